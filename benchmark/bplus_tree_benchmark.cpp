@@ -0,0 +1,99 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Micro-benchmarks for B+ tree index insert and point lookup.
+//
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "storage/common/bplus_tree.h"
+
+static const char *BENCHMARK_FILE = "bplus_tree_benchmark.index";
+
+static RID make_rid(int i)
+{
+  RID rid;
+  rid.page_num = i / 100 + 1;
+  rid.slot_num = i % 100;
+  return rid;
+}
+
+static std::vector<int> shuffled_keys(int key_num)
+{
+  std::vector<int> keys(key_num);
+  for (int i = 0; i < key_num; i++) {
+    keys[i] = i;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+  return keys;
+}
+
+/**
+ * 按随机顺序插入key_num个int类型的key，每一轮都从空树开始
+ */
+static void BM_BplusTreeInsert(benchmark::State &state)
+{
+  const int key_num = state.range(0);
+  const std::vector<int> keys = shuffled_keys(key_num);
+  for (auto _ : state) {
+    state.PauseTiming();
+    remove(BENCHMARK_FILE);
+    BplusTreeHandler handler;
+    handler.create(BENCHMARK_FILE, INTS, sizeof(int));
+    state.ResumeTiming();
+
+    for (int key : keys) {
+      RID rid = make_rid(key);
+      handler.insert_entry((const char *)&key, &rid);
+    }
+
+    state.PauseTiming();
+    handler.close();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * key_num);
+  remove(BENCHMARK_FILE);
+}
+BENCHMARK(BM_BplusTreeInsert)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+/**
+ * 在有key_num个key的树上按随机顺序查找存在的key
+ */
+static void BM_BplusTreeGet(benchmark::State &state)
+{
+  const int key_num = state.range(0);
+  const std::vector<int> keys = shuffled_keys(key_num);
+  remove(BENCHMARK_FILE);
+  BplusTreeHandler handler;
+  handler.create(BENCHMARK_FILE, INTS, sizeof(int));
+  for (int key : keys) {
+    RID rid = make_rid(key);
+    handler.insert_entry((const char *)&key, &rid);
+  }
+
+  size_t i = 0;
+  for (auto _ : state) {
+    const int key = keys[i];
+    RID rid = make_rid(key);
+    benchmark::DoNotOptimize(handler.get_entry((const char *)&key, &rid));
+    i = (i + 1) % keys.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  handler.close();
+  remove(BENCHMARK_FILE);
+}
+BENCHMARK(BM_BplusTreeGet)->Arg(1000)->Arg(100000);
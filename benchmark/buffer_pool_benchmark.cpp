@@ -0,0 +1,128 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Micro-benchmarks for the disk buffer pool and the LRU replacer.
+//
+
+#include <unistd.h>
+
+#include "benchmark/benchmark.h"
+#include "storage/default/disk_buffer_pool.h"
+
+static const char *BENCHMARK_FILE = "buffer_pool_benchmark.data";
+
+/**
+ * 创建一个有page_num个数据页的文件，缓冲池中有frame_num个页帧
+ */
+static void prepare_pool(DiskBufferPool &pool, int page_num, int *file_id)
+{
+  unlink(BENCHMARK_FILE);
+  pool.create_file(BENCHMARK_FILE);
+  pool.open_file(BENCHMARK_FILE, file_id);
+  for (int i = 0; i < page_num; i++) {
+    BPPageHandle page_handle;
+    pool.allocate_page(*file_id, &page_handle);
+    pool.mark_dirty(&page_handle);
+    pool.unpin_page(&page_handle);
+  }
+}
+
+static void cleanup_pool(DiskBufferPool &pool, int file_id)
+{
+  pool.close_file(file_id);
+  unlink(BENCHMARK_FILE);
+}
+
+/**
+ * 所有页面都在缓冲池中，每次都命中
+ */
+static void BM_GetThisPageHit(benchmark::State &state)
+{
+  const int page_num = 64;
+  DiskBufferPool pool(256);
+  int file_id = -1;
+  prepare_pool(pool, page_num, &file_id);
+
+  PageNum page = 0;
+  for (auto _ : state) {
+    BPPageHandle page_handle;
+    pool.get_this_page(file_id, page + 1, &page_handle);
+    pool.unpin_page(&page_handle);
+    page = (page + 1) % page_num;
+  }
+  state.SetItemsProcessed(state.iterations());
+  cleanup_pool(pool, file_id);
+}
+BENCHMARK(BM_GetThisPageHit);
+
+/**
+ * 顺序访问的页面数是页帧数的两倍，LRU下每次都不命中，需要淘汰页面并从文件中读取
+ */
+static void BM_GetThisPageMiss(benchmark::State &state)
+{
+  const int frame_num = 16;
+  const int page_num = frame_num * 2;
+  DiskBufferPool pool(frame_num);
+  int file_id = -1;
+  prepare_pool(pool, page_num, &file_id);
+
+  PageNum page = 0;
+  for (auto _ : state) {
+    BPPageHandle page_handle;
+    pool.get_this_page(file_id, page + 1, &page_handle);
+    pool.unpin_page(&page_handle);
+    page = (page + 1) % page_num;
+  }
+  state.SetItemsProcessed(state.iterations());
+  cleanup_pool(pool, file_id);
+}
+BENCHMARK(BM_GetThisPageMiss);
+
+/**
+ * 访问一个页面时replacer上的操作：pin之后unpin，放到LRU链表的最后
+ */
+static void BM_LRUReplacerPinUnpin(benchmark::State &state)
+{
+  const int frame_num = state.range(0);
+  LRUReplacer replacer(frame_num);
+  for (int i = 0; i < frame_num; i++) {
+    replacer.Unpin(i);
+  }
+
+  int frame_id = 0;
+  for (auto _ : state) {
+    replacer.Pin(frame_id);
+    replacer.Unpin(frame_id);
+    frame_id = (frame_id + 1) % frame_num;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LRUReplacerPinUnpin)->Arg(64)->Arg(4096);
+
+/**
+ * 淘汰一个页帧之后再放回去，对应缓冲池不命中时的操作
+ */
+static void BM_LRUReplacerVictim(benchmark::State &state)
+{
+  const int frame_num = state.range(0);
+  LRUReplacer replacer(frame_num);
+  for (int i = 0; i < frame_num; i++) {
+    replacer.Unpin(i);
+  }
+
+  for (auto _ : state) {
+    int frame_id = -1;
+    replacer.Victim(&frame_id);
+    replacer.Unpin(frame_id);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LRUReplacerVictim)->Arg(64)->Arg(4096);
@@ -0,0 +1,115 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Micro-benchmarks for evaluating conditions on records.
+//
+
+#include <string.h>
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "storage/common/condition_filter.h"
+#include "storage/common/record_manager.h"
+
+// 记录格式：id(int) | f(float) | name(char(8)) | 三个字段的null位图
+#define ID_OFFSET 0
+#define F_OFFSET 4
+#define NAME_OFFSET 8
+#define NULL_OFFSET 16
+#define RECORD_SIZE 20
+#define RECORD_NUM 1024
+
+static std::vector<char> make_records()
+{
+  std::vector<char> data(RECORD_NUM * RECORD_SIZE, 0);
+  for (int i = 0; i < RECORD_NUM; i++) {
+    char *record = data.data() + i * RECORD_SIZE;
+    const float f = i * 0.5f;
+    memcpy(record + ID_OFFSET, &i, sizeof(i));
+    memcpy(record + F_OFFSET, &f, sizeof(f));
+    snprintf(record + NAME_OFFSET, 8, "n%d", i % 100);
+  }
+  return data;
+}
+
+static ConDesc attr_desc(int offset, int length, int null_bit)
+{
+  return ConDesc{true, NullFlag{NULL_OFFSET, (unsigned char)(1 << null_bit)}, length, offset, nullptr};
+}
+
+static ConDesc value_desc(void *value)
+{
+  return ConDesc{false, NullFlag(), 0, 0, value};
+}
+
+static int int_value = RECORD_NUM / 2;
+static float float_value = RECORD_NUM / 4.0f;
+static char string_value[] = "n50";
+
+/**
+ * 字段和常量比较，参数是字段类型：0 int, 1 float, 2 char
+ */
+static RC init_filter(int type, DefaultConditionFilter &filter)
+{
+  switch (type) {
+    case 0:
+      return filter.init(attr_desc(ID_OFFSET, 4, 0), value_desc(&int_value), INTS, LESS_THAN, INTS);
+    case 1:
+      return filter.init(attr_desc(F_OFFSET, 4, 1), value_desc(&float_value), FLOATS, LESS_THAN, FLOATS);
+    default:
+      return filter.init(attr_desc(NAME_OFFSET, 8, 2), value_desc(string_value), CHARS, EQUAL_TO, CHARS);
+  }
+}
+
+/**
+ * 一次过滤一条记录
+ */
+static void BM_ConditionFilterRecord(benchmark::State &state)
+{
+  std::vector<char> data = make_records();
+  DefaultConditionFilter filter;
+  init_filter(state.range(0), filter);
+
+  for (auto _ : state) {
+    int count = 0;
+    Record record;
+    for (int i = 0; i < RECORD_NUM; i++) {
+      record.data = data.data() + i * RECORD_SIZE;
+      count += filter.filter(record) ? 1 : 0;
+    }
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetItemsProcessed(state.iterations() * RECORD_NUM);
+}
+BENCHMARK(BM_ConditionFilterRecord)->Arg(0)->Arg(1)->Arg(2);
+
+/**
+ * 一次过滤一批记录
+ */
+static void BM_ConditionFilterBatch(benchmark::State &state)
+{
+  std::vector<char> data = make_records();
+  std::vector<const char *> records(RECORD_NUM);
+  for (int i = 0; i < RECORD_NUM; i++) {
+    records[i] = data.data() + i * RECORD_SIZE;
+  }
+  DefaultConditionFilter filter;
+  init_filter(state.range(0), filter);
+
+  std::vector<uint8_t> sel(RECORD_NUM);
+  for (auto _ : state) {
+    filter.filter(records.data(), RECORD_NUM, sel.data());
+    benchmark::DoNotOptimize(sel.data());
+  }
+  state.SetItemsProcessed(state.iterations() * RECORD_NUM);
+}
+BENCHMARK(BM_ConditionFilterBatch)->Arg(0)->Arg(1)->Arg(2);
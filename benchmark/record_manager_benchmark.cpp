@@ -0,0 +1,113 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Micro-benchmarks for inserting and scanning records on a page.
+//
+
+#include <string.h>
+#include <unistd.h>
+
+#include "benchmark/benchmark.h"
+#include "storage/common/record_manager.h"
+
+static const char *BENCHMARK_FILE = "record_manager_benchmark.data";
+
+/**
+ * 在一个空页面上不停地插入记录，页面满了之后重新初始化成空页面
+ */
+static void BM_RecordPageInsert(benchmark::State &state)
+{
+  const int record_size = state.range(0);
+  unlink(BENCHMARK_FILE);
+  DiskBufferPool pool(16);
+  int file_id = -1;
+  pool.create_file(BENCHMARK_FILE);
+  pool.open_file(BENCHMARK_FILE, &file_id);
+  BPPageHandle page_handle;
+  pool.allocate_page(file_id, &page_handle);
+  PageNum page_num = 0;
+  pool.get_page_num(&page_handle, &page_num);
+  pool.unpin_page(&page_handle);
+
+  char data[record_size];
+  memset(data, 0x5a, record_size);
+  RecordPageHandler handler;
+  handler.init_empty_page(pool, file_id, page_num, record_size);
+  for (auto _ : state) {
+    RID rid;
+    if (handler.insert_record(data, &rid) != RC::SUCCESS) {
+      state.PauseTiming();
+      handler.deinit();
+      handler.init_empty_page(pool, file_id, page_num, record_size);
+      state.ResumeTiming();
+    }
+  }
+  handler.deinit();
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * record_size);
+
+  pool.close_file(file_id);
+  unlink(BENCHMARK_FILE);
+}
+BENCHMARK(BM_RecordPageInsert)->Arg(16)->Arg(100);
+
+static RC count_record(Record *record, void *context)
+{
+  (*(int *)context)++;
+  return RC::SUCCESS;
+}
+
+/**
+ * 扫描一个写满的页面，分别用get_next_record逐条读取和visit_records访问
+ */
+static void BM_RecordPageScan(benchmark::State &state)
+{
+  const int record_size = 100;
+  const bool visit = state.range(0) != 0;
+  unlink(BENCHMARK_FILE);
+  DiskBufferPool pool(16);
+  int file_id = -1;
+  pool.create_file(BENCHMARK_FILE);
+  pool.open_file(BENCHMARK_FILE, &file_id);
+  BPPageHandle page_handle;
+  pool.allocate_page(file_id, &page_handle);
+  PageNum page_num = 0;
+  pool.get_page_num(&page_handle, &page_num);
+  pool.unpin_page(&page_handle);
+
+  char data[record_size];
+  memset(data, 0x5a, record_size);
+  RecordPageHandler handler;
+  handler.init_empty_page(pool, file_id, page_num, record_size);
+  int record_num = 0;
+  while (handler.insert_record(data, nullptr) == RC::SUCCESS) {
+    record_num++;
+  }
+
+  for (auto _ : state) {
+    int count = 0;
+    if (visit) {
+      handler.visit_records(count_record, &count);
+    } else {
+      Record record;
+      for (RC rc = handler.get_first_record(&record); rc == RC::SUCCESS; rc = handler.get_next_record(&record)) {
+        count++;
+      }
+    }
+    benchmark::DoNotOptimize(count);
+  }
+  handler.deinit();
+  state.SetItemsProcessed(state.iterations() * record_num);
+
+  pool.close_file(file_id);
+  unlink(BENCHMARK_FILE);
+}
+BENCHMARK(BM_RecordPageScan)->Arg(0)->Arg(1);
@@ -0,0 +1,67 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Micro-benchmarks for building tuples from records.
+//
+
+#include "benchmark/benchmark.h"
+#include "sql/executor/tuple.h"
+
+/**
+ * 和把一条记录转换成tuple时一样，依次加入int、float和字符串字段
+ */
+static void BM_TupleConstruct(benchmark::State &state)
+{
+  const int field_num = state.range(0);
+  int i = 0;
+  for (auto _ : state) {
+    Tuple tuple;
+    for (int f = 0; f < field_num; f++) {
+      switch (f % 3) {
+        case 0:
+          tuple.add(i);
+          break;
+        case 1:
+          tuple.add(i * 0.5f);
+          break;
+        default:
+          tuple.add("benchmark", 9);
+          break;
+      }
+    }
+    benchmark::DoNotOptimize(tuple.size());
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TupleConstruct)->Arg(3)->Arg(12);
+
+/**
+ * 连接时把左右两边的tuple合并成一个
+ */
+static void BM_TupleMerge(benchmark::State &state)
+{
+  Tuple left;
+  left.add(1);
+  left.add("left", 4);
+  Tuple right;
+  right.add(2.5f);
+  right.add("right", 5);
+  right.add(3);
+  for (auto _ : state) {
+    Tuple joined;
+    joined.merge(left);
+    joined.merge(right);
+    benchmark::DoNotOptimize(joined.size());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TupleMerge);
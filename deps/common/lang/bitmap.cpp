@@ -14,25 +14,24 @@ See the Mulan PSL v2 for more details. */
 
 #include "common/lang/bitmap.h"
 
+#include <stdint.h>
+#include <string.h>
+
 namespace common
 {
 
-int find_first_zero(char byte, int start) {
-  for (int i = start; i < 8; i++) {
-    if ((byte & (1 << i)) == 0) {
-      return i;
-    }
-  }
-  return -1;
-}
-
-int find_first_setted(char byte, int start) {
-  for (int i = start; i < 8; i++) {
-    if ((byte & (1 << i)) != 0) {
-      return i;
-    }
-  }
-  return -1;
+// 按64位的字查找，第index位在第index/8个字节的第index%8位，和小端的uint64_t位序相同。
+// 最后一个字不满8个字节时用0补齐
+static uint64_t load_word(const char *bitmap, int word_index, int byte_num)
+{
+  uint64_t word = 0;
+  int offset = word_index * 8;
+  int len = byte_num - offset < 8 ? byte_num - offset : 8;
+  memcpy(&word, bitmap + offset, len);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+  return word;
 }
 
 Bitmap::Bitmap(char *bitmap, int size) : bitmap_(bitmap), size_(size) {
@@ -54,47 +53,42 @@ void Bitmap::clear_bit(int index) {
 }
 
 int Bitmap::next_unsetted_bit(int start) {
-  int ret = -1;
-  int start_in_byte = start % 8;
-  for (int iter = start / 8, end = (size_ % 8 == 0 ? size_ / 8 : size_ / 8 + 1); iter <= end; iter++) {
-    char byte = bitmap_[iter];
-    if (byte != -1) {
-      int index_in_byte = find_first_zero(byte, start_in_byte);
-      if (index_in_byte >= 0) {
-        ret = iter * 8 + index_in_byte;
-        break;
-      }
-
-      start_in_byte = 0;
-    }
-  }
-
-  if (ret >= size_) {
-    ret = -1;
-  }
-  return ret;
+  return next_bit(start, true);
 }
 
 int Bitmap::next_setted_bit(int start) {
-  int ret = -1;
-  int start_in_byte = start % 8;
-  for (int iter = start / 8, end = (size_ % 8 == 0 ? size_ / 8 : size_ / 8 + 1); iter <= end; iter++) {
-    char byte = bitmap_[iter];
-    if (byte != 0x00) {
-      int index_in_byte = find_first_setted(byte, start_in_byte);
-      if (index_in_byte >= 0) {
-        ret = iter * 8 + index_in_byte;
-        break;
-      }
+  return next_bit(start, false);
+}
 
-      start_in_byte = 0;
-    }
+int Bitmap::next_bit(int start, bool unsetted) {
+  if (start < 0) {
+    start = 0;
+  }
+  if (start >= size_) {
+    return -1;
   }
 
-  if (ret >= size_) {
-    ret = -1;
+  const int byte_num = size_ % 8 == 0 ? size_ / 8 : size_ / 8 + 1;
+  const int word_num = (byte_num + 7) / 8;
+  int word_index = start / 64;
+  uint64_t word = load_word(bitmap_, word_index, byte_num);
+  if (unsetted) {
+    word = ~word;
   }
-  return ret;
+  word &= ~0ULL << (start % 64);
+  while (word == 0) {
+    if (++word_index >= word_num) {
+      return -1;
+    }
+    word = load_word(bitmap_, word_index, byte_num);
+    if (unsetted) {
+      word = ~word;
+    }
+  }
+
+  // 最后一个字节中超出size_的位不属于bitmap
+  int ret = word_index * 64 + __builtin_ctzll(word);
+  return ret < size_ ? ret : -1;
 }
 
 } // namespace common
\ No newline at end of file
@@ -29,6 +29,9 @@ public:
   int  next_unsetted_bit(int start);
   int  next_setted_bit(int start);
 
+private:
+  int  next_bit(int start, bool unsetted);
+
 private:
   char * bitmap_;
   int    size_;
@@ -0,0 +1,259 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Sampling profiler of mutex contention per lock site.
+//
+
+#include "common/lang/lock_profiler.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+
+#include "common/metrics/snapshot.h"
+
+namespace common {
+
+#define LOCK_CONTENTION_REPORT_SITES 20  // sites in one report, the ones waited longest
+
+std::atomic<bool> LockProfiler::enabled_(false);
+std::atomic<int> LockProfiler::sample_rate_(LOCK_PROFILER_DEFAULT_SAMPLE_RATE);
+
+namespace {
+
+std::atomic<int> site_num(0);
+std::atomic<const LockSite *> sites[LOCK_PROFILER_MAX_SITES];
+
+/**
+ * Counters of one thread. Only the owner writes them, with a relaxed load and store
+ * instead of an atomic add; collect may read them at any time.
+ */
+struct ThreadLockCounters {
+  std::atomic<bool> in_use;
+  std::atomic<uint64_t> acquisitions[LOCK_PROFILER_MAX_SITES];
+  std::atomic<uint64_t> contended[LOCK_PROFILER_MAX_SITES];
+  std::atomic<uint64_t> wait_ns[LOCK_PROFILER_MAX_SITES];
+  std::atomic<uint64_t> buckets[LOCK_PROFILER_MAX_SITES][LOCK_PROFILER_BUCKETS];
+};
+
+// counters of exited threads are kept, so their numbers stay in the totals, and reused by new threads.
+// not destroyed on exit, other threads may still be locking
+std::mutex &counters_mutex() {
+  static std::mutex *mutex = new std::mutex();
+  return *mutex;
+}
+std::vector<ThreadLockCounters *> &all_counters() {
+  static std::vector<ThreadLockCounters *> *counters = new std::vector<ThreadLockCounters *>();
+  return *counters;
+}
+
+class ThreadCountersHolder {
+public:
+  ~ThreadCountersHolder() {
+    if (counters_ != nullptr) {
+      counters_->in_use.store(false, std::memory_order_release);
+      counters_ = nullptr;
+    }
+  }
+
+  ThreadLockCounters *get() {
+    if (counters_ != nullptr) {
+      return counters_;
+    }
+    std::lock_guard<std::mutex> guard(counters_mutex());
+    for (ThreadLockCounters *counters : all_counters()) {
+      if (!counters->in_use.load(std::memory_order_acquire)) {
+        counters->in_use.store(true, std::memory_order_relaxed);
+        counters_ = counters;
+        return counters_;
+      }
+    }
+    counters_ = new ThreadLockCounters();
+    counters_->in_use.store(true, std::memory_order_relaxed);
+    all_counters().push_back(counters_);
+    return counters_;
+  }
+
+private:
+  ThreadLockCounters *counters_ = nullptr;
+};
+
+thread_local ThreadCountersHolder thread_counters;
+thread_local int sample_countdown = 0;
+
+inline void add(std::atomic<uint64_t> &counter, uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+uint64_t now_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+}  // namespace
+
+LockSite::LockSite(const char *file, int line) : file_(file), line_(line) {
+  id_ = site_num.fetch_add(1, std::memory_order_relaxed);
+  if (id_ >= LOCK_PROFILER_MAX_SITES) {
+    id_ = -1;
+    return;
+  }
+  sites[id_].store(this, std::memory_order_release);
+}
+
+std::string LockSite::name() const {
+  const char *base = strrchr(file_, '/');
+  std::string name(base != nullptr ? base + 1 : file_);
+  std::replace(name.begin(), name.end(), '.', '_');
+  return name + "_" + std::to_string(line_);
+}
+
+uint64_t LockSiteStats::wait_quantile_us(double quantile) const {
+  uint64_t total = 0;
+  for (uint64_t count : buckets) {
+    total += count;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const uint64_t rank = (uint64_t)(quantile * total);
+  uint64_t seen = 0;
+  for (int i = 0; i < LOCK_PROFILER_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen > rank) {
+      return 1ul << i;
+    }
+  }
+  return 1ul << (LOCK_PROFILER_BUCKETS - 1);
+}
+
+void LockProfiler::set_sample_rate(int rate) {
+  sample_rate_.store(std::max(rate, 1), std::memory_order_relaxed);
+}
+
+int LockProfiler::bucket_index(uint64_t wait_ns) {
+  const uint64_t us = wait_ns / 1000;
+  if (us == 0) {
+    return 0;
+  }
+  // bucket i holds [2^(i-1), 2^i) us
+  return std::min(64 - __builtin_clzl(us), LOCK_PROFILER_BUCKETS - 1);
+}
+
+int LockProfiler::sampled_lock(pthread_mutex_t *mutex, const LockSite &site) {
+  if (site.id() < 0 || --sample_countdown > 0) {
+    return pthread_mutex_lock(mutex);
+  }
+  const int rate = sample_rate();
+  sample_countdown = rate;
+
+  ThreadLockCounters *counters = thread_counters.get();
+  const int id = site.id();
+  int result = pthread_mutex_trylock(mutex);
+  if (result == 0) {
+    add(counters->acquisitions[id], rate);
+    return result;
+  }
+  if (result != EBUSY) {
+    return pthread_mutex_lock(mutex);
+  }
+
+  const uint64_t start = now_ns();
+  result = pthread_mutex_lock(mutex);
+  const uint64_t wait = now_ns() - start;
+  add(counters->acquisitions[id], rate);
+  add(counters->contended[id], rate);
+  add(counters->wait_ns[id], wait * rate);
+  add(counters->buckets[id][bucket_index(wait)], rate);
+  return result;
+}
+
+void LockProfiler::collect(std::vector<const LockSite *> &site_list, std::vector<LockSiteStats> &stats) {
+  const int num = std::min(site_num.load(std::memory_order_relaxed), LOCK_PROFILER_MAX_SITES);
+  site_list.assign(num, nullptr);
+  stats.assign(num, LockSiteStats());
+  for (int i = 0; i < num; i++) {
+    site_list[i] = sites[i].load(std::memory_order_acquire);
+  }
+
+  std::lock_guard<std::mutex> guard(counters_mutex());
+  for (const ThreadLockCounters *counters : all_counters()) {
+    for (int i = 0; i < num; i++) {
+      LockSiteStats &site_stats = stats[i];
+      site_stats.acquisitions += counters->acquisitions[i].load(std::memory_order_relaxed);
+      site_stats.contended += counters->contended[i].load(std::memory_order_relaxed);
+      site_stats.wait_ns += counters->wait_ns[i].load(std::memory_order_relaxed);
+      for (int j = 0; j < LOCK_PROFILER_BUCKETS; j++) {
+        site_stats.buckets[j] += counters->buckets[i][j].load(std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+LockContentionMetric::~LockContentionMetric() {
+  if (snapshot_value_ != nullptr) {
+    delete snapshot_value_;
+    snapshot_value_ = nullptr;
+  }
+}
+
+void LockContentionMetric::snapshot() {
+  std::vector<const LockSite *> sites;
+  std::vector<LockSiteStats> totals;
+  LockProfiler::collect(sites, totals);
+
+  // numbers of this interval
+  std::vector<std::pair<const LockSite *, LockSiteStats>> intervals;
+  last_.resize(totals.size());
+  for (size_t i = 0; i < totals.size(); i++) {
+    LockSiteStats interval;
+    interval.acquisitions = totals[i].acquisitions - last_[i].acquisitions;
+    interval.contended = totals[i].contended - last_[i].contended;
+    interval.wait_ns = totals[i].wait_ns - last_[i].wait_ns;
+    for (int j = 0; j < LOCK_PROFILER_BUCKETS; j++) {
+      interval.buckets[j] = totals[i].buckets[j] - last_[i].buckets[j];
+    }
+    if (sites[i] != nullptr && interval.acquisitions > 0) {
+      intervals.emplace_back(sites[i], interval);
+    }
+  }
+  last_ = std::move(totals);
+
+  std::sort(intervals.begin(), intervals.end(),
+      [](const std::pair<const LockSite *, LockSiteStats> &left,
+          const std::pair<const LockSite *, LockSiteStats> &right) {
+        return left.second.wait_ns > right.second.wait_ns;
+      });
+  if (intervals.size() > LOCK_CONTENTION_REPORT_SITES) {
+    intervals.resize(LOCK_CONTENTION_REPORT_SITES);
+  }
+
+  std::stringstream oss;
+  for (size_t i = 0; i < intervals.size(); i++) {
+    const std::string name = intervals[i].first->name();
+    const LockSiteStats &stats = intervals[i].second;
+    oss << (i > 0 ? "," : "") << name << "_acquisitions:" << stats.acquisitions << "," << name
+        << "_contended:" << stats.contended << "," << name << "_wait_us:" << stats.wait_ns / 1000 << ","
+        << name << "_p99_wait_us:" << stats.wait_quantile_us(0.99);
+  }
+  std::string value = oss.str();
+  if (snapshot_value_ == nullptr) {
+    snapshot_value_ = new SnapshotBasic<std::string>();
+  }
+  ((SnapshotBasic<std::string> *)snapshot_value_)->setValue(value);
+}
+
+} // namespace common
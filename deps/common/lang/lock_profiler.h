@@ -0,0 +1,127 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Sampling profiler of mutex contention per lock site.
+//
+
+#ifndef __COMMON_LANG_LOCK_PROFILER_H__
+#define __COMMON_LANG_LOCK_PROFILER_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "common/metrics/metric.h"
+
+namespace common {
+
+#define LOCK_PROFILER_MAX_SITES 256        // sites beyond this are locked without profiling
+#define LOCK_PROFILER_BUCKETS 24           // wait time buckets: [0, 1us), [1us, 2us), ... [2^22us, inf)
+#define LOCK_PROFILER_DEFAULT_SAMPLE_RATE 8
+
+/**
+ * One MUTEX_LOCK in the source, created on the first execution of the macro.
+ * Sites are never destroyed, the id indexes the per thread counters.
+ */
+class LockSite {
+public:
+  LockSite(const char *file, int line);
+
+  const char *file() const { return file_; }
+  int line() const { return line_; }
+  int id() const { return id_; }
+
+  /**
+   * "file_line" with the directory stripped, usable in a metric name
+   */
+  std::string name() const;
+
+private:
+  const char *file_;
+  int line_;
+  int id_;
+};
+
+/**
+ * Accumulated numbers of one lock site. Counts are estimates of all acquisitions:
+ * every sampled acquisition counts as many as the sample rate at that time.
+ */
+struct LockSiteStats {
+  uint64_t acquisitions = 0;
+  uint64_t contended = 0;   // the mutex was held by another thread
+  uint64_t wait_ns = 0;
+  uint64_t buckets[LOCK_PROFILER_BUCKETS] = {0};
+
+  /**
+   * Upper bound of the bucket containing the quantile of the contended waits, in us
+   */
+  uint64_t wait_quantile_us(double quantile) const;
+};
+
+/**
+ * Contention profiler behind MUTEX_LOCK. Disabled it costs one relaxed load per lock.
+ * Enabled, one of every sample_rate acquisitions of a thread tries the mutex first
+ * and measures how long it waits when the mutex is held. The numbers go to counters
+ * of the calling thread that only it writes, so the hot path has no shared writes;
+ * collect sums the counters of all threads.
+ */
+class LockProfiler {
+public:
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+  static void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+  static int sample_rate() { return sample_rate_.load(std::memory_order_relaxed); }
+  /**
+   * 1 profiles every acquisition
+   */
+  static void set_sample_rate(int rate);
+
+  static int acquire(pthread_mutex_t *mutex, const LockSite &site) {
+    if (!enabled()) {
+      return pthread_mutex_lock(mutex);
+    }
+    return sampled_lock(mutex, site);
+  }
+
+  /**
+   * Accumulated numbers of every site since start, indexed by site id
+   */
+  static void collect(std::vector<const LockSite *> &sites, std::vector<LockSiteStats> &stats);
+
+  static int bucket_index(uint64_t wait_ns);
+
+private:
+  static int sampled_lock(pthread_mutex_t *mutex, const LockSite &site);
+
+private:
+  static std::atomic<bool> enabled_;
+  static std::atomic<int> sample_rate_;
+};
+
+/**
+ * Contention of every lock site in the last report interval, the hottest site first
+ */
+class LockContentionMetric : public Metric {
+public:
+  virtual ~LockContentionMetric();
+
+  void snapshot() override;
+
+private:
+  std::vector<LockSiteStats> last_;  // totals at the previous snapshot
+};
+
+} // namespace common
+
+#endif //__COMMON_LANG_LOCK_PROFILER_H__
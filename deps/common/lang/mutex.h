@@ -24,6 +24,7 @@ See the Mulan PSL v2 for more details. */
 #include <string>
 #include <sys/types.h>
 
+#include "common/lang/lock_profiler.h"
 #include "common/log/log.h"
 
 namespace common {
@@ -101,7 +102,12 @@ class LockTrace {
 #define MUTEXT_STATIC_INIT() PTHREAD_MUTEX_INITIALIZER
 #define MUTEX_INIT(lock, attr) pthread_mutex_init(lock, attr)
 #define MUTEX_DESTROY(lock) pthread_mutex_destroy(lock)
-#define MUTEX_LOCK(lock) pthread_mutex_lock(lock)
+// every MUTEX_LOCK is a site of the contention profiler, see LockProfiler
+#define MUTEX_LOCK(lock)                                                       \
+  ({                                                                           \
+    static const common::LockSite __lock_site(__FILE__, __LINE__);             \
+    common::LockProfiler::acquire(lock, __lock_site);                          \
+  })
 #define MUTEX_UNLOCK(lock) pthread_mutex_unlock(lock)
 #define MUTEX_TRYLOCK(lock) pthread_mutex_trylock(lock)
 
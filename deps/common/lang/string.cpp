@@ -19,6 +19,7 @@ See the Mulan PSL v2 for more details. */
 #include <string.h>
 
 #include <algorithm>
+#include <charconv>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -235,4 +236,69 @@ bool is_blank(const char *s) {
   return true;
 }
 
+bool str_to_memory_size(const std::string &str, size_t &size) {
+  std::string num_str = str;
+  strip(num_str);
+  if (num_str.empty()) {
+    return false;
+  }
+
+  long long unit = 1;
+  switch (num_str.back()) {
+    case 'k':
+    case 'K':
+      unit = 1LL << 10;
+      break;
+    case 'm':
+    case 'M':
+      unit = 1LL << 20;
+      break;
+    case 'g':
+    case 'G':
+      unit = 1LL << 30;
+      break;
+    default:
+      break;
+  }
+  if (unit != 1) {
+    num_str.pop_back();
+  }
+
+  long long num = 0;
+  if (!str_to_val(num_str, num) || num < 0) {
+    return false;
+  }
+  size = (size_t)(num * unit);
+  return true;
+}
+
+/**
+ * std::from_chars does not accept a leading '+', strtol does.
+ */
+static bool skip_plus(std::string_view &str) {
+  if (!str.empty() && str[0] == '+') {
+    str.remove_prefix(1);
+    return !str.empty() && str[0] != '-';
+  }
+  return !str.empty();
+}
+
+bool str_to_int(std::string_view str, int &val) {
+  if (!skip_plus(str)) {
+    return false;
+  }
+  const char *end = str.data() + str.size();
+  std::from_chars_result result = std::from_chars(str.data(), end, val);
+  return result.ec == std::errc() && result.ptr == end;
+}
+
+bool str_to_float(std::string_view str, float &val) {
+  if (!skip_plus(str)) {
+    return false;
+  }
+  const char *end = str.data() + str.size();
+  std::from_chars_result result = std::from_chars(str.data(), end, val);
+  return result.ec == std::errc() && result.ptr == end;
+}
+
 } //namespace common
@@ -25,6 +25,7 @@ See the Mulan PSL v2 for more details. */
 #include <set>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <typeinfo>
 #include <vector>
 
@@ -158,5 +159,25 @@ template <class T> std::string get_type_name(const T &val) {
 
 bool is_blank(const char *s);
 
+/**
+ * Parse a memory size such as "64", "512K", "16M" or "1G". The suffix is
+ * case insensitive and means a power of 1024.
+ * @return false if str is empty, negative or not a number
+ */
+bool str_to_memory_size(const std::string &str, size_t &size);
+
+/**
+ * Parse the whole string as a decimal integer with std::from_chars. No
+ * memory is allocated and the locale is ignored. A leading '+' is accepted.
+ * @return false if str is empty, has trailing characters or is out of range
+ */
+bool str_to_int(std::string_view str, int &val);
+
+/**
+ * Parse the whole string as a float with std::from_chars, the same rules as
+ * str_to_int.
+ */
+bool str_to_float(std::string_view str, float &val);
+
 } //namespace common
 #endif // __COMMON_LANG_STRING_H__
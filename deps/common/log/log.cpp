@@ -16,6 +16,9 @@ See the Mulan PSL v2 for more details. */
 #include <exception>
 #include <stdarg.h>
 #include <stdio.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
 
 #include "common/lang/string.h"
 #include "common/log/log.h"
@@ -23,9 +26,89 @@ namespace common {
 
 Log *g_log = nullptr;
 
+static std::atomic<uint64_t> next_log_id(0);
+
+/**
+ * 一个线程在异步模式下写日志的环形缓冲区。只有这个线程写入，同时只有一个线程(持有Log::lock_)读取，
+ * 写入方写完一整行之后才移动tail_，读取方看到的都是完整的行
+ */
+class AsyncLogBuffer {
+ public:
+  AsyncLogBuffer() : data_(LOG_ASYNC_BUFFER_SIZE), head_(0), tail_(0), exited_(false) {}
+
+  /**
+   * 剩余空间不够时返回false，不写入任何内容
+   */
+  bool push(const char *prefix, size_t prefix_len, const char *msg, size_t msg_len, bool newline) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const size_t len = prefix_len + msg_len + (newline ? 1 : 0);
+    if (len > data_.size() - (tail - head)) {
+      return false;
+    }
+    copy_in(tail, prefix, prefix_len);
+    copy_in(tail + prefix_len, msg, msg_len);
+    if (newline) {
+      copy_in(tail + prefix_len + msg_len, "\n", 1);
+    }
+    tail_.store(tail + len, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * 把缓冲区中所有的日志追加到output中
+   */
+  void pop_all(std::string &output) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    const size_t start = head % data_.size();
+    const size_t len = tail - head;
+    const size_t first = std::min(len, data_.size() - start);
+    output.append(&data_[start], first);
+    output.append(&data_[0], len - first);
+    head_.store(tail, std::memory_order_release);
+  }
+
+  bool empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+  size_t capacity() const { return data_.size(); }
+
+  bool exited() const { return exited_; }
+  void set_exited() { exited_ = true; }
+
+ private:
+  void copy_in(uint64_t pos, const char *src, size_t len) {
+    const size_t start = pos % data_.size();
+    const size_t first = std::min(len, data_.size() - start);
+    memcpy(&data_[start], src, first);
+    memcpy(&data_[0], src + first, len - first);
+  }
+
+ private:
+  std::vector<char> data_;
+  std::atomic<uint64_t> head_;  // 读取方读到的位置，只增加，取模之后是在data_中的位置
+  std::atomic<uint64_t> tail_;  // 写入方写到的位置
+  std::atomic<bool> exited_;    // 线程已经退出，读完之后可以释放
+};
+
+/**
+ * 线程在各个Log中的缓冲区。线程退出时标记缓冲区，由后台线程读完之后释放
+ */
+struct ThreadLogBuffers {
+  std::vector<std::pair<uint64_t, std::shared_ptr<AsyncLogBuffer>>> buffers;
+
+  ~ThreadLogBuffers() {
+    for (auto &item : buffers) {
+      item.second->set_exited();
+    }
+  }
+};
+
+static thread_local ThreadLogBuffers thread_log_buffers;
+
 Log::Log(const std::string &log_file_name, const LOG_LEVEL log_level,
          const LOG_LEVEL console_level)
-    : log_name_(log_file_name), log_level_(log_level), console_level_(console_level) {
+    : log_name_(log_file_name), log_level_(log_level), console_level_(console_level),
+      id_(next_log_id++), async_(false), stop_writer_(false), urgent_(false), last_flush_time_(0) {
   prefix_map_[LOG_LEVEL_PANIC] = "PANIC:";
   prefix_map_[LOG_LEVEL_ERR] = "ERROR:";
   prefix_map_[LOG_LEVEL_WARN] = "WARNNING:";
@@ -34,6 +117,8 @@ Log::Log(const std::string &log_file_name, const LOG_LEVEL log_level,
   prefix_map_[LOG_LEVEL_TRACE] = "TRACE:";
 
   pthread_mutex_init(&lock_, nullptr);
+  pthread_mutex_init(&buffers_lock_, nullptr);
+  pthread_cond_init(&cond_, nullptr);
 
   log_date_.year_ = -1;
   log_date_.mon_ = -1;
@@ -46,12 +131,16 @@ Log::Log(const std::string &log_file_name, const LOG_LEVEL log_level,
 }
 
 Log::~Log(void) {
+  set_async(false);
+
   pthread_mutex_lock(&lock_);
   if (ofs_.is_open()) {
     ofs_.close();
   }
   pthread_mutex_unlock(&lock_);
 
+  pthread_cond_destroy(&cond_);
+  pthread_mutex_destroy(&buffers_lock_);
   pthread_mutex_destroy(&lock_);
 }
 
@@ -79,54 +168,194 @@ bool Log::check_output(const LOG_LEVEL level, const char *module) {
 
 int Log::output(const LOG_LEVEL level, const char *module, const char *prefix,
                 const char *f, ...) {
-  bool locked = false;
+  // 先判断是否需要输出，不需要时不格式化
+  const bool default_module = !default_set_.empty() && default_set_.find(module) != default_set_.end();
+  const bool to_console = (LOG_LEVEL_PANIC <= level && level <= console_level_) || default_module;
+  const bool to_file = (LOG_LEVEL_PANIC <= level && level <= log_level_) || default_module;
+  if (!to_console && !to_file) {
+    return LOG_STATUS_OK;
+  }
+
   try {
     va_list args;
     char msg[ONE_KILO];
 
     va_start(args, f);
-    vsnprintf(msg, sizeof(msg), f, args);
+    int len = vsnprintf(msg, sizeof(msg), f, args);
     va_end(args);
+    len = std::max(0, std::min(len, (int)sizeof(msg) - 1));
 
-    if (LOG_LEVEL_PANIC <= level && level <= console_level_) {
-      std::cout << msg << std::endl;
-    } else if (default_set_.find(module) != default_set_.end()) {
+    if (to_console) {
       std::cout << msg << std::endl;
     }
+    if (to_file) {
+      return write_line(level, prefix, msg, len, true);
+    }
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return LOG_STATUS_ERR;
+  }
 
-    if (LOG_LEVEL_PANIC <= level && level <= log_level_) {
-      pthread_mutex_lock(&lock_);
-      locked = true;
-      ofs_ << prefix;
-      ofs_ << msg;
-      ofs_ << "\n";
-      ofs_.flush();
-      log_line_++;
-      pthread_mutex_unlock(&lock_);
-      locked = false;
-    } else if (default_set_.find(module) != default_set_.end()) {
+  return LOG_STATUS_OK;
+}
+
+int Log::write_line(const LOG_LEVEL level, const char *prefix, const char *msg, size_t msg_len, bool newline) {
+  const size_t prefix_len = strlen(prefix);
+  AsyncLogBuffer *buffer = async_ ? thread_buffer() : nullptr;
+  if (buffer == nullptr || prefix_len + msg_len + 1 > buffer->capacity() / 2) {
+    // 同步模式，或者一行太长，直接写文件
+    pthread_mutex_lock(&lock_);
+    write_direct(prefix, msg, msg_len, newline);
+    ofs_.flush();
+    pthread_mutex_unlock(&lock_);
+    return LOG_STATUS_OK;
+  }
+
+  while (!buffer->push(prefix, prefix_len, msg, msg_len, newline)) {
+    // 缓冲区满了，叫醒后台线程，等它读走一些
+    urgent_ = true;
+    pthread_cond_signal(&cond_);
+    usleep(100);
+    if (!async_) {
+      // 已经关闭了异步模式，后台线程不会再读，自己把缓冲区写出
       pthread_mutex_lock(&lock_);
-      locked = true;
-      ofs_ << prefix;
-      ofs_ << msg;
-      ofs_ << "\n";
-      ofs_.flush();
-      log_line_++;
+      drain_buffers(false);
       pthread_mutex_unlock(&lock_);
-      locked = false;
     }
+  }
+  if (!async_) {
+    // 写入的同时关闭了异步模式，后台线程可能已经读完了最后一次
+    pthread_mutex_lock(&lock_);
+    drain_buffers(true);
+    pthread_mutex_unlock(&lock_);
+  } else if (level <= LOG_LEVEL_ERR) {
+    urgent_ = true;
+    pthread_cond_signal(&cond_);
+  }
+  return LOG_STATUS_OK;
+}
 
-  } catch (std::exception &e) {
-    if (locked) {
-      pthread_mutex_unlock(&lock_);
+void Log::write_direct(const char *prefix, const char *msg, size_t msg_len, bool newline) {
+  ofs_ << prefix;
+  ofs_.write(msg, msg_len);
+  if (newline) {
+    ofs_ << "\n";
+  }
+  log_line_++;
+}
+
+AsyncLogBuffer *Log::thread_buffer() {
+  for (auto &item : thread_log_buffers.buffers) {
+    if (item.first == id_) {
+      return item.second.get();
     }
-    std::cerr << e.what() << std::endl;
-    return LOG_STATUS_ERR;
+  }
+  std::shared_ptr<AsyncLogBuffer> buffer = std::make_shared<AsyncLogBuffer>();
+  thread_log_buffers.buffers.emplace_back(id_, buffer);
+  pthread_mutex_lock(&buffers_lock_);
+  buffers_.push_back(buffer);
+  pthread_mutex_unlock(&buffers_lock_);
+  return buffer.get();
+}
+
+void Log::drain_buffers(bool force_flush) {
+  std::vector<std::shared_ptr<AsyncLogBuffer>> buffers;
+  pthread_mutex_lock(&buffers_lock_);
+  buffers = buffers_;
+  pthread_mutex_unlock(&buffers_lock_);
+
+  std::string batch;
+  for (std::shared_ptr<AsyncLogBuffer> &buffer : buffers) {
+    // 先看线程是否退出再读，读完之后就不会再有新的日志
+    const bool exited = buffer->exited();
+    buffer->pop_all(batch);
+    if (exited) {
+      pthread_mutex_lock(&buffers_lock_);
+      buffers_.erase(std::remove(buffers_.begin(), buffers_.end(), buffer), buffers_.end());
+      pthread_mutex_unlock(&buffers_lock_);
+    }
+  }
+
+  time_t now = time(nullptr);
+  if (!batch.empty()) {
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    if (rotate_type_ == LOG_ROTATE_BYDAY) {
+      rotate_by_day(tm_now.tm_year + 1900, tm_now.tm_mon + 1, tm_now.tm_mday);
+    } else {
+      rotate_by_size();
+    }
+    ofs_.write(batch.data(), batch.size());
+    log_line_ += (int)std::count(batch.begin(), batch.end(), '\n');
+  }
+  if (force_flush || (now - last_flush_time_) * 1000 >= LOG_ASYNC_FLUSH_INTERVAL_MS) {
+    ofs_.flush();
+    last_flush_time_ = now;
+  }
+}
+
+void *Log::async_writer(void *param) {
+  Log *log = (Log *)param;
+  while (!log->stop_writer_) {
+    pthread_mutex_lock(&log->buffers_lock_);
+    if (!log->urgent_ && !log->stop_writer_) {
+      struct timeval now;
+      gettimeofday(&now, nullptr);
+      long nsec = now.tv_usec * 1000L + LOG_ASYNC_WRITE_INTERVAL_MS * 1000000L;
+      struct timespec deadline = {now.tv_sec + nsec / 1000000000L, nsec % 1000000000L};
+      pthread_cond_timedwait(&log->cond_, &log->buffers_lock_, &deadline);
+    }
+    pthread_mutex_unlock(&log->buffers_lock_);
+
+    const bool urgent = log->urgent_.exchange(false);
+    pthread_mutex_lock(&log->lock_);
+    log->drain_buffers(urgent);
+    pthread_mutex_unlock(&log->lock_);
+  }
+  return nullptr;
+}
+
+int Log::set_async(bool async) {
+  pthread_mutex_lock(&buffers_lock_);
+  if (async == async_) {
+    pthread_mutex_unlock(&buffers_lock_);
+    return LOG_STATUS_OK;
+  }
+  if (async) {
+    stop_writer_ = false;
+    if (pthread_create(&writer_, nullptr, async_writer, this) != 0) {
+      pthread_mutex_unlock(&buffers_lock_);
+      std::cerr << "Failed to create async log writer thread" << SYS_OUTPUT_ERROR << std::endl;
+      return LOG_STATUS_ERR;
+    }
+    async_ = true;
+    pthread_mutex_unlock(&buffers_lock_);
+    return LOG_STATUS_OK;
   }
 
+  async_ = false;
+  stop_writer_ = true;
+  pthread_cond_signal(&cond_);
+  pthread_mutex_unlock(&buffers_lock_);
+  pthread_join(writer_, nullptr);
+
+  // 后台线程停止之后缓冲区中剩下的日志
+  pthread_mutex_lock(&lock_);
+  drain_buffers(true);
+  pthread_mutex_unlock(&lock_);
   return LOG_STATUS_OK;
 }
 
+void Log::flush() {
+  pthread_mutex_lock(&lock_);
+  if (async_) {
+    drain_buffers(true);
+  } else {
+    ofs_.flush();
+  }
+  pthread_mutex_unlock(&lock_);
+}
+
 int Log::set_console_level(LOG_LEVEL console_level) {
   if (LOG_LEVEL_PANIC <= console_level && console_level < LOG_LEVEL_LAST) {
     console_level_ = console_level;
@@ -279,6 +508,10 @@ int Log::rotate_by_size() {
 }
 
 int Log::rotate(const int year, const int month, const int day) {
+  // 异步模式下由后台线程在写文件之前判断
+  if (async_) {
+    return 0;
+  }
   int result = 0;
   pthread_mutex_lock(&lock_);
   if (rotate_type_ == LOG_ROTATE_BYDAY) {
@@ -18,14 +18,19 @@ See the Mulan PSL v2 for more details. */
 #include <assert.h>
 #include <errno.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <string.h>
 #include <time.h>
 
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <set>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include "common/defs.h"
 
@@ -34,6 +39,9 @@ namespace common {
 const int LOG_STATUS_OK = 0;
 const int LOG_STATUS_ERR = 1;
 const int LOG_MAX_LINE = 100000;
+const int LOG_ASYNC_BUFFER_SIZE = 64 * 1024;       // 异步模式下每个线程的环形缓冲区大小
+const int LOG_ASYNC_WRITE_INTERVAL_MS = 50;        // 后台线程没有被唤醒时多久检查一次缓冲区
+const int LOG_ASYNC_FLUSH_INTERVAL_MS = 1000;      // 后台线程多久flush一次文件
 
 typedef enum {
   LOG_LEVEL_PANIC = 0,
@@ -51,6 +59,8 @@ typedef enum {
   LOG_ROTATE_LAST
 } LOG_ROTATE;
 
+class AsyncLogBuffer;
+
 class Log {
  public:
   Log(const std::string &log_name, const LOG_LEVEL log_level = LOG_LEVEL_INFO,
@@ -98,6 +108,18 @@ class Log {
   int set_rotate_type(LOG_ROTATE rotate_type);
   LOG_ROTATE get_rotate_type();
 
+  /**
+   * 异步模式下日志先写到每个线程自己的环形缓冲区，不加锁，由后台线程批量写到文件。
+   * 文件只在定时或者遇到ERROR及以上级别的日志时flush，不同线程的日志在文件中不一定按时间排列。
+   * 关闭异步模式时等后台线程把缓冲区中的日志都写完，之后的日志直接写文件
+   */
+  int set_async(bool async);
+  bool is_async() const { return async_; }
+  /**
+   * 把已经写到缓冲区中的日志都写到文件中并flush
+   */
+  void flush();
+
   const char *prefix_msg(const LOG_LEVEL level);
 
   /**
@@ -120,8 +142,20 @@ class Log {
   template<class T>
   int out(const LOG_LEVEL console_level, const LOG_LEVEL log_level, T &message);
 
+  /**
+   * 把一行日志写到文件，异步模式下写到当前线程的缓冲区
+   */
+  int write_line(const LOG_LEVEL level, const char *prefix, const char *msg, size_t msg_len, bool newline);
+  void write_direct(const char *prefix, const char *msg, size_t msg_len, bool newline);
+  AsyncLogBuffer *thread_buffer();
+  /**
+   * 把所有线程缓冲区中的日志写到文件，需要持有lock_
+   */
+  void drain_buffers(bool force_flush);
+  static void *async_writer(void *param);
+
  private:
-  pthread_mutex_t lock_;
+  pthread_mutex_t lock_;  // 保护文件。异步模式下也保证同时只有一个线程读取缓冲区
   std::ofstream ofs_;
   std::string log_name_;
   LOG_LEVEL log_level_;
@@ -142,6 +176,16 @@ class Log {
 
   typedef std::set<std::string> DefaultSet;
   DefaultSet default_set_;
+
+  uint64_t id_;  // 线程按照id找自己在这个Log中的缓冲区
+  std::atomic<bool> async_;
+  std::atomic<bool> stop_writer_;
+  std::atomic<bool> urgent_;  // 有ERROR及以上级别的日志或者有线程的缓冲区满了，需要马上写出
+  pthread_t writer_;
+  pthread_mutex_t buffers_lock_;  // 保护buffers_和cond_
+  pthread_cond_t cond_;
+  std::vector<std::shared_ptr<AsyncLogBuffer>> buffers_;
+  time_t last_flush_time_;
 };
 
 class LoggerFactory {
@@ -189,14 +233,46 @@ extern Log *g_log;
     }                                                                           \
   } while (0)
 
+/**
+ * 编译期去掉的日志。放在if (0)中，参数不会求值，只用来避免只在日志中使用的变量产生未使用的警告
+ */
+inline void log_discard(const char *fmt, ...) {}
+
+#define LOG_DISCARD(fmt, ...)                                                   \
+  do {                                                                          \
+    if (0) {                                                                    \
+      common::log_discard(fmt, ##__VA_ARGS__);                                  \
+    }                                                                           \
+  } while (0)
+
+/**
+ * 编译时用-DMINIOB_MIN_LOG_LEVEL=N去掉级别大于N的LOG_INFO、LOG_DEBUG和LOG_TRACE，
+ * PANIC、ERROR和WARN总是保留。没有定义时保留所有级别
+ */
+#ifndef MINIOB_MIN_LOG_LEVEL
+#define MINIOB_MIN_LOG_LEVEL 5
+#endif
+
 #define LOG_DEFAULT(fmt, ...)                                                   \
   LOG_OUTPUT(common::g_log->get_log_level(), fmt, ##__VA_ARGS__)
 #define LOG_PANIC(fmt, ...) LOG_OUTPUT(common::LOG_LEVEL_PANIC, fmt, ##__VA_ARGS__)
 #define LOG_ERROR(fmt, ...) LOG_OUTPUT(common::LOG_LEVEL_ERR, fmt, ##__VA_ARGS__)
 #define LOG_WARN(fmt, ...) LOG_OUTPUT(common::LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#if MINIOB_MIN_LOG_LEVEL >= 3
 #define LOG_INFO(fmt, ...) LOG_OUTPUT(common::LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+#if MINIOB_MIN_LOG_LEVEL >= 4
 #define LOG_DEBUG(fmt, ...) LOG_OUTPUT(common::LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+#if MINIOB_MIN_LOG_LEVEL >= 5
 #define LOG_TRACE(fmt, ...) LOG_OUTPUT(common::LOG_LEVEL_TRACE, fmt, ##__VA_ARGS__)
+#else
+#define LOG_TRACE(fmt, ...) LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
 
 template<class T>
 Log &Log::operator<<(T msg) {
@@ -237,7 +313,6 @@ int Log::trace(T message) {
 
 template<class T>
 int Log::out(const LOG_LEVEL console_level, const LOG_LEVEL log_level, T &msg) {
-  bool locked = false;
   if (console_level < LOG_LEVEL_PANIC || console_level > console_level_ ||
     log_level < LOG_LEVEL_PANIC || log_level > log_level_) {
     return LOG_STATUS_OK;
@@ -250,19 +325,12 @@ int Log::out(const LOG_LEVEL console_level, const LOG_LEVEL log_level, T &msg) {
     }
 
     if (LOG_LEVEL_PANIC <= log_level && log_level <= log_level_) {
-      pthread_mutex_lock(&lock_);
-      locked = true;
-      ofs_ << prefix;
-      ofs_ << msg;
-      ofs_.flush();
-      log_line_++;
-      pthread_mutex_unlock(&lock_);
-      locked = false;
+      std::ostringstream oss;
+      oss << msg;
+      const std::string &str = oss.str();
+      return write_line(log_level, prefix, str.data(), str.size(), false);
     }
   } catch (std::exception &e) {
-    if (locked) {
-      pthread_mutex_unlock(&lock_);
-    }
     std::cerr << e.what() << std::endl;
     return LOG_STATUS_ERR;
   }
@@ -0,0 +1,115 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// CRC32C (Castagnoli) checksum.
+//
+
+#include "common/math/crc32c.h"
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace common {
+
+#define CRC32C_POLY 0x82F63B78  // reversed Castagnoli polynomial
+
+namespace {
+
+struct Crc32cTable {
+  uint32_t table[256];
+
+  Crc32cTable()
+  {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int j = 0; j < 8; j++) {
+        crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+      }
+      table[i] = crc;
+    }
+  }
+};
+
+const Crc32cTable crc32c_table;
+
+uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t len)
+{
+  while (len-- > 0) {
+    crc = crc32c_table.table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) uint32_t crc32c_hw(uint32_t crc, const unsigned char *p, size_t len)
+{
+  uint64_t crc64 = crc;
+  for (; len >= sizeof(uint64_t); p += sizeof(uint64_t), len -= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  uint32_t crc32 = (uint32_t)crc64;
+  for (; len > 0; p++, len--) {
+    crc32 = _mm_crc32_u8(crc32, *p);
+  }
+  return crc32;
+}
+
+const bool hw_supported = []() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2") != 0;
+}();
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+uint32_t crc32c_hw(uint32_t crc, const unsigned char *p, size_t len)
+{
+  for (; len >= sizeof(uint64_t); p += sizeof(uint64_t), len -= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    crc = __crc32cd(crc, word);
+  }
+  for (; len > 0; p++, len--) {
+    crc = __crc32cb(crc, *p);
+  }
+  return crc;
+}
+
+const bool hw_supported = true;
+#else
+uint32_t crc32c_hw(uint32_t crc, const unsigned char *p, size_t len)
+{
+  return crc32c_sw(crc, p, len);
+}
+
+const bool hw_supported = false;
+#endif
+
+}  // namespace
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t len)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  crc = ~crc;
+  crc = hw_supported ? crc32c_hw(crc, p, len) : crc32c_sw(crc, p, len);
+  return ~crc;
+}
+
+bool crc32c_hardware()
+{
+  return hw_supported;
+}
+
+}  // namespace common
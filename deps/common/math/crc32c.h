@@ -0,0 +1,36 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// CRC32C (Castagnoli) checksum.
+//
+#ifndef __COMMON_MATH_CRC32C_H__
+#define __COMMON_MATH_CRC32C_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace common {
+
+/**
+ * Extend crc with len bytes of data. Start with crc 0:
+ *   crc32c(0, "123456789", 9) == 0xE3069283
+ * Uses the SSE4.2 crc32 instruction on x86-64 when the cpu supports it,
+ * the ARMv8 crc32c instructions when built with them, and a table otherwise.
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+
+/**
+ * Whether crc32c runs on the hardware instructions.
+ */
+bool crc32c_hardware();
+
+}  // namespace common
+#endif  // __COMMON_MATH_CRC32C_H__
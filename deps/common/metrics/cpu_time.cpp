@@ -0,0 +1,73 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// CPU time spent by the threads handling some kind of events.
+//
+
+#include "common/metrics/cpu_time.h"
+
+#include <time.h>
+
+#include <sstream>
+
+#include "common/metrics/latency_histogram.h"
+#include "common/metrics/snapshot.h"
+
+namespace common {
+
+static thread_local CpuTimeCounter *current_event_counter = nullptr;
+
+CpuTimeCounter::CpuTimeCounter() : last_tick_us_(LatencyHistogram::now_us()) {}
+
+CpuTimeCounter::~CpuTimeCounter() {
+  if (snapshot_value_ != nullptr) {
+    delete snapshot_value_;
+    snapshot_value_ = nullptr;
+  }
+}
+
+void CpuTimeCounter::snapshot() {
+  const uint64_t now_tick = LatencyHistogram::now_us();
+  const uint64_t events = this->events();
+  const uint64_t cpu_ns = this->cpu_ns();
+  const uint64_t interval_events = events - last_events_;
+  const uint64_t interval_cpu_us = (cpu_ns - last_cpu_ns_) / 1000;
+  const uint64_t interval_us = now_tick - last_tick_us_;
+  last_events_ = events;
+  last_cpu_ns_ = cpu_ns;
+  last_tick_us_ = now_tick;
+
+  std::stringstream oss;
+  oss << "events:" << interval_events << ",cpu_us:" << interval_cpu_us
+      << ",avg_cpu_us:" << (interval_events > 0 ? interval_cpu_us / interval_events : 0)
+      << ",cores:" << (interval_us > 0 ? (double)interval_cpu_us / interval_us : 0);
+  std::string value = oss.str();
+  if (snapshot_value_ == nullptr) {
+    snapshot_value_ = new SnapshotBasic<std::string>();
+  }
+  ((SnapshotBasic<std::string> *)snapshot_value_)->setValue(value);
+}
+
+uint64_t CpuTimeCounter::thread_cpu_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void CpuTimeCounter::charge_current_event(CpuTimeCounter *counter) { current_event_counter = counter; }
+
+CpuTimeCounter *CpuTimeCounter::take_current_event() {
+  CpuTimeCounter *counter = current_event_counter;
+  current_event_counter = nullptr;
+  return counter;
+}
+
+}  // namespace common
@@ -0,0 +1,71 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// CPU time spent by the threads handling some kind of events.
+//
+
+#ifndef __COMMON_METRICS_CPU_TIME_H__
+#define __COMMON_METRICS_CPU_TIME_H__
+
+#include <stdint.h>
+
+#include "common/metrics/metric.h"
+#include "common/metrics/striped_counter.h"
+
+namespace common {
+
+/**
+ * CPU time of events measured by the thread CPU clock, so time the thread
+ * waits for locks, IO or the scheduler is not counted, unlike the handle latency.
+ * A snapshot reports the interval since the previous one:
+ * events, cpu_us, avg_cpu_us and cores, the number of CPUs kept busy.
+ */
+class CpuTimeCounter : public Metric {
+public:
+  CpuTimeCounter();
+  virtual ~CpuTimeCounter();
+
+  void add(uint64_t cpu_ns) {
+    events_.add(1);
+    cpu_ns_.add(cpu_ns);
+  }
+
+  /**
+   * Totals since start
+   */
+  uint64_t events() const { return events_.sum(); }
+  uint64_t cpu_ns() const { return cpu_ns_.sum(); }
+
+  void snapshot();
+
+  /**
+   * CPU time of the calling thread in ns, CLOCK_THREAD_CPUTIME_ID
+   */
+  static uint64_t thread_cpu_ns();
+
+  /**
+   * Also charge the CPU time of the event the calling thread is handling to counter,
+   * e.g. the counter of the statement type, which the thread pool does not know.
+   * The thread pool takes it when the event is handled.
+   */
+  static void charge_current_event(CpuTimeCounter *counter);
+  static CpuTimeCounter *take_current_event();
+
+private:
+  StripedCounter events_;
+  StripedCounter cpu_ns_;
+  uint64_t last_events_ = 0;
+  uint64_t last_cpu_ns_ = 0;
+  uint64_t last_tick_us_;
+};
+
+}  // namespace common
+#endif  //__COMMON_METRICS_CPU_TIME_H__
@@ -0,0 +1,144 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Lock-free log-bucketed latency histogram.
+//
+
+#include "common/metrics/latency_histogram.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "common/metrics/latency_snapshot.h"
+#include "common/metrics/striped_counter.h"
+
+namespace common {
+
+#define LATENCY_SUB_BUCKET_HALF (1 << (LATENCY_SUB_BUCKET_BITS - 1))
+#define LATENCY_MAX_VALUE ((1ul << LATENCY_MAX_VALUE_BITS) - 1)
+
+uint64_t LatencyHistogram::now_us() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int current_stripe() {
+  return StripedCounter::current_stripe() % LATENCY_STRIPE_NUM;
+}
+
+LatencyHistogram::LatencyHistogram() {
+  stripes_ = new Stripe[LATENCY_STRIPE_NUM]();
+  for (int i = 0; i < LATENCY_STRIPE_NUM; i++) {
+    stripes_[i].min.store(UINT64_MAX);
+  }
+  snapshot_tick_ = now_us();
+}
+
+LatencyHistogram::~LatencyHistogram() {
+  delete[] stripes_;
+  stripes_ = nullptr;
+  if (snapshot_value_ != nullptr) {
+    delete snapshot_value_;
+    snapshot_value_ = nullptr;
+  }
+}
+
+int LatencyHistogram::bucket_index(uint64_t value) {
+  if (value > LATENCY_MAX_VALUE) {
+    value = LATENCY_MAX_VALUE;
+  }
+  if (value < (1ul << LATENCY_SUB_BUCKET_BITS)) {
+    return (int)value;
+  }
+  // keep LATENCY_SUB_BUCKET_BITS significant bits, value >> shift is in [half, 2 * half)
+  const int shift = 63 - __builtin_clzl(value) - (LATENCY_SUB_BUCKET_BITS - 1);
+  return shift * LATENCY_SUB_BUCKET_HALF + (int)(value >> shift);
+}
+
+uint64_t LatencyHistogram::bucket_low(int index) {
+  if (index < (1 << LATENCY_SUB_BUCKET_BITS)) {
+    return index;
+  }
+  const int shift = index / LATENCY_SUB_BUCKET_HALF - 1;
+  return (uint64_t)(index - shift * LATENCY_SUB_BUCKET_HALF) << shift;
+}
+
+uint64_t LatencyHistogram::bucket_width(int index) {
+  if (index < (1 << LATENCY_SUB_BUCKET_BITS)) {
+    return 1;
+  }
+  return 1ul << (index / LATENCY_SUB_BUCKET_HALF - 1);
+}
+
+void LatencyHistogram::update(uint64_t us) {
+  Stripe &stripe = stripes_[current_stripe()];
+  stripe.counts[bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+  stripe.sum.fetch_add(us, std::memory_order_relaxed);
+
+  uint64_t min = stripe.min.load(std::memory_order_relaxed);
+  while (us < min && !stripe.min.compare_exchange_weak(min, us, std::memory_order_relaxed)) {
+  }
+  uint64_t max = stripe.max.load(std::memory_order_relaxed);
+  while (us > max && !stripe.max.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::snapshot() {
+  // every value is taken by exactly one snapshot, even if it is updated concurrently
+  std::vector<uint64_t> counts(LATENCY_BUCKET_NUM, 0);
+  uint64_t sum = 0;
+  uint64_t min = UINT64_MAX;
+  uint64_t max = 0;
+  for (int i = 0; i < LATENCY_STRIPE_NUM; i++) {
+    Stripe &stripe = stripes_[i];
+    for (int j = 0; j < LATENCY_BUCKET_NUM; j++) {
+      if (stripe.counts[j].load(std::memory_order_relaxed) != 0) {
+        counts[j] += stripe.counts[j].exchange(0, std::memory_order_relaxed);
+      }
+    }
+    sum += stripe.sum.exchange(0, std::memory_order_relaxed);
+    min = std::min(min, stripe.min.exchange(UINT64_MAX, std::memory_order_relaxed));
+    max = std::max(max, stripe.max.exchange(0, std::memory_order_relaxed));
+  }
+
+  uint64_t count = 0;
+  for (uint64_t bucket_count : counts) {
+    count += bucket_count;
+  }
+  const uint64_t now_tick = now_us();
+  const double seconds = (now_tick - snapshot_tick_) / 1000000.0;
+  snapshot_tick_ = now_tick;
+
+  if (snapshot_value_ == nullptr) {
+    snapshot_value_ = new LatencySnapshot();
+  }
+  ((LatencySnapshot *)snapshot_value_)
+      ->set_value(counts, sum, count == 0 ? 0 : min, max, seconds > 0 ? count / seconds : 0);
+}
+
+LatencyStat::LatencyStat(LatencyHistogram &histogram)
+    : histogram_(histogram), start_us_(LatencyHistogram::now_us()) {}
+
+LatencyStat::~LatencyStat() {
+  end();
+}
+
+void LatencyStat::end() {
+  if (!ended_) {
+    ended_ = true;
+    histogram_.update(LatencyHistogram::now_us() - start_us_);
+  }
+}
+
+} // namespace common
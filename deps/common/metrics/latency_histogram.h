@@ -0,0 +1,88 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Lock-free log-bucketed latency histogram.
+//
+
+#ifndef __COMMON_METRICS_LATENCY_HISTOGRAM_H__
+#define __COMMON_METRICS_LATENCY_HISTOGRAM_H__
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "common/metrics/metric.h"
+
+namespace common {
+
+// values below 2^LATENCY_SUB_BUCKET_BITS are counted exactly, bigger values
+// keep LATENCY_SUB_BUCKET_BITS significant bits, the relative error is below 1/64
+#define LATENCY_SUB_BUCKET_BITS 7
+#define LATENCY_MAX_VALUE_BITS 36  // about 19 hours in us, bigger values are counted as the max
+#define LATENCY_BUCKET_NUM ((LATENCY_MAX_VALUE_BITS - LATENCY_SUB_BUCKET_BITS + 2) << (LATENCY_SUB_BUCKET_BITS - 1))
+#define LATENCY_STRIPE_NUM 8  // threads update different stripes, so they seldom share a cache line
+
+/**
+ * HdrHistogram-like histogram for latencies in us.
+ * Unlike Histogram/Timer, update takes no lock and samples nothing: every value
+ * is counted by a relaxed atomic add on the stripe of the calling thread.
+ * snapshot merges the stripes and starts a new report interval.
+ */
+class LatencyHistogram : public Metric {
+public:
+  LatencyHistogram();
+  virtual ~LatencyHistogram();
+
+  void update(uint64_t us);
+  void snapshot();
+
+  /**
+   * Monotonic clock in us, used to measure the latencies
+   */
+  static uint64_t now_us();
+
+  static int bucket_index(uint64_t value);
+  /**
+   * The smallest value and the width of the bucket
+   */
+  static uint64_t bucket_low(int index);
+  static uint64_t bucket_width(int index);
+
+protected:
+  struct Stripe {
+    std::atomic<uint64_t> counts[LATENCY_BUCKET_NUM];
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> min;
+    std::atomic<uint64_t> max;
+    char padding[64];  // keep max away from the counts of the next stripe
+  };
+
+  Stripe *stripes_;
+  long snapshot_tick_;
+};
+
+// update us, when end is called or on destruction
+class LatencyStat {
+public:
+  LatencyStat(LatencyHistogram &histogram);
+  ~LatencyStat();
+
+  void end();
+
+private:
+  LatencyHistogram &histogram_;
+  uint64_t start_us_;
+  bool ended_ = false;
+};
+
+} // namespace common
+
+#endif //__COMMON_METRICS_LATENCY_HISTOGRAM_H__
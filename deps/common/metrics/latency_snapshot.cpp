@@ -0,0 +1,76 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Snapshot of LatencyHistogram.
+//
+
+#include "common/metrics/latency_snapshot.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include "common/metrics/latency_histogram.h"
+
+namespace common {
+
+LatencySnapshot::LatencySnapshot() {}
+
+LatencySnapshot::~LatencySnapshot() {}
+
+void LatencySnapshot::set_value(
+    const std::vector<uint64_t> &counts, uint64_t sum, uint64_t min, uint64_t max, double tps) {
+  counts_ = counts;
+  count_ = 0;
+  for (uint64_t count : counts_) {
+    count_ += count;
+  }
+  sum_ = sum;
+  min_ = min;
+  max_ = max;
+  tps_ = tps;
+}
+
+double LatencySnapshot::get_value(double quantile) {
+  if (count_ == 0) {
+    return 0.0;
+  }
+  quantile = std::min(1.0, std::max(0.0, quantile));
+
+  // the rank-th smallest value, counted from 1
+  const uint64_t rank = std::max<uint64_t>(1, (uint64_t)ceil(quantile * count_));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); i++) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      const double middle = LatencyHistogram::bucket_low(i) + (LatencyHistogram::bucket_width(i) - 1) / 2.0;
+      return std::min((double)max_, std::max((double)min_, middle));
+    }
+  }
+  return (double)max_;
+}
+
+double LatencySnapshot::get_mean() {
+  if (count_ == 0) {
+    return 0.0;
+  }
+  return (double)sum_ / count_;
+}
+
+std::string LatencySnapshot::to_string() {
+  std::stringstream oss;
+  oss << "count:" << count_ << ",tps:" << tps_ << ",mean:" << get_mean() << ",min:" << get_min()
+      << ",max:" << get_max() << ",median:" << get_median() << ",99th:" << get_99th() << ",999th:" << get_999th();
+  return oss.str();
+}
+
+} // namespace common
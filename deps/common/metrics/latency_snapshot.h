@@ -0,0 +1,73 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Snapshot of LatencyHistogram.
+//
+
+#ifndef __COMMON_METRICS_LATENCY_SNAPSHOT_H__
+#define __COMMON_METRICS_LATENCY_SNAPSHOT_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "common/metrics/snapshot.h"
+
+namespace common {
+
+/**
+ * Bucket counts of a LatencyHistogram in one report interval.
+ * Quantiles are exact up to the bucket width, no sampling involved.
+ */
+class LatencySnapshot : public Snapshot {
+public:
+  LatencySnapshot();
+  virtual ~LatencySnapshot();
+
+public:
+  /**
+   * counts[i] is the number of values falling into bucket i,
+   * see LatencyHistogram::bucket_index
+   */
+  void set_value(const std::vector<uint64_t> &counts, uint64_t sum, uint64_t min, uint64_t max, double tps);
+
+  /**
+   * Returns the value at the given quantile, in [0..1].
+   * The result is the middle of the bucket, clamped to [min, max]
+   */
+  double get_value(double quantile);
+
+  const std::vector<uint64_t> &get_counts() { return counts_; }
+  uint64_t get_count() { return count_; }
+  uint64_t get_sum() { return sum_; }
+  double get_tps() { return tps_; }
+  double get_mean();
+  double get_min() { return (double)min_; }
+  double get_max() { return (double)max_; }
+  double get_median() { return get_value(0.5); }
+  double get_99th() { return get_value(0.99); }
+  double get_999th() { return get_value(0.999); }
+
+  std::string to_string();
+
+protected:
+  std::vector<uint64_t> counts_;
+  uint64_t count_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t min_ = 0;
+  uint64_t max_ = 0;
+  double tps_ = 0;
+};
+
+} // namespace common
+
+#endif //__COMMON_METRICS_LATENCY_SNAPSHOT_H__
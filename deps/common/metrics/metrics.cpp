@@ -16,12 +16,26 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/mutex.h"
 
 namespace common {
+Counter::~Counter() {
+  if (snapshot_value_ != NULL) {
+    delete snapshot_value_;
+    snapshot_value_ = NULL;
+  }
+}
+
+void Counter::snapshot() {
+  if (snapshot_value_ == NULL) {
+    snapshot_value_ = new SnapshotBasic<long>();
+  }
+  long value = value_.sum();
+  ((SnapshotBasic<long> *)snapshot_value_)->setValue(value);
+}
+
 Meter::Meter() {
   struct timeval start_time;
   gettimeofday(&start_time, NULL);
 
   snapshot_tick_ = start_time.tv_sec * 1000000 + start_time.tv_usec;
-  value_.store(0l);
 }
 
 Meter::~Meter() {
@@ -31,7 +45,7 @@ Meter::~Meter() {
   }
 }
 
-void Meter::inc(long increase) { value_.fetch_add(increase); }
+void Meter::inc(long increase) { value_.add(increase); }
 void Meter::inc() { inc(1l); }
 
 void Meter::snapshot() {
@@ -43,7 +57,7 @@ void Meter::snapshot() {
   long now_tick = now.tv_sec * 1000000 + now.tv_usec;
 
   double temp_value =
-      ((double)value_.exchange(0l)) / ((now_tick - snapshot_tick_ ) / 1000000);
+      ((double)value_.take()) / ((now_tick - snapshot_tick_ ) / 1000000);
   snapshot_tick_ = now_tick;
 
   if (snapshot_value_ == NULL) {
@@ -60,8 +74,8 @@ SimpleTimer::~SimpleTimer() {
 }
 
 void SimpleTimer::inc(long increase) {
-  value_.fetch_add(increase);
-  times_.fetch_add(1);
+  value_.add(increase);
+  times_.add(1);
 }
 
 void SimpleTimer::update(long one) { inc(one); }
@@ -74,8 +88,8 @@ void SimpleTimer::snapshot() {
 
   long now_tick = now.tv_sec * 1000000 + now.tv_usec;
 
-  long value_snapshot = value_.exchange(0l);
-  long times_snapshot = times_.exchange(0l);
+  long value_snapshot = value_.take();
+  long times_snapshot = times_.take();
 
   double tps = 0;
   double mean = 0;
@@ -112,7 +126,6 @@ Timer::Timer(RandomGenerator &random)
   gettimeofday(&start_time, NULL);
 
   snapshot_tick_ = start_time.tv_sec * 1000000 + start_time.tv_usec;
-  value_.store(0l);
 }
 
 Timer::Timer(RandomGenerator &random, size_t size)
@@ -121,7 +134,6 @@ Timer::Timer(RandomGenerator &random, size_t size)
   gettimeofday(&start_time, NULL);
 
   snapshot_tick_ = start_time.tv_sec * 1000000 + start_time.tv_usec;
-  value_.store(0l);
 }
 
 Timer::~Timer() {
@@ -133,7 +145,7 @@ Timer::~Timer() {
 
 void Timer::update(double ms) {
   UniformReservoir::update(ms);
-  value_.fetch_add(1l);
+  value_.add(1l);
 }
 
 void Timer::snapshot() {
@@ -148,7 +160,7 @@ void Timer::snapshot() {
   long now_tick = now.tv_sec * 1000000 + now.tv_usec;
 
   double tps =
-      ((double)value_.exchange(0l) )/ ((now_tick - snapshot_tick_  ) / 1000000);
+      ((double)value_.take() )/ ((now_tick - snapshot_tick_  ) / 1000000);
   snapshot_tick_ = now_tick;
 
   MUTEX_LOCK(&mutex);
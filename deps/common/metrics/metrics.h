@@ -16,8 +16,10 @@ See the Mulan PSL v2 for more details. */
 #define __COMMON_METRICS_METRICS_H__
 
 #include "common/lang/string.h"
+#include "common/metrics/latency_histogram.h"
 #include "common/metrics/metric.h"
 #include "common/metrics/snapshot.h"
+#include "common/metrics/striped_counter.h"
 #include "common/metrics/timer_snapshot.h"
 #include "common/metrics/uniform_reservoir.h"
 #include <sys/time.h>
@@ -30,8 +32,19 @@ public:
   void set_snapshot(Snapshot *value) { snapshot_value_ = value; }
 };
 
+// total since start
 class Counter : public Metric {
-  void set_snapshot(SnapshotBasic<long> *value) { snapshot_value_ = value; }
+public:
+  virtual ~Counter();
+
+  void inc(long increase) { value_.add(increase); }
+  void inc() { inc(1l); }
+  long value() const { return value_.sum(); }
+
+  void snapshot();
+
+protected:
+  StripedCounter value_;
 };
 
 class Meter : public Metric {
@@ -45,7 +58,7 @@ public:
   void snapshot();
 
 protected:
-  std::atomic<long> value_;
+  StripedCounter value_;
   long snapshot_tick_;
 };
 
@@ -62,13 +75,14 @@ public:
   void snapshot();
 
 protected:
-  std::atomic<long> times_;
+  StripedCounter times_;
 };
 
 // Histogram metric is complicated, in normal case ,
 //  please skip us histogram or Timer as more as possible
 //  try use SimpleTimer to replace them.
 //  if use histogram , please use sampling method.
+//  for latencies on hot paths, use LatencyHistogram, which takes no lock.
 class Histogram : public UniformReservoir {
 public:
   Histogram(RandomGenerator &random);
@@ -91,7 +105,7 @@ public:
   void update(double ms);
 
 protected:
-  std::atomic<long> value_;
+  StripedCounter value_;
   long snapshot_tick_;
 };
 // update ms
@@ -15,6 +15,7 @@ See the Mulan PSL v2 for more details. */
 
 
 #include "common/metrics/metrics_registry.h"
+#include "common/lang/mutex.h"
 #include "common/log/log.h"
 
 namespace common {
@@ -25,20 +26,34 @@ MetricsRegistry& get_metrics_registry() {
   return instance;
 }
 
-void MetricsRegistry::register_metric(const std::string &tag, Metric *metric) {
+MetricsRegistry::MetricsRegistry() {
+  MUTEX_INIT(&mutex, NULL);
+}
+
+MetricsRegistry::~MetricsRegistry() {
+  MUTEX_DESTROY(&mutex);
+}
+
+bool MetricsRegistry::register_metric(const std::string &tag, Metric *metric) {
+  MUTEX_LOCK(&mutex);
   std::map<std::string, Metric*>::iterator it = metrics.find(tag);
   if (it != metrics.end()) {
+    MUTEX_UNLOCK(&mutex);
     LOG_WARN("%s has been registered!", tag.c_str());
-    return;
+    return false;
   }
 
   //metrics[tag] = metric;
   metrics.insert(std::pair<std::string, Metric *>(tag, metric));
+  MUTEX_UNLOCK(&mutex);
   LOG_INFO("Successfully register metric :%s", tag.c_str());
+  return true;
 }
 
 void MetricsRegistry::unregister(const std::string &tag) {
+  MUTEX_LOCK(&mutex);
   unsigned int num = metrics.erase(tag);
+  MUTEX_UNLOCK(&mutex);
   if (num == 0) {
     LOG_WARN("There is no %s metric!", tag.c_str());
     return;
@@ -47,13 +62,16 @@ void MetricsRegistry::unregister(const std::string &tag) {
 }
 
 void MetricsRegistry::snapshot() {
+  MUTEX_LOCK(&mutex);
   std::map<std::string, Metric*>::iterator it = metrics.begin();
   for (; it != metrics.end(); it++) {
     it->second->snapshot();
   }
+  MUTEX_UNLOCK(&mutex);
 }
 
 void MetricsRegistry::report() {
+  MUTEX_LOCK(&mutex);
   for (std::list<Reporter *>::iterator reporterIt = reporters.begin();
        reporterIt != reporters.end(); reporterIt++) {
     for (std::map<std::string, Metric*>::iterator it = metrics.begin();
@@ -62,6 +80,7 @@ void MetricsRegistry::report() {
       (*reporterIt)->report(it->first, it->second);
     }
   }
+  MUTEX_UNLOCK(&mutex);
 }
 
 } // namespace common
@@ -18,6 +18,7 @@ See the Mulan PSL v2 for more details. */
 #include <string>
 #include <map>
 #include <list>
+#include <pthread.h>
 
 #include "common/metrics/metric.h"
 #include "common/metrics/reporter.h"
@@ -26,10 +27,13 @@ namespace common {
 
 class MetricsRegistry {
 public:
-  MetricsRegistry() {};
-  virtual ~MetricsRegistry(){};
+  MetricsRegistry();
+  virtual ~MetricsRegistry();
 
-  void register_metric(const std::string &tag, Metric *metric);
+  /**
+   * 注册成功返回true，tag已经被注册过时返回false
+   */
+  bool register_metric(const std::string &tag, Metric *metric);
   void unregister(const std::string &tag);
 
   void snapshot();
@@ -42,6 +46,8 @@ public:
 
 
 protected:
+  // 注册和snapshot/report可能在不同的线程中执行
+  pthread_mutex_t mutex;
   std::map<std::string, Metric *> metrics;
   std::list<Reporter *> reporters;
 
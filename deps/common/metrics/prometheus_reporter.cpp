@@ -0,0 +1,283 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Serve the reported metrics over HTTP in Prometheus text format.
+//
+
+#include "common/metrics/prometheus_reporter.h"
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <sstream>
+
+#include "common/lang/mutex.h"
+#include "common/log/log.h"
+#include "common/metrics/latency_histogram.h"
+#include "common/metrics/latency_snapshot.h"
+#include "common/metrics/metric.h"
+
+namespace common {
+
+// upper bounds of the exported histogram buckets, in us
+static const uint64_t HISTOGRAM_BOUNDS[] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000};
+static const int HISTOGRAM_BOUND_NUM = sizeof(HISTOGRAM_BOUNDS) / sizeof(HISTOGRAM_BOUNDS[0]);
+
+#define PROMETHEUS_ACCEPT_TIMEOUT_MS 200
+#define PROMETHEUS_MAX_REQUEST_SIZE 4096
+
+static std::string metric_name(const std::string &tag, const std::string &suffix) {
+  std::string name = "miniob_" + tag;
+  if (!suffix.empty()) {
+    name += "_" + suffix;
+  }
+  for (size_t i = 0; i < name.size(); i++) {
+    const char c = name[i];
+    if (!isalnum((unsigned char)c) && c != '_' && c != ':') {
+      name[i] = '_';
+    }
+  }
+  return name;
+}
+
+static std::string trim(const std::string &str) {
+  size_t begin = str.find_first_not_of(" \t");
+  if (begin == std::string::npos) {
+    return std::string();
+  }
+  size_t end = str.find_last_not_of(" \t%");
+  return str.substr(begin, end - begin + 1);
+}
+
+/**
+ * Render "key:value,..." or a single number as gauges
+ */
+static std::string render_gauges(const std::string &tag, const std::string &text) {
+  std::stringstream oss;
+  std::stringstream items(text);
+  std::string item;
+  while (std::getline(items, item, ',')) {
+    std::string key;
+    std::string value = item;
+    size_t colon = item.find(':');
+    if (colon != std::string::npos) {
+      key = trim(item.substr(0, colon));
+      value = item.substr(colon + 1);
+    }
+    value = trim(value);
+    char *end = nullptr;
+    strtod(value.c_str(), &end);
+    if (value.empty() || *end != '\0') {
+      continue;
+    }
+    const std::string name = metric_name(tag, key);
+    oss << "# TYPE " << name << " gauge\n" << name << " " << value << "\n";
+  }
+  return oss.str();
+}
+
+PrometheusReporter *get_prometheus_reporter() {
+  static PrometheusReporter *instance = new PrometheusReporter();
+
+  return instance;
+}
+
+PrometheusReporter::PrometheusReporter() : running_(false) {
+  MUTEX_INIT(&mutex_, NULL);
+}
+
+PrometheusReporter::~PrometheusReporter() {
+  stop();
+  MUTEX_DESTROY(&mutex_);
+}
+
+int PrometheusReporter::start(int port) {
+  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    LOG_ERROR("Failed to create socket of prometheus reporter. error=%s", strerror(errno));
+    return -1;
+  }
+  int yes = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  socklen_t addr_len = sizeof(addr);
+  if (bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd_, 16) < 0 ||
+      getsockname(listen_fd_, (struct sockaddr *)&addr, &addr_len) < 0) {
+    LOG_ERROR("Failed to listen on port %d for prometheus reporter. error=%s", port, strerror(errno));
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return -1;
+  }
+  port_ = ntohs(addr.sin_port);
+
+  running_ = true;
+  if (pthread_create(&server_, nullptr, serve, this) != 0) {
+    LOG_ERROR("Failed to create thread of prometheus reporter");
+    running_ = false;
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return -1;
+  }
+  LOG_INFO("Serve metrics on port %d, path /metrics", port_);
+  return 0;
+}
+
+void PrometheusReporter::stop() {
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+  pthread_join(server_, nullptr);
+  close(listen_fd_);
+  listen_fd_ = -1;
+}
+
+void PrometheusReporter::report(const std::string &tag, Metric *metric) {
+  Snapshot *snapshot = metric->get_snapshot();
+  if (snapshot == nullptr) {
+    return;
+  }
+
+  LatencySnapshot *latency = dynamic_cast<LatencySnapshot *>(snapshot);
+  if (latency == nullptr) {
+    std::string gauges = render_gauges(tag, snapshot->to_string());
+    MUTEX_LOCK(&mutex_);
+    entries_[tag].gauges = std::move(gauges);
+    MUTEX_UNLOCK(&mutex_);
+    return;
+  }
+
+  // LatencyHistogram starts a new interval on every snapshot, so add the interval to the totals
+  std::vector<uint64_t> buckets(HISTOGRAM_BOUND_NUM, 0);
+  const std::vector<uint64_t> &counts = latency->get_counts();
+  for (size_t i = 0; i < counts.size(); i++) {
+    if (counts[i] == 0) {
+      continue;
+    }
+    const uint64_t high = LatencyHistogram::bucket_low(i) + LatencyHistogram::bucket_width(i) - 1;
+    for (int j = 0; j < HISTOGRAM_BOUND_NUM; j++) {
+      if (high <= HISTOGRAM_BOUNDS[j]) {
+        buckets[j] += counts[i];
+      }
+    }
+  }
+
+  MUTEX_LOCK(&mutex_);
+  Entry &entry = entries_[tag];
+  entry.histogram = true;
+  entry.buckets.resize(HISTOGRAM_BOUND_NUM, 0);
+  for (int j = 0; j < HISTOGRAM_BOUND_NUM; j++) {
+    entry.buckets[j] += buckets[j];
+  }
+  entry.count += latency->get_count();
+  entry.sum_us += latency->get_sum();
+  MUTEX_UNLOCK(&mutex_);
+}
+
+std::string PrometheusReporter::to_text() {
+  std::stringstream oss;
+  MUTEX_LOCK(&mutex_);
+  for (std::map<std::string, Entry>::iterator it = entries_.begin(); it != entries_.end(); it++) {
+    const Entry &entry = it->second;
+    if (!entry.histogram) {
+      oss << entry.gauges;
+      continue;
+    }
+    const std::string name = metric_name(it->first, "seconds");
+    oss << "# TYPE " << name << " histogram\n";
+    for (int j = 0; j < HISTOGRAM_BOUND_NUM; j++) {
+      oss << name << "_bucket{le=\"" << HISTOGRAM_BOUNDS[j] / 1000000.0 << "\"} " << entry.buckets[j] << "\n";
+    }
+    oss << name << "_bucket{le=\"+Inf\"} " << entry.count << "\n";
+    oss << name << "_sum " << entry.sum_us / 1000000.0 << "\n";
+    oss << name << "_count " << entry.count << "\n";
+  }
+  MUTEX_UNLOCK(&mutex_);
+  return oss.str();
+}
+
+void *PrometheusReporter::serve(void *arg) {
+  PrometheusReporter *reporter = (PrometheusReporter *)arg;
+  while (reporter->running_) {
+    // wake up now and then to see whether it is stopped
+    struct pollfd pfd;
+    pfd.fd = reporter->listen_fd_;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, PROMETHEUS_ACCEPT_TIMEOUT_MS) <= 0) {
+      continue;
+    }
+    int fd = accept(reporter->listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    reporter->handle_connection(fd);
+    close(fd);
+  }
+  return nullptr;
+}
+
+/**
+ * Serve one HTTP/1.0 style request and close the connection
+ */
+void PrometheusReporter::handle_connection(int fd) {
+  struct timeval timeout = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  std::string request;
+  char buf[1024];
+  while (request.find("\r\n\r\n") == std::string::npos && request.size() < PROMETHEUS_MAX_REQUEST_SIZE) {
+    ssize_t len = read(fd, buf, sizeof(buf));
+    if (len <= 0) {
+      break;
+    }
+    request.append(buf, len);
+  }
+
+  std::string status = "200 OK";
+  std::string body;
+  if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0) {
+    body = to_text();
+  } else {
+    status = "404 Not Found";
+    body = "try GET /metrics\n";
+  }
+  std::stringstream oss;
+  oss << "HTTP/1.0 " << status << "\r\n"
+      << "Content-Type: text/plain; version=0.0.4\r\n"
+      << "Content-Length: " << body.size() << "\r\n"
+      << "Connection: close\r\n\r\n"
+      << body;
+  const std::string response = oss.str();
+  size_t written = 0;
+  while (written < response.size()) {
+    ssize_t len = send(fd, response.data() + written, response.size() - written, MSG_NOSIGNAL);
+    if (len <= 0) {
+      break;
+    }
+    written += len;
+  }
+}
+
+} // namespace common
@@ -0,0 +1,82 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Serve the reported metrics over HTTP in Prometheus text format.
+//
+
+#ifndef __COMMON_METRICS_PROMETHEUS_REPORTER_H__
+#define __COMMON_METRICS_PROMETHEUS_REPORTER_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/metrics/reporter.h"
+
+namespace common {
+
+/**
+ * Keeps the latest report of every metric and serves them on GET /metrics.
+ * LatencyHistogram becomes a Prometheus histogram in seconds, whose buckets,
+ * sum and count accumulate over the reports. Other snapshots are parsed as
+ * "key:value,..." (or a single number) and every numeric value is a gauge.
+ * Metric names are "miniob_" + the tag, with characters Prometheus does not
+ * allow replaced by '_'.
+ */
+class PrometheusReporter : public Reporter {
+public:
+  PrometheusReporter();
+  virtual ~PrometheusReporter();
+
+  /**
+   * Listen on the port and serve in a background thread, 0 picks a free port
+   * @return 0 on success
+   */
+  int start(int port);
+  void stop();
+  int port() const { return port_; }
+
+  void report(const std::string &tag, Metric *metric);
+
+  /**
+   * The text returned on GET /metrics
+   */
+  std::string to_text();
+
+private:
+  struct Entry {
+    std::string gauges;             // rendered gauge lines
+    bool histogram = false;
+    std::vector<uint64_t> buckets;  // cumulative count of values <= each bound, since start
+    uint64_t count = 0;
+    uint64_t sum_us = 0;
+  };
+
+  static void *serve(void *arg);
+  void handle_connection(int fd);
+
+  pthread_mutex_t mutex_;  // protects entries_, reported and served by different threads
+  std::map<std::string, Entry> entries_;
+
+  int listen_fd_ = -1;
+  int port_ = 0;
+  pthread_t server_;
+  std::atomic<bool> running_;
+};
+
+PrometheusReporter *get_prometheus_reporter();
+} // namespace common
+
+#endif //__COMMON_METRICS_PROMETHEUS_REPORTER_H__
@@ -0,0 +1,24 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Counter striped over cache lines for metrics updated by many threads.
+//
+
+#include "common/metrics/striped_counter.h"
+
+namespace common {
+
+int StripedCounter::next_stripe() {
+  static std::atomic<int> next(0);
+  return next.fetch_add(1, std::memory_order_relaxed) % STRIPED_COUNTER_STRIPES;
+}
+
+}  // namespace common
@@ -0,0 +1,78 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Counter striped over cache lines for metrics updated by many threads.
+//
+
+#ifndef __COMMON_METRICS_STRIPED_COUNTER_H__
+#define __COMMON_METRICS_STRIPED_COUNTER_H__
+
+#include <atomic>
+
+namespace common {
+
+#define STRIPED_COUNTER_STRIPES 16  // threads are spread over the stripes round robin
+#define CACHE_LINE_SIZE 64
+
+/**
+ * A counter made of one atomic per cache line. Every thread adds to its own
+ * stripe with a relaxed atomic add, so threads on different cores seldom touch
+ * the same cache line; reading sums the stripes. Use it for numbers updated on
+ * hot paths and read only when the metrics are reported.
+ */
+class StripedCounter {
+public:
+  StripedCounter() = default;
+  StripedCounter(const StripedCounter &) = delete;
+  StripedCounter &operator=(const StripedCounter &) = delete;
+
+  void add(long value) { stripes_[current_stripe()].value.fetch_add(value, std::memory_order_relaxed); }
+
+  long sum() const {
+    long total = 0;
+    for (const Stripe &stripe : stripes_) {
+      total += stripe.value.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  /**
+   * The sum, leaving 0 in every stripe. Adds running at the same time are
+   * counted either now or by the next call, none is lost.
+   */
+  long take() {
+    long total = 0;
+    for (Stripe &stripe : stripes_) {
+      total += stripe.value.exchange(0, std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  /**
+   * Stripe of the calling thread, fixed for the life of the thread
+   */
+  static int current_stripe() {
+    thread_local int stripe = next_stripe();
+    return stripe;
+  }
+
+private:
+  static int next_stripe();
+
+  struct alignas(CACHE_LINE_SIZE) Stripe {
+    std::atomic<long> value{0};
+  };
+
+  Stripe stripes_[STRIPED_COUNTER_STRIPES];
+};
+
+}  // namespace common
+#endif  //__COMMON_METRICS_STRIPED_COUNTER_H__
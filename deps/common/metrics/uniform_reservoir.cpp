@@ -46,7 +46,7 @@ UniformReservoir::UniformReservoir(RandomGenerator &random, size_t size)
 }
 
 UniformReservoir::~UniformReservoir() {
-  if (snapshot_value_ == NULL) {
+  if (snapshot_value_ != NULL) {
     delete snapshot_value_;
     snapshot_value_ = NULL;
   }
@@ -77,11 +77,14 @@ void UniformReservoir::update(double value) {
   MUTEX_LOCK(&mutex);
   size_t count = ++counter;
 
-  if (count < data.size()) {
-    data[count] = (value);
+  // Algorithm R: the count-th value replaces a random slot with probability size / count
+  if (count <= data.size()) {
+    data[count - 1] = (value);
   } else {
-    size_t rcount = next(data.size());
-    data[rcount] = (value);
+    size_t rcount = next(count);
+    if (rcount < data.size()) {
+      data[rcount] = (value);
+    }
   }
 
   MUTEX_UNLOCK(&mutex);
@@ -89,7 +92,8 @@ void UniformReservoir::update(double value) {
 
 void UniformReservoir::snapshot() {
   MUTEX_LOCK(&mutex);
-  std::vector<double> output = data;
+  size_t size = (counter < data.size()) ? counter : data.size();
+  std::vector<double> output(data.begin(), data.begin() + size);
   MUTEX_UNLOCK(&mutex);
 
   if (snapshot_value_ == NULL) {
@@ -102,7 +106,6 @@ void UniformReservoir::reset() {
 
   MUTEX_LOCK(&mutex);
   counter = 0;
-  data.clear();
 
   // clear snapshot
   MUTEX_UNLOCK(&mutex);
@@ -0,0 +1,139 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Thread cached free lists of fixed size blocks.
+//
+
+#include "common/mm/mpool.h"
+
+#include <stdlib.h>
+
+namespace common {
+
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+struct FreeList {
+  FreeBlock *head;
+  int count;
+};
+
+// lists shared by all threads, the blocks in them are returned by threads
+struct SharedFreeList {
+  pthread_mutex_t mutex;
+  FreeList list;
+};
+
+static SharedFreeList shared_lists[MPOOL_SIZE_CLASS_NUM];
+static pthread_once_t shared_lists_once = PTHREAD_ONCE_INIT;
+
+static void init_shared_lists() {
+  for (int i = 0; i < MPOOL_SIZE_CLASS_NUM; i++) {
+    MUTEX_INIT(&shared_lists[i].mutex, NULL);
+    shared_lists[i].list.head = NULL;
+    shared_lists[i].list.count = 0;
+  }
+}
+
+// move up to count blocks from the head of src to dst
+static void transfer(FreeList &src, FreeList &dst, int count) {
+  while (count > 0 && src.head != NULL) {
+    FreeBlock *block = src.head;
+    src.head = block->next;
+    src.count--;
+    block->next = dst.head;
+    dst.head = block;
+    dst.count++;
+    count--;
+  }
+}
+
+// free lists of current thread, returned to the shared lists when the thread exits
+class ThreadCache {
+ public:
+  ThreadCache() {
+    pthread_once(&shared_lists_once, init_shared_lists);
+    for (int i = 0; i < MPOOL_SIZE_CLASS_NUM; i++) {
+      lists_[i].head = NULL;
+      lists_[i].count = 0;
+    }
+  }
+
+  ~ThreadCache() {
+    for (int i = 0; i < MPOOL_SIZE_CLASS_NUM; i++) {
+      if (lists_[i].count > 0) {
+        MUTEX_LOCK(&shared_lists[i].mutex);
+        transfer(lists_[i], shared_lists[i].list, lists_[i].count);
+        MUTEX_UNLOCK(&shared_lists[i].mutex);
+      }
+    }
+  }
+
+  FreeList &list(int index) { return lists_[index]; }
+
+ private:
+  FreeList lists_[MPOOL_SIZE_CLASS_NUM];
+};
+
+static thread_local ThreadCache thread_cache;
+
+static int size_class(size_t size) {
+  return (int)((size + MPOOL_BLOCK_ALIGN - 1) / MPOOL_BLOCK_ALIGN) - 1;
+}
+
+void *BlockPool::alloc(size_t size) {
+  if (size == 0 || size > MPOOL_MAX_BLOCK_SIZE) {
+    return malloc(size);
+  }
+
+  const int index = size_class(size);
+  FreeList &list = thread_cache.list(index);
+  if (list.head == NULL) {
+    SharedFreeList &shared = shared_lists[index];
+    MUTEX_LOCK(&shared.mutex);
+    transfer(shared.list, list, MPOOL_TRANSFER_BATCH);
+    MUTEX_UNLOCK(&shared.mutex);
+    if (list.head == NULL) {
+      return malloc((index + 1) * MPOOL_BLOCK_ALIGN);
+    }
+  }
+
+  FreeBlock *block = list.head;
+  list.head = block->next;
+  list.count--;
+  return block;
+}
+
+void BlockPool::free(void *ptr, size_t size) {
+  if (ptr == NULL) {
+    return;
+  }
+  if (size == 0 || size > MPOOL_MAX_BLOCK_SIZE) {
+    ::free(ptr);
+    return;
+  }
+
+  const int index = size_class(size);
+  FreeList &list = thread_cache.list(index);
+  FreeBlock *block = (FreeBlock *)ptr;
+  block->next = list.head;
+  list.head = block;
+  list.count++;
+  if (list.count > MPOOL_THREAD_CACHE_MAX) {
+    SharedFreeList &shared = shared_lists[index];
+    MUTEX_LOCK(&shared.mutex);
+    transfer(list, shared.list, MPOOL_TRANSFER_BATCH);
+    MUTEX_UNLOCK(&shared.mutex);
+  }
+}
+
+}  // namespace common
@@ -15,7 +15,11 @@ See the Mulan PSL v2 for more details. */
 #ifndef __COMMON_MM_MPOOL_H__
 #define __COMMON_MM_MPOOL_H__
 
+#include <stddef.h>
+
+#include <new>
 #include <queue>
+#include <vector>
 
 #include "common/lang/mutex.h"
 #include "common/log/log.h"
@@ -43,17 +47,8 @@ class MemPool {
   }
 
   int add(int addSize) {
-    int ret = 0;
-
     MUTEX_LOCK(&mLock);
-    for (int i = 0; i < addSize; i++) {
-      T *item = new T();
-      if (item == NULL) {
-        ret = -1;
-        break;
-      }
-      mQueue.push(item);
-    }
+    int ret = add_locked(addSize);
     MUTEX_UNLOCK(&mLock);
 
     return ret;
@@ -66,7 +61,7 @@ class MemPool {
 
     MUTEX_LOCK(&mLock);
     if (mQueue.empty() == true) {
-      add(mAddSize);
+      add_locked(mAddSize);
     }
 
     if (mQueue.empty() == false) {
@@ -87,11 +82,224 @@ class MemPool {
     MUTEX_UNLOCK(&mLock);
   }
 
+ private:
+  // mLock must be held
+  int add_locked(int addSize) {
+    for (int i = 0; i < addSize; i++) {
+      T *item = new (std::nothrow) T();
+      if (item == NULL) {
+        return -1;
+      }
+      mQueue.push(item);
+    }
+    return 0;
+  }
+
  private:
   std::queue<T *> mQueue;
   pthread_mutex_t mLock;
   int mAddSize;
 };
 
+#define CLMPOOL_DEFAULT_CHUNK_SIZE 64
+
+/**
+ * A MemPool with a cache for every thread.
+ * get() and put() only touch the cache of current thread, so they take no
+ * lock. When the cache is empty it takes a batch from the shared free list,
+ * which is refilled by allocating objects in contiguous chunks, objects
+ * created together stay close in memory. When the cache holds more than
+ * two chunks, a chunk's worth is returned to the shared free list.
+ * Objects are constructed once with T() like MemPool and not reset on put.
+ * The pool must outlive the threads using it, or they must stop using it
+ * before it is destroyed.
+ */
+template <class T>
+class ThreadLocalMemPool {
+ public:
+  explicit ThreadLocalMemPool(int chunkSize = CLMPOOL_DEFAULT_CHUNK_SIZE)
+      : mChunkSize(chunkSize > 0 ? chunkSize : CLMPOOL_DEFAULT_CHUNK_SIZE) {
+    MUTEX_INIT(&mLock, NULL);
+    pthread_key_create(&mKey, release_cache);
+  }
+
+  ~ThreadLocalMemPool() {
+    // the key destructor is not called after the key is deleted
+    pthread_key_delete(mKey);
+    MUTEX_LOCK(&mLock);
+    for (LocalCache *cache : mCaches) {
+      delete cache;
+    }
+    mCaches.clear();
+    for (T *chunk : mChunks) {
+      delete[] chunk;
+    }
+    mChunks.clear();
+    mFree.clear();
+    MUTEX_UNLOCK(&mLock);
+    MUTEX_DESTROY(&mLock);
+  }
+
+  // Allocate objects of initSize / chunk size chunks ahead
+  int init(int initSize) {
+    MUTEX_LOCK(&mLock);
+    int ret = 0;
+    while ((int)mFree.size() < initSize && ret == 0) {
+      ret = add_chunk_locked();
+    }
+    MUTEX_UNLOCK(&mLock);
+    return ret;
+  }
+
+  T *get() {
+    LocalCache *cache = local_cache();
+    if (cache == NULL) {
+      return NULL;
+    }
+    if (cache->items.empty()) {
+      MUTEX_LOCK(&mLock);
+      if (mFree.empty()) {
+        add_chunk_locked();
+      }
+      transfer(mFree, cache->items, mChunkSize);
+      MUTEX_UNLOCK(&mLock);
+      if (cache->items.empty()) {
+        return NULL;
+      }
+    }
+    T *item = cache->items.back();
+    cache->items.pop_back();
+    return item;
+  }
+
+  void put(T *item) {
+    LocalCache *cache = local_cache();
+    if (cache == NULL) {
+      MUTEX_LOCK(&mLock);
+      mFree.push_back(item);
+      MUTEX_UNLOCK(&mLock);
+      return;
+    }
+    cache->items.push_back(item);
+    if ((int)cache->items.size() > 2 * mChunkSize) {
+      MUTEX_LOCK(&mLock);
+      transfer(cache->items, mFree, mChunkSize);
+      MUTEX_UNLOCK(&mLock);
+    }
+  }
+
+ private:
+  struct LocalCache {
+    ThreadLocalMemPool *pool;
+    std::vector<T *> items;
+  };
+
+  // move up to count items from the back of src to dst
+  static void transfer(std::vector<T *> &src, std::vector<T *> &dst, int count) {
+    while (count > 0 && !src.empty()) {
+      dst.push_back(src.back());
+      src.pop_back();
+      count--;
+    }
+  }
+
+  // called when a thread exits, gives its objects back to the pool
+  static void release_cache(void *arg) {
+    LocalCache *cache = (LocalCache *)arg;
+    ThreadLocalMemPool *pool = cache->pool;
+    MUTEX_LOCK(&pool->mLock);
+    transfer(cache->items, pool->mFree, (int)cache->items.size());
+    for (size_t i = 0; i < pool->mCaches.size(); i++) {
+      if (pool->mCaches[i] == cache) {
+        pool->mCaches[i] = pool->mCaches.back();
+        pool->mCaches.pop_back();
+        break;
+      }
+    }
+    MUTEX_UNLOCK(&pool->mLock);
+    delete cache;
+  }
+
+  LocalCache *local_cache() {
+    LocalCache *cache = (LocalCache *)pthread_getspecific(mKey);
+    if (cache != NULL) {
+      return cache;
+    }
+    cache = new (std::nothrow) LocalCache();
+    if (cache == NULL) {
+      return NULL;
+    }
+    cache->pool = this;
+    cache->items.reserve(2 * mChunkSize + 1);
+    pthread_setspecific(mKey, cache);
+    MUTEX_LOCK(&mLock);
+    mCaches.push_back(cache);
+    MUTEX_UNLOCK(&mLock);
+    return cache;
+  }
+
+  // mLock must be held
+  int add_chunk_locked() {
+    T *chunk = new (std::nothrow) T[mChunkSize];
+    if (chunk == NULL) {
+      return -1;
+    }
+    mChunks.push_back(chunk);
+    // transfer() reverses the order, so the cache hands out from the beginning of the chunk
+    for (int i = 0; i < mChunkSize; i++) {
+      mFree.push_back(&chunk[i]);
+    }
+    return 0;
+  }
+
+ private:
+  pthread_mutex_t mLock;              // protects the members below
+  pthread_key_t mKey;                 // LocalCache of current thread
+  std::vector<T *> mChunks;           // all the chunks allocated
+  std::vector<T *> mFree;             // free objects shared by threads
+  std::vector<LocalCache *> mCaches;  // caches of the threads alive
+  int mChunkSize;
+};
+
+#define MPOOL_BLOCK_ALIGN 16
+#define MPOOL_MAX_BLOCK_SIZE 512
+#define MPOOL_SIZE_CLASS_NUM (MPOOL_MAX_BLOCK_SIZE / MPOOL_BLOCK_ALIGN)
+#define MPOOL_THREAD_CACHE_MAX 256  // blocks of one size kept by a thread
+#define MPOOL_TRANSFER_BATCH 32     // blocks moved between a thread and the shared list at a time
+
+/**
+ * Allocator of small fixed size blocks.
+ * Sizes are rounded up to MPOOL_BLOCK_ALIGN, every size class has a free
+ * list per thread, so allocating and freeing a block in steady state takes
+ * no lock and does not reach the heap. A thread which frees more blocks
+ * than it allocates (e.g. the consumer of events created by another
+ * thread) returns them to a shared list in batches, and a thread which
+ * runs out takes a batch from there before asking the heap.
+ * Blocks bigger than MPOOL_MAX_BLOCK_SIZE go to the heap directly.
+ */
+class BlockPool {
+ public:
+  static void *alloc(size_t size);
+  static void free(void *ptr, size_t size);
+};
+
+/**
+ * Base class of objects allocated from BlockPool.
+ * Derived classes with virtual destructors are freed with their real
+ * size, so every subclass shares the pools by size.
+ */
+class PooledObject {
+ public:
+  static void *operator new(size_t size) {
+    void *ptr = BlockPool::alloc(size);
+    if (ptr == NULL) {
+      throw std::bad_alloc();
+    }
+    return ptr;
+  }
+  static void *operator new(size_t size, const std::nothrow_t &) noexcept { return BlockPool::alloc(size); }
+  static void operator delete(void *ptr, size_t size) { BlockPool::free(ptr, size); }
+};
+
 } //namespace common
 #endif /* __COMMON_MM_MPOOL_H__ */
@@ -12,9 +12,19 @@ See the Mulan PSL v2 for more details. */
 // Created by Longda on 2010.
 //
 
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef HAVE_LINUX_MEMPOLICY_H
+#include <linux/mempolicy.h>
+#endif
+
+#include <fstream>
 #include <thread>
 
 #include "common/defs.h"
+#include "common/lang/string.h"
 #include "common/os/os.h"
 
 namespace common {
@@ -23,4 +33,58 @@ u32_t getCpuNum() {
   return std::thread::hardware_concurrency();
 }
 
+int parse_cpu_list(const std::string &str, std::vector<int> &cpus) {
+  std::vector<std::string> ranges;
+  split_string(str, ",", ranges);
+  for (size_t i = 0; i < ranges.size(); i++) {
+    std::string range = ranges[i];
+    strip(range);
+    const char *begin = range.c_str();
+    char *end = NULL;
+    long first = strtol(begin, &end, 10);
+    if (end == begin || first < 0) {
+      return -1;
+    }
+    long last = first;
+    if (*end == '-') {
+      begin = end + 1;
+      last = strtol(begin, &end, 10);
+      if (end == begin || last < first) {
+        return -1;
+      }
+    }
+    if (*end != '\0' || last >= CPU_SETSIZE) {
+      return -1;
+    }
+    for (long cpu = first; cpu <= last; cpu++) {
+      cpus.push_back((int)cpu);
+    }
+  }
+  return cpus.empty() ? -1 : 0;
+}
+
+void get_numa_nodes(std::vector<int> &nodes) {
+  std::ifstream ifs("/sys/devices/system/node/online");
+  std::string online;
+  if (!std::getline(ifs, online) || parse_cpu_list(online, nodes) != 0) {
+    nodes.clear();
+    nodes.push_back(0);
+  }
+}
+
+int bind_memory_to_numa_node(void *addr, size_t len, int node) {
+#if defined(HAVE_LINUX_MEMPOLICY_H) && defined(SYS_mbind)
+  const int bits = sizeof(unsigned long) * 8;
+  unsigned long mask[CPU_SETSIZE / (sizeof(unsigned long) * 8)] = {0};
+  if (node < 0 || node >= CPU_SETSIZE) {
+    return -1;
+  }
+  mask[node / bits] |= 1UL << (node % bits);
+  // the preferred node falls back to the others when it is out of memory
+  return (int)syscall(SYS_mbind, addr, len, MPOL_PREFERRED, mask, (unsigned long)CPU_SETSIZE, 0);
+#else
+  return -1;
+#endif
+}
+
 }//namespace common
\ No newline at end of file
@@ -14,9 +14,32 @@ See the Mulan PSL v2 for more details. */
 
 #ifndef __COMMON_OS_OS_H__
 #define __COMMON_OS_OS_H__
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
 namespace common {
 
 u32_t getCpuNum();
 
+/**
+ * Parse a list like "0-3,8,10-11", the format used by taskset and by
+ * /sys/devices/system/node. Returns -1 if the list is invalid.
+ */
+int parse_cpu_list(const std::string &str, std::vector<int> &cpus);
+
+/**
+ * Ids of the online numa nodes, only node 0 if the system isn't numa.
+ */
+void get_numa_nodes(std::vector<int> &nodes);
+
+/**
+ * Prefer to allocate the pages of [addr, addr + len) on the numa node. Must
+ * be called before the memory is touched. Returns -1 if it isn't supported.
+ */
+int bind_memory_to_numa_node(void *addr, size_t len, int node);
+
 } //namespace common
 #endif /* __COMMON_OS_OS_H__ */
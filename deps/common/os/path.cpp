@@ -139,7 +139,8 @@ bool check_directory(std::string &path) {
     return true;
 
 	bool sep_state = false;
-  for (int i = 0; i < len; i++)
+  // 绝对路径开头的'/'是根目录，不需要创建
+  for (int i = 1; i < len; i++)
   {
     if (path[i] != '/')
     {
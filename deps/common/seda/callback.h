@@ -17,6 +17,7 @@ See the Mulan PSL v2 for more details. */
 
 // Include Files
 #include "common/defs.h"
+#include "common/mm/mpool.h"
 namespace common {
 
 class StageEvent;
@@ -53,9 +54,10 @@ class CallbackContext;
  * to execute the callback stack in place, it can call the done_immediate()
  * interface.  Note that this will execute the *entire* callback stack on
  * the current thread.
+ * Callbacks are allocated from the thread cached BlockPool.
  */
 
-class CompletionCallback {
+class CompletionCallback : public PooledObject {
 
   // public interface operations
 
@@ -56,7 +56,7 @@ protected:
    * @post event queue is empty
    * @post stage is not connected
    */
-  KillThreadStage(const char *tag) : Stage(tag) {}
+  KillThreadStage(const char *tag) : Stage(tag) { report_metrics_ = false; }
 
   /**
    * Notify the pool and kill the thread
@@ -22,6 +22,7 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/string.h"
 #include "common/log/log.h"
 #include "common/metrics/metrics_registry.h"
+#include "common/metrics/prometheus_reporter.h"
 #include "common/seda/metrics_report_event.h"
 #include "common/seda/timer_stage.h"
 #include "common/time/datetime.h"
@@ -66,6 +67,22 @@ bool MetricsStage::set_properties() {
     str_to_val(it->second, metric_report_interval_);
   }
 
+  it = section.find(PROMETHEUS_PORT);
+  if (it != section.end()) {
+    str_to_val(it->second, prometheus_port_);
+  }
+
+  it = section.find(LOCK_PROFILER_SAMPLE_RATE);
+  if (it != section.end()) {
+    int sample_rate = LOCK_PROFILER_DEFAULT_SAMPLE_RATE;
+    str_to_val(it->second, sample_rate);
+    LockProfiler::set_sample_rate(sample_rate);
+  }
+  it = section.find(LOCK_PROFILER);
+  if (it != section.end()) {
+    LockProfiler::set_enabled(0 == strcasecmp(it->second.c_str(), "true") || it->second == "1");
+  }
+
   return true;
 }
 
@@ -76,6 +93,19 @@ bool MetricsStage::initialize() {
   std::list<Stage *>::iterator stgp = next_stage_list_.begin();
   timer_stage_ = *(stgp++);
 
+  if (prometheus_port_ > 0) {
+    PrometheusReporter *reporter = get_prometheus_reporter();
+    if (reporter->start(prometheus_port_) != 0) {
+      LOG_ERROR("Failed to serve metrics for prometheus on port %d", prometheus_port_);
+      return false;
+    }
+    get_metrics_registry().add_reporter(reporter);
+  }
+
+  // registered even when disabled, the profiler may be enabled at runtime
+  lock_contention_metric_ = new LockContentionMetric();
+  get_metrics_registry().register_metric(LOCK_CONTENTION_METRIC_TAG, lock_contention_metric_);
+
   MetricsReportEvent *report_event = new MetricsReportEvent();
 
   add_event(report_event);
@@ -87,6 +117,15 @@ bool MetricsStage::initialize() {
 void MetricsStage::cleanup() {
   LOG_TRACE("Enter");
 
+  if (prometheus_port_ > 0) {
+    get_prometheus_reporter()->stop();
+  }
+  if (lock_contention_metric_ != nullptr) {
+    get_metrics_registry().unregister(LOCK_CONTENTION_METRIC_TAG);
+    delete lock_contention_metric_;
+    lock_contention_metric_ = nullptr;
+  }
+
   LOG_TRACE("Exit");
 }
 
@@ -15,6 +15,7 @@ See the Mulan PSL v2 for more details. */
 #ifndef __COMMON_SEDA_METRICS_STAGE_H__
 #define __COMMON_SEDA_METRICS_STAGE_H__
 
+#include "common/lang/lock_profiler.h"
 #include "common/seda/stage.h"
 
 namespace common {
@@ -39,6 +40,10 @@ private:
   Stage *timer_stage_ = nullptr;
   //report metrics every @metric_report_interval_ seconds
   int  metric_report_interval_ = 10;
+  // serve metrics on this port for prometheus, 0 means disabled
+  int prometheus_port_ = 0;
+  // reports the contention of MUTEX_LOCK sites while LockProfiler is enabled
+  LockContentionMetric *lock_contention_metric_ = nullptr;
 };
 } // namespace common
 #endif //__COMMON_SEDA_METRICS_STAGE_H__
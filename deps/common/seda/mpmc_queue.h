@@ -0,0 +1,142 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Bounded lock-free multi-producer multi-consumer queue of stage events.
+//
+
+#ifndef __COMMON_SEDA_MPMC_QUEUE_H__
+#define __COMMON_SEDA_MPMC_QUEUE_H__
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace common {
+
+/**
+ * A bounded lock-free queue of pointers, any thread can push and pop.
+ * Every cell carries a sequence number telling whether it is ready to be
+ * written or read at a given position, so a producer or a consumer only
+ * needs one CAS on the tail or the head (D. Vyukov's bounded queue).
+ * push() fails when the queue is full. pop() may also report empty while
+ * an earlier producer is still writing its cell, callers which know an
+ * item is there should retry.
+ */
+template <class T>
+class MpmcQueue {
+ public:
+  static const uint64_t CAPACITY = 1024;  // must be a power of 2
+
+  MpmcQueue() : head_(0), tail_(0) {
+    for (uint64_t i = 0; i < CAPACITY; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+      cells_[i].item = nullptr;
+    }
+  }
+
+  /**
+   * Append an item to the tail.
+   * @return false if the queue is full
+   */
+  bool push(T *item) {
+    uint64_t pos = tail_.load(std::memory_order_relaxed);
+    Cell *cell = nullptr;
+    while (true) {
+      cell = &cells_[pos & (CAPACITY - 1)];
+      const uint64_t seq = cell->sequence.load(std::memory_order_acquire);
+      const int64_t diff = (int64_t)seq - (int64_t)pos;
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->item = item;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Take the item at the head.
+   * @return nullptr if there is no item ready
+   */
+  T *pop() {
+    T *item = nullptr;
+    return pop_batch(&item, 1) == 1 ? item : nullptr;
+  }
+
+  /**
+   * Take up to max ready items from the head with a single CAS.
+   * @return number of items stored in items
+   */
+  int pop_batch(T **items, int max) {
+    uint64_t pos = head_.load(std::memory_order_relaxed);
+    int count = 0;
+    while (true) {
+      // count the cells which are ready from pos
+      count = 0;
+      while (count < max) {
+        Cell &cell = cells_[(pos + count) & (CAPACITY - 1)];
+        const uint64_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (seq != pos + count + 1) {
+          break;
+        }
+        count++;
+      }
+      if (count == 0) {
+        const uint64_t seq = cells_[pos & (CAPACITY - 1)].sequence.load(std::memory_order_acquire);
+        if ((int64_t)seq - (int64_t)(pos + 1) < 0) {
+          return 0;
+        }
+        // another consumer took this position
+        pos = head_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (head_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+
+    for (int i = 0; i < count; i++) {
+      Cell &cell = cells_[(pos + i) & (CAPACITY - 1)];
+      items[i] = cell.item;
+      cell.sequence.store(pos + i + CAPACITY, std::memory_order_release);
+    }
+    return count;
+  }
+
+  /**
+   * Approximate number of items.
+   */
+  uint64_t size() const {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<uint64_t> sequence;
+    T *item;
+  };
+
+  std::atomic<uint64_t> head_;
+  char pad_[64];  // keep producers and consumers off the same cache line
+  std::atomic<uint64_t> tail_;
+  Cell cells_[CAPACITY];
+};
+
+}  // namespace common
+#endif  // __COMMON_SEDA_MPMC_QUEUE_H__
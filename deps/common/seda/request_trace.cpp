@@ -0,0 +1,182 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Sampled request tracing: spans kept in a fixed ring per request and
+// exported in the Chrome trace event format.
+//
+
+#include "common/seda/request_trace.h"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/log/log.h"
+#include "common/metrics/latency_histogram.h"
+
+namespace common {
+
+static thread_local RequestTrace *current_trace = nullptr;
+
+RequestTrace::RequestTrace(u64_t id) : id_(id), next_(0) {}
+
+void RequestTrace::add_span(const char *category, const char *name, u64_t begin_us, u64_t end_us) {
+  // the kernel thread id, the same as shown by top -H
+  static thread_local s64_t thread_id = syscall(SYS_gettid);
+  const u64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+  TraceSpan &span = spans_[index % REQUEST_TRACE_SPAN_NUM];
+  span.category = category;
+  span.name = name;
+  span.begin_us = begin_us;
+  span.end_us = end_us;
+  span.thread_id = thread_id;
+}
+
+int RequestTrace::span_num() const {
+  const u64_t count = next_.load(std::memory_order_relaxed);
+  return count < REQUEST_TRACE_SPAN_NUM ? (int)count : REQUEST_TRACE_SPAN_NUM;
+}
+
+const TraceSpan &RequestTrace::span(int i) const {
+  return spans_[(dropped() + i) % REQUEST_TRACE_SPAN_NUM];
+}
+
+u64_t RequestTrace::dropped() const {
+  const u64_t count = next_.load(std::memory_order_relaxed);
+  return count > REQUEST_TRACE_SPAN_NUM ? count - REQUEST_TRACE_SPAN_NUM : 0;
+}
+
+RequestTrace *RequestTrace::current() {
+  return current_trace;
+}
+
+void RequestTrace::set_current(RequestTrace *trace) {
+  current_trace = trace;
+}
+
+TraceSpanScope::TraceSpanScope(const char *category, const char *name)
+    : trace_(current_trace), category_(category), name_(name),
+      begin_us_(trace_ == nullptr ? 0 : LatencyHistogram::now_us()) {}
+
+TraceSpanScope::~TraceSpanScope() {
+  if (trace_ != nullptr) {
+    trace_->add_span(category_, name_, begin_us_, LatencyHistogram::now_us());
+  }
+}
+
+RequestTraceLog &RequestTraceLog::instance() {
+  static RequestTraceLog trace_log;
+  return trace_log;
+}
+
+RequestTraceLog::~RequestTraceLog() {
+  close();
+}
+
+int RequestTraceLog::init(const std::string &file, double sample_rate) {
+  close();
+  if (sample_rate <= 0) {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  file_ = fopen(file.c_str(), "a");
+  if (file_ == nullptr) {
+    LOG_ERROR("Failed to open request trace file %s. error=%s", file.c_str(), strerror(errno));
+    return -1;
+  }
+  if (ftell(file_) == 0) {
+    fputs("[\n", file_);
+  }
+  sample_every_ = sample_rate >= 1 ? 1 : (u64_t)llround(1 / sample_rate);
+  LOG_INFO("Trace 1 of every %lu requests to %s", (unsigned long)sample_every_, file.c_str());
+  return 0;
+}
+
+void RequestTraceLog::close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_ != nullptr) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+RequestTrace *RequestTraceLog::sample() {
+  if (file_ == nullptr) {
+    return nullptr;
+  }
+  const u64_t count = request_count_.fetch_add(1, std::memory_order_relaxed);
+  if (count % sample_every_ != 0) {
+    return nullptr;
+  }
+  return new RequestTrace(count);
+}
+
+void RequestTraceLog::write(const RequestTrace &trace, const char *label) {
+  std::string out;
+  to_chrome_trace(trace, label, out);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_ != nullptr) {
+    fwrite(out.data(), 1, out.size(), file_);
+    fflush(file_);
+  }
+}
+
+static void append_json_string(const char *s, std::string &out) {
+  out += '"';
+  for (size_t i = 0; s[i] != '\0' && i < REQUEST_TRACE_LABEL_MAX_LEN; i++) {
+    const unsigned char c = s[i];
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+void RequestTraceLog::to_chrome_trace(const RequestTrace &trace, const char *label, std::string &out) {
+  // complete events ("ph":"X"), one per span, ts and dur are in us
+  std::string args = "{\"request\":" + std::to_string(trace.id());
+  if (trace.dropped() > 0) {
+    args += ",\"dropped_spans\":" + std::to_string(trace.dropped());
+  }
+  if (label != nullptr) {
+    args += ",\"label\":";
+    append_json_string(label, args);
+  }
+  args += "}";
+
+  const std::string pid = std::to_string(getpid());
+  char buf[128];
+  for (int i = 0; i < trace.span_num(); i++) {
+    const TraceSpan &span = trace.span(i);
+    out += "{\"name\":";
+    append_json_string(span.name, out);
+    out += ",\"cat\":";
+    append_json_string(span.category, out);
+    snprintf(buf, sizeof(buf), ",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,\"pid\":%s,\"tid\":%ld,\"args\":",
+        (unsigned long)span.begin_us, (unsigned long)(span.end_us - span.begin_us), pid.c_str(),
+        (long)span.thread_id);
+    out += buf;
+    out += args;
+    out += "},\n";
+  }
+}
+
+}  // namespace common
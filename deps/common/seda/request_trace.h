@@ -0,0 +1,132 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Sampled request tracing: spans kept in a fixed ring per request and
+// exported in the Chrome trace event format.
+//
+
+#ifndef __COMMON_SEDA_REQUEST_TRACE_H__
+#define __COMMON_SEDA_REQUEST_TRACE_H__
+
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "common/defs.h"
+
+namespace common {
+
+#define REQUEST_TRACE_SPAN_NUM 256     // spans kept per request, older spans are overwritten
+#define REQUEST_TRACE_LABEL_MAX_LEN 256  // the label (e.g. the SQL) is truncated in the exported trace
+
+struct TraceSpan {
+  const char *category;  // static string, e.g. "stage" or "storage"
+  const char *name;      // static string
+  u64_t begin_us;
+  u64_t end_us;
+  s64_t thread_id;
+};
+
+/**
+ * Spans of one request. The ring is allocated together with the trace, adding
+ * a span never allocates memory. Spans may be added from several threads, e.g.
+ * by the workers of a parallel scan, but the trace must not be exported until
+ * they have finished.
+ */
+class RequestTrace {
+public:
+  explicit RequestTrace(u64_t id);
+
+  u64_t id() const { return id_; }
+
+  void add_span(const char *category, const char *name, u64_t begin_us, u64_t end_us);
+
+  // spans kept in the ring, at most REQUEST_TRACE_SPAN_NUM
+  int span_num() const;
+  // the i-th kept span, the oldest first
+  const TraceSpan &span(int i) const;
+  // spans overwritten because the ring was full
+  u64_t dropped() const;
+
+  /**
+   * The trace of the request handled by the current thread, nullptr if the
+   * request is not sampled. Code deep in the storage layer uses it to add
+   * spans without passing the event around.
+   */
+  static RequestTrace *current();
+  static void set_current(RequestTrace *trace);
+
+private:
+  u64_t id_;
+  std::atomic<u64_t> next_;
+  TraceSpan spans_[REQUEST_TRACE_SPAN_NUM];
+};
+
+/**
+ * Add a span for the enclosing scope to the trace of the current thread.
+ * Costs one thread local read if the request is not sampled.
+ */
+class TraceSpanScope {
+public:
+  TraceSpanScope(const char *category, const char *name);
+  ~TraceSpanScope();
+
+private:
+  RequestTrace *trace_;
+  const char *category_;
+  const char *name_;
+  u64_t begin_us_;
+};
+
+/**
+ * Decides which requests are traced and appends finished traces to a file in
+ * the Chrome trace event format (JSON array format), which can be opened by
+ * chrome://tracing or Perfetto. The closing ']' is optional in this format, so
+ * the file stays valid while it grows.
+ */
+class RequestTraceLog {
+public:
+  static RequestTraceLog &instance();
+
+  /**
+   * sample_rate is the fraction of requests to trace, 0 disables tracing
+   */
+  int init(const std::string &file, double sample_rate);
+  void close();
+
+  bool enabled() const { return file_ != nullptr; }
+  /**
+   * Return a new trace if this request should be traced, otherwise nullptr
+   */
+  RequestTrace *sample();
+  /**
+   * Write all spans of the trace, label is shown in the args of every span
+   */
+  void write(const RequestTrace &trace, const char *label);
+
+  static void to_chrome_trace(const RequestTrace &trace, const char *label, std::string &out);
+
+private:
+  RequestTraceLog() = default;
+  ~RequestTraceLog();
+
+private:
+  std::mutex mutex_;
+  FILE *file_ = nullptr;
+  u64_t sample_every_ = 0;
+  std::atomic<u64_t> request_count_{0};
+};
+
+}  // namespace common
+
+#endif  // __COMMON_SEDA_REQUEST_TRACE_H__
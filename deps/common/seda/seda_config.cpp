@@ -39,7 +39,7 @@ SedaConfig *&SedaConfig::get_instance() {
 }
 
 // Constructor
-SedaConfig::SedaConfig() : cfg_file_(), cfg_str_(), thread_pools_(), stages_() {
+SedaConfig::SedaConfig() : cfg_file_(), cfg_str_(), thread_pools_(), autoscaler_(), stages_() {
   return;
 }
 
@@ -123,6 +123,18 @@ SedaConfig::status_t SedaConfig::start() {
     iter++;
   }
 
+  if (stat == SUCCESS && !autoscaler_.empty()) {
+    std::string interval_str =
+        get_properties()->get(AUTOSCALE_INTERVAL, std::to_string(AUTOSCALE_INTERVAL_MS), SEDA_BASE_NAME);
+    int interval_ms = AUTOSCALE_INTERVAL_MS;
+    str_to_val(interval_str, interval_ms);
+    if (interval_ms <= 0 || !autoscaler_.start(interval_ms)) {
+      LOG_ERROR("Failed to start the thread pool autoscaler, %s=%s", AUTOSCALE_INTERVAL, interval_str.c_str());
+      cleanup();
+      stat = INITFAIL;
+    }
+  }
+
   return stat;
 }
 
@@ -151,6 +163,9 @@ SedaConfig::status_t SedaConfig::init() {
 
 // Clean-up the threadpool and stages_
 void SedaConfig::cleanup() {
+  // stop resizing the pools before they are deleted
+  autoscaler_.stop();
+
   // first disconnect all stages_
   if (stages_.empty() == false) {
     std::map<std::string, Stage *>::iterator iter = stages_.begin();
@@ -249,11 +264,41 @@ SedaConfig::status_t SedaConfig::init_thread_pool() {
         return INITFAIL;
       }
 
-      Threadpool * thread_pool = new Threadpool(thread_count, thread_name);
+      // get work stealing switch
+      key = WORK_STEALING;
+      std::string stealing_str = get_properties()->get(key, "false", thread_name);
+      bool work_stealing = stealing_str.compare("true") == 0;
+
+      // get cpu affinity, e.g. the cpus of one numa node
+      key = CPUS;
+      std::string cpus_str = get_properties()->get(key, "", thread_name);
+      std::vector<int> cpus;
+      if (!cpus_str.empty() && parse_cpu_list(cpus_str, cpus) != 0) {
+        LOG_ERROR("Invalid %s of %s: %s", CPUS, thread_name.c_str(), cpus_str.c_str());
+        return INITFAIL;
+      }
+
+      // the autoscaler keeps the number of threads between MinCount and MaxCount,
+      // both are count by default, then the pool keeps its size
+      int min_count = thread_count;
+      int max_count = thread_count;
+      str_to_val(get_properties()->get(MIN_COUNT, count_str, thread_name), min_count);
+      str_to_val(get_properties()->get(MAX_COUNT, count_str, thread_name), max_count);
+      if (min_count < 1 || min_count > thread_count || max_count < thread_count ||
+          max_count >= max_thread_count) {
+        LOG_ERROR("Invalid %s=%d or %s=%d of %s, must be %s <= count(%d) <= %s",
+                  MIN_COUNT, min_count, MAX_COUNT, max_count, thread_name.c_str(),
+                  MIN_COUNT, thread_count, MAX_COUNT);
+        return INITFAIL;
+      }
+
+      Threadpool * thread_pool = new Threadpool(thread_count, thread_name, work_stealing, cpus);
       if (thread_pool == NULL) {
         LOG_ERROR("Failed to new %s threadpool\n", thread_name.c_str());
         return INITFAIL;
       }
+      thread_pool->set_thread_limits(min_count, max_count);
+      autoscaler_.add_pool(thread_pool);
       thread_pools_[thread_name] = thread_pool;
     }
 
@@ -344,6 +389,13 @@ SedaConfig::status_t SedaConfig::init_stages() {
       stages_[stage_name] = stage;
       stage->set_pool(t);
 
+      key = RUN_TO_COMPLETION;
+      std::string run_to_completion = get_properties()->get(key, "false", stage_name);
+      if (run_to_completion.compare("true") == 0) {
+        stage->set_run_to_completion(true);
+        LOG_INFO("Stage %s runs events of its threadpool to completion.", stage_name.c_str());
+      }
+
       LOG_INFO("Stage %s use threadpool %s.",
                stage_name.c_str(), thread_name.c_str());
     } // end for stage
@@ -452,6 +504,8 @@ void SedaConfig::clear_config() {
   LOG_INFO("Seda Stage released");
 
   // delete thread_pools_
+  autoscaler_.stop();
+  autoscaler_.clear();
   std::map<std::string, Threadpool *>::iterator t_iter = thread_pools_.begin();
   std::map<std::string, Threadpool *>::iterator t_end = thread_pools_.end();
   while (t_iter != t_end) {
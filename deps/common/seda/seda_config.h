@@ -22,6 +22,7 @@ See the Mulan PSL v2 for more details. */
 #include <vector>
 
 #include "common/seda/thread_pool.h"
+#include "common/seda/thread_pool_autoscaler.h"
 #include "common/seda/seda_defs.h"
 
 namespace common {
@@ -201,6 +202,7 @@ class SedaConfig {
   std::string cfg_str_;
 
   std::map<std::string, Threadpool *> thread_pools_;
+  ThreadpoolAutoscaler autoscaler_;  // resizes the pools with MinCount < MaxCount
   std::map<std::string, Stage *> stages_;
   std::vector<std::string> stage_names_;
 
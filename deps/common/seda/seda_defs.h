@@ -23,11 +23,21 @@ See the Mulan PSL v2 for more details. */
 #define MAX_EVENT_HISTORY_NUM "MaxEventHistoryNum"
 
 #define COUNT "count"
+#define MIN_COUNT "MinCount"
+#define MAX_COUNT "MaxCount"
+#define AUTOSCALE_INTERVAL "AutoscaleInterval"
+#define WORK_STEALING "WorkStealing"
+#define CPUS "cpus"
 
 #define THREAD_POOL_ID "ThreadId"
 
 #define NEXT_STAGES "NextStages"
+#define RUN_TO_COMPLETION "RunToCompletion"
 #define DEFAULT_THREAD_POOL "DefaultThreads"
 #define METRCS_REPORT_INTERVAL "MetricsReportInterval"
+#define PROMETHEUS_PORT "PrometheusPort"
+#define LOCK_PROFILER "LockProfiler"
+#define LOCK_PROFILER_SAMPLE_RATE "LockProfilerSampleRate"
+#define LOCK_CONTENTION_METRIC_TAG "lock_contention"
 
 #endif //__COMMON_SEDA_SEDA_DEFS_H__
@@ -16,16 +16,44 @@ See the Mulan PSL v2 for more details. */
 #include "common/seda/stage.h"
 
 #include <assert.h>
+#include <sched.h>
 #include <string.h>
 
 #include "common/defs.h"
 #include "common/lang/mutex.h"
 #include "common/lang/string.h"
 #include "common/log/log.h"
+#include "common/metrics/metrics.h"
+#include "common/metrics/metrics_registry.h"
 #include "common/seda/init.h"
 #include "common/seda/thread_pool.h"
 namespace common {
 
+// nesting of stages handled inline on the current thread
+static thread_local int inline_depth = 0;
+
+/**
+ * Queue length of a stage when the metrics are reported
+ */
+class QueueLengthGauge : public Gauge {
+public:
+  QueueLengthGauge(const Stage &stage) : stage_(stage) {}
+  virtual ~QueueLengthGauge() {
+    delete snapshot_value_;
+    snapshot_value_ = nullptr;
+  }
+
+  void snapshot() {
+    if (snapshot_value_ == nullptr) {
+      snapshot_value_ = new SnapshotBasic<unsigned long>();
+    }
+    unsigned long qlen = stage_.qlen();
+    ((SnapshotBasic<unsigned long> *)snapshot_value_)->setValue(qlen);
+  }
+
+private:
+  const Stage &stage_;
+};
 
 /**
  * Constructor
@@ -36,7 +64,7 @@ namespace common {
  * @post stage is not connected
  */
 Stage::Stage(const char *tag)
-    : next_stage_list_(), event_list_(), connected_(false), event_ref_(0) {
+    : next_stage_list_(), event_list_(), overflow_(0), low_num_(0), connected_(false), event_ref_(0) {
   LOG_TRACE("%s", "enter");
   assert(tag != NULL);
 
@@ -44,6 +72,7 @@ Stage::Stage(const char *tag)
   COND_INIT(&disconnect_cond_, NULL);
   stage_name_ = new char[strlen(tag) + 1];
   snprintf(stage_name_, strlen(tag) + 1, "%s", tag);
+  queue_metric_ = new QueueLengthGauge(*this);
   LOG_TRACE("%s", "exit");
 }
 
@@ -55,16 +84,30 @@ Stage::Stage(const char *tag)
 Stage::~Stage() {
   LOG_TRACE("%s", "enter");
   assert(!connected_);
+  StageEvent *events[64];
+  int count = 0;
+  while ((count = event_queue_.pop_batch(events, 64)) > 0) {
+    for (int i = 0; i < count; i++) {
+      delete events[i];
+    }
+  }
   MUTEX_LOCK(&list_mutex_);
   while (event_list_.size() > 0) {
     delete *(event_list_.begin());
     event_list_.pop_front();
   }
+  overflow_ = 0;
+  while (!low_events_.empty()) {
+    delete low_events_.front();
+    low_events_.pop_front();
+  }
+  low_num_ = 0;
   MUTEX_UNLOCK(&list_mutex_);
   next_stage_list_.clear();
 
   MUTEX_DESTROY(&list_mutex_);
   COND_DESTROY(&disconnect_cond_);
+  delete queue_metric_;
   delete[] stage_name_;
   LOG_TRACE("%s", "exit");
 }
@@ -96,7 +139,7 @@ bool Stage::connect() {
   success = initialize();
   if (success) {
     MUTEX_LOCK(&list_mutex_);
-    backlog = event_list_.size();
+    backlog = event_queue_.size() + event_list_.size() + low_events_.size();
     event_ref_ = backlog;
     connected_ = true;
     MUTEX_UNLOCK(&list_mutex_);
@@ -104,13 +147,14 @@ bool Stage::connect() {
 
   // if connection succeeded, schedule all the events in the queue
   if (connected_) {
+    register_metrics();
     while (backlog > 0) {
       th_pool_->schedule(this);
       backlog--;
     }
   }
 
-  LOG_TRACE("%s%s%d", "exit", stage_name_, connected_);
+  LOG_TRACE("%s%s%d", "exit", stage_name_, connected_.load());
   return success;
 }
 
@@ -136,6 +180,7 @@ void Stage::disconnect() {
   while (event_ref_ > 0) {
     COND_WAIT(&disconnect_cond_, &list_mutex_);
   }
+  unregister_metrics();
   th_pool_ = NULL;
   next_stage_list_.clear();
   cleanup();
@@ -154,10 +199,45 @@ void Stage::disconnect() {
 void Stage::add_event(StageEvent *event) {
   assert(event != NULL);
 
+  // count the event before checking the connection, so that disconnect
+  // either waits for it or this thread sees the stage disconnected
+  event_ref_++;
+  if (event->priority() == StageEvent::LOW_PRIORITY) {
+    add_low_priority_event(event);
+    return;
+  }
+  if (connected_) {
+    if (run_to_completion_ && inline_depth < MAX_INLINE_DEPTH && th_pool_->in_pool()) {
+      const u64_t start_us = LatencyHistogram::now_us();
+      const u64_t start_cpu_ns = CpuTimeCounter::thread_cpu_ns();
+      inline_depth++;
+      th_pool_->run_event(this, event);
+      inline_depth--;
+      handle_metric_.update(LatencyHistogram::now_us() - start_us);
+      cpu_metric_.add(CpuTimeCounter::thread_cpu_ns() - start_cpu_ns);
+      release_event();
+      return;
+    }
+    event->set_enqueue_time(LatencyHistogram::now_us());
+    if (!event_queue_.push(event)) {
+      MUTEX_LOCK(&list_mutex_);
+      event_list_.push_back(event);
+      overflow_++;
+      MUTEX_UNLOCK(&list_mutex_);
+    }
+    th_pool_->schedule(this);
+    return;
+  }
+  release_event();
+
   MUTEX_LOCK(&list_mutex_);
 
   // add event to back of queue
-  event_list_.push_back(event);
+  event->set_enqueue_time(LatencyHistogram::now_us());
+  if (!event_queue_.push(event)) {
+    event_list_.push_back(event);
+    overflow_++;
+  }
 
   if (connected_) {
     assert(th_pool_ != NULL);
@@ -170,17 +250,30 @@ void Stage::add_event(StageEvent *event) {
   }
 }
 
+/**
+ * Queue a low priority event, the event is already counted in event_ref_.
+ */
+void Stage::add_low_priority_event(StageEvent *event) {
+  event->set_enqueue_time(LatencyHistogram::now_us());
+  MUTEX_LOCK(&list_mutex_);
+  low_events_.push_back(event);
+  low_num_++;
+  const bool connected = connected_;
+  MUTEX_UNLOCK(&list_mutex_);
+  if (connected) {
+    th_pool_->schedule(this, true);
+  } else {
+    // scheduled when the stage is connected
+    release_event();
+  }
+}
+
 /**
  * Query length of queue
  * @return length of event queue.
  */
 unsigned long Stage::qlen() const {
-  unsigned long res;
-
-  MUTEX_LOCK(&list_mutex_);
-  res = event_list_.size();
-  MUTEX_UNLOCK(&list_mutex_);
-  return res;
+  return event_queue_.size() + overflow_.load() + low_num_.load();
 }
 
 /**
@@ -188,12 +281,7 @@ unsigned long Stage::qlen() const {
  * @return \c true if the queue is empty; \c false otherwise
  */
 bool Stage::qempty() const {
-  bool empty = false;
-
-  MUTEX_LOCK(&list_mutex_);
-  empty = event_list_.empty();
-  MUTEX_UNLOCK(&list_mutex_);
-  return empty;
+  return qlen() == 0;
 }
 
 /**
@@ -204,29 +292,128 @@ bool Stage::qempty() const {
  * @post  first event on queue is removed from queue.
  */
 StageEvent *Stage::remove_event() {
-  MUTEX_LOCK(&list_mutex_);
+  // the event of this schedule is in one of the queues, the lock-free queue
+  // may look empty for a moment while an earlier producer is writing its cell
+  StageEvent *se = NULL;
+  while ((se = try_remove_event()) == NULL) {
+    sched_yield();
+  }
+  return se;
+}
 
-  assert(!event_list_.empty());
+/**
+ * Take the event of a schedule and the normal events queued behind it.
+ * Every queued event has its own schedule, so the schedules of the events
+ * taken ahead are counted in batched_ and skipped when they run.
+ * @return number of events taken, 0 if the event of this schedule has
+ * been taken by an earlier batch
+ */
+int Stage::remove_events(StageEvent **events, int max) {
+  StageEvent *se = NULL;
+  while (true) {
+    int batched = batched_.load();
+    while (batched > 0) {
+      if (batched_.compare_exchange_weak(batched, batched - 1)) {
+        return 0;
+      }
+    }
+    if ((se = try_remove_event()) != NULL) {
+      break;
+    }
+    sched_yield();
+  }
 
-  StageEvent *se = *(event_list_.begin());
-  event_list_.pop_front();
-  MUTEX_UNLOCK(&list_mutex_);
+  events[0] = se;
+  int n = 1;
+  while (n < max && (se = try_remove_event(false)) != NULL) {
+    events[n++] = se;
+  }
+  batched_ += n - 1;
+  return n;
+}
 
+/**
+ * Handle a batch of events one by one.
+ */
+void Stage::handle_events(StageEvent **events, int n) {
+  for (int i = 0; i < n; i++) {
+    handle_event(events[i]);
+  }
+}
+
+/**
+ * Take one event without waiting.
+ * @return NULL if no event is ready
+ */
+StageEvent *Stage::try_remove_event(bool low) {
+  StageEvent *se = event_queue_.pop();
+  if (se != NULL || (overflow_.load() == 0 && (!low || low_num_.load() == 0))) {
+    return se;
+  }
+
+  MUTEX_LOCK(&list_mutex_);
+  if (!event_list_.empty()) {
+    se = event_list_.front();
+    event_list_.pop_front();
+    overflow_--;
+  } else if (low && !low_events_.empty()) {
+    se = low_events_.front();
+    low_events_.pop_front();
+    low_num_--;
+  }
+  MUTEX_UNLOCK(&list_mutex_);
   return se;
 }
 
+std::string Stage::metric_tag_prefix() const {
+  return "seda." + th_pool_->get_name() + "." + stage_name_ + ".";
+}
+
+/**
+ * Register the metrics of the stage, called when the stage is connected.
+ */
+void Stage::register_metrics() {
+  if (!report_metrics_) {
+    return;
+  }
+  MetricsRegistry &registry = get_metrics_registry();
+  const std::string prefix = metric_tag_prefix();
+  registry.register_metric(prefix + "queue", queue_metric_);
+  registry.register_metric(prefix + "wait", &wait_metric_);
+  registry.register_metric(prefix + "handle", &handle_metric_);
+  registry.register_metric(prefix + "cpu", &cpu_metric_);
+  metrics_registered_ = true;
+}
+
+/**
+ * Unregister the metrics before the stage is disconnected, the registry
+ * does not snapshot them any more after this returns.
+ */
+void Stage::unregister_metrics() {
+  if (!metrics_registered_) {
+    return;
+  }
+  MetricsRegistry &registry = get_metrics_registry();
+  const std::string prefix = metric_tag_prefix();
+  registry.unregister(prefix + "queue");
+  registry.unregister(prefix + "wait");
+  registry.unregister(prefix + "handle");
+  registry.unregister(prefix + "cpu");
+  metrics_registered_ = false;
+}
+
 /**
  * Release event reference on stage.  Called only by service thread.
  *
  * @post event ref count on stage is decremented
  */
 void Stage::release_event() {
-  MUTEX_LOCK(&list_mutex_);
-  event_ref_--;
-  if (!connected_ && event_ref_ == 0) {
+  if (--event_ref_ == 0 && !connected_) {
+    // disconnect holds the mutex until it waits, so the signal is not lost
+    MUTEX_LOCK(&list_mutex_);
     COND_SIGNAL(&disconnect_cond_);
+    MUTEX_UNLOCK(&list_mutex_);
   }
-  MUTEX_UNLOCK(&list_mutex_);
 }
 
 } //namespace common
\ No newline at end of file
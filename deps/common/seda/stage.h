@@ -16,19 +16,25 @@ See the Mulan PSL v2 for more details. */
 #define __COMMON_SEDA_STAGE_H__
 
 // Include Files
+#include <algorithm>
+#include <atomic>
 #include <deque>
 #include <list>
 
 // project headers
 #include "common/defs.h"
 #include "common/log/log.h"
+#include "common/metrics/cpu_time.h"
+#include "common/metrics/latency_histogram.h"
 
 // seda headers
+#include "common/seda/mpmc_queue.h"
 #include "common/seda/stage_event.h"
 namespace common {
 
 class Threadpool;
 class CallbackContext;
+class Metric;
 
 /**
  * A Stage in a staged event-driven architecture
@@ -176,6 +182,9 @@ class Stage {
    * @post event added to the end of event queue
    * @post event must not be de-referenced by caller after return
    * @post event ref count on stage is incremented
+   *
+   * A low priority event is never handled inline, and is taken after the
+   * normal events of the stage.
    */
   void add_event(StageEvent *event);
 
@@ -197,6 +206,36 @@ class Stage {
    */
   bool is_connected() const { return connected_; }
 
+  /**
+   * Set run-to-completion mode
+   * In this mode an event added by a thread of the stage's own threadpool
+   * is handled right away on that thread instead of being queued, so a
+   * chain of such stages runs inline. Events from other threads still go
+   * through the queue.
+   *
+   * @pre  stage not connected
+   */
+  void set_run_to_completion(bool run_to_completion);
+  bool run_to_completion() const { return run_to_completion_; }
+
+  // the deepest nesting of inline stages on one thread, deeper events are queued
+  static const int MAX_INLINE_DEPTH = 16;
+
+  /**
+   * Set the most events a thread takes from the queue at a time
+   * With max_batch > 1 a thread handling the stage also takes the normal
+   * events queued behind the first one, up to max_batch in total, and
+   * passes them to handle_events together. Low priority events are never
+   * taken into a batch.
+   *
+   * @pre  stage not connected
+   */
+  void set_max_batch(int max_batch);
+  int max_batch() const { return max_batch_; }
+
+  // upper bound of max_batch
+  static constexpr int MAX_EVENT_BATCH = 64;
+
   /**
    * Perform Stage-specific processing for an event
    * Processing one event without swtich thread.
@@ -209,6 +248,18 @@ class Stage {
    */
   virtual void handle_event(StageEvent *event) = 0;
 
+  /**
+   * Handle a batch of events taken from the queue together, see set_max_batch
+   * The default handles them one by one. A stage overrides it to share work
+   * between the events, e.g. one log flush for several transactions.
+   *
+   * @param[in] events  Events to handle, none of them a callback.
+   * @param[in] n       Number of events, at least 2.
+   *
+   * @post  events must not be de-referenced by caller after return
+   */
+  virtual void handle_events(StageEvent **events, int n);
+
   /**
    * Perform Stage-specific callback processing for an event
    * Implement callback processing according to the requirements of
@@ -296,15 +347,47 @@ class Stage {
   // implementation state
   char *stage_name_; // name of stage
 
+  // register queue length, queue wait and handle time of the stage in
+  // MetricsRegistry while connected? internal stages may turn it off
+  bool report_metrics_ = true;
+
   friend class Threadpool;
 
  private:
-  std::deque<StageEvent *> event_list_; // event queue
-  mutable pthread_mutex_t list_mutex_;  // protects the event queue
+  // Take one event from the lock-free queue or the overflow list, or a low
+  // priority one when both are empty and low is true
+  StageEvent *try_remove_event(bool low = true);
+  // Take the event of this schedule and the normal events behind it, at most
+  // max in total. Returns 0 if a batch of another schedule took the event
+  int remove_events(StageEvent **events, int max);
+  // Queue an event of LOW_PRIORITY, already counted in event_ref_
+  void add_low_priority_event(StageEvent *event);
+
+  // Tag prefix of the metrics of this stage, "seda.<pool>.<stage>."
+  std::string metric_tag_prefix() const;
+  void register_metrics();
+  void unregister_metrics();
+
+  MpmcQueue<StageEvent> event_queue_;   // lock-free event queue
+  std::deque<StageEvent *> event_list_; // events which the full event_queue_ can not hold
+  std::atomic<unsigned long> overflow_; // length of event_list_
+  std::deque<StageEvent *> low_events_; // low priority events, taken when the others are empty
+  std::atomic<unsigned long> low_num_;  // length of low_events_
+  mutable pthread_mutex_t list_mutex_;  // protects event_list_, low_events_ and connection state changes
   pthread_cond_t disconnect_cond_;      // wait here for disconnect
-  bool connected_;                      // is stage connected to pool?
-  unsigned long event_ref_;             // # of outstanding events
+  std::atomic<bool> connected_;         // is stage connected to pool?
+  std::atomic<unsigned long> event_ref_; // # of outstanding events
   Threadpool *th_pool_ = nullptr;       // Threadpool for this stage
+  bool run_to_completion_ = false;      // handle events from own pool inline?
+  int max_batch_ = 1;                   // most events handled together
+  std::atomic<int> batched_{0};         // events taken by batches ahead of their schedules
+
+  // metrics, updated by the threads of th_pool_
+  Metric *queue_metric_ = nullptr;       // queue length when reported
+  LatencyHistogram wait_metric_;         // time from add_event until a thread takes the event
+  LatencyHistogram handle_metric_;       // time to handle one event
+  CpuTimeCounter cpu_metric_;            // CPU time of the threads handling the events
+  bool metrics_registered_ = false;
 
 };
 
@@ -324,6 +407,18 @@ inline void Stage::push_stage(Stage *st) {
   next_stage_list_.push_back(st);
 }
 
+inline void Stage::set_max_batch(int max_batch) {
+  ASSERT(!connected_, "attempt to set max batch while connected: %s",
+         this->get_name());
+  max_batch_ = std::max(1, std::min(max_batch, MAX_EVENT_BATCH));
+}
+
+inline void Stage::set_run_to_completion(bool run_to_completion) {
+  ASSERT(!connected_, "attempt to set run to completion while connected: %s",
+         this->get_name());
+  run_to_completion_ = run_to_completion;
+}
+
 inline const char *Stage::get_name() { return stage_name_; }
 
 } //namespace common
@@ -22,13 +22,14 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/mutex.h"
 #include "common/log/log.h"
 #include "common/seda/callback.h"
+#include "common/seda/request_trace.h"
 #include "common/time/timeout_info.h"
 namespace common {
 
 // Constructor
 StageEvent::StageEvent()
   : comp_cb_(NULL), ud_(NULL), cb_flag_(false), history_(NULL), stage_hops_(0),
-    tm_info_(NULL) {}
+    tm_info_(NULL), enqueue_us_(0), trace_(NULL), priority_(NORMAL_PRIORITY) {}
 
 // Destructor
 StageEvent::~StageEvent() {
@@ -49,6 +50,8 @@ StageEvent::~StageEvent() {
     tm_info_->detach();
     tm_info_ = NULL;
   }
+
+  delete trace_;
 }
 
 // Processing for this event is done; callbacks executed
@@ -118,6 +121,13 @@ void StageEvent::save_stage(Stage *stg, HistType type) {
   }
 }
 
+void StageEvent::set_trace(RequestTrace *trace) {
+  if (trace_ != trace) {
+    delete trace_;
+    trace_ = trace;
+  }
+}
+
 void StageEvent::set_timeout_info(time_t deadline) {
   TimeoutInfo *tmi = new TimeoutInfo(deadline);
   set_timeout_info(tmi);
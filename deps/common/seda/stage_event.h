@@ -21,12 +21,14 @@ See the Mulan PSL v2 for more details. */
 #include <string>
 
 #include "common/defs.h"
+#include "common/mm/mpool.h"
 namespace common {
 
 class CompletionCallback;
 class UserData;
 class Stage;
 class TimeoutInfo;
+class RequestTrace;
 
 //! An event in a staged event-driven architecture
 /**
@@ -54,14 +56,19 @@ class TimeoutInfo;
  * Calling done_immediate() has the same effect as done(), except that the
  * callbacks are executed on the current stack.
  * </ul>
+ * Events are allocated from the thread cached BlockPool.
  */
 
-class StageEvent {
+class StageEvent : public PooledObject {
 
  public:
   // Interface for collecting debugging information
   typedef enum { HANDLE_EV = 0, CALLBACK_EV, TIMEOUT_EV } HistType;
 
+  // Low priority events of a stage are handled after its normal ones, and the
+  // threads of a pool take stages scheduled for them after all the others
+  typedef enum { NORMAL_PRIORITY = 0, LOW_PRIORITY } Priority;
+
   /**
    *  Constructor
    *  Should not create StageEvents on the stack.  done() assumes that
@@ -123,6 +130,18 @@ class StageEvent {
   // If the event has timed out (and should be dropped)
   bool has_timed_out();
 
+  // When the event was put into the queue of a stage, in us, 0 if not queued
+  u64_t enqueue_time() const { return enqueue_us_; }
+  void set_enqueue_time(u64_t us) { enqueue_us_ = us; }
+
+  Priority priority() const { return priority_; }
+  void set_priority(Priority priority) { priority_ = priority; }
+
+  // Spans of a sampled request, nullptr if the request is not traced.
+  // The event owns the trace and deletes it on destruction.
+  RequestTrace *trace() const { return trace_; }
+  void set_trace(RequestTrace *trace);
+
  private:
   typedef std::pair<Stage *, HistType> HistEntry;
 
@@ -139,6 +158,9 @@ class StageEvent {
   std::list<HistEntry> *history_; // List of stages which have handled ev
   u32_t stage_hops_;               // Number of stages which have handled ev
   TimeoutInfo *tm_info_; // the timeout info for this event
+  u64_t enqueue_us_;      // when the event was queued, for the queue wait metric
+  RequestTrace *trace_;   // spans of the request if it is sampled
+  Priority priority_;
   
 };
 
@@ -16,29 +16,93 @@ See the Mulan PSL v2 for more details. */
 #include "common/seda/thread_pool.h"
 
 #include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sstream>
 
 #include "common/lang/mutex.h"
 #include "common/log/log.h"
+#include "common/metrics/latency_histogram.h"
+#include "common/metrics/metrics_registry.h"
 #include "common/seda/stage.h"
 namespace common {
 
 extern bool &get_event_history_flag();
 
+// deque owned by the current thread, if it is a worker of a work stealing pool
+static thread_local WorkStealingQueue<Stage> *local_queue = NULL;
+// slot of local_queue in workers_
+static thread_local int local_slot = -1;
+// seed to pick the victim to steal from
+static thread_local unsigned int steal_seed = 0;
+
+/**
+ * Busy and idle time of the threads in a pool since the last report.
+ * Idle time is what is left of threads * interval after the busy time.
+ */
+class ThreadpoolMetric : public Metric {
+public:
+  ThreadpoolMetric(Threadpool &pool)
+      : pool_(pool), last_busy_us_(0), last_tick_(LatencyHistogram::now_us()) {}
+  virtual ~ThreadpoolMetric() {
+    delete snapshot_value_;
+    snapshot_value_ = nullptr;
+  }
+
+  void snapshot() {
+    const u64_t now_tick = LatencyHistogram::now_us();
+    const u64_t busy_us = pool_.busy_time();
+    const unsigned int threads = pool_.num_threads();
+    const u64_t busy = busy_us - last_busy_us_;
+    const u64_t capacity = (now_tick - last_tick_) * threads;
+    const u64_t idle = capacity > busy ? capacity - busy : 0;
+    last_busy_us_ = busy_us;
+    last_tick_ = now_tick;
+
+    std::stringstream oss;
+    oss << "threads:" << threads << ",busy_us:" << busy << ",idle_us:" << idle
+        << ",busy:" << (capacity > 0 ? 100.0 * busy / capacity : 0) << "%";
+    std::string value = oss.str();
+    if (snapshot_value_ == nullptr) {
+      snapshot_value_ = new SnapshotBasic<std::string>();
+    }
+    ((SnapshotBasic<std::string> *)snapshot_value_)->setValue(value);
+  }
+
+private:
+  Threadpool &pool_;
+  u64_t last_busy_us_;
+  u64_t last_tick_;
+};
+
 /**
  * Constructor
  * @param[in] threads The number of threads to create.
+ * @param[in] name    Name of the thread pool.
+ * @param[in] work_stealing Give every thread its own deque.
+ * @param[in] cpus    Cpus the threads may run on.
  *
  * @post thread pool has <i>threads</i> threads running
  */
-Threadpool::Threadpool(unsigned int threads, const std::string &name)
-  : run_queue_(), eventhist_(get_event_history_flag()), nthreads_(0),
-    threads_to_kill_(0), n_idles_(0), killer_("KillThreads"), name_(name) {
+Threadpool::Threadpool(unsigned int threads, const std::string &name, bool work_stealing,
+                       const std::vector<int> &cpus)
+  : run_queue_(), low_run_queue_(), low_injected_(0), eventhist_(get_event_history_flag()), nthreads_(0),
+    threads_to_kill_(0), n_idles_(0), min_threads_(threads), max_threads_(threads), killer_("KillThreads"), name_(name), cpus_(cpus),
+    work_stealing_(work_stealing), pending_(0), injected_(0), stealing_idles_(0), nworkers_(0) {
   LOG_TRACE("Enter, thread number:%d", threads);
+  for (int i = 0; i < MAX_STEALING_WORKERS; i++) {
+    workers_[i].store(NULL);
+  }
   MUTEX_INIT(&run_mutex_, NULL);
   COND_INIT(&run_cond_, NULL);
   MUTEX_INIT(&thread_mutex_, NULL);
   COND_INIT(&thread_cond_, NULL);
   add_threads(threads);
+  pool_metric_ = new ThreadpoolMetric(*this);
+  get_metrics_registry().register_metric("seda." + name_ + ".pool", pool_metric_);
   LOG_TRACE("exit");
 }
 
@@ -50,10 +114,18 @@ Threadpool::Threadpool(unsigned int threads, const std::string &name)
  */
 Threadpool::~Threadpool() {
   LOG_TRACE("%s", "enter");
+  get_metrics_registry().unregister("seda." + name_ + ".pool");
+  delete pool_metric_;
+  pool_metric_ = NULL;
+
   // kill all the remaining service threads
   kill_threads(nthreads_);
 
   run_queue_.clear();
+  low_run_queue_.clear();
+  for (int i = 0; i < MAX_STEALING_WORKERS; i++) {
+    delete workers_[i].load();
+  }
   MUTEX_DESTROY(&run_mutex_);
   COND_DESTROY(&run_cond_);
   MUTEX_DESTROY(&thread_mutex_);
@@ -72,6 +144,31 @@ unsigned int Threadpool::num_threads() {
   return result;
 }
 
+void Threadpool::set_thread_limits(unsigned int min_threads, unsigned int max_threads) {
+  min_threads_ = min_threads;
+  max_threads_ = max_threads < min_threads ? min_threads : max_threads;
+}
+
+int Threadpool::backlog() {
+  if (work_stealing_) {
+    return pending_.load() + low_injected_.load();
+  }
+  MUTEX_LOCK(&run_mutex_);
+  int result = (int)(run_queue_.size() + low_run_queue_.size());
+  MUTEX_UNLOCK(&run_mutex_);
+  return result;
+}
+
+unsigned int Threadpool::idle_threads() {
+  if (work_stealing_) {
+    return stealing_idles_.load();
+  }
+  MUTEX_LOCK(&run_mutex_);
+  unsigned int result = n_idles_;
+  MUTEX_UNLOCK(&run_mutex_);
+  return result;
+}
+
 /**
  * Add threads to the pool
  * @param[in] threads Number of threads to add to the pool.
@@ -88,6 +185,18 @@ unsigned int Threadpool::add_threads(unsigned int threads) {
   // create all threads as detached.  We will not try to join them.
   pthread_attr_init(&pthread_attrs);
   pthread_attr_setdetachstate(&pthread_attrs, PTHREAD_CREATE_DETACHED);
+  // the threads float among the cpus, e.g. the cores of one numa node
+  if (!cpus_.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (size_t c = 0; c < cpus_.size(); c++) {
+      CPU_SET(cpus_[c], &cpu_set);
+    }
+    int stat = pthread_attr_setaffinity_np(&pthread_attrs, sizeof(cpu_set), &cpu_set);
+    if (stat != 0) {
+      LOG_WARN("Failed to set cpu affinity of %s, error=%s", name_.c_str(), strerror(stat));
+    }
+  }
 
   MUTEX_LOCK(&thread_mutex_);
 
@@ -157,7 +266,24 @@ unsigned int Threadpool::kill_threads(unsigned int threads) {
  * kill, signals the waiting kill_threads method.
  */
 void Threadpool::thread_kill() {
+  if (work_stealing_ && local_queue != NULL) {
+    // hand over the stages left in the deque of the exiting thread
+    MUTEX_LOCK(&run_mutex_);
+    Stage *stage = NULL;
+    while ((stage = local_queue->pop()) != NULL) {
+      run_queue_.push_back(stage);
+      injected_++;
+    }
+    MUTEX_UNLOCK(&run_mutex_);
+    local_queue = NULL;
+  }
+
   MUTEX_LOCK(&thread_mutex_);
+  if (local_slot >= 0) {
+    // a thread added later takes over the empty deque
+    free_workers_.push_back(local_slot);
+    local_slot = -1;
+  }
 
   nthreads_--;
   threads_to_kill_--;
@@ -202,13 +328,56 @@ unsigned int Threadpool::gen_kill_thread_events(unsigned int to_kill) {
  * Schedule a stage with some work to be done on the run queue.
  *
  * @param[in] stage Reference to stage to be scheduled.
+ * @param[in] low_priority the work is a low priority event, the stage is
+ *            taken only when no other stage of the pool is scheduled.
  *
  * @pre  stage must have a non-empty queue.
  * @post stage is scheduled on the run queue.
  */
-void Threadpool::schedule(Stage *stage) {
+void Threadpool::schedule(Stage *stage, bool low_priority) {
   assert(!stage->qempty());
 
+  if (low_priority) {
+    MUTEX_LOCK(&run_mutex_);
+    if (work_stealing_) {
+      pending_++;
+      low_injected_++;
+    }
+    low_run_queue_.push_back(stage);
+    // an idle thread is waiting only if every queue is empty
+    if (work_stealing_ ? stealing_idles_.load() > 0 : n_idles_ > 0) {
+      COND_SIGNAL(&run_cond_);
+    }
+    MUTEX_UNLOCK(&run_mutex_);
+    return;
+  }
+
+  if (work_stealing_) {
+    bool own = this == get_thread_pool_ptr() && local_queue != NULL;
+    bool was_empty = own && local_queue->size() == 0;
+    pending_++;
+    if (own && local_queue->push(stage)) {
+      // the current thread runs it next if nothing else is waiting
+      if (was_empty) {
+        return;
+      }
+    } else {
+      MUTEX_LOCK(&run_mutex_);
+      run_queue_.push_back(stage);
+      injected_++;
+      MUTEX_UNLOCK(&run_mutex_);
+    }
+    // pending_ is increased before checking the idle threads, and an idle
+    // thread checks pending_ after increasing stealing_idles_ with run_mutex_
+    // held, so the wakeup can not be lost
+    if (stealing_idles_.load() > 0) {
+      MUTEX_LOCK(&run_mutex_);
+      COND_SIGNAL(&run_cond_);
+      MUTEX_UNLOCK(&run_mutex_);
+    }
+    return;
+  }
+
   MUTEX_LOCK(&run_mutex_);
   bool was_empty = run_queue_.empty();
   run_queue_.push_back(stage);
@@ -242,61 +411,264 @@ void *Threadpool::run_thread(void *pool_ptr) {
   LOG_INFO("threadid = %llx, threadname = %s\n", threadid,
            pool->get_name().c_str());
 
+  if (pool->work_stealing_) {
+    pool->run_stealing_thread();
+  }
+
   // enter a loop where we continuously look for events from Stages on
   // the run_queue_ and handle the event.
   while (1) {
     MUTEX_LOCK(&(pool->run_mutex_));
 
     // wait for some stage to be scheduled
-    while (pool->run_queue_.empty()) {
+    while (pool->run_queue_.empty() && pool->low_run_queue_.empty()) {
       (pool->n_idles_)++;
       COND_WAIT(&(pool->run_cond_), &(pool->run_mutex_));
       (pool->n_idles_)--;
     }
 
-    assert(!pool->run_queue_.empty());
-    Stage *run_stage = *(pool->run_queue_.begin());
-    pool->run_queue_.pop_front();
+    // low priority work runs only when nothing else is scheduled
+    std::deque<Stage *> &queue = pool->run_queue_.empty() ? pool->low_run_queue_ : pool->run_queue_;
+    Stage *run_stage = queue.front();
+    queue.pop_front();
     MUTEX_UNLOCK(&(pool->run_mutex_));
 
-    StageEvent *event = run_stage->remove_event();
+    pool->run_stage(run_stage);
+  }
+  LOG_TRACE("exit %p", pool_ptr);
+  LOG_INFO("Begin to exit, threadid = %llx, threadname = %s", threadid,
+           pool->get_name().c_str());
+
+  // the dummy compiler need this
+  pthread_exit(NULL);
+}
 
-    // need to check if this is a rescheduled callback
+/**
+ * Control loop of a service thread in work stealing mode.
+ */
+void Threadpool::run_stealing_thread() {
+  // reuse the deque of a killed thread, so that resizing the pool does not use up the slots
+  int slot = -1;
+  MUTEX_LOCK(&thread_mutex_);
+  if (!free_workers_.empty()) {
+    slot = free_workers_.back();
+    free_workers_.pop_back();
+  }
+  MUTEX_UNLOCK(&thread_mutex_);
+  if (slot >= 0) {
+    local_queue = workers_[slot].load();
+    local_slot = slot;
+  } else {
+    slot = nworkers_++;
+    if (slot < MAX_STEALING_WORKERS) {
+      local_queue = new WorkStealingQueue<Stage>();
+      workers_[slot].store(local_queue);
+      local_slot = slot;
+    } else {
+      LOG_WARN("Too many threads in %s, thread %d only takes stages from the run queue", name_.c_str(), slot);
+    }
+  }
+  steal_seed = (unsigned int)gettid();
+
+  while (1) {
+    Stage *stage = take_stage();
+    if (stage == NULL) {
+      MUTEX_LOCK(&run_mutex_);
+      stealing_idles_++;
+      if (pending_.load() == 0) {
+        COND_WAIT(&run_cond_, &run_mutex_);
+      }
+      stealing_idles_--;
+      MUTEX_UNLOCK(&run_mutex_);
+      continue;
+    }
+
+    pending_--;
+    run_stage(stage);
+  }
+}
+
+/**
+ * Find a scheduled stage in the deque of current thread, the run queue,
+ * the deques of other threads and then the low priority run queue.
+ */
+Stage *Threadpool::take_stage() {
+  Stage *stage = NULL;
+  if (local_queue != NULL) {
+    stage = local_queue->pop();
+    if (stage != NULL) {
+      return stage;
+    }
+  }
+
+  if (injected_.load() > 0) {
+    MUTEX_LOCK(&run_mutex_);
+    if (!run_queue_.empty()) {
+      stage = run_queue_.front();
+      run_queue_.pop_front();
+      injected_--;
+    }
+    MUTEX_UNLOCK(&run_mutex_);
+    if (stage != NULL) {
+      return stage;
+    }
+  }
+
+  int nworkers = nworkers_.load();
+  if (nworkers > MAX_STEALING_WORKERS) {
+    nworkers = MAX_STEALING_WORKERS;
+  }
+  // start from a random victim so that thieves do not line up on the same deque
+  int start = nworkers > 0 ? rand_r(&steal_seed) % nworkers : 0;
+  for (int i = 0; i < nworkers; i++) {
+    WorkStealingQueue<Stage> *victim = workers_[(start + i) % nworkers].load();
+    if (victim == NULL || victim == local_queue) {
+      continue;
+    }
+    stage = victim->steal();
+    if (stage != NULL) {
+      return stage;
+    }
+  }
+
+  if (low_injected_.load() > 0) {
+    MUTEX_LOCK(&run_mutex_);
+    if (!low_run_queue_.empty()) {
+      stage = low_run_queue_.front();
+      low_run_queue_.pop_front();
+      low_injected_--;
+    }
+    MUTEX_UNLOCK(&run_mutex_);
+  }
+  return stage;
+}
+
+/**
+ * Remove one event from the scheduled stage and handle it.
+ */
+void Threadpool::run_stage(Stage *stage) {
+  if (stage->max_batch_ > 1) {
+    run_stage_batch(stage);
+    return;
+  }
+  const u64_t start_us = LatencyHistogram::now_us();
+  // the thread CPU clock is a system call, not in vdso, about as much as a few locks
+  const u64_t start_cpu_ns = CpuTimeCounter::thread_cpu_ns();
+  StageEvent *event = stage->remove_event();
+  if (event->enqueue_time() != 0 && start_us > event->enqueue_time()) {
+    stage->wait_metric_.update(start_us - event->enqueue_time());
+  }
+  CpuTimeCounter::take_current_event();
+  run_event(stage, event);
+  // the event may be queued again (callbacks), or freed
+  const u64_t handle_us = LatencyHistogram::now_us() - start_us;
+  const u64_t cpu_ns = CpuTimeCounter::thread_cpu_ns() - start_cpu_ns;
+  stage->handle_metric_.update(handle_us);
+  stage->cpu_metric_.add(cpu_ns);
+  CpuTimeCounter *charged = CpuTimeCounter::take_current_event();
+  if (charged != NULL) {
+    charged->add(cpu_ns);
+  }
+  busy_us_.add(handle_us);
+  cpu_ns_.add(cpu_ns);
+  stage->release_event();
+}
+
+/**
+ * Remove a batch of events from the scheduled stage and handle them together.
+ */
+void Threadpool::run_stage_batch(Stage *stage) {
+  StageEvent *events[Stage::MAX_EVENT_BATCH];
+  const int n = stage->remove_events(events, stage->max_batch_);
+  if (n == 0) {
+    // an earlier batch took the event of this schedule
+    return;
+  }
+  const u64_t start_us = LatencyHistogram::now_us();
+  const u64_t start_cpu_ns = CpuTimeCounter::thread_cpu_ns();
+  for (int i = 0; i < n; i++) {
+    if (events[i]->enqueue_time() != 0 && start_us > events[i]->enqueue_time()) {
+      stage->wait_metric_.update(start_us - events[i]->enqueue_time());
+    }
+  }
+  CpuTimeCounter::take_current_event();
+
+  // callbacks are done one by one, the others go to handle_events together
+  StageEvent *handled[Stage::MAX_EVENT_BATCH];
+  int handled_num = 0;
+  for (int i = 0; i < n; i++) {
+    StageEvent *event = events[i];
     if (event->is_callback()) {
+      run_event(stage, event);
+      continue;
+    }
 #ifdef ENABLE_STAGE_LEVEL_TIMEOUT
-      // check if the event has timed out.
-      if (event->has_timed_out()) {
-        event->done_timeout();
-      } else {
-        event->done_immediate();
-      }
-#else
-      event->done_immediate();
+    if (event->has_timed_out()) {
+      event->done();
+      continue;
+    }
 #endif
-    } else {
-      if (pool->eventhist_) {
-        event->save_stage(run_stage, StageEvent::HANDLE_EV);
-      }
+    if (eventhist_) {
+      event->save_stage(stage, StageEvent::HANDLE_EV);
+    }
+    handled[handled_num++] = event;
+  }
+  if (handled_num == 1) {
+    stage->handle_event(handled[0]);
+  } else if (handled_num > 1) {
+    stage->handle_events(handled, handled_num);
+  }
+
+  // every event of the batch is charged an equal share
+  const u64_t handle_us = LatencyHistogram::now_us() - start_us;
+  const u64_t cpu_ns = CpuTimeCounter::thread_cpu_ns() - start_cpu_ns;
+  for (int i = 0; i < n; i++) {
+    stage->handle_metric_.update(handle_us / n);
+    stage->cpu_metric_.add(cpu_ns / n);
+  }
+  CpuTimeCounter *charged = CpuTimeCounter::take_current_event();
+  if (charged != NULL) {
+    charged->add(cpu_ns / n);
+  }
+  busy_us_.add(handle_us);
+  cpu_ns_.add(cpu_ns);
+  for (int i = 0; i < n; i++) {
+    stage->release_event();
+  }
+}
 
+/**
+ * Handle an event of the stage on the current thread.
+ */
+void Threadpool::run_event(Stage *stage, StageEvent *event) {
+  // need to check if this is a rescheduled callback
+  if (event->is_callback()) {
 #ifdef ENABLE_STAGE_LEVEL_TIMEOUT
-      // check if the event has timed out
-      if (event->has_timed_out()) {
-        event->done();
-      } else {
-        run_stage->handle_event(event);
-      }
+    // check if the event has timed out.
+    if (event->has_timed_out()) {
+      event->done_timeout();
+    } else {
+      event->done_immediate();
+    }
 #else
-      run_stage->handle_event(event);
+    event->done_immediate();
 #endif
+  } else {
+    if (eventhist_) {
+      event->save_stage(stage, StageEvent::HANDLE_EV);
     }
-    run_stage->release_event();
-  }
-  LOG_TRACE("exit %p", pool_ptr);
-  LOG_INFO("Begin to exit, threadid = %llx, threadname = %s", threadid,
-           pool->get_name().c_str());
 
-  // the dummy compiler need this
-  pthread_exit(NULL);
+#ifdef ENABLE_STAGE_LEVEL_TIMEOUT
+    // check if the event has timed out
+    if (event->has_timed_out()) {
+      event->done();
+    } else {
+      stage->handle_event(event);
+    }
+#else
+    stage->handle_event(event);
+#endif
+  }
 }
 
 pthread_key_t Threadpool::pool_ptr_key_;
@@ -15,13 +15,19 @@ See the Mulan PSL v2 for more details. */
 #ifndef __COMMON_SEDA_THREAD_POOL_H__
 #define __COMMON_SEDA_THREAD_POOL_H__
 
+#include <atomic>
 #include <deque>
+#include <string>
+#include <vector>
 
 #include "common/defs.h"
+#include "common/metrics/striped_counter.h"
 #include "common/seda/kill_thread.h"
+#include "common/seda/work_stealing_queue.h"
 namespace common {
 
 class Stage;
+class Metric;
 
 /**
  * A thread pool for one or more seda stages
@@ -39,6 +45,17 @@ class Stage;
  * creation, the caller provides a parameter indicating the initial number
  * of worker threads, but this number can be adjusted at any time by using
  * the add_threads(), num_threads(), and kill_threads() interfaces.
+ * <p>
+ * In work stealing mode every worker thread also owns a lock-free deque.
+ * A stage scheduled by a worker of the same pool goes to that worker's
+ * deque, so a request usually keeps running on the thread that has its
+ * data in cache and the shared run queue lock is not touched. Stages
+ * scheduled from outside the pool go to the shared run queue. An idle
+ * worker takes from its own deque, then the shared run queue, then
+ * steals the oldest stage from another worker's deque.
+ * <p>
+ * With thread limits set, ThreadpoolAutoscaler adds and kills threads
+ * between min_threads() and max_threads() by the backlog of the pool.
  */
 class Threadpool {
 
@@ -53,10 +70,14 @@ class Threadpool {
    * Constructor
    * @param[in] threads The number of threads to create.
    * @param[in] name    Name of the thread pool.
+   * @param[in] work_stealing Give every thread its own deque and let idle
+   *                          threads steal from the others.
+   * @param[in] cpus    Cpus the threads may run on, empty means all of them.
    *
    * @post thread pool has <i>threads</i> threads running
    */
-  Threadpool(unsigned int threads, const std::string &name = std::string());
+  Threadpool(unsigned int threads, const std::string &name = std::string(), bool work_stealing = false,
+             const std::vector<int> &cpus = std::vector<int>());
 
   /**
    * Destructor
@@ -100,15 +121,58 @@ class Threadpool {
    * Schedule a stage with some work to be done on the run queue.
    *
    * @param[in] stage Reference to stage to be scheduled.
+   * @param[in] low_priority the work is a low priority event, the stage is
+   *            taken only when no other stage of the pool is scheduled.
    *
    * @pre  stage must have a non-empty queue.
    * @post stage is scheduled on the run queue.
    */
-  void schedule(Stage *stage);
+  void schedule(Stage *stage, bool low_priority = false);
 
   // Get name of thread pool
   const std::string &get_name();
 
+  /**
+   * Handle an event of the stage on the current thread
+   * Used by stages in run-to-completion mode, the event is not queued.
+   */
+  void run_event(Stage *stage, StageEvent *event);
+
+  // Is the current thread a service thread of this pool?
+  bool in_pool() const { return this == get_thread_pool_ptr(); }
+
+  // Is work stealing enabled?
+  bool work_stealing() const { return work_stealing_; }
+
+  // Cpus the threads may run on, empty means all of them
+  const std::vector<int> &cpus() const { return cpus_; }
+
+  // Max worker threads that own a deque, later threads only use the run queue
+  static const int MAX_STEALING_WORKERS = 64;
+
+  // Total time the threads spent on handling events, in us
+  u64_t busy_time() const { return busy_us_.sum(); }
+
+  // Total CPU time of the threads spent on handling events, in us. The rest
+  // of the busy time is spent blocked on I/O, locks or the scheduler
+  u64_t cpu_time() const { return cpu_ns_.sum() / 1000; }
+
+  /**
+   * Bounds of the number of threads for ThreadpoolAutoscaler. Both are the
+   * initial number of threads by default, then the pool is not resized.
+   */
+  void set_thread_limits(unsigned int min_threads, unsigned int max_threads);
+  unsigned int min_threads() const { return min_threads_; }
+  unsigned int max_threads() const { return max_threads_; }
+  bool autoscaled() const { return max_threads_ > min_threads_; }
+
+  // Number of scheduled stages no thread has taken yet, about the number of
+  // queued events of the stages in the pool
+  int backlog();
+
+  // Number of threads waiting for a stage to be scheduled
+  unsigned int idle_threads();
+
 
  protected:
   /**
@@ -138,6 +202,18 @@ class Threadpool {
    */
   static void *run_thread(void *pool_ptr);
 
+  // Control loop of a service thread in work stealing mode
+  void run_stealing_thread();
+
+  // Find a scheduled stage for the current thread in work stealing mode,
+  // returns NULL if there is none
+  Stage *take_stage();
+
+  // Remove one event of the scheduled stage and handle it
+  void run_stage(Stage *stage);
+  // Remove a batch of events of the scheduled stage and handle them together
+  void run_stage_batch(Stage *stage);
+
   // Save the thread pool pointer for this thread
   static void set_thread_pool_ptr(const Threadpool *thd_pool);
 
@@ -148,6 +224,8 @@ class Threadpool {
   pthread_mutex_t run_mutex_;     //< protects the run queue
   pthread_cond_t run_cond_;       //< wait here for stage to be scheduled
   std::deque<Stage *> run_queue_; //< list of stages with work to do
+  std::deque<Stage *> low_run_queue_; //< stages with low priority work to do
+  std::atomic<int> low_injected_;     //< stages in the low run queue
   bool eventhist_;               //< is event history enabled?
 
   // thread state
@@ -156,8 +234,25 @@ class Threadpool {
   unsigned int nthreads_;       //< number of service threads
   unsigned int threads_to_kill_;  //< number of pending kill events
   unsigned int n_idles_;         //< number of idle threads
+  unsigned int min_threads_;     //< lower bound of nthreads_ for the autoscaler
+  unsigned int max_threads_;     //< upper bound of nthreads_ for the autoscaler
   KillThreadStage killer_;      //< used to kill threads
   std::string name_;            //< name of threadpool
+  std::vector<int> cpus_;       //< cpu affinity of the threads
+
+  // work stealing state
+  bool work_stealing_;                     //< is work stealing enabled?
+  std::atomic<int> pending_;               //< stages in the run queues and all deques
+  std::atomic<int> injected_;              //< stages in the run queue
+  std::atomic<int> stealing_idles_;        //< number of threads waiting on run_cond_
+  std::atomic<int> nworkers_;              //< number of deque slots claimed
+  std::atomic<WorkStealingQueue<Stage> *> workers_[MAX_STEALING_WORKERS]; //< deques of the threads
+  std::vector<int> free_workers_;          //< deque slots of killed threads, protected by thread_mutex_
+
+  // metrics
+  StripedCounter busy_us_;      //< time spent on handling events
+  StripedCounter cpu_ns_;       //< CPU time spent on handling events
+  Metric *pool_metric_;         //< busy and idle time, registered as "seda.<name>.pool"
 
   // key of thread specific to store thread pool pointer
   static pthread_key_t pool_ptr_key_;
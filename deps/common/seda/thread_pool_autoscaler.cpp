@@ -0,0 +1,179 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Resize thread pools by their backlog.
+//
+
+#include "common/seda/thread_pool_autoscaler.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "common/log/log.h"
+#include "common/metrics/latency_histogram.h"
+#include "common/os/os.h"
+#include "common/seda/thread_pool.h"
+
+namespace common {
+
+ThreadpoolAutoscaler::ThreadpoolAutoscaler()
+    : cpus_(getCpuNum()), interval_ms_(AUTOSCALE_INTERVAL_MS), running_(false) {
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_condattr_t condattr;
+  pthread_condattr_init(&condattr);
+  pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+  pthread_cond_init(&cond_, &condattr);
+  pthread_condattr_destroy(&condattr);
+}
+
+ThreadpoolAutoscaler::~ThreadpoolAutoscaler() {
+  stop();
+  pthread_mutex_destroy(&mutex_);
+  pthread_cond_destroy(&cond_);
+}
+
+int ThreadpoolAutoscaler::decide(const Sample &sample, int &underused_rounds) {
+  if (sample.threads < sample.min_threads) {
+    underused_rounds = 0;
+    return sample.min_threads - sample.threads;
+  }
+  if (sample.threads > sample.max_threads) {
+    underused_rounds = 0;
+    return -(int)(sample.threads - sample.max_threads);
+  }
+
+  if (sample.backlog > 0 && sample.idle_threads == 0) {
+    underused_rounds = 0;
+    if (sample.threads >= sample.max_threads) {
+      return 0;
+    }
+    // no event finished in the interval: every thread is stuck in a long event, e.g. a blocking
+    // call, and the queued ones starve unless threads are added
+    const u64_t blocked_us = sample.busy_us > sample.cpu_us ? sample.busy_us - sample.cpu_us : 0;
+    const bool io_bound = blocked_us >= sample.busy_us * AUTOSCALE_BLOCKED_RATIO;
+    if (sample.threads >= sample.cpus && !io_bound) {
+      return 0;
+    }
+    // at most double the threads at a time
+    unsigned int grow = std::min((unsigned int)sample.backlog, sample.threads);
+    grow = std::min(std::max(grow, 1u), sample.max_threads - sample.threads);
+    if (!io_bound && sample.threads < sample.cpus) {
+      grow = std::min(grow, sample.cpus - sample.threads);
+    }
+    return grow;
+  }
+
+  // one thread fewer would still be busy less than half of the time
+  const bool underused = sample.backlog == 0 && sample.idle_threads > 0 && sample.threads > sample.min_threads &&
+                         sample.busy_us * 2 < (sample.threads - 1) * sample.interval_us;
+  if (!underused) {
+    underused_rounds = 0;
+    return 0;
+  }
+  if (++underused_rounds < AUTOSCALE_SHRINK_ROUNDS) {
+    return 0;
+  }
+  underused_rounds = 0;
+  return -1;
+}
+
+void ThreadpoolAutoscaler::add_pool(Threadpool *pool) {
+  if (!pool->autoscaled()) {
+    return;
+  }
+  pools_.push_back(PoolState{pool, LatencyHistogram::now_us(), pool->busy_time(), pool->cpu_time(), 0});
+}
+
+bool ThreadpoolAutoscaler::start(unsigned int interval_ms) {
+  if (pools_.empty() || running_) {
+    return true;
+  }
+  interval_ms_ = interval_ms > 0 ? interval_ms : AUTOSCALE_INTERVAL_MS;
+  running_ = true;
+  int ret = pthread_create(&thread_, NULL, ThreadpoolAutoscaler::run, this);
+  if (ret != 0) {
+    LOG_ERROR("Failed to create thread pool autoscaler thread. error=%s", strerror(ret));
+    running_ = false;
+    return false;
+  }
+  LOG_INFO("Resize %d thread pool(s) every %u ms", (int)pools_.size(), interval_ms_);
+  return true;
+}
+
+void ThreadpoolAutoscaler::stop() {
+  pthread_mutex_lock(&mutex_);
+  if (!running_) {
+    pthread_mutex_unlock(&mutex_);
+    return;
+  }
+  running_ = false;
+  pthread_cond_signal(&cond_);
+  pthread_mutex_unlock(&mutex_);
+  pthread_join(thread_, NULL);
+}
+
+void ThreadpoolAutoscaler::check() {
+  for (PoolState &state : pools_) {
+    Threadpool *pool = state.pool;
+    const u64_t now = LatencyHistogram::now_us();
+    const u64_t busy_us = pool->busy_time();
+    const u64_t cpu_us = pool->cpu_time();
+    Sample sample;
+    sample.threads = pool->num_threads();
+    sample.min_threads = pool->min_threads();
+    sample.max_threads = pool->max_threads();
+    sample.cpus = cpus_;
+    sample.backlog = pool->backlog();
+    sample.idle_threads = pool->idle_threads();
+    sample.interval_us = now - state.last_tick_us;
+    sample.busy_us = busy_us - state.last_busy_us;
+    sample.cpu_us = cpu_us - state.last_cpu_us;
+    state.last_tick_us = now;
+    state.last_busy_us = busy_us;
+    state.last_cpu_us = cpu_us;
+
+    const int delta = decide(sample, state.underused_rounds);
+    if (delta > 0) {
+      const unsigned int added = pool->add_threads(delta);
+      LOG_INFO("Add %u thread(s) to %s, threads=%u, backlog=%d", added, pool->get_name().c_str(),
+               sample.threads + added, sample.backlog);
+    } else if (delta < 0) {
+      // the kill event is handled by an idle thread of the pool soon
+      const unsigned int killed = pool->kill_threads(-delta);
+      LOG_INFO("Kill %u thread(s) of %s, threads=%u", killed, pool->get_name().c_str(), sample.threads - killed);
+    }
+  }
+}
+
+void *ThreadpoolAutoscaler::run(void *arg) {
+  ThreadpoolAutoscaler *autoscaler = (ThreadpoolAutoscaler *)arg;
+  pthread_mutex_lock(&autoscaler->mutex_);
+  while (autoscaler->running_) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    const u64_t nsec = deadline.tv_nsec + (u64_t)autoscaler->interval_ms_ % 1000 * 1000000;
+    deadline.tv_sec += autoscaler->interval_ms_ / 1000 + nsec / 1000000000;
+    deadline.tv_nsec = nsec % 1000000000;
+    pthread_cond_timedwait(&autoscaler->cond_, &autoscaler->mutex_, &deadline);
+    if (!autoscaler->running_) {
+      break;
+    }
+    pthread_mutex_unlock(&autoscaler->mutex_);
+    autoscaler->check();
+    pthread_mutex_lock(&autoscaler->mutex_);
+  }
+  pthread_mutex_unlock(&autoscaler->mutex_);
+  return NULL;
+}
+
+}  // namespace common
@@ -0,0 +1,106 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Resize thread pools by their backlog.
+//
+
+#ifndef __COMMON_SEDA_THREAD_POOL_AUTOSCALER_H__
+#define __COMMON_SEDA_THREAD_POOL_AUTOSCALER_H__
+
+#include <pthread.h>
+
+#include <vector>
+
+#include "common/defs.h"
+
+namespace common {
+
+class Threadpool;
+
+#define AUTOSCALE_INTERVAL_MS 1000   // default interval between two checks
+#define AUTOSCALE_SHRINK_ROUNDS 10   // checks a pool stays underused before a thread is killed
+#define AUTOSCALE_BLOCKED_RATIO 0.5  // busy time blocked on I/O above which a pool grows past the cpus
+
+/**
+ * Grows and shrinks the thread pools with thread limits between
+ * min_threads() and max_threads(), checked every interval in a background thread.
+ * A pool grows when stages are waiting for a thread while no thread is idle,
+ * beyond the number of cpus only if its threads spend much of their busy
+ * time blocked on I/O or locks, or finish no event at all, since more threads
+ * would not run a CPU bound pool faster. A pool shrinks by one thread after it stays underused for
+ * AUTOSCALE_SHRINK_ROUNDS checks, so a short lull does not kill threads that
+ * are needed again soon.
+ */
+class ThreadpoolAutoscaler {
+public:
+  /**
+   * What a pool did in one interval
+   */
+  struct Sample {
+    unsigned int threads;
+    unsigned int min_threads;
+    unsigned int max_threads;
+    unsigned int cpus;
+    int backlog;                // scheduled stages not taken by a thread
+    unsigned int idle_threads;
+    u64_t interval_us;
+    u64_t busy_us;              // time the threads spent handling events in the interval
+    u64_t cpu_us;               // CPU time of it
+  };
+
+  ThreadpoolAutoscaler();
+  ~ThreadpoolAutoscaler();
+
+  /**
+   * Threads to add (> 0) or kill (< 0). underused_rounds is the state of the
+   * pool kept between the checks, 0 at first.
+   */
+  static int decide(const Sample &sample, int &underused_rounds);
+
+  /**
+   * Only pools with autoscaled() are resized. Add the pools before start
+   */
+  void add_pool(Threadpool *pool);
+  bool empty() const { return pools_.empty(); }
+  // Forget the pools, e.g. before they are deleted. Call stop first
+  void clear() { pools_.clear(); }
+
+  bool start(unsigned int interval_ms = AUTOSCALE_INTERVAL_MS);
+  void stop();
+
+  /**
+   * Check and resize every pool once, called by the background thread
+   */
+  void check();
+
+private:
+  struct PoolState {
+    Threadpool *pool;
+    u64_t last_tick_us;
+    u64_t last_busy_us;
+    u64_t last_cpu_us;
+    int underused_rounds;
+  };
+
+  static void *run(void *arg);
+
+private:
+  std::vector<PoolState> pools_;
+  unsigned int cpus_;
+  unsigned int interval_ms_;
+  bool running_;
+  pthread_t thread_;
+  pthread_mutex_t mutex_;  // protects running_
+  pthread_cond_t cond_;    // signaled to stop the thread
+};
+
+}  // namespace common
+#endif  // __COMMON_SEDA_THREAD_POOL_AUTOSCALER_H__
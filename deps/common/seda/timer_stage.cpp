@@ -18,6 +18,7 @@ See the Mulan PSL v2 for more details. */
 #include <time.h>
 
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <typeinfo>
@@ -198,8 +199,8 @@ void TimerCancelEvent::set_success(bool s) {
 bool TimerCancelEvent::get_success() { return cancelled_; }
 
 TimerStage::TimerStage(const char *tag)
-  : Stage(tag), timer_queue_(&TimerStage::timer_token_less_than), shutdown_(false),
-    num_events_(0), timer_thread_id_(0) {
+  : Stage(tag), timer_wheel_(now_tick()), next_wakeup_tick_(std::numeric_limits<u64_t>::max()),
+    shutdown_(false), num_events_(0), timer_thread_id_(0) {
   pthread_mutex_init(&timer_mutex_, NULL);
   pthread_condattr_t condattr;
   pthread_condattr_init(&condattr);
@@ -212,9 +213,10 @@ TimerStage::TimerStage(const char *tag)
 }
 
 TimerStage::~TimerStage() {
-  for (timer_queue_t::iterator i = timer_queue_.begin(); i != timer_queue_.end();
-       ++i) {
-    delete i->second;
+  std::vector<StageEvent *> events;
+  timer_wheel_.clear(events);
+  for (StageEvent *event : events) {
+    delete event;
   }
 
   num_events_ = 0;
@@ -308,17 +310,17 @@ void TimerStage::register_timer(TimerRegisterEvent &reg_ev) {
   bool check_timer = false;
   pthread_mutex_lock(&timer_mutex_);
 
-  // add the event to the timer queue
+  // add the event to the timer wheel
   StageEvent *timer_cb = reg_ev.adopt_callback_event();
-  std::pair<timer_queue_t::iterator, bool> result =
-    timer_queue_.insert(std::make_pair(tt, timer_cb));
-  ASSERT(result.second,
+  const u64_t tick = expire_tick(tt.get_time());
+  bool result = timer_wheel_.add(tt.get_nonce(), tick, timer_cb);
+  ASSERT(result,
          "Internal error--"
          "failed to register timer because token is not unique.");
   ++num_events_;
 
-  // if event was added to the head of queue, schedule a timer check
-  if (result.first == timer_queue_.begin())
+  // if event expires before the timer thread wakes up, schedule a timer check
+  if (tick < next_wakeup_tick_)
     check_timer = true;
 
   pthread_mutex_unlock(&timer_mutex_);
@@ -335,14 +337,13 @@ void TimerStage::register_timer(TimerRegisterEvent &reg_ev) {
 void TimerStage::cancel_timer(TimerCancelEvent &cancel_ev) {
   pthread_mutex_lock(&timer_mutex_);
   bool success = false;
-  timer_queue_t::iterator it = timer_queue_.find(cancel_ev.get_token());
-  if (it != timer_queue_.end()) {
+  StageEvent *timer_cb = timer_wheel_.remove(cancel_ev.get_token().get_nonce());
+  if (timer_cb != NULL) {
     success = true;
 
     // delete the canceled timer event
-    delete it->second;
+    delete timer_cb;
 
-    timer_queue_.erase(it);
     --num_events_;
   }
   pthread_mutex_unlock(&timer_mutex_);
@@ -376,39 +377,28 @@ void *TimerStage::start_timer_thread(void *arg) {
 void TimerStage::check_timer() {
   pthread_mutex_lock(&timer_mutex_);
 
+  std::vector<StageEvent *> done_events;
   while (true) {
-    struct timespec ts_now;
-    clock_gettime(CLOCK_MONOTONIC, &ts_now);
-
-    struct timeval now;
-    now.tv_sec = ts_now.tv_sec;
-    now.tv_usec = ts_now.tv_nsec / NSEC_PER_USEC;
-
-    LOG_TRACE("checking timer: sec=%ld, usec=%ld\n", now.tv_sec, now.tv_usec);
+    const u64_t now = now_tick();
+    LOG_TRACE("checking timer: tick=%llu\n", now);
 
     // Trigger all events for which the trigger time has already passed.
-    timer_queue_t::iterator first = timer_queue_.begin();
-    timer_queue_t::iterator last;
-    std::list < StageEvent * > done_events;
-    for (last = first; last != timer_queue_.end(); ++last) {
-      if (TIMEVAL_LESS_THAN(now, last->first.get_time()))
-        break;
-      done_events.push_back(last->second);
-    }
-    timer_queue_.erase(first, last);
+    timer_wheel_.advance(now, done_events);
     if (!done_events.empty()) {
-      // It is ok to hold the mutex while executing this loop.
-      // Triggering the events only enqueues the event on the
-      // caller's queue--it does not perform any real work.
-      for (std::list<StageEvent *>::iterator i = done_events.begin();
-           i != done_events.end(); ++i) {
-        LOG_TRACE("triggering timer event: sec=%ld, usec=%ld, typeid=%s\n",
-                  now.tv_sec, now.tv_usec, typeid(**i).name());
-        (*i)->done();
-        --num_events_;
+      num_events_ -= done_events.size();
+      next_wakeup_tick_ = now;
+
+      // Triggering an event may run the callback stage inline, which
+      // can register another timer, so it is done without the mutex.
+      pthread_mutex_unlock(&timer_mutex_);
+      for (StageEvent *event : done_events) {
+        LOG_TRACE("triggering timer event: tick=%llu, typeid=%s\n",
+                  now, typeid(*event).name());
+        event->done();
       }
+      done_events.clear();
+      pthread_mutex_lock(&timer_mutex_);
     }
-    done_events.clear();
 
     // Check if the 'shutdown' signal has been received.  The
     // stage must not release the mutex between this check and the
@@ -419,19 +409,22 @@ void TimerStage::check_timer() {
     }
 
     // Sleep until the next service interval.
-    first = timer_queue_.begin();
-    if (first == timer_queue_.end()) {
+    u64_t next_tick = 0;
+    if (!timer_wheel_.next_tick(next_tick)) {
       // If no timer events are registered, sleep indefinately.
       // (When new events are registered, the condition variable
       // will be signalled to allow service to resume.)
       LOG_TRACE("sleeping indefinately\n");
+      next_wakeup_tick_ = std::numeric_limits<u64_t>::max();
       pthread_cond_wait(&timer_condv_, &timer_mutex_);
     } else {
       // If timer events are registered, sleep until the first
       // event should be triggered.
+      next_wakeup_tick_ = next_tick;
+      const u64_t usec = next_tick * TIMER_WHEEL_TICK_USEC;
       struct timespec ts;
-      ts.tv_sec = first->first.get_time().tv_sec;
-      ts.tv_nsec = first->first.get_time().tv_usec * NSEC_PER_USEC;
+      ts.tv_sec = usec / USEC_PER_SEC;
+      ts.tv_nsec = (usec % USEC_PER_SEC) * NSEC_PER_USEC;
 
       LOG_TRACE("sleeping until next deadline: sec=%ld, nsec=%ld\n", ts.tv_sec,
                 ts.tv_nsec);
@@ -444,6 +437,22 @@ void TimerStage::check_timer() {
   return;
 }
 
+u64_t TimerStage::now_tick() {
+  struct timespec ts_now;
+  clock_gettime(CLOCK_MONOTONIC, &ts_now);
+  const u64_t usec = (u64_t)ts_now.tv_sec * USEC_PER_SEC + ts_now.tv_nsec / NSEC_PER_USEC;
+  return usec / TIMER_WHEEL_TICK_USEC;
+}
+
+u64_t TimerStage::expire_tick(const struct timeval &t) {
+  if (t.tv_sec < 0) {
+    return 0;
+  }
+  // round up, the event must not be triggered before the requested time
+  const u64_t usec = (u64_t)t.tv_sec * USEC_PER_SEC + t.tv_usec;
+  return (usec + TIMER_WHEEL_TICK_USEC - 1) / TIMER_WHEEL_TICK_USEC;
+}
+
 bool TimerStage::timer_token_less_than(const TimerToken &tt1,
                                     const TimerToken &tt2) {
   return (tt1 < tt2);
@@ -23,11 +23,13 @@ See the Mulan PSL v2 for more details. */
 #include "common/seda/callback.h"
 #include "common/seda/stage.h"
 #include "common/seda/stage_event.h"
+#include "common/seda/timing_wheel.h"
 namespace common {
 
 #define NSEC_PER_SEC 1000000000
 #define USEC_PER_SEC 1000000
 #define NSEC_PER_USEC 1000
+#define TIMER_WHEEL_TICK_USEC 1000  // resolution of the timer wheel
 
 /**
  *  \author longda
@@ -270,7 +272,9 @@ class TimerCancelEvent : public TimerEvent {
  *  of the event triggering will depend on the load on the system.
  *
  *  Implementation note: The \c TimerStage creates an internal thread
- *  to maintain the timer.
+ *  to maintain the timer.  Timers are kept in a hierarchical timing
+ *  wheel with a tick of \c TIMER_WHEEL_TICK_USEC, so registering and
+ *  cancelling are O(1) and a timer fires at most one tick late.
  */
 class TimerStage : public Stage {
  public:
@@ -291,7 +295,7 @@ class TimerStage : public Stage {
   void callback_event(StageEvent *event, CallbackContext *context);
   void disconnect_prepare();
 
-  // For ordering the keys in the timer_queue_.
+  // For ordering the timer tokens.
   static bool timer_token_less_than(const TimerToken &tt1, const TimerToken &tt2);
 
  private:
@@ -301,12 +305,14 @@ class TimerStage : public Stage {
   void trigger_timer_check();
   void check_timer();
 
+  // ticks of the timer wheel from monotonic time
+  static u64_t now_tick();
+  static u64_t expire_tick(const struct timeval &t);
+
   static void *start_timer_thread(void *arg);
 
-  typedef std::map<TimerToken, StageEvent *,
-                   bool (*)(const TimerToken &, const TimerToken &)>
-    timer_queue_t;
-  timer_queue_t timer_queue_;
+  TimingWheel timer_wheel_;  // registered events, keyed by the token nonce
+  u64_t next_wakeup_tick_;   // when the timer thread wakes up, if it is sleeping
 
   pthread_mutex_t timer_mutex_;
   pthread_cond_t timer_condv_;
@@ -0,0 +1,199 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Hierarchical timing wheel used by the timer stage.
+//
+
+#include "common/seda/timing_wheel.h"
+
+#include <string.h>
+
+namespace common {
+
+// ticks covered by one slot of the level
+static inline u64_t level_span(int level) {
+  return (u64_t)1 << (TIMING_WHEEL_SLOT_BITS * level);
+}
+
+static inline int slot_of(u64_t tick, int level) {
+  return (int)((tick >> (TIMING_WHEEL_SLOT_BITS * level)) & (TIMING_WHEEL_SLOTS - 1));
+}
+
+TimingWheel::TimingWheel(u64_t now_tick) : current_(now_tick) {
+  memset(slots_, 0, sizeof(slots_));
+  memset(level_counts_, 0, sizeof(level_counts_));
+}
+
+TimingWheel::~TimingWheel() {
+  for (auto &entry : nodes_) {
+    delete entry.second;
+  }
+}
+
+bool TimingWheel::add(u64_t id, u64_t expire_tick, StageEvent *event) {
+  if (nodes_.find(id) != nodes_.end()) {
+    return false;
+  }
+  Node *node = new Node();
+  node->id = id;
+  node->expire = expire_tick;
+  node->event = event;
+  nodes_[id] = node;
+  place(node);
+  return true;
+}
+
+StageEvent *TimingWheel::remove(u64_t id) {
+  auto it = nodes_.find(id);
+  if (it == nodes_.end()) {
+    return NULL;
+  }
+  Node *node = it->second;
+  nodes_.erase(it);
+  unlink(node);
+  StageEvent *event = node->event;
+  delete node;
+  return event;
+}
+
+void TimingWheel::place(Node *node) {
+  const u64_t expire = node->expire < current_ ? current_ : node->expire;
+  const u64_t delta = expire - current_;
+  int level = 0;
+  while (level < TIMING_WHEEL_LEVELS - 1 && delta >= level_span(level + 1)) {
+    level++;
+  }
+  int slot = 0;
+  if (delta >= level_span(TIMING_WHEEL_LEVELS)) {
+    // out of range, wait in the farthest slot and be placed again later
+    slot = slot_of(current_ + level_span(TIMING_WHEEL_LEVELS) - 1, level);
+  } else {
+    slot = slot_of(expire, level);
+  }
+
+  node->level = level;
+  node->slot = slot;
+  node->prev = NULL;
+  node->next = slots_[level][slot];
+  if (node->next != NULL) {
+    node->next->prev = node;
+  }
+  slots_[level][slot] = node;
+  level_counts_[level]++;
+}
+
+void TimingWheel::unlink(Node *node) {
+  if (node->prev != NULL) {
+    node->prev->next = node->next;
+  } else {
+    slots_[node->level][node->slot] = node->next;
+  }
+  if (node->next != NULL) {
+    node->next->prev = node->prev;
+  }
+  level_counts_[node->level]--;
+}
+
+void TimingWheel::cascade(int level, int slot) {
+  Node *node = slots_[level][slot];
+  slots_[level][slot] = NULL;
+  while (node != NULL) {
+    Node *next = node->next;
+    level_counts_[level]--;
+    place(node);
+    node = next;
+  }
+}
+
+void TimingWheel::advance(u64_t now_tick, std::vector<StageEvent *> &expired) {
+  while (current_ <= now_tick) {
+    // skip to the next cascade point of the first non-empty level
+    int first_level = 0;
+    while (first_level < TIMING_WHEEL_LEVELS && level_counts_[first_level] == 0) {
+      first_level++;
+    }
+    if (first_level == TIMING_WHEEL_LEVELS) {
+      current_ = now_tick + 1;
+      break;
+    }
+    if (first_level > 0) {
+      const u64_t span = level_span(first_level);
+      const u64_t next = (current_ + span - 1) / span * span;
+      if (next > now_tick) {
+        current_ = now_tick + 1;
+        break;
+      }
+      current_ = next;
+    }
+
+    // move the entries of higher levels down when the lower level wraps around
+    for (int level = 1; level < TIMING_WHEEL_LEVELS; level++) {
+      if (slot_of(current_, level - 1) != 0) {
+        break;
+      }
+      cascade(level, slot_of(current_, level));
+    }
+
+    const int slot = slot_of(current_, 0);
+    Node *node = slots_[0][slot];
+    slots_[0][slot] = NULL;
+    while (node != NULL) {
+      Node *next = node->next;
+      level_counts_[0]--;
+      nodes_.erase(node->id);
+      expired.push_back(node->event);
+      delete node;
+      node = next;
+    }
+    current_++;
+  }
+}
+
+bool TimingWheel::next_tick(u64_t &tick) const {
+  if (nodes_.empty()) {
+    return false;
+  }
+  tick = (u64_t)-1;
+  if (level_counts_[0] > 0) {
+    for (u64_t i = 0; i < TIMING_WHEEL_SLOTS; i++) {
+      if (slots_[0][slot_of(current_ + i, 0)] != NULL) {
+        tick = current_ + i;
+        break;
+      }
+    }
+  }
+  // entries of higher levels may expire earlier than the first level ones
+  // once they are cascaded, so wake up at the next cascade point too
+  int level = 1;
+  while (level < TIMING_WHEEL_LEVELS && level_counts_[level] == 0) {
+    level++;
+  }
+  if (level < TIMING_WHEEL_LEVELS) {
+    const u64_t span = level_span(level);
+    const u64_t cascade_tick = (current_ + span - 1) / span * span;
+    if (cascade_tick < tick) {
+      tick = cascade_tick;
+    }
+  }
+  return true;
+}
+
+void TimingWheel::clear(std::vector<StageEvent *> &events) {
+  for (auto &entry : nodes_) {
+    events.push_back(entry.second->event);
+    delete entry.second;
+  }
+  nodes_.clear();
+  memset(slots_, 0, sizeof(slots_));
+  memset(level_counts_, 0, sizeof(level_counts_));
+}
+
+}  // namespace common
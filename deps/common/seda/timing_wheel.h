@@ -0,0 +1,108 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Hierarchical timing wheel used by the timer stage.
+//
+
+#ifndef __COMMON_SEDA_TIMING_WHEEL_H__
+#define __COMMON_SEDA_TIMING_WHEEL_H__
+
+#include <unordered_map>
+#include <vector>
+
+#include "common/defs.h"
+namespace common {
+
+class StageEvent;
+
+#define TIMING_WHEEL_LEVELS 4
+#define TIMING_WHEEL_SLOT_BITS 8
+#define TIMING_WHEEL_SLOTS (1 << TIMING_WHEEL_SLOT_BITS)
+
+/**
+ * A hierarchical timing wheel of events.
+ * Time is counted in ticks. The first level has one slot for each of the
+ * next TIMING_WHEEL_SLOTS ticks, every higher level has slots covering
+ * TIMING_WHEEL_SLOTS times longer, so 4 levels of 256 slots cover 2^32
+ * ticks. When the first level wraps around, the entries of the next slot
+ * of the level above are moved down (cascaded). An entry expiring beyond
+ * the range waits in the last level and is placed again on each cascade.
+ * <p>
+ * add() and remove() are O(1): slots are intrusive doubly linked lists
+ * and entries are found by id through a hash map. advance() collects all
+ * the entries expired up to the given tick in one call, and skips the
+ * ticks of empty levels instead of visiting them one by one.
+ * The class is not thread safe.
+ */
+class TimingWheel {
+ public:
+  /**
+   * @param[in] now_tick the first tick to process
+   */
+  explicit TimingWheel(u64_t now_tick);
+  ~TimingWheel();
+
+  /**
+   * Add an event expiring at the tick. An expire tick already passed
+   * fires on the next advance().
+   * @return false if the id is registered already
+   */
+  bool add(u64_t id, u64_t expire_tick, StageEvent *event);
+
+  /**
+   * Remove the event with the id
+   * @return the event, or NULL if there is no such id
+   */
+  StageEvent *remove(u64_t id);
+
+  /**
+   * Process all the ticks up to now_tick, and append the events expired
+   * to expired, in the order of their expire ticks.
+   */
+  void advance(u64_t now_tick, std::vector<StageEvent *> &expired);
+
+  /**
+   * Get the tick when advance() should be called next, it is the expire
+   * tick of the first event, or earlier when events of a higher level have
+   * to be cascaded first.
+   * @return false if the wheel is empty
+   */
+  bool next_tick(u64_t &tick) const;
+
+  // Remove all the events and append them to events
+  void clear(std::vector<StageEvent *> &events);
+
+  size_t size() const { return nodes_.size(); }
+  u64_t current_tick() const { return current_; }
+
+ private:
+  struct Node {
+    u64_t id;
+    u64_t expire;
+    StageEvent *event;
+    Node *prev;
+    Node *next;
+    int level;
+    int slot;
+  };
+
+  void place(Node *node);
+  void unlink(Node *node);
+  void cascade(int level, int slot);
+
+  Node *slots_[TIMING_WHEEL_LEVELS][TIMING_WHEEL_SLOTS];
+  size_t level_counts_[TIMING_WHEEL_LEVELS];
+  std::unordered_map<u64_t, Node *> nodes_;
+  u64_t current_;  // the next tick to process
+};
+
+}  // namespace common
+#endif  // __COMMON_SEDA_TIMING_WHEEL_H__
@@ -0,0 +1,118 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Bounded lock-free work-stealing deque used by the thread pool.
+//
+
+#ifndef __COMMON_SEDA_WORK_STEALING_QUEUE_H__
+#define __COMMON_SEDA_WORK_STEALING_QUEUE_H__
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace common {
+
+/**
+ * A bounded Chase-Lev work-stealing deque of pointers.
+ * The owner thread pushes and pops at the bottom (LIFO, good cache locality),
+ * any other thread steals from the top (FIFO). No operation takes a lock:
+ * the owner only synchronizes with thieves when they race for the last item.
+ * push() fails when the deque is full, the caller then keeps the item
+ * somewhere else.
+ */
+template <class T>
+class WorkStealingQueue {
+ public:
+  static const int64_t CAPACITY = 1024;  // must be a power of 2
+
+  WorkStealingQueue() : top_(0), bottom_(0) {
+    for (int64_t i = 0; i < CAPACITY; i++) {
+      buffer_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Push an item at the bottom. Only called by the owner.
+   * @return false if the deque is full
+   */
+  bool push(T *item) {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_acquire);
+    if (b - t >= CAPACITY) {
+      return false;
+    }
+    buffer_[b & (CAPACITY - 1)].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /**
+   * Pop the most recently pushed item. Only called by the owner.
+   * @return nullptr if the deque is empty or a thief took the last item
+   */
+  T *pop() {
+    const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    T *item = buffer_[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+      // the last item, race with thieves for it
+      if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  /**
+   * Take the oldest item. Can be called by any thread.
+   * @return nullptr if the deque is empty or another thread won the race
+   */
+  T *steal() {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+      return nullptr;
+    }
+    T *item = buffer_[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+  /**
+   * Approximate number of items, exact only when no other thread is working on the deque.
+   */
+  int64_t size() const {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_relaxed);
+    return b > t ? b - t : 0;
+  }
+
+ private:
+  std::atomic<int64_t> top_;
+  std::atomic<int64_t> bottom_;
+  std::atomic<T *> buffer_[CAPACITY];
+};
+
+}  // namespace common
+#endif  // __COMMON_SEDA_WORK_STEALING_QUEUE_H__
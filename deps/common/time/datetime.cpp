@@ -348,6 +348,80 @@ std::string Now::unique() {
   return oss.str();
 }
 
+// Value of the decimal digit c, greater than 9 for other characters
+static inline unsigned digit_value(char c) { return (unsigned)(unsigned char)c - '0'; }
+
+// DAYS_IN_MONTH[leap][month]
+static const unsigned char DAYS_IN_MONTH[2][13] = {
+    {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31},
+    {0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}};
+
+// Two ASCII digits of 00~99
+static const char TWO_DIGITS[] = "00010203040506070809"
+                                 "10111213141516171819"
+                                 "20212223242526272829"
+                                 "30313233343536373839"
+                                 "40414243444546474849"
+                                 "50515253545556575859"
+                                 "60616263646566676869"
+                                 "70717273747576777879"
+                                 "80818283848586878889"
+                                 "90919293949596979899";
+
+// Parse 1 or 2 digits followed by end, return the end of the digits or
+// nullptr.
+static inline const char *parse_two_digits(const char *s, char end, unsigned *value) {
+  const unsigned d0 = digit_value(s[0]);
+  if (d0 > 9) {
+    return nullptr;
+  }
+  const unsigned d1 = digit_value(s[1]);
+  if (d1 <= 9) {
+    *value = d0 * 10 + d1;
+    return s[2] == end ? s + 2 : nullptr;
+  }
+  *value = d0;
+  return s[1] == end ? s + 1 : nullptr;
+}
+
+bool parse_date(const char *s, int *days) {
+  unsigned year = 0;
+  for (int i = 0; i < 4; i++) {
+    const unsigned d = digit_value(s[i]);
+    if (d > 9) {
+      return false;
+    }
+    year = year * 10 + d;
+  }
+  unsigned month = 0;
+  unsigned day = 0;
+  const char *p = s[4] == '-' ? parse_two_digits(s + 5, '-', &month) : nullptr;
+  if (p == nullptr || parse_two_digits(p + 1, '\0', &day) == nullptr) {
+    return false;
+  }
+  const int leap = (year % 4 == 0) & ((year % 100 != 0) | (year % 400 == 0));
+  if (month - 1 >= 12 || day - 1 >= DAYS_IN_MONTH[leap][month]) {
+    return false;
+  }
+  *days = days_from_civil((int)year, (int)month, (int)day);
+  return true;
+}
+
+int format_date(int days, char *buf) {
+  int year = 0;
+  int month = 0;
+  int day = 0;
+  civil_from_days(days, &year, &month, &day);
+  memcpy(buf, TWO_DIGITS + year / 100 * 2, 2);
+  memcpy(buf + 2, TWO_DIGITS + year % 100 * 2, 2);
+  buf[4] = '-';
+  memcpy(buf + 5, TWO_DIGITS + month * 2, 2);
+  buf[7] = '-';
+  memcpy(buf + 8, TWO_DIGITS + day * 2, 2);
+  buf[DATE_STRING_LEN] = '\0';
+  return DATE_STRING_LEN;
+}
+
 bool DateTime::is_valid_xml_datetime(const std::string &str) {
   // check length. 20 is the length of a xml date
   if (str.length() != 20)
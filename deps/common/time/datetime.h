@@ -435,5 +435,46 @@ public:
   static std::string unique();
 };
 
+// Dates as the number of days since 1970-01-01 in the proleptic Gregorian
+// calendar, negative before the epoch. The conversions below have no loops
+// and no data dependent branches (the comparisons compile to cmov/setcc), see
+// http://howardhinnant.github.io/date_algorithms.html
+
+// Days since 1970-01-01 of year-month-day. month is 1~12, day is 1~31.
+inline int days_from_civil(int year, int month, int day) {
+  year -= month <= 2;
+  const int era = (year >= 0 ? year : year - 399) / 400;
+  const unsigned yoe = (unsigned)(year - era * 400);                           // [0, 399]
+  const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;  // [0, 365]
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;                     // [0, 146096]
+  return era * 146097 + (int)doe - 719468;
+}
+
+// Inverse of days_from_civil.
+inline void civil_from_days(int days, int *year, int *month, int *day) {
+  days += 719468;
+  const int era = (days >= 0 ? days : days - 146096) / 146097;
+  const unsigned doe = (unsigned)(days - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  *day = (int)(doy - (153 * mp + 2) / 5 + 1);
+  *month = (int)(mp < 10 ? mp + 3 : mp - 9);
+  *year = (int)yoe + era * 400 + (*month <= 2);
+}
+
+// Length of the string written by format_date, not including the '\0'.
+#define DATE_STRING_LEN 10
+
+// Parse a date of exactly yyyy-m-d, month and day have 1 or 2 digits, into
+// days since 1970-01-01. Returns false if s is not in this format or is not
+// a valid date, e.g. 2021-02-29.
+bool parse_date(const char *s, int *days);
+
+// Write days since 1970-01-01 as yyyy-mm-dd and a '\0' into buf, which must
+// hold at least DATE_STRING_LEN + 1 bytes. Years are in [0, 9999].
+// Returns DATE_STRING_LEN.
+int format_date(int days, char *buf);
+
 } //namespace common
 #endif //__COMMON_TIME_DATETIME_H__
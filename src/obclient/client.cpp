@@ -16,24 +16,51 @@ See the Mulan PSL v2 for more details. */
 #include <errno.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include <termios.h>
 
+#include <string>
+#include <vector>
+
 #include "common/defs.h"
 #include "common/lang/string.h"
+#include "net/shm_ring.h"
+#include "net/wire_compression.h"
+#include "net/wire_protocol.h"
 
 #define MAX_MEM_BUFFER_SIZE 8192
 #define PORT_DEFAULT 6789
+#define BATCH_WINDOW_DEFAULT 64  // 批量执行时默认最多这么多条语句在途
 
 using namespace common;
 
+// 和服务端约定了结果压缩之后，收到的数据都先经过这里解压
+static WireDecompressor *decompressor = nullptr;
+
+/**
+ * 客户端一侧的共享内存传输，见net/shm_ring.h。切换之后请求和结果都经过共享内存，socket只用来发现服务端关闭
+ */
+struct ClientShm {
+  void *mem = nullptr;
+  size_t size = 0;
+  ShmRing requests;
+  ShmRing responses;
+  int request_fd = -1;
+  int response_fd = -1;
+};
+static ClientShm *shm = nullptr;
+static std::vector<int> passed_fds;  // 服务端用SCM_RIGHTS传过来的fd
+
 bool is_exit_command(const char *cmd) {
   return 0 == strncasecmp("exit", cmd, 4) ||
          0 == strncasecmp("bye", cmd, 3);
@@ -93,6 +120,525 @@ int init_tcp_sock(const char *server_host, int server_port) {
 // 但是设置控制台模式为非 ICANON 后，不能再正常的处理 backspace
 // 所以暂时不调用这个函数
 // 需要测试超长字符串场景的同学，可以通过文本重定向的方式测试
+// 和服务端文本协议的格式相同：保留两位小数，再去掉末尾的0
+static void print_float(float v) {
+  char ftos[50];
+  snprintf(ftos, sizeof(ftos), "%.2f", v);
+  int s_end = strlen(ftos) - 1;
+  while (ftos[s_end] == '0') {
+    --s_end;
+  }
+  if (ftos[s_end] == '.') {
+    ftos[s_end] = '\0';
+  } else {
+    ftos[s_end + 1] = '\0';
+  }
+  fputs(ftos, stdout);
+}
+
+// 打印一个WIRE_FRAME_SCHEMA帧，格式错误时返回-1
+static int print_schema(const char *data, uint32_t len) {
+  const char *end = data + len;
+  if (len < 2) {
+    return -1;
+  }
+  int column_num = wire_get_u16(data);
+  data += 2;
+  for (int i = 0; i < column_num; i++) {
+    if (end - data < 3) {
+      return -1;
+    }
+    uint16_t name_len = wire_get_u16(data + 1);
+    data += 3;
+    if (end - data < name_len) {
+      return -1;
+    }
+    printf("%s%.*s", i == 0 ? "" : " | ", (int)name_len, data);
+    data += name_len;
+  }
+  printf("\n");
+  return 0;
+}
+
+// 打印一个WIRE_FRAME_ROWS帧，格式和文本协议相同
+static int print_rows(const char *data, uint32_t len) {
+  const char *end = data + len;
+  if (len < 4) {
+    return -1;
+  }
+  uint32_t row_num = wire_get_u32(data);
+  data += 4;
+  for (uint32_t row = 0; row < row_num; row++) {
+    if (end - data < 2) {
+      return -1;
+    }
+    int value_num = wire_get_u16(data);
+    data += 2;
+    for (int i = 0; i < value_num; i++) {
+      if (data >= end) {
+        return -1;
+      }
+      if (i > 0) {
+        fputs(" | ", stdout);
+      }
+      char type = *data++;
+      switch (type) {
+        case WIRE_VALUE_NULL: {
+          fputs("NULL", stdout);
+        } break;
+        case WIRE_VALUE_INT: {
+          if (end - data < 4) {
+            return -1;
+          }
+          printf("%d", (int)wire_get_u32(data));
+          data += 4;
+        } break;
+        case WIRE_VALUE_FLOAT: {
+          if (end - data < 4) {
+            return -1;
+          }
+          print_float(wire_get_f32(data));
+          data += 4;
+        } break;
+        case WIRE_VALUE_STRING: {
+          if (end - data < 2 || end - data - 2 < wire_get_u16(data)) {
+            return -1;
+          }
+          uint16_t str_len = wire_get_u16(data);
+          printf("%.*s", (int)str_len, data + 2);
+          data += 2 + str_len;
+        } break;
+        default: {
+          return -1;
+        }
+      }
+    }
+    printf("\n");
+  }
+  return 0;
+}
+
+/**
+ * 处理buf中已经收到的完整的帧并打印，收到max_responses个WIRE_FRAME_END之后停止，responses加上收到的个数。
+ * message不为空时，WIRE_FRAME_MESSAGE的内容追加到其中。返回处理了的字节数，收到错误的数据时返回-1
+ */
+static long consume_binary_frames(
+    const std::string &buf, bool print, int max_responses, int *responses, std::string *message = nullptr) {
+  size_t pos = 0;
+  int ended = 0;
+  while (ended < max_responses && buf.size() - pos >= WIRE_FRAME_HEADER_SIZE) {
+    char type = buf[pos];
+    uint32_t len = wire_get_u32(buf.data() + pos + 1);
+    if (buf.size() - pos - WIRE_FRAME_HEADER_SIZE < len) {
+      break;
+    }
+    const char *data = buf.data() + pos + WIRE_FRAME_HEADER_SIZE;
+    pos += WIRE_FRAME_HEADER_SIZE + len;
+
+    int ret = 0;
+    switch (type) {
+      case WIRE_FRAME_END: {
+        ended++;
+      } break;
+      case WIRE_FRAME_MESSAGE: {
+        if (print) {
+          fwrite(data, 1, len, stdout);
+        }
+        if (message != nullptr) {
+          message->append(data, len);
+        }
+      } break;
+      case WIRE_FRAME_SCHEMA: {
+        ret = print ? print_schema(data, len) : 0;
+      } break;
+      case WIRE_FRAME_ROWS: {
+        ret = print ? print_rows(data, len) : 0;
+      } break;
+      default: {
+        ret = -1;
+      }
+    }
+    if (ret < 0) {
+      fprintf(stderr, "Received invalid frame from server, type=%d\n", type);
+      return -1;
+    }
+  }
+  *responses += ended;
+  return pos;
+}
+
+/**
+ * 等待共享内存中有结果，want_write时也等待请求环有空间。先自旋，之后才阻塞在eventfd上。
+ * 返回1表示可以重新检查，0表示服务端关闭了连接，-1表示出错
+ */
+static int shm_wait(int sockfd, bool want_write) {
+  auto ready = [want_write]() {
+    return shm->responses.readable() > 0 || (want_write && shm->requests.writable() > 0);
+  };
+  if (shm_spin_until(ready)) {
+    return 1;
+  }
+  // 设置之后再检查一次，避免错过服务端刚写入的数据
+  shm->responses.header()->consumer_waiting.store(1);
+  if (want_write) {
+    shm->requests.header()->producer_waiting.store(1);
+  }
+  if (ready()) {
+    return 1;
+  }
+  struct pollfd fds[2] = {{shm->response_fd, POLLIN, 0}, {sockfd, POLLIN, 0}};
+  if (poll(fds, 2, -1) < 0) {
+    return errno == EINTR ? 1 : -1;
+  }
+  if ((fds[0].revents & POLLIN) != 0) {
+    uint64_t count = 0;
+    if (read(shm->response_fd, &count, sizeof(count)) < 0 && errno != EAGAIN && errno != EINTR) {
+      return -1;
+    }
+  }
+  if (fds[1].revents != 0 && !ready()) {
+    // 切换之后服务端不会再在socket上发送数据，可读就是关闭了
+    char c;
+    ssize_t len = recv(sockfd, &c, sizeof(c), MSG_DONTWAIT);
+    if (len == 0) {
+      return 0;
+    }
+    if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      return -1;
+    }
+  }
+  return 1;
+}
+
+/**
+ * 发送数据，返回值和send相同。使用共享内存时写到请求环中，flags有MSG_DONTWAIT时只写入放得下的部分
+ */
+static ssize_t send_raw(int sockfd, const char *data, size_t len, int flags) {
+  if (shm == nullptr) {
+    return send(sockfd, data, len, flags | MSG_NOSIGNAL);
+  }
+  size_t wlen = 0;
+  while (true) {
+    size_t n = shm->requests.write(data + wlen, len - wlen);
+    if (n == SHM_RING_CORRUPTED) {
+      errno = EPROTO;
+      return -1;
+    }
+    if (n > 0) {
+      wlen += n;
+      shm_notify_consumer(shm->requests, shm->request_fd);
+    }
+    if (wlen == len || (flags & MSG_DONTWAIT) != 0) {
+      break;
+    }
+    int ret = shm_wait(sockfd, true);
+    if (ret <= 0) {
+      errno = ret == 0 ? EPIPE : errno;
+      return -1;
+    }
+  }
+  if (wlen == 0 && len > 0) {
+    errno = EAGAIN;
+    return -1;
+  }
+  return wlen;
+}
+
+static int send_all(int sockfd, const char *data, size_t len) {
+  size_t wlen = 0;
+  while (wlen < len) {
+    ssize_t n = send_raw(sockfd, data + wlen, len - wlen, 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return -1;
+    }
+    wlen += n;
+  }
+  return 0;
+}
+
+/**
+ * 接收数据，返回值和recv相同。socket上收到的fd放到passed_fds中，使用共享内存时从结果环中读
+ */
+static ssize_t recv_raw(int sockfd, char *buf, size_t len, int flags) {
+  if (shm != nullptr) {
+    while (true) {
+      size_t n = shm->responses.read(buf, len);
+      if (n == SHM_RING_CORRUPTED) {
+        errno = EPROTO;
+        return -1;
+      }
+      if (n > 0) {
+        shm_notify_producer(shm->responses, shm->request_fd);
+        return n;
+      }
+      if ((flags & MSG_DONTWAIT) != 0) {
+        errno = EAGAIN;
+        return -1;
+      }
+      int ret = shm_wait(sockfd, false);
+      if (ret <= 0) {
+        return ret;
+      }
+    }
+  }
+
+  char control[CMSG_SPACE(sizeof(int) * 4)];
+  struct iovec iov = {buf, len};
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ssize_t ret = recvmsg(sockfd, &msg, flags | MSG_CMSG_CLOEXEC);
+  if (ret > 0) {
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        const int fd_num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (int i = 0; i < fd_num; i++) {
+          int fd;
+          memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+          passed_fds.push_back(fd);
+        }
+      }
+    }
+  }
+  return ret;
+}
+
+/**
+ * 等待连接可以收发数据。返回1表示可以重新尝试收发，0表示服务端关闭了连接，-1表示出错
+ */
+static int wait_connection(int sockfd, bool want_write) {
+  if (shm != nullptr) {
+    return shm_wait(sockfd, want_write);
+  }
+  struct pollfd pfd;
+  pfd.fd = sockfd;
+  pfd.events = POLLIN | (want_write ? POLLOUT : 0);
+  pfd.revents = 0;
+  if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+    return -1;
+  }
+  return 1;
+}
+
+/**
+ * 映射服务端在握手的回复中传过来的共享内存，之后的请求和结果都经过共享内存
+ */
+static int attach_shm() {
+  if (passed_fds.size() != 3) {
+    return -1;
+  }
+  struct stat st;
+  ClientShm *client_shm = new ClientShm();
+  if (fstat(passed_fds[0], &st) == 0) {
+    client_shm->size = st.st_size;
+    client_shm->mem = mmap(nullptr, client_shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, passed_fds[0], 0);
+  }
+  close(passed_fds[0]);
+  client_shm->request_fd = passed_fds[1];
+  client_shm->response_fd = passed_fds[2];
+  passed_fds.clear();
+  if (client_shm->mem == nullptr || client_shm->mem == MAP_FAILED ||
+      !shm_region_attach(client_shm->mem, client_shm->size, &client_shm->requests, &client_shm->responses)) {
+    if (client_shm->mem != nullptr && client_shm->mem != MAP_FAILED) {
+      munmap(client_shm->mem, client_shm->size);
+    }
+    close(client_shm->request_fd);
+    close(client_shm->response_fd);
+    delete client_shm;
+    return -1;
+  }
+  shm = client_shm;
+  return 0;
+}
+
+static void detach_shm() {
+  if (shm == nullptr) {
+    return;
+  }
+  munmap(shm->mem, shm->size);
+  close(shm->request_fd);
+  close(shm->response_fd);
+  delete shm;
+  shm = nullptr;
+}
+
+/**
+ * 从连接上接收一次数据，约定了结果压缩时解压之后再追加到out中，解压得到的数据可能是空的。
+ * 返回值和recv相同，收到错误的压缩数据时返回-1并且errno是EPROTO
+ */
+static ssize_t recv_response_data(int sockfd, std::string &out, int flags) {
+  char recv_buf[MAX_MEM_BUFFER_SIZE];
+  ssize_t len = recv_raw(sockfd, recv_buf, sizeof(recv_buf), flags);
+  if (len <= 0) {
+    return len;
+  }
+  if (decompressor == nullptr) {
+    out.append(recv_buf, len);
+  } else if (!decompressor->feed(recv_buf, len, out)) {
+    errno = EPROTO;
+    return -1;
+  }
+  return len;
+}
+
+/**
+ * 按照二进制协议接收一个请求的结果并打印，直到收到WIRE_FRAME_END。message不为空时收集结果中的文本消息。
+ * 返回0表示成功，连接断开或者收到错误的数据时返回-1
+ */
+static int recv_binary_response(int sockfd, bool print, std::string *message = nullptr) {
+  std::string buf;
+  while (true) {
+    int responses = 0;
+    long consumed = consume_binary_frames(buf, print, 1, &responses, message);
+    if (consumed < 0) {
+      return -1;
+    }
+    if (responses > 0) {
+      return 0;
+    }
+    buf.erase(0, consumed);
+
+    ssize_t len = recv_response_data(sockfd, buf, 0);
+    if (len < 0) {
+      fprintf(stderr, "Connection was broken: %s\n", strerror(errno));
+      return -1;
+    }
+    if (len == 0) {
+      printf("Connection has been closed\n");
+      return -1;
+    }
+  }
+}
+
+/**
+ * 按照文本协议接收一个请求的结果，直到收到'\0'。print时边收边打印，response不为空时收集结果。
+ * 返回0表示成功，连接断开或者收到错误的数据时返回-1
+ */
+static int recv_text_response(int sockfd, bool print, std::string *response = nullptr) {
+  std::string buf;
+  while (true) {
+    ssize_t len = recv_response_data(sockfd, buf, 0);
+    if (len < 0) {
+      fprintf(stderr, "Connection was broken: %s\n", strerror(errno));
+      return -1;
+    }
+    if (len == 0) {
+      printf("Connection has been closed\n");
+      return -1;
+    }
+    size_t end = buf.find('\0');
+    size_t data_len = end == std::string::npos ? buf.size() : end;
+    if (print) {
+      fwrite(buf.data(), 1, data_len, stdout);
+    }
+    if (response != nullptr) {
+      response->append(buf.data(), data_len);
+    }
+    if (end != std::string::npos) {
+      return 0;
+    }
+    buf.clear();
+  }
+}
+
+/**
+ * 批量执行文件中的语句，每行一条。不等前一条的结果就继续发送，最多window条语句在途，
+ * 服务端按顺序逐条执行并返回结果，结果按顺序打印，不打印提示符。
+ * 发送和接收都不阻塞，结果很多时不会因为双方都在等对方读而卡住。返回0表示所有语句都收到了结果
+ */
+static int run_batch(int sockfd, FILE *input, bool binary_protocol, int window) {
+  std::string out;  // 还没有发出去的请求
+  std::string in;   // 收到还没有处理的结果
+  int in_flight = 0;
+  long long statements = 0;
+  bool eof = false;
+  char line[MAX_MEM_BUFFER_SIZE];
+  struct timeval start;
+  gettimeofday(&start, nullptr);
+
+  while (true) {
+    while (!eof && in_flight < window) {
+      if (fgets(line, sizeof(line), input) == NULL || is_exit_command(line)) {
+        eof = true;
+        break;
+      }
+      if (common::is_blank(line)) {
+        continue;
+      }
+      out.append(line, strlen(line) + 1);
+      in_flight++;
+      statements++;
+    }
+    if (eof && in_flight == 0) {
+      break;
+    }
+
+    int ready = wait_connection(sockfd, !out.empty());
+    if (ready < 0) {
+      fprintf(stderr, "Failed to poll connection: %s\n", strerror(errno));
+      return -1;
+    }
+    if (ready == 0) {
+      fprintf(stderr, "Connection has been closed with %d statements in flight\n", in_flight);
+      return -1;
+    }
+    if (!out.empty()) {
+      ssize_t len = send_raw(sockfd, out.data(), out.size(), MSG_DONTWAIT);
+      if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        fprintf(stderr, "send error: %d:%s \n", errno, strerror(errno));
+        return -1;
+      }
+      if (len > 0) {
+        out.erase(0, len);
+      }
+    }
+    ssize_t len = recv_response_data(sockfd, in, MSG_DONTWAIT);
+    if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+      continue;
+    }
+    if (len < 0) {
+      fprintf(stderr, "Connection was broken: %s\n", strerror(errno));
+      return -1;
+    }
+    if (len == 0) {
+      fprintf(stderr, "Connection has been closed with %d statements in flight\n", in_flight);
+      return -1;
+    }
+
+    int responses = 0;
+    if (binary_protocol) {
+      long consumed = consume_binary_frames(in, true, in_flight, &responses);
+      if (consumed < 0) {
+        return -1;
+      }
+      in.erase(0, consumed);
+    } else {
+      // 文本协议的每个结果以'\0'结束
+      size_t pos = 0;
+      size_t end = 0;
+      while ((end = in.find('\0', pos)) != std::string::npos) {
+        fwrite(in.data() + pos, 1, end - pos, stdout);
+        pos = end + 1;
+        responses++;
+      }
+      in.erase(0, pos);
+    }
+    in_flight -= responses;
+  }
+
+  struct timeval finish;
+  gettimeofday(&finish, nullptr);
+  long long elapsed_ms = (finish.tv_sec - start.tv_sec) * 1000LL + (finish.tv_usec - start.tv_usec) / 1000;
+  fprintf(stderr, "Executed %lld statements in %lld ms\n", statements, elapsed_ms);
+  return 0;
+}
+
 int set_terminal_noncanonical() {
   int fd = STDIN_FILENO;
   struct termios old_termios;
@@ -122,10 +668,40 @@ int main(int argc, char *argv[]) {
   const char *unix_socket_path = nullptr;
   const char *server_host = "127.0.0.1";
   int server_port = PORT_DEFAULT;
+  bool binary_protocol = false;
+  const char *batch_file = nullptr;
+  int batch_window = BATCH_WINDOW_DEFAULT;
+  const char *compression_name = nullptr;
+  WireCompression compression = WIRE_COMPRESSION_NONE;
+  bool shared_memory = false;
   int opt;
   extern char *optarg;
-  while ((opt = getopt(argc, argv, "s:h:p:")) > 0) {
+  while ((opt = getopt(argc, argv, "s:h:p:bf:w:z:m")) > 0) {
     switch (opt) {
+    case 'b':
+      binary_protocol = true;
+      break;
+    case 'm':
+      shared_memory = true;
+      break;
+    case 'z':
+      compression_name = optarg;
+      if (!wire_compression_from_string(compression_name, &compression) ||
+          !wire_compression_supported(compression)) {
+        fprintf(stderr, "Unsupported compression %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 'f':
+      batch_file = optarg;
+      break;
+    case 'w':
+      batch_window = atoi(optarg);
+      if (batch_window <= 0) {
+        fprintf(stderr, "Invalid window size %s\n", optarg);
+        return 1;
+      }
+      break;
     case 's':
       unix_socket_path = optarg;
       break;
@@ -138,9 +714,14 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  if (shared_memory && unix_socket_path == nullptr) {
+    fprintf(stderr, "Shared memory transport needs a unix socket, use -s\n");
+    return 1;
+  }
+
   const char *prompt_str = "miniob > ";
 
-  int sockfd, send_bytes;
+  int sockfd;
   // char send[MAXLINE];
 
   if (unix_socket_path != nullptr) {
@@ -152,6 +733,59 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
+  if (shared_memory) {
+    // 最先切换到共享内存，之后的握手也经过共享内存
+    const char handshake[] = SHM_TRANSPORT_HANDSHAKE;
+    std::string reply;
+    if (send_all(sockfd, handshake, sizeof(handshake)) != 0 || recv_text_response(sockfd, false, &reply) != 0 ||
+        reply != "SUCCESS\n" || attach_shm() != 0) {
+      fprintf(stderr, "Failed to set up shared memory with server\n");
+      close(sockfd);
+      return 1;
+    }
+  }
+
+  if (binary_protocol) {
+    // 先和服务端约定使用二进制协议
+    const char handshake[] = BINARY_PROTOCOL_HANDSHAKE;
+    if (send_all(sockfd, handshake, sizeof(handshake)) != 0 || recv_binary_response(sockfd, false) != 0) {
+      fprintf(stderr, "Failed to negotiate binary protocol with server\n");
+      close(sockfd);
+      return 1;
+    }
+  }
+
+  if (compression != WIRE_COMPRESSION_NONE) {
+    // 服务端按当前的协议回复，回复本身不压缩，之后收到的数据才需要解压
+    std::string handshake = std::string(COMPRESSION_HANDSHAKE_PREFIX) + compression_name;
+    std::string reply;
+    if (send_all(sockfd, handshake.c_str(), handshake.size() + 1) != 0 ||
+        (binary_protocol ? recv_binary_response(sockfd, false, &reply) : recv_text_response(sockfd, false, &reply)) != 0 ||
+        reply != "SUCCESS\n") {
+      fprintf(stderr, "Failed to negotiate %s compression with server\n", compression_name);
+      close(sockfd);
+      return 1;
+    }
+    decompressor = new WireDecompressor(compression);
+  }
+
+  if (batch_file != nullptr) {
+    FILE *input = 0 == strcmp(batch_file, "-") ? stdin : fopen(batch_file, "r");
+    if (input == nullptr) {
+      fprintf(stderr, "Failed to open %s: %s\n", batch_file, strerror(errno));
+      close(sockfd);
+      return 1;
+    }
+    ret = run_batch(sockfd, input, binary_protocol, batch_window);
+    if (input != stdin) {
+      fclose(input);
+    }
+    detach_shm();
+    close(sockfd);
+    delete decompressor;
+    return ret == 0 ? 0 : 1;
+  }
+
   char send_buf[MAX_MEM_BUFFER_SIZE];
   // char buf[MAXDATASIZE];
 
@@ -166,39 +800,28 @@ int main(int argc, char *argv[]) {
       break;
     }
 
-    if ((send_bytes = write(sockfd, send_buf, strlen(send_buf) + 1)) == -1) {
+    if (send_all(sockfd, send_buf, strlen(send_buf) + 1) != 0) {
       fprintf(stderr, "send error: %d:%s \n", errno, strerror(errno));
       exit(1);
     }
     memset(send_buf, 0, sizeof(send_buf));
 
-    int len = 0;
-    while((len = recv(sockfd, send_buf, MAX_MEM_BUFFER_SIZE, 0)) > 0){  
-      bool msg_end = false;
-      for (int i = 0; i < len; i++) {
-        if (0 == send_buf[i]) {
-          msg_end = true;
-          break;
-		    }
-        printf("%c", send_buf[i]);
-      }
-      if (msg_end) {
+    if (binary_protocol) {
+      if (recv_binary_response(sockfd, true) != 0) {
         break;
       }
-      memset(send_buf, 0, MAX_MEM_BUFFER_SIZE);
+      fputs(prompt_str, stdout);
+      continue;
     }
 
-    if (len < 0) {
-      fprintf(stderr, "Connection was broken: %s\n", strerror(errno));
-      break;
-    }
-    if (0 == len) {
-      printf("Connection has been closed\n");
+    if (recv_text_response(sockfd, true) != 0) {
       break;
     }
     fputs(prompt_str, stdout);
   }
+  detach_shm();
   close(sockfd);
+  delete decompressor;
 
   return 0;
 }
@@ -0,0 +1,90 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Query router in front of several hash-sharded observers.
+//
+
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+
+#include "common/conf/ini.h"
+#include "common/log/log.h"
+#include "obrouter/router_server.h"
+#include "obrouter/shard_map.h"
+
+#define ROUTER_SECTION "ROUTER"
+
+void usage() {
+  std::cout << "Useage " << std::endl;
+  std::cout << "-f: path of config file, see etc/obrouter.ini" << std::endl;
+  std::cout << "-p: router port. if not specified, the item in the config file will be used" << std::endl;
+  std::cout << "-s: use unix socket and the argument is socket address" << std::endl;
+  exit(0);
+}
+
+int main(int argc, char **argv) {
+  std::string conf_file;
+  std::string unix_socket_path;
+  int port = 0;
+  int opt;
+  extern char *optarg;
+  while ((opt = getopt(argc, argv, "f:p:s:h")) > 0) {
+    switch (opt) {
+    case 'f':
+      conf_file = optarg;
+      break;
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 's':
+      unix_socket_path = optarg;
+      break;
+    case 'h':
+    default:
+      usage();
+    }
+  }
+  if (conf_file.empty()) {
+    usage();
+  }
+
+  common::Ini ini;
+  if (ini.load(conf_file) != 0) {
+    std::cerr << "Failed to load config file " << conf_file << std::endl;
+    return 1;
+  }
+  std::string log_file = ini.get("LOG_FILE", "obrouter.log", ROUTER_SECTION);
+  common::LoggerFactory::init_default(log_file);
+
+  if (port <= 0) {
+    port = atoi(ini.get("PORT", std::to_string(ROUTER_PORT_DEFAULT), ROUTER_SECTION).c_str());
+  }
+
+  ShardMap shard_map;
+  RC rc = shard_map.init(ini.get("SHARDS", "", ROUTER_SECTION), ini.get("SHARD_KEYS", "", ROUTER_SECTION));
+  if (rc != RC::SUCCESS) {
+    std::cerr << "Invalid SHARDS or SHARD_KEYS in " << conf_file << std::endl;
+    return 1;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  RouterServer server(shard_map);
+  if (server.listen(port, unix_socket_path) != RC::SUCCESS) {
+    std::cerr << "Failed to listen, see " << log_file << std::endl;
+    return 1;
+  }
+  server.serve();
+  return 0;
+}
@@ -0,0 +1,282 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Combine the results of one statement from several shards.
+//
+
+#include "obrouter/result_merger.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+static bool is_success(const WireResult &result) {
+  return !result.has_schema() && 0 == result.message().compare(0, 7, "SUCCESS");
+}
+
+void ResultMerger::merge_status(const std::vector<WireResult> &results, bool any_success, std::string &out) {
+  if (results.empty()) {
+    out = "SUCCESS\n";
+    return;
+  }
+  for (const WireResult &result : results) {
+    if (is_success(result) == any_success) {
+      out = result.text();
+      return;
+    }
+  }
+  out = results.front().text();
+}
+
+/**
+ * 结果中的一行作为hash表的键
+ */
+static std::string row_key(const WireRow &row, const std::vector<int> *columns = nullptr) {
+  std::string key;
+  size_t num = columns == nullptr ? row.size() : columns->size();
+  for (size_t i = 0; i < num; i++) {
+    const WireValue &value = row[columns == nullptr ? i : (*columns)[i]];
+    key.push_back((char)('0' + value.type));
+    value.to_text(key);
+    key.push_back('\0');
+  }
+  return key;
+}
+
+/**
+ * 排序的字段在结果中的位置，表头是字段名或者表名.字段名
+ */
+static int find_column(const std::vector<std::string> &headers, const MergeOrder &order) {
+  for (size_t i = 0; i < headers.size(); i++) {
+    const std::string &header = headers[i];
+    if (header == order.attribute) {
+      return (int)i;
+    }
+    size_t dot = header.rfind('.');
+    if (dot != std::string::npos && header.compare(dot + 1, std::string::npos, order.attribute) == 0 &&
+        (order.relation.empty() || header.compare(0, dot, order.relation) == 0)) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+void ResultMerger::merge_rows(const MergeSpec &spec, std::vector<WireResult> &results, std::string &out) {
+  for (const WireResult &result : results) {
+    if (!result.has_schema()) {
+      out = result.text();
+      return;
+    }
+  }
+
+  std::vector<std::string> headers;
+  std::vector<WireRow> rows;
+  if (spec.aggregate) {
+    merge_aggregate(spec, results, headers, rows);
+    if (headers.empty()) {
+      // 所有分片都没有结果，和单机时相同
+      out = results.front().text();
+      return;
+    }
+  } else {
+    headers = results.front().headers();
+    for (WireResult &result : results) {
+      for (WireRow &row : result.rows()) {
+        rows.push_back(std::move(row));
+      }
+    }
+    if (spec.distinct) {
+      std::unordered_set<std::string> seen;
+      std::vector<WireRow> distinct_rows;
+      for (WireRow &row : rows) {
+        if (seen.insert(row_key(row)).second) {
+          distinct_rows.push_back(std::move(row));
+        }
+      }
+      rows.swap(distinct_rows);
+    }
+  }
+
+  sort_and_limit(spec, headers, rows);
+
+  if (spec.hidden_columns > 0) {
+    size_t visible = headers.size() > (size_t)spec.hidden_columns ? headers.size() - spec.hidden_columns : 0;
+    headers.resize(visible);
+    for (WireRow &row : rows) {
+      if (row.size() > visible) {
+        row.resize(visible);
+      }
+    }
+  }
+
+  out.clear();
+  WireResult::header_text(headers, out);
+  for (const WireRow &row : rows) {
+    WireResult::row_text(row, out);
+  }
+}
+
+namespace {
+
+/**
+ * 一个分组中一列的合并状态
+ */
+struct MergeState {
+  WireValue value;      // NONE、MIN、MAX和SUM的结果
+  int64_t count = 0;    // COUNT的结果，AVG的个数
+  double sum = 0;       // AVG的和
+};
+
+}  // namespace
+
+void ResultMerger::merge_aggregate(const MergeSpec &spec, std::vector<WireResult> &results,
+                                   std::vector<std::string> &headers, std::vector<WireRow> &rows) {
+  std::unordered_map<std::string, size_t> group_index;
+  std::vector<std::vector<MergeState>> groups;  // 按第一次出现的顺序
+  const WireResult *first = nullptr;
+  for (WireResult &result : results) {
+    if (result.rows().empty()) {
+      // 没有匹配的记录时observer返回的表头不同，跳过
+      continue;
+    }
+    if (first == nullptr) {
+      first = &result;
+    }
+    for (const WireRow &row : result.rows()) {
+      std::string key = row_key(row, &spec.group_sources);
+      auto iter = group_index.find(key);
+      bool created = iter == group_index.end();
+      if (created) {
+        iter = group_index.emplace(key, groups.size()).first;
+        groups.emplace_back(spec.columns.size());
+      }
+      std::vector<MergeState> &states = groups[iter->second];
+      for (size_t i = 0; i < spec.columns.size(); i++) {
+        const MergeColumn &column = spec.columns[i];
+        MergeState &state = states[i];
+        const WireValue &value = row[column.source];
+        switch (column.func) {
+          case MergeFunc::NONE: {
+            if (created) {
+              state.value = value;
+            }
+          } break;
+          case MergeFunc::COUNT: {
+            state.count += value.is_number() ? (int64_t)value.as_double() : 0;
+          } break;
+          case MergeFunc::SUM: {
+            if (!value.is_number()) {
+              break;
+            }
+            if (state.value.is_null()) {
+              state.value = value;
+            } else if (state.value.type == WIRE_VALUE_INT && value.type == WIRE_VALUE_INT) {
+              state.value.int_value += value.int_value;
+            } else {
+              state.value = WireValue::make_float(state.value.as_double() + value.as_double());
+            }
+          } break;
+          case MergeFunc::MIN:
+          case MergeFunc::MAX: {
+            if (value.is_null()) {
+              break;
+            }
+            int cmp = state.value.is_null() ? 0 : value.compare(state.value);
+            if (state.value.is_null() || (column.func == MergeFunc::MIN ? cmp < 0 : cmp > 0)) {
+              state.value = value;
+            }
+          } break;
+          case MergeFunc::AVG: {
+            const WireValue &count = row[column.count_source];
+            if (value.is_number() && count.is_number()) {
+              state.sum += value.as_double();
+              state.count += (int64_t)count.as_double();
+            }
+          } break;
+        }
+      }
+    }
+  }
+  if (first == nullptr) {
+    return;
+  }
+
+  for (const MergeColumn &column : spec.columns) {
+    std::string header = first->headers()[column.source];
+    if (column.func == MergeFunc::AVG) {
+      size_t paren = header.find('(');
+      header = "avg" + (paren == std::string::npos ? "(" + header + ")" : header.substr(paren));
+    }
+    headers.push_back(header);
+  }
+  for (std::vector<MergeState> &states : groups) {
+    WireRow row(spec.columns.size());
+    for (size_t i = 0; i < spec.columns.size(); i++) {
+      MergeState &state = states[i];
+      switch (spec.columns[i].func) {
+        case MergeFunc::COUNT: {
+          row[i] = WireValue::make_int(state.count);
+        } break;
+        case MergeFunc::AVG: {
+          if (state.count > 0) {
+            row[i] = WireValue::make_float(state.sum / state.count);
+          }
+        } break;
+        default: {
+          row[i] = std::move(state.value);
+        } break;
+      }
+    }
+    rows.push_back(std::move(row));
+  }
+  if (spec.distinct) {
+    std::unordered_set<std::string> seen;
+    std::vector<WireRow> distinct_rows;
+    for (WireRow &row : rows) {
+      if (seen.insert(row_key(row)).second) {
+        distinct_rows.push_back(std::move(row));
+      }
+    }
+    rows.swap(distinct_rows);
+  }
+}
+
+void ResultMerger::sort_and_limit(const MergeSpec &spec, const std::vector<std::string> &headers,
+                                  std::vector<WireRow> &rows) {
+  std::vector<std::pair<int, bool>> keys;
+  for (const MergeOrder &order : spec.orders) {
+    int column = find_column(headers, order);
+    if (column >= 0) {
+      keys.emplace_back(column, order.desc);
+    }
+  }
+  if (!keys.empty()) {
+    std::stable_sort(rows.begin(), rows.end(), [&keys](const WireRow &a, const WireRow &b) {
+      for (const auto &key : keys) {
+        if ((size_t)key.first >= a.size() || (size_t)key.first >= b.size()) {
+          continue;
+        }
+        int cmp = a[key.first].compare(b[key.first]);
+        if (cmp != 0) {
+          return key.second ? cmp > 0 : cmp < 0;
+        }
+      }
+      return false;
+    });
+  }
+
+  if (spec.has_limit) {
+    size_t begin = std::min(rows.size(), (size_t)std::max(spec.offset, 0));
+    size_t end = std::min(rows.size(), begin + (size_t)std::max(spec.limit, 0));
+    rows.erase(rows.begin() + end, rows.end());
+    rows.erase(rows.begin(), rows.begin() + begin);
+  }
+}
@@ -0,0 +1,45 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Combine the results of one statement from several shards.
+//
+
+#ifndef __OBROUTER_RESULT_MERGER_H__
+#define __OBROUTER_RESULT_MERGER_H__
+
+#include <string>
+#include <vector>
+
+#include "obrouter/route_planner.h"
+#include "obrouter/wire_result.h"
+
+class ResultMerger {
+public:
+  /**
+   * MULTI的结果：都成功时返回第一个分片的结果，否则返回第一个失败的结果。
+   * any_success时有一个分片成功就返回它的结果
+   */
+  static void merge_status(const std::vector<WireResult> &results, bool any_success, std::string &out);
+
+  /**
+   * SCATTER的结果，格式和observer的文本协议相同。
+   * 有分片没有返回结果集(比如FAILURE)时返回这个分片的结果
+   */
+  static void merge_rows(const MergeSpec &spec, std::vector<WireResult> &results, std::string &out);
+
+private:
+  static void merge_aggregate(const MergeSpec &spec, std::vector<WireResult> &results, std::vector<std::string> &headers,
+                              std::vector<WireRow> &rows);
+  static void sort_and_limit(const MergeSpec &spec, const std::vector<std::string> &headers,
+                             std::vector<WireRow> &rows);
+};
+
+#endif  // __OBROUTER_RESULT_MERGER_H__
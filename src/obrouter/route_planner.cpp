@@ -0,0 +1,472 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Decide which shards a statement goes to.
+//
+
+#include "obrouter/route_planner.h"
+
+#include <string.h>
+#include <strings.h>
+
+#include "common/log/log.h"
+#include "obrouter/sql_writer.h"
+
+static bool same_field(const RelAttr &a, const RelAttr &b) {
+  if (strcmp(a.attribute_name, b.attribute_name) != 0) {
+    return false;
+  }
+  return a.relation_name == nullptr || b.relation_name == nullptr || strcmp(a.relation_name, b.relation_name) == 0;
+}
+
+static MergeFunc merge_func(const char *function_name) {
+  if (0 == strcasecmp(function_name, "count")) {
+    return MergeFunc::COUNT;
+  } else if (0 == strcasecmp(function_name, "sum")) {
+    return MergeFunc::SUM;
+  } else if (0 == strcasecmp(function_name, "min")) {
+    return MergeFunc::MIN;
+  } else if (0 == strcasecmp(function_name, "max")) {
+    return MergeFunc::MAX;
+  } else if (0 == strcasecmp(function_name, "avg")) {
+    return MergeFunc::AVG;
+  }
+  return MergeFunc::NONE;
+}
+
+/**
+ * 下推到分片上的部分聚合，参数和原来的聚合函数相同
+ */
+static RelAttr partial_attr(const RelAttr &attr, const char *function_name) {
+  RelAttr partial = attr;
+  partial.window_function_name = const_cast<char *>(function_name);
+  partial.is_distinct = 0;
+  partial.window = nullptr;
+  return partial;
+}
+
+RC RoutePlanner::plan(const char *sql, Query *query, RoutePlan &plan) {
+  plan = RoutePlan();
+  Queries &sstr = query->sstr;
+  switch (query->flag) {
+    case SCF_SELECT: {
+      plan_select(sql, sstr.selection, plan);
+    } break;
+    case SCF_INSERT: {
+      return plan_insert(sql, sstr.insertion, plan);
+    }
+    case SCF_UPDATE: {
+      const char *key = shard_map_.shard_key(sstr.update.relation_name);
+      if (key != nullptr && 0 == strcmp(key, sstr.update.attribute_name)) {
+        fail(std::string("cannot update shard key ") + key, plan);
+        break;
+      }
+      plan_write(sql, sstr.update.relation_name, sstr.update.conditions, sstr.update.condition_num, plan);
+    } break;
+    case SCF_DELETE: {
+      plan_write(sql, sstr.deletion.relation_name, sstr.deletion.conditions, sstr.deletion.condition_num, plan);
+    } break;
+    case SCF_CREATE_TABLE: {
+      plan_create_table(sql, sstr.create_table, plan);
+    } break;
+    case SCF_DROP_TABLE: {
+      route_table(sql, sstr.drop_table.relation_name, plan);
+      plan.ddl_table = sstr.drop_table.relation_name;
+    } break;
+    case SCF_TRUNCATE_TABLE: {
+      route_table(sql, sstr.truncate_table.relation_name, plan);
+    } break;
+    case SCF_ANALYZE_TABLE: {
+      route_table(sql, sstr.analyze_table.relation_name, plan);
+    } break;
+    case SCF_DROP_PARTITION: {
+      route_table(sql, sstr.drop_partition.relation_name, plan);
+    } break;
+    case SCF_CREATE_INDEX: {
+      route_table(sql, sstr.create_index.relation_name, plan);
+    } break;
+    case SCF_DROP_INDEX: {
+      // 语句中没有表名，索引在哪些分片上都有可能
+      route_all(sql, plan);
+      plan.any_success = true;
+    } break;
+    case SCF_LOAD_DATA: {
+      if (shard_map_.is_sharded(sstr.load_data.relation_name)) {
+        fail("cannot load data into sharded table", plan);
+        break;
+      }
+      route_single(sql, 0, plan);
+    } break;
+    case SCF_CREATE_VIEW: {
+      const Selects &selects = sstr.create_view.query->sstr.selection;
+      for (size_t i = 0; i < selects.relation_num; i++) {
+        if (shard_map_.is_sharded(selects.relations[i])) {
+          fail("cannot create view on sharded table", plan);
+          return RC::SUCCESS;
+        }
+      }
+      route_single(sql, 0, plan);
+    } break;
+    case SCF_SYNC:
+    case SCF_SET_VARIABLE:
+    case SCF_RESET_STATEMENT_STATS: {
+      route_all(sql, plan);
+    } break;
+    case SCF_PREPARE:
+    case SCF_EXECUTE:
+    case SCF_DEALLOCATE:
+    case SCF_SAVEPOINT:
+    case SCF_ROLLBACK_TO_SAVEPOINT:
+    case SCF_RELEASE_SAVEPOINT:
+    case SCF_KILL_QUERY: {
+      fail("statement is not supported by router", plan);
+    } break;
+    case SCF_FETCH:
+    case SCF_CLOSE_CURSOR: {
+      fail("cursors are not supported by router", plan);
+    } break;
+    case SCF_BACKUP: {
+      // 每个分片的备份目录在它自己的机器上，需要分别连接分片执行
+      fail("backup each shard directly", plan);
+    } break;
+    case SCF_BEGIN:
+    case SCF_COMMIT:
+    case SCF_ROLLBACK: {
+      fail("transaction statements are handled by session", plan);
+    } break;
+    default: {
+      // 解析失败的语句也发给第0个分片，错误信息和直接连接observer时相同
+      route_single(sql, 0, plan);
+    } break;
+  }
+  return RC::SUCCESS;
+}
+
+void RoutePlanner::plan_select(const char *sql, const Selects &selects, RoutePlan &plan) {
+  if (selects.cursor != nullptr) {
+    // 游标挂起在某个分片上，之后的fetch和close中没有表名，不知道发给哪个分片
+    fail("cursors are not supported by router", plan);
+    return;
+  }
+  int shard = single_shard(selects);
+  if (shard >= 0) {
+    route_single(sql, shard, plan);
+    return;
+  }
+  if (selects.explain != EXPLAIN_NONE) {
+    // 各个分片上的执行计划相同，只看第0个分片的
+    route_single(sql, 0, plan);
+    return;
+  }
+  if (plan_scatter(selects, plan) != RC::SUCCESS) {
+    fail("cross-shard query is not supported", plan);
+  }
+}
+
+RC RoutePlanner::plan_scatter(const Selects &selects, RoutePlan &plan) {
+  // 分片上的语句由SqlWriter重新生成，不支持表达式
+  if (selects.relation_num != 1 || selects.outfile != nullptr || selects.expr_condition_num > 0) {
+    return RC::INVALID_ARGUMENT;
+  }
+  for (size_t i = 0; i < selects.condition_num; i++) {
+    if (selects.conditions[i].sub_select != nullptr) {
+      return RC::INVALID_ARGUMENT;
+    }
+  }
+
+  std::vector<RelAttr> attrs;
+  bool aggregate = false;
+  for (size_t i = selects.attr_num; i > 0; i--) {
+    const RelAttr &attr = selects.attributes[i - 1];
+    if (attr.window != nullptr || attr.is_distinct || attr.expr != nullptr) {
+      return RC::INVALID_ARGUMENT;
+    }
+    if (attr.window_function_name != nullptr) {
+      if (merge_func(attr.window_function_name) == MergeFunc::NONE) {
+        return RC::INVALID_ARGUMENT;
+      }
+      aggregate = true;
+    }
+    attrs.push_back(attr);
+  }
+
+  MergeSpec &merge = plan.merge;
+  merge.aggregate = aggregate;
+  merge.distinct = selects.distinct != 0;
+  merge.has_limit = selects.has_limit != 0;
+  merge.limit = selects.limit;
+  merge.offset = selects.offset;
+  for (size_t i = 0; i < selects.order_num; i++) {
+    const RelAttr &attr = selects.order_attrs[i];
+    MergeOrder order;
+    order.relation = attr.relation_name == nullptr ? "" : attr.relation_name;
+    order.attribute = attr.attribute_name;
+    order.desc = attr.is_desc != 0;
+    merge.orders.push_back(order);
+  }
+
+  std::vector<RelAttr> shard_attrs;
+  std::string shard_sql;
+  RC rc = RC::SUCCESS;
+  if (!aggregate) {
+    // 排序的字段不在结果中时附加在最后，合并之后再去掉
+    shard_attrs = attrs;
+    bool has_star = false;
+    for (const RelAttr &attr : attrs) {
+      has_star = has_star || 0 == strcmp(attr.attribute_name, "*");
+    }
+    for (size_t i = 0; i < selects.order_num && !has_star; i++) {
+      const RelAttr &order_attr = selects.order_attrs[i];
+      bool found = false;
+      for (const RelAttr &attr : shard_attrs) {
+        found = found || same_field(attr, order_attr);
+      }
+      if (!found) {
+        RelAttr hidden = order_attr;
+        hidden.is_desc = 0;
+        shard_attrs.push_back(hidden);
+        merge.hidden_columns++;
+      }
+    }
+    if (merge.distinct && merge.hidden_columns > 0) {
+      return RC::INVALID_ARGUMENT;
+    }
+    // 每个分片最多需要offset + limit行
+    int limit = merge.has_limit ? merge.offset + merge.limit : -1;
+    rc = SqlWriter::write_select(selects, shard_attrs, true, limit, shard_sql);
+  } else {
+    for (const RelAttr &attr : attrs) {
+      MergeColumn column;
+      column.source = (int)shard_attrs.size();
+      if (attr.window_function_name == nullptr) {
+        if (0 == strcmp(attr.attribute_name, "*")) {
+          return RC::INVALID_ARGUMENT;
+        }
+        merge.group_sources.push_back(column.source);
+        shard_attrs.push_back(attr);
+        merge.columns.push_back(column);
+        continue;
+      }
+      column.func = merge_func(attr.window_function_name);
+      switch (column.func) {
+        case MergeFunc::COUNT: {
+          shard_attrs.push_back(partial_attr(attr, "count"));
+        } break;
+        case MergeFunc::SUM: {
+          shard_attrs.push_back(partial_attr(attr, "sum"));
+        } break;
+        case MergeFunc::MIN: {
+          shard_attrs.push_back(partial_attr(attr, "min"));
+        } break;
+        case MergeFunc::MAX: {
+          shard_attrs.push_back(partial_attr(attr, "max"));
+        } break;
+        default: {
+          // avg = 所有分片的sum之和 / 所有分片的count之和
+          shard_attrs.push_back(partial_attr(attr, "sum"));
+          column.count_source = (int)shard_attrs.size();
+          shard_attrs.push_back(partial_attr(attr, "count"));
+        } break;
+      }
+      merge.columns.push_back(column);
+    }
+    for (size_t i = 0; i < selects.group_num; i++) {
+      bool found = false;
+      for (const RelAttr &attr : attrs) {
+        found = found || (attr.window_function_name == nullptr && same_field(attr, selects.group_attrs[i]));
+      }
+      if (!found) {
+        merge.group_sources.push_back((int)shard_attrs.size());
+        shard_attrs.push_back(selects.group_attrs[i]);
+      }
+    }
+    // 只能按结果中的分组字段排序
+    for (size_t i = 0; i < selects.order_num; i++) {
+      bool found = false;
+      for (const RelAttr &attr : attrs) {
+        found = found || (attr.window_function_name == nullptr && same_field(attr, selects.order_attrs[i]));
+      }
+      if (!found) {
+        return RC::INVALID_ARGUMENT;
+      }
+    }
+    rc = SqlWriter::write_select(selects, shard_attrs, false, -1, shard_sql);
+  }
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  plan.type = RouteType::SCATTER;
+  for (int i = 0; i < shard_map_.shard_num(); i++) {
+    ShardRequest request;
+    request.shard = i;
+    request.sql = shard_sql;
+    plan.requests.push_back(request);
+  }
+  return RC::SUCCESS;
+}
+
+RC RoutePlanner::plan_insert(const char *sql, const Inserts &inserts, RoutePlan &plan) {
+  const char *key = shard_map_.shard_key(inserts.relation_name);
+  if (key == nullptr) {
+    route_single(sql, 0, plan);
+    return RC::SUCCESS;
+  }
+  int position = -1;
+  RC rc = resolver_(inserts.relation_name, key, position);
+  if (rc != RC::SUCCESS) {
+    LOG_WARN("Failed to find shard key %s of table %s. rc=%d:%s", key, inserts.relation_name, rc, strrc(rc));
+    fail("cannot find shard key", plan);
+    return RC::SUCCESS;
+  }
+
+  std::vector<std::vector<size_t>> shard_groups(shard_map_.shard_num());
+  int shard_count = 0;
+  int last_shard = 0;
+  for (size_t i = 0; i < inserts.group_num; i++) {
+    // 值的个数不对时由observer报错
+    int shard = (size_t)position < inserts.value_num[i] ? shard_map_.shard_of(inserts.values[i][position]) : 0;
+    if (shard_groups[shard].empty()) {
+      shard_count++;
+    }
+    shard_groups[shard].push_back(i);
+    last_shard = shard;
+  }
+  if (shard_count <= 1) {
+    route_single(sql, last_shard, plan);
+    return RC::SUCCESS;
+  }
+
+  plan.type = RouteType::MULTI;
+  plan.atomic = true;
+  for (int i = 0; i < shard_map_.shard_num(); i++) {
+    if (shard_groups[i].empty()) {
+      continue;
+    }
+    ShardRequest request;
+    request.shard = i;
+    SqlWriter::write_insert(inserts, shard_groups[i], request.sql);
+    plan.requests.push_back(request);
+  }
+  return RC::SUCCESS;
+}
+
+void RoutePlanner::plan_write(const char *sql, const char *table, const Condition conditions[],
+                              size_t condition_num, RoutePlan &plan) {
+  if (!shard_map_.is_sharded(table)) {
+    route_single(sql, 0, plan);
+    return;
+  }
+  int shard = shard_by_conditions(table, true, conditions, condition_num);
+  if (shard >= 0) {
+    route_single(sql, shard, plan);
+  } else {
+    route_all(sql, plan);
+    plan.atomic = true;
+  }
+}
+
+void RoutePlanner::plan_create_table(const char *sql, const CreateTable &create_table, RoutePlan &plan) {
+  const char *key = shard_map_.shard_key(create_table.relation_name);
+  if (key == nullptr) {
+    route_single(sql, 0, plan);
+    return;
+  }
+  bool found = false;
+  for (size_t i = 0; i < create_table.attribute_count; i++) {
+    found = found || 0 == strcmp(create_table.attributes[i].name, key);
+  }
+  if (!found) {
+    fail(std::string("shard key ") + key + " is not a field of table", plan);
+    return;
+  }
+  route_all(sql, plan);
+  plan.ddl_table = create_table.relation_name;
+}
+
+void RoutePlanner::route_table(const char *sql, const char *table, RoutePlan &plan) {
+  if (shard_map_.is_sharded(table)) {
+    route_all(sql, plan);
+  } else {
+    route_single(sql, 0, plan);
+  }
+}
+
+void RoutePlanner::route_all(const char *sql, RoutePlan &plan) {
+  plan.type = RouteType::MULTI;
+  for (int i = 0; i < shard_map_.shard_num(); i++) {
+    ShardRequest request;
+    request.shard = i;
+    request.sql = sql;
+    plan.requests.push_back(request);
+  }
+}
+
+void RoutePlanner::route_single(const char *sql, int shard, RoutePlan &plan) {
+  plan.type = RouteType::SINGLE;
+  ShardRequest request;
+  request.shard = shard;
+  request.sql = sql;
+  plan.requests.push_back(request);
+}
+
+void RoutePlanner::fail(const std::string &reason, RoutePlan &plan) {
+  plan.type = RouteType::FAILURE;
+  plan.requests.clear();
+  plan.reason = reason;
+}
+
+int RoutePlanner::single_shard(const Selects &selects) const {
+  int shard = -1;
+  for (size_t i = 0; i < selects.relation_num; i++) {
+    const char *table = selects.relations[i];
+    int table_shard = 0;
+    if (shard_map_.is_sharded(table)) {
+      table_shard = shard_by_conditions(table, selects.relation_num == 1, selects.conditions, selects.condition_num);
+    }
+    if (table_shard < 0 || (shard >= 0 && shard != table_shard)) {
+      return -1;
+    }
+    shard = table_shard;
+  }
+  for (size_t i = 0; i < selects.condition_num; i++) {
+    if (selects.conditions[i].sub_select == nullptr) {
+      continue;
+    }
+    int sub_shard = single_shard(*selects.conditions[i].sub_select);
+    if (sub_shard < 0 || (shard >= 0 && shard != sub_shard)) {
+      return -1;
+    }
+    shard = sub_shard;
+  }
+  return shard;
+}
+
+int RoutePlanner::shard_by_conditions(const char *table, bool only_table, const Condition conditions[],
+                                      size_t condition_num) const {
+  const char *key = shard_map_.shard_key(table);
+  for (size_t i = 0; i < condition_num; i++) {
+    const Condition &condition = conditions[i];
+    if (condition.comp != EQUAL_TO || condition.sub_select != nullptr ||
+        condition.left_is_attr == condition.right_is_attr) {
+      continue;
+    }
+    const RelAttr &attr = condition.left_is_attr ? condition.left_attr : condition.right_attr;
+    const Value &value = condition.left_is_attr ? condition.right_value : condition.left_value;
+    if (0 != strcmp(attr.attribute_name, key)) {
+      continue;
+    }
+    if (attr.relation_name == nullptr ? only_table : 0 == strcmp(attr.relation_name, table)) {
+      return shard_map_.shard_of(value);
+    }
+  }
+  return -1;
+}
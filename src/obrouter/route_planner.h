@@ -0,0 +1,140 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Decide which shards a statement goes to.
+//
+
+#ifndef __OBROUTER_ROUTE_PLANNER_H__
+#define __OBROUTER_ROUTE_PLANNER_H__
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "rc.h"
+#include "sql/parser/parse_defs.h"
+#include "obrouter/shard_map.h"
+
+enum class RouteType {
+  SINGLE,   // 原样转发给一个分片，结果原样返回
+  MULTI,    // 发给多个分片，合并成一个成功或者失败的结果
+  SCATTER,  // 查询发给所有分片，合并结果集
+  FAILURE,  // 不能路由，比如跨分片的连接
+};
+
+enum class MergeFunc {
+  NONE,   // 普通的列，聚合时是分组键
+  COUNT,
+  SUM,
+  MIN,
+  MAX,
+  AVG,    // 分片上拆成sum和count
+};
+
+/**
+ * 合并之后的一列，source是这一列在分片结果中的位置，AVG的count在count_source
+ */
+struct MergeColumn {
+  MergeFunc func = MergeFunc::NONE;
+  int source = 0;
+  int count_source = -1;
+};
+
+struct MergeOrder {
+  std::string relation;   // 可以为空
+  std::string attribute;
+  bool desc = false;
+};
+
+/**
+ * 怎样把各个分片的结果集合并成一个。
+ * 不是聚合时把所有分片的结果连起来，去重、排序之后取limit，再去掉为了排序附加在最后的hidden_columns列；
+ * 聚合时按分组键合并每个分片的部分聚合结果，输出columns，再排序和取limit
+ */
+struct MergeSpec {
+  bool aggregate = false;
+  bool distinct = false;
+  std::vector<MergeColumn> columns;
+  std::vector<int> group_sources;    // 分片结果中组成分组键的列
+  int hidden_columns = 0;
+  std::vector<MergeOrder> orders;    // 按优先级排列
+  bool has_limit = false;
+  int limit = 0;
+  int offset = 0;
+};
+
+struct ShardRequest {
+  int shard = 0;
+  std::string sql;
+};
+
+struct RoutePlan {
+  RouteType type = RouteType::FAILURE;
+  std::vector<ShardRequest> requests;
+  bool any_success = false;   // MULTI时有一个分片成功就算成功，比如只在部分分片上存在的索引
+  bool atomic = false;        // 修改多个分片上的记录，不在事务中时需要放在一个事务中执行
+  MergeSpec merge;            // SCATTER时使用
+  std::string ddl_table;      // 修改了这个表的结构，缓存的表信息需要失效
+  std::string reason;         // FAILURE的原因
+};
+
+/**
+ * 查询分片键在insert的值中的位置，也就是它在表中是第几个可见的字段
+ */
+typedef std::function<RC(const char *table, const char *key, int &position)> KeyPositionResolver;
+
+/**
+ * 按语法树决定语句发给哪些分片。
+ * 没有分片键的表都在第0个分片上，分片的表在每个分片上都有一份结构相同的表。
+ * select的所有表都能确定在同一个分片上(分片键等值或者没有分片)时原样转发；
+ * 单个分片表的select发给所有分片，聚合函数拆成部分聚合下推，由路由合并；
+ * 其它跨分片的select、预编译语句和savepoint都不支持。
+ * 事务语句由RouterSession处理，不经过这里
+ */
+class RoutePlanner {
+public:
+  RoutePlanner(const ShardMap &shard_map, KeyPositionResolver resolver)
+      : shard_map_(shard_map), resolver_(std::move(resolver))
+  {}
+
+  RC plan(const char *sql, Query *query, RoutePlan &plan);
+
+private:
+  void plan_select(const char *sql, const Selects &selects, RoutePlan &plan);
+  RC plan_scatter(const Selects &selects, RoutePlan &plan);
+  RC plan_insert(const char *sql, const Inserts &inserts, RoutePlan &plan);
+  void plan_write(const char *sql, const char *table, const Condition conditions[], size_t condition_num,
+                  RoutePlan &plan);
+  void plan_create_table(const char *sql, const CreateTable &create_table, RoutePlan &plan);
+  /**
+   * 按表是否分片发给所有分片或者第0个分片
+   */
+  void route_table(const char *sql, const char *table, RoutePlan &plan);
+  void route_all(const char *sql, RoutePlan &plan);
+  void route_single(const char *sql, int shard, RoutePlan &plan);
+  void fail(const std::string &reason, RoutePlan &plan);
+
+  /**
+   * select(包括子查询)中所有的表都能确定在同一个分片上时返回这个分片，否则返回-1
+   */
+  int single_shard(const Selects &selects) const;
+  /**
+   * 条件中table的分片键和一个值相等时返回值所在的分片，否则返回-1
+   */
+  int shard_by_conditions(const char *table, bool only_table, const Condition conditions[],
+                          size_t condition_num) const;
+
+private:
+  const ShardMap &shard_map_;
+  KeyPositionResolver resolver_;
+};
+
+#endif  // __OBROUTER_ROUTE_PLANNER_H__
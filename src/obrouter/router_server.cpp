@@ -0,0 +1,137 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Accept client connections of the router.
+//
+
+#include "obrouter/router_server.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include "common/log/log.h"
+#include "net/wire_protocol.h"
+
+RC RouterServer::listen(int port, const std::string &unix_socket_path) {
+  int yes = 1;
+  if (!unix_socket_path.empty()) {
+    listen_fd_ = socket(PF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+      LOG_ERROR("Failed to create unix socket. error=%s", strerror(errno));
+      return RC::IOERR;
+    }
+    unlink(unix_socket_path.c_str());
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = PF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", unix_socket_path.c_str());
+    if (bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      LOG_ERROR("Failed to bind unix socket %s. error=%s", unix_socket_path.c_str(), strerror(errno));
+      return RC::IOERR;
+    }
+  } else {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+      LOG_ERROR("Failed to create socket. error=%s", strerror(errno));
+      return RC::IOERR;
+    }
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      LOG_ERROR("Failed to bind port %d. error=%s", port, strerror(errno));
+      return RC::IOERR;
+    }
+  }
+  if (::listen(listen_fd_, SOMAXCONN) < 0) {
+    LOG_ERROR("Failed to listen. error=%s", strerror(errno));
+    return RC::IOERR;
+  }
+  LOG_INFO("Router is listening on %s", unix_socket_path.empty() ? std::to_string(port).c_str() : unix_socket_path.c_str());
+  return RC::SUCCESS;
+}
+
+void RouterServer::serve() {
+  while (true) {
+    int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno != EINTR) {
+        LOG_WARN("Failed to accept connection. error=%s", strerror(errno));
+      }
+      continue;
+    }
+    std::thread(&RouterServer::serve_connection, this, fd).detach();
+  }
+}
+
+static bool send_all(int fd, const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::send(fd, data, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+void RouterServer::serve_connection(int fd) {
+  RouterSession session(catalog_);
+  std::string buffer;
+  std::string response;
+  char recv_buf[ROUTER_RECV_BUFFER_SIZE];
+  bool running = true;
+  while (running) {
+    ssize_t len = recv(fd, recv_buf, sizeof(recv_buf), 0);
+    if (len < 0 && errno == EINTR) {
+      continue;
+    }
+    if (len <= 0) {
+      break;
+    }
+    buffer.append(recv_buf, len);
+
+    size_t pos = 0;
+    size_t end;
+    while ((end = buffer.find('\0', pos)) != std::string::npos) {
+      std::string sql = buffer.substr(pos, end - pos);
+      pos = end + 1;
+      if (sql == BINARY_PROTOCOL_HANDSHAKE || sql == SHM_TRANSPORT_HANDSHAKE ||
+          0 == sql.compare(0, strlen(COMPRESSION_HANDSHAKE_PREFIX), COMPRESSION_HANDSHAKE_PREFIX)) {
+        // 路由只支持socket上不压缩的文本协议
+        response = "FAILURE\n";
+      } else {
+        session.handle(sql.c_str(), response);
+      }
+      response.push_back('\0');
+      if (!send_all(fd, response.data(), response.size())) {
+        running = false;
+        break;
+      }
+    }
+    buffer.erase(0, pos);
+  }
+  close(fd);
+}
@@ -0,0 +1,53 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Accept client connections of the router.
+//
+
+#ifndef __OBROUTER_ROUTER_SERVER_H__
+#define __OBROUTER_ROUTER_SERVER_H__
+
+#include <string>
+
+#include "rc.h"
+#include "obrouter/router_session.h"
+#include "obrouter/shard_map.h"
+
+#define ROUTER_PORT_DEFAULT 6790
+#define ROUTER_RECV_BUFFER_SIZE 8192
+
+/**
+ * 路由的服务端，和observer一样使用文本协议：请求是以'\0'结尾的sql，结果以'\0'结尾。
+ * 每个客户端连接一个线程，语句在这个线程中同步地发给分片
+ */
+class RouterServer {
+public:
+  explicit RouterServer(const ShardMap &shard_map) : catalog_(shard_map)
+  {}
+
+  /**
+   * unix_socket_path不为空时监听unix socket，否则监听TCP的port
+   */
+  RC listen(int port, const std::string &unix_socket_path);
+  /**
+   * 接受连接，不会返回
+   */
+  void serve();
+
+private:
+  void serve_connection(int fd);
+
+private:
+  RouterCatalog catalog_;
+  int listen_fd_ = -1;
+};
+
+#endif  // __OBROUTER_ROUTER_SERVER_H__
@@ -0,0 +1,255 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// One client connection of the router.
+//
+
+#include "obrouter/router_session.h"
+
+#include <string.h>
+
+#include "common/log/log.h"
+#include "obrouter/result_merger.h"
+#include "sql/parser/parse.h"
+
+#define ROUTER_FAILURE "FAILURE\n"
+
+bool RouterCatalog::key_position(const std::string &table, int &position) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto iter = key_positions_.find(table);
+  if (iter == key_positions_.end()) {
+    return false;
+  }
+  position = iter->second;
+  return true;
+}
+
+void RouterCatalog::set_key_position(const std::string &table, int position) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  key_positions_[table] = position;
+}
+
+void RouterCatalog::invalidate(const std::string &table) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  key_positions_.erase(table);
+}
+
+RouterSession::RouterSession(RouterCatalog &catalog)
+    : catalog_(catalog),
+      planner_(catalog.shard_map(),
+          [this](const char *table, const char *key, int &position) { return key_position(table, key, position); }),
+      clients_(catalog.shard_map().shard_num()),
+      trx_shards_(catalog.shard_map().shard_num(), false) {
+}
+
+void RouterSession::handle(const char *sql, std::string &response) {
+  Query *query = query_create();
+  RoutePlan plan;
+  RC rc = parse(sql, query);
+  if (rc != RC::SUCCESS) {
+    // 解析失败时由第0个分片返回错误
+    plan.type = RouteType::SINGLE;
+    plan.requests.push_back(ShardRequest{0, sql});
+  } else if (query->flag == SCF_BEGIN) {
+    in_trx_ = true;
+    response = "SUCCESS";
+    query_destroy(query);
+    return;
+  } else if (query->flag == SCF_COMMIT || query->flag == SCF_ROLLBACK) {
+    finish_trx(query->flag == SCF_COMMIT ? "commit;" : "rollback;", response);
+    query_destroy(query);
+    return;
+  } else {
+    planner_.plan(sql, query, plan);
+  }
+
+  if (plan.atomic && !in_trx_ && plan.requests.size() > 1) {
+    // 一个分片失败时回滚所有分片，和单机时一样要么都成功要么都失败。
+    // 提交时不是两阶段提交，提交的过程中出错仍然可能只有部分分片提交了
+    in_trx_ = true;
+    execute(plan, response);
+    bool success = 0 == response.compare(0, 7, "SUCCESS");
+    std::string finish_response;
+    finish_trx(success ? "commit;" : "rollback;", finish_response);
+    if (success && 0 != finish_response.compare(0, 7, "SUCCESS")) {
+      response = ROUTER_FAILURE;
+    }
+  } else {
+    execute(plan, response);
+  }
+  if (rc == RC::SUCCESS && query->flag == SCF_SET_VARIABLE && 0 == response.compare(0, 7, "SUCCESS")) {
+    variables_.push_back(sql);
+  }
+  if (!plan.ddl_table.empty()) {
+    catalog_.invalidate(plan.ddl_table);
+  }
+  query_destroy(query);
+}
+
+void RouterSession::execute(const RoutePlan &plan, std::string &response) {
+  if (plan.type == RouteType::FAILURE) {
+    LOG_INFO("Cannot route statement: %s", plan.reason.c_str());
+    response = ROUTER_FAILURE;
+    return;
+  }
+
+  RC rc = RC::SUCCESS;
+  std::vector<ShardClient *> clients;
+  for (const ShardRequest &request : plan.requests) {
+    ShardClient *shard_client = client(request.shard);
+    if (shard_client == nullptr || (rc = join_trx(request.shard)) != RC::SUCCESS ||
+        (rc = shard_client->send(request.sql)) != RC::SUCCESS) {
+      rc = rc == RC::SUCCESS ? RC::IOERR : rc;
+      break;
+    }
+    clients.push_back(shard_client);
+  }
+  // 已经发出的请求都要收到结果，否则连接上的下一个结果就错位了
+  std::vector<WireResult> results(clients.size());
+  for (size_t i = 0; i < clients.size(); i++) {
+    RC receive_rc = clients[i]->receive(results[i]);
+    if (rc == RC::SUCCESS) {
+      rc = receive_rc;
+    }
+  }
+  if (rc != RC::SUCCESS) {
+    LOG_WARN("Failed to execute statement on shards. rc=%d:%s", rc, strrc(rc));
+    response = ROUTER_FAILURE;
+    return;
+  }
+
+  switch (plan.type) {
+    case RouteType::SINGLE: {
+      response = results.front().text();
+    } break;
+    case RouteType::MULTI: {
+      ResultMerger::merge_status(results, plan.any_success, response);
+    } break;
+    default: {
+      ResultMerger::merge_rows(plan.merge, results, response);
+    } break;
+  }
+}
+
+void RouterSession::finish_trx(const char *sql, std::string &response) {
+  std::vector<ShardClient *> clients;
+  RC rc = RC::SUCCESS;
+  for (size_t i = 0; i < trx_shards_.size(); i++) {
+    if (!trx_shards_[i]) {
+      continue;
+    }
+    trx_shards_[i] = false;
+    ShardClient *shard_client = clients_[i].get();
+    if (shard_client == nullptr || shard_client->send(sql) != RC::SUCCESS) {
+      rc = RC::IOERR_WRITE;
+      continue;
+    }
+    clients.push_back(shard_client);
+  }
+  in_trx_ = false;
+
+  response = "SUCCESS";
+  std::vector<WireResult> results(clients.size());
+  for (size_t i = 0; i < clients.size(); i++) {
+    if (clients[i]->receive(results[i]) != RC::SUCCESS) {
+      rc = RC::IOERR_READ;
+    }
+  }
+  if (rc != RC::SUCCESS) {
+    LOG_WARN("Failed to finish transaction on some shards: %s", sql);
+    response = ROUTER_FAILURE;
+  } else if (!results.empty()) {
+    ResultMerger::merge_status(results, false, response);
+  }
+}
+
+ShardClient *RouterSession::client(int shard) {
+  std::unique_ptr<ShardClient> &shard_client = clients_[shard];
+  if (shard_client != nullptr && shard_client->connected()) {
+    return shard_client.get();
+  }
+  if (trx_shards_[shard]) {
+    // 事务中断开的连接，分片上的事务已经回滚了
+    LOG_WARN("Connection to shard %d was lost in transaction", shard);
+    return nullptr;
+  }
+  shard_client.reset(new ShardClient());
+  if (shard_client->connect(catalog_.shard_map().shard(shard)) != RC::SUCCESS) {
+    shard_client.reset();
+    return nullptr;
+  }
+  for (const std::string &variable : variables_) {
+    WireResult result;
+    if (shard_client->execute(variable, result) != RC::SUCCESS) {
+      shard_client.reset();
+      return nullptr;
+    }
+  }
+  return shard_client.get();
+}
+
+RC RouterSession::join_trx(int shard) {
+  if (!in_trx_ || trx_shards_[shard]) {
+    return RC::SUCCESS;
+  }
+  WireResult result;
+  RC rc = clients_[shard]->execute("begin;", result);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  if (0 != result.message().compare(0, 7, "SUCCESS")) {
+    LOG_WARN("Failed to begin transaction on shard %d: %s", shard, result.message().c_str());
+    return RC::GENERIC_ERROR;
+  }
+  trx_shards_[shard] = true;
+  return RC::SUCCESS;
+}
+
+RC RouterSession::key_position(const char *table, const char *key, int &position) {
+  if (catalog_.key_position(table, position)) {
+    return RC::SUCCESS;
+  }
+
+  // 每个分片上的表结构相同，从第0个分片上查
+  ShardClient *shard_client = client(0);
+  if (shard_client == nullptr) {
+    return RC::IOERR;
+  }
+  WireResult result;
+  RC rc = shard_client->execute(std::string("desc ") + table + ";", result);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  // 每个字段一行：\tfield name=id, type=ints, len=4, visible=yes, ...
+  const std::string &desc = result.message();
+  const std::string prefix = "\tfield name=";
+  int visible_index = 0;
+  size_t pos = 0;
+  while ((pos = desc.find(prefix, pos)) != std::string::npos) {
+    pos += prefix.size();
+    size_t name_end = desc.find(',', pos);
+    size_t line_end = desc.find('\n', pos);
+    if (name_end == std::string::npos || line_end == std::string::npos || name_end > line_end) {
+      break;
+    }
+    if (desc.find("visible=no", name_end) < line_end) {
+      continue;
+    }
+    if (desc.compare(pos, name_end - pos, key) == 0) {
+      position = visible_index;
+      catalog_.set_key_position(table, position);
+      return RC::SUCCESS;
+    }
+    visible_index++;
+  }
+  return RC::SCHEMA_FIELD_MISSING;
+}
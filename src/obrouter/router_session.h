@@ -0,0 +1,94 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// One client connection of the router.
+//
+
+#ifndef __OBROUTER_ROUTER_SESSION_H__
+#define __OBROUTER_ROUTER_SESSION_H__
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rc.h"
+#include "obrouter/route_planner.h"
+#include "obrouter/shard_client.h"
+#include "obrouter/shard_map.h"
+
+/**
+ * 所有会话共享的信息：分片的配置和分片键在表中的位置
+ */
+class RouterCatalog {
+public:
+  explicit RouterCatalog(const ShardMap &shard_map) : shard_map_(shard_map)
+  {}
+
+  const ShardMap &shard_map() const
+  {
+    return shard_map_;
+  }
+
+  bool key_position(const std::string &table, int &position);
+  void set_key_position(const std::string &table, int position);
+  /**
+   * 表的结构变了
+   */
+  void invalidate(const std::string &table);
+
+private:
+  const ShardMap &shard_map_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, int> key_positions_;
+};
+
+/**
+ * 一个客户端连接。到每个分片的连接在第一次用到时建立，和客户端连接的生命周期相同。
+ * begin只在路由上记下事务开始，之后第一次发给某个分片的语句之前在这个分片上begin；
+ * commit和rollback依次发给参与的分片，不是两阶段提交，某个分片提交失败时其它分片可能已经提交了。
+ * 不在事务中时，修改多个分片上记录的语句也放在一个这样的事务中，有分片失败时全部回滚。
+ * set语句发给所有已经连接的分片，之后新建的连接上也会先执行一遍
+ */
+class RouterSession {
+public:
+  explicit RouterSession(RouterCatalog &catalog);
+
+  /**
+   * 处理一条语句，response是和observer文本协议相同的结果，不包括结尾的'\0'
+   */
+  void handle(const char *sql, std::string &response);
+
+private:
+  /**
+   * 按计划执行，先把请求发给所有分片，再依次接收结果
+   */
+  void execute(const RoutePlan &plan, std::string &response);
+  void finish_trx(const char *sql, std::string &response);
+
+  ShardClient *client(int shard);
+  /**
+   * 事务中第一次用到这个分片时在它上面开始事务
+   */
+  RC join_trx(int shard);
+  RC key_position(const char *table, const char *key, int &position);
+
+private:
+  RouterCatalog &catalog_;
+  RoutePlanner planner_;
+  std::vector<std::unique_ptr<ShardClient>> clients_;
+  std::vector<std::string> variables_;  // 执行过的set语句
+  bool in_trx_ = false;
+  std::vector<bool> trx_shards_;         // 参与当前事务的分片
+};
+
+#endif  // __OBROUTER_ROUTER_SESSION_H__
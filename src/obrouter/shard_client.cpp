@@ -0,0 +1,175 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// A connection from the router to one shard.
+//
+
+#include "obrouter/shard_client.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "common/log/log.h"
+
+#define SHARD_RECV_BUFFER_SIZE 65536
+
+ShardClient::~ShardClient() {
+  close();
+}
+
+static int connect_tcp(const ShardAddress &address) {
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *addrs = nullptr;
+  std::string port = std::to_string(address.port);
+  if (getaddrinfo(address.host.c_str(), port.c_str(), &hints, &addrs) != 0 || addrs == nullptr) {
+    LOG_WARN("Failed to resolve shard %s", address.to_string().c_str());
+    return -1;
+  }
+  int fd = socket(addrs->ai_family, addrs->ai_socktype, addrs->ai_protocol);
+  if (fd >= 0 && ::connect(fd, addrs->ai_addr, addrs->ai_addrlen) != 0) {
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addrs);
+  if (fd >= 0) {
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+  }
+  return fd;
+}
+
+static int connect_unix(const ShardAddress &address) {
+  int fd = socket(PF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  struct sockaddr_un sockaddr;
+  memset(&sockaddr, 0, sizeof(sockaddr));
+  sockaddr.sun_family = PF_UNIX;
+  snprintf(sockaddr.sun_path, sizeof(sockaddr.sun_path), "%s", address.unix_path.c_str());
+  if (::connect(fd, (struct sockaddr *)&sockaddr, sizeof(sockaddr)) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+RC ShardClient::connect(const ShardAddress &address) {
+  close();
+  fd_ = address.host.empty() ? connect_unix(address) : connect_tcp(address);
+  if (fd_ < 0) {
+    LOG_WARN("Failed to connect to shard %s. error=%s", address.to_string().c_str(), strerror(errno));
+    return RC::IOERR;
+  }
+
+  // 和obclient -b相同，先约定使用二进制协议
+  const char handshake[] = BINARY_PROTOCOL_HANDSHAKE;
+  WireResult result;
+  RC rc = send(std::string(handshake, sizeof(handshake) - 1));
+  if (rc == RC::SUCCESS) {
+    rc = receive(result);
+  }
+  if (rc != RC::SUCCESS) {
+    LOG_WARN("Failed to negotiate binary protocol with shard %s", address.to_string().c_str());
+    close();
+  }
+  return rc;
+}
+
+void ShardClient::close() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  buffer_.clear();
+}
+
+RC ShardClient::send(const std::string &sql) {
+  if (fd_ < 0) {
+    return RC::IOERR;
+  }
+  // 请求以'\0'结尾
+  const char *data = sql.c_str();
+  size_t left = sql.size() + 1;
+  while (left > 0) {
+    ssize_t len = ::send(fd_, data, left, MSG_NOSIGNAL);
+    if (len < 0 && errno == EINTR) {
+      continue;
+    }
+    if (len <= 0) {
+      LOG_WARN("Failed to send request to shard. error=%s", strerror(errno));
+      close();
+      return RC::IOERR_WRITE;
+    }
+    data += len;
+    left -= len;
+  }
+  return RC::SUCCESS;
+}
+
+RC ShardClient::receive(WireResult &result) {
+  if (fd_ < 0) {
+    return RC::IOERR;
+  }
+  char recv_buf[SHARD_RECV_BUFFER_SIZE];
+  size_t pos = 0;
+  while (true) {
+    while (buffer_.size() - pos >= WIRE_FRAME_HEADER_SIZE) {
+      char type = buffer_[pos];
+      uint32_t len = wire_get_u32(buffer_.data() + pos + 1);
+      if (buffer_.size() - pos - WIRE_FRAME_HEADER_SIZE < len) {
+        break;
+      }
+      const char *data = buffer_.data() + pos + WIRE_FRAME_HEADER_SIZE;
+      pos += WIRE_FRAME_HEADER_SIZE + len;
+      if (type == WIRE_FRAME_END) {
+        buffer_.erase(0, pos);
+        return RC::SUCCESS;
+      }
+      RC rc = result.add_frame(type, data, len);
+      if (rc != RC::SUCCESS) {
+        LOG_WARN("Received invalid frame from shard, type=%d", type);
+        close();
+        return rc;
+      }
+    }
+    buffer_.erase(0, pos);
+    pos = 0;
+
+    ssize_t len = recv(fd_, recv_buf, sizeof(recv_buf), 0);
+    if (len < 0 && errno == EINTR) {
+      continue;
+    }
+    if (len <= 0) {
+      LOG_WARN("Connection to shard was broken. error=%s", len == 0 ? "closed" : strerror(errno));
+      close();
+      return RC::IOERR_READ;
+    }
+    buffer_.append(recv_buf, len);
+  }
+}
+
+RC ShardClient::execute(const std::string &sql, WireResult &result) {
+  RC rc = send(sql);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  return receive(result);
+}
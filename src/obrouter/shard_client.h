@@ -0,0 +1,61 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// A connection from the router to one shard.
+//
+
+#ifndef __OBROUTER_SHARD_CLIENT_H__
+#define __OBROUTER_SHARD_CLIENT_H__
+
+#include <string>
+
+#include "rc.h"
+#include "obrouter/shard_map.h"
+#include "obrouter/wire_result.h"
+
+/**
+ * 到一个分片的连接，使用二进制协议，这样结果集中的值带着类型，合并时不用再解析文本
+ */
+class ShardClient {
+public:
+  ShardClient() = default;
+  ~ShardClient();
+
+  ShardClient(const ShardClient &) = delete;
+  ShardClient &operator=(const ShardClient &) = delete;
+
+  RC connect(const ShardAddress &address);
+  void close();
+  bool connected() const
+  {
+    return fd_ >= 0;
+  }
+
+  /**
+   * 发送一条语句。可以先发给所有分片再依次接收结果，这样各个分片同时执行
+   */
+  RC send(const std::string &sql);
+  /**
+   * 接收一条语句的结果，直到WIRE_FRAME_END。出错时关闭连接
+   */
+  RC receive(WireResult &result);
+
+  /**
+   * 发送并接收结果
+   */
+  RC execute(const std::string &sql, WireResult &result);
+
+private:
+  int fd_ = -1;
+  std::string buffer_;
+};
+
+#endif  // __OBROUTER_SHARD_CLIENT_H__
@@ -0,0 +1,134 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Which shard every table and record lives on.
+//
+
+#include "obrouter/shard_map.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common/lang/string.h"
+#include "common/log/log.h"
+#include "common/time/datetime.h"
+
+std::string ShardAddress::to_string() const {
+  if (host.empty()) {
+    return unix_path;
+  }
+  return host + ":" + std::to_string(port);
+}
+
+static void split_list(const std::string &list, std::vector<std::string> &items) {
+  std::vector<std::string> parts;
+  common::split_string(list, ",", parts);
+  for (std::string &part : parts) {
+    common::strip(part);
+    if (!part.empty()) {
+      items.push_back(part);
+    }
+  }
+}
+
+RC ShardMap::init(const std::string &shards, const std::string &shard_keys) {
+  shards_.clear();
+  shard_keys_.clear();
+
+  std::vector<std::string> items;
+  split_list(shards, items);
+  if (items.empty() || items.size() > MAX_SHARD_NUM) {
+    LOG_ERROR("Invalid shard number %d, should be in [1, %d]", (int)items.size(), MAX_SHARD_NUM);
+    return RC::INVALID_ARGUMENT;
+  }
+  for (const std::string &item : items) {
+    ShardAddress address;
+    size_t colon = item.rfind(':');
+    if (colon == std::string::npos) {
+      address.unix_path = item;
+    } else {
+      address.host = item.substr(0, colon);
+      char *end = nullptr;
+      long port = strtol(item.c_str() + colon + 1, &end, 10);
+      if (address.host.empty() || *end != '\0' || port <= 0 || port > 65535) {
+        LOG_ERROR("Invalid shard address %s", item.c_str());
+        return RC::INVALID_ARGUMENT;
+      }
+      address.port = (int)port;
+    }
+    shards_.push_back(address);
+  }
+
+  items.clear();
+  split_list(shard_keys, items);
+  for (const std::string &item : items) {
+    size_t dot = item.find('.');
+    if (dot == std::string::npos || dot == 0 || dot + 1 == item.size()) {
+      LOG_ERROR("Invalid shard key %s, should be table.column", item.c_str());
+      return RC::INVALID_ARGUMENT;
+    }
+    shard_keys_[item.substr(0, dot)] = item.substr(dot + 1);
+  }
+  return RC::SUCCESS;
+}
+
+const char *ShardMap::shard_key(const char *table) const {
+  if (table == nullptr) {
+    return nullptr;
+  }
+  auto iter = shard_keys_.find(table);
+  return iter == shard_keys_.end() ? nullptr : iter->second.c_str();
+}
+
+uint64_t ShardMap::hash(const std::string &canonical) {
+  uint64_t h = 14695981039346656037ULL;
+  for (unsigned char c : canonical) {
+    h ^= c;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+std::string ShardMap::canonical(const Value &value) {
+  char buf[64];
+  switch (value.type) {
+    case INTS: {
+      return std::to_string(*(int *)value.data);
+    }
+    case FLOATS: {
+      float v = *(float *)value.data;
+      if (v == floorf(v) && fabsf(v) < 1e15) {
+        snprintf(buf, sizeof(buf), "%lld", (long long)v);
+      } else {
+        snprintf(buf, sizeof(buf), "%.9g", v);
+      }
+      return buf;
+    }
+    case DATES: {
+      common::format_date(*(int *)value.data, buf);
+      return buf;
+    }
+    case CHARS: {
+      return (const char *)value.data;
+    }
+    default: {
+      return "";
+    }
+  }
+}
+
+int ShardMap::shard_of(const Value &value) const {
+  if (value.is_null || value.type == NULLS || value.type == UNDEFINED) {
+    return 0;
+  }
+  return (int)(hash(canonical(value)) % shards_.size());
+}
@@ -0,0 +1,88 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Which shard every table and record lives on.
+//
+
+#ifndef __OBROUTER_SHARD_MAP_H__
+#define __OBROUTER_SHARD_MAP_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rc.h"
+#include "sql/parser/parse_defs.h"
+
+#define MAX_SHARD_NUM 64
+
+/**
+ * 一个分片是一个observer，host为空时port_or_path是unix socket的路径
+ */
+struct ShardAddress {
+  std::string host;
+  int port = 0;
+  std::string unix_path;
+
+  std::string to_string() const;
+};
+
+/**
+ * 表到分片的映射。配置了分片键的表按分片键的哈希值把记录分到所有分片上，
+ * 其它的表只放在第0个分片上。
+ * 分片键的值先转换成和类型无关的字符串再计算FNV-1a，这样整数1、浮点数1.0和字符串'1'落在同一个分片上，
+ * 和observer比较不同类型的值时的规则一致
+ */
+class ShardMap {
+public:
+  /**
+   * shards是逗号分隔的host:port，没有':'的是unix socket的路径；
+   * shard_keys是逗号分隔的table.column，可以为空
+   */
+  RC init(const std::string &shards, const std::string &shard_keys);
+
+  int shard_num() const
+  {
+    return (int)shards_.size();
+  }
+  const ShardAddress &shard(int index) const
+  {
+    return shards_[index];
+  }
+
+  /**
+   * 表的分片键，没有配置的返回nullptr
+   */
+  const char *shard_key(const char *table) const;
+  bool is_sharded(const char *table) const
+  {
+    return shard_key(table) != nullptr;
+  }
+
+  /**
+   * 分片键的值所在的分片，NULL放在第0个分片上
+   */
+  int shard_of(const Value &value) const;
+
+  static uint64_t hash(const std::string &canonical);
+  /**
+   * 值的规范形式：整数和没有小数部分的浮点数是十进制整数，日期是yyyy-mm-dd，字符串是原样
+   */
+  static std::string canonical(const Value &value);
+
+private:
+  std::vector<ShardAddress> shards_;
+  std::unordered_map<std::string, std::string> shard_keys_;  // 表名 -> 分片键
+};
+
+#endif  // __OBROUTER_SHARD_MAP_H__
@@ -0,0 +1,179 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Turn parsed statements back into sql that is sent to the shards.
+//
+
+#include "obrouter/sql_writer.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/time/datetime.h"
+
+static const char *COMP_OP_NAMES[] = {"=", "<=", "<>", "<", ">=", ">", "is null", "is not null", "like", "not like"};
+
+void SqlWriter::write_value(const Value &value, std::string &out) {
+  if (value.is_null || value.type == NULLS) {
+    out.append("null");
+    return;
+  }
+  switch (value.type) {
+    case INTS: {
+      out.append(std::to_string(*(int *)value.data));
+    } break;
+    case FLOATS: {
+      // 词法分析要求浮点数有小数部分，取能还原出相同float的最短写法
+      float v = *(float *)value.data;
+      char buf[128];
+      for (int precision = 1; precision <= 12; precision++) {
+        snprintf(buf, sizeof(buf), "%.*f", precision, v);
+        if (strtof(buf, nullptr) == v) {
+          break;
+        }
+      }
+      out.append(buf);
+    } break;
+    case DATES: {
+      char buf[DATE_STRING_LEN + 1];
+      common::format_date(*(int *)value.data, buf);
+      out.push_back('\'');
+      out.append(buf);
+      out.push_back('\'');
+    } break;
+    default: {
+      const char *s = (const char *)value.data;
+      char quote = strchr(s, '\'') == nullptr ? '\'' : '"';
+      out.push_back(quote);
+      out.append(s);
+      out.push_back(quote);
+    } break;
+  }
+}
+
+static void write_field(const RelAttr &attr, std::string &out) {
+  if (attr.relation_name != nullptr) {
+    out.append(attr.relation_name);
+    out.push_back('.');
+  }
+  out.append(attr.attribute_name);
+}
+
+void SqlWriter::write_attr(const RelAttr &attr, std::string &out) {
+  if (attr.window_function_name == nullptr) {
+    write_field(attr, out);
+    return;
+  }
+  for (const char *p = attr.window_function_name; *p; p++) {
+    out.push_back((char)tolower(*p));
+  }
+  out.push_back('(');
+  if (attr.is_distinct) {
+    out.append("distinct ");
+  }
+  write_field(attr, out);
+  out.push_back(')');
+}
+
+RC SqlWriter::write_conditions(const Condition conditions[], size_t condition_num, std::string &out) {
+  for (size_t i = 0; i < condition_num; i++) {
+    const Condition &condition = conditions[i];
+    if (condition.sub_select != nullptr || condition.comp > NOT_LIKE_OP) {
+      return RC::INVALID_ARGUMENT;
+    }
+    out.append(i == 0 ? " where " : " and ");
+    if (condition.left_is_attr) {
+      write_field(condition.left_attr, out);
+    } else {
+      write_value(condition.left_value, out);
+    }
+    if (condition.comp == IS_NULL) {
+      out.append(" is null");
+      continue;
+    }
+    if (condition.comp == IS_NOT_NULL) {
+      out.append(" is not null");
+      continue;
+    }
+    out.push_back(' ');
+    out.append(COMP_OP_NAMES[condition.comp]);
+    out.push_back(' ');
+    if (condition.right_is_attr) {
+      write_field(condition.right_attr, out);
+    } else {
+      write_value(condition.right_value, out);
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC SqlWriter::write_select(const Selects &selects, const std::vector<RelAttr> &attrs, bool include_order, int limit,
+                           std::string &out) {
+  out.append("select ");
+  if (selects.distinct) {
+    out.append("distinct ");
+  }
+  for (size_t i = 0; i < attrs.size(); i++) {
+    if (i > 0) {
+      out.append(", ");
+    }
+    write_attr(attrs[i], out);
+  }
+  out.append(" from ");
+  for (size_t i = selects.relation_num; i > 0; i--) {
+    if (i != selects.relation_num) {
+      out.append(", ");
+    }
+    out.append(selects.relations[i - 1]);
+  }
+  RC rc = write_conditions(selects.conditions, selects.condition_num, out);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  for (size_t i = 0; i < selects.group_num; i++) {
+    out.append(i == 0 ? " group by " : ", ");
+    write_field(selects.group_attrs[i], out);
+  }
+  if (include_order) {
+    for (size_t i = 0; i < selects.order_num; i++) {
+      const RelAttr &attr = selects.order_attrs[i];
+      out.append(i == 0 ? " order by " : ", ");
+      write_field(attr, out);
+      out.append(attr.is_desc ? " desc" : " asc");
+    }
+  }
+  if (limit >= 0) {
+    out.append(" limit ");
+    out.append(std::to_string(limit));
+  }
+  out.push_back(';');
+  return RC::SUCCESS;
+}
+
+void SqlWriter::write_insert(const Inserts &inserts, const std::vector<size_t> &groups, std::string &out) {
+  out.append("insert into ");
+  out.append(inserts.relation_name);
+  out.append(" values");
+  for (size_t i = 0; i < groups.size(); i++) {
+    size_t group = groups[i];
+    out.append(i == 0 ? " (" : ", (");
+    for (size_t j = 0; j < inserts.value_num[group]; j++) {
+      if (j > 0) {
+        out.append(", ");
+      }
+      write_value(inserts.values[group][j], out);
+    }
+    out.push_back(')');
+  }
+  out.push_back(';');
+}
@@ -0,0 +1,49 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Turn parsed statements back into sql that is sent to the shards.
+//
+
+#ifndef __OBROUTER_SQL_WRITER_H__
+#define __OBROUTER_SQL_WRITER_H__
+
+#include <string>
+#include <vector>
+
+#include "rc.h"
+#include "sql/parser/parse_defs.h"
+
+/**
+ * 把语法树重新写成sql，发给分片的语句由此生成。
+ * 只支持路由需要改写的语句：单表的select和insert，带子查询的条件返回RC::INVALID_ARGUMENT
+ */
+class SqlWriter {
+public:
+  static void write_value(const Value &value, std::string &out);
+  /**
+   * 字段或者聚合函数，比如t.id、count(*)、sum(score)
+   */
+  static void write_attr(const RelAttr &attr, std::string &out);
+  static RC write_conditions(const Condition conditions[], size_t condition_num, std::string &out);
+
+  /**
+   * select语句。attrs是要查询的列，按照输出的顺序，而不是Selects中相反的顺序；
+   * limit小于0时不写limit子句；include_order为false时不写order by
+   */
+  static RC write_select(const Selects &selects, const std::vector<RelAttr> &attrs, bool include_order, int limit,
+                         std::string &out);
+  /**
+   * insert语句，只插入groups中的这几组值
+   */
+  static void write_insert(const Inserts &inserts, const std::vector<size_t> &groups, std::string &out);
+};
+
+#endif  // __OBROUTER_SQL_WRITER_H__
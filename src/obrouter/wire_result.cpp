@@ -0,0 +1,205 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Results received from a shard over the binary wire protocol.
+//
+
+#include "obrouter/wire_result.h"
+
+#include <stdio.h>
+#include <string.h>
+
+WireValue WireValue::make_int(int64_t v) {
+  WireValue value;
+  value.type = WIRE_VALUE_INT;
+  value.int_value = v;
+  return value;
+}
+
+WireValue WireValue::make_float(double v) {
+  WireValue value;
+  value.type = WIRE_VALUE_FLOAT;
+  value.float_value = v;
+  return value;
+}
+
+int WireValue::compare(const WireValue &other) const {
+  if (is_null() || other.is_null()) {
+    return (int)other.is_null() - (int)is_null();
+  }
+  if (type == WIRE_VALUE_INT && other.type == WIRE_VALUE_INT) {
+    return int_value < other.int_value ? -1 : (int_value > other.int_value ? 1 : 0);
+  }
+  if (is_number() && other.is_number()) {
+    double a = as_double();
+    double b = other.as_double();
+    return a < b ? -1 : (a > b ? 1 : 0);
+  }
+  if (is_number() != other.is_number()) {
+    std::string a;
+    std::string b;
+    to_text(a);
+    other.to_text(b);
+    return strcmp(a.c_str(), b.c_str());
+  }
+  return strcmp(string_value.c_str(), other.string_value.c_str());
+}
+
+void WireValue::to_text(std::string &out) const {
+  switch (type) {
+    case WIRE_VALUE_NULL: {
+      out.append("NULL");
+    } break;
+    case WIRE_VALUE_INT: {
+      out.append(std::to_string((int)int_value));
+    } break;
+    case WIRE_VALUE_FLOAT: {
+      char ftos[64];
+      snprintf(ftos, sizeof(ftos), "%.2f", (float)float_value);
+      int s_end = strlen(ftos) - 1;
+      while (ftos[s_end] == '0') {
+        --s_end;
+      }
+      if (ftos[s_end] == '.') {
+        ftos[s_end] = '\0';
+      } else {
+        ftos[s_end + 1] = '\0';
+      }
+      out.append(ftos);
+    } break;
+    default: {
+      out.append(string_value);
+    } break;
+  }
+}
+
+void WireResult::header_text(const std::vector<std::string> &headers, std::string &out) {
+  for (size_t i = 0; i < headers.size(); i++) {
+    if (i > 0) {
+      out.append(" | ");
+    }
+    out.append(headers[i]);
+  }
+  out.push_back('\n');
+}
+
+void WireResult::row_text(const WireRow &row, std::string &out) {
+  for (size_t i = 0; i < row.size(); i++) {
+    if (i > 0) {
+      out.append(" | ");
+    }
+    row[i].to_text(out);
+  }
+  out.push_back('\n');
+}
+
+RC WireResult::add_frame(char type, const char *data, uint32_t len) {
+  switch (type) {
+    case WIRE_FRAME_MESSAGE: {
+      message_.append(data, len);
+      text_.append(data, len);
+      return RC::SUCCESS;
+    }
+    case WIRE_FRAME_SCHEMA: {
+      return add_schema(data, len);
+    }
+    case WIRE_FRAME_ROWS: {
+      return add_rows(data, len);
+    }
+    default: {
+      return RC::IOERR_READ;
+    }
+  }
+}
+
+RC WireResult::add_schema(const char *data, uint32_t len) {
+  const char *end = data + len;
+  if (len < 2) {
+    return RC::IOERR_READ;
+  }
+  int column_num = wire_get_u16(data);
+  data += 2;
+  headers_.clear();
+  column_types_.clear();
+  for (int i = 0; i < column_num; i++) {
+    if (end - data < 3) {
+      return RC::IOERR_READ;
+    }
+    int column_type = (uint8_t)data[0];
+    uint16_t name_len = wire_get_u16(data + 1);
+    data += 3;
+    if (end - data < name_len) {
+      return RC::IOERR_READ;
+    }
+    headers_.emplace_back(data, name_len);
+    column_types_.push_back(column_type);
+    data += name_len;
+  }
+  has_schema_ = true;
+  header_text(headers_, text_);
+  return RC::SUCCESS;
+}
+
+RC WireResult::add_rows(const char *data, uint32_t len) {
+  const char *end = data + len;
+  if (len < 4) {
+    return RC::IOERR_READ;
+  }
+  uint32_t row_num = wire_get_u32(data);
+  data += 4;
+  for (uint32_t r = 0; r < row_num; r++) {
+    if (end - data < 2) {
+      return RC::IOERR_READ;
+    }
+    int value_num = wire_get_u16(data);
+    data += 2;
+    WireRow row(value_num);
+    for (int i = 0; i < value_num; i++) {
+      if (data >= end) {
+        return RC::IOERR_READ;
+      }
+      WireValue &value = row[i];
+      value.type = (uint8_t)*data++;
+      switch (value.type) {
+        case WIRE_VALUE_NULL: {
+        } break;
+        case WIRE_VALUE_INT: {
+          if (end - data < 4) {
+            return RC::IOERR_READ;
+          }
+          value.int_value = (int32_t)wire_get_u32(data);
+          data += 4;
+        } break;
+        case WIRE_VALUE_FLOAT: {
+          if (end - data < 4) {
+            return RC::IOERR_READ;
+          }
+          value.float_value = wire_get_f32(data);
+          data += 4;
+        } break;
+        case WIRE_VALUE_STRING: {
+          if (end - data < 2 || end - data - 2 < wire_get_u16(data)) {
+            return RC::IOERR_READ;
+          }
+          uint16_t str_len = wire_get_u16(data);
+          value.string_value.assign(data + 2, str_len);
+          data += 2 + str_len;
+        } break;
+        default: {
+          return RC::IOERR_READ;
+        }
+      }
+    }
+    row_text(row, text_);
+    rows_.push_back(std::move(row));
+  }
+  return RC::SUCCESS;
+}
@@ -0,0 +1,127 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Results received from a shard over the binary wire protocol.
+//
+
+#ifndef __OBROUTER_WIRE_RESULT_H__
+#define __OBROUTER_WIRE_RESULT_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "rc.h"
+#include "net/wire_protocol.h"
+
+/**
+ * 结果中的一个值，类型是WireValueType，日期按字符串发送
+ */
+struct WireValue {
+  int type = WIRE_VALUE_NULL;
+  int64_t int_value = 0;
+  double float_value = 0;
+  std::string string_value;
+
+  static WireValue make_int(int64_t v);
+  static WireValue make_float(double v);
+
+  bool is_null() const
+  {
+    return type == WIRE_VALUE_NULL;
+  }
+  bool is_number() const
+  {
+    return type == WIRE_VALUE_INT || type == WIRE_VALUE_FLOAT;
+  }
+  double as_double() const
+  {
+    return type == WIRE_VALUE_INT ? (double)int_value : float_value;
+  }
+
+  /**
+   * NULL最小，数字按数值比较，其它按字符串比较
+   */
+  int compare(const WireValue &other) const;
+  bool operator==(const WireValue &other) const
+  {
+    return type == other.type && compare(other) == 0;
+  }
+  /**
+   * 和obclient打印的格式相同，浮点数按float保留两位小数并去掉末尾的0
+   */
+  void to_text(std::string &out) const;
+};
+
+typedef std::vector<WireValue> WireRow;
+
+/**
+ * 一个分片对一条语句的结果。message是没有结果集的语句的文本结果，比如"SUCCESS\n"；
+ * 有结果集时has_schema为true，headers和rows是结果集
+ */
+class WireResult {
+public:
+  /**
+   * 处理收到的一帧，帧的格式错误时返回RC::IOERR_READ
+   */
+  RC add_frame(char type, const char *data, uint32_t len);
+
+  bool has_schema() const
+  {
+    return has_schema_;
+  }
+  const std::string &message() const
+  {
+    return message_;
+  }
+  const std::vector<std::string> &headers() const
+  {
+    return headers_;
+  }
+  const std::vector<int> &column_types() const
+  {
+    return column_types_;
+  }
+  std::vector<WireRow> &rows()
+  {
+    return rows_;
+  }
+  const std::vector<WireRow> &rows() const
+  {
+    return rows_;
+  }
+
+  /**
+   * 和observer文本协议相同的结果，消息和结果集按收到的顺序排列
+   */
+  const std::string &text() const
+  {
+    return text_;
+  }
+
+  static void header_text(const std::vector<std::string> &headers, std::string &out);
+  static void row_text(const WireRow &row, std::string &out);
+
+private:
+  RC add_schema(const char *data, uint32_t len);
+  RC add_rows(const char *data, uint32_t len);
+
+private:
+  bool has_schema_ = false;
+  std::string message_;
+  std::vector<std::string> headers_;
+  std::vector<int> column_types_;
+  std::vector<WireRow> rows_;
+  std::string text_;
+};
+
+#endif  // __OBROUTER_WIRE_RESULT_H__
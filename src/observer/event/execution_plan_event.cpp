@@ -23,7 +23,9 @@ ExecutionPlanEvent::~ExecutionPlanEvent() {
   //   sql_event_->doneImmediate();
   // }
 
-  query_destroy(sqls_);
-  sqls_ = nullptr;
+  if (sqls_ != nullptr) {
+    query_destroy(sqls_);
+    sqls_ = nullptr;
+  }
 }
 
@@ -17,24 +17,70 @@ See the Mulan PSL v2 for more details. */
 
 #include "common/seda/stage_event.h"
 #include "sql/parser/parse.h"
+#include "sql/optimizer/join_planner.h"
 
 class SQLStageEvent;
 
 class ExecutionPlanEvent : public common::StageEvent {
 public:
+  /**
+   * 重查询的准入状态，见AdmissionControl。WAITING的event在等待队列中，被唤醒时是ADMITTED或者TIMEOUT
+   */
+  enum class AdmissionState {
+    NONE,
+    WAITING,
+    ADMITTED,
+    TIMEOUT,
+  };
+
   ExecutionPlanEvent(SQLStageEvent *sql_event, Query *sqls);
   virtual ~ExecutionPlanEvent();
 
   Query * sqls() const {
     return sqls_;
   }
+  /**
+   * 取走语句，之后由调用者释放。游标的执行计划引用语句中的数据，要和游标一起保存
+   */
+  Query * release_sqls() {
+    Query *sqls = sqls_;
+    sqls_ = nullptr;
+    return sqls;
+  }
 
   SQLStageEvent * sql_event() const {
     return sql_event_;
   }
+
+  /**
+   * 多表查询时由优化器选择的join顺序
+   */
+  JoinPlan & join_plan() {
+    return join_plan_;
+  }
+
+  AdmissionState admission_state() const {
+    return admission_state_;
+  }
+  void set_admission_state(AdmissionState state) {
+    admission_state_ = state;
+  }
+
+  /**
+   * 要扫描的页面已经交给PageLoader异步加载过，重新执行时不再加载
+   */
+  bool pages_loaded() const {
+    return pages_loaded_;
+  }
+  void set_pages_loaded() {
+    pages_loaded_ = true;
+  }
 private:
   SQLStageEvent *      sql_event_;
   Query *             sqls_;
+  JoinPlan            join_plan_;
+  AdmissionState      admission_state_ = AdmissionState::NONE;
+  bool                pages_loaded_ = false;
 };
 
 #endif // __OBSERVER_EVENT_EXECUTION_PLAN_EVENT_H__
\ No newline at end of file
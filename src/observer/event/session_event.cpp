@@ -13,8 +13,11 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include "session_event.h"
+#include "net/server.h"
+#include "net/wire_protocol.h"
 
-SessionEvent::SessionEvent(ConnectionContext *client) : client_(client) {
+SessionEvent::SessionEvent(ConnectionContext *client, std::string &&request)
+    : client_(client), request_(std::move(request)) {
 }
 
 SessionEvent::~SessionEvent() {
@@ -32,15 +35,53 @@ void SessionEvent::set_response(const char *response) {
 }
 
 void SessionEvent::set_response(const char *response, int len) {
+  if (binary_protocol()) {
+    response_.clear();
+    wire_put_frame(response_, WIRE_FRAME_MESSAGE, response, len);
+    return;
+  }
   response_.assign(response, len);
 }
 
 void SessionEvent::set_response(std::string &&response) {
+  if (binary_protocol()) {
+    set_response(response.data(), response.size());
+    return;
+  }
   response_ = std::move(response);
 }
 
+void SessionEvent::end_response() {
+  if (response_.empty() && !response_sent_) {
+    set_response("No data\n");
+  }
+  if (binary_protocol()) {
+    wire_frame_begin(response_, WIRE_FRAME_END);
+  } else if (response_.empty() || response_.back() != '\0') {
+    response_.push_back('\0');
+  }
+}
+
+bool SessionEvent::append_response(const char *response, int len) {
+  if (send_failed_) {
+    return false;
+  }
+  response_.append(response, len);
+  if (response_.size() < RESPONSE_CHUNK_SIZE) {
+    return true;
+  }
+  // 连接由session stage最后发送时关闭，这里只标记发送失败
+  if (Server::send_chunk(client_, response_.data(), response_.size()) != 0) {
+    send_failed_ = true;
+    return false;
+  }
+  response_sent_ = true;
+  response_.clear();
+  return true;
+}
+
 int SessionEvent::get_response_len() const { return response_.size(); }
 
-char *SessionEvent::get_request_buf() { return client_->buf; }
+const char *SessionEvent::get_request_buf() const { return request_.c_str(); }
 
-int SessionEvent::get_request_buf_len() { return SOCKET_BUFFER_SIZE; }
\ No newline at end of file
+int SessionEvent::get_request_buf_len() const { return request_.size(); }
\ No newline at end of file
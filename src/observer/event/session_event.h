@@ -20,26 +20,64 @@ See the Mulan PSL v2 for more details. */
 
 #include "common/seda/stage_event.h"
 #include "net/connection_context.h"
+#include "session/slow_query_log.h"
+
+// 分块发送结果时每一块的大小
+#define RESPONSE_CHUNK_SIZE (64 * 1024)
 
 class SessionEvent : public common::StageEvent {
 public:
-  SessionEvent(ConnectionContext *client);
+  SessionEvent(ConnectionContext *client, std::string &&request);
   virtual ~SessionEvent();
 
   ConnectionContext *get_client() const;
 
+  /**
+   * 连接是否使用二进制协议。是的话set_response设置的文本会放在WIRE_FRAME_MESSAGE帧中，
+   * append_response追加的结果需要调用者按帧编码好
+   */
+  bool binary_protocol() const {
+    return client_->binary_protocol;
+  }
+
   const char *get_response() const;
   void set_response(const char *response);
   void set_response(const char *response, int len);
   void set_response(std::string &&response);
+  /**
+   * 追加按连接的协议编码好的结果。没有发送的结果超过RESPONSE_CHUNK_SIZE时先发送给客户端，
+   * 这样结果很大时不需要全部放在内存中。发送失败时返回false，之后的结果都不再发送
+   */
+  bool append_response(const char *response, int len);
+  /**
+   * 在结果最后加上结束标记：文本协议是'\0'，二进制协议是WIRE_FRAME_END。没有任何结果时先放入"No data\n"
+   */
+  void end_response();
+  /**
+   * 是否已经发送过一部分结果
+   */
+  bool response_sent() const {
+    return response_sent_;
+  }
   int get_response_len() const;
-  char *get_request_buf();
-  int get_request_buf_len();
+  const char *get_request_buf() const;
+  int get_request_buf_len() const;
+
+  /**
+   * 语句在各个stage中的耗时，用于慢查询日志
+   */
+  QueryTrace &query_trace() {
+    return query_trace_;
+  }
 
 private:
   ConnectionContext *client_;
+  std::string request_;  // 一个连接上可能同时收到多个请求，每个事件保存自己的请求
 
   std::string response_;
+  bool response_sent_ = false;
+  bool send_failed_ = false;
+  QueryTrace query_trace_;
 };
 
 #endif //__OBSERVER_SESSION_SESSIONEVENT_H__
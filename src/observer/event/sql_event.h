@@ -16,7 +16,9 @@ See the Mulan PSL v2 for more details. */
 #define __OBSERVER_SQL_EVENT_SQLEVENT_H__
 
 #include "common/seda/stage_event.h"
+#include "sql/query_cache/query_cache.h"
 #include <string>
+#include <vector>
 
 class SessionEvent;
 
@@ -32,9 +34,24 @@ public:
   SessionEvent * session_event() const {
     return session_event_;
   }
+
+  /**
+   * 查询结果缓存使用的key，为空时结果不放进缓存
+   */
+  std::string &query_cache_key() {
+    return query_cache_key_;
+  }
+  /**
+   * 执行查询之前记录的表的版本，和结果一起放进缓存
+   */
+  std::vector<TableVersion> &table_versions() {
+    return table_versions_;
+  }
 private:
   SessionEvent *session_event_;
   std::string & sql_;
+  std::string query_cache_key_;
+  std::vector<TableVersion> table_versions_;
   // void *context_;
 };
 
@@ -22,8 +22,15 @@ See the Mulan PSL v2 for more details. */
 #define MAX_CONNECTION_NUM_DEFAULT 8192
 #define PORT "PORT"
 #define PORT_DEFAULT 16880
+// 处理连接读事件的IO线程数，0表示监听线程自己处理所有连接
+#define IO_THREAD_NUM "IO_THREAD_NUM"
+#define IO_THREAD_NUM_DEFAULT 0
+// 客户端选择了结果压缩时，一次发送的数据到这么多字节才压缩
+#define COMPRESSION_THRESHOLD "COMPRESSION_THRESHOLD"
 
+// 连接的接收缓冲区按SOCKET_BUFFER_SIZE大小的块按需分配，空闲时归还。一个请求不能超过MAX_REQUEST_SIZE
 #define SOCKET_BUFFER_SIZE 8192
+#define MAX_REQUEST_SIZE (64 * 1024 * 1024)
 
 #define SESSION_STAGE_NAME "SessionStage"
 #endif //__SRC_OBSERVER_INI_SETTING_H__
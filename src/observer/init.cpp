@@ -115,6 +115,15 @@ int init_log(ProcessParam *process_cfg, Ini &properties) {
       g_log->set_default_module(it->second);
     }
 
+    // 异步写日志，请求线程只把日志放到自己的缓冲区中
+    key = ("LOG_ASYNC");
+    it = log_section.find(key);
+    if (it != log_section.end()) {
+      int async = 0;
+      str_to_val(it->second, async);
+      g_log->set_async(async != 0);
+    }
+
     if (process_cfg->is_demon()) {
       sys_log_redirect(log_file_name.c_str(), log_file_name.c_str());
     }
@@ -25,6 +25,8 @@ See the Mulan PSL v2 for more details. */
 #include "common/os/signal.h"
 #include "net/server.h"
 #include "net/server_param.h"
+#include "net/wire_compression.h"
+#include "storage/default/disk_buffer_pool.h"
 
 using namespace common;
 
@@ -111,10 +113,26 @@ Server *init_server() {
     }
   }
 
+  int io_thread_num = IO_THREAD_NUM_DEFAULT;
+  it = net_section.find(IO_THREAD_NUM);
+  if (it != net_section.end()) {
+    std::string str = it->second;
+    str_to_val(str, io_thread_num);
+  }
+
+  int compression_threshold = WIRE_COMPRESSION_THRESHOLD_DEFAULT;
+  it = net_section.find(COMPRESSION_THRESHOLD);
+  if (it != net_section.end()) {
+    std::string str = it->second;
+    str_to_val(str, compression_threshold);
+  }
+
   ServerParam server_param;
   server_param.listen_addr = listen_addr;
   server_param.max_connection_num = max_connection_num;
   server_param.port = port;
+  server_param.io_thread_num = io_thread_num < 0 ? 0 : io_thread_num;
+  server_param.compression_threshold = compression_threshold < 0 ? 0 : compression_threshold;
 
   if (process_param->get_unix_socket_path().size() > 0) {
     server_param.use_unix_socket = true;
@@ -133,6 +151,9 @@ Server *init_server() {
 void *quit_thread_func(void *_signum) {
   intptr_t signum = (intptr_t)_signum;
   LOG_INFO("Receive signal: %ld", signum);
+  // 记录缓冲池中的页面，下次启动时预热
+  stop_global_buffer_pool_warm_up();
+  dump_global_buffer_pool_pages();
   if (g_server) {
     g_server->shutdown();
     delete g_server;
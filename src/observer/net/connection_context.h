@@ -18,15 +18,52 @@ See the Mulan PSL v2 for more details. */
 #include <event.h>
 #include <ini_setting.h>
 
+#include <deque>
+#include <string>
+
+#include "net/net_buffer.h"
+#include "net/shm_ring.h"
+
 class Session;
 
+/**
+ * 连接切换到共享内存传输之后的状态，见net/shm_ring.h
+ */
+struct ShmChannel {
+  void *mem = nullptr;
+  size_t size = 0;
+  ShmRing requests;            // 客户端写，IO线程读
+  ShmRing responses;           // 生成结果的线程持有连接的mutex写，客户端读
+  int request_fd = -1;         // 请求的eventfd，IO线程等待，客户端读出结果之后也通过它通知
+  int response_fd = -1;        // 结果的eventfd，客户端等待
+  struct event notify_event;   // request_fd的读事件
+};
+
 typedef struct _ConnectionContext {
   Session *session;
   int fd;
   struct event read_event;
   pthread_mutex_t mutex;
   char addr[24];
-  char buf[SOCKET_BUFFER_SIZE];
+  NetBuffer buf;  // 收到的数据，一个请求分多次到达时跨读事件保留
+  // 已经收到但是还没有执行的请求，按收到的顺序逐个执行，保证结果的顺序和请求一致
+  std::deque<std::string> pending_requests;
+  bool busy;         // 有请求正在执行
+  bool peer_closed;  // 客户端已经关闭，等正在执行的请求结束、结果发送完后再关闭连接
+  bool binary_protocol;  // 客户端通过握手选择了二进制协议，见net/wire_protocol.h
+  int compression;       // 客户端通过握手选择的WireCompression，之后发送的数据都放在压缩帧中，见net/wire_compression.h
+  ShmChannel *shm;       // 客户端通过握手切换到了共享内存传输，之后的请求和结果都经过共享内存
+
+  // 没有立即发送出去的结果按顺序排队，由连接所属的IO线程在socket可写时发送
+  struct event write_event;
+  int notify_fd;                    // 连接所属IO线程的通知管道
+  std::deque<std::string> output;   // 等待发送的数据
+  size_t output_offset;             // output第一块中已经发送的长度
+  size_t output_bytes;              // output中还没有发送的总长度
+  pthread_cond_t output_cond;       // 排队的数据太多时生成结果的线程等待发送
+  bool write_pending;               // 写事件已经加入event_base
+  bool write_failed;                // 发送失败，之后的数据都丢弃
+  bool closing;                     // 已经通知IO线程关闭连接
 } ConnectionContext;
 
 #endif //__SRC_OBSERVER_NET_CONNECTION_CONTEXT_H__
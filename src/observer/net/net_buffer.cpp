@@ -0,0 +1,118 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Receive buffer of a connection, made of blocks taken from a shared pool.
+//
+
+#include "net/net_buffer.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "common/mm/mpool.h"
+
+// 连接关闭时缓冲区也会还回块，池不随静态对象析构
+static common::MemPool<NetBufferBlock> &block_pool() {
+  static common::MemPool<NetBufferBlock> *pool = new common::MemPool<NetBufferBlock>();
+  return *pool;
+}
+
+NetBuffer::~NetBuffer() {
+  for (NetBufferBlock *block : blocks_) {
+    block_pool().put(block);
+  }
+  blocks_.clear();
+}
+
+char *NetBuffer::write_space(int &len) {
+  if (blocks_.empty() || tail_ == SOCKET_BUFFER_SIZE) {
+    NetBufferBlock *block = block_pool().get();
+    if (block == nullptr) {
+      len = 0;
+      return nullptr;
+    }
+    blocks_.push_back(block);
+    if (blocks_.size() == 1) {
+      head_ = 0;
+    }
+    tail_ = 0;
+  }
+  len = SOCKET_BUFFER_SIZE - tail_;
+  return blocks_.back()->data + tail_;
+}
+
+void NetBuffer::commit(int len) {
+  tail_ += len;
+  size_ += len;
+}
+
+bool NetBuffer::pop_message(std::string &message) {
+  // 从上次结束的地方接着找'\0'
+  int pos = scanned_;
+  int offset = head_ + pos;
+  size_t index = offset / SOCKET_BUFFER_SIZE;
+  offset %= SOCKET_BUFFER_SIZE;
+  int msg_len = -1;
+  while (pos < size_) {
+    const char *begin = blocks_[index]->data + offset;
+    int len = std::min(SOCKET_BUFFER_SIZE - offset, size_ - pos);
+    const char *end = (const char *)memchr(begin, 0, len);
+    if (end != nullptr) {
+      msg_len = pos + (int)(end - begin);
+      break;
+    }
+    pos += len;
+    index++;
+    offset = 0;
+  }
+  if (msg_len < 0) {
+    scanned_ = size_;
+    return false;
+  }
+
+  message.clear();
+  message.reserve(msg_len);
+  int remain = msg_len + 1;
+  while (remain > 0) {
+    int len = std::min(SOCKET_BUFFER_SIZE - head_, remain);
+    if (blocks_.size() == 1) {
+      len = std::min(tail_ - head_, remain);
+    }
+    // 不包括最后的'\0'
+    message.append(blocks_.front()->data + head_, remain == len ? len - 1 : len);
+    head_ += len;
+    size_ -= len;
+    remain -= len;
+    if (head_ == SOCKET_BUFFER_SIZE) {
+      pop_front_block();
+    }
+  }
+  scanned_ = 0;
+  return true;
+}
+
+void NetBuffer::reclaim() {
+  if (size_ != 0) {
+    return;
+  }
+  while (!blocks_.empty()) {
+    pop_front_block();
+  }
+  head_ = 0;
+  tail_ = 0;
+}
+
+void NetBuffer::pop_front_block() {
+  block_pool().put(blocks_.front());
+  blocks_.pop_front();
+  head_ = 0;
+}
@@ -0,0 +1,77 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Receive buffer of a connection, made of blocks taken from a shared pool.
+//
+
+#ifndef __SRC_OBSERVER_NET_NET_BUFFER_H__
+#define __SRC_OBSERVER_NET_NET_BUFFER_H__
+
+#include <deque>
+#include <string>
+
+#include "ini_setting.h"
+
+struct NetBufferBlock {
+  char data[SOCKET_BUFFER_SIZE];
+};
+
+/**
+ * 连接的接收缓冲区。数据放在一串固定大小的块里，需要时才从全局的池中取，
+ * 数据取完之后块就还回池中，空闲的连接不占用缓冲区。请求的长度只受MAX_REQUEST_SIZE限制。
+ * 不是线程安全的，由连接的mutex保护
+ */
+class NetBuffer {
+public:
+  NetBuffer() = default;
+  ~NetBuffer();
+
+  NetBuffer(const NetBuffer &) = delete;
+  NetBuffer &operator=(const NetBuffer &) = delete;
+
+  /**
+   * 返回可以写入数据的位置，len返回可写的长度。没有空间时分配一个新块，内存不足时返回nullptr
+   */
+  char *write_space(int &len);
+  /**
+   * 在write_space返回的位置写入了len字节
+   */
+  void commit(int len);
+
+  /**
+   * 取出第一个以'\0'结尾的消息，不包括'\0'。没有完整的消息时返回false
+   */
+  bool pop_message(std::string &message);
+
+  /**
+   * 没有数据时把所有块还回池中
+   */
+  void reclaim();
+
+  int size() const {
+    return size_;
+  }
+  int block_num() const {
+    return (int)blocks_.size();
+  }
+
+private:
+  void pop_front_block();
+
+private:
+  std::deque<NetBufferBlock *> blocks_;
+  int head_ = 0;     // 第一个块中数据的起始位置
+  int tail_ = 0;     // 最后一个块中数据的结束位置
+  int size_ = 0;     // 数据总长度
+  int scanned_ = 0;  // 从头开始已经确认没有'\0'的长度，避免一个大请求分多次到达时重复查找
+};
+
+#endif  //__SRC_OBSERVER_NET_NET_BUFFER_H__
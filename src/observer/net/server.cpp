@@ -19,11 +19,15 @@ See the Mulan PSL v2 for more details. */
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 
@@ -31,7 +35,9 @@ See the Mulan PSL v2 for more details. */
 #include "common/log/log.h"
 #include "common/seda/seda_config.h"
 #include "event/session_event.h"
+#include "net/wire_compression.h"
 #include "session/session.h"
+#include "session/session_pool.h"
 #include "ini_setting.h"
 #include <common/metrics/metrics_registry.h>
 
@@ -39,14 +45,26 @@ using namespace common;
 static const std::string READ_SOCKET_METRIC_TAG = "SessionStage.readsocket";
 static const std::string WRITE_SOCKET_METRIC_TAG = "SessionStage.writesocket";
 
+// 发送缓冲区一直是满的超过这个时间就认为客户端已经不再接收
+#define SEND_WAIT_TIMEOUT_MS 60000
+// 连接的发送队列超过这个长度时，生成结果的线程等IO线程发送一部分再继续
+#define OUTPUT_QUEUE_HIGH_WATER (4 * 1024 * 1024)
+// 一次sendmsg最多发送的块数
+#define OUTPUT_IOV_MAX 64
+
+// 当前线程是哪个IO线程，用通知管道区分。不是IO线程时是-1
+static thread_local int current_notify_fd = -1;
+
 Stage *Server::session_stage_ = nullptr;
-common::SimpleTimer *Server::read_socket_metric_ = nullptr;
-common::SimpleTimer *Server::write_socket_metric_ = nullptr;
+common::LatencyHistogram *Server::read_socket_metric_ = nullptr;
+common::LatencyHistogram *Server::write_socket_metric_ = nullptr;
+int Server::compression_threshold_ = WIRE_COMPRESSION_THRESHOLD_DEFAULT;
 
 ServerParam::ServerParam() {
   listen_addr = INADDR_ANY;
   max_connection_num = MAX_CONNECTION_NUM_DEFAULT;
   port = PORT_DEFAULT;
+  compression_threshold = WIRE_COMPRESSION_THRESHOLD_DEFAULT;
 }
 
 Server::Server(ServerParam input_server_param) : server_param_(input_server_param) {
@@ -54,6 +72,7 @@ Server::Server(ServerParam input_server_param) : server_param_(input_server_para
   server_socket_ = 0;
   event_base_ = nullptr;
   listen_ev_ = nullptr;
+  compression_threshold_ = server_param_.compression_threshold;
 }
 
 Server::~Server() {
@@ -67,12 +86,12 @@ void Server::init(){
 
   MetricsRegistry &metricsRegistry = get_metrics_registry();
   if (Server::read_socket_metric_ == nullptr) {
-    Server::read_socket_metric_ = new SimpleTimer();
+    Server::read_socket_metric_ = new LatencyHistogram();
     metricsRegistry.register_metric(READ_SOCKET_METRIC_TAG, Server::read_socket_metric_);
   }
 
   if (Server::write_socket_metric_ == nullptr) {
-    Server::write_socket_metric_ = new SimpleTimer();
+    Server::write_socket_metric_ = new LatencyHistogram();
     metricsRegistry.register_metric(WRITE_SOCKET_METRIC_TAG, Server::write_socket_metric_);
   }  
 }
@@ -96,111 +115,629 @@ int Server::set_non_block(int fd) {
 void Server::close_connection(ConnectionContext *client_context) {
   LOG_INFO("Close connection of %s.", client_context->addr);
   event_del(&client_context->read_event);
+  event_del(&client_context->write_event);
+  if (client_context->shm != nullptr) {
+    event_del(&client_context->shm->notify_event);
+    free_shm_channel(client_context->shm);
+    client_context->shm = nullptr;
+  }
   ::close(client_context->fd);
-  delete client_context->session;
+  SessionPool::instance().release(client_context->session);
   client_context->session = nullptr;
+  pthread_cond_destroy(&client_context->output_cond);
   delete client_context;
 }
 
+void Server::free_shm_channel(ShmChannel *shm) {
+  if (shm->mem != nullptr) {
+    munmap(shm->mem, shm->size);
+  }
+  if (shm->request_fd >= 0) {
+    ::close(shm->request_fd);
+  }
+  if (shm->response_fd >= 0) {
+    ::close(shm->response_fd);
+  }
+  delete shm;
+}
+
+void Server::async_close_connection(ConnectionContext *client_context) {
+  if (in_io_thread(client_context)) {
+    close_connection(client_context);
+    return;
+  }
+  if (post_command(client_context->notify_fd, Reactor::CLOSE_CONNECTION, client_context) != 0) {
+    LOG_ERROR("Failed to notify io thread to close connection %s", client_context->addr);
+  }
+}
+
+bool Server::in_io_thread(ConnectionContext *client_context) {
+  return client_context->notify_fd == current_notify_fd;
+}
+
+// client->mutex必须已经加锁。没有请求在执行、没有数据等待发送，连接也不会再用时，返回true并标记为关闭中，
+// 由调用者关闭连接
+bool Server::idle_after_close(ConnectionContext *client) {
+  if (client->closing || client->busy || client->write_pending || !client->output.empty()) {
+    return false;
+  }
+  if (!client->peer_closed && !client->write_failed) {
+    return false;
+  }
+  client->closing = true;
+  return true;
+}
+
 void Server::recv(int fd, short ev, void *arg) {
   ConnectionContext *client = (ConnectionContext *)arg;
-  //Server::send(sev->getClient(), sev->getRequestBuf(), strlen(sev->getRequestBuf()));
 
-  int data_len = 0;
+  NetBuffer &buf = client->buf;
   int read_len = 0;
-  int buf_size = sizeof(client->buf);
-  memset(client->buf, 0, buf_size);
+  bool no_memory = false;
 
-  TimerStat timer_stat(*read_socket_metric_);
+  LatencyStat timer_stat(*read_socket_metric_);
   MUTEX_LOCK(&client->mutex);
-	// 持续接收消息，直到遇到'\0'。将'\0'遇到的后续数据直接丢弃没有处理，因为目前仅支持一收一发的模式
-  while (true) {
-    read_len = ::read(client->fd, client->buf + data_len, buf_size - data_len);
-    if (read_len < 0) {
-      if (errno == EAGAIN) {
-        continue;
-      }
+  // 读出socket中已有的数据，接在上次收到的部分后面。没有数据时直接返回，等下次读事件，
+  // 不会因为客户端发送得慢而占住IO线程。一次最多读MAX_REQUEST_SIZE，剩下的等下次读事件
+  while (buf.size() < MAX_REQUEST_SIZE) {
+    int space_len = 0;
+    char *space = buf.write_space(space_len);
+    if (space == nullptr) {
+      no_memory = true;
       break;
     }
-    if (read_len == 0) {
-      break;
+    read_len = ::read(client->fd, space, space_len);
+    if (read_len > 0) {
+      buf.commit(read_len);
+      continue;
+    }
+    if (read_len < 0 && errno == EINTR) {
+      continue;
     }
+    break;
+  }
+  const bool would_block = read_len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+  const int saved_errno = errno;
+
+  bool closing = false;
+  if (no_memory) {
+    LOG_ERROR("Failed to alloc receive buffer for %s\n", client->addr);
+    closing = true;
+  } else if (read_len == 0) {
+    LOG_INFO("The peer has been closed %s\n", client->addr);
+    closing = true;
+  } else if (read_len < 0 && !would_block) {
+    LOG_ERROR("Failed to read socket of %s, %s\n", client->addr, strerror(saved_errno));
+    closing = true;
+  }
+  timer_stat.end();
+  handle_received(client, closing);
+}
 
-    if (read_len + data_len > buf_size) {
-      data_len += read_len;
-      break;
+void Server::handle_received(ConnectionContext *client, bool closing) {
+  // 一个请求以'\0'结束。取出所有完整的请求排队，不完整的部分留在缓冲区，等下次读事件接着收
+  NetBuffer &buf = client->buf;
+  std::string message;
+  while (buf.pop_message(message)) {
+    LOG_INFO("receive command(size=%d): %s", (int)message.size() + 1, message.c_str());
+    client->pending_requests.push_back(std::move(message));
+  }
+  buf.reclaim();
+
+  if (!closing && buf.size() >= MAX_REQUEST_SIZE) {
+    LOG_WARN("The length of sql exceeds the limitation %d\n", MAX_REQUEST_SIZE);
+    closing = true;
+  }
+
+  // 同一个连接上的请求逐个执行，前一个请求的结果发送完之后由request_done执行下一个
+  std::string request;
+  bool dispatch = false;
+  if (!client->busy && !client->pending_requests.empty()) {
+    request = std::move(client->pending_requests.front());
+    client->pending_requests.pop_front();
+    client->busy = true;
+    dispatch = true;
+  }
+  bool close_now = false;
+  if (closing) {
+    // 已经收到的请求还要执行完，结果也要发送完，不再读数据，等连接空闲时再关闭
+    client->peer_closed = true;
+    event_del(&client->read_event);
+    if (client->shm != nullptr) {
+      // 客户端不会再读共享内存中的结果，排队的结果都丢弃
+      event_del(&client->shm->notify_event);
+      client->write_failed = true;
+      client->output.clear();
+      client->output_offset = 0;
+      client->output_bytes = 0;
+      pthread_cond_broadcast(&client->output_cond);
     }
+    close_now = idle_after_close(client);
+  }
+  MUTEX_UNLOCK(&client->mutex);
+
+  if (close_now) {
+    close_connection(client);
+    return;
+  }
+  if (dispatch) {
+    dispatch_request(client, std::move(request));
+  }
+}
+
+void Server::on_shm_notify(int fd, short ev, void *arg) {
+  ConnectionContext *client = (ConnectionContext *)arg;
+  ShmChannel *shm = client->shm;
 
+  // eventfd是非阻塞的，读出计数清掉通知即可，请求和空间都重新检查
+  uint64_t count = 0;
+  while (::read(fd, &count, sizeof(count)) < 0 && errno == EINTR) {
+  }
 
-    bool msg_end = false;
-    for(int i = 0; i < read_len; i++) {
-      if (client->buf[data_len + i] == 0) {
-        data_len += i + 1;
-        msg_end = true;
+  LatencyStat timer_stat(*read_socket_metric_);
+  MUTEX_LOCK(&client->mutex);
+  // 请求环中的数据和socket收到的一样放到接收缓冲区中，一次最多读MAX_REQUEST_SIZE
+  NetBuffer &buf = client->buf;
+  bool no_memory = false;
+  bool corrupted = false;
+  while (buf.size() < MAX_REQUEST_SIZE) {
+    if (shm->requests.readable() == 0) {
+      // IO线程总是在等下一次通知，设置之后再检查一次，避免错过客户端刚写入的请求
+      shm->requests.header()->consumer_waiting.store(1);
+      if (shm->requests.readable() == 0) {
         break;
       }
     }
-
-    if (msg_end) {
+    int space_len = 0;
+    char *space = buf.write_space(space_len);
+    if (space == nullptr) {
+      no_memory = true;
       break;
     }
-
-    data_len += read_len;
+    const size_t len = shm->requests.read(space, space_len);
+    if (len == SHM_RING_CORRUPTED) {
+      corrupted = true;
+      break;
+    }
+    buf.commit((int)len);
+  }
+  shm_notify_producer(shm->requests, shm->response_fd);
+  if (no_memory) {
+    LOG_ERROR("Failed to alloc receive buffer for %s\n", client->addr);
+  }
+  if (corrupted) {
+    LOG_ERROR("Request ring of %s is corrupted, close the connection\n", client->addr);
   }
 
-  MUTEX_UNLOCK(&client->mutex);
+  // 客户端读出了结果，排队的结果接着写到结果环中，有进展时重新开始计时
+  if (!client->output.empty()) {
+    const size_t output_bytes = client->output_bytes;
+    flush_output(client, false);
+    if (client->output.empty()) {
+      event_del(&client->write_event);
+      client->write_pending = false;
+    } else if (client->write_pending && client->output_bytes < output_bytes) {
+      struct timeval timeout = {SEND_WAIT_TIMEOUT_MS / 1000, 0};
+      event_add(&client->write_event, &timeout);
+    }
+  }
   timer_stat.end();
+  handle_received(client, no_memory || corrupted);
+}
 
-  if(data_len > buf_size) {
-    LOG_WARN("The length of sql exceeds the limitation %d\n", buf_size);
-    close_connection(client);
-    return;
-  }
-  if (read_len == 0) {
-    LOG_INFO("The peer has been closed %s\n", client->addr);
-    close_connection(client);
-    return;
-  } else if (read_len < 0) {
-    LOG_ERROR("Failed to read socket of %s, %s\n", client->addr,
-              strerror(errno));
-    close_connection(client);
-    return;
+void Server::dispatch_request(ConnectionContext *client, std::string &&request) {
+  SessionEvent *sev = new SessionEvent(client, std::move(request));
+  session_stage_->add_event(sev);
+}
+
+void Server::request_done(ConnectionContext *client) {
+  std::string request;
+  bool dispatch = false;
+  bool close_now = false;
+
+  MUTEX_LOCK(&client->mutex);
+  if (!client->pending_requests.empty()) {
+    request = std::move(client->pending_requests.front());
+    client->pending_requests.pop_front();
+    dispatch = true;
+  } else {
+    client->busy = false;
+    close_now = idle_after_close(client);
   }
+  MUTEX_UNLOCK(&client->mutex);
 
-  LOG_INFO("receive command(size=%d): %s", data_len, client->buf);
-  SessionEvent *sev = new SessionEvent(client);
-  session_stage_->add_event(sev);
+  if (close_now) {
+    async_close_connection(client);
+  } else if (dispatch) {
+    dispatch_request(client, std::move(request));
+  }
 }
 
 // 这个函数仅负责发送数据，至于是否是一个完整的消息，由调用者控制
 int Server::send(ConnectionContext *client, const char *buf, int data_len) {
+  int ret = send_chunk(client, buf, data_len);
+  if (ret != 0) {
+    close_after_send_failure(client);
+  }
+  return ret;
+}
+
+void Server::close_after_send_failure(ConnectionContext *client) {
+  MUTEX_LOCK(&client->mutex);
+  const bool close_now = !client->closing;
+  client->closing = true;
+  MUTEX_UNLOCK(&client->mutex);
+  if (close_now) {
+    async_close_connection(client);
+  }
+}
+
+/**
+ * 写到共享内存的结果环中，客户端在等待结果时唤醒它。返回写入的长度，环被客户端改坏时返回SHM_RING_CORRUPTED
+ */
+static size_t shm_write(ShmChannel *shm, const char *buf, size_t len) {
+  size_t wlen = shm->responses.write(buf, len);
+  if (wlen == SHM_RING_CORRUPTED) {
+    return wlen;
+  }
+  if (wlen > 0) {
+    shm_notify_consumer(shm->responses, shm->response_fd);
+  }
+  return wlen;
+}
+
+/**
+ * 发送数据，用SCM_RIGHTS带上fds。socket是非阻塞的，发送缓冲区满时等待
+ */
+static int send_with_fds(int sock, const char *buf, int len, const int *fds, int fd_num) {
+  char control[CMSG_SPACE(sizeof(int) * 4)];
+  memset(control, 0, sizeof(control));
+  struct iovec iov = {const_cast<char *>(buf), (size_t)len};
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = CMSG_SPACE(sizeof(int) * fd_num);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fd_num);
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * fd_num);
+
+  // fd随第一次发送出去的数据一起到达，之后的部分不再带fd
+  int wlen = 0;
+  while (wlen < len) {
+    ssize_t ret = wlen == 0 ? ::sendmsg(sock, &msg, MSG_NOSIGNAL)
+                            : ::send(sock, buf + wlen, len - wlen, MSG_NOSIGNAL);
+    if (ret >= 0) {
+      wlen += ret;
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      struct pollfd poll_fd = {sock, POLLOUT, 0};
+      int poll_ret = poll(&poll_fd, 1, SEND_WAIT_TIMEOUT_MS);
+      if (poll_ret > 0 || (poll_ret < 0 && errno == EINTR)) {
+        continue;
+      }
+    }
+    return -1;
+  }
+  return 0;
+}
+
+int Server::enable_shared_memory(ConnectionContext *client, const char *ack, int ack_len, bool *enabled) {
+  *enabled = false;
+  struct sockaddr_storage addr;
+  socklen_t addr_len = sizeof(addr);
+  if (getsockname(client->fd, (struct sockaddr *)&addr, &addr_len) < 0 || addr.ss_family != AF_UNIX) {
+    LOG_WARN("Shared memory transport needs a unix socket connection, client %s", client->addr);
+    return 0;
+  }
+  if (client->shm != nullptr) {
+    LOG_WARN("Client %s is already using shared memory", client->addr);
+    return 0;
+  }
+
+  ShmChannel *shm = new ShmChannel();
+  shm->size = shm_region_size(SHM_REQUEST_RING_SIZE, SHM_RESPONSE_RING_SIZE);
+  int mem_fd = memfd_create("miniob-shm", MFD_CLOEXEC);
+  if (mem_fd < 0 || ftruncate(mem_fd, shm->size) < 0 ||
+      (shm->mem = mmap(nullptr, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, 0)) == MAP_FAILED ||
+      (shm->request_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0 ||
+      (shm->response_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+    LOG_ERROR("Failed to create shared memory for client %s, %s", client->addr, strerror(errno));
+    if (shm->mem == MAP_FAILED) {
+      shm->mem = nullptr;
+    }
+    free_shm_channel(shm);
+    if (mem_fd >= 0) {
+      ::close(mem_fd);
+    }
+    return 0;
+  }
+  shm_region_init(shm->mem, SHM_REQUEST_RING_SIZE, SHM_RESPONSE_RING_SIZE, &shm->requests, &shm->responses);
+  shm->requests.header()->consumer_waiting.store(1);
+  event_set(&shm->notify_event, shm->request_fd, EV_READ | EV_PERSIST, on_shm_notify, client);
+
+  // 之前的结果都发送完之后再发送ack，切换之后的结果才写到共享内存中
+  const int fds[3] = {mem_fd, shm->request_fd, shm->response_fd};
+  MUTEX_LOCK(&client->mutex);
+  int ret = client->write_failed ? -STATUS_FAILED_NETWORK : flush_output(client, true);
+  if (ret == 0 && send_with_fds(client->fd, ack, ack_len, fds, 3) != 0) {
+    LOG_ERROR("Failed to send shared memory to client %s, %s\n", client->addr, strerror(errno));
+    client->write_failed = true;
+    ret = -STATUS_FAILED_NETWORK;
+  }
+  if (ret == 0) {
+    client->shm = shm;
+  }
+  MUTEX_UNLOCK(&client->mutex);
+  ::close(mem_fd);
+
+  if (ret != 0) {
+    free_shm_channel(shm);
+    close_after_send_failure(client);
+    return ret;
+  }
+  if (post_command(client->notify_fd, Reactor::ENABLE_SHM, client) != 0) {
+    LOG_ERROR("Failed to notify io thread to read shared memory of %s", client->addr);
+  }
+  LOG_INFO("Client %s switched to shared memory transport", client->addr);
+  *enabled = true;
+  return 0;
+}
+
+int Server::send_chunk(ConnectionContext *client, const char *buf, int data_len) {
   if (buf == nullptr || data_len == 0) {
     return 0;
   }
 
-  TimerStat writeStat(*write_socket_metric_);
+  LatencyStat writeStat(*write_socket_metric_);
 
+  // 客户端选择了结果压缩，这次发送的数据编码成压缩帧之后再发送
+  std::string frames;
+  if (client->compression != WIRE_COMPRESSION_NONE) {
+    wire_compress((WireCompression)client->compression, buf, data_len, compression_threshold_, frames);
+    buf = frames.data();
+    data_len = (int)frames.size();
+  }
+
+  const bool io_thread = in_io_thread(client);
   MUTEX_LOCK(&client->mutex);
+  // 排队的数据太多时等IO线程发送一部分，避免很大的结果都堆在内存中
+  while (!io_thread && !client->write_failed && client->output_bytes >= OUTPUT_QUEUE_HIGH_WATER) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += SEND_WAIT_TIMEOUT_MS / 1000;
+    if (pthread_cond_timedwait(&client->output_cond, &client->mutex, &deadline) == ETIMEDOUT &&
+        client->output_bytes >= OUTPUT_QUEUE_HIGH_WATER) {
+      LOG_ERROR("Failed to send data back to client %s, %s\n", client->addr, strerror(ETIMEDOUT));
+      client->write_failed = true;
+    }
+  }
+  if (client->write_failed) {
+    MUTEX_UNLOCK(&client->mutex);
+    return -STATUS_FAILED_NETWORK;
+  }
+
+  // 前面没有排队的数据时直接发送，发送缓冲区满了再把剩下的放到队列中
   int wlen = 0;
-  for (int i = 0; i < 3 && wlen < data_len; i++) {
-    int len = write(client->fd, buf + wlen, data_len - wlen);
-    if (len < 0) {
-      LOG_ERROR("Failed to send data back to client\n");
+  if (client->shm != nullptr && client->output.empty()) {
+    const size_t len = shm_write(client->shm, buf, data_len);
+    if (len == SHM_RING_CORRUPTED) {
+      LOG_ERROR("Response ring of %s is corrupted, close the connection\n", client->addr);
+      client->write_failed = true;
       MUTEX_UNLOCK(&client->mutex);
-
-      close_connection(client);
       return -STATUS_FAILED_NETWORK;
     }
-    wlen += len;
+    wlen = (int)len;
+  }
+  while (client->shm == nullptr && client->output.empty() && wlen < data_len) {
+    // 客户端断开时不产生SIGPIPE，返回错误
+    int len = ::send(client->fd, buf + wlen, data_len - wlen, MSG_NOSIGNAL);
+    if (len >= 0) {
+      wlen += len;
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    }
+    LOG_ERROR("Failed to send data back to client %s, %s\n", client->addr, strerror(errno));
+    client->write_failed = true;
+    MUTEX_UNLOCK(&client->mutex);
+    return -STATUS_FAILED_NETWORK;
   }
   if (wlen < data_len) {
-    LOG_WARN("Not all data has been send back to client");
+    client->output.emplace_back(buf + wlen, data_len - wlen);
+    client->output_bytes += data_len - wlen;
+    if (client->shm != nullptr) {
+      // 结果环满了，让客户端读出数据之后通知IO线程接着写
+      flush_output(client, false);
+    }
   }
 
+  int ret = 0;
+  bool enable_write = false;
+  if (client->write_failed) {
+    // 上面写结果环时发现它被客户端改坏了
+    ret = -STATUS_FAILED_NETWORK;
+  } else if (io_thread) {
+    // 请求在IO线程中直接执行时，IO线程没有机会处理写事件，只能在这里等到发送完
+    ret = flush_output(client, true);
+  } else if (!client->output.empty() && !client->write_pending) {
+    client->write_pending = true;
+    enable_write = true;
+  }
   MUTEX_UNLOCK(&client->mutex);
+
+  if (enable_write) {
+    ret = post_command(client->notify_fd, Reactor::ENABLE_WRITE, client);
+    if (ret != 0) {
+      LOG_ERROR("Failed to notify io thread to send data to %s", client->addr);
+      MUTEX_LOCK(&client->mutex);
+      client->write_failed = true;
+      client->write_pending = false;
+      MUTEX_UNLOCK(&client->mutex);
+      ret = -STATUS_FAILED_NETWORK;
+    }
+  }
+  return ret;
+}
+
+// 用sendmsg一次发送发送队列中的多块数据，client->mutex必须已经加锁。
+// wait为false时发送缓冲区满就返回，为true时一直等到全部发送完。发送失败时丢弃所有排队的数据
+int Server::flush_output(ConnectionContext *client, bool wait) {
+  if (client->shm != nullptr) {
+    return flush_shm_output(client, wait);
+  }
+  while (!client->output.empty()) {
+    struct iovec iov[OUTPUT_IOV_MAX];
+    int iov_num = 0;
+    size_t offset = client->output_offset;
+    for (auto it = client->output.begin(); it != client->output.end() && iov_num < OUTPUT_IOV_MAX; ++it) {
+      iov[iov_num].iov_base = const_cast<char *>(it->data()) + offset;
+      iov[iov_num].iov_len = it->size() - offset;
+      iov_num++;
+      offset = 0;
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov_num;
+    ssize_t len = ::sendmsg(client->fd, &msg, MSG_NOSIGNAL);
+    if (len >= 0) {
+      client->output_bytes -= len;
+      while (len > 0) {
+        size_t remain = client->output.front().size() - client->output_offset;
+        if ((size_t)len < remain) {
+          client->output_offset += len;
+          break;
+        }
+        len -= remain;
+        client->output.pop_front();
+        client->output_offset = 0;
+      }
+      if (client->output_bytes < OUTPUT_QUEUE_HIGH_WATER) {
+        pthread_cond_broadcast(&client->output_cond);
+      }
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      if (!wait) {
+        return 0;
+      }
+      struct pollfd poll_fd = {client->fd, POLLOUT, 0};
+      int ret = poll(&poll_fd, 1, SEND_WAIT_TIMEOUT_MS);
+      if (ret > 0 || (ret < 0 && errno == EINTR)) {
+        continue;
+      }
+      if (ret == 0) {
+        errno = ETIMEDOUT;
+      }
+    }
+    LOG_ERROR("Failed to send data back to client %s, %s\n", client->addr, strerror(errno));
+    client->write_failed = true;
+    client->output.clear();
+    client->output_offset = 0;
+    client->output_bytes = 0;
+    pthread_cond_broadcast(&client->output_cond);
+    return -STATUS_FAILED_NETWORK;
+  }
   return 0;
 }
 
+// 把发送队列中的数据写到结果环中，client->mutex必须已经加锁。环满时设置producer_waiting，
+// 客户端读出数据之后通过请求的eventfd通知IO线程接着写。wait为true时一直等到全部写完
+int Server::flush_shm_output(ConnectionContext *client, bool wait) {
+  ShmChannel *shm = client->shm;
+  int waited_ms = 0;
+  while (!client->output.empty()) {
+    std::string &front = client->output.front();
+    size_t len = shm_write(shm, front.data() + client->output_offset, front.size() - client->output_offset);
+    if (len == SHM_RING_CORRUPTED) {
+      LOG_ERROR("Response ring of %s is corrupted, close the connection\n", client->addr);
+      client->write_failed = true;
+      client->output.clear();
+      client->output_offset = 0;
+      client->output_bytes = 0;
+      pthread_cond_broadcast(&client->output_cond);
+      return -STATUS_FAILED_NETWORK;
+    }
+    if (len > 0) {
+      client->output_bytes -= len;
+      client->output_offset += len;
+      if (client->output_offset == front.size()) {
+        client->output.pop_front();
+        client->output_offset = 0;
+      }
+      if (client->output_bytes < OUTPUT_QUEUE_HIGH_WATER) {
+        pthread_cond_broadcast(&client->output_cond);
+      }
+      continue;
+    }
+    shm->responses.header()->producer_waiting.store(1);
+    if (shm->responses.writable() > 0) {
+      continue;
+    }
+    if (!wait) {
+      return 0;
+    }
+    // 只有请求在IO线程中直接执行时才会等待，IO线程不能处理eventfd，只能轮询
+    if (waited_ms >= SEND_WAIT_TIMEOUT_MS) {
+      LOG_ERROR("Failed to send data back to client %s, %s\n", client->addr, strerror(ETIMEDOUT));
+      client->write_failed = true;
+      client->output.clear();
+      client->output_offset = 0;
+      client->output_bytes = 0;
+      pthread_cond_broadcast(&client->output_cond);
+      return -STATUS_FAILED_NETWORK;
+    }
+    usleep(1000);
+    waited_ms++;
+  }
+  return 0;
+}
+
+void Server::on_writable(int fd, short ev, void *arg) {
+  ConnectionContext *client = (ConnectionContext *)arg;
+
+  LatencyStat writeStat(*write_socket_metric_);
+  MUTEX_LOCK(&client->mutex);
+  if (ev & EV_TIMEOUT) {
+    LOG_ERROR("Failed to send data back to client %s, %s\n", client->addr, strerror(ETIMEDOUT));
+    client->write_failed = true;
+    client->output.clear();
+    client->output_offset = 0;
+    client->output_bytes = 0;
+    pthread_cond_broadcast(&client->output_cond);
+  } else {
+    flush_output(client, false);
+  }
+
+  bool close_now = false;
+  if (client->output.empty()) {
+    event_del(&client->write_event);
+    client->write_pending = false;
+    close_now = idle_after_close(client);
+  }
+  MUTEX_UNLOCK(&client->mutex);
+
+  if (close_now) {
+    close_connection(client);
+  }
+}
+
 void Server::accept(int fd, short ev, void *arg) {
   Server *instance = (Server *)arg;
   struct sockaddr_in addr;
@@ -245,37 +782,248 @@ void Server::accept(int fd, short ev, void *arg) {
   }
 
   ConnectionContext *client_context = new ConnectionContext();
-  memset(client_context, 0, sizeof(ConnectionContext));
   client_context->fd = client_fd;
   snprintf(client_context->addr, sizeof(client_context->addr), "%s", addr_str.c_str());
   pthread_mutex_init(&client_context->mutex, nullptr);
+  pthread_cond_init(&client_context->output_cond, nullptr);
 
   event_set(&client_context->read_event, client_context->fd, EV_READ | EV_PERSIST,
             recv, client_context);
-
-  ret = event_base_set(instance->event_base_, &client_context->read_event);
-  if (ret < 0) {
-    LOG_ERROR(
-            "Failed to do event_base_set for read event of %s into libevent, %s",
-            client_context->addr, strerror(errno));
+  event_set(&client_context->write_event, client_context->fd, EV_WRITE | EV_PERSIST,
+            on_writable, client_context);
+  // 连接交给IO线程之后随时可能收到请求，先准备好session。关闭连接时session放回池中
+  client_context->session = SessionPool::instance().acquire();
+  if (client_context->session == nullptr) {
+    LOG_ERROR("Failed to acquire session for %s", client_context->addr);
+    ::close(client_fd);
+    pthread_cond_destroy(&client_context->output_cond);
     delete client_context;
-    ::close(instance->server_socket_);
     return;
   }
 
-  ret = event_add(&client_context->read_event, nullptr);
+  ret = instance->dispatch_connection(client_context);
   if (ret < 0) {
-    LOG_ERROR("Failed to event_add for read event of %s into libevent, %s",
-              client_context->addr, strerror(errno));
+    SessionPool::instance().release(client_context->session);
+    pthread_cond_destroy(&client_context->output_cond);
     delete client_context;
     ::close(instance->server_socket_);
     return;
   }
 
-  client_context->session = new Session(Session::default_session());
   LOG_INFO("Accepted connection from %s\n", client_context->addr);
 }
 
+int Server::dispatch_connection(ConnectionContext *client_context) {
+  Reactor *reactor = listen_reactor_;
+  if (!reactors_.empty()) {
+    reactor = reactors_[next_reactor_++ % reactors_.size()];
+  }
+  client_context->notify_fd = reactor->notify_fds[1];
+
+  int ret = event_base_set(reactor->event_base, &client_context->read_event);
+  if (ret == 0) {
+    ret = event_base_set(reactor->event_base, &client_context->write_event);
+  }
+  if (ret < 0) {
+    LOG_ERROR(
+            "Failed to do event_base_set for read event of %s into libevent, %s",
+            client_context->addr, strerror(errno));
+    return -1;
+  }
+
+  if (reactor == listen_reactor_) {
+    ret = event_add(&client_context->read_event, nullptr);
+    if (ret < 0) {
+      LOG_ERROR("Failed to event_add for read event of %s into libevent, %s",
+                client_context->addr, strerror(errno));
+      return -1;
+    }
+    return 0;
+  }
+
+  // event_base不是线程安全的，由IO线程自己调用event_add
+  if (post_command(reactor->notify_fds[1], Reactor::ADD_CONNECTION, client_context) != 0) {
+    LOG_ERROR("Failed to hand over connection %s to io thread, %s", client_context->addr, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+int Server::post_command(int notify_fd, Reactor::CommandType type, ConnectionContext *client) {
+  // 小于PIPE_BUF的写入是原子的，多个线程可以同时发送
+  Reactor::Command command = {type, client};
+  while (::write(notify_fd, &command, sizeof(command)) != sizeof(command)) {
+    if (errno != EINTR) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void Server::reactor_notify(int fd, short ev, void *arg) {
+  Reactor *reactor = (Reactor *)arg;
+  Reactor::Command command;
+  while (::read(fd, &command, sizeof(command)) == sizeof(command)) {
+    ConnectionContext *client_context = command.client;
+    switch (command.type) {
+      case Reactor::QUIT: {
+        event_base_loopbreak(reactor->event_base);
+        return;
+      }
+      case Reactor::ADD_CONNECTION: {
+        if (event_add(&client_context->read_event, nullptr) < 0) {
+          LOG_ERROR("Failed to event_add for read event of %s into libevent, %s",
+                    client_context->addr, strerror(errno));
+          ::close(client_context->fd);
+          SessionPool::instance().release(client_context->session);
+          pthread_cond_destroy(&client_context->output_cond);
+          delete client_context;
+          continue;
+        }
+        LOG_INFO("Connection %s is handled by io thread %p", client_context->addr, reactor);
+      } break;
+      case Reactor::ENABLE_WRITE: {
+        struct timeval timeout = {SEND_WAIT_TIMEOUT_MS / 1000, 0};
+        bool close_now = false;
+        MUTEX_LOCK(&client_context->mutex);
+        if (client_context->output.empty()) {
+          // 生成结果的线程已经发送完了
+          client_context->write_pending = false;
+          close_now = idle_after_close(client_context);
+        } else if (event_add(&client_context->write_event, &timeout) < 0) {
+          LOG_ERROR("Failed to event_add for write event of %s into libevent, %s",
+                    client_context->addr, strerror(errno));
+          client_context->write_failed = true;
+          client_context->write_pending = false;
+          client_context->output.clear();
+          client_context->output_offset = 0;
+          client_context->output_bytes = 0;
+          pthread_cond_broadcast(&client_context->output_cond);
+          close_now = idle_after_close(client_context);
+        }
+        MUTEX_UNLOCK(&client_context->mutex);
+        if (close_now) {
+          close_connection(client_context);
+        }
+      } break;
+      case Reactor::CLOSE_CONNECTION: {
+        close_connection(client_context);
+      } break;
+      case Reactor::ENABLE_SHM: {
+        // 切换之后写事件只用来计时，客户端太久不读结果环时认为发送失败
+        MUTEX_LOCK(&client_context->mutex);
+        event_del(&client_context->write_event);
+        event_set(&client_context->write_event, -1, 0, on_writable, client_context);
+        event_base_set(reactor->event_base, &client_context->write_event);
+        if (client_context->output.empty()) {
+          client_context->write_pending = false;
+        } else if (client_context->write_pending) {
+          struct timeval timeout = {SEND_WAIT_TIMEOUT_MS / 1000, 0};
+          event_add(&client_context->write_event, &timeout);
+        }
+        bool close_now = false;
+        if (!client_context->peer_closed &&
+            (event_base_set(reactor->event_base, &client_context->shm->notify_event) < 0 ||
+                event_add(&client_context->shm->notify_event, nullptr) < 0)) {
+          LOG_ERROR("Failed to event_add for shared memory of %s into libevent, %s",
+                    client_context->addr, strerror(errno));
+          client_context->peer_closed = true;
+          event_del(&client_context->read_event);
+          close_now = idle_after_close(client_context);
+        }
+        MUTEX_UNLOCK(&client_context->mutex);
+        if (close_now) {
+          close_connection(client_context);
+        }
+      } break;
+    }
+  }
+}
+
+void *Server::reactor_thread(void *arg) {
+  Reactor *reactor = (Reactor *)arg;
+  current_notify_fd = reactor->notify_fds[1];
+  event_base_dispatch(reactor->event_base);
+  LOG_INFO("IO thread %p quit", reactor);
+  return nullptr;
+}
+
+int Server::init_reactor(Reactor *reactor) {
+  if (pipe(reactor->notify_fds) < 0) {
+    LOG_ERROR("Failed to create notify pipe for io thread, %s.", strerror(errno));
+    return -1;
+  }
+  if (set_non_block(reactor->notify_fds[0]) < 0) {
+    return -1;
+  }
+
+  reactor->notify_ev = event_new(reactor->event_base, reactor->notify_fds[0], EV_READ | EV_PERSIST,
+                                 reactor_notify, reactor);
+  if (reactor->notify_ev == nullptr || event_add(reactor->notify_ev, nullptr) < 0) {
+    LOG_ERROR("Failed to add notify event for io thread, %s.", strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+void Server::free_reactor(Reactor *reactor) {
+  if (reactor->notify_ev != nullptr) {
+    event_free(reactor->notify_ev);
+  }
+  for (int fd : reactor->notify_fds) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+  delete reactor;
+}
+
+int Server::start_reactors() {
+  for (int i = 0; i < server_param_.io_thread_num; i++) {
+    Reactor *reactor = new Reactor();
+    reactors_.push_back(reactor);
+
+    reactor->event_base = event_base_new();
+    if (reactor->event_base == nullptr) {
+      LOG_ERROR("Failed to create event base for io thread, %s.", strerror(errno));
+      return -1;
+    }
+    if (init_reactor(reactor) < 0) {
+      return -1;
+    }
+
+    if (pthread_create(&reactor->thread, nullptr, reactor_thread, reactor) != 0) {
+      LOG_ERROR("Failed to create io thread, %s.", strerror(errno));
+      return -1;
+    }
+    reactor->started = true;
+  }
+
+  if (!reactors_.empty()) {
+    LOG_INFO("Start %d io threads", (int)reactors_.size());
+  }
+  return 0;
+}
+
+void Server::stop_reactors() {
+  for (Reactor *reactor : reactors_) {
+    if (reactor->started) {
+      if (post_command(reactor->notify_fds[1], Reactor::QUIT, nullptr) == 0) {
+        pthread_join(reactor->thread, nullptr);
+      } else {
+        LOG_ERROR("Failed to notify io thread to quit, %s", strerror(errno));
+        pthread_detach(reactor->thread);
+      }
+    }
+    struct event_base *event_base = reactor->event_base;
+    free_reactor(reactor);
+    if (event_base != nullptr) {
+      event_base_free(event_base);
+    }
+  }
+  reactors_.clear();
+}
+
 int Server::start() {
   if (server_param_.use_unix_socket) {
     return start_unix_socket_server();
@@ -420,6 +1168,21 @@ int Server::serve() {
     exit(-1);
   }
 
+  // 监听线程也按IO线程的方式接收其它线程的通知，没有IO线程时由它处理所有连接
+  listen_reactor_ = new Reactor();
+  listen_reactor_->event_base = event_base_;
+  if (init_reactor(listen_reactor_) < 0) {
+    LOG_PANIC("Failed to init notify pipe of listen thread");
+    exit(-1);
+  }
+  current_notify_fd = listen_reactor_->notify_fds[1];
+
+  retval = start_reactors();
+  if (retval == -1) {
+    LOG_PANIC("Failed to start io threads");
+    exit(-1);
+  }
+
   event_base_dispatch(event_base_);
 
   return 0;
@@ -434,12 +1197,19 @@ void Server::shutdown() {
   exit_time.tv_sec += 10;
   event_base_loopexit(event_base_, &exit_time);
 
+  stop_reactors();
+
   if (listen_ev_ != nullptr) {
     event_del(listen_ev_);
     event_free(listen_ev_);
     listen_ev_ = nullptr;
   }
 
+  if (listen_reactor_ != nullptr) {
+    free_reactor(listen_reactor_);
+    listen_reactor_ = nullptr;
+  }
+
   if (event_base_ != nullptr) {
     event_base_free(event_base_);
     event_base_ = nullptr;
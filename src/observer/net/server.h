@@ -15,6 +15,11 @@ See the Mulan PSL v2 for more details. */
 #ifndef __OBSERVER_NET_SERVER_H__
 #define __OBSERVER_NET_SERVER_H__
 
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+
 #include "common/defs.h"
 #include "common/metrics/metrics.h"
 #include "common/seda/stage.h"
@@ -28,7 +33,27 @@ public:
 
 public:
   static void init();
+  /**
+   * 发送数据。socket的发送缓冲区满时把剩下的数据放到连接的发送队列中，由IO线程在socket可写时发送，
+   * 只有排队的数据超过OUTPUT_QUEUE_HIGH_WATER时才等待。失败时关闭连接
+   */
   static int send(ConnectionContext *client, const char *buf, int data_len);
+  /**
+   * 和send相同，但是失败时不关闭连接。用于在执行过程中分块发送结果，连接由之后的send关闭。
+   * 客户端选择了结果压缩时，每次发送的数据编码成压缩帧，到COMPRESSION_THRESHOLD的部分才压缩
+   */
+  static int send_chunk(ConnectionContext *client, const char *buf, int data_len);
+  /**
+   * 一个请求的结果已经发送完，执行这个连接上排队的下一个请求。
+   * 客户端已经关闭并且没有排队的请求时关闭连接
+   */
+  static void request_done(ConnectionContext *client);
+  /**
+   * 把unix socket连接切换到共享内存传输。之前的结果都发送完之后，发送ack并且用SCM_RIGHTS带上共享内存和eventfd，
+   * 之后的结果都写到共享内存中。连接不能使用共享内存时enabled为false，不发送任何数据。
+   * 发送失败时关闭连接，返回错误
+   */
+  static int enable_shared_memory(ConnectionContext *client, const char *ack, int ack_len, bool *enabled);
 
 public:
   int serve();
@@ -38,7 +63,61 @@ private:
   static void accept(int fd, short ev, void *arg);
   // close connection
   static void close_connection(ConnectionContext *client_context);
+  // 在连接所属的IO线程中关闭连接，其它线程通过通知管道交给IO线程
+  static void async_close_connection(ConnectionContext *client_context);
+  static bool in_io_thread(ConnectionContext *client_context);
+  static int flush_output(ConnectionContext *client_context, bool wait);
+  static bool idle_after_close(ConnectionContext *client_context);
   static void recv(int fd, short ev, void *arg);
+  /**
+   * client->mutex必须已经加锁，返回时已经解锁。取出接收缓冲区中完整的请求排队，连接空闲时执行下一个请求。
+   * closing表示不再接收数据，等连接空闲时关闭
+   */
+  static void handle_received(ConnectionContext *client, bool closing);
+  // 共享内存连接的请求eventfd可读：客户端写了请求，或者读出了结果有了空间
+  static void on_shm_notify(int fd, short ev, void *arg);
+  static int flush_shm_output(ConnectionContext *client_context, bool wait);
+  static void free_shm_channel(ShmChannel *shm);
+  // 发送失败之后关闭连接
+  static void close_after_send_failure(ConnectionContext *client);
+  static void on_writable(int fd, short ev, void *arg);
+  static void dispatch_request(ConnectionContext *client, std::string &&request);
+
+private:
+  /**
+   * 一个IO线程，有自己的event_base，负责分配给它的连接的读写事件。
+   * event_base不是线程安全的，其它线程通过管道发送Command，由IO线程自己加入新连接、
+   * 加入写事件或者关闭连接
+   */
+  struct Reactor {
+    enum CommandType {
+      ADD_CONNECTION,
+      ENABLE_WRITE,
+      CLOSE_CONNECTION,
+      ENABLE_SHM,  // 连接切换到了共享内存传输，加入请求eventfd的读事件
+      QUIT,
+    };
+    struct Command {
+      CommandType type;
+      ConnectionContext *client;
+    };
+
+    struct event_base *event_base = nullptr;
+    struct event *notify_ev = nullptr;
+    int notify_fds[2] = {-1, -1};
+    pthread_t thread;
+    bool started = false;
+  };
+
+  int start_reactors();
+  void stop_reactors();
+  int init_reactor(Reactor *reactor);
+  static void free_reactor(Reactor *reactor);
+  static int post_command(int notify_fd, Reactor::CommandType type, ConnectionContext *client);
+  // 把连接交给下一个IO线程，没有IO线程时加到监听线程的event_base
+  int dispatch_connection(ConnectionContext *client_context);
+  static void *reactor_thread(void *arg);
+  static void reactor_notify(int fd, short ev, void *arg);
 
 private:
   int set_non_block(int fd);
@@ -53,11 +132,16 @@ private:
   struct event_base *event_base_;
   struct event *listen_ev_;
 
+  Reactor *listen_reactor_ = nullptr;  // 监听线程的event_base，没有IO线程时也处理所有连接
+  std::vector<Reactor *> reactors_;
+  size_t next_reactor_ = 0;
+
   ServerParam server_param_;
 
   static common::Stage *session_stage_;
-  static common::SimpleTimer *read_socket_metric_;
-  static common::SimpleTimer *write_socket_metric_;
+  static common::LatencyHistogram *read_socket_metric_;
+  static common::LatencyHistogram *write_socket_metric_;
+  static int compression_threshold_;
 };
 
 class Communicator {
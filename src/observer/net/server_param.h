@@ -34,6 +34,12 @@ public:
 
   std::string unix_socket_path;
 
+  // 接收连接之后，按照轮询的方式分给这么多个IO线程，0表示都由监听线程处理
+  int io_thread_num = 0;
+
+  // 客户端选择了结果压缩时，一次发送的数据到这么多字节才压缩
+  int compression_threshold;
+
   // 如果使用标准输入输出作为通信条件，就不再监听端口
   bool use_unix_socket = false;
 };
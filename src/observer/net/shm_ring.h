@@ -0,0 +1,258 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Shared-memory transport for clients on the same host, shared by observer and obclient.
+//
+
+#ifndef __SRC_OBSERVER_NET_SHM_RING_H__
+#define __SRC_OBSERVER_NET_SHM_RING_H__
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+
+/**
+ * 共享内存传输。通过unix socket连接的客户端发送SHM_TRANSPORT_HANDSHAKE，服务端按当前的协议回复，
+ * 成功时回复中用SCM_RIGHTS带上三个fd：共享内存区域、请求的eventfd和结果的eventfd。
+ * 之后请求写到请求环中，结果写到结果环中，数据的格式和socket上完全相同，socket只用来发现连接断开。
+ * 每个环只有一个生产者和一个消费者：
+ * - 消费者准备阻塞等待之前设置consumer_waiting，生产者写入数据之后发现它被设置了才写eventfd；
+ * - 生产者发现环满了设置producer_waiting，消费者读出数据之后发现它被设置了才写eventfd；
+ * 请求的eventfd由服务端等待，结果的eventfd由客户端等待，一方等待的两种事件共用一个eventfd。
+ * 客户端等待结果时先自旋一会儿，点查询的结果通常在自旋时就到了，整个请求不需要socket的系统调用
+ */
+#define SHM_TRANSPORT_MAGIC 0x4d424f53u                  // "SOBM"
+#define SHM_REQUEST_RING_SIZE (1 << 20)
+#define SHM_RESPONSE_RING_SIZE (4 << 20)
+#define SHM_SPIN_TIME_US 200                              // 阻塞等待之前自旋的时间
+#define SHM_CACHE_LINE_SIZE 64
+#define SHM_RING_CORRUPTED ((size_t)-1)                  // 对方把head或tail改坏了，只能关闭连接
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory needs lock free atomics");
+
+/**
+ * 环的控制信息，放在共享内存中。head和tail只增不减，对容量取模得到位置
+ */
+struct ShmRingHeader {
+  alignas(SHM_CACHE_LINE_SIZE) std::atomic<uint64_t> head;  // 消费者读到的位置
+  alignas(SHM_CACHE_LINE_SIZE) std::atomic<uint64_t> tail;  // 生产者写到的位置
+  alignas(SHM_CACHE_LINE_SIZE) std::atomic<uint32_t> consumer_waiting;
+  std::atomic<uint32_t> producer_waiting;
+};
+
+/**
+ * 共享内存区域的开头，之后是请求环和结果环的ShmRingHeader，再之后是两个环的数据
+ */
+struct ShmRegionHeader {
+  alignas(SHM_CACHE_LINE_SIZE) uint32_t magic;
+  uint32_t request_ring_size;
+  uint32_t response_ring_size;
+};
+
+/**
+ * 共享内存中的单生产者单消费者字节环，容量是2的幂。只是共享内存的视图，不拥有内存
+ */
+class ShmRing {
+public:
+  ShmRing() = default;
+  ShmRing(ShmRingHeader *header, char *data, uint32_t capacity) : header_(header), data_(data), capacity_(capacity)
+  {}
+
+  ShmRingHeader *header() const
+  {
+    return header_;
+  }
+
+  /**
+   * 可以读出的长度。head和tail都在共享内存中，对方可以随意修改，差值超过容量时返回SHM_RING_CORRUPTED
+   */
+  size_t readable() const
+  {
+    const uint64_t used = header_->tail.load() - header_->head.load();
+    return used > capacity_ ? SHM_RING_CORRUPTED : (size_t)used;
+  }
+  /**
+   * 环被改坏时返回0，之后的write会返回SHM_RING_CORRUPTED
+   */
+  size_t writable() const
+  {
+    const size_t used = readable();
+    return used == SHM_RING_CORRUPTED ? 0 : capacity_ - used;
+  }
+
+  /**
+   * 写入尽量多的数据，返回写入的长度，环满时返回0，环被改坏时返回SHM_RING_CORRUPTED
+   */
+  size_t write(const char *data, size_t len)
+  {
+    const uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    const uint64_t used = tail - header_->head.load();
+    if (used > capacity_) {
+      return SHM_RING_CORRUPTED;
+    }
+    const size_t space = capacity_ - (size_t)used;
+    if (len > space) {
+      len = space;
+    }
+    copy_in(tail, data, len);
+    header_->tail.store(tail + len);
+    return len;
+  }
+
+  /**
+   * 读出最多len个字节，返回读出的长度，环空时返回0，环被改坏时返回SHM_RING_CORRUPTED
+   */
+  size_t read(char *buf, size_t len)
+  {
+    const uint64_t head = header_->head.load(std::memory_order_relaxed);
+    const uint64_t available = header_->tail.load() - head;
+    if (available > capacity_) {
+      return SHM_RING_CORRUPTED;
+    }
+    if (len > available) {
+      len = available;
+    }
+    const size_t pos = head & (capacity_ - 1);
+    const size_t first = len < capacity_ - pos ? len : capacity_ - pos;
+    memcpy(buf, data_ + pos, first);
+    memcpy(buf + first, data_, len - first);
+    header_->head.store(head + len);
+    return len;
+  }
+
+private:
+  void copy_in(uint64_t tail, const char *data, size_t len)
+  {
+    // 调用者已经按剩余空间截断，这里再保证绕回之后的部分不会超出环的末尾
+    if (len > capacity_) {
+      len = capacity_;
+    }
+    const size_t pos = tail & (capacity_ - 1);
+    const size_t first = len < capacity_ - pos ? len : capacity_ - pos;
+    memcpy(data_ + pos, data, first);
+    memcpy(data_, data + first, len - first);
+  }
+
+private:
+  ShmRingHeader *header_ = nullptr;
+  char *data_ = nullptr;
+  size_t capacity_ = 0;
+};
+
+inline size_t shm_region_size(uint32_t request_ring_size, uint32_t response_ring_size)
+{
+  return sizeof(ShmRegionHeader) + 2 * sizeof(ShmRingHeader) + request_ring_size + response_ring_size;
+}
+
+/**
+ * 服务端初始化新建的共享内存区域
+ */
+inline void shm_region_init(void *mem, uint32_t request_ring_size, uint32_t response_ring_size,
+    ShmRing *requests, ShmRing *responses)
+{
+  ShmRegionHeader *region = new (mem) ShmRegionHeader();
+  region->magic = SHM_TRANSPORT_MAGIC;
+  region->request_ring_size = request_ring_size;
+  region->response_ring_size = response_ring_size;
+  ShmRingHeader *headers = (ShmRingHeader *)((char *)mem + sizeof(ShmRegionHeader));
+  new (&headers[0]) ShmRingHeader();
+  new (&headers[1]) ShmRingHeader();
+  char *data = (char *)(headers + 2);
+  *requests = ShmRing(&headers[0], data, request_ring_size);
+  *responses = ShmRing(&headers[1], data + request_ring_size, response_ring_size);
+}
+
+/**
+ * 客户端检查映射的共享内存区域，大小不对或者不是服务端初始化的区域时返回false
+ */
+inline bool shm_region_attach(void *mem, size_t size, ShmRing *requests, ShmRing *responses)
+{
+  if (size < sizeof(ShmRegionHeader)) {
+    return false;
+  }
+  const ShmRegionHeader *region = (const ShmRegionHeader *)mem;
+  const uint32_t request_ring_size = region->request_ring_size;
+  const uint32_t response_ring_size = region->response_ring_size;
+  if (region->magic != SHM_TRANSPORT_MAGIC || request_ring_size == 0 || response_ring_size == 0 ||
+      (request_ring_size & (request_ring_size - 1)) != 0 || (response_ring_size & (response_ring_size - 1)) != 0 ||
+      size != shm_region_size(request_ring_size, response_ring_size)) {
+    return false;
+  }
+  ShmRingHeader *headers = (ShmRingHeader *)((char *)mem + sizeof(ShmRegionHeader));
+  char *data = (char *)(headers + 2);
+  *requests = ShmRing(&headers[0], data, request_ring_size);
+  *responses = ShmRing(&headers[1], data + request_ring_size, response_ring_size);
+  return true;
+}
+
+/**
+ * 唤醒等待eventfd的一方
+ */
+inline void shm_notify(int event_fd)
+{
+  uint64_t one = 1;
+  while (::write(event_fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+  }
+}
+
+/**
+ * 写入数据之后调用，消费者已经准备阻塞时唤醒它
+ */
+inline void shm_notify_consumer(ShmRing &ring, int event_fd)
+{
+  if (ring.header()->consumer_waiting.load() != 0 && ring.header()->consumer_waiting.exchange(0) != 0) {
+    shm_notify(event_fd);
+  }
+}
+
+/**
+ * 读出数据之后调用，生产者在等待空间时唤醒它
+ */
+inline void shm_notify_producer(ShmRing &ring, int event_fd)
+{
+  if (ring.header()->producer_waiting.load() != 0 && ring.header()->producer_waiting.exchange(0) != 0) {
+    shm_notify(event_fd);
+  }
+}
+
+/**
+ * 自旋等待ready返回true，最多SHM_SPIN_TIME_US微秒。读时钟走vdso，不是系统调用。
+ * 只有一个CPU时自旋只会占住对方需要的CPU，直接返回
+ */
+template <typename Ready>
+inline bool shm_spin_until(Ready ready)
+{
+  static const bool multi_cpu = sysconf(_SC_NPROCESSORS_ONLN) > 1;
+  if (!multi_cpu) {
+    return ready();
+  }
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (true) {
+    for (int i = 0; i < 64; i++) {
+      if (ready()) {
+        return true;
+      }
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((now.tv_sec - start.tv_sec) * 1000000L + (now.tv_nsec - start.tv_nsec) / 1000 >= SHM_SPIN_TIME_US) {
+      return ready();
+    }
+  }
+}
+
+#endif  //__SRC_OBSERVER_NET_SHM_RING_H__
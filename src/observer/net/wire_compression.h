@@ -0,0 +1,249 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Optional compression of the bytes sent back to the client, shared by observer and obclient.
+//
+
+#ifndef __SRC_OBSERVER_NET_WIRE_COMPRESSION_H__
+#define __SRC_OBSERVER_NET_WIRE_COMPRESSION_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#include <string>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "net/wire_protocol.h"
+
+/**
+ * 结果压缩。客户端发送COMPRESSION_HANDSHAKE_PREFIX加上压缩方式的名字，服务端按当前的协议回复
+ * "SUCCESS\n"或者"FAILURE\n"，成功之后服务端发送的所有数据都放在压缩帧中，不管是文本协议还是二进制协议。
+ * 压缩帧是1字节的类型、4字节的原始长度、4字节的内容长度和内容，整数都是小端：
+ * WIRE_COMPRESSED_FRAME_PLAIN       内容就是原始数据，不到阈值或者压缩之后没有变小的数据这样发送
+ * WIRE_COMPRESSED_FRAME_COMPRESSED  内容是按约定的方式压缩的数据
+ * 客户端把压缩帧解开之后，得到的数据和没有压缩时完全一样
+ */
+enum WireCompression
+{
+  WIRE_COMPRESSION_NONE = 0,
+  WIRE_COMPRESSION_ZLIB = 1,
+  WIRE_COMPRESSION_LZ4 = 2,
+  WIRE_COMPRESSION_ZSTD = 3,
+};
+
+enum WireCompressedFrameType
+{
+  WIRE_COMPRESSED_FRAME_PLAIN = 'P',
+  WIRE_COMPRESSED_FRAME_COMPRESSED = 'Z',
+};
+
+#define WIRE_COMPRESSED_FRAME_HEADER_SIZE 9
+#define WIRE_COMPRESSION_BLOCK_SIZE (1024 * 1024)    // 一帧最多这么多原始数据，接收方据此限制内存
+#define WIRE_COMPRESSION_THRESHOLD_DEFAULT 4096      // 一次发送的数据不到这么多时不压缩
+
+/**
+ * 根据名字(none/zlib/lz4/zstd)获取压缩方式，名字不区分大小写
+ */
+inline bool wire_compression_from_string(const char *name, WireCompression *compression)
+{
+  if (0 == strcasecmp(name, "none")) {
+    *compression = WIRE_COMPRESSION_NONE;
+  } else if (0 == strcasecmp(name, "zlib")) {
+    *compression = WIRE_COMPRESSION_ZLIB;
+  } else if (0 == strcasecmp(name, "lz4")) {
+    *compression = WIRE_COMPRESSION_LZ4;
+  } else if (0 == strcasecmp(name, "zstd")) {
+    *compression = WIRE_COMPRESSION_ZSTD;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * 当前编译的版本是否支持这种压缩方式，编译时没有找到对应的库就不支持
+ */
+inline bool wire_compression_supported(WireCompression compression)
+{
+  switch (compression) {
+    case WIRE_COMPRESSION_NONE: return true;
+#ifdef HAVE_ZLIB
+    case WIRE_COMPRESSION_ZLIB: return true;
+#endif
+#ifdef HAVE_LZ4
+    case WIRE_COMPRESSION_LZ4: return true;
+#endif
+#ifdef HAVE_ZSTD
+    case WIRE_COMPRESSION_ZSTD: return true;
+#endif
+    default: return false;
+  }
+}
+
+/**
+ * 压缩len个字节追加到out中，失败或者没有变小时返回false，out不变
+ */
+inline bool wire_compress_block(WireCompression compression, const char *data, size_t len, std::string &out)
+{
+  const size_t pos = out.size();
+  size_t dst_len = 0;
+  switch (compression) {
+#ifdef HAVE_ZLIB
+    case WIRE_COMPRESSION_ZLIB: {
+      uLongf bound = compressBound(len);
+      out.resize(pos + bound);
+      if (compress2((Bytef *)&out[pos], &bound, (const Bytef *)data, len, Z_BEST_SPEED) == Z_OK) {
+        dst_len = bound;
+      }
+    } break;
+#endif
+#ifdef HAVE_LZ4
+    case WIRE_COMPRESSION_LZ4: {
+      int bound = LZ4_compressBound((int)len);
+      out.resize(pos + bound);
+      int ret = LZ4_compress_default(data, &out[pos], (int)len, bound);
+      dst_len = ret > 0 ? ret : 0;
+    } break;
+#endif
+#ifdef HAVE_ZSTD
+    case WIRE_COMPRESSION_ZSTD: {
+      size_t bound = ZSTD_compressBound(len);
+      out.resize(pos + bound);
+      size_t ret = ZSTD_compress(&out[pos], bound, data, len, 1);
+      dst_len = ZSTD_isError(ret) ? 0 : ret;
+    } break;
+#endif
+    default: break;
+  }
+  if (dst_len == 0 || dst_len >= len) {
+    out.resize(pos);
+    return false;
+  }
+  out.resize(pos + dst_len);
+  return true;
+}
+
+/**
+ * 把压缩的数据解到out的末尾，必须正好得到len个字节
+ */
+inline bool wire_decompress_block(
+    WireCompression compression, const char *data, size_t data_len, size_t len, std::string &out)
+{
+  const size_t pos = out.size();
+  out.resize(pos + len);
+  bool ok = false;
+  switch (compression) {
+#ifdef HAVE_ZLIB
+    case WIRE_COMPRESSION_ZLIB: {
+      uLongf dst_len = len;
+      ok = uncompress((Bytef *)&out[pos], &dst_len, (const Bytef *)data, data_len) == Z_OK && dst_len == len;
+    } break;
+#endif
+#ifdef HAVE_LZ4
+    case WIRE_COMPRESSION_LZ4: {
+      ok = LZ4_decompress_safe(data, &out[pos], (int)data_len, (int)len) == (int)len;
+    } break;
+#endif
+#ifdef HAVE_ZSTD
+    case WIRE_COMPRESSION_ZSTD: {
+      size_t ret = ZSTD_decompress(&out[pos], len, data, data_len);
+      ok = !ZSTD_isError(ret) && ret == len;
+    } break;
+#endif
+    default: break;
+  }
+  if (!ok) {
+    out.resize(pos);
+  }
+  return ok;
+}
+
+/**
+ * 把一次发送的len个字节编码成压缩帧追加到out中。不到threshold的数据不压缩，
+ * 超过WIRE_COMPRESSION_BLOCK_SIZE的数据分成多帧
+ */
+inline void wire_compress(
+    WireCompression compression, const char *data, size_t len, size_t threshold, std::string &out)
+{
+  while (len > 0) {
+    const size_t block_len = len < WIRE_COMPRESSION_BLOCK_SIZE ? len : WIRE_COMPRESSION_BLOCK_SIZE;
+    const size_t pos = out.size();
+    out.append(WIRE_COMPRESSED_FRAME_HEADER_SIZE, '\0');
+    char type = WIRE_COMPRESSED_FRAME_COMPRESSED;
+    if (block_len < threshold || !wire_compress_block(compression, data, block_len, out)) {
+      type = WIRE_COMPRESSED_FRAME_PLAIN;
+      out.append(data, block_len);
+    }
+    out[pos] = type;
+    wire_set_u32(out, pos + 1, (uint32_t)block_len);
+    wire_set_u32(out, pos + 5, (uint32_t)(out.size() - pos - WIRE_COMPRESSED_FRAME_HEADER_SIZE));
+    data += block_len;
+    len -= block_len;
+  }
+}
+
+/**
+ * 接收方解开压缩帧。收到的数据可能在任意位置断开，不完整的帧留到下次
+ */
+class WireDecompressor {
+public:
+  explicit WireDecompressor(WireCompression compression) : compression_(compression)
+  {}
+
+  /**
+   * 追加收到的数据，解开所有完整的帧追加到out中。收到错误的数据时返回false
+   */
+  bool feed(const char *data, size_t len, std::string &out)
+  {
+    buf_.append(data, len);
+    size_t pos = 0;
+    bool ok = true;
+    while (buf_.size() - pos >= WIRE_COMPRESSED_FRAME_HEADER_SIZE) {
+      const char type = buf_[pos];
+      const uint32_t raw_len = wire_get_u32(buf_.data() + pos + 1);
+      const uint32_t payload_len = wire_get_u32(buf_.data() + pos + 5);
+      if (raw_len > WIRE_COMPRESSION_BLOCK_SIZE || payload_len > raw_len) {
+        ok = false;
+        break;
+      }
+      if (buf_.size() - pos - WIRE_COMPRESSED_FRAME_HEADER_SIZE < payload_len) {
+        break;
+      }
+      const char *payload = buf_.data() + pos + WIRE_COMPRESSED_FRAME_HEADER_SIZE;
+      if (type == WIRE_COMPRESSED_FRAME_PLAIN && payload_len == raw_len) {
+        out.append(payload, payload_len);
+      } else if (type != WIRE_COMPRESSED_FRAME_COMPRESSED ||
+                 !wire_decompress_block(compression_, payload, payload_len, raw_len, out)) {
+        ok = false;
+        break;
+      }
+      pos += WIRE_COMPRESSED_FRAME_HEADER_SIZE + payload_len;
+    }
+    buf_.erase(0, pos);
+    return ok;
+  }
+
+private:
+  WireCompression compression_;
+  std::string buf_;  // 还不完整的帧
+};
+
+#endif  //__SRC_OBSERVER_NET_WIRE_COMPRESSION_H__
@@ -0,0 +1,139 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Binary wire protocol shared by observer and obclient.
+//
+
+#ifndef __SRC_OBSERVER_NET_WIRE_PROTOCOL_H__
+#define __SRC_OBSERVER_NET_WIRE_PROTOCOL_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+/**
+ * 二进制协议。请求仍然是以'\0'结尾的sql，客户端连接之后先发送BINARY_PROTOCOL_HANDSHAKE，
+ * 服务端回复一个WIRE_FRAME_END，之后这个连接上的结果都按帧发送，不再以'\0'结尾。
+ * 一个请求的结果由若干帧组成，以WIRE_FRAME_END结束。每一帧是1字节的类型、4字节的内容长度和内容，
+ * 整数都是小端：
+ * WIRE_FRAME_MESSAGE  文本消息，内容和文本协议的结果相同，比如"SUCCESS\n"
+ * WIRE_FRAME_SCHEMA   u16列数，每列u8类型、u16列名长度和列名
+ * WIRE_FRAME_ROWS     u32行数，每行是u16值的个数(聚合的结果可能和列数不同)和按列的顺序排列的值，
+ *                     每个值是u8类型和值：WIRE_VALUE_INT是i32，WIRE_VALUE_FLOAT是f32，
+ *                     WIRE_VALUE_STRING是u16长度和内容，WIRE_VALUE_NULL没有值
+ * WIRE_FRAME_END      没有内容
+ */
+#define BINARY_PROTOCOL_HANDSHAKE "\x7f" "MINIOB BINARY PROTOCOL 1"
+/**
+ * 结果压缩的握手，后面跟压缩方式的名字，两种协议都可以使用，见net/wire_compression.h
+ */
+#define COMPRESSION_HANDSHAKE_PREFIX "\x7f" "MINIOB COMPRESSION "
+/**
+ * 切换到共享内存传输的握手，只能用于unix socket连接，见net/shm_ring.h
+ */
+#define SHM_TRANSPORT_HANDSHAKE "\x7f" "MINIOB SHARED MEMORY"
+
+enum WireFrameType
+{
+  WIRE_FRAME_MESSAGE = 'M',
+  WIRE_FRAME_SCHEMA = 'S',
+  WIRE_FRAME_ROWS = 'R',
+  WIRE_FRAME_END = 'E',
+};
+
+enum WireValueType
+{
+  WIRE_VALUE_NULL = 0,
+  WIRE_VALUE_INT = 1,
+  WIRE_VALUE_FLOAT = 2,
+  WIRE_VALUE_STRING = 3,
+  WIRE_VALUE_DATE = 4,  // 只用于列的类型，值按字符串发送
+};
+
+#define WIRE_FRAME_HEADER_SIZE 5
+
+inline void wire_put_u8(std::string &out, uint8_t v)
+{
+  out.push_back((char)v);
+}
+
+inline void wire_put_u16(std::string &out, uint16_t v)
+{
+  out.push_back((char)(v & 0xff));
+  out.push_back((char)(v >> 8));
+}
+
+inline void wire_put_u32(std::string &out, uint32_t v)
+{
+  for (int i = 0; i < 4; i++) {
+    out.push_back((char)((v >> (i * 8)) & 0xff));
+  }
+}
+
+inline void wire_put_f32(std::string &out, float v)
+{
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  wire_put_u32(out, bits);
+}
+
+inline void wire_set_u32(std::string &out, size_t pos, uint32_t v)
+{
+  for (int i = 0; i < 4; i++) {
+    out[pos + i] = (char)((v >> (i * 8)) & 0xff);
+  }
+}
+
+inline uint16_t wire_get_u16(const char *p)
+{
+  const uint8_t *u = (const uint8_t *)p;
+  return (uint16_t)(u[0] | (u[1] << 8));
+}
+
+inline uint32_t wire_get_u32(const char *p)
+{
+  const uint8_t *u = (const uint8_t *)p;
+  return (uint32_t)u[0] | ((uint32_t)u[1] << 8) | ((uint32_t)u[2] << 16) | ((uint32_t)u[3] << 24);
+}
+
+inline float wire_get_f32(const char *p)
+{
+  uint32_t bits = wire_get_u32(p);
+  float v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+/**
+ * 开始一帧，返回帧在out中的位置，内容写完之后调用wire_frame_end填上长度
+ */
+inline size_t wire_frame_begin(std::string &out, WireFrameType type)
+{
+  size_t pos = out.size();
+  out.push_back((char)type);
+  out.append(4, '\0');
+  return pos;
+}
+
+inline void wire_frame_end(std::string &out, size_t frame_pos)
+{
+  wire_set_u32(out, frame_pos + 1, (uint32_t)(out.size() - frame_pos - WIRE_FRAME_HEADER_SIZE));
+}
+
+inline void wire_put_frame(std::string &out, WireFrameType type, const char *data, size_t len)
+{
+  size_t pos = wire_frame_begin(out, type);
+  out.append(data, len);
+  wire_frame_end(out, pos);
+}
+
+#endif  //__SRC_OBSERVER_NET_WIRE_PROTOCOL_H__
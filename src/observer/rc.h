@@ -112,6 +112,7 @@ enum RCLock {
   LVIRT,
   NEED_WAIT,
   RESOURCE_DELETED,
+  DEADLOCK,
 };
 
 enum RCBusy {
@@ -203,7 +204,7 @@ enum RC {
   MISUSE,        /* Library used incorrectly */
   NOLFS,         /* Uses OS features not supported on host */
   AUTH,          /* Authorization denied */
-  FORMAT,        /* Not used */
+  FORMAT,        /* File format is not supported */
   RANGE,         /* 2nd parameter to bind out of range */
   NOTADB,        /* File opened that is not a database file */
   NOTICE = 100,  /* Notifications from log() */
@@ -295,6 +296,7 @@ enum RC {
   LOCKED_VIRT = (LOCKED | (RCLock::LVIRT << 8)),
   LOCKED_NEED_WAIT = (LOCKED | (RCLock::NEED_WAIT << 8)),
   LOCKED_RESOURCE_DELETED = (LOCKED | (RCLock::RESOURCE_DELETED << 8)),
+  LOCKED_DEADLOCK = (LOCKED | (RCLock::DEADLOCK << 8)),
 
   /* busy part */
   BUSY_RECOVERY = (BUSY | (RCBusy::BRECOVERY << 8)),
@@ -0,0 +1,32 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Server-side cursors kept in a session between fetches.
+//
+
+#include "session/cursor.h"
+#include "storage/common/table.h"
+
+Cursor::~Cursor() {
+  unpin_tables();
+}
+
+void Cursor::pin_table(Table *table) {
+  table->pin_by_cursor();
+  tables_.push_back(table);
+}
+
+void Cursor::unpin_tables() {
+  for (Table *table : tables_) {
+    table->unpin_by_cursor();
+  }
+  tables_.clear();
+}
@@ -0,0 +1,52 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Server-side cursors kept in a session between fetches.
+//
+
+#ifndef __OBSERVER_SESSION_CURSOR_H__
+#define __OBSERVER_SESSION_CURSOR_H__
+
+#include <vector>
+
+class Table;
+
+/**
+ * DECLARE CURSOR打开的服务器端游标，保存在Session中。执行计划在两次FETCH之间挂起，
+ * 只占用算子自己缓存的数据，每次返回多少行由FETCH决定，服务器和客户端都不需要容纳整个结果。
+ * 扫描从打开到关闭一直持有表的整理锁(读锁)，所以游标扫描的表在游标关闭之前不能删除、清空、
+ * 分析或者建索引，这些语句直接失败而不是等待游标关闭，见Table::pinned_by_cursor
+ */
+class Cursor {
+public:
+  Cursor() = default;
+  virtual ~Cursor();
+
+  Cursor(const Cursor &) = delete;
+  Cursor &operator=(const Cursor &) = delete;
+
+  /**
+   * 游标使用session的事务(在多语句事务中声明)时返回true，事务提交或回滚之前需要关闭
+   */
+  virtual bool uses_session_trx() const = 0;
+
+protected:
+  /**
+   * 记下游标扫描的表，unpin_tables或者游标销毁时释放
+   */
+  void pin_table(Table *table);
+  void unpin_tables();
+
+private:
+  std::vector<Table *> tables_;
+};
+
+#endif  // __OBSERVER_SESSION_CURSOR_H__
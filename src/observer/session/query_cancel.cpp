@@ -0,0 +1,68 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Cooperative cancellation of a running statement.
+//
+
+#include "session/query_cancel.h"
+
+static thread_local QueryCancel *current_cancel = nullptr;
+
+uint64_t QueryCancel::begin() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  running_ = true;
+  reason_.store((int)Reason::NONE);
+  return ++seq_;
+}
+
+void QueryCancel::end() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  running_ = false;
+}
+
+bool QueryCancel::cancel(Reason reason) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (!running_) {
+    return false;
+  }
+  int expected = (int)Reason::NONE;
+  reason_.compare_exchange_strong(expected, (int)reason);
+  return true;
+}
+
+bool QueryCancel::cancel(uint64_t seq, Reason reason) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (!running_ || seq != seq_) {
+    return false;
+  }
+  int expected = (int)Reason::NONE;
+  reason_.compare_exchange_strong(expected, (int)reason);
+  return true;
+}
+
+const char *QueryCancel::reason_name(Reason reason) {
+  switch (reason) {
+    case Reason::KILLED:
+      return "killed";
+    case Reason::TIMEOUT:
+      return "timeout";
+    default:
+      return "none";
+  }
+}
+
+QueryCancel *QueryCancel::current() {
+  return current_cancel;
+}
+
+void QueryCancel::set_current(QueryCancel *cancel) {
+  current_cancel = cancel;
+}
@@ -0,0 +1,101 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Cooperative cancellation of a running statement.
+//
+
+#ifndef __OBSERVER_SESSION_QUERY_CANCEL_H__
+#define __OBSERVER_SESSION_QUERY_CANCEL_H__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+// 逐行处理的循环每隔这么多行检查一次是否被取消，必须是2的幂
+#define QUERY_CANCEL_CHECK_INTERVAL 1024
+
+/**
+ * 一个session中正在执行的语句的取消标记。语句超时或者被kill query时设置标记，
+ * 扫描、join和排序的循环在当前线程的标记被设置后返回RC::INTERRUPT，语句失败并释放占用的线程、页面和内存。
+ * 每条语句有一个序号，定时器到期时语句可能已经结束，只能取消序号相同的语句
+ */
+class QueryCancel {
+public:
+  enum class Reason {
+    NONE = 0,
+    KILLED,
+    TIMEOUT,
+  };
+
+  /**
+   * 开始执行一条语句，清除之前的标记，返回语句的序号
+   */
+  uint64_t begin();
+  void end();
+
+  /**
+   * 取消正在执行的语句，没有语句在执行时返回false
+   */
+  bool cancel(Reason reason);
+  /**
+   * 只取消序号为seq的语句
+   */
+  bool cancel(uint64_t seq, Reason reason);
+
+  bool cancelled() const {
+    return reason_.load(std::memory_order_relaxed) != (int)Reason::NONE;
+  }
+  Reason reason() const {
+    return (Reason)reason_.load(std::memory_order_relaxed);
+  }
+  static const char *reason_name(Reason reason);
+
+  /**
+   * 当前线程执行的语句的标记，执行语句和并行扫描的线程设置，存储层和算子通过它检查
+   */
+  static QueryCancel *current();
+  static void set_current(QueryCancel *cancel);
+  static bool current_cancelled() {
+    QueryCancel *cancel = current();
+    return cancel != nullptr && cancel->cancelled();
+  }
+  /**
+   * 循环中每次调用，counter累加到QUERY_CANCEL_CHECK_INTERVAL的倍数时才检查
+   */
+  static bool poll(unsigned int &counter) {
+    return (++counter & (QUERY_CANCEL_CHECK_INTERVAL - 1)) == 0 && current_cancelled();
+  }
+
+private:
+  std::mutex mutex_;
+  uint64_t seq_ = 0;
+  bool running_ = false;
+  std::atomic<int> reason_{(int)Reason::NONE};
+};
+
+/**
+ * 在作用域内把cancel设置为当前线程的标记，离开时恢复
+ */
+class QueryCancelScope {
+public:
+  explicit QueryCancelScope(QueryCancel *cancel) : saved_(QueryCancel::current()) {
+    QueryCancel::set_current(cancel);
+  }
+  ~QueryCancelScope() {
+    QueryCancel::set_current(saved_);
+  }
+
+private:
+  QueryCancel *saved_;
+};
+
+#endif  // __OBSERVER_SESSION_QUERY_CANCEL_H__
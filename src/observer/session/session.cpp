@@ -13,6 +13,9 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include "session/session.h"
+#include "session/cursor.h"
+#include "common/lang/string.h"
+#include "common/time/datetime.h"
 #include "storage/trx/trx.h"
 
 Session &Session::default_session() {
@@ -20,12 +23,24 @@ Session &Session::default_session() {
   return session;
 }
 
-Session::Session(const Session &other) : current_db_(other.current_db_){
+Session::Session(const Session &other)
+    : current_db_(other.current_db_), statement_timeout_ms_(other.statement_timeout_ms_),
+      last_active_usec_(common::Now::usec()) {
 }
 
 Session::~Session() {
+  for (auto &iter : cursors_) {
+    delete iter.second;
+  }
+  cursors_.clear();
+
   delete trx_;
   trx_ = nullptr;
+
+  for (auto &iter : prepared_statements_) {
+    query_destroy(iter.second);
+  }
+  prepared_statements_.clear();
 }
 
 const std::string &Session::get_current_db() const {
@@ -46,6 +61,130 @@ bool Session::is_trx_multi_operation_mode() const {
 Trx *Session::current_trx() {
   if (trx_ == nullptr) {
     trx_ = new Trx;
+    trx_->set_synchronous_commit(synchronous_commit_);
   }
   return trx_;
 }
+
+void Session::set_synchronous_commit(bool synchronous_commit) {
+  synchronous_commit_ = synchronous_commit;
+  if (trx_ != nullptr) {
+    trx_->set_synchronous_commit(synchronous_commit);
+  }
+}
+
+bool Session::synchronous_commit() const {
+  return synchronous_commit_;
+}
+
+void Session::add_prepared_statement(Query *query) {
+  Query *&stmt = prepared_statements_[query->sstr.prepare.stmt_name];
+  if (stmt != nullptr) {
+    query_destroy(stmt);
+  }
+  stmt = query;
+}
+
+const Prepare *Session::find_prepared_statement(const char *stmt_name) const {
+  auto iter = prepared_statements_.find(stmt_name);
+  if (iter == prepared_statements_.end()) {
+    return nullptr;
+  }
+  return &iter->second->sstr.prepare;
+}
+
+bool Session::remove_prepared_statement(const char *stmt_name) {
+  auto iter = prepared_statements_.find(stmt_name);
+  if (iter == prepared_statements_.end()) {
+    return false;
+  }
+  query_destroy(iter->second);
+  prepared_statements_.erase(iter);
+  return true;
+}
+
+bool Session::add_cursor(const char *name, Cursor *cursor) {
+  return cursors_.emplace(name, cursor).second;
+}
+
+Cursor *Session::find_cursor(const char *name) const {
+  auto iter = cursors_.find(name);
+  return iter == cursors_.end() ? nullptr : iter->second;
+}
+
+bool Session::remove_cursor(const char *name) {
+  auto iter = cursors_.find(name);
+  if (iter == cursors_.end()) {
+    return false;
+  }
+  delete iter->second;
+  cursors_.erase(iter);
+  return true;
+}
+
+void Session::close_trx_cursors() {
+  for (auto iter = cursors_.begin(); iter != cursors_.end();) {
+    if (iter->second->uses_session_trx()) {
+      delete iter->second;
+      iter = cursors_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+void Session::begin_request(const char *sql) {
+  std::lock_guard<std::mutex> guard(lock_);
+  in_request_ = true;
+  request_begin_usec_ = common::Now::usec();
+  request_sql_ = sql;
+  // 请求中带着换行符
+  common::strip(request_sql_);
+}
+
+void Session::end_request() {
+  std::lock_guard<std::mutex> guard(lock_);
+  in_request_ = false;
+  last_active_usec_ = common::Now::usec();
+  request_sql_.clear();
+}
+
+SessionInfo Session::info(int64_t now_usec) {
+  std::lock_guard<std::mutex> guard(lock_);
+  return SessionInfo{id_, in_request_, in_request_ ? now_usec - request_begin_usec_ : 0, request_sql_};
+}
+
+bool Session::reclaim_if_idle(int64_t now_usec, int64_t idle_usec) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (in_request_ || trx_ == nullptr || now_usec - last_active_usec_ < idle_usec) {
+    return false;
+  }
+  // 多语句事务中的修改要保留到commit或rollback
+  if (trx_multi_operation_mode_ || trx_->started()) {
+    return false;
+  }
+  delete trx_;
+  trx_ = nullptr;
+  return true;
+}
+
+void Session::reset(const Session &other) {
+  for (auto &iter : cursors_) {
+    delete iter.second;
+  }
+  std::unordered_map<std::string, Cursor *>().swap(cursors_);
+  delete trx_;
+  trx_ = nullptr;
+  trx_multi_operation_mode_ = false;
+  synchronous_commit_ = true;
+  for (auto &iter : prepared_statements_) {
+    query_destroy(iter.second);
+  }
+  // 重新使用的session不保留上一个连接的哈希表空间
+  std::unordered_map<std::string, Query *>().swap(prepared_statements_);
+  current_db_ = other.current_db_;
+  statement_timeout_ms_ = other.statement_timeout_ms_;
+  in_request_ = false;
+  request_sql_.clear();
+  last_active_usec_ = common::Now::usec();
+}
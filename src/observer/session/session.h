@@ -15,9 +15,28 @@ See the Mulan PSL v2 for more details. */
 #ifndef __OBSERVER_SESSION_SESSION_H__
 #define __OBSERVER_SESSION_SESSION_H__
 
+#include <stdint.h>
+
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+
+#include "session/query_cancel.h"
+#include "sql/parser/parse_defs.h"
 
 class Trx;
+class Cursor;
+
+/**
+ * show processlist中的一行
+ */
+struct SessionInfo {
+  uint32_t id;
+  bool in_request;
+  int64_t request_usec;  // 请求已经执行的时间
+  std::string sql;
+};
 
 class Session {
 public:
@@ -39,10 +58,90 @@ public:
 
   Trx * current_trx();
 
+  /**
+   * set synchronous_commit = on|off，对之后提交的事务生效
+   */
+  void set_synchronous_commit(bool synchronous_commit);
+  bool synchronous_commit() const;
+
+  /**
+   * 保存PREPARE解析出的语句，session接管query，同名的语句会被替换
+   */
+  void add_prepared_statement(Query *query);
+  const Prepare *find_prepared_statement(const char *stmt_name) const;
+  bool remove_prepared_statement(const char *stmt_name);
+
+  /**
+   * 保存DECLARE CURSOR打开的游标，session接管cursor。同名的游标已经打开时返回false，cursor不被接管
+   */
+  bool add_cursor(const char *name, Cursor *cursor);
+  Cursor *find_cursor(const char *name) const;
+  bool remove_cursor(const char *name);
+  /**
+   * 多语句事务提交或回滚之前调用，关闭使用这个事务的游标
+   */
+  void close_trx_cursors();
+
+  /**
+   * 连接的编号，kill query使用
+   */
+  uint32_t id() const {
+    return id_;
+  }
+  void set_id(uint32_t id) {
+    id_ = id;
+  }
+
+  /**
+   * set statement_timeout = 毫秒数，之后的语句执行超过这个时间时被取消，0表示不限制
+   */
+  void set_statement_timeout(int64_t timeout_ms) {
+    statement_timeout_ms_ = timeout_ms;
+  }
+  int64_t statement_timeout() const {
+    return statement_timeout_ms_;
+  }
+  /**
+   * 正在执行的语句的取消标记，超时的定时器可能比session活得长，所以是共享的
+   */
+  const std::shared_ptr<QueryCancel> &query_cancel() const {
+    return query_cancel_;
+  }
+
+  /**
+   * 开始和结束执行一个请求。执行中的session不会被回收
+   */
+  void begin_request(const char *sql);
+  void end_request();
+  SessionInfo info(int64_t now_usec);
+
+  /**
+   * 超过idle_usec没有请求，并且没有进行中的事务时释放空闲的事务对象，下一个请求需要时再创建。
+   * 返回是否释放了内存
+   */
+  bool reclaim_if_idle(int64_t now_usec, int64_t idle_usec);
+
+  /**
+   * 放回session池之前恢复成和other一样的初始状态，释放游标、事务和预编译语句
+   */
+  void reset(const Session &other);
+
 private:
   std::string  current_db_;
   Trx         *trx_ = nullptr;
   bool         trx_multi_operation_mode_ = false; // 当前事务的模式，是否多语句模式. 单语句模式自动提交
+  bool         synchronous_commit_ = true;        // 提交时是否等待redo日志落盘，事务对象重新创建时也要设置
+  std::unordered_map<std::string, Query *> prepared_statements_; // 预编译语句，flag都是SCF_PREPARE
+  std::unordered_map<std::string, Cursor *> cursors_;  // 打开的游标，可能在使用trx_，要在trx_之前释放
+  uint32_t     id_ = 0;
+  int64_t      statement_timeout_ms_ = 0;
+  std::shared_ptr<QueryCancel> query_cancel_ = std::make_shared<QueryCancel>();
+
+  std::mutex   lock_;                     // 保护下面的状态和回收trx_，请求的执行过程不加锁
+  bool         in_request_ = false;
+  int64_t      last_active_usec_ = 0;     // 上一个请求结束的时间
+  int64_t      request_begin_usec_ = 0;
+  std::string  request_sql_;
 };
 
 #endif // __OBSERVER_SESSION_SESSION_H__
\ No newline at end of file
@@ -0,0 +1,137 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// A pool of sessions reused across connections, and the idle-session sweep.
+//
+
+#include "session/session_pool.h"
+
+#include <algorithm>
+#include <new>
+
+#include "common/time/datetime.h"
+#include "session/session.h"
+
+SessionPool &SessionPool::instance() {
+  static SessionPool pool;
+  return pool;
+}
+
+SessionPool::~SessionPool() {
+  for (Session *session : idle_) {
+    delete session;
+  }
+  idle_.clear();
+}
+
+Session *SessionPool::acquire() {
+  Session *session = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (!idle_.empty()) {
+      session = idle_.back();
+      idle_.pop_back();
+    }
+  }
+  if (session == nullptr) {
+    session = new (std::nothrow) Session(Session::default_session());
+    if (session == nullptr) {
+      return nullptr;
+    }
+  } else {
+    session->reset(Session::default_session());
+  }
+
+  std::lock_guard<std::mutex> guard(lock_);
+  session->set_id(next_id_++);
+  active_.insert(session);
+  return session;
+}
+
+void SessionPool::release(Session *session) {
+  if (session == nullptr) {
+    return;
+  }
+  {
+    // 先从active_中去掉，之后回收线程不会再访问这个session
+    std::lock_guard<std::mutex> guard(lock_);
+    active_.erase(session);
+  }
+  // 放回池中之前释放事务和预编译语句，空闲的session只占用对象本身
+  session->reset(Session::default_session());
+
+  std::lock_guard<std::mutex> guard(lock_);
+  if (idle_.size() < max_idle_) {
+    idle_.push_back(session);
+    return;
+  }
+  delete session;
+}
+
+void SessionPool::set_max_idle(size_t max_idle) {
+  std::vector<Session *> evicted;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    max_idle_ = max_idle;
+    while (idle_.size() > max_idle_) {
+      evicted.push_back(idle_.back());
+      idle_.pop_back();
+    }
+  }
+  for (Session *session : evicted) {
+    delete session;
+  }
+}
+
+int SessionPool::reclaim_idle(int64_t idle_usec) {
+  const int64_t now = common::Now::usec();
+  int reclaimed = 0;
+  std::lock_guard<std::mutex> guard(lock_);
+  for (Session *session : active_) {
+    if (session->reclaim_if_idle(now, idle_usec)) {
+      reclaimed++;
+    }
+  }
+  return reclaimed;
+}
+
+size_t SessionPool::active_count() {
+  std::lock_guard<std::mutex> guard(lock_);
+  return active_.size();
+}
+
+size_t SessionPool::idle_count() {
+  std::lock_guard<std::mutex> guard(lock_);
+  return idle_.size();
+}
+
+bool SessionPool::kill_query(uint32_t id) {
+  // 持有lock_时session不会被放回池中
+  std::lock_guard<std::mutex> guard(lock_);
+  for (Session *session : active_) {
+    if (session->id() == id) {
+      return session->query_cancel()->cancel(QueryCancel::Reason::KILLED);
+    }
+  }
+  return false;
+}
+
+void SessionPool::list(std::vector<SessionInfo> &sessions) {
+  const int64_t now = common::Now::usec();
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    for (Session *session : active_) {
+      sessions.push_back(session->info(now));
+    }
+  }
+  std::sort(sessions.begin(), sessions.end(),
+            [](const SessionInfo &left, const SessionInfo &right) { return left.id < right.id; });
+}
@@ -0,0 +1,71 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// A pool of sessions reused across connections, and the idle-session sweep.
+//
+
+#ifndef __OBSERVER_SESSION_SESSION_POOL_H__
+#define __OBSERVER_SESSION_SESSION_POOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+class Session;
+struct SessionInfo;
+
+/**
+ * 连接使用的session从池中取，连接关闭后恢复初始状态放回池中，池中最多保留max_idle个。
+ * 池也记录所有使用中的session，定时回收长时间没有请求的session占用的事务对象。每次取出时分配一个新的连接编号
+ */
+class SessionPool {
+public:
+  static SessionPool &instance();
+
+  ~SessionPool();
+
+  /**
+   * 取一个和Session::default_session状态相同的session
+   */
+  Session *acquire();
+  void release(Session *session);
+
+  void set_max_idle(size_t max_idle);
+
+  /**
+   * 回收超过idle_usec没有请求的session的空闲状态，返回回收的个数
+   */
+  int reclaim_idle(int64_t idle_usec);
+
+  size_t active_count();
+  size_t idle_count();
+
+  /**
+   * 取消编号为id的连接正在执行的语句，连接不存在或者没有在执行语句时返回false
+   */
+  bool kill_query(uint32_t id);
+  /**
+   * 使用中的session，按编号排序
+   */
+  void list(std::vector<SessionInfo> &sessions);
+
+private:
+  std::mutex lock_;
+  uint32_t next_id_ = 1;
+  size_t max_idle_ = 64;
+  std::vector<Session *> idle_;
+  std::unordered_set<Session *> active_;
+};
+
+#endif  // __OBSERVER_SESSION_SESSION_POOL_H__
@@ -22,17 +22,77 @@ See the Mulan PSL v2 for more details. */
 #include "common/seda/timer_stage.h"
 
 #include "common/lang/mutex.h"
+#include "common/os/path.h"
 #include "common/metrics/metrics_registry.h"
 #include "common/seda/callback.h"
+#include "common/seda/request_trace.h"
 #include "event/session_event.h"
 #include "event/sql_event.h"
 #include "net/server.h"
+#include "net/wire_compression.h"
+#include "net/wire_protocol.h"
+#include "session/query_cancel.h"
 #include "session/session.h"
+#include "session/session_pool.h"
+#include "session/slow_query_log.h"
+#include "session/statement_stats.h"
 
 using namespace common;
 
 const std::string SessionStage::SQL_METRIC_TAG = "SessionStage.sql";
 
+static const char *CONF_SESSION_IDLE_TIMEOUT = "SessionIdleTimeout";
+static const char *CONF_SESSION_POOL_SIZE = "SessionPoolSize";
+static const char *CONF_SLOW_QUERY_TIME = "SlowQueryTime";
+static const char *CONF_SLOW_QUERY_LOG_FILE = "SlowQueryLogFile";
+static const char *CONF_TRACE_SAMPLE_RATE = "TraceSampleRate";
+static const char *CONF_TRACE_FILE = "TraceFile";
+static const char *CONF_STATEMENT_STATS_SIZE = "StatementStatsSize";
+static const char *CONF_STATEMENT_TIMEOUT = "StatementTimeout";
+
+/**
+ * 定时回收空闲session的事件，一直在本stage和TimerStage之间循环
+ */
+class IdleSweepEvent : public StageEvent {
+public:
+  bool timer_fired = false;  // 定时器已经到期，需要回收一次
+};
+
+/**
+ * 语句的超时定时器。TimerStage到期时调用done()，这个事件没有回调，直接被删除，在析构时取消语句，
+ * 这样即使SQLThreads的线程都被慢查询占住，超时也能生效。语句已经结束时序号不同，没有作用
+ */
+class StatementTimeoutEvent : public StageEvent {
+public:
+  StatementTimeoutEvent(std::shared_ptr<QueryCancel> cancel, uint64_t seq, uint32_t session_id)
+      : cancel_(std::move(cancel)), seq_(seq), session_id_(session_id) {}
+  ~StatementTimeoutEvent() override {
+    if (cancel_->cancel(seq_, QueryCancel::Reason::TIMEOUT)) {
+      LOG_INFO("Cancel statement of session %u since it runs out of time", session_id_);
+    }
+  }
+
+private:
+  std::shared_ptr<QueryCancel> cancel_;
+  uint64_t seq_;
+  uint32_t session_id_;
+};
+
+static bool parse_non_negative(const std::map<std::string, std::string> &section, const char *key, long &value) {
+  auto iter = section.find(key);
+  if (iter == section.end()) {
+    return true;
+  }
+  char *end = nullptr;
+  long number = strtol(iter->second.c_str(), &end, 10);
+  if (end == iter->second.c_str() || *end != '\0' || number < 0 || number > INT32_MAX) {
+    LOG_ERROR("Invalid config %s=%s", key, iter->second.c_str());
+    return false;
+  }
+  value = number;
+  return true;
+}
+
 // Constructor
 SessionStage::SessionStage(const char *tag)
     : Stage(tag), resolve_stage_(nullptr), sql_metric_(nullptr) {}
@@ -53,14 +113,63 @@ Stage *SessionStage::make_stage(const std::string &tag) {
 
 // Set properties for this object set in stage specific properties
 bool SessionStage::set_properties() {
-  //  std::string stageNameStr(stage_name_);
-  //  std::map<std::string, std::string> section = g_properties()->get(
-  //    stageNameStr);
-  //
-  //  std::map<std::string, std::string>::iterator it;
-  //
-  //  std::string key;
+  std::string stageNameStr(stage_name_);
+  std::map<std::string, std::string> section = get_properties()->get(stageNameStr);
 
+  long idle_timeout = idle_timeout_;
+  if (!parse_non_negative(section, CONF_SESSION_IDLE_TIMEOUT, idle_timeout)) {
+    return false;
+  }
+  idle_timeout_ = (int)idle_timeout;
+
+  long pool_size = -1;
+  if (!parse_non_negative(section, CONF_SESSION_POOL_SIZE, pool_size)) {
+    return false;
+  }
+  if (pool_size >= 0) {
+    SessionPool::instance().set_max_idle((size_t)pool_size);
+    LOG_INFO("Keep at most %ld idle sessions in pool", pool_size);
+  }
+
+  long slow_query_time = -1;
+  if (!parse_non_negative(section, CONF_SLOW_QUERY_TIME, slow_query_time)) {
+    return false;
+  }
+  slow_query_time_ = slow_query_time;
+  auto iter = section.find(CONF_SLOW_QUERY_LOG_FILE);
+  if (iter != section.end()) {
+    slow_query_log_file_ = iter->second;
+  }
+
+  iter = section.find(CONF_TRACE_SAMPLE_RATE);
+  if (iter != section.end()) {
+    char *end = nullptr;
+    trace_sample_rate_ = strtod(iter->second.c_str(), &end);
+    if (end == iter->second.c_str() || *end != '\0' || trace_sample_rate_ < 0 || trace_sample_rate_ > 1) {
+      LOG_ERROR("Invalid config %s=%s", CONF_TRACE_SAMPLE_RATE, iter->second.c_str());
+      return false;
+    }
+  }
+  iter = section.find(CONF_TRACE_FILE);
+  if (iter != section.end()) {
+    trace_file_ = iter->second;
+  }
+
+  long statement_stats_size = -1;
+  if (!parse_non_negative(section, CONF_STATEMENT_STATS_SIZE, statement_stats_size)) {
+    return false;
+  }
+  if (statement_stats_size >= 0) {
+    StatementStatsTable::instance().set_capacity((size_t)statement_stats_size);
+    LOG_INFO("Keep statistics of at most %ld statements", statement_stats_size);
+  }
+
+  long statement_timeout = 0;
+  if (!parse_non_negative(section, CONF_STATEMENT_TIMEOUT, statement_timeout)) {
+    return false;
+  }
+  // 新的连接从default_session复制
+  Session::default_session().set_statement_timeout(statement_timeout);
   return true;
 }
 
@@ -71,9 +180,31 @@ bool SessionStage::initialize() {
   std::list<Stage *>::iterator stgp = next_stage_list_.begin();
   resolve_stage_ = *(stgp++);
 
+  if (stgp != next_stage_list_.end()) {
+    timer_stage_ = *(stgp++);
+  }
+  if (idle_timeout_ > 0) {
+    if (nullptr == timer_stage_) {
+      LOG_WARN("Idle session reclamation is disabled, since no TimerStage is configured as next stage");
+    } else {
+      LOG_INFO("Reclaim sessions idle for %d seconds", idle_timeout_);
+      add_event(new IdleSweepEvent());
+    }
+  }
+  if (nullptr == timer_stage_) {
+    LOG_WARN("Statement timeout is disabled, since no TimerStage is configured as next stage");
+  }
+
   MetricsRegistry &metricsRegistry = get_metrics_registry();
-  sql_metric_ = new SimpleTimer();
+  sql_metric_ = new LatencyHistogram();
   metricsRegistry.register_metric(SQL_METRIC_TAG, sql_metric_);
+
+  if (slow_query_time_ >= 0) {
+    SlowQueryLog::instance().init(getAboslutPath(slow_query_log_file_.c_str()), slow_query_time_);
+  }
+  if (trace_sample_rate_ > 0) {
+    RequestTraceLog::instance().init(getAboslutPath(trace_file_.c_str()), trace_sample_rate_);
+  }
   LOG_TRACE("Exit");
   return true;
 }
@@ -88,6 +219,8 @@ void SessionStage::cleanup() {
     delete sql_metric_;
     sql_metric_ = nullptr;
   }
+  SlowQueryLog::instance().close();
+  RequestTraceLog::instance().close();
 
   LOG_TRACE("Exit");
 }
@@ -95,7 +228,11 @@ void SessionStage::cleanup() {
 void SessionStage::handle_event(StageEvent *event) {
   LOG_TRACE("Enter\n");
 
-  // right now, we just support only one event.
+  if (dynamic_cast<IdleSweepEvent *>(event) != nullptr) {
+    handle_idle_sweep_event(event);
+    LOG_TRACE("Exit\n");
+    return;
+  }
   handle_request(event);
 
   LOG_TRACE("Exit\n");
@@ -105,24 +242,45 @@ void SessionStage::handle_event(StageEvent *event) {
 void SessionStage::callback_event(StageEvent *event, CallbackContext *context) {
   LOG_TRACE("Enter\n");
 
+  IdleSweepEvent *sweep_event = dynamic_cast<IdleSweepEvent *>(event);
+  if (sweep_event != nullptr) {
+    // 定时器线程回调，回到本stage的线程中回收
+    sweep_event->timer_fired = true;
+    add_event(sweep_event);
+    LOG_TRACE("Exit\n");
+    return;
+  }
+
   SessionEvent *sev = dynamic_cast<SessionEvent *>(event);
   if (nullptr == sev) {
     LOG_ERROR("Cannot cat event to sessionEvent");
     return;
   }
 
-  const char *response = sev->get_response();
-  int len = sev->get_response_len();
-  if (len <= 0 || response == nullptr) {
-    response = "No data\n";
-    len = strlen(response) + 1;
+  Session *session = sev->get_client()->session;
+  session->query_cancel()->end();
+  session->end_request();
+  sev->end_response();
+  // 发送失败时连接会被异步关闭，session随时可能释放，之后不能再访问
+  const std::string db = session->get_current_db();
+  QueryTrace &trace = sev->query_trace();
+  trace.enter_stage("send");
+  const int ret = Server::send(sev->get_client(), sev->get_response(), sev->get_response_len());
+  trace.end();
+  SlowQueryLog::instance().record(sev->get_request_buf(), trace);
+  StatementStatsTable &statement_stats = StatementStatsTable::instance();
+  if (statement_stats.enabled()) {
+    statement_stats.record(db, sev->get_request_buf(), trace);
+  }
+  if (sev->trace() != nullptr) {
+    RequestTraceLog::instance().write(*sev->trace(), sev->get_request_buf());
+  }
+  if (ret != 0) {
+    // 连接已经关闭
+    return;
   }
-  Server::send(sev->get_client(), response, len);
-	if ('\0' != response[len - 1]) {
-		// 这里强制性的给发送一个消息终结符，如果需要发送多条消息，需要调整
-		char end = 0;
-		Server::send(sev->get_client(), &end, 1);
-	}
+  // 结果发送完之后才执行这个连接上的下一个请求，保证结果的顺序
+  Server::request_done(sev->get_client());
 
   // sev->done();
   LOG_TRACE("Exit\n");
@@ -137,15 +295,69 @@ void SessionStage::handle_request(StageEvent *event) {
     return;
   }
 
-  TimerStat sql_stat(*sql_metric_);
+  LatencyStat sql_stat(*sql_metric_);
   if (nullptr == sev->get_request_buf()) {
     LOG_ERROR("Invalid request buffer.");
+    Server::request_done(sev->get_client());
     sev->done_immediate();
     return ;
   }
 
   std::string sql = sev->get_request_buf();
   if (common::is_blank(sql.c_str())) {
+    Server::request_done(sev->get_client());
+    sev->done_immediate();
+    return;
+  }
+
+  if (sql == BINARY_PROTOCOL_HANDSHAKE) {
+    // 之后的结果都使用二进制协议，回复一个空的结果表示客户端可以开始发送请求
+    sev->get_client()->binary_protocol = true;
+    std::string ack;
+    wire_frame_begin(ack, WIRE_FRAME_END);
+    if (Server::send(sev->get_client(), ack.data(), ack.size()) == 0) {
+      Server::request_done(sev->get_client());
+    }
+    sev->done_immediate();
+    return;
+  }
+
+  if (sql == SHM_TRANSPORT_HANDSHAKE) {
+    // 成功时ack带上共享内存和eventfd，之后的请求和结果都经过共享内存。连接不能使用共享内存时回复失败
+    bool enabled = false;
+    sev->set_response("SUCCESS\n");
+    sev->end_response();
+    int ret = Server::enable_shared_memory(sev->get_client(), sev->get_response(), sev->get_response_len(), &enabled);
+    if (ret == 0 && !enabled) {
+      sev->set_response("FAILURE\n");
+      sev->end_response();
+      ret = Server::send(sev->get_client(), sev->get_response(), sev->get_response_len());
+    }
+    if (ret == 0) {
+      Server::request_done(sev->get_client());
+    }
+    sev->done_immediate();
+    return;
+  }
+
+  if (0 == sql.compare(0, strlen(COMPRESSION_HANDSHAKE_PREFIX), COMPRESSION_HANDSHAKE_PREFIX)) {
+    // 按当前的协议回复，客户端收到之后才开始解压，所以发送完回复再打开压缩
+    WireCompression compression = WIRE_COMPRESSION_NONE;
+    const bool supported =
+        wire_compression_from_string(sql.c_str() + strlen(COMPRESSION_HANDSHAKE_PREFIX), &compression) &&
+        wire_compression_supported(compression);
+    if (!supported) {
+      LOG_WARN("Client %s asked for unsupported compression %s",
+          sev->get_client()->addr, sql.c_str() + strlen(COMPRESSION_HANDSHAKE_PREFIX));
+    }
+    sev->set_response(supported ? "SUCCESS\n" : "FAILURE\n");
+    sev->end_response();
+    if (Server::send(sev->get_client(), sev->get_response(), sev->get_response_len()) == 0) {
+      if (supported) {
+        sev->get_client()->compression = compression;
+      }
+      Server::request_done(sev->get_client());
+    }
     sev->done_immediate();
     return;
   }
@@ -154,12 +366,65 @@ void SessionStage::handle_request(StageEvent *event) {
   if (cb == nullptr) {
     LOG_ERROR("Failed to new callback for SessionEvent");
 
+    Server::request_done(sev->get_client());
     sev->done_immediate();
     return;
   }
 
   sev->push_callback(cb);
+  Session *session = sev->get_client()->session;
+  session->begin_request(sql.c_str());
+  const uint64_t statement_seq = session->query_cancel()->begin();
+  if (session->statement_timeout() > 0 && timer_stage_ != nullptr) {
+    // 语句提前结束时不取消定时器，到期时序号已经不同了。直接注册而不是加到TimerStage的队列中，
+    // TimerStage和当前stage在同一个线程池时，队列中的事件要等当前的语句执行完才会被处理
+    StatementTimeoutEvent *timeout_event =
+        new StatementTimeoutEvent(session->query_cancel(), statement_seq, session->id());
+    timer_stage_->handle_event(new TimerRegisterEvent(timeout_event, (u64_t)session->statement_timeout() * 1000));
+  }
+  // 采样的请求记录每个stage和存储层操作的时间，stage之间是同步调用的，
+  // 存储层通过线程变量找到当前请求的trace
+  RequestTrace *request_trace = RequestTraceLog::instance().sample();
+  if (request_trace != nullptr) {
+    sev->set_trace(request_trace);
+    sev->query_trace().set_request_trace(request_trace);
+  }
+  if (SlowQueryLog::instance().enabled() || StatementStatsTable::instance().enabled() || request_trace != nullptr) {
+    sev->query_trace().begin();
+  }
 
   SQLStageEvent *sql_event = new SQLStageEvent(sev, sql);
+  RequestTrace::set_current(request_trace);
   resolve_stage_->handle_event(sql_event);
+  RequestTrace::set_current(nullptr);
+}
+
+void SessionStage::handle_idle_sweep_event(StageEvent *event) {
+  IdleSweepEvent *sweep_event = static_cast<IdleSweepEvent *>(event);
+  if (sweep_event->timer_fired) {
+    sweep_event->timer_fired = false;
+    int reclaimed = SessionPool::instance().reclaim_idle((int64_t)idle_timeout_ * USEC_PER_SEC);
+    if (reclaimed > 0) {
+      LOG_INFO("Reclaimed %d idle session(s)", reclaimed);
+    }
+  }
+
+  CompletionCallback *cb = new (std::nothrow) CompletionCallback(this, nullptr);
+  if (cb == nullptr) {
+    LOG_ERROR("Failed to new callback for IdleSweepEvent");
+    event->done();
+    return;
+  }
+
+  // 每隔一个超时时间检查一次，session最多空闲两倍的超时时间后被回收
+  TimerRegisterEvent *tm_event = new (std::nothrow) TimerRegisterEvent(event, (u64_t)idle_timeout_ * USEC_PER_SEC);
+  if (tm_event == nullptr) {
+    LOG_ERROR("Failed to new TimerRegisterEvent for IdleSweepEvent");
+    delete cb;
+    event->done();
+    return;
+  }
+
+  event->push_callback(cb);
+  timer_stage_->add_event(tm_event);
 }
@@ -47,12 +47,20 @@ protected:
 
 
   void handle_request(common::StageEvent *event);
+  void handle_idle_sweep_event(common::StageEvent *event);
 
 private:
   Stage *resolve_stage_;
-  common::SimpleTimer *sql_metric_;
+  common::LatencyHistogram *sql_metric_;
   static const std::string SQL_METRIC_TAG;
 
+  common::Stage *timer_stage_ = nullptr;
+  int idle_timeout_ = 0;  // session超过这么多秒没有请求时回收空闲的状态，0表示不回收
+  long slow_query_time_ = -1;  // 执行超过这么多毫秒的语句写到慢查询日志，小于0时不记录
+  std::string slow_query_log_file_ = "miniob.slow.log";
+  double trace_sample_rate_ = 0;  // 采样跟踪的请求比例，0表示不跟踪
+  std::string trace_file_ = "miniob.trace.json";
+
 };
 
 #endif //__OBSERVER_SESSION_SESSIONSTAGE_H__
@@ -0,0 +1,165 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Per-statement trace and the slow query log.
+//
+
+#include "session/slow_query_log.h"
+
+#include <string.h>
+#include <time.h>
+
+#include "common/log/log.h"
+#include "common/metrics/latency_histogram.h"
+#include "common/seda/request_trace.h"
+#include "storage/common/table_scanner.h"
+#include "storage/default/disk_buffer_pool.h"
+
+using namespace common;
+
+void QueryTrace::begin() {
+  active_ = true;
+  stages_.clear();
+  begin_us_ = LatencyHistogram::now_us();
+  stage_begin_us_ = begin_us_;
+  end_us_ = begin_us_;
+  stages_.push_back(StageTime{"session", 0});
+  current_ = 0;
+  rows_examined_ = scanned_record_count();
+  pages_hit_ = bp_thread_stat().hits;
+  pages_read_ = bp_thread_stat().misses;
+  rows_sent_ = 0;
+}
+
+void QueryTrace::enter_stage(const char *stage) {
+  if (!active_) {
+    return;
+  }
+  const uint64_t now = LatencyHistogram::now_us();
+  stages_[current_].us += now - stage_begin_us_;
+  if (request_trace_ != nullptr) {
+    request_trace_->add_span("stage", stages_[current_].stage, stage_begin_us_, now);
+  }
+  stage_begin_us_ = now;
+  for (current_ = 0; current_ < (int)stages_.size(); current_++) {
+    if (0 == strcmp(stages_[current_].stage, stage)) {
+      return;
+    }
+  }
+  stages_.push_back(StageTime{stage, 0});
+}
+
+void QueryTrace::end() {
+  if (!active_) {
+    return;
+  }
+  active_ = false;
+  end_us_ = LatencyHistogram::now_us();
+  stages_[current_].us += end_us_ - stage_begin_us_;
+  if (request_trace_ != nullptr) {
+    request_trace_->add_span("stage", stages_[current_].stage, stage_begin_us_, end_us_);
+    request_trace_->add_span("request", "request", begin_us_, end_us_);
+  }
+  rows_examined_ = scanned_record_count() - rows_examined_;
+  pages_hit_ = bp_thread_stat().hits - pages_hit_;
+  pages_read_ = bp_thread_stat().misses - pages_read_;
+}
+
+void QueryTrace::suspend() {
+  if (!active_) {
+    return;
+  }
+  // 变成到目前为止的差
+  rows_examined_ = scanned_record_count() - rows_examined_;
+  pages_hit_ = bp_thread_stat().hits - pages_hit_;
+  pages_read_ = bp_thread_stat().misses - pages_read_;
+}
+
+void QueryTrace::resume() {
+  if (!active_) {
+    return;
+  }
+  rows_examined_ = scanned_record_count() - rows_examined_;
+  pages_hit_ = bp_thread_stat().hits - pages_hit_;
+  pages_read_ = bp_thread_stat().misses - pages_read_;
+}
+
+std::string QueryTrace::stage_string() const {
+  std::string s;
+  for (const StageTime &stage : stages_) {
+    if (!s.empty()) {
+      s += ",";
+    }
+    s += std::string(stage.stage) + "=" + std::to_string(stage.us) + "us";
+  }
+  return s;
+}
+
+SlowQueryLog &SlowQueryLog::instance() {
+  static SlowQueryLog slow_query_log;
+  return slow_query_log;
+}
+
+SlowQueryLog::~SlowQueryLog() {
+  close();
+}
+
+void SlowQueryLog::init(const std::string &log_file, long threshold_ms) {
+  close();
+  if (threshold_ms < 0) {
+    return;
+  }
+  // 不输出到控制台
+  Log *log = nullptr;
+  if (LoggerFactory::init(log_file, &log, LOG_LEVEL_INFO, LOG_LEVEL_PANIC) != 0) {
+    LOG_ERROR("Failed to open slow query log %s", log_file.c_str());
+    return;
+  }
+  log->set_async(true);
+  threshold_us_ = (uint64_t)threshold_ms * 1000;
+  log_ = log;
+  LOG_INFO("Log statements slower than %ld ms to %s", threshold_ms, log_file.c_str());
+}
+
+void SlowQueryLog::close() {
+  if (log_ != nullptr) {
+    delete log_;
+    log_ = nullptr;
+  }
+}
+
+void SlowQueryLog::record(const char *sql, const QueryTrace &trace) {
+  if (nullptr == log_ || trace.total_us() < threshold_us_) {
+    return;
+  }
+
+  // 一条语句一行，换行换成空格
+  std::string text(sql, strnlen(sql, SLOW_QUERY_SQL_MAX_LEN + 1));
+  if (text.size() > SLOW_QUERY_SQL_MAX_LEN) {
+    text.resize(SLOW_QUERY_SQL_MAX_LEN);
+    text += "...";
+  }
+  for (char &c : text) {
+    if (c == '\n' || c == '\r') {
+      c = ' ';
+    }
+  }
+
+  char prefix[64] = {0};
+  time_t now = time(nullptr);
+  struct tm tm;
+  if (localtime_r(&now, &tm) != nullptr) {
+    strftime(prefix, sizeof(prefix), "[%Y-%m-%d %H:%M:%S] ", &tm);
+  }
+  log_->output(LOG_LEVEL_INFO, "SlowQuery", prefix,
+      "time=%.3fms stages=%s rows_examined=%ld pages_hit=%ld pages_read=%ld sql=%s", trace.total_us() / 1000.0,
+      trace.stage_string().c_str(), trace.rows_examined(), trace.pages_hit(), trace.pages_read(), text.c_str());
+}
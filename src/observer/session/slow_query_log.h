@@ -0,0 +1,132 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Per-statement trace and the slow query log.
+//
+
+#ifndef __OBSERVER_SESSION_SLOW_QUERY_LOG_H__
+#define __OBSERVER_SESSION_SLOW_QUERY_LOG_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace common {
+class Log;
+class RequestTrace;
+}  // namespace common
+
+#define SLOW_QUERY_SQL_MAX_LEN 640  // 日志中的SQL最多保留这么多个字符，一行日志最多1K
+
+/**
+ * 一条语句在每个stage中的耗时，以及执行期间检查的行数和访问的页面。
+ * 语句通常在SessionStage的线程中从头执行到尾，行数和页面取当前线程中计数的前后差
+ */
+class QueryTrace {
+public:
+  /**
+   * SessionStage收到请求时开始，之后的时间计入session，直到进入下一个stage
+   */
+  void begin();
+  /**
+   * 进入stage，上一段时间计入之前的stage。同一个stage多次进入时累加
+   */
+  void enter_stage(const char *stage);
+  void end();
+  /**
+   * 语句换到其它线程继续执行之前suspend，在新的线程中resume，行数和页面分别计算两个线程中的差
+   */
+  void suspend();
+  void resume();
+  /**
+   * 请求被采样跟踪时，每个stage的耗时同时作为一个span加到trace中
+   */
+  void set_request_trace(common::RequestTrace *trace) {
+    request_trace_ = trace;
+  }
+
+  uint64_t total_us() const {
+    return end_us_ - begin_us_;
+  }
+  long rows_examined() const {
+    return rows_examined_;
+  }
+  long pages_hit() const {
+    return pages_hit_;
+  }
+  long pages_read() const {
+    return pages_read_;
+  }
+  /**
+   * 返回给客户端的行数，由执行结果的地方累加
+   */
+  void add_rows_sent(long rows) {
+    rows_sent_ += rows;
+  }
+  long rows_sent() const {
+    return rows_sent_;
+  }
+  /**
+   * 比如 session=12us,parse=30us,execute=1000us
+   */
+  std::string stage_string() const;
+
+private:
+  struct StageTime {
+    const char *stage;
+    uint64_t us;
+  };
+
+  bool active_ = false;
+  std::vector<StageTime> stages_;
+  int current_ = -1;
+  uint64_t begin_us_ = 0;
+  uint64_t stage_begin_us_ = 0;
+  uint64_t end_us_ = 0;
+  long rows_examined_ = 0;
+  long pages_hit_ = 0;
+  long pages_read_ = 0;
+  long rows_sent_ = 0;
+  common::RequestTrace *request_trace_ = nullptr;
+};
+
+/**
+ * 执行时间超过阈值的语句写到单独的日志文件中，日志使用异步模式，请求线程只写自己的缓冲区
+ */
+class SlowQueryLog {
+public:
+  static SlowQueryLog &instance();
+
+  /**
+   * threshold_ms小于0时不记录，等于0时记录所有的语句
+   */
+  void init(const std::string &log_file, long threshold_ms);
+  void close();
+
+  bool enabled() const {
+    return log_ != nullptr;
+  }
+  /**
+   * 语句执行时间超过阈值时写一行日志
+   */
+  void record(const char *sql, const QueryTrace &trace);
+
+private:
+  SlowQueryLog() = default;
+  ~SlowQueryLog();
+
+private:
+  common::Log *log_ = nullptr;
+  uint64_t threshold_us_ = 0;
+};
+
+#endif  // __OBSERVER_SESSION_SLOW_QUERY_LOG_H__
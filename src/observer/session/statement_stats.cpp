@@ -0,0 +1,184 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Execution statistics of statements keyed by literal-normalized sql.
+//
+
+#include "session/statement_stats.h"
+
+#include <ctype.h>
+
+#include <algorithm>
+
+#include "session/slow_query_log.h"
+#include "sql/plan_cache/plan_cache.h"
+
+static int latency_bucket(uint64_t us) {
+  if (us == 0) {
+    return 0;
+  }
+  // 桶i是[2^(i-1), 2^i)
+  return std::min(64 - __builtin_clzl(us), STATEMENT_STATS_BUCKETS - 1);
+}
+
+uint64_t StatementStats::quantile_us(double quantile) const {
+  if (calls == 0) {
+    return 0;
+  }
+  const uint64_t rank = (uint64_t)(quantile * calls);
+  uint64_t seen = 0;
+  for (int i = 0; i < STATEMENT_STATS_BUCKETS - 1; i++) {
+    seen += latency_buckets[i];
+    if (seen > rank) {
+      return std::min<uint64_t>(1ul << i, max_us);
+    }
+  }
+  return max_us;
+}
+
+StatementStatsTable &StatementStatsTable::instance() {
+  static StatementStatsTable table;
+  return table;
+}
+
+StatementStatsTable::StatementStatsTable(size_t capacity) : capacity_(capacity) {}
+
+void StatementStatsTable::set_capacity(size_t capacity) {
+  capacity_ = capacity;
+  const size_t shard_capacity = this->shard_capacity();
+  for (Shard &s : shards_) {
+    std::lock_guard<std::mutex> lock_guard(s.mutex);
+    if (s.entries.size() > shard_capacity) {
+      s.entries.clear();
+    }
+  }
+}
+
+size_t StatementStatsTable::shard_capacity() const {
+  return (capacity_ + STATEMENT_STATS_SHARDS - 1) / STATEMENT_STATS_SHARDS;
+}
+
+StatementStatsTable::Shard &StatementStatsTable::shard(const std::string &key) {
+  return shards_[std::hash<std::string>()(key) % STATEMENT_STATS_SHARDS];
+}
+
+std::string StatementStatsTable::statement_key(const char *sql) {
+  std::string normalized;
+  std::vector<SqlLiteral> literals;
+  if (normalize_sql(sql, normalized, literals)) {
+    return normalized;
+  }
+
+  // 不能参数化的语句只合并空白
+  normalized.clear();
+  bool pending_space = false;
+  for (const char *p = sql; *p != '\0'; p++) {
+    if (isspace((unsigned char)*p)) {
+      pending_space = !normalized.empty();
+      continue;
+    }
+    if (pending_space) {
+      normalized.push_back(' ');
+      pending_space = false;
+    }
+    normalized.push_back(*p);
+  }
+  return normalized;
+}
+
+void StatementStatsTable::record(const std::string &db, const char *sql, const QueryTrace &trace) {
+  record(db, sql, trace.total_us(), trace.rows_sent(), trace.rows_examined(), trace.pages_read());
+}
+
+void StatementStatsTable::record(const std::string &db, const char *sql, uint64_t us, uint64_t rows_sent,
+    uint64_t rows_examined, uint64_t pages_read) {
+  const size_t capacity = shard_capacity();
+  if (capacity == 0) {
+    return;
+  }
+
+  const std::string statement = statement_key(sql);
+  const std::string key = db + "\n" + statement;
+  Shard &s = shard(key);
+  std::lock_guard<std::mutex> lock_guard(s.mutex);
+  auto iter = s.entries.find(key);
+  if (iter == s.entries.end()) {
+    if (s.entries.size() >= capacity) {
+      // 淘汰总耗时最少的语句，新的语句从0开始，经常执行的语句很快会超过它
+      auto victim = std::min_element(s.entries.begin(), s.entries.end(),
+          [](const std::pair<const std::string, StatementStats> &left,
+              const std::pair<const std::string, StatementStats> &right) {
+            return left.second.total_us < right.second.total_us;
+          });
+      s.entries.erase(victim);
+    }
+    iter = s.entries.emplace(key, StatementStats()).first;
+    iter->second.db = db;
+    iter->second.sql = statement;
+  }
+
+  StatementStats &stats = iter->second;
+  stats.calls++;
+  stats.total_us += us;
+  stats.max_us = std::max(stats.max_us, us);
+  stats.rows_sent += rows_sent;
+  stats.rows_examined += rows_examined;
+  stats.pages_read += pages_read;
+  stats.latency_buckets[latency_bucket(us)]++;
+}
+
+std::vector<StatementStats> StatementStatsTable::top(size_t limit) {
+  std::vector<StatementStats> result;
+  for (Shard &s : shards_) {
+    std::lock_guard<std::mutex> lock_guard(s.mutex);
+    for (const auto &entry : s.entries) {
+      result.push_back(entry.second);
+    }
+  }
+  std::sort(result.begin(), result.end(), [](const StatementStats &left, const StatementStats &right) {
+    return left.total_us > right.total_us;
+  });
+  if (result.size() > limit) {
+    result.resize(limit);
+  }
+  return result;
+}
+
+void StatementStatsTable::dump(std::ostream &os, size_t limit) {
+  os << "total_us | calls | avg_us | p99_us | max_us | rows_sent | rows_examined | pages_read | db | sql"
+     << std::endl;
+  for (const StatementStats &stats : top(limit)) {
+    std::string sql = stats.sql;
+    if (sql.size() > STATEMENT_STATS_SQL_MAX_LEN) {
+      sql.resize(STATEMENT_STATS_SQL_MAX_LEN);
+      sql += "...";
+    }
+    os << stats.total_us << " | " << stats.calls << " | " << stats.total_us / stats.calls << " | "
+       << stats.quantile_us(0.99) << " | " << stats.max_us << " | " << stats.rows_sent << " | "
+       << stats.rows_examined << " | " << stats.pages_read << " | " << stats.db << " | " << sql << std::endl;
+  }
+}
+
+void StatementStatsTable::reset() {
+  for (Shard &s : shards_) {
+    std::lock_guard<std::mutex> lock_guard(s.mutex);
+    s.entries.clear();
+  }
+}
+
+size_t StatementStatsTable::size() {
+  size_t size = 0;
+  for (Shard &s : shards_) {
+    std::lock_guard<std::mutex> lock_guard(s.mutex);
+    size += s.entries.size();
+  }
+  return size;
+}
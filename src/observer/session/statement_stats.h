@@ -0,0 +1,113 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Execution statistics of statements keyed by literal-normalized sql.
+//
+
+#ifndef __OBSERVER_SESSION_STATEMENT_STATS_H__
+#define __OBSERVER_SESSION_STATEMENT_STATS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class QueryTrace;
+
+#define STATEMENT_STATS_SIZE 1024        // 默认最多统计的语句个数
+#define STATEMENT_STATS_SHARDS 16
+#define STATEMENT_STATS_BUCKETS 32       // 耗时的桶：[0, 1us)、[1us, 2us)、... [2^30us, 无穷)
+#define STATEMENT_STATS_SHOW_LIMIT 100   // show statement stats最多输出的语句个数
+#define STATEMENT_STATS_SQL_MAX_LEN 256  // 输出的语句最多保留这么多个字符
+
+/**
+ * 一种语句的累计统计。rows_sent是返回给客户端的行数，rows_examined和pages_read是扫描的记录数和
+ * buffer pool未命中从磁盘读取的页面数，和慢查询日志中的含义相同
+ */
+struct StatementStats {
+  std::string db;
+  std::string sql;
+  uint64_t calls = 0;
+  uint64_t total_us = 0;
+  uint64_t max_us = 0;
+  uint64_t rows_sent = 0;
+  uint64_t rows_examined = 0;
+  uint64_t pages_read = 0;
+  uint64_t latency_buckets[STATEMENT_STATS_BUCKETS] = {0};
+
+  /**
+   * 耗时的分位数所在的桶的上界
+   */
+  uint64_t quantile_us(double quantile) const;
+};
+
+/**
+ * 语句统计表。select/insert/update/delete按照plan cache的规则把常量换成?之后作为key，
+ * 其它语句用合并空白之后的原文。key分到多个分片，每个分片一把锁；分片满了之后淘汰总耗时最少的语句，
+ * 留下的是总耗时最多的语句
+ */
+class StatementStatsTable {
+public:
+  static StatementStatsTable &instance();
+
+  explicit StatementStatsTable(size_t capacity = STATEMENT_STATS_SIZE);
+
+  /**
+   * capacity为0时不统计，已有的统计被清空
+   */
+  void set_capacity(size_t capacity);
+  bool enabled() const {
+    return capacity_ > 0;
+  }
+
+  /**
+   * 语句执行完之后记录一次，trace中是语句的耗时和检查的行数
+   */
+  void record(const std::string &db, const char *sql, const QueryTrace &trace);
+  void record(const std::string &db, const char *sql, uint64_t us, uint64_t rows_sent, uint64_t rows_examined,
+      uint64_t pages_read);
+
+  /**
+   * 总耗时最多的limit个语句，总耗时从多到少
+   */
+  std::vector<StatementStats> top(size_t limit);
+  /**
+   * 每行一个语句，和show buffer pool status一样用 | 分隔各列
+   */
+  void dump(std::ostream &os, size_t limit = STATEMENT_STATS_SHOW_LIMIT);
+
+  void reset();
+  size_t size();
+
+  /**
+   * 语句的key，见类的说明
+   */
+  static std::string statement_key(const char *sql);
+
+private:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, StatementStats> entries;  // key是db + '\n' + 语句
+  };
+
+  Shard &shard(const std::string &key);
+  size_t shard_capacity() const;
+
+private:
+  size_t capacity_;
+  Shard shards_[STATEMENT_STATS_SHARDS];
+};
+
+#endif  // __OBSERVER_SESSION_STATEMENT_STATS_H__
@@ -0,0 +1,127 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Admission control of heavy queries.
+//
+
+#include "sql/executor/admission_control.h"
+
+#include "common/log/log.h"
+#include "common/metrics/latency_histogram.h"
+#include "common/seda/stage.h"
+#include "event/execution_plan_event.h"
+
+AdmissionControl &AdmissionControl::instance() {
+  static AdmissionControl admission_control;
+  return admission_control;
+}
+
+void AdmissionControl::init(int max_heavy, double heavy_cost, long queue_timeout_ms, int queue_size) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  max_heavy_ = max_heavy < 0 ? 0 : max_heavy;
+  heavy_cost_ = heavy_cost;
+  queue_timeout_us_ = queue_timeout_ms < 0 ? 0 : (uint64_t)queue_timeout_ms * 1000;
+  queue_size_ = queue_size < 0 ? 0 : queue_size;
+}
+
+AdmissionResult AdmissionControl::admit(ExecutionPlanEvent *event, common::Stage *stage) {
+  const uint64_t now = common::LatencyHistogram::now_us();
+  std::deque<Waiter> expired;
+  AdmissionResult result = AdmissionResult::QUEUED;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    take_expired(now, expired);
+    if (running_ < max_heavy_ && waiters_.empty()) {
+      running_++;
+      result = AdmissionResult::RUN;
+    } else if (waiters_.size() >= queue_size_) {
+      rejected_++;
+      result = AdmissionResult::REJECTED;
+    } else {
+      event->set_admission_state(ExecutionPlanEvent::AdmissionState::WAITING);
+      waiters_.push_back(Waiter{event, stage, now + queue_timeout_us_});
+      waiter_num_ = waiters_.size();
+    }
+  }
+  resume(expired);
+  return result;
+}
+
+void AdmissionControl::release() {
+  std::deque<Waiter> ready;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    take_expired(common::LatencyHistogram::now_us(), ready);
+    if (!waiters_.empty() && running_ <= max_heavy_) {
+      // 名额直接交给等待的查询，running_不变
+      Waiter waiter = waiters_.front();
+      waiters_.pop_front();
+      waiter_num_ = waiters_.size();
+      waiter.event->set_admission_state(ExecutionPlanEvent::AdmissionState::ADMITTED);
+      ready.push_back(waiter);
+    } else if (running_ > 0) {
+      running_--;
+    }
+  }
+  resume(ready);
+}
+
+void AdmissionControl::expire() {
+  if (waiter_num_.load() == 0) {
+    return;
+  }
+  std::deque<Waiter> expired;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    take_expired(common::LatencyHistogram::now_us(), expired);
+  }
+  resume(expired);
+}
+
+void AdmissionControl::take_expired(uint64_t now_us, std::deque<Waiter> &expired) {
+  // 按加入的顺序排列，超时时间也是递增的
+  while (!waiters_.empty() && waiters_.front().deadline_us <= now_us) {
+    Waiter waiter = waiters_.front();
+    waiters_.pop_front();
+    waiter_num_ = waiters_.size();
+    waiter.event->set_admission_state(ExecutionPlanEvent::AdmissionState::TIMEOUT);
+    expired.push_back(waiter);
+    timed_out_++;
+  }
+}
+
+void AdmissionControl::resume(std::deque<Waiter> &waiters) {
+  for (Waiter &waiter : waiters) {
+    // 排在线程池中其它事件的后面，等待中的短查询先执行
+    waiter.event->set_priority(common::StageEvent::LOW_PRIORITY);
+    waiter.stage->add_event(waiter.event);
+  }
+}
+
+int AdmissionControl::running() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return running_;
+}
+
+int AdmissionControl::waiting() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return waiters_.size();
+}
+
+long AdmissionControl::rejected() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return rejected_;
+}
+
+long AdmissionControl::timed_out() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return timed_out_;
+}
@@ -0,0 +1,103 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Admission control of heavy queries.
+//
+
+#ifndef __OBSERVER_SQL_EXECUTOR_ADMISSION_CONTROL_H_
+#define __OBSERVER_SQL_EXECUTOR_ADMISSION_CONTROL_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+namespace common {
+class Stage;
+}  // namespace common
+class ExecutionPlanEvent;
+
+#define HEAVY_QUERY_COST 100000           // 估算处理的行数超过这个值的查询是重查询
+#define HEAVY_QUERY_QUEUE_TIMEOUT 30000   // 重查询排队的最长时间，毫秒
+#define HEAVY_QUERY_QUEUE_SIZE 128        // 最多排队的重查询
+
+enum class AdmissionResult {
+  RUN,       // 立即执行，结束后调用release
+  QUEUED,    // 进入等待队列，调用者不能再访问event
+  REJECTED,  // 队列已满
+};
+
+/**
+ * 限制同时执行的重查询的个数，避免少数报表查询占满SQLThreads，短查询排在它们后面。
+ * 名额用完时重查询进入等待队列并让出线程，有名额释放时按顺序把等待的event以低优先级重新加到原来的stage中，
+ * 线程池在没有其它事件时才处理它们；等待超时的event同样加回stage，由stage返回失败。
+ * max_heavy为0时不限制
+ */
+class AdmissionControl {
+public:
+  AdmissionControl() = default;
+
+  static AdmissionControl &instance();
+
+  void init(int max_heavy, double heavy_cost, long queue_timeout_ms, int queue_size);
+
+  bool enabled() const {
+    return max_heavy_ > 0;
+  }
+  bool heavy(double cost) const {
+    return max_heavy_ > 0 && cost >= heavy_cost_;
+  }
+
+  /**
+   * 重查询执行之前调用
+   */
+  AdmissionResult admit(ExecutionPlanEvent *event, common::Stage *stage);
+  /**
+   * admit返回RUN或者event被唤醒为ADMITTED的重查询结束后调用，名额交给等待最久的查询
+   */
+  void release();
+  /**
+   * 把等待超时的event加回stage。admit和release时都会检查，没有重查询结束时由普通查询调用
+   */
+  void expire();
+
+  int running();
+  int waiting();
+  long rejected();
+  long timed_out();
+
+private:
+  struct Waiter {
+    ExecutionPlanEvent *event;
+    common::Stage *stage;
+    uint64_t deadline_us;
+  };
+
+  // 调用者持有mutex_，返回需要加回stage的event
+  void take_expired(uint64_t now_us, std::deque<Waiter> &expired);
+  static void resume(std::deque<Waiter> &waiters);
+
+private:
+  std::mutex mutex_;
+  int max_heavy_ = 0;
+  double heavy_cost_ = HEAVY_QUERY_COST;
+  uint64_t queue_timeout_us_ = (uint64_t)HEAVY_QUERY_QUEUE_TIMEOUT * 1000;
+  size_t queue_size_ = HEAVY_QUERY_QUEUE_SIZE;
+
+  int running_ = 0;
+  std::deque<Waiter> waiters_;
+  std::atomic<int> waiter_num_{0};  // waiters_的长度，不加锁判断是否有等待的查询
+  long rejected_ = 0;
+  long timed_out_ = 0;
+};
+
+#endif  // __OBSERVER_SQL_EXECUTOR_ADMISSION_CONTROL_H_
@@ -0,0 +1,94 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Hash set of encoded values used by DISTINCT and COUNT(DISTINCT).
+//
+
+#include <string.h>
+#include <algorithm>
+
+#include "sql/executor/distinct_set.h"
+
+static const uint32_t EMPTY_SLOT = UINT32_MAX;
+
+uint64_t DistinctHashSet::hash(const char *data, int len) {
+  uint64_t h = 14695981039346656037ull;
+  for (int i = 0; i < len; i++) {
+    h ^= (uint8_t)data[i];
+    h *= 1099511628211ull;
+  }
+  // FNV-1a的高位只受前面字节的影响很少，用murmur3的finalizer混合一次
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+bool DistinctHashSet::insert(const char *data, int len, uint64_t hash_value) {
+  if ((size_ + 1) * 2 > slots_.size()) {
+    size_t capacity = std::max<size_t>(slots_.size() * 2, DISTINCT_SET_MIN_CAPACITY);
+    if (slots_.empty() && expected_ > 0) {
+      const size_t expected = (size_t)std::min<int64_t>(expected_, DISTINCT_SET_MAX_INITIAL);
+      while (capacity < expected * 2) {
+        capacity *= 2;
+      }
+    }
+    grow(capacity);
+  }
+
+  const size_t mask = slots_.size() - 1;
+  for (size_t pos = hash_value & mask;; pos = (pos + 1) & mask) {
+    Slot &slot = slots_[pos];
+    if (slot.len == EMPTY_SLOT) {
+      slot.hash = hash_value;
+      slot.offset = data_.size();
+      slot.len = len;
+      data_.append(data, len);
+      size_++;
+      return true;
+    }
+    if (slot.hash == hash_value && slot.len == (uint32_t)len && 0 == memcmp(data_.data() + slot.offset, data, len)) {
+      return false;
+    }
+  }
+}
+
+void DistinctHashSet::grow(size_t capacity) {
+  std::vector<Slot> slots(capacity, Slot{0, 0, EMPTY_SLOT});
+  const size_t mask = capacity - 1;
+  for (const Slot &slot : slots_) {
+    if (slot.len == EMPTY_SLOT) {
+      continue;
+    }
+    size_t pos = slot.hash & mask;
+    while (slots[pos].len != EMPTY_SLOT) {
+      pos = (pos + 1) & mask;
+    }
+    slots[pos] = slot;
+  }
+  slots_.swap(slots);
+}
+
+void DistinctHashSet::merge(const DistinctHashSet &other) {
+  for (const Slot &slot : other.slots_) {
+    if (slot.len != EMPTY_SLOT) {
+      insert(other.data_.data() + slot.offset, slot.len, slot.hash);
+    }
+  }
+}
+
+void DistinctHashSet::clear() {
+  size_ = 0;
+  std::vector<Slot>().swap(slots_);
+  std::string().swap(data_);
+}
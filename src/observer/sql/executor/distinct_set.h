@@ -0,0 +1,86 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Hash set of encoded values used by DISTINCT and COUNT(DISTINCT).
+//
+
+#ifndef __OBSERVER_SQL_EXECUTOR_DISTINCT_SET_H_
+#define __OBSERVER_SQL_EXECUTOR_DISTINCT_SET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define DISTINCT_SET_MIN_CAPACITY 8             // 第一次插入时至少分配这么多个槽
+#define DISTINCT_SET_MAX_INITIAL (1 << 18)      // 统计信息中的不同值个数超过这个值时只按这个值预分配，统计信息偏大时不会浪费太多内存
+
+/**
+ * 开放寻址(线性探测)的hash集合，保存编码之后的值。所有值的内容连续地放在一个字符串中，
+ * 槽中只有hash值和内容的位置，查找时先比较hash值，插入一个值最多一次内存分配(扩容时除外)。
+ * 槽数总是2的幂，装载因子超过1/2时扩容一倍。expected是预计的不同值个数，比如统计信息中字段的不同值个数，
+ * 第一次插入时按它分配槽数，避免逐次扩容时的重新hash。没有插入时不占用内存，可以作为聚合函数的中间结果复制
+ */
+class DistinctHashSet {
+public:
+  explicit DistinctHashSet(int64_t expected = 0) : expected_(expected) {
+  }
+
+  /**
+   * 值不在集合中时插入并返回true
+   */
+  bool insert(const char *data, int len) {
+    return insert(data, len, hash(data, len));
+  }
+  bool insert(const char *data, int len, uint64_t hash_value);
+
+  /**
+   * 把other中的值都插入到这个集合中，用于合并并行线程的中间结果
+   */
+  void merge(const DistinctHashSet &other);
+
+  size_t size() const {
+    return size_;
+  }
+  size_t capacity() const {
+    return slots_.size();
+  }
+  /**
+   * 占用的内存，包括槽和值的内容
+   */
+  size_t memory_size() const {
+    return slots_.capacity() * sizeof(Slot) + data_.capacity();
+  }
+
+  void clear();
+
+  /**
+   * 64位的FNV-1a再做一次混合，高位和低位都分布均匀：低位选槽，高32位给HyperLogLog
+   */
+  static uint64_t hash(const char *data, int len);
+
+private:
+  struct Slot {
+    uint64_t hash;
+    uint32_t offset;
+    uint32_t len;      // 空槽的len是UINT32_MAX
+  };
+
+  void grow(size_t capacity);
+
+private:
+  int64_t expected_;
+  size_t size_ = 0;
+  std::vector<Slot> slots_;
+  std::string data_;
+};
+
+#endif  // __OBSERVER_SQL_EXECUTOR_DISTINCT_SET_H_
@@ -12,38 +12,160 @@ See the Mulan PSL v2 for more details. */
 // Created by Longda on 2021/4/13.
 //
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <list>
 #include <string>
 #include <sstream>
 #include <algorithm>
 #include "execute_stage.h"
 
+#include "common/conf/ini.h"
 #include "common/io/io.h"
 #include "common/log/log.h"
+#include "common/seda/request_trace.h"
 #include "common/seda/timer_stage.h"
 #include "common/lang/string.h"
+#include "common/lang/lock_profiler.h"
+#include "common/metrics/cpu_time.h"
+#include "common/metrics/metrics_registry.h"
+#include "session/cursor.h"
+#include "session/query_cancel.h"
 #include "session/session.h"
+#include "session/session_pool.h"
+#include "session/statement_stats.h"
 #include "event/storage_event.h"
 #include "event/sql_event.h"
 #include "event/session_event.h"
 #include "event/execution_plan_event.h"
+#include "net/wire_protocol.h"
+#include "sql/executor/admission_control.h"
 #include "sql/executor/execution_node.h"
+#include "sql/executor/expression.h"
+#include "sql/executor/memory_tracker.h"
 #include "sql/executor/tuple.h"
+#include "sql/executor/tuple_batch.h"
+#include "sql/optimizer/join_planner.h"
+#include "sql/query_cache/query_cache.h"
 #include "storage/common/table.h"
 #include "storage/default/default_handler.h"
+#include "storage/default/page_loader.h"
+#include "storage/default/spill_file.h"
 #include "storage/common/condition_filter.h"
 #include "storage/trx/trx.h"
 
 using namespace common;
 
+/**
+ * where中的一个子查询条件，outer_attrs和inner_attrs是关联条件中外层和子查询的字段，一一对应
+ */
+struct Subquery
+{
+  const Condition *condition = nullptr;
+  std::vector<const RelAttr *> outer_attrs;
+  std::vector<const RelAttr *> inner_attrs;
+  const char *outer_table = nullptr; // 外层的字段都在这张表中，不关联的exists为nullptr
+  SubqueryResult result;
+};
+
 static RC schema_add_field(Table *table, const char *field_name, TupleSchema &schema);
 
-RC create_selection_executor(Trx *trx, const Selects &selects, const char *db, const char *table_name, SelectExeNode &select_node);
+/**
+ * SET语句中的开关取值，on/off、true/false、1/0
+ */
+static bool parse_bool_value(const char *str, bool *value)
+{
+  if (0 == strcasecmp(str, "on") || 0 == strcasecmp(str, "true") || 0 == strcmp(str, "1")) {
+    *value = true;
+    return true;
+  }
+  if (0 == strcasecmp(str, "off") || 0 == strcasecmp(str, "false") || 0 == strcmp(str, "0")) {
+    *value = false;
+    return true;
+  }
+  return false;
+}
 
-RC do_aggregation(TupleSet *tuple_set, AttrFunction *attr_function, std::vector<TupleSet> &results, int rel_num);
+RC create_selection_executor(Trx *trx, const Selects &selects, const char *db, const char *table_name,
+                             const std::list<Subquery> &subqueries, SelectExeNode &select_node);
 
 FuncType judge_function_type(char *window_function_name);
 
-void quick_sort(TupleSet *tuple_set, int l, int r, OrderInfo *order_info);
+const std::string ExecuteStage::STATEMENT_CPU_METRIC_TAG = "ExecuteStage.statement_cpu";
+
+// 下标是SqlCommandFlag
+static const char *STATEMENT_TYPE_NAMES[] = {"error", "select", "insert", "update", "delete", "create_table",
+    "drop_table", "create_index", "drop_index", "sync", "show_tables", "desc_table", "show_buffer_pool", "begin",
+    "commit", "rollback", "load_data", "help", "exit", "prepare", "execute", "deallocate", "savepoint",
+    "rollback_to_savepoint", "release_savepoint", "set_variable", "drop_partition", "truncate_table",
+    "analyze_table", "show_statement_stats", "reset_statement_stats", "kill_query", "show_processlist", "create_view",
+    "backup", "fetch", "close_cursor"};
+static_assert(sizeof(STATEMENT_TYPE_NAMES) / sizeof(STATEMENT_TYPE_NAMES[0]) == SCF_NUM,
+    "a name for every SqlCommandFlag");
+
+/**
+ * 每种语句(SCF_*)处理时占用的CPU时间，包括会话、解析、优化和执行，用线程的CPU时钟度量，
+ * 不包括等锁、等IO的时间。报告的是两次snapshot之间有执行的语句类型：
+ * <类型>_events、<类型>_cpu_us、<类型>_avg_cpu_us。查询缓存命中的语句没有到执行阶段，不在其中
+ */
+class StatementCpuMetric : public common::Metric
+{
+public:
+  ~StatementCpuMetric() override
+  {
+    delete snapshot_value_;
+    snapshot_value_ = nullptr;
+  }
+
+  /**
+   * 当前线程处理的这个事件的CPU时间记到语句类型flag上，线程池在事件处理完之后记录
+   */
+  void charge(SqlCommandFlag flag)
+  {
+    if (flag >= 0 && flag < STATEMENT_TYPE_NUM)
+    {
+      common::CpuTimeCounter::charge_current_event(&counters_[flag]);
+    }
+  }
+
+  void snapshot() override
+  {
+    std::stringstream oss;
+    bool first = true;
+    for (int i = 0; i < STATEMENT_TYPE_NUM; i++)
+    {
+      const uint64_t events = counters_[i].events();
+      const uint64_t cpu_ns = counters_[i].cpu_ns();
+      const uint64_t interval_events = events - last_events_[i];
+      const uint64_t interval_cpu_us = (cpu_ns - last_cpu_ns_[i]) / 1000;
+      last_events_[i] = events;
+      last_cpu_ns_[i] = cpu_ns;
+      if (interval_events == 0)
+      {
+        continue;
+      }
+      const char *name = STATEMENT_TYPE_NAMES[i];
+      oss << (first ? "" : ",") << name << "_events:" << interval_events << "," << name
+          << "_cpu_us:" << interval_cpu_us << "," << name << "_avg_cpu_us:" << interval_cpu_us / interval_events;
+      first = false;
+    }
+    std::string value = oss.str();
+    if (snapshot_value_ == nullptr)
+    {
+      snapshot_value_ = new common::SnapshotBasic<std::string>();
+    }
+    ((common::SnapshotBasic<std::string> *)snapshot_value_)->setValue(value);
+  }
+
+private:
+  static const int STATEMENT_TYPE_NUM = SCF_NUM;
+
+  common::CpuTimeCounter counters_[STATEMENT_TYPE_NUM];
+  uint64_t last_events_[STATEMENT_TYPE_NUM] = {0};
+  uint64_t last_cpu_ns_[STATEMENT_TYPE_NUM] = {0};
+};
 
 //! Constructor
 ExecuteStage::ExecuteStage(const char *tag) : Stage(tag) {}
@@ -64,17 +186,92 @@ Stage *ExecuteStage::make_stage(const std::string &tag)
   return stage;
 }
 
+const char *CONF_QUERY_MEMORY_LIMIT = "QueryMemoryLimit";
+const char *CONF_MAX_HEAVY_QUERIES = "MaxHeavyQueries";
+const char *CONF_HEAVY_QUERY_COST = "HeavyQueryCost";
+const char *CONF_HEAVY_QUERY_QUEUE_TIMEOUT = "HeavyQueryQueueTimeout";
+const char *CONF_HEAVY_QUERY_QUEUE_SIZE = "HeavyQueryQueueSize";
+const char *CONF_PAGE_LOAD_THREADS = "PageLoadThreads";
+const char *CONF_SPILL_DIR = "SpillDir";
+const char *CONF_QUERY_SPILL_LIMIT = "QuerySpillLimit";
+
+/**
+ * 非负整数的配置项，没有配置时value不变
+ */
+static bool parse_non_negative(const std::map<std::string, std::string> &section, const char *key, long &value)
+{
+  auto iter = section.find(key);
+  if (iter == section.end())
+  {
+    return true;
+  }
+  char *end = nullptr;
+  long number = strtol(iter->second.c_str(), &end, 10);
+  if (end == iter->second.c_str() || *end != '\0' || number < 0 || number > INT32_MAX)
+  {
+    LOG_ERROR("Invalid config %s=%s", key, iter->second.c_str());
+    return false;
+  }
+  value = number;
+  return true;
+}
+
 //! Set properties for this object set in stage specific properties
 bool ExecuteStage::set_properties()
 {
-  //  std::string stageNameStr(stageName);
-  //  std::map<std::string, std::string> section = theGlobalProperties()->get(
-  //    stageNameStr);
-  //
-  //  std::map<std::string, std::string>::iterator it;
-  //
-  //  std::string key;
+  std::string stage_name(stage_name_);
+  std::map<std::string, std::string> section = get_properties()->get(stage_name);
+
+  std::map<std::string, std::string>::iterator iter = section.find(CONF_QUERY_MEMORY_LIMIT);
+  if (iter != section.end())
+  {
+    size_t limit = 0;
+    if (!str_to_memory_size(iter->second, limit))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_QUERY_MEMORY_LIMIT, iter->second.c_str());
+      return false;
+    }
+    set_query_memory_limit(limit);
+    LOG_INFO("Use %lu bytes as query memory limit", limit);
+  }
+
+  size_t spill_limit = QUERY_SPILL_LIMIT;
+  iter = section.find(CONF_QUERY_SPILL_LIMIT);
+  if (iter != section.end() && !str_to_memory_size(iter->second, spill_limit))
+  {
+    LOG_ERROR("Invalid config %s=%s", CONF_QUERY_SPILL_LIMIT, iter->second.c_str());
+    return false;
+  }
+  iter = section.find(CONF_SPILL_DIR);
+  if (SpillFileManager::instance().init(iter != section.end() ? iter->second : "", spill_limit) != RC::SUCCESS)
+  {
+    return false;
+  }
+
+  long max_heavy = 0;
+  long heavy_cost = HEAVY_QUERY_COST;
+  long queue_timeout = HEAVY_QUERY_QUEUE_TIMEOUT;
+  long queue_size = HEAVY_QUERY_QUEUE_SIZE;
+  if (!parse_non_negative(section, CONF_MAX_HEAVY_QUERIES, max_heavy) ||
+      !parse_non_negative(section, CONF_HEAVY_QUERY_COST, heavy_cost) ||
+      !parse_non_negative(section, CONF_HEAVY_QUERY_QUEUE_TIMEOUT, queue_timeout) ||
+      !parse_non_negative(section, CONF_HEAVY_QUERY_QUEUE_SIZE, queue_size))
+  {
+    return false;
+  }
+  AdmissionControl::instance().init(max_heavy, heavy_cost, queue_timeout, queue_size);
+  if (max_heavy > 0)
+  {
+    LOG_INFO("At most %ld heavy queries(cost >= %ld) run at the same time, %ld wait for at most %ld ms",
+             max_heavy, heavy_cost, queue_size, queue_timeout);
+  }
 
+  long page_load_threads = 0;
+  if (!parse_non_negative(section, CONF_PAGE_LOAD_THREADS, page_load_threads))
+  {
+    return false;
+  }
+  PageLoader::instance().start(page_load_threads);
   return true;
 }
 
@@ -87,6 +284,9 @@ bool ExecuteStage::initialize()
   default_storage_stage_ = *(stgp++);
   mem_storage_stage_ = *(stgp++);
 
+  statement_cpu_metric_ = new StatementCpuMetric();
+  get_metrics_registry().register_metric(STATEMENT_CPU_METRIC_TAG, statement_cpu_metric_);
+
   LOG_TRACE("Exit");
   return true;
 }
@@ -96,6 +296,14 @@ void ExecuteStage::cleanup()
 {
   LOG_TRACE("Enter");
 
+  PageLoader::instance().stop();
+  if (statement_cpu_metric_ != nullptr)
+  {
+    get_metrics_registry().unregister(STATEMENT_CPU_METRIC_TAG);
+    delete statement_cpu_metric_;
+    statement_cpu_metric_ = nullptr;
+  }
+
   LOG_TRACE("Exit");
 }
 
@@ -126,8 +334,25 @@ void ExecuteStage::handle_request(common::StageEvent *event)
 {
   ExecutionPlanEvent *exe_event = static_cast<ExecutionPlanEvent *>(event);
   SessionEvent *session_event = exe_event->sql_event()->session_event();
+  session_event->query_trace().enter_stage("execute");
   Query *sql = exe_event->sqls();
   const char *current_db = session_event->get_client()->session->get_current_db().c_str();
+  // 扫描、join和排序通过当前线程的标记检查语句是否超时或者被kill，存储层也是在这个线程上同步调用的
+  QueryCancelScope cancel_scope(session_event->get_client()->session->query_cancel().get());
+  if (statement_cpu_metric_ != nullptr)
+  {
+    statement_cpu_metric_->charge(sql->flag);
+  }
+
+  if (exe_event->admission_state() != ExecutionPlanEvent::AdmissionState::NONE || exe_event->pages_loaded())
+  {
+    // 从准入控制的等待队列或者异步加载页面回来，回调已经加过了，线程可能也换了
+    session_event->query_trace().resume();
+    common::RequestTrace::set_current(session_event->trace());
+    handle_select(exe_event, current_db);
+    common::RequestTrace::set_current(nullptr);
+    return;
+  }
 
   CompletionCallback *cb = new (std::nothrow) CompletionCallback(this, nullptr);
   if (cb == nullptr)
@@ -142,8 +367,7 @@ void ExecuteStage::handle_request(common::StageEvent *event)
   {
   case SCF_SELECT:
   { // select
-    do_select(current_db, sql, exe_event->sql_event()->session_event());
-    exe_event->done_immediate();
+    handle_select(exe_event, current_db);
   }
   break;
 
@@ -151,13 +375,27 @@ void ExecuteStage::handle_request(common::StageEvent *event)
   case SCF_UPDATE:
   case SCF_DELETE:
   case SCF_CREATE_TABLE:
+  case SCF_CREATE_VIEW:
   case SCF_SHOW_TABLES:
+  case SCF_SHOW_BUFFER_POOL:
   case SCF_DESC_TABLE:
   case SCF_DROP_TABLE:
+  case SCF_DROP_PARTITION:
+  case SCF_TRUNCATE_TABLE:
+  case SCF_ANALYZE_TABLE:
   case SCF_CREATE_INDEX:
   case SCF_DROP_INDEX:
   case SCF_LOAD_DATA:
+  case SCF_BACKUP:
   {
+    // 备库的数据只能来自主库的日志
+    if (Trx::replica() && sql->flag != SCF_SHOW_TABLES && sql->flag != SCF_SHOW_BUFFER_POOL &&
+        sql->flag != SCF_DESC_TABLE)
+    {
+      session_event->set_response(strrc(RC::READONLY));
+      exe_event->done_immediate();
+      return;
+    }
     StorageEvent *storage_event = new (std::nothrow) StorageEvent(exe_event);
     if (storage_event == nullptr)
     {
@@ -166,7 +404,60 @@ void ExecuteStage::handle_request(common::StageEvent *event)
       return;
     }
 
-    default_storage_stage_->handle_event(storage_event);
+    if (default_storage_stage_->max_batch() > 1 &&
+        (sql->flag == SCF_INSERT || sql->flag == SCF_UPDATE || sql->flag == SCF_DELETE))
+    {
+      // 增删改交给存储stage的线程，和其它会话同时到达的语句一起执行、一起提交
+      default_storage_stage_->add_event(storage_event);
+    }
+    else
+    {
+      default_storage_stage_->handle_event(storage_event);
+    }
+  }
+  break;
+  case SCF_SHOW_STATEMENT_STATS:
+  {
+    std::stringstream ss;
+    StatementStatsTable::instance().dump(ss);
+    session_event->set_response(ss.str());
+    exe_event->done_immediate();
+  }
+  break;
+  case SCF_RESET_STATEMENT_STATS:
+  {
+    StatementStatsTable::instance().reset();
+    session_event->set_response(strrc(RC::SUCCESS));
+    exe_event->done_immediate();
+  }
+  break;
+  case SCF_SHOW_PROCESSLIST:
+  {
+    std::vector<SessionInfo> sessions;
+    SessionPool::instance().list(sessions);
+    std::stringstream ss;
+    ss << "id | state | time_ms | sql" << std::endl;
+    for (const SessionInfo &info : sessions)
+    {
+      ss << info.id << " | " << (info.in_request ? "query" : "sleep") << " | " << info.request_usec / 1000 << " | "
+         << info.sql << std::endl;
+    }
+    session_event->set_response(ss.str());
+    exe_event->done_immediate();
+  }
+  break;
+  case SCF_KILL_QUERY:
+  {
+    // 只设置标记，被kill的语句在下一次检查时失败，由它自己的线程释放资源
+    const int connection_id = sql->sstr.kill_query.connection_id;
+    RC rc = RC::SUCCESS;
+    if (connection_id < 0 || !SessionPool::instance().kill_query((uint32_t)connection_id))
+    {
+      LOG_WARN("No running statement in session %d", connection_id);
+      rc = RC::NOTFOUND;
+    }
+    session_event->set_response(strrc(rc));
+    exe_event->done_immediate();
   }
   break;
   case SCF_SYNC:
@@ -185,6 +476,7 @@ void ExecuteStage::handle_request(common::StageEvent *event)
   break;
   case SCF_COMMIT:
   {
+    session_event->get_client()->session->close_trx_cursors();
     Trx *trx = session_event->get_client()->session->current_trx();
     RC rc = trx->commit();
     session_event->get_client()->session->set_trx_multi_operation_mode(false);
@@ -194,6 +486,7 @@ void ExecuteStage::handle_request(common::StageEvent *event)
   break;
   case SCF_ROLLBACK:
   {
+    session_event->get_client()->session->close_trx_cursors();
     Trx *trx = session_event->get_client()->session->current_trx();
     RC rc = trx->rollback();
     session_event->get_client()->session->set_trx_multi_operation_mode(false);
@@ -201,16 +494,144 @@ void ExecuteStage::handle_request(common::StageEvent *event)
     exe_event->done_immediate();
   }
   break;
+  case SCF_FETCH:
+  {
+    fetch_cursor(session_event, sql->sstr.fetch);
+    exe_event->done_immediate();
+  }
+  break;
+  case SCF_CLOSE_CURSOR:
+  {
+    const char *cursor_name = sql->sstr.close_cursor.cursor_name;
+    const bool removed = session_event->get_client()->session->remove_cursor(cursor_name);
+    if (!removed)
+    {
+      LOG_WARN("No cursor named %s", cursor_name);
+    }
+    session_event->set_response(removed ? "SUCCESS\n" : "FAILURE\n");
+    exe_event->done_immediate();
+  }
+  break;
+  case SCF_SAVEPOINT:
+  case SCF_ROLLBACK_TO_SAVEPOINT:
+  case SCF_RELEASE_SAVEPOINT:
+  {
+    // 保存点只在BEGIN开始的事务中有意义，单条语句的事务在语句结束时就提交了
+    Session *session = session_event->get_client()->session;
+    Trx *trx = session->current_trx();
+    const char *savepoint_name = sql->sstr.savepoint.savepoint_name;
+    RC rc = RC::SUCCESS;
+    if (!session->is_trx_multi_operation_mode())
+    {
+      LOG_WARN("Savepoint %s is only valid in a transaction", savepoint_name);
+      rc = RC::GENERIC_ERROR;
+    }
+    else if (sql->flag == SCF_SAVEPOINT)
+    {
+      trx->savepoint(savepoint_name);
+    }
+    else if (sql->flag == SCF_ROLLBACK_TO_SAVEPOINT)
+    {
+      rc = trx->rollback_to_savepoint(savepoint_name);
+    }
+    else
+    {
+      rc = trx->release_savepoint(savepoint_name);
+    }
+    session_event->set_response(strrc(rc));
+    exe_event->done_immediate();
+  }
+  break;
+  case SCF_SET_VARIABLE:
+  {
+    Session *session = session_event->get_client()->session;
+    const SetVariable &set_variable = sql->sstr.set_variable;
+    RC rc = RC::SUCCESS;
+    if (0 == strcasecmp(set_variable.variable_name, "synchronous_commit"))
+    {
+      bool value = false;
+      if (parse_bool_value(set_variable.value, &value))
+      {
+        session->set_synchronous_commit(value);
+      }
+      else
+      {
+        LOG_WARN("Invalid value of synchronous_commit: %s", set_variable.value);
+        rc = RC::INVALID_ARGUMENT;
+      }
+    }
+    else if (0 == strcasecmp(set_variable.variable_name, "lock_profiler"))
+    {
+      // 全局的开关，不只是当前的会话
+      bool value = false;
+      if (parse_bool_value(set_variable.value, &value))
+      {
+        common::LockProfiler::set_enabled(value);
+        LOG_INFO("Lock profiler is %s", value ? "enabled" : "disabled");
+      }
+      else
+      {
+        LOG_WARN("Invalid value of lock_profiler: %s", set_variable.value);
+        rc = RC::INVALID_ARGUMENT;
+      }
+    }
+    else if (0 == strcasecmp(set_variable.variable_name, "lock_profiler_sample_rate"))
+    {
+      char *end = nullptr;
+      const long value = strtol(set_variable.value, &end, 10);
+      if (end != set_variable.value && *end == '\0' && value > 0 && value <= INT_MAX)
+      {
+        common::LockProfiler::set_sample_rate((int)value);
+      }
+      else
+      {
+        LOG_WARN("Invalid value of lock_profiler_sample_rate: %s", set_variable.value);
+        rc = RC::INVALID_ARGUMENT;
+      }
+    }
+    else if (0 == strcasecmp(set_variable.variable_name, "statement_timeout"))
+    {
+      // 毫秒，0表示不限制，从下一条语句开始生效
+      char *end = nullptr;
+      const long value = strtol(set_variable.value, &end, 10);
+      if (end != set_variable.value && *end == '\0' && value >= 0)
+      {
+        session->set_statement_timeout(value);
+      }
+      else
+      {
+        LOG_WARN("Invalid value of statement_timeout: %s", set_variable.value);
+        rc = RC::INVALID_ARGUMENT;
+      }
+    }
+    else
+    {
+      LOG_WARN("Unknown variable: %s", set_variable.variable_name);
+      rc = RC::NOTFOUND;
+    }
+    session_event->set_response(strrc(rc));
+    exe_event->done_immediate();
+  }
+  break;
   case SCF_HELP:
   {
     const char *response = "show tables;\n"
+                           "show buffer pool status;\n"
+                           "show statement stats;\n"
+                           "truncate statement stats;\n"
+                           "show processlist;\n"
+                           "kill query `session id`;\n"
+                           "set statement_timeout = `ms`;\n"
                            "desc `table name`;\n"
                            "create table `table name` (`column name` `column type`, ...);\n"
                            "create index `index name` on `table` (`column`);\n"
                            "insert into `table` values(`value1`,`value2`);\n"
                            "update `table` set column=value [where `column`=`value`];\n"
                            "delete from `table` [where `column`=`value`];\n"
-                           "select [ * | `columns` ] from `table`;\n";
+                           "select [ * | `columns` ] from `table`;\n"
+                           "declare `cursor` cursor for select ...;\n"
+                           "fetch `n` from `cursor`;\n"
+                           "close `cursor`;\n";
     session_event->set_response(response);
     exe_event->done_immediate();
   }
@@ -256,83 +677,14 @@ void end_trx_if_need(Session *session, Trx *trx, bool all_right)
 }
 
 
-bool valueCompare(const TupleValue* value_a, const TupleValue* value_b, CompOp op)
-{
-  bool compare_result = false;
-  switch (op)
-  {
-  case EQUAL_TO:
-    compare_result = (value_a->compare(*value_b) == 0);
-    break;
-  case LESS_EQUAL:
-    compare_result = (value_a->compare(*value_b) <= 0);
-    break;
-  case NOT_EQUAL:
-    compare_result = (value_a->compare(*value_b) != 0);
-    break;
-  case LESS_THAN:
-    compare_result = (value_a->compare(*value_b) < 0);
-    break;
-  case GREAT_EQUAL:
-    compare_result = (value_a->compare(*value_b) >= 0);
-    break;
-  case GREAT_THAN:
-    compare_result = (value_a->compare(*value_b) > 0);
-    break;
-  default:
-    break;
-  }
-  return compare_result;
-}
-
-// 判断Tuple是否满足条件
-bool isTupleSatisfy(const Tuple& tp, const TupleSchema& schema, const Selects &selects)
-{
-    bool valid = true;
-    for (size_t i = 0; i < selects.condition_num; i++) {
-        const Condition& cond = selects.conditions[i];
-        // 只考虑两边都是attr的condition
-        if (cond.left_is_attr == 1 && cond.right_is_attr == 1) {
-            int left_index = schema.index_of_field(cond.left_attr.relation_name, cond.left_attr.attribute_name);
-            int right_index = schema.index_of_field(cond.right_attr.relation_name, cond.right_attr.attribute_name);
-            TupleValue *va = tp.get_pointer(left_index).get();
-            TupleValue *vb = tp.get_pointer(right_index).get();
-            if (valueCompare(va, vb, cond.comp) == false) {
-                valid = false;
-                break;
-            }
-        }
-    }
-    return valid;
-}
-
-// 回溯法求笛卡尔积
-void backtrack(TupleSet& ans, const std::vector<TupleSet>& sets, int index, Tuple& tmp, const Selects &selects, const TupleSchema& schema)
-{
-    if (index == -1) {
-        Tuple t;
-        for (const auto& each : tmp.values()) {
-            t.add(each);
-        }
-        // 满足条件再加入
-        if (isTupleSatisfy(t, schema, selects)) {
-            ans.add(std::move(t));
-        }
-    } else {
-        int len = sets[index].size();
-        for (int i = 0; i < len; i++) {
-            tmp.merge(sets[index].get(i));
-            backtrack(ans, sets, index - 1, tmp, selects, schema);
-            tmp.remove(sets[index].get(i));
-        }
-    }
-}
-
 TupleSchema buildSchema(const Selects &selects, const TupleSchema& total_schema, const char *db)
 {
     TupleSchema final_schema;
     for (int i = selects.attr_num - 1; i >= 0; i--) {
         const RelAttr &attr = selects.attributes[i];
+        if (attr.window != nullptr || attr.expr != nullptr) {
+            continue;
+        }
         if ((nullptr == attr.relation_name) && (0 == strcmp(attr.attribute_name, "*"))) {
             final_schema.append(total_schema);
         } else if ((nullptr != attr.relation_name) && (0 == strcmp(attr.attribute_name, "*"))) {
@@ -343,159 +695,310 @@ TupleSchema buildSchema(const Selects &selects, const TupleSchema& total_schema,
             schema_add_field(table, attr.attribute_name, final_schema);
         }
     }
+    // 分组字段和窗口函数用到的字段不一定出现在select中
+    auto add_field = [&total_schema, &final_schema](const RelAttr &attr) {
+        int index = attr.relation_name != nullptr ? total_schema.index_of_field(attr.relation_name, attr.attribute_name)
+                                                  : total_schema.index_of_field(attr.attribute_name);
+        if (index >= 0) {
+            const TupleField &field = total_schema.field(index);
+            final_schema.add_if_not_exists(field.type(), field.table_name(), field.field_name(), field.is_nullable());
+        }
+    };
+    for (size_t i = 0; i < selects.group_num; i++) {
+        add_field(selects.group_attrs[i]);
+    }
+    for (int i = selects.attr_num - 1; i >= 0; i--) {
+        const RelAttr &attr = selects.attributes[i];
+        if (attr.window == nullptr) {
+            continue;
+        }
+        add_field(attr);
+        for (size_t j = 0; j < attr.window->partition_num + attr.window->order_num; j++) {
+            add_field(attr.window->attrs[j]);
+        }
+    }
     return final_schema;
 }
 
-TupleSet do_join(const std::vector<TupleSet>& sets, const Selects &selects, const char *db)
+static bool same_attr(const RelAttr &left, const RelAttr &right)
 {
-    // 先根据所有的tuple_set构造一个包含所有列的TupleSet
-    TupleSchema total_schema;
-    TupleSet total_set;
-    for (auto it = sets.rbegin(); it != sets.rend(); it++) {
-        total_schema.append(it->get_schema());
-    }
-    total_set.set_schema(total_schema);
-
-    int len_sets = sets.size();
-    Tuple tmp;
-    backtrack(total_set, sets, len_sets - 1, tmp, selects, total_schema);
-
-    // 根据Select中的列构造输出的schema
-    // TupleSchema final_schema;
-    // for (int i = selects.attr_num - 1; i >= 0; i--) {
-    //     const RelAttr &attr = selects.attributes[i];
-    //     if ((nullptr == attr.relation_name) && (0 == strcmp(attr.attribute_name, "*"))) {
-    //         final_schema.append(total_schema);
-    //     } else if ((nullptr != attr.relation_name) && (0 == strcmp(attr.attribute_name, "*"))) {
-    //         Table *table = DefaultHandler::get_default().find_table(db, attr.relation_name);
-    //         TupleSchema::from_table(table, final_schema);
-    //     } else {
-    //         Table *table = DefaultHandler::get_default().find_table(db, attr.relation_name);
-    //         schema_add_field(table, attr.attribute_name, final_schema);
-    //     }
-    // }
-
-    TupleSet final_set;
-    TupleSchema final_schema = buildSchema(selects, total_schema, db);
-    final_set.set_schema(final_schema);
-
-      //////////////////////////至此生成全表笛卡尔积，开始group by/////////////////////////////
-  // if (selects.group_num > 0)
-  // {
-  //   // group by特点：不在group by中的列，在select中只能以聚合函数形式出现
-  //   // 检查group by列名是否存在
-  //   std::vector<int> group_idx; // 用于group by的列在tutal_set中的index
-  //   int n = selects.group_num;
-
-  //   for (int i = 0; i < n; ++i)
-  //   {
-  //     int cnt = 0;
-  //     const RelAttr &attr = selects.group_attrs[i];
-  //     // 确定该属性与这张表有关
-  //     int index = -1;
-
-  //     if (attr.relation_name != nullptr)
-  //     {
-  //       index = total_schema.index_of_field(attr.relation_name, attr.attribute_name);
-  //     }
-  //     else
-  //     {
-  //       // 不带属性名，可能出现二义性问题
-  //       const char *last_table_name = nullptr;
-  //       const int size = total_schema.fields().size();
-
-  //       for (int i = 0; i < size; ++i)
-  //       {
-  //         if (strcmp(attr.attribute_name, total_schema.field(i).field_name()) == 0)
-  //         {
-  //           if (cnt == 0)
-  //           {
-  //             ++cnt;
-  //             last_table_name = total_schema.field(i).table_name();
-  //             index = i;
-  //           }
-  //           else
-  //           {
-  //             if (last_table_name != total_schema.field(i).table_name())
-  //             {
-  //               ++cnt;
-  //               break;
-  //             }
-  //           }
-  //         }
-  //       }
-  //     }
-
-  //     if (index == -1 || cnt > 1)
-  //     {
-  //       // 有order信息但没有提取出来，说明出现错误的列名
-  //       for (SelectExeNode *&tmp_node : select_nodes)
-  //       {
-  //         delete tmp_node;
-  //       }
-
-  //       session_event->set_response("FAILURE\n");
-  //       end_trx_if_need(session, trx, true);
-  //       return RC::GENERIC_ERROR;
-  //     }
-  //   }
-  // }
-  //////////////////////////group by结束/////////////////////////////
-
-    // 取出需要的列
-    for (auto& tp : total_set.tuples()) {
-        Tuple t;
-        for (const auto& s : final_schema.fields()) {
-            int index = total_schema.index_of_field(s.table_name(), s.field_name());
-            t.add(tp.get_pointer(index));
-        }
-        final_set.add(std::move(t));
-    }
+  if (0 != strcmp(left.attribute_name, right.attribute_name))
+  {
+    return false;
+  }
+  return left.relation_name == nullptr || right.relation_name == nullptr || 0 == strcmp(left.relation_name, right.relation_name);
+}
 
-    return final_set;
+/**
+ * limit和offset都不能是负数
+ */
+static RC check_limit(const Selects &selects)
+{
+  if (selects.has_limit && (selects.limit < 0 || selects.offset < 0))
+  {
+    LOG_WARN("Invalid limit %d offset %d", selects.limit, selects.offset);
+    return RC::INVALID_ARGUMENT;
+  }
+  return RC::SUCCESS;
 }
 
-// 检查Select, where中的表名是否都出现在from中
-RC check_table_name(const Selects &selects, const char *db)
+/**
+ * 窗口函数的名字要认识，并且不能和聚合函数、group by一起使用
+ */
+static RC check_window(const Selects &selects)
 {
-  // 检查from中的表是否存在
-  int rel_num = selects.relation_num;
-  for (int i = 0; i < rel_num; i++)
+  bool has_window = false;
+  bool has_aggregate = false;
+  for (size_t i = 0; i < selects.attr_num; i++)
   {
-    Table *table = DefaultHandler::get_default().find_table(db, selects.relations[i]);
-    if (nullptr == table)
+    const RelAttr &attr = selects.attributes[i];
+    if (attr.window == nullptr)
     {
-      LOG_WARN("No such table [%s] in db [%s]", selects.relations[i], db);
-      return RC::SCHEMA_TABLE_NOT_EXIST;
+      has_aggregate = has_aggregate || attr.window_function_name != nullptr;
+      continue;
+    }
+    has_window = true;
+    WindowFuncType type;
+    if (!WindowFunction::parse_type(attr.window_function_name, type))
+    {
+      LOG_WARN("Unknown window function %s", attr.window_function_name);
+      return RC::SQL_SYNTAX;
     }
   }
+  if (has_window && (has_aggregate || selects.group_num > 0))
+  {
+    LOG_WARN("Window functions can not be used with aggregation");
+    return RC::SQL_SYNTAX;
+  }
+  return RC::SUCCESS;
+}
 
-  // 检查select中的表是否在from中
+/**
+ * select中不是聚合函数的列必须是分组字段；没有group by时不能同时查询普通的列和聚合函数
+ */
+static RC check_group_by(const Selects &selects)
+{
+  bool has_function = false;
+  bool has_plain = false;
   for (size_t i = 0; i < selects.attr_num; i++)
   {
     const RelAttr &attr = selects.attributes[i];
-    if (rel_num > 1)
-    { // 多表
-      // 只有列名且不为"*"出错, id
-      if ((nullptr == attr.relation_name) && (0 != strcmp(attr.attribute_name, "*")))
-      {
-        LOG_ERROR("Table name must appear.");
-        return RC::SCHEMA_TABLE_NOT_EXIST;
-      }
-      // t1.id
-      bool table_name_in_from = false;
-      for (int j = 0; j < rel_num; j++)
-      {
-        if ((nullptr != attr.relation_name) && (0 == strcmp(attr.relation_name, selects.relations[j])))
-        {
-          table_name_in_from = true;
-          break;
-        }
-      }
-      // t1.*
-      if ((nullptr == attr.relation_name) && (0 == strcmp(attr.attribute_name, "*")))
-      {
-        table_name_in_from = true;
+    if (attr.window != nullptr)
+    {
+      // 窗口函数不能和聚合一起使用，由check_window检查
+      continue;
+    }
+    if (attr.window_function_name != nullptr)
+    {
+      has_function = true;
+      continue;
+    }
+    has_plain = true;
+    if (selects.group_num == 0)
+    {
+      continue;
+    }
+    bool in_group = false;
+    for (size_t j = 0; j < selects.group_num && !in_group; j++)
+    {
+      in_group = same_attr(attr, selects.group_attrs[j]);
+    }
+    if (!in_group)
+    {
+      LOG_WARN("Column [%s] must appear in group by", attr.attribute_name);
+      return RC::SQL_SYNTAX;
+    }
+  }
+  if (selects.group_num == 0 && has_function && has_plain)
+  {
+    LOG_WARN("Cannot select columns together with aggregate functions without group by");
+    return RC::SQL_SYNTAX;
+  }
+  return RC::SUCCESS;
+}
+
+/**
+ * select中的表达式不能和聚合函数、窗口函数、group by一起使用；表达式和表达式条件中字段的表名要在from中，
+ * 多表时必须带表名。再按from中所有表的字段编译一次，字段不存在或者类型不匹配时在执行之前就返回错误
+ */
+static RC check_expressions(const Selects &selects, const char *db)
+{
+  bool has_expr = false;
+  bool has_function = selects.group_num > 0;
+  std::vector<const RelAttr *> attrs;
+  for (size_t i = 0; i < selects.attr_num; i++)
+  {
+    const RelAttr &attr = selects.attributes[i];
+    if (attr.expr != nullptr)
+    {
+      has_expr = true;
+      expr_collect_attrs(attr.expr, attrs);
+    }
+    has_function = has_function || attr.window_function_name != nullptr;
+  }
+  if (!has_expr && selects.expr_condition_num == 0)
+  {
+    return RC::SUCCESS;
+  }
+  if (has_expr && has_function)
+  {
+    LOG_WARN("Expressions can not be used with aggregation or window functions");
+    return RC::SQL_SYNTAX;
+  }
+  for (size_t i = 0; i < selects.expr_condition_num; i++)
+  {
+    expr_condition_collect_attrs(selects.expr_conditions[i], attrs);
+  }
+  for (const RelAttr *attr : attrs)
+  {
+    if (nullptr == attr->relation_name)
+    {
+      if (selects.relation_num > 1)
+      {
+        LOG_WARN("Table name must appear.");
+        return RC::SCHEMA_TABLE_NOT_EXIST;
+      }
+      continue;
+    }
+    bool table_name_in_from = false;
+    for (size_t j = 0; j < selects.relation_num && !table_name_in_from; j++)
+    {
+      table_name_in_from = 0 == strcmp(attr->relation_name, selects.relations[j]);
+    }
+    if (!table_name_in_from)
+    {
+      LOG_WARN("Table [%s] not in from", attr->relation_name);
+      return RC::SCHEMA_TABLE_NOT_EXIST;
+    }
+  }
+
+  TupleSchema from_schema;
+  for (int i = selects.relation_num - 1; i >= 0; i--)
+  {
+    TupleSchema::from_table(DefaultHandler::get_default().find_table(db, selects.relations[i]), from_schema);
+  }
+  ExprProgram program;
+  int output = 0;
+  for (size_t i = 0; i < selects.attr_num; i++)
+  {
+    if (selects.attributes[i].expr != nullptr)
+    {
+      RC rc = program.add_expr(selects.attributes[i].expr, from_schema, &output);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+    }
+  }
+  for (size_t i = 0; i < selects.expr_condition_num; i++)
+  {
+    RC rc = program.add_condition(selects.expr_conditions[i], from_schema);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+/**
+ * 表达式条件中的字段都属于同一张表(或者没有字段)时下推到这张表的扫描中过滤，否则在join之后计算
+ */
+static bool expr_condition_on_one_table(const Selects &selects, const std::vector<const RelAttr *> &attrs)
+{
+  if (selects.relation_num == 1)
+  {
+    return true;
+  }
+  for (const RelAttr *attr : attrs)
+  {
+    if (0 != strcmp(attr->relation_name, attrs[0]->relation_name))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * select中有表达式时按select的顺序列出输出的列：表达式、普通的字段和*展开的字段。
+ * table_schema是from中所有表的字段，按from的顺序。单表时表达式的表名是这张表，和其它列一样输出时不加表名前缀；
+ * 多表时表达式没有表名
+ */
+static void plan_expression_outputs(const Selects &selects, const TupleSchema &table_schema,
+                                    std::vector<ExpressionExeNode::Output> &outputs)
+{
+  const char *single_table = selects.relation_num == 1 ? table_schema.field(0).table_name() : "";
+  for (int i = selects.attr_num - 1; i >= 0; i--)
+  {
+    const RelAttr &attr = selects.attributes[i];
+    if (attr.expr != nullptr)
+    {
+      outputs.push_back(ExpressionExeNode::Output{attr.expr, single_table, expr_to_string(attr.expr)});
+      continue;
+    }
+    if (0 != strcmp(attr.attribute_name, "*"))
+    {
+      const char *table_name = attr.relation_name != nullptr ? attr.relation_name : single_table;
+      outputs.push_back(ExpressionExeNode::Output{nullptr, table_name, attr.attribute_name});
+      continue;
+    }
+    for (const TupleField &field : table_schema.fields())
+    {
+      if (attr.relation_name == nullptr || 0 == strcmp(attr.relation_name, field.table_name()))
+      {
+        outputs.push_back(ExpressionExeNode::Output{nullptr, field.table_name(), field.field_name()});
+      }
+    }
+  }
+}
+
+// 检查Select, where中的表名是否都出现在from中
+RC check_table_name(const Selects &selects, const char *db)
+{
+  // 检查from中的表是否存在
+  int rel_num = selects.relation_num;
+  for (int i = 0; i < rel_num; i++)
+  {
+    Table *table = DefaultHandler::get_default().find_table(db, selects.relations[i]);
+    if (nullptr == table)
+    {
+      LOG_WARN("No such table [%s] in db [%s]", selects.relations[i], db);
+      return RC::SCHEMA_TABLE_NOT_EXIST;
+    }
+  }
+
+  // 检查select中的表是否在from中
+  for (size_t i = 0; i < selects.attr_num; i++)
+  {
+    const RelAttr &attr = selects.attributes[i];
+    if (attr.expr != nullptr)
+    {
+      // 表达式中的字段由check_expressions检查
+      continue;
+    }
+    if (rel_num > 1)
+    { // 多表
+      // 只有列名且不为"*"出错, id
+      if ((nullptr == attr.relation_name) && (0 != strcmp(attr.attribute_name, "*")))
+      {
+        LOG_ERROR("Table name must appear.");
+        return RC::SCHEMA_TABLE_NOT_EXIST;
+      }
+      // t1.id
+      bool table_name_in_from = false;
+      for (int j = 0; j < rel_num; j++)
+      {
+        if ((nullptr != attr.relation_name) && (0 == strcmp(attr.relation_name, selects.relations[j])))
+        {
+          table_name_in_from = true;
+          break;
+        }
+      }
+      // t1.*
+      if ((nullptr == attr.relation_name) && (0 == strcmp(attr.attribute_name, "*")))
+      {
+        table_name_in_from = true;
       }
       if (table_name_in_from == false)
       {
@@ -622,537 +1125,1773 @@ RC check_table_name(const Selects &selects, const char *db)
   return RC::SUCCESS;
 }
 
-// 这里没有对输入的某些信息做合法性校验，比如查询的列名、where条件中的列名等，没有做必要的合法性校验
-// 需要补充上这一部分. 校验部分也可以放在resolve，不过跟execution放一起也没有关系
-RC ExecuteStage::do_select(const char *db, Query *sql, SessionEvent *session_event)
-{
-  RC rc = RC::SUCCESS;
-  Session *session = session_event->get_client()->session;
-  Trx *trx = session->current_trx();
-  const Selects &selects = sql->sstr.selection;
-
-  // 这里先检查Select语句的合法性
-  rc = check_table_name(selects, db);
-  if (rc != RC::SUCCESS)
-  {
-    session_event->set_response("FAILURE\n");
-    end_trx_if_need(session, trx, false);
-    return rc;
-  }
-
-  std::vector<SelectExeNode *> select_nodes;
+#define LATE_MATERIALIZE_MIN_BYTES 32 // 一张表延迟读取的字段每行至少有这么多字节时才延迟物化
 
+/**
+ * 多表查询时，一张表要输出的字段不在join条件中并且比较宽的时候，扫描这张表只读出join条件的字段和rid，
+ * 其它要输出的字段在join之后再读取。修改扫描算子的schema，deferred中是每张表延迟读取的字段。
+ * from中有同名的表时不能按表名区分rid，不做延迟物化
+ */
+static void plan_late_materialize(const Selects &selects, const TupleSchema &final_schema,
+                                  std::vector<SelectExeNode *> &select_nodes,
+                                  std::vector<std::pair<Table *, TupleSchema>> &deferred)
+{
   for (size_t i = 0; i < selects.relation_num; i++)
   {
-    // 遍历所有表
-    const char *table_name = selects.relations[i];
-
-    SelectExeNode *select_node = new SelectExeNode;
-    rc = create_selection_executor(trx, selects, db, table_name, *select_node);
-    if (rc != RC::SUCCESS)
+    for (size_t j = 0; j < i; j++)
     {
-      session_event->set_response("FAILURE\n");
-      delete select_node;
-      for (SelectExeNode *&tmp_node : select_nodes)
+      if (0 == strcmp(selects.relations[i], selects.relations[j]))
       {
-        delete tmp_node;
+        return;
       }
-      end_trx_if_need(session, trx, false);
-      return rc;
     }
-    LOG_INFO("成功创建selection_executor");
-    select_nodes.push_back(select_node);
   }
-  LOG_INFO("select_nodes.size: %d", select_nodes.size());
 
-  if (select_nodes.empty())
+  for (size_t i = 0; i < select_nodes.size(); i++)
   {
-    LOG_ERROR("No table given");
-    session_event->set_response("FAILURE\n");
-    end_trx_if_need(session, trx, false);
-    return RC::SQL_SYNTAX;
-  }
-  LOG_INFO("select_nodes's size: %d", select_nodes.size());
+    Table *table = select_nodes[i]->table();
+    const char *table_name = selects.relations[i];
+    if (table->partitioned())
+    {
+      // 不同分区的rid会重复，不能按rid回表
+      continue;
+    }
+    TupleSchema keys;
+    for (size_t j = 0; j < selects.condition_num; j++)
+    {
+      const Condition &condition = selects.conditions[j];
+      if (condition.sub_select != nullptr || condition.left_is_attr != 1 || condition.right_is_attr != 1 ||
+          0 == strcmp(condition.left_attr.relation_name, condition.right_attr.relation_name))
+      {
+        continue;
+      }
+      if (0 == strcmp(condition.left_attr.relation_name, table_name))
+      {
+        schema_add_field(table, condition.left_attr.attribute_name, keys);
+      }
+      if (0 == strcmp(condition.right_attr.relation_name, table_name))
+      {
+        schema_add_field(table, condition.right_attr.attribute_name, keys);
+      }
+    }
 
-  std::vector<TupleSet> tuple_sets;
-  for (SelectExeNode *&node : select_nodes)
-  {
-    TupleSet tuple_set;
-    // excute里设置了聚合函数的type，type定义于tuple.h文件
-    LOG_INFO("开始执行select_node->execute函数");
-    rc = node->execute(tuple_set);
-    LOG_INFO("node->execute完毕并返回 rc=%d", rc);
-    if (rc != RC::SUCCESS)
+    TupleSchema fields;
+    int bytes = 0;
+    for (const TupleField &field : final_schema.fields())
     {
-      LOG_INFO("node->execute失败 rc=%d", rc);
-      for (SelectExeNode *&tmp_node : select_nodes)
+      if (0 != strcmp(field.table_name(), table_name) || keys.index_of_field(table_name, field.field_name()) >= 0 ||
+          fields.index_of_field(table_name, field.field_name()) >= 0)
       {
-        delete tmp_node;
+        continue;
       }
-      end_trx_if_need(session, trx, false);
-      return rc;
+      fields.add(field.type(), field.table_name(), field.field_name(), field.is_nullable());
+      bytes += table->table_meta().field(field.field_name())->value_len();
     }
-    else
+    if (bytes < LATE_MATERIALIZE_MIN_BYTES)
     {
-      tuple_sets.push_back(std::move(tuple_set));
+      continue;
     }
+
+    keys.add(INTS, table_name, RID_PAGE_FIELD);
+    keys.add(INTS, table_name, RID_SLOT_FIELD);
+    select_nodes[i]->set_schema(std::move(keys));
+    deferred.emplace_back(table, std::move(fields));
   }
+}
 
-  std::stringstream ss;
-  TupleSet result;
-  bool isMultiTable = false;
-  if (tuple_sets.size() > 1)
-  { // 本次查询了多张表，需要做join操作
-    isMultiTable = true;
-    result = do_join(tuple_sets, selects, db);
+/**
+ * 单表并且没有聚合时，ORDER BY的字段都是这张表上不能为null的字段、方向相同，并且有索引按这些字段排好了序，
+ * 就让扫描按索引的顺序读取，排序算子在扫描确实有序时不再排序。null在索引中的位置和排序时不一样，
+ * 可以为null的字段不用索引的顺序
+ */
+static void plan_index_order(SelectExeNode *scan, const Selects &selects, SortExeNode *sort)
+{
+  Table *table = scan->table();
+  const bool descending = selects.order_attrs[0].is_desc == 1;
+  std::vector<const FieldMeta *> fields;
+  for (size_t i = 0; i < selects.order_num; i++)
+  {
+    const RelAttr &attr = selects.order_attrs[i];
+    if ((attr.is_desc == 1) != descending ||
+        (attr.relation_name != nullptr && 0 != strcmp(attr.relation_name, table->name())))
+    {
+      return;
+    }
+    const FieldMeta *field = table->table_meta().field(attr.attribute_name);
+    if (nullptr == field || field->nullable())
+    {
+      return;
+    }
+    fields.push_back(field);
   }
-  else
+  scan->set_order(std::move(fields), descending);
+  if (nullptr == scan->order_index())
   {
-    // 当前只查询一张表，直接返回结果即可
-    result = std::move(tuple_sets.front());
+    scan->set_order(std::vector<const FieldMeta *>(), false);
+    return;
   }
+  sort->set_ordered_input(scan);
+}
 
-  ////////////////////////////聚合函数开始/////////////////////////////
-  // 不管是单表还是多表，到聚合这一步都应该只剩一个TupleSet
-  std::vector<TupleSet> results;
-
-  // 处理聚合函数
-  if (result.size() > 0)
+/**
+ * 单表的GROUP BY字段都是这张表上不能为null的字段，并且有索引按这些字段排好了序时，扫描按索引的顺序读取，
+ * 聚合算子在扫描确实有序时每个分组读完就输出，不用hash表。分组只要求同一个值的行连续，顺序和方向都可以任选：
+ * ORDER BY是分组字段的一部分并且方向相同时，这些字段按ORDER BY的顺序排在前面，排序算子也不用再排序。
+ * 返回ORDER BY是否也能由索引的顺序满足
+ */
+static bool plan_group_order(SelectExeNode *scan, const Selects &selects, HashAggregateExeNode *aggregate)
+{
+  Table *table = scan->table();
+  std::vector<const RelAttr *> attrs;
+  bool order_covered = selects.order_num > 0;
+  const bool descending = order_covered && selects.order_attrs[0].is_desc == 1;
+  for (size_t i = 0; i < selects.order_num && order_covered; i++)
   {
-    // 上一步有结果才进行聚合
-    AttrFunction *attr_function = new AttrFunction;
-    for (int i = selects.attr_num - 1; i >= 0; i--)
+    const RelAttr &attr = selects.order_attrs[i];
+    order_covered = (attr.is_desc == 1) == descending;
+    for (size_t j = 0; j < selects.group_num && order_covered; j++)
     {
-      const RelAttr &attr = selects.attributes[i];
-
-      if (attr.window_function_name != nullptr)
+      if (same_attr(attr, selects.group_attrs[j]))
       {
-        // 注意这里attr.relation_name可能为nullptr
-        FuncType function_type = judge_function_type(attr.window_function_name);
-        attr_function->add_function_type(std::string(attr.attribute_name), function_type, attr.relation_name);
+        attrs.push_back(&selects.group_attrs[j]);
+        break;
       }
     }
-
-    rc = do_aggregation(&result, attr_function, results, selects.relation_num);
-
-    if (rc != RC::SUCCESS)
+    order_covered = order_covered && attrs.size() == i + 1;
+  }
+  if (!order_covered)
+  {
+    attrs.clear();
+  }
+  for (size_t j = 0; j < selects.group_num; j++)
+  {
+    if (std::find(attrs.begin(), attrs.end(), &selects.group_attrs[j]) == attrs.end())
     {
-      session_event->set_response("FAILURE\n");
-      for (SelectExeNode *&tmp_node : select_nodes)
-      {
-        delete tmp_node;
-      }
-      end_trx_if_need(session, trx, false);
-      return rc;
+      attrs.push_back(&selects.group_attrs[j]);
     }
+  }
 
-    if (results.size() != 0)
+  std::vector<const FieldMeta *> fields;
+  for (const RelAttr *attr : attrs)
+  {
+    if (attr->relation_name != nullptr && 0 != strcmp(attr->relation_name, table->name()))
     {
-      result = std::move(results[0]);
-      results.clear();
+      return false;
     }
+    const FieldMeta *field = table->table_meta().field(attr->attribute_name);
+    if (nullptr == field || field->nullable() || std::find(fields.begin(), fields.end(), field) != fields.end())
+    {
+      return false;
+    }
+    fields.push_back(field);
   }
-  ////////////////////////////聚合函数结束/////////////////////////////
-
-  if (selects.order_num > 0)
+  scan->set_order(std::move(fields), order_covered && descending);
+  if (nullptr == scan->order_index())
   {
-    // 当前没有group by，先假设聚合和排序是矛盾的，仍然用tuples_sets进行快速排序
-    ///////////////////////////////////排序开始////////////////////////////////
-    // 提取排序信息
-    OrderInfo *order_info = new OrderInfo;
-    const TupleSchema &schema = result.get_schema();
+    scan->set_order(std::vector<const FieldMeta *>(), false);
+    return false;
+  }
+  aggregate->set_ordered_input(scan);
+  return order_covered;
+}
 
-    for (int i = selects.order_num - 1; i >= 0; i--)
+/**
+ * 按统计信息估计表中几个字段组合起来的不同值个数，用来预先分配DISTINCT和COUNT(DISTINCT)的hash集合。
+ * 每个字段的不同值个数相乘，不超过表的行数，过滤条件不考虑。有字段没有统计信息时返回0，hash集合从小开始扩容
+ */
+static int64_t estimate_distinct(Table *table, const std::vector<const char *> &field_names)
+{
+  TableStats stats;
+  if (field_names.empty() || table->statistics(stats) != RC::SUCCESS)
+  {
+    return 0;
+  }
+  int64_t estimate = 1;
+  for (const char *field_name : field_names)
+  {
+    const int index = table->table_meta().find_field_index_by_name(field_name);
+    if (index < 0 || index >= (int)stats.distinct_counts.size() || stats.distinct_counts[index] < 0)
     {
-      int cnt = 0;
-      const RelAttr &attr = selects.order_attrs[i];
-      // 确定该属性与这张表有关
-      int index = -1;
-      if (attr.relation_name != nullptr)
+      return 0;
+    }
+    estimate = std::min<int64_t>(estimate * std::max(stats.distinct_counts[index], 1), stats.row_count);
+  }
+  return estimate;
+}
+
+static bool same_sort_attr(const RelAttr &left, const RelAttr &right)
+{
+  return same_attr(left, right) && left.is_desc == right.is_desc;
+}
+
+static bool same_window(const WindowSpec &left, const WindowSpec &right)
+{
+  if (left.partition_num != right.partition_num || left.order_num != right.order_num)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < left.partition_num + left.order_num; i++)
+  {
+    if (!same_sort_attr(left.attrs[i], right.attrs[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * left的排序字段是right的排序字段的前缀，按right排好序的输入也满足left
+ */
+static bool window_prefix(const WindowSpec &left, const WindowSpec &right)
+{
+  const size_t key_num = left.partition_num + left.order_num;
+  if (key_num > right.partition_num + right.order_num)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < key_num; i++)
+  {
+    if (!same_sort_attr(left.attrs[i], right.attrs[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * ORDER BY的字段是窗口排序字段的前缀，按窗口排序之后不需要再排序
+ */
+static bool order_prefix(const Selects &selects, const WindowSpec &window)
+{
+  if (selects.order_num == 0 || selects.order_num > window.partition_num + window.order_num)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < selects.order_num; i++)
+  {
+    if (!same_sort_attr(selects.order_attrs[i], window.attrs[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * 窗口函数输出的列名，例如rank() over (partition by c order by score desc)
+ */
+static std::string window_column_name(const RelAttr &attr, bool multi_table)
+{
+  auto attr_name = [multi_table](const RelAttr &attr) {
+    std::string name = multi_table && attr.relation_name != nullptr
+                           ? std::string(attr.relation_name) + "." + attr.attribute_name
+                           : std::string(attr.attribute_name);
+    return name;
+  };
+
+  std::string function_name = attr.window_function_name;
+  std::string name = common::str_to_lower(function_name) + "(";
+  WindowFuncType type;
+  if (0 != strcmp(attr.attribute_name, "*"))
+  {
+    name += attr_name(attr);
+  }
+  else if (WindowFunction::parse_type(attr.window_function_name, type) && type == WindowFuncType::COUNT)
+  {
+    name += "*";
+  }
+  name += ") over (";
+
+  const WindowSpec &window = *attr.window;
+  for (size_t i = 0; i < window.partition_num; i++)
+  {
+    name += i == 0 ? "partition by " : ", ";
+    name += attr_name(window.attrs[i]);
+  }
+  for (size_t i = 0; i < window.order_num; i++)
+  {
+    const RelAttr &order_attr = window.attrs[window.partition_num + i];
+    name += i > 0 ? ", " : (window.partition_num > 0 ? " order by " : "order by ");
+    name += attr_name(order_attr);
+    if (order_attr.is_desc == 1)
+    {
+      name += " desc";
+    }
+  }
+  return name + ")";
+}
+
+/**
+ * 为select中的窗口函数增加排序和WindowExeNode，最后按照select的顺序投影。
+ * OVER相同的函数在同一个WindowExeNode中计算；一个窗口的排序字段是另一个的前缀时共用一次排序，
+ * 所以按排序字段从长到短安排排序。能满足ORDER BY的那次排序放在最后，这时order_satisfied为true，不需要再排序
+ */
+static ExecutionNode *plan_windows(const Selects &selects, ExecutionNode *root, MemoryTracker *memory,
+                                   bool &order_satisfied)
+{
+  order_satisfied = false;
+  std::vector<const RelAttr *> windows;
+  for (int i = selects.attr_num - 1; i >= 0; i--)
+  {
+    if (selects.attributes[i].window != nullptr)
+    {
+      windows.push_back(&selects.attributes[i]);
+    }
+  }
+  if (windows.empty())
+  {
+    return root;
+  }
+
+  const TupleSchema input = root->schema();
+  const bool multi_table = selects.relation_num > 1;
+
+  std::vector<const WindowSpec *> specs;
+  for (const RelAttr *attr : windows)
+  {
+    if (std::none_of(specs.begin(), specs.end(),
+                     [attr](const WindowSpec *spec) { return same_window(*spec, *attr->window); }))
+    {
+      specs.push_back(attr->window);
+    }
+  }
+  std::stable_sort(specs.begin(), specs.end(), [](const WindowSpec *left, const WindowSpec *right) {
+    return left->partition_num + left->order_num > right->partition_num + right->order_num;
+  });
+
+  // 每次排序和使用这次排序的窗口
+  std::vector<std::pair<const WindowSpec *, std::vector<const WindowSpec *>>> sorts;
+  for (const WindowSpec *spec : specs)
+  {
+    auto iter = std::find_if(sorts.begin(), sorts.end(),
+                             [spec](const auto &sort) { return window_prefix(*spec, *sort.first); });
+    if (iter == sorts.end())
+    {
+      sorts.emplace_back(spec, std::vector<const WindowSpec *>{spec});
+    }
+    else
+    {
+      iter->second.push_back(spec);
+    }
+  }
+  auto ordered = std::find_if(sorts.begin(), sorts.end(),
+                              [&selects](const auto &sort) { return order_prefix(selects, *sort.first); });
+  if (ordered != sorts.end())
+  {
+    std::rotate(ordered, ordered + 1, sorts.end());
+    order_satisfied = true;
+  }
+
+  for (const auto &sort : sorts)
+  {
+    const int key_num = sort.first->partition_num + sort.first->order_num;
+    if (key_num > 0)
+    {
+      root = new SortExeNode(root, sort.first->attrs, key_num, -1, memory);
+    }
+    for (const WindowSpec *spec : sort.second)
+    {
+      std::vector<WindowFunction> functions;
+      for (const RelAttr *attr : windows)
+      {
+        if (!same_window(*spec, *attr->window))
+        {
+          continue;
+        }
+        WindowFunction function;
+        WindowFunction::parse_type(attr->window_function_name, function.type);
+        function.table_name = attr->relation_name;
+        function.arg = attr->attribute_name;
+        function.name = window_column_name(*attr, multi_table);
+        if (std::none_of(functions.begin(), functions.end(),
+                         [&function](const WindowFunction &other) { return other.name == function.name; }))
+        {
+          functions.push_back(std::move(function));
+        }
+      }
+      root = new WindowExeNode(root, spec, std::move(functions), memory);
+    }
+  }
+
+  // 窗口函数的参数和OVER中的字段不一定出现在select中
+  TupleSchema output;
+  for (int i = selects.attr_num - 1; i >= 0; i--)
+  {
+    const RelAttr &attr = selects.attributes[i];
+    if (attr.window != nullptr)
+    {
+      WindowFuncType type;
+      WindowFunction::parse_type(attr.window_function_name, type);
+      int index = -1;
+      if (0 != strcmp(attr.attribute_name, "*"))
+      {
+        index = attr.relation_name != nullptr ? input.index_of_field(attr.relation_name, attr.attribute_name)
+                                              : input.index_of_field(attr.attribute_name);
+      }
+      const AttrType arg_type = index >= 0 ? input.field(index).type() : INTS;
+      output.add(WindowFunction::result_type(type, arg_type), "", window_column_name(attr, multi_table).c_str(),
+                 WindowFunction::result_nullable(type));
+      continue;
+    }
+    for (size_t j = 0; j < input.fields().size(); j++)
+    {
+      const TupleField &field = input.field(j);
+      bool match = false;
+      if (0 == strcmp(attr.attribute_name, "*"))
       {
-        index = schema.index_of_field(attr.relation_name, attr.attribute_name);
+        match = attr.relation_name == nullptr || 0 == strcmp(attr.relation_name, field.table_name());
       }
       else
       {
-        // 不带属性名，可能出现二义性问题
-        const char *last_table_name = nullptr;
-        const int size = schema.fields().size();
+        match = 0 == strcmp(attr.attribute_name, field.field_name()) &&
+                (attr.relation_name == nullptr || 0 == strcmp(attr.relation_name, field.table_name()));
+      }
+      if (match)
+      {
+        output.add(field.type(), field.table_name(), field.field_name(), field.is_nullable());
+        if (0 != strcmp(attr.attribute_name, "*"))
+        {
+          break;
+        }
+      }
+    }
+  }
+  return new ProjectExeNode(root, output);
+}
+
+/**
+ * 把每张表的扫描算子组合成执行计划：按照优化器选择的顺序join，没有选择时按照from的顺序。
+ * 每一步使用优化器选择的join方法，没有选择时有等值条件就用hash join，两张表都加入之后立即用两边都是字段的其它条件过滤，
+ * 多表时宽的字段延迟到join之后按rid读取，再按照select的列做投影，最后是聚合和排序。select_nodes的所有权转移给返回的算子
+ */
+static ExecutionNode *build_execution_plan(const Selects &selects, const char *db, std::vector<SelectExeNode *> &select_nodes,
+                                           const JoinPlan &join_plan, MemoryTracker *memory)
+{
+  const int node_num = select_nodes.size();
+  bool has_expr = false;
+  for (size_t i = 0; i < selects.attr_num; i++)
+  {
+    has_expr = has_expr || selects.attributes[i].expr != nullptr;
+  }
+  // 用到多张表的表达式条件在join之后计算，只用到一张表的已经在扫描时过滤了
+  std::vector<const ExprCondition *> join_expr_conditions;
+  std::vector<const RelAttr *> expr_attrs;
+  for (size_t i = 0; i < selects.expr_condition_num; i++)
+  {
+    std::vector<const RelAttr *> attrs;
+    expr_condition_collect_attrs(selects.expr_conditions[i], attrs);
+    if (!expr_condition_on_one_table(selects, attrs))
+    {
+      join_expr_conditions.push_back(&selects.expr_conditions[i]);
+      expr_attrs.insert(expr_attrs.end(), attrs.begin(), attrs.end());
+    }
+  }
+  TupleSchema table_schema;
+  if (has_expr)
+  {
+    for (int i = node_num - 1; i >= 0; i--)
+    {
+      TupleSchema::from_table(select_nodes[i]->table(), table_schema);
+    }
+    for (size_t i = 0; i < selects.attr_num; i++)
+    {
+      if (selects.attributes[i].expr != nullptr)
+      {
+        expr_collect_attrs(selects.attributes[i].expr, expr_attrs);
+      }
+    }
+  }
+
+  TupleSchema final_schema;
+  std::vector<std::pair<Table *, TupleSchema>> deferred;
+  if (node_num > 1)
+  {
+    // select *的列按照from的顺序输出
+    TupleSchema from_schema;
+    for (int i = node_num - 1; i >= 0; i--)
+    {
+      from_schema.append(select_nodes[i]->schema());
+    }
+    final_schema = buildSchema(selects, from_schema, db);
+    // 表达式用到的字段在join之后才计算，延迟物化时也要读出来
+    TupleSchema needed_schema = final_schema;
+    for (const RelAttr *attr : expr_attrs)
+    {
+      const int index = from_schema.index_of_field(attr->relation_name, attr->attribute_name);
+      if (index >= 0)
+      {
+        const TupleField &field = from_schema.field(index);
+        needed_schema.add_if_not_exists(field.type(), field.table_name(), field.field_name(), field.is_nullable());
+      }
+    }
+    plan_late_materialize(selects, needed_schema, select_nodes, deferred);
+  }
 
-        for (int i = 0; i < size; ++i)
+  std::vector<JoinStep> steps = join_plan.steps;
+  if ((int)steps.size() != node_num)
+  {
+    // relations中的表和from中的顺序相反
+    steps.clear();
+    for (int i = node_num - 1; i >= 0; i--)
+    {
+      steps.push_back(JoinStep{i, JoinMethod::HASH});
+    }
+  }
+
+  ExecutionNode *root = select_nodes[steps[0].relation];
+  TupleSchema total_schema;
+  total_schema.append(select_nodes[steps[0].relation]->schema());
+  std::vector<const char *> joined_tables = {selects.relations[steps[0].relation]};
+  std::vector<bool> applied(selects.condition_num, false);
+  for (int k = 1; k < node_num; k++)
+  {
+    const int i = steps[k].relation;
+    const TupleSchema &right_schema = select_nodes[i]->schema();
+    joined_tables.push_back(selects.relations[i]);
+
+    // 索引嵌套循环join用左边的字段值在右边表的索引上查找，索引不能用时改成hash join
+    JoinMethod method = steps[k].method;
+    int lookup_index = -1;
+    Index *index = nullptr;
+    if (method == JoinMethod::INDEX_NESTED_LOOP)
+    {
+      const int c = steps[k].condition;
+      if (c >= 0 && c < (int)selects.condition_num && selects.conditions[c].left_is_attr == 1 &&
+          selects.conditions[c].right_is_attr == 1)
+      {
+        const RelAttr *left_attr = &selects.conditions[c].left_attr;
+        const RelAttr *right_attr = &selects.conditions[c].right_attr;
+        if (0 == strcmp(left_attr->relation_name, selects.relations[i]))
         {
-          if (strcmp(attr.attribute_name, schema.field(i).field_name()) == 0)
-          {
-            if (cnt == 0)
-            {
-              ++cnt;
-              last_table_name = schema.field(i).table_name();
-              index = i;
-            }
-            else
-            {
-              if (last_table_name != schema.field(i).table_name())
-              {
-                ++cnt;
-                break;
-              }
-            }
-          }
+          std::swap(left_attr, right_attr);
+        }
+        Table *table = select_nodes[i]->table();
+        const FieldMeta *field = table->table_meta().field(right_attr->attribute_name);
+        lookup_index = total_schema.index_of_field(left_attr->relation_name, left_attr->attribute_name);
+        index = table->find_index_for_lookup(right_attr->attribute_name);
+        if (0 == strcmp(right_attr->relation_name, selects.relations[i]) && lookup_index >= 0 && index != nullptr &&
+            field != nullptr && hash_join_key_usable(total_schema.field(lookup_index).type(), field->type()))
+        {
+          applied[c] = true;
+        }
+        else
+        {
+          index = nullptr;
+        }
+      }
+      if (nullptr == index)
+      {
+        method = JoinMethod::HASH;
+      }
+    }
+
+    // 两边的表都已经加入的条件在这里处理，类型相同的等值条件作为hash join的字段，其它的条件在join之后过滤
+    std::vector<const Condition *> join_conditions;
+    std::vector<std::pair<int, int>> key_fields;
+    for (size_t j = 0; j < selects.condition_num; j++)
+    {
+      const Condition &condition = selects.conditions[j];
+      if (applied[j] || condition.left_is_attr != 1 || condition.right_is_attr != 1 ||
+          0 == strcmp(condition.left_attr.relation_name, condition.right_attr.relation_name))
+      {
+        // 只和一张表有关的条件已经在扫描时过滤了
+        continue;
+      }
+      auto joined = [&joined_tables](const char *table_name) {
+        return std::any_of(joined_tables.begin(), joined_tables.end(),
+                           [table_name](const char *name) { return 0 == strcmp(name, table_name); });
+      };
+      if (!joined(condition.left_attr.relation_name) || !joined(condition.right_attr.relation_name))
+      {
+        continue;
+      }
+      applied[j] = true;
+
+      if (condition.comp == EQUAL_TO && method == JoinMethod::HASH)
+      {
+        const RelAttr *left_attr = &condition.left_attr;
+        const RelAttr *right_attr = &condition.right_attr;
+        if (0 == strcmp(left_attr->relation_name, selects.relations[i]))
+        {
+          std::swap(left_attr, right_attr);
+        }
+        int left_index = total_schema.index_of_field(left_attr->relation_name, left_attr->attribute_name);
+        int right_index = right_schema.index_of_field(right_attr->relation_name, right_attr->attribute_name);
+        if (left_index >= 0 && right_index >= 0 &&
+            hash_join_key_usable(total_schema.field(left_index).type(), right_schema.field(right_index).type()))
+        {
+          key_fields.emplace_back(left_index, right_index);
+          continue;
         }
       }
+      join_conditions.push_back(&condition);
+    }
+
+    if (method == JoinMethod::INDEX_NESTED_LOOP)
+    {
+      root = new IndexNestedLoopJoinExeNode(root, select_nodes[i], lookup_index, index);
+    }
+    else if (key_fields.empty())
+    {
+      root = new NestedLoopJoinExeNode(root, select_nodes[i], memory);
+    }
+    else
+    {
+      HashJoinExeNode *hash_join = new HashJoinExeNode(root, select_nodes[i], std::move(key_fields), memory);
+      hash_join->set_build_left(steps[k].build_left);
+      root = hash_join;
+    }
+    total_schema.append(right_schema);
+    if (!join_conditions.empty())
+    {
+      root = new FilterExeNode(root, std::move(join_conditions));
+    }
+  }
+
+  if (!deferred.empty())
+  {
+    MaterializeExeNode *materialize = new MaterializeExeNode(root);
+    for (auto &table_fields : deferred)
+    {
+      materialize->add_table(table_fields.first, std::move(table_fields.second));
+    }
+    root = materialize;
+  }
+  SelectExeNode *single_node = node_num == 1 ? select_nodes[0] : nullptr;
+  ExecutionNode *scan_output = single_node;  // 输出的行和顺序与单表的扫描相同的算子
+  if (!join_expr_conditions.empty() || has_expr)
+  {
+    std::vector<ExpressionExeNode::Output> outputs;
+    if (has_expr)
+    {
+      plan_expression_outputs(selects, table_schema, outputs);
+    }
+    root = new ExpressionExeNode(root, std::move(join_expr_conditions), std::move(outputs));
+    if (single_node != nullptr)
+    {
+      // 单表时只计算select中的表达式，不过滤
+      scan_output = root;
+    }
+  }
+  if (node_num > 1 && !has_expr)
+  {
+    root = new ProjectExeNode(root, final_schema);
+  }
+  select_nodes.clear();
+  bool group_ordered = false;  // 分组按ORDER BY的顺序输出
 
-      if (index == -1 || cnt > 1)
+  AttrFunction *attr_function = new AttrFunction;
+  for (int i = selects.attr_num - 1; i >= 0; i--)
+  {
+    const RelAttr &attr = selects.attributes[i];
+    if (attr.window_function_name != nullptr && attr.window == nullptr)
+    {
+      // 注意这里attr.relation_name可能为nullptr
+      FuncType function_type = judge_function_type(attr.window_function_name);
+      if (attr.is_distinct && function_type == FuncType::COUNT)
+      {
+        function_type = FuncType::COUNT_DISTINCT;
+      }
+      attr_function->add_function_type(std::string(attr.attribute_name), function_type, attr.relation_name);
+      if (function_type == FuncType::COUNT_DISTINCT && single_node != nullptr && selects.group_num == 0)
+      {
+        // 分组时每个分组的集合都从小开始
+        const int function_index = attr_function->get_size() - 1;
+        attr_function->set_distinct_estimate(function_index, estimate_distinct(single_node->table(), {attr.attribute_name}));
+      }
+    }
+  }
+  if (selects.group_num > 0)
+  {
+    // 按照select的顺序输出分组字段和聚合函数，check_group_by保证了普通的列都是分组字段
+    std::vector<HashAggregateExeNode::Output> outputs;
+    int function_index = 0;
+    for (int i = selects.attr_num - 1; i >= 0; i--)
+    {
+      const RelAttr &attr = selects.attributes[i];
+      if (attr.window_function_name != nullptr)
+      {
+        outputs.push_back(HashAggregateExeNode::Output{false, function_index++});
+        continue;
+      }
+      for (size_t j = 0; j < selects.group_num; j++)
       {
-        // 有order信息但没有提取出来，说明出现错误的列名
-        for (SelectExeNode *&tmp_node : select_nodes)
+        if (same_attr(attr, selects.group_attrs[j]))
         {
-          delete tmp_node;
+          outputs.push_back(HashAggregateExeNode::Output{true, (int)j});
+          break;
         }
+      }
+    }
+    HashAggregateExeNode *aggregate = new HashAggregateExeNode(root, selects.group_attrs, selects.group_num,
+                                                               attr_function, std::move(outputs), selects.relation_num,
+                                                               memory);
+    if (root == single_node)
+    {
+      group_ordered = plan_group_order(single_node, selects, aggregate);
+    }
+    root = aggregate;
+  }
+  else if (attr_function->get_size() > 0)
+  {
+    root = new AggregateExeNode(root, attr_function, selects.relation_num, memory);
+  }
+  else
+  {
+    delete attr_function;
+  }
+
+  bool order_satisfied = false;
+  root = plan_windows(selects, root, memory, order_satisfied);
+
+  // DISTINCT不改变输入的顺序，单表的扫描按索引的顺序读取时排序算子仍然可以不排序
+  const bool scan_input = single_node != nullptr && root == scan_output;
+  if (selects.distinct)
+  {
+    int64_t expected = 0;
+    if (root == single_node)
+    {
+      std::vector<const char *> field_names;
+      for (const TupleField &field : single_node->schema().fields())
+      {
+        field_names.push_back(field.field_name());
+      }
+      expected = estimate_distinct(single_node->table(), field_names);
+    }
+    root = new DistinctExeNode(root, expected, memory);
+  }
+
+  // limit和offset都不小于0，至少要读取limit + offset行
+  const int fetch = selects.limit > INT_MAX - selects.offset ? INT_MAX : selects.limit + selects.offset;
+  if (selects.order_num > 0 && !order_satisfied)
+  {
+    SortExeNode *sort = new SortExeNode(root, selects.order_attrs, selects.order_num, selects.has_limit ? fetch : -1,
+                                        memory);
+    if (scan_input)
+    {
+      plan_index_order(single_node, selects, sort);
+    }
+    else if (group_ordered)
+    {
+      sort->set_ordered_input(single_node);
+    }
+    root = sort;
+  }
+  else if (selects.has_limit && scan_input)
+  {
+    // 单表并且没有聚合时所有过滤条件都在扫描中判断，扫描读够行数就可以结束
+    single_node->set_limit(fetch);
+  }
+  if (selects.has_limit)
+  {
+    root = new LimitExeNode(root, selects.limit, selects.offset);
+  }
+  return root;
+}
+
+static RC build_select_plan(Trx *trx, const char *db, const Selects &selects, const JoinPlan &join_plan,
+                            MemoryTracker *memory, std::list<Subquery> &subqueries, ExecutionNode *&root);
+
+/**
+ * 字段的表名不是子查询from中的表时引用的是外层的表
+ */
+static bool is_outer_attr(const Selects &sub_select, const RelAttr &attr)
+{
+  if (attr.relation_name == nullptr)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < sub_select.relation_num; i++)
+  {
+    if (0 == strcmp(attr.relation_name, sub_select.relations[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * 把批次中一个不是null的值追加到子查询结果的key中
+ */
+static void append_batch_key(const TupleBatch &batch, int column, int row, std::string &key)
+{
+  const AttrType type = batch.schema().field(column).type();
+  if (CHARS == type)
+  {
+    const char *value = batch.chars_value(column, row);
+    subquery_key_append(key, type, value, strlen(value));
+  }
+  else if (FLOATS == type)
+  {
+    subquery_key_append(key, type, (const char *)(batch.float_values(column) + row), sizeof(float));
+  }
+  else
+  {
+    subquery_key_append(key, type, (const char *)(batch.int_values(column) + row), sizeof(int));
+  }
+}
+
+/**
+ * 把一批子查询的结果放进hash表。value_column是in的列，exists时小于0
+ */
+static void add_subquery_keys(const TupleBatch &batch, int value_column, const std::vector<int> &correlated_columns,
+                              SubqueryResult &result)
+{
+  for (int row = 0; row < batch.size(); row++)
+  {
+    std::string group;
+    bool group_null = false;
+    for (size_t k = 0; k < correlated_columns.size() && !group_null; k++)
+    {
+      group_null = batch.nulls(correlated_columns[k])[row] != 0;
+      if (!group_null)
+      {
+        append_batch_key(batch, correlated_columns[k], row, group);
+      }
+    }
+    if (group_null)
+    {
+      // 关联字段是null的行不满足关联条件
+      continue;
+    }
+    result.groups.insert(group);
+    if (value_column < 0)
+    {
+      continue;
+    }
+    if (batch.nulls(value_column)[row] != 0)
+    {
+      result.null_groups.insert(group);
+      continue;
+    }
+    std::string key = group;
+    append_batch_key(batch, value_column, row, key);
+    result.keys.insert(key);
+  }
+}
+
+/**
+ * 执行一次子查询，把结果放进hash表，外层的每一行在hash表中查找，相当于hash semi join，不用对每一行执行一次子查询。
+ * 关联子查询中子查询的字段和外层的字段相等的条件从子查询中去掉，改成输出子查询一边的字段，结果按照这些字段的值分组
+ */
+static RC evaluate_subquery(Trx *trx, const char *db, const Selects &selects, const Condition &condition,
+                            MemoryTracker *memory, std::list<Subquery> &subqueries, Subquery &subquery)
+{
+  const Selects &sub_select = *condition.sub_select;
+  subquery.condition = &condition;
+
+  // 浅拷贝，只改写列和条件，不释放其中的内存
+  Selects inner = sub_select;
+  inner.condition_num = 0;
+  for (size_t i = 0; i < sub_select.condition_num; i++)
+  {
+    const Condition &sub_condition = sub_select.conditions[i];
+    const bool left_outer = sub_condition.left_is_attr == 1 && is_outer_attr(sub_select, sub_condition.left_attr);
+    const bool right_outer = sub_condition.right_is_attr == 1 && is_outer_attr(sub_select, sub_condition.right_attr);
+    if (!left_outer && !right_outer)
+    {
+      inner.conditions[inner.condition_num++] = sub_condition;
+      continue;
+    }
+    if (sub_condition.comp != EQUAL_TO || sub_condition.left_is_attr != 1 || sub_condition.right_is_attr != 1 ||
+        (left_outer && right_outer))
+    {
+      LOG_WARN("Correlated sub query only supports equality between its own column and an outer column");
+      return RC::SQL_SYNTAX;
+    }
+    subquery.outer_attrs.push_back(left_outer ? &sub_condition.left_attr : &sub_condition.right_attr);
+    subquery.inner_attrs.push_back(left_outer ? &sub_condition.right_attr : &sub_condition.left_attr);
+  }
+
+  // 外层的字段都要在同一张表中，子查询的条件在扫描这张表时判断
+  std::vector<const RelAttr *> outer_attrs = subquery.outer_attrs;
+  if (condition.left_is_attr == 1)
+  {
+    outer_attrs.push_back(&condition.left_attr);
+  }
+  for (const RelAttr *attr : outer_attrs)
+  {
+    const char *table_name = attr->relation_name != nullptr ? attr->relation_name : selects.relations[0];
+    if (!std::any_of(selects.relations, selects.relations + selects.relation_num,
+                     [table_name](const char *name) { return 0 == strcmp(name, table_name); }))
+    {
+      LOG_WARN("Table [%s] referenced by sub query not in from", table_name);
+      return RC::SCHEMA_TABLE_NOT_EXIST;
+    }
+    if (subquery.outer_table != nullptr && 0 != strcmp(subquery.outer_table, table_name))
+    {
+      LOG_WARN("Sub query can only reference columns of one outer table");
+      return RC::SQL_SYNTAX;
+    }
+    subquery.outer_table = table_name;
+  }
+
+  const bool is_in = condition.comp == IN_SUBQUERY || condition.comp == NOT_IN_SUBQUERY;
+  if (is_in && (sub_select.attr_num != 1 || 0 == strcmp(sub_select.attributes[0].attribute_name, "*")))
+  {
+    LOG_WARN("Sub query of in must select exactly one column");
+    return RC::SQL_SYNTAX;
+  }
+  if (!subquery.inner_attrs.empty())
+  {
+    const bool has_function = std::any_of(sub_select.attributes, sub_select.attributes + sub_select.attr_num,
+                                          [](const RelAttr &attr) { return attr.window_function_name != nullptr; });
+    if (has_function || sub_select.group_num > 0 || subquery.inner_attrs.size() + is_in > MAX_NUM)
+    {
+      LOG_WARN("Aggregation in correlated sub query is not supported");
+      return RC::SQL_SYNTAX;
+    }
+    // 先输出in的列，再输出关联字段，attributes和select中的顺序相反
+    inner.attr_num = 0;
+    for (int i = subquery.inner_attrs.size() - 1; i >= 0; i--)
+    {
+      inner.attributes[inner.attr_num++] = *subquery.inner_attrs[i];
+    }
+    if (is_in)
+    {
+      inner.attributes[inner.attr_num++] = sub_select.attributes[0];
+    }
+  }
+  else if (!is_in)
+  {
+    // 不关联的exists只要知道有没有结果
+    inner.has_limit = 1;
+    inner.limit = 1;
+    inner.offset = 0;
+  }
+
+  JoinPlan join_plan;
+  RC rc = plan_join(inner, db, join_plan);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  ExecutionNode *root = nullptr;
+  rc = build_select_plan(trx, db, inner, join_plan, memory, subqueries, root);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  // 子查询的schema中相同的字段只有一列，关联子查询按照名字找到每个字段的位置，不关联的in只有一列。
+  // 聚合的schema在open之后才有
+  rc = root->open();
+  const TupleSchema &schema = root->schema();
+  int value_column = is_in ? 0 : -1;
+  std::vector<int> correlated_columns;
+  for (const RelAttr *attr : subquery.inner_attrs)
+  {
+    correlated_columns.push_back(attr->relation_name != nullptr
+                                     ? schema.index_of_field(attr->relation_name, attr->attribute_name)
+                                     : schema.index_of_field(attr->attribute_name));
+  }
+  if (is_in && !subquery.inner_attrs.empty())
+  {
+    const RelAttr &attr = sub_select.attributes[0];
+    if (attr.expr != nullptr)
+    {
+      // 表达式的列名是它的文本
+      value_column = schema.index_of_field(expr_to_string(attr.expr).c_str());
+    }
+    else
+    {
+      value_column = attr.relation_name != nullptr ? schema.index_of_field(attr.relation_name, attr.attribute_name)
+                                                   : schema.index_of_field(attr.attribute_name);
+    }
+  }
+  std::vector<int> columns = correlated_columns;
+  if (is_in)
+  {
+    columns.push_back(value_column);
+  }
+  if (rc == RC::SUCCESS && std::any_of(columns.begin(), columns.end(), [](int column) { return column < 0; }))
+  {
+    LOG_WARN("Failed to find the columns of sub query");
+    rc = RC::SCHEMA_FIELD_MISSING;
+  }
+  if (rc == RC::SUCCESS)
+  {
+    subquery.result.value_type = is_in ? schema.field(value_column).type() : UNDEFINED;
+    for (int column : correlated_columns)
+    {
+      subquery.result.correlated_types.push_back(schema.field(column).type());
+    }
+
+    TupleBatch batch;
+    batch.init(schema, columns);
+    Tuple tuple;
+    while ((rc = root->next(tuple)) == RC::SUCCESS)
+    {
+      batch.add_tuple(tuple);
+      if (batch.full())
+      {
+        add_subquery_keys(batch, value_column, correlated_columns, subquery.result);
+        batch.clear();
+      }
+    }
+    add_subquery_keys(batch, value_column, correlated_columns, subquery.result);
+  }
+  root->close();
+  delete root;
+  return rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+}
+
+/**
+ * 检查select语句并生成执行计划。where中的子查询在这里各执行一次，结果保存在subqueries中，
+ * 执行计划用完之前不能释放subqueries
+ */
+static RC build_select_plan(Trx *trx, const char *db, const Selects &selects, const JoinPlan &join_plan,
+                            MemoryTracker *memory, std::list<Subquery> &subqueries, ExecutionNode *&root)
+{
+  // 这里先检查Select语句的合法性
+  RC rc = check_table_name(selects, db);
+  if (rc == RC::SUCCESS)
+  {
+    rc = check_expressions(selects, db);
+  }
+  if (rc == RC::SUCCESS)
+  {
+    rc = check_group_by(selects);
+  }
+  if (rc == RC::SUCCESS)
+  {
+    rc = check_window(selects);
+  }
+  if (rc == RC::SUCCESS)
+  {
+    rc = check_limit(selects);
+  }
+  for (size_t i = 0; i < selects.condition_num && rc == RC::SUCCESS; i++)
+  {
+    if (selects.conditions[i].sub_select != nullptr)
+    {
+      subqueries.emplace_back();
+      rc = evaluate_subquery(trx, db, selects, selects.conditions[i], memory, subqueries, subqueries.back());
+    }
+  }
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  std::vector<SelectExeNode *> select_nodes;
+
+  for (size_t i = 0; i < selects.relation_num; i++)
+  {
+    // 遍历所有表
+    const char *table_name = selects.relations[i];
+
+    SelectExeNode *select_node = new SelectExeNode;
+    rc = create_selection_executor(trx, selects, db, table_name, subqueries, *select_node);
+    if (rc != RC::SUCCESS)
+    {
+      delete select_node;
+      for (SelectExeNode *&tmp_node : select_nodes)
+      {
+        delete tmp_node;
+      }
+      return rc;
+    }
+    select_nodes.push_back(select_node);
+  }
+
+  if (select_nodes.empty())
+  {
+    LOG_ERROR("No table given");
+    return RC::SQL_SYNTAX;
+  }
+
+  root = build_execution_plan(selects, db, select_nodes, join_plan, memory);
+  return RC::SUCCESS;
+}
+
+/**
+ * 按照连接的协议输出select的结果，文本协议和TupleSet::print的格式相同，二进制协议按帧编码。
+ * 结果一边生成一边发送，满RESPONSE_CHUNK_SIZE之后先发送一块，内存中只保留一块结果
+ */
+class SelectResultWriter
+{
+public:
+  explicit SelectResultWriter(SessionEvent *session_event)
+      : session_event_(session_event), binary_(session_event->binary_protocol())
+  {
+    if (!binary_)
+    {
+      text_.reserve(RESPONSE_CHUNK_SIZE + 4096);
+    }
+  }
+
+  void write_schema(const TupleSchema &schema, bool multi_table)
+  {
+    if (binary_)
+    {
+      schema.encode(frames_, multi_table);
+    }
+    else
+    {
+      std::stringstream ss;
+      schema.print(ss, multi_table);
+      text_.append(ss.str());
+    }
+  }
+
+  /**
+   * 客户端接收得慢时发送会等待，发送失败返回false
+   */
+  bool write_tuple(const Tuple &tuple)
+  {
+    if (!binary_)
+    {
+      TupleSet::append_tuple(text_, tuple);
+      return text_.size() < RESPONSE_CHUNK_SIZE || flush();
+    }
+
+    if (row_num_ == 0)
+    {
+      rows_frame_ = wire_frame_begin(frames_, WIRE_FRAME_ROWS);
+      wire_put_u32(frames_, 0);
+    }
+    TupleSet::encode_tuple(frames_, tuple);
+    row_num_++;
+    return frames_.size() < RESPONSE_CHUNK_SIZE || flush();
+  }
+
+  bool flush()
+  {
+    if (!binary_)
+    {
+      const bool ret = session_event_->append_response(text_.data(), text_.size());
+      text_.clear();
+      return ret;
+    }
+
+    if (row_num_ > 0)
+    {
+      wire_set_u32(frames_, rows_frame_ + WIRE_FRAME_HEADER_SIZE, row_num_);
+      wire_frame_end(frames_, rows_frame_);
+      row_num_ = 0;
+    }
+    const bool ret = session_event_->append_response(frames_.data(), frames_.size());
+    frames_.clear();
+    return ret;
+  }
+
+private:
+  SessionEvent *session_event_;
+  bool binary_;
+  std::string text_;  // 文本协议的结果，到RESPONSE_CHUNK_SIZE时发送
+  std::string frames_;
+  size_t rows_frame_ = 0;  // 当前WIRE_FRAME_ROWS帧的位置
+  uint32_t row_num_ = 0;   // 当前帧中的行数
+};
+
+/**
+ * DECLARE CURSOR打开的游标。执行计划中的条件和子查询的结果引用声明的语句，语句和计划一起保存。
+ * 自动提交时游标有自己的只读事务，读视图保留到结果取完或者游标关闭，这期间session的其它语句照常提交；
+ * 在多语句事务中声明的游标使用session的事务，能看到事务自己的修改，事务结束之前关闭
+ */
+class SelectCursor : public Cursor
+{
+public:
+  SelectCursor(Trx *trx, bool own_trx) : trx_(trx), own_trx_(own_trx)
+  {
+  }
+  ~SelectCursor() override
+  {
+    release();
+  }
+
+  bool uses_session_trx() const override
+  {
+    return !own_trx_;
+  }
+
+  /**
+   * 生成并打开执行计划，成功之后接管query
+   */
+  RC open(Query *query, const char *db, const JoinPlan &join_plan)
+  {
+    const Selects &selects = query->sstr.selection;
+    RC rc = build_select_plan(trx_, db, selects, join_plan, &memory_, subqueries_, root_);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+    pin_tables(root_);
+    rc = root_->open();
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+    schema_ = root_->schema();
+    multi_table_ = selects.relation_num > 1;
+    query_ = query;
+    return RC::SUCCESS;
+  }
+
+  /**
+   * 接着取出最多row_num行写到writer中，每次都带着表头。取完之后马上释放执行计划，再取时只有表头
+   */
+  RC fetch(int row_num, SelectResultWriter &writer, long *rows)
+  {
+    writer.write_schema(schema_, multi_table_);
+    RC rc = RC::SUCCESS;
+    Tuple tuple;
+    while (root_ != nullptr && *rows < row_num && (rc = root_->next(tuple)) == RC::SUCCESS)
+    {
+      if (!writer.write_tuple(tuple))
+      {
+        return RC::IOERR_WRITE;
+      }
+      (*rows)++;
+    }
+    if (rc == RC::RECORD_EOF)
+    {
+      release();
+      rc = RC::SUCCESS;
+    }
+    return rc;
+  }
+
+private:
+  void pin_tables(ExecutionNode *node)
+  {
+    SelectExeNode *scan = dynamic_cast<SelectExeNode *>(node);
+    if (scan != nullptr)
+    {
+      pin_table(scan->table());
+    }
+    std::vector<ExecutionNode *> children;
+    node->children(children);
+    for (ExecutionNode *child : children)
+    {
+      pin_tables(child);
+    }
+  }
+
+  /**
+   * 关闭执行计划，放开扫描的表、查询内存和读视图
+   */
+  void release()
+  {
+    if (root_ != nullptr)
+    {
+      root_->close();
+      delete root_;
+      root_ = nullptr;
+    }
+    subqueries_.clear();
+    unpin_tables();
+    if (own_trx_ && trx_ != nullptr)
+    {
+      // 只读的事务，销毁时回滚只是放开读视图
+      delete trx_;
+      trx_ = nullptr;
+    }
+    if (query_ != nullptr)
+    {
+      query_destroy(query_);
+      query_ = nullptr;
+    }
+  }
+
+private:
+  Trx *trx_;
+  bool own_trx_;
+  Query *query_ = nullptr;
+  MemoryTracker memory_;  // 所有的算子共用一个内存限制
+  std::list<Subquery> subqueries_;
+  ExecutionNode *root_ = nullptr;
+  TupleSchema schema_;
+  bool multi_table_ = false;
+};
+
+#define SELECT_OUTFILE_BUFFER_SIZE (1024 * 1024) // select into outfile攒够这么多数据才写一次文件
+
+/**
+ * select ... into outfile把结果写到服务器上的文件中，一行一条记录，字段之间用'|'分隔，和load data的格式相同。
+ * 结果不经过网络也不在会话中缓存，攒满SELECT_OUTFILE_BUFFER_SIZE之后顺序地写一次文件。已经存在的文件不覆盖
+ */
+class SelectOutfileWriter
+{
+public:
+  ~SelectOutfileWriter()
+  {
+    if (fd_ >= 0)
+    {
+      ::close(fd_);
+    }
+  }
+
+  RC open(const char *file_name)
+  {
+    fd_ = ::open(file_name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+    {
+      LOG_WARN("Failed to create outfile %s. error=%s", file_name, strerror(errno));
+      return RC::IOERR_ACCESS;
+    }
+    file_name_ = file_name;
+    buffer_.reserve(SELECT_OUTFILE_BUFFER_SIZE + 4096);
+    return RC::SUCCESS;
+  }
+
+  RC write_tuple(const Tuple &tuple)
+  {
+    const int size = tuple.size();
+    for (int i = 0; i < size; i++)
+    {
+      if (i > 0)
+      {
+        buffer_.push_back('|');
+      }
+      tuple.append_value(buffer_, i);
+    }
+    buffer_.push_back('\n');
+    return buffer_.size() < SELECT_OUTFILE_BUFFER_SIZE ? RC::SUCCESS : flush();
+  }
+
+  /**
+   * 写完剩下的数据并关闭文件。失败时删除写了一部分的文件
+   */
+  RC close(bool success)
+  {
+    RC rc = success ? flush() : RC::SUCCESS;
+    if (::close(fd_) != 0 && rc == RC::SUCCESS)
+    {
+      rc = RC::IOERR_CLOSE;
+    }
+    fd_ = -1;
+    if (!success || rc != RC::SUCCESS)
+    {
+      ::unlink(file_name_.c_str());
+    }
+    return rc;
+  }
+
+private:
+  RC flush()
+  {
+    const char *p = buffer_.data();
+    size_t size = buffer_.size();
+    while (size > 0)
+    {
+      ssize_t n = ::write(fd_, p, size);
+      if (n < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        LOG_WARN("Failed to write outfile %s. error=%s", file_name_.c_str(), strerror(errno));
+        return RC::IOERR_WRITE;
+      }
+      p += n;
+      size -= n;
+    }
+    buffer_.clear();
+    return RC::SUCCESS;
+  }
+
+private:
+  int fd_ = -1;
+  std::string file_name_;
+  std::string buffer_;
+};
+
+/**
+ * EXPLAIN只输出执行计划，不执行。EXPLAIN ANALYZE执行查询并丢弃结果，在每个算子后面输出实际的行数、耗时、
+ * 访问的页面和申请的内存。子查询在生成执行计划时已经执行，不在输出中
+ */
+static RC explain_select(ExecutionNode *root, bool analyze, MemoryTracker *memory, std::string &result)
+{
+  RC rc = RC::SUCCESS;
+  if (analyze)
+  {
+    root->enable_profile(memory);
+    rc = root->open();
+    Tuple tuple;
+    while (rc == RC::SUCCESS)
+    {
+      rc = root->next(tuple);
+    }
+    root->close();
+    if (rc != RC::RECORD_EOF)
+    {
+      return rc;
+    }
+  }
+
+  std::stringstream ss;
+  ss << "Query Plan" << std::endl;
+  root->explain_tree(ss, analyze);
+  if (analyze)
+  {
+    ss << "Peak memory: " << memory->peak() << "B" << std::endl;
+  }
+  result = ss.str();
+  return RC::SUCCESS;
+}
+
+/**
+ * 重查询需要准入控制允许后才执行。返回true时立即执行；返回false时event进入了等待队列，
+ * 或者因为队列已满、等待超时返回了失败
+ */
+bool ExecuteStage::admit_select(ExecutionPlanEvent *exe_event, const char *db)
+{
+  AdmissionControl &admission = AdmissionControl::instance();
+  SessionEvent *session_event = exe_event->sql_event()->session_event();
+  switch (exe_event->admission_state())
+  {
+  case ExecutionPlanEvent::AdmissionState::ADMITTED:
+    return true;
+  case ExecutionPlanEvent::AdmissionState::TIMEOUT:
+    LOG_WARN("Heavy query waited too long for admission. sql=%s", session_event->get_request_buf());
+    session_event->set_response("FAILURE\n");
+    exe_event->done_immediate();
+    return false;
+  default:
+    break;
+  }
+
+  const Selects &selects = exe_event->sqls()->sstr.selection;
+  if (!admission.enabled() || selects.explain == EXPLAIN_PLAN ||
+      !admission.heavy(estimate_select_cost(selects, db, exe_event->join_plan())))
+  {
+    // 没有重查询结束时等待的查询也要能超时
+    admission.expire();
+    return true;
+  }
+
+  // 进入等待队列之后event随时可能被其它线程拿走
+  QueryTrace &trace = session_event->query_trace();
+  trace.enter_stage("admission");
+  trace.suspend();
+  switch (admission.admit(exe_event, this))
+  {
+  case AdmissionResult::RUN:
+    trace.resume();
+    trace.enter_stage("execute");
+    exe_event->set_admission_state(ExecutionPlanEvent::AdmissionState::ADMITTED);
+    return true;
+  case AdmissionResult::QUEUED:
+    return false;
+  case AdmissionResult::REJECTED:
+  default:
+    trace.resume();
+    LOG_WARN("Too many heavy queries waiting for admission. sql=%s", session_event->get_request_buf());
+    session_event->set_response("FAILURE\n");
+    exe_event->done_immediate();
+    return false;
+  }
+}
+
+/**
+ * 表在查询中是不是用索引访问的：有可以用索引查找的单表条件，或者是索引嵌套循环join的内表。
+ * 和estimate_select_cost判断的条件一致
+ */
+static bool accessed_by_index(const Selects &selects, const JoinPlan &plan, size_t relation, Table *table)
+{
+  for (const JoinStep &step : plan.steps)
+  {
+    if (step.relation == (int)relation && step.method == JoinMethod::INDEX_NESTED_LOOP)
+    {
+      return true;
+    }
+  }
+
+  const char *table_name = selects.relation_num == 1 ? nullptr : selects.relations[relation];
+  for (size_t i = 0; i < selects.condition_num; i++)
+  {
+    const Condition &condition = selects.conditions[i];
+    const bool left_field = condition.left_is_attr && !condition.right_is_attr;
+    const bool right_field = condition.right_is_attr && !condition.left_is_attr;
+    const bool like_prefix = condition.comp == LIKE_OP && left_field && like_pattern_has_prefix(condition.right_value);
+    if ((!left_field && !right_field) || ((condition.comp > GREAT_THAN || condition.comp == NOT_EQUAL) && !like_prefix))
+    {
+      continue;
+    }
+    const RelAttr &attr = left_field ? condition.left_attr : condition.right_attr;
+    if (attr.relation_name != nullptr && table_name != nullptr && 0 != strcmp(attr.relation_name, table_name))
+    {
+      continue;
+    }
+    if (table->find_index_for_lookup(attr.attribute_name) != nullptr)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * 要全表扫描的表中不在缓冲池里的页面足够多时，交给PageLoader异步加载，当前线程去处理其它请求，
+ * 加载完成之后event重新加回这个stage执行。返回true表示event已经交出去了
+ */
+bool ExecuteStage::load_select_pages(ExecutionPlanEvent *exe_event, const char *db)
+{
+  PageLoader &loader = PageLoader::instance();
+  const Selects &selects = exe_event->sqls()->sstr.selection;
+  if (!loader.enabled() || exe_event->pages_loaded() || selects.explain == EXPLAIN_PLAN)
+  {
+    return false;
+  }
+
+  std::vector<PageLoadFile> files;
+  int missing = 0;
+  for (size_t i = 0; i < selects.relation_num && missing < PAGE_LOAD_MAX_PAGES; i++)
+  {
+    Table *table = DefaultHandler::get_default().find_table(db, selects.relations[i]);
+    if (table == nullptr || accessed_by_index(selects, exe_event->join_plan(), i, table))
+    {
+      continue;
+    }
+    const size_t old_size = files.size();
+    if (table->missing_pages(PAGE_LOAD_MAX_PAGES - missing, files) != RC::SUCCESS)
+    {
+      files.resize(old_size);
+      continue;
+    }
+    for (size_t j = old_size; j < files.size(); j++)
+    {
+      missing += files[j].pages.size();
+    }
+  }
+  if (missing < PAGE_LOAD_MIN_PAGES)
+  {
+    return false;
+  }
+
+  // 提交之后event随时可能被加载线程加回stage
+  exe_event->set_pages_loaded();
+  QueryTrace &trace = exe_event->sql_event()->session_event()->query_trace();
+  trace.enter_stage("load_pages");
+  trace.suspend();
+  LOG_DEBUG("Load %d page(s) asynchronously before executing select", missing);
+  loader.submit(std::move(files), [exe_event, this]() { add_event(exe_event); });
+  return true;
+}
+
+void ExecuteStage::handle_select(ExecutionPlanEvent *exe_event, const char *current_db)
+{
+  if (!admit_select(exe_event, current_db) || load_select_pages(exe_event, current_db))
+  {
+    return;
+  }
+
+  Query *sql = exe_event->sqls();
+  SQLStageEvent *sql_event = exe_event->sql_event();
+  std::string &query_cache_key = sql_event->query_cache_key();
+  // 查询之前记录表的版本，查询期间表被修改的话缓存的结果会被当成过期的。explain的结果每次都不同，不缓存。
+  // 备库重放日志不经过表的版本，不能缓存
+  if (!query_cache_key.empty() && (Trx::replica() || sql->sstr.selection.explain != EXPLAIN_NONE || sql->sstr.selection.outfile != nullptr ||
+      !record_table_versions(current_db, sql->sstr.selection, sql_event->table_versions())))
+  {
+    query_cache_key.clear();
+  }
+  RC rc = sql->sstr.selection.cursor != nullptr ? declare_cursor(exe_event, current_db)
+                                                : do_select(current_db, sql, sql_event->session_event(), exe_event->join_plan());
+  if (rc != RC::SUCCESS)
+  {
+    query_cache_key.clear();
+  }
+  if (rc == RC::INTERRUPT)
+  {
+    QueryCancel *cancel = QueryCancel::current();
+    LOG_WARN("Select is cancelled: %s",
+        cancel != nullptr ? QueryCancel::reason_name(cancel->reason()) : "unknown");
+  }
+  if (exe_event->admission_state() == ExecutionPlanEvent::AdmissionState::ADMITTED)
+  {
+    AdmissionControl::instance().release();
+  }
+  exe_event->done_immediate();
+}
+
+// 这里没有对输入的某些信息做合法性校验，比如查询的列名、where条件中的列名等，没有做必要的合法性校验
+// 需要补充上这一部分. 校验部分也可以放在resolve，不过跟execution放一起也没有关系
+RC ExecuteStage::do_select(const char *db, Query *sql, SessionEvent *session_event, const JoinPlan &join_plan)
+{
+  Session *session = session_event->get_client()->session;
+  Trx *trx = session->current_trx();
+  const Selects &selects = sql->sstr.selection;
+
+  // 子查询的结果被扫描的过滤条件引用，要比执行计划活得长。所有的算子共用一个内存限制
+  MemoryTracker memory;
+  std::list<Subquery> subqueries;
+  ExecutionNode *root = nullptr;
+  RC rc = build_select_plan(trx, db, selects, join_plan, &memory, subqueries, root);
+  if (rc != RC::SUCCESS)
+  {
+    session_event->set_response("FAILURE\n");
+    end_trx_if_need(session, trx, false);
+    return rc;
+  }
+
+  if (selects.explain != EXPLAIN_NONE && selects.outfile != nullptr)
+  {
+    LOG_WARN("Cannot explain select into outfile");
+    delete root;
+    session_event->set_response("FAILURE\n");
+    end_trx_if_need(session, trx, false);
+    return RC::INVALID_ARGUMENT;
+  }
+  if (selects.explain != EXPLAIN_NONE)
+  {
+    std::string result;
+    rc = explain_select(root, selects.explain == EXPLAIN_ANALYZE, &memory, result);
+    delete root;
+    if (rc != RC::SUCCESS)
+    {
+      LOG_WARN("Failed to explain select. rc=%d:%s", rc, strrc(rc));
+      session_event->set_response("FAILURE\n");
+      end_trx_if_need(session, trx, false);
+      return rc;
+    }
+    session_event->set_response(std::move(result));
+    end_trx_if_need(session, trx, true);
+    return RC::SUCCESS;
+  }
+
+  if (selects.outfile != nullptr)
+  {
+    return select_into_outfile(root, selects.outfile, session_event, trx);
+  }
 
-        session_event->set_response("FAILURE\n");
-        end_trx_if_need(session, trx, true);
-        return RC::GENERIC_ERROR;
+  // 结果一边从执行计划中拉取一边输出，只有排序、聚合和join的内表需要缓存数据
+  SelectResultWriter writer(session_event);
+  rc = root->open();
+  if (rc == RC::SUCCESS && !root->schema().empty())
+  {
+    writer.write_schema(root->schema(), selects.relation_num > 1);
+    Tuple tuple;
+    long rows = 0;
+    while ((rc = root->next(tuple)) == RC::SUCCESS)
+    {
+      if (!writer.write_tuple(tuple))
+      {
+        rc = RC::IOERR_WRITE;
+        break;
       }
-      order_info->add(attr.attribute_name, index, attr.is_desc == 1);
+      rows++;
     }
-
-    quick_sort(&result, 0, result.size() - 1, order_info);
+    session_event->query_trace().add_rows_sent(rows);
+  }
+  root->close();
+  delete root;
+  if (memory.peak() > 0)
+  {
+    LOG_DEBUG("Select used at most %lu bytes of query memory, limit=%lu", memory.peak(), memory.limit());
   }
 
-  result.print(ss, isMultiTable);
-
-  for (SelectExeNode *&tmp_node : select_nodes)
+  if (rc != RC::SUCCESS && rc != RC::RECORD_EOF)
   {
-    delete tmp_node;
+    LOG_WARN("Failed to execute select. rc=%d:%s", rc, strrc(rc));
+    session_event->set_response("FAILURE\n");
+    end_trx_if_need(session, trx, false);
+    return rc;
   }
 
-  session_event->set_response(ss.str());
+  writer.flush();
   end_trx_if_need(session, trx, true);
-  return rc;
+  return RC::SUCCESS;
 }
 
-bool tuple_compare(const Tuple *lhs, const Tuple *rhs, OrderInfo *order_info)
+RC ExecuteStage::select_into_outfile(ExecutionNode *root, const char *file_name, SessionEvent *session_event, Trx *trx)
 {
-  // 左在右前返回true
-  for (int i = order_info->get_size() - 1; i >= 0; --i)
+  Session *session = session_event->get_client()->session;
+  SelectOutfileWriter writer;
+  RC rc = writer.open(file_name);
+  long rows = 0;
+  if (rc == RC::SUCCESS)
   {
-    auto l_value = lhs->get_pointer(order_info->get_index(i));
-    auto r_value = rhs->get_pointer(order_info->get_index(i));
-    bool is_desc = order_info->get_is_desc(i);
-
-    if (l_value->compare(*r_value) > 0)
+    rc = root->open();
+    Tuple tuple;
+    while (rc == RC::SUCCESS && (rc = root->next(tuple)) == RC::SUCCESS)
     {
-      return !is_desc;
+      rc = writer.write_tuple(tuple);
+      rows++;
     }
-
-    if (l_value->compare(*r_value) < 0)
+    root->close();
+    const bool success = rc == RC::RECORD_EOF;
+    RC close_rc = writer.close(success);
+    if (success)
     {
-      return is_desc;
+      rc = close_rc == RC::SUCCESS ? RC::SUCCESS : close_rc;
     }
   }
+  delete root;
 
-  // 两者数据完全一样，返回true/false都可以
-  return true;
+  if (rc != RC::SUCCESS)
+  {
+    LOG_WARN("Failed to select into outfile %s. rc=%d:%s", file_name, rc, strrc(rc));
+    session_event->set_response("FAILURE\n");
+    end_trx_if_need(session, trx, false);
+    return rc;
+  }
+  LOG_INFO("Selected %ld row(s) into outfile %s", rows, file_name);
+  session_event->set_response("SUCCESS\n");
+  end_trx_if_need(session, trx, true);
+  return RC::SUCCESS;
 }
 
-int partition(TupleSet *tuple_set, int l, int r, OrderInfo *order_info)
+RC ExecuteStage::declare_cursor(ExecutionPlanEvent *exe_event, const char *db)
 {
-  auto pivot = &(tuple_set->get(r));
-  int i = l - 1;
-
-  for (int j = l; j < r; j++)
+  SessionEvent *session_event = exe_event->sql_event()->session_event();
+  Session *session = session_event->get_client()->session;
+  const Selects &selects = exe_event->sqls()->sstr.selection;
+  if (selects.outfile != nullptr || session->find_cursor(selects.cursor) != nullptr)
   {
-    if (tuple_compare(pivot, &(tuple_set->get(j)), order_info))
-    {
-      i++;
-      tuple_set->swap_tuple(i, j);
-    }
+    LOG_WARN("Cannot declare cursor %s", selects.cursor);
+    session_event->set_response("FAILURE\n");
+    return RC::INVALID_ARGUMENT;
   }
 
-  tuple_set->swap_tuple(i + 1, r);
-  return i + 1;
-}
-
-/**
- * @brief 快速排序
- *
- * @param tuple_set 表的当前结果集合
- * @param index     按第index列进行排序
- * @param is_desc   是否降序，默认升序
- * @return RC
- */
-void quick_sort(TupleSet *tuple_set, int l, int r, OrderInfo *order_info)
-{
-  if (l < r)
+  // 自动提交时session的事务在每条语句之后提交，游标需要自己的读视图
+  const bool in_trx = session->is_trx_multi_operation_mode();
+  SelectCursor *cursor = new SelectCursor(in_trx ? session->current_trx() : new Trx, !in_trx);
+  RC rc = cursor->open(exe_event->sqls(), db, exe_event->join_plan());
+  if (rc != RC::SUCCESS)
   {
-    int mid = partition(tuple_set, l, r, order_info);
-    quick_sort(tuple_set, l, mid - 1, order_info);
-    quick_sort(tuple_set, mid + 1, r, order_info);
+    LOG_WARN("Failed to declare cursor %s. rc=%d:%s", selects.cursor, rc, strrc(rc));
+    delete cursor;
+    session_event->set_response("FAILURE\n");
+    return rc;
   }
+  exe_event->release_sqls();
+  session->add_cursor(selects.cursor, cursor);
+  session_event->set_response("SUCCESS\n");
+  return RC::SUCCESS;
 }
 
-/**
- * @brief 聚合函数运算
- *
- * @param tuple_set 表的当前结果集合
- * @param attr_function 表的聚合函数信息
- * @param results 表的聚合数结果
- * @return RC
- */
-RC do_aggregation(TupleSet *tuple_set, AttrFunction *attr_function, std::vector<TupleSet> &results, int rel_num)
+RC ExecuteStage::fetch_cursor(SessionEvent *session_event, const Fetch &fetch)
 {
-  TupleSchema tmp_scheme;
-  Tuple tmp_tuple;
-
-  // 遍历所有带函数的属性
-  RC rc = RC::SUCCESS;
-  for (int j = attr_function->get_size() - 1; j >= 0; --j)
+  Session *session = session_event->get_client()->session;
+  SelectCursor *cursor = static_cast<SelectCursor *>(session->find_cursor(fetch.cursor_name));
+  if (cursor == nullptr || fetch.row_num <= 0)
   {
-    const char *table_name = attr_function->get_table_name(j);
-    const char *attr_name = attr_function->get_attr_name(j);
-    auto func_type = attr_function->get_function_type(j);
-    // 获取 func_type( 字符串
-    std::string add_scheme_name = attr_function->to_string(j, rel_num);
-
-    if (strcmp(attr_name, "*") == 0)
-    {
-      // 处理COUNT(*)
-      tmp_scheme.add_if_not_exists(AttrType::INTS, "", add_scheme_name.c_str());
-      tmp_tuple.add((int)tuple_set->tuples().size());
-      continue;
-    }
-
-    int index = -1;
-    AttrType type = AttrType::UNDEFINED;
-
-    if (table_name != nullptr)
-    {
-      index = tuple_set->get_schema().index_of_field(table_name, attr_name);
-      type = tuple_set->get_schema().field(index).type();
-    }
-    else
-    {
-      // 手动搜寻
-      const TupleSchema &schema = tuple_set->get_schema();
-      int n = schema.fields().size();
-      for (int i = 0; i < n; ++i)
-      {
-        if (strcmp(schema.field(i).field_name(), attr_name) == 0)
-        {
-          index = i;
-          type = schema.field(i).type();
-          break;
-        }
-      }
-    }
-    // const TupleField &field = tuple_set->get_schema().field(index);
-
-    if (func_type == FuncType::NOFUNC)
-    {
-      // 其实这个if应该永远不会执行
-      LOG_ERROR("未定义的聚合函数");
-      rc = RC::GENERIC_ERROR;
-      return rc;
-    }
-
-    // 增加tuple
-    AttrType add_type = AttrType::UNDEFINED;
-    switch (func_type)
-    {
-    case FuncType::COUNT:
-    {
-      // 增加Scheme
-      add_type = AttrType::INTS;
-      // tmp_tuple.add((int)tuple_set->tuples().size());
-
-      int ans = 0;
-
-      for (int tuple_i = 0; tuple_i < tuple_set->size(); ++tuple_i)
-      {
-        std::shared_ptr<TupleValue> value = tuple_set->get(tuple_i).get_pointer(index);
-        if (!value->is_null())
-        {
-          ++ans;
-        }
-      }
-      tmp_tuple.add(ans);
-      break;
-    }
-    case FuncType::AVG:
-    {
-      if (type == AttrType::CHARS || type == AttrType::DATES)
-      {
-        // CHARS和DATES不应该计算平均值
-        rc = RC::GENERIC_ERROR;
-        break;
-      }
-      add_type = AttrType::FLOATS;
-
-      int size = (int)tuple_set->tuples().size();
-      float ans = 0;
-      int cnt = 0;
-
-      if (type == AttrType::FLOATS)
-      {
-        for (int tuple_i = 0; tuple_i < tuple_set->size(); ++tuple_i)
-        {
-          std::shared_ptr<TupleValue> val = tuple_set->get(tuple_i).get_pointer(index);
-          if (val->is_null())
-          {
-            continue;
-          }
-          std::shared_ptr<FloatValue> value = std::dynamic_pointer_cast<FloatValue>(val);
-          ans += value->get_value();
-          ++cnt;
-        }
-      }
-      else if (type == AttrType::INTS)
-      {
-        for (int tuple_i = 0; tuple_i < tuple_set->size(); ++tuple_i)
-        {
-          std::shared_ptr<TupleValue> val = tuple_set->get(tuple_i).get_pointer(index);
-          if (val->is_null())
-          {
-            continue;
-          }
-          std::shared_ptr<IntValue> value = std::dynamic_pointer_cast<IntValue>(val);
-          ans += value->get_value();
-          ++cnt;
-        }
-      }
-
-      if (size = 0 || cnt == 0)
-      {
-        // TODO: 显示什么，NULL会影响吗
-        add_type = AttrType::CHARS;
-        tmp_tuple.add("NULL", 4);
-        break;
-      }
-
-      tmp_tuple.add(ans / cnt);
-
-      break;
-    }
-    case FuncType::MAX:
-    {
-      int tuple_i = 0;
-      for (; tuple_i < tuple_set->size(); ++tuple_i)
-      {
-        auto ans = tuple_set->get(tuple_i).get_pointer(index);
-        if (!ans->is_null())
-        {
-          break;
-        }
-      }
-
-      if (tuple_i == tuple_set->size())
-      {
-        // TODO: 显示什么，NULL会影响吗
-        add_type = AttrType::CHARS;
-        tmp_tuple.add("NULL", 4);
-        break;
-      }
-
-      auto ans = tuple_set->get(tuple_i).get_pointer(index);
-      for (; tuple_i < tuple_set->size(); ++tuple_i)
-      {
-
-        auto value = tuple_set->get(tuple_i).get_pointer(index);
-
-        if (value->compare(*ans) > 0)
-        {
-          ans = value;
-        }
-      }
-
-      add_type = type;
-
-      if (type == AttrType::FLOATS)
-      {
-        tmp_tuple.add(std::dynamic_pointer_cast<FloatValue>(ans)->get_value());
-      }
-      else if (type == AttrType::INTS)
-      {
-        tmp_tuple.add(std::dynamic_pointer_cast<IntValue>(ans)->get_value());
-      }
-      else // AttrType::CHARS和DATES一样计算
-      {
-        tmp_tuple.add(std::dynamic_pointer_cast<StringValue>(ans)->get_value(),
-                      std::dynamic_pointer_cast<StringValue>(ans)->get_len());
-      }
-
-      break;
-    }
-    case FuncType::MIN:
-    {
-      int tuple_i = 0;
-      for (; tuple_i < tuple_set->size(); ++tuple_i)
-      {
-        auto ans = tuple_set->get(tuple_i).get_pointer(index);
-        if (!ans->is_null())
-        {
-          break;
-        }
-      }
-
-      if (tuple_i == tuple_set->size())
-      {
-        // TODO: 显示什么，NULL会影响吗
-        add_type = AttrType::CHARS;
-        tmp_tuple.add("NULL", 4);
-        break;
-      }
-
-      auto ans = tuple_set->get(tuple_i).get_pointer(index);
-      for (; tuple_i < tuple_set->size(); ++tuple_i)
-      {
-
-        auto value = tuple_set->get(tuple_i).get_pointer(index);
-
-        if (value->compare(*ans) < 0)
-        {
-
-          ans = value;
-        }
-      }
-
-      add_type = type;
-
-      if (type == AttrType::FLOATS)
-      {
-        tmp_tuple.add(std::dynamic_pointer_cast<FloatValue>(ans)->get_value());
-      }
-      else if (type == AttrType::INTS)
-      {
-        tmp_tuple.add(std::dynamic_pointer_cast<IntValue>(ans)->get_value());
-      }
-      else // AttrType::CHARS和DATES一样计算
-      {
-        tmp_tuple.add(std::dynamic_pointer_cast<StringValue>(ans)->get_value(),
-                      std::dynamic_pointer_cast<StringValue>(ans)->get_len());
-      }
-
-      break;
-    }
-    default:
-      break;
-    }
-
-    tmp_scheme.add_if_not_exists(add_type, "", add_scheme_name.c_str());
-
-    if (rc != RC::SUCCESS)
-    {
-      return rc;
-    }
+    LOG_WARN("Cannot fetch %d row(s) from cursor %s", fetch.row_num, fetch.cursor_name);
+    session_event->set_response("FAILURE\n");
+    return RC::INVALID_ARGUMENT;
   }
-  if (tmp_tuple.size() > 0)
+
+  SelectResultWriter writer(session_event);
+  long rows = 0;
+  RC rc = cursor->fetch(fetch.row_num, writer, &rows);
+  session_event->query_trace().add_rows_sent(rows);
+  if (rc != RC::SUCCESS)
   {
-    TupleSet tmp_set;
-    tmp_set.set_schema(tmp_scheme);
-    tmp_set.add(std ::move(tmp_tuple));
-    results.push_back(std::move(tmp_set));
+    // 执行计划停在出错的地方，不能再继续
+    LOG_WARN("Failed to fetch from cursor %s, close it. rc=%d:%s", fetch.cursor_name, rc, strrc(rc));
+    session->remove_cursor(fetch.cursor_name);
+    session_event->set_response("FAILURE\n");
+    return rc;
   }
-
-  return rc;
+  writer.flush();
+  return RC::SUCCESS;
 }
 
 bool match_table(const Selects &selects, const char *table_name_in_condition, const char *table_name_to_match)
@@ -1203,6 +2942,10 @@ FuncType judge_function_type(char *window_function_name)
   {
     return FuncType::AVG;
   }
+  else if (strcmp("sum", window_function_name) == 0)
+  {
+    return FuncType::SUM;
+  }
   else if (strcmp("max", window_function_name) == 0)
   {
     return FuncType::MAX;
@@ -1211,12 +2954,17 @@ FuncType judge_function_type(char *window_function_name)
   {
     return FuncType::MIN;
   }
+  else if (strcmp("approx_count_distinct", window_function_name) == 0)
+  {
+    return FuncType::APPROX_COUNT_DISTINCT;
+  }
 
   return FuncType::NOFUNC;
 }
 
 // 把所有的表和只跟这张表关联的condition都拿出来，生成最底层的select 执行节点
-RC create_selection_executor(Trx *trx, const Selects &selects, const char *db, const char *table_name, SelectExeNode &select_node)
+RC create_selection_executor(Trx *trx, const Selects &selects, const char *db, const char *table_name,
+                             const std::list<Subquery> &subqueries, SelectExeNode &select_node)
 {
   // 列出跟这张表关联的Attr
   // 1. 找到表
@@ -1230,6 +2978,10 @@ RC create_selection_executor(Trx *trx, const Selects &selects, const char *db, c
   for (int i = selects.attr_num - 1; i >= 0; i--)
   {
     const RelAttr &attr = selects.attributes[i];
+    if (attr.window != nullptr || attr.expr != nullptr)
+    {
+      continue;
+    }
 
     // 确定该属性与这张表有关
     if (nullptr == attr.relation_name || 0 == strcmp(table_name, attr.relation_name))
@@ -1252,13 +3004,126 @@ RC create_selection_executor(Trx *trx, const Selects &selects, const char *db, c
     }
   } // for selects.attr_num
 
+  // group by的字段也要从表中读出来
+  for (size_t i = 0; i < selects.group_num && !attrIsStar; i++)
+  {
+    const RelAttr &attr = selects.group_attrs[i];
+    if (match_table(selects, attr.relation_name, table_name))
+    {
+      RC rc = schema_add_field(table, attr.attribute_name, schema);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+    }
+  }
+
+  // 窗口函数的参数和OVER中的字段也要从表中读出来
+  bool has_window = false;
+  for (int i = selects.attr_num - 1; i >= 0; i--)
+  {
+    const RelAttr &attr = selects.attributes[i];
+    if (attr.window == nullptr)
+    {
+      continue;
+    }
+    has_window = true;
+    std::vector<const RelAttr *> attrs;
+    if (0 != strcmp(attr.attribute_name, "*"))
+    {
+      attrs.push_back(&attr);
+    }
+    for (size_t j = 0; j < attr.window->partition_num + attr.window->order_num; j++)
+    {
+      attrs.push_back(&attr.window->attrs[j]);
+    }
+    for (const RelAttr *window_attr : attrs)
+    {
+      if (attrIsStar || !match_table(selects, window_attr->relation_name, table_name))
+      {
+        continue;
+      }
+      RC rc = schema_add_field(table, window_attr->attribute_name, schema);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+    }
+  }
+  if (has_window && schema.fields().empty())
+  {
+    // 只有row_number()这样不用字段的窗口函数时也要输出每一行
+    TupleSchema::from_table(table, schema);
+  }
+
+  // select中的表达式和join之后才计算的表达式条件用到的字段也要从表中读出来
+  std::vector<const RelAttr *> expr_attrs;
+  for (size_t i = 0; i < selects.attr_num; i++)
+  {
+    if (selects.attributes[i].expr != nullptr)
+    {
+      expr_collect_attrs(selects.attributes[i].expr, expr_attrs);
+    }
+  }
+  std::vector<const ExprCondition *> expr_conditions;
+  for (size_t i = 0; i < selects.expr_condition_num; i++)
+  {
+    std::vector<const RelAttr *> attrs;
+    expr_condition_collect_attrs(selects.expr_conditions[i], attrs);
+    if (!expr_condition_on_one_table(selects, attrs))
+    {
+      expr_attrs.insert(expr_attrs.end(), attrs.begin(), attrs.end());
+    }
+    else if (attrs.empty() || match_table(selects, attrs[0]->relation_name, table_name))
+    {
+      expr_conditions.push_back(&selects.expr_conditions[i]);
+    }
+  }
+  for (const RelAttr *attr : expr_attrs)
+  {
+    if (attrIsStar || !match_table(selects, attr->relation_name, table_name))
+    {
+      continue;
+    }
+    RC rc = schema_add_field(table, attr->attribute_name, schema);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+
   // 找出仅与此表相关的过滤条件, 或者都是值的过滤条件
   // 构造schema, 包括select和where中需要的列
-  std::vector<DefaultConditionFilter *> condition_filters;
+  std::vector<ConditionFilter *> condition_filters;
   for (size_t i = 0; i < selects.condition_num; i++)
   {
     const Condition &condition = selects.conditions[i];
 
+    // 子查询的条件由外层字段所在的表判断，不关联的exists每张表都判断
+    if (condition.sub_select != nullptr)
+    {
+      auto subquery = std::find_if(subqueries.begin(), subqueries.end(),
+                                   [&condition](const Subquery &subquery) { return subquery.condition == &condition; });
+      if (subquery == subqueries.end() ||
+          (subquery->outer_table != nullptr && 0 != strcmp(subquery->outer_table, table_name)))
+      {
+        continue;
+      }
+      SubqueryConditionFilter *condition_filter = new SubqueryConditionFilter();
+      RC rc = condition_filter->init(*table, condition, subquery->outer_attrs, subquery->result);
+      if (rc != RC::SUCCESS)
+      {
+        delete condition_filter;
+        for (ConditionFilter *&filter : condition_filters)
+        {
+          delete filter;
+        }
+        return rc;
+      }
+      condition_filters.push_back(condition_filter);
+      continue;
+    }
+
     // 这里其实已经做了下推，即先在单张表上进行了过滤
     if ((condition.left_is_attr == 0 && condition.right_is_attr == 0) ||                                                                         // 两边都是值
         (condition.left_is_attr == 1 && condition.right_is_attr == 0 && match_table(selects, condition.left_attr.relation_name, table_name)) ||  // 左边是属性右边是值
@@ -1271,7 +3136,7 @@ RC create_selection_executor(Trx *trx, const Selects &selects, const char *db, c
       if (rc != RC::SUCCESS)
       {
         delete condition_filter;
-        for (DefaultConditionFilter *&filter : condition_filters)
+        for (ConditionFilter *&filter : condition_filters)
         {
           delete filter;
         }
@@ -1305,6 +3170,23 @@ RC create_selection_executor(Trx *trx, const Selects &selects, const char *db, c
 
   } // for
 
+  // 只用到这张表的表达式条件放在最后，前面的条件过滤掉的记录不用计算表达式
+  for (const ExprCondition *condition : expr_conditions)
+  {
+    ExprConditionFilter *condition_filter = new ExprConditionFilter();
+    RC rc = condition_filter->init(*table, *condition);
+    if (rc != RC::SUCCESS)
+    {
+      delete condition_filter;
+      for (ConditionFilter *&filter : condition_filters)
+      {
+        delete filter;
+      }
+      return rc;
+    }
+    condition_filters.push_back(condition_filter);
+  }
+
   // 这里是为了处理 select t1.id from t1,t2; 这种情况
   if (schema.empty())
   {
@@ -25,120 +25,11 @@ See the Mulan PSL v2 for more details. */
 #include <unordered_map>
 
 class SessionEvent;
-
-class AttrFunction
-{
-public:
-  void add_function_type(const std::string &attr_name, FuncType function_type, const char *table_name)
-  {
-    
-    attr_function_type_.emplace_back(attr_name, function_type);
-    table_names_.emplace_back(table_name);
-  }
-
-  std::string to_string(int i, int rel_num)
-  {
-    FuncType type = attr_function_type_[i].second;
-    std::string attr = attr_function_type_[i].first;
-    std::string s;
-
-    switch (type)
-    {
-    case FuncType::COUNT:
-    {
-      s = std::string("count(");
-    }
-    break;
-
-    case FuncType::AVG:
-    {
-      s = std::string("avg(");
-    }
-    break;
-
-    case FuncType::MAX:
-    {
-      s = std::string("max(");
-    }
-    break;
-
-    case FuncType::MIN:
-    {
-      s = std::string("min(");
-    }
-    break;
-
-    default:
-      s = std::string("undefined(");
-      break;
-    }
-
-    if (table_names_[i] != nullptr && rel_num > 1) {
-      // 修改：只在多表的时候显示表名
-      s = s + std::string(table_names_[i]) + std::string(".");
-    }
-
-    s = s + attr + std::string(")");
-
-    return s;
-  }
-
-  FuncType get_function_type(int i)
-  {
-    return attr_function_type_[i].second;
-  }
-
-  const char *get_table_name(int i)
-  {
-    return table_names_[i];
-  }
-
-  const char *get_attr_name(int i)
-  {
-    return attr_function_type_[i].first.c_str();
-  }
-
-  int get_size()
-  {
-    return attr_function_type_.size();
-  }
-
-private:
-  std::vector<std::pair<std::string, FuncType>> attr_function_type_; // 存储<属性名，函数类型>
-  std::vector<const char *> table_names_;                            // 存储对应的table名
-};
-
-class OrderInfo
-{
-public:
-  void add(const char *attr_name, int idx, bool is_desc)
-  {
-    is_desc_.emplace_back(is_desc);
-    attr_name_.emplace_back(attr_name);
-    index_.emplace_back(idx);
-  }
-
-  int get_size()
-  {
-    return is_desc_.size();
-  }
-
-  bool get_is_desc(int i)
-  {
-    return is_desc_[i];
-  }
-
-  int get_index(int i)
-  {
-    return index_[i];
-  }
-
-private:
-  // 包含一个表的排序信息
-  std::vector<bool> is_desc_; // 默认为升序asc
-  std::vector<const char *> attr_name_;
-  std::vector<int> index_; // attr_name对应tuple里的index
-};
+struct JoinPlan;
+class StatementCpuMetric;
+class ExecutionPlanEvent;
+class ExecutionNode;
+class Trx;
 
 class ExecuteStage : public common::Stage
 {
@@ -146,6 +37,8 @@ public:
   ~ExecuteStage();
   static Stage *make_stage(const std::string &tag);
 
+  static const std::string STATEMENT_CPU_METRIC_TAG;
+
 protected:
   // common function
   ExecuteStage(const char *tag);
@@ -158,12 +51,28 @@ protected:
                       common::CallbackContext *context) override;
 
   void handle_request(common::StageEvent *event);
-  RC do_select(const char *db, Query *sql, SessionEvent *session_event);
+  void handle_select(ExecutionPlanEvent *exe_event, const char *current_db);
+  bool admit_select(ExecutionPlanEvent *exe_event, const char *db);
+  bool load_select_pages(ExecutionPlanEvent *exe_event, const char *db);
+  RC do_select(const char *db, Query *sql, SessionEvent *session_event, const JoinPlan &join_plan);
+  /**
+   * 执行root并把结果写到file_name中，见SelectOutfileWriter。root在这里释放
+   */
+  RC select_into_outfile(ExecutionNode *root, const char *file_name, SessionEvent *session_event, Trx *trx);
+  /**
+   * declare 游标名 cursor for select：打开执行计划，和语句一起挂起在session中，语句从exe_event中取走
+   */
+  RC declare_cursor(ExecutionPlanEvent *exe_event, const char *db);
+  /**
+   * fetch n from 游标名：从挂起的执行计划中接着取出最多n行
+   */
+  RC fetch_cursor(SessionEvent *session_event, const Fetch &fetch);
 
 protected:
 private:
   Stage *default_storage_stage_ = nullptr;
   Stage *mem_storage_stage_ = nullptr;
+  StatementCpuMetric *statement_cpu_metric_ = nullptr;
 };
 
 #endif //__OBSERVER_SQL_EXECUTE_STAGE_H__
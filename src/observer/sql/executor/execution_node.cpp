@@ -12,41 +12,3424 @@ See the Mulan PSL v2 for more details. */
 // Created by Wangyunlai on 2021/5/14.
 //
 
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <string_view>
+
 #include "sql/executor/execution_node.h"
 #include "storage/common/table.h"
+#include "storage/common/index.h"
+#include "storage/common/dictionary.h"
+#include "storage/default/disk_buffer_pool.h"
+#include "storage/default/spill_file.h"
 #include "common/log/log.h"
+#include "common/seda/request_trace.h"
+#include "common/time/datetime.h"
+#include "session/query_cancel.h"
+
+namespace {
+
+long now_ns() {
+  struct timespec tp;
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return tp.tv_sec * 1000000000L + tp.tv_nsec;
+}
+
+/**
+ * 打开profile时记录一次调用期间的耗时、页面访问和内存申请，计入算子的profile
+ */
+class ProfileScope {
+public:
+  ProfileScope(ExecutionProfile &profile, MemoryTracker *memory) : profile_(profile), memory_(memory) {
+    if (!profile_.enabled) {
+      return;
+    }
+    const BPThreadStat &stat = bp_thread_stat();
+    pages_hit_ = stat.hits;
+    pages_read_ = stat.misses;
+    bytes_ = memory_ != nullptr ? memory_->total() : 0;
+    begin_ns_ = now_ns();
+  }
+  ~ProfileScope() {
+    if (!profile_.enabled) {
+      return;
+    }
+    profile_.time_ns += now_ns() - begin_ns_;
+    const BPThreadStat &stat = bp_thread_stat();
+    profile_.pages_hit += stat.hits - pages_hit_;
+    profile_.pages_read += stat.misses - pages_read_;
+    if (memory_ != nullptr) {
+      profile_.bytes += memory_->total() - bytes_;
+    }
+  }
+
+private:
+  ExecutionProfile &profile_;
+  MemoryTracker *memory_;
+  long begin_ns_ = 0;
+  long pages_hit_ = 0;
+  long pages_read_ = 0;
+  size_t bytes_ = 0;
+};
+
+const char *comp_op_name(CompOp comp) {
+  switch (comp) {
+    case EQUAL_TO: return "=";
+    case LESS_EQUAL: return "<=";
+    case NOT_EQUAL: return "<>";
+    case LESS_THAN: return "<";
+    case GREAT_EQUAL: return ">=";
+    case GREAT_THAN: return ">";
+    default: return "?";
+  }
+}
+
+std::string attr_name(const RelAttr &attr) {
+  if (nullptr == attr.relation_name) {
+    return attr.attribute_name;
+  }
+  return std::string(attr.relation_name) + "." + attr.attribute_name;
+}
+
+std::string field_name(const TupleField &field) {
+  // 聚合函数和窗口函数的列没有表名
+  if (field.table_name()[0] == '\0') {
+    return field.field_name();
+  }
+  return std::string(field.table_name()) + "." + field.field_name();
+}
+
+}  // namespace
+
+RC ExecutionNode::open() {
+  ProfileScope scope(profile_, profile_memory_);
+  profile_.loops++;
+  return do_open();
+}
+
+RC ExecutionNode::next(Tuple &tuple) {
+  // join和排序的循环都通过子算子的next取数据，在这里检查就不用每个循环各自检查
+  if (QueryCancel::poll(cancel_check_)) {
+    return RC::INTERRUPT;
+  }
+  ProfileScope scope(profile_, profile_memory_);
+  RC rc = do_next(tuple);
+  if (rc == RC::SUCCESS) {
+    profile_.rows++;
+  }
+  return rc;
+}
+
+RC ExecutionNode::next_batch(TupleBatch &batch) {
+  if (QueryCancel::current_cancelled()) {
+    return RC::INTERRUPT;
+  }
+  ProfileScope scope(profile_, profile_memory_);
+  RC rc = do_next_batch(batch);
+  if (rc == RC::SUCCESS) {
+    profile_.rows += batch.size();
+  }
+  return rc;
+}
+
+RC ExecutionNode::close() {
+  ProfileScope scope(profile_, profile_memory_);
+  return do_close();
+}
+
+void ExecutionNode::enable_profile(MemoryTracker *memory) {
+  profile_ = ExecutionProfile();
+  profile_.enabled = true;
+  profile_memory_ = memory;
+  std::vector<ExecutionNode *> nodes;
+  children(nodes);
+  for (ExecutionNode *child : nodes) {
+    child->enable_profile(memory);
+  }
+}
+
+void ExecutionNode::explain_tree(std::ostream &os, bool analyze, int depth) const {
+  os << std::string(depth * 2, ' ') << (depth > 0 ? "-> " : "") << explain();
+  if (analyze && profile_.loops == 0) {
+    os << " (never executed)";
+  } else if (analyze) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), " (rows=%ld, loops=%ld, time=%.3fms, pages hit=%ld read=%ld, memory=%zuB)",
+        profile_.rows, profile_.loops, profile_.time_ns / 1000000.0, profile_.pages_hit, profile_.pages_read,
+        profile_.bytes);
+    os << buf;
+  }
+  os << '\n';
+  std::vector<ExecutionNode *> nodes;
+  children(nodes);
+  for (const ExecutionNode *child : nodes) {
+    child->explain_tree(os, analyze, depth + 1);
+  }
+}
+
+RC ExecutionNode::execute(TupleSet &tuple_set) {
+  RC rc = open();
+  if (rc != RC::SUCCESS) {
+    close();
+    return rc;
+  }
+
+  tuple_set.clear();
+  tuple_set.set_schema(schema());
+  Tuple tuple;
+  while ((rc = next(tuple)) == RC::SUCCESS) {
+    tuple_set.add(std::move(tuple));
+  }
+  close();
+  return rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+}
+
+RC ExecutionNode::do_next_batch(TupleBatch &batch) {
+  batch.clear();
+  RC rc = RC::SUCCESS;
+  Tuple tuple;
+  while (!batch.full() && (rc = do_next(tuple)) == RC::SUCCESS) {
+    batch.add_tuple(tuple);
+  }
+  if (rc != RC::SUCCESS && rc != RC::RECORD_EOF) {
+    return rc;
+  }
+  return batch.size() > 0 ? RC::SUCCESS : RC::RECORD_EOF;
+}
 
+////////////////////////////////////////////////////////////////////////////////
 SelectExeNode::SelectExeNode() : table_(nullptr) {
 }
 
 SelectExeNode::~SelectExeNode() {
-  for (DefaultConditionFilter * &filter : condition_filters_) {
+  close();
+  for (ConditionFilter * &filter : condition_filters_) {
     delete filter;
   }
   condition_filters_.clear();
 }
 
 RC
-SelectExeNode::init(Trx *trx, Table *table, TupleSchema &&tuple_schema, std::vector<DefaultConditionFilter *> &&condition_filters) {
+SelectExeNode::init(Trx *trx, Table *table, TupleSchema &&tuple_schema, std::vector<ConditionFilter *> &&condition_filters) {
   trx_ = trx;
   table_ = table;
   tuple_schema_ = tuple_schema;
   condition_filters_ = std::move(condition_filters);
+  return condition_filter_.init((const ConditionFilter **)condition_filters_.data(), condition_filters_.size());
+}
+
+void SelectExeNode::record_reader(const char *data, void *context) {
+  SelectExeNode *node = (SelectExeNode *)context;
+  node->converter_->add_record(data, &node->scanner_.current_rid());
+}
+
+RC SelectExeNode::do_open() {
+  batch_.clear();
+  batch_.set_schema(tuple_schema_);
+  batch_pos_ = 0;
+  delete converter_;
+  converter_ = new TupleRecordConverter(table_, batch_);
+  index_ordered_ = false;
+  if (!order_fields_.empty()) {
+    return scanner_.open_ordered(trx_, table_, &condition_filter_, limit_, order_fields_, descending_,
+        &index_ordered_, &converter_->field_indexes());
+  }
+  return scanner_.open(trx_, table_, &condition_filter_, limit_, &converter_->field_indexes());
+}
+
+RC SelectExeNode::do_next(Tuple &tuple) {
+  while (batch_pos_ >= batch_.size()) {
+    batch_.clear_tuples();
+    batch_pos_ = 0;
+    RC rc = scanner_.next_batch(this, record_reader);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  tuple = std::move(batch_.mutable_tuple(batch_pos_++));
   return RC::SUCCESS;
 }
 
-void record_reader(const char *data, void *context) {
-  TupleRecordConverter *converter = (TupleRecordConverter *)context;
+static void batch_record_reader(const char *data, void *context) {
+  TupleBatchConverter *converter = (TupleBatchConverter *)context;
   converter->add_record(data);
 }
 
-RC SelectExeNode::execute(TupleSet &tuple_set) {
-  CompositeConditionFilter condition_filter;
-  condition_filter.init((const ConditionFilter **)condition_filters_.data(), condition_filters_.size());
+RC SelectExeNode::do_next_batch(TupleBatch &batch) {
+  batch.clear();
+  TupleBatchConverter converter(table_, batch);
+  while (!batch.full()) {
+    RC rc = scanner_.next_batch(&converter, batch_record_reader);
+    if (rc == RC::RECORD_EOF) {
+      break;
+    }
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  return batch.size() > 0 ? RC::SUCCESS : RC::RECORD_EOF;
+}
+
+RC SelectExeNode::open_lookup(Index *index, const char *key) {
+  ProfileScope scope(profile_, profile_memory_);
+  profile_.loops++;
+  scanner_.close();
+  batch_.clear_tuples();
+  batch_.set_schema(tuple_schema_);
+  batch_pos_ = 0;
+  if (nullptr == converter_) {
+    converter_ = new TupleRecordConverter(table_, batch_);
+  }
+  index_ordered_ = false;
+  return scanner_.open_lookup(trx_, table_, &condition_filter_, index, key);
+}
+
+namespace {
 
-  tuple_set.clear();
-  tuple_set.set_schema(tuple_schema_);
-  TupleRecordConverter converter(table_, tuple_set);
+struct FirstValueContext {
+  const FieldMeta *field;
+  NullFlag null_flag;
+  bool has_rows;
+  bool found;
+  std::vector<char> *value;
+};
+
+void first_value_reader(const char *data, void *context) {
+  FirstValueContext *first = (FirstValueContext *)context;
+  first->has_rows = true;
+  if (first->found || (first->field->nullable() && first->null_flag.test(data))) {
+    return;
+  }
+  const char *value = data + first->field->offset();
+  first->value->assign(value, value + first->field->len());
+  first->found = true;
+}
+
+}  // namespace
+
+Index *SelectExeNode::order_index() const {
+  if (order_fields_.empty() || lookup_index_ != nullptr) {
+    return nullptr;
+  }
+  return TableScanner::order_index(table_, &condition_filter_, order_fields_);
+}
+
+bool SelectExeNode::first_in_index_order(const FieldMeta *field, bool descending, bool *has_rows, bool *found,
+    std::vector<char> &value) {
+  if (!unfiltered()) {
+    return false;
+  }
+  const TableMeta &table_meta = table_->table_meta();
+  const int field_index = table_meta.find_field_index_by_name(field->name());
+  FirstValueContext context{field, table_meta.null_flag(field_index), false, false, &value};
+  std::vector<int> field_indexes{field_index};
+  TableScanner scanner;
+  bool ordered = false;
+  RC rc = scanner.open_ordered(trx_, table_, nullptr, -1, std::vector<const FieldMeta *>{field}, descending, &ordered,
+      &field_indexes);
+  if (rc != RC::SUCCESS || !ordered) {
+    scanner.close();
+    return false;
+  }
+  // null值在索引中的位置不确定，要跳过
+  while (!context.found && (rc = scanner.next_batch(&context, first_value_reader)) == RC::SUCCESS) {
+  }
+  scanner.close();
+  if (rc != RC::SUCCESS && rc != RC::RECORD_EOF) {
+    return false;
+  }
+  *has_rows = context.has_rows;
+  *found = context.found;
+  return true;
+}
+
+bool SelectExeNode::parallel_scannable() {
+  return TableScanner::parallel_scannable(table_, &condition_filter_, PARALLEL_SCAN_MIN_PAGES);
+}
+
+namespace {
+
+struct ParallelScanTask {
+  Trx *trx;
+  Table *table;
+  ConditionFilter *filter;
+  const TupleSchema *schema;
+  const std::vector<int> *columns;
+  PageMorsels *morsels;
+  void (*consumer)(const TupleBatch &batch, int worker, void *context);
+  void *context;
+  int worker;
+  RC rc;
+  long rows;
+  long pages_hit;   // 线程中访问的页面，扫描结束后计入调用parallel_scan的线程
+  long pages_read;
+  common::RequestTrace *trace;  // 调用parallel_scan的请求的trace，扫描线程中的span也加到这里
+  QueryCancel *cancel;          // 调用parallel_scan的语句的取消标记
+};
+
+void *parallel_scan_routine(void *arg) {
+  ParallelScanTask *task = (ParallelScanTask *)arg;
+  common::RequestTrace *caller_trace = common::RequestTrace::current();
+  common::RequestTrace::set_current(task->trace);
+  QueryCancelScope cancel_scope(task->cancel);
+  common::TraceSpanScope span("executor", "parallel_scan_worker");
+  TupleBatch batch;
+  batch.init(*task->schema, *task->columns);
+  TupleBatchConverter converter(task->table, batch);
+  TableScanner scanner;
+  const BPThreadStat begin_stat = bp_thread_stat();
+  RC rc = scanner.open_morsels(task->trx, task->table, task->filter, task->morsels, &converter.field_indexes());
+  while (rc == RC::SUCCESS) {
+    batch.clear();
+    while (!batch.full()) {
+      rc = scanner.next_batch(&converter, batch_record_reader);
+      if (rc != RC::SUCCESS) {
+        break;
+      }
+    }
+    if (batch.size() > 0 && (rc == RC::SUCCESS || rc == RC::RECORD_EOF)) {
+      task->rows += batch.size();
+      task->consumer(batch, task->worker, task->context);
+    }
+  }
+  scanner.close();
+  task->rc = rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+  task->pages_hit = bp_thread_stat().hits - begin_stat.hits;
+  task->pages_read = bp_thread_stat().misses - begin_stat.misses;
+  common::RequestTrace::set_current(caller_trace);
+  return nullptr;
+}
+
+}  // namespace
+
+RC SelectExeNode::parallel_scan(int thread_num, const std::vector<int> &columns,
+    void (*consumer)(const TupleBatch &batch, int worker, void *context), void *context) {
+  ProfileScope scope(profile_, profile_memory_);
+  PageMorsels morsels;
+  std::vector<ParallelScanTask> tasks(thread_num);
+  for (int i = 0; i < thread_num; i++) {
+    tasks[i] = ParallelScanTask{trx_, table_, &condition_filter_, &tuple_schema_, &columns, &morsels, consumer, context,
+                                i, RC::SUCCESS, 0, 0, 0, common::RequestTrace::current(), QueryCancel::current()};
+  }
+
+  // 创建线程失败时在当前线程中扫描，其它线程没有领走的页面都由这个任务读取
+  std::vector<pthread_t> threads(thread_num);
+  std::vector<bool> started(thread_num, false);
+  for (int i = 1; i < thread_num; i++) {
+    int ret = pthread_create(&threads[i], nullptr, parallel_scan_routine, &tasks[i]);
+    if (ret != 0) {
+      LOG_WARN("Failed to create scan thread. error=%s", strerror(ret));
+      continue;
+    }
+    started[i] = true;
+  }
+  parallel_scan_routine(&tasks[0]);
+  RC rc = tasks[0].rc;
+  profile_.rows += tasks[0].rows;
+  for (int i = 1; i < thread_num; i++) {
+    if (started[i]) {
+      pthread_join(threads[i], nullptr);
+      if (rc == RC::SUCCESS) {
+        rc = tasks[i].rc;
+      }
+      // 其它线程的扫描计入当前线程，和单线程执行时的统计一致
+      profile_.rows += tasks[i].rows;
+      scanned_record_count() += tasks[i].rows;
+      bp_thread_stat().hits += tasks[i].pages_hit;
+      bp_thread_stat().misses += tasks[i].pages_read;
+    }
+  }
+  return rc;
+}
+
+RC SelectExeNode::do_close() {
+  scanner_.close();
+  batch_.clear_tuples();
+  delete converter_;
+  converter_ = nullptr;
+  return RC::SUCCESS;
+}
+
+std::string SelectExeNode::explain() const {
+  std::string s;
+  if (lookup_index_ != nullptr) {
+    s = std::string("INDEX_LOOKUP(") + table_->name() + ", index=" + lookup_index_->index_meta().name();
+  } else if (table_->partitioned()) {
+    s = std::string("PARTITION_SCAN(") + table_->name() + ", partitions=" +
+        std::to_string(TableScanner::scan_partition_num(table_, &condition_filter_));
+  } else {
+    Index *order_index = this->order_index();
+    Index *index = order_index != nullptr ? order_index : TableScanner::scan_index(table_, &condition_filter_);
+    if (index != nullptr) {
+      s = std::string("INDEX_SCAN(") + table_->name() + ", index=" + index->index_meta().name();
+      if (order_index != nullptr) {
+        s += descending_ ? ", order=DESC" : ", order=ASC";
+      } else {
+        std::vector<Index *> intersect;
+        TableScanner::intersect_indexes(table_, &condition_filter_, intersect);
+        for (size_t i = 0; i < intersect.size(); i++) {
+          s += std::string(i == 0 ? ", intersect=" : "&") + intersect[i]->index_meta().name();
+        }
+      }
+    } else {
+      s = std::string("TABLE_SCAN(") + table_->name();
+    }
+  }
+  if (!condition_filters_.empty()) {
+    s += ", filters=" + std::to_string(condition_filters_.size());
+  }
+  if (limit_ >= 0) {
+    s += ", limit=" + std::to_string(limit_);
+  }
+  return s + ")";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NestedLoopJoinExeNode::~NestedLoopJoinExeNode() {
+  delete left_;
+  delete right_;
+}
+
+RC NestedLoopJoinExeNode::do_open() {
+  RC rc = left_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  rc = right_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  schema_.clear();
+  schema_.append(left_->schema());
+  schema_.append(right_->schema());
+
+  inner_tuples_.clear();
+  Tuple tuple;
+  while ((rc = right_->next(tuple)) == RC::SUCCESS) {
+    const size_t bytes = tuple.memory_size();
+    if (memory_ != nullptr && !memory_->try_consume(bytes)) {
+      LOG_WARN("Inner side of nested loop join exceeds query memory limit %lu. tuples=%d",
+          memory_->limit(), (int)inner_tuples_.size());
+      rc = RC::NOMEM;
+      break;
+    }
+    memory_used_ += bytes;
+    inner_tuples_.emplace_back(std::move(tuple));
+  }
+  right_->close();
+  inner_pos_ = 0;
+  has_outer_ = false;
+  return rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+}
+
+RC NestedLoopJoinExeNode::do_next(Tuple &tuple) {
+  if (inner_tuples_.empty()) {
+    return RC::RECORD_EOF;
+  }
+  if (!has_outer_ || inner_pos_ >= inner_tuples_.size()) {
+    RC rc = left_->next(outer_tuple_);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+    has_outer_ = true;
+    inner_pos_ = 0;
+  }
+
+  Tuple joined;
+  joined.merge(outer_tuple_);
+  joined.merge(inner_tuples_[inner_pos_++]);
+  tuple = std::move(joined);
+  return RC::SUCCESS;
+}
+
+RC NestedLoopJoinExeNode::do_close() {
+  inner_tuples_.clear();
+  if (memory_ != nullptr) {
+    memory_->release(memory_used_);
+  }
+  memory_used_ = 0;
+  has_outer_ = false;
+  left_->close();
+  return right_->close();
+}
+
+std::string NestedLoopJoinExeNode::explain() const {
+  return "NESTED_LOOP_JOIN";
+}
+
+void NestedLoopJoinExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(left_);
+  children.push_back(right_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+IndexNestedLoopJoinExeNode::~IndexNestedLoopJoinExeNode() {
+  delete left_;
+  delete right_;
+}
+
+RC IndexNestedLoopJoinExeNode::do_open() {
+  RC rc = left_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  schema_.clear();
+  schema_.append(left_->schema());
+  schema_.append(right_->schema());
+
+  key_field_ = right_->table()->table_meta().field(index_->index_meta().field(0));
+  if (nullptr == key_field_) {
+    LOG_ERROR("No such field in table. field=%s", index_->index_meta().field(0));
+    return RC::SCHEMA_FIELD_MISSING;
+  }
+  key_.resize(key_field_->len());
+  has_outer_ = false;
+  return RC::SUCCESS;
+}
 
-  return table_->scan_record(trx_, &condition_filter, -1, (void *)&converter, record_reader);
-}
\ No newline at end of file
+bool IndexNestedLoopJoinExeNode::make_key(const Tuple &tuple) {
+  if (tuple.is_null(left_index_)) {
+    return false;
+  }
+  std::fill(key_.begin(), key_.end(), 0);
+  if (key_field_->dictionary() != nullptr) {
+    // 索引中是字典编码，不在字典中的值不可能匹配
+    const char *s = tuple.get_string(left_index_);
+    const int code = tuple.get_len(left_index_) > key_field_->value_len() ? -1 : key_field_->dictionary()->find(s);
+    if (code < 0) {
+      return false;
+    }
+    memcpy(key_.data(), &code, sizeof(code));
+    return true;
+  }
+  switch (key_field_->type()) {
+    case INTS: {
+      int v = tuple.get_int(left_index_);
+      memcpy(key_.data(), &v, sizeof(v));
+    } break;
+    case DATES: {
+      // tuple中的日期是yyyy-mm-dd格式的字符串，记录中是从1970-01-01开始的天数
+      int v = 0;
+      common::parse_date(tuple.get_string(left_index_), &v);
+      memcpy(key_.data(), &v, sizeof(v));
+    } break;
+    default: {
+      const int len = tuple.get_len(left_index_);
+      if (len > (int)key_.size()) {
+        // 比字段长的字符串不可能和字段中的值相等
+        return false;
+      }
+      memcpy(key_.data(), tuple.get_string(left_index_), len);
+    } break;
+  }
+  return true;
+}
+
+RC IndexNestedLoopJoinExeNode::do_next(Tuple &tuple) {
+  Tuple inner;
+  while (true) {
+    if (has_outer_) {
+      RC rc = right_->next(inner);
+      if (rc == RC::SUCCESS) {
+        break;
+      }
+      if (rc != RC::RECORD_EOF) {
+        return rc;
+      }
+      has_outer_ = false;
+    }
+
+    RC rc = left_->next(outer_tuple_);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+    if (!make_key(outer_tuple_)) {
+      continue;
+    }
+    rc = right_->open_lookup(index_, key_.data());
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+    has_outer_ = true;
+  }
+
+  Tuple joined;
+  joined.merge(outer_tuple_);
+  joined.merge(inner);
+  tuple = std::move(joined);
+  return RC::SUCCESS;
+}
+
+RC IndexNestedLoopJoinExeNode::do_close() {
+  has_outer_ = false;
+  left_->close();
+  return right_->close();
+}
+
+std::string IndexNestedLoopJoinExeNode::explain() const {
+  return "INDEX_NESTED_LOOP_JOIN(" + field_name(left_->schema().field(left_index_)) + "=" + right_->table()->name() +
+         "." + index_->index_meta().field(0) + ")";
+}
+
+void IndexNestedLoopJoinExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(left_);
+  children.push_back(right_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+int hash_join_threads(int parallelism) {
+  if (parallelism > 0) {
+    return parallelism;
+  }
+  return std::max(1, std::min((int)sysconf(_SC_NPROCESSORS_ONLN), PARALLEL_SCAN_MAX_THREADS));
+}
+
+/**
+ * 每个任务处理两边各一段连续的行，0是build端，1是左边
+ */
+struct RadixPartitionTask {
+  int partitions;
+  bool scatter;  // false时统计每个分区的行数，true时把行号写到分区中
+  const std::vector<std::string> *keys[2];
+  size_t begin[2];
+  size_t end[2];
+  std::vector<int> *partition_of[2];  // 每一行的分区
+  std::vector<int> *rows[2];          // 按分区排列的行号，同一个分区中按行号排序
+  std::vector<size_t> offsets[2];     // 统计时是这一段在每个分区中的行数，写入时是下一个写入的位置
+};
+
+void *radix_partition_routine(void *arg) {
+  RadixPartitionTask *task = (RadixPartitionTask *)arg;
+  for (int side = 0; side < 2; side++) {
+    const std::vector<std::string> &keys = *task->keys[side];
+    std::vector<int> &partition_of = *task->partition_of[side];
+    std::vector<size_t> &offsets = task->offsets[side];
+    if (!task->scatter) {
+      for (size_t i = task->begin[side]; i < task->end[side]; i++) {
+        const int partition = std::hash<std::string>()(keys[i]) % task->partitions;
+        partition_of[i] = partition;
+        offsets[partition]++;
+      }
+    } else {
+      std::vector<int> &rows = *task->rows[side];
+      for (size_t i = task->begin[side]; i < task->end[side]; i++) {
+        rows[offsets[partition_of[i]]++] = i;
+      }
+    }
+  }
+  return nullptr;
+}
+
+struct RadixJoinContext {
+  const std::vector<std::string> *build_keys;
+  const std::vector<std::string> *probe_keys;
+  const std::vector<int> *build_rows;
+  const std::vector<int> *probe_rows;
+  const std::vector<size_t> *build_begins;  // 每个分区在rows中的开始位置，最后一个是总行数
+  const std::vector<size_t> *probe_begins;
+  std::vector<int> *probe_heads;
+  std::vector<int> *build_chain;
+  int partitions;
+  std::atomic<int> next_partition{0};
+  common::RequestTrace *trace;
+  QueryCancel *cancel;
+};
+
+struct RadixJoinTask {
+  RadixJoinContext *context;
+  RC rc;
+};
+
+void *radix_join_routine(void *arg) {
+  RadixJoinTask *task = (RadixJoinTask *)arg;
+  RadixJoinContext &context = *task->context;
+  common::RequestTrace *caller_trace = common::RequestTrace::current();
+  common::RequestTrace::set_current(context.trace);
+  QueryCancelScope cancel_scope(context.cancel);
+  common::TraceSpanScope span("executor", "hash_join_worker");
+  const std::vector<std::string> &build_keys = *context.build_keys;
+  const std::vector<std::string> &probe_keys = *context.probe_keys;
+  std::vector<int> &build_chain = *context.build_chain;
+  std::unordered_map<std::string_view, int> heads;
+  int partition = 0;
+  while ((partition = context.next_partition++) < context.partitions) {
+    if (QueryCancel::current_cancelled()) {
+      task->rc = RC::INTERRUPT;
+      break;
+    }
+    // 倒着插入，每个key的链表按build的顺序排列，和不分区时的输出顺序一致
+    const size_t build_begin = (*context.build_begins)[partition];
+    const size_t build_end = (*context.build_begins)[partition + 1];
+    heads.clear();
+    heads.reserve(build_end - build_begin);
+    for (size_t i = build_end; i > build_begin; i--) {
+      const int row = (*context.build_rows)[i - 1];
+      auto result = heads.emplace(std::string_view(build_keys[row]), row);
+      if (!result.second) {
+        build_chain[row] = result.first->second;
+        result.first->second = row;
+      }
+    }
+    for (size_t i = (*context.probe_begins)[partition]; i < (*context.probe_begins)[partition + 1]; i++) {
+      const int row = (*context.probe_rows)[i];
+      auto iter = heads.find(std::string_view(probe_keys[row]));
+      if (iter != heads.end()) {
+        (*context.probe_heads)[row] = iter->second;
+      }
+    }
+  }
+  common::RequestTrace::set_current(caller_trace);
+  return nullptr;
+}
+
+/**
+ * 每个任务一个线程，第一个任务在当前线程执行，创建线程失败时也在当前线程执行
+ */
+template <typename Task>
+void run_tasks(std::vector<Task> &tasks, void *(*routine)(void *)) {
+  std::vector<pthread_t> threads(tasks.size());
+  std::vector<bool> started(tasks.size(), false);
+  for (size_t i = 1; i < tasks.size(); i++) {
+    int ret = pthread_create(&threads[i], nullptr, routine, &tasks[i]);
+    if (ret != 0) {
+      LOG_WARN("Failed to create hash join thread. error=%s", strerror(ret));
+      routine(&tasks[i]);
+      continue;
+    }
+    started[i] = true;
+  }
+  routine(&tasks[0]);
+  for (size_t i = 1; i < tasks.size(); i++) {
+    if (started[i]) {
+      pthread_join(threads[i], nullptr);
+    }
+  }
+}
+
+}  // namespace
+
+HashJoinExeNode::~HashJoinExeNode() {
+  close_partitions();
+  delete left_;
+  delete right_;
+}
+
+RC HashJoinExeNode::do_open() {
+  RC rc = left_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  rc = right_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  schema_.clear();
+  schema_.append(left_->schema());
+  schema_.append(right_->schema());
+
+  clear_hash_table();
+  close_partitions();
+  // 可以并行时先不建hash表，等probe端也读完之后按分区建
+  radix_ = hash_join_threads(parallelism_) > 1;
+  Tuple tuple;
+  std::string key;
+  ExecutionNode *build = build_input();
+  while ((rc = build->next(tuple)) == RC::SUCCESS) {
+    if (!make_key(tuple, true, key)) {
+      // null和任何值都不相等
+      continue;
+    }
+    rc = add_build_tuple(key, tuple);
+    if (rc != RC::SUCCESS) {
+      break;
+    }
+  }
+  build->close();
+  if (rc != RC::RECORD_EOF) {
+    return rc;
+  }
+  matches_ = nullptr;
+  match_pos_ = 0;
+  if (build_files_.empty()) {
+    return radix_ ? buffer_probe() : RC::SUCCESS;
+  }
+
+  rc = spill_probe();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  partition_ = 0;
+  return load_partition(partition_);
+}
+
+bool HashJoinExeNode::make_key(const Tuple &tuple, bool build, std::string &key) const {
+  const bool left = build == build_left_;
+  key.clear();
+  for (const auto &field : key_fields_) {
+    const int index = left ? field.first : field.second;
+    const TupleValue &value = tuple.get(index);
+    if (value.is_null) {
+      return false;
+    }
+    if (INTS == value.type) {
+      key.append((const char *)&value.int_value, sizeof(value.int_value));
+    } else {
+      // CHARS和DATES都是字符串，按照strcmp比较，结束符之后的内容不影响结果
+      key.append(tuple.get_string(index));
+      key.push_back('\0');
+    }
+  }
+  return true;
+}
+
+static int hash_join_partition(const std::string &key) {
+  return std::hash<std::string>()(key) % HASH_JOIN_PARTITIONS;
+}
+
+RC HashJoinExeNode::add_build_tuple(std::string &key, Tuple &tuple) {
+  if (!build_files_.empty()) {
+    return write_sort_row(build_files_[hash_join_partition(key)], key, tuple, build_input()->schema());
+  }
+
+  // hash表中的key、位置和tuple，再加上hash表节点的开销
+  const size_t bytes = tuple.memory_size() + key.size() + sizeof(int) + 64;
+  if (memory_ != nullptr && !memory_->try_consume(bytes)) {
+    RC rc = spill_build();
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+    return write_sort_row(build_files_[hash_join_partition(key)], key, tuple, build_input()->schema());
+  }
+  memory_used_ += bytes;
+  if (radix_) {
+    build_keys_.emplace_back(std::move(key));
+  } else {
+    hash_table_[key].push_back(build_tuples_.size());
+  }
+  build_tuples_.emplace_back(std::move(tuple));
+  return RC::SUCCESS;
+}
+
+/**
+ * 已经在hash表中的tuple按照key写到分区中，之后的build端tuple都直接写到分区
+ */
+RC HashJoinExeNode::spill_build() {
+  LOG_INFO("Hash join spills build side to %d partitions, tuples in memory=%d, query memory used=%lu",
+      HASH_JOIN_PARTITIONS, (int)build_tuples_.size(), memory_->used());
+  for (int i = 0; i < HASH_JOIN_PARTITIONS; i++) {
+    FILE *build_file = SpillFileManager::instance().create(memory_->spill());
+    FILE *probe_file = build_file != nullptr ? SpillFileManager::instance().create(memory_->spill()) : nullptr;
+    if (nullptr == probe_file) {
+      LOG_ERROR("Failed to create temporary file for hash join. error=%s", strerror(errno));
+      if (build_file != nullptr) {
+        fclose(build_file);
+      }
+      return RC::IOERR_ACCESS;
+    }
+    build_files_.push_back(build_file);
+    probe_files_.push_back(probe_file);
+  }
+  for (size_t i = 0; i < build_keys_.size(); i++) {
+    RC rc = write_sort_row(build_files_[hash_join_partition(build_keys_[i])], build_keys_[i], build_tuples_[i],
+        build_input()->schema());
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  for (const auto &entry : hash_table_) {
+    FILE *file = build_files_[hash_join_partition(entry.first)];
+    for (int index : entry.second) {
+      RC rc = write_sort_row(file, entry.first, build_tuples_[index], build_input()->schema());
+      if (rc != RC::SUCCESS) {
+        return rc;
+      }
+    }
+  }
+  radix_ = false;
+  clear_hash_table();
+  return RC::SUCCESS;
+}
+
+RC HashJoinExeNode::buffer_probe() {
+  if (build_tuples_.empty()) {
+    // 不会有匹配，不用读probe端
+    radix_ = false;
+    return RC::SUCCESS;
+  }
+
+  const size_t build_bytes = memory_used_;
+  RC rc = RC::SUCCESS;
+  Tuple tuple;
+  std::string key;
+  while ((rc = probe_input()->next(tuple)) == RC::SUCCESS) {
+    if (!make_key(tuple, false, key)) {
+      // key有null的tuple不会匹配
+      continue;
+    }
+    const size_t bytes = tuple.memory_size() + key.size() + 2 * sizeof(int) + 64;
+    const bool fits = memory_ == nullptr || memory_->try_consume(bytes);
+    // 放不下的这一个tuple也放到缓存的最后，接着从probe端读
+    probe_keys_.emplace_back(std::move(key));
+    probe_tuples_.emplace_back(std::move(tuple));
+    if (!fits) {
+      LOG_INFO("Hash join stops buffering probe side at %d tuples, query memory used=%lu",
+          (int)probe_tuples_.size(), memory_->used());
+      build_hash_table();
+      return RC::SUCCESS;
+    }
+    memory_used_ += bytes;
+  }
+  if (rc != RC::RECORD_EOF) {
+    return rc;
+  }
+
+  const int thread_num = hash_join_threads(parallelism_);
+  if (build_tuples_.size() + probe_tuples_.size() < HASH_JOIN_PARALLEL_ROWS) {
+    build_hash_table();
+    return RC::SUCCESS;
+  }
+  return radix_join(thread_num, build_bytes);
+}
+
+RC HashJoinExeNode::radix_join(int thread_num, size_t build_bytes) {
+  const size_t build_num = build_tuples_.size();
+  const size_t probe_num = probe_tuples_.size();
+  // 每行的分区号和按分区排列的行号在join之后释放，匹配的链表留到close
+  const size_t temp_bytes = (build_num + probe_num) * 2 * sizeof(int);
+  const size_t result_bytes = (build_num + probe_num) * sizeof(int);
+  if (memory_ != nullptr && !memory_->try_consume(temp_bytes + result_bytes)) {
+    build_hash_table();
+    return RC::SUCCESS;
+  }
+  memory_used_ += result_bytes;
+
+  int partitions = thread_num;
+  while (partitions < HASH_JOIN_MAX_RADIX_PARTITIONS && build_bytes / partitions > HASH_JOIN_PARTITION_BYTES) {
+    partitions *= 2;
+  }
+
+  // 第一遍每个线程统计自己那一段中每个分区的行数，算出每段在每个分区中写入的位置之后，第二遍把行号写到分区中
+  std::vector<int> partition_of[2] = {std::vector<int>(build_num), std::vector<int>(probe_num)};
+  std::vector<int> rows[2] = {std::vector<int>(build_num), std::vector<int>(probe_num)};
+  std::vector<RadixPartitionTask> partition_tasks(thread_num);
+  for (int t = 0; t < thread_num; t++) {
+    RadixPartitionTask &task = partition_tasks[t];
+    task.partitions = partitions;
+    task.scatter = false;
+    task.keys[0] = &build_keys_;
+    task.keys[1] = &probe_keys_;
+    for (int side = 0; side < 2; side++) {
+      const size_t num = side == 0 ? build_num : probe_num;
+      task.begin[side] = num * t / thread_num;
+      task.end[side] = num * (t + 1) / thread_num;
+      task.partition_of[side] = &partition_of[side];
+      task.rows[side] = &rows[side];
+      task.offsets[side].assign(partitions, 0);
+    }
+  }
+  run_tasks(partition_tasks, radix_partition_routine);
+
+  std::vector<size_t> begins[2] = {std::vector<size_t>(partitions + 1), std::vector<size_t>(partitions + 1)};
+  for (int side = 0; side < 2; side++) {
+    size_t offset = 0;
+    for (int p = 0; p < partitions; p++) {
+      begins[side][p] = offset;
+      for (RadixPartitionTask &task : partition_tasks) {
+        const size_t count = task.offsets[side][p];
+        task.offsets[side][p] = offset;
+        offset += count;
+      }
+    }
+    begins[side][partitions] = offset;
+  }
+  for (RadixPartitionTask &task : partition_tasks) {
+    task.scatter = true;
+  }
+  run_tasks(partition_tasks, radix_partition_routine);
+
+  // 每个线程领取分区，用分区的build端建一个小的hash表，再查找分区中probe端的tuple
+  probe_heads_.assign(probe_num, -1);
+  build_chain_.assign(build_num, -1);
+  RadixJoinContext context;
+  context.build_keys = &build_keys_;
+  context.probe_keys = &probe_keys_;
+  context.build_rows = &rows[0];
+  context.probe_rows = &rows[1];
+  context.build_begins = &begins[0];
+  context.probe_begins = &begins[1];
+  context.probe_heads = &probe_heads_;
+  context.build_chain = &build_chain_;
+  context.partitions = partitions;
+  context.trace = common::RequestTrace::current();
+  context.cancel = QueryCancel::current();
+  std::vector<RadixJoinTask> join_tasks(thread_num);
+  for (RadixJoinTask &task : join_tasks) {
+    task.context = &context;
+    task.rc = RC::SUCCESS;
+  }
+  run_tasks(join_tasks, radix_join_routine);
+  if (memory_ != nullptr) {
+    memory_->release(temp_bytes);
+  }
+  for (const RadixJoinTask &task : join_tasks) {
+    if (task.rc != RC::SUCCESS) {
+      return task.rc;
+    }
+  }
+
+  LOG_DEBUG("Hash join of %d build and %d probe tuples in %d partitions by %d threads",
+      (int)build_num, (int)probe_num, partitions, thread_num);
+  build_keys_.clear();
+  probe_keys_.clear();
+  joined_ = true;
+  probe_pos_ = 0;
+  match_ = -1;
+  return RC::SUCCESS;
+}
+
+void HashJoinExeNode::build_hash_table() {
+  for (size_t i = 0; i < build_keys_.size(); i++) {
+    hash_table_[build_keys_[i]].push_back(i);
+  }
+  build_keys_.clear();
+  radix_ = false;
+}
+
+/**
+ * probe端的输入全部按照key写到分区中，key有null的tuple不可能匹配，直接丢掉
+ */
+RC HashJoinExeNode::spill_probe() {
+  RC rc = RC::SUCCESS;
+  Tuple tuple;
+  std::string key;
+  while ((rc = probe_input()->next(tuple)) == RC::SUCCESS) {
+    if (!make_key(tuple, false, key)) {
+      continue;
+    }
+    rc = write_sort_row(probe_files_[hash_join_partition(key)], key, tuple, probe_input()->schema());
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  return rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+}
+
+RC HashJoinExeNode::load_partition(int partition) {
+  clear_hash_table();
+  FILE *build_file = build_files_[partition];
+  RC rc = rewind_sort_file(build_file);
+  if (rc == RC::SUCCESS) {
+    rc = rewind_sort_file(probe_files_[partition]);
+  }
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  std::string key;
+  Tuple tuple;
+  bool eof = false;
+  while (true) {
+    rc = read_sort_row(build_file, build_input()->schema(), key, tuple, eof);
+    if (rc != RC::SUCCESS || eof) {
+      return rc;
+    }
+    const size_t bytes = tuple.memory_size() + key.size() + sizeof(int) + 64;
+    if (!memory_->try_consume(bytes)) {
+      LOG_WARN("Partition %d of hash join exceeds query memory limit %lu. tuples=%d",
+          partition, memory_->limit(), (int)build_tuples_.size());
+      return RC::NOMEM;
+    }
+    memory_used_ += bytes;
+    hash_table_[key].push_back(build_tuples_.size());
+    build_tuples_.emplace_back(std::move(tuple));
+  }
+}
+
+/**
+ * 取出下一个用来查找的tuple，分区之后逐个分区读取。key_中是它的join字段，有字段为null时为空，不会匹配
+ */
+RC HashJoinExeNode::next_probe(Tuple &tuple) {
+  if (build_files_.empty()) {
+    if (probe_pos_ < probe_tuples_.size()) {
+      // 放弃并行之前已经读入的tuple
+      tuple = std::move(probe_tuples_[probe_pos_]);
+      key_ = std::move(probe_keys_[probe_pos_]);
+      probe_pos_++;
+      return RC::SUCCESS;
+    }
+    RC rc = probe_input()->next(tuple);
+    if (rc == RC::SUCCESS && !make_key(tuple, false, key_)) {
+      key_.clear();
+    }
+    return rc;
+  }
+
+  while (partition_ < HASH_JOIN_PARTITIONS) {
+    bool eof = false;
+    RC rc = read_sort_row(probe_files_[partition_], probe_input()->schema(), key_, tuple, eof);
+    if (rc != RC::SUCCESS || !eof) {
+      return rc;
+    }
+    if (++partition_ < HASH_JOIN_PARTITIONS) {
+      rc = load_partition(partition_);
+      if (rc != RC::SUCCESS) {
+        return rc;
+      }
+    }
+  }
+  return RC::RECORD_EOF;
+}
+
+RC HashJoinExeNode::do_next(Tuple &tuple) {
+  if (joined_) {
+    while (match_ < 0) {
+      if (probe_pos_ >= probe_heads_.size()) {
+        return RC::RECORD_EOF;
+      }
+      match_ = probe_heads_[probe_pos_++];
+    }
+    merge_joined(probe_tuples_[probe_pos_ - 1], build_tuples_[match_], tuple);
+    match_ = build_chain_[match_];
+    return RC::SUCCESS;
+  }
+  if (hash_table_.empty() && build_files_.empty()) {
+    return RC::RECORD_EOF;
+  }
+  while (matches_ == nullptr || match_pos_ >= matches_->size()) {
+    RC rc = next_probe(probe_tuple_);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+    matches_ = nullptr;
+    match_pos_ = 0;
+    auto iter = key_.empty() ? hash_table_.end() : hash_table_.find(key_);
+    if (iter != hash_table_.end()) {
+      matches_ = &iter->second;
+    }
+  }
+
+  merge_joined(probe_tuple_, build_tuples_[(*matches_)[match_pos_++]], tuple);
+  return RC::SUCCESS;
+}
+
+void HashJoinExeNode::merge_joined(const Tuple &probe, const Tuple &build, Tuple &tuple) const {
+  // 输出的列总是左边在前
+  Tuple joined;
+  joined.merge(build_left_ ? build : probe);
+  joined.merge(build_left_ ? probe : build);
+  tuple = std::move(joined);
+}
+
+void HashJoinExeNode::clear_hash_table() {
+  build_tuples_.clear();
+  hash_table_.clear();
+  build_keys_.clear();
+  probe_tuples_.clear();
+  probe_keys_.clear();
+  probe_pos_ = 0;
+  probe_heads_.clear();
+  build_chain_.clear();
+  joined_ = false;
+  match_ = -1;
+  matches_ = nullptr;
+  if (memory_ != nullptr) {
+    memory_->release(memory_used_);
+  }
+  memory_used_ = 0;
+}
+
+void HashJoinExeNode::close_partitions() {
+  for (FILE *file : build_files_) {
+    fclose(file);
+  }
+  for (FILE *file : probe_files_) {
+    fclose(file);
+  }
+  build_files_.clear();
+  probe_files_.clear();
+}
+
+RC HashJoinExeNode::do_close() {
+  clear_hash_table();
+  close_partitions();
+  left_->close();
+  return right_->close();
+}
+
+std::string HashJoinExeNode::explain() const {
+  std::string s = build_left_ ? "HASH_JOIN(BUILD LEFT, " : "HASH_JOIN(";
+  for (size_t i = 0; i < key_fields_.size(); i++) {
+    s += i > 0 ? " AND " : "";
+    s += field_name(left_->schema().field(key_fields_[i].first)) + "=" +
+         field_name(right_->schema().field(key_fields_[i].second));
+  }
+  return s + ")";
+}
+
+void HashJoinExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(left_);
+  children.push_back(right_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool valueCompare(const Tuple &tuple, int index_a, int index_b, CompOp op)
+{
+  const int result = tuple.compare(index_a, tuple, index_b);
+  bool compare_result = false;
+  switch (op)
+  {
+  case EQUAL_TO:
+    compare_result = (result == 0);
+    break;
+  case LESS_EQUAL:
+    compare_result = (result <= 0);
+    break;
+  case NOT_EQUAL:
+    compare_result = (result != 0);
+    break;
+  case LESS_THAN:
+    compare_result = (result < 0);
+    break;
+  case GREAT_EQUAL:
+    compare_result = (result >= 0);
+    break;
+  case GREAT_THAN:
+    compare_result = (result > 0);
+    break;
+  default:
+    break;
+  }
+  return compare_result;
+}
+
+FilterExeNode::~FilterExeNode() {
+  delete child_;
+}
+
+RC FilterExeNode::do_open() {
+  RC rc = child_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  const TupleSchema &schema = child_->schema();
+  field_indexes_.clear();
+  for (const Condition *condition : conditions_) {
+    int left_index = schema.index_of_field(condition->left_attr.relation_name, condition->left_attr.attribute_name);
+    int right_index = schema.index_of_field(condition->right_attr.relation_name, condition->right_attr.attribute_name);
+    if (left_index < 0 || right_index < 0) {
+      LOG_WARN("No such field in condition. %s.%s, %s.%s",
+               condition->left_attr.relation_name, condition->left_attr.attribute_name,
+               condition->right_attr.relation_name, condition->right_attr.attribute_name);
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    field_indexes_.emplace_back(left_index, right_index);
+  }
+  return RC::SUCCESS;
+}
+
+RC FilterExeNode::do_next(Tuple &tuple) {
+  RC rc = RC::SUCCESS;
+  while ((rc = child_->next(tuple)) == RC::SUCCESS) {
+    bool valid = true;
+    for (size_t i = 0; i < conditions_.size() && valid; i++) {
+      valid = valueCompare(tuple, field_indexes_[i].first, field_indexes_[i].second, conditions_[i]->comp);
+    }
+    if (valid) {
+      return RC::SUCCESS;
+    }
+  }
+  return rc;
+}
+
+RC FilterExeNode::do_close() {
+  return child_->close();
+}
+
+std::string FilterExeNode::explain() const {
+  std::string s = "FILTER(";
+  for (size_t i = 0; i < conditions_.size(); i++) {
+    s += i > 0 ? " AND " : "";
+    s += attr_name(conditions_[i]->left_attr) + comp_op_name(conditions_[i]->comp) +
+         attr_name(conditions_[i]->right_attr);
+  }
+  return s + ")";
+}
+
+void FilterExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(child_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ProjectExeNode::~ProjectExeNode() {
+  delete child_;
+}
+
+RC ProjectExeNode::do_open() {
+  RC rc = child_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  // 字段只在这里按名字查找一次，之后每个tuple按位置复制
+  field_indexes_.clear();
+  const TupleSchema &input_schema = child_->schema();
+  identity_ = schema_.fields().size() == input_schema.fields().size();
+  for (const TupleField &field : schema_.fields()) {
+    int index = input_schema.index_of_field(field.table_name(), field.field_name());
+    if (index < 0) {
+      LOG_WARN("No such field. %s.%s", field.table_name(), field.field_name());
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    identity_ = identity_ && index == (int)field_indexes_.size();
+    field_indexes_.push_back(index);
+  }
+  return RC::SUCCESS;
+}
+
+RC ProjectExeNode::do_next(Tuple &tuple) {
+  if (identity_) {
+    return child_->next(tuple);
+  }
+
+  Tuple input;
+  RC rc = child_->next(input);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  Tuple output;
+  output.reserve(field_indexes_.size());
+  for (int index : field_indexes_) {
+    output.add(input, index);
+  }
+  tuple = std::move(output);
+  return RC::SUCCESS;
+}
+
+RC ProjectExeNode::do_close() {
+  return child_->close();
+}
+
+std::string ProjectExeNode::explain() const {
+  std::string s = "PROJECT(";
+  for (size_t i = 0; i < schema_.fields().size(); i++) {
+    s += (i > 0 ? ", " : "") + field_name(schema_.field(i));
+  }
+  return s + ")";
+}
+
+void ProjectExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(child_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ExpressionExeNode::~ExpressionExeNode() {
+  delete child_;
+}
+
+RC ExpressionExeNode::do_open() {
+  RC rc = child_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  // 表达式只在这里按输入的schema编译一次，字段解析成批次中的列
+  const TupleSchema &input_schema = child_->schema();
+  program_.reset(new ExprProgram());
+  for (const ExprCondition *condition : conditions_) {
+    rc = program_->add_condition(*condition, input_schema);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  schema_.clear();
+  int output = 0;
+  if (outputs_.empty()) {
+    for (size_t i = 0; i < input_schema.fields().size() && rc == RC::SUCCESS; i++) {
+      rc = program_->add_column(i, input_schema, &output);
+    }
+  }
+  for (size_t i = 0; i < outputs_.size() && rc == RC::SUCCESS; i++) {
+    const Output &out = outputs_[i];
+    if (out.expr != nullptr) {
+      rc = program_->add_expr(out.expr, input_schema, &output);
+      if (rc == RC::SUCCESS) {
+        // 只能是null的表达式按字符串输出
+        const AttrType type = program_->output_type(output);
+        schema_.add(type == NULLS ? CHARS : type, out.table_name.c_str(), out.field_name.c_str(), true);
+      }
+      continue;
+    }
+    const int index = input_schema.index_of_field(out.table_name.c_str(), out.field_name.c_str());
+    if (index < 0) {
+      LOG_WARN("No such field. %s.%s", out.table_name.c_str(), out.field_name.c_str());
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    const TupleField &field = input_schema.field(index);
+    schema_.add(field.type(), field.table_name(), field.field_name(), field.is_nullable());
+    rc = program_->add_column(index, input_schema, &output);
+  }
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  batch_.init(input_schema, program_->columns());
+  program_->init_context(context_);
+  rows_.clear();
+  row_pos_ = 0;
+  return RC::SUCCESS;
+}
+
+RC ExpressionExeNode::do_next(Tuple &tuple) {
+  while (row_pos_ >= rows_.size()) {
+    RC rc = child_->next_batch(batch_);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+    const int n = batch_.size();
+    sel_.assign(n, 1);
+    program_->filter(batch_, context_, sel_.data());
+
+    const int output_num = program_->output_num();
+    std::vector<const ExprColumn *> columns(output_num);
+    for (int k = 0; k < output_num; k++) {
+      columns[k] = &program_->eval(k, batch_, context_);
+    }
+    rows_.clear();
+    row_pos_ = 0;
+    for (int row = 0; row < n; row++) {
+      if (!sel_[row]) {
+        continue;
+      }
+      rows_.emplace_back();
+      Tuple &out = rows_.back();
+      out.reserve(output_num);
+      for (int k = 0; k < output_num; k++) {
+        expr_column_append(*columns[k], row, out);
+      }
+    }
+  }
+  tuple = std::move(rows_[row_pos_++]);
+  return RC::SUCCESS;
+}
+
+RC ExpressionExeNode::do_close() {
+  rows_.clear();
+  row_pos_ = 0;
+  return child_->close();
+}
+
+std::string ExpressionExeNode::explain() const {
+  std::string s = "EXPRESSION(";
+  for (size_t i = 0; i < outputs_.size(); i++) {
+    const Output &out = outputs_[i];
+    s += i > 0 ? ", " : "";
+    if (out.expr != nullptr) {
+      s += expr_to_string(out.expr);
+    } else {
+      s += out.table_name.empty() ? out.field_name : out.table_name + "." + out.field_name;
+    }
+  }
+  for (size_t i = 0; i < conditions_.size(); i++) {
+    s += i > 0 ? " AND " : (outputs_.empty() ? "WHERE " : " WHERE ");
+    s += expr_condition_to_string(*conditions_[i]);
+  }
+  return s + ")";
+}
+
+void ExpressionExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(child_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MaterializeExeNode::~MaterializeExeNode() {
+  close();
+  delete child_;
+}
+
+void MaterializeExeNode::add_table(Table *table, TupleSchema &&fields) {
+  sources_.emplace_back();
+  Source &source = sources_.back();
+  source.table = table;
+  source.fields.set_schema(fields);
+}
+
+RC MaterializeExeNode::do_open() {
+  // 加锁之后才开始扫描，读到的rid在close之前都有效
+  for (Source &source : sources_) {
+    source.table->lock_records();
+  }
+  locked_ = true;
+  RC rc = child_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  const TupleSchema &input_schema = child_->schema();
+  schema_.clear();
+  field_indexes_.clear();
+  for (size_t i = 0; i < input_schema.fields().size(); i++) {
+    const TupleField &field = input_schema.field(i);
+    if (0 != strcmp(field.field_name(), RID_PAGE_FIELD) && 0 != strcmp(field.field_name(), RID_SLOT_FIELD)) {
+      schema_.add(field.type(), field.table_name(), field.field_name(), field.is_nullable());
+      field_indexes_.push_back(i);
+    }
+  }
+  for (Source &source : sources_) {
+    const char *table_name = source.table->name();
+    source.page_index = input_schema.index_of_field(table_name, RID_PAGE_FIELD);
+    source.slot_index = input_schema.index_of_field(table_name, RID_SLOT_FIELD);
+    if (source.page_index < 0 || source.slot_index < 0) {
+      LOG_WARN("No rid of table %s in input", table_name);
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    schema_.append(source.fields.schema());
+    delete source.converter;
+    source.converter = new TupleRecordConverter(source.table, source.fields);
+  }
+  return RC::SUCCESS;
+}
+
+RC MaterializeExeNode::do_next(Tuple &tuple) {
+  Tuple input;
+  RC rc = child_->next(input);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  Tuple output;
+  output.reserve(schema_.fields().size());
+  for (int index : field_indexes_) {
+    output.add(input, index);
+  }
+  for (Source &source : sources_) {
+    RID rid;
+    rid.page_num = input.get_int(source.page_index);
+    rid.slot_num = input.get_int(source.slot_index);
+    rc = source.table->fetch_record(rid, data_);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+    source.converter->add_values(data_.data(), output);
+  }
+  tuple = std::move(output);
+  return RC::SUCCESS;
+}
+
+RC MaterializeExeNode::do_close() {
+  if (!locked_) {
+    return RC::SUCCESS;
+  }
+  RC rc = child_->close();
+  for (Source &source : sources_) {
+    delete source.converter;
+    source.converter = nullptr;
+    source.table->unlock_records();
+  }
+  locked_ = false;
+  return rc;
+}
+
+std::string MaterializeExeNode::explain() const {
+  std::string s = "MATERIALIZE(";
+  for (const Source &source : sources_) {
+    s += (&source != &sources_.front() ? ", " : "") + std::string(source.table->name());
+  }
+  return s + ")";
+}
+
+void MaterializeExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(child_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AggregateExeNode::~AggregateExeNode() {
+  release_memory();
+  delete child_;
+  delete attr_function_;
+}
+
+/**
+ * COUNT(*)和COUNT(1)这样的参数不对应字段，结果是输入的行数
+ */
+static bool is_row_count_argument(const char *attr_name) {
+  return strcmp(attr_name, "*") == 0 || isdigit(attr_name[0]) || attr_name[0] == '-';
+}
+
+static bool is_distinct_function(FuncType func_type) {
+  return func_type == FuncType::COUNT_DISTINCT || func_type == FuncType::APPROX_COUNT_DISTINCT;
+}
+
+/**
+ * 把批次中一个不是null的值加到COUNT(DISTINCT)的集合或者APPROX_COUNT_DISTINCT的HyperLogLog中。
+ * INTS、DATES和FLOATS按4个字节编码，CHARS是字符串的内容，同一列的值类型相同，不会混淆
+ */
+static void add_distinct_value(AggregateState &state, FuncType func_type, const TupleBatch &batch, int row) {
+  const char *data = nullptr;
+  int len = 0;
+  float float_value = 0;
+  switch (state.type) {
+    case INTS:
+    case DATES: {
+      data = (const char *)(batch.int_values(state.index) + row);
+      len = sizeof(int);
+    } break;
+    case FLOATS: {
+      // 0.0和-0.0是同一个值
+      float_value = batch.float_values(state.index)[row];
+      float_value = float_value == 0 ? 0 : float_value;
+      data = (const char *)&float_value;
+      len = sizeof(float);
+    } break;
+    default: {
+      data = batch.chars_value(state.index, row);
+      len = strlen(data);
+    } break;
+  }
+  const uint64_t hash = DistinctHashSet::hash(data, len);
+  if (func_type == FuncType::COUNT_DISTINCT) {
+    state.distinct_values.insert(data, len, hash);
+  } else {
+    state.sketch.add((uint32_t)(hash >> 32));
+  }
+}
+
+RC AggregateExeNode::do_open() {
+  // 只有COUNT(*)并且没有过滤条件时直接使用表中维护的记录数，记录数未知时扫描之后记下来
+  SelectExeNode *scan = dynamic_cast<SelectExeNode *>(child_);
+  bool count_only = scan != nullptr && scan->unfiltered();
+  for (int j = 0; count_only && j < attr_function_->get_size(); j++) {
+    count_only = attr_function_->get_function_type(j) == FuncType::COUNT &&
+                 is_row_count_argument(attr_function_->get_attr_name(j));
+  }
+  int64_t maintained_count = 0;
+  uint64_t count_epoch = 0;
+  if (count_only && scan->table()->maintained_row_count(scan->trx(), &maintained_count, &count_epoch)) {
+    states_.assign(attr_function_->get_size(), AggregateState());
+    columns_.clear();
+    result_pos_ = 0;
+    result_.clear();
+    if (maintained_count == 0) {
+      result_.set_schema(child_->schema());
+      return RC::SUCCESS;
+    }
+    return make_result((int)maintained_count);
+  }
+  int extreme_rows = 0;
+  if (index_extremes(extreme_rows)) {
+    result_pos_ = 0;
+    result_.clear();
+    if (extreme_rows == 0) {
+      result_.set_schema(child_->schema());
+      return RC::SUCCESS;
+    }
+    return make_result(extreme_rows);
+  }
+
+  RC rc = child_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  // 找出每个聚合函数的参数在输入中的位置，批次中只保存这些列
+  const TupleSchema &input_schema = child_->schema();
+  std::vector<int> columns;
+  release_memory();
+  states_.assign(attr_function_->get_size(), AggregateState());
+  columns_.clear();
+  has_distinct_ = false;
+  for (int j = 0; j < attr_function_->get_size(); j++) {
+    const char *table_name = attr_function_->get_table_name(j);
+    const char *attr_name = attr_function_->get_attr_name(j);
+    if (is_row_count_argument(attr_name)) {
+      continue;
+    }
+
+    AggregateState &state = states_[j];
+    if (attr_function_->get_function_type(j) == FuncType::COUNT_DISTINCT) {
+      state.distinct_values = DistinctHashSet(attr_function_->get_distinct_estimate(j));
+    }
+    has_distinct_ = has_distinct_ || is_distinct_function(attr_function_->get_function_type(j));
+    if (table_name != nullptr) {
+      state.index = input_schema.index_of_field(table_name, attr_name);
+    } else {
+      state.index = input_schema.index_of_field(attr_name);
+    }
+    if (state.index < 0) {
+      LOG_WARN("No such field for aggregation. %s", attr_name);
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    state.type = input_schema.field(state.index).type();
+    auto iter = std::find_if(columns_.begin(), columns_.end(),
+        [&state](const ColumnFunctions &column) { return column.index == state.index; });
+    if (iter == columns_.end()) {
+      columns_.push_back(ColumnFunctions{state.index, state.type, {}});
+      iter = columns_.end() - 1;
+      columns.push_back(state.index);
+    }
+    iter->functions.push_back(j);
+  }
+
+  int row_count = 0;
+  if (!parallel_accumulate(columns, row_count, rc)) {
+    TupleBatch batch;
+    batch.init(input_schema, columns);
+    while ((rc = child_->next_batch(batch)) == RC::SUCCESS) {
+      row_count += batch.size();
+      for (const ColumnFunctions &column : columns_) {
+        accumulate_column(column, batch, states_);
+      }
+      if (has_distinct_ && (rc = track_state_memory()) != RC::SUCCESS) {
+        break;
+      }
+    }
+  } else if (rc == RC::RECORD_EOF && has_distinct_) {
+    RC memory_rc = track_state_memory();
+    rc = memory_rc == RC::SUCCESS ? rc : memory_rc;
+  }
+  child_->close();
+  if (rc != RC::RECORD_EOF) {
+    return rc;
+  }
+  if (count_only && count_epoch != 0) {
+    scan->table()->learn_row_count(count_epoch, row_count);
+  }
+
+  result_pos_ = 0;
+  result_.clear();
+  if (row_count == 0) {
+    // 没有输入时不做聚合
+    result_.set_schema(input_schema);
+    return RC::SUCCESS;
+  }
+  return make_result(row_count);
+}
+
+bool AggregateExeNode::index_extremes(int &row_count) {
+  SelectExeNode *scan = dynamic_cast<SelectExeNode *>(child_);
+  if (nullptr == scan || !scan->unfiltered() || attr_function_->get_size() == 0) {
+    return false;
+  }
+  const Table *table = scan->table();
+  std::vector<const FieldMeta *> fields;
+  for (int j = 0; j < attr_function_->get_size(); j++) {
+    const FuncType func_type = attr_function_->get_function_type(j);
+    const char *table_name = attr_function_->get_table_name(j);
+    const char *attr_name = attr_function_->get_attr_name(j);
+    if ((func_type != FuncType::MIN && func_type != FuncType::MAX) || is_row_count_argument(attr_name) ||
+        (table_name != nullptr && strcmp(table_name, table->name()) != 0)) {
+      return false;
+    }
+    const FieldMeta *field = table->table_meta().field(attr_name);
+    if (nullptr == field) {
+      return false;
+    }
+    fields.push_back(field);
+  }
+
+  std::vector<AggregateState> states(attr_function_->get_size());
+  bool has_rows = false;
+  std::vector<char> value;
+  for (int j = 0; j < attr_function_->get_size(); j++) {
+    bool found = false;
+    if (!scan->first_in_index_order(fields[j], attr_function_->get_function_type(j) == FuncType::MAX, &has_rows,
+        &found, value)) {
+      return false;
+    }
+    AggregateState &state = states[j];
+    state.type = fields[j]->type();
+    if (!found) {
+      continue;
+    }
+    state.count = 1;
+    if (state.type == AttrType::CHARS) {
+      state.chars_value.assign(value.data(), strnlen(value.data(), value.size()));
+    } else {
+      memcpy(&state.int_value, value.data(), sizeof(state.int_value));
+    }
+  }
+  states_ = std::move(states);
+  columns_.clear();
+  row_count = has_rows ? 1 : 0;
+  return true;
+}
+
+namespace {
+
+struct ParallelAggregateContext {
+  const AggregateExeNode *node;
+  std::vector<std::vector<AggregateState>> states;  // 每个线程的中间结果
+  std::vector<int> row_counts;
+};
+
+/**
+ * 把另一个线程的中间结果合并到state上
+ */
+void merge_state(AggregateState &state, FuncType func_type, const AggregateState &other) {
+  switch (func_type) {
+    case FuncType::COUNT: {
+      state.count += other.count;
+    } break;
+    case FuncType::AVG:
+    case FuncType::SUM: {
+      state.int_sum += other.int_sum;
+      state.float_sum += other.float_sum;
+      state.count += other.count;
+    } break;
+    case FuncType::MAX:
+    case FuncType::MIN: {
+      if (other.count == 0) {
+        break;
+      }
+      const bool is_max = func_type == FuncType::MAX;
+      bool replace = state.count == 0;
+      if (!replace && state.type == AttrType::FLOATS) {
+        replace = is_max ? other.float_value > state.float_value : other.float_value < state.float_value;
+      } else if (!replace && (state.type == AttrType::INTS || state.type == AttrType::DATES)) {
+        replace = is_max ? other.int_value > state.int_value : other.int_value < state.int_value;
+      } else if (!replace) {
+        int cmp = strcmp(other.chars_value.c_str(), state.chars_value.c_str());
+        replace = is_max ? cmp > 0 : cmp < 0;
+      }
+      if (replace) {
+        state.int_value = other.int_value;
+        state.float_value = other.float_value;
+        state.chars_value = other.chars_value;
+      }
+      state.count += other.count;
+    } break;
+    case FuncType::COUNT_DISTINCT: {
+      state.distinct_values.merge(other.distinct_values);
+    } break;
+    case FuncType::APPROX_COUNT_DISTINCT: {
+      state.sketch.merge(other.sketch);
+    } break;
+    default:
+      break;
+  }
+}
+
+}  // namespace
+
+bool AggregateExeNode::parallel_accumulate(const std::vector<int> &columns, int &row_count, RC &rc) {
+  SelectExeNode *scan = dynamic_cast<SelectExeNode *>(child_);
+  if (nullptr == scan) {
+    return false;
+  }
+  for (int j = 0; j < attr_function_->get_size(); j++) {
+    // 浮点数求和的结果和累加的顺序有关，并行时结果会和逐行累加不同
+    const FuncType func_type = attr_function_->get_function_type(j);
+    if ((func_type == FuncType::AVG || func_type == FuncType::SUM) && states_[j].type == AttrType::FLOATS) {
+      return false;
+    }
+  }
+  int thread_num = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  thread_num = std::min(thread_num, PARALLEL_SCAN_MAX_THREADS);
+  if (thread_num <= 1 || !scan->parallel_scannable()) {
+    return false;
+  }
+
+  // 每个线程使用自己的扫描，不需要open时打开的扫描
+  scan->close();
+  ParallelAggregateContext context;
+  context.node = this;
+  context.states.assign(thread_num, states_);
+  context.row_counts.assign(thread_num, 0);
+  rc = scan->parallel_scan(thread_num, columns, accumulate_worker_batch, &context);
+  if (rc != RC::SUCCESS) {
+    return true;
+  }
+  for (int i = 0; i < thread_num; i++) {
+    row_count += context.row_counts[i];
+    for (int j = 0; j < attr_function_->get_size(); j++) {
+      merge_state(states_[j], attr_function_->get_function_type(j), context.states[i][j]);
+    }
+  }
+  rc = RC::RECORD_EOF;
+  return true;
+}
+
+void AggregateExeNode::accumulate_worker_batch(const TupleBatch &batch, int worker, void *context) {
+  ParallelAggregateContext *aggregate_context = (ParallelAggregateContext *)context;
+  aggregate_context->row_counts[worker] += batch.size();
+  for (const ColumnFunctions &column : aggregate_context->node->columns_) {
+    aggregate_context->node->accumulate_column(column, batch, aggregate_context->states[worker]);
+  }
+}
+
+void AggregateExeNode::accumulate(AggregateState &state, FuncType func_type, const TupleBatch &batch) const {
+  if (state.index < 0) {
+    return;
+  }
+
+  const int n = batch.size();
+  const uint8_t *nulls = batch.nulls(state.index);
+  switch (func_type) {
+    case FuncType::COUNT: {
+      state.count += batch_count_not_null(nulls, n);
+    } break;
+    case FuncType::AVG:
+    case FuncType::SUM: {
+      if (state.type == AttrType::INTS) {
+        state.int_sum += batch_sum_int(batch.int_values(state.index), nulls, n);
+        state.count += batch_count_not_null(nulls, n);
+      } else if (state.type == AttrType::FLOATS) {
+        batch_sum_float(batch.float_values(state.index), nulls, n, &state.float_sum);
+        state.count += batch_count_not_null(nulls, n);
+      }
+    } break;
+    case FuncType::MAX:
+    case FuncType::MIN: {
+      const bool is_max = func_type == FuncType::MAX;
+      if (state.type == AttrType::INTS || state.type == AttrType::DATES) {
+        // 日期保存成天数，按整数比较和按字符串比较的结果一样
+        int value = 0;
+        const int *values = batch.int_values(state.index);
+        if (is_max ? batch_max_int(values, nulls, n, &value) : batch_min_int(values, nulls, n, &value)) {
+          if (state.count == 0 || (is_max ? value > state.int_value : value < state.int_value)) {
+            state.int_value = value;
+          }
+          state.count++;
+        }
+      } else if (state.type == AttrType::FLOATS) {
+        float value = 0;
+        const float *values = batch.float_values(state.index);
+        if (is_max ? batch_max_float(values, nulls, n, &value) : batch_min_float(values, nulls, n, &value)) {
+          if (state.count == 0 || (is_max ? value > state.float_value : value < state.float_value)) {
+            state.float_value = value;
+          }
+          state.count++;
+        }
+      } else {
+        for (int row = 0; row < n; row++) {
+          if (nulls[row] != 0) {
+            continue;
+          }
+          const char *value = batch.chars_value(state.index, row);
+          int cmp = state.count == 0 ? 0 : strcmp(value, state.chars_value.c_str());
+          if (state.count == 0 || (is_max ? cmp > 0 : cmp < 0)) {
+            state.chars_value = value;
+          }
+          state.count++;
+        }
+      }
+    } break;
+    case FuncType::COUNT_DISTINCT:
+    case FuncType::APPROX_COUNT_DISTINCT: {
+      for (int row = 0; row < n; row++) {
+        if (nulls[row] == 0) {
+          add_distinct_value(state, func_type, batch, row);
+        }
+      }
+    } break;
+    default:
+      break;
+  }
+}
+
+/**
+ * 把一个聚合函数的结果添加到tuple中，add_type是结果的类型
+ */
+static RC add_aggregate_value(const AggregateState &state, FuncType func_type, const char *attr_name, int row_count,
+    Tuple &tuple, AttrType &add_type) {
+  if (is_row_count_argument(attr_name)) {
+    // 处理COUNT(*)
+    add_type = AttrType::INTS;
+    tuple.add(row_count);
+    return RC::SUCCESS;
+  }
+
+  switch (func_type) {
+    case FuncType::COUNT: {
+      add_type = AttrType::INTS;
+      tuple.add(state.count);
+    } break;
+    case FuncType::COUNT_DISTINCT: {
+      add_type = AttrType::INTS;
+      tuple.add((int)state.distinct_values.size());
+    } break;
+    case FuncType::APPROX_COUNT_DISTINCT: {
+      add_type = AttrType::INTS;
+      tuple.add((int)llround(state.sketch.estimate()));
+    } break;
+    case FuncType::AVG: {
+      if (state.type == AttrType::CHARS || state.type == AttrType::DATES) {
+        // CHARS和DATES不应该计算平均值
+        LOG_WARN("Cannot compute avg of field %s", attr_name);
+        return RC::GENERIC_ERROR;
+      }
+      if (state.count == 0) {
+        add_type = AttrType::CHARS;
+        tuple.add("NULL", 4, true);
+        break;
+      }
+      add_type = AttrType::FLOATS;
+      if (state.type == AttrType::INTS) {
+        tuple.add((float)state.int_sum / state.count);
+      } else {
+        tuple.add(state.float_sum / state.count);
+      }
+    } break;
+    case FuncType::SUM: {
+      if (state.type != AttrType::INTS && state.type != AttrType::FLOATS) {
+        LOG_WARN("Cannot compute sum of field %s", attr_name);
+        return RC::GENERIC_ERROR;
+      }
+      if (state.count == 0) {
+        add_type = AttrType::CHARS;
+        tuple.add("NULL", 4, true);
+        break;
+      }
+      add_type = state.type;
+      if (state.type == AttrType::INTS) {
+        tuple.add((int)state.int_sum);
+      } else {
+        tuple.add(state.float_sum);
+      }
+    } break;
+    case FuncType::MAX:
+    case FuncType::MIN: {
+      if (state.count == 0) {
+        add_type = AttrType::CHARS;
+        tuple.add("NULL", 4, true);
+        break;
+      }
+      add_type = state.type;
+      if (state.type == AttrType::FLOATS) {
+        tuple.add(state.float_value);
+      } else if (state.type == AttrType::INTS) {
+        tuple.add(state.int_value);
+      } else if (state.type == AttrType::DATES) {
+        char date[DATE_STRING_LEN + 1];
+        common::format_date(state.int_value, date);
+        tuple.add(date, DATE_STRING_LEN);
+      } else {
+        tuple.add(state.chars_value.c_str(), state.chars_value.size());
+      }
+    } break;
+    default: {
+      LOG_ERROR("未定义的聚合函数");
+      return RC::GENERIC_ERROR;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+void AggregateExeNode::accumulate_column(const ColumnFunctions &column, const TupleBatch &batch,
+    std::vector<AggregateState> &states) const {
+  const bool numeric = column.type == AttrType::INTS || column.type == AttrType::DATES || column.type == AttrType::FLOATS;
+  if (column.functions.size() == 1 || !numeric) {
+    for (int j : column.functions) {
+      accumulate(states[j], attr_function_->get_function_type(j), batch);
+    }
+    return;
+  }
+
+  // 比如min(a), max(a), avg(a)只遍历一次a
+  const int n = batch.size();
+  const uint8_t *nulls = batch.nulls(column.index);
+  BatchIntSummary int_summary = {0, 0, 0, 0};
+  BatchFloatSummary float_summary = {0, 0, 0};
+  if (column.type == AttrType::FLOATS) {
+    batch_summarize_float(batch.float_values(column.index), nulls, n, &float_summary);
+  } else {
+    batch_summarize_int(batch.int_values(column.index), nulls, n, &int_summary);
+  }
+  const int count = column.type == AttrType::FLOATS ? float_summary.count : int_summary.count;
+
+  for (int j : column.functions) {
+    AggregateState &state = states[j];
+    switch (attr_function_->get_function_type(j)) {
+      case FuncType::COUNT: {
+        state.count += count;
+      } break;
+      case FuncType::AVG:
+      case FuncType::SUM: {
+        if (state.type == AttrType::INTS) {
+          state.int_sum += int_summary.sum;
+          state.count += count;
+        } else if (state.type == AttrType::FLOATS) {
+          batch_sum_float(batch.float_values(column.index), nulls, n, &state.float_sum);
+          state.count += count;
+        }
+      } break;
+      case FuncType::MAX:
+      case FuncType::MIN: {
+        if (count == 0) {
+          break;
+        }
+        const bool is_max = attr_function_->get_function_type(j) == FuncType::MAX;
+        if (state.type == AttrType::FLOATS) {
+          float value = is_max ? float_summary.max : float_summary.min;
+          if (state.count == 0 || (is_max ? value > state.float_value : value < state.float_value)) {
+            state.float_value = value;
+          }
+        } else {
+          int value = is_max ? int_summary.max : int_summary.min;
+          if (state.count == 0 || (is_max ? value > state.int_value : value < state.int_value)) {
+            state.int_value = value;
+          }
+        }
+        state.count++;
+      } break;
+      case FuncType::COUNT_DISTINCT:
+      case FuncType::APPROX_COUNT_DISTINCT: {
+        accumulate(state, attr_function_->get_function_type(j), batch);
+      } break;
+      default:
+        break;
+    }
+  }
+}
+
+RC AggregateExeNode::track_state_memory() {
+  size_t bytes = 0;
+  for (const AggregateState &state : states_) {
+    bytes += state.memory_size();
+  }
+  if (bytes <= memory_used_) {
+    return RC::SUCCESS;
+  }
+  if (memory_ != nullptr && !memory_->try_consume(bytes - memory_used_)) {
+    LOG_WARN("Distinct values of aggregation exceed query memory limit %lu. used=%lu",
+        memory_->limit(), memory_->used());
+    return RC::NOMEM;
+  }
+  memory_used_ = bytes;
+  return RC::SUCCESS;
+}
+
+void AggregateExeNode::release_memory() {
+  if (memory_ != nullptr) {
+    memory_->release(memory_used_);
+  }
+  memory_used_ = 0;
+}
+
+RC AggregateExeNode::make_result(int row_count) {
+  TupleSchema schema;
+  Tuple tuple;
+  for (int j = 0; j < attr_function_->get_size(); j++) {
+    // 获取 func_type( 字符串
+    std::string name = attr_function_->to_string(j, rel_num_);
+    AttrType add_type = AttrType::UNDEFINED;
+    RC rc = add_aggregate_value(states_[j], attr_function_->get_function_type(j), attr_function_->get_attr_name(j),
+        row_count, tuple, add_type);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+    schema.add_if_not_exists(add_type, "", name.c_str());
+  }
+
+  result_.set_schema(schema);
+  result_.add(std::move(tuple));
+  return RC::SUCCESS;
+}
+
+RC AggregateExeNode::do_next(Tuple &tuple) {
+  if (result_pos_ >= result_.size()) {
+    return RC::RECORD_EOF;
+  }
+  tuple = std::move(result_.mutable_tuple(result_pos_++));
+  return RC::SUCCESS;
+}
+
+RC AggregateExeNode::do_close() {
+  result_.clear_tuples();
+  // 结果已经算出来了，不再需要中间结果
+  states_.clear();
+  release_memory();
+  return child_->close();
+}
+
+std::string AggregateExeNode::explain() const {
+  std::string s = "AGGREGATE(";
+  for (int i = 0; i < attr_function_->get_size(); i++) {
+    s += (i > 0 ? ", " : "") + attr_function_->to_string(i, rel_num_);
+  }
+  return s + ")";
+}
+
+void AggregateExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(child_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HashAggregateExeNode::~HashAggregateExeNode() {
+  close_partitions();
+  delete child_;
+  delete attr_function_;
+}
+
+/**
+ * 把一行累加到聚合函数的中间结果上
+ */
+static void accumulate_row(AggregateState &state, FuncType func_type, const TupleBatch &batch, int row) {
+  if (state.index < 0 || batch.nulls(state.index)[row] != 0) {
+    return;
+  }
+
+  switch (func_type) {
+    case FuncType::COUNT: {
+      state.count++;
+    } break;
+    case FuncType::AVG:
+    case FuncType::SUM: {
+      if (state.type == AttrType::INTS) {
+        state.int_sum += batch.int_values(state.index)[row];
+        state.count++;
+      } else if (state.type == AttrType::FLOATS) {
+        state.float_sum += batch.float_values(state.index)[row];
+        state.count++;
+      }
+    } break;
+    case FuncType::MAX:
+    case FuncType::MIN: {
+      const bool is_max = func_type == FuncType::MAX;
+      if (state.type == AttrType::INTS || state.type == AttrType::DATES) {
+        int value = batch.int_values(state.index)[row];
+        if (state.count == 0 || (is_max ? value > state.int_value : value < state.int_value)) {
+          state.int_value = value;
+        }
+      } else if (state.type == AttrType::FLOATS) {
+        float value = batch.float_values(state.index)[row];
+        if (state.count == 0 || (is_max ? value > state.float_value : value < state.float_value)) {
+          state.float_value = value;
+        }
+      } else {
+        const char *value = batch.chars_value(state.index, row);
+        int cmp = state.count == 0 ? 0 : strcmp(value, state.chars_value.c_str());
+        if (state.count == 0 || (is_max ? cmp > 0 : cmp < 0)) {
+          state.chars_value = value;
+        }
+      }
+      state.count++;
+    } break;
+    case FuncType::COUNT_DISTINCT:
+    case FuncType::APPROX_COUNT_DISTINCT: {
+      add_distinct_value(state, func_type, batch, row);
+    } break;
+    default:
+      break;
+  }
+}
+
+static int find_input_field(const TupleSchema &schema, const char *table_name, const char *attr_name) {
+  return table_name != nullptr ? schema.index_of_field(table_name, attr_name) : schema.index_of_field(attr_name);
+}
+
+RC HashAggregateExeNode::do_open() {
+  RC rc = child_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  input_schema_ = child_->schema();
+  group_indexes_.clear();
+  columns_.clear();
+  for (int i = 0; i < group_num_; i++) {
+    int index = find_input_field(input_schema_, group_attrs_[i].relation_name, group_attrs_[i].attribute_name);
+    if (index < 0) {
+      LOG_WARN("No such field for group by. %s", group_attrs_[i].attribute_name);
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    group_indexes_.push_back(index);
+    if (std::find(columns_.begin(), columns_.end(), index) == columns_.end()) {
+      columns_.push_back(index);
+    }
+  }
+
+  initial_states_.assign(attr_function_->get_size(), AggregateState());
+  for (int j = 0; j < attr_function_->get_size(); j++) {
+    const char *attr_name = attr_function_->get_attr_name(j);
+    if (is_row_count_argument(attr_name)) {
+      continue;
+    }
+    AggregateState &state = initial_states_[j];
+    state.index = find_input_field(input_schema_, attr_function_->get_table_name(j), attr_name);
+    if (state.index < 0) {
+      LOG_WARN("No such field for aggregation. %s", attr_name);
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    state.type = input_schema_.field(state.index).type();
+    if (std::find(columns_.begin(), columns_.end(), state.index) == columns_.end()) {
+      columns_.push_back(state.index);
+    }
+  }
+
+  // 分组字段保留原来的表名和字段名，这样后面可以按照分组字段排序
+  schema_.clear();
+  for (const Output &output : outputs_) {
+    if (output.is_group) {
+      const TupleField &field = input_schema_.field(group_indexes_[output.index]);
+      schema_.add(field.type(), field.table_name(), field.field_name(), field.is_nullable());
+    } else {
+      const AggregateState &state = initial_states_[output.index];
+      AttrType type = AttrType::INTS;
+      FuncType func_type = attr_function_->get_function_type(output.index);
+      if (state.index >= 0 && func_type == FuncType::AVG) {
+        type = AttrType::FLOATS;
+      } else if (state.index >= 0 &&
+                 (func_type == FuncType::MAX || func_type == FuncType::MIN || func_type == FuncType::SUM)) {
+        type = state.type;
+      }
+      schema_.add(type, "", attr_function_->to_string(output.index, rel_num_).c_str());
+    }
+  }
+
+  clear_groups();
+  close_partitions();
+  streaming_ = ordered_input_ != nullptr && ordered_input_->index_ordered();
+  if (streaming_) {
+    // 分组在do_next中逐个读出，子算子在close时关闭
+    batch_.init(input_schema_, columns_);
+    batch_row_ = 0;
+    input_eof_ = false;
+    return RC::SUCCESS;
+  }
+  TupleBatch batch;
+  batch.init(input_schema_, columns_);
+  std::vector<FILE *> spills(HASH_AGGREGATE_PARTITIONS, nullptr);
+  while ((rc = child_->next_batch(batch)) == RC::SUCCESS) {
+    rc = aggregate_batch(batch, 0, spills);
+    if (rc != RC::SUCCESS) {
+      break;
+    }
+  }
+  child_->close();
+  for (FILE *file : spills) {
+    if (file != nullptr) {
+      partitions_.push_back(Partition{file, 1});
+    }
+  }
+  return rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+}
+
+/**
+ * 分组字段依次编码：一个字节的null标志，不是null时INTS、DATES和FLOATS是4个字节，CHARS是以'\0'结尾的字符串
+ */
+void HashAggregateExeNode::make_key(const TupleBatch &batch, int row, std::string &key) const {
+  key.clear();
+  for (int index : group_indexes_) {
+    if (batch.nulls(index)[row] != 0) {
+      key.push_back(1);
+      continue;
+    }
+    key.push_back(0);
+    switch (input_schema_.field(index).type()) {
+      case INTS:
+      case DATES: {
+        int value = batch.int_values(index)[row];
+        key.append((const char *)&value, sizeof(value));
+      } break;
+      case FLOATS: {
+        // 0.0和-0.0是同一个分组
+        float value = batch.float_values(index)[row];
+        value = value == 0 ? 0 : value;
+        key.append((const char *)&value, sizeof(value));
+      } break;
+      default: {
+        key.append(batch.chars_value(index, row));
+        key.push_back('\0');
+      } break;
+    }
+  }
+}
+
+RC HashAggregateExeNode::aggregate_batch(const TupleBatch &batch, int depth, std::vector<FILE *> &spills) {
+  std::string key;
+  for (int row = 0; row < batch.size(); row++) {
+    make_key(batch, row, key);
+    int group_index = 0;
+    auto iter = group_map_.find(key);
+    if (iter != group_map_.end()) {
+      group_index = iter->second;
+    } else {
+      // hash表中的key和分组中的key各一份，再加上hash表节点的开销。最后一层不再分区，超出限制也在内存中聚合
+      const size_t bytes = key.size() * 2 + sizeof(Group) + initial_states_.size() * sizeof(AggregateState) + 64;
+      const bool last_depth = depth >= HASH_AGGREGATE_MAX_DEPTH;
+      if (!last_depth &&
+          (memory_used_ >= memory_budget_ || (memory_ != nullptr && !memory_->try_consume(bytes)))) {
+        // 每一层用hash值中不同的位选择分区，同一个分区中的分组在下一层还能继续分开
+        const size_t hash = std::hash<std::string>()(key);
+        const int partition = (hash >> (depth * 4)) % HASH_AGGREGATE_PARTITIONS;
+        if (spills[partition] == nullptr) {
+          spills[partition] = SpillFileManager::instance().create(memory_ != nullptr ? memory_->spill() : nullptr);
+          if (spills[partition] == nullptr) {
+            LOG_ERROR("Failed to create temporary file for hash aggregation. error=%s", strerror(errno));
+            return RC::IOERR_ACCESS;
+          }
+          LOG_INFO("Hash aggregation spills partition %d at depth %d, groups in memory=%d",
+              partition, depth, (int)groups_.size());
+        }
+        RC rc = spill_row(batch, row, spills[partition]);
+        if (rc != RC::SUCCESS) {
+          return rc;
+        }
+        continue;
+      }
+      if (last_depth && memory_ != nullptr) {
+        memory_->consume(bytes);
+      }
+      memory_used_ += bytes;
+      group_index = groups_.size();
+      group_map_.emplace(key, group_index);
+      groups_.emplace_back();
+      groups_.back().key = key;
+      groups_.back().states = initial_states_;
+    }
+
+    Group &group = groups_[group_index];
+    group.row_count++;
+    for (size_t j = 0; j < group.states.size(); j++) {
+      AggregateState &state = group.states[j];
+      const size_t state_size = state.memory_size();
+      accumulate_row(state, attr_function_->get_function_type(j), batch, row);
+      if (state.memory_size() > state_size) {
+        memory_used_ += state.memory_size() - state_size;
+        if (memory_ != nullptr) {
+          memory_->consume(state.memory_size() - state_size);
+        }
+      }
+    }
+  }
+  return RC::SUCCESS;
+}
+
+/**
+ * 按照columns_的顺序写出一行：一个字节的null标志，不是null时INTS、DATES和FLOATS是4个字节，CHARS是长度加上内容
+ */
+RC HashAggregateExeNode::spill_row(const TupleBatch &batch, int row, FILE *file) const {
+  for (int index : columns_) {
+    const char null_flag = batch.nulls(index)[row];
+    bool ok = fwrite(&null_flag, sizeof(null_flag), 1, file) == 1;
+    if (ok && null_flag == 0) {
+      switch (input_schema_.field(index).type()) {
+        case INTS:
+        case DATES:
+          ok = fwrite(batch.int_values(index) + row, sizeof(int), 1, file) == 1;
+          break;
+        case FLOATS:
+          ok = fwrite(batch.float_values(index) + row, sizeof(float), 1, file) == 1;
+          break;
+        default: {
+          const char *value = batch.chars_value(index, row);
+          const int len = strlen(value);
+          ok = fwrite(&len, sizeof(len), 1, file) == 1 && (len == 0 || fwrite(value, len, 1, file) == 1);
+        } break;
+      }
+    }
+    if (!ok) {
+      LOG_ERROR("Failed to write hash aggregation partition. error=%s", strerror(errno));
+      return RC::IOERR_WRITE;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC HashAggregateExeNode::load_partition(FILE *file, TupleBatch &batch, bool &eof) const {
+  batch.clear();
+  std::string chars;
+  while (!batch.full()) {
+    char null_flag = 0;
+    if (fread(&null_flag, sizeof(null_flag), 1, file) != 1) {
+      eof = true;
+      break;
+    }
+    const int row = batch.add_row();
+    for (size_t pos = 0; pos < columns_.size(); pos++) {
+      const int index = columns_[pos];
+      if (pos > 0 && fread(&null_flag, sizeof(null_flag), 1, file) != 1) {
+        LOG_ERROR("Hash aggregation partition is truncated");
+        return RC::IOERR_SHORT_READ;
+      }
+      if (null_flag != 0) {
+        continue;
+      }
+      bool ok = true;
+      switch (input_schema_.field(index).type()) {
+        case INTS:
+        case DATES: {
+          int value = 0;
+          ok = fread(&value, sizeof(value), 1, file) == 1;
+          batch.set_int(index, row, value);
+        } break;
+        case FLOATS: {
+          float value = 0;
+          ok = fread(&value, sizeof(value), 1, file) == 1;
+          batch.set_float(index, row, value);
+        } break;
+        default: {
+          int len = 0;
+          ok = fread(&len, sizeof(len), 1, file) == 1;
+          chars.resize(ok ? len : 0);
+          ok = ok && (len == 0 || fread(&chars[0], len, 1, file) == 1);
+          batch.set_chars(index, row, chars.data(), chars.size());
+        } break;
+      }
+      if (!ok) {
+        LOG_ERROR("Hash aggregation partition is truncated");
+        return RC::IOERR_SHORT_READ;
+      }
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC HashAggregateExeNode::aggregate_partition(const Partition &partition) {
+  clear_groups();
+  RC rc = rewind_sort_file(partition.file);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  TupleBatch batch;
+  batch.init(input_schema_, columns_);
+  std::vector<FILE *> spills(HASH_AGGREGATE_PARTITIONS, nullptr);
+  bool eof = false;
+  while (rc == RC::SUCCESS && !eof) {
+    rc = load_partition(partition.file, batch, eof);
+    if (rc == RC::SUCCESS && batch.size() > 0) {
+      rc = aggregate_batch(batch, partition.depth, spills);
+    }
+  }
+  for (FILE *file : spills) {
+    if (file != nullptr) {
+      partitions_.push_back(Partition{file, partition.depth + 1});
+    }
+  }
+  return rc;
+}
+
+RC HashAggregateExeNode::make_tuple(const Group &group, Tuple &tuple) const {
+  // 从key中解码出分组字段的值
+  Tuple group_tuple;
+  const char *data = group.key.data();
+  for (int index : group_indexes_) {
+    if (*data++ != 0) {
+      group_tuple.add("NULL", 4, true);
+      continue;
+    }
+    switch (input_schema_.field(index).type()) {
+      case INTS: {
+        group_tuple.add(*(const int *)data);
+        data += sizeof(int);
+      } break;
+      case DATES: {
+        char date[DATE_STRING_LEN + 1];
+        common::format_date(*(const int *)data, date);
+        group_tuple.add(date, DATE_STRING_LEN);
+        data += sizeof(int);
+      } break;
+      case FLOATS: {
+        group_tuple.add(*(const float *)data);
+        data += sizeof(float);
+      } break;
+      default: {
+        const int len = strlen(data);
+        group_tuple.add(data, len);
+        data += len + 1;
+      } break;
+    }
+  }
+
+  tuple = Tuple();
+  for (const Output &output : outputs_) {
+    if (output.is_group) {
+      tuple.add(group_tuple, output.index);
+      continue;
+    }
+    AttrType add_type = AttrType::UNDEFINED;
+    RC rc = add_aggregate_value(group.states[output.index], attr_function_->get_function_type(output.index),
+        attr_function_->get_attr_name(output.index), group.row_count, tuple, add_type);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC HashAggregateExeNode::next_sorted_group(Tuple &tuple) {
+  std::string key;
+  while (true) {
+    if (batch_row_ >= batch_.size()) {
+      if (input_eof_) {
+        break;
+      }
+      RC rc = child_->next_batch(batch_);
+      if (rc == RC::RECORD_EOF) {
+        input_eof_ = true;
+        break;
+      }
+      if (rc != RC::SUCCESS) {
+        return rc;
+      }
+      batch_row_ = 0;
+    }
+
+    make_key(batch_, batch_row_, key);
+    RC rc = RC::SUCCESS;
+    const bool finished = !groups_.empty() && key != groups_[0].key;
+    if (finished) {
+      rc = make_tuple(groups_[0], tuple);
+      groups_.clear();
+    }
+    if (groups_.empty()) {
+      groups_.emplace_back();
+      groups_[0].key = key;
+      groups_[0].states = initial_states_;
+    }
+    Group &group = groups_[0];
+    group.row_count++;
+    for (size_t j = 0; j < group.states.size(); j++) {
+      accumulate_row(group.states[j], attr_function_->get_function_type(j), batch_, batch_row_);
+    }
+    batch_row_++;
+    if (finished) {
+      return rc;
+    }
+  }
+
+  if (groups_.empty()) {
+    return RC::RECORD_EOF;
+  }
+  RC rc = make_tuple(groups_[0], tuple);
+  groups_.clear();
+  return rc;
+}
+
+RC HashAggregateExeNode::do_next(Tuple &tuple) {
+  if (streaming_) {
+    return next_sorted_group(tuple);
+  }
+  while (group_pos_ >= groups_.size()) {
+    if (partitions_.empty()) {
+      return RC::RECORD_EOF;
+    }
+    Partition partition = partitions_.back();
+    partitions_.pop_back();
+    RC rc = aggregate_partition(partition);
+    fclose(partition.file);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  return make_tuple(groups_[group_pos_++], tuple);
+}
+
+void HashAggregateExeNode::clear_groups() {
+  groups_.clear();
+  group_map_.clear();
+  if (memory_ != nullptr) {
+    memory_->release(memory_used_);
+  }
+  memory_used_ = 0;
+  group_pos_ = 0;
+}
+
+void HashAggregateExeNode::close_partitions() {
+  for (Partition &partition : partitions_) {
+    fclose(partition.file);
+  }
+  partitions_.clear();
+}
+
+RC HashAggregateExeNode::do_close() {
+  clear_groups();
+  close_partitions();
+  return child_->close();
+}
+
+std::string HashAggregateExeNode::explain() const {
+  std::string s = "HASH_AGGREGATE(group by ";
+  for (int i = 0; i < group_num_; i++) {
+    s += (i > 0 ? ", " : "") + attr_name(group_attrs_[i]);
+  }
+  for (int i = 0; i < attr_function_->get_size(); i++) {
+    s += ", " + attr_function_->to_string(i, rel_num_);
+  }
+  if (ordered_input_ != nullptr) {
+    s += ", index order";
+  }
+  return s + ")";
+}
+
+void HashAggregateExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(child_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+DistinctExeNode::~DistinctExeNode() {
+  release_memory();
+  delete child_;
+}
+
+RC DistinctExeNode::do_open() {
+  RC rc = child_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  // 所有的列都参与比较，编码的方向不影响是否相等
+  fields_.clear();
+  const TupleSchema &schema = child_->schema();
+  for (int i = 0; i < (int)schema.fields().size(); i++) {
+    fields_.push_back(SortField{i, schema.field(i).type(), false});
+  }
+  release_memory();
+  values_ = DistinctHashSet(expected_);
+  return RC::SUCCESS;
+}
+
+RC DistinctExeNode::do_next(Tuple &tuple) {
+  RC rc = RC::SUCCESS;
+  while ((rc = child_->next(tuple)) == RC::SUCCESS) {
+    make_sort_key(tuple, fields_, key_);
+    if (!values_.insert(key_.data(), key_.size())) {
+      continue;
+    }
+    const size_t bytes = values_.memory_size();
+    if (bytes > memory_used_) {
+      if (memory_ != nullptr && !memory_->try_consume(bytes - memory_used_)) {
+        LOG_WARN("Distinct rows exceed query memory limit %lu. rows=%d", memory_->limit(), (int)values_.size());
+        return RC::NOMEM;
+      }
+      memory_used_ = bytes;
+    }
+    return RC::SUCCESS;
+  }
+  return rc;
+}
+
+RC DistinctExeNode::do_close() {
+  values_.clear();
+  release_memory();
+  return child_->close();
+}
+
+void DistinctExeNode::release_memory() {
+  if (memory_ != nullptr) {
+    memory_->release(memory_used_);
+  }
+  memory_used_ = 0;
+}
+
+std::string DistinctExeNode::explain() const {
+  return "DISTINCT(expected=" + std::to_string(expected_) + ")";
+}
+
+void DistinctExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(child_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WindowFunction::parse_type(const char *name, WindowFuncType &type) {
+  static const std::pair<const char *, WindowFuncType> types[] = {
+      {"row_number", WindowFuncType::ROW_NUMBER},
+      {"rank", WindowFuncType::RANK},
+      {"dense_rank", WindowFuncType::DENSE_RANK},
+      {"count", WindowFuncType::COUNT},
+      {"sum", WindowFuncType::SUM},
+      {"avg", WindowFuncType::AVG},
+      {"min", WindowFuncType::MIN},
+      {"max", WindowFuncType::MAX},
+  };
+  for (const auto &entry : types) {
+    if (0 == strcasecmp(name, entry.first)) {
+      type = entry.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+AttrType WindowFunction::result_type(WindowFuncType type, AttrType arg_type) {
+  switch (type) {
+    case WindowFuncType::SUM: return arg_type == FLOATS ? FLOATS : INTS;
+    case WindowFuncType::AVG: return FLOATS;
+    case WindowFuncType::MIN:
+    case WindowFuncType::MAX: return arg_type;
+    default: return INTS;
+  }
+}
+
+bool WindowFunction::result_nullable(WindowFuncType type) {
+  return type == WindowFuncType::SUM || type == WindowFuncType::AVG || type == WindowFuncType::MIN ||
+         type == WindowFuncType::MAX;
+}
+
+static void add_null_value(Tuple &tuple, AttrType type) {
+  if (FLOATS == type) {
+    tuple.add(0.0f, true);
+  } else if (INTS == type || DATES == type) {
+    tuple.add(0, true);
+  } else {
+    tuple.add("", 0, true);
+  }
+}
+
+WindowExeNode::~WindowExeNode() {
+  release_memory();
+  delete child_;
+}
+
+RC WindowExeNode::do_open() {
+  RC rc = child_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  const TupleSchema &input = child_->schema();
+  partition_fields_.clear();
+  peer_fields_.clear();
+  for (size_t i = 0; i < window_->partition_num + window_->order_num; i++) {
+    const RelAttr &attr = window_->attrs[i];
+    const int index = find_input_field(input, attr.relation_name, attr.attribute_name);
+    if (index < 0) {
+      LOG_WARN("No such field for window. %s", attr.attribute_name);
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    const SortField field{index, input.field(index).type(), attr.is_desc == 1};
+    if (i < window_->partition_num) {
+      partition_fields_.push_back(field);
+    }
+    peer_fields_.push_back(field);
+  }
+
+  schema_ = input;
+  arg_indexes_.clear();
+  for (const WindowFunction &function : functions_) {
+    int index = -1;
+    if (0 != strcmp(function.arg, "*")) {
+      index = find_input_field(input, function.table_name, function.arg);
+      if (index < 0) {
+        LOG_WARN("No such field for window function. %s", function.arg);
+        return RC::SCHEMA_FIELD_MISSING;
+      }
+    }
+    const AttrType arg_type = index >= 0 ? input.field(index).type() : INTS;
+    if ((function.type == WindowFuncType::SUM || function.type == WindowFuncType::AVG) &&
+        (index < 0 || (arg_type != INTS && arg_type != FLOATS))) {
+      LOG_WARN("Window function %s needs a numeric argument", function.name.c_str());
+      return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+    }
+    if ((function.type == WindowFuncType::MIN || function.type == WindowFuncType::MAX) && index < 0) {
+      LOG_WARN("Window function %s needs an argument", function.name.c_str());
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    arg_indexes_.push_back(index);
+    schema_.add(WindowFunction::result_type(function.type, arg_type), "", function.name.c_str(),
+        WindowFunction::result_nullable(function.type));
+  }
+
+  release_memory();
+  peers_.clear();
+  peer_pos_ = 0;
+  new_partition_ = true;
+  rc = child_->next(next_);
+  has_next_ = rc == RC::SUCCESS;
+  if (has_next_) {
+    make_sort_key(next_, partition_fields_, next_partition_key_);
+    make_sort_key(next_, peer_fields_, next_peer_key_);
+  }
+  return rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+}
+
+/**
+ * 读出下一组peer，同时把它们加到分区的聚合中
+ */
+RC WindowExeNode::read_peers() {
+  const long previous = peers_.size();
+  peers_.clear();
+  peer_pos_ = 0;
+  release_memory();
+  if (!has_next_) {
+    return RC::RECORD_EOF;
+  }
+
+  if (new_partition_ || next_partition_key_ != partition_key_) {
+    states_.clear();
+    states_.resize(functions_.size());
+    partition_rows_ = 0;
+    peer_groups_ = 0;
+    partition_key_ = next_partition_key_;
+    new_partition_ = false;
+  } else {
+    partition_rows_ += previous;
+  }
+  peer_groups_++;
+  peer_key_ = next_peer_key_;
+
+  RC rc = RC::SUCCESS;
+  do {
+    const size_t bytes = next_.memory_size() + sizeof(Tuple);
+    if (memory_ != nullptr && !memory_->try_consume(bytes)) {
+      LOG_WARN("Window peer rows exceed query memory limit %lu. rows=%d", memory_->limit(), (int)peers_.size());
+      return RC::NOMEM;
+    }
+    memory_used_ += bytes;
+
+    for (size_t i = 0; i < functions_.size(); i++) {
+      const int index = arg_indexes_[i];
+      State &state = states_[i];
+      if (index >= 0 && next_.is_null(index)) {
+        continue;
+      }
+      switch (functions_[i].type) {
+        case WindowFuncType::COUNT: {
+          state.count++;
+        } break;
+        case WindowFuncType::SUM:
+        case WindowFuncType::AVG: {
+          state.sum += schema_.field(index).type() == FLOATS ? next_.get_float(index) : next_.get_int(index);
+          state.count++;
+        } break;
+        case WindowFuncType::MIN:
+        case WindowFuncType::MAX: {
+          const int cmp = state.count == 0 ? 0 : state.extreme.compare(0, next_, index);
+          if (state.count == 0 || (functions_[i].type == WindowFuncType::MIN ? cmp > 0 : cmp < 0)) {
+            Tuple extreme;
+            extreme.add(next_, index);
+            state.extreme = std::move(extreme);
+          }
+          state.count++;
+        } break;
+        default:
+          break;
+      }
+    }
+    peers_.emplace_back(std::move(next_));
+
+    rc = child_->next(next_);
+    if (rc != RC::SUCCESS) {
+      has_next_ = false;
+      break;
+    }
+    make_sort_key(next_, partition_fields_, next_partition_key_);
+    make_sort_key(next_, peer_fields_, next_peer_key_);
+  } while (next_peer_key_ == peer_key_);
+  return rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+}
+
+void WindowExeNode::output_peer(Tuple &tuple, int pos) {
+  tuple = std::move(peers_[pos]);
+  const int input_size = tuple.size();
+  for (size_t i = 0; i < functions_.size(); i++) {
+    const State &state = states_[i];
+    const AttrType type = schema_.field(input_size + i).type();
+    switch (functions_[i].type) {
+      case WindowFuncType::ROW_NUMBER: {
+        tuple.add((int)(partition_rows_ + pos + 1));
+      } break;
+      case WindowFuncType::RANK: {
+        tuple.add((int)(partition_rows_ + 1));
+      } break;
+      case WindowFuncType::DENSE_RANK: {
+        tuple.add((int)peer_groups_);
+      } break;
+      case WindowFuncType::COUNT: {
+        tuple.add((int)state.count);
+      } break;
+      case WindowFuncType::SUM: {
+        if (state.count == 0) {
+          add_null_value(tuple, type);
+        } else if (FLOATS == type) {
+          tuple.add((float)state.sum);
+        } else {
+          tuple.add((int)state.sum);
+        }
+      } break;
+      case WindowFuncType::AVG: {
+        if (state.count == 0) {
+          add_null_value(tuple, type);
+        } else {
+          tuple.add((float)(state.sum / state.count));
+        }
+      } break;
+      case WindowFuncType::MIN:
+      case WindowFuncType::MAX: {
+        if (state.count == 0) {
+          add_null_value(tuple, type);
+        } else {
+          tuple.add(state.extreme, 0);
+        }
+      } break;
+    }
+  }
+}
+
+RC WindowExeNode::do_next(Tuple &tuple) {
+  if (peer_pos_ >= peers_.size()) {
+    RC rc = read_peers();
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  output_peer(tuple, peer_pos_++);
+  return RC::SUCCESS;
+}
+
+RC WindowExeNode::do_close() {
+  peers_.clear();
+  states_.clear();
+  has_next_ = false;
+  release_memory();
+  return child_->close();
+}
+
+void WindowExeNode::release_memory() {
+  if (memory_ != nullptr) {
+    memory_->release(memory_used_);
+  }
+  memory_used_ = 0;
+}
+
+std::string WindowExeNode::explain() const {
+  std::string s = "WINDOW(";
+  for (size_t i = 0; i < functions_.size(); i++) {
+    s += (i > 0 ? ", " : "") + functions_[i].name;
+  }
+  return s + ")";
+}
+
+void WindowExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(child_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SortExeNode::~SortExeNode() {
+  close_runs();
+  delete child_;
+}
+
+RC SortExeNode::do_open() {
+  RC rc = child_->open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  // 提取排序信息，order_attrs_[0]是第一排序字段
+  fields_.clear();
+  const TupleSchema &schema = child_->schema();
+  for (int i = 0; i < order_num_; i++) {
+    int cnt = 0;
+    const RelAttr &attr = order_attrs_[i];
+    // 确定该属性与这张表有关
+    int index = -1;
+    if (attr.relation_name != nullptr) {
+      index = schema.index_of_field(attr.relation_name, attr.attribute_name);
+    } else {
+      // 不带属性名，可能出现二义性问题
+      const char *last_table_name = nullptr;
+      const int size = schema.fields().size();
+      for (int j = 0; j < size; ++j) {
+        if (strcmp(attr.attribute_name, schema.field(j).field_name()) == 0) {
+          if (cnt == 0) {
+            ++cnt;
+            last_table_name = schema.field(j).table_name();
+            index = j;
+          } else if (last_table_name != schema.field(j).table_name()) {
+            ++cnt;
+            break;
+          }
+        }
+      }
+    }
+
+    if (index == -1 || cnt > 1) {
+      // 有order信息但没有提取出来，说明出现错误的列名
+      LOG_WARN("Invalid order by field %s", attr.attribute_name);
+      child_->close();
+      return RC::GENERIC_ERROR;
+    }
+    fields_.push_back(SortField{index, schema.field(index).type(), attr.is_desc == 1});
+  }
+
+  output_count_ = 0;
+  pass_through_ = ordered_input_ != nullptr && ordered_input_->index_ordered();
+  if (pass_through_) {
+    // 扫描已经按排序字段的顺序输出了，边拉取边输出，子算子在close时关闭
+    tuples_.clear();
+    tuples_.set_schema(child_->schema());
+    return RC::SUCCESS;
+  }
+  rc = limit_ >= 0 ? top_n() : sort_all();
+  child_->close();
+  entry_pos_ = 0;
+  return rc;
+}
+
+RC SortExeNode::sort_all() {
+  close_runs();
+  release_memory();
+  tuples_.clear();
+  tuples_.set_schema(child_->schema());
+  entries_.clear();
+
+  RC rc = RC::SUCCESS;
+  Tuple tuple;
+  while ((rc = child_->next(tuple)) == RC::SUCCESS) {
+    SortEntry entry;
+    make_sort_key(tuple, fields_, entry.key);
+    const size_t bytes = sort_row_memory(entry.key, tuple);
+    if (memory_ != nullptr && !memory_->try_consume(bytes)) {
+      // 查询的内存不够时先写出已经缓存的数据，这一行放到下一段中
+      if (!entries_.empty()) {
+        rc = spill_run();
+        if (rc != RC::SUCCESS) {
+          return rc;
+        }
+      }
+      memory_->consume(bytes);
+    }
+    memory_used_ += bytes;
+    entry.index = tuples_.size();
+    entries_.push_back(std::move(entry));
+    tuples_.add(std::move(tuple));
+    if (memory_used_ >= memory_budget_) {
+      rc = spill_run();
+      if (rc != RC::SUCCESS) {
+        return rc;
+      }
+    }
+  }
+  if (rc != RC::RECORD_EOF) {
+    return rc;
+  }
+
+  if (runs_.empty()) {
+    sort_entries(entries_);
+    return RC::SUCCESS;
+  }
+  if (!entries_.empty()) {
+    rc = spill_run();
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  LOG_INFO("External sort merges %d runs", (int)runs_.size());
+  std::vector<FILE *> files;
+  for (const Run &run : runs_) {
+    files.push_back(run.file);
+  }
+  return merger_.init(tuples_.get_schema(), files);
+}
+
+/**
+ * 把缓存的数据排好序写到一个临时文件中
+ */
+RC SortExeNode::spill_run() {
+  sort_entries(entries_);
+  FILE *file = SpillFileManager::instance().create(memory_ != nullptr ? memory_->spill() : nullptr);
+  if (nullptr == file) {
+    LOG_ERROR("Failed to create temporary file for sort. error=%s", strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  runs_.push_back(Run{file, 0});
+  for (const SortEntry &entry : entries_) {
+    RC rc = write_sort_row(file, entry.key, tuples_.get(entry.index), tuples_.get_schema());
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  entries_.clear();
+  tuples_.clear_tuples();
+  release_memory();
+  return merge_runs();
+}
+
+void SortExeNode::release_memory() {
+  if (memory_ != nullptr) {
+    memory_->release(memory_used_);
+  }
+  memory_used_ = 0;
+}
+
+/**
+ * 最后的SORT_MERGE_FAN_IN个段在同一层时归并成上一层的一段，段的顺序不变
+ */
+RC SortExeNode::merge_runs() {
+  while (runs_.size() >= SORT_MERGE_FAN_IN) {
+    const int level = runs_.back().level;
+    const size_t first = runs_.size() - SORT_MERGE_FAN_IN;
+    if (runs_[first].level != level) {
+      break;
+    }
+
+    std::vector<FILE *> files;
+    for (size_t i = first; i < runs_.size(); i++) {
+      files.push_back(runs_[i].file);
+    }
+    FILE *file = SpillFileManager::instance().create(memory_ != nullptr ? memory_->spill() : nullptr);
+    if (nullptr == file) {
+      LOG_ERROR("Failed to create temporary file for sort. error=%s", strerror(errno));
+      return RC::IOERR_ACCESS;
+    }
+    SortRunMerger merger;
+    RC rc = merger.init(tuples_.get_schema(), files);
+    std::string key;
+    Tuple tuple;
+    unsigned int cancel_check = 0;
+    while (rc == RC::SUCCESS && (rc = merger.next(key, tuple)) == RC::SUCCESS) {
+      rc = write_sort_row(file, key, tuple, tuples_.get_schema());
+      if (rc == RC::SUCCESS && QueryCancel::poll(cancel_check)) {
+        rc = RC::INTERRUPT;
+      }
+    }
+    for (FILE *merged : files) {
+      fclose(merged);
+    }
+    runs_.resize(first);
+    runs_.push_back(Run{file, level + 1});
+    if (rc != RC::RECORD_EOF) {
+      return rc;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+void SortExeNode::close_runs() {
+  for (Run &run : runs_) {
+    fclose(run.file);
+  }
+  runs_.clear();
+}
+
+RC SortExeNode::top_n() {
+  // 用大顶堆保留当前最小的limit个，堆顶是其中最大的
+  struct Candidate {
+    SortEntry entry;
+    Tuple tuple;
+    bool operator<(const Candidate &other) const {
+      return entry < other.entry;
+    }
+  };
+  std::vector<Candidate> heap;
+  tuples_.clear();
+  tuples_.set_schema(child_->schema());
+
+  RC rc = RC::SUCCESS;
+  Candidate candidate;
+  for (int seq = 0; limit_ > 0 && (rc = child_->next(candidate.tuple)) == RC::SUCCESS; seq++) {
+    make_sort_key(candidate.tuple, fields_, candidate.entry.key);
+    candidate.entry.index = seq;
+    if ((int)heap.size() < limit_) {
+      heap.push_back(std::move(candidate));
+      std::push_heap(heap.begin(), heap.end());
+    } else if (candidate.entry < heap.front().entry) {
+      std::pop_heap(heap.begin(), heap.end());
+      std::swap(heap.back(), candidate);
+      std::push_heap(heap.begin(), heap.end());
+    }
+  }
+  if (rc != RC::SUCCESS && rc != RC::RECORD_EOF) {
+    return rc;
+  }
+
+  std::sort_heap(heap.begin(), heap.end());
+  entries_.resize(heap.size());
+  for (size_t i = 0; i < heap.size(); i++) {
+    tuples_.add(std::move(heap[i].tuple));
+    entries_[i].index = i;
+  }
+  return RC::SUCCESS;
+}
+
+RC SortExeNode::do_next(Tuple &tuple) {
+  if (pass_through_) {
+    if (limit_ >= 0 && output_count_ >= limit_) {
+      return RC::RECORD_EOF;
+    }
+    RC rc = child_->next(tuple);
+    if (rc == RC::SUCCESS) {
+      output_count_++;
+    }
+    return rc;
+  }
+  if (!runs_.empty()) {
+    std::string key;
+    return merger_.next(key, tuple);
+  }
+  if (entry_pos_ >= entries_.size()) {
+    return RC::RECORD_EOF;
+  }
+  tuple = std::move(tuples_.mutable_tuple(entries_[entry_pos_++].index));
+  return RC::SUCCESS;
+}
+
+RC SortExeNode::do_close() {
+  tuples_.clear_tuples();
+  entries_.clear();
+  release_memory();
+  close_runs();
+  return child_->close();
+}
+
+std::string SortExeNode::explain() const {
+  std::string s = "SORT(";
+  for (int i = 0; i < order_num_; i++) {
+    s += (i > 0 ? ", " : "") + attr_name(order_attrs_[i]) + (order_attrs_[i].is_desc ? " DESC" : "");
+  }
+  if (limit_ >= 0) {
+    s += ", top=" + std::to_string(limit_);
+  }
+  if (ordered_input_ != nullptr) {
+    s += ", index order";
+  }
+  return s + ")";
+}
+
+void SortExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(child_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+LimitExeNode::~LimitExeNode() {
+  delete child_;
+}
+
+RC LimitExeNode::do_open() {
+  count_ = 0;
+  skipped_ = 0;
+  return child_->open();
+}
+
+RC LimitExeNode::do_next(Tuple &tuple) {
+  if (count_ >= limit_) {
+    return RC::RECORD_EOF;
+  }
+  // 跳过前面offset个tuple
+  for (; skipped_ < offset_; skipped_++) {
+    RC rc = child_->next(tuple);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  RC rc = child_->next(tuple);
+  if (rc == RC::SUCCESS) {
+    count_++;
+  }
+  return rc;
+}
+
+RC LimitExeNode::do_close() {
+  return child_->close();
+}
+
+std::string LimitExeNode::explain() const {
+  return "LIMIT(" + std::to_string(limit_) + ", offset=" + std::to_string(offset_) + ")";
+}
+
+void LimitExeNode::children(std::vector<ExecutionNode *> &children) const {
+  children.push_back(child_);
+}
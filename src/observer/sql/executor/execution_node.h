@@ -15,36 +15,1077 @@ See the Mulan PSL v2 for more details. */
 #ifndef __OBSERVER_SQL_EXECUTOR_EXECUTION_NODE_H_
 #define __OBSERVER_SQL_EXECUTOR_EXECUTION_NODE_H_
 
+#include <list>
+#include <ostream>
+#include <string>
 #include <vector>
 #include <unordered_map>
+#include <stdio.h>
 #include "storage/common/condition_filter.h"
+#include "storage/common/table_scanner.h"
+#include "storage/common/column_stats.h"
 #include "sql/executor/tuple.h"
+#include "sql/executor/tuple_batch.h"
+#include "sql/executor/tuple_sort.h"
+#include "sql/executor/distinct_set.h"
+#include "sql/executor/expression.h"
+#include "sql/executor/memory_tracker.h"
 
 class Table;
 class Trx;
+class Index;
 
+class AttrFunction
+{
+public:
+  void add_function_type(const std::string &attr_name, FuncType function_type, const char *table_name)
+  {
+    
+    attr_function_type_.emplace_back(attr_name, function_type);
+    table_names_.emplace_back(table_name);
+    distinct_estimates_.push_back(0);
+  }
+
+  std::string to_string(int i, int rel_num)
+  {
+    FuncType type = attr_function_type_[i].second;
+    std::string attr = attr_function_type_[i].first;
+    std::string s;
+
+    switch (type)
+    {
+    case FuncType::COUNT:
+    {
+      s = std::string("count(");
+    }
+    break;
+
+    case FuncType::AVG:
+    {
+      s = std::string("avg(");
+    }
+    break;
+
+    case FuncType::SUM:
+    {
+      s = std::string("sum(");
+    }
+    break;
+
+    case FuncType::MAX:
+    {
+      s = std::string("max(");
+    }
+    break;
+
+    case FuncType::MIN:
+    {
+      s = std::string("min(");
+    }
+    break;
+
+    case FuncType::COUNT_DISTINCT:
+    {
+      s = std::string("count(distinct ");
+    }
+    break;
+
+    case FuncType::APPROX_COUNT_DISTINCT:
+    {
+      s = std::string("approx_count_distinct(");
+    }
+    break;
+
+    default:
+      s = std::string("undefined(");
+      break;
+    }
+
+    if (table_names_[i] != nullptr && rel_num > 1) {
+      // 修改：只在多表的时候显示表名
+      s = s + std::string(table_names_[i]) + std::string(".");
+    }
+
+    s = s + attr + std::string(")");
+
+    return s;
+  }
+
+  FuncType get_function_type(int i)
+  {
+    return attr_function_type_[i].second;
+  }
+
+  const char *get_table_name(int i)
+  {
+    return table_names_[i];
+  }
+
+  const char *get_attr_name(int i)
+  {
+    return attr_function_type_[i].first.c_str();
+  }
+
+  int get_size()
+  {
+    return attr_function_type_.size();
+  }
+
+  /**
+   * COUNT(DISTINCT)预计的不同值个数，来自统计信息，用来预先分配hash集合
+   */
+  void set_distinct_estimate(int i, int64_t estimate)
+  {
+    distinct_estimates_[i] = estimate;
+  }
+  int64_t get_distinct_estimate(int i) const
+  {
+    return distinct_estimates_[i];
+  }
+
+private:
+  std::vector<std::pair<std::string, FuncType>> attr_function_type_; // 存储<属性名，函数类型>
+  std::vector<const char *> table_names_;                            // 存储对应的table名
+  std::vector<int64_t> distinct_estimates_;
+};
+
+/**
+ * EXPLAIN ANALYZE时一个算子实际的执行情况。时间、页面和内存包含子算子的部分，页面只统计执行查询的线程
+ */
+struct ExecutionProfile {
+  bool enabled = false;
+  long loops = 0;       // open的次数，索引嵌套循环join的内表每次查找算一次
+  long rows = 0;        // 输出的tuple数
+  long time_ns = 0;
+  long pages_hit = 0;   // 访问时已经在缓冲池中的页面
+  long pages_read = 0;  // 从磁盘加载的页面
+  size_t bytes = 0;     // 向MemoryTracker申请的内存
+};
+
+/**
+ * 执行计划中的算子，按照拉取的方式执行：open之后反复调用next取出tuple，直到返回RECORD_EOF，最后close。
+ * 只有排序、聚合和join的内表需要缓存数据，其它算子每次只处理一个tuple。
+ * schema在open成功之后有效，join算子在创建之后就有效，子算子由父算子负责释放。
+ * 子类实现do_open等函数，open等函数在打开profile时记录算子的执行情况
+ */
 class ExecutionNode {
 public:
   ExecutionNode() = default;
   virtual ~ExecutionNode() = default;
 
-  virtual RC execute(TupleSet &tuple_set) = 0;
+  RC open();
+  RC next(Tuple &tuple);
+  RC close();
+  virtual const TupleSchema &schema() const = 0;
+
+  /**
+   * 按列取出下一批tuple，batch需要先用schema和需要的列初始化。
+   * 返回的批次不为空，没有更多数据时返回RECORD_EOF。同一次执行中不要和next混用
+   */
+  RC next_batch(TupleBatch &batch);
+
+  /**
+   * 取出所有的tuple放到tuple_set中
+   */
+  virtual RC execute(TupleSet &tuple_set);
+
+  /**
+   * 算子的名字和参数，比如HASH_JOIN(t1.id=t2.id)
+   */
+  virtual std::string explain() const = 0;
+  /**
+   * 按照输出中的顺序添加直接的子算子
+   */
+  virtual void children(std::vector<ExecutionNode *> &children) const {
+  }
+  /**
+   * 在open之前打开这个算子和所有子算子的profile，memory是查询的MemoryTracker，可以为nullptr
+   */
+  void enable_profile(MemoryTracker *memory);
+  const ExecutionProfile &profile() const {
+    return profile_;
+  }
+  /**
+   * 每个算子一行，子算子比父算子多缩进一层。analyze为true时在每行后面加上profile
+   */
+  void explain_tree(std::ostream &os, bool analyze, int depth = 0) const;
+
+protected:
+  virtual RC do_open() = 0;
+  virtual RC do_next(Tuple &tuple) = 0;
+  virtual RC do_next_batch(TupleBatch &batch);
+  virtual RC do_close() = 0;
+
+protected:
+  ExecutionProfile profile_;
+  MemoryTracker *profile_memory_ = nullptr;
+
+private:
+  unsigned int cancel_check_ = 0;  // next每调用QUERY_CANCEL_CHECK_INTERVAL次检查一次语句是否被取消
 };
 
+#define PARALLEL_SCAN_MIN_PAGES 64   // 页面数少于这个值的表不并行扫描
+#define PARALLEL_SCAN_MAX_THREADS 8
+
+/**
+ * 扫描一张表，只输出满足这张表上的过滤条件的记录。每次从TableScanner中取一批记录缓存起来
+ */
 class SelectExeNode : public ExecutionNode {
 public:
   SelectExeNode();
   virtual ~SelectExeNode();
 
-  RC init(Trx *trx, Table *table, TupleSchema && tuple_schema, std::vector<DefaultConditionFilter *> &&condition_filters);
+  RC init(Trx *trx, Table *table, TupleSchema && tuple_schema, std::vector<ConditionFilter *> &&condition_filters);
+
+  const TupleSchema &schema() const override {
+    return tuple_schema_;
+  }
+  std::string explain() const override;
+
+  /**
+   * 重新开始扫描，只返回index第一个字段等于key并且满足过滤条件的记录。不需要先调用open
+   */
+  RC open_lookup(Index *index, const char *key);
+  Table *table() const {
+    return table_;
+  }
+  Trx *trx() const {
+    return trx_;
+  }
+  /**
+   * 输出表中的所有记录：没有过滤条件和limit，也不是索引嵌套循环join的内表
+   */
+  bool unfiltered() const {
+    return condition_filters_.empty() && limit_ < 0 && lookup_index_ == nullptr;
+  }
+  /**
+   * 表足够大并且扫描时不会用索引时返回true，这时可以用parallel_scan
+   */
+  bool parallel_scannable();
+  /**
+   * 用thread_num个线程并行地顺序扫描表，每个线程按页面领取morsel，读到的每一批记录交给consumer。
+   * consumer在各个线程中并发调用，worker是线程的编号，批次中只有columns中的列，各批之间没有顺序。
+   * 不需要先调用open
+   */
+  RC parallel_scan(int thread_num, const std::vector<int> &columns,
+      void (*consumer)(const TupleBatch &batch, int worker, void *context), void *context);
+  /**
+   * 最多读取limit条满足条件的记录，小于0时不限制。在open之前设置
+   */
+  void set_limit(int limit) {
+    limit_ = limit;
+  }
+  /**
+   * 在open之前替换输出的字段。最后两个字段是RID_PAGE_FIELD和RID_SLOT_FIELD时输出记录的rid，用于延迟物化
+   */
+  void set_schema(TupleSchema &&tuple_schema) {
+    tuple_schema_ = std::move(tuple_schema);
+  }
+  /**
+   * 作为索引嵌套循环join的内表，每次用open_lookup在index上查找，EXPLAIN时输出这个索引
+   */
+  void set_lookup_index(Index *index) {
+    lookup_index_ = index;
+  }
+  /**
+   * 在open之前设置，要求按order_fields的顺序输出，descending为true时从大到小。有合适的索引时按索引的顺序扫描，
+   * open之后用index_ordered判断输出是否真的有序
+   */
+  void set_order(std::vector<const FieldMeta *> &&order_fields, bool descending) {
+    order_fields_ = std::move(order_fields);
+    descending_ = descending;
+  }
+  bool index_ordered() const {
+    return index_ordered_;
+  }
+  /**
+   * set_order之后按顺序扫描会用的索引，没有时返回nullptr
+   */
+  Index *order_index() const;
+  /**
+   * 没有过滤条件时按索引的顺序找field第一个不是null的值，descending为true时是最大值，用于MIN/MAX。
+   * 没有合适的索引或者表中有别的事务的修改时返回false，调用者需要扫描。has_rows返回有没有可见的记录，
+   * found返回有没有不是null的值，value是这个值在记录中的数据。不需要先调用open
+   */
+  bool first_in_index_order(const FieldMeta *field, bool descending, bool *has_rows, bool *found,
+      std::vector<char> &value);
 
-  RC execute(TupleSet &tuple_set) override;
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  /**
+   * 记录直接转换到batch中，不构造Tuple
+   */
+  RC do_next_batch(TupleBatch &batch) override;
+  RC do_close() override;
+
+private:
+  static void record_reader(const char *data, void *context);
 
 private:
   Trx *trx_ = nullptr;
   Table  * table_;
   TupleSchema  tuple_schema_;
-  std::vector<DefaultConditionFilter *> condition_filters_;
+  std::vector<ConditionFilter *> condition_filters_;
+  CompositeConditionFilter condition_filter_;
+  TableScanner scanner_;
+  TupleSet batch_;
+  TupleRecordConverter *converter_ = nullptr;
+  int batch_pos_ = 0;
+  int limit_ = -1;
+  Index *lookup_index_ = nullptr;
+  std::vector<const FieldMeta *> order_fields_;
+  bool descending_ = false;
+  bool index_ordered_ = false;
+};
+
+/**
+ * 嵌套循环求两个输入的笛卡尔积，输出的tuple是左边的字段后面跟着右边的字段。
+ * 右边(内表)在open时全部读出来，左边每次取一个tuple。内表超出查询的内存限制时返回RC::NOMEM
+ */
+class NestedLoopJoinExeNode : public ExecutionNode {
+public:
+  NestedLoopJoinExeNode(ExecutionNode *left, ExecutionNode *right, MemoryTracker *memory = nullptr)
+      : left_(left), right_(right), memory_(memory) {
+    schema_.append(left->schema());
+    schema_.append(right->schema());
+  }
+  virtual ~NestedLoopJoinExeNode();
+
+  const TupleSchema &schema() const override {
+    return schema_;
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  ExecutionNode *left_;
+  ExecutionNode *right_;
+  MemoryTracker *memory_;
+  size_t memory_used_ = 0;
+  TupleSchema schema_;
+  std::vector<Tuple> inner_tuples_;
+  Tuple outer_tuple_;
+  size_t inner_pos_ = 0;
+  bool has_outer_ = false;
+};
+
+/**
+ * 索引嵌套循环join。左边每次取一个tuple，用join字段的值在右边表的索引上查找匹配的记录，
+ * 右边的表不用全部读出来，代价只和左边的行数以及匹配的行数有关。字段的类型要求和hash join相同
+ */
+class IndexNestedLoopJoinExeNode : public ExecutionNode {
+public:
+  /**
+   * left_index是join字段在左边输入中的位置，index的第一个字段是右边表中对应的字段
+   */
+  IndexNestedLoopJoinExeNode(ExecutionNode *left, SelectExeNode *right, int left_index, Index *index)
+      : left_(left), right_(right), left_index_(left_index), index_(index) {
+    schema_.append(left->schema());
+    schema_.append(right->schema());
+    right->set_lookup_index(index);
+  }
+  virtual ~IndexNestedLoopJoinExeNode();
+
+  const TupleSchema &schema() const override {
+    return schema_;
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  /**
+   * 把左边tuple中join字段的值转换成索引中的格式，null或者不可能匹配时返回false
+   */
+  bool make_key(const Tuple &tuple);
+
+private:
+  ExecutionNode *left_;
+  SelectExeNode *right_;
+  int left_index_;
+  Index *index_;
+  const FieldMeta *key_field_ = nullptr;
+  TupleSchema schema_;
+  Tuple outer_tuple_;
+  bool has_outer_ = false;
+  std::vector<char> key_;
+};
+
+#define HASH_JOIN_PARTITIONS 32  // build端放不下时两边的输入按照hash值分到这么多个临时文件中
+#define HASH_JOIN_PARALLEL_ROWS 65536             // 两边一共超过这么多行时分区之后用多个线程join
+#define HASH_JOIN_PARTITION_BYTES (256 * 1024)    // 并行join时每个分区build端的大小，放得进cache
+#define HASH_JOIN_MAX_RADIX_PARTITIONS 4096
+
+/**
+ * 等值条件的hash join。build端在open时全部读出来，按照join字段建hash表，
+ * probe端每次取一个tuple去hash表中查找。默认右边是build端，输出的顺序和NestedLoopJoinExeNode加上过滤条件相同；
+ * 优化器估计左边的行数更少时用set_build_left改为左边建hash表，这时输出按右边的顺序，输出的列仍然是左边在前。
+ * join字段的类型需要相同并且不能是FLOATS(浮点数按误差比较相等)，字段为null时不匹配。
+ * 有多个CPU时probe端也在open时全部读到内存中，两边一共超过HASH_JOIN_PARALLEL_ROWS行时按照key的hash值
+ * 分成很多个放得进cache的分区，多个线程各自领取分区建hash表并查找，输出的顺序不变。
+ * probe端放不下时不再并行，建好hash表之后先查找已经读入的tuple。
+ * build端超出查询的内存限制时，两边的输入都按照key的hash值写到临时文件的分区中，再逐个分区join，
+ * 这时输出的顺序按分区排列。一个分区的build端仍然放不下时返回RC::NOMEM
+ */
+class HashJoinExeNode : public ExecutionNode {
+public:
+  /**
+   * key_fields中每一项是一个等值条件左右两个字段分别在左右输入中的位置
+   */
+  HashJoinExeNode(ExecutionNode *left, ExecutionNode *right, std::vector<std::pair<int, int>> &&key_fields,
+      MemoryTracker *memory = nullptr)
+      : left_(left), right_(right), key_fields_(std::move(key_fields)), memory_(memory) {
+    schema_.append(left->schema());
+    schema_.append(right->schema());
+  }
+  virtual ~HashJoinExeNode();
+
+  const TupleSchema &schema() const override {
+    return schema_;
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+  /**
+   * 并行join使用的线程数，0表示CPU核数(最多PARALLEL_SCAN_MAX_THREADS)，1表示不并行。在open之前设置
+   */
+  void set_parallelism(int threads) {
+    parallelism_ = threads;
+  }
+  /**
+   * 用左边建hash表，右边去查找。在open之前设置
+   */
+  void set_build_left(bool build_left) {
+    build_left_ = build_left;
+  }
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  /**
+   * 按照join字段生成hash表的key，build表示tuple来自build端。有字段为null时返回false
+   */
+  bool make_key(const Tuple &tuple, bool build, std::string &key) const;
+  RC add_build_tuple(std::string &key, Tuple &tuple);
+  RC spill_build();
+  RC spill_probe();
+  RC next_probe(Tuple &tuple);
+  RC load_partition(int partition);
+  /**
+   * 按左边在前的顺序拼接两边的tuple
+   */
+  void merge_joined(const Tuple &probe, const Tuple &build, Tuple &tuple) const;
+  ExecutionNode *build_input() const {
+    return build_left_ ? left_ : right_;
+  }
+  ExecutionNode *probe_input() const {
+    return build_left_ ? right_ : left_;
+  }
+  /**
+   * 读入probe端所有key不为null的tuple，然后并行join。内存不够时从build_keys_建hash表，改为逐个查找
+   */
+  RC buffer_probe();
+  RC radix_join(int thread_num, size_t build_bytes);
+  void build_hash_table();
+  void clear_hash_table();
+  void close_partitions();
+
+private:
+  ExecutionNode *left_;
+  ExecutionNode *right_;
+  std::vector<std::pair<int, int>> key_fields_;
+  MemoryTracker *memory_;
+  size_t memory_used_ = 0;
+  std::vector<FILE *> build_files_;  // 不为空时两边的输入都已经分区
+  std::vector<FILE *> probe_files_;
+  int partition_ = 0;                // 正在join的分区
+  TupleSchema schema_;
+  std::vector<Tuple> build_tuples_;
+  std::unordered_map<std::string, std::vector<int>> hash_table_;  // key对应的build_tuples_中的位置
+  Tuple probe_tuple_;
+  const std::vector<int> *matches_ = nullptr;
+  size_t match_pos_ = 0;
+  std::string key_;
+
+  int parallelism_ = 0;
+  bool build_left_ = false;
+  bool radix_ = false;                   // build端的key在build_keys_中，还没有建hash表
+  bool joined_ = false;                  // radix_join已经完成，按probe_heads_输出
+  std::vector<std::string> build_keys_;
+  std::vector<Tuple> probe_tuples_;      // 读入内存的probe端的tuple
+  std::vector<std::string> probe_keys_;
+  size_t probe_pos_ = 0;
+  std::vector<int> probe_heads_;         // 每个probe端tuple匹配的第一个build tuple，没有时是-1
+  std::vector<int> build_chain_;         // 同一个key的下一个build tuple，按build的顺序
+  int match_ = -1;
+};
+
+/**
+ * 按照两边都是字段的条件过滤，比如join条件t1.id = t2.id
+ */
+class FilterExeNode : public ExecutionNode {
+public:
+  FilterExeNode(ExecutionNode *child, std::vector<const Condition *> &&conditions)
+      : child_(child), conditions_(std::move(conditions)) {
+  }
+  virtual ~FilterExeNode();
+
+  const TupleSchema &schema() const override {
+    return child_->schema();
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  ExecutionNode *child_;
+  std::vector<const Condition *> conditions_;
+  std::vector<std::pair<int, int>> field_indexes_;  // 每个条件左右两个字段在tuple中的位置
+};
+
+/**
+ * 按照schema中字段的(表名, 字段名)从输入中取出需要的列。open时把字段解析成输入中的位置，
+ * 输出和输入的列完全相同时直接传递输入的tuple
+ */
+class ProjectExeNode : public ExecutionNode {
+public:
+  ProjectExeNode(ExecutionNode *child, const TupleSchema &schema) : child_(child), schema_(schema) {
+  }
+  virtual ~ProjectExeNode();
+
+  const TupleSchema &schema() const override {
+    return schema_;
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  ExecutionNode *child_;
+  TupleSchema schema_;
+  std::vector<int> field_indexes_;  // 每个输出字段在输入中的位置
+  bool identity_ = false;
+};
+
+/**
+ * 按批计算select中的表达式和用到多张表的表达式条件。每次从子算子取一批数据，先按条件过滤，
+ * 再一列一列地计算输出。输出可以是输入中的字段或者表达式，没有给出输出时只过滤，输出和输入相同
+ */
+class ExpressionExeNode : public ExecutionNode {
+public:
+  struct Output {
+    const Expr *expr = nullptr;  // 为nullptr时输出输入中(table_name, field_name)的字段
+    std::string table_name;
+    std::string field_name;
+  };
+
+  ExpressionExeNode(ExecutionNode *child, std::vector<const ExprCondition *> &&conditions, std::vector<Output> &&outputs)
+      : child_(child), conditions_(std::move(conditions)), outputs_(std::move(outputs)) {
+  }
+  virtual ~ExpressionExeNode();
+
+  const TupleSchema &schema() const override {
+    return outputs_.empty() ? child_->schema() : schema_;
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  ExecutionNode *child_;
+  std::vector<const ExprCondition *> conditions_;
+  std::vector<Output> outputs_;
+  TupleSchema schema_;
+  std::unique_ptr<ExprProgram> program_;  // open时按输入的schema编译
+  ExprContext context_;
+  TupleBatch batch_;
+  std::vector<uint8_t> sel_;
+  std::vector<Tuple> rows_;  // 当前一批计算好的输出
+  size_t row_pos_ = 0;
+};
+
+/**
+ * 延迟物化：join之前的扫描只读出join用到的字段和记录的rid，join之后再按rid从表中读出其它需要输出的字段，
+ * 被join过滤掉的行不用读取这些字段，join的中间结果也更小。
+ * 输出的schema是输入去掉rid字段，再加上每张表延迟读取的字段。open之后close之前这些表的记录不会被整理移动
+ */
+class MaterializeExeNode : public ExecutionNode {
+public:
+  explicit MaterializeExeNode(ExecutionNode *child) : child_(child) {
+  }
+  virtual ~MaterializeExeNode();
+
+  /**
+   * fields是table延迟读取的字段，输入中要有这张表的rid字段
+   */
+  void add_table(Table *table, TupleSchema &&fields);
+
+  const TupleSchema &schema() const override {
+    return schema_;
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  struct Source {
+    Table *table;
+    TupleSet fields;                              // 只使用schema，转换时不添加tuple
+    TupleRecordConverter *converter = nullptr;
+    int page_index = -1;                          // rid在输入中的位置
+    int slot_index = -1;
+  };
+
+  ExecutionNode *child_;
+  std::list<Source> sources_;
+  TupleSchema schema_;
+  std::vector<int> field_indexes_;                // 输入中不是rid的字段
+  std::vector<char> data_;
+  bool locked_ = false;
+};
+
+/**
+ * 一个聚合函数的中间结果
+ */
+struct AggregateState {
+  int index = -1;                 // 参数在输入中的位置，比如COUNT(*)这样的参数是-1
+  AttrType type = UNDEFINED;
+  int count = 0;                  // 遇到的非null值的个数
+  int64_t int_sum = 0;
+  float float_sum = 0;
+  int int_value = 0;              // MAX/MIN当前的结果
+  float float_value = 0;
+  std::string chars_value;
+  DistinctHashSet distinct_values;  // COUNT(DISTINCT)见过的值
+  HyperLogLog sketch;               // APPROX_COUNT_DISTINCT
+
+  /**
+   * 中间结果占用的堆内存
+   */
+  size_t memory_size() const {
+    return chars_value.capacity() + distinct_values.memory_size() + sketch.memory_size();
+  }
+};
+
+/**
+ * 在open时按批读取所有的输入，每个聚合函数用按列计算的内核累加，最后输出一个tuple。
+ * 所有的聚合函数在同一次读取中累加，同一列上的多个聚合函数每批只遍历一次这一列。
+ * 输入为空时不计算，直接输出空的结果，schema和输入相同。
+ * COUNT(DISTINCT)的hash集合占用的内存计入查询的MemoryTracker，超过限制时查询失败
+ */
+class AggregateExeNode : public ExecutionNode {
+public:
+  AggregateExeNode(ExecutionNode *child, AttrFunction *attr_function, int rel_num, MemoryTracker *memory = nullptr)
+      : child_(child), attr_function_(attr_function), rel_num_(rel_num), memory_(memory) {
+  }
+  virtual ~AggregateExeNode();
+
+  const TupleSchema &schema() const override {
+    return result_.get_schema();
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  /**
+   * 参数是同一列的聚合函数
+   */
+  struct ColumnFunctions {
+    int index;
+    AttrType type;
+    std::vector<int> functions;
+  };
+
+  void accumulate(AggregateState &state, FuncType func_type, const TupleBatch &batch) const;
+  void accumulate_column(const ColumnFunctions &column, const TupleBatch &batch, std::vector<AggregateState> &states) const;
+  /**
+   * 输入是一张大表的扫描时分到多个线程上扫描和累加，最后合并每个线程的中间结果。不能并行时返回false
+   */
+  bool parallel_accumulate(const std::vector<int> &columns, int &row_count, RC &rc);
+  static void accumulate_worker_batch(const TupleBatch &batch, int worker, void *context);
+  RC make_result(int row_count);
+  /**
+   * 只有MIN/MAX并且没有过滤条件时，每个函数从参数字段上的索引的一端读第一个值，不扫描全表。
+   * 不能这样计算时返回false
+   */
+  bool index_extremes(int &row_count);
+  /**
+   * 按中间结果现在占用的内存向MemoryTracker申请增加的部分，超过查询的内存限制时返回NOMEM
+   */
+  RC track_state_memory();
+  void release_memory();
+
+private:
+  ExecutionNode *child_;
+  AttrFunction *attr_function_;
+  int rel_num_;
+  MemoryTracker *memory_;
+  size_t memory_used_ = 0;
+  bool has_distinct_ = false;  // 有COUNT(DISTINCT)或者APPROX_COUNT_DISTINCT，中间结果会增长
+  std::vector<AggregateState> states_;
+  std::vector<ColumnFunctions> columns_;
+  TupleSet result_;
+  int result_pos_ = 0;
+};
+
+#define HASH_AGGREGATE_MEMORY_BUDGET (64 * 1024 * 1024)  // hash表估计占用的内存超过这个值时新的分组写到临时文件中
+#define HASH_AGGREGATE_PARTITIONS 16                     // 每次溢出时把数据按hash值分到这么多个临时文件中
+#define HASH_AGGREGATE_MAX_DEPTH 4                       // 最多递归分区的层数，之后不再溢出
+
+/**
+ * 用hash表做GROUP BY，每个分组的所有聚合函数在读取输入时一起累加，只读一遍输入。
+ * hash表超过内存预算或者查询的内存限制时已有的分组继续在内存中累加，新分组的行按照hash值写到临时文件的分区中，
+ * 内存中的分组输出完之后再逐个读入分区聚合，同一个分组的行总是在同一个分区里。
+ * 没有溢出时分组按照第一次出现的顺序输出，溢出时先按这个顺序输出内存中的分组，再输出各个分区中的分组。
+ * NULL值作为一个分组。
+ * 输入按分组字段的索引顺序扫描时，同一个分组的行是连续的，每个分组读完就输出，只保存当前的一个分组
+ */
+class HashAggregateExeNode : public ExecutionNode {
+public:
+  /**
+   * 输出的一列，is_group为true时是group_attrs中的第index个字段，否则是attr_function中的第index个聚合函数
+   */
+  struct Output {
+    bool is_group;
+    int index;
+  };
+
+  HashAggregateExeNode(ExecutionNode *child, const RelAttr *group_attrs, int group_num, AttrFunction *attr_function,
+      std::vector<Output> &&outputs, int rel_num, MemoryTracker *memory = nullptr,
+      size_t memory_budget = HASH_AGGREGATE_MEMORY_BUDGET)
+      : child_(child), group_attrs_(group_attrs), group_num_(group_num), attr_function_(attr_function),
+        outputs_(std::move(outputs)), rel_num_(rel_num), memory_(memory), memory_budget_(memory_budget) {
+  }
+  virtual ~HashAggregateExeNode();
+
+  const TupleSchema &schema() const override {
+    return schema_;
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+  /**
+   * 输入是按分组字段的索引顺序扫描的单表时，open之后扫描确实有序就边读边输出分组，不再建hash表
+   */
+  void set_ordered_input(SelectExeNode *scan) {
+    ordered_input_ = scan;
+  }
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  struct Group {
+    std::string key;
+    int row_count = 0;
+    std::vector<AggregateState> states;
+  };
+
+  struct Partition {
+    FILE *file;
+    int depth;
+  };
+
+  void make_key(const TupleBatch &batch, int row, std::string &key) const;
+  RC aggregate_batch(const TupleBatch &batch, int depth, std::vector<FILE *> &spills);
+  RC spill_row(const TupleBatch &batch, int row, FILE *file) const;
+  RC load_partition(FILE *file, TupleBatch &batch, bool &eof) const;
+  RC aggregate_partition(const Partition &partition);
+  RC make_tuple(const Group &group, Tuple &tuple) const;
+  /**
+   * 有序的输入中读到分组字段变化或者输入结束时输出当前的分组
+   */
+  RC next_sorted_group(Tuple &tuple);
+  void clear_groups();
+  void close_partitions();
+
+private:
+  ExecutionNode *child_;
+  const RelAttr *group_attrs_;
+  int group_num_;
+  AttrFunction *attr_function_;
+  std::vector<Output> outputs_;
+  int rel_num_;
+  MemoryTracker *memory_;
+  size_t memory_budget_;
+
+  TupleSchema input_schema_;
+  std::vector<int> group_indexes_;  // 分组字段在输入中的位置
+  std::vector<int> columns_;        // 批次中保存的列：分组字段和聚合函数的参数
+  std::vector<AggregateState> initial_states_;
+  TupleSchema schema_;
+
+  std::vector<Group> groups_;
+  std::unordered_map<std::string, int> group_map_;
+  size_t memory_used_ = 0;
+  size_t group_pos_ = 0;
+  std::vector<Partition> partitions_;  // 还没有聚合的分区
+  SelectExeNode *ordered_input_ = nullptr;
+  bool streaming_ = false;   // 输入有序，groups_中只有当前的分组
+  TupleBatch batch_;         // 有序输入时当前读到的一批
+  int batch_row_ = 0;
+  bool input_eof_ = false;
+};
+
+/**
+ * SELECT DISTINCT。输出每个不同的tuple第一次出现的那一行，保持输入的顺序，不阻塞，可以和LIMIT一起提前结束。
+ * 整个tuple按照排序key的格式编码之后放进开放寻址的hash集合，expected是预计的不同行数，来自统计信息。
+ * 集合占用的内存计入查询的MemoryTracker，不写临时文件，超过限制时查询失败
+ */
+class DistinctExeNode : public ExecutionNode {
+public:
+  DistinctExeNode(ExecutionNode *child, int64_t expected, MemoryTracker *memory = nullptr)
+      : child_(child), expected_(expected), memory_(memory), values_(expected) {
+  }
+  virtual ~DistinctExeNode();
+
+  const TupleSchema &schema() const override {
+    return child_->schema();
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  void release_memory();
+
+private:
+  ExecutionNode *child_;
+  int64_t expected_;
+  MemoryTracker *memory_;
+  std::vector<SortField> fields_;
+  DistinctHashSet values_;
+  std::string key_;
+  size_t memory_used_ = 0;
+};
+
+enum class WindowFuncType {
+  ROW_NUMBER,
+  RANK,
+  DENSE_RANK,
+  COUNT,
+  SUM,
+  AVG,
+  MIN,
+  MAX,
+};
+
+/**
+ * select中的一个窗口函数。arg为"*"时没有参数(row_number()、count(*)等)，name是输出的列名
+ */
+struct WindowFunction {
+  WindowFuncType type;
+  const char *table_name;
+  const char *arg;
+  std::string name;
+
+  /**
+   * 函数名不是窗口函数时返回false
+   */
+  static bool parse_type(const char *name, WindowFuncType &type);
+  /**
+   * 输出列的类型，arg_type是参数的类型，没有参数时不使用
+   */
+  static AttrType result_type(WindowFuncType type, AttrType arg_type);
+  /**
+   * 聚合函数在没有值时输出null，排名和count不会是null
+   */
+  static bool result_nullable(WindowFuncType type);
+};
+
+/**
+ * 计算OVER子句相同的窗口函数，每个函数在输入tuple的后面增加一列，输出的顺序和输入相同。
+ * 输入需要已经按照window的attrs(partition by的字段，再是order by的字段)排好序，或者按照以它们为前缀的字段排序，
+ * 这样多个窗口可以共用一次排序。只遍历一次输入：order by的字段都相同的行(peer)有相同的rank，
+ * 聚合函数计算从分区开始到当前这组peer为止的行(RANGE UNBOUNDED PRECEDING)，没有order by时整个分区是一组peer。
+ * 每次缓存一组peer，占用的内存计入查询的MemoryTracker，超过限制时返回RC::NOMEM
+ */
+class WindowExeNode : public ExecutionNode {
+public:
+  WindowExeNode(ExecutionNode *child, const WindowSpec *window, std::vector<WindowFunction> &&functions,
+      MemoryTracker *memory = nullptr)
+      : child_(child), window_(window), functions_(std::move(functions)), memory_(memory) {
+  }
+  virtual ~WindowExeNode();
+
+  const TupleSchema &schema() const override {
+    return schema_;
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  /**
+   * 分区中到目前为止的行上的聚合，min和max的值保存在只有一个值的tuple中
+   */
+  struct State {
+    long count = 0;  // 参数不是null的行数
+    double sum = 0;
+    Tuple extreme;
+  };
+
+  RC read_peers();
+  void output_peer(Tuple &tuple, int pos);
+  void release_memory();
+
+private:
+  ExecutionNode *child_;
+  const WindowSpec *window_;
+  std::vector<WindowFunction> functions_;
+  MemoryTracker *memory_;
+  TupleSchema schema_;
+  std::vector<SortField> partition_fields_;
+  std::vector<SortField> peer_fields_;  // partition by和order by的字段
+  std::vector<int> arg_indexes_;        // 每个函数的参数在输入中的位置，没有参数时为-1
+
+  std::vector<State> states_;
+  long partition_rows_ = 0;  // 分区中当前这组peer之前的行数
+  long peer_groups_ = 0;     // 分区中到当前这组为止的peer组数
+  std::vector<Tuple> peers_;
+  size_t peer_pos_ = 0;
+  Tuple next_;               // 读到的下一组的第一行
+  bool has_next_ = false;
+  bool new_partition_ = false;
+  std::string partition_key_;
+  std::string peer_key_;
+  std::string next_partition_key_;
+  std::string next_peer_key_;
+  size_t memory_used_ = 0;
+};
+
+/**
+ * 在open时读取所有的输入，按照预先编码的排序key排序。order_attrs[0]是第一排序字段。
+ * limit不小于0时只需要最小的limit个，读取时用堆保留这些tuple，不缓存所有的输入。
+ * 缓存的数据超过memory_budget或者查询的内存限制时把排好序的一段写到临时文件中，最后k路归并所有的段；
+ * 同一层的段有SORT_MERGE_FAN_IN个时先归并成上一层的一段
+ */
+class SortExeNode : public ExecutionNode {
+public:
+  SortExeNode(ExecutionNode *child, const RelAttr *order_attrs, int order_num, int limit = -1,
+      MemoryTracker *memory = nullptr, size_t memory_budget = SORT_MEMORY_BUDGET)
+      : child_(child), order_attrs_(order_attrs), order_num_(order_num), limit_(limit), memory_(memory),
+        memory_budget_(memory_budget) {
+  }
+  virtual ~SortExeNode();
+
+  const TupleSchema &schema() const override {
+    return tuples_.get_schema();
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+  /**
+   * 输入是按排序字段的索引顺序扫描的单表时，open之后扫描确实有序就不再排序，直接输出前limit个
+   */
+  void set_ordered_input(SelectExeNode *scan) {
+    ordered_input_ = scan;
+  }
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  struct Run {
+    FILE *file;
+    int level;  // 归并过几次
+  };
+
+  RC sort_all();
+  RC top_n();
+  RC spill_run();
+  RC merge_runs();
+  void close_runs();
+  void release_memory();
+
+private:
+  ExecutionNode *child_;
+  const RelAttr *order_attrs_;
+  int order_num_;
+  int limit_;
+  MemoryTracker *memory_;
+  size_t memory_budget_;
+  size_t memory_used_ = 0;
+  std::vector<SortField> fields_;
+  TupleSet tuples_;
+  std::vector<SortEntry> entries_;  // 排好序的tuple在tuples_中的位置
+  size_t entry_pos_ = 0;
+  std::vector<Run> runs_;           // 按输入顺序排列的临时文件，为空时数据都在内存中
+  SortRunMerger merger_;
+  SelectExeNode *ordered_input_ = nullptr;
+  bool pass_through_ = false;       // 输入已经有序，直接从子算子中拉取
+  int output_count_ = 0;
+};
+
+/**
+ * 跳过前offset个tuple之后最多输出limit个tuple，之后不再从子算子中拉取
+ */
+class LimitExeNode : public ExecutionNode {
+public:
+  LimitExeNode(ExecutionNode *child, int limit, int offset = 0) : child_(child), limit_(limit), offset_(offset) {
+  }
+  virtual ~LimitExeNode();
+
+  const TupleSchema &schema() const override {
+    return child_->schema();
+  }
+  std::string explain() const override;
+  void children(std::vector<ExecutionNode *> &children) const override;
+
+protected:
+  RC do_open() override;
+  RC do_next(Tuple &tuple) override;
+  RC do_close() override;
+
+private:
+  ExecutionNode *child_;
+  int limit_;
+  int offset_;
+  int count_ = 0;
+  int skipped_ = 0;
 };
 
 #endif //__OBSERVER_SQL_EXECUTOR_EXECUTION_NODE_H_
@@ -0,0 +1,1168 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Compiled expressions evaluated a column at a time over a TupleBatch.
+//
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+
+#include "sql/executor/expression.h"
+#include "common/lang/bitmap.h"
+#include "common/log/log.h"
+#include "common/time/datetime.h"
+#include "sql/parser/value_parser.h"
+#include "storage/common/record_manager.h"
+#include "storage/common/table.h"
+
+/**
+ * 表达式树的节点。编译之后不再改变，计算的结果放在ExprContext的第id列
+ */
+class ExprNode {
+public:
+  ExprNode(int id, AttrType type) : id_(id), type_(type)
+  {}
+  virtual ~ExprNode() = default;
+
+  int id() const
+  {
+    return id_;
+  }
+  AttrType type() const
+  {
+    return type_;
+  }
+
+  /**
+   * 先计算子节点再计算自己，返回context中自己的结果
+   */
+  virtual const ExprColumn &eval(const TupleBatch &batch, ExprContext &context) const = 0;
+
+protected:
+  int id_;
+  AttrType type_;
+};
+
+namespace {
+
+/**
+ * 准备节点自己的n行结果缓冲区，返回的列中null标志和类型对应的数组都指向缓冲区
+ */
+ExprColumn &output_column(ExprContext &context, int id, AttrType type, int n)
+{
+  ExprColumn &column = context.columns[id];
+  column.type = type;
+  column.null_buf.resize(n);
+  column.nulls = column.null_buf.data();
+  switch (type) {
+    case FLOATS:
+      column.float_buf.resize(n);
+      column.floats = column.float_buf.data();
+      break;
+    case CHARS:
+      column.str_buf.resize(n);
+      column.len_buf.resize(n);
+      column.strs = column.str_buf.data();
+      column.lens = column.len_buf.data();
+      break;
+    default:
+      column.int_buf.resize(n);
+      column.ints = column.int_buf.data();
+      break;
+  }
+  return column;
+}
+
+/**
+ * len_buf已经填好、字符串依次放在char_buf中时设置每一行的指针
+ */
+void link_strings(ExprColumn &column, int n)
+{
+  const char *data = column.char_buf.data();
+  for (int i = 0; i < n; i++) {
+    column.str_buf[i] = data;
+    data += column.len_buf[i] + 1;
+  }
+}
+
+void or_nulls(uint8_t *nulls, const uint8_t *other, int n)
+{
+  for (int i = 0; i < n; i++) {
+    nulls[i] |= other[i];
+  }
+}
+
+/**
+ * 日期超出范围的行置为null
+ */
+void null_invalid_dates(const int *days, uint8_t *nulls, int n)
+{
+  for (int i = 0; i < n; i++) {
+    nulls[i] |= (days[i] < DATE_MIN_DAYS) | (days[i] > DATE_MAX_DAYS);
+  }
+}
+
+/**
+ * 批次中的一列，数值直接使用批次中的数组
+ */
+class ColumnNode : public ExprNode {
+public:
+  ColumnNode(int id, AttrType type, int index) : ExprNode(id, type), index_(index)
+  {}
+
+  const ExprColumn &eval(const TupleBatch &batch, ExprContext &context) const override
+  {
+    ExprColumn &column = context.columns[id_];
+    column.type = type_;
+    column.nulls = batch.nulls(index_);
+    if (type_ == FLOATS) {
+      column.floats = batch.float_values(index_);
+    } else if (type_ == CHARS) {
+      const int n = batch.size();
+      column.str_buf.resize(n);
+      column.len_buf.resize(n);
+      for (int i = 0; i < n; i++) {
+        const char *value = batch.chars_value(index_, i);
+        column.str_buf[i] = value;
+        column.len_buf[i] = strlen(value);
+      }
+      column.strs = column.str_buf.data();
+      column.lens = column.len_buf.data();
+    } else {
+      column.ints = batch.int_values(index_);
+    }
+    return column;
+  }
+
+private:
+  int index_;
+};
+
+/**
+ * 常量。所有类型的数组都填好，null常量可以当作任何类型使用；批次变大时才重新填充
+ */
+class ConstNode : public ExprNode {
+public:
+  ConstNode(int id, AttrType type, int int_value, float float_value, const std::string &str_value)
+      : ExprNode(id, type), int_value_(int_value), float_value_(float_value), str_value_(str_value)
+  {}
+
+  const ExprColumn &eval(const TupleBatch &batch, ExprContext &context) const override
+  {
+    ExprColumn &column = context.columns[id_];
+    const int n = batch.size();
+    if (column.type != type_ || (int)column.null_buf.size() < n) {
+      column.type = type_;
+      column.int_buf.assign(n, int_value_);
+      column.float_buf.assign(n, float_value_);
+      column.str_buf.assign(n, str_value_.c_str());
+      column.len_buf.assign(n, (int)str_value_.size());
+      column.null_buf.assign(n, type_ == NULLS ? 1 : 0);
+      column.ints = column.int_buf.data();
+      column.floats = column.float_buf.data();
+      column.strs = column.str_buf.data();
+      column.lens = column.len_buf.data();
+      column.nulls = column.null_buf.data();
+    }
+    return column;
+  }
+
+private:
+  int int_value_;
+  float float_value_;
+  std::string str_value_;
+};
+
+/**
+ * INTS转换成FLOATS
+ */
+class CastNode : public ExprNode {
+public:
+  CastNode(int id, const ExprNode *child) : ExprNode(id, FLOATS), child_(child)
+  {}
+
+  const ExprColumn &eval(const TupleBatch &batch, ExprContext &context) const override
+  {
+    const ExprColumn &in = child_->eval(batch, context);
+    const int n = batch.size();
+    ExprColumn &out = output_column(context, id_, FLOATS, n);
+    float *values = out.float_buf.data();
+    for (int i = 0; i < n; i++) {
+      values[i] = (float)in.ints[i];
+    }
+    out.nulls = in.nulls;
+    return out;
+  }
+
+private:
+  const ExprNode *child_;
+};
+
+/**
+ * 四则运算。INTS按无符号数计算，溢出时回绕而不是未定义行为
+ */
+class ArithNode : public ExprNode {
+public:
+  ArithNode(int id, AttrType type, char op, const ExprNode *left, const ExprNode *right)
+      : ExprNode(id, type), op_(op), left_(left), right_(right)
+  {}
+
+  const ExprColumn &eval(const TupleBatch &batch, ExprContext &context) const override
+  {
+    const ExprColumn &left = left_->eval(batch, context);
+    const ExprColumn &right = right_->eval(batch, context);
+    const int n = batch.size();
+    ExprColumn &out = output_column(context, id_, type_, n);
+    uint8_t *nulls = out.null_buf.data();
+    for (int i = 0; i < n; i++) {
+      nulls[i] = left.nulls[i] | right.nulls[i];
+    }
+    if (type_ == FLOATS) {
+      eval_float(left.floats, right.floats, out.float_buf.data(), nulls, n);
+    } else {
+      eval_int(left.ints, right.ints, out.int_buf.data(), n);
+      if (type_ == DATES) {
+        null_invalid_dates(out.ints, nulls, n);
+      }
+    }
+    return out;
+  }
+
+private:
+  void eval_int(const int *a, const int *b, int *values, int n) const
+  {
+    switch (op_) {
+      case '+':
+        for (int i = 0; i < n; i++) {
+          values[i] = (int)((unsigned)a[i] + (unsigned)b[i]);
+        }
+        break;
+      case '-':
+        for (int i = 0; i < n; i++) {
+          values[i] = (int)((unsigned)a[i] - (unsigned)b[i]);
+        }
+        break;
+      default:
+        for (int i = 0; i < n; i++) {
+          values[i] = (int)((unsigned)a[i] * (unsigned)b[i]);
+        }
+        break;
+    }
+  }
+
+  void eval_float(const float *a, const float *b, float *values, uint8_t *nulls, int n) const
+  {
+    switch (op_) {
+      case '+':
+        for (int i = 0; i < n; i++) {
+          values[i] = a[i] + b[i];
+        }
+        break;
+      case '-':
+        for (int i = 0; i < n; i++) {
+          values[i] = a[i] - b[i];
+        }
+        break;
+      case '*':
+        for (int i = 0; i < n; i++) {
+          values[i] = a[i] * b[i];
+        }
+        break;
+      default:
+        for (int i = 0; i < n; i++) {
+          const bool zero = b[i] == 0;
+          values[i] = a[i] / (zero ? 1.0f : b[i]);
+          nulls[i] |= zero;
+        }
+        break;
+    }
+  }
+
+private:
+  char op_;
+  const ExprNode *left_;
+  const ExprNode *right_;
+};
+
+class NegNode : public ExprNode {
+public:
+  NegNode(int id, AttrType type, const ExprNode *child) : ExprNode(id, type), child_(child)
+  {}
+
+  const ExprColumn &eval(const TupleBatch &batch, ExprContext &context) const override
+  {
+    const ExprColumn &in = child_->eval(batch, context);
+    const int n = batch.size();
+    ExprColumn &out = output_column(context, id_, type_, n);
+    if (type_ == FLOATS) {
+      float *values = out.float_buf.data();
+      for (int i = 0; i < n; i++) {
+        values[i] = -in.floats[i];
+      }
+    } else {
+      int *values = out.int_buf.data();
+      for (int i = 0; i < n; i++) {
+        values[i] = (int)(0u - (unsigned)in.ints[i]);
+      }
+    }
+    out.nulls = in.nulls;
+    return out;
+  }
+
+private:
+  const ExprNode *child_;
+};
+
+enum ExprFunc {
+  FUNC_UPPER,
+  FUNC_LOWER,
+  FUNC_LENGTH,
+  FUNC_CONCAT,
+  FUNC_ABS,
+  FUNC_YEAR,
+  FUNC_MONTH,
+  FUNC_DAY,
+  FUNC_DATEDIFF,
+  FUNC_DATE_ADD,
+  FUNC_DATE_SUB,
+};
+
+/**
+ * 函数的名字、参数个数(-1表示至少一个)和参数的类型，NULLS表示INTS或者FLOATS
+ */
+struct FuncDef {
+  const char *name;
+  ExprFunc func;
+  int arg_num;
+  AttrType arg_types[2];
+};
+
+const FuncDef FUNC_DEFS[] = {
+    {"upper", FUNC_UPPER, 1, {CHARS}},
+    {"lower", FUNC_LOWER, 1, {CHARS}},
+    {"length", FUNC_LENGTH, 1, {CHARS}},
+    {"concat", FUNC_CONCAT, -1, {CHARS}},
+    {"abs", FUNC_ABS, 1, {NULLS}},
+    {"year", FUNC_YEAR, 1, {DATES}},
+    {"month", FUNC_MONTH, 1, {DATES}},
+    {"day", FUNC_DAY, 1, {DATES}},
+    {"datediff", FUNC_DATEDIFF, 2, {DATES, DATES}},
+    {"date_add", FUNC_DATE_ADD, 2, {DATES, INTS}},
+    {"date_sub", FUNC_DATE_SUB, 2, {DATES, INTS}},
+};
+
+class FuncNode : public ExprNode {
+public:
+  FuncNode(int id, AttrType type, ExprFunc func, const std::vector<const ExprNode *> &args)
+      : ExprNode(id, type), func_(func), args_(args)
+  {}
+
+  const ExprColumn &eval(const TupleBatch &batch, ExprContext &context) const override
+  {
+    const ExprColumn *args[MAX_EXPR_ARGS];
+    for (size_t k = 0; k < args_.size(); k++) {
+      args[k] = &args_[k]->eval(batch, context);
+    }
+    const int n = batch.size();
+    ExprColumn &out = output_column(context, id_, type_, n);
+    uint8_t *nulls = out.null_buf.data();
+    memcpy(nulls, args[0]->nulls, n);
+    for (size_t k = 1; k < args_.size(); k++) {
+      or_nulls(nulls, args[k]->nulls, n);
+    }
+
+    const ExprColumn &arg = *args[0];
+    int *ints = out.int_buf.data();
+    switch (func_) {
+      case FUNC_UPPER:
+      case FUNC_LOWER:
+        change_case(arg, out, n, func_ == FUNC_UPPER);
+        break;
+      case FUNC_LENGTH:
+        memcpy(ints, arg.lens, n * sizeof(int));
+        break;
+      case FUNC_CONCAT:
+        concat(args, out, n);
+        break;
+      case FUNC_ABS:
+        if (type_ == FLOATS) {
+          for (int i = 0; i < n; i++) {
+            out.float_buf[i] = fabsf(arg.floats[i]);
+          }
+        } else {
+          for (int i = 0; i < n; i++) {
+            const unsigned value = (unsigned)arg.ints[i];
+            ints[i] = (int)(arg.ints[i] < 0 ? 0u - value : value);
+          }
+        }
+        break;
+      case FUNC_YEAR:
+      case FUNC_MONTH:
+      case FUNC_DAY:
+        for (int i = 0; i < n; i++) {
+          int parts[3];
+          common::civil_from_days(arg.ints[i], &parts[0], &parts[1], &parts[2]);
+          ints[i] = parts[func_ - FUNC_YEAR];
+        }
+        break;
+      case FUNC_DATEDIFF:
+        for (int i = 0; i < n; i++) {
+          ints[i] = arg.ints[i] - args[1]->ints[i];
+        }
+        break;
+      case FUNC_DATE_ADD:
+      case FUNC_DATE_SUB: {
+        const unsigned sign = func_ == FUNC_DATE_ADD ? 1u : 0u - 1u;
+        for (int i = 0; i < n; i++) {
+          ints[i] = (int)((unsigned)arg.ints[i] + sign * (unsigned)args[1]->ints[i]);
+        }
+        null_invalid_dates(ints, nulls, n);
+      } break;
+    }
+    return out;
+  }
+
+private:
+  static void change_case(const ExprColumn &arg, ExprColumn &out, int n, bool upper)
+  {
+    size_t total = 0;
+    for (int i = 0; i < n; i++) {
+      total += arg.lens[i] + 1;
+    }
+    out.char_buf.resize(total);
+    char *data = out.char_buf.data();
+    for (int i = 0; i < n; i++) {
+      const char *value = arg.strs[i];
+      const int len = arg.lens[i];
+      for (int j = 0; j < len; j++) {
+        data[j] = upper ? toupper((unsigned char)value[j]) : tolower((unsigned char)value[j]);
+      }
+      data[len] = '\0';
+      data += len + 1;
+      out.len_buf[i] = len;
+    }
+    link_strings(out, n);
+  }
+
+  void concat(const ExprColumn *const *args, ExprColumn &out, int n) const
+  {
+    const size_t arg_num = args_.size();
+    size_t total = 0;
+    for (int i = 0; i < n; i++) {
+      int len = 0;
+      for (size_t k = 0; k < arg_num; k++) {
+        len += args[k]->lens[i];
+      }
+      out.len_buf[i] = len;
+      total += len + 1;
+    }
+    out.char_buf.resize(total);
+    char *data = out.char_buf.data();
+    for (int i = 0; i < n; i++) {
+      for (size_t k = 0; k < arg_num; k++) {
+        memcpy(data, args[k]->strs[i], args[k]->lens[i]);
+        data += args[k]->lens[i];
+      }
+      *data++ = '\0';
+    }
+    link_strings(out, n);
+  }
+
+private:
+  ExprFunc func_;
+  std::vector<const ExprNode *> args_;
+};
+
+/**
+ * 按比较符筛选，cmp(i)返回第i行左边减右边的符号。任何一边是null的行不满足
+ */
+template <typename Cmp>
+void compare_rows(CompOp comp, const uint8_t *left_nulls, const uint8_t *right_nulls, int n, uint8_t *sel, Cmp cmp)
+{
+  switch (comp) {
+    case EQUAL_TO:
+      for (int i = 0; i < n; i++) {
+        sel[i] &= (cmp(i) == 0) & !(left_nulls[i] | right_nulls[i]);
+      }
+      break;
+    case NOT_EQUAL:
+      for (int i = 0; i < n; i++) {
+        sel[i] &= (cmp(i) != 0) & !(left_nulls[i] | right_nulls[i]);
+      }
+      break;
+    case LESS_THAN:
+      for (int i = 0; i < n; i++) {
+        sel[i] &= (cmp(i) < 0) & !(left_nulls[i] | right_nulls[i]);
+      }
+      break;
+    case LESS_EQUAL:
+      for (int i = 0; i < n; i++) {
+        sel[i] &= (cmp(i) <= 0) & !(left_nulls[i] | right_nulls[i]);
+      }
+      break;
+    case GREAT_THAN:
+      for (int i = 0; i < n; i++) {
+        sel[i] &= (cmp(i) > 0) & !(left_nulls[i] | right_nulls[i]);
+      }
+      break;
+    case GREAT_EQUAL:
+      for (int i = 0; i < n; i++) {
+        sel[i] &= (cmp(i) >= 0) & !(left_nulls[i] | right_nulls[i]);
+      }
+      break;
+    default:
+      memset(sel, 0, n);
+      break;
+  }
+}
+
+bool is_numeric(AttrType type)
+{
+  return type == INTS || type == FLOATS;
+}
+
+/**
+ * 没有给出表名的字段按名字查找，有多个同名字段时返回-2
+ */
+int find_field(const TupleSchema &schema, const RelAttr &attr)
+{
+  if (attr.relation_name != nullptr) {
+    return schema.index_of_field(attr.relation_name, attr.attribute_name);
+  }
+  int index = -1;
+  const std::vector<TupleField> &fields = schema.fields();
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (0 == strcmp(fields[i].field_name(), attr.attribute_name)) {
+      if (index >= 0) {
+        return -2;
+      }
+      index = i;
+    }
+  }
+  return index;
+}
+
+const char *comp_op_string(CompOp comp)
+{
+  switch (comp) {
+    case EQUAL_TO: return "=";
+    case LESS_EQUAL: return "<=";
+    case NOT_EQUAL: return "<>";
+    case LESS_THAN: return "<";
+    case GREAT_EQUAL: return ">=";
+    case GREAT_THAN: return ">";
+    case LIKE_OP: return "LIKE";
+    case NOT_LIKE_OP: return "NOT LIKE";
+    default: return "?";
+  }
+}
+
+int arith_precedence(const Expr *expr)
+{
+  if (expr->type != EXPR_ARITH) {
+    return 3;
+  }
+  return expr->op == '+' || expr->op == '-' ? 1 : 2;
+}
+
+void append_expr(const Expr *expr, std::string &out);
+
+/**
+ * 子表达式的优先级比外层低，或者在-和/的右边优先级相同时加上括号
+ */
+void append_operand(const Expr *expr, int precedence, bool right, std::string &out)
+{
+  const int child = arith_precedence(expr);
+  const bool paren = child < precedence || (right && child == precedence);
+  if (paren) {
+    out += '(';
+  }
+  append_expr(expr, out);
+  if (paren) {
+    out += ')';
+  }
+}
+
+void append_expr(const Expr *expr, std::string &out)
+{
+  switch (expr->type) {
+    case EXPR_ATTR:
+      if (expr->attr.relation_name != nullptr) {
+        out += expr->attr.relation_name;
+        out += '.';
+      }
+      out += expr->attr.attribute_name;
+      break;
+    case EXPR_VALUE: {
+      const Value &value = expr->value;
+      char buf[64];
+      switch (value.type) {
+        case INTS:
+          snprintf(buf, sizeof(buf), "%d", *(const int *)value.data);
+          out += buf;
+          break;
+        case FLOATS:
+          snprintf(buf, sizeof(buf), "%g", *(const float *)value.data);
+          out += buf;
+          break;
+        case DATES:
+          common::format_date(*(const int *)value.data, buf);
+          out += '\'';
+          out += buf;
+          out += '\'';
+          break;
+        case CHARS:
+          out += '\'';
+          out += (const char *)value.data;
+          out += '\'';
+          break;
+        case NULLS:
+          out += "NULL";
+          break;
+        default:
+          out += '?';
+          break;
+      }
+    } break;
+    case EXPR_ARITH: {
+      const int precedence = arith_precedence(expr);
+      append_operand(expr->args[0], precedence, false, out);
+      out += ' ';
+      out += expr->op;
+      out += ' ';
+      append_operand(expr->args[1], precedence, expr->op == '-' || expr->op == '/', out);
+    } break;
+    case EXPR_NEG:
+      out += '-';
+      append_operand(expr->args[0], 3, false, out);
+      break;
+    case EXPR_FUNC:
+      out += expr->function_name;
+      out += '(';
+      for (size_t i = 0; i < expr->arg_num; i++) {
+        if (i > 0) {
+          out += ", ";
+        }
+        append_expr(expr->args[i], out);
+      }
+      out += ')';
+      break;
+  }
+}
+
+}  // namespace
+
+ExprProgram::ExprProgram() = default;
+ExprProgram::~ExprProgram() = default;
+
+template <typename T, typename... Args>
+T *ExprProgram::make_node(Args &&...args)
+{
+  T *node = new T((int)nodes_.size(), std::forward<Args>(args)...);
+  nodes_.emplace_back(node);
+  return node;
+}
+
+RC ExprProgram::compile_column(int index, const TupleSchema &schema, const ExprNode *&node)
+{
+  if (std::find(columns_.begin(), columns_.end(), index) == columns_.end()) {
+    columns_.push_back(index);
+  }
+  node = make_node<ColumnNode>(schema.field(index).type(), index);
+  return RC::SUCCESS;
+}
+
+const ExprNode *ExprProgram::cast_to_float(const ExprNode *node)
+{
+  if (node->type() != INTS) {
+    return node;
+  }
+  return make_node<CastNode>(node);
+}
+
+RC ExprProgram::compile_arith(const Expr *expr, const TupleSchema &schema, const ExprNode *&node)
+{
+  const ExprNode *left = nullptr;
+  const ExprNode *right = nullptr;
+  RC rc = compile(expr->args[0], schema, left);
+  if (rc == RC::SUCCESS) {
+    rc = compile(expr->args[1], schema, right);
+  }
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  const char op = expr->op;
+  AttrType l = left->type();
+  AttrType r = right->type();
+  // null参与运算时结果是null，类型按另一边推断
+  if (l == NULLS) {
+    l = r == NULLS ? INTS : r;
+  }
+  if (r == NULLS) {
+    r = l;
+  }
+  AttrType type = UNDEFINED;
+  if (is_numeric(l) && is_numeric(r)) {
+    type = (l == FLOATS || r == FLOATS || op == '/') ? FLOATS : INTS;
+  } else if (l == DATES && r == INTS && (op == '+' || op == '-')) {
+    type = DATES;
+  } else if (l == INTS && r == DATES && op == '+') {
+    type = DATES;
+  } else if (l == DATES && r == DATES && op == '-') {
+    type = INTS;
+  }
+  if (type == UNDEFINED) {
+    LOG_WARN("Cannot apply '%c' to %s.", op, expr_to_string(expr).c_str());
+    return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+  }
+  if (left->type() == NULLS && right->type() == NULLS) {
+    type = NULLS;
+  }
+  if (type == FLOATS) {
+    left = cast_to_float(left);
+    right = cast_to_float(right);
+  }
+  node = make_node<ArithNode>(type, op, left, right);
+  return RC::SUCCESS;
+}
+
+RC ExprProgram::compile_func(const Expr *expr, const TupleSchema &schema, const ExprNode *&node)
+{
+  const FuncDef *def = nullptr;
+  for (const FuncDef &candidate : FUNC_DEFS) {
+    if (0 == strcasecmp(candidate.name, expr->function_name)) {
+      def = &candidate;
+      break;
+    }
+  }
+  if (def == nullptr) {
+    LOG_WARN("Unknown function %s.", expr->function_name);
+    return RC::SQL_SYNTAX;
+  }
+  if (def->arg_num >= 0 ? (int)expr->arg_num != def->arg_num : expr->arg_num == 0) {
+    LOG_WARN("Function %s takes %d arguments, got %d.", def->name, def->arg_num, (int)expr->arg_num);
+    return RC::SQL_SYNTAX;
+  }
+
+  std::vector<const ExprNode *> args;
+  for (size_t i = 0; i < expr->arg_num; i++) {
+    const ExprNode *arg = nullptr;
+    RC rc = compile(expr->args[i], schema, arg);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+    const AttrType expected = def->arg_types[def->arg_num < 0 ? 0 : i];
+    const AttrType type = arg->type();
+    const bool match = type == NULLS || type == expected || (expected == NULLS && is_numeric(type));
+    if (!match) {
+      LOG_WARN("Argument %d of %s has the wrong type.", (int)i + 1, def->name);
+      return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+    }
+    args.push_back(arg);
+  }
+
+  AttrType type = INTS;
+  switch (def->func) {
+    case FUNC_UPPER:
+    case FUNC_LOWER:
+    case FUNC_CONCAT:
+      type = CHARS;
+      break;
+    case FUNC_ABS:
+      type = args[0]->type() == FLOATS ? FLOATS : INTS;
+      break;
+    case FUNC_DATE_ADD:
+    case FUNC_DATE_SUB:
+      type = DATES;
+      break;
+    default:
+      break;
+  }
+  node = make_node<FuncNode>(type, def->func, args);
+  return RC::SUCCESS;
+}
+
+RC ExprProgram::compile(const Expr *expr, const TupleSchema &schema, const ExprNode *&node)
+{
+  switch (expr->type) {
+    case EXPR_ATTR: {
+      const int index = find_field(schema, expr->attr);
+      if (index < 0) {
+        LOG_WARN("Field %s is %s.", expr_to_string(expr).c_str(), index == -2 ? "ambiguous" : "not found");
+        return index == -2 ? RC::SCHEMA_FIELD_NAME_ILLEGAL : RC::SCHEMA_FIELD_MISSING;
+      }
+      return compile_column(index, schema, node);
+    }
+    case EXPR_VALUE: {
+      const Value &value = expr->value;
+      if (value.type == UNDEFINED) {
+        LOG_WARN("Parameter is not bound.");
+        return RC::INVALID_ARGUMENT;
+      }
+      if (value.is_null || value.type == NULLS) {
+        node = make_node<ConstNode>(NULLS, 0, 0.0f, std::string());
+      } else if (value.type == FLOATS) {
+        node = make_node<ConstNode>(FLOATS, 0, *(const float *)value.data, std::string());
+      } else if (value.type == CHARS) {
+        node = make_node<ConstNode>(CHARS, 0, 0.0f, std::string((const char *)value.data));
+      } else {
+        node = make_node<ConstNode>(value.type, *(const int *)value.data, 0.0f, std::string());
+      }
+      return RC::SUCCESS;
+    }
+    case EXPR_ARITH:
+      return compile_arith(expr, schema, node);
+    case EXPR_NEG: {
+      const ExprNode *child = nullptr;
+      RC rc = compile(expr->args[0], schema, child);
+      if (rc != RC::SUCCESS) {
+        return rc;
+      }
+      if (!is_numeric(child->type()) && child->type() != NULLS) {
+        LOG_WARN("Cannot negate %s.", expr_to_string(expr->args[0]).c_str());
+        return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+      }
+      node = make_node<NegNode>(child->type(), child);
+      return RC::SUCCESS;
+    }
+    case EXPR_FUNC:
+      return compile_func(expr, schema, node);
+  }
+  return RC::SQL_SYNTAX;
+}
+
+RC ExprProgram::add_expr(const Expr *expr, const TupleSchema &schema, int *output)
+{
+  const ExprNode *node = nullptr;
+  RC rc = compile(expr, schema, node);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  *output = outputs_.size();
+  outputs_.push_back(node);
+  return RC::SUCCESS;
+}
+
+RC ExprProgram::add_column(int index, const TupleSchema &schema, int *output)
+{
+  const ExprNode *node = nullptr;
+  RC rc = compile_column(index, schema, node);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  *output = outputs_.size();
+  outputs_.push_back(node);
+  return RC::SUCCESS;
+}
+
+RC ExprProgram::add_condition(const ExprCondition &condition, const TupleSchema &schema)
+{
+  Predicate predicate;
+  predicate.comp = condition.comp;
+  RC rc = compile(condition.left, schema, predicate.left);
+  if (rc == RC::SUCCESS && condition.right != nullptr) {
+    rc = compile(condition.right, schema, predicate.right);
+  }
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  if (condition.right == nullptr) {
+    if (condition.comp != IS_NULL && condition.comp != IS_NOT_NULL) {
+      return RC::SQL_SYNTAX;
+    }
+    predicates_.push_back(predicate);
+    return RC::SUCCESS;
+  }
+  if (condition.comp == LIKE_OP || condition.comp == NOT_LIKE_OP) {
+    return add_like(condition, predicate);
+  }
+
+  const AttrType l = predicate.left->type();
+  const AttrType r = predicate.right->type();
+  if (l == NULLS || r == NULLS) {
+    predicate.never = true;
+  } else if (is_numeric(l) && is_numeric(r)) {
+    if (l != r) {
+      predicate.left = cast_to_float(predicate.left);
+      predicate.right = cast_to_float(predicate.right);
+    }
+  } else if (l != r) {
+    LOG_WARN("Cannot compare %s.", expr_condition_to_string(condition).c_str());
+    return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+  }
+  predicates_.push_back(predicate);
+  return RC::SUCCESS;
+}
+
+RC ExprProgram::add_like(const ExprCondition &condition, Predicate &predicate)
+{
+  // 模式串只能是常量，和DefaultConditionFilter一样编译一次
+  const Expr *right = condition.right;
+  if (right->type != EXPR_VALUE) {
+    LOG_WARN("Pattern of like must be a constant. %s", expr_condition_to_string(condition).c_str());
+    return RC::SQL_SYNTAX;
+  }
+  const AttrType l = predicate.left->type();
+  if (l == NULLS || right->value.type == NULLS) {
+    predicate.never = true;
+    predicates_.push_back(predicate);
+    return RC::SUCCESS;
+  }
+  if (l != CHARS || (right->value.type != CHARS && right->value.type != DATES)) {
+    LOG_WARN("Like can only match chars. %s", expr_condition_to_string(condition).c_str());
+    return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+  }
+  char date[DATE_STRING_LEN + 1];
+  const char *pattern = (const char *)right->value.data;
+  if (right->value.type == DATES) {
+    int days;
+    memcpy(&days, right->value.data, sizeof(days));
+    common::format_date(days, date);
+    pattern = date;
+  }
+  likes_.emplace_back(new LikeMatcher());
+  likes_.back()->init(pattern);
+  predicate.like = likes_.back().get();
+  predicate.right = nullptr;
+  predicates_.push_back(predicate);
+  return RC::SUCCESS;
+}
+
+AttrType ExprProgram::output_type(int output) const
+{
+  return outputs_[output]->type();
+}
+
+void ExprProgram::init_context(ExprContext &context) const
+{
+  context.columns.clear();
+  context.columns.resize(nodes_.size());
+}
+
+void ExprProgram::filter(const TupleBatch &batch, ExprContext &context, uint8_t *sel) const
+{
+  const int n = batch.size();
+  for (const Predicate &predicate : predicates_) {
+    if (predicate.never) {
+      memset(sel, 0, n);
+      return;
+    }
+    const ExprColumn &left = predicate.left->eval(batch, context);
+    if (predicate.like != nullptr) {
+      const LikeMatcher *like = predicate.like;
+      const uint8_t flip = predicate.comp == NOT_LIKE_OP ? 1 : 0;
+      for (int i = 0; i < n; i++) {
+        sel[i] &= ((uint8_t)like->match(left.strs[i], left.lens[i]) ^ flip) & !left.nulls[i];
+      }
+      continue;
+    }
+    if (predicate.right == nullptr) {
+      const uint8_t flip = predicate.comp == IS_NULL ? 0 : 1;
+      for (int i = 0; i < n; i++) {
+        sel[i] &= left.nulls[i] ^ flip;
+      }
+      continue;
+    }
+    const ExprColumn &right = predicate.right->eval(batch, context);
+    switch (left.type) {
+      case FLOATS: {
+        const float *a = left.floats;
+        const float *b = right.floats;
+        compare_rows(predicate.comp, left.nulls, right.nulls, n, sel, [a, b](int i) {
+          const float diff = a[i] - b[i];
+          return (diff > EXPR_FLOAT_EPSILON) - (diff < -EXPR_FLOAT_EPSILON);
+        });
+      } break;
+      case CHARS: {
+        const char *const *a = left.strs;
+        const char *const *b = right.strs;
+        compare_rows(predicate.comp, left.nulls, right.nulls, n, sel, [a, b](int i) { return strcmp(a[i], b[i]); });
+      } break;
+      default: {
+        const int *a = left.ints;
+        const int *b = right.ints;
+        compare_rows(
+            predicate.comp, left.nulls, right.nulls, n, sel, [a, b](int i) { return (a[i] > b[i]) - (a[i] < b[i]); });
+      } break;
+    }
+  }
+}
+
+const ExprColumn &ExprProgram::eval(int output, const TupleBatch &batch, ExprContext &context) const
+{
+  return outputs_[output]->eval(batch, context);
+}
+
+std::string expr_to_string(const Expr *expr)
+{
+  std::string out;
+  append_expr(expr, out);
+  return out;
+}
+
+std::string expr_condition_to_string(const ExprCondition &condition)
+{
+  std::string out = expr_to_string(condition.left);
+  if (condition.right == nullptr) {
+    out += condition.comp == IS_NULL ? " IS NULL" : " IS NOT NULL";
+  } else {
+    out += ' ';
+    out += comp_op_string(condition.comp);
+    out += ' ';
+    out += expr_to_string(condition.right);
+  }
+  return out;
+}
+
+void expr_collect_attrs(const Expr *expr, std::vector<const RelAttr *> &attrs)
+{
+  if (expr->type == EXPR_ATTR) {
+    attrs.push_back(&expr->attr);
+    return;
+  }
+  const size_t arg_num = expr->type == EXPR_ARITH ? 2 : expr->type == EXPR_NEG ? 1 : expr->type == EXPR_FUNC ? expr->arg_num : 0;
+  for (size_t i = 0; i < arg_num; i++) {
+    expr_collect_attrs(expr->args[i], attrs);
+  }
+}
+
+void expr_condition_collect_attrs(const ExprCondition &condition, std::vector<const RelAttr *> &attrs)
+{
+  expr_collect_attrs(condition.left, attrs);
+  if (condition.right != nullptr) {
+    expr_collect_attrs(condition.right, attrs);
+  }
+}
+
+void expr_column_append(const ExprColumn &column, int row, Tuple &tuple)
+{
+  if (column.nulls[row]) {
+    tuple.add("NULL", 4, true);
+    return;
+  }
+  switch (column.type) {
+    case INTS:
+      tuple.add(column.ints[row], false);
+      break;
+    case FLOATS:
+      tuple.add(column.floats[row], false);
+      break;
+    case DATES: {
+      char buf[DATE_STRING_LEN + 1];
+      const int len = common::format_date(column.ints[row], buf);
+      tuple.add(buf, len, false);
+    } break;
+    case CHARS:
+      tuple.add(column.strs[row], column.lens[row], false);
+      break;
+    default:
+      tuple.add("NULL", 4, true);
+      break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ExprConditionFilter::~ExprConditionFilter()
+{
+  for (Scratch *scratch : free_scratches_) {
+    delete scratch;
+  }
+}
+
+RC ExprConditionFilter::init(Table &table, const ExprCondition &condition)
+{
+  table_ = &table;
+  TupleSchema::from_table(&table, schema_);
+  return program_.add_condition(condition, schema_);
+}
+
+ExprConditionFilter::Scratch *ExprConditionFilter::acquire() const
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_scratches_.empty()) {
+      Scratch *scratch = free_scratches_.back();
+      free_scratches_.pop_back();
+      return scratch;
+    }
+  }
+  Scratch *scratch = new Scratch();
+  scratch->batch.init(schema_, program_.columns());
+  scratch->converter.reset(new TupleBatchConverter(table_, scratch->batch));
+  program_.init_context(scratch->context);
+  return scratch;
+}
+
+void ExprConditionFilter::release(Scratch *scratch) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_scratches_.push_back(scratch);
+}
+
+void ExprConditionFilter::filter_batch(Scratch *scratch, const char *const *records, int n) const
+{
+  scratch->batch.clear();
+  for (int i = 0; i < n; i++) {
+    scratch->converter->add_record(records[i]);
+  }
+  scratch->sel.assign(n, 1);
+  program_.filter(scratch->batch, scratch->context, scratch->sel.data());
+}
+
+bool ExprConditionFilter::filter(const Record &rec) const
+{
+  Scratch *scratch = acquire();
+  const char *record = rec.data;
+  filter_batch(scratch, &record, 1);
+  const bool result = scratch->sel[0] != 0;
+  release(scratch);
+  return result;
+}
+
+void ExprConditionFilter::filter(const char *const *records, int n, uint8_t *sel) const
+{
+  Scratch *scratch = acquire();
+  for (int start = 0; start < n; start += TUPLE_BATCH_CAPACITY) {
+    const int num = std::min(n - start, TUPLE_BATCH_CAPACITY);
+    filter_batch(scratch, records + start, num);
+    memcpy(sel + start, scratch->sel.data(), num);
+  }
+  release(scratch);
+}
+
+void ExprConditionFilter::filter_page(const char *first_record, int record_size, int capacity, char *bitmap) const
+{
+  // 页面上有效的记录收集起来按批计算
+  Scratch *scratch = acquire();
+  common::Bitmap bits(bitmap, capacity);
+  scratch->records.clear();
+  scratch->slots.clear();
+  for (int index = bits.next_setted_bit(0); index >= 0; index = bits.next_setted_bit(index + 1)) {
+    scratch->records.push_back(first_record + index * record_size);
+    scratch->slots.push_back(index);
+  }
+  const int n = scratch->records.size();
+  for (int start = 0; start < n; start += TUPLE_BATCH_CAPACITY) {
+    const int num = std::min(n - start, TUPLE_BATCH_CAPACITY);
+    filter_batch(scratch, scratch->records.data() + start, num);
+    for (int i = 0; i < num; i++) {
+      if (!scratch->sel[i]) {
+        bits.clear_bit(scratch->slots[start + i]);
+      }
+    }
+  }
+  release(scratch);
+}
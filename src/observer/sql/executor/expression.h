@@ -0,0 +1,195 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Compiled expressions evaluated a column at a time over a TupleBatch.
+//
+
+#ifndef __OBSERVER_SQL_EXECUTOR_EXPRESSION_H_
+#define __OBSERVER_SQL_EXECUTOR_EXPRESSION_H_
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rc.h"
+#include "sql/executor/tuple.h"
+#include "sql/executor/tuple_batch.h"
+#include "storage/common/condition_filter.h"
+
+#define EXPR_FLOAT_EPSILON 1e-6  // 浮点数的差小于它时认为相等，和条件过滤相同
+
+/**
+ * 表达式一个节点对一批数据的计算结果，类型和TupleBatch中的列相同：INTS和DATES是int，FLOATS是float，
+ * CHARS是以'\0'结尾的字符串。null的行在数值列中是0、在字符串列中是""，计算时不需要判断null。
+ * 字段节点直接指向批次中的数据，不复制；其它节点的结果放在自己的缓冲区中
+ */
+struct ExprColumn {
+  AttrType type = UNDEFINED;
+  const int *ints = nullptr;
+  const float *floats = nullptr;
+  const char *const *strs = nullptr;
+  const int *lens = nullptr;
+  const uint8_t *nulls = nullptr;
+
+  std::vector<int> int_buf;
+  std::vector<float> float_buf;
+  std::vector<const char *> str_buf;
+  std::vector<int> len_buf;
+  std::vector<uint8_t> null_buf;
+  std::vector<char> char_buf;
+};
+
+/**
+ * 计算时的中间结果，每个节点一列。编译好的ExprProgram不可变，多个线程各用一个ExprContext就可以同时计算
+ */
+struct ExprContext {
+  std::vector<ExprColumn> columns;
+};
+
+class ExprNode;
+
+/**
+ * 编译好的一组表达式和条件，输入是按schema保存的TupleBatch。编译时检查字段是否存在、类型是否匹配，
+ * 并确定每个节点的类型和计算函数，计算时一个节点处理一整批数据，循环中没有类型判断。
+ * 类型规则：
+ * - INTS之间的+-*结果是INTS(溢出时回绕)，有FLOATS时INTS先转换成FLOATS，除法的结果总是FLOATS，除数是0时结果是null；
+ * - DATES加减INTS是DATES，超出日期的范围时是null；DATES减DATES是相差的天数；
+ * - 任何一边是null的运算结果是null，和null的比较总是不满足
+ */
+class ExprProgram {
+public:
+  ExprProgram();
+  ~ExprProgram();
+  ExprProgram(const ExprProgram &) = delete;
+  ExprProgram &operator=(const ExprProgram &) = delete;
+
+  /**
+   * 添加一个输出，返回的输出序号按添加的顺序从0开始。add_column直接输出schema中的第index列
+   */
+  RC add_expr(const Expr *expr, const TupleSchema &schema, int *output);
+  RC add_column(int index, const TupleSchema &schema, int *output);
+  /**
+   * 添加一个过滤条件，多个条件之间是and
+   */
+  RC add_condition(const ExprCondition &condition, const TupleSchema &schema);
+
+  int output_num() const
+  {
+    return (int)outputs_.size();
+  }
+  /**
+   * 输出的类型，结果只能是null的表达式是NULLS
+   */
+  AttrType output_type(int output) const;
+  /**
+   * 用到的输入列在schema中的位置，用来初始化TupleBatch
+   */
+  const std::vector<int> &columns() const
+  {
+    return columns_;
+  }
+
+  void init_context(ExprContext &context) const;
+  /**
+   * 不满足条件的行把sel中对应的值置为0，满足的行不改变
+   */
+  void filter(const TupleBatch &batch, ExprContext &context, uint8_t *sel) const;
+  /**
+   * 计算一个输出，结果在下次使用context计算之前有效
+   */
+  const ExprColumn &eval(int output, const TupleBatch &batch, ExprContext &context) const;
+
+private:
+  struct Predicate {
+    CompOp comp = NO_OP;
+    const ExprNode *left = nullptr;
+    const ExprNode *right = nullptr;  // IS NULL、IS NOT NULL和LIKE时是nullptr
+    const LikeMatcher *like = nullptr;
+    bool never = false;               // 和null常量比较，总是不满足
+  };
+
+  RC add_like(const ExprCondition &condition, Predicate &predicate);
+  RC compile(const Expr *expr, const TupleSchema &schema, const ExprNode *&node);
+  RC compile_arith(const Expr *expr, const TupleSchema &schema, const ExprNode *&node);
+  RC compile_func(const Expr *expr, const TupleSchema &schema, const ExprNode *&node);
+  RC compile_column(int index, const TupleSchema &schema, const ExprNode *&node);
+  const ExprNode *cast_to_float(const ExprNode *node);
+  template <typename T, typename... Args>
+  T *make_node(Args &&...args);
+
+private:
+  std::vector<std::unique_ptr<ExprNode>> nodes_;
+  std::vector<const ExprNode *> outputs_;
+  std::vector<Predicate> predicates_;
+  std::vector<std::unique_ptr<LikeMatcher>> likes_;
+  std::vector<int> columns_;
+};
+
+/**
+ * 表达式的文本，作为select中表达式的列名，比如"id + 1"、"upper(t.name)"
+ */
+std::string expr_to_string(const Expr *expr);
+std::string expr_condition_to_string(const ExprCondition &condition);
+
+/**
+ * 收集表达式中所有的字段
+ */
+void expr_collect_attrs(const Expr *expr, std::vector<const RelAttr *> &attrs);
+void expr_condition_collect_attrs(const ExprCondition &condition, std::vector<const RelAttr *> &attrs);
+
+/**
+ * 把计算结果的第row行追加到tuple中，日期转换成yyyy-mm-dd，null和其它的算子一样是"NULL"
+ */
+void expr_column_append(const ExprColumn &column, int row, Tuple &tuple);
+
+/**
+ * 只用到一张表的字段的表达式条件，下推到表的扫描中。记录先转换成只有用到的字段的TupleBatch再按批计算，
+ * 扫描按批或者按页面过滤时一次计算一批记录。并行扫描的线程共用一个过滤器，每次过滤取一份空闲的中间状态
+ */
+class ExprConditionFilter : public ConditionFilter {
+public:
+  ExprConditionFilter() = default;
+  virtual ~ExprConditionFilter();
+
+  RC init(Table &table, const ExprCondition &condition);
+
+  virtual bool filter(const Record &rec) const;
+  virtual void filter(const char *const *records, int n, uint8_t *sel) const;
+  virtual void filter_page(const char *first_record, int record_size, int capacity, char *bitmap) const;
+
+private:
+  struct Scratch {
+    TupleBatch batch;
+    std::unique_ptr<TupleBatchConverter> converter;
+    ExprContext context;
+    std::vector<uint8_t> sel;
+    std::vector<const char *> records;  // 过滤页面时页面上有效的记录和它们的slot
+    std::vector<int> slots;
+  };
+
+  Scratch *acquire() const;
+  void release(Scratch *scratch) const;
+  /**
+   * 计算records中的n(不超过一批)条记录，结果在scratch->sel中
+   */
+  void filter_batch(Scratch *scratch, const char *const *records, int n) const;
+
+private:
+  Table *table_ = nullptr;
+  TupleSchema schema_;
+  ExprProgram program_;
+  mutable std::mutex mutex_;
+  mutable std::vector<Scratch *> free_scratches_;
+};
+
+#endif  // __OBSERVER_SQL_EXECUTOR_EXPRESSION_H_
@@ -0,0 +1,48 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Per-query accounting of the memory held by operators.
+//
+
+#include "sql/executor/memory_tracker.h"
+
+static size_t global_query_memory_limit = QUERY_MEMORY_LIMIT;
+
+void set_query_memory_limit(size_t limit) {
+  global_query_memory_limit = limit;
+}
+
+size_t query_memory_limit() {
+  return global_query_memory_limit;
+}
+
+MemoryTracker::MemoryTracker() : limit_(global_query_memory_limit) {
+}
+
+bool MemoryTracker::try_consume(size_t bytes) {
+  if (limit_ > 0 && used_ + bytes > limit_) {
+    return false;
+  }
+  consume(bytes);
+  return true;
+}
+
+void MemoryTracker::consume(size_t bytes) {
+  used_ += bytes;
+  total_ += bytes;
+  if (used_ > peak_) {
+    peak_ = used_;
+  }
+}
+
+void MemoryTracker::release(size_t bytes) {
+  used_ = bytes > used_ ? 0 : used_ - bytes;
+}
@@ -0,0 +1,82 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Per-query accounting of the memory held by operators.
+//
+
+#ifndef __OBSERVER_SQL_EXECUTOR_MEMORY_TRACKER_H_
+#define __OBSERVER_SQL_EXECUTOR_MEMORY_TRACKER_H_
+
+#include <stddef.h>
+
+#include "storage/default/spill_file.h"
+
+#define QUERY_MEMORY_LIMIT (512 * 1024 * 1024)  // 默认一次查询中缓存数据的算子最多使用的内存
+
+/**
+ * 一次查询中排序、聚合和join的build端缓存数据使用的内存。算子缓存数据之前用try_consume申请，
+ * 超过限制时申请失败，算子把数据写到临时文件中之后release；不能写出的数据返回RC::NOMEM结束查询。
+ * limit为0时不限制。同一次查询的算子在同一个线程中执行，不需要加锁
+ */
+class MemoryTracker {
+public:
+  explicit MemoryTracker(size_t limit) : limit_(limit) {
+  }
+  MemoryTracker();
+
+  /**
+   * 加上bytes之后不超过限制时计入并返回true，否则不计入
+   */
+  bool try_consume(size_t bytes);
+  /**
+   * 不管是否超过限制都计入，用于已经分配的内存，比如聚合中字符串的增长
+   */
+  void consume(size_t bytes);
+  void release(size_t bytes);
+
+  size_t used() const {
+    return used_;
+  }
+  size_t peak() const {
+    return peak_;
+  }
+  size_t limit() const {
+    return limit_;
+  }
+  /**
+   * 累计计入过的内存，不减去release的部分
+   */
+  size_t total() const {
+    return total_;
+  }
+
+  /**
+   * 这次查询写临时文件的quota，用SpillFileManager::create创建临时文件时传入
+   */
+  SpillQuota *spill() {
+    return &spill_;
+  }
+
+private:
+  size_t limit_;
+  size_t used_ = 0;
+  size_t peak_ = 0;
+  size_t total_ = 0;
+  SpillQuota spill_;
+};
+
+/**
+ * 新的查询使用的内存限制，在启动时根据配置项QueryMemoryLimit设置
+ */
+void set_query_memory_limit(size_t limit);
+size_t query_memory_limit();
+
+#endif  // __OBSERVER_SQL_EXECUTOR_MEMORY_TRACKER_H_
@@ -11,11 +11,17 @@ See the Mulan PSL v2 for more details. */
 //
 // Created by Wangyunlai on 2021/5/14.
 //
+#include <charconv>
 #include <string>
 #include <stdio.h>
+#include <string.h>
 #include "sql/executor/tuple.h"
 #include "storage/common/table.h"
+#include "storage/common/record_manager.h"
+#include "storage/common/dictionary.h"
 #include "common/log/log.h"
+#include "common/time/datetime.h"
+#include "net/wire_protocol.h"
 
 Tuple::Tuple(const Tuple &other)
 {
@@ -23,7 +29,7 @@ Tuple::Tuple(const Tuple &other)
   exit(1);
 }
 
-Tuple::Tuple(Tuple &&other) noexcept : values_(std::move(other.values_))
+Tuple::Tuple(Tuple &&other) noexcept : values_(std::move(other.values_)), strings_(std::move(other.strings_))
 {
 }
 
@@ -36,6 +42,8 @@ Tuple &Tuple::operator=(Tuple &&other) noexcept
 
   values_.clear();
   values_.swap(other.values_);
+  strings_.clear();
+  strings_.swap(other.strings_);
   return *this;
 }
 
@@ -43,28 +51,143 @@ Tuple::~Tuple()
 {
 }
 
-// add (Value && value)
-void Tuple::add(TupleValue *value)
+void Tuple::add(int value, bool is_null)
 {
-  values_.emplace_back(value);
+  TupleValue tuple_value;
+  tuple_value.type = INTS;
+  tuple_value.is_null = is_null;
+  tuple_value.len = 0;
+  tuple_value.int_value = value;
+  values_.push_back(tuple_value);
 }
-void Tuple::add(const std::shared_ptr<TupleValue> &other)
+
+void Tuple::add(float value, bool is_null)
 {
-  values_.emplace_back(other);
+  TupleValue tuple_value;
+  tuple_value.type = FLOATS;
+  tuple_value.is_null = is_null;
+  tuple_value.len = 0;
+  tuple_value.float_value = value;
+  values_.push_back(tuple_value);
 }
-void Tuple::add(int value, bool is_null)
+
+void Tuple::add(const char *s, int len, bool is_null)
 {
-  add(new IntValue(value, is_null));
+  TupleValue tuple_value;
+  tuple_value.type = CHARS;
+  tuple_value.is_null = is_null;
+  tuple_value.len = len;
+  tuple_value.offset = strings_.size();
+  values_.push_back(tuple_value);
+  strings_.append(s, len);
+  strings_.push_back('\0');
 }
 
-void Tuple::add(float value, bool is_null)
+void Tuple::add(const Tuple &other, int index)
 {
-  add(new FloatValue(value, is_null));
+  const TupleValue &value = other.values_[index];
+  if (CHARS == value.type)
+  {
+    add(other.get_string(index), value.len, value.is_null);
+  }
+  else
+  {
+    values_.push_back(value);
+  }
 }
 
-void Tuple::add(const char *s, int len, bool is_null)
+void Tuple::merge(const Tuple &other)
+{
+  // 字符串区整体复制，other中字符串的位置加上原来字符串区的长度
+  const int base = strings_.size();
+  values_.reserve(values_.size() + other.values_.size());
+  for (const TupleValue &value : other.values_)
+  {
+    values_.push_back(value);
+    if (CHARS == value.type)
+    {
+      values_.back().offset += base;
+    }
+  }
+  strings_.append(other.strings_);
+}
+
+/**
+ * float输出规则：先保留两位小数（四舍五入），再去掉尾后0
+ * 17.101 -> 17.10 -> 17.1
+ * 用to_chars直接写到buf中，结果和printf("%.2f")相同但不需要解析格式串，返回写入的长度
+ */
+static int format_float(float value, char *buf, int size)
+{
+  char *end = std::to_chars(buf, buf + size, value, std::chars_format::fixed, 2).ptr;
+  while (end[-1] == '0')
+  {
+    --end;
+  }
+  if (end[-1] == '.')
+  {
+    --end;
+  }
+  return end - buf;
+}
+
+void Tuple::print_value(std::ostream &os, int index) const
 {
-  add(new StringValue(s, len, is_null));
+  std::string out;
+  append_value(out, index);
+  os << out;
+}
+
+void Tuple::append_value(std::string &out, int index) const
+{
+  const TupleValue &value = values_[index];
+  char buf[TUPLE_VALUE_TEXT_MAX_LEN];
+  switch (value.type)
+  {
+  case INTS:
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), value.int_value).ptr - buf);
+    break;
+  case FLOATS:
+    out.append(buf, format_float(value.float_value, buf, sizeof(buf)));
+    break;
+  default:
+    out.append(get_string(index), value.len);
+    break;
+  }
+}
+
+int Tuple::compare(int index, const Tuple &other, int other_index) const
+{
+  const TupleValue &value = values_[index];
+  const TupleValue &other_value = other.values_[other_index];
+  if (value.is_null || other_value.is_null)
+  {
+    return -1;
+  }
+
+  if (INTS == value.type && INTS == other_value.type)
+  {
+    return value.int_value < other_value.int_value ? -1 : (value.int_value > other_value.int_value ? 1 : 0);
+  }
+  if (CHARS == value.type && CHARS == other_value.type)
+  {
+    return strcmp(get_string(index), other.get_string(other_index));
+  }
+  if (CHARS == value.type || CHARS == other_value.type)
+  {
+    // 字符串和数字不能比较
+    return -1;
+  }
+
+  // 浮点数之间或者浮点数和整数比较，差值很小时认为相等
+  const float left = INTS == value.type ? value.int_value : value.float_value;
+  const float right = INTS == other_value.type ? other_value.int_value : other_value.float_value;
+  const float result = left - right;
+  if (result > -1e-6 && result < 1e-6)
+  {
+    return 0;
+  }
+  return result > 0 ? 1 : -1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -168,20 +291,62 @@ void TupleSchema::print(std::ostream &os, bool isMultiTable) const
   for (std::vector<TupleField>::const_iterator iter = fields_.begin(), end = --fields_.end();
        iter != end; ++iter)
   {
-    if (table_names.size() > 1 || isMultiTable == true)
+    // 聚合函数这样的列没有表名
+    if ((table_names.size() > 1 || isMultiTable == true) && iter->table_name()[0] != '\0')
     {
       os << iter->table_name() << ".";
     }
     os << iter->field_name() << " | ";
   }
 
-  if (table_names.size() > 1 || isMultiTable == true)
+  if ((table_names.size() > 1 || isMultiTable == true) && fields_.back().table_name()[0] != '\0')
   {
     os << fields_.back().table_name() << ".";
   }
   os << fields_.back().field_name() << std::endl;
 }
 
+void TupleSchema::encode(std::string &out, bool isMultiTable) const
+{
+  std::set<std::string> table_names;
+  for (const auto &field : fields_)
+  {
+    table_names.insert(field.table_name());
+  }
+  const bool with_table_name = table_names.size() > 1 || isMultiTable;
+
+  size_t frame = wire_frame_begin(out, WIRE_FRAME_SCHEMA);
+  wire_put_u16(out, fields_.size());
+  std::string name;
+  for (const TupleField &field : fields_)
+  {
+    switch (field.type())
+    {
+    case INTS:
+      wire_put_u8(out, WIRE_VALUE_INT);
+      break;
+    case FLOATS:
+      wire_put_u8(out, WIRE_VALUE_FLOAT);
+      break;
+    case DATES:
+      wire_put_u8(out, WIRE_VALUE_DATE);
+      break;
+    default:
+      wire_put_u8(out, WIRE_VALUE_STRING);
+      break;
+    }
+    name.clear();
+    if (with_table_name && field.table_name()[0] != '\0')
+    {
+      name.append(field.table_name()).append(".");
+    }
+    name.append(field.field_name());
+    wire_put_u16(out, name.size());
+    out.append(name);
+  }
+  wire_frame_end(out, frame);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 TupleSet::TupleSet(TupleSet &&other) : tuples_(std::move(other.tuples_)), schema_(other.schema_)
 {
@@ -225,17 +390,71 @@ void TupleSet::print(std::ostream &os, bool isMultiTable) const
 
   schema_.print(os, isMultiTable);
 
+  // 先格式化到缓冲区，每满TUPLE_PRINT_BUFFER_SIZE写一次流
+  std::string buffer;
+  buffer.reserve(TUPLE_PRINT_BUFFER_SIZE + 4096);
   for (const Tuple &item : tuples_)
   {
-    const std::vector<std::shared_ptr<TupleValue>> &values = item.values();
-    for (std::vector<std::shared_ptr<TupleValue>>::const_iterator iter = values.begin(), end = --values.end();
-         iter != end; ++iter)
+    append_tuple(buffer, item);
+    if (buffer.size() >= TUPLE_PRINT_BUFFER_SIZE)
+    {
+      os.write(buffer.data(), buffer.size());
+      buffer.clear();
+    }
+  }
+  os.write(buffer.data(), buffer.size());
+}
+
+void TupleSet::print_tuple(std::ostream &os, const Tuple &tuple)
+{
+  std::string out;
+  append_tuple(out, tuple);
+  os.write(out.data(), out.size());
+}
+
+void TupleSet::append_tuple(std::string &out, const Tuple &tuple)
+{
+  const int size = tuple.size();
+  for (int i = 0; i < size - 1; i++)
+  {
+    tuple.append_value(out, i);
+    out.append(" | ");
+  }
+  tuple.append_value(out, size - 1);
+  out.push_back('\n');
+}
+
+void TupleSet::encode_tuple(std::string &out, const Tuple &tuple)
+{
+  const int size = tuple.size();
+  wire_put_u16(out, size);
+  for (int i = 0; i < size; i++)
+  {
+    const TupleValue &value = tuple.get(i);
+    if (value.is_null)
+    {
+      wire_put_u8(out, WIRE_VALUE_NULL);
+      continue;
+    }
+    switch (value.type)
+    {
+    case INTS:
+      wire_put_u8(out, WIRE_VALUE_INT);
+      wire_put_u32(out, (uint32_t)value.int_value);
+      break;
+    case FLOATS:
+      wire_put_u8(out, WIRE_VALUE_FLOAT);
+      wire_put_f32(out, value.float_value);
+      break;
+    default:
     {
-      (*iter)->to_string(os);
-      os << " | ";
+      const int len = std::min(value.len, 0xffff);
+      wire_put_u8(out, WIRE_VALUE_STRING);
+      wire_put_u16(out, len);
+      out.append(tuple.get_string(i), len);
+    }
+    break;
     }
-    values.back()->to_string(os);
-    os << std::endl;
   }
 }
 
@@ -272,50 +491,53 @@ const std::vector<Tuple> &TupleSet::tuples() const
 /////////////////////////////////////////////////////////////////////////////
 TupleRecordConverter::TupleRecordConverter(Table *table, TupleSet &tuple_set) : table_(table), tuple_set_(tuple_set)
 {
-}
-
-void num2date(int n, char* str)
-{
-    const int len = 10;
-  char str1[len];
-  sprintf(str1, "%d", n);
-  // char str[len];
-
-  for (int i = 0, j = 0; i < len; i++)
+  const TableMeta &table_meta = table_->table_meta();
+  for (const TupleField &field : tuple_set_.schema().fields())
   {
-    if (i == 4 || i == 7)
+    if (0 == strcmp(field.field_name(), RID_PAGE_FIELD))
     {
-      str[i] = '-';
-      i++;
+      // rid总是最后两个字段
+      with_rid_ = true;
+      break;
     }
-    str[i] = str1[j++];
+    int i = table_meta.find_field_index_by_name(field.field_name());
+    assert(i != -1);
+    field_indexes_.push_back(i);
+    field_metas_.push_back(table_meta.field(i));
+    null_flags_.push_back(table_meta.null_flag(i));
   }
 }
 
-void TupleRecordConverter::add_record(const char *record)
+void TupleRecordConverter::add_record(const char *record, const RID *rid)
 {
-  const TupleSchema &schema = tuple_set_.schema();
   Tuple tuple;
-  const TableMeta &table_meta = table_->table_meta();
-
-  auto last_field = table_meta.field(table_meta.field_num() - 1);
-  int null_field_index = last_field->offset() + last_field->len();
+  add_values(record, tuple);
+  if (with_rid_)
+  {
+    tuple.add(rid->page_num);
+    tuple.add(rid->slot_num);
+  }
+  tuple_set_.add(std::move(tuple));
+}
 
-  for (const TupleField &field : schema.fields())
+void TupleRecordConverter::add_values(const char *record, Tuple &tuple) const
+{
+  for (size_t field_pos = 0; field_pos < field_metas_.size(); field_pos++)
   {
-    int i = table_meta.find_field_index_by_name(field.field_name());
-    assert(i != -1);
-    const FieldMeta *field_meta = table_meta.field(i);
+    const FieldMeta *field_meta = field_metas_[field_pos];
     // 不管什么类型都有可能插入null
-    bool is_null = false;
-    // -1是因为field[0]为_trx
-    memcpy(&is_null, record + null_field_index + i - 1, 1);
-    if (is_null)
+    if (null_flags_[field_pos].test(record))
     {
       // 插入null
       const char *s = "NULL";
       tuple.add(s, 4, true);
     }
+    else if (field_meta->dictionary() != nullptr)
+    {
+      // 字典编码的字段记录中是编码
+      const std::string &s = field_meta->dictionary()->value(*(int *)(record + field_meta->offset()));
+      tuple.add(s.c_str(), (int)s.size(), false);
+    }
     else
     {
       switch (field_meta->type())
@@ -355,9 +577,9 @@ void TupleRecordConverter::add_record(const char *record)
       case DATES:
       {
         int value = *(int *)(record + field_meta->offset());
-        char *s = (char *)malloc(sizeof(char)*10);
-        num2date(value, s);
-        tuple.add(s, 10, false);
+        char s[DATE_STRING_LEN + 1];
+        common::format_date(value, s);
+        tuple.add(s, DATE_STRING_LEN, false);
       }
       break;
       default:
@@ -367,6 +589,4 @@ void TupleRecordConverter::add_record(const char *record)
       }
     }
   }
-
-  tuple_set_.add(std::move(tuple));
 }
@@ -24,6 +24,7 @@ See the Mulan PSL v2 for more details. */
 
 #include "sql/parser/parse.h"
 #include "sql/executor/value.h"
+#include "storage/common/field_meta.h"
 
 enum FuncType
 {
@@ -31,12 +32,26 @@ enum FuncType
   MAX,
   MIN,
   AVG,
+  SUM,
+  COUNT_DISTINCT,         // COUNT(DISTINCT attr)
+  APPROX_COUNT_DISTINCT,  // 用HyperLogLog估算不同值的个数，不保存所有的值
   NOFUNC
 };
 
 class Table;
-class OrderInfo;
+struct RID;
 
+// 延迟物化时tuple中代替字段的记录位置，字段名不是合法的标识符，不会和表中的字段重名
+#define RID_PAGE_FIELD "#rid_page"
+#define RID_SLOT_FIELD "#rid_slot"
+
+#define TUPLE_VALUE_TEXT_MAX_LEN 64             // 数值转换成文本的最大长度，float的整数部分最多39位
+#define TUPLE_PRINT_BUFFER_SIZE (64 * 1024)     // TupleSet::print每积累这么多输出写一次流
+
+/**
+ * 一行数据。值按顺序保存在values_中，字符串的内容都放在strings_中，每个字符串以'\0'结尾。
+ * 这样一个tuple只有两次内存分配，join合并tuple时也只需要复制这两块内存
+ */
 class Tuple
 {
 public:
@@ -49,37 +64,43 @@ public:
   Tuple(Tuple &&other) noexcept;
   Tuple &operator=(Tuple &&other) noexcept;
 
-  void add(TupleValue *value);
-  void add(const std::shared_ptr<TupleValue> &other);
   void add(int value, bool is_null = false);
   void add(float value, bool is_null = false);
   void add(const char *s, int len, bool is_null = false);
+  /**
+   * 复制other中的第index个值
+   */
+  void add(const Tuple &other, int index);
 
-  // 以下两个函数是成对出现的
-  void merge(const Tuple &other)
-  {
-    values_.insert(values_.end(), other.values().begin(), other.values().end());
-  }
+  void merge(const Tuple &other);
 
-  void remove(const Tuple &other)
+  void reserve(int value_num)
   {
-    auto iter = std::find(values_.begin(), values_.end(), other.get_pointer(0));
-    values_.erase(iter, values_.end());
+    values_.reserve(value_num);
   }
 
   void print(std::ostream &os) const
   {
-    for (const auto &each : values_)
+    for (int i = 0; i < size(); i++)
     {
-      each->to_string(os);
+      print_value(os, i);
     }
     os << std::endl;
   }
 
-  const std::vector<std::shared_ptr<TupleValue>> &values() const
-  {
-    return values_;
-  }
+  /**
+   * 按照输出结果的格式打印第index个值
+   */
+  void print_value(std::ostream &os, int index) const;
+  /**
+   * 和print_value的格式相同，直接追加到out后面，不经过流
+   */
+  void append_value(std::string &out, int index) const;
+
+  /**
+   * 比较第index个值和other中第other_index个值，有一个是null时返回-1
+   */
+  int compare(int index, const Tuple &other, int other_index) const;
 
   int size() const
   {
@@ -88,17 +109,48 @@ public:
 
   const TupleValue &get(int index) const
   {
-    return *values_[index];
+    return values_[index];
   }
 
-  const std::shared_ptr<TupleValue> &get_pointer(int index) const
+  bool is_null(int index) const
   {
-    return values_[index];
+    return values_[index].is_null;
+  }
+
+  int get_int(int index) const
+  {
+    return values_[index].int_value;
+  }
+
+  float get_float(int index) const
+  {
+    return values_[index].float_value;
+  }
+
+  /**
+   * 字符串在tuple再次添加值之前有效
+   */
+  const char *get_string(int index) const
+  {
+    return strings_.data() + values_[index].offset;
+  }
+
+  int get_len(int index) const
+  {
+    return values_[index].len;
+  }
+
+  /**
+   * tuple占用的内存，包括结构本身
+   */
+  size_t memory_size() const
+  {
+    return sizeof(Tuple) + values_.capacity() * sizeof(TupleValue) + strings_.capacity();
   }
 
 private:
-  std::vector<std::shared_ptr<TupleValue>> values_;
-  std::vector<std::string> attr_name_;
+  std::vector<TupleValue> values_;
+  std::string strings_;
 };
 
 class TupleField
@@ -165,6 +217,10 @@ public:
   }
 
   void print(std::ostream &os, bool isMultiTable = false) const;
+  /**
+   * 按照二进制协议输出一个WIRE_FRAME_SCHEMA帧，列名和print输出的相同
+   */
+  void encode(std::string &out, bool isMultiTable = false) const;
 
   int index_of_field(const char *field_name) const;
 
@@ -212,6 +268,35 @@ public:
     std::swap(tuples_[i], tuples_[j]);
   }
 
+  /**
+   * 拉取执行时用来把tuple移出去，移走之后这个位置上的tuple是空的
+   */
+  Tuple &mutable_tuple(int index)
+  {
+    return tuples_[index];
+  }
+
+  /**
+   * 只清空tuple，保留schema
+   */
+  void clear_tuples()
+  {
+    tuples_.clear();
+  }
+
+  /**
+   * 按照print的格式输出一行
+   */
+  static void print_tuple(std::ostream &os, const Tuple &tuple);
+  /**
+   * 和print_tuple的格式相同，直接追加到out后面。输出大量结果时用这个，不经过流
+   */
+  static void append_tuple(std::string &out, const Tuple &tuple);
+  /**
+   * 按照二进制协议输出一行，放在WIRE_FRAME_ROWS帧中
+   */
+  static void encode_tuple(std::string &out, const Tuple &tuple);
+
 public:
   const TupleSchema &schema() const
   {
@@ -223,16 +308,39 @@ private:
   TupleSchema schema_;
 };
 
+/**
+ * 把记录转换成tuple放入tuple_set中，tuple_set的schema需要在创建converter之前设置好。
+ * 每个输出字段在表中的位置在构造时查找一次，转换时直接从记录数据中读取字段
+ */
 class TupleRecordConverter
 {
 public:
+  /**
+   * tuple_set的schema最后两个字段是RID_PAGE_FIELD和RID_SLOT_FIELD时，在tuple的最后加上记录的rid
+   */
   TupleRecordConverter(Table *table, TupleSet &tuple_set);
 
-  void add_record(const char *record);
+  void add_record(const char *record, const RID *rid = nullptr);
+  /**
+   * 把记录中schema的字段追加到tuple中，不包括rid
+   */
+  void add_values(const char *record, Tuple &tuple) const;
+
+  /**
+   * 转换时用到的字段在表中的序号，扫描PAX格式的表时只需要读取这些字段
+   */
+  const std::vector<int> &field_indexes() const
+  {
+    return field_indexes_;
+  }
 
 private:
   Table *table_;
   TupleSet &tuple_set_;
+  std::vector<int> field_indexes_;              // schema中每个字段在表中的序号
+  std::vector<const FieldMeta *> field_metas_;
+  std::vector<NullFlag> null_flags_;            // 这些字段的null标志
+  bool with_rid_ = false;
 };
 
 #endif //__OBSERVER_SQL_EXECUTOR_TUPLE_H_
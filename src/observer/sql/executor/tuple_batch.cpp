@@ -0,0 +1,339 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Columnar batch of tuples and the kernels that work on it.
+//
+
+#include <assert.h>
+#include <float.h>
+#include <limits.h>
+#include <string.h>
+
+#include "common/time/datetime.h"
+#include "sql/executor/tuple_batch.h"
+#include "storage/common/table.h"
+#include "storage/common/dictionary.h"
+
+void TupleBatch::init(const TupleSchema &schema, const std::vector<int> &columns)
+{
+  schema_ = schema;
+  column_pos_.assign(schema.fields().size(), -1);
+  columns_.clear();
+  for (int index : columns)
+  {
+    if (column_pos_[index] >= 0)
+    {
+      continue;
+    }
+    column_pos_[index] = columns_.size();
+    columns_.emplace_back();
+    Column &col = columns_.back();
+    col.type = schema.field(index).type();
+    col.nulls.reserve(TUPLE_BATCH_CAPACITY);
+    if (CHARS == col.type)
+    {
+      col.offsets.reserve(TUPLE_BATCH_CAPACITY);
+    }
+    else if (FLOATS == col.type)
+    {
+      col.floats.reserve(TUPLE_BATCH_CAPACITY);
+    }
+    else
+    {
+      col.ints.reserve(TUPLE_BATCH_CAPACITY);
+    }
+  }
+  size_ = 0;
+}
+
+void TupleBatch::clear()
+{
+  for (Column &col : columns_)
+  {
+    col.ints.clear();
+    col.floats.clear();
+    col.chars.clear();
+    col.offsets.clear();
+    col.nulls.clear();
+  }
+  size_ = 0;
+}
+
+int TupleBatch::add_row()
+{
+  for (Column &col : columns_)
+  {
+    col.nulls.push_back(1);
+    if (CHARS == col.type)
+    {
+      col.offsets.push_back(col.chars.size());
+      col.chars.push_back('\0');
+    }
+    else if (FLOATS == col.type)
+    {
+      col.floats.push_back(0);
+    }
+    else
+    {
+      col.ints.push_back(0);
+    }
+  }
+  return size_++;
+}
+
+void TupleBatch::set_int(int index, int row, int value)
+{
+  Column &col = column(index);
+  col.ints[row] = value;
+  col.nulls[row] = 0;
+}
+
+void TupleBatch::set_float(int index, int row, float value)
+{
+  Column &col = column(index);
+  col.floats[row] = value;
+  col.nulls[row] = 0;
+}
+
+void TupleBatch::set_chars(int index, int row, const char *value, int len)
+{
+  // 只能设置最后一行，替换掉add_row时放入的空字符串
+  Column &col = column(index);
+  assert(row == size_ - 1);
+  col.chars.resize(col.offsets[row]);
+  col.chars.insert(col.chars.end(), value, value + len);
+  col.chars.push_back('\0');
+  col.nulls[row] = 0;
+}
+
+/**
+ * tuple中的日期是yyyy-mm-dd格式的字符串，转成从1970-01-01开始的天数
+ */
+static int date_string_to_int(const char *s)
+{
+  int days = 0;
+  common::parse_date(s, &days);
+  return days;
+}
+
+void TupleBatch::add_tuple(const Tuple &tuple)
+{
+  const int row = add_row();
+  for (size_t index = 0; index < column_pos_.size(); index++)
+  {
+    if (column_pos_[index] < 0)
+    {
+      continue;
+    }
+    if (tuple.is_null(index))
+    {
+      continue;
+    }
+    switch (column(index).type)
+    {
+    case INTS:
+      set_int(index, row, tuple.get_int(index));
+      break;
+    case FLOATS:
+      set_float(index, row, tuple.get_float(index));
+      break;
+    case DATES:
+      set_int(index, row, date_string_to_int(tuple.get_string(index)));
+      break;
+    default:
+      set_chars(index, row, tuple.get_string(index), tuple.get_len(index));
+      break;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TupleBatchConverter::TupleBatchConverter(Table *table, TupleBatch &batch) : batch_(batch)
+{
+  const TableMeta &table_meta = table->table_meta();
+  const std::vector<TupleField> &fields = batch_.schema().fields();
+  for (size_t index = 0; index < fields.size(); index++)
+  {
+    if (!batch_.has_column(index))
+    {
+      continue;
+    }
+    int i = table_meta.find_field_index_by_name(fields[index].field_name());
+    assert(i != -1);
+    columns_.push_back(index);
+    field_indexes_.push_back(i);
+    field_metas_.push_back(table_meta.field(i));
+    null_flags_.push_back(table_meta.null_flag(i));
+  }
+}
+
+void TupleBatchConverter::add_record(const char *record)
+{
+  const int row = batch_.add_row();
+  for (size_t pos = 0; pos < columns_.size(); pos++)
+  {
+    if (null_flags_[pos].test(record))
+    {
+      continue;
+    }
+    const FieldMeta *field_meta = field_metas_[pos];
+    const char *data = record + field_meta->offset();
+    if (field_meta->dictionary() != nullptr)
+    {
+      const std::string &s = field_meta->dictionary()->value(*(const int *)data);
+      batch_.set_chars(columns_[pos], row, s.data(), (int)s.size());
+      continue;
+    }
+    switch (field_meta->type())
+    {
+    case INTS:
+    case DATES:
+      batch_.set_int(columns_[pos], row, *(const int *)data);
+      break;
+    case FLOATS:
+      batch_.set_float(columns_[pos], row, *(const float *)data);
+      break;
+    default:
+      batch_.set_chars(columns_[pos], row, data, strnlen(data, field_meta->len()));
+      break;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int batch_count_not_null(const uint8_t *nulls, int n)
+{
+  int count = 0;
+  for (int i = 0; i < n; i++)
+  {
+    count += nulls[i] == 0;
+  }
+  return count;
+}
+
+int64_t batch_sum_int(const int *values, const uint8_t *nulls, int n)
+{
+  int64_t sum = 0;
+  for (int i = 0; i < n; i++)
+  {
+    sum += nulls[i] == 0 ? values[i] : 0;
+  }
+  return sum;
+}
+
+void batch_sum_float(const float *values, const uint8_t *nulls, int n, float *sum)
+{
+  // 浮点数的加法没有结合律，保持按行累加的顺序
+  float result = *sum;
+  for (int i = 0; i < n; i++)
+  {
+    if (nulls[i] == 0)
+    {
+      result += values[i];
+    }
+  }
+  *sum = result;
+}
+
+bool batch_min_int(const int *values, const uint8_t *nulls, int n, int *result)
+{
+  int min_value = INT_MAX;
+  int count = 0;
+  for (int i = 0; i < n; i++)
+  {
+    int value = nulls[i] == 0 ? values[i] : INT_MAX;
+    min_value = value < min_value ? value : min_value;
+    count += nulls[i] == 0;
+  }
+  *result = min_value;
+  return count > 0;
+}
+
+bool batch_max_int(const int *values, const uint8_t *nulls, int n, int *result)
+{
+  int max_value = INT_MIN;
+  int count = 0;
+  for (int i = 0; i < n; i++)
+  {
+    int value = nulls[i] == 0 ? values[i] : INT_MIN;
+    max_value = value > max_value ? value : max_value;
+    count += nulls[i] == 0;
+  }
+  *result = max_value;
+  return count > 0;
+}
+
+bool batch_min_float(const float *values, const uint8_t *nulls, int n, float *result)
+{
+  float min_value = FLT_MAX;
+  int count = 0;
+  for (int i = 0; i < n; i++)
+  {
+    float value = nulls[i] == 0 ? values[i] : FLT_MAX;
+    min_value = value < min_value ? value : min_value;
+    count += nulls[i] == 0;
+  }
+  *result = min_value;
+  return count > 0;
+}
+
+bool batch_max_float(const float *values, const uint8_t *nulls, int n, float *result)
+{
+  float max_value = -FLT_MAX;
+  int count = 0;
+  for (int i = 0; i < n; i++)
+  {
+    float value = nulls[i] == 0 ? values[i] : -FLT_MAX;
+    max_value = value > max_value ? value : max_value;
+    count += nulls[i] == 0;
+  }
+  *result = max_value;
+  return count > 0;
+}
+
+void batch_summarize_int(const int *values, const uint8_t *nulls, int n, BatchIntSummary *summary)
+{
+  int count = 0;
+  int64_t sum = 0;
+  int min_value = INT_MAX;
+  int max_value = INT_MIN;
+  for (int i = 0; i < n; i++)
+  {
+    const bool valid = nulls[i] == 0;
+    const int value = values[i];
+    count += valid;
+    sum += valid ? value : 0;
+    min_value = valid && value < min_value ? value : min_value;
+    max_value = valid && value > max_value ? value : max_value;
+  }
+  summary->count = count;
+  summary->sum = sum;
+  summary->min = min_value;
+  summary->max = max_value;
+}
+
+void batch_summarize_float(const float *values, const uint8_t *nulls, int n, BatchFloatSummary *summary)
+{
+  int count = 0;
+  float min_value = FLT_MAX;
+  float max_value = -FLT_MAX;
+  for (int i = 0; i < n; i++)
+  {
+    const bool valid = nulls[i] == 0;
+    const float value = values[i];
+    count += valid;
+    min_value = valid && value < min_value ? value : min_value;
+    max_value = valid && value > max_value ? value : max_value;
+  }
+  summary->count = count;
+  summary->min = min_value;
+  summary->max = max_value;
+}
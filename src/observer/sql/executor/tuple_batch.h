@@ -0,0 +1,172 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Columnar batch of tuples and the kernels that work on it.
+//
+
+#ifndef __OBSERVER_SQL_EXECUTOR_TUPLE_BATCH_H_
+#define __OBSERVER_SQL_EXECUTOR_TUPLE_BATCH_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "sql/executor/tuple.h"
+
+#define TUPLE_BATCH_CAPACITY 1024  // 一批数据的目标行数，从表中读取时可能多出一个页面的记录
+
+
+/**
+ * 按列保存的一批tuple。INTS和DATES保存成int(日期是从1970-01-01开始的天数)，FLOATS保存成float，
+ * CHARS的值以'\0'结尾依次放在一起。每列有一个null标志数组，一个字节对应一行，1表示null。
+ * 只保存init时指定的列，聚合这样只用到少数几列的算子不用转换其它的列
+ */
+class TupleBatch {
+public:
+  TupleBatch() = default;
+
+  /**
+   * columns是需要保存的列在schema中的位置
+   */
+  void init(const TupleSchema &schema, const std::vector<int> &columns);
+
+  const TupleSchema &schema() const
+  {
+    return schema_;
+  }
+  bool has_column(int index) const
+  {
+    return index < (int)column_pos_.size() && column_pos_[index] >= 0;
+  }
+  int size() const
+  {
+    return size_;
+  }
+  bool full() const
+  {
+    return size_ >= TUPLE_BATCH_CAPACITY;
+  }
+  void clear();
+
+  /**
+   * 在最后添加一行，之后用set_xxx设置这一行每一列的值，没有设置的列是null
+   */
+  int add_row();
+  void set_int(int index, int row, int value);
+  void set_float(int index, int row, float value);
+  void set_chars(int index, int row, const char *value, int len);
+  /**
+   * 把tuple中需要保存的列添加到批次中
+   */
+  void add_tuple(const Tuple &tuple);
+
+  const int *int_values(int index) const
+  {
+    return column(index).ints.data();
+  }
+  const float *float_values(int index) const
+  {
+    return column(index).floats.data();
+  }
+  const char *chars_value(int index, int row) const
+  {
+    const Column &col = column(index);
+    return col.chars.data() + col.offsets[row];
+  }
+  const uint8_t *nulls(int index) const
+  {
+    return column(index).nulls.data();
+  }
+
+private:
+  struct Column {
+    AttrType type;
+    std::vector<int> ints;
+    std::vector<float> floats;
+    std::vector<char> chars;
+    std::vector<int> offsets;  // CHARS每个值在chars中开始的位置
+    std::vector<uint8_t> nulls;
+  };
+
+  Column &column(int index)
+  {
+    return columns_[column_pos_[index]];
+  }
+  const Column &column(int index) const
+  {
+    return columns_[column_pos_[index]];
+  }
+
+private:
+  TupleSchema schema_;
+  std::vector<int> column_pos_;  // schema中每一列在columns_中的位置，不保存的列是-1
+  std::vector<Column> columns_;
+  int size_ = 0;
+};
+
+/**
+ * 把记录直接转换到批次中，不经过Tuple和TupleValue
+ */
+class TupleBatchConverter {
+public:
+  TupleBatchConverter(Table *table, TupleBatch &batch);
+
+  void add_record(const char *record);
+
+  /**
+   * 批次中的列在表中的序号，扫描PAX格式的表时只需要读取这些字段
+   */
+  const std::vector<int> &field_indexes() const
+  {
+    return field_indexes_;
+  }
+
+private:
+  TupleBatch &batch_;
+  std::vector<int> columns_;                    // 批次中保存的列在schema中的位置
+  std::vector<int> field_indexes_;              // 这些列在表中的序号
+  std::vector<const FieldMeta *> field_metas_;
+  std::vector<NullFlag> null_flags_;            // 这些列的null标志
+};
+
+/**
+ * 按列计算的内核，nulls中非0的行被跳过。循环里没有分支和虚函数调用，编译器可以自动向量化。
+ * min/max在没有非null的值时返回false
+ */
+int batch_count_not_null(const uint8_t *nulls, int n);
+int64_t batch_sum_int(const int *values, const uint8_t *nulls, int n);
+/**
+ * 按行的顺序累加到sum上，和一行一行累加的结果相同
+ */
+void batch_sum_float(const float *values, const uint8_t *nulls, int n, float *sum);
+bool batch_min_int(const int *values, const uint8_t *nulls, int n, int *result);
+bool batch_max_int(const int *values, const uint8_t *nulls, int n, int *result);
+bool batch_min_float(const float *values, const uint8_t *nulls, int n, float *result);
+bool batch_max_float(const float *values, const uint8_t *nulls, int n, float *result);
+
+/**
+ * 同一列上有多个聚合函数时一次遍历算出所有需要的结果。count为0时min/max没有意义。
+ * 浮点数的和不在这里计算，它要按行的顺序累加到每个聚合函数已有的和上
+ */
+struct BatchIntSummary {
+  int count;
+  int64_t sum;
+  int min;
+  int max;
+};
+struct BatchFloatSummary {
+  int count;
+  float min;
+  float max;
+};
+void batch_summarize_int(const int *values, const uint8_t *nulls, int n, BatchIntSummary *summary);
+void batch_summarize_float(const float *values, const uint8_t *nulls, int n, BatchFloatSummary *summary);
+
+#endif  // __OBSERVER_SQL_EXECUTOR_TUPLE_BATCH_H_
@@ -0,0 +1,278 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Normalized sort keys and the in-memory sort used by ORDER BY.
+//
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "sql/executor/tuple_sort.h"
+#include "common/log/log.h"
+
+static void append_uint32(std::string &key, uint32_t value) {
+  // 大端序，按字节比较和按整数比较的结果一样
+  key.push_back((char)(value >> 24));
+  key.push_back((char)(value >> 16));
+  key.push_back((char)(value >> 8));
+  key.push_back((char)value);
+}
+
+void make_sort_key(const Tuple &tuple, const std::vector<SortField> &fields, std::string &key) {
+  key.clear();
+  for (const SortField &field : fields) {
+    const size_t start = key.size();
+    if (tuple.is_null(field.index)) {
+      key.push_back(0);
+    } else {
+      key.push_back(1);
+      switch (field.type) {
+        case INTS: {
+          // 翻转符号位，负数排在正数前面
+          uint32_t bits = (uint32_t)tuple.get_int(field.index);
+          append_uint32(key, bits ^ 0x80000000u);
+        } break;
+        case FLOATS: {
+          // 正数翻转符号位，负数翻转所有的位
+          float f = tuple.get_float(field.index);
+          f = f == 0 ? 0 : f;
+          uint32_t bits = 0;
+          memcpy(&bits, &f, sizeof(bits));
+          append_uint32(key, (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u));
+        } break;
+        default: {
+          // CHARS和yyyy-mm-dd格式的DATES中没有'\0'，以'\0'结尾时短的字符串排在前面
+          key.append(tuple.get_string(field.index));
+          key.push_back('\0');
+        } break;
+      }
+    }
+    if (field.desc) {
+      for (size_t i = start; i < key.size(); i++) {
+        key[i] = ~key[i];
+      }
+    }
+  }
+}
+
+namespace {
+
+struct SortTask {
+  std::vector<SortEntry>::iterator begin;
+  std::vector<SortEntry>::iterator end;
+};
+
+void *sort_routine(void *arg) {
+  SortTask *task = (SortTask *)arg;
+  std::sort(task->begin, task->end);
+  return nullptr;
+}
+
+}  // namespace
+
+void sort_entries(std::vector<SortEntry> &entries) {
+  int thread_num = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  thread_num = std::max(1, std::min(thread_num, SORT_MAX_THREADS));
+  if (entries.size() < SORT_PARALLEL_THRESHOLD || thread_num == 1) {
+    std::sort(entries.begin(), entries.end());
+    return;
+  }
+
+  // 每段由一个线程排序，创建线程失败时在当前线程排序
+  const size_t chunk_size = (entries.size() + thread_num - 1) / thread_num;
+  std::vector<SortTask> tasks;
+  for (size_t start = 0; start < entries.size(); start += chunk_size) {
+    size_t end = std::min(start + chunk_size, entries.size());
+    tasks.push_back(SortTask{entries.begin() + start, entries.begin() + end});
+  }
+  std::vector<pthread_t> threads(tasks.size());
+  std::vector<bool> started(tasks.size(), false);
+  for (size_t i = 0; i < tasks.size(); i++) {
+    int ret = pthread_create(&threads[i], nullptr, sort_routine, &tasks[i]);
+    if (ret != 0) {
+      LOG_WARN("Failed to create sort thread. error=%s", strerror(ret));
+      sort_routine(&tasks[i]);
+      continue;
+    }
+    started[i] = true;
+  }
+  for (size_t i = 0; i < tasks.size(); i++) {
+    if (started[i]) {
+      pthread_join(threads[i], nullptr);
+    }
+  }
+
+  // 相邻的两段归并，直到只剩一段
+  while (tasks.size() > 1) {
+    std::vector<SortTask> merged;
+    for (size_t i = 0; i + 1 < tasks.size(); i += 2) {
+      std::inplace_merge(tasks[i].begin, tasks[i].end, tasks[i + 1].end);
+      merged.push_back(SortTask{tasks[i].begin, tasks[i + 1].end});
+    }
+    if (tasks.size() % 2 == 1) {
+      merged.push_back(tasks.back());
+    }
+    tasks.swap(merged);
+  }
+}
+
+size_t sort_row_memory(const std::string &key, const Tuple &tuple) {
+  return sizeof(SortEntry) + key.capacity() + tuple.memory_size();
+}
+
+RC write_sort_row(FILE *file, const std::string &key, const Tuple &tuple, const TupleSchema &schema) {
+  const uint32_t key_len = key.size();
+  bool ok = fwrite(&key_len, sizeof(key_len), 1, file) == 1 && (key_len == 0 || fwrite(key.data(), key_len, 1, file) == 1);
+  for (int i = 0; ok && i < tuple.size(); i++) {
+    const char null_flag = tuple.is_null(i) ? 1 : 0;
+    ok = fwrite(&null_flag, sizeof(null_flag), 1, file) == 1;
+    if (!ok || null_flag != 0) {
+      continue;
+    }
+    switch (schema.field(i).type()) {
+      case INTS: {
+        int v = tuple.get_int(i);
+        ok = fwrite(&v, sizeof(v), 1, file) == 1;
+      } break;
+      case FLOATS: {
+        float v = tuple.get_float(i);
+        ok = fwrite(&v, sizeof(v), 1, file) == 1;
+      } break;
+      default: {
+        const uint32_t len = tuple.get_len(i);
+        ok = fwrite(&len, sizeof(len), 1, file) == 1 && (len == 0 || fwrite(tuple.get_string(i), len, 1, file) == 1);
+      } break;
+    }
+  }
+  if (!ok) {
+    LOG_ERROR("Failed to write sort run. error=%s", strerror(errno));
+    return RC::IOERR_WRITE;
+  }
+  return RC::SUCCESS;
+}
+
+static bool read_string(FILE *file, std::string &value) {
+  uint32_t len = 0;
+  if (fread(&len, sizeof(len), 1, file) != 1) {
+    return false;
+  }
+  value.resize(len);
+  return len == 0 || fread(&value[0], len, 1, file) == 1;
+}
+
+RC rewind_sort_file(FILE *file) {
+  if (fflush(file) != 0) {
+    LOG_ERROR("Failed to flush sort run. error=%s", strerror(errno));
+    return RC::IOERR_WRITE;
+  }
+  rewind(file);
+  return RC::SUCCESS;
+}
+
+RC read_sort_row(FILE *file, const TupleSchema &schema, std::string &key, Tuple &tuple, bool &eof) {
+  uint32_t key_len = 0;
+  if (fread(&key_len, sizeof(key_len), 1, file) != 1) {
+    eof = true;
+    return RC::SUCCESS;
+  }
+  eof = false;
+  key.resize(key_len);
+  bool ok = key_len == 0 || fread(&key[0], key_len, 1, file) == 1;
+
+  tuple = Tuple();
+  std::string chars;
+  const int field_num = schema.fields().size();
+  for (int i = 0; ok && i < field_num; i++) {
+    char null_flag = 0;
+    ok = fread(&null_flag, sizeof(null_flag), 1, file) == 1;
+    if (!ok) {
+      break;
+    }
+    if (null_flag != 0) {
+      tuple.add("NULL", 4, true);
+      continue;
+    }
+    switch (schema.field(i).type()) {
+      case INTS: {
+        int v = 0;
+        ok = fread(&v, sizeof(v), 1, file) == 1;
+        tuple.add(v);
+      } break;
+      case FLOATS: {
+        float v = 0;
+        ok = fread(&v, sizeof(v), 1, file) == 1;
+        tuple.add(v);
+      } break;
+      default: {
+        ok = read_string(file, chars);
+        tuple.add(chars.data(), chars.size());
+      } break;
+    }
+  }
+  if (!ok) {
+    LOG_ERROR("Sort run is truncated");
+    return RC::IOERR_SHORT_READ;
+  }
+  return RC::SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+RC SortRunMerger::init(const TupleSchema &schema, const std::vector<FILE *> &runs) {
+  schema_ = schema;
+  runs_ = runs;
+  keys_.assign(runs.size(), std::string());
+  tuples_.clear();
+  tuples_.resize(runs.size());
+  heap_.clear();
+  for (size_t i = 0; i < runs_.size(); i++) {
+    RC rc = rewind_sort_file(runs_[i]);
+    if (rc == RC::SUCCESS) {
+      rc = fetch(i);
+    }
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+bool SortRunMerger::after(int left, int right) const {
+  // std::push_heap是大顶堆，用"排在后面"作为比较得到小顶堆
+  int cmp = keys_[left].compare(keys_[right]);
+  return cmp > 0 || (cmp == 0 && left > right);
+}
+
+RC SortRunMerger::fetch(int run) {
+  bool eof = false;
+  RC rc = read_sort_row(runs_[run], schema_, keys_[run], tuples_[run], eof);
+  if (rc != RC::SUCCESS || eof) {
+    return rc;
+  }
+
+  heap_.push_back(run);
+  std::push_heap(heap_.begin(), heap_.end(), [this](int left, int right) { return after(left, right); });
+  return RC::SUCCESS;
+}
+
+RC SortRunMerger::next(std::string &key, Tuple &tuple) {
+  if (heap_.empty()) {
+    return RC::RECORD_EOF;
+  }
+  std::pop_heap(heap_.begin(), heap_.end(), [this](int left, int right) { return after(left, right); });
+  const int run = heap_.back();
+  heap_.pop_back();
+  key.swap(keys_[run]);
+  tuple = std::move(tuples_[run]);
+  return fetch(run);
+}
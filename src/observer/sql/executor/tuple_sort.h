@@ -0,0 +1,103 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Normalized sort keys and the in-memory sort used by ORDER BY.
+//
+
+#ifndef __OBSERVER_SQL_EXECUTOR_TUPLE_SORT_H_
+#define __OBSERVER_SQL_EXECUTOR_TUPLE_SORT_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "rc.h"
+#include "sql/executor/tuple.h"
+
+#define SORT_PARALLEL_THRESHOLD 65536  // 超过这么多行时分段用多个线程排序
+#define SORT_MAX_THREADS 8
+#define SORT_MEMORY_BUDGET (64 * 1024 * 1024)  // 缓存的数据估计超过这个值时把排好序的一段写到临时文件中
+#define SORT_MERGE_FAN_IN 64                   // 一次最多归并这么多段，同时打开的临时文件不会太多
+
+/**
+ * 一个排序字段，index是字段在schema中的位置
+ */
+struct SortField {
+  int index;
+  AttrType type;
+  bool desc;
+};
+
+/**
+ * 把tuple的排序字段编码成按字节比较(memcmp)就能得到排序结果的key，
+ * 排序时不再通过TupleValue::compare的虚函数比较。NULL比所有的值都小，降序时排在最后
+ */
+void make_sort_key(const Tuple &tuple, const std::vector<SortField> &fields, std::string &key);
+
+struct SortEntry {
+  std::string key;
+  int index;  // tuple在输入中的序号，key相同时按照输入的顺序，排序的结果是确定的
+
+  bool operator<(const SortEntry &other) const {
+    int cmp = key.compare(other.key);
+    return cmp < 0 || (cmp == 0 && index < other.index);
+  }
+};
+
+/**
+ * 用std::sort排序。超过SORT_PARALLEL_THRESHOLD行时分成几段，每段由一个线程排序，再两两归并
+ */
+void sort_entries(std::vector<SortEntry> &entries);
+
+/**
+ * 估计排序时缓存一行占用的内存
+ */
+size_t sort_row_memory(const std::string &key, const Tuple &tuple);
+
+/**
+ * 外部排序的临时文件中一行的格式：key的长度和内容，之后是每个值：一个字节的null标志，
+ * 不是null时INTS和FLOATS是4个字节，其它类型是长度加上内容。值的类型来自schema
+ */
+RC write_sort_row(FILE *file, const std::string &key, const Tuple &tuple, const TupleSchema &schema);
+/**
+ * 写完之后回到文件开头开始读。缓冲区中还没写到文件的数据写入失败(比如超出SpillQuota)时返回RC::IOERR_WRITE
+ */
+RC rewind_sort_file(FILE *file);
+/**
+ * 读到文件末尾时eof为true
+ */
+RC read_sort_row(FILE *file, const TupleSchema &schema, std::string &key, Tuple &tuple, bool &eof);
+
+/**
+ * 多个排好序的段的k路归并，key相同时前面的段中的行先输出，和整体排序的结果一样。
+ * 文件由调用者打开和关闭，init时从头读取
+ */
+class SortRunMerger {
+public:
+  RC init(const TupleSchema &schema, const std::vector<FILE *> &runs);
+  /**
+   * 取出下一行，所有的段都读完时返回RECORD_EOF
+   */
+  RC next(std::string &key, Tuple &tuple);
+
+private:
+  bool after(int left, int right) const;
+  RC fetch(int run);
+
+private:
+  TupleSchema schema_;
+  std::vector<FILE *> runs_;
+  std::vector<std::string> keys_;  // 每一段当前的第一行
+  std::vector<Tuple> tuples_;
+  std::vector<int> heap_;          // 还没有读完的段，小顶堆
+};
+
+#endif  // __OBSERVER_SQL_EXECUTOR_TUPLE_SORT_H_
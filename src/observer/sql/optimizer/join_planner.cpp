@@ -0,0 +1,383 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Cost based join order and join method selection for multi-table selects.
+//
+
+#include <string.h>
+#include <algorithm>
+
+#include "sql/optimizer/join_planner.h"
+#include "storage/common/like_matcher.h"
+#include "storage/common/table.h"
+#include "storage/default/default_handler.h"
+#include "common/log/log.h"
+
+// 没有统计信息可用时的选择率，和System R的默认值相同
+#define DEFAULT_EQUAL_SELECTIVITY 0.1
+#define DEFAULT_RANGE_SELECTIVITY (1.0 / 3)
+#define DEFAULT_NOT_EQUAL_SELECTIVITY 0.9
+
+// hash join建hash表的每一行比探测的一行代价高
+#define HASH_BUILD_COST_FACTOR 2.0
+// 索引嵌套循环join每次在索引上查找的代价，不包括读取匹配的记录
+#define INDEX_PROBE_COST 4.0
+
+// 最优的代价小于from顺序的代价除以这个值时才改变join的顺序
+#define JOIN_REORDER_THRESHOLD 2.0
+
+const char *join_method_name(JoinMethod method) {
+  switch (method) {
+    case JoinMethod::NESTED_LOOP:
+      return "nested loop";
+    case JoinMethod::HASH:
+      return "hash";
+    case JoinMethod::INDEX_NESTED_LOOP:
+      return "index nested loop";
+  }
+  return "unknown";
+}
+
+bool hash_join_key_usable(AttrType left, AttrType right) {
+  return left == right && left != FLOATS;
+}
+
+void JoinPlan::to_string(const Selects &selects, std::string &output) const {
+  for (size_t i = 0; i < steps.size(); i++) {
+    if (i > 0) {
+      output.append(" -(").append(join_method_name(steps[i].method)).append(")-> ");
+    }
+    output.append(selects.relations[steps[i].relation]);
+  }
+}
+
+namespace {
+
+struct Relation {
+  Table *table;
+  TableStats stats;
+  double rows;  // 经过只和这张表有关的条件过滤之后估计的行数
+};
+
+/**
+ * 两边是不同表的字段的条件
+ */
+struct JoinCondition {
+  int index;  // 在selects.conditions中的位置
+  int left;   // 左边字段的表在selects.relations中的位置
+  int right;
+  bool hash_key;
+  double selectivity;
+  // 可以用这一边的索引查找时，每次查找读取的记录数，不能用索引时小于0
+  double left_lookup_rows = -1;
+  double right_lookup_rows = -1;
+};
+
+int find_relation(const Selects &selects, const char *name) {
+  if (name == nullptr) {
+    return -1;
+  }
+  for (size_t i = 0; i < selects.relation_num; i++) {
+    if (0 == strcmp(selects.relations[i], name)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * 字段不同值的个数，没有统计时返回-1
+ */
+int distinct_count(const Relation &relation, const char *field_name) {
+  int index = relation.table->table_meta().find_field_index_by_name(field_name);
+  if (index < 0 || index >= (int)relation.stats.distinct_counts.size()) {
+    return -1;
+  }
+  return relation.stats.distinct_counts[index];
+}
+
+/**
+ * ANALYZE TABLE得到的字段统计信息，没有分析过时返回nullptr
+ */
+const ColumnStats *column_stats(const Relation &relation, const char *field_name) {
+  int index = relation.table->table_meta().find_field_index_by_name(field_name);
+  if (index < 0 || index >= (int)relation.stats.columns.size() || !relation.stats.columns[index].valid()) {
+    return nullptr;
+  }
+  return &relation.stats.columns[index];
+}
+
+/**
+ * 字段和值比较的条件的选择率，value_on_left为true时条件是"值 op 字段"
+ */
+double filter_selectivity(const Relation &relation, const Condition &condition, const char *field_name,
+    bool value_on_left) {
+  const ColumnStats *stats = column_stats(relation, field_name);
+  switch (condition.comp) {
+    case EQUAL_TO: {
+      if (stats != nullptr) {
+        return stats->equal_selectivity();
+      }
+      int distinct = distinct_count(relation, field_name);
+      return distinct > 0 ? 1.0 / distinct : DEFAULT_EQUAL_SELECTIVITY;
+    }
+    case NOT_EQUAL:
+    case NOT_LIKE_OP:
+      return DEFAULT_NOT_EQUAL_SELECTIVITY;
+    case IS_NOT_NULL:
+      return stats != nullptr ? 1 - stats->null_fraction() : DEFAULT_NOT_EQUAL_SELECTIVITY;
+    case IS_NULL:
+      return stats != nullptr ? stats->null_fraction() : DEFAULT_EQUAL_SELECTIVITY;
+    case LESS_THAN:
+    case LESS_EQUAL:
+    case GREAT_THAN:
+    case GREAT_EQUAL: {
+      const Value &value = value_on_left ? condition.left_value : condition.right_value;
+      double number = 0;
+      if (stats != nullptr && !value.is_null && value.data != nullptr &&
+          ColumnStats::to_number(value.type, value.data, &number)) {
+        // 都按"字段 op 值"估计
+        CompOp comp = condition.comp;
+        if (value_on_left) {
+          comp = comp == LESS_THAN ? GREAT_THAN : comp == LESS_EQUAL ? GREAT_EQUAL
+               : comp == GREAT_THAN ? LESS_THAN : LESS_EQUAL;
+        }
+        double selectivity = stats->compare_selectivity(comp, number);
+        if (selectivity >= 0) {
+          return selectivity;
+        }
+      }
+      return DEFAULT_RANGE_SELECTIVITY;
+    }
+    default:
+      return DEFAULT_RANGE_SELECTIVITY;
+  }
+}
+
+/**
+ * 按照order的顺序join的代价，每一步选择代价最小的join方法。steps不为nullptr时返回每一步的方法
+ */
+double join_cost(const std::vector<Relation> &relations, const std::vector<JoinCondition> &conditions,
+    const std::vector<int> &order, std::vector<JoinStep> *steps) {
+  std::vector<bool> joined(relations.size(), false);
+  joined[order[0]] = true;
+  double rows = relations[order[0]].rows;
+  double cost = rows;
+  for (size_t k = 1; k < order.size(); k++) {
+    const int next = order[k];
+    const double next_rows = relations[next].rows;
+    double output_rows = rows * next_rows;
+    bool hash = false;
+    int lookup_condition = -1;
+    double lookup_rows = 0;
+    for (const JoinCondition &condition : conditions) {
+      if ((condition.left == next && joined[condition.right]) || (condition.right == next && joined[condition.left])) {
+        output_rows *= condition.selectivity;
+        hash = hash || condition.hash_key;
+        double rows_per_lookup = condition.left == next ? condition.left_lookup_rows : condition.right_lookup_rows;
+        if (rows_per_lookup >= 0 && (lookup_condition < 0 || rows_per_lookup < lookup_rows)) {
+          lookup_condition = condition.index;
+          lookup_rows = rows_per_lookup;
+        }
+      }
+    }
+    output_rows = std::max(output_rows, 1.0);
+
+    // 嵌套循环对每个外层的行都要访问内层所有的行；hash join用行数少的一边建hash表，另一边的每一行探测一次；
+    // 这两种都要扫描一次内层的表。索引嵌套循环不扫描内层的表，外层的每一行在索引上查找一次
+    JoinStep step{next, JoinMethod::NESTED_LOOP};
+    double step_cost = next_rows + rows * next_rows;
+    const double hash_cost = next_rows + std::min(rows, next_rows) * HASH_BUILD_COST_FACTOR + std::max(rows, next_rows);
+    if (hash && hash_cost < step_cost) {
+      step.method = JoinMethod::HASH;
+      step.build_left = rows < next_rows;
+      step_cost = hash_cost;
+    }
+    if (lookup_condition >= 0 && rows * (INDEX_PROBE_COST + lookup_rows) < step_cost) {
+      step.method = JoinMethod::INDEX_NESTED_LOOP;
+      step.condition = lookup_condition;
+      step_cost = rows * (INDEX_PROBE_COST + lookup_rows);
+    }
+    cost += step_cost + output_rows;
+    if (steps != nullptr) {
+      steps->push_back(step);
+    }
+
+    joined[next] = true;
+    rows = output_rows;
+  }
+  return cost;
+}
+
+}  // namespace
+
+RC plan_join(const Selects &selects, const char *db, JoinPlan &plan) {
+  plan.steps.clear();
+  plan.cost = 0;
+  const int relation_num = selects.relation_num;
+  if (relation_num <= 1) {
+    return RC::SUCCESS;
+  }
+
+  std::vector<Relation> relations(relation_num);
+  for (int i = 0; i < relation_num; i++) {
+    if (find_relation(selects, selects.relations[i]) != i) {
+      // 同一张表出现多次时字段的表名有歧义
+      return RC::SUCCESS;
+    }
+    Relation &relation = relations[i];
+    relation.table = DefaultHandler::get_default().find_table(db, selects.relations[i]);
+    if (nullptr == relation.table) {
+      // 执行时会报告表不存在
+      return RC::SUCCESS;
+    }
+    RC rc = relation.table->statistics(relation.stats);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+    relation.rows = relation.stats.row_count;
+  }
+
+  std::vector<JoinCondition> join_conditions;
+  for (size_t i = 0; i < selects.condition_num; i++) {
+    const Condition &condition = selects.conditions[i];
+    const int left = condition.left_is_attr ? find_relation(selects, condition.left_attr.relation_name) : -1;
+    const int right = condition.right_is_attr ? find_relation(selects, condition.right_attr.relation_name) : -1;
+    if (left >= 0 && right >= 0 && left != right) {
+      const FieldMeta *left_field = relations[left].table->table_meta().field(condition.left_attr.attribute_name);
+      const FieldMeta *right_field = relations[right].table->table_meta().field(condition.right_attr.attribute_name);
+      if (nullptr == left_field || nullptr == right_field) {
+        return RC::SUCCESS;
+      }
+
+      JoinCondition join_condition;
+      join_condition.index = i;
+      join_condition.left = left;
+      join_condition.right = right;
+      join_condition.hash_key = condition.comp == EQUAL_TO && hash_join_key_usable(left_field->type(), right_field->type());
+      if (condition.comp == EQUAL_TO) {
+        // 假设值较少的一边的值都能在另一边找到。没有统计时把字段当作没有重复的值
+        int left_distinct = distinct_count(relations[left], condition.left_attr.attribute_name);
+        int right_distinct = distinct_count(relations[right], condition.right_attr.attribute_name);
+        double distinct = std::max(left_distinct > 0 ? left_distinct : relations[left].stats.row_count,
+                                   right_distinct > 0 ? right_distinct : relations[right].stats.row_count);
+        join_condition.selectivity = distinct > 0 ? 1.0 / distinct : 1.0;
+
+        // 用作索引第一个字段的字段都有统计不同值的个数，ANALYZE TABLE之后所有字段都有
+        if (join_condition.hash_key && left_distinct > 0 &&
+            relations[left].table->find_index_for_lookup(condition.left_attr.attribute_name) != nullptr) {
+          join_condition.left_lookup_rows = (double)relations[left].stats.row_count / left_distinct;
+        }
+        if (join_condition.hash_key && right_distinct > 0 &&
+            relations[right].table->find_index_for_lookup(condition.right_attr.attribute_name) != nullptr) {
+          join_condition.right_lookup_rows = (double)relations[right].stats.row_count / right_distinct;
+        }
+      } else {
+        join_condition.selectivity = condition.comp == NOT_EQUAL ? DEFAULT_NOT_EQUAL_SELECTIVITY : DEFAULT_RANGE_SELECTIVITY;
+      }
+      join_conditions.push_back(join_condition);
+    } else if (left >= 0 && !condition.right_is_attr) {
+      relations[left].rows *= filter_selectivity(relations[left], condition, condition.left_attr.attribute_name, false);
+    } else if (right >= 0 && !condition.left_is_attr) {
+      relations[right].rows *= filter_selectivity(relations[right], condition, condition.right_attr.attribute_name, true);
+    } else if (left >= 0 && left == right) {
+      relations[left].rows *= DEFAULT_RANGE_SELECTIVITY;
+    }
+  }
+  for (Relation &relation : relations) {
+    relation.rows = std::max(relation.rows, 1.0);
+  }
+
+  // relations中的表和from中的顺序相反
+  std::vector<int> from_order;
+  for (int i = relation_num - 1; i >= 0; i--) {
+    from_order.push_back(i);
+  }
+  const double from_cost = join_cost(relations, join_conditions, from_order, nullptr);
+
+  // 从每一张表开始，每次加入使得代价最小的表
+  std::vector<int> best_order = from_order;
+  double best_cost = from_cost;
+  for (int first : from_order) {
+    std::vector<int> order = {first};
+    std::vector<bool> used(relation_num, false);
+    used[first] = true;
+    while ((int)order.size() < relation_num) {
+      int best_next = -1;
+      double best_next_cost = 0;
+      for (int next : from_order) {
+        if (used[next]) {
+          continue;
+        }
+        order.push_back(next);
+        double cost = join_cost(relations, join_conditions, order, nullptr);
+        order.pop_back();
+        if (best_next < 0 || cost < best_next_cost) {
+          best_next = next;
+          best_next_cost = cost;
+        }
+      }
+      order.push_back(best_next);
+      used[best_next] = true;
+    }
+    double cost = join_cost(relations, join_conditions, order, nullptr);
+    if (cost < best_cost) {
+      best_order = order;
+      best_cost = cost;
+    }
+  }
+  if (best_cost * JOIN_REORDER_THRESHOLD > from_cost) {
+    best_order = from_order;
+  }
+
+  plan.steps.push_back(JoinStep{best_order[0], JoinMethod::NESTED_LOOP});
+  plan.cost = join_cost(relations, join_conditions, best_order, &plan.steps);
+  return RC::SUCCESS;
+}
+
+double estimate_select_cost(const Selects &selects, const char *db, const JoinPlan &plan) {
+  if (!plan.empty()) {
+    return plan.cost;
+  }
+
+  double cost = 0;
+  for (size_t i = 0; i < selects.relation_num; i++) {
+    Relation relation;
+    relation.table = DefaultHandler::get_default().find_table(db, selects.relations[i]);
+    if (nullptr == relation.table || relation.table->statistics(relation.stats) != RC::SUCCESS) {
+      continue;
+    }
+    // 只有一张表时条件的字段可能不带表名
+    const char *table_name = selects.relation_num == 1 ? nullptr : selects.relations[i];
+    double rows = relation.stats.row_count;
+    for (size_t j = 0; j < selects.condition_num; j++) {
+      const Condition &condition = selects.conditions[j];
+      const bool left_field = condition.left_is_attr && !condition.right_is_attr;
+      const bool right_field = condition.right_is_attr && !condition.left_is_attr;
+      if (!left_field && !right_field) {
+        continue;
+      }
+      const RelAttr &attr = left_field ? condition.left_attr : condition.right_attr;
+      // 模式串有前缀的LIKE可以用索引扫描前缀的范围
+      const bool like_prefix = condition.comp == LIKE_OP && left_field && like_pattern_has_prefix(condition.right_value);
+      if (((condition.comp > GREAT_THAN || condition.comp == NOT_EQUAL) && !like_prefix) ||
+          (attr.relation_name != nullptr && table_name != nullptr && 0 != strcmp(attr.relation_name, table_name))) {
+        continue;
+      }
+      if (relation.table->find_index_for_lookup(attr.attribute_name) != nullptr) {
+        rows = std::min(rows, relation.stats.row_count * filter_selectivity(relation, condition, attr.attribute_name,
+                                                                            right_field));
+      }
+    }
+    cost += std::max(rows, 1.0);
+  }
+  return cost;
+}
@@ -0,0 +1,70 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Cost based join order and join method selection for multi-table selects.
+//
+
+#ifndef __OBSERVER_SQL_OPTIMIZER_JOIN_PLANNER_H_
+#define __OBSERVER_SQL_OPTIMIZER_JOIN_PLANNER_H_
+
+#include <string>
+#include <vector>
+
+#include "rc.h"
+#include "sql/parser/parse_defs.h"
+
+enum class JoinMethod {
+  NESTED_LOOP,
+  HASH,
+  INDEX_NESTED_LOOP,  // 用左边的值在右边表的B+树索引上查找
+};
+
+const char *join_method_name(JoinMethod method);
+
+/**
+ * 等值条件两边的字段类型相同并且不是FLOATS时可以作为hash join的字段，浮点数按误差比较相等
+ */
+bool hash_join_key_usable(AttrType left, AttrType right);
+
+struct JoinStep {
+  int relation;       // 表在selects.relations中的位置
+  JoinMethod method;  // 和前面所有的表join的方法，第一张表没有意义
+  int condition = -1; // 索引嵌套循环join用来查找的条件在selects.conditions中的位置
+  bool build_left = false;  // hash join用前面join的结果建hash表，它估计的行数比这张表少
+};
+
+/**
+ * join的顺序，steps[0]是最外层的表。steps为空时按照from的顺序执行
+ */
+struct JoinPlan {
+  std::vector<JoinStep> steps;
+  double cost = 0;  // 估算的代价，大致是处理的行数
+
+  bool empty() const {
+    return steps.empty();
+  }
+  void to_string(const Selects &selects, std::string &output) const;
+};
+
+/**
+ * 根据表的统计信息估算每种join顺序的代价，选出代价最小的顺序和每一步join的方法。
+ * 按照from的顺序执行的代价和最优的代价相差不大时保留from的顺序，这样结果的顺序不会因为统计信息的小变化而改变。
+ * 只有一张表、有表不存在或者同一张表出现多次时plan为空
+ */
+RC plan_join(const Selects &selects, const char *db, JoinPlan &plan);
+
+/**
+ * 估算查询处理的行数，用于准入控制。多表查询用plan的代价；
+ * 单表查询有可以用索引的条件时是过滤后的行数，否则是表的行数。表不存在时返回0
+ */
+double estimate_select_cost(const Selects &selects, const char *db, const JoinPlan &plan);
+
+#endif  // __OBSERVER_SQL_OPTIMIZER_JOIN_PLANNER_H_
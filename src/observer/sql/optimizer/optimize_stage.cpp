@@ -22,6 +22,12 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/string.h"
 #include "common/log/log.h"
 #include "common/seda/timer_stage.h"
+#include "event/execution_plan_event.h"
+#include "event/session_event.h"
+#include "event/sql_event.h"
+#include "session/session.h"
+#include "sql/optimizer/join_planner.h"
+#include "sql/optimizer/predicate_pushdown.h"
 
 using namespace common;
 
@@ -73,10 +79,34 @@ void OptimizeStage::cleanup() {
   LOG_TRACE("Exit");
 }
 
+void OptimizeStage::optimize(Query *sql, const char *current_db, JoinPlan &join_plan) {
+  if (sql->flag != SCF_SELECT || sql->sstr.selection.relation_num <= 1) {
+    return;
+  }
+  int derived = derive_pushdown_conditions(sql->sstr.selection, &sql->arena, current_db);
+  if (derived > 0) {
+    LOG_DEBUG("Derived %d predicates from join conditions", derived);
+  }
+  RC rc = plan_join(sql->sstr.selection, current_db, join_plan);
+  if (rc != RC::SUCCESS) {
+    // 没有执行计划时按照from的顺序执行
+    LOG_WARN("Failed to plan join order. rc=%d:%s", rc, strrc(rc));
+    join_plan.steps.clear();
+  } else if (!join_plan.empty()) {
+    std::string plan_string;
+    join_plan.to_string(sql->sstr.selection, plan_string);
+    LOG_DEBUG("Join plan: %s, cost=%.0f", plan_string.c_str(), join_plan.cost);
+  }
+}
+
 void OptimizeStage::handle_event(StageEvent *event) {
   LOG_TRACE("Enter\n");
 
-  // optimize sql plan, here just pass the event to the next stage
+  ExecutionPlanEvent *exe_event = static_cast<ExecutionPlanEvent *>(event);
+  SessionEvent *session_event = exe_event->sql_event()->session_event();
+  session_event->query_trace().enter_stage("optimize");
+  const char *current_db = session_event->get_client()->session->get_current_db().c_str();
+  optimize(exe_event->sqls(), current_db, exe_event->join_plan());
   execute_stage->handle_event(event);
 
   LOG_TRACE("Exit\n");
@@ -16,12 +16,18 @@ See the Mulan PSL v2 for more details. */
 #define __OBSERVER_SQL_OPTIMIZE_STAGE_H__
 
 #include "common/seda/stage.h"
+#include "sql/optimizer/join_planner.h"
 
 class OptimizeStage : public common::Stage {
 public:
   ~OptimizeStage();
   static Stage *make_stage(const std::string &tag);
 
+  /**
+   * 多表查询推导可以下推的条件并选择join顺序。执行计划缓存也用它优化缓存的语句
+   */
+  static void optimize(Query *sql, const char *current_db, JoinPlan &join_plan);
+
 protected:
   // common function
   OptimizeStage(const char *tag);
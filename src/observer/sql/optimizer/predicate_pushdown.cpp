@@ -0,0 +1,221 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Derive single-table predicates from equality join conditions.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "sql/optimizer/predicate_pushdown.h"
+#include "storage/common/table.h"
+#include "storage/default/default_handler.h"
+#include "common/log/log.h"
+
+namespace {
+
+/**
+ * 等价类中的一个字段
+ */
+struct ClassMember {
+  int relation;  // 在selects.relations中的位置
+  std::string field_name;
+  AttrType type;
+};
+
+class AttrClasses {
+public:
+  int find_or_add(int relation, const char *field_name, AttrType type) {
+    int member = find(relation, field_name);
+    if (member >= 0) {
+      return member;
+    }
+    members_.push_back(ClassMember{relation, field_name, type});
+    parents_.push_back(members_.size() - 1);
+    return members_.size() - 1;
+  }
+
+  int find(int relation, const char *field_name) const {
+    for (size_t i = 0; i < members_.size(); i++) {
+      if (members_[i].relation == relation && members_[i].field_name == field_name) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  int root(int member) {
+    while (parents_[member] != member) {
+      parents_[member] = parents_[parents_[member]];
+      member = parents_[member];
+    }
+    return member;
+  }
+
+  void merge(int left, int right) {
+    parents_[root(left)] = root(right);
+  }
+
+  const std::vector<ClassMember> &members() const {
+    return members_;
+  }
+
+private:
+  std::vector<ClassMember> members_;
+  std::vector<int> parents_;
+};
+
+int find_relation(const Selects &selects, const char *name) {
+  if (name == nullptr) {
+    return -1;
+  }
+  for (size_t i = 0; i < selects.relation_num; i++) {
+    if (0 == strcmp(selects.relations[i], name)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const FieldMeta *find_field(Table *table, const RelAttr &attr) {
+  return table == nullptr ? nullptr : table->table_meta().field(attr.attribute_name);
+}
+
+CompOp flip_comp(CompOp comp) {
+  switch (comp) {
+    case LESS_THAN:
+      return GREAT_THAN;
+    case LESS_EQUAL:
+      return GREAT_EQUAL;
+    case GREAT_THAN:
+      return LESS_THAN;
+    case GREAT_EQUAL:
+      return LESS_EQUAL;
+    default:
+      return comp;
+  }
+}
+
+bool value_equal(const Value &left, const Value &right) {
+  if (left.type != right.type || left.is_null != right.is_null) {
+    return false;
+  }
+  if (left.type == CHARS || left.type == NULLS) {
+    return 0 == strcmp((const char *)left.data, (const char *)right.data);
+  }
+  return 0 == memcmp(left.data, right.data, sizeof(int));
+}
+
+/**
+ * 字段和值比较的条件，字段总是在左边
+ */
+struct ValuePredicate {
+  int member;
+  CompOp comp;
+  const Value *value;
+};
+
+bool has_predicate(const Selects &selects, const ClassMember &member, CompOp comp, const Value &value) {
+  for (size_t i = 0; i < selects.condition_num; i++) {
+    const Condition &condition = selects.conditions[i];
+    if (condition.left_is_attr && !condition.right_is_attr && condition.comp == comp &&
+        find_relation(selects, condition.left_attr.relation_name) == member.relation &&
+        member.field_name == condition.left_attr.attribute_name && value_equal(condition.right_value, value)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+int derive_pushdown_conditions(Selects &selects, Arena *arena, const char *db) {
+  if (selects.relation_num <= 1) {
+    return 0;
+  }
+  std::vector<Table *> tables;
+  for (size_t i = 0; i < selects.relation_num; i++) {
+    tables.push_back(DefaultHandler::get_default().find_table(db, selects.relations[i]));
+  }
+
+  // 类型相同的两个字段的等值条件把它们放进同一个等价类
+  AttrClasses classes;
+  const size_t condition_num = selects.condition_num;
+  for (size_t i = 0; i < condition_num; i++) {
+    const Condition &condition = selects.conditions[i];
+    if (!condition.left_is_attr || !condition.right_is_attr || condition.comp != EQUAL_TO) {
+      continue;
+    }
+    const int left = find_relation(selects, condition.left_attr.relation_name);
+    const int right = find_relation(selects, condition.right_attr.relation_name);
+    if (left < 0 || right < 0) {
+      continue;
+    }
+    const FieldMeta *left_field = find_field(tables[left], condition.left_attr);
+    const FieldMeta *right_field = find_field(tables[right], condition.right_attr);
+    if (left_field == nullptr || right_field == nullptr || left_field->type() != right_field->type()) {
+      continue;
+    }
+    classes.merge(classes.find_or_add(left, left_field->name(), left_field->type()),
+                  classes.find_or_add(right, right_field->name(), right_field->type()));
+  }
+  if (classes.members().empty()) {
+    return 0;
+  }
+
+  std::vector<ValuePredicate> predicates;
+  for (size_t i = 0; i < condition_num; i++) {
+    const Condition &condition = selects.conditions[i];
+    if (condition.left_is_attr == condition.right_is_attr || condition.comp > GREAT_THAN) {
+      continue;
+    }
+    const RelAttr &attr = condition.left_is_attr ? condition.left_attr : condition.right_attr;
+    const Value &value = condition.left_is_attr ? condition.right_value : condition.left_value;
+    const int relation = find_relation(selects, attr.relation_name);
+    const FieldMeta *field = relation >= 0 ? find_field(tables[relation], attr) : nullptr;
+    if (value.is_null || value.type == NULLS || field == nullptr) {
+      continue;
+    }
+    const int member = classes.find(relation, field->name());
+    if (member >= 0) {
+      predicates.push_back(ValuePredicate{member, condition.left_is_attr ? condition.comp : flip_comp(condition.comp), &value});
+    }
+  }
+
+  int derived = 0;
+  for (const ValuePredicate &predicate : predicates) {
+    const int root = classes.root(predicate.member);
+    for (size_t m = 0; m < classes.members().size(); m++) {
+      const ClassMember &member = classes.members()[m];
+      if ((int)m == predicate.member || classes.root(m) != root ||
+          has_predicate(selects, member, predicate.comp, *predicate.value)) {
+        continue;
+      }
+      if (selects.condition_num >= MAX_NUM) {
+        LOG_INFO("Too many conditions to push down more derived predicates");
+        return derived;
+      }
+
+      Condition &condition = selects.conditions[selects.condition_num++];
+      memset(&condition, 0, sizeof(condition));
+      condition.is_valid = true;
+      condition.left_is_attr = 1;
+      relation_attr_init(arena, &condition.left_attr, selects.relations[member.relation], member.field_name.c_str(), nullptr, 0);
+      condition.comp = predicate.comp;
+      condition.right_is_attr = 0;
+      value_copy(arena, &condition.right_value, predicate.value);
+      derived++;
+    }
+  }
+  return derived;
+}
@@ -0,0 +1,28 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Derive single-table predicates from equality join conditions.
+//
+
+#ifndef __OBSERVER_SQL_OPTIMIZER_PREDICATE_PUSHDOWN_H_
+#define __OBSERVER_SQL_OPTIMIZER_PREDICATE_PUSHDOWN_H_
+
+#include "sql/parser/parse_defs.h"
+
+/**
+ * 等值的join条件把字段连成等价类，一个字段和值比较的条件对同一个等价类中的其它字段也成立，
+ * 比如t1.a = t2.a and t2.a = 5可以推出t1.a = 5。推导出的条件追加到selects.conditions的后面，
+ * 执行时和其它只跟一张表有关的条件一样下推到表的扫描中，也可以用来选择索引。
+ * 只在两个字段的类型相同时推导，conditions满了之后不再推导。推导出的条件的内存从arena中分配。返回推导出的条件个数
+ */
+int derive_pushdown_conditions(Selects &selects, Arena *arena, const char *db);
+
+#endif  // __OBSERVER_SQL_OPTIMIZER_PREDICATE_PUSHDOWN_H_
@@ -388,13 +388,13 @@ static const YY_CHAR yy_ec[256] =
         1,    1,    1,    1,    1,    1,    1,    2,    2,    3,
         1,    2,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    4,    1,    5,    1,    1,    1,    1,    5,    6,
+        1,    4,    1,    5,    1,    1,   12,    1,    5,    6,
         7,    8,    1,    9,   10,   11,   12,   13,   13,   13,
        13,   13,   13,   13,   13,   13,   13,    1,   14,   15,
        16,   17,    1,    1,   18,   19,   20,   21,   22,   23,
        24,   25,   26,   27,   28,   29,   30,   31,   32,   33,
        34,   35,   36,   37,   38,   39,   40,   41,   42,   34,
-        1,    1,    1,    1,   34,    1,   18,   19,   20,   21,
+        1,   12,    1,    1,   34,    1,   18,   19,   20,   21,
 
        22,   23,   24,   25,   26,   27,   28,   29,   30,   31,
        32,   33,   34,   35,   36,   37,   38,   39,   40,   41,
@@ -584,9 +584,15 @@ static const flex_int16_t yy_chk[403] =
 #line 1 "lex_sql.l"
 #line 2 "lex_sql.l"
 #include<string.h>
+#include<strings.h>
 #include<stdio.h>
 
 struct ParserContext;
+// 在yacc_sql.y中定义，从语句的arena中复制字符串
+char *context_strdup(void *context, const char *s);
+// 在yacc_sql.y中定义，记录返回的token，判断上一个token是不是字段、常量或者右括号
+int context_token(void *context, int token);
+int context_after_operand(void *context);
 
 #include "yacc_sql.tab.h"
 extern int atoi();
@@ -598,11 +604,11 @@ extern double atof();
 #define debug_printf(...)
 #endif // YYDEBUG
 
-#define RETURN_TOKEN(token) debug_printf("%s\n",#token);return token
-#line 603 "lex.yy.c"
+#define RETURN_TOKEN(token) debug_printf("%s\n",#token);return context_token(yyextra, token)
+#line 609 "lex.yy.c"
 /* Prevent the need for linking with -lfl */
 
-#line 606 "lex.yy.c"
+#line 612 "lex.yy.c"
 
 #define INITIAL 0
 #define STR 1
@@ -877,10 +883,10 @@ YY_DECL
 		}
 
 	{
-#line 32 "lex_sql.l"
+#line 37 "lex_sql.l"
 
 
-#line 884 "lex.yy.c"
+#line 890 "lex.yy.c"
 
 	while ( /*CONSTCOND*/1 )		/* loops until end-of-file is reached */
 		{
@@ -939,321 +945,346 @@ do_action:	/* This label is used only to access EOF actions. */
 
 case 1:
 YY_RULE_SETUP
-#line 34 "lex_sql.l"
+#line 39 "lex_sql.l"
 // ignore whitespace
 	YY_BREAK
 case 2:
 /* rule 2 can match eol */
 YY_RULE_SETUP
-#line 35 "lex_sql.l"
+#line 40 "lex_sql.l"
 ;
 	YY_BREAK
 case 3:
 YY_RULE_SETUP
-#line 37 "lex_sql.l"
-yylval->number=atoi(yytext); RETURN_TOKEN(NUMBER);
+#line 42 "lex_sql.l"
+if (yytext[0] == '-' && context_after_operand(yyextra)) { yyless(1); return context_token(yyextra, '-'); } yylval->number=atoi(yytext); RETURN_TOKEN(NUMBER);
 	YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 38 "lex_sql.l"
-yylval->floats=(float)(atof(yytext)); RETURN_TOKEN(FLOAT);
+#line 43 "lex_sql.l"
+if (yytext[0] == '-' && context_after_operand(yyextra)) { yyless(1); return context_token(yyextra, '-'); } yylval->floats=(float)(atof(yytext)); RETURN_TOKEN(FLOAT);
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 40 "lex_sql.l"
+#line 45 "lex_sql.l"
 RETURN_TOKEN(SEMICOLON);
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 41 "lex_sql.l"
+#line 46 "lex_sql.l"
 RETURN_TOKEN(DOT);
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 42 "lex_sql.l"
-yylval->string=strdup(yytext); RETURN_TOKEN(STAR);
+#line 47 "lex_sql.l"
+yylval->string=context_strdup(yyextra, yytext); RETURN_TOKEN(STAR);
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 43 "lex_sql.l"
+#line 48 "lex_sql.l"
 RETURN_TOKEN(EXIT);
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
-#line 44 "lex_sql.l"
+#line 49 "lex_sql.l"
 RETURN_TOKEN(HELP);
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 45 "lex_sql.l"
+#line 50 "lex_sql.l"
 RETURN_TOKEN(DESC);
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 46 "lex_sql.l"
+#line 51 "lex_sql.l"
 RETURN_TOKEN(CREATE);
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 47 "lex_sql.l"
+#line 52 "lex_sql.l"
 RETURN_TOKEN(DROP);
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 48 "lex_sql.l"
+#line 53 "lex_sql.l"
 RETURN_TOKEN(TABLE);
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 49 "lex_sql.l"
+#line 54 "lex_sql.l"
 RETURN_TOKEN(TABLES);
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 50 "lex_sql.l"
+#line 55 "lex_sql.l"
 RETURN_TOKEN(INDEX);
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 51 "lex_sql.l"
+#line 56 "lex_sql.l"
 RETURN_TOKEN(ON);
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 52 "lex_sql.l"
+#line 57 "lex_sql.l"
 RETURN_TOKEN(SHOW);
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 53 "lex_sql.l"
+#line 58 "lex_sql.l"
 RETURN_TOKEN(SYNC);
 	YY_BREAK
 case 19:
 YY_RULE_SETUP
-#line 54 "lex_sql.l"
+#line 59 "lex_sql.l"
 RETURN_TOKEN(SELECT);
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 55 "lex_sql.l"
+#line 60 "lex_sql.l"
 RETURN_TOKEN(FROM);
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 56 "lex_sql.l"
+#line 61 "lex_sql.l"
 RETURN_TOKEN(WHERE);
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 57 "lex_sql.l"
+#line 62 "lex_sql.l"
 RETURN_TOKEN(AND);
 	YY_BREAK
 case 23:
 YY_RULE_SETUP
-#line 58 "lex_sql.l"
+#line 63 "lex_sql.l"
 RETURN_TOKEN(INSERT);
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
-#line 59 "lex_sql.l"
+#line 64 "lex_sql.l"
 RETURN_TOKEN(INTO);
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
-#line 60 "lex_sql.l"
+#line 65 "lex_sql.l"
 RETURN_TOKEN(VALUES);
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
-#line 61 "lex_sql.l"
+#line 66 "lex_sql.l"
 RETURN_TOKEN(DELETE);
 	YY_BREAK
 case 27:
 YY_RULE_SETUP
-#line 62 "lex_sql.l"
+#line 67 "lex_sql.l"
 RETURN_TOKEN(UPDATE);
 	YY_BREAK
 case 28:
 YY_RULE_SETUP
-#line 63 "lex_sql.l"
+#line 68 "lex_sql.l"
 RETURN_TOKEN(SET);
 	YY_BREAK
 case 29:
 YY_RULE_SETUP
-#line 64 "lex_sql.l"
+#line 69 "lex_sql.l"
 RETURN_TOKEN(TRX_BEGIN);
 	YY_BREAK
 case 30:
 YY_RULE_SETUP
-#line 65 "lex_sql.l"
+#line 70 "lex_sql.l"
 RETURN_TOKEN(TRX_COMMIT);
 	YY_BREAK
 case 31:
 YY_RULE_SETUP
-#line 66 "lex_sql.l"
+#line 71 "lex_sql.l"
 RETURN_TOKEN(TRX_ROLLBACK);
 	YY_BREAK
 case 32:
 YY_RULE_SETUP
-#line 67 "lex_sql.l"
+#line 72 "lex_sql.l"
 RETURN_TOKEN(INT_T);
 	YY_BREAK
 case 33:
 YY_RULE_SETUP
-#line 68 "lex_sql.l"
+#line 73 "lex_sql.l"
 RETURN_TOKEN(STRING_T);
 	YY_BREAK
 case 34:
 YY_RULE_SETUP
-#line 69 "lex_sql.l"
+#line 74 "lex_sql.l"
 RETURN_TOKEN(FLOAT_T);
 	YY_BREAK
 case 35:
 YY_RULE_SETUP
-#line 70 "lex_sql.l"
+#line 75 "lex_sql.l"
 RETURN_TOKEN(ORDER);
 	YY_BREAK
 case 36:
 YY_RULE_SETUP
-#line 71 "lex_sql.l"
+#line 76 "lex_sql.l"
 RETURN_TOKEN(ASC);
 	YY_BREAK
 case 37:
 YY_RULE_SETUP
-#line 72 "lex_sql.l"
+#line 77 "lex_sql.l"
 RETURN_TOKEN(BY);
 	YY_BREAK
 case 38:
 YY_RULE_SETUP
-#line 73 "lex_sql.l"
+#line 78 "lex_sql.l"
 RETURN_TOKEN(DATE_T);
 	YY_BREAK
 case 39:
 YY_RULE_SETUP
-#line 74 "lex_sql.l"
+#line 79 "lex_sql.l"
 RETURN_TOKEN(LOAD);
 	YY_BREAK
 case 40:
 YY_RULE_SETUP
-#line 75 "lex_sql.l"
+#line 80 "lex_sql.l"
 RETURN_TOKEN(DATA);
 	YY_BREAK
 case 41:
 YY_RULE_SETUP
-#line 76 "lex_sql.l"
+#line 81 "lex_sql.l"
 RETURN_TOKEN(INFILE);
 	YY_BREAK
 case 42:
 YY_RULE_SETUP
-#line 77 "lex_sql.l"
+#line 82 "lex_sql.l"
 RETURN_TOKEN(NULLABLE);
 	YY_BREAK
 case 43:
 YY_RULE_SETUP
-#line 78 "lex_sql.l"
+#line 83 "lex_sql.l"
 RETURN_TOKEN(NOT);
 	YY_BREAK
 case 44:
 YY_RULE_SETUP
-#line 79 "lex_sql.l"
+#line 84 "lex_sql.l"
 RETURN_TOKEN(NULL_T);
 	YY_BREAK
 case 45:
 YY_RULE_SETUP
-#line 80 "lex_sql.l"
-yylval->string=strdup(yytext); RETURN_TOKEN(COUNT);
+#line 85 "lex_sql.l"
+yylval->string=context_strdup(yyextra, yytext); RETURN_TOKEN(COUNT);
 	YY_BREAK
 case 46:
 YY_RULE_SETUP
-#line 81 "lex_sql.l"
-yylval->string=strdup(yytext); RETURN_TOKEN(OTHER_FUNCTION_TYPE);
+#line 86 "lex_sql.l"
+yylval->string=context_strdup(yyextra, yytext); RETURN_TOKEN(OTHER_FUNCTION_TYPE);
 	YY_BREAK
 case 47:
 YY_RULE_SETUP
-#line 82 "lex_sql.l"
+#line 87 "lex_sql.l"
 RETURN_TOKEN(INNER);
 	YY_BREAK
 case 48:
 YY_RULE_SETUP
-#line 83 "lex_sql.l"
+#line 88 "lex_sql.l"
 RETURN_TOKEN(JOIN);
 	YY_BREAK
 case 49:
 YY_RULE_SETUP
-#line 84 "lex_sql.l"
+#line 89 "lex_sql.l"
 RETURN_TOKEN(IS);
 	YY_BREAK
 case 50:
 YY_RULE_SETUP
-#line 85 "lex_sql.l"
+#line 90 "lex_sql.l"
 RETURN_TOKEN(GROUP);
 	YY_BREAK
 case 51:
 YY_RULE_SETUP
-#line 86 "lex_sql.l"
-yylval->string=strdup(yytext); RETURN_TOKEN(ID);
+#line 91 "lex_sql.l"
+{
+  // limit、offset、in和exists等关键字在标识符中识别，不区分大小写
+  if (0 == strcasecmp(yytext, "limit")) { RETURN_TOKEN(LIMIT); }
+  if (0 == strcasecmp(yytext, "offset")) { RETURN_TOKEN(OFFSET); }
+  if (0 == strcasecmp(yytext, "in")) { RETURN_TOKEN(IN); }
+  if (0 == strcasecmp(yytext, "exists")) { RETURN_TOKEN(EXISTS); }
+  if (0 == strcasecmp(yytext, "like")) { RETURN_TOKEN(LIKE); }
+  if (0 == strcasecmp(yytext, "prepare")) { RETURN_TOKEN(PREPARE); }
+  if (0 == strcasecmp(yytext, "execute")) { RETURN_TOKEN(EXECUTE); }
+  if (0 == strcasecmp(yytext, "deallocate")) { RETURN_TOKEN(DEALLOCATE); }
+  if (0 == strcasecmp(yytext, "using")) { RETURN_TOKEN(USING); }
+  if (0 == strcasecmp(yytext, "savepoint")) { RETURN_TOKEN(SAVEPOINT); }
+  if (0 == strcasecmp(yytext, "release")) { RETURN_TOKEN(RELEASE); }
+  if (0 == strcasecmp(yytext, "to")) { RETURN_TOKEN(TO); }
+  if (0 == strcasecmp(yytext, "partition")) { RETURN_TOKEN(PARTITION); }
+  if (0 == strcasecmp(yytext, "alter")) { RETURN_TOKEN(ALTER); }
+  if (0 == strcasecmp(yytext, "truncate")) { RETURN_TOKEN(TRUNCATE); }
+  if (0 == strcasecmp(yytext, "analyze")) { RETURN_TOKEN(ANALYZE); }
+  if (0 == strcasecmp(yytext, "explain")) { RETURN_TOKEN(EXPLAIN); }
+  if (0 == strcasecmp(yytext, "distinct")) { RETURN_TOKEN(DISTINCT); }
+  if (0 == strcasecmp(yytext, "over")) { RETURN_TOKEN(OVER); }
+  if (0 == strcasecmp(yytext, "approx_count_distinct") || 0 == strcasecmp(yytext, "sum")) {
+    yylval->string=context_strdup(yyextra, yytext); RETURN_TOKEN(OTHER_FUNCTION_TYPE);
+  }
+  yylval->string=context_strdup(yyextra, yytext); RETURN_TOKEN(ID);
+}
 	YY_BREAK
 case 52:
 YY_RULE_SETUP
-#line 87 "lex_sql.l"
+#line 92 "lex_sql.l"
 RETURN_TOKEN(LBRACE);
 	YY_BREAK
 case 53:
 YY_RULE_SETUP
-#line 88 "lex_sql.l"
+#line 93 "lex_sql.l"
 RETURN_TOKEN(RBRACE);
 	YY_BREAK
 case 54:
 YY_RULE_SETUP
-#line 89 "lex_sql.l"
+#line 94 "lex_sql.l"
 RETURN_TOKEN(COMMA);
 	YY_BREAK
 case 55:
 YY_RULE_SETUP
-#line 90 "lex_sql.l"
+#line 95 "lex_sql.l"
 RETURN_TOKEN(EQ);
 	YY_BREAK
 case 56:
 YY_RULE_SETUP
-#line 91 "lex_sql.l"
+#line 96 "lex_sql.l"
 RETURN_TOKEN(LE);
 	YY_BREAK
 case 57:
 YY_RULE_SETUP
-#line 92 "lex_sql.l"
+#line 97 "lex_sql.l"
 RETURN_TOKEN(NE);
 	YY_BREAK
 case 58:
 YY_RULE_SETUP
-#line 93 "lex_sql.l"
+#line 98 "lex_sql.l"
 RETURN_TOKEN(LT);
 	YY_BREAK
 case 59:
 YY_RULE_SETUP
-#line 94 "lex_sql.l"
+#line 99 "lex_sql.l"
 RETURN_TOKEN(GE);
 	YY_BREAK
 case 60:
 YY_RULE_SETUP
-#line 95 "lex_sql.l"
+#line 100 "lex_sql.l"
 RETURN_TOKEN(GT);
 	YY_BREAK
 case 61:
 YY_RULE_SETUP
-#line 96 "lex_sql.l"
-yylval->string=strdup(yytext); RETURN_TOKEN(SSS);
+#line 101 "lex_sql.l"
+yylval->string=context_strdup(yyextra, yytext); RETURN_TOKEN(SSS);
 	YY_BREAK
 case 62:
 YY_RULE_SETUP
-#line 98 "lex_sql.l"
-printf("Unknown character [%c]\n",yytext[0]); return yytext[0];
+#line 103 "lex_sql.l"
+if (strchr("?+-/", yytext[0]) == NULL) { printf("Unknown character [%c]\n",yytext[0]); } return context_token(yyextra, yytext[0]);
 	YY_BREAK
 case 63:
 YY_RULE_SETUP
-#line 99 "lex_sql.l"
+#line 104 "lex_sql.l"
 ECHO;
 	YY_BREAK
-#line 1257 "lex.yy.c"
+#line 1287 "lex.yy.c"
 case YY_STATE_EOF(INITIAL):
 case YY_STATE_EOF(STR):
 	yyterminate();
@@ -2435,9 +2466,4 @@ void yyfree (void * ptr , yyscan_t yyscanner)
 
 #define YYTABLES_NAME "yytables"
 
-#line 99 "lex_sql.l"
-
-
-void scan_string(const char *str, yyscan_t scanner) {
-	yy_switch_to_buffer(yy_scan_string(str, scanner), scanner);
-}
+#line 104 "lex_sql.l"
@@ -13,10 +13,12 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include <mutex>
-#include <regex>
+#include <ctype.h>
+#include <strings.h>
 #include <string>
 #include <vector>
 #include "sql/parser/parse.h"
+#include "sql/parser/value_parser.h"
 #include "rc.h"
 #include "common/log/log.h"
 
@@ -26,58 +28,143 @@ RC parse(char *st, Query *sqln);
 extern "C"
 {
 #endif // __cplusplus
-  void relation_attr_init(RelAttr *relation_attr, const char *relation_name, const char *attribute_name, const char *window_function_name, int _is_desc)
+
+  struct _ArenaBlock
   {
-    if (relation_name != nullptr)
-    {
-      relation_attr->relation_name = strdup(relation_name);
+    struct _ArenaBlock *next;
+  };
+
+  void *arena_alloc(Arena *arena, size_t size)
+  {
+    if (arena == nullptr) {
+      return malloc(size);
     }
-    else
-    {
-      relation_attr->relation_name = nullptr;
+
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (size > ARENA_BLOCK_SIZE / 4) {
+      // 大的对象(比如子查询的Selects)单独占一块，当前块剩下的空间留给后面的小对象
+      ArenaBlock *block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + size);
+      if (block == nullptr) {
+        LOG_ERROR("Failed to alloc memory for query. size=%ld", size);
+        return nullptr;
+      }
+      block->next = arena->blocks;
+      arena->blocks = block;
+      return block + 1;
     }
 
-    relation_attr->attribute_name = strdup(attribute_name);
-      LOG_ERROR("%s", attribute_name);
+    if ((size_t)(arena->end - arena->pos) < size) {
+      ArenaBlock *block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + ARENA_BLOCK_SIZE);
+      if (block == nullptr) {
+        LOG_ERROR("Failed to alloc memory for query. size=%d", ARENA_BLOCK_SIZE);
+        return nullptr;
+      }
+      block->next = arena->blocks;
+      arena->blocks = block;
+      arena->pos = (char *)(block + 1);
+      arena->end = arena->pos + ARENA_BLOCK_SIZE;
+    }
+    void *p = arena->pos;
+    arena->pos += size;
+    return p;
+  }
 
-    if (window_function_name != nullptr)
-    {
-      relation_attr->window_function_name = strdup(window_function_name);
+  char *arena_strdup(Arena *arena, const char *s)
+  {
+    if (s == nullptr) {
+      return nullptr;
     }
-    else
-    {
-      relation_attr->window_function_name = nullptr;
+    size_t len = strlen(s) + 1;
+    char *p = (char *)arena_alloc(arena, len);
+    if (p != nullptr) {
+      memcpy(p, s, len);
     }
+    return p;
+  }
 
+  void arena_destroy(Arena *arena)
+  {
+    ArenaBlock *block = arena->blocks;
+    while (block != nullptr) {
+      ArenaBlock *next = block->next;
+      free(block);
+      block = next;
+    }
+    arena->blocks = nullptr;
+    arena->pos = nullptr;
+    arena->end = nullptr;
+  }
+
+  void relation_attr_init(Arena *arena, RelAttr *relation_attr, const char *relation_name, const char *attribute_name,
+                          const char *window_function_name, int _is_desc)
+  {
+    relation_attr->relation_name = arena_strdup(arena, relation_name);
+    relation_attr->attribute_name = arena_strdup(arena, attribute_name);
+      LOG_ERROR("%s", attribute_name);
+    relation_attr->window_function_name = arena_strdup(arena, window_function_name);
     relation_attr->is_desc = _is_desc;
+    relation_attr->is_distinct = 0;
+    relation_attr->window = nullptr;
+    relation_attr->expr = nullptr;
+  }
+
+  WindowSpec *window_spec_create(Arena *arena)
+  {
+    WindowSpec *window = (WindowSpec *)arena_alloc(arena, sizeof(WindowSpec));
+    memset(window, 0, sizeof(*window));
+    return window;
   }
 
-  void relation_attr_destroy(RelAttr *relation_attr)
+  void window_spec_append_partition(WindowSpec *window, RelAttr *attr)
   {
-    free(relation_attr->relation_name);
-    free(relation_attr->attribute_name);
-    free(relation_attr->window_function_name);
+    // partition by在order by之前解析，还没有order by的字段
+    window->attrs[window->partition_num++] = *attr;
+  }
 
-    relation_attr->relation_name = nullptr;
-    relation_attr->attribute_name = nullptr;
-    relation_attr->window_function_name = nullptr;
+  void window_spec_append_order(WindowSpec *window, RelAttr *attr)
+  {
+    window->attrs[window->partition_num + window->order_num++] = *attr;
   }
 
-  void value_init_integer(Value *value, int v, int is_null)
+  static void value_init_data(Arena *arena, Value *value, AttrType type, const void *data, int is_null)
   {
-    value->type = INTS;
-    value->data = malloc(sizeof(v));
+    // 整数、浮点数、日期和参数序号都是4个字节
+    value->type = type;
+    value->data = arena_alloc(arena, sizeof(int));
     value->is_null = is_null;
-    memcpy(value->data, &v, sizeof(v));
+    memcpy(value->data, data, sizeof(int));
   }
 
-  void value_init_float(Value *value, float v, int is_null)
+  void value_init_integer(Arena *arena, Value *value, int v, int is_null)
   {
-    value->type = FLOATS;
-    value->data = malloc(sizeof(v));
-    value->is_null = is_null;
+    value_init_data(arena, value, INTS, &v, is_null);
+  }
 
-    memcpy(value->data, &v, sizeof(v));
+  void value_init_float(Arena *arena, Value *value, float v, int is_null)
+  {
+    value_init_data(arena, value, FLOATS, &v, is_null);
+  }
+
+  /**
+   * 预编译语句中的参数?，执行时由query_bind_params替换成EXECUTE给出的值
+   */
+  void value_init_param(Arena *arena, Value *value, int param_index)
+  {
+    value_init_data(arena, value, UNDEFINED, &param_index, false);
+  }
+
+  void value_copy(Arena *arena, Value *dst, const Value *src)
+  {
+    dst->type = src->type;
+    dst->is_null = src->is_null;
+    if (src->data == nullptr) {
+      dst->data = nullptr;
+    } else if (src->type == CHARS || src->type == NULLS) {
+      dst->data = arena_strdup(arena, (const char *)src->data);
+    } else {
+      dst->data = arena_alloc(arena, sizeof(int));
+      memcpy(dst->data, src->data, sizeof(int));
+    }
   }
 
   void value_destroy(Value *value)
@@ -87,150 +174,84 @@ extern "C"
     value->data = nullptr;
     value->is_null = false;
   }
-// check date 格式
-bool check_date_format(const char *s)
+
+  static Expr *expr_create(Arena *arena, ExprType type)
   {
-    std::string str = s;
-    std::regex pattern("^\\d{4}-\\d{1,2}-\\d{1,2}");
-    if (std::regex_match(str, pattern))
-    {
-      return true;
-    }
-    return false;
+    Expr *expr = (Expr *)arena_alloc(arena, sizeof(Expr));
+    memset(expr, 0, sizeof(*expr));
+    expr->type = type;
+    return expr;
   }
-  /*  放弃使用regex
-bool check_date_data(const char *s)
+
+  Expr *expr_create_attr(Arena *arena, const char *relation_name, const char *attribute_name)
   {
-    // 
-    std::string str = s;
-    std::regex pattern("((19[7-9][0-9]|20[0-2][0-9]|203[0-7])-(((0?[13578]|1[02])-([12][0-9]|3[01]|0?[1-9]))|((0?[469]|11)-([12][0-9]|30|0?[1-9]))|(0?2-([1][0-9]|2[0-8]|0?[1-9]))))|((2000|19(8[048]|[79][26]))-0?2-29)|(2038-((0?1-([1-2][0-9]|3[0-1]|0?[1-9]))|(0?2-(1[0-9]|2[0-8]|0?[1-9]))))");
-    if (std::regex_match(str, pattern))
-    {
-      return true;
-    }
-    return false;
+    Expr *expr = expr_create(arena, EXPR_ATTR);
+    relation_attr_init(arena, &expr->attr, relation_name, attribute_name, nullptr, 0);
+    return expr;
   }
-*/
-int date2num(const char *s)
+
+  Expr *expr_create_value(Arena *arena, const Value *value)
   {
-    // 这个函数写的比较丑，先用着（后期可以考虑使用strtok字符串分割函数进行改写）
-    // 设定格式为yyyy-mm-dd/yyyy-m-dd/yyyy-mm-d/yyyy-m-d
-    std::string str = s;
-    int len = str.length();
-    int num = 0;
-    int mul = 1;
-    for (int i = len - 1; i >= 0; i--)
-    {
-      if (s[i] != '-')
-      {
-        num += mul * (s[i] - '0');
-        mul *= 10;
-      }
-      else if (i == len - 2)
-      {
-        mul *= 10;
-      }
-      else if (i == len - 5)
-      {
-        if (mul == 1000)
-        {
-          mul *= 10;
-        }
-      }
-      else if (i == len - 4)
-      {
-        mul *= 10;
-      }
-    }
-    return num;
-  }
-// 如果过了date格式则设定t为true且返回对应的int,否则设定t为false且返回0
-int check_date_data_convert(const char *s,int &t){
-    int num = date2num(s);
-    if(num<19700101||num>20380131){
-        t=0;
-    }
-    // check 天数
-    int days=num%100;
-    if(days>31||days<1){
-        t=0;
-    }
-    int mons=num%10000/100;
-    if(mons>12||mons<1){
-        t=0;
-    }
-    int years=num/10000;
-    // 处理闰年
-    if(mons==2){
-        // years(1970~2038)
-        if(years%4==0){
-            if(days>29){
-                t=0;
-            }
-        }else{
-            if(days>28){
-                t=0;
-            }
-        }
-    }
-    // 处理大小月份
-    if(mons==4||mons==6||mons==9||mons==11){
-        if(days>30){
-            t=0;
-        }
-    }else{
-        if(days>31){
-            t=0;
-        }
-    }
-    return num;
-}
-  
+    Expr *expr = expr_create(arena, EXPR_VALUE);
+    value_copy(arena, &expr->value, value);
+    return expr;
+  }
 
-  bool match_null(const char *s)
+  Expr *expr_create_arith(Arena *arena, char op, Expr *left, Expr *right)
   {
-    std::string str = s;
-    std::regex format_("^[Nn][Uu][Ll][Ll]$");
+    Expr *expr = expr_create(arena, EXPR_ARITH);
+    expr->op = op;
+    expr->arg_num = 2;
+    expr->args[0] = left;
+    expr->args[1] = right;
+    return expr;
+  }
 
-    if (std::regex_match(str, format_))
-    {
-      return true;
-    }
-    else
-    {
-      return false;
+  Expr *expr_create_neg(Arena *arena, Expr *child)
+  {
+    Expr *expr = expr_create(arena, EXPR_NEG);
+    expr->arg_num = 1;
+    expr->args[0] = child;
+    return expr;
+  }
+
+  Expr *expr_create_func(Arena *arena, const char *function_name)
+  {
+    Expr *expr = expr_create(arena, EXPR_FUNC);
+    expr->function_name = arena_strdup(arena, function_name);
+    return expr;
+  }
+
+  int expr_append_arg(Expr *func, Expr *arg)
+  {
+    if (func->arg_num >= MAX_EXPR_ARGS) {
+      return 0;
     }
+    func->args[func->arg_num++] = arg;
+    return 1;
   }
 
-  void value_init_string(Value *value, const char *v, int is_null)
+  bool match_null(const char *s)
   {
+    return 0 == strcasecmp(s, "null");
+  }
+
+
+  void value_init_string(Arena *arena, Value *value, const char *v, int is_null)
+  {
+    int date_num = 0;
     if (is_null) {
       value->type = NULLS;
-      value->data = strdup(v);
-    } else if (check_date_format(v))
+      value->data = arena_strdup(arena, v);
+    } else if (parse_date_value(v, &date_num))
     {
-      LOG_INFO("成功匹配日期格式开始检查具体日期");
-      // 转换为数字
-      int t=1;
-      int date_num = check_date_data_convert(v,t);
-      if(t){
-        LOG_INFO("通过具体日期检测，将输入值作为dates处理");
-        value->type = DATES;
-        value->data = malloc(sizeof(date_num));  
-        memcpy(value->data, &date_num, sizeof(date_num));
-      }else{
-        //没有通过具体日期检测  因为后面插入表格的时候会有table_meta与value_type的检测，就不用再这里将解析识别为错误，
-        // 对于不通过日期检测的字符串解析为正常字符串
-        LOG_INFO("成功匹配日期格式但没有通过具体日期检测，将输入值作为char处理");
-        value->type = CHARS;
-        value->data = strdup(v);
-      }
-    } 
+      value_init_data(arena, value, DATES, &date_num, is_null);
+    }
     else
     {
-      LOG_INFO("没有成功匹配日期格式将输入值作为char处理");     
+      // 不是日期格式或者不是有效日期的字符串都当作CHARS，插入时再和字段的类型比较
       value->type = CHARS;
-      value->data = strdup(v);
+      value->data = arena_strdup(arena, v);
     }
 
     value->is_null = is_null;
@@ -243,6 +264,7 @@ int check_date_data_convert(const char *s,int &t){
     // LOG_INFO("condition_init function starts and right_value.type=%d",right_value->type);
     condition->comp = comp;
     condition->is_valid=true;
+    condition->sub_select = NULL;
     condition->left_is_attr = left_is_attr;
     if (left_is_attr)
     {
@@ -266,29 +288,25 @@ int check_date_data_convert(const char *s,int &t){
       condition->right_value = *right_value;
     }
   }
-  void condition_destroy(Condition *condition)
+  /**
+   * 子查询条件：in和not in的左边是字段，exists和not exists的left_attr为NULL，两边都不是字段
+   */
+  void condition_init_subquery(Condition *condition, CompOp comp, RelAttr *left_attr, Selects *sub_select)
   {
-    if (condition->left_is_attr)
-    {
-      relation_attr_destroy(&condition->left_attr);
-    }
-    else
-    {
-      value_destroy(&condition->left_value);
-    }
-    if (condition->right_is_attr)
-    {
-      relation_attr_destroy(&condition->right_attr);
-    }
-    else
+    memset(condition, 0, sizeof(*condition));
+    condition->comp = comp;
+    condition->is_valid = true;
+    if (left_attr != NULL)
     {
-      value_destroy(&condition->right_value);
+      condition->left_is_attr = 1;
+      condition->left_attr = *left_attr;
     }
+    condition->sub_select = sub_select;
   }
 
-  void attr_info_init(AttrInfo *attr_info, const char *name, AttrType type, size_t length, TrueOrFalse is_nullable)
+  void attr_info_init(Arena *arena, AttrInfo *attr_info, const char *name, AttrType type, size_t length, TrueOrFalse is_nullable)
   {
-    attr_info->name = strdup(name);
+    attr_info->name = arena_strdup(arena, name);
     attr_info->type = type;
     
     attr_info->length = length;
@@ -301,11 +319,7 @@ int check_date_data_convert(const char *s,int &t){
     {
       attr_info->is_nullable = 0;
     }
-  }
-  void attr_info_destroy(AttrInfo *attr_info)
-  {
-    free(attr_info->name);
-    attr_info->name = nullptr;
+    attr_info->dictionary = 0;
   }
 
   void selects_init(Selects *selects, ...);
@@ -315,9 +329,9 @@ int check_date_data_convert(const char *s,int &t){
     selects->attributes[selects->attr_num++] = *rel_attr;
   }
 
-  void selects_append_relation(Selects *selects, const char *relation_name)
+  void selects_append_relation(Arena *arena, Selects *selects, const char *relation_name)
   {
-    selects->relations[selects->relation_num++] = strdup(relation_name);
+    selects->relations[selects->relation_num++] = arena_strdup(arena, relation_name);
   }
 
   void selects_append_order(Selects *selects, RelAttr *rel_attr)
@@ -329,10 +343,33 @@ int check_date_data_convert(const char *s,int &t){
     selects->group_attrs[selects->group_num++] = *rel_attr;
   }
 
+  void selects_set_limit(Selects *selects, int limit, int offset) {
+    selects->has_limit = 1;
+    selects->limit = limit;
+    selects->offset = offset;
+  }
+
+  void selects_set_explain(Selects *selects, ExplainType explain) {
+    selects->explain = explain;
+  }
+
+  void selects_set_outfile(Arena *arena, Selects *selects, const char *file_name) {
+    // 和load data的文件名一样去掉引号
+    char *dup_file_name = arena_strdup(arena, file_name[0] == '\'' || file_name[0] == '\"' ? file_name + 1 : file_name);
+    const size_t len = strlen(dup_file_name);
+    if (len > 0 && (dup_file_name[len - 1] == '\'' || dup_file_name[len - 1] == '\"')) {
+      dup_file_name[len - 1] = 0;
+    }
+    selects->outfile = dup_file_name;
+  }
+
+  void selects_set_cursor(Arena *arena, Selects *selects, const char *cursor_name) {
+    selects->cursor = arena_strdup(arena, cursor_name);
+  }
+
   // void selects_append_conditions(Selects *selects, Condition conditions[], size_t condition_num)
-  void selects_append_conditions(Query *sql, Condition conditions[], size_t condition_num)
+  void selects_append_conditions(Query *sql, Selects *selects, Condition conditions[], size_t condition_num)
   {
-    Selects *selects = &sql->sstr.selection;
     assert(condition_num <= sizeof(selects->conditions) / sizeof(selects->conditions[0]));
     for (size_t i = 0; i < condition_num; i++)
     {
@@ -346,73 +383,58 @@ int check_date_data_convert(const char *s,int &t){
     selects->condition_num = condition_num;
   }
 
-  void selects_destroy(Selects *selects)
+  void selects_append_expr_conditions(Selects *selects, ExprCondition conditions[], size_t condition_num)
   {
-    for (size_t i = 0; i < selects->attr_num; i++)
-    {
-      relation_attr_destroy(&selects->attributes[i]);
+    assert(condition_num <= sizeof(selects->expr_conditions) / sizeof(selects->expr_conditions[0]));
+    for (size_t i = 0; i < condition_num; i++) {
+      selects->expr_conditions[i] = conditions[i];
     }
-    selects->attr_num = 0;
+    selects->expr_condition_num = condition_num;
+  }
 
-    for (size_t i = 0; i < selects->relation_num; i++)
-    {
-      free(selects->relations[i]);
-      selects->relations[i] = NULL;
-    }
-    selects->relation_num = 0;
+  void inserts_init(Arena *arena, Inserts *inserts, const char *relation_name, Value values[], size_t value_num, size_t index)
+  {
+    assert(value_num <= MAX_NUM);
 
-    for (size_t i = 0; i < selects->condition_num; i++)
+    if (inserts->relation_name == nullptr)
     {
-      condition_destroy(&selects->conditions[i]);
+      inserts->relation_name = arena_strdup(arena, relation_name);
     }
-    selects->condition_num = 0;
-
-    for (size_t i = 0; i < selects->order_num; i++)
+    inserts->group_num = index;
+    if (value_num == 0)
     {
-      relation_attr_destroy(&selects->order_attrs[i]);
+      // 最后一次调用只设置组数
+      return;
     }
-    selects->order_num = 0;
-
-    for (size_t i = 0; i < selects->group_num; i++)
+    assert(index <= inserts->group_capacity);
+    if (index == inserts->group_capacity)
     {
-      relation_attr_destroy(&selects->group_attrs[i]);
+      // 组数不受MAX_NUM限制。旧的数组留在arena中，随语句一起释放
+      size_t capacity = inserts->group_capacity == 0 ? INSERT_GROUP_INIT_CAPACITY : inserts->group_capacity * 2;
+      size_t *value_num = (size_t *)arena_alloc(arena, sizeof(size_t) * capacity);
+      Value **values = (Value **)arena_alloc(arena, sizeof(Value *) * capacity);
+      if (index > 0)
+      {
+        memcpy(value_num, inserts->value_num, sizeof(size_t) * index);
+        memcpy(values, inserts->values, sizeof(Value *) * index);
+      }
+      inserts->value_num = value_num;
+      inserts->values = values;
+      inserts->group_capacity = capacity;
     }
-    selects->group_num = 0;
-  }
-
-  void inserts_init(Inserts *inserts, const char *relation_name, Value values[], size_t value_num, size_t index)
-  {
-    assert(value_num <= sizeof(inserts->values[index]) / sizeof(inserts->values[index][0]));
-
-    inserts->relation_name = strdup(relation_name);
+    // 每组值按实际的个数分配
+    Value *row = (Value *)arena_alloc(arena, sizeof(Value) * value_num);
     for (size_t i = 0; i < value_num; i++)
     {
-      inserts->values[index][i] = values[i];
+      row[i] = values[i];
     }
+    inserts->values[index] = row;
     inserts->value_num[index] = value_num;
-    inserts->group_num = index;
   }
 
-  void inserts_destroy(Inserts *inserts)
+  void deletes_init_relation(Arena *arena, Deletes *deletes, const char *relation_name)
   {
-    free(inserts->relation_name);
-    inserts->relation_name = nullptr;
-
-    for (size_t i = 0; i < inserts->group_num; i++)
-    {
-      for (size_t j = 0; j < inserts->value_num[i]; j++)
-      {
-        value_destroy(&inserts->values[i][j]);
-      }
-      inserts->value_num[i] = 0;
-    }
-
-    inserts->group_num = 0;
-  }
-
-  void deletes_init_relation(Deletes *deletes, const char *relation_name)
-  {
-    deletes->relation_name = strdup(relation_name);
+    deletes->relation_name = arena_strdup(arena, relation_name);
   }
 
   void deletes_set_conditions(Deletes *deletes, Condition conditions[], size_t condition_num)
@@ -424,22 +446,12 @@ int check_date_data_convert(const char *s,int &t){
     }
     deletes->condition_num = condition_num;
   }
-  void deletes_destroy(Deletes *deletes)
-  {
-    for (size_t i = 0; i < deletes->condition_num; i++)
-    {
-      condition_destroy(&deletes->conditions[i]);
-    }
-    deletes->condition_num = 0;
-    free(deletes->relation_name);
-    deletes->relation_name = nullptr;
-  }
 
-  void updates_init(Updates *updates, const char *relation_name, const char *attribute_name,
+  void updates_init(Arena *arena, Updates *updates, const char *relation_name, const char *attribute_name,
                     Value *value, Condition conditions[], size_t condition_num)
   {
-    updates->relation_name = strdup(relation_name);
-    updates->attribute_name = strdup(attribute_name);
+    updates->relation_name = arena_strdup(arena, relation_name);
+    updates->attribute_name = arena_strdup(arena, attribute_name);
     updates->value = *value;
 
     assert(condition_num <= sizeof(updates->conditions) / sizeof(updates->conditions[0]));
@@ -450,99 +462,135 @@ int check_date_data_convert(const char *s,int &t){
     updates->condition_num = condition_num;
   }
 
-  void updates_destroy(Updates *updates)
-  {
-    free(updates->relation_name);
-    free(updates->attribute_name);
-    updates->relation_name = nullptr;
-    updates->attribute_name = nullptr;
-
-    value_destroy(&updates->value);
-
-    for (size_t i = 0; i < updates->condition_num; i++)
-    {
-      condition_destroy(&updates->conditions[i]);
-    }
-    updates->condition_num = 0;
-  }
-
   void create_table_append_attribute(CreateTable *create_table, AttrInfo *attr_info)
   {
     create_table->attributes[create_table->attribute_count++] = *attr_info;
   }
-  void create_table_init_name(CreateTable *create_table, const char *relation_name)
+  void create_table_init_name(Arena *arena, CreateTable *create_table, const char *relation_name)
   {
-    create_table->relation_name = strdup(relation_name);
+    create_table->relation_name = arena_strdup(arena, relation_name);
   }
-  void create_table_destroy(CreateTable *create_table)
+  void create_table_set_page_size(CreateTable *create_table, int page_size)
   {
+    create_table->page_size = page_size;
+  }
+  void create_table_set_compression(Arena *arena, CreateTable *create_table, const char *compression)
+  {
+    create_table->compression = arena_strdup(arena, compression);
+  }
+  void create_table_set_format(Arena *arena, CreateTable *create_table, const char *format)
+  {
+    create_table->format = arena_strdup(arena, format);
+  }
+  void create_table_set_engine(Arena *arena, CreateTable *create_table, const char *engine)
+  {
+    create_table->engine = arena_strdup(arena, engine);
+  }
+  void create_table_set_bloom_filter(Arena *arena, CreateTable *create_table, const char *field_name)
+  {
+    create_table->bloom_filter = arena_strdup(arena, field_name);
+  }
+  int create_table_set_dictionary(CreateTable *create_table, const char *field_name)
+  {
+    // 字段都在表选项之前，只有CHARS字段可以用字典编码
     for (size_t i = 0; i < create_table->attribute_count; i++)
     {
-      attr_info_destroy(&create_table->attributes[i]);
+      AttrInfo &attr_info = create_table->attributes[i];
+      if (0 == strcmp(attr_info.name, field_name))
+      {
+        if (attr_info.type != CHARS)
+        {
+          return -1;
+        }
+        attr_info.dictionary = 1;
+        return 0;
+      }
     }
-    create_table->attribute_count = 0;
-    free(create_table->relation_name);
-    create_table->relation_name = nullptr;
+    return -1;
+  }
+  void create_table_append_primary_key(Arena *arena, CreateTable *create_table, const char *field_name)
+  {
+    create_table->primary_keys[create_table->primary_key_num++] = arena_strdup(arena, field_name);
   }
 
-  void drop_table_init(DropTable *drop_table, const char *relation_name)
+  void create_table_set_partition(Arena *arena, CreateTable *create_table, PartitionType type, const char *field_name)
   {
-    drop_table->relation_name = strdup(relation_name);
+    create_table->partition.type = type;
+    create_table->partition.field_name = arena_strdup(arena, field_name);
   }
-  void drop_table_destroy(DropTable *drop_table)
+  void create_table_append_range_partition(Arena *arena, CreateTable *create_table, const char *partition_name,
+                                           const Value *bound)
   {
-    free(drop_table->relation_name);
-    drop_table->relation_name = nullptr;
+    PartitionDef &partition = create_table->partition;
+    partition.partition_names[partition.partition_num] = arena_strdup(arena, partition_name);
+    if (bound != nullptr) {
+      partition.bounds[partition.partition_num] = *bound;
+    } else {
+      partition.bounds[partition.partition_num].type = UNDEFINED;
+      partition.bounds[partition.partition_num].data = nullptr;
+    }
+    partition.partition_num++;
+  }
+  void create_table_set_hash_partitions(CreateTable *create_table, int partition_num)
+  {
+    create_table->partition.partition_num = partition_num;
   }
 
-  void create_index_init(CreateIndex *create_index, const char *index_name,
-                         const char *relation_name, const char *attr_name)
+  void drop_table_init(Arena *arena, DropTable *drop_table, const char *relation_name)
   {
-    create_index->index_name = strdup(index_name);
-    create_index->relation_name = strdup(relation_name);
-    create_index->attribute_name = strdup(attr_name);
+    drop_table->relation_name = arena_strdup(arena, relation_name);
   }
-  void create_index_destroy(CreateIndex *create_index)
+  void drop_partition_init(Arena *arena, DropPartition *drop_partition, const char *relation_name,
+                           const char *partition_name)
   {
-    free(create_index->index_name);
-    free(create_index->relation_name);
-    free(create_index->attribute_name);
-
-    create_index->index_name = nullptr;
-    create_index->relation_name = nullptr;
-    create_index->attribute_name = nullptr;
+    drop_partition->relation_name = arena_strdup(arena, relation_name);
+    drop_partition->partition_name = arena_strdup(arena, partition_name);
+  }
+  void truncate_table_init(Arena *arena, TruncateTable *truncate_table, const char *relation_name)
+  {
+    truncate_table->relation_name = arena_strdup(arena, relation_name);
+  }
+  void analyze_table_init(Arena *arena, AnalyzeTable *analyze_table, const char *relation_name)
+  {
+    analyze_table->relation_name = arena_strdup(arena, relation_name);
   }
 
-  void drop_index_init(DropIndex *drop_index, const char *index_name)
+  void create_index_init(Arena *arena, CreateIndex *create_index, const char *index_name,
+                         const char *relation_name, int unique)
+  {
+    create_index->index_name = arena_strdup(arena, index_name);
+    create_index->relation_name = arena_strdup(arena, relation_name);
+    create_index->unique = unique;
+  }
+  void create_index_append_attribute(Arena *arena, CreateIndex *create_index, const char *attr_name, int prefix_length)
   {
-    drop_index->index_name = strdup(index_name);
+    create_index->prefix_lengths[create_index->attribute_num] = prefix_length;
+    create_index->attribute_names[create_index->attribute_num++] = arena_strdup(arena, attr_name);
   }
-  void drop_index_destroy(DropIndex *drop_index)
+  void create_index_set_type(CreateIndex *create_index, IndexType index_type)
   {
-    free((char *)drop_index->index_name);
-    drop_index->index_name = nullptr;
+    create_index->index_type = index_type;
   }
 
-  void desc_table_init(DescTable *desc_table, const char *relation_name)
+  void drop_index_init(Arena *arena, DropIndex *drop_index, const char *index_name)
   {
-    desc_table->relation_name = strdup(relation_name);
+    drop_index->index_name = arena_strdup(arena, index_name);
   }
 
-  void desc_table_destroy(DescTable *desc_table)
+  void desc_table_init(Arena *arena, DescTable *desc_table, const char *relation_name)
   {
-    free((char *)desc_table->relation_name);
-    desc_table->relation_name = nullptr;
+    desc_table->relation_name = arena_strdup(arena, relation_name);
   }
 
-  void load_data_init(LoadData *load_data, const char *relation_name, const char *file_name)
+  void load_data_init(Arena *arena, LoadData *load_data, const char *relation_name, const char *file_name)
   {
-    load_data->relation_name = strdup(relation_name);
+    load_data->relation_name = arena_strdup(arena, relation_name);
 
     if (file_name[0] == '\'' || file_name[0] == '\"')
     {
       file_name++;
     }
-    char *dup_file_name = strdup(file_name);
+    char *dup_file_name = arena_strdup(arena, file_name);
     int len = strlen(dup_file_name);
     if (dup_file_name[len - 1] == '\'' || dup_file_name[len - 1] == '\"')
     {
@@ -551,104 +599,360 @@ int check_date_data_convert(const char *s,int &t){
     load_data->file_name = dup_file_name;
   }
 
-  void load_data_destroy(LoadData *load_data)
+  void backup_init(Arena *arena, Backup *backup, const char *dir)
   {
-    free((char *)load_data->relation_name);
-    free((char *)load_data->file_name);
-    load_data->relation_name = nullptr;
-    load_data->file_name = nullptr;
+    // 和load data的文件名一样去掉引号
+    char *dup_dir = arena_strdup(arena, dir[0] == '\'' || dir[0] == '\"' ? dir + 1 : dir);
+    const size_t len = strlen(dup_dir);
+    if (len > 0 && (dup_dir[len - 1] == '\'' || dup_dir[len - 1] == '\"')) {
+      dup_dir[len - 1] = 0;
+    }
+    backup->dir = dup_dir;
   }
 
-  void query_init(Query *query)
+  void fetch_init(Arena *arena, Fetch *fetch, const char *cursor_name, int row_num)
   {
-    query->flag = SCF_ERROR;
-    memset(&query->sstr, 0, sizeof(query->sstr));
+    fetch->cursor_name = arena_strdup(arena, cursor_name);
+    fetch->row_num = row_num;
   }
 
-  Query *query_create()
+  void close_cursor_init(Arena *arena, CloseCursor *close_cursor, const char *cursor_name)
   {
-    Query *query = (Query *)malloc(sizeof(Query));
-    if (nullptr == query)
-    {
-      LOG_ERROR("Failed to alloc memroy for query. size=%ld", sizeof(Query));
-      return nullptr;
+    close_cursor->cursor_name = arena_strdup(arena, cursor_name);
+  }
+
+  void prepare_init(Query *query, const char *stmt_name, size_t param_num)
+  {
+    if (query->flag == SCF_ERROR) {
+      return;
     }
+    // 把解析好的语句和它的arena移到prepare里，外层变成PREPARE语句
+    Query *stmt = query_create();
+    *stmt = *query;
+    query_init(query);
+    query->flag = SCF_PREPARE;
+    query->sstr.prepare.stmt_name = arena_strdup(&query->arena, stmt_name);
+    query->sstr.prepare.query = stmt;
+    query->sstr.prepare.param_num = param_num;
+  }
 
+  void create_view_init(Query *query, const char *view_name)
+  {
+    if (query->flag != SCF_SELECT) {
+      return;
+    }
+    // 和prepare一样，select连同它的arena移到create_view里
+    Query *stmt = query_create();
+    *stmt = *query;
     query_init(query);
-    return query;
+    query->flag = SCF_CREATE_VIEW;
+    query->sstr.create_view.view_name = arena_strdup(&query->arena, view_name);
+    query->sstr.create_view.query = stmt;
   }
 
-  void query_reset(Query *query)
+  void execute_init(Arena *arena, Execute *execute, const char *stmt_name, Value values[], size_t value_num)
   {
-    switch (query->flag)
-    {
-    case SCF_SELECT:
-    {
+    assert(value_num <= sizeof(execute->values) / sizeof(execute->values[0]));
+    execute->stmt_name = arena_strdup(arena, stmt_name);
+    for (size_t i = 0; i < value_num; i++) {
+      execute->values[i] = values[i];
+    }
+    execute->value_num = value_num;
+  }
+
+  void deallocate_init(Arena *arena, Deallocate *deallocate, const char *stmt_name)
+  {
+    deallocate->stmt_name = arena_strdup(arena, stmt_name);
+  }
+
+  void savepoint_init(Arena *arena, Savepoint *savepoint, const char *savepoint_name)
+  {
+    savepoint->savepoint_name = arena_strdup(arena, savepoint_name);
+  }
+
+  void set_variable_init(Arena *arena, SetVariable *set_variable, const char *variable_name, const char *value)
+  {
+    set_variable->variable_name = arena_strdup(arena, variable_name);
+    set_variable->value = arena_strdup(arena, value);
+  }
+
+  static void relation_attr_copy(Arena *arena, RelAttr *dst, const RelAttr *src);
+
+  static Expr *expr_copy(Arena *arena, const Expr *src)
+  {
+    if (src == nullptr) {
+      return nullptr;
+    }
+    Expr *dst = expr_create(arena, src->type);
+    dst->op = src->op;
+    if (src->type == EXPR_ATTR) {
+      relation_attr_copy(arena, &dst->attr, &src->attr);
+    } else if (src->type == EXPR_VALUE) {
+      value_copy(arena, &dst->value, &src->value);
+    }
+    dst->function_name = arena_strdup(arena, src->function_name);
+    dst->arg_num = src->arg_num;
+    for (size_t i = 0; i < src->arg_num; i++) {
+      dst->args[i] = expr_copy(arena, src->args[i]);
+    }
+    return dst;
+  }
 
-      selects_destroy(&query->sstr.selection);
+  static void relation_attr_copy(Arena *arena, RelAttr *dst, const RelAttr *src)
+  {
+    relation_attr_init(arena, dst, src->relation_name, src->attribute_name, src->window_function_name, src->is_desc);
+    dst->is_distinct = src->is_distinct;
+    if (src->window != nullptr) {
+      dst->window = window_spec_create(arena);
+      dst->window->partition_num = src->window->partition_num;
+      dst->window->order_num = src->window->order_num;
+      for (size_t i = 0; i < src->window->partition_num + src->window->order_num; i++) {
+        relation_attr_copy(arena, &dst->window->attrs[i], &src->window->attrs[i]);
+      }
     }
-    break;
-    case SCF_INSERT:
-    {
-      inserts_destroy(&query->sstr.insertion);
+    dst->expr = expr_copy(arena, src->expr);
+  }
+
+  static void selects_copy(Arena *arena, Selects *dst, const Selects *src);
+
+  static void condition_copy(Arena *arena, Condition *dst, const Condition *src)
+  {
+    memset(dst, 0, sizeof(*dst));
+    dst->is_valid = src->is_valid;
+    dst->comp = src->comp;
+    dst->left_is_attr = src->left_is_attr;
+    if (src->left_is_attr) {
+      relation_attr_copy(arena, &dst->left_attr, &src->left_attr);
+    } else {
+      value_copy(arena, &dst->left_value, &src->left_value);
     }
-    break;
-    case SCF_DELETE:
+    dst->right_is_attr = src->right_is_attr;
+    if (src->right_is_attr) {
+      relation_attr_copy(arena, &dst->right_attr, &src->right_attr);
+    } else {
+      value_copy(arena, &dst->right_value, &src->right_value);
+    }
+    if (src->sub_select != nullptr) {
+      dst->sub_select = (Selects *)arena_alloc(arena, sizeof(Selects));
+      selects_copy(arena, dst->sub_select, src->sub_select);
+    }
+  }
+
+  static void selects_copy(Arena *arena, Selects *dst, const Selects *src)
+  {
+    memset(dst, 0, sizeof(*dst));
+    for (size_t i = 0; i < src->attr_num; i++) {
+      relation_attr_copy(arena, &dst->attributes[i], &src->attributes[i]);
+    }
+    dst->attr_num = src->attr_num;
+    for (size_t i = 0; i < src->relation_num; i++) {
+      dst->relations[i] = arena_strdup(arena, src->relations[i]);
+    }
+    dst->relation_num = src->relation_num;
+    for (size_t i = 0; i < src->condition_num; i++) {
+      condition_copy(arena, &dst->conditions[i], &src->conditions[i]);
+    }
+    dst->condition_num = src->condition_num;
+    for (size_t i = 0; i < src->expr_condition_num; i++) {
+      dst->expr_conditions[i].comp = src->expr_conditions[i].comp;
+      dst->expr_conditions[i].left = expr_copy(arena, src->expr_conditions[i].left);
+      dst->expr_conditions[i].right = expr_copy(arena, src->expr_conditions[i].right);
+    }
+    dst->expr_condition_num = src->expr_condition_num;
+    for (size_t i = 0; i < src->order_num; i++) {
+      relation_attr_copy(arena, &dst->order_attrs[i], &src->order_attrs[i]);
+    }
+    dst->order_num = src->order_num;
+    for (size_t i = 0; i < src->group_num; i++) {
+      relation_attr_copy(arena, &dst->group_attrs[i], &src->group_attrs[i]);
+    }
+    dst->group_num = src->group_num;
+    dst->has_limit = src->has_limit;
+    dst->explain = src->explain;
+    dst->distinct = src->distinct;
+    dst->limit = src->limit;
+    dst->offset = src->offset;
+  }
+
+  void query_copy(Query *dst, const Query *src)
+  {
+    query_init(dst);
+    dst->flag = src->flag;
+    Arena *arena = &dst->arena;
+    switch (src->flag) {
+    case SCF_SELECT:
+      selects_copy(arena, &dst->sstr.selection, &src->sstr.selection);
+      break;
+    case SCF_INSERT:
     {
-      deletes_destroy(&query->sstr.deletion);
+      const Inserts &from = src->sstr.insertion;
+      Inserts &to = dst->sstr.insertion;
+      for (size_t i = 0; i < from.group_num; i++) {
+        Value values[MAX_NUM];
+        for (size_t j = 0; j < from.value_num[i]; j++) {
+          value_copy(arena, &values[j], &from.values[i][j]);
+        }
+        inserts_init(arena, &to, from.relation_name, values, from.value_num[i], i);
+      }
+      to.group_num = from.group_num;
     }
     break;
     case SCF_UPDATE:
     {
-      updates_destroy(&query->sstr.update);
+      const Updates &from = src->sstr.update;
+      Updates &to = dst->sstr.update;
+      to.relation_name = arena_strdup(arena, from.relation_name);
+      to.attribute_name = arena_strdup(arena, from.attribute_name);
+      value_copy(arena, &to.value, &from.value);
+      for (size_t i = 0; i < from.condition_num; i++) {
+        condition_copy(arena, &to.conditions[i], &from.conditions[i]);
+      }
+      to.condition_num = from.condition_num;
     }
     break;
-    case SCF_CREATE_TABLE:
+    case SCF_DELETE:
     {
-      create_table_destroy(&query->sstr.create_table);
+      const Deletes &from = src->sstr.deletion;
+      Deletes &to = dst->sstr.deletion;
+      to.relation_name = arena_strdup(arena, from.relation_name);
+      for (size_t i = 0; i < from.condition_num; i++) {
+        condition_copy(arena, &to.conditions[i], &from.conditions[i]);
+      }
+      to.condition_num = from.condition_num;
     }
     break;
-    case SCF_DROP_TABLE:
-    {
-      drop_table_destroy(&query->sstr.drop_table);
+    default:
+      // 只有这几种语句可以预编译
+      LOG_ERROR("Cannot copy query. flag=%d", src->flag);
+      dst->flag = SCF_ERROR;
+      break;
     }
-    break;
-    case SCF_CREATE_INDEX:
-    {
-      create_index_destroy(&query->sstr.create_index);
+  }
+
+  static void bind_value(Arena *arena, Value *value, const Value params[])
+  {
+    if (value->type != UNDEFINED || value->data == nullptr) {
+      return;
     }
-    break;
-    case SCF_DROP_INDEX:
-    {
-      drop_index_destroy(&query->sstr.drop_index);
+    int param_index = *(int *)value->data;
+    value_copy(arena, value, &params[param_index]);
+  }
+
+  static void bind_condition_params(Arena *arena, Condition conditions[], size_t condition_num, const Value params[]);
+
+  static void bind_expr_params(Arena *arena, Expr *expr, const Value params[])
+  {
+    if (expr == nullptr) {
+      return;
     }
-    break;
-    case SCF_SYNC:
+    if (expr->type == EXPR_VALUE) {
+      bind_value(arena, &expr->value, params);
+    }
+    for (size_t i = 0; i < expr->arg_num; i++) {
+      bind_expr_params(arena, expr->args[i], params);
+    }
+  }
+
+  static void bind_selects_params(Arena *arena, Selects *selects, const Value params[])
+  {
+    for (size_t i = 0; i < selects->attr_num; i++) {
+      bind_expr_params(arena, selects->attributes[i].expr, params);
+    }
+    bind_condition_params(arena, selects->conditions, selects->condition_num, params);
+    for (size_t i = 0; i < selects->expr_condition_num; i++) {
+      bind_expr_params(arena, selects->expr_conditions[i].left, params);
+      bind_expr_params(arena, selects->expr_conditions[i].right, params);
+    }
+  }
+
+  static void bind_condition_params(Arena *arena, Condition conditions[], size_t condition_num, const Value params[])
+  {
+    for (size_t i = 0; i < condition_num; i++) {
+      Condition &condition = conditions[i];
+      if (!condition.left_is_attr) {
+        bind_value(arena, &condition.left_value, params);
+      }
+      if (!condition.right_is_attr) {
+        bind_value(arena, &condition.right_value, params);
+      }
+      if (condition.sub_select != nullptr) {
+        bind_selects_params(arena, condition.sub_select, params);
+      }
+    }
+  }
+
+  /**
+   * 把语句中的参数替换成params中对应序号的值，params的个数由调用者保证和参数个数一致
+   */
+  void query_bind_params(Query *query, const Value params[])
+  {
+    Arena *arena = &query->arena;
+    switch (query->flag) {
+    case SCF_SELECT:
+      bind_selects_params(arena, &query->sstr.selection, params);
+      break;
+    case SCF_INSERT:
     {
+      Inserts &inserts = query->sstr.insertion;
+      for (size_t i = 0; i < inserts.group_num; i++) {
+        for (size_t j = 0; j < inserts.value_num[i]; j++) {
+          bind_value(arena, &inserts.values[i][j], params);
+        }
+      }
     }
     break;
-    case SCF_SHOW_TABLES:
+    case SCF_UPDATE:
+      bind_value(arena, &query->sstr.update.value, params);
+      bind_condition_params(arena, query->sstr.update.conditions, query->sstr.update.condition_num, params);
+      break;
+    case SCF_DELETE:
+      bind_condition_params(arena, query->sstr.deletion.conditions, query->sstr.deletion.condition_num, params);
+      break;
+    default:
       break;
+    }
+  }
 
-    case SCF_DESC_TABLE:
+  /**
+   * 不释放arena，已经有内容的语句需要调用query_reset
+   */
+  void query_init(Query *query)
+  {
+    query->flag = SCF_ERROR;
+    query->arena.blocks = nullptr;
+    query->arena.pos = nullptr;
+    query->arena.end = nullptr;
+    memset(&query->sstr, 0, sizeof(query->sstr));
+  }
+
+  Query *query_create()
+  {
+    Query *query = (Query *)malloc(sizeof(Query));
+    if (nullptr == query)
     {
-      desc_table_destroy(&query->sstr.desc_table);
+      LOG_ERROR("Failed to alloc memroy for query. size=%ld", sizeof(Query));
+      return nullptr;
     }
-    break;
 
-    case SCF_LOAD_DATA:
+    query_init(query);
+    return query;
+  }
+
+  /**
+   * 语句中的字符串、值和子查询都在arena中，一起释放。预编译的语句是另外一个Query，有自己的arena
+   */
+  void query_reset(Query *query)
+  {
+    if (query->flag == SCF_PREPARE && query->sstr.prepare.query != nullptr)
     {
-      load_data_destroy(&query->sstr.load_data);
+      query_destroy(query->sstr.prepare.query);
     }
-    break;
-    case SCF_BEGIN:
-    case SCF_COMMIT:
-    case SCF_ROLLBACK:
-    case SCF_HELP:
-    case SCF_EXIT:
-    case SCF_ERROR:
-      break;
+    if (query->flag == SCF_CREATE_VIEW && query->sstr.create_view.query != nullptr)
+    {
+      query_destroy(query->sstr.create_view.query);
     }
+    arena_destroy(&query->arena);
+    query_init(query);
   }
 
   void query_destroy(Query *query)
@@ -662,7 +966,7 @@ int check_date_data_convert(const char *s,int &t){
     LOG_ERROR(info);
   }
 
-  const char *number_to_str(int number)
+  char *number_to_str(Arena *arena, int number)
   {
     char s[25];
     char ret[25];
@@ -673,7 +977,7 @@ int check_date_data_convert(const char *s,int &t){
     {
       s[idx++] = '0';
       s[idx] = '\0';
-      return strdup(s);
+      return arena_strdup(arena, s);
     }
 
     if (number < 0)
@@ -688,13 +992,14 @@ int check_date_data_convert(const char *s,int &t){
       number /= 10;
     }
 
-    for (int j = 0; j < idx; ++j)
+    // s中是倒序的各位数字
+    for (int j = idx - 1; j >= 0; --j)
     {
       ret[i++] = s[j];
     }
 
     ret[i] = '\0';
-    return strdup(ret);
+    return arena_strdup(arena, ret);
   }
 
 #ifdef __cplusplus
@@ -703,11 +1008,48 @@ int check_date_data_convert(const char *s,int &t){
 
 ////////////////////////////////////////////////////////////////////////////////
 
-extern "C" int sql_parse(const char *st, Query *sqls);
+extern "C" void *sql_scanner_create(void);
+extern "C" void sql_scanner_destroy(void *scanner);
+extern "C" int sql_parse(void *scanner, const char *st, Query *sqls);
+extern "C" int sql_parse_template(void *scanner, const char *st, Query *sqls, size_t *param_num);
+
+namespace {
+/**
+ * 解析器没有全局状态，每个线程使用自己的词法分析器，线程退出时释放
+ */
+class ThreadScanner {
+public:
+  ThreadScanner() : scanner_(sql_scanner_create())
+  {}
+  ~ThreadScanner()
+  {
+    sql_scanner_destroy(scanner_);
+  }
+  void *get() const
+  {
+    return scanner_;
+  }
+
+private:
+  void *scanner_;
+};
+
+void *thread_scanner()
+{
+  static thread_local ThreadScanner scanner;
+  return scanner.get();
+}
+}  // namespace
 
 RC parse(const char *st, Query *sqln)
 {
-  sql_parse(st, sqln);
+  void *scanner = thread_scanner();
+  if (nullptr == scanner) {
+    LOG_ERROR("Failed to create sql scanner.");
+    sqln->flag = SCF_ERROR;
+    return SQL_SYNTAX;
+  }
+  sql_parse(scanner, st, sqln);
   //LOG_INFO(" the parse result sqln->flag is %d",sqln->flag);
   if (sqln->flag == SCF_ERROR){
     LOG_INFO(" the parse function return SQL_SYNTAX");
@@ -716,4 +1058,18 @@ RC parse(const char *st, Query *sqln)
     LOG_INFO(" the parse function return SUCCESS");
     return SUCCESS;
   }
-}
\ No newline at end of file
+}
+
+RC parse_template(const char *st, Query *sqln, size_t &param_num)
+{
+  param_num = 0;
+  void *scanner = thread_scanner();
+  if (nullptr == scanner) {
+    LOG_ERROR("Failed to create sql scanner.");
+    return SQL_SYNTAX;
+  }
+  if (sql_parse_template(scanner, st, sqln, &param_num) != 0 || sqln->flag == SCF_ERROR) {
+    return SQL_SYNTAX;
+  }
+  return SUCCESS;
+}
@@ -20,5 +20,10 @@ See the Mulan PSL v2 for more details. */
 
 RC parse(const char *st, Query *sqln);
 
+/**
+ * 解析带参数?的语句，不做PREPARE，执行计划缓存用常量换成?的语句作为模板
+ */
+RC parse_template(const char *st, Query *sqln, size_t &param_num);
+
 #endif //__OBSERVER_SQL_PARSER_PARSE_H__
 
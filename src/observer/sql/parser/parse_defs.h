@@ -20,20 +20,35 @@ See the Mulan PSL v2 for more details. */
 #include <stdbool.h>
 
 #define MAX_NUM 20
+#define MAX_PARTITION_NUM 64
+#define INSERT_GROUP_INIT_CAPACITY 16 // insert语句开始能放的组数，组数本身没有上限
 #define MAX_REL_NAME 20
 #define MAX_ATTR_NAME 20
 #define MAX_ERROR_MESSAGE 20
 #define MAX_DATA 50
+#define MAX_EXPR_ARGS 4 // 表达式中函数的参数个数上限
 
 //属性结构体
-typedef struct
+typedef struct _RelAttr
 {
   int is_desc;                // 默认采用升序asc，=1降序
   char *relation_name;        // relation name (may be NULL) 表名
   char *attribute_name;       // attribute name              属性名
   char *window_function_name; // 窗口函数名
+  int is_distinct;            // COUNT(DISTINCT attr)
+  struct _WindowSpec *window; // 带OVER子句的窗口函数，普通的列和聚合函数为NULL
+  struct _Expr *expr;         // select中的表达式，比如a + 1、upper(name)，这时其它字段都不使用
 } RelAttr;
 
+// 窗口函数的OVER (PARTITION BY ... ORDER BY ...)。attrs中先是partition by的字段，再是order by的字段，
+// 都按照语句中的顺序，整个attrs就是计算窗口函数之前需要的排序
+typedef struct _WindowSpec
+{
+  size_t partition_num;
+  size_t order_num;
+  RelAttr attrs[MAX_NUM];
+} WindowSpec;
+
 typedef enum
 {
   EQUAL_TO,    //"="     0
@@ -44,7 +59,14 @@ typedef enum
   GREAT_THAN,  //">"     5
   IS_NULL,
   IS_NOT_NULL,
-  NO_OP
+  LIKE_OP,     //"like"，右边是模式串常量
+  NOT_LIKE_OP, //"not like"
+  NO_OP,
+  // 下面是子查询的条件，只在select中使用，由执行阶段把子查询的结果放进hash表之后判断
+  IN_SUBQUERY,         // attr in (select ...)
+  NOT_IN_SUBQUERY,     // attr not in (select ...)
+  EXISTS_SUBQUERY,     // exists (select ...)
+  NOT_EXISTS_SUBQUERY  // not exists (select ...)
 } CompOp;
 
 //属性值类型
@@ -58,6 +80,21 @@ typedef enum
   NULLS
 } AttrType;
 
+// 索引的存储结构，哈希索引只能用于等值查找
+typedef enum
+{
+  BPLUS_TREE_INDEX,
+  HASH_INDEX
+} IndexType;
+
+// 分区表按哪种方式把记录分到各个分区
+typedef enum
+{
+  NO_PARTITION,
+  RANGE_PARTITION,
+  HASH_PARTITION
+} PartitionType;
+
 // true or false
 typedef enum
 {
@@ -74,6 +111,39 @@ typedef struct _Value
   int is_null;   // 1:null, 0:not null
 } Value;
 
+// 表达式的节点类型
+typedef enum
+{
+  EXPR_ATTR,  // 字段
+  EXPR_VALUE, // 常量或者参数
+  EXPR_ARITH, // 四则运算，运算符在op中
+  EXPR_NEG,   // 取负
+  EXPR_FUNC   // 函数调用
+} ExprType;
+
+// 表达式树，叶子是字段或者常量。和语句的其它部分一样都分配在语句的arena中
+typedef struct _Expr
+{
+  ExprType type;
+  char op;                           // EXPR_ARITH的运算符，'+' '-' '*' '/'
+  RelAttr attr;                      // EXPR_ATTR的字段
+  Value value;                       // EXPR_VALUE的值
+  char *function_name;               // EXPR_FUNC的函数名
+  size_t arg_num;                    // EXPR_ARITH有两个参数，EXPR_NEG有一个
+  struct _Expr *args[MAX_EXPR_ARGS];
+} Expr;
+
+// where中两侧不都是字段或者常量的比较，比如a + b > 10、upper(name) = 'A'、a * 2 is null。
+// IS_NULL和IS_NOT_NULL时right为NULL
+typedef struct _ExprCondition
+{
+  CompOp comp;
+  Expr *left;
+  Expr *right;
+} ExprCondition;
+
+struct _Selects;
+
 typedef struct _Condition
 {
   bool is_valid;      // added for check if date value is valid
@@ -88,34 +158,53 @@ typedef struct _Condition
                       // 1时，操作符右边是属性名，0时，是属性值
   RelAttr right_attr; // right-hand side attribute if right_is_attr = TRUE 右边的属性
   Value right_value;  // right-hand side value if right_is_attr = FALSE
+  struct _Selects *sub_select; // 子查询条件的子查询，其它条件为NULL
 } Condition;
 
 // struct of select
 // SELECT column_name,column_name
 // FROM table_name
 // WHERE column_name operator value;
-typedef struct
+// explain的类型，EXPLAIN只输出执行计划，EXPLAIN_ANALYZE执行查询并输出每个算子的实际执行情况
+typedef enum
+{
+  EXPLAIN_NONE = 0,
+  EXPLAIN_PLAN,
+  EXPLAIN_ANALYZE
+} ExplainType;
+
+typedef struct _Selects
 {
   size_t attr_num;               // Length of attrs in Select clause
-  RelAttr attributes[MAX_NUM];   // attrs in Select clause
+  RelAttr attributes[MAX_NUM];   // attrs in Select clause，和select中的顺序相反
   size_t relation_num;           // Length of relations in For clause
   char *relations[MAX_NUM];      // relations in From clause
   size_t condition_num;          // Length of conditions in Where clause
   Condition conditions[MAX_NUM]; // conditions in Where clause
+  size_t expr_condition_num;     // where中带表达式的条件，和conditions是and的关系
+  ExprCondition expr_conditions[MAX_NUM];
   size_t order_num;
   RelAttr order_attrs[MAX_NUM]; // order by数组
   size_t group_num;
   RelAttr group_attrs[MAX_NUM]; // group by 数组
+  int has_limit;                // 是否有limit子句
+  int limit;                    // 最多返回的行数
+  int offset;                   // 跳过前面的行数
+  int explain;                  // ExplainType，是否是explain或者explain analyze
+  int distinct;                 // select distinct，去掉重复的结果行
+  char *outfile;                // select ... into outfile的文件名，NULL时结果返回给客户端
+  char *cursor;                 // declare 游标名 cursor for select时的游标名，NULL时是普通的查询
 } Selects;
 
 // struct of insert
 typedef struct
 {
   char *relation_name;       // Relation to insert into
-  size_t value_num[MAX_NUM]; // Length of values
+  size_t *value_num;         // Length of values
   size_t group_num;
+  size_t group_capacity;     // value_num和values能放下的组数，不够时在arena中按两倍扩展
   // Value values[MAX_NUM]; // values to insert
-  Value values[MAX_NUM][MAX_NUM]; // values to insert, values[i][j] - 插入的第i组元素第j个值
+  Value **values; // values to insert, values[i][j] - 插入的第i组元素第j个值，每组按实际的个数分配
 } Inserts;
 
 // struct of delete
@@ -142,14 +231,34 @@ typedef struct
   AttrType type;   // Type of attribute
   size_t length;   // Length of attribute
   int is_nullable; // 是否允许null，默认不允许
+  int dictionary;  // CHARS字段是否用字典编码，记录中只保存值在字典中的编码
 } AttrInfo;
 
+// partition by range(field) (partition name values less than (value|maxvalue), ...)
+// partition by hash(field) partitions num
+typedef struct
+{
+  PartitionType type;
+  char *field_name;                        // 分区字段
+  size_t partition_num;                     // 分区个数
+  char *partition_names[MAX_PARTITION_NUM]; // range分区的名字，hash分区按序号命名
+  Value bounds[MAX_PARTITION_NUM];          // range分区的上界(不含)，maxvalue的type是UNDEFINED
+} PartitionDef;
+
 // struct of craete_table
 typedef struct
 {
   char *relation_name;          // Relation name
   size_t attribute_count;       // Length of attribute
   AttrInfo attributes[MAX_NUM]; // attributes
+  int page_size;                // 数据和索引文件的页面大小，0表示使用默认值
+  char *compression;            // 数据文件的页面压缩方式，nullptr表示不压缩
+  char *format;                 // 数据文件的记录格式(row/pax)，nullptr表示row
+  char *engine;                 // 存储引擎(disk/memory)，nullptr表示disk
+  char *bloom_filter;           // 记录文件中按区段建布隆过滤器的字段，nullptr表示不建
+  PartitionDef partition;       // 分区方式，type为NO_PARTITION时不分区
+  size_t primary_key_num;         // 主键字段的个数，0表示没有主键
+  char *primary_keys[MAX_NUM];    // 主键字段，按这个顺序比较
 } CreateTable;
 
 // struct of drop_table
@@ -158,12 +267,36 @@ typedef struct
   char *relation_name; // Relation name
 } DropTable;
 
+// struct of truncate_table
+typedef struct
+{
+  char *relation_name;
+} TruncateTable;
+
+// struct of analyze_table
+typedef struct
+{
+  char *relation_name;
+} AnalyzeTable;
+
+// struct of drop partition
+// ALTER TABLE relation_name DROP PARTITION partition_name
+typedef struct
+{
+  char *relation_name;
+  char *partition_name;
+} DropPartition;
+
 // struct of create_index
 typedef struct
 {
   char *index_name;     // Index name
   char *relation_name;  // Relation name
-  char *attribute_name; // Attribute name
+  size_t attribute_num;           // Length of attribute names
+  char *attribute_names[MAX_NUM]; // Attribute names，多字段索引按这个顺序比较
+  int prefix_lengths[MAX_NUM];    // 字符串字段只索引前几个字符，0表示整个字段
+  int unique;                     // 1:unique index, 0:normal index
+  IndexType index_type;           // using btree/hash
 } CreateIndex;
 
 // struct of  drop_index
@@ -183,6 +316,85 @@ typedef struct
   const char *file_name;
 } LoadData;
 
+struct Query;
+
+// struct of prepare
+// PREPARE stmt_name FROM statement，statement中的参数写作?
+typedef struct
+{
+  char *stmt_name;     // 预编译语句的名字
+  struct Query *query; // 解析好的语句，参数是type为UNDEFINED、data为参数序号(int)的Value
+  size_t param_num;    // 参数个数
+} Prepare;
+
+// struct of create materialized view
+// CREATE MATERIALIZED VIEW view_name AS select
+typedef struct
+{
+  char *view_name;
+  struct Query *query; // 定义视图的select，和预编译的语句一样是另外一个Query
+} CreateView;
+
+// struct of execute
+// EXECUTE stmt_name [USING value, ...]
+typedef struct
+{
+  char *stmt_name;
+  size_t value_num;
+  Value values[MAX_NUM]; // 按顺序绑定到语句中的参数
+} Execute;
+
+// struct of deallocate
+// DEALLOCATE PREPARE stmt_name
+typedef struct
+{
+  char *stmt_name;
+} Deallocate;
+
+// struct of savepoint
+// SAVEPOINT name, ROLLBACK TO [SAVEPOINT] name, RELEASE SAVEPOINT name
+typedef struct
+{
+  char *savepoint_name;
+} Savepoint;
+
+// struct of set variable
+// SET name = value
+typedef struct
+{
+  char *variable_name;
+  char *value;
+} SetVariable;
+
+// struct of backup
+// BACKUP TO 'dir'
+typedef struct
+{
+  char *dir;
+} Backup;
+
+// struct of fetch
+// FETCH row_num FROM cursor_name
+typedef struct
+{
+  char *cursor_name;
+  int row_num;         // 最多取出的行数
+} Fetch;
+
+// struct of close cursor
+// CLOSE cursor_name
+typedef struct
+{
+  char *cursor_name;
+} CloseCursor;
+
+// struct of kill query
+// KILL QUERY connection_id
+typedef struct
+{
+  int connection_id;
+} KillQuery;
+
 union Queries
 {
   Selects selection;
@@ -191,10 +403,23 @@ union Queries
   Updates update;
   CreateTable create_table;
   DropTable drop_table;
+  TruncateTable truncate_table;
+  AnalyzeTable analyze_table;
+  DropPartition drop_partition;
   CreateIndex create_index;
   DropIndex drop_index;
   DescTable desc_table;
   LoadData load_data;
+  Prepare prepare;
+  CreateView create_view;
+  Execute execute;
+  Deallocate deallocate;
+  Savepoint savepoint;
+  SetVariable set_variable;
+  KillQuery kill_query;
+  Backup backup;
+  Fetch fetch;
+  CloseCursor close_cursor;
   char *errors;
 };
 
@@ -213,17 +438,52 @@ enum SqlCommandFlag
   SCF_SYNC,
   SCF_SHOW_TABLES,
   SCF_DESC_TABLE,
+  SCF_SHOW_BUFFER_POOL,
   SCF_BEGIN,
   SCF_COMMIT,
   SCF_ROLLBACK,
   SCF_LOAD_DATA,
   SCF_HELP,
-  SCF_EXIT
+  SCF_EXIT,
+  SCF_PREPARE,
+  SCF_EXECUTE,
+  SCF_DEALLOCATE,
+  SCF_SAVEPOINT,
+  SCF_ROLLBACK_TO_SAVEPOINT,
+  SCF_RELEASE_SAVEPOINT,
+  SCF_SET_VARIABLE,
+  SCF_DROP_PARTITION,
+  SCF_TRUNCATE_TABLE,
+  SCF_ANALYZE_TABLE,
+  SCF_SHOW_STATEMENT_STATS,
+  SCF_RESET_STATEMENT_STATS,
+  SCF_KILL_QUERY,
+  SCF_SHOW_PROCESSLIST,
+  SCF_CREATE_VIEW,
+  SCF_BACKUP,
+  SCF_FETCH,
+  SCF_CLOSE_CURSOR,
+  SCF_NUM  // 语句类型的个数，按类型统计的数组用它作为大小，新的类型加在它前面
 };
+#define ARENA_BLOCK_SIZE 4096 // arena每次向malloc申请的大小，超过1/4的对象单独申请
+#define ARENA_ALIGN 8
+
+struct _ArenaBlock;
+typedef struct _ArenaBlock ArenaBlock;
+
+// 解析一条语句时分配的字符串、值和子查询都放在语句自己的arena中，语句销毁时一起释放
+typedef struct _Arena
+{
+  ArenaBlock *blocks; // 申请过的块，最后申请的在前面
+  char *pos;          // 当前块中没有使用的空间
+  char *end;
+} Arena;
+
 // struct of flag and sql_struct
 typedef struct Query
 {
   enum SqlCommandFlag flag;
+  Arena arena;
   union Queries sstr;
 } Query;
 
@@ -232,69 +492,118 @@ extern "C"
 {
 #endif // __cplusplus
 
-  void relation_attr_init(RelAttr *relation_attr, const char *relation_name, const char *attribute_name, const char *window_function_name, int _is_desc);
-  void relation_attr_destroy(RelAttr *relation_attr);
-
-  void value_init_integer(Value *value, int v, int is_null);
-  void value_init_float(Value *value, float v, int is_null);
-  void value_init_string(Value *value, const char *v, int is_null);
+  /**
+   * arena为NULL时使用malloc申请，这样的内存需要调用者释放，比如用value_destroy释放值
+   */
+  void *arena_alloc(Arena *arena, size_t size);
+  char *arena_strdup(Arena *arena, const char *s);
+  void arena_destroy(Arena *arena);
+
+  // 下面的init函数把字符串和值的内容复制到arena中，参数可以是临时的
+  void relation_attr_init(Arena *arena, RelAttr *relation_attr, const char *relation_name, const char *attribute_name,
+                          const char *window_function_name, int _is_desc);
+
+  WindowSpec *window_spec_create(Arena *arena);
+  void window_spec_append_partition(WindowSpec *window, RelAttr *attr);
+  void window_spec_append_order(WindowSpec *window, RelAttr *attr);
+
+  void value_init_integer(Arena *arena, Value *value, int v, int is_null);
+  void value_init_float(Arena *arena, Value *value, float v, int is_null);
+  void value_init_string(Arena *arena, Value *value, const char *v, int is_null);
+  void value_init_param(Arena *arena, Value *value, int param_index);
+  void value_copy(Arena *arena, Value *dst, const Value *src);
+  // 只用于arena为NULL时初始化的值，语句中的值随着语句一起释放
   void value_destroy(Value *value);
 
+  Expr *expr_create_attr(Arena *arena, const char *relation_name, const char *attribute_name);
+  Expr *expr_create_value(Arena *arena, const Value *value);
+  Expr *expr_create_arith(Arena *arena, char op, Expr *left, Expr *right);
+  Expr *expr_create_neg(Arena *arena, Expr *child);
+  Expr *expr_create_func(Arena *arena, const char *function_name);
+  // 参数太多时返回0
+  int expr_append_arg(Expr *func, Expr *arg);
+
   void condition_init(Condition *condition, CompOp comp, int left_is_attr, RelAttr *left_attr, Value *left_value,
                       int right_is_attr, RelAttr *right_attr, Value *right_value);
-  void condition_destroy(Condition *condition);
+  void condition_init_subquery(Condition *condition, CompOp comp, RelAttr *left_attr, Selects *sub_select);
 
-  void attr_info_init(AttrInfo *attr_info, const char *name, AttrType type, size_t length, TrueOrFalse is_nullable);
-  void attr_info_destroy(AttrInfo *attr_info);
+  void attr_info_init(Arena *arena, AttrInfo *attr_info, const char *name, AttrType type, size_t length, TrueOrFalse is_nullable);
 
   void selects_init(Selects *selects, ...);
   void selects_append_attribute(Selects *selects, RelAttr *rel_attr);
-  void selects_append_relation(Selects *selects, const char *relation_name);
+  void selects_append_relation(Arena *arena, Selects *selects, const char *relation_name);
   // void selects_append_conditions(Selects *selects, Condition conditions[], size_t condition_num);
-  void selects_append_conditions(Query *sql, Condition conditions[], size_t condition_num);
+  void selects_append_conditions(Query *sql, Selects *selects, Condition conditions[], size_t condition_num);
+  void selects_append_expr_conditions(Selects *selects, ExprCondition conditions[], size_t condition_num);
   void selects_append_order(Selects *selects, RelAttr *rel_attr);
   void selects_append_group(Selects *selects, RelAttr *rel_attr);
-  void selects_destroy(Selects *selects);
+  void selects_set_limit(Selects *selects, int limit, int offset);
+  void selects_set_explain(Selects *selects, ExplainType explain);
+  void selects_set_outfile(Arena *arena, Selects *selects, const char *file_name);
+  void selects_set_cursor(Arena *arena, Selects *selects, const char *cursor_name);
 
-  void inserts_init(Inserts *inserts, const char *relation_name, Value values[], size_t value_num, size_t index);
-  void inserts_destroy(Inserts *inserts);
+  void inserts_init(Arena *arena, Inserts *inserts, const char *relation_name, Value values[], size_t value_num, size_t index);
 
-  void deletes_init_relation(Deletes *deletes, const char *relation_name);
+  void deletes_init_relation(Arena *arena, Deletes *deletes, const char *relation_name);
   void deletes_set_conditions(Deletes *deletes, Condition conditions[], size_t condition_num);
-  void deletes_destroy(Deletes *deletes);
 
-  void updates_init(Updates *updates, const char *relation_name, const char *attribute_name, Value *value,
+  void updates_init(Arena *arena, Updates *updates, const char *relation_name, const char *attribute_name, Value *value,
                     Condition conditions[], size_t condition_num);
-  void updates_destroy(Updates *updates);
 
   void create_table_append_attribute(CreateTable *create_table, AttrInfo *attr_info);
-  void create_table_init_name(CreateTable *create_table, const char *relation_name);
-  void create_table_destroy(CreateTable *create_table);
+  void create_table_init_name(Arena *arena, CreateTable *create_table, const char *relation_name);
+  void create_table_set_page_size(CreateTable *create_table, int page_size);
+  void create_table_set_compression(Arena *arena, CreateTable *create_table, const char *compression);
+  void create_table_set_format(Arena *arena, CreateTable *create_table, const char *format);
+  void create_table_set_engine(Arena *arena, CreateTable *create_table, const char *engine);
+  void create_table_set_bloom_filter(Arena *arena, CreateTable *create_table, const char *field_name);
+  int create_table_set_dictionary(CreateTable *create_table, const char *field_name);
+  void create_table_append_primary_key(Arena *arena, CreateTable *create_table, const char *field_name);
+
+  void create_table_set_partition(Arena *arena, CreateTable *create_table, PartitionType type, const char *field_name);
+  void create_table_append_range_partition(Arena *arena, CreateTable *create_table, const char *partition_name,
+                                           const Value *bound);
+  void create_table_set_hash_partitions(CreateTable *create_table, int partition_num);
+
+  void drop_table_init(Arena *arena, DropTable *drop_table, const char *relation_name);
+  void drop_partition_init(Arena *arena, DropPartition *drop_partition, const char *relation_name,
+                           const char *partition_name);
+  void truncate_table_init(Arena *arena, TruncateTable *truncate_table, const char *relation_name);
+  void analyze_table_init(Arena *arena, AnalyzeTable *analyze_table, const char *relation_name);
+
+  void create_index_init(Arena *arena, CreateIndex *create_index, const char *index_name, const char *relation_name, int unique);
+  void create_index_append_attribute(Arena *arena, CreateIndex *create_index, const char *attr_name, int prefix_length);
+  void create_index_set_type(CreateIndex *create_index, IndexType index_type);
+
+  void drop_index_init(Arena *arena, DropIndex *drop_index, const char *index_name);
 
-  void drop_table_init(DropTable *drop_table, const char *relation_name);
-  void drop_table_destroy(DropTable *drop_table);
+  void desc_table_init(Arena *arena, DescTable *desc_table, const char *relation_name);
 
-  void create_index_init(
-      CreateIndex *create_index, const char *index_name, const char *relation_name, const char *attr_name);
-  void create_index_destroy(CreateIndex *create_index);
+  void load_data_init(Arena *arena, LoadData *load_data, const char *relation_name, const char *file_name);
+  void backup_init(Arena *arena, Backup *backup, const char *dir);
+  void fetch_init(Arena *arena, Fetch *fetch, const char *cursor_name, int row_num);
+  void close_cursor_init(Arena *arena, CloseCursor *close_cursor, const char *cursor_name);
 
-  void drop_index_init(DropIndex *drop_index, const char *index_name);
-  void drop_index_destroy(DropIndex *drop_index);
+  void prepare_init(Query *query, const char *stmt_name, size_t param_num);
+  void create_view_init(Query *query, const char *view_name);
 
-  void desc_table_init(DescTable *desc_table, const char *relation_name);
-  void desc_table_destroy(DescTable *desc_table);
+  void execute_init(Arena *arena, Execute *execute, const char *stmt_name, Value values[], size_t value_num);
 
-  void load_data_init(LoadData *load_data, const char *relation_name, const char *file_name);
-  void load_data_destroy(LoadData *load_data);
+  void deallocate_init(Arena *arena, Deallocate *deallocate, const char *stmt_name);
+  void savepoint_init(Arena *arena, Savepoint *savepoint, const char *savepoint_name);
+  void set_variable_init(Arena *arena, SetVariable *set_variable, const char *variable_name, const char *value);
 
   void query_init(Query *query);
   Query *query_create(); // create and init
   void query_reset(Query *query);
   void query_destroy(Query *query); // reset and delete
+  // 深拷贝select/insert/update/delete语句，预编译语句每次执行时在拷贝上绑定参数
+  void query_copy(Query *dst, const Query *src);
+  void query_bind_params(Query *query, const Value params[]);
 
   void log_err(const char *info);
 
-  const char *number_to_str(int number);
+  char *number_to_str(Arena *arena, int number);
 
 #ifdef __cplusplus
 }
@@ -26,6 +26,8 @@ See the Mulan PSL v2 for more details. */
 #include "event/sql_event.h"
 #include "sql/parser/parse.h"
 #include "event/execution_plan_event.h"
+#include "net/connection_context.h"
+#include "session/session.h"
 
 using namespace common;
 
@@ -80,6 +82,7 @@ void ParseStage::cleanup() {
 void ParseStage::handle_event(StageEvent *event) {
   LOG_TRACE("Enter\n");
 
+  static_cast<SQLStageEvent *>(event)->session_event()->query_trace().enter_stage("parse");
   StageEvent *new_event = handle_request(event);
   if (nullptr == new_event) {
     callback_event(event, nullptr);
@@ -103,8 +106,9 @@ void ParseStage::handle_event(StageEvent *event) {
 
 void ParseStage::callback_event(StageEvent *event, CallbackContext *context) {
   LOG_TRACE("Enter\n");
+  // 回到query cache stage，由它结束session event
   SQLStageEvent *sql_event = static_cast<SQLStageEvent *>(event);
-  sql_event->session_event()->done_immediate();
+  sql_event->done_immediate();
   LOG_TRACE("Exit\n");
   return;
 }
@@ -131,5 +135,55 @@ StageEvent *ParseStage::handle_request(StageEvent *event) {
     return nullptr;
   }
 
+  switch (result->flag) {
+  case SCF_PREPARE:
+  case SCF_EXECUTE:
+  case SCF_DEALLOCATE:
+    return handle_prepared_statement(sql_event, result);
+  default:
+    break;
+  }
   return new ExecutionPlanEvent(sql_event, result);
 }
+
+/**
+ * 预编译语句保存在session中。EXECUTE不再解析原来的语句，
+ * 复制一份保存的Query，把参数替换成USING后面的值，再交给后面的stage执行
+ */
+StageEvent *ParseStage::handle_prepared_statement(SQLStageEvent *sql_event, Query *result) {
+  SessionEvent *session_event = sql_event->session_event();
+  Session *session = session_event->get_client()->session;
+
+  if (result->flag == SCF_PREPARE) {
+    session->add_prepared_statement(result);
+    session_event->set_response("SUCCESS\n");
+    return nullptr;
+  }
+
+  if (result->flag == SCF_DEALLOCATE) {
+    bool removed = session->remove_prepared_statement(result->sstr.deallocate.stmt_name);
+    session_event->set_response(removed ? "SUCCESS\n" : "FAILURE\n");
+    query_destroy(result);
+    return nullptr;
+  }
+
+  const Execute &execute = result->sstr.execute;
+  const Prepare *prepare = session->find_prepared_statement(execute.stmt_name);
+  if (prepare == nullptr || prepare->param_num != execute.value_num) {
+    LOG_WARN("Cannot execute prepared statement %s. value num=%d", execute.stmt_name, (int)execute.value_num);
+    session_event->set_response("FAILURE\n");
+    query_destroy(result);
+    return nullptr;
+  }
+
+  Query *query = query_create();
+  if (nullptr == query) {
+    LOG_ERROR("Failed to create query.");
+    query_destroy(result);
+    return nullptr;
+  }
+  query_copy(query, prepare->query);
+  query_bind_params(query, execute.values);
+  query_destroy(result);
+  return new ExecutionPlanEvent(sql_event, query);
+}
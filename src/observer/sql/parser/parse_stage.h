@@ -17,6 +17,9 @@ See the Mulan PSL v2 for more details. */
 
 #include "common/seda/stage.h"
 
+class SQLStageEvent;
+struct Query;
+
 class ParseStage : public common::Stage {
 public:
   ~ParseStage();
@@ -35,6 +38,7 @@ protected:
 
 protected:
   common::StageEvent *handle_request(common::StageEvent *event);
+  common::StageEvent *handle_prepared_statement(SQLStageEvent *sql_event, Query *result);
 private:
   Stage *optimize_stage_ = nullptr;
 };
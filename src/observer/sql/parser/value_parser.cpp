@@ -0,0 +1,73 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Conversion from text to values shared by INSERT and LOAD DATA.
+//
+
+#include "sql/parser/value_parser.h"
+
+#include <string.h>
+
+#include "common/lang/string.h"
+#include "common/time/datetime.h"
+
+bool parse_date_value(std::string_view text, int *days)
+{
+  // parse_date需要以'\0'结尾的字符串
+  char date[DATE_STRING_LEN + 1];
+  if (text.size() > DATE_STRING_LEN) {
+    return false;
+  }
+  memcpy(date, text.data(), text.size());
+  date[text.size()] = '\0';
+  return common::parse_date(date, days) && *days >= DATE_MIN_DAYS && *days <= DATE_MAX_DAYS;
+}
+
+RC parse_value(AttrType type, std::string_view text, ValueBuffer &buffer, Value &value)
+{
+  bool parsed = true;
+  switch (type) {
+    case INTS: {
+      parsed = common::str_to_int(text, buffer.int_value);
+      value.data = &buffer.int_value;
+    } break;
+    case FLOATS: {
+      parsed = common::str_to_float(text, buffer.float_value);
+      value.data = &buffer.float_value;
+    } break;
+    case DATES: {
+      parsed = parse_date_value(text, &buffer.int_value);
+      value.data = &buffer.int_value;
+    } break;
+    case CHARS: {
+      buffer.chars.assign(text.data(), text.size());
+      value.data = (void *)buffer.chars.c_str();
+    } break;
+    default: {
+      parsed = false;
+    } break;
+  }
+  if (!parsed) {
+    value.data = nullptr;
+    return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+  }
+  value.type = type;
+  value.is_null = 0;
+  return RC::SUCCESS;
+}
+
+void parse_string_value(std::string_view text, ValueBuffer &buffer, Value &value)
+{
+  if (parse_value(DATES, text, buffer, value) != RC::SUCCESS) {
+    // 不是日期格式或者不是有效日期的字符串都当作CHARS，插入时再和字段的类型比较
+    parse_value(CHARS, text, buffer, value);
+  }
+}
@@ -0,0 +1,53 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Conversion from text to values shared by INSERT and LOAD DATA.
+//
+
+#ifndef __OBSERVER_SQL_PARSER_VALUE_PARSER_H__
+#define __OBSERVER_SQL_PARSER_VALUE_PARSER_H__
+
+#include <string>
+#include <string_view>
+
+#include "rc.h"
+#include "sql/parser/parse_defs.h"
+
+// 有效的日期是1970-01-01到2038-01-31，保存成从1970-01-01开始的天数
+#define DATE_MIN_DAYS 0
+#define DATE_MAX_DAYS 24867
+
+/**
+ * 解析出来的值的数据，Value的data指向这里。可以重复使用，chars的容量够用之后不再申请内存
+ */
+struct ValueBuffer {
+  int int_value = 0;
+  float float_value = 0;
+  std::string chars;
+};
+
+/**
+ * 解析yyyy-mm-dd格式的日期，不是有效的日期或者超出DATE_MIN_DAYS到DATE_MAX_DAYS的范围时返回false
+ */
+bool parse_date_value(std::string_view text, int *days);
+
+/**
+ * 把文本解析成type类型的值，value的data指向buffer。整数和浮点数用std::from_chars解析，
+ * 整个文本都必须是数字，不能有多余的字符，也不能超出范围。格式不对时返回RC::SCHEMA_FIELD_TYPE_MISMATCH
+ */
+RC parse_value(AttrType type, std::string_view text, ValueBuffer &buffer, Value &value);
+
+/**
+ * 把SQL中的字符串常量(不带引号)转换成值，和解析时一样，是有效日期的转换成DATES，否则是CHARS
+ */
+void parse_string_value(std::string_view text, ValueBuffer &buffer, Value &value);
+
+#endif // __OBSERVER_SQL_PARSER_VALUE_PARSER_H__
@@ -1,8 +1,8 @@
-/* A Bison parser, made by GNU Bison 3.5.1.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
 /* Bison implementation for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2020 Free Software Foundation,
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
    Inc.
 
    This program is free software: you can redistribute it and/or modify
@@ -16,7 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -34,6 +34,10 @@
 /* C LALR(1) parser skeleton written by Richard Stallman, by
    simplifying the original so-called "semantic" parser.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 /* All symbols defined below should begin with yy or YY, to avoid
    infringing on user name space.  This should be done even for local
    variables, as they might otherwise be expanded by user macros.
@@ -41,14 +45,11 @@
    define necessary library symbols; they are noted "INFRINGES ON
    USER NAME SPACE" below.  */
 
-/* Undocumented macros, especially those whose name start with YY_,
-   are private implementation details.  Do not rely on them.  */
-
-/* Identify Bison output.  */
-#define YYBISON 1
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
 
-/* Bison version.  */
-#define YYBISON_VERSION "3.5.1"
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
 
 /* Skeleton name.  */
 #define YYSKELETON_NAME "yacc.c"
@@ -77,6 +78,7 @@
 #include<stdio.h>
 #include<stdlib.h>
 #include<string.h>
+#include<strings.h>
 
 typedef struct ParserContext {
   Query * ssql;
@@ -89,22 +91,33 @@ typedef struct ParserContext {
   Condition conditions[MAX_NUM];
   CompOp comp;
 	char id[MAX_NUM];
+  Selects *sub_selects[MAX_NUM];        // 正在解析的子查询，最后一个是最内层的
+  size_t sub_condition_starts[MAX_NUM]; // 每个子查询的条件在conditions中开始的位置
+  size_t sub_select_depth;
+  size_t param_num;                     // 预编译语句中参数?的个数
+  ExprCondition expr_conditions[MAX_NUM];        // 带表达式的条件，和conditions一样按子查询分段
+  size_t expr_condition_length;
+  size_t sub_expr_condition_starts[MAX_NUM];
+  int last_token;                       // 词法分析返回的上一个token
 } ParserContext;
 
-//获取子串
-char *substr(const char *s,int n1,int n2)/*从s中提取下标为n1~n2的字符组成一个新字符串，然后返回这个新串的首地址*/
+// 词法分析得到的标识符和字符串也放在语句的arena中，在lex_sql.l中使用
+char *context_strdup(void *context, const char *s)
 {
-  // printf("start call substr on s %s with n1 is %d and n2 is %d \n",s,n1,n2);
-  char *sp = malloc(sizeof(char) * (n2 - n1 + 2));
-  int i, j = 0;
-  
-  // printf("now the substr is going \n");
-  for (i = n1; i <= n2; i++) {
-    sp[j++] = s[i];
-  }
-  sp[j] = 0;
-  // printf("now the substr end and new string is %s \n",sp);
-  return sp;
+  return arena_strdup(&((ParserContext *)context)->ssql->arena, s);
+}
+
+// 词法分析器返回token时记录下来。a -1中的-1前面是字段，这时-是减号，不是负数的一部分
+int context_token(void *context, int token)
+{
+  ((ParserContext *)context)->last_token = token;
+  return token;
+}
+
+int context_after_operand(void *context)
+{
+  const int token = ((ParserContext *)context)->last_token;
+  return token == ID || token == NUMBER || token == FLOAT || token == SSS || token == RBRACE || token == '?';
 }
 
 void yyerror(yyscan_t scanner, const char *str)
@@ -118,10 +131,10 @@ void yyerror(yyscan_t scanner, const char *str)
   context->select_length = 0;
   context->value_length = 0;
   context->insert_index = 0;
-  for (size_t i = 0; i < MAX_NUM; i++) {
-  	context->ssql->sstr.insertion.value_num[i] = 0;
-  }
-  context->ssql->sstr.insertion.group_num = 0;
+  // 子查询也在语句的arena中，已经随着query_reset释放
+  context->sub_select_depth = 0;
+  context->param_num = 0;
+  context->expr_condition_length = 0;
   printf("parse sql failed. error=%s", str);
 }
 
@@ -131,9 +144,60 @@ ParserContext *get_context(yyscan_t scanner)
 }
 
 #define CONTEXT get_context(scanner)
+#define ARENA (&CONTEXT->ssql->arena)
+
+// select的列、表和条件加入正在解析的最内层的子查询，不在子查询中时加入外层的select
+Selects *current_selects(ParserContext *context)
+{
+  if (context->sub_select_depth > 0) {
+    return context->sub_selects[context->sub_select_depth - 1];
+  }
+  return &context->ssql->sstr.selection;
+}
+
+static int expr_is_simple(const Expr *expr)
+{
+  return expr == NULL || expr->type == EXPR_ATTR || expr->type == EXPR_VALUE;
+}
+
+/**
+ * where中的比较。两侧都是字段或者常量时还是普通的条件，可以下推到扫描、使用索引，
+ * 否则放进带表达式的条件，right为NULL时是is null和is not null
+ */
+int context_add_condition(ParserContext *context, CompOp comp, Expr *left, Expr *right)
+{
+  Arena *arena = &context->ssql->arena;
+  if (expr_is_simple(left) && expr_is_simple(right)) {
+    if (context->condition_length >= MAX_NUM) {
+      return 0;
+    }
+    Value null_value;
+    Value *right_value = NULL;
+    if (right == NULL) {
+      value_init_string(arena, &null_value, "NULL", true);
+      right_value = &null_value;
+    } else if (right->type == EXPR_VALUE) {
+      right_value = &right->value;
+    }
+    Condition condition;
+    memset(&condition, 0, sizeof(condition));
+    condition_init(&condition, comp, left->type == EXPR_ATTR, &left->attr, &left->value,
+        right != NULL && right->type == EXPR_ATTR, right != NULL ? &right->attr : NULL, right_value);
+    context->conditions[context->condition_length++] = condition;
+    return 1;
+  }
+  if (context->expr_condition_length >= MAX_NUM) {
+    return 0;
+  }
+  ExprCondition *condition = &context->expr_conditions[context->expr_condition_length++];
+  condition->comp = comp;
+  condition->left = left;
+  condition->right = right;
+  return 1;
+}
 
 
-#line 137 "yacc_sql.tab.c"
+#line 201 "yacc_sql.tab.c"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -156,123 +220,198 @@ ParserContext *get_context(yyscan_t scanner)
 #  endif
 # endif
 
-/* Enabling verbose error messages.  */
-#ifdef YYERROR_VERBOSE
-# undef YYERROR_VERBOSE
-# define YYERROR_VERBOSE 1
-#else
-# define YYERROR_VERBOSE 0
-#endif
-
-/* Use api.header.include to #include this header
-   instead of duplicating it here.  */
-#ifndef YY_YY_YACC_SQL_TAB_H_INCLUDED
-# define YY_YY_YACC_SQL_TAB_H_INCLUDED
-/* Debug traces.  */
-#ifndef YYDEBUG
-# define YYDEBUG 0
-#endif
-#if YYDEBUG
-extern int yydebug;
-#endif
-
-/* Token type.  */
-#ifndef YYTOKENTYPE
-# define YYTOKENTYPE
-  enum yytokentype
-  {
-    SEMICOLON = 258,
-    CREATE = 259,
-    DROP = 260,
-    TABLE = 261,
-    TABLES = 262,
-    INDEX = 263,
-    SELECT = 264,
-    DESC = 265,
-    SHOW = 266,
-    SYNC = 267,
-    INSERT = 268,
-    DELETE = 269,
-    UPDATE = 270,
-    LBRACE = 271,
-    RBRACE = 272,
-    COMMA = 273,
-    TRX_BEGIN = 274,
-    TRX_COMMIT = 275,
-    TRX_ROLLBACK = 276,
-    INT_T = 277,
-    STRING_T = 278,
-    FLOAT_T = 279,
-    ORDER = 280,
-    ASC = 281,
-    BY = 282,
-    DATE_T = 283,
-    HELP = 284,
-    EXIT = 285,
-    DOT = 286,
-    INTO = 287,
-    VALUES = 288,
-    FROM = 289,
-    WHERE = 290,
-    AND = 291,
-    SET = 292,
-    ON = 293,
-    LOAD = 294,
-    DATA = 295,
-    INFILE = 296,
-    NULLABLE = 297,
-    GROUP = 298,
-    IS = 299,
-    NOT = 300,
-    EQ = 301,
-    LT = 302,
-    GT = 303,
-    LE = 304,
-    GE = 305,
-    NE = 306,
-    NULL_T = 307,
-    INNER = 308,
-    JOIN = 309,
-    NUMBER = 310,
-    FLOAT = 311,
-    ID = 312,
-    PATH = 313,
-    SSS = 314,
-    STAR = 315,
-    STRING_V = 316,
-    COUNT = 317,
-    OTHER_FUNCTION_TYPE = 318
-  };
-#endif
-
-/* Value type.  */
-#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-union YYSTYPE
+#include "yacc_sql.tab.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
 {
-#line 127 "yacc_sql.y"
-
-  struct _Attr *attr;
-  struct _Condition *condition1;
-  struct _Value *value1;
-  char *string;
-  //char *date;
-  int number;
-  float floats;
-  char *position;
-
-#line 264 "yacc_sql.tab.c"
-
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_SEMICOLON = 3,                  /* SEMICOLON  */
+  YYSYMBOL_CREATE = 4,                     /* CREATE  */
+  YYSYMBOL_DROP = 5,                       /* DROP  */
+  YYSYMBOL_TABLE = 6,                      /* TABLE  */
+  YYSYMBOL_TABLES = 7,                     /* TABLES  */
+  YYSYMBOL_INDEX = 8,                      /* INDEX  */
+  YYSYMBOL_SELECT = 9,                     /* SELECT  */
+  YYSYMBOL_DESC = 10,                      /* DESC  */
+  YYSYMBOL_SHOW = 11,                      /* SHOW  */
+  YYSYMBOL_SYNC = 12,                      /* SYNC  */
+  YYSYMBOL_INSERT = 13,                    /* INSERT  */
+  YYSYMBOL_DELETE = 14,                    /* DELETE  */
+  YYSYMBOL_UPDATE = 15,                    /* UPDATE  */
+  YYSYMBOL_LBRACE = 16,                    /* LBRACE  */
+  YYSYMBOL_RBRACE = 17,                    /* RBRACE  */
+  YYSYMBOL_COMMA = 18,                     /* COMMA  */
+  YYSYMBOL_TRX_BEGIN = 19,                 /* TRX_BEGIN  */
+  YYSYMBOL_TRX_COMMIT = 20,                /* TRX_COMMIT  */
+  YYSYMBOL_TRX_ROLLBACK = 21,              /* TRX_ROLLBACK  */
+  YYSYMBOL_INT_T = 22,                     /* INT_T  */
+  YYSYMBOL_STRING_T = 23,                  /* STRING_T  */
+  YYSYMBOL_FLOAT_T = 24,                   /* FLOAT_T  */
+  YYSYMBOL_ORDER = 25,                     /* ORDER  */
+  YYSYMBOL_ASC = 26,                       /* ASC  */
+  YYSYMBOL_BY = 27,                        /* BY  */
+  YYSYMBOL_DATE_T = 28,                    /* DATE_T  */
+  YYSYMBOL_HELP = 29,                      /* HELP  */
+  YYSYMBOL_EXIT = 30,                      /* EXIT  */
+  YYSYMBOL_DOT = 31,                       /* DOT  */
+  YYSYMBOL_INTO = 32,                      /* INTO  */
+  YYSYMBOL_VALUES = 33,                    /* VALUES  */
+  YYSYMBOL_FROM = 34,                      /* FROM  */
+  YYSYMBOL_WHERE = 35,                     /* WHERE  */
+  YYSYMBOL_AND = 36,                       /* AND  */
+  YYSYMBOL_SET = 37,                       /* SET  */
+  YYSYMBOL_ON = 38,                        /* ON  */
+  YYSYMBOL_LOAD = 39,                      /* LOAD  */
+  YYSYMBOL_DATA = 40,                      /* DATA  */
+  YYSYMBOL_INFILE = 41,                    /* INFILE  */
+  YYSYMBOL_NULLABLE = 42,                  /* NULLABLE  */
+  YYSYMBOL_GROUP = 43,                     /* GROUP  */
+  YYSYMBOL_IS = 44,                        /* IS  */
+  YYSYMBOL_NOT = 45,                       /* NOT  */
+  YYSYMBOL_EQ = 46,                        /* EQ  */
+  YYSYMBOL_LT = 47,                        /* LT  */
+  YYSYMBOL_GT = 48,                        /* GT  */
+  YYSYMBOL_LE = 49,                        /* LE  */
+  YYSYMBOL_GE = 50,                        /* GE  */
+  YYSYMBOL_NE = 51,                        /* NE  */
+  YYSYMBOL_NULL_T = 52,                    /* NULL_T  */
+  YYSYMBOL_INNER = 53,                     /* INNER  */
+  YYSYMBOL_JOIN = 54,                      /* JOIN  */
+  YYSYMBOL_LIMIT = 55,                     /* LIMIT  */
+  YYSYMBOL_OFFSET = 56,                    /* OFFSET  */
+  YYSYMBOL_IN = 57,                        /* IN  */
+  YYSYMBOL_EXISTS = 58,                    /* EXISTS  */
+  YYSYMBOL_LIKE = 59,                      /* LIKE  */
+  YYSYMBOL_PREPARE = 60,                   /* PREPARE  */
+  YYSYMBOL_EXECUTE = 61,                   /* EXECUTE  */
+  YYSYMBOL_DEALLOCATE = 62,                /* DEALLOCATE  */
+  YYSYMBOL_USING = 63,                     /* USING  */
+  YYSYMBOL_SAVEPOINT = 64,                 /* SAVEPOINT  */
+  YYSYMBOL_RELEASE = 65,                   /* RELEASE  */
+  YYSYMBOL_TO = 66,                        /* TO  */
+  YYSYMBOL_PARTITION = 67,                 /* PARTITION  */
+  YYSYMBOL_ALTER = 68,                     /* ALTER  */
+  YYSYMBOL_TRUNCATE = 69,                  /* TRUNCATE  */
+  YYSYMBOL_ANALYZE = 70,                   /* ANALYZE  */
+  YYSYMBOL_EXPLAIN = 71,                   /* EXPLAIN  */
+  YYSYMBOL_DISTINCT = 72,                  /* DISTINCT  */
+  YYSYMBOL_OVER = 73,                      /* OVER  */
+  YYSYMBOL_74_ = 74,                       /* '+'  */
+  YYSYMBOL_75_ = 75,                       /* '-'  */
+  YYSYMBOL_76_ = 76,                       /* '/'  */
+  YYSYMBOL_UMINUS = 77,                    /* UMINUS  */
+  YYSYMBOL_NUMBER = 78,                    /* NUMBER  */
+  YYSYMBOL_FLOAT = 79,                     /* FLOAT  */
+  YYSYMBOL_ID = 80,                        /* ID  */
+  YYSYMBOL_PATH = 81,                      /* PATH  */
+  YYSYMBOL_SSS = 82,                       /* SSS  */
+  YYSYMBOL_STAR = 83,                      /* STAR  */
+  YYSYMBOL_STRING_V = 84,                  /* STRING_V  */
+  YYSYMBOL_COUNT = 85,                     /* COUNT  */
+  YYSYMBOL_OTHER_FUNCTION_TYPE = 86,       /* OTHER_FUNCTION_TYPE  */
+  YYSYMBOL_87_ = 87,                       /* '?'  */
+  YYSYMBOL_YYACCEPT = 88,                  /* $accept  */
+  YYSYMBOL_commands = 89,                  /* commands  */
+  YYSYMBOL_command = 90,                   /* command  */
+  YYSYMBOL_prepare = 91,                   /* prepare  */
+  YYSYMBOL_prepared_command = 92,          /* prepared_command  */
+  YYSYMBOL_execute = 93,                   /* execute  */
+  YYSYMBOL_deallocate = 94,                /* deallocate  */
+  YYSYMBOL_exit = 95,                      /* exit  */
+  YYSYMBOL_help = 96,                      /* help  */
+  YYSYMBOL_sync = 97,                      /* sync  */
+  YYSYMBOL_begin = 98,                     /* begin  */
+  YYSYMBOL_commit = 99,                    /* commit  */
+  YYSYMBOL_rollback = 100,                 /* rollback  */
+  YYSYMBOL_savepoint = 101,                /* savepoint  */
+  YYSYMBOL_rollback_to_savepoint = 102,    /* rollback_to_savepoint  */
+  YYSYMBOL_release_savepoint = 103,        /* release_savepoint  */
+  YYSYMBOL_set_variable = 104,             /* set_variable  */
+  YYSYMBOL_drop_table = 105,               /* drop_table  */
+  YYSYMBOL_create_view = 106,              /* create_view  */
+  YYSYMBOL_drop_view = 107,                /* drop_view  */
+  YYSYMBOL_truncate_table = 108,           /* truncate_table  */
+  YYSYMBOL_analyze_table = 109,            /* analyze_table  */
+  YYSYMBOL_alter_table = 110,              /* alter_table  */
+  YYSYMBOL_show_tables = 111,              /* show_tables  */
+  YYSYMBOL_show_buffer_pool = 112,         /* show_buffer_pool  */
+  YYSYMBOL_show_statement_stats = 113,     /* show_statement_stats  */
+  YYSYMBOL_reset_statement_stats = 114,    /* reset_statement_stats  */
+  YYSYMBOL_show_processlist = 115,         /* show_processlist  */
+  YYSYMBOL_kill_query = 116,               /* kill_query  */
+  YYSYMBOL_desc_table = 117,               /* desc_table  */
+  YYSYMBOL_create_index = 118,             /* create_index  */
+  YYSYMBOL_opt_index_using = 119,          /* opt_index_using  */
+  YYSYMBOL_index_attr_list = 120,          /* index_attr_list  */
+  YYSYMBOL_index_attr = 121,               /* index_attr  */
+  YYSYMBOL_drop_index = 122,               /* drop_index  */
+  YYSYMBOL_create_table = 123,             /* create_table  */
+  YYSYMBOL_table_option_list = 124,        /* table_option_list  */
+  YYSYMBOL_table_option = 125,             /* table_option  */
+  YYSYMBOL_opt_partition = 126,            /* opt_partition  */
+  YYSYMBOL_range_partition_list = 127,     /* range_partition_list  */
+  YYSYMBOL_range_partition = 128,          /* range_partition  */
+  YYSYMBOL_attr_def_list = 129,            /* attr_def_list  */
+  YYSYMBOL_primary_key = 130,              /* primary_key  */
+  YYSYMBOL_primary_key_attr_list = 131,    /* primary_key_attr_list  */
+  YYSYMBOL_primary_key_attr = 132,         /* primary_key_attr  */
+  YYSYMBOL_attr_def = 133,                 /* attr_def  */
+  YYSYMBOL_opt_null = 134,                 /* opt_null  */
+  YYSYMBOL_number = 135,                   /* number  */
+  YYSYMBOL_type = 136,                     /* type  */
+  YYSYMBOL_ID_get = 137,                   /* ID_get  */
+  YYSYMBOL_insert = 138,                   /* insert  */
+  YYSYMBOL_multi_values = 139,             /* multi_values  */
+  YYSYMBOL_value_list = 140,               /* value_list  */
+  YYSYMBOL_value = 141,                    /* value  */
+  YYSYMBOL_delete = 142,                   /* delete  */
+  YYSYMBOL_update = 143,                   /* update  */
+  YYSYMBOL_explain = 144,                  /* explain  */
+  YYSYMBOL_select = 145,                   /* select  */
+  YYSYMBOL_opt_outfile = 146,              /* opt_outfile  */
+  YYSYMBOL_opt_distinct = 147,             /* opt_distinct  */
+  YYSYMBOL_select_attr = 148,              /* select_attr  */
+  YYSYMBOL_attr_list = 149,                /* attr_list  */
+  YYSYMBOL_select_item = 150,              /* select_item  */
+  YYSYMBOL_join_list = 151,                /* join_list  */
+  YYSYMBOL_window_function = 152,          /* window_function  */
+  YYSYMBOL_window_call = 153,              /* window_call  */
+  YYSYMBOL_window_spec = 154,              /* window_spec  */
+  YYSYMBOL_window_partition = 155,         /* window_partition  */
+  YYSYMBOL_window_order = 156,             /* window_order  */
+  YYSYMBOL_window_attr = 157,              /* window_attr  */
+  YYSYMBOL_window_sort_attr = 158,         /* window_sort_attr  */
+  YYSYMBOL_opt_star = 159,                 /* opt_star  */
+  YYSYMBOL_expr = 160,                     /* expr  */
+  YYSYMBOL_func_call = 161,                /* func_call  */
+  YYSYMBOL_func_args = 162,                /* func_args  */
+  YYSYMBOL_rel_list = 163,                 /* rel_list  */
+  YYSYMBOL_where = 164,                    /* where  */
+  YYSYMBOL_on = 165,                       /* on  */
+  YYSYMBOL_condition_list = 166,           /* condition_list  */
+  YYSYMBOL_condition = 167,                /* condition  */
+  YYSYMBOL_sub_select = 168,               /* sub_select  */
+  YYSYMBOL_169_1 = 169,                    /* $@1  */
+  YYSYMBOL_comOp = 170,                    /* comOp  */
+  YYSYMBOL_group_by = 171,                 /* group_by  */
+  YYSYMBOL_group_list = 172,               /* group_list  */
+  YYSYMBOL_group_attr = 173,               /* group_attr  */
+  YYSYMBOL_order_by = 174,                 /* order_by  */
+  YYSYMBOL_sort_list = 175,                /* sort_list  */
+  YYSYMBOL_sort_attr = 176,                /* sort_attr  */
+  YYSYMBOL_opt_asc = 177,                  /* opt_asc  */
+  YYSYMBOL_limit = 178,                    /* limit  */
+  YYSYMBOL_load_data = 179,                /* load_data  */
+  YYSYMBOL_backup = 180,                   /* backup  */
+  YYSYMBOL_declare_cursor = 181,           /* declare_cursor  */
+  YYSYMBOL_fetch = 182,                    /* fetch  */
+  YYSYMBOL_close_cursor = 183              /* close_cursor  */
 };
-typedef union YYSTYPE YYSTYPE;
-# define YYSTYPE_IS_TRIVIAL 1
-# define YYSTYPE_IS_DECLARED 1
-#endif
-
-
+typedef enum yysymbol_kind_t yysymbol_kind_t;
 
-int yyparse (void *scanner);
-
-#endif /* !YY_YY_YACC_SQL_TAB_H_INCLUDED  */
 
 
 
@@ -313,6 +452,18 @@ typedef int_least16_t yytype_int16;
 typedef short yytype_int16;
 #endif
 
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
+#endif
+
 #if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
 typedef __UINT_LEAST8_TYPE__ yytype_uint8;
 #elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
@@ -372,8 +523,9 @@ typedef int yytype_uint16;
 
 #define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
 
+
 /* Stored state numbers (used for stacks). */
-typedef yytype_uint8 yy_state_t;
+typedef yytype_int16 yy_state_t;
 
 /* State numbers in computations.  */
 typedef int yy_state_fast_t;
@@ -390,6 +542,7 @@ typedef int yy_state_fast_t;
 # endif
 #endif
 
+
 #ifndef YY_ATTRIBUTE_PURE
 # if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
 #  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
@@ -408,17 +561,23 @@ typedef int yy_state_fast_t;
 
 /* Suppress unused-variable warnings by "using" E.  */
 #if ! defined lint || defined __GNUC__
-# define YYUSE(E) ((void) (E))
+# define YY_USE(E) ((void) (E))
 #else
-# define YYUSE(E) /* empty */
+# define YY_USE(E) /* empty */
 #endif
 
-#if defined __GNUC__ && ! defined __ICC && 407 <= __GNUC__ * 100 + __GNUC_MINOR__
 /* Suppress an incorrect diagnostic about yylval being uninitialized.  */
-# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                            \
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
     _Pragma ("GCC diagnostic push")                                     \
     _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
     _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+# endif
 # define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
     _Pragma ("GCC diagnostic pop")
 #else
@@ -447,7 +606,7 @@ typedef int yy_state_fast_t;
 
 #define YY_ASSERT(E) ((void) (0 && (E)))
 
-#if ! defined yyoverflow || YYERROR_VERBOSE
+#if !defined yyoverflow
 
 /* The parser invokes alloca or malloc; define the necessary symbols.  */
 
@@ -512,8 +671,7 @@ void free (void *); /* INFRINGES ON USER NAME SPACE */
 #   endif
 #  endif
 # endif
-#endif /* ! defined yyoverflow || YYERROR_VERBOSE */
-
+#endif /* !defined yyoverflow */
 
 #if (! defined yyoverflow \
      && (! defined __cplusplus \
@@ -578,25 +736,27 @@ union yyalloc
 /* YYFINAL -- State number of the termination state.  */
 #define YYFINAL  2
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   261
+#define YYLAST   496
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  64
+#define YYNTOKENS  88
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  48
+#define YYNNTS  96
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  123
+#define YYNRULES  240
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  252
+#define YYNSTATES  503
 
-#define YYUNDEFTOK  2
-#define YYMAXUTOK   318
+/* YYMAXUTOK -- Last valid token kind.  */
+#define YYMAXUTOK   338
 
 
 /* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
    as returned by yylex, with out-of-bounds checking.  */
-#define YYTRANSLATE(YYX)                                                \
-  (0 <= (YYX) && (YYX) <= YYMAXUTOK ? yytranslate[YYX] : YYUNDEFTOK)
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
 
 /* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
    as returned by yylex.  */
@@ -606,9 +766,9 @@ static const yytype_int8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,    74,     2,    75,     2,    76,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,    87,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
@@ -633,306 +793,490 @@ static const yytype_int8 yytranslate[] =
       25,    26,    27,    28,    29,    30,    31,    32,    33,    34,
       35,    36,    37,    38,    39,    40,    41,    42,    43,    44,
       45,    46,    47,    48,    49,    50,    51,    52,    53,    54,
-      55,    56,    57,    58,    59,    60,    61,    62,    63
+      55,    56,    57,    58,    59,    60,    61,    62,    63,    64,
+      65,    66,    67,    68,    69,    70,    71,    72,    73,    77,
+      78,    79,    80,    81,    82,    83,    84,    85,    86
 };
 
 #if YYDEBUG
-  /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_int16 yyrline[] =
 {
-       0,   159,   159,   161,   165,   166,   167,   168,   169,   170,
-     171,   172,   173,   174,   175,   176,   177,   178,   179,   180,
-     181,   185,   190,   195,   201,   207,   213,   219,   225,   231,
-     238,   246,   253,   262,   264,   268,   279,   293,   296,   299,
-     305,   308,   312,   316,   320,   326,   335,   352,   359,   367,
-     369,   374,   377,   380,   384,   392,   402,   412,   432,   437,
-     442,   447,   452,   456,   458,   465,   472,   481,   483,   489,
-     495,   501,   507,   513,   519,   525,   533,   534,   536,   538,
-     542,   544,   548,   550,   555,   557,   562,   564,   569,   591,
-     611,   631,   653,   675,   696,   715,   727,   739,   750,   761,
-     770,   782,   783,   784,   785,   786,   787,   790,   792,   798,
-     801,   805,   810,   817,   819,   824,   827,   830,   835,   840,
-     845,   851,   853,   856
+       0,   261,   261,   263,   267,   268,   269,   270,   271,   272,
+     273,   274,   275,   276,   277,   278,   279,   280,   281,   282,
+     283,   284,   285,   286,   287,   288,   289,   290,   291,   292,
+     293,   294,   295,   296,   297,   298,   299,   300,   301,   302,
+     303,   304,   305,   309,   316,   317,   318,   319,   323,   327,
+     335,   342,   347,   352,   358,   364,   370,   376,   383,   387,
+     394,   401,   405,   409,   416,   422,   433,   445,   451,   457,
+     465,   471,   482,   492,   502,   512,   524,   531,   536,   547,
+     549,   566,   567,   570,   578,   593,   600,   609,   611,   614,
+     622,   647,   649,   657,   671,   673,   676,   689,   702,   704,
+     705,   708,   717,   718,   721,   731,   742,   756,   759,   762,
+     768,   771,   775,   779,   783,   789,   798,   815,   822,   830,
+     832,   837,   840,   843,   847,   852,   860,   874,   888,   891,
+     897,   918,   920,   929,   931,   936,   941,   946,   948,   953,
+     963,   967,   972,   974,   980,   985,   990,   995,  1000,  1006,
+    1012,  1017,  1022,  1027,  1033,  1038,  1054,  1059,  1064,  1069,
+    1076,  1077,  1081,  1084,  1089,  1096,  1101,  1108,  1113,  1120,
+    1121,  1128,  1129,  1132,  1133,  1134,  1135,  1136,  1150,  1151,
+    1152,  1153,  1159,  1165,  1171,  1178,  1184,  1187,  1188,  1195,
+    1200,  1209,  1211,  1215,  1217,  1222,  1224,  1229,  1231,  1236,
+    1243,  1250,  1257,  1264,  1271,  1281,  1290,  1295,  1303,  1303,
+    1332,  1333,  1334,  1335,  1336,  1337,  1340,  1342,  1348,  1351,
+    1355,  1360,  1367,  1369,  1374,  1377,  1380,  1385,  1390,  1395,
+    1401,  1403,  1405,  1407,  1410,  1413,  1419,  1426,  1437,  1447,
+    1458
 };
 #endif
 
-#if YYDEBUG || YYERROR_VERBOSE || 0
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
+
+#if YYDEBUG || 0
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
+
 /* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
    First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
 static const char *const yytname[] =
 {
-  "$end", "error", "$undefined", "SEMICOLON", "CREATE", "DROP", "TABLE",
-  "TABLES", "INDEX", "SELECT", "DESC", "SHOW", "SYNC", "INSERT", "DELETE",
-  "UPDATE", "LBRACE", "RBRACE", "COMMA", "TRX_BEGIN", "TRX_COMMIT",
-  "TRX_ROLLBACK", "INT_T", "STRING_T", "FLOAT_T", "ORDER", "ASC", "BY",
-  "DATE_T", "HELP", "EXIT", "DOT", "INTO", "VALUES", "FROM", "WHERE",
-  "AND", "SET", "ON", "LOAD", "DATA", "INFILE", "NULLABLE", "GROUP", "IS",
-  "NOT", "EQ", "LT", "GT", "LE", "GE", "NE", "NULL_T", "INNER", "JOIN",
-  "NUMBER", "FLOAT", "ID", "PATH", "SSS", "STAR", "STRING_V", "COUNT",
-  "OTHER_FUNCTION_TYPE", "$accept", "commands", "command", "exit", "help",
-  "sync", "begin", "commit", "rollback", "drop_table", "show_tables",
-  "desc_table", "create_index", "drop_index", "create_table",
-  "attr_def_list", "attr_def", "opt_null", "number", "type", "ID_get",
-  "insert", "multi_values", "value_list", "value", "delete", "update",
-  "select", "select_attr", "attr_list", "join_list", "window_function",
-  "opt_star", "function_list", "rel_list", "where", "on", "condition_list",
-  "condition", "comOp", "group_by", "group_list", "group_attr", "order_by",
-  "sort_list", "sort_attr", "opt_asc", "load_data", YY_NULLPTR
+  "\"end of file\"", "error", "\"invalid token\"", "SEMICOLON", "CREATE",
+  "DROP", "TABLE", "TABLES", "INDEX", "SELECT", "DESC", "SHOW", "SYNC",
+  "INSERT", "DELETE", "UPDATE", "LBRACE", "RBRACE", "COMMA", "TRX_BEGIN",
+  "TRX_COMMIT", "TRX_ROLLBACK", "INT_T", "STRING_T", "FLOAT_T", "ORDER",
+  "ASC", "BY", "DATE_T", "HELP", "EXIT", "DOT", "INTO", "VALUES", "FROM",
+  "WHERE", "AND", "SET", "ON", "LOAD", "DATA", "INFILE", "NULLABLE",
+  "GROUP", "IS", "NOT", "EQ", "LT", "GT", "LE", "GE", "NE", "NULL_T",
+  "INNER", "JOIN", "LIMIT", "OFFSET", "IN", "EXISTS", "LIKE", "PREPARE",
+  "EXECUTE", "DEALLOCATE", "USING", "SAVEPOINT", "RELEASE", "TO",
+  "PARTITION", "ALTER", "TRUNCATE", "ANALYZE", "EXPLAIN", "DISTINCT",
+  "OVER", "'+'", "'-'", "'/'", "UMINUS", "NUMBER", "FLOAT", "ID", "PATH",
+  "SSS", "STAR", "STRING_V", "COUNT", "OTHER_FUNCTION_TYPE", "'?'",
+  "$accept", "commands", "command", "prepare", "prepared_command",
+  "execute", "deallocate", "exit", "help", "sync", "begin", "commit",
+  "rollback", "savepoint", "rollback_to_savepoint", "release_savepoint",
+  "set_variable", "drop_table", "create_view", "drop_view",
+  "truncate_table", "analyze_table", "alter_table", "show_tables",
+  "show_buffer_pool", "show_statement_stats", "reset_statement_stats",
+  "show_processlist", "kill_query", "desc_table", "create_index",
+  "opt_index_using", "index_attr_list", "index_attr", "drop_index",
+  "create_table", "table_option_list", "table_option", "opt_partition",
+  "range_partition_list", "range_partition", "attr_def_list",
+  "primary_key", "primary_key_attr_list", "primary_key_attr", "attr_def",
+  "opt_null", "number", "type", "ID_get", "insert", "multi_values",
+  "value_list", "value", "delete", "update", "explain", "select",
+  "opt_outfile", "opt_distinct", "select_attr", "attr_list", "select_item",
+  "join_list", "window_function", "window_call", "window_spec",
+  "window_partition", "window_order", "window_attr", "window_sort_attr",
+  "opt_star", "expr", "func_call", "func_args", "rel_list", "where", "on",
+  "condition_list", "condition", "sub_select", "$@1", "comOp", "group_by",
+  "group_list", "group_attr", "order_by", "sort_list", "sort_attr",
+  "opt_asc", "limit", "load_data", "backup", "declare_cursor", "fetch",
+  "close_cursor", YY_NULLPTR
 };
-#endif
 
-# ifdef YYPRINT
-/* YYTOKNUM[NUM] -- (External) token number corresponding to the
-   (internal) symbol number NUM (which must be that of a token).  */
-static const yytype_int16 yytoknum[] =
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
 {
-       0,   256,   257,   258,   259,   260,   261,   262,   263,   264,
-     265,   266,   267,   268,   269,   270,   271,   272,   273,   274,
-     275,   276,   277,   278,   279,   280,   281,   282,   283,   284,
-     285,   286,   287,   288,   289,   290,   291,   292,   293,   294,
-     295,   296,   297,   298,   299,   300,   301,   302,   303,   304,
-     305,   306,   307,   308,   309,   310,   311,   312,   313,   314,
-     315,   316,   317,   318
-};
-# endif
+  return yytname[yysymbol];
+}
+#endif
 
-#define YYPACT_NINF (-181)
+#define YYPACT_NINF (-413)
 
 #define yypact_value_is_default(Yyn) \
   ((Yyn) == YYPACT_NINF)
 
-#define YYTABLE_NINF (-1)
+#define YYTABLE_NINF (-160)
 
 #define yytable_value_is_error(Yyn) \
   0
 
-  /* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
-     STATE-NUM.  */
+/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
+   STATE-NUM.  */
 static const yytype_int16 yypact[] =
 {
-    -181,     7,  -181,   115,   134,    62,   -43,    16,    64,    30,
-      56,    24,   114,   141,   142,   143,   144,    67,  -181,  -181,
-    -181,  -181,  -181,  -181,  -181,  -181,  -181,  -181,  -181,  -181,
-    -181,  -181,  -181,  -181,  -181,  -181,    80,    91,    92,    93,
-      37,  -181,   135,   136,   119,   137,   151,   153,  -181,   100,
-     101,   122,  -181,  -181,  -181,  -181,  -181,   120,   146,   125,
-     157,   161,   108,     4,  -181,    74,   109,   110,   -29,  -181,
-    -181,  -181,  -181,   138,   133,   112,   111,   100,   116,  -181,
-    -181,    40,   154,   154,  -181,     8,  -181,   158,    26,   156,
-     137,   160,    41,   174,   132,   147,   162,   104,   165,    32,
-    -181,  -181,  -181,  -181,    73,  -181,  -181,    78,   126,   129,
-    -181,    14,    38,  -181,  -181,  -181,     1,  -181,    28,   148,
-    -181,    14,   179,   100,   169,  -181,  -181,  -181,  -181,    -7,
-     130,   154,   154,   171,   172,   173,   175,   156,   139,   133,
-     176,  -181,   180,   140,    43,  -181,  -181,  -181,  -181,  -181,
-    -181,    47,    49,    53,    41,  -181,   133,   145,   162,   188,
-     149,  -181,   155,  -181,   178,  -181,  -181,  -181,  -181,  -181,
-    -181,  -181,   152,   163,    14,   181,    14,    36,   159,  -181,
-    -181,  -181,   164,  -181,   168,  -181,   148,   197,   198,  -181,
-    -181,  -181,   186,  -181,   202,   170,   183,   187,   176,  -181,
-     176,    68,    59,  -181,  -181,   166,  -181,  -181,  -181,    94,
-    -181,    41,   129,   167,   190,   210,  -181,   201,   177,  -181,
-     184,  -181,  -181,  -181,   148,  -181,   189,   196,  -181,   182,
-    -181,  -181,  -181,   185,  -181,   191,   167,    -2,   203,  -181,
-    -181,  -181,  -181,  -181,  -181,   192,  -181,   182,     5,  -181,
-    -181,  -181
+    -413,    14,  -413,    30,    31,   -42,   -32,    15,    66,    75,
+      82,    53,   122,   159,    43,   186,   212,   150,   206,   167,
+     172,   196,   187,   202,   254,    11,   262,    36,    92,  -413,
+    -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,
+    -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,
+    -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,
+    -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,   189,
+     190,    12,   191,   192,   193,  -413,    44,   271,   272,    10,
+    -413,   197,   198,   239,  -413,  -413,  -413,   -17,  -413,  -413,
+     233,   240,   246,    51,   203,   279,   204,   205,   207,   208,
+     210,   277,  -413,   211,   255,     9,   275,   256,   215,   216,
+     289,   294,   218,   130,  -413,   130,  -413,  -413,    70,  -413,
+    -413,   283,   284,  -413,   267,   285,  -413,   231,   153,   232,
+    -413,  -413,  -413,    13,  -413,   269,   273,   226,   227,   306,
+      59,   228,   229,  -413,   117,   308,  -413,   309,   310,   311,
+     314,   315,  -413,   316,   241,  -413,   317,   242,   197,   243,
+     286,   248,  -413,  -413,   322,   126,   111,  -413,  -413,    86,
+     -31,   154,   249,   250,    65,  -413,   297,   130,   130,   130,
+     130,   318,  -413,   323,   319,    96,   324,   287,   328,  -413,
+     329,   333,   334,   307,  -413,  -413,  -413,  -413,  -413,  -413,
+    -413,  -413,  -413,  -413,   325,  -413,  -413,   274,  -413,  -413,
+    -413,  -413,   337,  -413,   277,   326,   217,   330,   265,   277,
+    -413,   268,  -413,  -413,   153,   162,  -413,  -413,   270,  -413,
+     132,  -413,   332,   136,   335,   285,   280,    37,    37,  -413,
+    -413,   280,  -413,   117,   185,   293,   336,   174,   320,  -413,
+     117,  -413,  -413,  -413,  -413,   348,   117,   339,   278,  -413,
+    -413,   281,   338,  -413,  -413,  -413,  -413,   139,   282,   341,
+    -413,  -413,   130,   180,   290,   -22,   291,   292,    76,   288,
+     313,  -413,   340,   342,   182,   351,   343,   325,  -413,   354,
+     336,   362,  -413,   161,   157,  -413,  -413,  -413,  -413,  -413,
+    -413,   336,   130,   130,    96,  -413,   273,   295,   325,  -413,
+     369,   296,  -413,   326,   298,   299,  -413,   321,  -413,   358,
+     184,  -413,   282,   153,  -413,   300,   364,   365,   363,   366,
+     367,   335,   331,   273,   312,  -413,   312,   359,   312,  -413,
+     370,   117,  -413,  -413,   344,  -413,   336,   130,  -413,   153,
+     153,   320,   385,   386,  -413,  -413,   374,  -413,   345,   327,
+     298,  -413,   376,  -413,   346,   347,   282,   245,   378,   349,
+    -413,   280,   350,  -413,  -413,   352,   355,   368,  -413,  -413,
+     312,    45,  -413,  -413,   325,   -42,  -413,  -413,   153,  -413,
+    -413,  -413,   353,   175,   373,   394,  -413,   209,   384,   356,
+     399,  -413,   347,  -413,   387,   371,   379,   380,   357,  -413,
+    -413,  -413,  -413,   390,    44,  -413,   247,  -413,  -413,  -413,
+     360,  -413,  -413,  -413,  -413,  -413,   400,  -413,    96,   313,
+     361,   381,   375,  -413,  -413,   377,  -413,   353,   396,  -413,
+     320,  -413,   382,   392,  -413,   372,   383,   388,   389,  -413,
+     391,  -413,   393,   361,    46,   397,  -413,    32,   395,   411,
+     335,   401,  -413,  -413,  -413,   398,  -413,   372,   402,   403,
+     404,  -413,   313,    24,   108,  -413,  -413,  -413,  -413,   273,
+     405,   406,  -413,  -413,   355,   407,   408,  -413,   412,   409,
+     405,   414,  -413,   410,   408,  -413,   413,  -413,    25,   117,
+    -413,   417,  -413
 };
 
-  /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
-     Performed when YYTABLE does not specify something else to do.  Zero
-     means the default is an error.  */
-static const yytype_int8 yydefact[] =
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_uint8 yydefact[] =
 {
-       2,     0,     1,     0,     0,     0,     0,     0,     0,     0,
-       0,     0,     0,     0,     0,     0,     0,     0,     3,    20,
-      19,    14,    15,    16,    17,     9,    10,    11,    12,    13,
-       8,     5,     7,     6,     4,    18,     0,     0,     0,     0,
-      63,    58,     0,     0,     0,    78,     0,     0,    23,     0,
-       0,     0,    24,    25,    26,    22,    21,     0,     0,     0,
-       0,     0,     0,     0,    59,     0,     0,     0,     0,    62,
-      29,    28,    45,     0,    82,     0,     0,     0,     0,    27,
-      31,    63,    63,    63,    77,     0,    76,     0,     0,    80,
-      78,     0,     0,     0,     0,     0,    33,     0,     0,     0,
-      64,    60,    61,    70,     0,    69,    73,     0,     0,    67,
-      79,     0,     0,    53,    51,    52,     0,    54,     0,    86,
-      55,     0,     0,     0,     0,    41,    42,    43,    44,    37,
-       0,    63,    63,     0,     0,     0,     0,    80,     0,    82,
-      49,    46,     0,     0,     0,   101,   102,   103,   104,   105,
-     106,     0,     0,     0,     0,    83,    82,     0,    33,     0,
-       0,    39,     0,    36,     0,    65,    66,    71,    72,    74,
-      75,    81,     0,   107,     0,     0,     0,     0,     0,    95,
-      90,    88,     0,   100,    91,    89,    86,     0,     0,    34,
-      32,    40,     0,    38,     0,    84,     0,   113,    49,    47,
-      49,     0,     0,    96,    99,     0,    87,    56,   123,    37,
-      30,     0,    67,     0,     0,     0,    50,     0,     0,    97,
-       0,    92,    93,    35,    86,    68,   111,   108,   109,     0,
-      57,    48,    98,     0,    85,     0,     0,   121,   114,   115,
-      94,   112,   110,   118,   122,     0,   117,     0,   121,   116,
-     120,   119
+       2,     0,     1,     0,     0,   133,     0,     0,     0,     0,
+       0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,     0,     0,     0,     0,     0,     3,
+      36,    37,    38,    35,    34,    25,    26,    27,    28,    39,
+      40,    41,    42,    10,    23,    11,    12,    13,    14,    15,
+      16,    17,    18,    19,    20,    21,    22,    24,     9,     6,
+       8,     7,     5,     4,    29,    30,    31,    32,    33,     0,
+       0,     0,     0,     0,     0,   134,     0,     0,     0,     0,
+      53,     0,     0,     0,    54,    55,    56,     0,    52,    51,
+       0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,   128,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,   183,     0,   181,   182,   179,   184,
+     135,     0,     0,   185,     0,   137,   141,     0,   139,   186,
+      76,    70,    74,     0,   115,     0,   193,     0,     0,     0,
+       0,     0,     0,    48,     0,     0,    57,     0,     0,     0,
+       0,     0,   129,     0,     0,   240,     0,     0,     0,     0,
+       0,     0,    64,    85,     0,   179,     0,   186,   177,     0,
+       0,     0,     0,     0,     0,   136,     0,     0,     0,     0,
+       0,     0,    72,     0,     0,     0,     0,     0,     0,    58,
+       0,     0,     0,     0,    43,    45,    47,    46,    44,   123,
+     121,   122,   124,   125,   119,    50,    60,     0,    67,    73,
+      68,   237,     0,    75,     0,    98,     0,     0,     0,     0,
+      66,     0,   178,   187,   189,     0,   180,   140,     0,   172,
+       0,   171,     0,     0,   191,   137,   162,   173,   174,   176,
+     175,   162,    71,     0,     0,     0,     0,     0,   197,   126,
+       0,    59,    62,    63,    61,     0,     0,     0,     0,   239,
+     238,     0,     0,   111,   112,   113,   114,   107,     0,     0,
+      65,   188,     0,     0,   145,     0,   144,   150,     0,     0,
+     142,   138,     0,     0,   160,   161,     0,   119,   116,     0,
+       0,     0,   206,     0,     0,   210,   211,   212,   213,   214,
+     215,     0,     0,     0,     0,   194,   193,     0,   119,    49,
+       0,   115,   100,    98,    87,     0,   109,     0,   106,    83,
+       0,    81,     0,   190,   148,     0,     0,     0,     0,     0,
+       0,   191,     0,   193,     0,   154,     0,     0,     0,   155,
+       0,     0,   207,   208,     0,   200,     0,     0,   204,   202,
+     199,   197,     0,     0,   120,    69,     0,    99,     0,    91,
+      87,   110,     0,   108,     0,    79,     0,     0,     0,   146,
+     147,   162,   151,   152,   192,     0,   216,   167,   163,   164,
+       0,   230,   166,   117,   119,   133,   201,   205,   203,   198,
+     127,   236,     0,     0,     0,     0,    88,   107,     0,     0,
+       0,    82,    79,   149,     0,   195,     0,   222,     0,   165,
+     170,   231,   169,     0,     0,   104,     0,   102,    89,    90,
+       0,    86,   105,    84,    80,    77,     0,   153,     0,   142,
+       0,     0,   232,   168,   118,     0,   101,     0,     0,    78,
+     197,   143,   220,   217,   218,     0,     0,   131,     0,   103,
+       0,   196,     0,     0,   230,   223,   224,   233,     0,     0,
+     191,     0,   221,   219,   227,     0,   226,     0,     0,     0,
+       0,   130,   142,     0,   230,   225,   235,   234,   132,   193,
+       0,     0,   229,   228,   216,     0,    94,    93,     0,     0,
+       0,     0,   209,     0,    94,    92,     0,    95,     0,     0,
+      97,     0,    96
 };
 
-  /* YYPGOTO[NTERM-NUM].  */
+/* YYPGOTO[NTERM-NUM].  */
 static const yytype_int16 yypgoto[] =
 {
-    -181,  -181,  -181,  -181,  -181,  -181,  -181,  -181,  -181,  -181,
-    -181,  -181,  -181,  -181,  -181,    61,    99,    17,  -181,  -181,
-     194,  -181,  -181,   -57,  -111,  -181,  -181,  -181,  -181,   -78,
-      13,   193,  -181,   150,    90,  -126,  -181,  -180,  -152,  -117,
-    -181,  -181,    -8,  -181,  -181,   -17,   -16,  -181
+    -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,
+    -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,
+    -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,  -413,
+    -413,    17,    94,    55,  -413,  -413,    57,  -413,  -413,   -69,
+     -62,   125,  -413,  -413,    -2,   178,    47,  -413,  -413,   415,
+     301,  -413,  -276,  -241,   303,   304,  -413,   -21,  -413,    62,
+      34,   214,   276,  -408,  -413,  -413,  -236,  -413,  -413,   -75,
+      71,  -413,  -112,   -76,  -413,  -324,  -302,  -413,  -341,  -296,
+    -231,  -413,  -413,   -30,  -413,     0,  -413,  -413,   -12,  -412,
+    -413,  -413,  -413,  -413,  -413,  -413
 };
 
-  /* YYDEFGOTO[NTERM-NUM].  */
+/* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int16 yydefgoto[] =
 {
-      -1,     1,    18,    19,    20,    21,    22,    23,    24,    25,
-      26,    27,    28,    29,    30,   124,    96,   163,   192,   129,
-      97,    31,   112,   175,   118,    32,    33,    34,    44,    64,
-     139,    45,    87,    69,   109,    93,   212,   155,   119,   151,
-     197,   227,   228,   215,   238,   239,   246,    35
+       0,     1,    29,    30,   194,    31,    32,    33,    34,    35,
+      36,    37,    38,    39,    40,    41,    42,    43,    44,    45,
+      46,    47,    48,    49,    50,    51,    52,    53,    54,    55,
+      56,   400,   320,   321,    57,    58,   359,   360,   395,   491,
+     486,   262,   312,   416,   417,   215,   318,   362,   267,   216,
+      59,   244,   257,   204,    60,    61,    62,    63,   459,    76,
+     124,   175,   125,   333,   126,   127,   283,   284,   285,   381,
+     382,   232,   128,   167,   225,   280,   186,   429,   305,   248,
+     292,   385,   303,   407,   443,   444,   432,   455,   456,   412,
+     447,    64,    65,    66,    67,    68
 };
 
-  /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
-     positive, shift that token.  If negative, reduce the rule whose
-     number is the opposite.  If YYTABLE_NINF, syntax error.  */
-static const yytype_uint8 yytable[] =
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
+static const yytype_int16 yytable[] =
 {
-     140,   153,   186,   100,   101,   102,   206,     2,   243,   160,
-     156,     3,     4,   173,    46,   250,     5,     6,     7,     8,
-       9,    10,    11,    47,   244,   103,    12,    13,    14,   245,
-     187,   244,   143,    42,    43,   161,    15,    16,   162,   104,
-     181,   141,   185,   106,   234,   144,    17,   145,   146,   147,
-     148,   149,   150,   165,   166,    62,   142,   107,    62,   224,
-     202,    82,    49,   198,    83,   200,   113,    48,    63,   114,
-     115,    99,   152,   117,   145,   146,   147,   148,   149,   150,
-     201,    51,   145,   146,   147,   148,   149,   150,   178,   131,
-      50,   221,   132,   113,   182,   179,   114,   115,   116,   113,
-     117,   183,   114,   115,   180,   113,   117,    57,   114,   115,
-     184,   113,   117,   218,   114,   115,   220,    52,   117,    40,
-     219,    36,    41,    37,    42,    43,   125,   126,   127,    84,
-     133,    85,   128,   134,    86,   135,   161,    58,   136,   162,
-      38,   216,    39,   217,    53,    54,    55,    56,    59,    60,
-      61,    65,    66,    67,    70,    68,    71,    72,    74,    75,
-      79,    76,    77,    78,    80,    81,    88,    89,    92,    94,
-      95,    91,    62,    98,   108,   105,   111,   120,   121,   122,
-     123,   130,   138,   137,   154,   157,   159,   164,   167,   168,
-     169,   190,   170,   172,   174,   194,   176,   177,   199,   205,
-     207,   208,   188,   209,   191,   210,   196,   193,   211,   195,
-     213,   203,   214,   230,   236,   233,   204,   229,   231,   189,
-     235,   247,   158,   222,   226,   225,   223,   171,   242,   232,
-     249,     0,   251,     0,     0,     0,     0,     0,     0,   237,
-     110,     0,   240,    73,     0,     0,     0,     0,   241,   248,
-       0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
-       0,    90
+     129,   166,   287,   168,   352,   286,   102,   374,   351,   306,
+     389,   340,   155,   132,     2,   308,   182,    98,     3,     4,
+     108,   441,    78,     5,     6,     7,     8,     9,    10,    11,
+      75,   376,   354,    12,    13,    14,    69,    72,    70,    73,
+     480,   499,   466,    15,    16,     5,    86,   138,    77,   226,
+     468,    17,   227,    18,   143,   410,   464,   224,   326,   342,
+     113,   327,   483,   139,   479,   237,   238,   239,   240,    80,
+     348,   411,   411,   247,    19,    20,    21,   465,    22,    23,
+     152,   113,    24,    25,    26,    27,   169,   156,   469,   157,
+     133,    99,   109,   183,    28,    79,   114,   190,   129,   451,
+     384,   170,   113,   223,   481,   500,   101,    81,   413,    87,
+      71,    74,   113,   179,   144,   387,    82,   114,   482,   115,
+     180,   198,   116,   117,   118,    84,   119,   120,   222,   121,
+     122,   123,   440,    83,   411,   404,   472,   191,   114,   192,
+     115,   245,   169,   116,   117,   118,   113,   119,   114,   274,
+     121,   122,   123,   277,   246,   315,   329,   221,   103,   330,
+     323,   115,    85,   275,   116,   117,   165,   278,   119,   199,
+     104,   115,   105,   123,   116,   117,   165,   484,   119,   271,
+     272,   316,   114,   123,   317,   177,   178,   179,   288,    88,
+     349,   350,   247,   260,   180,   200,   201,   324,   270,   202,
+     336,   365,   366,   289,   203,   115,   344,   337,   116,   117,
+     165,   325,   119,   345,   346,    89,   347,   123,   293,   294,
+     295,   296,   297,   298,   299,   300,   228,   177,   178,   179,
+      90,   301,   229,   302,   230,   388,   180,   231,     5,   263,
+     264,   265,     9,    10,    11,   266,    91,    92,   177,   178,
+     179,   316,    93,   418,   317,   419,    94,   180,   501,   378,
+      97,   379,   402,   366,   436,   437,    96,    95,   100,   106,
+     107,   110,   111,   112,   130,   131,   137,   134,   136,   140,
+     142,   141,   146,   145,   147,   148,     5,   149,   150,   154,
+     151,   158,   162,   153,   159,   160,   161,   163,   164,   171,
+     172,   173,   184,   174,   176,   181,   187,   188,   185,   189,
+     193,   205,   206,   236,   208,   207,   247,   209,   210,   211,
+     213,   212,   214,   217,   218,   220,   242,   249,   219,   233,
+     234,   251,   252,   250,   241,   243,   253,   254,   129,   255,
+     259,   258,   309,   256,   261,   269,   268,   282,   226,   276,
+     273,   290,   291,   279,   307,   314,   304,   322,   310,   335,
+     339,   311,   319,  -156,   328,  -158,   332,   334,   331,   338,
+     341,   343,   355,   363,   364,   353,   356,   361,   358,   371,
+     368,   369,   370,   372,   373,   375,   380,   383,   390,   391,
+     392,   393,   377,   397,   394,   403,   386,   421,   406,   408,
+     420,   423,   425,   439,   427,   431,   430,   434,   445,   428,
+     453,   448,   450,   452,   471,   467,   367,   396,   473,   426,
+     458,   401,  -157,  -159,   398,   497,   490,   399,   494,   492,
+     446,   495,   405,   415,   502,   449,   424,   433,   357,   313,
+     438,   442,   493,   195,   422,   196,   197,   414,   435,   281,
+     235,   409,   454,   463,   488,   475,     0,     0,     0,     0,
+       0,   457,     0,     0,     0,     0,     0,     0,     0,   460,
+       0,   461,   485,   462,     0,   470,     0,     0,   474,     0,
+     476,   477,     0,     0,   487,     0,   478,   489,     0,     0,
+     496,     0,     0,   498,     0,     0,   135
 };
 
 static const yytype_int16 yycheck[] =
 {
-     111,   118,   154,    81,    82,    83,   186,     0,    10,    16,
-     121,     4,     5,   139,    57,    10,     9,    10,    11,    12,
-      13,    14,    15,     7,    26,    17,    19,    20,    21,    31,
-     156,    26,    31,    62,    63,    42,    29,    30,    45,    31,
-     151,     3,   153,    17,   224,    44,    39,    46,    47,    48,
-      49,    50,    51,   131,   132,    18,    18,    31,    18,   211,
-     177,    57,    32,   174,    60,   176,    52,     3,    31,    55,
-      56,    31,    44,    59,    46,    47,    48,    49,    50,    51,
-      44,    57,    46,    47,    48,    49,    50,    51,    45,    57,
-      34,   202,    60,    52,    45,    52,    55,    56,    57,    52,
-      59,    52,    55,    56,    57,    52,    59,    40,    55,    56,
-      57,    52,    59,    45,    55,    56,    57,     3,    59,    57,
-      52,     6,    60,     8,    62,    63,    22,    23,    24,    55,
-      57,    57,    28,    60,    60,    57,    42,    57,    60,    45,
-       6,   198,     8,   200,     3,     3,     3,     3,    57,    57,
-      57,    16,    16,    34,     3,    18,     3,    57,    57,    37,
-       3,    41,    16,    38,     3,    57,    57,    57,    35,    57,
-      59,    33,    18,    57,    18,    17,    16,     3,    46,    32,
-      18,    16,    53,    57,    36,     6,    17,    57,    17,    17,
-      17,     3,    17,    54,    18,    17,    16,    57,    17,    31,
-       3,     3,    57,    17,    55,     3,    43,    52,    38,    57,
-      27,    52,    25,     3,    18,    31,    52,    27,    17,   158,
-      31,    18,   123,    57,    57,   212,   209,   137,   236,    52,
-     247,    -1,   248,    -1,    -1,    -1,    -1,    -1,    -1,    57,
-      90,    -1,    57,    49,    -1,    -1,    -1,    -1,    57,    57,
-      -1,    -1,    -1,    -1,    -1,    -1,    -1,    -1,    -1,    -1,
-      -1,    68
+      76,   113,   243,   115,   306,   241,    27,   331,   304,   250,
+     351,   287,     3,     3,     0,   256,     3,     6,     4,     5,
+       8,   429,     7,     9,    10,    11,    12,    13,    14,    15,
+      72,   333,   308,    19,    20,    21,     6,     6,     8,     8,
+      16,    16,   454,    29,    30,     9,     3,    64,    80,    80,
+      18,    37,    83,    39,     3,    10,    10,   169,    80,   290,
+      16,    83,   474,    80,   472,   177,   178,   179,   180,     3,
+     301,    26,    26,   185,    60,    61,    62,    31,    64,    65,
+     101,    16,    68,    69,    70,    71,    16,    78,    56,    80,
+      80,    80,    80,    80,    80,    80,    52,    38,   174,   440,
+     341,    31,    16,    17,    80,    80,    70,    32,   384,    66,
+      80,    80,    16,    76,    63,   346,    34,    52,    10,    75,
+      83,   142,    78,    79,    80,     3,    82,    83,    17,    85,
+      86,    87,   428,    80,    26,   371,   460,    78,    52,    80,
+      75,    45,    16,    78,    79,    80,    16,    82,    52,    17,
+      85,    86,    87,    17,    58,    16,    80,    31,    66,    83,
+     272,    75,     3,    31,    78,    79,    80,    31,    82,    52,
+      78,    75,    80,    87,    78,    79,    80,   479,    82,    17,
+      18,    42,    52,    87,    45,    74,    75,    76,     3,     3,
+     302,   303,   304,   214,    83,    78,    79,    17,   219,    82,
+      18,    17,    18,    18,    87,    75,    45,    25,    78,    79,
+      80,    31,    82,    52,    57,     3,    59,    87,    44,    45,
+      46,    47,    48,    49,    50,    51,    72,    74,    75,    76,
+      80,    57,    78,    59,    80,   347,    83,    83,     9,    22,
+      23,    24,    13,    14,    15,    28,    40,    80,    74,    75,
+      76,    42,    80,    78,    45,    80,    60,    83,   499,   334,
+       6,   336,    17,    18,    17,    18,    64,    80,     6,    80,
+      80,    80,    80,    80,     3,     3,    37,    80,    80,    46,
+      34,    41,     3,    80,    80,    80,     9,    80,    80,    34,
+      80,    16,     3,    82,    38,    80,    80,     3,    80,    16,
+      16,    34,    33,    18,    73,    73,    80,    80,    35,     3,
+      82,     3,     3,    16,     3,     5,   428,     3,     3,     3,
+       3,    80,    80,    80,    38,     3,     3,     3,    80,    80,
+      80,     3,     3,    46,    16,    16,     3,     3,   414,    32,
+       3,    67,     3,    18,    18,    80,    16,    67,    80,    17,
+      80,    58,    16,    18,     6,    17,    36,    16,    80,    17,
+      17,    80,    80,    73,    73,    73,    53,    27,    80,    18,
+      16,     9,     3,    52,    16,    80,    80,    78,    80,    16,
+      80,    17,    17,    17,    17,    54,    27,    17,     3,     3,
+      16,    46,    80,    17,    67,    17,    52,     3,    43,    31,
+      27,    17,     3,     3,    17,    25,    27,    17,    27,    38,
+      18,    34,    16,    31,     3,    18,   322,   360,    17,   402,
+      32,   366,    73,    73,    78,   494,    18,    80,   490,    17,
+      55,    17,    80,    80,    17,   437,    80,    80,   313,   261,
+      80,    80,    33,   142,   397,   142,   142,   385,   414,   235,
+     174,   380,    80,   453,   484,   467,    -1,    -1,    -1,    -1,
+      -1,    78,    -1,    -1,    -1,    -1,    -1,    -1,    -1,    80,
+      -1,    80,    67,    80,    -1,    80,    -1,    -1,    80,    -1,
+      78,    78,    -1,    -1,    78,    -1,    82,    80,    -1,    -1,
+      80,    -1,    -1,    80,    -1,    -1,    81
 };
 
-  /* YYSTOS[STATE-NUM] -- The (internal number of the) accessing
-     symbol of state STATE-NUM.  */
-static const yytype_int8 yystos[] =
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_uint8 yystos[] =
 {
-       0,    65,     0,     4,     5,     9,    10,    11,    12,    13,
-      14,    15,    19,    20,    21,    29,    30,    39,    66,    67,
-      68,    69,    70,    71,    72,    73,    74,    75,    76,    77,
-      78,    85,    89,    90,    91,   111,     6,     8,     6,     8,
-      57,    60,    62,    63,    92,    95,    57,     7,     3,    32,
-      34,    57,     3,     3,     3,     3,     3,    40,    57,    57,
-      57,    57,    18,    31,    93,    16,    16,    34,    18,    97,
-       3,     3,    57,    84,    57,    37,    41,    16,    38,     3,
-       3,    57,    57,    60,    55,    57,    60,    96,    57,    57,
-      95,    33,    35,    99,    57,    59,    80,    84,    57,    31,
-      93,    93,    93,    17,    31,    17,    17,    31,    18,    98,
-      97,    16,    86,    52,    55,    56,    57,    59,    88,   102,
-       3,    46,    32,    18,    79,    22,    23,    24,    28,    83,
-      16,    57,    60,    57,    60,    57,    60,    57,    53,    94,
-      88,     3,    18,    31,    44,    46,    47,    48,    49,    50,
-      51,   103,    44,   103,    36,   101,    88,     6,    80,    17,
-      16,    42,    45,    81,    57,    93,    93,    17,    17,    17,
-      17,    98,    54,    99,    18,    87,    16,    57,    45,    52,
-      57,    88,    45,    52,    57,    88,   102,    99,    57,    79,
-       3,    55,    82,    52,    17,    57,    43,   104,    88,    17,
-      88,    44,   103,    52,    52,    31,   101,     3,     3,    17,
-       3,    38,   100,    27,    25,   107,    87,    87,    45,    52,
-      57,    88,    57,    81,   102,    94,    57,   105,   106,    27,
-       3,    17,    52,    31,   101,    31,    18,    57,   108,   109,
-      57,    57,   106,    10,    26,    31,   110,    18,    57,   109,
-      10,   110
+       0,    89,     0,     4,     5,     9,    10,    11,    12,    13,
+      14,    15,    19,    20,    21,    29,    30,    37,    39,    60,
+      61,    62,    64,    65,    68,    69,    70,    71,    80,    90,
+      91,    93,    94,    95,    96,    97,    98,    99,   100,   101,
+     102,   103,   104,   105,   106,   107,   108,   109,   110,   111,
+     112,   113,   114,   115,   116,   117,   118,   122,   123,   138,
+     142,   143,   144,   145,   179,   180,   181,   182,   183,     6,
+       8,    80,     6,     8,    80,    72,   147,    80,     7,    80,
+       3,    32,    34,    80,     3,     3,     3,    66,     3,     3,
+      80,    40,    80,    80,    60,    80,    64,     6,     6,    80,
+       6,    70,   145,    66,    78,    80,    80,    80,     8,    80,
+      80,    80,    80,    16,    52,    75,    78,    79,    80,    82,
+      83,    85,    86,    87,   148,   150,   152,   153,   160,   161,
+       3,     3,     3,    80,    80,   137,    80,    37,    64,    80,
+      46,    41,    34,     3,    63,    80,     3,    80,    80,    80,
+      80,    80,   145,    82,    34,     3,    78,    80,    16,    38,
+      80,    80,     3,     3,    80,    80,   160,   161,   160,    16,
+      31,    16,    16,    34,    18,   149,    73,    74,    75,    76,
+      83,    73,     3,    80,    33,    35,   164,    80,    80,     3,
+      38,    78,    80,    82,    92,   138,   142,   143,   145,    52,
+      78,    79,    82,    87,   141,     3,     3,     5,     3,     3,
+       3,     3,    80,     3,    80,   133,   137,    80,    38,    80,
+       3,    31,    17,    17,   160,   162,    80,    83,    72,    78,
+      80,    83,   159,    80,    80,   150,    16,   160,   160,   160,
+     160,    16,     3,    16,   139,    45,    58,   160,   167,     3,
+      46,     3,     3,     3,     3,    32,    18,   140,    67,     3,
+     145,    18,   129,    22,    23,    24,    28,   136,    16,    80,
+     145,    17,    18,    80,    17,    31,    17,    17,    31,    18,
+     163,   149,    67,   154,   155,   156,   154,   141,     3,    18,
+      58,    16,   168,    44,    45,    46,    47,    48,    49,    50,
+      51,    57,    59,   170,    36,   166,   141,     6,   141,     3,
+      80,    80,   130,   133,    17,    16,    42,    45,   134,    80,
+     120,   121,    16,   160,    17,    31,    80,    83,    73,    80,
+      83,    80,    53,   151,    27,    17,    18,    25,    18,    17,
+     140,    16,   168,     9,    45,    52,    57,    59,   168,   160,
+     160,   167,   164,    80,   140,     3,    80,   129,    80,   124,
+     125,    78,   135,    52,    16,    17,    18,   120,    80,    17,
+      17,    16,    17,    17,   163,    54,   164,    80,   157,   157,
+      27,   157,   158,    17,   141,   169,    52,   168,   160,   166,
+       3,     3,    16,    46,    67,   126,   124,    17,    78,    80,
+     119,   121,    17,    17,   154,    80,    43,   171,    31,   158,
+      10,    26,   177,   140,   147,    80,   131,   132,    78,    80,
+      27,     3,   134,    17,    80,     3,   119,    17,    38,   165,
+      27,    25,   174,    80,    17,   148,    17,    18,    80,     3,
+     167,   151,    80,   172,   173,    27,    55,   178,    34,   132,
+      16,   166,    31,    18,    80,   175,   176,    78,    32,   146,
+      80,    80,    80,   173,    10,    31,   177,    18,    18,    56,
+      80,     3,   163,    17,    80,   176,    78,    78,    82,   151,
+      16,    80,    10,   177,   164,    67,   128,    78,   171,    80,
+      18,   127,    17,    33,   128,    17,    80,   127,    80,    16,
+      80,   141,    17
 };
 
-  /* YYR1[YYN] -- Symbol number of symbol that rule YYN derives.  */
-static const yytype_int8 yyr1[] =
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_uint8 yyr1[] =
 {
-       0,    64,    65,    65,    66,    66,    66,    66,    66,    66,
-      66,    66,    66,    66,    66,    66,    66,    66,    66,    66,
-      66,    67,    68,    69,    70,    71,    72,    73,    74,    75,
-      76,    77,    78,    79,    79,    80,    80,    81,    81,    81,
-      82,    83,    83,    83,    83,    84,    85,    86,    86,    87,
-      87,    88,    88,    88,    88,    89,    90,    91,    92,    92,
-      92,    92,    92,    93,    93,    93,    93,    94,    94,    95,
-      95,    95,    95,    95,    95,    95,    96,    96,    97,    97,
-      98,    98,    99,    99,   100,   100,   101,   101,   102,   102,
-     102,   102,   102,   102,   102,   102,   102,   102,   102,   102,
-     102,   103,   103,   103,   103,   103,   103,   104,   104,   105,
-     105,   106,   106,   107,   107,   108,   108,   109,   109,   109,
-     109,   110,   110,   111
+       0,    88,    89,    89,    90,    90,    90,    90,    90,    90,
+      90,    90,    90,    90,    90,    90,    90,    90,    90,    90,
+      90,    90,    90,    90,    90,    90,    90,    90,    90,    90,
+      90,    90,    90,    90,    90,    90,    90,    90,    90,    90,
+      90,    90,    90,    91,    92,    92,    92,    92,    93,    93,
+      94,    95,    96,    97,    98,    99,   100,   101,   102,   102,
+     103,   104,   104,   104,   105,   106,   107,   108,   109,   110,
+     111,   112,   113,   114,   115,   116,   117,   118,   118,   119,
+     119,   120,   120,   121,   121,   122,   123,   124,   124,   125,
+     125,   126,   126,   126,   127,   127,   128,   128,   129,   129,
+     129,   130,   131,   131,   132,   133,   133,   134,   134,   134,
+     135,   136,   136,   136,   136,   137,   138,   139,   139,   140,
+     140,   141,   141,   141,   141,   141,   142,   143,   144,   144,
+     145,   146,   146,   147,   147,   148,   148,   149,   149,   150,
+     150,   150,   151,   151,   152,   152,   152,   152,   152,   152,
+     152,   152,   152,   152,   152,   152,   153,   153,   153,   153,
+     154,   154,   155,   155,   155,   156,   156,   157,   157,   158,
+     158,   159,   159,   160,   160,   160,   160,   160,   160,   160,
+     160,   160,   160,   160,   160,   160,   160,   161,   161,   162,
+     162,   163,   163,   164,   164,   165,   165,   166,   166,   167,
+     167,   167,   167,   167,   167,   167,   167,   167,   169,   168,
+     170,   170,   170,   170,   170,   170,   171,   171,   172,   172,
+     173,   173,   174,   174,   175,   175,   176,   176,   176,   176,
+     177,   177,   178,   178,   178,   178,   179,   180,   181,   182,
+     183
 };
 
-  /* YYR2[YYN] -- Number of symbols on the right hand side of rule YYN.  */
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr2[] =
 {
        0,     2,     0,     2,     1,     1,     1,     1,     1,     1,
        1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
-       1,     2,     2,     2,     2,     2,     2,     4,     3,     3,
-       9,     4,     8,     0,     3,     6,     3,     0,     2,     1,
+       1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+       1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+       1,     1,     1,     4,     1,     1,     1,     1,     3,     6,
+       4,     2,     2,     2,     2,     2,     2,     3,     4,     5,
+       4,     5,     5,     5,     4,     6,     5,     4,     4,     7,
+       3,     5,     4,     4,     3,     4,     3,    10,    11,     0,
+       2,     1,     3,     1,     4,     4,    10,     0,     2,     3,
+       3,     0,    10,     8,     0,     3,     8,     6,     0,     3,
+       2,     5,     1,     3,     1,     6,     3,     0,     2,     1,
        1,     1,     1,     1,     1,     1,     6,     4,     6,     0,
-       3,     1,     1,     1,     1,     5,     8,    10,     1,     2,
-       4,     4,     2,     0,     3,     5,     5,     0,     5,     4,
-       4,     6,     6,     4,     6,     6,     1,     1,     0,     3,
-       0,     3,     0,     3,     0,     3,     0,     3,     3,     3,
-       3,     3,     5,     5,     7,     3,     4,     5,     6,     4,
-       3,     1,     1,     1,     1,     1,     1,     0,     3,     1,
-       3,     1,     3,     0,     3,     1,     3,     2,     2,     4,
-       4,     0,     1,     8
+       3,     1,     1,     1,     1,     1,     5,     8,     2,     3,
+      13,     0,     3,     0,     1,     1,     2,     0,     3,     1,
+       3,     1,     0,     5,     4,     4,     6,     6,     5,     7,
+       4,     6,     6,     8,     5,     5,     4,     6,     4,     6,
+       1,     1,     0,     3,     3,     4,     3,     1,     3,     2,
+       2,     1,     1,     3,     3,     3,     3,     2,     3,     1,
+       3,     1,     1,     1,     1,     1,     1,     3,     4,     1,
+       3,     0,     3,     0,     3,     0,     3,     0,     3,     3,
+       3,     4,     3,     4,     3,     4,     2,     3,     0,    12,
+       1,     1,     1,     1,     1,     1,     0,     3,     1,     3,
+       1,     3,     0,     3,     1,     3,     2,     2,     4,     4,
+       0,     1,     0,     2,     4,     4,     8,     4,     5,     5,
+       3
 };
 
 
+enum { YYENOMEM = -2 };
+
 #define yyerrok         (yyerrstatus = 0)
 #define yyclearin       (yychar = YYEMPTY)
-#define YYEMPTY         (-2)
-#define YYEOF           0
 
 #define YYACCEPT        goto yyacceptlab
 #define YYABORT         goto yyabortlab
 #define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
 
 
 #define YYRECOVERING()  (!!yyerrstatus)
@@ -954,10 +1298,9 @@ static const yytype_int8 yyr2[] =
       }                                                           \
   while (0)
 
-/* Error token number */
-#define YYTERROR        1
-#define YYERRCODE       256
-
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
 
 
 /* Enable debugging if requested.  */
@@ -974,19 +1317,16 @@ do {                                            \
     YYFPRINTF Args;                             \
 } while (0)
 
-/* This macro is provided for backward compatibility. */
-#ifndef YY_LOCATION_PRINT
-# define YY_LOCATION_PRINT(File, Loc) ((void) 0)
-#endif
 
 
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)                    \
+
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
 do {                                                                      \
   if (yydebug)                                                            \
     {                                                                     \
       YYFPRINTF (stderr, "%s ", Title);                                   \
       yy_symbol_print (stderr,                                            \
-                  Type, Value, scanner); \
+                  Kind, Value, scanner); \
       YYFPRINTF (stderr, "\n");                                           \
     }                                                                     \
 } while (0)
@@ -997,19 +1337,16 @@ do {                                                                      \
 `-----------------------------------*/
 
 static void
-yy_symbol_value_print (FILE *yyo, int yytype, YYSTYPE const * const yyvaluep, void *scanner)
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, void *scanner)
 {
   FILE *yyoutput = yyo;
-  YYUSE (yyoutput);
-  YYUSE (scanner);
+  YY_USE (yyoutput);
+  YY_USE (scanner);
   if (!yyvaluep)
     return;
-# ifdef YYPRINT
-  if (yytype < YYNTOKENS)
-    YYPRINT (yyo, yytoknum[yytype], *yyvaluep);
-# endif
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
-  YYUSE (yytype);
+  YY_USE (yykind);
   YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
@@ -1019,12 +1356,13 @@ yy_symbol_value_print (FILE *yyo, int yytype, YYSTYPE const * const yyvaluep, vo
 `---------------------------*/
 
 static void
-yy_symbol_print (FILE *yyo, int yytype, YYSTYPE const * const yyvaluep, void *scanner)
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, void *scanner)
 {
   YYFPRINTF (yyo, "%s %s (",
-             yytype < YYNTOKENS ? "token" : "nterm", yytname[yytype]);
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
 
-  yy_symbol_value_print (yyo, yytype, yyvaluep, scanner);
+  yy_symbol_value_print (yyo, yykind, yyvaluep, scanner);
   YYFPRINTF (yyo, ")");
 }
 
@@ -1057,7 +1395,8 @@ do {                                                            \
 `------------------------------------------------*/
 
 static void
-yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp, int yyrule, void *scanner)
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
+                 int yyrule, void *scanner)
 {
   int yylno = yyrline[yyrule];
   int yynrhs = yyr2[yyrule];
@@ -1069,9 +1408,8 @@ yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp, int yyrule, void *scanner)
     {
       YYFPRINTF (stderr, "   $%d = ", yyi + 1);
       yy_symbol_print (stderr,
-                       yystos[+yyssp[yyi + 1 - yynrhs]],
-                       &yyvsp[(yyi + 1) - (yynrhs)]
-                                              , scanner);
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)], scanner);
       YYFPRINTF (stderr, "\n");
     }
 }
@@ -1086,8 +1424,8 @@ do {                                    \
    multiple parsers can coexist.  */
 int yydebug;
 #else /* !YYDEBUG */
-# define YYDPRINTF(Args)
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
 # define YY_STACK_PRINT(Bottom, Top)
 # define YY_REDUCE_PRINT(Rule)
 #endif /* !YYDEBUG */
@@ -1110,259 +1448,34 @@ int yydebug;
 #endif
 
 
-#if YYERROR_VERBOSE
-
-# ifndef yystrlen
-#  if defined __GLIBC__ && defined _STRING_H
-#   define yystrlen(S) (YY_CAST (YYPTRDIFF_T, strlen (S)))
-#  else
-/* Return the length of YYSTR.  */
-static YYPTRDIFF_T
-yystrlen (const char *yystr)
-{
-  YYPTRDIFF_T yylen;
-  for (yylen = 0; yystr[yylen]; yylen++)
-    continue;
-  return yylen;
-}
-#  endif
-# endif
-
-# ifndef yystpcpy
-#  if defined __GLIBC__ && defined _STRING_H && defined _GNU_SOURCE
-#   define yystpcpy stpcpy
-#  else
-/* Copy YYSRC to YYDEST, returning the address of the terminating '\0' in
-   YYDEST.  */
-static char *
-yystpcpy (char *yydest, const char *yysrc)
-{
-  char *yyd = yydest;
-  const char *yys = yysrc;
-
-  while ((*yyd++ = *yys++) != '\0')
-    continue;
-
-  return yyd - 1;
-}
-#  endif
-# endif
-
-# ifndef yytnamerr
-/* Copy to YYRES the contents of YYSTR after stripping away unnecessary
-   quotes and backslashes, so that it's suitable for yyerror.  The
-   heuristic is that double-quoting is unnecessary unless the string
-   contains an apostrophe, a comma, or backslash (other than
-   backslash-backslash).  YYSTR is taken from yytname.  If YYRES is
-   null, do not copy; instead, return the length of what the result
-   would have been.  */
-static YYPTRDIFF_T
-yytnamerr (char *yyres, const char *yystr)
-{
-  if (*yystr == '"')
-    {
-      YYPTRDIFF_T yyn = 0;
-      char const *yyp = yystr;
-
-      for (;;)
-        switch (*++yyp)
-          {
-          case '\'':
-          case ',':
-            goto do_not_strip_quotes;
-
-          case '\\':
-            if (*++yyp != '\\')
-              goto do_not_strip_quotes;
-            else
-              goto append;
-
-          append:
-          default:
-            if (yyres)
-              yyres[yyn] = *yyp;
-            yyn++;
-            break;
-
-          case '"':
-            if (yyres)
-              yyres[yyn] = '\0';
-            return yyn;
-          }
-    do_not_strip_quotes: ;
-    }
-
-  if (yyres)
-    return yystpcpy (yyres, yystr) - yyres;
-  else
-    return yystrlen (yystr);
-}
-# endif
-
-/* Copy into *YYMSG, which is of size *YYMSG_ALLOC, an error message
-   about the unexpected token YYTOKEN for the state stack whose top is
-   YYSSP.
-
-   Return 0 if *YYMSG was successfully written.  Return 1 if *YYMSG is
-   not large enough to hold the message.  In that case, also set
-   *YYMSG_ALLOC to the required number of bytes.  Return 2 if the
-   required number of bytes is too large to store.  */
-static int
-yysyntax_error (YYPTRDIFF_T *yymsg_alloc, char **yymsg,
-                yy_state_t *yyssp, int yytoken)
-{
-  enum { YYERROR_VERBOSE_ARGS_MAXIMUM = 5 };
-  /* Internationalized format string. */
-  const char *yyformat = YY_NULLPTR;
-  /* Arguments of yyformat: reported tokens (one for the "unexpected",
-     one per "expected"). */
-  char const *yyarg[YYERROR_VERBOSE_ARGS_MAXIMUM];
-  /* Actual size of YYARG. */
-  int yycount = 0;
-  /* Cumulated lengths of YYARG.  */
-  YYPTRDIFF_T yysize = 0;
-
-  /* There are many possibilities here to consider:
-     - If this state is a consistent state with a default action, then
-       the only way this function was invoked is if the default action
-       is an error action.  In that case, don't check for expected
-       tokens because there are none.
-     - The only way there can be no lookahead present (in yychar) is if
-       this state is a consistent state with a default action.  Thus,
-       detecting the absence of a lookahead is sufficient to determine
-       that there is no unexpected or expected token to report.  In that
-       case, just report a simple "syntax error".
-     - Don't assume there isn't a lookahead just because this state is a
-       consistent state with a default action.  There might have been a
-       previous inconsistent state, consistent state with a non-default
-       action, or user semantic action that manipulated yychar.
-     - Of course, the expected token list depends on states to have
-       correct lookahead information, and it depends on the parser not
-       to perform extra reductions after fetching a lookahead from the
-       scanner and before detecting a syntax error.  Thus, state merging
-       (from LALR or IELR) and default reductions corrupt the expected
-       token list.  However, the list is correct for canonical LR with
-       one exception: it will still contain any token that will not be
-       accepted due to an error action in a later state.
-  */
-  if (yytoken != YYEMPTY)
-    {
-      int yyn = yypact[+*yyssp];
-      YYPTRDIFF_T yysize0 = yytnamerr (YY_NULLPTR, yytname[yytoken]);
-      yysize = yysize0;
-      yyarg[yycount++] = yytname[yytoken];
-      if (!yypact_value_is_default (yyn))
-        {
-          /* Start YYX at -YYN if negative to avoid negative indexes in
-             YYCHECK.  In other words, skip the first -YYN actions for
-             this state because they are default actions.  */
-          int yyxbegin = yyn < 0 ? -yyn : 0;
-          /* Stay within bounds of both yycheck and yytname.  */
-          int yychecklim = YYLAST - yyn + 1;
-          int yyxend = yychecklim < YYNTOKENS ? yychecklim : YYNTOKENS;
-          int yyx;
-
-          for (yyx = yyxbegin; yyx < yyxend; ++yyx)
-            if (yycheck[yyx + yyn] == yyx && yyx != YYTERROR
-                && !yytable_value_is_error (yytable[yyx + yyn]))
-              {
-                if (yycount == YYERROR_VERBOSE_ARGS_MAXIMUM)
-                  {
-                    yycount = 1;
-                    yysize = yysize0;
-                    break;
-                  }
-                yyarg[yycount++] = yytname[yyx];
-                {
-                  YYPTRDIFF_T yysize1
-                    = yysize + yytnamerr (YY_NULLPTR, yytname[yyx]);
-                  if (yysize <= yysize1 && yysize1 <= YYSTACK_ALLOC_MAXIMUM)
-                    yysize = yysize1;
-                  else
-                    return 2;
-                }
-              }
-        }
-    }
-
-  switch (yycount)
-    {
-# define YYCASE_(N, S)                      \
-      case N:                               \
-        yyformat = S;                       \
-      break
-    default: /* Avoid compiler warnings. */
-      YYCASE_(0, YY_("syntax error"));
-      YYCASE_(1, YY_("syntax error, unexpected %s"));
-      YYCASE_(2, YY_("syntax error, unexpected %s, expecting %s"));
-      YYCASE_(3, YY_("syntax error, unexpected %s, expecting %s or %s"));
-      YYCASE_(4, YY_("syntax error, unexpected %s, expecting %s or %s or %s"));
-      YYCASE_(5, YY_("syntax error, unexpected %s, expecting %s or %s or %s or %s"));
-# undef YYCASE_
-    }
 
-  {
-    /* Don't count the "%s"s in the final size, but reserve room for
-       the terminator.  */
-    YYPTRDIFF_T yysize1 = yysize + (yystrlen (yyformat) - 2 * yycount) + 1;
-    if (yysize <= yysize1 && yysize1 <= YYSTACK_ALLOC_MAXIMUM)
-      yysize = yysize1;
-    else
-      return 2;
-  }
 
-  if (*yymsg_alloc < yysize)
-    {
-      *yymsg_alloc = 2 * yysize;
-      if (! (yysize <= *yymsg_alloc
-             && *yymsg_alloc <= YYSTACK_ALLOC_MAXIMUM))
-        *yymsg_alloc = YYSTACK_ALLOC_MAXIMUM;
-      return 1;
-    }
 
-  /* Avoid sprintf, as that infringes on the user's name space.
-     Don't have undefined behavior even if the translation
-     produced a string with the wrong number of "%s"s.  */
-  {
-    char *yyp = *yymsg;
-    int yyi = 0;
-    while ((*yyp = *yyformat) != '\0')
-      if (*yyp == '%' && yyformat[1] == 's' && yyi < yycount)
-        {
-          yyp += yytnamerr (yyp, yyarg[yyi++]);
-          yyformat += 2;
-        }
-      else
-        {
-          ++yyp;
-          ++yyformat;
-        }
-  }
-  return 0;
-}
-#endif /* YYERROR_VERBOSE */
 
 /*-----------------------------------------------.
 | Release the memory associated to this symbol.  |
 `-----------------------------------------------*/
 
 static void
-yydestruct (const char *yymsg, int yytype, YYSTYPE *yyvaluep, void *scanner)
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, void *scanner)
 {
-  YYUSE (yyvaluep);
-  YYUSE (scanner);
+  YY_USE (yyvaluep);
+  YY_USE (scanner);
   if (!yymsg)
     yymsg = "Deleting";
-  YY_SYMBOL_PRINT (yymsg, yytype, yyvaluep, yylocationp);
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
 
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
-  YYUSE (yytype);
+  YY_USE (yykind);
   YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
 
 
 
+
+
 /*----------.
 | yyparse.  |
 `----------*/
@@ -1370,7 +1483,7 @@ yydestruct (const char *yymsg, int yytype, YYSTYPE *yyvaluep, void *scanner)
 int
 yyparse (void *scanner)
 {
-/* The lookahead symbol.  */
+/* Lookahead token kind.  */
 int yychar;
 
 
@@ -1381,45 +1494,38 @@ YY_INITIAL_VALUE (static YYSTYPE yyval_default;)
 YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
 
     /* Number of syntax errors so far.  */
-    int yynerrs;
+    int yynerrs = 0;
 
-    yy_state_fast_t yystate;
+    yy_state_fast_t yystate = 0;
     /* Number of tokens to shift before error messages enabled.  */
-    int yyerrstatus;
+    int yyerrstatus = 0;
 
-    /* The stacks and their tools:
-       'yyss': related to states.
-       'yyvs': related to semantic values.
-
-       Refer to the stacks through separate pointers, to allow yyoverflow
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
        to reallocate them elsewhere.  */
 
-    /* The state stack.  */
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
+
+    /* The state stack: array, bottom, top.  */
     yy_state_t yyssa[YYINITDEPTH];
-    yy_state_t *yyss;
-    yy_state_t *yyssp;
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
 
-    /* The semantic value stack.  */
+    /* The semantic value stack: array, bottom, top.  */
     YYSTYPE yyvsa[YYINITDEPTH];
-    YYSTYPE *yyvs;
-    YYSTYPE *yyvsp;
-
-    YYPTRDIFF_T yystacksize;
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
 
   int yyn;
+  /* The return value of yyparse.  */
   int yyresult;
-  /* Lookahead token as an internal (translated) token number.  */
-  int yytoken = 0;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
   /* The variables used to return semantic value and location from the
      action routines.  */
   YYSTYPE yyval;
 
-#if YYERROR_VERBOSE
-  /* Buffer for error messages, and its allocated size.  */
-  char yymsgbuf[128];
-  char *yymsg = yymsgbuf;
-  YYPTRDIFF_T yymsg_alloc = sizeof yymsgbuf;
-#endif
+
 
 #define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
 
@@ -1427,16 +1533,10 @@ YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
      Keep to zero when no symbol should be popped.  */
   int yylen = 0;
 
-  yyssp = yyss = yyssa;
-  yyvsp = yyvs = yyvsa;
-  yystacksize = YYINITDEPTH;
-
   YYDPRINTF ((stderr, "Starting parse\n"));
 
-  yystate = 0;
-  yyerrstatus = 0;
-  yynerrs = 0;
   yychar = YYEMPTY; /* Cause a token to be read.  */
+
   goto yysetstate;
 
 
@@ -1458,10 +1558,11 @@ yysetstate:
   YY_IGNORE_USELESS_CAST_BEGIN
   *yyssp = YY_CAST (yy_state_t, yystate);
   YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
 
   if (yyss + yystacksize - 1 <= yyssp)
 #if !defined yyoverflow && !defined YYSTACK_RELOCATE
-    goto yyexhaustedlab;
+    YYNOMEM;
 #else
     {
       /* Get the current used size of the three stacks, in elements.  */
@@ -1489,7 +1590,7 @@ yysetstate:
 # else /* defined YYSTACK_RELOCATE */
       /* Extend the stack our own way.  */
       if (YYMAXDEPTH <= yystacksize)
-        goto yyexhaustedlab;
+        YYNOMEM;
       yystacksize *= 2;
       if (YYMAXDEPTH < yystacksize)
         yystacksize = YYMAXDEPTH;
@@ -1500,10 +1601,10 @@ yysetstate:
           YY_CAST (union yyalloc *,
                    YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
         if (! yyptr)
-          goto yyexhaustedlab;
+          YYNOMEM;
         YYSTACK_RELOCATE (yyss_alloc, yyss);
         YYSTACK_RELOCATE (yyvs_alloc, yyvs);
-# undef YYSTACK_RELOCATE
+#  undef YYSTACK_RELOCATE
         if (yyss1 != yyssa)
           YYSTACK_FREE (yyss1);
       }
@@ -1522,6 +1623,7 @@ yysetstate:
     }
 #endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
 
+
   if (yystate == YYFINAL)
     YYACCEPT;
 
@@ -1542,18 +1644,29 @@ yybackup:
 
   /* Not known => get a lookahead token if don't already have one.  */
 
-  /* YYCHAR is either YYEMPTY or YYEOF or a valid lookahead symbol.  */
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
   if (yychar == YYEMPTY)
     {
-      YYDPRINTF ((stderr, "Reading a token: "));
+      YYDPRINTF ((stderr, "Reading a token\n"));
       yychar = yylex (&yylval, scanner);
     }
 
   if (yychar <= YYEOF)
     {
-      yychar = yytoken = YYEOF;
+      yychar = YYEOF;
+      yytoken = YYSYMBOL_YYEOF;
       YYDPRINTF ((stderr, "Now at end of input.\n"));
     }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      goto yyerrlab1;
+    }
   else
     {
       yytoken = YYTRANSLATE (yychar);
@@ -1622,223 +1735,655 @@ yyreduce:
   YY_REDUCE_PRINT (yyn);
   switch (yyn)
     {
-  case 21:
-#line 185 "yacc_sql.y"
+  case 43: /* prepare: PREPARE ID FROM prepared_command  */
+#line 309 "yacc_sql.y"
+                                     {
+      prepare_init(CONTEXT->ssql, (yyvsp[-2].string), CONTEXT->param_num);
+      CONTEXT->param_num = 0;
+    }
+#line 1745 "yacc_sql.tab.c"
+    break;
+
+  case 48: /* execute: EXECUTE ID SEMICOLON  */
+#line 323 "yacc_sql.y"
+                         {
+      CONTEXT->ssql->flag = SCF_EXECUTE;
+      execute_init(ARENA, &CONTEXT->ssql->sstr.execute, (yyvsp[-1].string), CONTEXT->values, 0);
+    }
+#line 1754 "yacc_sql.tab.c"
+    break;
+
+  case 49: /* execute: EXECUTE ID USING value value_list SEMICOLON  */
+#line 327 "yacc_sql.y"
+                                                  {
+      CONTEXT->ssql->flag = SCF_EXECUTE;
+      execute_init(ARENA, &CONTEXT->ssql->sstr.execute, (yyvsp[-4].string), CONTEXT->values, CONTEXT->value_length);
+      CONTEXT->value_length = 0;
+    }
+#line 1764 "yacc_sql.tab.c"
+    break;
+
+  case 50: /* deallocate: DEALLOCATE PREPARE ID SEMICOLON  */
+#line 335 "yacc_sql.y"
+                                    {
+      CONTEXT->ssql->flag = SCF_DEALLOCATE;
+      deallocate_init(ARENA, &CONTEXT->ssql->sstr.deallocate, (yyvsp[-1].string));
+    }
+#line 1773 "yacc_sql.tab.c"
+    break;
+
+  case 51: /* exit: EXIT SEMICOLON  */
+#line 342 "yacc_sql.y"
                    {
         CONTEXT->ssql->flag=SCF_EXIT;//"exit";
     }
-#line 1631 "yacc_sql.tab.c"
+#line 1781 "yacc_sql.tab.c"
     break;
 
-  case 22:
-#line 190 "yacc_sql.y"
+  case 52: /* help: HELP SEMICOLON  */
+#line 347 "yacc_sql.y"
                    {
         CONTEXT->ssql->flag=SCF_HELP;//"help";
     }
-#line 1639 "yacc_sql.tab.c"
+#line 1789 "yacc_sql.tab.c"
     break;
 
-  case 23:
-#line 195 "yacc_sql.y"
+  case 53: /* sync: SYNC SEMICOLON  */
+#line 352 "yacc_sql.y"
                    {
       CONTEXT->ssql->flag = SCF_SYNC;
     }
-#line 1647 "yacc_sql.tab.c"
+#line 1797 "yacc_sql.tab.c"
     break;
 
-  case 24:
-#line 201 "yacc_sql.y"
+  case 54: /* begin: TRX_BEGIN SEMICOLON  */
+#line 358 "yacc_sql.y"
                         {
       CONTEXT->ssql->flag = SCF_BEGIN;
     }
-#line 1655 "yacc_sql.tab.c"
+#line 1805 "yacc_sql.tab.c"
     break;
 
-  case 25:
-#line 207 "yacc_sql.y"
+  case 55: /* commit: TRX_COMMIT SEMICOLON  */
+#line 364 "yacc_sql.y"
                          {
       CONTEXT->ssql->flag = SCF_COMMIT;
     }
-#line 1663 "yacc_sql.tab.c"
+#line 1813 "yacc_sql.tab.c"
     break;
 
-  case 26:
-#line 213 "yacc_sql.y"
+  case 56: /* rollback: TRX_ROLLBACK SEMICOLON  */
+#line 370 "yacc_sql.y"
                            {
       CONTEXT->ssql->flag = SCF_ROLLBACK;
     }
-#line 1671 "yacc_sql.tab.c"
+#line 1821 "yacc_sql.tab.c"
     break;
 
-  case 27:
-#line 219 "yacc_sql.y"
-                            {
-        CONTEXT->ssql->flag = SCF_DROP_TABLE;//"drop_table";
-        drop_table_init(&CONTEXT->ssql->sstr.drop_table, (yyvsp[-1].string));
+  case 57: /* savepoint: SAVEPOINT ID SEMICOLON  */
+#line 376 "yacc_sql.y"
+                           {
+      CONTEXT->ssql->flag = SCF_SAVEPOINT;
+      savepoint_init(ARENA, &CONTEXT->ssql->sstr.savepoint, (yyvsp[-1].string));
     }
-#line 1680 "yacc_sql.tab.c"
+#line 1830 "yacc_sql.tab.c"
     break;
 
-  case 28:
-#line 225 "yacc_sql.y"
-                          {
-      CONTEXT->ssql->flag = SCF_SHOW_TABLES;
+  case 58: /* rollback_to_savepoint: TRX_ROLLBACK TO ID SEMICOLON  */
+#line 383 "yacc_sql.y"
+                                 {
+      CONTEXT->ssql->flag = SCF_ROLLBACK_TO_SAVEPOINT;
+      savepoint_init(ARENA, &CONTEXT->ssql->sstr.savepoint, (yyvsp[-1].string));
     }
-#line 1688 "yacc_sql.tab.c"
+#line 1839 "yacc_sql.tab.c"
     break;
 
-  case 29:
-#line 231 "yacc_sql.y"
-                      {
-      CONTEXT->ssql->flag = SCF_DESC_TABLE;
-      desc_table_init(&CONTEXT->ssql->sstr.desc_table, (yyvsp[-1].string));
+  case 59: /* rollback_to_savepoint: TRX_ROLLBACK TO SAVEPOINT ID SEMICOLON  */
+#line 387 "yacc_sql.y"
+                                             {
+      CONTEXT->ssql->flag = SCF_ROLLBACK_TO_SAVEPOINT;
+      savepoint_init(ARENA, &CONTEXT->ssql->sstr.savepoint, (yyvsp[-1].string));
     }
-#line 1697 "yacc_sql.tab.c"
+#line 1848 "yacc_sql.tab.c"
     break;
 
-  case 30:
-#line 239 "yacc_sql.y"
-                {
-			CONTEXT->ssql->flag = SCF_CREATE_INDEX;//"create_index";
-			create_index_init(&CONTEXT->ssql->sstr.create_index, (yyvsp[-6].string), (yyvsp[-4].string), (yyvsp[-2].string));
-		}
-#line 1706 "yacc_sql.tab.c"
+  case 60: /* release_savepoint: RELEASE SAVEPOINT ID SEMICOLON  */
+#line 394 "yacc_sql.y"
+                                   {
+      CONTEXT->ssql->flag = SCF_RELEASE_SAVEPOINT;
+      savepoint_init(ARENA, &CONTEXT->ssql->sstr.savepoint, (yyvsp[-1].string));
+    }
+#line 1857 "yacc_sql.tab.c"
     break;
 
-  case 31:
-#line 247 "yacc_sql.y"
-                {
-			CONTEXT->ssql->flag=SCF_DROP_INDEX;//"drop_index";
-			drop_index_init(&CONTEXT->ssql->sstr.drop_index, (yyvsp[-1].string));
-		}
-#line 1715 "yacc_sql.tab.c"
+  case 61: /* set_variable: SET ID EQ ID SEMICOLON  */
+#line 401 "yacc_sql.y"
+                           {
+      CONTEXT->ssql->flag = SCF_SET_VARIABLE;
+      set_variable_init(ARENA, &CONTEXT->ssql->sstr.set_variable, (yyvsp[-3].string), (yyvsp[-1].string));
+    }
+#line 1866 "yacc_sql.tab.c"
     break;
 
-  case 32:
-#line 254 "yacc_sql.y"
-                {
-			CONTEXT->ssql->flag=SCF_CREATE_TABLE;//"create_table";
-			// CONTEXT->ssql->sstr.create_table.attribute_count = CONTEXT->value_length;
-			create_table_init_name(&CONTEXT->ssql->sstr.create_table, (yyvsp[-5].string));
-			//临时变量清零	
-			CONTEXT->value_length = 0;
-		}
-#line 1727 "yacc_sql.tab.c"
+  case 62: /* set_variable: SET ID EQ ON SEMICOLON  */
+#line 405 "yacc_sql.y"
+                             {
+      CONTEXT->ssql->flag = SCF_SET_VARIABLE;
+      set_variable_init(ARENA, &CONTEXT->ssql->sstr.set_variable, (yyvsp[-3].string), "on");
+    }
+#line 1875 "yacc_sql.tab.c"
     break;
 
-  case 34:
-#line 264 "yacc_sql.y"
-                                   {    }
-#line 1733 "yacc_sql.tab.c"
+  case 63: /* set_variable: SET ID EQ NUMBER SEMICOLON  */
+#line 409 "yacc_sql.y"
+                                 {
+      CONTEXT->ssql->flag = SCF_SET_VARIABLE;
+      set_variable_init(ARENA, &CONTEXT->ssql->sstr.set_variable, (yyvsp[-3].string), number_to_str(ARENA, (yyvsp[-1].number)));
+    }
+#line 1884 "yacc_sql.tab.c"
     break;
 
-  case 35:
-#line 269 "yacc_sql.y"
-                {
-			AttrInfo attribute;
-			attr_info_init(&attribute, CONTEXT->id, (yyvsp[-4].number), (yyvsp[-2].number), (yyvsp[0].number));
-			create_table_append_attribute(&CONTEXT->ssql->sstr.create_table, &attribute);
-			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].name =(char*)malloc(sizeof(char));
-			// strcpy(CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].name, CONTEXT->id); 
-			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].type = $2;  
-			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].length = $4;
-			CONTEXT->value_length++;
-		}
-#line 1748 "yacc_sql.tab.c"
+  case 64: /* drop_table: DROP TABLE ID SEMICOLON  */
+#line 416 "yacc_sql.y"
+                            {
+        CONTEXT->ssql->flag = SCF_DROP_TABLE;//"drop_table";
+        drop_table_init(ARENA, &CONTEXT->ssql->sstr.drop_table, (yyvsp[-1].string));
+    }
+#line 1893 "yacc_sql.tab.c"
     break;
 
-  case 36:
-#line 280 "yacc_sql.y"
-                {
-			AttrInfo attribute;
-			attr_info_init(&attribute, CONTEXT->id, (yyvsp[-1].number), 4, (yyvsp[0].number));
-			create_table_append_attribute(&CONTEXT->ssql->sstr.create_table, &attribute);
-			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].name=(char*)malloc(sizeof(char));
-			// strcpy(CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].name, CONTEXT->id); 
-			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].type=$2;  
-			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].length=4; // default attribute length
-			CONTEXT->value_length++;
-		}
-#line 1763 "yacc_sql.tab.c"
+  case 65: /* create_view: CREATE ID ID ID ID select  */
+#line 422 "yacc_sql.y"
+                              {
+        // create materialized view名字as select ...，materialized、view和as不作为关键字
+        if (strcasecmp((yyvsp[-4].string), "materialized") != 0 || strcasecmp((yyvsp[-3].string), "view") != 0 || strcasecmp((yyvsp[-1].string), "as") != 0) {
+            yyerror(scanner, "unknown create statement");
+            YYABORT;
+        }
+        create_view_init(CONTEXT->ssql, (yyvsp[-2].string));
+    }
+#line 1906 "yacc_sql.tab.c"
     break;
 
-  case 37:
-#line 293 "yacc_sql.y"
-                  {
-		(yyval.number) = ISFALSE; // 默认允许null
-	}
-#line 1771 "yacc_sql.tab.c"
+  case 66: /* drop_view: DROP ID ID ID SEMICOLON  */
+#line 433 "yacc_sql.y"
+                            {
+        // 物化视图也是一张表，删除视图就是删除这张表
+        if (strcasecmp((yyvsp[-3].string), "materialized") != 0 || strcasecmp((yyvsp[-2].string), "view") != 0) {
+            yyerror(scanner, "unknown drop statement");
+            YYABORT;
+        }
+        CONTEXT->ssql->flag = SCF_DROP_TABLE;
+        drop_table_init(ARENA, &CONTEXT->ssql->sstr.drop_table, (yyvsp[-1].string));
+    }
+#line 1920 "yacc_sql.tab.c"
     break;
 
-  case 38:
-#line 296 "yacc_sql.y"
-                     {
-		(yyval.number) = ISFALSE;
-	}
-#line 1779 "yacc_sql.tab.c"
+  case 67: /* truncate_table: TRUNCATE TABLE ID SEMICOLON  */
+#line 445 "yacc_sql.y"
+                                {
+        CONTEXT->ssql->flag = SCF_TRUNCATE_TABLE;
+        truncate_table_init(ARENA, &CONTEXT->ssql->sstr.truncate_table, (yyvsp[-1].string));
+    }
+#line 1929 "yacc_sql.tab.c"
     break;
 
-  case 39:
-#line 299 "yacc_sql.y"
-                   {
-		(yyval.number) = ISTRUE;
-	}
-#line 1787 "yacc_sql.tab.c"
+  case 68: /* analyze_table: ANALYZE TABLE ID SEMICOLON  */
+#line 451 "yacc_sql.y"
+                               {
+        CONTEXT->ssql->flag = SCF_ANALYZE_TABLE;
+        analyze_table_init(ARENA, &CONTEXT->ssql->sstr.analyze_table, (yyvsp[-1].string));
+    }
+#line 1938 "yacc_sql.tab.c"
     break;
 
-  case 40:
-#line 305 "yacc_sql.y"
-                       {(yyval.number) = (yyvsp[0].number);}
-#line 1793 "yacc_sql.tab.c"
+  case 69: /* alter_table: ALTER TABLE ID DROP PARTITION ID SEMICOLON  */
+#line 457 "yacc_sql.y"
+                                               {
+        // 删除range分区的数据文件和索引文件，不用逐条删除记录
+        CONTEXT->ssql->flag = SCF_DROP_PARTITION;
+        drop_partition_init(ARENA, &CONTEXT->ssql->sstr.drop_partition, (yyvsp[-4].string), (yyvsp[-1].string));
+    }
+#line 1948 "yacc_sql.tab.c"
     break;
 
-  case 41:
-#line 308 "yacc_sql.y"
-              { 
-		(yyval.number)=INTS; 
-		// printf("CREATE 语句语法解析 type 为 INTS\n");
-	}
-#line 1802 "yacc_sql.tab.c"
+  case 70: /* show_tables: SHOW TABLES SEMICOLON  */
+#line 465 "yacc_sql.y"
+                          {
+      CONTEXT->ssql->flag = SCF_SHOW_TABLES;
+    }
+#line 1956 "yacc_sql.tab.c"
     break;
 
-  case 42:
-#line 312 "yacc_sql.y"
-                  { 
-		   (yyval.number)=CHARS;
-		// printf("CREATE 语句语法解析 type 为 STRING_T\n");
-	}
-#line 1811 "yacc_sql.tab.c"
+  case 71: /* show_buffer_pool: SHOW ID ID ID SEMICOLON  */
+#line 471 "yacc_sql.y"
+                            {
+      // buffer/pool/status 不是关键字，避免和同名的表或字段冲突
+      if (strcasecmp((yyvsp[-3].string), "buffer") != 0 || strcasecmp((yyvsp[-2].string), "pool") != 0 || strcasecmp((yyvsp[-1].string), "status") != 0) {
+        yyerror(scanner, "unknown show command");
+        YYABORT;
+      }
+      CONTEXT->ssql->flag = SCF_SHOW_BUFFER_POOL;
+    }
+#line 1969 "yacc_sql.tab.c"
     break;
 
-  case 43:
-#line 316 "yacc_sql.y"
-                 { 
-		   (yyval.number)=FLOATS;
-		// printf("CREATE 语句语法解析 type 为 FLOAT_T\n");
-	}
-#line 1820 "yacc_sql.tab.c"
+  case 72: /* show_statement_stats: SHOW ID ID SEMICOLON  */
+#line 482 "yacc_sql.y"
+                         {
+      if (strcasecmp((yyvsp[-2].string), "statement") != 0 || strcasecmp((yyvsp[-1].string), "stats") != 0) {
+        yyerror(scanner, "unknown show command");
+        YYABORT;
+      }
+      CONTEXT->ssql->flag = SCF_SHOW_STATEMENT_STATS;
+    }
+#line 1981 "yacc_sql.tab.c"
     break;
 
-  case 44:
-#line 320 "yacc_sql.y"
-                    { 
-		   (yyval.number)=DATES;
-		// printf("CREATE 语句语法解析 type 为 DATE_T\n");
-	}
-#line 1829 "yacc_sql.tab.c"
+  case 73: /* reset_statement_stats: TRUNCATE ID ID SEMICOLON  */
+#line 492 "yacc_sql.y"
+                             {
+      if (strcasecmp((yyvsp[-2].string), "statement") != 0 || strcasecmp((yyvsp[-1].string), "stats") != 0) {
+        yyerror(scanner, "unknown truncate command");
+        YYABORT;
+      }
+      CONTEXT->ssql->flag = SCF_RESET_STATEMENT_STATS;
+    }
+#line 1993 "yacc_sql.tab.c"
     break;
 
-  case 45:
-#line 327 "yacc_sql.y"
-        {
-		char *temp=(yyvsp[0].string); 
-		snprintf(CONTEXT->id, sizeof(CONTEXT->id), "%s", temp);
-	}
-#line 1838 "yacc_sql.tab.c"
-    break;
+  case 74: /* show_processlist: SHOW ID SEMICOLON  */
+#line 502 "yacc_sql.y"
+                      {
+      if (strcasecmp((yyvsp[-1].string), "processlist") != 0) {
+        yyerror(scanner, "unknown show command");
+        YYABORT;
+      }
+      CONTEXT->ssql->flag = SCF_SHOW_PROCESSLIST;
+    }
+#line 2005 "yacc_sql.tab.c"
+    break;
+
+  case 75: /* kill_query: ID ID NUMBER SEMICOLON  */
+#line 512 "yacc_sql.y"
+                           {
+      // kill/query 不是关键字
+      if (strcasecmp((yyvsp[-3].string), "kill") != 0 || strcasecmp((yyvsp[-2].string), "query") != 0) {
+        yyerror(scanner, "unknown command");
+        YYABORT;
+      }
+      CONTEXT->ssql->flag = SCF_KILL_QUERY;
+      CONTEXT->ssql->sstr.kill_query.connection_id = (yyvsp[-1].number);
+    }
+#line 2019 "yacc_sql.tab.c"
+    break;
+
+  case 76: /* desc_table: DESC ID SEMICOLON  */
+#line 524 "yacc_sql.y"
+                      {
+      CONTEXT->ssql->flag = SCF_DESC_TABLE;
+      desc_table_init(ARENA, &CONTEXT->ssql->sstr.desc_table, (yyvsp[-1].string));
+    }
+#line 2028 "yacc_sql.tab.c"
+    break;
+
+  case 77: /* create_index: CREATE INDEX ID ON ID LBRACE index_attr_list RBRACE opt_index_using SEMICOLON  */
+#line 532 "yacc_sql.y"
+                {
+			CONTEXT->ssql->flag = SCF_CREATE_INDEX;//"create_index";
+			create_index_init(ARENA, &CONTEXT->ssql->sstr.create_index, (yyvsp[-7].string), (yyvsp[-5].string), 0);
+		}
+#line 2037 "yacc_sql.tab.c"
+    break;
+
+  case 78: /* create_index: CREATE ID INDEX ID ON ID LBRACE index_attr_list RBRACE opt_index_using SEMICOLON  */
+#line 537 "yacc_sql.y"
+                {
+			// unique 不是关键字，避免和同名的表或字段冲突
+			if (strcasecmp((yyvsp[-9].string), "unique") != 0) {
+				yyerror(scanner, "unknown create index option");
+				YYABORT;
+			}
+			CONTEXT->ssql->flag = SCF_CREATE_INDEX;
+			create_index_init(ARENA, &CONTEXT->ssql->sstr.create_index, (yyvsp[-7].string), (yyvsp[-5].string), 1);
+		}
+#line 2051 "yacc_sql.tab.c"
+    break;
+
+  case 80: /* opt_index_using: ID ID  */
+#line 549 "yacc_sql.y"
+            {
+			// using btree/hash，和unique一样不作为关键字
+			if (strcasecmp((yyvsp[-1].string), "using") != 0) {
+				yyerror(scanner, "unknown create index option");
+				YYABORT;
+			}
+			if (strcasecmp((yyvsp[0].string), "hash") == 0) {
+				create_index_set_type(&CONTEXT->ssql->sstr.create_index, HASH_INDEX);
+			} else if (strcasecmp((yyvsp[0].string), "btree") == 0) {
+				create_index_set_type(&CONTEXT->ssql->sstr.create_index, BPLUS_TREE_INDEX);
+			} else {
+				yyerror(scanner, "unknown index type");
+				YYABORT;
+			}
+		}
+#line 2071 "yacc_sql.tab.c"
+    break;
+
+  case 83: /* index_attr: ID  */
+#line 570 "yacc_sql.y"
+       {
+			// 多字段索引，字段按照书写的顺序比较
+			if (CONTEXT->ssql->sstr.create_index.attribute_num >= MAX_NUM) {
+				yyerror(scanner, "too many index attributes");
+				YYABORT;
+			}
+			create_index_append_attribute(ARENA, &CONTEXT->ssql->sstr.create_index, (yyvsp[0].string), 0);
+		}
+#line 2084 "yacc_sql.tab.c"
+    break;
+
+  case 84: /* index_attr: ID LBRACE NUMBER RBRACE  */
+#line 578 "yacc_sql.y"
+                              {
+			// name(8)：字符串字段只把前8个字符放到索引中
+			if (CONTEXT->ssql->sstr.create_index.attribute_num >= MAX_NUM) {
+				yyerror(scanner, "too many index attributes");
+				YYABORT;
+			}
+			if ((yyvsp[-1].number) <= 0) {
+				yyerror(scanner, "invalid index prefix length");
+				YYABORT;
+			}
+			create_index_append_attribute(ARENA, &CONTEXT->ssql->sstr.create_index, (yyvsp[-3].string), (yyvsp[-1].number));
+		}
+#line 2101 "yacc_sql.tab.c"
+    break;
+
+  case 85: /* drop_index: DROP INDEX ID SEMICOLON  */
+#line 594 "yacc_sql.y"
+                {
+			CONTEXT->ssql->flag=SCF_DROP_INDEX;//"drop_index";
+			drop_index_init(ARENA, &CONTEXT->ssql->sstr.drop_index, (yyvsp[-1].string));
+		}
+#line 2110 "yacc_sql.tab.c"
+    break;
+
+  case 86: /* create_table: CREATE TABLE ID LBRACE attr_def attr_def_list RBRACE table_option_list opt_partition SEMICOLON  */
+#line 601 "yacc_sql.y"
+                {
+			CONTEXT->ssql->flag=SCF_CREATE_TABLE;//"create_table";
+			// CONTEXT->ssql->sstr.create_table.attribute_count = CONTEXT->value_length;
+			create_table_init_name(ARENA, &CONTEXT->ssql->sstr.create_table, (yyvsp[-7].string));
+			//临时变量清零	
+			CONTEXT->value_length = 0;
+		}
+#line 2122 "yacc_sql.tab.c"
+    break;
+
+  case 88: /* table_option_list: table_option table_option_list  */
+#line 611 "yacc_sql.y"
+                                     {    }
+#line 2128 "yacc_sql.tab.c"
+    break;
+
+  case 89: /* table_option: ID EQ NUMBER  */
+#line 614 "yacc_sql.y"
+                 {
+			// page_size=<字节数>，单独建表时指定页面大小
+			if (strcasecmp((yyvsp[-2].string), "page_size") != 0) {
+				yyerror(scanner, "unknown table option");
+				YYABORT;
+			}
+			create_table_set_page_size(&CONTEXT->ssql->sstr.create_table, (yyvsp[0].number));
+		}
+#line 2141 "yacc_sql.tab.c"
+    break;
+
+  case 90: /* table_option: ID EQ ID  */
+#line 622 "yacc_sql.y"
+               {
+			// compression=<none|zlib|lz4|zstd>，数据文件的页面压缩方式
+			// format=<row|pax>，数据文件中记录的存放方式
+			// engine=<disk|memory>，memory的表只保存在内存中
+			// bloom_filter=<字段>，记录文件的每个区段为这个字段建布隆过滤器
+			// dictionary=<字段>，CHARS字段用字典编码，可以指定多次
+			if (strcasecmp((yyvsp[-2].string), "compression") == 0) {
+				create_table_set_compression(ARENA, &CONTEXT->ssql->sstr.create_table, (yyvsp[0].string));
+			} else if (strcasecmp((yyvsp[-2].string), "format") == 0) {
+				create_table_set_format(ARENA, &CONTEXT->ssql->sstr.create_table, (yyvsp[0].string));
+			} else if (strcasecmp((yyvsp[-2].string), "engine") == 0) {
+				create_table_set_engine(ARENA, &CONTEXT->ssql->sstr.create_table, (yyvsp[0].string));
+			} else if (strcasecmp((yyvsp[-2].string), "bloom_filter") == 0) {
+				create_table_set_bloom_filter(ARENA, &CONTEXT->ssql->sstr.create_table, (yyvsp[0].string));
+			} else if (strcasecmp((yyvsp[-2].string), "dictionary") == 0) {
+				if (create_table_set_dictionary(&CONTEXT->ssql->sstr.create_table, (yyvsp[0].string)) != 0) {
+					yyerror(scanner, "dictionary field must be a chars field of the table");
+					YYABORT;
+				}
+			} else {
+				yyerror(scanner, "unknown table option");
+				YYABORT;
+			}
+		}
+#line 2170 "yacc_sql.tab.c"
+    break;
+
+  case 92: /* opt_partition: PARTITION BY ID LBRACE ID RBRACE LBRACE range_partition range_partition_list RBRACE  */
+#line 649 "yacc_sql.y"
+                                                                                          {
+			// partition by range(字段) (partition 名字 values less than (值), ...)
+			if (strcasecmp((yyvsp[-7].string), "range") != 0) {
+				yyerror(scanner, "unknown partition type");
+				YYABORT;
+			}
+			create_table_set_partition(ARENA, &CONTEXT->ssql->sstr.create_table, RANGE_PARTITION, (yyvsp[-5].string));
+		}
+#line 2183 "yacc_sql.tab.c"
+    break;
+
+  case 93: /* opt_partition: PARTITION BY ID LBRACE ID RBRACE ID NUMBER  */
+#line 657 "yacc_sql.y"
+                                                 {
+			// partition by hash(字段) partitions 个数
+			if (strcasecmp((yyvsp[-5].string), "hash") != 0 || strcasecmp((yyvsp[-1].string), "partitions") != 0) {
+				yyerror(scanner, "unknown partition type");
+				YYABORT;
+			}
+			if ((yyvsp[0].number) <= 0 || (yyvsp[0].number) > MAX_PARTITION_NUM) {
+				yyerror(scanner, "invalid partition number");
+				YYABORT;
+			}
+			create_table_set_partition(ARENA, &CONTEXT->ssql->sstr.create_table, HASH_PARTITION, (yyvsp[-3].string));
+			create_table_set_hash_partitions(&CONTEXT->ssql->sstr.create_table, (yyvsp[0].number));
+		}
+#line 2201 "yacc_sql.tab.c"
+    break;
+
+  case 95: /* range_partition_list: COMMA range_partition range_partition_list  */
+#line 673 "yacc_sql.y"
+                                                 {    }
+#line 2207 "yacc_sql.tab.c"
+    break;
+
+  case 96: /* range_partition: PARTITION ID VALUES ID ID LBRACE value RBRACE  */
+#line 676 "yacc_sql.y"
+                                                  {
+			const Value *bound = &CONTEXT->values[CONTEXT->value_length - 1];
+			if (strcasecmp((yyvsp[-4].string), "less") != 0 || strcasecmp((yyvsp[-3].string), "than") != 0 || bound->type == UNDEFINED ||
+			    bound->is_null) {
+				yyerror(scanner, "invalid partition bound");
+				YYABORT;
+			}
+			if (CONTEXT->ssql->sstr.create_table.partition.partition_num >= MAX_PARTITION_NUM) {
+				yyerror(scanner, "too many partitions");
+				YYABORT;
+			}
+			create_table_append_range_partition(ARENA, &CONTEXT->ssql->sstr.create_table, (yyvsp[-6].string), bound);
+		}
+#line 2225 "yacc_sql.tab.c"
+    break;
+
+  case 97: /* range_partition: PARTITION ID VALUES ID ID ID  */
+#line 689 "yacc_sql.y"
+                                   {
+			// maxvalue只能是最后一个分区，建表时检查
+			if (strcasecmp((yyvsp[-2].string), "less") != 0 || strcasecmp((yyvsp[-1].string), "than") != 0 || strcasecmp((yyvsp[0].string), "maxvalue") != 0) {
+				yyerror(scanner, "invalid partition bound");
+				YYABORT;
+			}
+			if (CONTEXT->ssql->sstr.create_table.partition.partition_num >= MAX_PARTITION_NUM) {
+				yyerror(scanner, "too many partitions");
+				YYABORT;
+			}
+			create_table_append_range_partition(ARENA, &CONTEXT->ssql->sstr.create_table, (yyvsp[-4].string), NULL);
+		}
+#line 2242 "yacc_sql.tab.c"
+    break;
+
+  case 99: /* attr_def_list: COMMA attr_def attr_def_list  */
+#line 704 "yacc_sql.y"
+                                   {    }
+#line 2248 "yacc_sql.tab.c"
+    break;
+
+  case 100: /* attr_def_list: COMMA primary_key  */
+#line 705 "yacc_sql.y"
+                        {    }
+#line 2254 "yacc_sql.tab.c"
+    break;
+
+  case 101: /* primary_key: ID ID LBRACE primary_key_attr_list RBRACE  */
+#line 708 "yacc_sql.y"
+                                              {
+			// primary key(字段, ...)写在所有字段的后面，primary和key不作为关键字
+			if (strcasecmp((yyvsp[-4].string), "primary") != 0 || strcasecmp((yyvsp[-3].string), "key") != 0) {
+				yyerror(scanner, "unknown table constraint");
+				YYABORT;
+			}
+		}
+#line 2266 "yacc_sql.tab.c"
+    break;
+
+  case 104: /* primary_key_attr: ID  */
+#line 721 "yacc_sql.y"
+       {
+			if (CONTEXT->ssql->sstr.create_table.primary_key_num >= MAX_NUM) {
+				yyerror(scanner, "too many primary key attributes");
+				YYABORT;
+			}
+			create_table_append_primary_key(ARENA, &CONTEXT->ssql->sstr.create_table, (yyvsp[0].string));
+		}
+#line 2278 "yacc_sql.tab.c"
+    break;
+
+  case 105: /* attr_def: ID_get type LBRACE number RBRACE opt_null  */
+#line 732 "yacc_sql.y"
+                {
+			AttrInfo attribute;
+			attr_info_init(ARENA, &attribute, CONTEXT->id, (yyvsp[-4].number), (yyvsp[-2].number), (yyvsp[0].number));
+			create_table_append_attribute(&CONTEXT->ssql->sstr.create_table, &attribute);
+			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].name =(char*)malloc(sizeof(char));
+			// strcpy(CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].name, CONTEXT->id); 
+			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].type = $2;  
+			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].length = $4;
+			CONTEXT->value_length++;
+		}
+#line 2293 "yacc_sql.tab.c"
+    break;
+
+  case 106: /* attr_def: ID_get type opt_null  */
+#line 743 "yacc_sql.y"
+                {
+			AttrInfo attribute;
+			attr_info_init(ARENA, &attribute, CONTEXT->id, (yyvsp[-1].number), 4, (yyvsp[0].number));
+			create_table_append_attribute(&CONTEXT->ssql->sstr.create_table, &attribute);
+			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].name=(char*)malloc(sizeof(char));
+			// strcpy(CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].name, CONTEXT->id); 
+			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].type=$2;  
+			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].length=4; // default attribute length
+			CONTEXT->value_length++;
+		}
+#line 2308 "yacc_sql.tab.c"
+    break;
+
+  case 107: /* opt_null: %empty  */
+#line 756 "yacc_sql.y"
+                  {
+		(yyval.number) = ISFALSE; // 默认允许null
+	}
+#line 2316 "yacc_sql.tab.c"
+    break;
+
+  case 108: /* opt_null: NOT NULL_T  */
+#line 759 "yacc_sql.y"
+                     {
+		(yyval.number) = ISFALSE;
+	}
+#line 2324 "yacc_sql.tab.c"
+    break;
+
+  case 109: /* opt_null: NULLABLE  */
+#line 762 "yacc_sql.y"
+                   {
+		(yyval.number) = ISTRUE;
+	}
+#line 2332 "yacc_sql.tab.c"
+    break;
 
-  case 46:
-#line 336 "yacc_sql.y"
+  case 110: /* number: NUMBER  */
+#line 768 "yacc_sql.y"
+                       {(yyval.number) = (yyvsp[0].number);}
+#line 2338 "yacc_sql.tab.c"
+    break;
+
+  case 111: /* type: INT_T  */
+#line 771 "yacc_sql.y"
+              { 
+		(yyval.number)=INTS; 
+		// printf("CREATE 语句语法解析 type 为 INTS\n");
+	}
+#line 2347 "yacc_sql.tab.c"
+    break;
+
+  case 112: /* type: STRING_T  */
+#line 775 "yacc_sql.y"
+                  { 
+		   (yyval.number)=CHARS;
+		// printf("CREATE 语句语法解析 type 为 STRING_T\n");
+	}
+#line 2356 "yacc_sql.tab.c"
+    break;
+
+  case 113: /* type: FLOAT_T  */
+#line 779 "yacc_sql.y"
+                 { 
+		   (yyval.number)=FLOATS;
+		// printf("CREATE 语句语法解析 type 为 FLOAT_T\n");
+	}
+#line 2365 "yacc_sql.tab.c"
+    break;
+
+  case 114: /* type: DATE_T  */
+#line 783 "yacc_sql.y"
+                    { 
+		   (yyval.number)=DATES;
+		// printf("CREATE 语句语法解析 type 为 DATE_T\n");
+	}
+#line 2374 "yacc_sql.tab.c"
+    break;
+
+  case 115: /* ID_get: ID  */
+#line 790 "yacc_sql.y"
+        {
+		char *temp=(yyvsp[0].string); 
+		snprintf(CONTEXT->id, sizeof(CONTEXT->id), "%s", temp);
+	}
+#line 2383 "yacc_sql.tab.c"
+    break;
+
+  case 116: /* insert: INSERT INTO ID_get VALUES multi_values SEMICOLON  */
+#line 799 "yacc_sql.y"
         {
 			// CONTEXT->values[CONTEXT->value_length++] = *$6;
 
@@ -1848,764 +2393,1068 @@ yyreduce:
 			// for(i = 0; i < CONTEXT->value_length; i++){
 			// 	CONTEXT->ssql->sstr.insertion.values[i] = CONTEXT->values[i];
       // }	// 到此结束所有插入：存储最后一组、index清零、length清零
-	  		inserts_init(&CONTEXT->ssql->sstr.insertion, CONTEXT->id, CONTEXT->values, CONTEXT->value_length, CONTEXT->insert_index);
+	  		inserts_init(ARENA, &CONTEXT->ssql->sstr.insertion, CONTEXT->id, CONTEXT->values, CONTEXT->value_length, CONTEXT->insert_index);
 			CONTEXT->insert_index=0;
 			//临时变量清零
       		CONTEXT->value_length=0;
     }
-#line 1857 "yacc_sql.tab.c"
+#line 2402 "yacc_sql.tab.c"
     break;
 
-  case 47:
-#line 352 "yacc_sql.y"
+  case 117: /* multi_values: LBRACE value value_list RBRACE  */
+#line 815 "yacc_sql.y"
                                        {
 		// 到此结束一组的插入：存储该组、增加index、value_length清零
-		inserts_init(&CONTEXT->ssql->sstr.insertion, CONTEXT->id, CONTEXT->values, CONTEXT->value_length, CONTEXT->insert_index);
+		inserts_init(ARENA, &CONTEXT->ssql->sstr.insertion, CONTEXT->id, CONTEXT->values, CONTEXT->value_length, CONTEXT->insert_index);
 		CONTEXT->insert_index++;
 		//临时变量清零
       	CONTEXT->value_length=0;
 	}
-#line 1869 "yacc_sql.tab.c"
+#line 2414 "yacc_sql.tab.c"
     break;
 
-  case 48:
-#line 359 "yacc_sql.y"
+  case 118: /* multi_values: multi_values COMMA LBRACE value value_list RBRACE  */
+#line 822 "yacc_sql.y"
                                                            {
 		// 到此结束一组的插入：存储该组、增加index、value_length清零
-		inserts_init(&CONTEXT->ssql->sstr.insertion, CONTEXT->id, CONTEXT->values, CONTEXT->value_length, CONTEXT->insert_index);
+		inserts_init(ARENA, &CONTEXT->ssql->sstr.insertion, CONTEXT->id, CONTEXT->values, CONTEXT->value_length, CONTEXT->insert_index);
 		CONTEXT->insert_index++;
 		//临时变量清零
       	CONTEXT->value_length=0;
 	}
-#line 1881 "yacc_sql.tab.c"
+#line 2426 "yacc_sql.tab.c"
     break;
 
-  case 50:
-#line 369 "yacc_sql.y"
+  case 120: /* value_list: COMMA value value_list  */
+#line 832 "yacc_sql.y"
                               { 
   		// CONTEXT->values[CONTEXT->value_length++] = *$2;
 	  }
-#line 1889 "yacc_sql.tab.c"
+#line 2434 "yacc_sql.tab.c"
     break;
 
-  case 51:
-#line 374 "yacc_sql.y"
+  case 121: /* value: NUMBER  */
+#line 837 "yacc_sql.y"
           {	
-  		value_init_integer(&CONTEXT->values[CONTEXT->value_length++], (yyvsp[0].number), false);
+  		value_init_integer(ARENA, &CONTEXT->values[CONTEXT->value_length++], (yyvsp[0].number), false);
 	}
-#line 1897 "yacc_sql.tab.c"
+#line 2442 "yacc_sql.tab.c"
     break;
 
-  case 52:
-#line 377 "yacc_sql.y"
+  case 122: /* value: FLOAT  */
+#line 840 "yacc_sql.y"
           {
-  		value_init_float(&CONTEXT->values[CONTEXT->value_length++], (yyvsp[0].floats), false);
+  		value_init_float(ARENA, &CONTEXT->values[CONTEXT->value_length++], (yyvsp[0].floats), false);
 	}
-#line 1905 "yacc_sql.tab.c"
+#line 2450 "yacc_sql.tab.c"
     break;
 
-  case 53:
-#line 380 "yacc_sql.y"
+  case 123: /* value: NULL_T  */
+#line 843 "yacc_sql.y"
                 {
 		// null不需要加双引号，当作字符串插入
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
+		value_init_string(ARENA, &CONTEXT->values[CONTEXT->value_length++], "NULL", true);
 	}
-#line 1914 "yacc_sql.tab.c"
+#line 2459 "yacc_sql.tab.c"
     break;
 
-  case 54:
-#line 384 "yacc_sql.y"
+  case 124: /* value: SSS  */
+#line 847 "yacc_sql.y"
          {
-		(yyvsp[0].string) = substr((yyvsp[0].string),1,strlen((yyvsp[0].string))-2);
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], (yyvsp[0].string), false);
+		// 去掉两边的引号
+		(yyvsp[0].string)[strlen((yyvsp[0].string)) - 1] = '\0';
+		value_init_string(ARENA, &CONTEXT->values[CONTEXT->value_length++], (yyvsp[0].string) + 1, false);
 		}
-#line 1923 "yacc_sql.tab.c"
+#line 2469 "yacc_sql.tab.c"
+    break;
+
+  case 125: /* value: '?'  */
+#line 852 "yacc_sql.y"
+             {
+		// 预编译语句的参数，按出现的顺序编号
+		value_init_param(ARENA, &CONTEXT->values[CONTEXT->value_length++], CONTEXT->param_num++);
+	}
+#line 2478 "yacc_sql.tab.c"
     break;
 
-  case 55:
-#line 393 "yacc_sql.y"
+  case 126: /* delete: DELETE FROM ID where SEMICOLON  */
+#line 861 "yacc_sql.y"
                 {
 			CONTEXT->ssql->flag = SCF_DELETE;//"delete";
-			deletes_init_relation(&CONTEXT->ssql->sstr.deletion, (yyvsp[-2].string));
+			if (CONTEXT->expr_condition_length > 0) {
+				yyerror(scanner, "expression conditions are only supported in select");
+				YYABORT;
+			}
+			deletes_init_relation(ARENA, &CONTEXT->ssql->sstr.deletion, (yyvsp[-2].string));
 			deletes_set_conditions(&CONTEXT->ssql->sstr.deletion, 
 					CONTEXT->conditions, CONTEXT->condition_length);
 			CONTEXT->condition_length = 0;	
     }
-#line 1935 "yacc_sql.tab.c"
+#line 2494 "yacc_sql.tab.c"
     break;
 
-  case 56:
-#line 403 "yacc_sql.y"
+  case 127: /* update: UPDATE ID SET ID EQ value where SEMICOLON  */
+#line 875 "yacc_sql.y"
                 {
+			if (CONTEXT->expr_condition_length > 0) {
+				yyerror(scanner, "expression conditions are only supported in select");
+				YYABORT;
+			}
 			CONTEXT->ssql->flag = SCF_UPDATE;//"update";
 			Value *value = &CONTEXT->values[0];
-			updates_init(&CONTEXT->ssql->sstr.update, (yyvsp[-6].string), (yyvsp[-4].string), value, 
+			updates_init(ARENA, &CONTEXT->ssql->sstr.update, (yyvsp[-6].string), (yyvsp[-4].string), value, 
 					CONTEXT->conditions, CONTEXT->condition_length);
 			CONTEXT->condition_length = 0;
 		}
-#line 1947 "yacc_sql.tab.c"
+#line 2510 "yacc_sql.tab.c"
+    break;
+
+  case 128: /* explain: EXPLAIN select  */
+#line 888 "yacc_sql.y"
+                   {
+        selects_set_explain(&CONTEXT->ssql->sstr.selection, EXPLAIN_PLAN);
+    }
+#line 2518 "yacc_sql.tab.c"
+    break;
+
+  case 129: /* explain: EXPLAIN ANALYZE select  */
+#line 891 "yacc_sql.y"
+                             {
+        selects_set_explain(&CONTEXT->ssql->sstr.selection, EXPLAIN_ANALYZE);
+    }
+#line 2526 "yacc_sql.tab.c"
     break;
 
-  case 57:
-#line 413 "yacc_sql.y"
+  case 130: /* select: SELECT opt_distinct select_attr FROM ID rel_list join_list where group_by order_by limit opt_outfile SEMICOLON  */
+#line 898 "yacc_sql.y"
             {
 			CONTEXT->ssql->flag=SCF_SELECT;//"select";
 
-			// CONTEXT->ssql->sstr.selection.relations[CONTEXT->from_length++]=$4;
-			selects_append_relation(&CONTEXT->ssql->sstr.selection, (yyvsp[-6].string));
+			// CONTEXT->ssql->sstr.selection.relations[CONTEXT->from_length++]=$5;
+			selects_append_relation(ARENA, current_selects(CONTEXT), (yyvsp[-8].string));
 
 			//selects_append_conditions(&CONTEXT->ssql->sstr.selection, CONTEXT->conditions, CONTEXT->condition_length);
-			selects_append_conditions(CONTEXT->ssql, CONTEXT->conditions, CONTEXT->condition_length);
+			selects_append_conditions(CONTEXT->ssql, current_selects(CONTEXT), CONTEXT->conditions, CONTEXT->condition_length);
+			selects_append_expr_conditions(current_selects(CONTEXT), CONTEXT->expr_conditions, CONTEXT->expr_condition_length);
 			
 			// CONTEXT->ssql->sstr.selection.attr_num = CONTEXT->select_length;
 			
 			//临时变量清零
 			CONTEXT->condition_length=0;
+			CONTEXT->expr_condition_length=0;
 			CONTEXT->from_length=0;
 			CONTEXT->select_length=0;
 			CONTEXT->value_length = 0;
 	    }
-#line 1969 "yacc_sql.tab.c"
+#line 2550 "yacc_sql.tab.c"
     break;
 
-  case 58:
-#line 432 "yacc_sql.y"
+  case 132: /* opt_outfile: INTO ID SSS  */
+#line 920 "yacc_sql.y"
+                  {
+        // outfile不作为关键字
+        if (strcasecmp((yyvsp[-1].string), "outfile") != 0) {
+            yyerror(scanner, "unknown select into");
+            YYABORT;
+        }
+        selects_set_outfile(ARENA, current_selects(CONTEXT), (yyvsp[0].string));
+    }
+#line 2563 "yacc_sql.tab.c"
+    break;
+
+  case 134: /* opt_distinct: DISTINCT  */
+#line 931 "yacc_sql.y"
+               {
+			current_selects(CONTEXT)->distinct = 1;
+		}
+#line 2571 "yacc_sql.tab.c"
+    break;
+
+  case 135: /* select_attr: STAR  */
+#line 936 "yacc_sql.y"
          {  // select *
 			RelAttr attr;
-			relation_attr_init(&attr, NULL, "*", NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+			relation_attr_init(ARENA, &attr, NULL, "*", NULL, 0);
+			selects_append_attribute(current_selects(CONTEXT), &attr);
 		}
-#line 1979 "yacc_sql.tab.c"
+#line 2581 "yacc_sql.tab.c"
     break;
 
-  case 59:
-#line 437 "yacc_sql.y"
-                   { // select age
-			RelAttr attr;
-			relation_attr_init(&attr, NULL, (yyvsp[-1].string), NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+  case 136: /* select_attr: select_item attr_list  */
+#line 941 "yacc_sql.y"
+                            {
+			// 和from中的表一样，select中的列按照相反的顺序保存
+			selects_append_attribute(current_selects(CONTEXT), (yyvsp[-1].attr));
 		}
-#line 1989 "yacc_sql.tab.c"
+#line 2590 "yacc_sql.tab.c"
     break;
 
-  case 60:
-#line 442 "yacc_sql.y"
-                              { // select t1.age
-			RelAttr attr;
-			relation_attr_init(&attr, (yyvsp[-3].string), (yyvsp[-1].string), NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+  case 138: /* attr_list: COMMA select_item attr_list  */
+#line 948 "yacc_sql.y"
+                                  { // .., id
+			selects_append_attribute(current_selects(CONTEXT), (yyvsp[-1].attr));
+      }
+#line 2598 "yacc_sql.tab.c"
+    break;
+
+  case 139: /* select_item: expr  */
+#line 953 "yacc_sql.y"
+         { // age、t1.age、a + 1、upper(name)
+			if ((yyvsp[0].expr1)->type == EXPR_ATTR) {
+				(yyval.attr) = &(yyvsp[0].expr1)->attr;
+			} else {
+				// 表达式的列没有表名和字段名，列名在执行时由表达式生成
+				(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+				relation_attr_init(ARENA, (yyval.attr), NULL, "", NULL, 0);
+				(yyval.attr)->expr = (yyvsp[0].expr1);
+			}
 		}
-#line 1999 "yacc_sql.tab.c"
+#line 2613 "yacc_sql.tab.c"
     break;
 
-  case 61:
-#line 447 "yacc_sql.y"
-                                { // select t1.*
-			RelAttr attr;
-			relation_attr_init(&attr, (yyvsp[-3].string), "*", NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+  case 140: /* select_item: ID DOT STAR  */
+#line 963 "yacc_sql.y"
+                      { // t1.*
+			(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+			relation_attr_init(ARENA, (yyval.attr), (yyvsp[-2].string), "*", NULL, 0);
+		}
+#line 2622 "yacc_sql.tab.c"
+    break;
+
+  case 141: /* select_item: window_function  */
+#line 967 "yacc_sql.y"
+                          {
+			(yyval.attr) = (yyvsp[0].attr);
 		}
-#line 2009 "yacc_sql.tab.c"
+#line 2630 "yacc_sql.tab.c"
     break;
 
-  case 62:
-#line 452 "yacc_sql.y"
-                                        {
-		// 放到window_function里执行
+  case 143: /* join_list: INNER JOIN ID on join_list  */
+#line 974 "yacc_sql.y"
+                                {
+        selects_append_relation(ARENA, current_selects(CONTEXT), (yyvsp[-2].string));
+    }
+#line 2638 "yacc_sql.tab.c"
+    break;
+
+  case 144: /* window_function: COUNT LBRACE opt_star RBRACE  */
+#line 981 "yacc_sql.y"
+        {	// 只有COUNT允许COUNT(*)
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), NULL, (yyvsp[-1].string), (yyvsp[-3].string), 0);
 	}
-#line 2017 "yacc_sql.tab.c"
+#line 2647 "yacc_sql.tab.c"
     break;
 
-  case 64:
-#line 458 "yacc_sql.y"
-                         { // .., id
-			RelAttr attr;
-			relation_attr_init(&attr, NULL, (yyvsp[-1].string), NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
-     	  // CONTEXT->ssql->sstr.selection.attributes[CONTEXT->select_length].relation_name = NULL;
-        // CONTEXT->ssql->sstr.selection.attributes[CONTEXT->select_length++].attribute_name=$2;
-      }
-#line 2029 "yacc_sql.tab.c"
+  case 145: /* window_function: COUNT LBRACE ID RBRACE  */
+#line 986 "yacc_sql.y"
+        {
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), NULL, (yyvsp[-1].string), (yyvsp[-3].string), 0);
+	}
+#line 2656 "yacc_sql.tab.c"
     break;
 
-  case 65:
-#line 465 "yacc_sql.y"
-                                {
-			RelAttr attr;
-			relation_attr_init(&attr, (yyvsp[-3].string), (yyvsp[-1].string), NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
-        // CONTEXT->ssql->sstr.selection.attributes[CONTEXT->select_length].attribute_name=$4;
-        // CONTEXT->ssql->sstr.selection.attributes[CONTEXT->select_length++].relation_name=$2;
-  	  }
-#line 2041 "yacc_sql.tab.c"
+  case 146: /* window_function: COUNT LBRACE ID DOT ID RBRACE  */
+#line 991 "yacc_sql.y"
+        {
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), (yyvsp[-3].string), (yyvsp[-1].string), (yyvsp[-5].string), 0);
+	}
+#line 2665 "yacc_sql.tab.c"
     break;
 
-  case 66:
-#line 472 "yacc_sql.y"
-                                  {     // select t1.*, t2.*
-			RelAttr attr;
-			relation_attr_init(&attr, (yyvsp[-3].string), "*", NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
-        // CONTEXT->ssql->sstr.selection.attributes[CONTEXT->select_length].attribute_name=$4;
-        // CONTEXT->ssql->sstr.selection.attributes[CONTEXT->select_length++].relation_name=$2;
-  	  }
-#line 2053 "yacc_sql.tab.c"
+  case 147: /* window_function: COUNT LBRACE ID DOT STAR RBRACE  */
+#line 996 "yacc_sql.y"
+        {
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), (yyvsp[-3].string), "*", (yyvsp[-5].string), 0);
+	}
+#line 2674 "yacc_sql.tab.c"
     break;
 
-  case 68:
-#line 483 "yacc_sql.y"
-                                {
-        selects_append_relation(&CONTEXT->ssql->sstr.selection, (yyvsp[-2].string));
-    }
-#line 2061 "yacc_sql.tab.c"
+  case 148: /* window_function: COUNT LBRACE DISTINCT ID RBRACE  */
+#line 1001 "yacc_sql.y"
+        {
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), NULL, (yyvsp[-1].string), (yyvsp[-4].string), 0);
+		(yyval.attr)->is_distinct = 1;
+	}
+#line 2684 "yacc_sql.tab.c"
     break;
 
-  case 69:
-#line 490 "yacc_sql.y"
-        {	// 只有COUNT允许COUNT(*)
-		RelAttr attr;
-		relation_attr_init(&attr, NULL, (yyvsp[-1].string), (yyvsp[-3].string), 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+  case 149: /* window_function: COUNT LBRACE DISTINCT ID DOT ID RBRACE  */
+#line 1007 "yacc_sql.y"
+        {
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), (yyvsp[-3].string), (yyvsp[-1].string), (yyvsp[-6].string), 0);
+		(yyval.attr)->is_distinct = 1;
 	}
-#line 2071 "yacc_sql.tab.c"
+#line 2694 "yacc_sql.tab.c"
     break;
 
-  case 70:
-#line 496 "yacc_sql.y"
+  case 150: /* window_function: OTHER_FUNCTION_TYPE LBRACE ID RBRACE  */
+#line 1013 "yacc_sql.y"
         {
-		RelAttr attr;
-		relation_attr_init(&attr, NULL, (yyvsp[-1].string), (yyvsp[-3].string), 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), NULL, (yyvsp[-1].string), (yyvsp[-3].string), 0);
 	}
-#line 2081 "yacc_sql.tab.c"
+#line 2703 "yacc_sql.tab.c"
     break;
 
-  case 71:
-#line 502 "yacc_sql.y"
+  case 151: /* window_function: OTHER_FUNCTION_TYPE LBRACE ID DOT ID RBRACE  */
+#line 1018 "yacc_sql.y"
         {
-		RelAttr attr;
-		relation_attr_init(&attr, (yyvsp[-3].string), (yyvsp[-1].string), (yyvsp[-5].string), 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), (yyvsp[-3].string), (yyvsp[-1].string), (yyvsp[-5].string), 0);
 	}
-#line 2091 "yacc_sql.tab.c"
+#line 2712 "yacc_sql.tab.c"
     break;
 
-  case 72:
-#line 508 "yacc_sql.y"
+  case 152: /* window_function: OTHER_FUNCTION_TYPE LBRACE ID DOT STAR RBRACE  */
+#line 1023 "yacc_sql.y"
         {
-		RelAttr attr;
-		relation_attr_init(&attr, (yyvsp[-3].string), "*", (yyvsp[-5].string), 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), (yyvsp[-3].string), "*", (yyvsp[-5].string), 0);
 	}
-#line 2101 "yacc_sql.tab.c"
+#line 2721 "yacc_sql.tab.c"
     break;
 
-  case 73:
-#line 514 "yacc_sql.y"
+  case 153: /* window_function: COUNT LBRACE opt_star RBRACE OVER LBRACE window_spec RBRACE  */
+#line 1028 "yacc_sql.y"
         {
-		RelAttr attr;
-		relation_attr_init(&attr, NULL, (yyvsp[-1].string), (yyvsp[-3].string), 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), NULL, (yyvsp[-5].string), (yyvsp[-7].string), 0);
+		(yyval.attr)->window = (yyvsp[-1].window1);
 	}
-#line 2111 "yacc_sql.tab.c"
+#line 2731 "yacc_sql.tab.c"
     break;
 
-  case 74:
-#line 520 "yacc_sql.y"
+  case 154: /* window_function: window_call OVER LBRACE window_spec RBRACE  */
+#line 1034 "yacc_sql.y"
         {
-		RelAttr attr;
-		relation_attr_init(&attr, (yyvsp[-3].string), (yyvsp[-1].string), (yyvsp[-5].string), 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		(yyval.attr) = (yyvsp[-4].attr);
+		(yyval.attr)->window = (yyvsp[-1].window1);
 	}
-#line 2121 "yacc_sql.tab.c"
+#line 2740 "yacc_sql.tab.c"
+    break;
+
+  case 155: /* window_function: func_call OVER LBRACE window_spec RBRACE  */
+#line 1039 "yacc_sql.y"
+        {	// row_number()、rank()和dense_rank()没有参数，其它窗口函数的参数只能是字段
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		if ((yyvsp[-4].expr1)->arg_num == 0) {
+			relation_attr_init(ARENA, (yyval.attr), NULL, "*", (yyvsp[-4].expr1)->function_name, 0);
+		} else if ((yyvsp[-4].expr1)->arg_num == 1 && (yyvsp[-4].expr1)->args[0]->type == EXPR_ATTR) {
+			relation_attr_init(ARENA, (yyval.attr), (yyvsp[-4].expr1)->args[0]->attr.relation_name, (yyvsp[-4].expr1)->args[0]->attr.attribute_name,
+					(yyvsp[-4].expr1)->function_name, 0);
+		} else {
+			yyerror(scanner, "window function argument must be a column");
+			YYABORT;
+		}
+		(yyval.attr)->window = (yyvsp[-1].window1);
+	}
+#line 2758 "yacc_sql.tab.c"
     break;
 
-  case 75:
-#line 526 "yacc_sql.y"
+  case 156: /* window_call: COUNT LBRACE ID RBRACE  */
+#line 1055 "yacc_sql.y"
         {
-		RelAttr attr;
-		relation_attr_init(&attr, (yyvsp[-3].string), "*", (yyvsp[-5].string), 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), NULL, (yyvsp[-1].string), (yyvsp[-3].string), 0);
+	}
+#line 2767 "yacc_sql.tab.c"
+    break;
+
+  case 157: /* window_call: COUNT LBRACE ID DOT ID RBRACE  */
+#line 1060 "yacc_sql.y"
+        {
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), (yyvsp[-3].string), (yyvsp[-1].string), (yyvsp[-5].string), 0);
+	}
+#line 2776 "yacc_sql.tab.c"
+    break;
+
+  case 158: /* window_call: OTHER_FUNCTION_TYPE LBRACE ID RBRACE  */
+#line 1065 "yacc_sql.y"
+        {
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), NULL, (yyvsp[-1].string), (yyvsp[-3].string), 0);
+	}
+#line 2785 "yacc_sql.tab.c"
+    break;
+
+  case 159: /* window_call: OTHER_FUNCTION_TYPE LBRACE ID DOT ID RBRACE  */
+#line 1070 "yacc_sql.y"
+        {
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), (yyvsp[-3].string), (yyvsp[-1].string), (yyvsp[-5].string), 0);
+	}
+#line 2794 "yacc_sql.tab.c"
+    break;
+
+  case 160: /* window_spec: window_partition  */
+#line 1076 "yacc_sql.y"
+                         { (yyval.window1) = (yyvsp[0].window1); }
+#line 2800 "yacc_sql.tab.c"
+    break;
+
+  case 161: /* window_spec: window_order  */
+#line 1077 "yacc_sql.y"
+                       { (yyval.window1) = (yyvsp[0].window1); }
+#line 2806 "yacc_sql.tab.c"
+    break;
+
+  case 162: /* window_partition: %empty  */
+#line 1081 "yacc_sql.y"
+        {
+		(yyval.window1) = window_spec_create(ARENA);
+	}
+#line 2814 "yacc_sql.tab.c"
+    break;
+
+  case 163: /* window_partition: PARTITION BY window_attr  */
+#line 1085 "yacc_sql.y"
+        {
+		(yyval.window1) = window_spec_create(ARENA);
+		window_spec_append_partition((yyval.window1), (yyvsp[0].attr));
+	}
+#line 2823 "yacc_sql.tab.c"
+    break;
+
+  case 164: /* window_partition: window_partition COMMA window_attr  */
+#line 1090 "yacc_sql.y"
+        {
+		(yyval.window1) = (yyvsp[-2].window1);
+		window_spec_append_partition((yyval.window1), (yyvsp[0].attr));
+	}
+#line 2832 "yacc_sql.tab.c"
+    break;
+
+  case 165: /* window_order: window_partition ORDER BY window_sort_attr  */
+#line 1097 "yacc_sql.y"
+        {
+		(yyval.window1) = (yyvsp[-3].window1);
+		window_spec_append_order((yyval.window1), (yyvsp[0].attr));
+	}
+#line 2841 "yacc_sql.tab.c"
+    break;
+
+  case 166: /* window_order: window_order COMMA window_sort_attr  */
+#line 1102 "yacc_sql.y"
+        {
+		(yyval.window1) = (yyvsp[-2].window1);
+		window_spec_append_order((yyval.window1), (yyvsp[0].attr));
+	}
+#line 2850 "yacc_sql.tab.c"
+    break;
+
+  case 167: /* window_attr: ID  */
+#line 1109 "yacc_sql.y"
+        {
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), NULL, (yyvsp[0].string), NULL, 0);
+	}
+#line 2859 "yacc_sql.tab.c"
+    break;
+
+  case 168: /* window_attr: ID DOT ID  */
+#line 1114 "yacc_sql.y"
+        {
+		(yyval.attr) = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, (yyval.attr), (yyvsp[-2].string), (yyvsp[0].string), NULL, 0);
+	}
+#line 2868 "yacc_sql.tab.c"
+    break;
+
+  case 169: /* window_sort_attr: window_attr opt_asc  */
+#line 1120 "yacc_sql.y"
+                            { (yyval.attr) = (yyvsp[-1].attr); }
+#line 2874 "yacc_sql.tab.c"
+    break;
+
+  case 170: /* window_sort_attr: window_attr DESC  */
+#line 1122 "yacc_sql.y"
+        {
+		(yyval.attr) = (yyvsp[-1].attr);
+		(yyval.attr)->is_desc = 1;
 	}
-#line 2131 "yacc_sql.tab.c"
+#line 2883 "yacc_sql.tab.c"
     break;
 
-  case 76:
-#line 533 "yacc_sql.y"
+  case 171: /* opt_star: STAR  */
+#line 1128 "yacc_sql.y"
              { (yyval.string) = (yyvsp[0].string);}
-#line 2137 "yacc_sql.tab.c"
+#line 2889 "yacc_sql.tab.c"
     break;
 
-  case 77:
-#line 534 "yacc_sql.y"
-                 {(yyval.string) = number_to_str((yyvsp[0].number));}
-#line 2143 "yacc_sql.tab.c"
+  case 172: /* opt_star: NUMBER  */
+#line 1129 "yacc_sql.y"
+                 {(yyval.string) = number_to_str(ARENA, (yyvsp[0].number));}
+#line 2895 "yacc_sql.tab.c"
     break;
 
-  case 79:
-#line 538 "yacc_sql.y"
-                                          { // .., id
-		// 不操作，留给window_function执行
-      }
-#line 2151 "yacc_sql.tab.c"
+  case 173: /* expr: expr '+' expr  */
+#line 1132 "yacc_sql.y"
+                      { (yyval.expr1) = expr_create_arith(ARENA, '+', (yyvsp[-2].expr1), (yyvsp[0].expr1)); }
+#line 2901 "yacc_sql.tab.c"
+    break;
+
+  case 174: /* expr: expr '-' expr  */
+#line 1133 "yacc_sql.y"
+                        { (yyval.expr1) = expr_create_arith(ARENA, '-', (yyvsp[-2].expr1), (yyvsp[0].expr1)); }
+#line 2907 "yacc_sql.tab.c"
+    break;
+
+  case 175: /* expr: expr STAR expr  */
+#line 1134 "yacc_sql.y"
+                         { (yyval.expr1) = expr_create_arith(ARENA, '*', (yyvsp[-2].expr1), (yyvsp[0].expr1)); }
+#line 2913 "yacc_sql.tab.c"
+    break;
+
+  case 176: /* expr: expr '/' expr  */
+#line 1135 "yacc_sql.y"
+                        { (yyval.expr1) = expr_create_arith(ARENA, '/', (yyvsp[-2].expr1), (yyvsp[0].expr1)); }
+#line 2919 "yacc_sql.tab.c"
+    break;
+
+  case 177: /* expr: '-' expr  */
+#line 1137 "yacc_sql.y"
+        {
+		// 数字常量直接取负，- 1和-1一样还是常量
+		Value *value = &(yyvsp[0].expr1)->value;
+		if ((yyvsp[0].expr1)->type == EXPR_VALUE && !value->is_null && value->type == INTS) {
+			*(int *)value->data = -*(int *)value->data;
+			(yyval.expr1) = (yyvsp[0].expr1);
+		} else if ((yyvsp[0].expr1)->type == EXPR_VALUE && !value->is_null && value->type == FLOATS) {
+			*(float *)value->data = -*(float *)value->data;
+			(yyval.expr1) = (yyvsp[0].expr1);
+		} else {
+			(yyval.expr1) = expr_create_neg(ARENA, (yyvsp[0].expr1));
+		}
+	}
+#line 2937 "yacc_sql.tab.c"
+    break;
+
+  case 178: /* expr: LBRACE expr RBRACE  */
+#line 1150 "yacc_sql.y"
+                             { (yyval.expr1) = (yyvsp[-1].expr1); }
+#line 2943 "yacc_sql.tab.c"
+    break;
+
+  case 179: /* expr: ID  */
+#line 1151 "yacc_sql.y"
+             { (yyval.expr1) = expr_create_attr(ARENA, NULL, (yyvsp[0].string)); }
+#line 2949 "yacc_sql.tab.c"
+    break;
+
+  case 180: /* expr: ID DOT ID  */
+#line 1152 "yacc_sql.y"
+                    { (yyval.expr1) = expr_create_attr(ARENA, (yyvsp[-2].string), (yyvsp[0].string)); }
+#line 2955 "yacc_sql.tab.c"
+    break;
+
+  case 181: /* expr: NUMBER  */
+#line 1154 "yacc_sql.y"
+        {
+		Value value;
+		value_init_integer(ARENA, &value, (yyvsp[0].number), false);
+		(yyval.expr1) = expr_create_value(ARENA, &value);
+	}
+#line 2965 "yacc_sql.tab.c"
+    break;
+
+  case 182: /* expr: FLOAT  */
+#line 1160 "yacc_sql.y"
+        {
+		Value value;
+		value_init_float(ARENA, &value, (yyvsp[0].floats), false);
+		(yyval.expr1) = expr_create_value(ARENA, &value);
+	}
+#line 2975 "yacc_sql.tab.c"
+    break;
+
+  case 183: /* expr: NULL_T  */
+#line 1166 "yacc_sql.y"
+        {
+		Value value;
+		value_init_string(ARENA, &value, "NULL", true);
+		(yyval.expr1) = expr_create_value(ARENA, &value);
+	}
+#line 2985 "yacc_sql.tab.c"
+    break;
+
+  case 184: /* expr: SSS  */
+#line 1172 "yacc_sql.y"
+        {
+		Value value;
+		(yyvsp[0].string)[strlen((yyvsp[0].string)) - 1] = '\0';
+		value_init_string(ARENA, &value, (yyvsp[0].string) + 1, false);
+		(yyval.expr1) = expr_create_value(ARENA, &value);
+	}
+#line 2996 "yacc_sql.tab.c"
+    break;
+
+  case 185: /* expr: '?'  */
+#line 1179 "yacc_sql.y"
+        {
+		Value value;
+		value_init_param(ARENA, &value, CONTEXT->param_num++);
+		(yyval.expr1) = expr_create_value(ARENA, &value);
+	}
+#line 3006 "yacc_sql.tab.c"
+    break;
+
+  case 186: /* expr: func_call  */
+#line 1184 "yacc_sql.y"
+                    { (yyval.expr1) = (yyvsp[0].expr1); }
+#line 3012 "yacc_sql.tab.c"
+    break;
+
+  case 187: /* func_call: ID LBRACE RBRACE  */
+#line 1187 "yacc_sql.y"
+                         { (yyval.expr1) = expr_create_func(ARENA, (yyvsp[-2].string)); }
+#line 3018 "yacc_sql.tab.c"
+    break;
+
+  case 188: /* func_call: ID LBRACE func_args RBRACE  */
+#line 1189 "yacc_sql.y"
+        {
+		(yyval.expr1) = (yyvsp[-1].expr1);
+		(yyval.expr1)->function_name = (yyvsp[-3].string);
+	}
+#line 3027 "yacc_sql.tab.c"
+    break;
+
+  case 189: /* func_args: expr  */
+#line 1196 "yacc_sql.y"
+        {
+		(yyval.expr1) = expr_create_func(ARENA, NULL);
+		expr_append_arg((yyval.expr1), (yyvsp[0].expr1));
+	}
+#line 3036 "yacc_sql.tab.c"
+    break;
+
+  case 190: /* func_args: func_args COMMA expr  */
+#line 1201 "yacc_sql.y"
+        {
+		(yyval.expr1) = (yyvsp[-2].expr1);
+		if (!expr_append_arg((yyval.expr1), (yyvsp[0].expr1))) {
+			yyerror(scanner, "too many function arguments");
+			YYABORT;
+		}
+	}
+#line 3048 "yacc_sql.tab.c"
     break;
 
-  case 81:
-#line 544 "yacc_sql.y"
+  case 192: /* rel_list: COMMA ID rel_list  */
+#line 1211 "yacc_sql.y"
                         {	
-				selects_append_relation(&CONTEXT->ssql->sstr.selection, (yyvsp[-1].string));
+				selects_append_relation(ARENA, current_selects(CONTEXT), (yyvsp[-1].string));
 		  }
-#line 2159 "yacc_sql.tab.c"
+#line 3056 "yacc_sql.tab.c"
     break;
 
-  case 83:
-#line 550 "yacc_sql.y"
+  case 194: /* where: WHERE condition condition_list  */
+#line 1217 "yacc_sql.y"
                                      {	
 				// CONTEXT->conditions[CONTEXT->condition_length++]=*$2;
 			}
-#line 2167 "yacc_sql.tab.c"
+#line 3064 "yacc_sql.tab.c"
     break;
 
-  case 85:
-#line 557 "yacc_sql.y"
+  case 196: /* on: ON condition condition_list  */
+#line 1224 "yacc_sql.y"
                                   {	
 				// CONTEXT->conditions[CONTEXT->condition_length++]=*$2;
 			}
-#line 2175 "yacc_sql.tab.c"
+#line 3072 "yacc_sql.tab.c"
     break;
 
-  case 87:
-#line 564 "yacc_sql.y"
+  case 198: /* condition_list: AND condition condition_list  */
+#line 1231 "yacc_sql.y"
                                    {
 				// CONTEXT->conditions[CONTEXT->condition_length++]=*$2;
 			}
-#line 2183 "yacc_sql.tab.c"
+#line 3080 "yacc_sql.tab.c"
     break;
 
-  case 88:
-#line 570 "yacc_sql.y"
+  case 199: /* condition: expr comOp expr  */
+#line 1237 "yacc_sql.y"
                 {
-			RelAttr left_attr;
-			// $1 为属性名称
-			relation_attr_init(&left_attr, NULL, (yyvsp[-2].string), NULL, 0);
-
-			Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 1, &left_attr, NULL, 0, NULL, right_value);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-			// $$ = ( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 1;
-			// $$->left_attr.relation_name = NULL;
-			// $$->left_attr.attribute_name= $1;
-			// $$->comp = CONTEXT->comp;
-			// $$->right_is_attr = 0;
-			// $$->right_attr.relation_name = NULL;
-			// $$->right_attr.attribute_name = NULL;
-			// $$->right_value = *$3;
-
+			if (!context_add_condition(CONTEXT, CONTEXT->comp, (yyvsp[-2].expr1), (yyvsp[0].expr1))) {
+				yyerror(scanner, "too many conditions");
+				YYABORT;
+			}
 		}
-#line 2209 "yacc_sql.tab.c"
+#line 3091 "yacc_sql.tab.c"
     break;
 
-  case 89:
-#line 592 "yacc_sql.y"
+  case 200: /* condition: expr IS NULL_T  */
+#line 1244 "yacc_sql.y"
                 {
-			Value *left_value = &CONTEXT->values[CONTEXT->value_length - 2];
-			Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 0, NULL, left_value, 0, NULL, right_value);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-			// $$ = ( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 0;
-			// $$->left_attr.relation_name=NULL;
-			// $$->left_attr.attribute_name=NULL;
-			// $$->left_value = *$1;
-			// $$->comp = CONTEXT->comp;
-			// $$->right_is_attr = 0;
-			// $$->right_attr.relation_name = NULL;
-			// $$->right_attr.attribute_name = NULL;
-			// $$->right_value = *$3;
-
+			if (!context_add_condition(CONTEXT, IS_NULL, (yyvsp[-2].expr1), NULL)) {
+				yyerror(scanner, "too many conditions");
+				YYABORT;
+			}
 		}
-#line 2233 "yacc_sql.tab.c"
+#line 3102 "yacc_sql.tab.c"
     break;
 
-  case 90:
-#line 612 "yacc_sql.y"
+  case 201: /* condition: expr IS NOT NULL_T  */
+#line 1251 "yacc_sql.y"
                 {
-			RelAttr left_attr;
-			relation_attr_init(&left_attr, NULL, (yyvsp[-2].string), NULL, 0);
-			RelAttr right_attr;
-			relation_attr_init(&right_attr, NULL, (yyvsp[0].string), NULL, 0);
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 1, &left_attr, NULL, 1, &right_attr, NULL);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-			// $$=( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 1;
-			// $$->left_attr.relation_name=NULL;
-			// $$->left_attr.attribute_name=$1;
-			// $$->comp = CONTEXT->comp;
-			// $$->right_is_attr = 1;
-			// $$->right_attr.relation_name=NULL;
-			// $$->right_attr.attribute_name=$3;
-
+			if (!context_add_condition(CONTEXT, IS_NOT_NULL, (yyvsp[-3].expr1), NULL)) {
+				yyerror(scanner, "too many conditions");
+				YYABORT;
+			}
 		}
-#line 2257 "yacc_sql.tab.c"
+#line 3113 "yacc_sql.tab.c"
     break;
 
-  case 91:
-#line 632 "yacc_sql.y"
+  case 202: /* condition: expr LIKE expr  */
+#line 1258 "yacc_sql.y"
                 {
-			Value *left_value = &CONTEXT->values[CONTEXT->value_length - 1];
-			RelAttr right_attr;
-			relation_attr_init(&right_attr, NULL, (yyvsp[0].string), NULL, 0);
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 0, NULL, left_value, 1, &right_attr, NULL);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-
-			// $$=( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 0;
-			// $$->left_attr.relation_name=NULL;
-			// $$->left_attr.attribute_name=NULL;
-			// $$->left_value = *$1;
-			// $$->comp=CONTEXT->comp;
-			
-			// $$->right_is_attr = 1;
-			// $$->right_attr.relation_name=NULL;
-			// $$->right_attr.attribute_name=$3;
-		
+			if (!context_add_condition(CONTEXT, LIKE_OP, (yyvsp[-2].expr1), (yyvsp[0].expr1))) {
+				yyerror(scanner, "too many conditions");
+				YYABORT;
+			}
 		}
-#line 2283 "yacc_sql.tab.c"
-    break;
-
-  case 92:
-#line 654 "yacc_sql.y"
-                {
-			RelAttr left_attr;
-			// $1为表名，$3为属性名
-			relation_attr_init(&left_attr, (yyvsp[-4].string), (yyvsp[-2].string), NULL, 0);
-			Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 1, &left_attr, NULL, 0, NULL, right_value);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-
-			// $$=( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 1;
-			// $$->left_attr.relation_name=$1;
-			// $$->left_attr.attribute_name=$3;
-			// $$->comp=CONTEXT->comp;
-			// $$->right_is_attr = 0;   //属性值
-			// $$->right_attr.relation_name=NULL;
-			// $$->right_attr.attribute_name=NULL;
-			// $$->right_value =*$5;			
-							
-    }
-#line 2309 "yacc_sql.tab.c"
+#line 3124 "yacc_sql.tab.c"
     break;
 
-  case 93:
-#line 676 "yacc_sql.y"
-                {
-			Value *left_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
-			RelAttr right_attr;
-			relation_attr_init(&right_attr, (yyvsp[-2].string), (yyvsp[0].string), NULL, 0);
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 0, NULL, left_value, 1, &right_attr, NULL);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-			// $$=( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 0;//属性值
-			// $$->left_attr.relation_name=NULL;
-			// $$->left_attr.attribute_name=NULL;
-			// $$->left_value = *$1;
-			// $$->comp =CONTEXT->comp;
-			// $$->right_is_attr = 1;//属性
-			// $$->right_attr.relation_name = $3;
-			// $$->right_attr.attribute_name = $5;
-									
-    }
-#line 2334 "yacc_sql.tab.c"
-    break;
-
-  case 94:
-#line 697 "yacc_sql.y"
+  case 203: /* condition: expr NOT LIKE expr  */
+#line 1265 "yacc_sql.y"
                 {
-			RelAttr left_attr;
-			relation_attr_init(&left_attr, (yyvsp[-6].string), (yyvsp[-4].string), NULL, 0);
-			RelAttr right_attr;
-			relation_attr_init(&right_attr, (yyvsp[-2].string), (yyvsp[0].string), NULL, 0);
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 1, &left_attr, NULL, 1, &right_attr, NULL);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-			// $$=( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 1;		//属性
-			// $$->left_attr.relation_name=$1;
-			// $$->left_attr.attribute_name=$3;
-			// $$->comp =CONTEXT->comp;
-			// $$->right_is_attr = 1;		//属性
-			// $$->right_attr.relation_name=$5;
-			// $$->right_attr.attribute_name=$7;
-    }
-#line 2357 "yacc_sql.tab.c"
+			if (!context_add_condition(CONTEXT, NOT_LIKE_OP, (yyvsp[-3].expr1), (yyvsp[0].expr1))) {
+				yyerror(scanner, "too many conditions");
+				YYABORT;
+			}
+		}
+#line 3135 "yacc_sql.tab.c"
     break;
 
-  case 95:
-#line 715 "yacc_sql.y"
-                      {
-		RelAttr left_attr;
-		// $1 为属性名称
-		relation_attr_init(&left_attr, NULL, (yyvsp[-2].string), NULL, 0);
-
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
-		Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
+  case 204: /* condition: expr IN sub_select  */
+#line 1271 "yacc_sql.y"
+                            {
+		// in的左边只能是字段
+		if ((yyvsp[-2].expr1)->type != EXPR_ATTR) {
+			yyerror(scanner, "left side of in must be a field");
+			YYABORT;
+		}
 		Condition condition;
-		condition_init(&condition, IS_NULL, 1, &left_attr, NULL, 0, NULL, right_value);
+		condition_init_subquery(&condition, IN_SUBQUERY, &(yyvsp[-2].expr1)->attr, (yyvsp[0].selects1));
 		CONTEXT->conditions[CONTEXT->condition_length++] = condition;
 	}
-#line 2374 "yacc_sql.tab.c"
+#line 3150 "yacc_sql.tab.c"
     break;
 
-  case 96:
-#line 727 "yacc_sql.y"
-                          { // id is not null
-		RelAttr left_attr;
-		// $1 为属性名称
-		relation_attr_init(&left_attr, NULL, (yyvsp[-3].string), NULL, 0);
-
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
-		Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
+  case 205: /* condition: expr NOT IN sub_select  */
+#line 1281 "yacc_sql.y"
+                                {
+		if ((yyvsp[-3].expr1)->type != EXPR_ATTR) {
+			yyerror(scanner, "left side of in must be a field");
+			YYABORT;
+		}
 		Condition condition;
-		condition_init(&condition, IS_NOT_NULL, 1, &left_attr, NULL, 0, NULL, right_value);
+		condition_init_subquery(&condition, NOT_IN_SUBQUERY, &(yyvsp[-3].expr1)->attr, (yyvsp[0].selects1));
 		CONTEXT->conditions[CONTEXT->condition_length++] = condition;
 	}
-#line 2391 "yacc_sql.tab.c"
+#line 3164 "yacc_sql.tab.c"
     break;
 
-  case 97:
-#line 739 "yacc_sql.y"
-                             {
-		RelAttr left_attr;
-		// $1为表名，$3为属性名
-		relation_attr_init(&left_attr, (yyvsp[-4].string), (yyvsp[-2].string), NULL, 0);
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
-		Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
+  case 206: /* condition: EXISTS sub_select  */
+#line 1290 "yacc_sql.y"
+                           {
 		Condition condition;
-		condition_init(&condition, IS_NULL, 1, &left_attr, NULL, 0, NULL, right_value);
+		condition_init_subquery(&condition, EXISTS_SUBQUERY, NULL, (yyvsp[0].selects1));
 		CONTEXT->conditions[CONTEXT->condition_length++] = condition;
 	}
-#line 2407 "yacc_sql.tab.c"
+#line 3174 "yacc_sql.tab.c"
     break;
 
-  case 98:
-#line 750 "yacc_sql.y"
-                                 {
-		RelAttr left_attr;
-		// $1为表名，$3为属性名
-		relation_attr_init(&left_attr, (yyvsp[-5].string), (yyvsp[-3].string), NULL, 0);
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
-		Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
+  case 207: /* condition: NOT EXISTS sub_select  */
+#line 1295 "yacc_sql.y"
+                               {
 		Condition condition;
-		condition_init(&condition, IS_NOT_NULL, 1, &left_attr, NULL, 0, NULL, right_value);
+		condition_init_subquery(&condition, NOT_EXISTS_SUBQUERY, NULL, (yyvsp[0].selects1));
 		CONTEXT->conditions[CONTEXT->condition_length++] = condition;
 	}
-#line 2423 "yacc_sql.tab.c"
+#line 3184 "yacc_sql.tab.c"
     break;
 
-  case 99:
-#line 761 "yacc_sql.y"
-                             { // null is null/value is not null
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
-		Value *left_value = &CONTEXT->values[CONTEXT->value_length - 2];
-		Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
-		Condition condition;
-		condition_init(&condition, IS_NOT_NULL, 0, NULL, left_value, 0, NULL, right_value);
-		CONTEXT->conditions[CONTEXT->condition_length++] = condition;
+  case 208: /* $@1: %empty  */
+#line 1303 "yacc_sql.y"
+                      {
+		// 子查询的列、表和条件放进新的Selects，条件接在外层已经解析的条件后面
+		if (CONTEXT->sub_select_depth >= MAX_NUM) {
+			yyerror(scanner, "too many nested sub queries");
+			YYABORT;
+		}
+		Selects *sub_select = (Selects *)arena_alloc(ARENA, sizeof(Selects));
+		memset(sub_select, 0, sizeof(Selects));
+		CONTEXT->sub_selects[CONTEXT->sub_select_depth] = sub_select;
+		CONTEXT->sub_condition_starts[CONTEXT->sub_select_depth] = CONTEXT->condition_length;
+		CONTEXT->sub_expr_condition_starts[CONTEXT->sub_select_depth] = CONTEXT->expr_condition_length;
+		CONTEXT->sub_select_depth++;
 	}
-#line 2437 "yacc_sql.tab.c"
-    break;
-
-  case 100:
-#line 770 "yacc_sql.y"
-                         { //  null is not null/value is null
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
-		Value *left_value = &CONTEXT->values[CONTEXT->value_length - 2];
-		Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
-		Condition condition;
-		condition_init(&condition, IS_NULL, 0, NULL, left_value, 0, NULL, right_value);
-		CONTEXT->conditions[CONTEXT->condition_length++] = condition;
+#line 3202 "yacc_sql.tab.c"
+    break;
+
+  case 209: /* sub_select: LBRACE SELECT $@1 opt_distinct select_attr FROM ID rel_list join_list where group_by RBRACE  */
+#line 1316 "yacc_sql.y"
+                                                                                  {
+		Selects *sub_select = current_selects(CONTEXT);
+		selects_append_relation(ARENA, sub_select, (yyvsp[-5].string));
+		const size_t start = CONTEXT->sub_condition_starts[CONTEXT->sub_select_depth - 1];
+		selects_append_conditions(CONTEXT->ssql, sub_select, CONTEXT->conditions + start, CONTEXT->condition_length - start);
+		CONTEXT->condition_length = start;
+		const size_t expr_start = CONTEXT->sub_expr_condition_starts[CONTEXT->sub_select_depth - 1];
+		selects_append_expr_conditions(sub_select, CONTEXT->expr_conditions + expr_start,
+				CONTEXT->expr_condition_length - expr_start);
+		CONTEXT->expr_condition_length = expr_start;
+		CONTEXT->sub_select_depth--;
+		(yyval.selects1) = sub_select;
 	}
-#line 2451 "yacc_sql.tab.c"
+#line 3220 "yacc_sql.tab.c"
     break;
 
-  case 101:
-#line 782 "yacc_sql.y"
+  case 210: /* comOp: EQ  */
+#line 1332 "yacc_sql.y"
              { CONTEXT->comp = EQUAL_TO; }
-#line 2457 "yacc_sql.tab.c"
+#line 3226 "yacc_sql.tab.c"
     break;
 
-  case 102:
-#line 783 "yacc_sql.y"
+  case 211: /* comOp: LT  */
+#line 1333 "yacc_sql.y"
          { CONTEXT->comp = LESS_THAN; }
-#line 2463 "yacc_sql.tab.c"
+#line 3232 "yacc_sql.tab.c"
     break;
 
-  case 103:
-#line 784 "yacc_sql.y"
+  case 212: /* comOp: GT  */
+#line 1334 "yacc_sql.y"
          { CONTEXT->comp = GREAT_THAN; }
-#line 2469 "yacc_sql.tab.c"
+#line 3238 "yacc_sql.tab.c"
     break;
 
-  case 104:
-#line 785 "yacc_sql.y"
+  case 213: /* comOp: LE  */
+#line 1335 "yacc_sql.y"
          { CONTEXT->comp = LESS_EQUAL; }
-#line 2475 "yacc_sql.tab.c"
+#line 3244 "yacc_sql.tab.c"
     break;
 
-  case 105:
-#line 786 "yacc_sql.y"
+  case 214: /* comOp: GE  */
+#line 1336 "yacc_sql.y"
          { CONTEXT->comp = GREAT_EQUAL; }
-#line 2481 "yacc_sql.tab.c"
+#line 3250 "yacc_sql.tab.c"
     break;
 
-  case 106:
-#line 787 "yacc_sql.y"
+  case 215: /* comOp: NE  */
+#line 1337 "yacc_sql.y"
          { CONTEXT->comp = NOT_EQUAL; }
-#line 2487 "yacc_sql.tab.c"
+#line 3256 "yacc_sql.tab.c"
     break;
 
-  case 108:
-#line 792 "yacc_sql.y"
+  case 217: /* group_by: GROUP BY group_list  */
+#line 1342 "yacc_sql.y"
                               {
 		;
 	}
-#line 2495 "yacc_sql.tab.c"
+#line 3264 "yacc_sql.tab.c"
     break;
 
-  case 109:
-#line 798 "yacc_sql.y"
+  case 218: /* group_list: group_attr  */
+#line 1348 "yacc_sql.y"
                   {
 		;
 	}
-#line 2503 "yacc_sql.tab.c"
+#line 3272 "yacc_sql.tab.c"
     break;
 
-  case 110:
-#line 801 "yacc_sql.y"
+  case 219: /* group_list: group_list COMMA group_attr  */
+#line 1351 "yacc_sql.y"
                                       {}
-#line 2509 "yacc_sql.tab.c"
+#line 3278 "yacc_sql.tab.c"
     break;
 
-  case 111:
-#line 805 "yacc_sql.y"
+  case 220: /* group_attr: ID  */
+#line 1355 "yacc_sql.y"
            {
 		RelAttr attr;
-		relation_attr_init(&attr, NULL, (yyvsp[0].string), NULL, 0);
-		selects_append_group(&CONTEXT->ssql->sstr.selection, &attr);
+		relation_attr_init(ARENA, &attr, NULL, (yyvsp[0].string), NULL, 0);
+		selects_append_group(current_selects(CONTEXT), &attr);
 	}
-#line 2519 "yacc_sql.tab.c"
+#line 3288 "yacc_sql.tab.c"
     break;
 
-  case 112:
-#line 810 "yacc_sql.y"
+  case 221: /* group_attr: ID DOT ID  */
+#line 1360 "yacc_sql.y"
                     {
 		RelAttr attr;
-		relation_attr_init(&attr, (yyvsp[-2].string), (yyvsp[0].string), NULL, 0);
-		selects_append_group(&CONTEXT->ssql->sstr.selection, &attr);
+		relation_attr_init(ARENA, &attr, (yyvsp[-2].string), (yyvsp[0].string), NULL, 0);
+		selects_append_group(current_selects(CONTEXT), &attr);
 	}
-#line 2529 "yacc_sql.tab.c"
+#line 3298 "yacc_sql.tab.c"
     break;
 
-  case 114:
-#line 819 "yacc_sql.y"
+  case 223: /* order_by: ORDER BY sort_list  */
+#line 1369 "yacc_sql.y"
                              {
 	}
-#line 2536 "yacc_sql.tab.c"
+#line 3305 "yacc_sql.tab.c"
     break;
 
-  case 115:
-#line 824 "yacc_sql.y"
+  case 224: /* sort_list: sort_attr  */
+#line 1374 "yacc_sql.y"
                   {
 		// order by A, B, C，实际上加入顺序为C、B、A，方便后面排序
 	}
-#line 2544 "yacc_sql.tab.c"
+#line 3313 "yacc_sql.tab.c"
     break;
 
-  case 116:
-#line 827 "yacc_sql.y"
+  case 225: /* sort_list: sort_list COMMA sort_attr  */
+#line 1377 "yacc_sql.y"
                                     {}
-#line 2550 "yacc_sql.tab.c"
+#line 3319 "yacc_sql.tab.c"
     break;
 
-  case 117:
-#line 830 "yacc_sql.y"
+  case 226: /* sort_attr: ID opt_asc  */
+#line 1380 "yacc_sql.y"
                   {
 		RelAttr attr;
-		relation_attr_init(&attr, NULL, (yyvsp[-1].string), NULL, 0);
-		selects_append_order(&CONTEXT->ssql->sstr.selection, &attr);
+		relation_attr_init(ARENA, &attr, NULL, (yyvsp[-1].string), NULL, 0);
+		selects_append_order(current_selects(CONTEXT), &attr);
 	}
-#line 2560 "yacc_sql.tab.c"
+#line 3329 "yacc_sql.tab.c"
     break;
 
-  case 118:
-#line 835 "yacc_sql.y"
+  case 227: /* sort_attr: ID DESC  */
+#line 1385 "yacc_sql.y"
                   {
 		RelAttr attr;
-		relation_attr_init(&attr, NULL, (yyvsp[-1].string), NULL, 1);
-		selects_append_order(&CONTEXT->ssql->sstr.selection, &attr);
+		relation_attr_init(ARENA, &attr, NULL, (yyvsp[-1].string), NULL, 1);
+		selects_append_order(current_selects(CONTEXT), &attr);
 	}
-#line 2570 "yacc_sql.tab.c"
+#line 3339 "yacc_sql.tab.c"
     break;
 
-  case 119:
-#line 840 "yacc_sql.y"
+  case 228: /* sort_attr: ID DOT ID opt_asc  */
+#line 1390 "yacc_sql.y"
                             {
 		RelAttr attr;
-		relation_attr_init(&attr, (yyvsp[-3].string), (yyvsp[-1].string), NULL, 0);
-		selects_append_order(&CONTEXT->ssql->sstr.selection, &attr);
+		relation_attr_init(ARENA, &attr, (yyvsp[-3].string), (yyvsp[-1].string), NULL, 0);
+		selects_append_order(current_selects(CONTEXT), &attr);
 	}
-#line 2580 "yacc_sql.tab.c"
+#line 3349 "yacc_sql.tab.c"
     break;
 
-  case 120:
-#line 845 "yacc_sql.y"
+  case 229: /* sort_attr: ID DOT ID DESC  */
+#line 1395 "yacc_sql.y"
                          {
 		RelAttr attr;
-		relation_attr_init(&attr, (yyvsp[-3].string), (yyvsp[-1].string), NULL, 1);
-		selects_append_order(&CONTEXT->ssql->sstr.selection, &attr);
+		relation_attr_init(ARENA, &attr, (yyvsp[-3].string), (yyvsp[-1].string), NULL, 1);
+		selects_append_order(current_selects(CONTEXT), &attr);
 	}
-#line 2590 "yacc_sql.tab.c"
+#line 3359 "yacc_sql.tab.c"
     break;
 
-  case 122:
-#line 853 "yacc_sql.y"
+  case 231: /* opt_asc: ASC  */
+#line 1403 "yacc_sql.y"
               {}
-#line 2596 "yacc_sql.tab.c"
+#line 3365 "yacc_sql.tab.c"
+    break;
+
+  case 233: /* limit: LIMIT NUMBER  */
+#line 1407 "yacc_sql.y"
+                       {
+		selects_set_limit(current_selects(CONTEXT), (yyvsp[0].number), 0);
+	}
+#line 3373 "yacc_sql.tab.c"
+    break;
+
+  case 234: /* limit: LIMIT NUMBER OFFSET NUMBER  */
+#line 1410 "yacc_sql.y"
+                                     {
+		selects_set_limit(current_selects(CONTEXT), (yyvsp[-2].number), (yyvsp[0].number));
+	}
+#line 3381 "yacc_sql.tab.c"
     break;
 
-  case 123:
-#line 857 "yacc_sql.y"
+  case 235: /* limit: LIMIT NUMBER COMMA NUMBER  */
+#line 1413 "yacc_sql.y"
+                                    {
+		// limit m, n：跳过m行，返回n行
+		selects_set_limit(current_selects(CONTEXT), (yyvsp[0].number), (yyvsp[-2].number));
+	}
+#line 3390 "yacc_sql.tab.c"
+    break;
+
+  case 236: /* load_data: LOAD DATA INFILE SSS INTO TABLE ID SEMICOLON  */
+#line 1420 "yacc_sql.y"
                 {
 		  CONTEXT->ssql->flag = SCF_LOAD_DATA;
-			load_data_init(&CONTEXT->ssql->sstr.load_data, (yyvsp[-1].string), (yyvsp[-4].string));
+			load_data_init(ARENA, &CONTEXT->ssql->sstr.load_data, (yyvsp[-1].string), (yyvsp[-4].string));
 		}
-#line 2605 "yacc_sql.tab.c"
+#line 3399 "yacc_sql.tab.c"
+    break;
+
+  case 237: /* backup: ID TO SSS SEMICOLON  */
+#line 1426 "yacc_sql.y"
+                        {
+        // backup不作为关键字
+        if (strcasecmp((yyvsp[-3].string), "backup") != 0) {
+            yyerror(scanner, "unknown statement");
+            YYABORT;
+        }
+        CONTEXT->ssql->flag = SCF_BACKUP;
+        backup_init(ARENA, &CONTEXT->ssql->sstr.backup, (yyvsp[-1].string));
+    }
+#line 3413 "yacc_sql.tab.c"
+    break;
+
+  case 238: /* declare_cursor: ID ID ID ID select  */
+#line 1437 "yacc_sql.y"
+                       {
+        // declare 游标名 cursor for select ...，declare、cursor和for不作为关键字
+        if (strcasecmp((yyvsp[-4].string), "declare") != 0 || strcasecmp((yyvsp[-2].string), "cursor") != 0 || strcasecmp((yyvsp[-1].string), "for") != 0) {
+            yyerror(scanner, "unknown statement");
+            YYABORT;
+        }
+        selects_set_cursor(ARENA, &CONTEXT->ssql->sstr.selection, (yyvsp[-3].string));
+    }
+#line 3426 "yacc_sql.tab.c"
+    break;
+
+  case 239: /* fetch: ID NUMBER FROM ID SEMICOLON  */
+#line 1447 "yacc_sql.y"
+                                {
+        // fetch不作为关键字
+        if (strcasecmp((yyvsp[-4].string), "fetch") != 0) {
+            yyerror(scanner, "unknown statement");
+            YYABORT;
+        }
+        CONTEXT->ssql->flag = SCF_FETCH;
+        fetch_init(ARENA, &CONTEXT->ssql->sstr.fetch, (yyvsp[-1].string), (yyvsp[-3].number));
+    }
+#line 3440 "yacc_sql.tab.c"
     break;
 
+  case 240: /* close_cursor: ID ID SEMICOLON  */
+#line 1458 "yacc_sql.y"
+                    {
+        // close不作为关键字
+        if (strcasecmp((yyvsp[-2].string), "close") != 0) {
+            yyerror(scanner, "unknown statement");
+            YYABORT;
+        }
+        CONTEXT->ssql->flag = SCF_CLOSE_CURSOR;
+        close_cursor_init(ARENA, &CONTEXT->ssql->sstr.close_cursor, (yyvsp[-1].string));
+    }
+#line 3454 "yacc_sql.tab.c"
+    break;
 
-#line 2609 "yacc_sql.tab.c"
+
+#line 3458 "yacc_sql.tab.c"
 
       default: break;
     }
@@ -2620,11 +3469,10 @@ yyreduce:
      case of YYERROR or YYBACKUP, subsequent parser actions might lead
      to an incorrect destructor call or verbose syntax error message
      before the lookahead is translated.  */
-  YY_SYMBOL_PRINT ("-> $$ =", yyr1[yyn], &yyval, &yyloc);
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
 
   YYPOPSTACK (yylen);
   yylen = 0;
-  YY_STACK_PRINT (yyss, yyssp);
 
   *++yyvsp = yyval;
 
@@ -2648,50 +3496,14 @@ yyreduce:
 yyerrlab:
   /* Make sure we have latest lookahead translation.  See comments at
      user semantic actions for why this is necessary.  */
-  yytoken = yychar == YYEMPTY ? YYEMPTY : YYTRANSLATE (yychar);
-
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
   /* If not already recovering from an error, report this error.  */
   if (!yyerrstatus)
     {
       ++yynerrs;
-#if ! YYERROR_VERBOSE
       yyerror (scanner, YY_("syntax error"));
-#else
-# define YYSYNTAX_ERROR yysyntax_error (&yymsg_alloc, &yymsg, \
-                                        yyssp, yytoken)
-      {
-        char const *yymsgp = YY_("syntax error");
-        int yysyntax_error_status;
-        yysyntax_error_status = YYSYNTAX_ERROR;
-        if (yysyntax_error_status == 0)
-          yymsgp = yymsg;
-        else if (yysyntax_error_status == 1)
-          {
-            if (yymsg != yymsgbuf)
-              YYSTACK_FREE (yymsg);
-            yymsg = YY_CAST (char *, YYSTACK_ALLOC (YY_CAST (YYSIZE_T, yymsg_alloc)));
-            if (!yymsg)
-              {
-                yymsg = yymsgbuf;
-                yymsg_alloc = sizeof yymsgbuf;
-                yysyntax_error_status = 2;
-              }
-            else
-              {
-                yysyntax_error_status = YYSYNTAX_ERROR;
-                yymsgp = yymsg;
-              }
-          }
-        yyerror (scanner, yymsgp);
-        if (yysyntax_error_status == 2)
-          goto yyexhaustedlab;
-      }
-# undef YYSYNTAX_ERROR
-#endif
     }
 
-
-
   if (yyerrstatus == 3)
     {
       /* If just tried and failed to reuse lookahead token after an
@@ -2724,6 +3536,7 @@ yyerrorlab:
      label yyerrorlab therefore never appears in user code.  */
   if (0)
     YYERROR;
+  ++yynerrs;
 
   /* Do not reclaim the symbols of the rule whose action triggered
      this YYERROR.  */
@@ -2740,13 +3553,14 @@ yyerrorlab:
 yyerrlab1:
   yyerrstatus = 3;      /* Each real token shifted decrements this.  */
 
+  /* Pop stack until we find a state that shifts the error token.  */
   for (;;)
     {
       yyn = yypact[yystate];
       if (!yypact_value_is_default (yyn))
         {
-          yyn += YYTERROR;
-          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYTERROR)
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
             {
               yyn = yytable[yyn];
               if (0 < yyn)
@@ -2760,7 +3574,7 @@ yyerrlab1:
 
 
       yydestruct ("Error: popping",
-                  yystos[yystate], yyvsp, scanner);
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, scanner);
       YYPOPSTACK (1);
       yystate = *yyssp;
       YY_STACK_PRINT (yyss, yyssp);
@@ -2772,7 +3586,7 @@ yyerrlab1:
 
 
   /* Shift the error token.  */
-  YY_SYMBOL_PRINT ("Shifting", yystos[yyn], yyvsp, yylsp);
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
 
   yystate = yyn;
   goto yynewstate;
@@ -2783,7 +3597,7 @@ yyerrlab1:
 `-------------------------------------*/
 yyacceptlab:
   yyresult = 0;
-  goto yyreturn;
+  goto yyreturnlab;
 
 
 /*-----------------------------------.
@@ -2791,24 +3605,22 @@ yyacceptlab:
 `-----------------------------------*/
 yyabortlab:
   yyresult = 1;
-  goto yyreturn;
+  goto yyreturnlab;
 
 
-#if !defined yyoverflow || YYERROR_VERBOSE
-/*-------------------------------------------------.
-| yyexhaustedlab -- memory exhaustion comes here.  |
-`-------------------------------------------------*/
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
 yyexhaustedlab:
   yyerror (scanner, YY_("memory exhausted"));
   yyresult = 2;
-  /* Fall through.  */
-#endif
+  goto yyreturnlab;
 
 
-/*-----------------------------------------------------.
-| yyreturn -- parsing is finished, return the result.  |
-`-----------------------------------------------------*/
-yyreturn:
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
   if (yychar != YYEMPTY)
     {
       /* Make sure we have latest lookahead translation.  See comments at
@@ -2824,33 +3636,96 @@ yyreturn:
   while (yyssp != yyss)
     {
       yydestruct ("Cleanup: popping",
-                  yystos[+*yyssp], yyvsp, scanner);
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, scanner);
       YYPOPSTACK (1);
     }
 #ifndef yyoverflow
   if (yyss != yyssa)
     YYSTACK_FREE (yyss);
 #endif
-#if YYERROR_VERBOSE
-  if (yymsg != yymsgbuf)
-    YYSTACK_FREE (yymsg);
-#endif
+
   return yyresult;
 }
-#line 862 "yacc_sql.y"
+
+#line 1468 "yacc_sql.y"
 
 //_____________________________________________________________________
-extern void scan_string(const char *str, yyscan_t scanner);
+/**
+ * 可以反复使用的词法分析器。每个SQL线程一个(见parse.cpp)，解析语句时只换上下文和输入，
+ * 不再每条语句都创建和销毁flex的状态
+ */
+typedef struct {
+	yyscan_t scanner;
+	char *buffer;    // 语句的拷贝，flex要求末尾有两个'\0'，并且会临时改写其中的字符
+	size_t capacity;
+} SqlScanner;
+
+void *sql_scanner_create(void){
+	SqlScanner *scanner = (SqlScanner *)malloc(sizeof(SqlScanner));
+	if (scanner == NULL) {
+		return NULL;
+	}
+	memset(scanner, 0, sizeof(SqlScanner));
+	if (yylex_init(&scanner->scanner) != 0) {
+		free(scanner);
+		return NULL;
+	}
+	return scanner;
+}
 
-int sql_parse(const char *s, Query *sqls){
+void sql_scanner_destroy(void *s){
+	SqlScanner *scanner = (SqlScanner *)s;
+	if (scanner == NULL) {
+		return;
+	}
+	yylex_destroy(scanner->scanner);
+	free(scanner->buffer);
+	free(scanner);
+}
+
+static int sql_parse_internal(SqlScanner *scanner, const char *s, Query *sqls, int allow_params, size_t *param_num){
 	ParserContext context;
 	memset(&context, 0, sizeof(context));
-
-	yyscan_t scanner;
-	yylex_init_extra(&context, &scanner);
 	context.ssql = sqls;
-	scan_string(s, scanner);
-	int result = yyparse(scanner);
-	yylex_destroy(scanner);
+
+	// 输入缓冲只在语句变长时扩大
+	const size_t len = strlen(s);
+	if (len + 2 > scanner->capacity) {
+		size_t capacity = scanner->capacity * 2 > len + 2 ? scanner->capacity * 2 : len + 2;
+		char *buffer = (char *)realloc(scanner->buffer, capacity);
+		if (buffer == NULL) {
+			sqls->flag = SCF_ERROR;
+			return -1;
+		}
+		scanner->buffer = buffer;
+		scanner->capacity = capacity;
+	}
+	memcpy(scanner->buffer, s, len);
+	scanner->buffer[len] = '\0';
+	scanner->buffer[len + 1] = '\0';
+
+	yyset_extra(&context, scanner->scanner);
+	YY_BUFFER_STATE buffer = yy_scan_buffer(scanner->buffer, len + 2, scanner->scanner);
+	int result = yyparse(scanner->scanner);
+	yy_delete_buffer(buffer, scanner->scanner);
+	yyset_extra(NULL, scanner->scanner);
+	if (result == 0 && context.param_num > 0 && !allow_params) {
+		// 参数?只能出现在PREPARE的语句中
+		query_reset(sqls);
+		sqls->flag = SCF_ERROR;
+		result = -1;
+	}
+	if (param_num != NULL) {
+		*param_num = context.param_num;
+	}
 	return result;
 }
+
+int sql_parse(void *scanner, const char *s, Query *sqls){
+	return sql_parse_internal((SqlScanner *)scanner, s, sqls, 0, NULL);
+}
+
+// 解析常量换成?之后的语句，参数留在语句中，个数放在param_num
+int sql_parse_template(void *scanner, const char *s, Query *sqls, size_t *param_num){
+	return sql_parse_internal((SqlScanner *)scanner, s, sqls, 1, param_num);
+}
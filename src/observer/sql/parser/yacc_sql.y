@@ -9,6 +9,7 @@
 #include<stdio.h>
 #include<stdlib.h>
 #include<string.h>
+#include<strings.h>
 
 typedef struct ParserContext {
   Query * ssql;
@@ -21,22 +22,33 @@ typedef struct ParserContext {
   Condition conditions[MAX_NUM];
   CompOp comp;
 	char id[MAX_NUM];
+  Selects *sub_selects[MAX_NUM];        // 正在解析的子查询，最后一个是最内层的
+  size_t sub_condition_starts[MAX_NUM]; // 每个子查询的条件在conditions中开始的位置
+  size_t sub_select_depth;
+  size_t param_num;                     // 预编译语句中参数?的个数
+  ExprCondition expr_conditions[MAX_NUM];        // 带表达式的条件，和conditions一样按子查询分段
+  size_t expr_condition_length;
+  size_t sub_expr_condition_starts[MAX_NUM];
+  int last_token;                       // 词法分析返回的上一个token
 } ParserContext;
 
-//获取子串
-char *substr(const char *s,int n1,int n2)/*从s中提取下标为n1~n2的字符组成一个新字符串，然后返回这个新串的首地址*/
+// 词法分析得到的标识符和字符串也放在语句的arena中，在lex_sql.l中使用
+char *context_strdup(void *context, const char *s)
 {
-  // printf("start call substr on s %s with n1 is %d and n2 is %d \n",s,n1,n2);
-  char *sp = malloc(sizeof(char) * (n2 - n1 + 2));
-  int i, j = 0;
-  
-  // printf("now the substr is going \n");
-  for (i = n1; i <= n2; i++) {
-    sp[j++] = s[i];
-  }
-  sp[j] = 0;
-  // printf("now the substr end and new string is %s \n",sp);
-  return sp;
+  return arena_strdup(&((ParserContext *)context)->ssql->arena, s);
+}
+
+// 词法分析器返回token时记录下来。a -1中的-1前面是字段，这时-是减号，不是负数的一部分
+int context_token(void *context, int token)
+{
+  ((ParserContext *)context)->last_token = token;
+  return token;
+}
+
+int context_after_operand(void *context)
+{
+  const int token = ((ParserContext *)context)->last_token;
+  return token == ID || token == NUMBER || token == FLOAT || token == SSS || token == RBRACE || token == '?';
 }
 
 void yyerror(yyscan_t scanner, const char *str)
@@ -50,10 +62,10 @@ void yyerror(yyscan_t scanner, const char *str)
   context->select_length = 0;
   context->value_length = 0;
   context->insert_index = 0;
-  for (size_t i = 0; i < MAX_NUM; i++) {
-  	context->ssql->sstr.insertion.value_num[i] = 0;
-  }
-  context->ssql->sstr.insertion.group_num = 0;
+  // 子查询也在语句的arena中，已经随着query_reset释放
+  context->sub_select_depth = 0;
+  context->param_num = 0;
+  context->expr_condition_length = 0;
   printf("parse sql failed. error=%s", str);
 }
 
@@ -63,6 +75,57 @@ ParserContext *get_context(yyscan_t scanner)
 }
 
 #define CONTEXT get_context(scanner)
+#define ARENA (&CONTEXT->ssql->arena)
+
+// select的列、表和条件加入正在解析的最内层的子查询，不在子查询中时加入外层的select
+Selects *current_selects(ParserContext *context)
+{
+  if (context->sub_select_depth > 0) {
+    return context->sub_selects[context->sub_select_depth - 1];
+  }
+  return &context->ssql->sstr.selection;
+}
+
+static int expr_is_simple(const Expr *expr)
+{
+  return expr == NULL || expr->type == EXPR_ATTR || expr->type == EXPR_VALUE;
+}
+
+/**
+ * where中的比较。两侧都是字段或者常量时还是普通的条件，可以下推到扫描、使用索引，
+ * 否则放进带表达式的条件，right为NULL时是is null和is not null
+ */
+int context_add_condition(ParserContext *context, CompOp comp, Expr *left, Expr *right)
+{
+  Arena *arena = &context->ssql->arena;
+  if (expr_is_simple(left) && expr_is_simple(right)) {
+    if (context->condition_length >= MAX_NUM) {
+      return 0;
+    }
+    Value null_value;
+    Value *right_value = NULL;
+    if (right == NULL) {
+      value_init_string(arena, &null_value, "NULL", true);
+      right_value = &null_value;
+    } else if (right->type == EXPR_VALUE) {
+      right_value = &right->value;
+    }
+    Condition condition;
+    memset(&condition, 0, sizeof(condition));
+    condition_init(&condition, comp, left->type == EXPR_ATTR, &left->attr, &left->value,
+        right != NULL && right->type == EXPR_ATTR, right != NULL ? &right->attr : NULL, right_value);
+    context->conditions[context->condition_length++] = condition;
+    return 1;
+  }
+  if (context->expr_condition_length >= MAX_NUM) {
+    return 0;
+  }
+  ExprCondition *condition = &context->expr_conditions[context->expr_condition_length++];
+  condition->comp = comp;
+  condition->left = left;
+  condition->right = right;
+  return 1;
+}
 
 %}
 
@@ -123,11 +186,38 @@ ParserContext *get_context(yyscan_t scanner)
 		NULL_T
         INNER
         JOIN
-        
+        LIMIT
+        OFFSET
+        IN
+        EXISTS
+        LIKE
+        PREPARE
+        EXECUTE
+        DEALLOCATE
+        USING
+        SAVEPOINT
+        RELEASE
+        TO
+        PARTITION
+        ALTER
+        TRUNCATE
+        ANALYZE
+        EXPLAIN
+        DISTINCT
+        OVER
+
+// 表达式中运算符的优先级，一元的负号最高
+%left '+' '-'
+%left STAR '/'
+%nonassoc UMINUS
+
 %union {
-  struct _Attr *attr;
+  struct _RelAttr *attr;
+  struct _WindowSpec *window1;
   struct _Condition *condition1;
   struct _Value *value1;
+  struct _Selects *selects1;
+  struct _Expr *expr1;
   char *string;
   //char *date;
   int number;
@@ -153,6 +243,18 @@ ParserContext *get_context(yyscan_t scanner)
 %type <number> number;
 %type <number> opt_null;
 %type <string> opt_star;
+%type <attr> select_item;
+%type <attr> window_function;
+%type <attr> window_call;
+%type <expr1> expr;
+%type <expr1> func_call;
+%type <expr1> func_args;
+%type <attr> window_attr;
+%type <attr> window_sort_attr;
+%type <window1> window_spec;
+%type <window1> window_partition;
+%type <window1> window_order;
+%type <selects1> sub_select;
 
 %%
 
@@ -163,22 +265,77 @@ commands:		//commands or sqls. parser starts here.
 
 command:
 	  select  
+	| explain
 	| insert
 	| update
 	| delete
 	| create_table
 	| drop_table
+	| drop_view
+	| truncate_table
+	| analyze_table
+	| alter_table
 	| show_tables
+	| show_buffer_pool
+	| show_statement_stats
+	| reset_statement_stats
+	| show_processlist
+	| kill_query
 	| desc_table
 	| create_index	
+	| create_view
 	| drop_index
 	| sync
 	| begin
 	| commit
 	| rollback
 	| load_data
+	| backup
+	| declare_cursor
+	| fetch
+	| close_cursor
 	| help
 	| exit
+	| prepare
+	| execute
+	| deallocate
+	| savepoint
+	| rollback_to_savepoint
+	| release_savepoint
+	| set_variable
+    ;
+
+prepare:
+    PREPARE ID FROM prepared_command {
+      prepare_init(CONTEXT->ssql, $2, CONTEXT->param_num);
+      CONTEXT->param_num = 0;
+    }
+    ;
+
+prepared_command:	/* 可以预编译的语句 */
+	  select
+	| insert
+	| update
+	| delete
+    ;
+
+execute:
+    EXECUTE ID SEMICOLON {
+      CONTEXT->ssql->flag = SCF_EXECUTE;
+      execute_init(ARENA, &CONTEXT->ssql->sstr.execute, $2, CONTEXT->values, 0);
+    }
+    | EXECUTE ID USING value value_list SEMICOLON {
+      CONTEXT->ssql->flag = SCF_EXECUTE;
+      execute_init(ARENA, &CONTEXT->ssql->sstr.execute, $2, CONTEXT->values, CONTEXT->value_length);
+      CONTEXT->value_length = 0;
+    }
+    ;
+
+deallocate:
+    DEALLOCATE PREPARE ID SEMICOLON {
+      CONTEXT->ssql->flag = SCF_DEALLOCATE;
+      deallocate_init(ARENA, &CONTEXT->ssql->sstr.deallocate, $3);
+    }
     ;
 
 exit:			
@@ -215,30 +372,220 @@ rollback:
     }
     ;
 
+savepoint:
+    SAVEPOINT ID SEMICOLON {
+      CONTEXT->ssql->flag = SCF_SAVEPOINT;
+      savepoint_init(ARENA, &CONTEXT->ssql->sstr.savepoint, $2);
+    }
+    ;
+
+rollback_to_savepoint:
+    TRX_ROLLBACK TO ID SEMICOLON {
+      CONTEXT->ssql->flag = SCF_ROLLBACK_TO_SAVEPOINT;
+      savepoint_init(ARENA, &CONTEXT->ssql->sstr.savepoint, $3);
+    }
+    | TRX_ROLLBACK TO SAVEPOINT ID SEMICOLON {
+      CONTEXT->ssql->flag = SCF_ROLLBACK_TO_SAVEPOINT;
+      savepoint_init(ARENA, &CONTEXT->ssql->sstr.savepoint, $4);
+    }
+    ;
+
+release_savepoint:
+    RELEASE SAVEPOINT ID SEMICOLON {
+      CONTEXT->ssql->flag = SCF_RELEASE_SAVEPOINT;
+      savepoint_init(ARENA, &CONTEXT->ssql->sstr.savepoint, $3);
+    }
+    ;
+
+set_variable:
+    SET ID EQ ID SEMICOLON {
+      CONTEXT->ssql->flag = SCF_SET_VARIABLE;
+      set_variable_init(ARENA, &CONTEXT->ssql->sstr.set_variable, $2, $4);
+    }
+    | SET ID EQ ON SEMICOLON {
+      CONTEXT->ssql->flag = SCF_SET_VARIABLE;
+      set_variable_init(ARENA, &CONTEXT->ssql->sstr.set_variable, $2, "on");
+    }
+    | SET ID EQ NUMBER SEMICOLON {
+      CONTEXT->ssql->flag = SCF_SET_VARIABLE;
+      set_variable_init(ARENA, &CONTEXT->ssql->sstr.set_variable, $2, number_to_str(ARENA, $4));
+    }
+    ;
+
 drop_table:		/*drop table 语句的语法解析树*/
     DROP TABLE ID SEMICOLON {
         CONTEXT->ssql->flag = SCF_DROP_TABLE;//"drop_table";
-        drop_table_init(&CONTEXT->ssql->sstr.drop_table, $3);
+        drop_table_init(ARENA, &CONTEXT->ssql->sstr.drop_table, $3);
+    };
+
+create_view:
+    CREATE ID ID ID ID select {
+        // create materialized view名字as select ...，materialized、view和as不作为关键字
+        if (strcasecmp($2, "materialized") != 0 || strcasecmp($3, "view") != 0 || strcasecmp($5, "as") != 0) {
+            yyerror(scanner, "unknown create statement");
+            YYABORT;
+        }
+        create_view_init(CONTEXT->ssql, $4);
+    }
+    ;
+
+drop_view:
+    DROP ID ID ID SEMICOLON {
+        // 物化视图也是一张表，删除视图就是删除这张表
+        if (strcasecmp($2, "materialized") != 0 || strcasecmp($3, "view") != 0) {
+            yyerror(scanner, "unknown drop statement");
+            YYABORT;
+        }
+        CONTEXT->ssql->flag = SCF_DROP_TABLE;
+        drop_table_init(ARENA, &CONTEXT->ssql->sstr.drop_table, $4);
+    }
+    ;
+
+truncate_table:
+    TRUNCATE TABLE ID SEMICOLON {
+        CONTEXT->ssql->flag = SCF_TRUNCATE_TABLE;
+        truncate_table_init(ARENA, &CONTEXT->ssql->sstr.truncate_table, $3);
+    };
+
+analyze_table:
+    ANALYZE TABLE ID SEMICOLON {
+        CONTEXT->ssql->flag = SCF_ANALYZE_TABLE;
+        analyze_table_init(ARENA, &CONTEXT->ssql->sstr.analyze_table, $3);
     };
 
+alter_table:
+    ALTER TABLE ID DROP PARTITION ID SEMICOLON {
+        // 删除range分区的数据文件和索引文件，不用逐条删除记录
+        CONTEXT->ssql->flag = SCF_DROP_PARTITION;
+        drop_partition_init(ARENA, &CONTEXT->ssql->sstr.drop_partition, $3, $6);
+    }
+    ;
+
 show_tables:
     SHOW TABLES SEMICOLON {
       CONTEXT->ssql->flag = SCF_SHOW_TABLES;
     }
     ;
 
+show_buffer_pool:
+    SHOW ID ID ID SEMICOLON {
+      // buffer/pool/status 不是关键字，避免和同名的表或字段冲突
+      if (strcasecmp($2, "buffer") != 0 || strcasecmp($3, "pool") != 0 || strcasecmp($4, "status") != 0) {
+        yyerror(scanner, "unknown show command");
+        YYABORT;
+      }
+      CONTEXT->ssql->flag = SCF_SHOW_BUFFER_POOL;
+    }
+    ;
+
+show_statement_stats:
+    SHOW ID ID SEMICOLON {
+      if (strcasecmp($2, "statement") != 0 || strcasecmp($3, "stats") != 0) {
+        yyerror(scanner, "unknown show command");
+        YYABORT;
+      }
+      CONTEXT->ssql->flag = SCF_SHOW_STATEMENT_STATS;
+    }
+    ;
+
+reset_statement_stats:
+    TRUNCATE ID ID SEMICOLON {
+      if (strcasecmp($2, "statement") != 0 || strcasecmp($3, "stats") != 0) {
+        yyerror(scanner, "unknown truncate command");
+        YYABORT;
+      }
+      CONTEXT->ssql->flag = SCF_RESET_STATEMENT_STATS;
+    }
+    ;
+
+show_processlist:
+    SHOW ID SEMICOLON {
+      if (strcasecmp($2, "processlist") != 0) {
+        yyerror(scanner, "unknown show command");
+        YYABORT;
+      }
+      CONTEXT->ssql->flag = SCF_SHOW_PROCESSLIST;
+    }
+    ;
+
+kill_query:
+    ID ID NUMBER SEMICOLON {
+      // kill/query 不是关键字
+      if (strcasecmp($1, "kill") != 0 || strcasecmp($2, "query") != 0) {
+        yyerror(scanner, "unknown command");
+        YYABORT;
+      }
+      CONTEXT->ssql->flag = SCF_KILL_QUERY;
+      CONTEXT->ssql->sstr.kill_query.connection_id = $3;
+    }
+    ;
+
 desc_table:
     DESC ID SEMICOLON {
       CONTEXT->ssql->flag = SCF_DESC_TABLE;
-      desc_table_init(&CONTEXT->ssql->sstr.desc_table, $2);
+      desc_table_init(ARENA, &CONTEXT->ssql->sstr.desc_table, $2);
     }
     ;
 
 create_index:		/*create index 语句的语法解析树*/
-    CREATE INDEX ID ON ID LBRACE ID RBRACE SEMICOLON 
+    CREATE INDEX ID ON ID LBRACE index_attr_list RBRACE opt_index_using SEMICOLON 
 		{
 			CONTEXT->ssql->flag = SCF_CREATE_INDEX;//"create_index";
-			create_index_init(&CONTEXT->ssql->sstr.create_index, $3, $5, $7);
+			create_index_init(ARENA, &CONTEXT->ssql->sstr.create_index, $3, $5, 0);
+		}
+    | CREATE ID INDEX ID ON ID LBRACE index_attr_list RBRACE opt_index_using SEMICOLON
+		{
+			// unique 不是关键字，避免和同名的表或字段冲突
+			if (strcasecmp($2, "unique") != 0) {
+				yyerror(scanner, "unknown create index option");
+				YYABORT;
+			}
+			CONTEXT->ssql->flag = SCF_CREATE_INDEX;
+			create_index_init(ARENA, &CONTEXT->ssql->sstr.create_index, $4, $6, 1);
+		}
+    ;
+opt_index_using:
+    /* empty */
+    | ID ID {
+			// using btree/hash，和unique一样不作为关键字
+			if (strcasecmp($1, "using") != 0) {
+				yyerror(scanner, "unknown create index option");
+				YYABORT;
+			}
+			if (strcasecmp($2, "hash") == 0) {
+				create_index_set_type(&CONTEXT->ssql->sstr.create_index, HASH_INDEX);
+			} else if (strcasecmp($2, "btree") == 0) {
+				create_index_set_type(&CONTEXT->ssql->sstr.create_index, BPLUS_TREE_INDEX);
+			} else {
+				yyerror(scanner, "unknown index type");
+				YYABORT;
+			}
+		}
+    ;
+index_attr_list:
+    index_attr
+    | index_attr_list COMMA index_attr
+    ;
+index_attr:
+    ID {
+			// 多字段索引，字段按照书写的顺序比较
+			if (CONTEXT->ssql->sstr.create_index.attribute_num >= MAX_NUM) {
+				yyerror(scanner, "too many index attributes");
+				YYABORT;
+			}
+			create_index_append_attribute(ARENA, &CONTEXT->ssql->sstr.create_index, $1, 0);
+		}
+    | ID LBRACE NUMBER RBRACE {
+			// name(8)：字符串字段只把前8个字符放到索引中
+			if (CONTEXT->ssql->sstr.create_index.attribute_num >= MAX_NUM) {
+				yyerror(scanner, "too many index attributes");
+				YYABORT;
+			}
+			if ($3 <= 0) {
+				yyerror(scanner, "invalid index prefix length");
+				YYABORT;
+			}
+			create_index_append_attribute(ARENA, &CONTEXT->ssql->sstr.create_index, $1, $3);
 		}
     ;
 
@@ -246,29 +593,145 @@ drop_index:			/*drop index 语句的语法解析树*/
     DROP INDEX ID  SEMICOLON 
 		{
 			CONTEXT->ssql->flag=SCF_DROP_INDEX;//"drop_index";
-			drop_index_init(&CONTEXT->ssql->sstr.drop_index, $3);
+			drop_index_init(ARENA, &CONTEXT->ssql->sstr.drop_index, $3);
 		}
     ;
 create_table:		/*create table 语句的语法解析树*/
-    CREATE TABLE ID LBRACE attr_def attr_def_list RBRACE SEMICOLON 
+    CREATE TABLE ID LBRACE attr_def attr_def_list RBRACE table_option_list opt_partition SEMICOLON 
 		{
 			CONTEXT->ssql->flag=SCF_CREATE_TABLE;//"create_table";
 			// CONTEXT->ssql->sstr.create_table.attribute_count = CONTEXT->value_length;
-			create_table_init_name(&CONTEXT->ssql->sstr.create_table, $3);
+			create_table_init_name(ARENA, &CONTEXT->ssql->sstr.create_table, $3);
 			//临时变量清零	
 			CONTEXT->value_length = 0;
 		}
     ;
+table_option_list:
+    /* empty */
+    | table_option table_option_list {    }
+    ;
+table_option:
+    ID EQ NUMBER {
+			// page_size=<字节数>，单独建表时指定页面大小
+			if (strcasecmp($1, "page_size") != 0) {
+				yyerror(scanner, "unknown table option");
+				YYABORT;
+			}
+			create_table_set_page_size(&CONTEXT->ssql->sstr.create_table, $3);
+		}
+    | ID EQ ID {
+			// compression=<none|zlib|lz4|zstd>，数据文件的页面压缩方式
+			// format=<row|pax>，数据文件中记录的存放方式
+			// engine=<disk|memory>，memory的表只保存在内存中
+			// bloom_filter=<字段>，记录文件的每个区段为这个字段建布隆过滤器
+			// dictionary=<字段>，CHARS字段用字典编码，可以指定多次
+			if (strcasecmp($1, "compression") == 0) {
+				create_table_set_compression(ARENA, &CONTEXT->ssql->sstr.create_table, $3);
+			} else if (strcasecmp($1, "format") == 0) {
+				create_table_set_format(ARENA, &CONTEXT->ssql->sstr.create_table, $3);
+			} else if (strcasecmp($1, "engine") == 0) {
+				create_table_set_engine(ARENA, &CONTEXT->ssql->sstr.create_table, $3);
+			} else if (strcasecmp($1, "bloom_filter") == 0) {
+				create_table_set_bloom_filter(ARENA, &CONTEXT->ssql->sstr.create_table, $3);
+			} else if (strcasecmp($1, "dictionary") == 0) {
+				if (create_table_set_dictionary(&CONTEXT->ssql->sstr.create_table, $3) != 0) {
+					yyerror(scanner, "dictionary field must be a chars field of the table");
+					YYABORT;
+				}
+			} else {
+				yyerror(scanner, "unknown table option");
+				YYABORT;
+			}
+		}
+    ;
+opt_partition:
+    /* empty */
+    | PARTITION BY ID LBRACE ID RBRACE LBRACE range_partition range_partition_list RBRACE {
+			// partition by range(字段) (partition 名字 values less than (值), ...)
+			if (strcasecmp($3, "range") != 0) {
+				yyerror(scanner, "unknown partition type");
+				YYABORT;
+			}
+			create_table_set_partition(ARENA, &CONTEXT->ssql->sstr.create_table, RANGE_PARTITION, $5);
+		}
+    | PARTITION BY ID LBRACE ID RBRACE ID NUMBER {
+			// partition by hash(字段) partitions 个数
+			if (strcasecmp($3, "hash") != 0 || strcasecmp($7, "partitions") != 0) {
+				yyerror(scanner, "unknown partition type");
+				YYABORT;
+			}
+			if ($8 <= 0 || $8 > MAX_PARTITION_NUM) {
+				yyerror(scanner, "invalid partition number");
+				YYABORT;
+			}
+			create_table_set_partition(ARENA, &CONTEXT->ssql->sstr.create_table, HASH_PARTITION, $5);
+			create_table_set_hash_partitions(&CONTEXT->ssql->sstr.create_table, $8);
+		}
+    ;
+range_partition_list:
+    /* empty */
+    | COMMA range_partition range_partition_list {    }
+    ;
+range_partition:
+    PARTITION ID VALUES ID ID LBRACE value RBRACE {
+			const Value *bound = &CONTEXT->values[CONTEXT->value_length - 1];
+			if (strcasecmp($4, "less") != 0 || strcasecmp($5, "than") != 0 || bound->type == UNDEFINED ||
+			    bound->is_null) {
+				yyerror(scanner, "invalid partition bound");
+				YYABORT;
+			}
+			if (CONTEXT->ssql->sstr.create_table.partition.partition_num >= MAX_PARTITION_NUM) {
+				yyerror(scanner, "too many partitions");
+				YYABORT;
+			}
+			create_table_append_range_partition(ARENA, &CONTEXT->ssql->sstr.create_table, $2, bound);
+		}
+    | PARTITION ID VALUES ID ID ID {
+			// maxvalue只能是最后一个分区，建表时检查
+			if (strcasecmp($4, "less") != 0 || strcasecmp($5, "than") != 0 || strcasecmp($6, "maxvalue") != 0) {
+				yyerror(scanner, "invalid partition bound");
+				YYABORT;
+			}
+			if (CONTEXT->ssql->sstr.create_table.partition.partition_num >= MAX_PARTITION_NUM) {
+				yyerror(scanner, "too many partitions");
+				YYABORT;
+			}
+			create_table_append_range_partition(ARENA, &CONTEXT->ssql->sstr.create_table, $2, NULL);
+		}
+    ;
 attr_def_list:
     /* empty */
     | COMMA attr_def attr_def_list {    }
+    | COMMA primary_key {    }
+    ;
+primary_key:
+    ID ID LBRACE primary_key_attr_list RBRACE {
+			// primary key(字段, ...)写在所有字段的后面，primary和key不作为关键字
+			if (strcasecmp($1, "primary") != 0 || strcasecmp($2, "key") != 0) {
+				yyerror(scanner, "unknown table constraint");
+				YYABORT;
+			}
+		}
+    ;
+primary_key_attr_list:
+    primary_key_attr
+    | primary_key_attr_list COMMA primary_key_attr
+    ;
+primary_key_attr:
+    ID {
+			if (CONTEXT->ssql->sstr.create_table.primary_key_num >= MAX_NUM) {
+				yyerror(scanner, "too many primary key attributes");
+				YYABORT;
+			}
+			create_table_append_primary_key(ARENA, &CONTEXT->ssql->sstr.create_table, $1);
+		}
     ;
     
 attr_def:
     ID_get type LBRACE number RBRACE opt_null
 		{
 			AttrInfo attribute;
-			attr_info_init(&attribute, CONTEXT->id, $2, $4, $6);
+			attr_info_init(ARENA, &attribute, CONTEXT->id, $2, $4, $6);
 			create_table_append_attribute(&CONTEXT->ssql->sstr.create_table, &attribute);
 			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].name =(char*)malloc(sizeof(char));
 			// strcpy(CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].name, CONTEXT->id); 
@@ -279,7 +742,7 @@ attr_def:
     |ID_get type opt_null
 		{
 			AttrInfo attribute;
-			attr_info_init(&attribute, CONTEXT->id, $2, 4, $3);
+			attr_info_init(ARENA, &attribute, CONTEXT->id, $2, 4, $3);
 			create_table_append_attribute(&CONTEXT->ssql->sstr.create_table, &attribute);
 			// CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].name=(char*)malloc(sizeof(char));
 			// strcpy(CONTEXT->ssql->sstr.create_table.attributes[CONTEXT->value_length].name, CONTEXT->id); 
@@ -342,7 +805,7 @@ insert:				/*insert   语句的语法解析树*/
 			// for(i = 0; i < CONTEXT->value_length; i++){
 			// 	CONTEXT->ssql->sstr.insertion.values[i] = CONTEXT->values[i];
       // }	// 到此结束所有插入：存储最后一组、index清零、length清零
-	  		inserts_init(&CONTEXT->ssql->sstr.insertion, CONTEXT->id, CONTEXT->values, CONTEXT->value_length, CONTEXT->insert_index);
+	  		inserts_init(ARENA, &CONTEXT->ssql->sstr.insertion, CONTEXT->id, CONTEXT->values, CONTEXT->value_length, CONTEXT->insert_index);
 			CONTEXT->insert_index=0;
 			//临时变量清零
       		CONTEXT->value_length=0;
@@ -351,14 +814,14 @@ insert:				/*insert   语句的语法解析树*/
 multi_values:
 	LBRACE value value_list RBRACE {
 		// 到此结束一组的插入：存储该组、增加index、value_length清零
-		inserts_init(&CONTEXT->ssql->sstr.insertion, CONTEXT->id, CONTEXT->values, CONTEXT->value_length, CONTEXT->insert_index);
+		inserts_init(ARENA, &CONTEXT->ssql->sstr.insertion, CONTEXT->id, CONTEXT->values, CONTEXT->value_length, CONTEXT->insert_index);
 		CONTEXT->insert_index++;
 		//临时变量清零
       	CONTEXT->value_length=0;
 	}
 	|multi_values COMMA LBRACE value value_list RBRACE {
 		// 到此结束一组的插入：存储该组、增加index、value_length清零
-		inserts_init(&CONTEXT->ssql->sstr.insertion, CONTEXT->id, CONTEXT->values, CONTEXT->value_length, CONTEXT->insert_index);
+		inserts_init(ARENA, &CONTEXT->ssql->sstr.insertion, CONTEXT->id, CONTEXT->values, CONTEXT->value_length, CONTEXT->insert_index);
 		CONTEXT->insert_index++;
 		//临时变量清零
       	CONTEXT->value_length=0;
@@ -372,19 +835,24 @@ value_list:
     ;
 value:
     NUMBER{	
-  		value_init_integer(&CONTEXT->values[CONTEXT->value_length++], $1, false);
+  		value_init_integer(ARENA, &CONTEXT->values[CONTEXT->value_length++], $1, false);
 	}
     |FLOAT{
-  		value_init_float(&CONTEXT->values[CONTEXT->value_length++], $1, false);
+  		value_init_float(ARENA, &CONTEXT->values[CONTEXT->value_length++], $1, false);
 	}
 	|NULL_T {
 		// null不需要加双引号，当作字符串插入
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
+		value_init_string(ARENA, &CONTEXT->values[CONTEXT->value_length++], "NULL", true);
 	}
     |SSS {
-		$1 = substr($1,1,strlen($1)-2);
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], $1, false);
+		// 去掉两边的引号
+		$1[strlen($1) - 1] = '\0';
+		value_init_string(ARENA, &CONTEXT->values[CONTEXT->value_length++], $1 + 1, false);
 		}
+	|'?' {
+		// 预编译语句的参数，按出现的顺序编号
+		value_init_param(ARENA, &CONTEXT->values[CONTEXT->value_length++], CONTEXT->param_num++);
+	}
     ;
 
     
@@ -392,7 +860,11 @@ delete:		/*  delete 语句的语法解析树*/
     DELETE FROM ID where SEMICOLON 
 		{
 			CONTEXT->ssql->flag = SCF_DELETE;//"delete";
-			deletes_init_relation(&CONTEXT->ssql->sstr.deletion, $3);
+			if (CONTEXT->expr_condition_length > 0) {
+				yyerror(scanner, "expression conditions are only supported in select");
+				YYABORT;
+			}
+			deletes_init_relation(ARENA, &CONTEXT->ssql->sstr.deletion, $3);
 			deletes_set_conditions(&CONTEXT->ssql->sstr.deletion, 
 					CONTEXT->conditions, CONTEXT->condition_length);
 			CONTEXT->condition_length = 0;	
@@ -401,148 +873,343 @@ delete:		/*  delete 语句的语法解析树*/
 update:			/*  update 语句的语法解析树*/
     UPDATE ID SET ID EQ value where SEMICOLON
 		{
+			if (CONTEXT->expr_condition_length > 0) {
+				yyerror(scanner, "expression conditions are only supported in select");
+				YYABORT;
+			}
 			CONTEXT->ssql->flag = SCF_UPDATE;//"update";
 			Value *value = &CONTEXT->values[0];
-			updates_init(&CONTEXT->ssql->sstr.update, $2, $4, value, 
+			updates_init(ARENA, &CONTEXT->ssql->sstr.update, $2, $4, value, 
 					CONTEXT->conditions, CONTEXT->condition_length);
 			CONTEXT->condition_length = 0;
 		}
     ;
+explain:
+    EXPLAIN select {
+        selects_set_explain(&CONTEXT->ssql->sstr.selection, EXPLAIN_PLAN);
+    }
+    | EXPLAIN ANALYZE select {
+        selects_set_explain(&CONTEXT->ssql->sstr.selection, EXPLAIN_ANALYZE);
+    }
+    ;
+
 select:				/*  select 语句的语法解析树*/
-    SELECT select_attr FROM ID rel_list join_list where group_by order_by SEMICOLON
+    SELECT opt_distinct select_attr FROM ID rel_list join_list where group_by order_by limit opt_outfile SEMICOLON
 	    {
 			CONTEXT->ssql->flag=SCF_SELECT;//"select";
 
-			// CONTEXT->ssql->sstr.selection.relations[CONTEXT->from_length++]=$4;
-			selects_append_relation(&CONTEXT->ssql->sstr.selection, $4);
+			// CONTEXT->ssql->sstr.selection.relations[CONTEXT->from_length++]=$5;
+			selects_append_relation(ARENA, current_selects(CONTEXT), $5);
 
 			//selects_append_conditions(&CONTEXT->ssql->sstr.selection, CONTEXT->conditions, CONTEXT->condition_length);
-			selects_append_conditions(CONTEXT->ssql, CONTEXT->conditions, CONTEXT->condition_length);
+			selects_append_conditions(CONTEXT->ssql, current_selects(CONTEXT), CONTEXT->conditions, CONTEXT->condition_length);
+			selects_append_expr_conditions(current_selects(CONTEXT), CONTEXT->expr_conditions, CONTEXT->expr_condition_length);
 			
 			// CONTEXT->ssql->sstr.selection.attr_num = CONTEXT->select_length;
 			
 			//临时变量清零
 			CONTEXT->condition_length=0;
+			CONTEXT->expr_condition_length=0;
 			CONTEXT->from_length=0;
 			CONTEXT->select_length=0;
 			CONTEXT->value_length = 0;
 	    }
 	;
+opt_outfile:
+    /* empty */
+    | INTO ID SSS {
+        // outfile不作为关键字
+        if (strcasecmp($2, "outfile") != 0) {
+            yyerror(scanner, "unknown select into");
+            YYABORT;
+        }
+        selects_set_outfile(ARENA, current_selects(CONTEXT), $3);
+    }
+    ;
+opt_distinct:
+    /* empty */
+    | DISTINCT {
+			current_selects(CONTEXT)->distinct = 1;
+		}
+    ;
 select_attr:
     STAR {  // select *
 			RelAttr attr;
-			relation_attr_init(&attr, NULL, "*", NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+			relation_attr_init(ARENA, &attr, NULL, "*", NULL, 0);
+			selects_append_attribute(current_selects(CONTEXT), &attr);
 		}
-    | ID attr_list { // select age
-			RelAttr attr;
-			relation_attr_init(&attr, NULL, $1, NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+    | select_item attr_list {
+			// 和from中的表一样，select中的列按照相反的顺序保存
+			selects_append_attribute(current_selects(CONTEXT), $1);
 		}
-  	| ID DOT ID attr_list { // select t1.age
-			RelAttr attr;
-			relation_attr_init(&attr, $1, $3, NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
-		}
-	| ID DOT STAR attr_list { // select t1.*
-			RelAttr attr;
-			relation_attr_init(&attr, $1, "*", NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
-		}
-	| window_function function_list {
-		// 放到window_function里执行
-	}
     ;
 attr_list:
     /* empty */
-    | COMMA ID attr_list { // .., id
-			RelAttr attr;
-			relation_attr_init(&attr, NULL, $2, NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
-     	  // CONTEXT->ssql->sstr.selection.attributes[CONTEXT->select_length].relation_name = NULL;
-        // CONTEXT->ssql->sstr.selection.attributes[CONTEXT->select_length++].attribute_name=$2;
+    | COMMA select_item attr_list { // .., id
+			selects_append_attribute(current_selects(CONTEXT), $2);
       }
-    | COMMA ID DOT ID attr_list {
-			RelAttr attr;
-			relation_attr_init(&attr, $2, $4, NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
-        // CONTEXT->ssql->sstr.selection.attributes[CONTEXT->select_length].attribute_name=$4;
-        // CONTEXT->ssql->sstr.selection.attributes[CONTEXT->select_length++].relation_name=$2;
-  	  }
-    | COMMA ID DOT STAR attr_list {     // select t1.*, t2.*
-			RelAttr attr;
-			relation_attr_init(&attr, $2, "*", NULL, 0);
-			selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
-        // CONTEXT->ssql->sstr.selection.attributes[CONTEXT->select_length].attribute_name=$4;
-        // CONTEXT->ssql->sstr.selection.attributes[CONTEXT->select_length++].relation_name=$2;
-  	  }
   	;
+select_item:
+    expr { // age、t1.age、a + 1、upper(name)
+			if ($1->type == EXPR_ATTR) {
+				$$ = &$1->attr;
+			} else {
+				// 表达式的列没有表名和字段名，列名在执行时由表达式生成
+				$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+				relation_attr_init(ARENA, $$, NULL, "", NULL, 0);
+				$$->expr = $1;
+			}
+		}
+	| ID DOT STAR { // t1.*
+			$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+			relation_attr_init(ARENA, $$, $1, "*", NULL, 0);
+		}
+	| window_function {
+			$$ = $1;
+		}
+	;
 
 join_list:
     /* empty */
     | INNER JOIN ID on join_list{
-        selects_append_relation(&CONTEXT->ssql->sstr.selection, $3);
+        selects_append_relation(ARENA, current_selects(CONTEXT), $3);
     }
     ;
 
 window_function:
 	COUNT LBRACE opt_star RBRACE 
 	{	// 只有COUNT允许COUNT(*)
-		RelAttr attr;
-		relation_attr_init(&attr, NULL, $3, $1, 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, NULL, $3, $1, 0);
 	}
 	| COUNT LBRACE ID RBRACE 
 	{
-		RelAttr attr;
-		relation_attr_init(&attr, NULL, $3, $1, 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, NULL, $3, $1, 0);
 	}
 	| COUNT LBRACE ID DOT ID RBRACE 
 	{
-		RelAttr attr;
-		relation_attr_init(&attr, $3, $5, $1, 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, $3, $5, $1, 0);
 	}
 	| COUNT LBRACE ID DOT STAR RBRACE 
 	{
-		RelAttr attr;
-		relation_attr_init(&attr, $3, "*", $1, 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, $3, "*", $1, 0);
+	}
+	| COUNT LBRACE DISTINCT ID RBRACE 
+	{
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, NULL, $4, $1, 0);
+		$$->is_distinct = 1;
+	}
+	| COUNT LBRACE DISTINCT ID DOT ID RBRACE 
+	{
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, $4, $6, $1, 0);
+		$$->is_distinct = 1;
 	}
 	| OTHER_FUNCTION_TYPE LBRACE ID RBRACE 
 	{
-		RelAttr attr;
-		relation_attr_init(&attr, NULL, $3, $1, 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, NULL, $3, $1, 0);
 	}
 	| OTHER_FUNCTION_TYPE LBRACE ID DOT ID RBRACE 
 	{
-		RelAttr attr;
-		relation_attr_init(&attr, $3, $5, $1, 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, $3, $5, $1, 0);
 	}
 	| OTHER_FUNCTION_TYPE LBRACE ID DOT STAR RBRACE 
 	{
-		RelAttr attr;
-		relation_attr_init(&attr, $3, "*", $1, 0);
-		selects_append_attribute(&CONTEXT->ssql->sstr.selection, &attr);
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, $3, "*", $1, 0);
+	}
+	| COUNT LBRACE opt_star RBRACE OVER LBRACE window_spec RBRACE
+	{
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, NULL, $3, $1, 0);
+		$$->window = $7;
+	}
+	| window_call OVER LBRACE window_spec RBRACE
+	{
+		$$ = $1;
+		$$->window = $4;
+	}
+	| func_call OVER LBRACE window_spec RBRACE
+	{	// row_number()、rank()和dense_rank()没有参数，其它窗口函数的参数只能是字段
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		if ($1->arg_num == 0) {
+			relation_attr_init(ARENA, $$, NULL, "*", $1->function_name, 0);
+		} else if ($1->arg_num == 1 && $1->args[0]->type == EXPR_ATTR) {
+			relation_attr_init(ARENA, $$, $1->args[0]->attr.relation_name, $1->args[0]->attr.attribute_name,
+					$1->function_name, 0);
+		} else {
+			yyerror(scanner, "window function argument must be a column");
+			YYABORT;
+		}
+		$$->window = $4;
+	}
+	;
+window_call:
+	COUNT LBRACE ID RBRACE
+	{
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, NULL, $3, $1, 0);
+	}
+	| COUNT LBRACE ID DOT ID RBRACE
+	{
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, $3, $5, $1, 0);
+	}
+	| OTHER_FUNCTION_TYPE LBRACE ID RBRACE
+	{
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, NULL, $3, $1, 0);
+	}
+	| OTHER_FUNCTION_TYPE LBRACE ID DOT ID RBRACE
+	{
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, $3, $5, $1, 0);
+	}
+	;
+window_spec:
+	window_partition { $$ = $1; }
+	| window_order { $$ = $1; }
+	;
+window_partition:
+	/* empty */
+	{
+		$$ = window_spec_create(ARENA);
+	}
+	| PARTITION BY window_attr
+	{
+		$$ = window_spec_create(ARENA);
+		window_spec_append_partition($$, $3);
+	}
+	| window_partition COMMA window_attr
+	{
+		$$ = $1;
+		window_spec_append_partition($$, $3);
+	}
+	;
+window_order:
+	window_partition ORDER BY window_sort_attr
+	{
+		$$ = $1;
+		window_spec_append_order($$, $4);
+	}
+	| window_order COMMA window_sort_attr
+	{
+		$$ = $1;
+		window_spec_append_order($$, $3);
+	}
+	;
+window_attr:
+	ID
+	{
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, NULL, $1, NULL, 0);
+	}
+	| ID DOT ID
+	{
+		$$ = (RelAttr *)arena_alloc(ARENA, sizeof(RelAttr));
+		relation_attr_init(ARENA, $$, $1, $3, NULL, 0);
+	}
+	;
+window_sort_attr:
+	window_attr opt_asc { $$ = $1; }
+	| window_attr DESC
+	{
+		$$ = $1;
+		$$->is_desc = 1;
 	}
 	;
 opt_star:
 	STAR { $$ = $1;}
-	| NUMBER {$$ = number_to_str($1);}
+	| NUMBER {$$ = number_to_str(ARENA, $1);}
+	;
+expr:
+	expr '+' expr { $$ = expr_create_arith(ARENA, '+', $1, $3); }
+	| expr '-' expr { $$ = expr_create_arith(ARENA, '-', $1, $3); }
+	| expr STAR expr { $$ = expr_create_arith(ARENA, '*', $1, $3); }
+	| expr '/' expr { $$ = expr_create_arith(ARENA, '/', $1, $3); }
+	| '-' expr %prec UMINUS
+	{
+		// 数字常量直接取负，- 1和-1一样还是常量
+		Value *value = &$2->value;
+		if ($2->type == EXPR_VALUE && !value->is_null && value->type == INTS) {
+			*(int *)value->data = -*(int *)value->data;
+			$$ = $2;
+		} else if ($2->type == EXPR_VALUE && !value->is_null && value->type == FLOATS) {
+			*(float *)value->data = -*(float *)value->data;
+			$$ = $2;
+		} else {
+			$$ = expr_create_neg(ARENA, $2);
+		}
+	}
+	| LBRACE expr RBRACE { $$ = $2; }
+	| ID { $$ = expr_create_attr(ARENA, NULL, $1); }
+	| ID DOT ID { $$ = expr_create_attr(ARENA, $1, $3); }
+	| NUMBER
+	{
+		Value value;
+		value_init_integer(ARENA, &value, $1, false);
+		$$ = expr_create_value(ARENA, &value);
+	}
+	| FLOAT
+	{
+		Value value;
+		value_init_float(ARENA, &value, $1, false);
+		$$ = expr_create_value(ARENA, &value);
+	}
+	| NULL_T
+	{
+		Value value;
+		value_init_string(ARENA, &value, "NULL", true);
+		$$ = expr_create_value(ARENA, &value);
+	}
+	| SSS
+	{
+		Value value;
+		$1[strlen($1) - 1] = '\0';
+		value_init_string(ARENA, &value, $1 + 1, false);
+		$$ = expr_create_value(ARENA, &value);
+	}
+	| '?'
+	{
+		Value value;
+		value_init_param(ARENA, &value, CONTEXT->param_num++);
+		$$ = expr_create_value(ARENA, &value);
+	}
+	| func_call { $$ = $1; }
+	;
+func_call:
+	ID LBRACE RBRACE { $$ = expr_create_func(ARENA, $1); }
+	| ID LBRACE func_args RBRACE
+	{
+		$$ = $3;
+		$$->function_name = $1;
+	}
+	;
+func_args:
+	expr
+	{
+		$$ = expr_create_func(ARENA, NULL);
+		expr_append_arg($$, $1);
+	}
+	| func_args COMMA expr
+	{
+		$$ = $1;
+		if (!expr_append_arg($$, $3)) {
+			yyerror(scanner, "too many function arguments");
+			YYABORT;
+		}
+	}
 	;
-function_list:
-	/* empty */
-    | COMMA window_function function_list { // .., id
-		// 不操作，留给window_function执行
-      }
-  	;
 rel_list:
     /* empty */
     | COMMA ID rel_list {	
-				selects_append_relation(&CONTEXT->ssql->sstr.selection, $2);
+				selects_append_relation(ARENA, current_selects(CONTEXT), $2);
 		  }
     ;
 where:
@@ -566,217 +1233,100 @@ condition_list:
 			}
     ;
 condition:
-    ID comOp value 
-		{
-			RelAttr left_attr;
-			// $1 为属性名称
-			relation_attr_init(&left_attr, NULL, $1, NULL, 0);
-
-			Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 1, &left_attr, NULL, 0, NULL, right_value);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-			// $$ = ( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 1;
-			// $$->left_attr.relation_name = NULL;
-			// $$->left_attr.attribute_name= $1;
-			// $$->comp = CONTEXT->comp;
-			// $$->right_is_attr = 0;
-			// $$->right_attr.relation_name = NULL;
-			// $$->right_attr.attribute_name = NULL;
-			// $$->right_value = *$3;
-
-		}
-		|value comOp value 
+    expr comOp expr
 		{
-			Value *left_value = &CONTEXT->values[CONTEXT->value_length - 2];
-			Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 0, NULL, left_value, 0, NULL, right_value);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-			// $$ = ( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 0;
-			// $$->left_attr.relation_name=NULL;
-			// $$->left_attr.attribute_name=NULL;
-			// $$->left_value = *$1;
-			// $$->comp = CONTEXT->comp;
-			// $$->right_is_attr = 0;
-			// $$->right_attr.relation_name = NULL;
-			// $$->right_attr.attribute_name = NULL;
-			// $$->right_value = *$3;
-
-		}
-		|ID comOp ID 
-		{
-			RelAttr left_attr;
-			relation_attr_init(&left_attr, NULL, $1, NULL, 0);
-			RelAttr right_attr;
-			relation_attr_init(&right_attr, NULL, $3, NULL, 0);
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 1, &left_attr, NULL, 1, &right_attr, NULL);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-			// $$=( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 1;
-			// $$->left_attr.relation_name=NULL;
-			// $$->left_attr.attribute_name=$1;
-			// $$->comp = CONTEXT->comp;
-			// $$->right_is_attr = 1;
-			// $$->right_attr.relation_name=NULL;
-			// $$->right_attr.attribute_name=$3;
-
-		}
-    |value comOp ID
+			if (!context_add_condition(CONTEXT, CONTEXT->comp, $1, $3)) {
+				yyerror(scanner, "too many conditions");
+				YYABORT;
+			}
+		}
+	|expr IS NULL_T
 		{
-			Value *left_value = &CONTEXT->values[CONTEXT->value_length - 1];
-			RelAttr right_attr;
-			relation_attr_init(&right_attr, NULL, $3, NULL, 0);
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 0, NULL, left_value, 1, &right_attr, NULL);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-
-			// $$=( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 0;
-			// $$->left_attr.relation_name=NULL;
-			// $$->left_attr.attribute_name=NULL;
-			// $$->left_value = *$1;
-			// $$->comp=CONTEXT->comp;
-			
-			// $$->right_is_attr = 1;
-			// $$->right_attr.relation_name=NULL;
-			// $$->right_attr.attribute_name=$3;
-		
+			if (!context_add_condition(CONTEXT, IS_NULL, $1, NULL)) {
+				yyerror(scanner, "too many conditions");
+				YYABORT;
+			}
 		}
-    |ID DOT ID comOp value
+	|expr IS NOT NULL_T
 		{
-			RelAttr left_attr;
-			// $1为表名，$3为属性名
-			relation_attr_init(&left_attr, $1, $3, NULL, 0);
-			Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 1, &left_attr, NULL, 0, NULL, right_value);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-
-			// $$=( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 1;
-			// $$->left_attr.relation_name=$1;
-			// $$->left_attr.attribute_name=$3;
-			// $$->comp=CONTEXT->comp;
-			// $$->right_is_attr = 0;   //属性值
-			// $$->right_attr.relation_name=NULL;
-			// $$->right_attr.attribute_name=NULL;
-			// $$->right_value =*$5;			
-							
-    }
-    |value comOp ID DOT ID
+			if (!context_add_condition(CONTEXT, IS_NOT_NULL, $1, NULL)) {
+				yyerror(scanner, "too many conditions");
+				YYABORT;
+			}
+		}
+	|expr LIKE expr
 		{
-			Value *left_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
-			RelAttr right_attr;
-			relation_attr_init(&right_attr, $3, $5, NULL, 0);
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 0, NULL, left_value, 1, &right_attr, NULL);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-			// $$=( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 0;//属性值
-			// $$->left_attr.relation_name=NULL;
-			// $$->left_attr.attribute_name=NULL;
-			// $$->left_value = *$1;
-			// $$->comp =CONTEXT->comp;
-			// $$->right_is_attr = 1;//属性
-			// $$->right_attr.relation_name = $3;
-			// $$->right_attr.attribute_name = $5;
-									
-    }
-    |ID DOT ID comOp ID DOT ID
+			if (!context_add_condition(CONTEXT, LIKE_OP, $1, $3)) {
+				yyerror(scanner, "too many conditions");
+				YYABORT;
+			}
+		}
+	|expr NOT LIKE expr
 		{
-			RelAttr left_attr;
-			relation_attr_init(&left_attr, $1, $3, NULL, 0);
-			RelAttr right_attr;
-			relation_attr_init(&right_attr, $5, $7, NULL, 0);
-
-			Condition condition;
-			condition_init(&condition, CONTEXT->comp, 1, &left_attr, NULL, 1, &right_attr, NULL);
-			CONTEXT->conditions[CONTEXT->condition_length++] = condition;
-			// $$=( Condition *)malloc(sizeof( Condition));
-			// $$->left_is_attr = 1;		//属性
-			// $$->left_attr.relation_name=$1;
-			// $$->left_attr.attribute_name=$3;
-			// $$->comp =CONTEXT->comp;
-			// $$->right_is_attr = 1;		//属性
-			// $$->right_attr.relation_name=$5;
-			// $$->right_attr.attribute_name=$7;
-    }
-	|ID IS NULL_T {
-		RelAttr left_attr;
-		// $1 为属性名称
-		relation_attr_init(&left_attr, NULL, $1, NULL, 0);
-
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
-		Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
+			if (!context_add_condition(CONTEXT, NOT_LIKE_OP, $1, $4)) {
+				yyerror(scanner, "too many conditions");
+				YYABORT;
+			}
+		}
+	|expr IN sub_select {
+		// in的左边只能是字段
+		if ($1->type != EXPR_ATTR) {
+			yyerror(scanner, "left side of in must be a field");
+			YYABORT;
+		}
 		Condition condition;
-		condition_init(&condition, IS_NULL, 1, &left_attr, NULL, 0, NULL, right_value);
+		condition_init_subquery(&condition, IN_SUBQUERY, &$1->attr, $3);
 		CONTEXT->conditions[CONTEXT->condition_length++] = condition;
 	}
-	|ID IS NOT NULL_T { // id is not null
-		RelAttr left_attr;
-		// $1 为属性名称
-		relation_attr_init(&left_attr, NULL, $1, NULL, 0);
-
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
-		Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
+	|expr NOT IN sub_select {
+		if ($1->type != EXPR_ATTR) {
+			yyerror(scanner, "left side of in must be a field");
+			YYABORT;
+		}
 		Condition condition;
-		condition_init(&condition, IS_NOT_NULL, 1, &left_attr, NULL, 0, NULL, right_value);
+		condition_init_subquery(&condition, NOT_IN_SUBQUERY, &$1->attr, $4);
 		CONTEXT->conditions[CONTEXT->condition_length++] = condition;
 	}
-	|ID DOT ID IS NULL_T {
-		RelAttr left_attr;
-		// $1为表名，$3为属性名
-		relation_attr_init(&left_attr, $1, $3, NULL, 0);
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
-		Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
+	|EXISTS sub_select {
 		Condition condition;
-		condition_init(&condition, IS_NULL, 1, &left_attr, NULL, 0, NULL, right_value);
+		condition_init_subquery(&condition, EXISTS_SUBQUERY, NULL, $2);
 		CONTEXT->conditions[CONTEXT->condition_length++] = condition;
 	}
-	|ID DOT ID IS NOT NULL_T {
-		RelAttr left_attr;
-		// $1为表名，$3为属性名
-		relation_attr_init(&left_attr, $1, $3, NULL, 0);
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
-		Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
+	|NOT EXISTS sub_select {
 		Condition condition;
-		condition_init(&condition, IS_NOT_NULL, 1, &left_attr, NULL, 0, NULL, right_value);
+		condition_init_subquery(&condition, NOT_EXISTS_SUBQUERY, NULL, $3);
 		CONTEXT->conditions[CONTEXT->condition_length++] = condition;
 	}
-	|value IS NOT NULL_T { // null is null/value is not null
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
-		Value *left_value = &CONTEXT->values[CONTEXT->value_length - 2];
-		Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
+    ;
 
-		Condition condition;
-		condition_init(&condition, IS_NOT_NULL, 0, NULL, left_value, 0, NULL, right_value);
-		CONTEXT->conditions[CONTEXT->condition_length++] = condition;
+sub_select:
+	LBRACE SELECT {
+		// 子查询的列、表和条件放进新的Selects，条件接在外层已经解析的条件后面
+		if (CONTEXT->sub_select_depth >= MAX_NUM) {
+			yyerror(scanner, "too many nested sub queries");
+			YYABORT;
+		}
+		Selects *sub_select = (Selects *)arena_alloc(ARENA, sizeof(Selects));
+		memset(sub_select, 0, sizeof(Selects));
+		CONTEXT->sub_selects[CONTEXT->sub_select_depth] = sub_select;
+		CONTEXT->sub_condition_starts[CONTEXT->sub_select_depth] = CONTEXT->condition_length;
+		CONTEXT->sub_expr_condition_starts[CONTEXT->sub_select_depth] = CONTEXT->expr_condition_length;
+		CONTEXT->sub_select_depth++;
 	}
-	|value IS NULL_T { //  null is not null/value is null
-		value_init_string(&CONTEXT->values[CONTEXT->value_length++], "NULL", true);
-		Value *left_value = &CONTEXT->values[CONTEXT->value_length - 2];
-		Value *right_value = &CONTEXT->values[CONTEXT->value_length - 1];
-
-		Condition condition;
-		condition_init(&condition, IS_NULL, 0, NULL, left_value, 0, NULL, right_value);
-		CONTEXT->conditions[CONTEXT->condition_length++] = condition;
+	opt_distinct select_attr FROM ID rel_list join_list where group_by RBRACE {
+		Selects *sub_select = current_selects(CONTEXT);
+		selects_append_relation(ARENA, sub_select, $7);
+		const size_t start = CONTEXT->sub_condition_starts[CONTEXT->sub_select_depth - 1];
+		selects_append_conditions(CONTEXT->ssql, sub_select, CONTEXT->conditions + start, CONTEXT->condition_length - start);
+		CONTEXT->condition_length = start;
+		const size_t expr_start = CONTEXT->sub_expr_condition_starts[CONTEXT->sub_select_depth - 1];
+		selects_append_expr_conditions(sub_select, CONTEXT->expr_conditions + expr_start,
+				CONTEXT->expr_condition_length - expr_start);
+		CONTEXT->expr_condition_length = expr_start;
+		CONTEXT->sub_select_depth--;
+		$$ = sub_select;
 	}
-    ;
+	;
 
 comOp:
   	  EQ { CONTEXT->comp = EQUAL_TO; }
@@ -804,13 +1354,13 @@ group_list:
 group_attr:
 	ID {
 		RelAttr attr;
-		relation_attr_init(&attr, NULL, $1, NULL, 0);
-		selects_append_group(&CONTEXT->ssql->sstr.selection, &attr);
+		relation_attr_init(ARENA, &attr, NULL, $1, NULL, 0);
+		selects_append_group(current_selects(CONTEXT), &attr);
 	}
 	| ID DOT ID {
 		RelAttr attr;
-		relation_attr_init(&attr, $1, $3, NULL, 0);
-		selects_append_group(&CONTEXT->ssql->sstr.selection, &attr);
+		relation_attr_init(ARENA, &attr, $1, $3, NULL, 0);
+		selects_append_group(current_selects(CONTEXT), &attr);
 	}
 	;
 
@@ -829,49 +1379,170 @@ sort_list:
 sort_attr:
 	ID opt_asc{
 		RelAttr attr;
-		relation_attr_init(&attr, NULL, $1, NULL, 0);
-		selects_append_order(&CONTEXT->ssql->sstr.selection, &attr);
+		relation_attr_init(ARENA, &attr, NULL, $1, NULL, 0);
+		selects_append_order(current_selects(CONTEXT), &attr);
 	}
 	| ID DESC {
 		RelAttr attr;
-		relation_attr_init(&attr, NULL, $1, NULL, 1);
-		selects_append_order(&CONTEXT->ssql->sstr.selection, &attr);
+		relation_attr_init(ARENA, &attr, NULL, $1, NULL, 1);
+		selects_append_order(current_selects(CONTEXT), &attr);
 	}
 	| ID DOT ID opt_asc {
 		RelAttr attr;
-		relation_attr_init(&attr, $1, $3, NULL, 0);
-		selects_append_order(&CONTEXT->ssql->sstr.selection, &attr);
+		relation_attr_init(ARENA, &attr, $1, $3, NULL, 0);
+		selects_append_order(current_selects(CONTEXT), &attr);
 	}
 	| ID DOT ID DESC {
 		RelAttr attr;
-		relation_attr_init(&attr, $1, $3, NULL, 1);
-		selects_append_order(&CONTEXT->ssql->sstr.selection, &attr);
+		relation_attr_init(ARENA, &attr, $1, $3, NULL, 1);
+		selects_append_order(current_selects(CONTEXT), &attr);
 	}
 	;
 opt_asc:
 	/* empty */
 	| ASC {}
 	;
+limit:
+	/*empty*/
+	| LIMIT NUMBER {
+		selects_set_limit(current_selects(CONTEXT), $2, 0);
+	}
+	| LIMIT NUMBER OFFSET NUMBER {
+		selects_set_limit(current_selects(CONTEXT), $2, $4);
+	}
+	| LIMIT NUMBER COMMA NUMBER {
+		// limit m, n：跳过m行，返回n行
+		selects_set_limit(current_selects(CONTEXT), $4, $2);
+	}
+	;
 load_data:
 		LOAD DATA INFILE SSS INTO TABLE ID SEMICOLON
 		{
 		  CONTEXT->ssql->flag = SCF_LOAD_DATA;
-			load_data_init(&CONTEXT->ssql->sstr.load_data, $7, $4);
+			load_data_init(ARENA, &CONTEXT->ssql->sstr.load_data, $7, $4);
 		}
 		;
+backup:
+    ID TO SSS SEMICOLON {
+        // backup不作为关键字
+        if (strcasecmp($1, "backup") != 0) {
+            yyerror(scanner, "unknown statement");
+            YYABORT;
+        }
+        CONTEXT->ssql->flag = SCF_BACKUP;
+        backup_init(ARENA, &CONTEXT->ssql->sstr.backup, $3);
+    }
+    ;
+declare_cursor:
+    ID ID ID ID select {
+        // declare 游标名 cursor for select ...，declare、cursor和for不作为关键字
+        if (strcasecmp($1, "declare") != 0 || strcasecmp($3, "cursor") != 0 || strcasecmp($4, "for") != 0) {
+            yyerror(scanner, "unknown statement");
+            YYABORT;
+        }
+        selects_set_cursor(ARENA, &CONTEXT->ssql->sstr.selection, $2);
+    }
+    ;
+fetch:
+    ID NUMBER FROM ID SEMICOLON {
+        // fetch不作为关键字
+        if (strcasecmp($1, "fetch") != 0) {
+            yyerror(scanner, "unknown statement");
+            YYABORT;
+        }
+        CONTEXT->ssql->flag = SCF_FETCH;
+        fetch_init(ARENA, &CONTEXT->ssql->sstr.fetch, $4, $2);
+    }
+    ;
+close_cursor:
+    ID ID SEMICOLON {
+        // close不作为关键字
+        if (strcasecmp($1, "close") != 0) {
+            yyerror(scanner, "unknown statement");
+            YYABORT;
+        }
+        CONTEXT->ssql->flag = SCF_CLOSE_CURSOR;
+        close_cursor_init(ARENA, &CONTEXT->ssql->sstr.close_cursor, $2);
+    }
+    ;
 %%
 //_____________________________________________________________________
-extern void scan_string(const char *str, yyscan_t scanner);
+/**
+ * 可以反复使用的词法分析器。每个SQL线程一个(见parse.cpp)，解析语句时只换上下文和输入，
+ * 不再每条语句都创建和销毁flex的状态
+ */
+typedef struct {
+	yyscan_t scanner;
+	char *buffer;    // 语句的拷贝，flex要求末尾有两个'\0'，并且会临时改写其中的字符
+	size_t capacity;
+} SqlScanner;
+
+void *sql_scanner_create(void){
+	SqlScanner *scanner = (SqlScanner *)malloc(sizeof(SqlScanner));
+	if (scanner == NULL) {
+		return NULL;
+	}
+	memset(scanner, 0, sizeof(SqlScanner));
+	if (yylex_init(&scanner->scanner) != 0) {
+		free(scanner);
+		return NULL;
+	}
+	return scanner;
+}
 
-int sql_parse(const char *s, Query *sqls){
+void sql_scanner_destroy(void *s){
+	SqlScanner *scanner = (SqlScanner *)s;
+	if (scanner == NULL) {
+		return;
+	}
+	yylex_destroy(scanner->scanner);
+	free(scanner->buffer);
+	free(scanner);
+}
+
+static int sql_parse_internal(SqlScanner *scanner, const char *s, Query *sqls, int allow_params, size_t *param_num){
 	ParserContext context;
 	memset(&context, 0, sizeof(context));
-
-	yyscan_t scanner;
-	yylex_init_extra(&context, &scanner);
 	context.ssql = sqls;
-	scan_string(s, scanner);
-	int result = yyparse(scanner);
-	yylex_destroy(scanner);
+
+	// 输入缓冲只在语句变长时扩大
+	const size_t len = strlen(s);
+	if (len + 2 > scanner->capacity) {
+		size_t capacity = scanner->capacity * 2 > len + 2 ? scanner->capacity * 2 : len + 2;
+		char *buffer = (char *)realloc(scanner->buffer, capacity);
+		if (buffer == NULL) {
+			sqls->flag = SCF_ERROR;
+			return -1;
+		}
+		scanner->buffer = buffer;
+		scanner->capacity = capacity;
+	}
+	memcpy(scanner->buffer, s, len);
+	scanner->buffer[len] = '\0';
+	scanner->buffer[len + 1] = '\0';
+
+	yyset_extra(&context, scanner->scanner);
+	YY_BUFFER_STATE buffer = yy_scan_buffer(scanner->buffer, len + 2, scanner->scanner);
+	int result = yyparse(scanner->scanner);
+	yy_delete_buffer(buffer, scanner->scanner);
+	yyset_extra(NULL, scanner->scanner);
+	if (result == 0 && context.param_num > 0 && !allow_params) {
+		// 参数?只能出现在PREPARE的语句中
+		query_reset(sqls);
+		sqls->flag = SCF_ERROR;
+		result = -1;
+	}
+	if (param_num != NULL) {
+		*param_num = context.param_num;
+	}
 	return result;
 }
+
+int sql_parse(void *scanner, const char *s, Query *sqls){
+	return sql_parse_internal((SqlScanner *)scanner, s, sqls, 0, NULL);
+}
+
+// 解析常量换成?之后的语句，参数留在语句中，个数放在param_num
+int sql_parse_template(void *scanner, const char *s, Query *sqls, size_t *param_num){
+	return sql_parse_internal((SqlScanner *)scanner, s, sqls, 1, param_num);
+}
@@ -0,0 +1,294 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Cache of parsed and optimized statements keyed by literal-normalized sql.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <functional>
+
+#include "sql/plan_cache/plan_cache.h"
+#include "common/log/log.h"
+
+namespace {
+
+// 和词法分析中的空白一致
+bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\b' || c == '\f' || c == '\n';
+}
+
+bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+bool is_id_start(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool is_id_char(char c) {
+  return is_id_start(c) || is_digit(c);
+}
+
+bool is_quote(char c) {
+  return c == '\'' || c == '"';
+}
+
+// SSS中引号之间允许出现的字符：[\40\42\47A-Za-z0-9_/\.\-%\\]
+bool is_string_char(char c) {
+  return c == ' ' || is_quote(c) || is_id_char(c) || c == '/' || c == '.' || c == '-' || c == '%' || c == '\\';
+}
+
+bool is_cacheable_command(const char *word, size_t len) {
+  static const char *commands[] = {"select", "insert", "update", "delete"};
+  for (const char *command : commands) {
+    if (len == strlen(command) && 0 == strncasecmp(word, command, len)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+bool normalize_sql(const char *sql, std::string &normalized, std::vector<SqlLiteral> &literals) {
+  normalized.clear();
+  literals.clear();
+
+  const char *p = sql;
+  while (is_space(*p)) {
+    p++;
+  }
+  const char *word_end = p;
+  while (is_id_char(*word_end)) {
+    word_end++;
+  }
+  if (!is_id_start(*p) || !is_cacheable_command(p, word_end - p)) {
+    return false;
+  }
+
+  bool pending_space = false;
+  while (*p != '\0') {
+    const char c = *p;
+    if (is_space(c)) {
+      pending_space = !normalized.empty();
+      p++;
+      continue;
+    }
+    if (pending_space) {
+      normalized.push_back(' ');
+      pending_space = false;
+    }
+
+    if (c == '?') {
+      return false;
+    }
+    if (c == ';') {
+      normalized.push_back(c);
+      p++;
+      while (is_space(*p)) {
+        p++;
+      }
+      if (*p != '\0') {
+        return false;
+      }
+      break;
+    }
+
+    if (is_id_start(c)) {
+      // 标识符和关键字中的数字不是常量
+      const char *end = p;
+      while (is_id_char(*end)) {
+        end++;
+      }
+      normalized.append(p, end - p);
+      p = end;
+      continue;
+    }
+
+    if (is_digit(c) || (c == '-' && is_digit(p[1]))) {
+      const char *end = p + 1;
+      while (is_digit(*end)) {
+        end++;
+      }
+      AttrType type = INTS;
+      if (*end == '.' && is_digit(end[1])) {
+        type = FLOATS;
+        end++;
+        while (is_digit(*end)) {
+          end++;
+        }
+      }
+      literals.push_back(SqlLiteral{type, std::string(p, end - p)});
+      normalized.push_back('?');
+      p = end;
+      continue;
+    }
+
+    if (is_quote(c)) {
+      // 和词法分析一样取最长的以引号结束的串
+      const char *last_quote = nullptr;
+      for (const char *q = p + 1; is_string_char(*q); q++) {
+        if (is_quote(*q)) {
+          last_quote = q;
+        }
+      }
+      if (last_quote != nullptr) {
+        literals.push_back(SqlLiteral{CHARS, std::string(p, last_quote + 1 - p)});
+        normalized.push_back('?');
+        p = last_quote + 1;
+        continue;
+      }
+    }
+
+    normalized.push_back(c);
+    p++;
+  }
+  return true;
+}
+
+bool literals_to_values(const std::vector<SqlLiteral> &literals, std::vector<ValueBuffer> &buffers,
+                        std::vector<Value> &values) {
+  values.resize(literals.size());
+  buffers.resize(literals.size());
+  for (size_t i = 0; i < literals.size(); i++) {
+    const std::string_view text = literals[i].text;
+    if (literals[i].type == CHARS) {
+      parse_string_value(text.substr(1, text.size() - 2), buffers[i], values[i]);
+    } else if (parse_value(literals[i].type, text, buffers[i], values[i]) != RC::SUCCESS) {
+      return false;
+    }
+  }
+  return true;
+}
+
+CachedPlan::~CachedPlan() {
+  if (query != nullptr) {
+    query_destroy(query);
+    query = nullptr;
+  }
+}
+
+PlanCache &PlanCache::instance() {
+  static PlanCache plan_cache;
+  return plan_cache;
+}
+
+PlanCache::PlanCache(size_t capacity) : capacity_(capacity) {
+}
+
+void PlanCache::set_capacity(size_t capacity) {
+  capacity_ = capacity;
+  for (Shard &shard : shards_) {
+    std::lock_guard<std::mutex> lock_guard(shard.mutex);
+    evict(shard, shard_capacity());
+  }
+}
+
+size_t PlanCache::shard_capacity() const {
+  return (capacity_ + PLAN_CACHE_SHARDS - 1) / PLAN_CACHE_SHARDS;
+}
+
+PlanCache::Shard &PlanCache::shard(const std::string &key) {
+  return shards_[std::hash<std::string>()(key) % PLAN_CACHE_SHARDS];
+}
+
+void PlanCache::evict(Shard &shard, size_t capacity) {
+  while (shard.lru.size() > capacity) {
+    shard.entries.erase(shard.lru.back().first);
+    shard.lru.pop_back();
+  }
+}
+
+std::shared_ptr<const CachedPlan> PlanCache::get(const std::string &key) {
+  Shard &s = shard(key);
+  std::lock_guard<std::mutex> lock_guard(s.mutex);
+  auto iter = s.entries.find(key);
+  if (iter == s.entries.end()) {
+    return nullptr;
+  }
+  s.lru.splice(s.lru.begin(), s.lru, iter->second);
+  return iter->second->second;
+}
+
+void PlanCache::put(const std::string &key, std::shared_ptr<const CachedPlan> plan, uint64_t version) {
+  const size_t capacity = shard_capacity();
+  if (capacity == 0) {
+    return;
+  }
+
+  Shard &s = shard(key);
+  std::lock_guard<std::mutex> lock_guard(s.mutex);
+  if (version != version_) {
+    // 生成计划的过程中有表发生了变化，计划可能已经过时
+    return;
+  }
+  auto iter = s.entries.find(key);
+  if (iter != s.entries.end()) {
+    iter->second->second = std::move(plan);
+    s.lru.splice(s.lru.begin(), s.lru, iter->second);
+    return;
+  }
+  s.lru.emplace_front(key, std::move(plan));
+  s.entries[key] = s.lru.begin();
+  evict(s, capacity);
+}
+
+void PlanCache::invalidate(const char *db, const char *table) {
+  // 先修改版本，正在生成的计划就不会再放进缓存
+  version_++;
+  int removed = 0;
+  for (Shard &s : shards_) {
+    std::lock_guard<std::mutex> lock_guard(s.mutex);
+    for (auto iter = s.lru.begin(); iter != s.lru.end();) {
+      const CachedPlan &plan = *iter->second;
+      bool referenced = false;
+      if (plan.db == db) {
+        for (const std::string &name : plan.tables) {
+          if (name == table) {
+            referenced = true;
+            break;
+          }
+        }
+      }
+      if (referenced) {
+        s.entries.erase(iter->first);
+        iter = s.lru.erase(iter);
+        removed++;
+      } else {
+        ++iter;
+      }
+    }
+  }
+  if (removed > 0) {
+    LOG_INFO("Removed %d cached plans of table %s.%s", removed, db, table);
+  }
+}
+
+void PlanCache::clear() {
+  version_++;
+  for (Shard &s : shards_) {
+    std::lock_guard<std::mutex> lock_guard(s.mutex);
+    s.entries.clear();
+    s.lru.clear();
+  }
+}
+
+size_t PlanCache::size() {
+  size_t size = 0;
+  for (Shard &s : shards_) {
+    std::lock_guard<std::mutex> lock_guard(s.mutex);
+    size += s.lru.size();
+  }
+  return size;
+}
@@ -0,0 +1,128 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Cache of parsed and optimized statements keyed by literal-normalized sql.
+//
+
+#ifndef __OBSERVER_SQL_PLAN_CACHE_PLAN_CACHE_H_
+#define __OBSERVER_SQL_PLAN_CACHE_PLAN_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sql/optimizer/join_planner.h"
+#include "sql/parser/parse_defs.h"
+#include "sql/parser/value_parser.h"
+
+#define PLAN_CACHE_SIZE 1024  // 默认最多缓存的语句个数
+#define PLAN_CACHE_SHARDS 16
+
+/**
+ * 语句中的常量：整数、浮点数和用引号括起来的字符串，和词法分析中的NUMBER、FLOAT和SSS一致
+ */
+struct SqlLiteral {
+  AttrType type;     // INTS、FLOATS或CHARS
+  std::string text;  // 常量的原文，字符串带着引号
+};
+
+/**
+ * 把select/insert/update/delete语句中的常量换成?，连续的空白合并成一个空格，常量按顺序放进literals。
+ * 其它语句、语句中已经有?或者多条语句时返回false
+ */
+bool normalize_sql(const char *sql, std::string &normalized, std::vector<SqlLiteral> &literals);
+
+/**
+ * 把常量转换成Value，和解析时的转换一样，不申请内存，values的数据放在buffers中。
+ * 数值超出int或者float的范围时返回false，这样的语句交给parse stage解析
+ */
+bool literals_to_values(const std::vector<SqlLiteral> &literals, std::vector<ValueBuffer> &buffers,
+                        std::vector<Value> &values);
+
+/**
+ * 缓存的执行计划。query是常量换成参数之后解析并优化过的语句，执行时复制一份再绑定参数，
+ * join_plan是优化器选择的join顺序。query为空表示这个语句不能参数化，不必每次都尝试
+ */
+struct CachedPlan {
+  Query *query = nullptr;
+  size_t param_num = 0;
+  JoinPlan join_plan;
+  std::string db;
+  std::vector<std::string> tables;  // 语句引用的表，包括子查询中的，这些表的DDL让缓存失效
+
+  CachedPlan() = default;
+  CachedPlan(const CachedPlan &) = delete;
+  CachedPlan &operator=(const CachedPlan &) = delete;
+  ~CachedPlan();
+};
+
+/**
+ * 按照LRU淘汰的执行计划缓存。key分到多个分片，每个分片一把锁，
+ * 缓存的计划不会被修改，get返回的shared_ptr在计划被淘汰之后仍然可以使用
+ */
+class PlanCache {
+public:
+  static PlanCache &instance();
+
+  explicit PlanCache(size_t capacity = PLAN_CACHE_SIZE);
+
+  /**
+   * 修改容量，超过的计划被淘汰。capacity为0时不缓存
+   */
+  void set_capacity(size_t capacity);
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  /**
+   * 生成计划之前取得版本，put时版本变了说明期间有表发生了变化，计划不放进缓存
+   */
+  uint64_t version() const {
+    return version_;
+  }
+
+  std::shared_ptr<const CachedPlan> get(const std::string &key);
+  void put(const std::string &key, std::shared_ptr<const CachedPlan> plan, uint64_t version);
+
+  /**
+   * 表的结构或者索引变化之后删除引用这张表的计划
+   */
+  void invalidate(const char *db, const char *table);
+  void clear();
+  size_t size();
+
+private:
+  typedef std::list<std::pair<std::string, std::shared_ptr<const CachedPlan>>> LruList;
+
+  struct Shard {
+    std::mutex mutex;
+    LruList lru;  // 最近使用的在前面
+    std::unordered_map<std::string, LruList::iterator> entries;
+  };
+
+  Shard &shard(const std::string &key);
+  size_t shard_capacity() const;
+  static void evict(Shard &shard, size_t capacity);
+
+private:
+  std::atomic<size_t> capacity_;
+  std::atomic<uint64_t> version_{0};
+  Shard shards_[PLAN_CACHE_SHARDS];
+};
+
+#endif  // __OBSERVER_SQL_PLAN_CACHE_PLAN_CACHE_H_
@@ -22,9 +22,18 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/string.h"
 #include "common/log/log.h"
 #include "common/seda/timer_stage.h"
+#include "event/execution_plan_event.h"
+#include "event/session_event.h"
+#include "event/sql_event.h"
+#include "session/session.h"
+#include "sql/optimizer/optimize_stage.h"
+#include "sql/parser/parse.h"
+#include "sql/plan_cache/plan_cache.h"
 
 using namespace common;
 
+const char *CONF_PLAN_CACHE_SIZE = "PlanCacheSize";
+
 //! Constructor
 PlanCacheStage::PlanCacheStage(const char *tag) : Stage(tag) {}
 
@@ -44,14 +53,19 @@ Stage *PlanCacheStage::make_stage(const std::string &tag) {
 
 //! Set properties for this object set in stage specific properties
 bool PlanCacheStage::set_properties() {
-  //  std::string stageNameStr(stage_name_);
-  //  std::map<std::string, std::string> section = g_properties()->get(
-  //    stageNameStr);
-  //
-  //  std::map<std::string, std::string>::iterator it;
-  //
-  //  std::string key;
-
+  std::string stage_name(stage_name_);
+  std::map<std::string, std::string> section = get_properties()->get(stage_name);
+
+  std::map<std::string, std::string>::iterator iter = section.find(CONF_PLAN_CACHE_SIZE);
+  if (iter != section.end()) {
+    long long size = 0;
+    if (!str_to_val(iter->second, size) || size < 0) {
+      LOG_ERROR("Invalid config %s=%s", CONF_PLAN_CACHE_SIZE, iter->second.c_str());
+      return false;
+    }
+    PlanCache::instance().set_capacity((size_t)size);
+    LOG_INFO("Cache at most %lld plans", size);
+  }
   return true;
 }
 
@@ -77,19 +91,23 @@ void PlanCacheStage::cleanup() {
 void PlanCacheStage::handle_event(StageEvent *event) {
   LOG_TRACE("Enter\n");
 
-  // Add callback to update plan cache
-  /*
+  static_cast<SQLStageEvent *>(event)->session_event()->query_trace().enter_stage("plan_cache");
+  StageEvent *new_event = handle_request(event);
+  if (nullptr == new_event) {
+    // 不能使用缓存的语句照常解析
+    parse_stage->handle_event(event);
+    return;
+  }
+
   CompletionCallback *cb = new (std::nothrow) CompletionCallback(this, nullptr);
   if (cb == nullptr) {
     LOG_ERROR("Failed to new callback for SQLStageEvent");
-    event->done_immediate();
+    delete new_event;
+    parse_stage->handle_event(event);
     return;
   }
-
   event->push_callback(cb);
-   */
-  // do nothing here, pass the event to the next stage
-  parse_stage->handle_event(event);
+  execute_stage->handle_event(new_event);
 
   LOG_TRACE("Exit\n");
   return;
@@ -99,9 +117,127 @@ void PlanCacheStage::callback_event(StageEvent *event,
                                    CallbackContext *context) {
   LOG_TRACE("Enter\n");
 
-  // update execute plan here
-  // event->done_immediate();
+  // 回到query cache stage，由它结束session event
+  SQLStageEvent *sql_event = static_cast<SQLStageEvent *>(event);
+  sql_event->done_immediate();
 
   LOG_TRACE("Exit\n");
   return;
 }
+
+static void collect_tables(const Selects &selects, std::vector<std::string> &tables);
+
+static void collect_tables(const Condition conditions[], size_t condition_num, std::vector<std::string> &tables) {
+  for (size_t i = 0; i < condition_num; i++) {
+    if (conditions[i].sub_select != nullptr) {
+      collect_tables(*conditions[i].sub_select, tables);
+    }
+  }
+}
+
+static void collect_tables(const Selects &selects, std::vector<std::string> &tables) {
+  for (size_t i = 0; i < selects.relation_num; i++) {
+    tables.push_back(selects.relations[i]);
+  }
+  collect_tables(selects.conditions, selects.condition_num, tables);
+}
+
+static void collect_tables(const Query *query, std::vector<std::string> &tables) {
+  switch (query->flag) {
+    case SCF_SELECT:
+      collect_tables(query->sstr.selection, tables);
+      break;
+    case SCF_INSERT:
+      tables.push_back(query->sstr.insertion.relation_name);
+      break;
+    case SCF_UPDATE:
+      tables.push_back(query->sstr.update.relation_name);
+      collect_tables(query->sstr.update.conditions, query->sstr.update.condition_num, tables);
+      break;
+    case SCF_DELETE:
+      tables.push_back(query->sstr.deletion.relation_name);
+      collect_tables(query->sstr.deletion.conditions, query->sstr.deletion.condition_num, tables);
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * 解析并优化常量换成?之后的语句。不能解析或者参数和常量对不上时返回query为空的计划，
+ * 这样的语句以后直接交给parse stage
+ */
+static std::shared_ptr<CachedPlan> make_plan(const std::string &normalized, size_t literal_num, const char *db) {
+  std::shared_ptr<CachedPlan> plan = std::make_shared<CachedPlan>();
+  plan->db = db;
+
+  Query *query = query_create();
+  if (nullptr == query) {
+    LOG_ERROR("Failed to create query.");
+    return plan;
+  }
+  size_t param_num = 0;
+  RC rc = parse_template(normalized.c_str(), query, param_num);
+  if (rc != RC::SUCCESS || param_num != literal_num) {
+    LOG_DEBUG("Cannot cache plan of %s", normalized.c_str());
+    query_destroy(query);
+    return plan;
+  }
+
+  OptimizeStage::optimize(query, db, plan->join_plan);
+  collect_tables(query, plan->tables);
+  plan->query = query;
+  plan->param_num = param_num;
+  return plan;
+}
+
+/**
+ * 常量换成?之后相同的语句使用同一个缓存的计划：复制解析和优化过的语句，绑定这次的常量之后直接交给execute stage
+ */
+StageEvent *PlanCacheStage::handle_request(StageEvent *event) {
+  PlanCache &plan_cache = PlanCache::instance();
+  if (plan_cache.capacity() == 0) {
+    return nullptr;
+  }
+
+  SQLStageEvent *sql_event = static_cast<SQLStageEvent *>(event);
+  std::string normalized;
+  std::vector<SqlLiteral> literals;
+  if (!normalize_sql(sql_event->get_sql().c_str(), normalized, literals)) {
+    return nullptr;
+  }
+
+  const std::string &db = sql_event->session_event()->get_client()->session->get_current_db();
+  std::string key = db + "\n" + normalized;
+  std::shared_ptr<const CachedPlan> plan = plan_cache.get(key);
+  if (plan == nullptr) {
+    const uint64_t version = plan_cache.version();
+    plan = make_plan(normalized, literals.size(), db.c_str());
+    plan_cache.put(key, plan, version);
+  }
+  if (plan->query == nullptr) {
+    return nullptr;
+  }
+
+  std::vector<ValueBuffer> buffers;
+  std::vector<Value> params;
+  if (!literals_to_values(literals, buffers, params)) {
+    return nullptr;
+  }
+  Query *query = query_create();
+  if (nullptr == query) {
+    LOG_ERROR("Failed to create query.");
+    return nullptr;
+  }
+  query_copy(query, plan->query);
+  query_bind_params(query, params.data());
+
+  ExecutionPlanEvent *exe_event = new (std::nothrow) ExecutionPlanEvent(sql_event, query);
+  if (nullptr == exe_event) {
+    LOG_ERROR("Failed to new ExecutionPlanEvent");
+    query_destroy(query);
+    return nullptr;
+  }
+  exe_event->join_plan() = plan->join_plan;
+  return exe_event;
+}
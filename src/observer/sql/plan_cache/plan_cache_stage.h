@@ -34,6 +34,7 @@ protected:
                      common::CallbackContext *context);
 
 protected:
+  common::StageEvent *handle_request(common::StageEvent *event);
 private:
   Stage *parse_stage = nullptr;
   Stage *execute_stage = nullptr;
@@ -0,0 +1,152 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Cache of select results invalidated by the versions of the tables they read.
+//
+
+#include "sql/query_cache/query_cache.h"
+#include "common/log/log.h"
+#include "storage/common/table.h"
+#include "storage/default/default_handler.h"
+
+static bool record_table_versions(const char *db, const Condition conditions[], size_t condition_num,
+                                  std::vector<TableVersion> &versions) {
+  for (size_t i = 0; i < condition_num; i++) {
+    if (conditions[i].sub_select != nullptr && !record_table_versions(db, *conditions[i].sub_select, versions)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool record_table_versions(const char *db, const Selects &selects, std::vector<TableVersion> &versions) {
+  for (size_t i = 0; i < selects.relation_num; i++) {
+    Table *table = DefaultHandler::get_default().find_table(db, selects.relations[i]);
+    if (nullptr == table) {
+      return false;
+    }
+    versions.push_back(TableVersion{selects.relations[i], table->version()});
+  }
+  return record_table_versions(db, selects.conditions, selects.condition_num, versions);
+}
+
+bool table_versions_valid(const char *db, const std::vector<TableVersion> &versions) {
+  for (const TableVersion &table_version : versions) {
+    Table *table = DefaultHandler::get_default().find_table(db, table_version.table.c_str());
+    if (nullptr == table || table->version() != table_version.version) {
+      return false;
+    }
+  }
+  return true;
+}
+
+QueryCache &QueryCache::instance() {
+  static QueryCache query_cache;
+  return query_cache;
+}
+
+QueryCache::QueryCache(size_t capacity) : capacity_(capacity) {
+}
+
+void QueryCache::set_capacity(size_t capacity) {
+  capacity_ = capacity;
+  std::lock_guard<std::mutex> lock_guard(mutex_);
+  evict(capacity);
+}
+
+size_t QueryCache::entry_bytes(const std::string &key, const CachedResult &result) {
+  size_t bytes = key.size() + result.response.size() + result.db.size() + sizeof(CachedResult);
+  for (const TableVersion &table_version : result.tables) {
+    bytes += table_version.table.size() + sizeof(TableVersion);
+  }
+  return bytes;
+}
+
+void QueryCache::erase(std::unordered_map<std::string, LruList::iterator>::iterator iter) {
+  LruList::iterator lru_iter = iter->second;
+  bytes_ -= entry_bytes(lru_iter->first, *lru_iter->second);
+  entries_.erase(iter);
+  lru_.erase(lru_iter);
+}
+
+void QueryCache::evict(size_t capacity) {
+  while (!lru_.empty() && bytes_ > capacity) {
+    erase(entries_.find(lru_.back().first));
+  }
+}
+
+std::shared_ptr<const CachedResult> QueryCache::get(const std::string &key) {
+  std::shared_ptr<const CachedResult> result;
+  {
+    std::lock_guard<std::mutex> lock_guard(mutex_);
+    auto iter = entries_.find(key);
+    if (iter == entries_.end()) {
+      return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, iter->second);
+    result = iter->second->second;
+  }
+
+  if (table_versions_valid(result->db.c_str(), result->tables)) {
+    return result;
+  }
+
+  // 表已经修改过了，这期间可能已经放入了新的结果，只删除过期的这个
+  std::lock_guard<std::mutex> lock_guard(mutex_);
+  auto iter = entries_.find(key);
+  if (iter != entries_.end() && iter->second->second == result) {
+    erase(iter);
+  }
+  return nullptr;
+}
+
+void QueryCache::put(const std::string &key, std::shared_ptr<const CachedResult> result) {
+  const size_t capacity = capacity_;
+  const size_t bytes = entry_bytes(key, *result);
+  if (bytes > capacity / 8) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock_guard(mutex_);
+  auto iter = entries_.find(key);
+  if (iter != entries_.end()) {
+    erase(iter);
+  }
+  lru_.emplace_front(key, std::move(result));
+  entries_[key] = lru_.begin();
+  bytes_ += bytes;
+  evict(capacity);
+}
+
+void QueryCache::remove(const std::string &key) {
+  std::lock_guard<std::mutex> lock_guard(mutex_);
+  auto iter = entries_.find(key);
+  if (iter != entries_.end()) {
+    erase(iter);
+  }
+}
+
+void QueryCache::clear() {
+  std::lock_guard<std::mutex> lock_guard(mutex_);
+  entries_.clear();
+  lru_.clear();
+  bytes_ = 0;
+}
+
+size_t QueryCache::size() {
+  std::lock_guard<std::mutex> lock_guard(mutex_);
+  return lru_.size();
+}
+
+size_t QueryCache::bytes() {
+  std::lock_guard<std::mutex> lock_guard(mutex_);
+  return bytes_;
+}
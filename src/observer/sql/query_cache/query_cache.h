@@ -0,0 +1,107 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Cache of select results invalidated by the versions of the tables they read.
+//
+
+#ifndef __OBSERVER_SQL_QUERY_CACHE_QUERY_CACHE_H_
+#define __OBSERVER_SQL_QUERY_CACHE_QUERY_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sql/parser/parse_defs.h"
+
+/**
+ * 查询开始之前表的版本，见Table::version
+ */
+struct TableVersion {
+  std::string table;
+  uint64_t version;
+};
+
+/**
+ * 缓存的查询结果。response是按连接的协议编码好的完整结果，不含结束标记
+ */
+struct CachedResult {
+  std::string response;
+  std::string db;
+  std::vector<TableVersion> tables;  // 查询读取的表，包括子查询中的
+};
+
+/**
+ * 取得select语句(包括子查询)读取的每张表当前的版本。有表不存在时返回false
+ */
+bool record_table_versions(const char *db, const Selects &selects, std::vector<TableVersion> &versions);
+
+/**
+ * 查询读取的表都还存在并且版本都没有变化时返回true
+ */
+bool table_versions_valid(const char *db, const std::vector<TableVersion> &versions);
+
+/**
+ * 按照LRU淘汰的查询结果缓存，容量是所有结果占用的字节数。
+ * 缓存的结果不会被修改，get返回的shared_ptr在结果被淘汰之后仍然可以使用
+ */
+class QueryCache {
+public:
+  static QueryCache &instance();
+
+  explicit QueryCache(size_t capacity = 0);
+
+  /**
+   * 修改容量，超过的结果被淘汰。capacity为0时不缓存
+   */
+  void set_capacity(size_t capacity);
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  /**
+   * 查找key对应的结果，结果读取的表发生变化之后从缓存中删除并返回nullptr
+   */
+  std::shared_ptr<const CachedResult> get(const std::string &key);
+  /**
+   * 放入一个结果，单个结果超过容量的1/8时不缓存，避免大结果把其它结果都挤出去
+   */
+  void put(const std::string &key, std::shared_ptr<const CachedResult> result);
+  void remove(const std::string &key);
+  void clear();
+  size_t size();
+  /**
+   * 缓存的结果占用的字节数
+   */
+  size_t bytes();
+
+private:
+  typedef std::list<std::pair<std::string, std::shared_ptr<const CachedResult>>> LruList;
+
+  static size_t entry_bytes(const std::string &key, const CachedResult &result);
+  void evict(size_t capacity);
+  void erase(std::unordered_map<std::string, LruList::iterator>::iterator iter);
+
+private:
+  std::atomic<size_t> capacity_;
+  std::mutex mutex_;
+  LruList lru_;  // 最近使用的在前面
+  std::unordered_map<std::string, LruList::iterator> entries_;
+  size_t bytes_ = 0;  // 由mutex_保护
+};
+
+#endif  // __OBSERVER_SQL_QUERY_CACHE_QUERY_CACHE_H_
@@ -13,6 +13,7 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include <string.h>
+#include <strings.h>
 #include <string>
 
 #include "query_cache_stage.h"
@@ -22,9 +23,16 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/string.h"
 #include "common/log/log.h"
 #include "common/seda/timer_stage.h"
+#include "event/session_event.h"
+#include "event/sql_event.h"
+#include "session/session.h"
+#include "sql/plan_cache/plan_cache.h"
+#include "sql/query_cache/query_cache.h"
 
 using namespace common;
 
+const char *CONF_QUERY_CACHE_SIZE = "QueryCacheSize";
+
 //! Constructor
 QueryCacheStage::QueryCacheStage(const char *tag) : Stage(tag) {}
 
@@ -44,14 +52,19 @@ Stage *QueryCacheStage::make_stage(const std::string &tag) {
 
 //! Set properties for this object set in stage specific properties
 bool QueryCacheStage::set_properties() {
-  //  std::string stageNameStr(stage_name_);
-  //  std::map<std::string, std::string> section = g_properties()->get(
-  //    stageNameStr);
-  //
-  //  std::map<std::string, std::string>::iterator it;
-  //
-  //  std::string key;
-
+  std::string stage_name(stage_name_);
+  std::map<std::string, std::string> section = get_properties()->get(stage_name);
+
+  std::map<std::string, std::string>::iterator iter = section.find(CONF_QUERY_CACHE_SIZE);
+  if (iter != section.end()) {
+    size_t size = 0;
+    if (!str_to_memory_size(iter->second, size)) {
+      LOG_ERROR("Invalid config %s=%s", CONF_QUERY_CACHE_SIZE, iter->second.c_str());
+      return false;
+    }
+    QueryCache::instance().set_capacity(size);
+    LOG_INFO("Use %lu bytes to cache query results", size);
+  }
   return true;
 }
 
@@ -73,21 +86,70 @@ void QueryCacheStage::cleanup() {
   LOG_TRACE("Exit");
 }
 
+/**
+ * 只缓存不在多语句事务中的select语句的结果。key由数据库、连接的协议、常量替换成?之后的语句以及这些常量组成，
+ * 只是空白不同的语句使用同一个key。不能缓存时返回false
+ */
+static bool make_cache_key(SQLStageEvent *sql_event, std::string &key) {
+  if (QueryCache::instance().capacity() == 0) {
+    return false;
+  }
+  SessionEvent *session_event = sql_event->session_event();
+  Session *session = session_event->get_client()->session;
+  if (session->is_trx_multi_operation_mode()) {
+    // 事务中的查询能看到自己还没有提交的修改
+    return false;
+  }
+
+  std::string normalized;
+  std::vector<SqlLiteral> literals;
+  if (!normalize_sql(sql_event->get_sql().c_str(), normalized, literals)) {
+    return false;
+  }
+  size_t begin = normalized.find_first_not_of(' ');
+  if (begin == std::string::npos || strncasecmp(normalized.c_str() + begin, "select ", 7) != 0) {
+    return false;
+  }
+
+  key = session->get_current_db();
+  key.push_back('\n');
+  key.push_back(session_event->binary_protocol() ? 'b' : 't');
+  key.append(normalized, begin, std::string::npos);
+  for (const SqlLiteral &literal : literals) {
+    key.push_back('\0');
+    key.append(literal.text);
+  }
+  return true;
+}
+
 void QueryCacheStage::handle_event(StageEvent *event) {
   LOG_TRACE("Enter\n");
 
-  // Add callback to update query cache
-  /*
+  SQLStageEvent *sql_event = static_cast<SQLStageEvent *>(event);
+  SessionEvent *session_event = sql_event->session_event();
+  session_event->query_trace().enter_stage("query_cache");
+  std::string &key = sql_event->query_cache_key();
+  if (make_cache_key(sql_event, key)) {
+    std::shared_ptr<const CachedResult> result = QueryCache::instance().get(key);
+    if (result != nullptr) {
+      LOG_DEBUG("Query cache hit: %s", sql_event->get_sql().c_str());
+      session_event->append_response(result->response.data(), result->response.size());
+      sql_event->done_immediate();
+      session_event->done_immediate();
+      return;
+    }
+  }
+
+  // 执行完之后在回调中把结果放进缓存
   CompletionCallback *cb = new (std::nothrow) CompletionCallback(this, nullptr);
   if (cb == nullptr) {
     LOG_ERROR("Failed to new callback for SQLStageEvent");
-    event->done_immediate();
+    session_event->set_response("FAILURE\n");
+    sql_event->done_immediate();
+    session_event->done_immediate();
     return;
   }
-
   event->push_callback(cb);
-   */
-  // do nothing here, pass the event to the next stage
   plan_cache_stage->handle_event(event);
 
   LOG_TRACE("Exit\n");
@@ -98,8 +160,18 @@ void QueryCacheStage::callback_event(StageEvent *event,
                                     CallbackContext *context) {
   LOG_TRACE("Enter\n");
 
-  // update data to query cache here
-  // event->done_immediate();
+  SQLStageEvent *sql_event = static_cast<SQLStageEvent *>(event);
+  SessionEvent *session_event = sql_event->session_event();
+  const std::string &key = sql_event->query_cache_key();
+  // 执行成功的查询才会记录表的版本。已经发送了一部分的结果太大，不缓存
+  if (!key.empty() && !sql_event->table_versions().empty() && !session_event->response_sent()) {
+    std::shared_ptr<CachedResult> result = std::make_shared<CachedResult>();
+    result->response.assign(session_event->get_response(), session_event->get_response_len());
+    result->db = session_event->get_client()->session->get_current_db();
+    result->tables = std::move(sql_event->table_versions());
+    QueryCache::instance().put(key, std::move(result));
+  }
+  session_event->done_immediate();
 
   LOG_TRACE("Exit\n");
   return;
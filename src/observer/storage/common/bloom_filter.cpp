@@ -0,0 +1,76 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Fixed size Bloom filter.
+//
+
+#include "storage/common/bloom_filter.h"
+
+#include <algorithm>
+
+/**
+ * 调用者的哈希低位可能分布不均匀，先混合一次
+ */
+static uint32_t mix(uint32_t hash)
+{
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+/**
+ * 用两个哈希组合出BLOOM_FILTER_HASH_NUM个位置(Kirsch-Mitzenmacher)，第二个哈希由第一个循环移位得到
+ */
+static uint32_t second_hash(uint32_t hash)
+{
+  return ((hash >> 17) | (hash << 15)) | 1;
+}
+
+BloomFilter::BloomFilter(int bit_num) : words_(bit_num / 64, 0)
+{}
+
+void BloomFilter::add(uint32_t hash)
+{
+  const uint32_t bit_num = (uint32_t)words_.size() * 64;
+  hash = mix(hash);
+  const uint32_t delta = second_hash(hash);
+  for (int i = 0; i < BLOOM_FILTER_HASH_NUM; i++)
+  {
+    const uint32_t bit = hash % bit_num;
+    words_[bit / 64] |= (uint64_t)1 << (bit % 64);
+    hash += delta;
+  }
+}
+
+bool BloomFilter::may_contain(uint32_t hash) const
+{
+  const uint32_t bit_num = (uint32_t)words_.size() * 64;
+  hash = mix(hash);
+  const uint32_t delta = second_hash(hash);
+  for (int i = 0; i < BLOOM_FILTER_HASH_NUM; i++)
+  {
+    const uint32_t bit = hash % bit_num;
+    if ((words_[bit / 64] & ((uint64_t)1 << (bit % 64))) == 0)
+    {
+      return false;
+    }
+    hash += delta;
+  }
+  return true;
+}
+
+void BloomFilter::clear()
+{
+  std::fill(words_.begin(), words_.end(), 0);
+}
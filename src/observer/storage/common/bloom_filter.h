@@ -0,0 +1,54 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Fixed size Bloom filter.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_BLOOM_FILTER_H_
+#define __OBSERVER_STORAGE_COMMON_BLOOM_FILTER_H_
+
+#include <stdint.h>
+#include <vector>
+
+#define BLOOM_FILTER_HASH_NUM 4  // 每个值设置的位数
+
+/**
+ * 只能加入不能删除的布隆过滤器。may_contain返回false时一定没有加入过这个值，返回true时可能加入过。
+ * 加入的值用32位哈希表示，调用者负责让不同的值有不同的哈希
+ */
+class BloomFilter {
+public:
+  /**
+   * bit_num需要是64的倍数
+   */
+  explicit BloomFilter(int bit_num);
+
+  void add(uint32_t hash);
+  bool may_contain(uint32_t hash) const;
+  void clear();
+
+  /**
+   * 保存到文件时按64位的字读写
+   */
+  std::vector<uint64_t> &words()
+  {
+    return words_;
+  }
+  const std::vector<uint64_t> &words() const
+  {
+    return words_;
+  }
+
+private:
+  std::vector<uint64_t> words_;
+};
+
+#endif  // __OBSERVER_STORAGE_COMMON_BLOOM_FILTER_H_
@@ -11,8 +11,16 @@ See the Mulan PSL v2 for more details. */
 //
 // Created by Longda on 2021/4/13.
 //
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+#include <numeric>
+
 #include "storage/common/bplus_tree.h"
 #include "storage/default/disk_buffer_pool.h"
+#include "storage/default/spill_file.h"
 #include "rc.h"
 #include "common/log/log.h"
 #include "sql/parser/parse_defs.h"
@@ -27,26 +35,483 @@ int float_compare(float f1, float f2)
   return result > 0 ? 1 : -1;
 }
 
-IndexNode *BplusTreeHandler::get_index_node(char *page_data) const
+/**
+ * 树的读写锁，和表的CompactLockGuard一样在析构时释放
+ */
+class TreeLatchGuard
+{
+public:
+  TreeLatchGuard(pthread_rwlock_t &latch, bool exclusive) : latch_(latch)
+  {
+    if (exclusive)
+    {
+      pthread_rwlock_wrlock(&latch_);
+    }
+    else
+    {
+      pthread_rwlock_rdlock(&latch_);
+    }
+  }
+  ~TreeLatchGuard()
+  {
+    pthread_rwlock_unlock(&latch_);
+  }
+
+private:
+  pthread_rwlock_t &latch_;
+};
+
+/**
+ * 修改树结构时加写锁，析构时恢复使用内部节点的缓存之后放开写锁
+ */
+class StructureChangeGuard
+{
+public:
+  StructureChangeGuard(BplusTreeHandler &handler) : handler_(handler), latch_guard_(handler.tree_latch_, true)
+  {
+    handler_.begin_structure_change();
+  }
+  ~StructureChangeGuard()
+  {
+    handler_.end_structure_change();
+  }
+
+private:
+  BplusTreeHandler &handler_;
+  TreeLatchGuard latch_guard_;
+};
+
+/**
+ * 缓存的内部节点，是页面中key和孩子页号的副本。孩子也缓存了时child_nodes中是指向它的指针，
+ * 孩子是叶子时leaf_children为true，查找到这一层就得到了叶子的页号
+ */
+struct BplusTreeHandler::CachedNode
+{
+  int key_num;
+  std::vector<char> keys;
+  std::vector<PageNum> children;
+  std::unique_ptr<std::atomic<CachedNode *>[]> child_nodes;
+  std::atomic<bool> leaf_children{false};
+};
+
+bool BplusTreeHandler::ChangeKeyLess::operator()(const std::string &key1, const std::string &key2) const
+{
+  return handler->compare_key(key1.data(), key2.data()) < 0;
+}
+
+BplusTreeHandler::BplusTreeHandler() : changes_(ChangeKeyLess{this})
+{
+  pthread_rwlock_init(&tree_latch_, nullptr);
+}
+
+BplusTreeHandler::~BplusTreeHandler()
+{
+  pthread_rwlock_destroy(&tree_latch_);
+}
+
+/**
+ * 页面中节点的头部。后面是节点中所有key的属性值共同的前缀，再依次是每一项。
+ * 叶子的每一项是属性值去掉前缀和末尾的0之后的长度、剩下的字节和rid，key中的rid和它相同，不再保存；
+ * 内部节点在第一项之前先放第一个孩子的页号，每一项是属性值剩下的部分、key中的rid和右边孩子的页号。
+ * 叶子分裂时放到父节点中的key一般只有一小段前缀，rid是最小值，这时长度的最高位是1，不保存rid
+ */
+struct PackedNodeHeader
+{
+  int is_leaf;
+  int key_num;
+  PageNum parent;
+  PageNum next;
+  int prefix_length;
+};
+
+static const uint16_t MIN_RID_FLAG = 0x8000;
+
+static int trimmed_length(const char *value, int length)
+{
+  while (length > 0 && value[length - 1] == 0)
+  {
+    length--;
+  }
+  return length;
+}
+
+static bool is_min_rid(const char *rid_data)
+{
+  RID rid;
+  memcpy(&rid, rid_data, sizeof(rid));
+  return rid.page_num == -1 && rid.slot_num == -1;
+}
+
+/**
+ * 固定一个页面并把其中的节点解码到node中，析构时放开latch和页面。
+ * 修改node之后调用save重新编码写回页面，没有调用save时页面不变
+ */
+class BplusTreeHandler::NodeFrame
+{
+public:
+  explicit NodeFrame(BplusTreeHandler &handler) : handler_(handler)
+  {
+    memset(&node, 0, sizeof(node));
+  }
+  ~NodeFrame()
+  {
+    release();
+  }
+
+  /**
+   * 之前固定的页面先放开。leaf_keys为false时叶子只解码头部，从上往下找叶子时用
+   */
+  RC get(PageNum page_num, bool leaf_keys = true)
+  {
+    return fetch(page_num, false, false, leaf_keys);
+  }
+  /**
+   * 加页面的latch之后再解码
+   */
+  RC get_latched(PageNum page_num, bool exclusive)
+  {
+    return fetch(page_num, true, exclusive, true);
+  }
+  /**
+   * 分配一个新页面作为空节点
+   */
+  RC allocate(bool is_leaf, PageNum parent);
+  RC save();
+  RC release();
+
+  /**
+   * 保证能放下key_num个key和key_num + 1个孩子
+   */
+  void reserve(int key_num);
+  /**
+   * 叶子在pos插入key和它的rid，内部节点在pos插入key，rid是它右边的孩子
+   */
+  void insert(int pos, const char *key, const RID &rid);
+  /**
+   * 删除第pos个key，内部节点同时删除它右边的孩子
+   */
+  void remove(int pos);
+
+  char *key(int pos)
+  {
+    return node.keys + pos * handler_.file_header_.key_length;
+  }
+  PageNum page_num() const
+  {
+    return page_num_;
+  }
+
+public:
+  IndexNode node;
+
+private:
+  RC fetch(PageNum page_num, bool latch, bool exclusive, bool leaf_keys);
+  void decode(bool leaf_keys);
+
+private:
+  BplusTreeHandler &handler_;
+  BPPageHandle page_handle_;
+  char *pdata_ = nullptr;
+  PageNum page_num_ = -1;
+  bool pinned_ = false;
+  bool latched_ = false;
+  std::vector<char> keys_;
+  std::vector<RID> rids_;
+};
+
+RC BplusTreeHandler::NodeFrame::fetch(PageNum page_num, bool latch, bool exclusive, bool leaf_keys)
+{
+  RC rc = release();
+  if (rc != SUCCESS)
+  {
+    return rc;
+  }
+  DiskBufferPool *disk_buffer_pool = handler_.disk_buffer_pool_;
+  rc = disk_buffer_pool->get_this_page(handler_.file_id_, page_num, &page_handle_);
+  if (rc != SUCCESS)
+  {
+    return rc;
+  }
+  pinned_ = true;
+  page_num_ = page_num;
+  disk_buffer_pool->get_data(&page_handle_, &pdata_);
+  if (latch)
+  {
+    disk_buffer_pool->latch_page(&page_handle_, exclusive);
+    latched_ = true;
+  }
+  decode(leaf_keys);
+  return SUCCESS;
+}
+
+RC BplusTreeHandler::NodeFrame::allocate(bool is_leaf, PageNum parent)
+{
+  RC rc = release();
+  if (rc != SUCCESS)
+  {
+    return rc;
+  }
+  DiskBufferPool *disk_buffer_pool = handler_.disk_buffer_pool_;
+  rc = disk_buffer_pool->allocate_page(handler_.file_id_, &page_handle_);
+  if (rc != SUCCESS)
+  {
+    LOG_ERROR("Failed to allocate index page. rc=%d:%s", rc, strrc(rc));
+    return rc;
+  }
+  pinned_ = true;
+  disk_buffer_pool->get_data(&page_handle_, &pdata_);
+  disk_buffer_pool->get_page_num(&page_handle_, &page_num_);
+  node.is_leaf = is_leaf ? 1 : 0;
+  node.key_num = 0;
+  node.parent = parent;
+  node.next = -1;
+  reserve(0);
+  node.rids[0].page_num = -1;
+  node.rids[0].slot_num = -1;
+  return SUCCESS;
+}
+
+RC BplusTreeHandler::NodeFrame::release()
+{
+  RC rc = SUCCESS;
+  if (latched_)
+  {
+    handler_.disk_buffer_pool_->unlatch_page(&page_handle_);
+    latched_ = false;
+  }
+  if (pinned_)
+  {
+    rc = handler_.disk_buffer_pool_->unpin_page(&page_handle_);
+    pinned_ = false;
+  }
+  return rc;
+}
+
+void BplusTreeHandler::NodeFrame::reserve(int key_num)
 {
-  IndexNode *node = (IndexNode *)(page_data + sizeof(IndexFileHeader));
-  node->keys = (char *)node + sizeof(IndexNode);
-  node->rids = (RID *)(node->keys + file_header_.order * file_header_.key_length);
-  return node;
+  const size_t key_length = handler_.file_header_.key_length;
+  if (keys_.size() < (key_num + 1) * key_length)
+  {
+    keys_.resize((key_num + 1) * key_length);
+    rids_.resize(key_num + 2);
+  }
+  node.keys = keys_.data();
+  node.rids = rids_.data();
+}
+
+void BplusTreeHandler::NodeFrame::insert(int pos, const char *key, const RID &rid)
+{
+  const int key_length = handler_.file_header_.key_length;
+  reserve(node.key_num + 1);
+  memmove(node.keys + (pos + 1) * key_length, node.keys + pos * key_length, (node.key_num - pos) * key_length);
+  memcpy(node.keys + pos * key_length, key, key_length);
+  const int rid_pos = node.is_leaf ? pos : pos + 1;
+  const int rid_num = node.is_leaf ? node.key_num : node.key_num + 1;
+  memmove(node.rids + rid_pos + 1, node.rids + rid_pos, (rid_num - rid_pos) * sizeof(RID));
+  node.rids[rid_pos] = rid;
+  node.key_num++;
+}
+
+void BplusTreeHandler::NodeFrame::remove(int pos)
+{
+  const int key_length = handler_.file_header_.key_length;
+  memmove(node.keys + pos * key_length, node.keys + (pos + 1) * key_length, (node.key_num - pos - 1) * key_length);
+  const int rid_pos = node.is_leaf ? pos : pos + 1;
+  const int rid_num = node.is_leaf ? node.key_num : node.key_num + 1;
+  memmove(node.rids + rid_pos, node.rids + rid_pos + 1, (rid_num - rid_pos - 1) * sizeof(RID));
+  node.key_num--;
+}
+
+void BplusTreeHandler::NodeFrame::decode(bool leaf_keys)
+{
+  const int attr_length = handler_.file_header_.attr_length;
+  const char *data = pdata_ + sizeof(IndexFileHeader);
+  PackedNodeHeader header;
+  memcpy(&header, data, sizeof(header));
+  data += sizeof(header);
+  node.is_leaf = header.is_leaf;
+  node.key_num = header.key_num;
+  node.parent = header.parent;
+  node.next = header.next;
+  if (node.is_leaf && !leaf_keys)
+  {
+    return;
+  }
+
+  reserve(node.key_num);
+  const char *prefix = data;
+  data += header.prefix_length;
+  if (!node.is_leaf)
+  {
+    memcpy(&node.rids[0].page_num, data, sizeof(PageNum));
+    node.rids[0].slot_num = -1;
+    data += sizeof(PageNum);
+  }
+  for (int i = 0; i < node.key_num; i++)
+  {
+    char *key = this->key(i);
+    uint16_t length;
+    memcpy(&length, data, sizeof(length));
+    data += sizeof(length);
+    const bool min_rid = !node.is_leaf && (length & MIN_RID_FLAG) != 0;
+    length &= ~MIN_RID_FLAG;
+    memcpy(key, prefix, header.prefix_length);
+    memcpy(key + header.prefix_length, data, length);
+    memset(key + header.prefix_length + length, 0, attr_length - header.prefix_length - length);
+    data += length;
+    if (node.is_leaf)
+    {
+      memcpy(&node.rids[i], data, sizeof(RID));
+      memcpy(key + attr_length, data, sizeof(RID));
+      data += sizeof(RID);
+      continue;
+    }
+    if (min_rid)
+    {
+      RID rid;
+      rid.page_num = -1;
+      rid.slot_num = -1;
+      memcpy(key + attr_length, &rid, sizeof(rid));
+    }
+    else
+    {
+      memcpy(key + attr_length, data, sizeof(RID));
+      data += sizeof(RID);
+    }
+    memcpy(&node.rids[i + 1].page_num, data, sizeof(PageNum));
+    node.rids[i + 1].slot_num = -1;
+    data += sizeof(PageNum);
+  }
+}
+
+RC BplusTreeHandler::NodeFrame::save()
+{
+  const int attr_length = handler_.file_header_.attr_length;
+  if (!handler_.node_fits(node))
+  {
+    LOG_ERROR("Index node does not fit in page %d. key num=%d", page_num_, node.key_num);
+    return RC::INTERNAL;
+  }
+  PackedNodeHeader header;
+  header.is_leaf = node.is_leaf;
+  header.key_num = node.key_num;
+  header.parent = node.parent;
+  header.next = node.next;
+  header.prefix_length = handler_.prefix_length(node.keys, node.key_num);
+  char *data = pdata_ + sizeof(IndexFileHeader);
+  memcpy(data, &header, sizeof(header));
+  data += sizeof(header);
+  memcpy(data, node.keys, header.prefix_length);
+  data += header.prefix_length;
+  if (!node.is_leaf)
+  {
+    memcpy(data, &node.rids[0].page_num, sizeof(PageNum));
+    data += sizeof(PageNum);
+  }
+  for (int i = 0; i < node.key_num; i++)
+  {
+    const char *key = this->key(i);
+    const int suffix = std::max(0, trimmed_length(key, attr_length) - header.prefix_length);
+    const bool min_rid = !node.is_leaf && is_min_rid(key + attr_length);
+    const uint16_t length = (uint16_t)suffix | (min_rid ? MIN_RID_FLAG : 0);
+    memcpy(data, &length, sizeof(length));
+    data += sizeof(length);
+    memcpy(data, key + header.prefix_length, suffix);
+    data += suffix;
+    if (node.is_leaf)
+    {
+      memcpy(data, &node.rids[i], sizeof(RID));
+      data += sizeof(RID);
+      continue;
+    }
+    if (!min_rid)
+    {
+      memcpy(data, key + attr_length, sizeof(RID));
+      data += sizeof(RID);
+    }
+    memcpy(data, &node.rids[i + 1].page_num, sizeof(PageNum));
+    data += sizeof(PageNum);
+  }
+  return handler_.disk_buffer_pool_->mark_dirty(&page_handle_);
 }
 
+
 RC BplusTreeHandler::sync()
 {
+  RC rc = merge_change_buffer();
+  if (rc != SUCCESS)
+  {
+    return rc;
+  }
+  TreeLatchGuard guard(tree_latch_, true);
+  // 根节点变化之后文件头只修改了内存中的副本，刷盘之前写回第一个页面
+  if (header_dirty_)
+  {
+    BPPageHandle page_handle;
+    char *pdata;
+    rc = disk_buffer_pool_->get_this_page(file_id_, 1, &page_handle);
+    if (rc != SUCCESS)
+    {
+      return rc;
+    }
+    disk_buffer_pool_->get_data(&page_handle, &pdata);
+    memcpy(pdata, &file_header_, sizeof(file_header_));
+    disk_buffer_pool_->mark_dirty(&page_handle);
+    disk_buffer_pool_->unpin_page(&page_handle);
+    header_dirty_ = false;
+  }
   return disk_buffer_pool_->flush_all_pages(file_id_);
 }
+
+RC BplusTreeHandler::map_readonly()
+{
+  RC rc = sync();
+  if (rc != SUCCESS)
+  {
+    return rc;
+  }
+  return disk_buffer_pool_->map_file(file_id_);
+}
+
+RC BplusTreeHandler::create(const char *file_name, AttrType attr_type, int attr_length, int page_size)
+{
+  return create(file_name, &attr_type, &attr_length, 1, page_size);
+}
+
 // 创建以file_name为名称的index文件
-RC BplusTreeHandler::create(const char *file_name, AttrType attr_type, int attr_length)
+RC BplusTreeHandler::create(const char *file_name, const AttrType attr_types[], const int attr_lengths[],
+                            int column_num, int page_size)
 {
+  if (column_num <= 0)
+  {
+    LOG_ERROR("Invalid column num %d of index file %s", column_num, file_name);
+    return RC::INVALID_ARGUMENT;
+  }
+  // 多字段索引的属性值是各个字段按顺序拼在一起，文件头中只记录总长度和第一个字段的类型
+  int attr_length = 0;
+  for (int i = 0; i < column_num; i++)
+  {
+    attr_length += attr_lengths[i];
+  }
+  AttrType attr_type = attr_types[0];
+
   BPPageHandle page_handle;
-  IndexNode *root;
   char *pdata;
   RC rc;
-  DiskBufferPool *disk_buffer_pool = theGlobalDiskBufferPool();
+  DiskBufferPool *disk_buffer_pool = theGlobalDiskBufferPool(page_size);
+  if (disk_buffer_pool == nullptr)
+  {
+    LOG_ERROR("Invalid page size %d of index file %s", page_size, file_name);
+    return RC::INVALID_ARGUMENT;
+  }
+  // 分裂时两边都至少要有一个key，内部节点还要移一个key到父节点中，一个页面至少要能放下三个最长的key
+  const int max_entry = sizeof(uint16_t) + attr_length + sizeof(RID) + sizeof(PageNum);
+  const int capacity = disk_buffer_pool->page_data_size() - (int)sizeof(IndexFileHeader);
+  if ((int)sizeof(PackedNodeHeader) + attr_length + (int)sizeof(PageNum) + 3 * max_entry > capacity)
+  {
+    LOG_ERROR("Index key of file %s is too long. attr length=%d, page size=%d", file_name, attr_length, page_size);
+    return RC::INVALID_ARGUMENT;
+  }
   rc = disk_buffer_pool->create_file(file_name);
   if (rc != SUCCESS)
   {
@@ -85,15 +550,16 @@ RC BplusTreeHandler::create(const char *file_name, AttrType attr_type, int attr_
   file_header->key_length = attr_length + sizeof(RID);
   file_header->attr_type = attr_type;
   file_header->node_num = 1;
-  file_header->order = ((int)BP_PAGE_DATA_SIZE - sizeof(IndexFileHeader) - sizeof(IndexNode)) / (attr_length + 2 * sizeof(RID));
+  file_header->format = BPLUS_TREE_FILE_FORMAT;
   file_header->root_page = page_num;
 
-  root = get_index_node(pdata);
-  root->is_leaf = 1;
-  root->key_num = 0;
-  root->parent = -1;
-  root->keys = nullptr;
-  root->rids = nullptr;
+  PackedNodeHeader root;
+  root.is_leaf = 1;
+  root.key_num = 0;
+  root.parent = -1;
+  root.next = -1;
+  root.prefix_length = 0;
+  memcpy(pdata + sizeof(IndexFileHeader), &root, sizeof(root));
 
   rc = disk_buffer_pool->mark_dirty(&page_handle);
   if (rc != SUCCESS)
@@ -113,10 +579,10 @@ RC BplusTreeHandler::create(const char *file_name, AttrType attr_type, int attr_
   memcpy(&file_header_, pdata, sizeof(file_header_));
   header_dirty_ = false;
 
-  return SUCCESS;
+  return init_key_columns(attr_types, attr_lengths, column_num);
 }
 
-RC BplusTreeHandler::open(const char *file_name)
+RC BplusTreeHandler::open(const char *file_name, const AttrType attr_types[], const int attr_lengths[], int column_num)
 {
   RC rc;
   BPPageHandle page_handle;
@@ -126,7 +592,13 @@ RC BplusTreeHandler::open(const char *file_name)
     return RC::RECORD_OPENNED;
   }
 
-  DiskBufferPool *disk_buffer_pool = theGlobalDiskBufferPool();
+  int page_size = BP_PAGE_SIZE;
+  rc = DiskBufferPool::read_file_page_size(file_name, &page_size);
+  if (rc != SUCCESS)
+  {
+    return rc;
+  }
+  DiskBufferPool *disk_buffer_pool = theGlobalDiskBufferPool(page_size);
   int file_id;
   rc = disk_buffer_pool->open_file(file_name, &file_id);
   if (rc != SUCCESS)
@@ -144,27 +616,68 @@ RC BplusTreeHandler::open(const char *file_name)
     return rc;
   }
   memcpy(&file_header_, pdata, sizeof(IndexFileHeader));
+  rc = disk_buffer_pool->unpin_page(&page_handle);
+  if (rc != SUCCESS)
+  {
+    return rc;
+  }
+  if (file_header_.format != BPLUS_TREE_FILE_FORMAT)
+  {
+    LOG_ERROR("Index file %s is in an old format and must be rebuilt. format=0x%x", file_name, file_header_.format);
+    disk_buffer_pool->close_file(file_id);
+    return RC::FORMAT;
+  }
   header_dirty_ = false;
   disk_buffer_pool_ = disk_buffer_pool;
   file_id_ = file_id;
 
-  rc = disk_buffer_pool->unpin_page(&page_handle);
+  // 没有指定字段时按照文件头当作单字段索引
+  if (attr_types == nullptr)
+  {
+    rc = init_key_columns(&file_header_.attr_type, &file_header_.attr_length, 1);
+  }
+  else
+  {
+    rc = init_key_columns(attr_types, attr_lengths, column_num);
+  }
   if (rc != SUCCESS)
   {
-    return rc;
+    close();
   }
-  return SUCCESS;
+  return rc;
 }
 
 RC BplusTreeHandler::close()
 {
   sync();
+  begin_structure_change();
+  end_structure_change();
   disk_buffer_pool_->close_file(file_id_);
   file_id_ = -1;
   disk_buffer_pool_ = nullptr;
   return RC::SUCCESS;
 }
 
+RC BplusTreeHandler::drop()
+{
+  if (disk_buffer_pool_ == nullptr)
+  {
+    return RC::SUCCESS;
+  }
+  begin_structure_change();
+  end_structure_change();
+  {
+    std::lock_guard<std::mutex> lock(change_mutex_);
+    changes_.clear();
+    change_count_ = 0;
+  }
+  RC rc = disk_buffer_pool_->drop_file(file_id_);
+  file_id_ = -1;
+  disk_buffer_pool_ = nullptr;
+  header_dirty_ = false;
+  return rc;
+}
+
 static int CmpRid(const RID *rid1, const RID *rid2)
 {
   if (rid1->page_num > rid2->page_num)
@@ -177,1033 +690,1147 @@ static int CmpRid(const RID *rid1, const RID *rid2)
     return -1;
   return 0;
 }
-int CompareKey(const char *pdata, const char *pkey, AttrType attr_type, int attr_length)
-{ // 简化
-  int i1, i2;
-  float f1, f2;
-  const char *s1, *s2;
-  switch (attr_type)
-  {
-  case INTS:
-  {
-    i1 = *(int *)pdata;
-    i2 = *(int *)pkey;
-    if (i1 > i2)
-      return 1;
-    if (i1 < i2)
-      return -1;
-    if (i1 == i2)
-      return 0;
-  }
-  break;
-  case DATES:
+
+/**
+ * 每种字段类型一个比较函数，在create/open时选定，避免每次比较都按类型分发。
+ * 单字段索引的比较函数不需要columns，多字段索引按columns依次比较每个字段
+ */
+template <AttrType TYPE>
+struct AttrCompare;
+
+template <>
+struct AttrCompare<INTS> {
+  static int compare(const char *v1, const char *v2, int attr_length, const IndexKeyColumn *columns, int column_num)
   {
-    i1 = *(int *)pdata;
-    i2 = *(int *)pkey;
-    if (i1 > i2)
-      return 1;
-    if (i1 < i2)
-      return -1;
-    if (i1 == i2)
-      return 0;
+    int i1 = *(const int *)v1;
+    int i2 = *(const int *)v2;
+    return i1 > i2 ? 1 : (i1 < i2 ? -1 : 0);
   }
-  break;
-  case FLOATS:
+};
+
+// 日期保存成从1970-01-01开始的天数，和整数的比较方式相同
+template <>
+struct AttrCompare<DATES> : public AttrCompare<INTS> {
+};
+
+template <>
+struct AttrCompare<FLOATS> {
+  static int compare(const char *v1, const char *v2, int attr_length, const IndexKeyColumn *columns, int column_num)
   {
-    f1 = *(float *)pdata;
-    f2 = *(float *)pkey;
-    return float_compare(f1, f2);
+    return float_compare(*(const float *)v1, *(const float *)v2);
   }
-  break;
-  case CHARS:
+};
+
+template <>
+struct AttrCompare<CHARS> {
+  static int compare(const char *v1, const char *v2, int attr_length, const IndexKeyColumn *columns, int column_num)
   {
-    s1 = pdata;
-    s2 = pkey;
-    return strncmp(s1, s2, attr_length);
+    return strncmp(v1, v2, attr_length);
   }
-  break;
-  default:
+};
+
+/**
+ * 多字段索引按字段顺序比较，前面的字段相同时才比较后面的字段
+ */
+struct CompositeAttrCompare {
+  static int compare(const char *v1, const char *v2, int attr_length, const IndexKeyColumn *columns, int column_num)
   {
-    LOG_PANIC("Unknown attr type: %d", attr_type);
-  }
+    for (int i = 0; i < column_num; i++)
+    {
+      const IndexKeyColumn &column = columns[i];
+      const char *c1 = v1 + column.offset;
+      const char *c2 = v2 + column.offset;
+      int result = 0;
+      switch (column.type)
+      {
+      case INTS:
+      case DATES:
+        result = AttrCompare<INTS>::compare(c1, c2, column.length, nullptr, 1);
+        break;
+      case FLOATS:
+        result = AttrCompare<FLOATS>::compare(c1, c2, column.length, nullptr, 1);
+        break;
+      default:
+        result = AttrCompare<CHARS>::compare(c1, c2, column.length, nullptr, 1);
+        break;
+      }
+      if (0 != result)
+      {
+        return result;
+      }
+    }
+    return 0;
   }
-  return -2; // This means error happens
+};
+
+template <class Compare>
+static int attr_compare(const char *v1, const char *v2, int attr_length, const IndexKeyColumn *columns,
+                        int column_num)
+{
+  return Compare::compare(v1, v2, attr_length, columns, column_num);
 }
-int CmpKey(AttrType attr_type, int attr_length, const char *pdata, const char *pkey)
+
+/**
+ * 索引的key是属性值后面跟着rid，属性值相同时按rid排序
+ */
+template <class Compare>
+static inline int key_compare(const char *key1, const char *key2, int attr_length, const IndexKeyColumn *columns,
+                              int column_num)
 {
-  int result = CompareKey(pdata, pkey, attr_type, attr_length);
+  int result = Compare::compare(key1, key2, attr_length, columns, column_num);
   if (0 != result)
   {
     return result;
   }
-  RID *rid1 = (RID *)(pdata + attr_length);
-  RID *rid2 = (RID *)(pkey + attr_length);
-  return CmpRid(rid1, rid2);
+  return CmpRid((const RID *)(key1 + attr_length), (const RID *)(key2 + attr_length));
 }
 
-RC BplusTreeHandler::find_leaf(const char *pkey, PageNum *leaf_page)
+/**
+ * 在节点有序的keys中二分查找，upper为false时返回第一个不小于pkey的位置，
+ * 为true时返回第一个大于pkey的位置，都没有时返回key_num
+ */
+template <class Compare>
+static int key_search(const char *keys, int key_num, int key_length, int attr_length, const IndexKeyColumn *columns,
+                      int column_num, const char *pkey, bool upper)
 {
-  RC rc;
-  BPPageHandle page_handle;
-  IndexNode *node;
-  char *pdata;
-  int i, tmp;
-  rc = disk_buffer_pool_->get_this_page(file_id_, file_header_.root_page, &page_handle);
-  if (rc != SUCCESS)
-  {
-    return rc;
-  }
-  // pdata->page_data
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-  if (rc != SUCCESS)
+  int low = 0;
+  int high = key_num;
+  while (low < high)
   {
-    return rc;
-  }
-  // 根据page_data的位置获取对应的index_node
-  node = get_index_node(pdata);
-  while (0 == node->is_leaf)
-  {
-    for (i = 0; i < node->key_num; i++)
-    {
-      tmp = CmpKey(file_header_.attr_type, file_header_.attr_length, pkey, node->keys + i * file_header_.key_length);
-      if (tmp < 0)
-        break;
-    }
-    rc = disk_buffer_pool_->unpin_page(&page_handle);
-    if (rc != SUCCESS)
-    {
-      return rc;
-    }
-    rc = disk_buffer_pool_->get_this_page(file_id_, node->rids[i].page_num, &page_handle);
-    if (rc != SUCCESS)
+    int mid = low + (high - low) / 2;
+    int result = key_compare<Compare>(keys + mid * key_length, pkey, attr_length, columns, column_num);
+    if (result < 0 || (upper && result == 0))
     {
-      return rc;
+      low = mid + 1;
     }
-    rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-    if (rc != SUCCESS)
+    else
     {
-      return rc;
+      high = mid;
     }
-    // 根据节点key的比较不断更新节点 直到找到leaf节点
-    node = get_index_node(pdata);
   }
-  rc = disk_buffer_pool_->get_page_num(&page_handle, leaf_page);
-  if (rc != SUCCESS)
+  return low;
+}
+
+template <class Compare>
+static void set_comparator(
+    int (*&attr_comparator)(const char *, const char *, int, const IndexKeyColumn *, int),
+    int (*&key_comparator)(const char *, const char *, int, const IndexKeyColumn *, int),
+    int (*&key_searcher)(const char *, int, int, int, const IndexKeyColumn *, int, const char *, bool))
+{
+  attr_comparator = attr_compare<Compare>;
+  key_comparator = key_compare<Compare>;
+  key_searcher = key_search<Compare>;
+}
+
+RC BplusTreeHandler::init_key_columns(const AttrType attr_types[], const int attr_lengths[], int column_num)
+{
+  key_columns_.clear();
+  int offset = 0;
+  for (int i = 0; i < column_num; i++)
   {
-    return rc;
+    IndexKeyColumn column;
+    column.type = attr_types[i];
+    column.offset = offset;
+    column.length = attr_lengths[i];
+    key_columns_.push_back(column);
+    offset += attr_lengths[i];
   }
-  rc = disk_buffer_pool_->unpin_page(&page_handle);
-  if (rc != SUCCESS)
+  if (column_num <= 0 || offset != file_header_.attr_length || attr_types[0] != file_header_.attr_type)
   {
-    return rc;
+    LOG_ERROR("Index key columns do not match the index file. column num=%d, length=%d, file attr length=%d",
+              column_num, offset, file_header_.attr_length);
+    return RC::INVALID_ARGUMENT;
   }
-  return SUCCESS;
+  return init_comparator();
 }
 
-RC BplusTreeHandler::insert_into_leaf(PageNum leaf_page, const char *pkey, const RID *rid)
+RC BplusTreeHandler::init_comparator()
 {
-  int i, insert_pos, tmp;
-  BPPageHandle page_handle;
-  char *pdata;
-  char *from, *to;
-  IndexNode *node;
-  RC rc;
-
-  rc = disk_buffer_pool_->get_this_page(file_id_, leaf_page, &page_handle);
-  if (rc != SUCCESS)
+  if (key_columns_.size() > 1)
   {
-    return rc;
+    set_comparator<CompositeAttrCompare>(attr_comparator_, key_comparator_, key_searcher_);
+    return RC::SUCCESS;
   }
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-  if (rc != SUCCESS)
+
+  switch (file_header_.attr_type)
   {
-    return rc;
+  case INTS:
+    set_comparator<AttrCompare<INTS>>(attr_comparator_, key_comparator_, key_searcher_);
+    break;
+  case DATES:
+    set_comparator<AttrCompare<DATES>>(attr_comparator_, key_comparator_, key_searcher_);
+    break;
+  case FLOATS:
+    set_comparator<AttrCompare<FLOATS>>(attr_comparator_, key_comparator_, key_searcher_);
+    break;
+  case CHARS:
+    set_comparator<AttrCompare<CHARS>>(attr_comparator_, key_comparator_, key_searcher_);
+    break;
+  default:
+    LOG_ERROR("Unknown attr type of index: %d", file_header_.attr_type);
+    return RC::INVALID_ARGUMENT;
+  }
+  return RC::SUCCESS;
+}
+
+int BplusTreeHandler::lower_bound(const IndexNode *node, const char *pkey) const
+{
+  return key_searcher_(node->keys, node->key_num, file_header_.key_length, file_header_.attr_length,
+                       key_columns_.data(), (int)key_columns_.size(), pkey, false);
+}
+
+int BplusTreeHandler::upper_bound(const IndexNode *node, const char *pkey) const
+{
+  return key_searcher_(node->keys, node->key_num, file_header_.key_length, file_header_.attr_length,
+                       key_columns_.data(), (int)key_columns_.size(), pkey, true);
+}
+
+int BplusTreeHandler::compare_key(const char *key1, const char *key2) const
+{
+  return key_comparator_(key1, key2, file_header_.attr_length, key_columns_.data(), (int)key_columns_.size());
+}
+
+int BplusTreeHandler::compare_attr(const char *value1, const char *value2) const
+{
+  return attr_comparator_(value1, value2, file_header_.attr_length, key_columns_.data(), (int)key_columns_.size());
+}
+
+int BplusTreeHandler::compare_attr_prefix(const char *value1, const char *value2, int column_num) const
+{
+  if (column_num >= (int)key_columns_.size())
+  {
+    return compare_attr(value1, value2);
   }
-  node = get_index_node(pdata);
+  return CompositeAttrCompare::compare(value1, value2, file_header_.attr_length, key_columns_.data(), column_num);
+}
+
+int BplusTreeHandler::compare_unique_attr(const char *value1, const char *value2) const
+{
+  return unique_column_num_ > 0 ? compare_attr_prefix(value1, value2, unique_column_num_)
+                                : compare_attr(value1, value2);
+}
 
-  for (insert_pos = 0; insert_pos < node->key_num; insert_pos++)
+void BplusTreeHandler::fill_key_columns(char *value, int from_column, bool max_value) const
+{
+  for (int i = from_column; i < (int)key_columns_.size(); i++)
   {
-    tmp = CmpKey(file_header_.attr_type, file_header_.attr_length, pkey, node->keys + insert_pos * file_header_.key_length);
-    if (tmp == 0)
+    const IndexKeyColumn &column = key_columns_[i];
+    char *data = value + column.offset;
+    switch (column.type)
+    {
+    case INTS:
+    case DATES:
+    {
+      int v = max_value ? INT_MAX : INT_MIN;
+      memcpy(data, &v, sizeof(v));
+    }
+    break;
+    case FLOATS:
     {
-      return RC::RECORD_DUPLICATE_KEY;
+      float v = max_value ? FLT_MAX : -FLT_MAX;
+      memcpy(data, &v, sizeof(v));
     }
-    if (tmp < 0)
+    break;
+    default:
+      memset(data, max_value ? 0xFF : 0, column.length);
       break;
+    }
   }
-  for (i = node->key_num; i > insert_pos; i--)
+}
+
+int BplusTreeHandler::node_capacity() const
+{
+  return disk_buffer_pool_->page_data_size() - (int)sizeof(IndexFileHeader);
+}
+
+int BplusTreeHandler::prefix_length(const char *keys, int key_num) const
+{
+  if (key_num <= 0)
   {
-    from = node->keys + (i - 1) * file_header_.key_length;
-    to = node->keys + i * file_header_.key_length;
-    memcpy(to, from, file_header_.key_length);
-    memcpy(node->rids + i, node->rids + i - 1, sizeof(RID));
+    return 0;
   }
-  memcpy(node->keys + insert_pos * file_header_.key_length, pkey, file_header_.key_length);
-  memcpy(node->rids + insert_pos, rid, sizeof(RID));
-  node->key_num++; //叶子结点增加一条记录
-  rc = disk_buffer_pool_->mark_dirty(&page_handle);
-  if (rc != SUCCESS)
+  const int attr_length = file_header_.attr_length;
+  const int key_length = file_header_.key_length;
+  int prefix = attr_length;
+  int max_length = 0;
+  for (int i = 0; i < key_num; i++)
   {
-    return rc;
+    const char *key = keys + i * key_length;
+    int same = 0;
+    while (same < prefix && key[same] == keys[same])
+    {
+      same++;
+    }
+    prefix = same;
+    max_length = std::max(max_length, trimmed_length(key, attr_length));
   }
-  rc = disk_buffer_pool_->unpin_page(&page_handle);
-  if (rc != SUCCESS)
+  return std::min(prefix, max_length);
+}
+
+int BplusTreeHandler::packed_size(bool is_leaf, const char *keys, int key_num) const
+{
+  const int attr_length = file_header_.attr_length;
+  const int key_length = file_header_.key_length;
+  const int prefix = prefix_length(keys, key_num);
+  int size = sizeof(PackedNodeHeader) + prefix + (is_leaf ? 0 : sizeof(PageNum));
+  for (int i = 0; i < key_num; i++)
   {
-    return rc;
+    const char *key = keys + i * key_length;
+    size += sizeof(uint16_t) + std::max(0, trimmed_length(key, attr_length) - prefix);
+    if (is_leaf)
+    {
+      size += sizeof(RID);
+    }
+    else
+    {
+      size += (is_min_rid(key + attr_length) ? 0 : sizeof(RID)) + sizeof(PageNum);
+    }
   }
-  return SUCCESS;
+  return size;
 }
 
-RC BplusTreeHandler::print()
+bool BplusTreeHandler::node_fits(const IndexNode &node) const
 {
-  IndexNode *node;
-  RC rc;
-  BPPageHandle page_handle;
-  int i, j;
-  char *pdata;
-  int page_count;
-  rc = disk_buffer_pool_->get_page_count(file_id_, &page_count);
-  if (rc != SUCCESS)
+  return packed_size(node.is_leaf, node.keys, node.key_num) <= node_capacity();
+}
+
+bool BplusTreeHandler::node_underflow(const IndexNode &node) const
+{
+  if (node.key_num == 0)
   {
-    return rc;
+    return true;
   }
-  for (i = 1; i <= page_count; i++)
+  const int threshold = node.is_leaf ? bplus_tree_merge_threshold() : 50;
+  return (long)packed_size(node.is_leaf, node.keys, node.key_num) * 100 < (long)node_capacity() * threshold;
+}
+
+int BplusTreeHandler::choose_split(const IndexNode &node, int preferred) const
+{
+  // 叶子分成[0, split)和[split, key_num)；内部节点的第split个key移到父节点中，右边从split + 1开始
+  const int key_length = file_header_.key_length;
+  const int moved = node.is_leaf ? 0 : 1;
+  const int capacity = node_capacity();
+  auto left_fits = [&](int split) {
+    return packed_size(node.is_leaf, node.keys, split) <= capacity;
+  };
+  auto right_fits = [&](int split) {
+    return packed_size(node.is_leaf, node.keys + (split + moved) * key_length, node.key_num - split - moved) <= capacity;
+  };
+
+  // key越少，共同的前缀只会越长，占用的空间不会变大。左边随着split变大，右边变小，二分找到两边都放得下的范围
+  const int first = 1;
+  const int last = node.key_num - 1 - moved;
+  if (first > last)
   {
-    rc = disk_buffer_pool_->get_this_page(file_id_, i, &page_handle);
-    if (rc == RC::BUFFERPOOL_INVALID_PAGE_NUM)
-      continue;
-    if (rc != SUCCESS)
+    return -1;
+  }
+  int low = first;
+  int high = last + 1;
+  while (low < high)
+  {
+    int mid = low + (high - low) / 2;
+    if (right_fits(mid))
     {
-      return rc;
+      high = mid;
     }
-    rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-    if (rc != SUCCESS)
+    else
     {
-      return rc;
+      low = mid + 1;
     }
-    node = get_index_node(pdata);
-    printf("page_num :%d 当前node是否为leaf :%d\n", i, node->is_leaf);
-    for (j = 0; j < node->key_num && j < 6; j++)
+  }
+  const int min_split = low;
+  low = first - 1;
+  high = last;
+  while (low < high)
+  {
+    int mid = low + (high - low + 1) / 2;
+    if (left_fits(mid))
     {
-      printf("keynum :%d rids:page_num :%d,slotnum :%d\n", node->key_num, node->rids[j].page_num, node->rids[j].slot_num);
+      low = mid;
     }
-    printf("\n");
-    rc = disk_buffer_pool_->unpin_page(&page_handle);
-    if (rc != SUCCESS)
+    else
     {
-      return rc;
+      high = mid - 1;
     }
   }
-  return rc;
+  const int max_split = low;
+  if (min_split > max_split)
+  {
+    return -1;
+  }
+  return std::min(max_split, std::max(min_split, preferred));
 }
 
-RC BplusTreeHandler::insert_into_leaf_after_split(PageNum leaf_page, const char *pkey, const RID *rid)
+void BplusTreeHandler::make_separator(const char *left_key, const char *right_key, char *separator) const
 {
-  RC rc;
-  BPPageHandle page_handle1, page_handle2;
-  IndexNode *leaf, *new_node;
-  PageNum new_page, parent_page;
-  RID *temp_pointers, tmprid;
-  char *temp_keys, *new_key;
-  char *pdata;
-  int insert_pos, split, i, j, tmp;
+  const int attr_length = file_header_.attr_length;
+  RID min_rid;
+  min_rid.page_num = -1;
+  min_rid.slot_num = -1;
+  const int right_length = trimmed_length(right_key, attr_length);
+  for (int length = 0; length <= right_length; length++)
+  {
+    if (length > 0 && right_key[length - 1] == 0)
+    {
+      continue;
+    }
+    memset(separator, 0, attr_length);
+    memcpy(separator, right_key, length);
+    memcpy(separator + attr_length, &min_rid, sizeof(min_rid));
+    // 补0之后的整数、浮点数不一定还在两个key之间，每个候选都要比较
+    if (compare_key(left_key, separator) < 0 && compare_key(separator, right_key) <= 0)
+    {
+      return;
+    }
+  }
+  memcpy(separator, right_key, file_header_.key_length);
+}
 
-  rc = disk_buffer_pool_->get_this_page(file_id_, leaf_page, &page_handle1);
+RC BplusTreeHandler::set_parent(PageNum page_num, PageNum parent)
+{
+  BPPageHandle page_handle;
+  RC rc = disk_buffer_pool_->get_this_page(file_id_, page_num, &page_handle);
   if (rc != SUCCESS)
   {
     return rc;
   }
-  rc = disk_buffer_pool_->get_data(&page_handle1, &pdata);
+  char *pdata;
+  disk_buffer_pool_->get_data(&page_handle, &pdata);
+  PackedNodeHeader *header = (PackedNodeHeader *)(pdata + sizeof(IndexFileHeader));
+  header->parent = parent;
+  rc = disk_buffer_pool_->mark_dirty(&page_handle);
   if (rc != SUCCESS)
   {
+    disk_buffer_pool_->unpin_page(&page_handle);
     return rc;
   }
-  leaf = get_index_node(pdata);
+  return disk_buffer_pool_->unpin_page(&page_handle);
+}
 
-  // add a new node
-  rc = disk_buffer_pool_->allocate_page(file_id_, &page_handle2);
-  if (rc != SUCCESS)
+void BplusTreeHandler::begin_structure_change()
+{
+  smo_count_++;
+  structure_changing_ = true;
+  cached_root_ = nullptr;
+  root_is_leaf_ = false;
+  cache_full_ = false;
+  cached_nodes_.clear();
+  rightmost_leaf_ = -1;
+}
+
+void BplusTreeHandler::end_structure_change()
+{
+  structure_changing_ = false;
+}
+
+size_t BplusTreeHandler::cached_inner_nodes()
+{
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  return cached_nodes_.size();
+}
+
+RC BplusTreeHandler::load_cached_node(PageNum page_num, std::atomic<CachedNode *> &slot, CachedNode **node,
+                                      bool *is_leaf)
+{
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  *node = slot.load();
+  *is_leaf = false;
+  if (*node != nullptr)
   {
-    return rc;
+    // 其它线程已经加入了
+    return SUCCESS;
   }
 
-  rc = disk_buffer_pool_->get_data(&page_handle2, &pdata);
+  NodeFrame frame(*this);
+  RC rc = frame.get(page_num, false);
   if (rc != SUCCESS)
   {
     return rc;
   }
-  rc = disk_buffer_pool_->get_page_num(&page_handle2, &new_page);
-  if (rc != SUCCESS)
+  const IndexNode &index_node = frame.node;
+  *is_leaf = index_node.is_leaf != 0;
+  if (!*is_leaf && cached_nodes_.size() < BPLUS_TREE_CACHED_INNER_NODES)
   {
-    return rc;
+    std::unique_ptr<CachedNode> cached(new CachedNode);
+    cached->key_num = index_node.key_num;
+    cached->keys.assign(index_node.keys, index_node.keys + index_node.key_num * file_header_.key_length);
+    for (int i = 0; i <= index_node.key_num; i++)
+    {
+      cached->children.push_back(index_node.rids[i].page_num);
+    }
+    cached->child_nodes.reset(new std::atomic<CachedNode *>[index_node.key_num + 1]());
+    *node = cached.get();
+    cached_nodes_.push_back(std::move(cached));
+    slot = *node;
   }
-  new_node = get_index_node(pdata);
-  new_node->key_num = 0;
-  new_node->is_leaf = 1;
-  new_node->parent = leaf->parent;
-
-  parent_page = leaf->parent;
-
-  // print();
+  cache_full_ = cached_nodes_.size() >= BPLUS_TREE_CACHED_INNER_NODES;
+  return frame.release();
+}
 
-  temp_keys = (char *)malloc(file_header_.key_length * file_header_.order);
-  if (temp_keys == nullptr)
-  {
-    LOG_ERROR("Failed to alloc memory for temp key. size=%d", file_header_.key_length * file_header_.order);
-    return RC::NOMEM;
-  }
+RC BplusTreeHandler::find_leaf(const char *pkey, PageNum *leaf_page)
+{
+  RC rc;
+  int i;
 
-  temp_pointers = (RID *)malloc((file_header_.order + 1) * sizeof(RID));
-  if (temp_pointers == nullptr)
+  // 先在缓存的内部节点中往下找，遇到没有缓存的内部节点时从它开始读缓冲池中的页面
+  PageNum page_num = file_header_.root_page;
+  if (!structure_changing_ && !root_is_leaf_)
   {
-    LOG_ERROR("Failed to alloc memory for temp pointers. size=%ld", (file_header_.order + 1) * sizeof(RID));
-    free(temp_keys);
-    return RC::NOMEM;
+    CachedNode *cached = cached_root_.load();
+    bool is_leaf = false;
+    if (cached == nullptr && !cache_full_)
+    {
+      rc = load_cached_node(page_num, cached_root_, &cached, &is_leaf);
+      if (rc != SUCCESS)
+      {
+        return rc;
+      }
+      root_is_leaf_ = is_leaf;
+    }
+    while (cached != nullptr)
+    {
+      i = key_searcher_(cached->keys.data(), cached->key_num, file_header_.key_length, file_header_.attr_length,
+                        key_columns_.data(), (int)key_columns_.size(), pkey, true);
+      page_num = cached->children[i];
+      if (cached->leaf_children)
+      {
+        *leaf_page = page_num;
+        return SUCCESS;
+      }
+      CachedNode *child = cached->child_nodes[i].load();
+      if (child == nullptr && !cache_full_)
+      {
+        rc = load_cached_node(page_num, cached->child_nodes[i], &child, &is_leaf);
+        if (rc != SUCCESS)
+        {
+          return rc;
+        }
+        if (is_leaf)
+        {
+          cached->leaf_children = true;
+          *leaf_page = page_num;
+          return SUCCESS;
+        }
+      }
+      cached = child;
+    }
   }
 
-  for (insert_pos = 0; insert_pos < leaf->key_num; insert_pos++)
+  NodeFrame frame(*this);
+  rc = frame.get(page_num, false);
+  if (rc != SUCCESS)
   {
-    tmp = CmpKey(file_header_.attr_type, file_header_.attr_length, pkey, leaf->keys + insert_pos * file_header_.key_length);
-    if (tmp < 0)
-      break;
+    return rc;
   }
-  for (i = 0, j = 0; i < leaf->key_num; i++, j++)
+  while (0 == frame.node.is_leaf)
   {
-    if (j == insert_pos)
-      j++;
-    memcpy(temp_keys + j * file_header_.key_length, leaf->keys + i * file_header_.key_length, file_header_.key_length);
-    memcpy(temp_pointers + j, leaf->rids + i, sizeof(RID));
+    // 第一个大于pkey的key左边的孩子。get先放开当前的页面，要先取出孩子的页号
+    i = upper_bound(&frame.node, pkey);
+    PageNum child_page = frame.node.rids[i].page_num;
+    rc = frame.get(child_page, false);
+    if (rc != SUCCESS)
+    {
+      return rc;
+    }
   }
-  memcpy(temp_keys + insert_pos * file_header_.key_length, pkey, file_header_.key_length);
-  memcpy(temp_pointers + insert_pos, rid, sizeof(RID));
-
-  split = file_header_.order / 2;
+  *leaf_page = frame.page_num();
+  return frame.release();
+}
 
-  for (i = 0; i < split; i++)
+RC BplusTreeHandler::print()
+{
+  RC rc;
+  int page_count;
+  rc = disk_buffer_pool_->get_page_count(file_id_, &page_count);
+  if (rc != SUCCESS)
   {
-    memcpy(leaf->keys + i * file_header_.key_length, temp_keys + i * file_header_.key_length, file_header_.key_length);
-    memcpy(leaf->rids + i, temp_pointers + i, sizeof(RID));
+    return rc;
   }
-  leaf->key_num = split;
-
-  for (i = split, j = 0; i < file_header_.order; i++, j++)
+  NodeFrame frame(*this);
+  for (int i = 1; i <= page_count; i++)
   {
-    memcpy(new_node->keys + j * file_header_.key_length, temp_keys + i * file_header_.key_length, file_header_.key_length);
-    memcpy(new_node->rids + j, temp_pointers + i, sizeof(RID));
-    new_node->key_num++;
+    rc = frame.get(i);
+    if (rc == RC::BUFFERPOOL_INVALID_PAGE_NUM)
+      continue;
+    if (rc != SUCCESS)
+    {
+      return rc;
+    }
+    const IndexNode &node = frame.node;
+    printf("page_num :%d 当前node是否为leaf :%d\n", i, node.is_leaf);
+    for (int j = 0; j < node.key_num && j < 6; j++)
+    {
+      printf("keynum :%d rids:page_num :%d,slotnum :%d\n", node.key_num, node.rids[j].page_num, node.rids[j].slot_num);
+    }
+    printf("\n");
+    rc = frame.release();
+    if (rc != SUCCESS)
+    {
+      return rc;
+    }
   }
+  return rc;
+}
 
-  free(temp_pointers);
-  free(temp_keys);
-
-  memcpy(new_node->rids + file_header_.order - 1, leaf->rids + file_header_.order - 1, sizeof(RID));
-  tmprid.page_num = new_page;
-  tmprid.slot_num = -1;
-  memcpy(leaf->rids + file_header_.order - 1, &tmprid, sizeof(RID));
-
-  new_key = (char *)malloc(file_header_.key_length);
-  if (new_key == nullptr)
+RC BplusTreeHandler::split_node(NodeFrame &left, bool append)
+{
+  IndexNode &node = left.node;
+  const int key_length = file_header_.key_length;
+  const int key_num = node.key_num;
+  int preferred = key_num / 2;
+  if (append)
   {
-    LOG_ERROR("Failed to alloc memory for new key. size=%d", file_header_.key_length);
-    return RC::NOMEM;
+    // 在最右边的叶子末尾插入时key多半是递增的，左边的叶子之后不会再插入，只给新叶子留少量的key
+    preferred = key_num - std::max(1, key_num * BPLUS_TREE_APPEND_SPLIT_RIGHT / 100);
   }
-  memcpy(new_key, new_node->keys, file_header_.key_length);
-
-  rc = disk_buffer_pool_->mark_dirty(&page_handle1);
-  if (rc != SUCCESS)
+  const int split = choose_split(node, preferred);
+  if (split < 0)
   {
-    free(new_key);
-    return rc;
+    LOG_ERROR("Failed to split index node of page %d. key num=%d", left.page_num(), key_num);
+    return RC::INTERNAL;
   }
 
-  rc = disk_buffer_pool_->unpin_page(&page_handle1);
+  NodeFrame right(*this);
+  RC rc = right.allocate(node.is_leaf != 0, node.parent);
   if (rc != SUCCESS)
   {
-    free(new_key);
     return rc;
   }
-
-  rc = disk_buffer_pool_->mark_dirty(&page_handle2);
-  if (rc != SUCCESS)
+  std::vector<char> separator(key_length);
+  if (node.is_leaf)
   {
-    free(new_key);
-    return rc;
+    // 父节点中只放能区分两个叶子的最短的key
+    right.reserve(key_num - split);
+    memcpy(right.node.keys, left.key(split), (key_num - split) * key_length);
+    memcpy(right.node.rids, node.rids + split, (key_num - split) * sizeof(RID));
+    right.node.key_num = key_num - split;
+    right.node.next = node.next;
+    node.next = right.page_num();
+    node.key_num = split;
+    make_separator(left.key(split - 1), right.key(0), separator.data());
   }
-  rc = disk_buffer_pool_->unpin_page(&page_handle2);
-  if (rc != SUCCESS)
+  else
   {
-    free(new_key);
-    return rc;
+    // 中间的key移到父节点中，它右边的孩子成为新节点的第一个孩子
+    memcpy(separator.data(), left.key(split), key_length);
+    right.reserve(key_num - split - 1);
+    memcpy(right.node.keys, left.key(split + 1), (key_num - split - 1) * key_length);
+    memcpy(right.node.rids, node.rids + split + 1, (key_num - split) * sizeof(RID));
+    right.node.key_num = key_num - split - 1;
+    node.key_num = split;
+    for (int i = 0; i <= right.node.key_num; i++)
+    {
+      rc = set_parent(right.node.rids[i].page_num, right.page_num());
+      if (rc != SUCCESS)
+      {
+        return rc;
+      }
+    }
   }
 
-  rc = insert_into_parent(parent_page, leaf_page, new_key, new_page); // 插入失败，应该回滚之前的叶子节点
+  const PageNum left_page = left.page_num();
+  const PageNum right_page = right.page_num();
+  const PageNum parent_page = node.parent;
+  rc = left.save();
+  if (rc == SUCCESS)
+  {
+    rc = right.save();
+  }
   if (rc != SUCCESS)
   {
-    free(new_key);
     return rc;
   }
-  free(new_key);
-  return SUCCESS;
+  left.release();
+  right.release();
+  return insert_into_parent(parent_page, left_page, separator.data(), right_page);
 }
 
-RC BplusTreeHandler::insert_intern_node(PageNum parent_page, PageNum left_page, PageNum right_page, const char *pkey)
+RC BplusTreeHandler::insert_into_parent(PageNum parent_page, PageNum left_page, const char *pkey, PageNum right_page)
 {
-  int i, insert_pos;
-  BPPageHandle page_handle;
-  char *pdata;
-  IndexNode *node;
-  RID rid;
-  RC rc;
-
-  rc = disk_buffer_pool_->get_this_page(file_id_, parent_page, &page_handle);
-  if (rc != SUCCESS)
+  if (parent_page == -1)
   {
-    return rc;
+    return insert_into_new_root(left_page, pkey, right_page);
   }
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
+
+  NodeFrame parent(*this);
+  RC rc = parent.get(parent_page);
   if (rc != SUCCESS)
   {
     return rc;
   }
-
-  node = get_index_node(pdata);
-
-  insert_pos = 0;
-  while ((insert_pos <= node->key_num) && (node->rids[insert_pos].page_num != left_page))
-    insert_pos++;
-  for (i = node->key_num; i > insert_pos; i--)
-  {
-    memcpy(node->rids + i + 1, node->rids + i, sizeof(RID));
-    memcpy(node->keys + i * file_header_.key_length, node->keys + (i - 1) * file_header_.key_length, file_header_.key_length);
-  }
-  rid.page_num = right_page;
-  rid.slot_num = BP_INVALID_PAGE_NUM; // change to invalid page num
-  memcpy(node->rids + insert_pos + 1, &rid, sizeof(RID));
-  memcpy(node->keys + insert_pos * file_header_.key_length, pkey, file_header_.key_length);
-  node->key_num++;
-  rc = disk_buffer_pool_->mark_dirty(&page_handle);
-  if (rc != SUCCESS)
+  int insert_pos = 0;
+  while (insert_pos <= parent.node.key_num && parent.node.rids[insert_pos].page_num != left_page)
   {
-    return rc;
+    insert_pos++;
   }
-  rc = disk_buffer_pool_->unpin_page(&page_handle);
-  if (rc != SUCCESS)
+  RID child;
+  child.page_num = right_page;
+  child.slot_num = BP_INVALID_PAGE_NUM;
+  parent.insert(insert_pos, pkey, child);
+  if (node_fits(parent.node))
   {
-    return rc;
+    return parent.save();
   }
-  return SUCCESS;
+  return split_node(parent, false);
 }
 
-RC BplusTreeHandler::insert_intern_node_after_split(PageNum inter_page, PageNum left_page, PageNum right_page, const char *pkey)
+RC BplusTreeHandler::insert_into_new_root(PageNum left_page, const char *pkey, PageNum right_page)
 {
-  RC rc;
-  BPPageHandle page_handle1, page_handle2, child_page_handle;
-  IndexNode *inter_node, *new_node, *child_node;
-  PageNum new_page, child_page, parent_page;
-  RID *temp_pointers, tmprid;
-  char *temp_keys, *new_key;
-  char *pdata;
-  int insert_pos, i, j, split;
-  rc = disk_buffer_pool_->get_this_page(file_id_, inter_page, &page_handle1);
+  NodeFrame root(*this);
+  RC rc = root.allocate(false, -1);
   if (rc != SUCCESS)
   {
     return rc;
   }
-  rc = disk_buffer_pool_->get_data(&page_handle1, &pdata);
+  root.node.rids[0].page_num = left_page;
+  RID child;
+  child.page_num = right_page;
+  child.slot_num = -1;
+  root.insert(0, pkey, child);
+  rc = root.save();
   if (rc != SUCCESS)
   {
     return rc;
   }
-
-  inter_node = get_index_node(pdata);
-
-  // add a new node
-  rc = disk_buffer_pool_->allocate_page(file_id_, &page_handle2);
+  const PageNum root_page = root.page_num();
+  rc = root.release();
   if (rc != SUCCESS)
   {
     return rc;
   }
-  rc = disk_buffer_pool_->get_data(&page_handle2, &pdata);
+
+  rc = set_parent(left_page, root_page);
   if (rc != SUCCESS)
   {
     return rc;
   }
-  rc = disk_buffer_pool_->get_page_num(&page_handle2, &new_page);
+  rc = set_parent(right_page, root_page);
   if (rc != SUCCESS)
   {
     return rc;
   }
+  file_header_.root_page = root_page;
+  header_dirty_ = true;
+  return SUCCESS;
+}
 
-  new_node = get_index_node(pdata);
-  new_node->key_num = 0;
-  new_node->is_leaf = false;
-  new_node->parent = inter_node->parent;
-
-  parent_page = inter_node->parent;
-
-  // print();
-
-  temp_keys = (char *)malloc(file_header_.key_length * file_header_.order);
-  if (temp_keys == nullptr)
+RC BplusTreeHandler::insert_entry(const char *pkey, const RID *rid, bool unique)
+{
+  if (nullptr == disk_buffer_pool_)
   {
-    LOG_ERROR("Failed to alloc memory for temp keys. size=%d",
-              file_header_.key_length * file_header_.order);
-    return RC::NOMEM;
+    return RC::RECORD_CLOSED;
   }
+  std::vector<char> key(file_header_.key_length);
+  memcpy(key.data(), pkey, file_header_.attr_length);
+  memcpy(key.data() + file_header_.attr_length, rid, sizeof(*rid));
 
-  temp_pointers = (RID *)malloc((file_header_.order + 1) * sizeof(RID));
-  if (temp_pointers == nullptr)
+  if (unique)
   {
-    LOG_ERROR("Failed to alloc memory for temp pointers. size=%ld",
-              (file_header_.order + 1) * sizeof(RID));
-    free(temp_keys);
-    return RC::NOMEM;
-  }
-
-  new_key = (char *)malloc(file_header_.key_length);
-  if (new_key == nullptr)
-  {
-    LOG_ERROR("Failed to alloc memory for new key. size=%d", file_header_.key_length);
-    free(temp_keys);
-    free(temp_pointers);
-    return RC::NOMEM;
-  }
-
-  insert_pos = 0;
-  while ((insert_pos <= inter_node->key_num) && (inter_node->rids[insert_pos].page_num != left_page))
-    insert_pos++;
-  for (i = 0, j = 0; i < inter_node->key_num + 1; i++, j++)
-  {
-    if (j == insert_pos + 1)
-      j++;
-    memcpy(temp_pointers + j, inter_node->rids + i, sizeof(RID));
-  }
-  for (i = 0, j = 0; i < inter_node->key_num; i++, j++)
-  {
-    if (j == insert_pos)
-      j++;
-    memcpy(temp_keys + j * file_header_.key_length, inter_node->keys + i * file_header_.key_length, file_header_.key_length);
+    // 唯一性检查要看到缓存中的删除
+    RC rc = merge_change_buffer();
+    if (rc != SUCCESS)
+    {
+      return rc;
+    }
   }
-  tmprid.page_num = right_page;
-  tmprid.slot_num = -1;
-  memcpy(temp_keys + insert_pos * file_header_.key_length, pkey, file_header_.key_length);
-  memcpy(temp_pointers + insert_pos + 1, &tmprid, sizeof(RID));
-
-  split = (file_header_.order + 1) / 2;
-
-  for (i = 0; i < split - 1; i++)
+  else if (bplus_tree_change_buffer() > 0 || change_count_ > 0)
   {
-    memcpy(inter_node->keys + i * file_header_.key_length, temp_keys + i * file_header_.key_length, file_header_.key_length);
-    memcpy(inter_node->rids + i, temp_pointers + i, sizeof(RID));
+    bool buffered = false;
+    RC rc = buffer_change(key.data(), true, &buffered);
+    if (buffered)
+    {
+      return rc;
+    }
   }
-  inter_node->key_num = split - 1;
-  memcpy(inter_node->rids + i, temp_pointers + i, sizeof(RID));
-  memcpy(new_key, temp_keys + i * file_header_.key_length, file_header_.key_length);
 
-  for (++i, j = 0; i < file_header_.order; i++, j++)
   {
-    memcpy(new_node->keys + j * file_header_.key_length, temp_keys + i * file_header_.key_length, file_header_.key_length);
-    memcpy(new_node->rids + j, temp_pointers + i, sizeof(RID));
-    new_node->key_num++;
+    TreeLatchGuard guard(tree_latch_, false);
+    bool done = false;
+    RC rc = insert_entry_optimistic(key.data(), rid, unique, &done);
+    if (done)
+    {
+      return rc;
+    }
   }
-  memcpy(new_node->rids + j, temp_pointers + i, sizeof(RID));
 
-  free(temp_keys);
-  free(temp_pointers);
+  StructureChangeGuard guard(*this);
+  return insert_entry_pessimistic(key.data(), rid, unique);
+}
+RC BplusTreeHandler::insert_entry_optimistic(const char *pkey, const RID *rid, bool unique, bool *done)
+{
+  *done = false;
+  NodeFrame leaf(*this);
+  RC rc;
 
-  for (i = 0; i <= new_node->key_num; i++)
+  // 比最右边叶子的最后一个key大时一定插入到这个叶子的末尾，不用从根节点找
+  PageNum leaf_page = rightmost_leaf_;
+  bool found = false;
+  if (leaf_page > 0)
   {
-    child_page = new_node->rids[i].page_num;
-    rc = disk_buffer_pool_->get_this_page(file_id_, child_page, &child_page_handle);
+    rc = leaf.get_latched(leaf_page, true);
     if (rc != SUCCESS)
     {
-      free(new_key);
+      *done = true;
       return rc;
     }
-    rc = disk_buffer_pool_->get_data(&child_page_handle, &pdata);
+    found = leaf.node.key_num > 0 && compare_key(pkey, leaf.key(leaf.node.key_num - 1)) > 0;
+  }
+
+  if (!found)
+  {
+    leaf.release();
+    rc = find_leaf(pkey, &leaf_page);
     if (rc != SUCCESS)
     {
-      free(new_key);
+      *done = true;
       return rc;
     }
-    child_node = (IndexNode *)(pdata + sizeof(IndexFileHeader));
-    child_node->parent = new_page;
-    rc = disk_buffer_pool_->mark_dirty(&child_page_handle);
+    rc = leaf.get_latched(leaf_page, true);
     if (rc != SUCCESS)
     {
-      free(new_key);
+      *done = true;
       return rc;
     }
-    rc = disk_buffer_pool_->unpin_page(&child_page_handle);
-    if (rc != SUCCESS)
+    if (leaf.node.next <= 0)
     {
-      free(new_key);
-      return rc;
+      rightmost_leaf_ = leaf_page;
     }
   }
 
-  rc = disk_buffer_pool_->mark_dirty(&page_handle1);
-  if (rc != SUCCESS)
-  {
-    free(new_key);
-    return rc;
-  }
-  rc = disk_buffer_pool_->unpin_page(&page_handle1);
-  if (rc != SUCCESS)
+  IndexNode &node = leaf.node;
+  int insert_pos = lower_bound(&node, pkey);
+  // 插入位置在叶子的两端时，相同的属性值可能在相邻的叶子中，交给加写锁的插入检查。
+  // 最右边的叶子后面没有叶子，插入到末尾时只需要和最后一个key比较
+  const bool rightmost = node.next <= 0;
+  if (unique && !(insert_pos > 0 && (insert_pos < node.key_num || rightmost)))
   {
-    free(new_key);
-    return rc;
+    return leaf.release();
   }
-  rc = disk_buffer_pool_->mark_dirty(&page_handle2);
-  if (rc != SUCCESS)
+  if (insert_pos < node.key_num && compare_key(pkey, leaf.key(insert_pos)) == 0)
   {
-    free(new_key);
-    return rc;
+    *done = true;
+    rc = RC::RECORD_DUPLICATE_KEY;
   }
-  rc = disk_buffer_pool_->unpin_page(&page_handle2);
-  if (rc != SUCCESS)
+  else if (unique && (compare_unique_attr(pkey, leaf.key(insert_pos - 1)) == 0 ||
+                      (insert_pos < node.key_num && compare_unique_attr(pkey, leaf.key(insert_pos)) == 0)))
   {
-    free(new_key);
-    return rc;
+    *done = true;
+    rc = RC::RECORD_DUPLICATE_KEY;
   }
-  // print();
-
-  rc = insert_into_parent(parent_page, inter_page, new_key, new_page);
-
-  // print();
-  if (rc != SUCCESS)
+  else
   {
-    free(new_key);
-    return rc;
+    // 编码之后放不下时要分裂，不写回页面
+    leaf.insert(insert_pos, pkey, *rid);
+    if (node_fits(node))
+    {
+      *done = true;
+      rc = leaf.save();
+    }
   }
-  free(new_key);
-  return SUCCESS;
+  leaf.release();
+  return rc;
 }
 
-RC BplusTreeHandler::insert_into_parent(PageNum parent_page, PageNum left_page, const char *pkey, PageNum right_page)
+RC BplusTreeHandler::insert_entry_pessimistic(const char *key, const RID *rid, bool unique)
 {
   RC rc;
-  BPPageHandle page_handle;
-  IndexNode *node;
-  char *pdata;
-  if (parent_page == -1)
-  {
-    return insert_into_new_root(left_page, pkey, right_page);
-  }
-
-  rc = disk_buffer_pool_->get_this_page(file_id_, parent_page, &page_handle);
-  if (rc != SUCCESS)
-  {
-    return rc;
-  }
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
+  PageNum leaf_page;
+  rc = find_leaf(key, &leaf_page);
   if (rc != SUCCESS)
   {
     return rc;
   }
-  node = (IndexNode *)(pdata + sizeof(IndexFileHeader));
-  if (node->key_num < file_header_.order - 1)
-  {
-    rc = disk_buffer_pool_->unpin_page(&page_handle);
-    if (rc != SUCCESS)
-    {
-      return rc;
-    }
-    return insert_intern_node(parent_page, left_page, right_page, pkey);
-  }
-  else
+  if (unique)
   {
-    rc = disk_buffer_pool_->unpin_page(&page_handle);
+    rc = check_unique(leaf_page, key);
     if (rc != SUCCESS)
     {
       return rc;
     }
-    return insert_intern_node_after_split(parent_page, left_page, right_page, pkey);
   }
-}
 
-RC BplusTreeHandler::insert_into_new_root(PageNum left_page, const char *pkey, PageNum right_page)
-{
-  RC rc;
-  BPPageHandle page_handle;
-  IndexNode *root, *left, *right;
-  PageNum root_page;
-  RID rid;
-  char *pdata;
-  rc = disk_buffer_pool_->allocate_page(file_id_, &page_handle);
+  NodeFrame leaf(*this);
+  rc = leaf.get(leaf_page);
   if (rc != SUCCESS)
   {
     return rc;
   }
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-  if (rc != SUCCESS)
+  const int insert_pos = lower_bound(&leaf.node, key);
+  if (insert_pos < leaf.node.key_num && compare_key(key, leaf.key(insert_pos)) == 0)
   {
-    return rc;
+    return RC::RECORD_DUPLICATE_KEY;
   }
-  rc = disk_buffer_pool_->get_page_num(&page_handle, &root_page);
-  if (rc != SUCCESS)
+  const bool append = insert_pos == leaf.node.key_num && leaf.node.next <= 0;
+  leaf.insert(insert_pos, key, *rid);
+  if (node_fits(leaf.node))
   {
-    return rc;
+    return leaf.save();
   }
+  return split_node(leaf, append);
+}
 
-  root = get_index_node(pdata);
-  root->is_leaf = false;
-  root->key_num = 1;
-  root->parent = -1;
-  memcpy(root->keys, pkey, file_header_.key_length);
-  rid.page_num = left_page;
-  rid.slot_num = -1;
-  memcpy(root->rids, &rid, sizeof(RID));
-  rid.page_num = right_page;
-  rid.slot_num = -1;
-  memcpy(root->rids + 1, &rid, sizeof(RID));
-
-  rc = disk_buffer_pool_->mark_dirty(&page_handle);
+RC BplusTreeHandler::find_equal_attr(PageNum page_num, const char *pkey, bool *found, int *pos)
+{
+  NodeFrame frame(*this);
+  RC rc = frame.get(page_num);
   if (rc != SUCCESS)
   {
     return rc;
   }
-  rc = disk_buffer_pool_->unpin_page(&page_handle);
-  if (rc != SUCCESS)
+  const IndexNode &node = frame.node;
+  *pos = lower_bound(&node, pkey);
+  *found = (*pos > 0 && compare_unique_attr(pkey, frame.key(*pos - 1)) == 0) ||
+           (*pos < node.key_num && compare_unique_attr(pkey, frame.key(*pos)) == 0);
+  PageNum next_page = node.next;
+  const bool check_next = !*found && *pos == node.key_num && next_page > 0;
+  if (!check_next)
   {
-    return rc;
+    return frame.release();
   }
 
-  rc = disk_buffer_pool_->get_this_page(file_id_, left_page, &page_handle);
-  if (rc != SUCCESS)
-  {
-    return rc;
-  }
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
+  // pkey比叶子中所有的key都大，后面叶子的第一个key也可能有相同的属性值
+  rc = frame.get(next_page);
   if (rc != SUCCESS)
   {
     return rc;
   }
-  left = (IndexNode *)(pdata + sizeof(IndexFileHeader));
-  left->parent = root_page;
+  *found = frame.node.key_num > 0 && compare_unique_attr(pkey, frame.key(0)) == 0;
+  return frame.release();
+}
 
-  rc = disk_buffer_pool_->mark_dirty(&page_handle);
+RC BplusTreeHandler::check_unique(PageNum leaf_page, const char *pkey)
+{
+  bool found = false;
+  int pos = 0;
+  RC rc = find_equal_attr(leaf_page, pkey, &found, &pos);
   if (rc != SUCCESS)
   {
     return rc;
   }
-  rc = disk_buffer_pool_->unpin_page(&page_handle);
-  if (rc != SUCCESS)
+  if (found)
   {
-    return rc;
+    return RC::RECORD_DUPLICATE_KEY;
   }
-
-  rc = disk_buffer_pool_->get_this_page(file_id_, right_page, &page_handle);
-  if (rc != SUCCESS)
+  if (pos != 0)
   {
-    return rc;
+    return SUCCESS;
   }
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-  if (rc != SUCCESS)
+
+  // pkey比叶子中所有的key都小。删除之后内部节点中的key可能已经不在叶子中了，前面的叶子也可能有相同的属性值，
+  // 用最小的rid重新找到第一个可能有这个属性值的叶子
+  std::vector<char> min_key(pkey, pkey + file_header_.key_length);
+  RID min_rid;
+  min_rid.page_num = -1;
+  min_rid.slot_num = -1;
+  memcpy(min_key.data() + file_header_.attr_length, &min_rid, sizeof(min_rid));
+  if (unique_column_num_ > 0)
   {
-    return rc;
+    fill_key_columns(min_key.data(), unique_column_num_, false);
   }
-  right = (IndexNode *)(pdata + sizeof(IndexFileHeader));
-  right->parent = root_page;
-
-  rc = disk_buffer_pool_->mark_dirty(&page_handle);
-  if (rc != SUCCESS)
+  PageNum first_page;
+  rc = find_leaf(min_key.data(), &first_page);
+  if (rc != SUCCESS || first_page == leaf_page)
   {
     return rc;
   }
-  rc = disk_buffer_pool_->unpin_page(&page_handle);
+  rc = find_equal_attr(first_page, min_key.data(), &found, &pos);
   if (rc != SUCCESS)
   {
     return rc;
   }
-  file_header_.root_page = root_page;
-  header_dirty_ = true;
-  return SUCCESS;
+  return found ? RC::RECORD_DUPLICATE_KEY : SUCCESS;
 }
-
-RC BplusTreeHandler::insert_entry(const char *pkey, const RID *rid)
+RC BplusTreeHandler::get_entry(const char *pkey, RID *rid)
 {
   RC rc;
   PageNum leaf_page;
-  BPPageHandle page_handle;
-  char *pdata, *key;
-  IndexNode *leaf;
-  if (nullptr == disk_buffer_pool_)
-  {
-    return RC::RECORD_CLOSED;
-  }
-  key = (char *)malloc(file_header_.key_length);
-  if (key == nullptr)
-  {
-    LOG_ERROR("Failed to alloc memory for key. size=%d", file_header_.key_length);
-    return RC::NOMEM;
-  }
-  memcpy(key, pkey, file_header_.attr_length);
-  memcpy(key + file_header_.attr_length, rid, sizeof(*rid));
-  rc = find_leaf(key, &leaf_page);
+  std::vector<char> key(file_header_.key_length);
+  memcpy(key.data(), pkey, file_header_.attr_length);
+  memcpy(key.data() + file_header_.attr_length, rid, sizeof(RID));
+
+  rc = merge_change_buffer();
   if (rc != SUCCESS)
   {
-    free(key);
     return rc;
   }
-
-  rc = disk_buffer_pool_->get_this_page(file_id_, leaf_page, &page_handle);
+  TreeLatchGuard guard(tree_latch_, false);
+  rc = find_leaf(key.data(), &leaf_page);
   if (rc != SUCCESS)
   {
-    free(key);
     return rc;
   }
 
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
+  NodeFrame leaf(*this);
+  rc = leaf.get_latched(leaf_page, false);
   if (rc != SUCCESS)
   {
-    free(key);
     return rc;
   }
-  leaf = (IndexNode *)(pdata + sizeof(IndexFileHeader));
-
-  if (leaf->key_num < file_header_.order - 1)
+  int i = lower_bound(&leaf.node, key.data());
+  if (i < leaf.node.key_num && compare_key(key.data(), leaf.key(i)) == 0)
   {
-    rc = disk_buffer_pool_->unpin_page(&page_handle);
-    if (rc != SUCCESS)
-    {
-      free(key);
-      return rc;
-    }
-    rc = insert_into_leaf(leaf_page, key, rid);
-    if (rc != SUCCESS)
-    {
-      free(key);
-      return rc;
-    }
-    free(key);
-    // return SUCCESS;
+    memcpy(rid, leaf.node.rids + i, sizeof(RID));
+    rc = SUCCESS;
   }
   else
   {
-    rc = disk_buffer_pool_->unpin_page(&page_handle);
-    if (rc != SUCCESS)
-    {
-      free(key);
-      return rc;
-    }
-    // print();
-    rc = insert_into_leaf_after_split(leaf_page, key, rid);
-    free(key);
+    rc = RC::RECORD_INVALID_KEY;
   }
-  // print();
-  return SUCCESS;
+  leaf.release();
+  return rc;
 }
 
-RC BplusTreeHandler::get_entry(const char *pkey, RID *rid)
+RC BplusTreeHandler::delete_entry_internal(PageNum page_num, const char *pkey)
 {
-  RC rc;
-  PageNum leaf_page;
-  BPPageHandle page_handle;
-  int i;
-  char *pdata, *key;
-  IndexNode *leaf;
-
-  key = (char *)malloc(file_header_.key_length);
-  if (key == nullptr)
-  {
-    LOG_ERROR("Failed to alloc memory for key. size=%d", file_header_.key_length);
-    return RC::NOMEM;
-  }
-  memcpy(key, pkey, file_header_.attr_length);
-  memcpy(key + file_header_.attr_length, rid, sizeof(RID));
-
-  rc = find_leaf(key, &leaf_page);
+  const int key_length = file_header_.key_length;
+  NodeFrame frame(*this);
+  RC rc = frame.get(page_num);
   if (rc != SUCCESS)
   {
-    free(key);
     return rc;
   }
-
-  rc = disk_buffer_pool_->get_this_page(file_id_, leaf_page, &page_handle);
-  if (rc != SUCCESS)
-  {
-    free(key);
-    return rc;
-  }
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-  if (rc != SUCCESS)
+  IndexNode &node = frame.node;
+  int delete_index = lower_bound(&node, pkey);
+  if (delete_index >= node.key_num || compare_key(pkey, frame.key(delete_index)) != 0)
   {
-    free(key);
-    return rc;
+    return RC::RECORD_INVALID_KEY;
   }
+  frame.remove(delete_index);
 
-  leaf = get_index_node(pdata);
-  for (i = 0; i < leaf->key_num; i++)
+  if (node.parent == -1)
   {
-    if (CmpKey(file_header_.attr_type, file_header_.attr_length, key, leaf->keys + (i * file_header_.key_length)) == 0)
+    if (node.key_num == 0 && !node.is_leaf)
     {
-      memcpy(rid, leaf->rids + i, sizeof(RID));
-      free(key);
-      return SUCCESS;
+      // 根节点只剩一个孩子，孩子成为新的根
+      const PageNum child_page = node.rids[0].page_num;
+      rc = frame.release();
+      if (rc != SUCCESS)
+      {
+        return rc;
+      }
+      rc = set_parent(child_page, -1);
+      if (rc != SUCCESS)
+      {
+        return rc;
+      }
+      file_header_.root_page = child_page;
+      header_dirty_ = true;
+      return disk_buffer_pool_->dispose_page(file_id_, page_num);
     }
+    return frame.save();
   }
-  free(key);
-  return RC::RECORD_INVALID_KEY;
-}
-
-RC BplusTreeHandler::delete_entry_from_node(PageNum node_page, const char *pkey)
-{
-  BPPageHandle page_handle;
-  IndexNode *node;
-  char *pdata;
-  int delete_index, i, tmp;
-  RC rc;
 
-  rc = disk_buffer_pool_->get_this_page(file_id_, node_page, &page_handle);
-  if (rc != SUCCESS)
+  rc = frame.save();
+  if (rc != SUCCESS || !node_underflow(node))
   {
     return rc;
   }
-
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
+  const bool is_leaf = node.is_leaf != 0;
+  const PageNum parent_page = node.parent;
+  NodeFrame parent(*this);
+  rc = parent.get(parent_page);
   if (rc != SUCCESS)
   {
     return rc;
   }
-
-  node = get_index_node(pdata);
-
-  for (delete_index = 0; delete_index < node->key_num; delete_index++)
-  {
-    tmp = CmpKey(file_header_.attr_type, file_header_.attr_length, pkey, node->keys + delete_index * file_header_.key_length);
-    if (tmp == 0)
-      break;
-  }
-  if (delete_index >= node->key_num)
+  if (parent.node.key_num == 0)
   {
-    return RC::RECORD_INVALID_KEY;
+    // 父节点只有这一个孩子，没有兄弟可以合并
+    return SUCCESS;
   }
-  i = delete_index;
-  while (i < (node->key_num - 1))
+  int index = 0;
+  while (index <= parent.node.key_num && parent.node.rids[index].page_num != page_num)
   {
-    memcpy(node->keys + i * file_header_.key_length, node->keys + (i + 1) * file_header_.key_length, file_header_.key_length);
-    i++;
+    index++;
   }
-
-  if (node->is_leaf)
-    for (i = delete_index; i < (node->key_num - 1); i++)
-      memcpy(node->rids + i, node->rids + i + 1, sizeof(RID));
-  else
-    for (i = delete_index + 1; i < node->key_num; i++)
-      memcpy(node->rids + i, node->rids + i + 1, sizeof(RID));
-  node->key_num--;
-
-  rc = disk_buffer_pool_->mark_dirty(&page_handle);
-  if (rc != SUCCESS)
+  // 第一个孩子和右边的兄弟合并，其它的和左边的兄弟合并
+  const int left_index = index == 0 ? 0 : index - 1;
+  const PageNum left_page = parent.node.rids[left_index].page_num;
+  const PageNum right_page = parent.node.rids[left_index + 1].page_num;
+  NodeFrame left(*this);
+  NodeFrame right(*this);
+  rc = left.get(left_page);
+  if (rc == SUCCESS)
   {
-    return rc;
+    rc = right.get(right_page);
   }
-  rc = disk_buffer_pool_->unpin_page(&page_handle);
   if (rc != SUCCESS)
   {
     return rc;
   }
 
-  return SUCCESS;
-}
-
-RC BplusTreeHandler::coalesce_node(PageNum leaf_page, PageNum right_page)
-{
-  BPPageHandle left_handle, right_handle, parent_handle, tmphandle;
-  IndexNode *left, *right, *parent, *node;
-  char *pdata, *tmp_key;
-  PageNum parent_page;
-  RC rc;
-  int i, j, k, start;
-
-  rc = disk_buffer_pool_->get_this_page(file_id_, leaf_page, &left_handle);
-  if (rc != SUCCESS)
+  // 合并之后能放进一个节点，并且兄弟也不到半满时才合并，否则重新分配。
+  // 延迟合并时叶子已经很空了，能放进一个叶子就合并
+  std::vector<char> merged(left.node.keys, left.node.keys + left.node.key_num * key_length);
+  if (!is_leaf)
   {
-    return rc;
+    merged.insert(merged.end(), parent.key(left_index), parent.key(left_index) + key_length);
   }
-  rc = disk_buffer_pool_->get_data(&left_handle, &pdata);
-  if (rc != SUCCESS)
+  merged.insert(merged.end(), right.node.keys, right.node.keys + right.node.key_num * key_length);
+  const int capacity = node_capacity();
+  const bool merged_fits = packed_size(is_leaf, merged.data(), (int)(merged.size() / key_length)) <= capacity;
+  const IndexNode &sibling = index == 0 ? right.node : left.node;
+  const bool lazy_leaf = is_leaf && bplus_tree_merge_threshold() < 50;
+  const bool sibling_full = packed_size(is_leaf, sibling.keys, sibling.key_num) * 2 > capacity;
+  parent.release();
+  left.release();
+  right.release();
+  frame.release();
+  if (merged_fits && (lazy_leaf || !sibling_full))
   {
-    return rc;
+    return coalesce_node(left_page, right_page);
   }
+  return redistribute_nodes(left_page, right_page);
+}
 
-  left = get_index_node(pdata);
-
-  rc = disk_buffer_pool_->get_this_page(file_id_, right_page, &right_handle);
-  if (rc != SUCCESS)
+RC BplusTreeHandler::coalesce_node(PageNum left_page, PageNum right_page)
+{
+  const int key_length = file_header_.key_length;
+  NodeFrame left(*this);
+  NodeFrame right(*this);
+  NodeFrame parent(*this);
+  RC rc = left.get(left_page);
+  if (rc == SUCCESS)
   {
-    return rc;
+    rc = right.get(right_page);
   }
-
-  rc = disk_buffer_pool_->get_data(&right_handle, &pdata);
-  if (rc != SUCCESS)
+  if (rc == SUCCESS)
   {
-    return rc;
+    rc = parent.get(left.node.parent);
   }
-
-  right = get_index_node(pdata);
-
-  parent_page = left->parent;
-  rc = disk_buffer_pool_->get_this_page(file_id_, parent_page, &parent_handle);
   if (rc != SUCCESS)
   {
     return rc;
   }
 
-  rc = disk_buffer_pool_->get_data(&parent_handle, &pdata);
-  if (rc != SUCCESS)
+  int k = 0;
+  while (k < parent.node.key_num && parent.node.rids[k].page_num != left_page)
   {
-    return rc;
+    k++;
   }
+  const PageNum parent_page = parent.page_num();
+  std::vector<char> parent_key(parent.key(k), parent.key(k) + key_length);
+  parent.release();
 
-  parent = get_index_node(pdata);
-
-  for (k = 0; k < parent->key_num; k++)
-    if ((parent->rids[k].page_num) == leaf_page)
-      break;
-
-  start = left->key_num;
-  if (left->is_leaf == false)
+  if (left.node.is_leaf)
   {
-    memcpy(left->keys + start * file_header_.key_length, parent->keys + k * file_header_.key_length, file_header_.key_length);
-    start++;
-    left->key_num++;
-  }
-  for (i = start, j = 0; j < right->key_num; i++, j++)
-  {
-    memcpy(left->keys + i * file_header_.key_length, right->keys + j * file_header_.key_length, file_header_.key_length);
-    memcpy(left->rids + i, right->rids + j, sizeof(RID));
-    left->key_num++;
+    for (int j = 0; j < right.node.key_num; j++)
+    {
+      left.insert(left.node.key_num, right.key(j), right.node.rids[j]);
+    }
+    left.node.next = right.node.next;
   }
-
-  if (left->is_leaf)
-    memcpy(left->rids + file_header_.order - 1, right->rids + file_header_.order - 1, sizeof(RID));
   else
   {
-    memcpy(left->rids + i, right->rids + j, sizeof(RID));
-
-    for (i = start; i <= left->key_num; i++)
+    // 父节点中的key下移到两个节点之间，右边节点的孩子都移到左边
+    left.insert(left.node.key_num, parent_key.data(), right.node.rids[0]);
+    for (int j = 0; j < right.node.key_num; j++)
     {
-      rc = disk_buffer_pool_->get_this_page(file_id_, left->rids[i].page_num, &tmphandle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->get_data(&tmphandle, &pdata);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      node = (IndexNode *)(pdata + sizeof(IndexFileHeader));
-      node->parent = leaf_page;
-
-      rc = disk_buffer_pool_->mark_dirty(&tmphandle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->unpin_page(&tmphandle);
+      left.insert(left.node.key_num, right.key(j), right.node.rids[j + 1]);
+    }
+    for (int j = 0; j <= right.node.key_num; j++)
+    {
+      rc = set_parent(right.node.rids[j].page_num, left_page);
       if (rc != SUCCESS)
       {
         return rc;
@@ -1211,1147 +1838,1199 @@ RC BplusTreeHandler::coalesce_node(PageNum leaf_page, PageNum right_page)
     }
   }
 
-  tmp_key = (char *)malloc(file_header_.key_length);
-  if (tmp_key == nullptr)
-  {
-    LOG_ERROR("Failed to alloc memory for key. size=%d", file_header_.key_length);
-    return RC::NOMEM;
-  }
-  memcpy(tmp_key, parent->keys + k * file_header_.key_length, file_header_.key_length);
-
-  rc = disk_buffer_pool_->mark_dirty(&left_handle);
+  rc = left.save();
   if (rc != SUCCESS)
   {
-    free(tmp_key);
     return rc;
   }
-  rc = disk_buffer_pool_->unpin_page(&left_handle);
+  left.release();
+  right.release();
+  rc = disk_buffer_pool_->dispose_page(file_id_, right_page);
   if (rc != SUCCESS)
   {
-    free(tmp_key);
     return rc;
   }
-  rc = disk_buffer_pool_->unpin_page(&right_handle);
-  if (rc != SUCCESS)
+  return delete_entry_internal(parent_page, parent_key.data());
+}
+
+RC BplusTreeHandler::redistribute_nodes(PageNum left_page, PageNum right_page)
+{
+  const int key_length = file_header_.key_length;
+  NodeFrame left(*this);
+  NodeFrame right(*this);
+  NodeFrame parent(*this);
+  RC rc = left.get(left_page);
+  if (rc == SUCCESS)
   {
-    free(tmp_key);
-    return rc;
+    rc = right.get(right_page);
   }
-  rc = disk_buffer_pool_->dispose_page(file_id_, right_page);
-  if (rc != SUCCESS)
+  if (rc == SUCCESS)
   {
-    free(tmp_key);
-    return rc;
+    rc = parent.get(left.node.parent);
   }
-
-  rc = disk_buffer_pool_->unpin_page(&parent_handle);
   if (rc != SUCCESS)
   {
-    free(tmp_key);
     return rc;
   }
 
-  rc = delete_entry_internal(parent_page, tmp_key);
-  if (rc != SUCCESS)
+  int k = 0;
+  while (k < parent.node.key_num && parent.node.rids[k].page_num != left_page)
   {
-    free(tmp_key);
-    return rc;
+    k++;
   }
-  free(tmp_key);
-  return SUCCESS;
-}
-
-RC BplusTreeHandler::redistribute_nodes(PageNum leaf_page, PageNum right_page)
-{
-  BPPageHandle left_handle, right_handle, parent_handle, tmphandle;
-  IndexNode *left, *right, *parent, *node;
-  char *pdata;
-  PageNum parent_page;
-  RC rc;
-  int min_key, i, k;
 
-  rc = disk_buffer_pool_->get_this_page(file_id_, leaf_page, &left_handle);
-  if (rc != SUCCESS)
+  // 把两个节点的key连在一起重新分开，内部节点中间还有父节点中的key
+  const bool is_leaf = left.node.is_leaf != 0;
+  const int left_num = left.node.key_num;
+  std::vector<char> keys(left.node.keys, left.node.keys + left_num * key_length);
+  std::vector<RID> rids(left.node.rids, left.node.rids + (is_leaf ? left_num : left_num + 1));
+  if (!is_leaf)
   {
-    return rc;
+    keys.insert(keys.end(), parent.key(k), parent.key(k) + key_length);
   }
-  rc = disk_buffer_pool_->get_data(&left_handle, &pdata);
-  if (rc != SUCCESS)
+  keys.insert(keys.end(), right.node.keys, right.node.keys + right.node.key_num * key_length);
+  rids.insert(rids.end(), right.node.rids, right.node.rids + (is_leaf ? right.node.key_num : right.node.key_num + 1));
+  IndexNode all = left.node;
+  all.key_num = (int)(keys.size() / key_length);
+  all.keys = keys.data();
+  all.rids = rids.data();
+  const int split = choose_split(all, all.key_num / 2);
+  if (split < 0)
   {
-    return rc;
+    return SUCCESS;
   }
 
-  left = get_index_node(pdata);
-
-  rc = disk_buffer_pool_->get_this_page(file_id_, right_page, &right_handle);
-  if (rc != SUCCESS)
+  std::vector<char> separator(key_length);
+  if (is_leaf)
   {
-    return rc;
+    make_separator(all.keys + (split - 1) * key_length, all.keys + split * key_length, separator.data());
   }
-  rc = disk_buffer_pool_->get_data(&right_handle, &pdata);
-  if (rc != SUCCESS)
+  else
   {
-    return rc;
+    memcpy(separator.data(), all.keys + split * key_length, key_length);
+  }
+  memcpy(parent.key(k), separator.data(), key_length);
+  if (!node_fits(parent.node))
+  {
+    // 新的分隔key更长，父节点放不下，保持原样。节点只是空一些，查找不受影响
+    return SUCCESS;
   }
 
-  right = get_index_node(pdata);
+  const int moved = is_leaf ? 0 : 1;
+  const int right_num = all.key_num - split - moved;
+  left.reserve(split);
+  memcpy(left.node.keys, all.keys, split * key_length);
+  memcpy(left.node.rids, all.rids, (is_leaf ? split : split + 1) * sizeof(RID));
+  left.node.key_num = split;
+  right.reserve(right_num);
+  memcpy(right.node.keys, all.keys + (split + moved) * key_length, right_num * key_length);
+  memcpy(right.node.rids, all.rids + split + moved, (is_leaf ? right_num : right_num + 1) * sizeof(RID));
+  right.node.key_num = right_num;
+  if (!is_leaf)
+  {
+    // 孩子0到left_num原来在左边，只修改换了节点的孩子
+    for (int i = 0; i < (int)rids.size(); i++)
+    {
+      const bool now_left = i <= split;
+      const bool was_left = i <= left_num;
+      if (now_left != was_left)
+      {
+        rc = set_parent(rids[i].page_num, now_left ? left_page : right_page);
+        if (rc != SUCCESS)
+        {
+          return rc;
+        }
+      }
+    }
+  }
 
-  parent_page = left->parent;
-  rc = disk_buffer_pool_->get_this_page(file_id_, parent_page, &parent_handle);
-  if (rc != SUCCESS)
+  rc = left.save();
+  if (rc == SUCCESS)
   {
-    return rc;
+    rc = right.save();
   }
-  rc = disk_buffer_pool_->get_data(&parent_handle, &pdata);
-  if (rc != SUCCESS)
+  if (rc == SUCCESS)
   {
-    return rc;
+    rc = parent.save();
   }
+  return rc;
+}
 
-  parent = get_index_node(pdata);
-
-  for (k = 0; k < parent->key_num; k++)
-    if (parent->rids[k].page_num == leaf_page)
-      break;
-  if (left->is_leaf)
+RC BplusTreeHandler::buffer_change(const char *pkey, bool insert, bool *buffered)
+{
+  *buffered = false;
+  const std::string key(pkey, file_header_.key_length);
+  bool full = false;
   {
-    min_key = file_header_.order / 2;
-    if (left->key_num < min_key)
+    TreeLatchGuard guard(tree_latch_, false);
+    PageNum leaf_page;
+    RC rc = find_leaf(pkey, &leaf_page);
+    if (rc != SUCCESS)
     {
-      memcpy(left->keys + left->key_num * file_header_.key_length, right->keys, file_header_.key_length);
-      memcpy(left->rids + left->key_num, right->rids, sizeof(RID));
-      left->key_num++;
+      *buffered = true;
+      return rc;
+    }
+    const bool resident = disk_buffer_pool_->is_page_resident(file_id_, leaf_page);
 
-      for (i = 0; i < right->key_num - 1; i++)
+    std::lock_guard<std::mutex> lock(change_mutex_);
+    auto iter = changes_.find(key);
+    if (iter != changes_.end())
+    {
+      // 缓存的插入被删除，或者缓存的删除又插入回来，两次修改抵消
+      *buffered = true;
+      if (iter->second == insert)
       {
-        memcpy(right->keys + i * file_header_.key_length, right->keys + (i + 1) * file_header_.key_length, file_header_.key_length);
-        memcpy(right->rids + i, right->rids + i + 1, sizeof(RID));
+        return insert ? RC::RECORD_DUPLICATE_KEY : RC::RECORD_INVALID_KEY;
       }
-      right->key_num--;
-      memcpy(parent->keys + k * file_header_.key_length, right->keys, file_header_.key_length);
+      changes_.erase(iter);
+      change_count_ = changes_.size();
+      return SUCCESS;
     }
-    else
+    if (resident || bplus_tree_change_buffer() <= 0)
     {
-      for (i = right->key_num; i > 0; i--)
-      {
-        memcpy(right->keys + i * file_header_.key_length, right->keys + (i - 1) * file_header_.key_length, file_header_.key_length);
-        memcpy(right->rids + i, right->rids + i - 1, sizeof(RID));
-      }
-      memcpy(right->keys, left->keys + (left->key_num - 1) * file_header_.key_length, file_header_.key_length);
-
-      left->key_num--;
-      right->key_num++;
-      memcpy(parent->keys + k * file_header_.key_length, right->keys, file_header_.key_length);
+      return SUCCESS;
     }
+    changes_.emplace(key, insert);
+    change_count_ = changes_.size();
+    *buffered = true;
+    full = changes_.size() >= (size_t)bplus_tree_change_buffer();
   }
-  else
-  {
-    min_key = (file_header_.order + 1) / 2 - 1;
-    if (left->key_num < min_key)
-    {
-      memcpy(left->keys + left->key_num * file_header_.key_length, parent->keys + k * file_header_.key_length, file_header_.key_length);
-      memcpy(left->rids + left->key_num + 1, right->rids, sizeof(RID));
-      left->key_num++;
+  return full ? merge_change_buffer() : SUCCESS;
+}
 
-      memcpy(parent->keys + k * file_header_.key_length, right->keys, file_header_.key_length);
-      for (i = 0; i < right->key_num - 1; i++)
-      {
-        memcpy(right->keys + i * file_header_.key_length, right->keys + (i + 1) * file_header_.key_length, file_header_.key_length);
-        memcpy(right->rids + i, right->rids + i + 1, sizeof(RID));
-      }
-      right->key_num--;
+RC BplusTreeHandler::merge_change_buffer()
+{
+  if (change_count_ == 0)
+  {
+    return SUCCESS;
+  }
+  StructureChangeGuard guard(*this);
+  std::map<std::string, bool, ChangeKeyLess> changes(ChangeKeyLess{this});
+  {
+    std::lock_guard<std::mutex> lock(change_mutex_);
+    changes.swap(changes_);
+    change_count_ = 0;
+  }
 
-      rc = disk_buffer_pool_->get_this_page(file_id_, left->rids[left->key_num].page_num, &tmphandle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->get_data(&tmphandle, &pdata);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      node = (IndexNode *)(pdata + sizeof(IndexFileHeader));
-      node->parent = leaf_page;
-      rc = disk_buffer_pool_->mark_dirty(&tmphandle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->unpin_page(&tmphandle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
+  // 按key的顺序修改，同一个叶子上的修改连在一起，只读一次
+  for (const auto &change : changes)
+  {
+    const char *key = change.first.data();
+    RC rc;
+    if (change.second)
+    {
+      RID rid;
+      memcpy(&rid, key + file_header_.attr_length, sizeof(rid));
+      rc = insert_entry_pessimistic(key, &rid, false);
     }
     else
     {
-      for (i = right->key_num; i > 0; i--)
+      PageNum leaf_page;
+      rc = find_leaf(key, &leaf_page);
+      if (rc == SUCCESS)
       {
-        memcpy(right->keys + i * file_header_.key_length, right->keys + (i - 1) * file_header_.key_length, file_header_.key_length);
-        memcpy(right->rids + i, right->rids + i - 1, sizeof(RID));
-      }
-      memcpy(right->keys, parent->keys + k * file_header_.key_length, file_header_.key_length);
-      memcpy(right->rids, left->rids + left->key_num, sizeof(RID));
-
-      right->key_num++;
-      memcpy(parent->keys + k * file_header_.key_length, left->keys + (left->key_num - 1) * file_header_.key_length, file_header_.key_length);
-      left->key_num--;
-
-      rc = disk_buffer_pool_->get_this_page(file_id_, right->rids[0].page_num, &tmphandle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->get_data(&tmphandle, &pdata);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      node = get_index_node(pdata);
-      node->parent = right_page;
-      rc = disk_buffer_pool_->mark_dirty(&tmphandle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->unpin_page(&tmphandle);
-      if (rc != SUCCESS)
-      {
-        return rc;
+        rc = delete_entry_internal(leaf_page, key);
       }
     }
+    if (rc == RC::RECORD_DUPLICATE_KEY || rc == RC::RECORD_INVALID_KEY)
+    {
+      // 缓存时没有读叶子，重复插入或者删除不存在的key到这里才发现
+      LOG_WARN("Skip buffered %s of index file %d. rc=%d:%s",
+               change.second ? "insert" : "delete", file_id_, rc, strrc(rc));
+    }
+    else if (rc != SUCCESS)
+    {
+      LOG_ERROR("Failed to merge buffered %s of index file %d. rc=%d:%s",
+                change.second ? "insert" : "delete", file_id_, rc, strrc(rc));
+      return rc;
+    }
   }
-  rc = disk_buffer_pool_->mark_dirty(&left_handle);
-  if (rc != SUCCESS)
-  {
-    return rc;
-  }
-  rc = disk_buffer_pool_->unpin_page(&left_handle);
-  if (rc != SUCCESS)
-  {
-    return rc;
-  }
+  return SUCCESS;
+}
 
-  rc = disk_buffer_pool_->mark_dirty(&right_handle);
-  if (rc != SUCCESS)
+size_t BplusTreeHandler::buffered_changes() const
+{
+  return change_count_;
+}
+
+RC BplusTreeHandler::delete_entry(const char *data, const RID *rid)
+{
+  if (nullptr == disk_buffer_pool_)
   {
-    return rc;
+    return RC::RECORD_CLOSED;
   }
+  std::vector<char> key(file_header_.key_length);
+  memcpy(key.data(), data, file_header_.attr_length);
+  memcpy(key.data() + file_header_.attr_length, rid, sizeof(*rid));
 
-  rc = disk_buffer_pool_->unpin_page(&right_handle);
-  if (rc != SUCCESS)
+  if (bplus_tree_change_buffer() > 0 || change_count_ > 0)
   {
-    return rc;
+    bool buffered = false;
+    RC rc = buffer_change(key.data(), false, &buffered);
+    if (buffered)
+    {
+      return rc;
+    }
   }
 
-  rc = disk_buffer_pool_->mark_dirty(&parent_handle);
-  if (rc != SUCCESS)
   {
-    return rc;
+    TreeLatchGuard guard(tree_latch_, false);
+    bool done = false;
+    RC rc = delete_entry_optimistic(key.data(), &done);
+    if (done)
+    {
+      return rc;
+    }
   }
-  rc = disk_buffer_pool_->unpin_page(&parent_handle);
+
+  StructureChangeGuard guard(*this);
+  PageNum leaf_page;
+  RC rc = find_leaf(key.data(), &leaf_page);
   if (rc != SUCCESS)
   {
     return rc;
   }
-  return SUCCESS;
+  return delete_entry_internal(leaf_page, key.data());
 }
-
-RC BplusTreeHandler::delete_entry_internal(PageNum page_num, const char *pkey)
+RC BplusTreeHandler::delete_entry_optimistic(const char *pkey, bool *done)
 {
-  BPPageHandle parent_handle, page_handle, left_handle, right_handle, tmphandle;
-  IndexNode *node, *parent, *left, *right, *tmpnode;
-  PageNum leaf_page, right_page;
-  char *pdata;
-  RC rc;
-  int delete_index, min_key;
-
-  rc = delete_entry_from_node(page_num, pkey);
+  *done = false;
+  PageNum leaf_page;
+  RC rc = find_leaf(pkey, &leaf_page);
   if (rc != SUCCESS)
   {
+    *done = true;
     return rc;
   }
 
-  rc = disk_buffer_pool_->get_this_page(file_id_, page_num, &page_handle);
+  NodeFrame leaf(*this);
+  rc = leaf.get_latched(leaf_page, true);
   if (rc != SUCCESS)
   {
+    *done = true;
     return rc;
   }
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-  if (rc != SUCCESS)
+  IndexNode &node = leaf.node;
+  int delete_pos = lower_bound(&node, pkey);
+  if (delete_pos >= node.key_num || compare_key(pkey, leaf.key(delete_pos)) != 0)
   {
-    return rc;
+    *done = true;
+    rc = RC::RECORD_INVALID_KEY;
   }
-  node = get_index_node(pdata);
-
-  if (node->parent == -1)
+  else
   {
-    if (node->key_num == 0 && node->is_leaf == false)
+    // 删除之后占用的空间不少于合并的阈值，不需要合并。内部节点中的key不用修改
+    leaf.remove(delete_pos);
+    if (node.parent == -1 || !node_underflow(node))
     {
-      rc = disk_buffer_pool_->get_this_page(file_id_, node->rids[0].page_num, &tmphandle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->get_data(&tmphandle, &pdata);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      tmpnode = (IndexNode *)(pdata + sizeof(IndexFileHeader));
-      tmpnode->parent = -1;
-      rc = disk_buffer_pool_->mark_dirty(&tmphandle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->unpin_page(&tmphandle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-
-      file_header_.root_page = node->rids[0].page_num;
-      header_dirty_ = true;
-
-      rc = disk_buffer_pool_->unpin_page(&page_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->dispose_page(file_id_, page_num);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      return SUCCESS;
+      *done = true;
+      rc = leaf.save();
     }
+  }
+  leaf.release();
+  return rc;
+}
 
-    rc = disk_buffer_pool_->unpin_page(&page_handle);
+RC BplusTreeHandler::print_tree()
+{
+  NodeFrame frame(*this);
+  RC rc = frame.get(file_header_.root_page);
+  if (rc != SUCCESS)
+  {
+    return rc;
+  }
+  while (!frame.node.is_leaf)
+  {
+    PageNum page_num = frame.node.rids[0].page_num;
+    rc = frame.get(page_num);
     if (rc != SUCCESS)
     {
       return rc;
     }
-    return SUCCESS;
   }
-
-  if (node->is_leaf)
-    min_key = file_header_.order / 2;
-  else
-    min_key = (file_header_.order + 1) / 2 - 1;
-
-  if (node->key_num >= min_key)
+  while (true)
   {
-    rc = disk_buffer_pool_->unpin_page(&page_handle);
+    const IndexNode &node = frame.node;
+    for (int i = 0; i < node.key_num; i++)
+    {
+      printf("key : %d,rids (page_num:%d slotnum %d)\n", *(int *)frame.key(i), node.rids[i].page_num,
+             node.rids[i].slot_num);
+    }
+    printf("next node:%d\n", node.next);
+    if (node.next <= 0)
+    {
+      break;
+    }
+    rc = frame.get(node.next);
     if (rc != SUCCESS)
     {
       return rc;
     }
-    return SUCCESS;
   }
+  return frame.release();
+}
 
-  rc = disk_buffer_pool_->get_this_page(file_id_, node->parent, &parent_handle);
-  if (rc != SUCCESS)
-  {
-    return rc;
-  }
-  rc = disk_buffer_pool_->get_data(&parent_handle, &pdata);
+RC BplusTreeHandler::get_first_leaf_page(PageNum *leaf_page)
+{
+  NodeFrame frame(*this);
+  RC rc = frame.get(file_header_.root_page, false);
   if (rc != SUCCESS)
   {
     return rc;
   }
-
-  parent = get_index_node(pdata);
-
-  delete_index = 0;
-  while (delete_index <= parent->key_num)
+  while (!frame.node.is_leaf)
   {
-    if ((parent->rids[delete_index].page_num) == page_num)
-      break;
-    delete_index++;
-  }
-
-  if (delete_index == 0)
-  {
-    leaf_page = page_num;
-    right_page = parent->rids[delete_index + 1].page_num;
-    rc = disk_buffer_pool_->get_this_page(file_id_, right_page, &right_handle);
+    PageNum page_num = frame.node.rids[0].page_num;
+    rc = frame.get(page_num, false);
     if (rc != SUCCESS)
     {
       return rc;
     }
-    rc = disk_buffer_pool_->get_data(&right_handle, &pdata);
+  }
+  *leaf_page = frame.page_num();
+  return frame.release();
+}
+
+RC BplusTreeHandler::find_leaf_before(const char *pkey, PageNum *leaf_page, std::vector<std::pair<PageNum, int>> &path)
+{
+  path.clear();
+  PageNum page_num = file_header_.root_page;
+  NodeFrame frame(*this);
+  while (true)
+  {
+    RC rc = frame.get(page_num, false);
     if (rc != SUCCESS)
     {
       return rc;
     }
-    right = (IndexNode *)(pdata + sizeof(IndexFileHeader));
-
-    if (right->key_num > min_key)
+    const IndexNode &node = frame.node;
+    if (node.is_leaf)
     {
-      rc = disk_buffer_pool_->unpin_page(&page_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->unpin_page(&parent_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->unpin_page(&right_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      return redistribute_nodes(page_num, right_page);
-    }
-    else
-    {
-      rc = disk_buffer_pool_->unpin_page(&page_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->unpin_page(&parent_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->unpin_page(&right_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      return coalesce_node(page_num, right_page);
+      break;
     }
+    // 孩子i中的key都小于第i个key，第一个不小于pkey的key左边的孩子里才可能有小于pkey的key
+    int i = pkey == nullptr ? node.key_num : lower_bound(&node, pkey);
+    path.emplace_back(page_num, i);
+    page_num = node.rids[i].page_num;
   }
-  else
+  *leaf_page = page_num;
+  return frame.release();
+}
+
+RC BplusTreeHandler::find_prev_leaf(std::vector<std::pair<PageNum, int>> &path, PageNum *leaf_page)
+{
+  // 往上找到第一个左边还有孩子的内部节点，再从左边的孩子一直往右下走到叶子
+  while (!path.empty() && path.back().second == 0)
+  {
+    path.pop_back();
+  }
+  if (path.empty())
+  {
+    *leaf_page = -1;
+    return SUCCESS;
+  }
+  path.back().second--;
+  PageNum page_num = path.back().first;
+  int child = path.back().second;
+  NodeFrame frame(*this);
+  while (true)
   {
-    leaf_page = parent->rids[delete_index - 1].page_num;
-    rc = disk_buffer_pool_->get_this_page(file_id_, leaf_page, &left_handle);
+    RC rc = frame.get(page_num, false);
     if (rc != SUCCESS)
     {
       return rc;
     }
-    rc = disk_buffer_pool_->get_data(&left_handle, &pdata);
-    if (rc != SUCCESS)
+    const IndexNode &node = frame.node;
+    if (node.is_leaf)
     {
-      return rc;
+      break;
     }
-    left = (IndexNode *)(pdata + sizeof(IndexFileHeader));
+    if (child < 0)
+    {
+      child = node.key_num;
+      path.emplace_back(page_num, child);
+    }
+    page_num = node.rids[child].page_num;
+    child = -1;
+  }
+  *leaf_page = page_num;
+  return frame.release();
+}
 
-    if (left->key_num > min_key)
+
+
+BplusTreeScanner::BplusTreeScanner(BplusTreeHandler &index_handler) : index_handler_(index_handler)
+{
+}
+
+BplusTreeScanner::~BplusTreeScanner()
+{
+  if (opened_)
+  {
+    close();
+  }
+}
+
+RC BplusTreeScanner::open(CompOp comp_op, const char *value, int null_index)
+{
+  // 值只和第一个字段比较，多字段索引也是按第一个字段的范围扫描
+  switch (comp_op)
+  {
+  case EQUAL_TO:
+    return open_range(value, 1, true, value, 1, true);
+  case GREAT_EQUAL:
+    return open_range(value, 1, true, nullptr, 0, false);
+  case GREAT_THAN:
+    return open_range(value, 1, false, nullptr, 0, false);
+  case LESS_EQUAL:
+    return open_range(nullptr, 0, false, value, 1, true);
+  case LESS_THAN:
+    return open_range(nullptr, 0, false, value, 1, false);
+  default:
+    // NOT_EQUAL、IS_NULL等没法用范围表示，扫描整个索引，由调用者按记录过滤
+    return open_range(nullptr, 0, false, nullptr, 0, false);
+  }
+}
+
+void BplusTreeScanner::copy_value(char *dest, const char *value, int column_num) const
+{
+  for (int i = 0; i < column_num; i++)
+  {
+    const IndexKeyColumn &column = index_handler_.key_columns_[i];
+    if (column.type == CHARS)
     {
-      rc = disk_buffer_pool_->unpin_page(&page_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->unpin_page(&parent_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->unpin_page(&left_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      return redistribute_nodes(leaf_page, page_num);
+      // 条件中的字符串可能比字段短
+      memset(dest + column.offset, 0, column.length);
+      strncpy(dest + column.offset, value + column.offset, column.length);
     }
     else
     {
-      rc = disk_buffer_pool_->unpin_page(&page_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->unpin_page(&parent_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      rc = disk_buffer_pool_->unpin_page(&left_handle);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
-      return coalesce_node(leaf_page, page_num);
+      memcpy(dest + column.offset, value + column.offset, column.length);
     }
   }
 }
 
-RC BplusTreeHandler::delete_entry(const char *data, const RID *rid)
+RC BplusTreeScanner::open_range(const char *low, bool low_inclusive, const char *high, bool high_inclusive)
+{
+  int column_num = (int)index_handler_.key_columns_.size();
+  return open_range(low, column_num, low_inclusive, high, column_num, high_inclusive);
+}
+
+RC BplusTreeScanner::open_range(const char *low, int low_column_num, bool low_inclusive,
+                                const char *high, int high_column_num, bool high_inclusive, bool reverse)
 {
   RC rc;
-  PageNum leaf_page;
-  char *pkey;
-  pkey = (char *)malloc(file_header_.key_length);
-  if (nullptr == pkey)
+  if (opened_)
   {
-    LOG_ERROR("Failed to alloc memory for key. size=%d", file_header_.key_length);
-    return RC::NOMEM;
+    return RC::RECORD_OPENNED;
   }
-  memcpy(pkey, data, file_header_.attr_length);
-  memcpy(pkey + file_header_.attr_length, rid, sizeof(*rid));
-
-  rc = find_leaf(pkey, &leaf_page);
+  rc = index_handler_.merge_change_buffer();
   if (rc != SUCCESS)
   {
-    free(pkey);
     return rc;
   }
-  rc = delete_entry_internal(leaf_page, pkey);
-  if (rc != SUCCESS)
+
+  const IndexFileHeader &file_header = index_handler_.file_header_;
+  int column_num = (int)index_handler_.key_columns_.size();
+  if (low == nullptr || low_column_num <= 0)
   {
-    free(pkey);
-    return rc;
+    low = nullptr;
+    low_column_num = 0;
   }
-  free(pkey);
-  return SUCCESS;
-}
+  if (high == nullptr || high_column_num <= 0)
+  {
+    high = nullptr;
+    high_column_num = 0;
+  }
+  low_column_num = std::min(low_column_num, column_num);
+  high_column_num = std::min(high_column_num, column_num);
 
-RC BplusTreeHandler::print_tree()
-{
-  BPPageHandle page_handle;
-  IndexNode *node;
-  PageNum page_num;
-  char *pdata, *pkey;
-  int i;
-  RC rc;
+  high_value_.clear();
+  high_column_num_ = high_column_num;
+  high_inclusive_ = high_inclusive;
+  if (high != nullptr)
+  {
+    high_value_.resize(file_header.attr_length);
+    copy_value(high_value_.data(), high, high_column_num);
+  }
 
-  rc = disk_buffer_pool_->get_this_page(file_id_, file_header_.root_page, &page_handle);
-  if (rc != SUCCESS)
+  // 下界的属性值配上最小或最大的rid，找到的就是第一个不小于或者大于下界的key。
+  // 只指定了前几个字段时，剩下的字段也填成最小或最大的值
+  low_key_.clear();
+  low_inclusive_ = low_inclusive;
+  if (low != nullptr)
   {
-    return rc;
+    low_key_.resize(file_header.key_length);
+    copy_value(low_key_.data(), low, low_column_num);
+    index_handler_.fill_key_columns(low_key_.data(), low_column_num, !low_inclusive);
+    RID rid;
+    rid.page_num = low_inclusive ? -1 : INT_MAX;
+    rid.slot_num = low_inclusive ? -1 : INT_MAX;
+    memcpy(low_key_.data() + file_header.attr_length, &rid, sizeof(RID));
   }
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-  if (rc != SUCCESS)
+
+  // 逆序扫描从上界开始，上界配上最大或最小的rid，小于它的key就是不超过或者小于上界的key
+  reverse_ = reverse;
+  high_key_.clear();
+  path_.clear();
+  if (reverse && high != nullptr)
   {
-    return rc;
+    high_key_.resize(file_header.key_length);
+    memcpy(high_key_.data(), high_value_.data(), file_header.attr_length);
+    index_handler_.fill_key_columns(high_key_.data(), high_column_num, high_inclusive);
+    RID rid;
+    rid.page_num = high_inclusive ? INT_MAX : -1;
+    rid.slot_num = high_inclusive ? INT_MAX : -1;
+    memcpy(high_key_.data() + file_header.attr_length, &rid, sizeof(RID));
   }
 
-  node = get_index_node(pdata);
+  // 叶子在第一次next_entry时再读取
+  started_ = false;
+  eof_ = false;
+  keys_.clear();
+  rids_.clear();
+  index_in_batch_ = 0;
+  opened_ = true;
+  return RC::SUCCESS;
+}
 
-  while (!node->is_leaf)
+RC BplusTreeScanner::close()
+{
+  if (!opened_)
   {
-    page_num = node->rids[0].page_num;
-    rc = disk_buffer_pool_->unpin_page(&page_handle);
-    if (rc != SUCCESS)
-    {
-      return rc;
-    }
-    rc = disk_buffer_pool_->get_this_page(file_id_, page_num, &page_handle);
-    if (rc != SUCCESS)
+    return RC::RECORD_SCANCLOSED;
+  }
+  keys_.clear();
+  rids_.clear();
+  opened_ = false;
+  return RC::SUCCESS;
+}
+
+RC BplusTreeScanner::fetch_next_leaf()
+{
+  const IndexFileHeader &file_header = index_handler_.file_header_;
+  const int attr_length = file_header.attr_length;
+  const int key_length = file_header.key_length;
+  keys_.clear();
+  rids_.clear();
+  index_in_batch_ = 0;
+
+  TreeLatchGuard guard(index_handler_.tree_latch_, false);
+  // 从哪个叶子的哪个位置开始：第一次按下界查找；之后树的结构没有变化时直接到下一个叶子，
+  // 否则上一个叶子可能已经分裂或者被释放了，按上次返回的最后一个key重新查找
+  RC rc = RC::SUCCESS;
+  PageNum page_num;
+  const char *start_key = nullptr;
+  bool start_inclusive = false;
+  if (!started_)
+  {
+    if (!low_key_.empty())
     {
-      return rc;
+      start_key = low_key_.data();
+      start_inclusive = low_inclusive_;
+      rc = index_handler_.find_leaf(start_key, &page_num);
     }
-    rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-    if (rc != SUCCESS)
+    else
     {
-      return rc;
+      rc = index_handler_.get_first_leaf_page(&page_num);
     }
-    node = (IndexNode *)(pdata + sizeof(IndexFileHeader));
-    node->keys = (char *)node + sizeof(IndexNode);
-    node->rids = (RID *)(node->keys + file_header_.order * file_header_.key_length);
   }
-  page_num = 1;
-  while (page_num != 0)
+  else if (smo_count_ == index_handler_.smo_count_)
   {
-    for (i = 0; i < node->key_num; i++)
+    page_num = next_page_;
+  }
+  else
+  {
+    start_key = last_key_.data();
+    rc = index_handler_.find_leaf(start_key, &page_num);
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to find the leaf page of index scan. rc=%d:%s", rc, strrc(rc));
+    return rc;
+  }
+  started_ = true;
+  smo_count_ = index_handler_.smo_count_;
+
+  // 跳过没有满足条件的key的叶子，直到读到一些索引项或者扫描结束
+  while (rids_.empty() && !eof_)
+  {
+    if (page_num <= 0)
     {
-      pkey = node->keys + i * file_header_.key_length;
-      printf("key : %d,rids (page_num:%d slotnum %d)\n", *(int *)pkey, node->rids[i].page_num, node->rids[i].slot_num);
+      eof_ = true;
+      break;
     }
-    printf("next node:%d\n", page_num);
-    rc = disk_buffer_pool_->unpin_page(&page_handle);
-    if (rc != SUCCESS)
+    BplusTreeHandler::NodeFrame leaf(index_handler_);
+    rc = leaf.get_latched(page_num, false);
+    if (rc != RC::SUCCESS)
     {
+      LOG_ERROR("Failed to get leaf page. page num=%d, rc=%d:%s", page_num, rc, strrc(rc));
       return rc;
     }
-    page_num = node->rids[file_header_.order - 1].page_num;
-    if (page_num == 0)
-      break;
-    rc = disk_buffer_pool_->get_this_page(file_id_, page_num, &page_handle);
-    if (rc != SUCCESS)
+    const IndexNode *node = &leaf.node;
+    int pos = 0;
+    if (start_key != nullptr)
     {
-      return rc;
+      pos = start_inclusive ? index_handler_.lower_bound(node, start_key) : index_handler_.upper_bound(node, start_key);
+      start_key = nullptr;
     }
-    rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-    if (rc != SUCCESS)
+    for (; pos < node->key_num; pos++)
     {
-      return rc;
+      const char *node_key = leaf.key(pos);
+      if (!high_value_.empty())
+      {
+        // key是有序的，超过上界之后就不用再往后扫描了
+        int result = index_handler_.compare_attr_prefix(node_key, high_value_.data(), high_column_num_);
+        if (result > 0 || (result == 0 && !high_inclusive_))
+        {
+          eof_ = true;
+          break;
+        }
+      }
+      keys_.insert(keys_.end(), node_key, node_key + attr_length);
+      rids_.push_back(node->rids[pos]);
     }
-
-    node = get_index_node(pdata);
-  }
-  rc = disk_buffer_pool_->unpin_page(&page_handle);
-  if (rc != SUCCESS)
-  {
-    return rc;
+    if (!rids_.empty())
+    {
+      const char *last = leaf.key(pos - 1);
+      last_key_.assign(last, last + key_length);
+    }
+    page_num = node->next;
   }
-  return SUCCESS;
+  next_page_ = page_num;
+  return RC::SUCCESS;
 }
 
-RC BplusTreeHandler::find_first_index_satisfied(CompOp compop, const char *key, PageNum *page_num, int *rididx)
+RC BplusTreeScanner::fetch_prev_leaf()
 {
-  BPPageHandle page_handle;
-  IndexNode *node;
-  PageNum leaf_page, next;
-  char *pdata, *pkey;
-  RC rc;
-  int i, tmp;
-  RID rid;
-  if (compop == LESS_THAN || compop == LESS_EQUAL || compop == NOT_EQUAL || compop == IS_NOT_NULL)
+  const IndexFileHeader &file_header = index_handler_.file_header_;
+  const int attr_length = file_header.attr_length;
+  const int key_length = file_header.key_length;
+  keys_.clear();
+  rids_.clear();
+  index_in_batch_ = 0;
+
+  TreeLatchGuard guard(index_handler_.tree_latch_, false);
+  // 第一次从上界开始查找；之后树的结构没有变化时沿着path_到前一个叶子，
+  // 否则按上次返回的最小的key重新查找。bound不为空时只返回叶子中小于它的key
+  RC rc = RC::SUCCESS;
+  PageNum page_num;
+  const char *bound = nullptr;
+  if (!started_)
   {
-    rc = get_first_leaf_page(page_num);
-    if (rc != SUCCESS)
-    {
-      return rc;
-    }
-    *rididx = 0;
-    return SUCCESS;
+    bound = high_key_.empty() ? nullptr : high_key_.data();
+    rc = index_handler_.find_leaf_before(bound, &page_num, path_);
   }
-  rid.page_num = -1;
-  rid.slot_num = -1;
-  pkey = (char *)malloc(file_header_.key_length);
-  if (pkey == nullptr)
+  else if (smo_count_ == index_handler_.smo_count_)
   {
-    LOG_ERROR("Failed to alloc memory for key. size=%d", file_header_.key_length);
-    return RC::NOMEM;
+    rc = index_handler_.find_prev_leaf(path_, &page_num);
   }
-  memcpy(pkey, key, file_header_.attr_length);
-  memcpy(pkey + file_header_.attr_length, &rid, sizeof(RID));
-
-  rc = find_leaf(pkey, &leaf_page);
-  if (rc != SUCCESS)
+  else
+  {
+    bound = last_key_.data();
+    rc = index_handler_.find_leaf_before(bound, &page_num, path_);
+  }
+  if (rc != RC::SUCCESS)
   {
-    free(pkey);
+    LOG_ERROR("Failed to find the leaf page of reverse index scan. rc=%d:%s", rc, strrc(rc));
     return rc;
   }
-  free(pkey);
+  started_ = true;
+  smo_count_ = index_handler_.smo_count_;
 
-  next = leaf_page;
-
-  while (next > 0)
+  while (rids_.empty() && !eof_)
   {
-    rc = disk_buffer_pool_->get_this_page(file_id_, next, &page_handle);
-    if (rc != SUCCESS)
+    if (page_num <= 0)
     {
-      return rc;
+      eof_ = true;
+      break;
     }
-    rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-    if (rc != SUCCESS)
+    BplusTreeHandler::NodeFrame leaf(index_handler_);
+    rc = leaf.get_latched(page_num, false);
+    if (rc != RC::SUCCESS)
     {
+      LOG_ERROR("Failed to get leaf page. page num=%d, rc=%d:%s", page_num, rc, strrc(rc));
       return rc;
     }
-
-    node = get_index_node(pdata);
-    for (i = 0; i < node->key_num; i++)
+    const IndexNode *node = &leaf.node;
+    int pos = bound == nullptr ? node->key_num - 1 : index_handler_.lower_bound(node, bound) - 1;
+    bound = nullptr;
+    for (; pos >= 0; pos--)
     {
-      if (compop == IS_NULL)
+      const char *node_key = leaf.key(pos);
+      if (!low_key_.empty() && index_handler_.compare_key(node_key, low_key_.data()) < 0)
       {
-        // 找出所有可能是null的值
-        // 实际上是否为null依靠add_record判断
-        switch (file_header_.attr_type)
-        {
-        case INTS:
-        {
-          int v = 0;
-          tmp = CompareKey(node->keys + i * file_header_.key_length, (const char *)(&v), file_header_.attr_type, file_header_.attr_length);
-        }
+        eof_ = true;
         break;
-        case CHARS:
-        {
-          const char *v = "NULL";
-          tmp = CompareKey(node->keys + i * file_header_.key_length, v, file_header_.attr_type, file_header_.attr_length);
-        }
-        break;
-        case FLOATS:
-        {
-          float v = 0.0;
-          tmp = CompareKey(node->keys + i * file_header_.key_length, (const char *)(&v), file_header_.attr_type, file_header_.attr_length);
-        }
-        break;
-        case DATES:
-        {
-          int v = 19700101;
-          tmp = CompareKey(node->keys + i * file_header_.key_length, (const char *)(&v), file_header_.attr_type, file_header_.attr_length);
-        }
-        break;
-        default:
-          LOG_ERROR("Error type");
-          break;
-        }
-
-
-        if (tmp >= 0) {
-          rc = disk_buffer_pool_->get_page_num(&page_handle, page_num);
-          if (rc != SUCCESS)
-          {
-            return rc;
-          }
-          *rididx = i;
-          rc = disk_buffer_pool_->unpin_page(&page_handle);
-          if (rc != SUCCESS)
-          {
-            return rc;
-          }
-        }
       }
-
-      tmp = CompareKey(node->keys + i * file_header_.key_length, key, file_header_.attr_type, file_header_.attr_length);
-      if (compop == EQUAL_TO || compop == GREAT_EQUAL)
+      if (!high_value_.empty())
       {
-        if (tmp >= 0)
+        int result = index_handler_.compare_attr_prefix(node_key, high_value_.data(), high_column_num_);
+        if (result > 0 || (result == 0 && !high_inclusive_))
         {
-          rc = disk_buffer_pool_->get_page_num(&page_handle, page_num);
-          if (rc != SUCCESS)
-          {
-            return rc;
-          }
-          *rididx = i;
-          rc = disk_buffer_pool_->unpin_page(&page_handle);
-          if (rc != SUCCESS)
-          {
-            return rc;
-          }
+          continue;
         }
       }
-
-      if (compop == GREAT_THAN)
+      keys_.insert(keys_.end(), node_key, node_key + attr_length);
+      rids_.push_back(node->rids[pos]);
+    }
+    if (!rids_.empty())
+    {
+      // 按从大到小的顺序放的，最后放进去的是最小的
+      const char *last = leaf.key(pos + 1);
+      last_key_.assign(last, last + key_length);
+    }
+    leaf.release();
+    if (rids_.empty() && !eof_)
+    {
+      rc = index_handler_.find_prev_leaf(path_, &page_num);
+      if (rc != RC::SUCCESS)
       {
-        if (tmp > 0)
-        {
-          rc = disk_buffer_pool_->get_page_num(&page_handle, page_num);
-          if (rc != SUCCESS)
-          {
-            return rc;
-          }
-          *rididx = i;
-          rc = disk_buffer_pool_->unpin_page(&page_handle);
-          if (rc != SUCCESS)
-          {
-            return rc;
-          }
-          return SUCCESS;
-        }
+        LOG_ERROR("Failed to find the previous leaf page. rc=%d:%s", rc, strrc(rc));
+        return rc;
       }
     }
-    next = node->rids[file_header_.order - 1].page_num;
-  }
-  rc = disk_buffer_pool_->unpin_page(&page_handle);
-  if (rc != SUCCESS)
-  {
-    return rc;
   }
-  return RC::RECORD_EOF;
+  return RC::SUCCESS;
 }
 
-RC BplusTreeHandler::get_first_leaf_page(PageNum *leaf_page)
+RC BplusTreeScanner::next_entry(RID *rid, char *key)
 {
-  RC rc;
-  BPPageHandle page_handle;
-  PageNum page_num;
-  IndexNode *node;
-  char *pdata;
-
-  rc = disk_buffer_pool_->get_this_page(file_id_, file_header_.root_page, &page_handle);
-  if (rc != SUCCESS)
-  {
-    return rc;
-  }
-  rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-  if (rc != SUCCESS)
+  if (!opened_)
   {
-    return rc;
+    return RC::RECORD_CLOSED;
   }
 
-  node = get_index_node(pdata);
-
-  while (node->is_leaf == false)
+  if (index_in_batch_ >= rids_.size())
   {
-    page_num = node->rids[0].page_num;
-    rc = disk_buffer_pool_->unpin_page(&page_handle);
-    if (rc != SUCCESS)
+    if (eof_)
     {
-      return rc;
+      return RC::RECORD_EOF;
     }
-
-    rc = disk_buffer_pool_->get_this_page(file_id_, page_num, &page_handle);
-    if (rc != SUCCESS)
+    RC rc = reverse_ ? fetch_prev_leaf() : fetch_next_leaf();
+    if (rc != RC::SUCCESS)
     {
       return rc;
     }
-    rc = disk_buffer_pool_->get_data(&page_handle, &pdata);
-    if (rc != SUCCESS)
+    if (rids_.empty())
     {
-      return rc;
+      return RC::RECORD_EOF;
     }
-
-    node = get_index_node(pdata);
   }
-  rc = disk_buffer_pool_->get_page_num(&page_handle, leaf_page);
-  if (rc != SUCCESS)
+
+  const int attr_length = index_handler_.file_header_.attr_length;
+  *rid = rids_[index_in_batch_];
+  if (key != nullptr)
   {
-    return rc;
+    memcpy(key, keys_.data() + index_in_batch_ * attr_length, attr_length);
   }
-  rc = disk_buffer_pool_->unpin_page(&page_handle);
-  if (rc != SUCCESS)
+  index_in_batch_++;
+  return RC::SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static int global_bplus_tree_fill_factor = 90;
+
+RC set_bplus_tree_fill_factor(int fill_factor)
+{
+  if (fill_factor < 50 || fill_factor > 100)
   {
-    return rc;
+    LOG_ERROR("Invalid bplus tree fill factor %d", fill_factor);
+    return RC::INVALID_ARGUMENT;
   }
-  return SUCCESS;
+  global_bplus_tree_fill_factor = fill_factor;
+  return RC::SUCCESS;
 }
 
-BplusTreeScanner::BplusTreeScanner(BplusTreeHandler &index_handler) : index_handler_(index_handler)
+int bplus_tree_fill_factor()
 {
+  return global_bplus_tree_fill_factor;
 }
 
-RC BplusTreeScanner::open(CompOp comp_op, const char *value, int null_index)
+static int global_bplus_tree_merge_threshold = 50;
+
+RC set_bplus_tree_merge_threshold(int threshold)
 {
-  RC rc;
-  if (opened_)
+  if (threshold < 0 || threshold > 50)
   {
-    return RC::RECORD_OPENNED;
+    LOG_ERROR("Invalid bplus tree merge threshold %d", threshold);
+    return RC::INVALID_ARGUMENT;
   }
+  global_bplus_tree_merge_threshold = threshold;
+  return RC::SUCCESS;
+}
+
+int bplus_tree_merge_threshold()
+{
+  return global_bplus_tree_merge_threshold;
+}
 
-  comp_op_ = comp_op;
-  null_index_ = null_index;
+static int global_bplus_tree_change_buffer = 0;
 
-  char *value_copy = (char *)malloc(index_handler_.file_header_.attr_length);
-  if (value_copy == nullptr)
+RC set_bplus_tree_change_buffer(int max_changes)
+{
+  if (max_changes < 0)
   {
-    LOG_ERROR("Failed to alloc memory for value. size=%d", index_handler_.file_header_.attr_length);
-    return RC::NOMEM;
+    LOG_ERROR("Invalid bplus tree change buffer %d", max_changes);
+    return RC::INVALID_ARGUMENT;
   }
-  memcpy(value_copy, value, index_handler_.file_header_.attr_length);
-  value_ = value_copy; // free value_
-  rc = index_handler_.find_first_index_satisfied(comp_op, value, &next_page_num_, &index_in_node_);
-  if (rc != SUCCESS)
+  global_bplus_tree_change_buffer = max_changes;
+  return RC::SUCCESS;
+}
+
+int bplus_tree_change_buffer()
+{
+  return global_bplus_tree_change_buffer;
+}
+
+BplusTreeBulkLoader::BplusTreeBulkLoader(BplusTreeHandler &handler, int fill_factor, size_t sort_memory)
+    : handler_(handler), fill_factor_(std::min(100, std::max(50, fill_factor))), sort_memory_(sort_memory),
+      entry_length_(handler.file_header_.key_length + 1)
+{
+}
+
+BplusTreeBulkLoader::~BplusTreeBulkLoader()
+{
+  levels_.clear();
+  for (Run &run : runs_)
   {
-    if (rc == RC::RECORD_EOF)
-    {
-      next_page_num_ = -1;
-      index_in_node_ = -1;
-    }
-    else
-      return rc;
+    fclose(run.file);
   }
-  num_fixed_pages_ = 1;
-  next_index_of_page_handle_ = 0;
-  pinned_page_count_ = 0;
-  opened_ = true;
-  return SUCCESS;
+  runs_.clear();
 }
 
-RC BplusTreeScanner::close()
+int BplusTreeBulkLoader::compare_entry(const char *entry1, const char *entry2) const
 {
-  if (!opened_)
+  return handler_.compare_key(entry1, entry2);
+}
+
+RC BplusTreeBulkLoader::add_entry(const char *pkey, const RID *rid, bool unique)
+{
+  const int attr_length = handler_.file_header_.attr_length;
+  buffer_.insert(buffer_.end(), pkey, pkey + attr_length);
+  buffer_.insert(buffer_.end(), (const char *)rid, (const char *)rid + sizeof(RID));
+  buffer_.push_back(unique ? 1 : 0);
+  entry_num_++;
+  if (buffer_.size() >= sort_memory_)
   {
-    return RC::RECORD_SCANCLOSED;
+    return spill_run();
   }
-  free((void *)value_);
-  value_ = nullptr;
-  opened_ = false;
   return RC::SUCCESS;
 }
 
-RC BplusTreeScanner::next_entry(RID *rid)
+void BplusTreeBulkLoader::sort_buffer()
 {
-  RC rc;
-  if (!opened_)
+  order_.resize(buffer_.size() / entry_length_);
+  std::iota(order_.begin(), order_.end(), 0);
+  const char *data = buffer_.data();
+  std::sort(order_.begin(), order_.end(), [this, data](int a, int b) {
+    return compare_entry(data + (size_t)a * entry_length_, data + (size_t)b * entry_length_) < 0;
+  });
+  next_ = 0;
+}
+
+RC BplusTreeBulkLoader::spill_run()
+{
+  sort_buffer();
+  FILE *file = SpillFileManager::instance().create(nullptr);
+  if (file == nullptr)
   {
-    return RC::RECORD_CLOSED;
+    LOG_ERROR("Failed to create temp file for bulk load. errmsg=%s", strerror(errno));
+    return RC::IOERR;
   }
-  rc = get_next_idx_in_memory(rid); //和RM中一样，有可能有错误，一次只查当前页和当前页的下一页，有待确定
-  if (rc == RC::RECORD_NO_MORE_IDX_IN_MEM)
+  runs_.push_back(Run{file, std::vector<char>(entry_length_)});
+  for (int pos : order_)
   {
-    rc = find_idx_pages();
-    if (rc != SUCCESS)
+    if (fwrite(buffer_.data() + (size_t)pos * entry_length_, entry_length_, 1, file) != 1)
     {
-      return rc;
+      LOG_ERROR("Failed to write temp file for bulk load. errmsg=%s", strerror(errno));
+      return RC::IOERR;
     }
-    return get_next_idx_in_memory(rid);
   }
-  else
+  if (fflush(file) != 0 || fseek(file, 0, SEEK_SET) != 0)
   {
-    if (rc != SUCCESS)
+    LOG_ERROR("Failed to flush temp file for bulk load. errmsg=%s", strerror(errno));
+    return RC::IOERR;
+  }
+  buffer_.clear();
+  order_.clear();
+  return RC::SUCCESS;
+}
+
+RC BplusTreeBulkLoader::read_run(Run &run, bool *eof)
+{
+  *eof = false;
+  if (fread(run.entry.data(), entry_length_, 1, run.file) == 1)
+  {
+    return RC::SUCCESS;
+  }
+  if (feof(run.file))
+  {
+    *eof = true;
+    return RC::SUCCESS;
+  }
+  LOG_ERROR("Failed to read temp file for bulk load. errmsg=%s", strerror(errno));
+  return RC::IOERR;
+}
+
+RC BplusTreeBulkLoader::start_merge()
+{
+  heap_.clear();
+  for (int i = 0; i < (int)runs_.size(); i++)
+  {
+    bool eof = false;
+    RC rc = read_run(runs_[i], &eof);
+    if (rc != RC::SUCCESS)
     {
       return rc;
     }
+    if (!eof)
+    {
+      heap_.push_back(i);
+    }
   }
-  return SUCCESS;
+  auto greater = [this](int a, int b) {
+    return compare_entry(runs_[a].entry.data(), runs_[b].entry.data()) > 0;
+  };
+  std::make_heap(heap_.begin(), heap_.end(), greater);
+  last_run_ = -1;
+  return RC::SUCCESS;
 }
 
-RC BplusTreeScanner::find_idx_pages()
+RC BplusTreeBulkLoader::next_entry(const char **entry)
 {
-  RC rc;
-  if (!opened_)
-  {
-    return RC::RECORD_CLOSED;
-  }
-  if (pinned_page_count_ > 0)
+  if (runs_.empty())
   {
-    for (int i = 0; i < pinned_page_count_; i++)
+    if (next_ >= order_.size())
     {
-      rc = index_handler_.disk_buffer_pool_->unpin_page(page_handles_ + i);
-      if (rc != SUCCESS)
-      {
-        return rc;
-      }
+      return RC::RECORD_EOF;
     }
+    *entry = buffer_.data() + (size_t)order_[next_++] * entry_length_;
+    return RC::SUCCESS;
   }
-  next_index_of_page_handle_ = 0;
-  pinned_page_count_ = 0;
 
-  for (int i = 0; i < num_fixed_pages_; i++)
+  // 上次返回的索引项在调用者用完之前不能覆盖，这次再从它所在的文件读下一个
+  auto greater = [this](int a, int b) {
+    return compare_entry(runs_[a].entry.data(), runs_[b].entry.data()) > 0;
+  };
+  if (last_run_ >= 0)
   {
-    if (next_page_num_ <= 0)
-      break;
-    rc = index_handler_.disk_buffer_pool_->get_this_page(index_handler_.file_id_, next_page_num_, page_handles_ + i);
-    if (rc != SUCCESS)
+    bool eof = false;
+    RC rc = read_run(runs_[last_run_], &eof);
+    if (rc != RC::SUCCESS)
     {
       return rc;
     }
-    char *pdata;
-    rc = index_handler_.disk_buffer_pool_->get_data(page_handles_ + i, &pdata);
-    if (rc != SUCCESS)
+    if (!eof)
     {
-      return rc;
+      heap_.push_back(last_run_);
+      std::push_heap(heap_.begin(), heap_.end(), greater);
     }
-
-    IndexNode *node = index_handler_.get_index_node(pdata);
-    pinned_page_count_++;
-    next_page_num_ = node->rids[index_handler_.file_header_.order - 1].page_num;
+    last_run_ = -1;
   }
-  if (pinned_page_count_ > 0)
-    return SUCCESS;
-  return RC::RECORD_EOF;
+  if (heap_.empty())
+  {
+    return RC::RECORD_EOF;
+  }
+  std::pop_heap(heap_.begin(), heap_.end(), greater);
+  last_run_ = heap_.back();
+  heap_.pop_back();
+  *entry = runs_[last_run_].entry.data();
+  return RC::SUCCESS;
 }
 
-RC BplusTreeScanner::get_next_idx_in_memory(RID *rid)
+bool BplusTreeBulkLoader::overfilled(const IndexNode &node) const
 {
-  char *pdata;
-  IndexNode *node;
-  RC rc;
-  if (next_index_of_page_handle_ >= pinned_page_count_)
+  return (long)handler_.packed_size(node.is_leaf, node.keys, node.key_num) * 100 >
+         (long)handler_.node_capacity() * fill_factor_;
+}
+
+RC BplusTreeBulkLoader::append_leaf(const char *key, const RID &rid)
+{
+  BplusTreeHandler::NodeFrame &leaf = *levels_[0];
+  leaf.insert(leaf.node.key_num, key, rid);
+  if (leaf.node.key_num == 1 || !overfilled(leaf.node))
   {
-    return RC::RECORD_NO_MORE_IDX_IN_MEM;
+    return RC::SUCCESS;
   }
 
-  if (next_page_num_ == -1 && index_in_node_ == -1)
+  // 放不下时新开一个叶子，父节点中只放能区分两个叶子的最短的key
+  leaf.remove(leaf.node.key_num - 1);
+  std::unique_ptr<BplusTreeHandler::NodeFrame> next(new BplusTreeHandler::NodeFrame(handler_));
+  RC rc = next->allocate(true, -1);
+  if (rc != RC::SUCCESS)
   {
-    return RC::RECORD_EOF;
+    return rc;
   }
+  std::vector<char> separator(handler_.file_header_.key_length);
+  handler_.make_separator(leaf.key(leaf.node.key_num - 1), key, separator.data());
+  rc = append_child(1, separator.data(), next->page_num());
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  next->node.parent = levels_[1]->page_num();
+  leaf.node.next = next->page_num();
+  rc = leaf.save();
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  levels_[0] = std::move(next);
+  levels_[0]->insert(0, key, rid);
+  leaf_num_++;
+  return RC::SUCCESS;
+}
 
-  for (; next_index_of_page_handle_ < pinned_page_count_; next_index_of_page_handle_++)
+RC BplusTreeBulkLoader::append_child(size_t level, const char *key, PageNum child)
+{
+  RC rc;
+  if (level == levels_.size())
   {
-    //根据pdata获取更新的node
-    rc = index_handler_.disk_buffer_pool_->get_data(page_handles_ + next_index_of_page_handle_, &pdata);
-    if (rc != SUCCESS)
+    std::unique_ptr<BplusTreeHandler::NodeFrame> root(new BplusTreeHandler::NodeFrame(handler_));
+    rc = root->allocate(false, -1);
+    if (rc != RC::SUCCESS)
     {
-      LOG_ERROR("Failed to get data from disk buffer pool. rc=%s", strrc);
       return rc;
     }
+    root->node.rids[0].page_num = levels_[level - 1]->page_num();
+    levels_[level - 1]->node.parent = root->page_num();
+    levels_.push_back(std::move(root));
+  }
 
-    node = index_handler_.get_index_node(pdata);
-    // 在node内部不断进行扫描比较
-    for (; index_in_node_ < node->key_num; index_in_node_++)
-    {
-      if (satisfy_condition(node->keys + index_in_node_ * index_handler_.file_header_.key_length))
-      {
-        memcpy(rid, node->rids + index_in_node_, sizeof(RID));
-        index_in_node_++;
-        return SUCCESS;
-      }
-    }
+  BplusTreeHandler::NodeFrame &node = *levels_[level];
+  RID child_rid;
+  child_rid.page_num = child;
+  child_rid.slot_num = -1;
+  node.insert(node.node.key_num, key, child_rid);
+  if (node.node.key_num == 1 || !overfilled(node.node))
+  {
+    return RC::SUCCESS;
+  }
 
-    index_in_node_ = 0;
-    // WARNING: 如果什么都没筛选到，会返回no data
+  // key移到上一层，child成为新节点的第一个孩子
+  node.remove(node.node.key_num - 1);
+  std::unique_ptr<BplusTreeHandler::NodeFrame> next(new BplusTreeHandler::NodeFrame(handler_));
+  rc = next->allocate(false, -1);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  rc = append_child(level + 1, key, next->page_num());
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
   }
-  return RC::RECORD_NO_MORE_IDX_IN_MEM;
+  next->node.parent = levels_[level + 1]->page_num();
+  next->node.rids[0] = child_rid;
+  rc = node.save();
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  levels_[level] = std::move(next);
+  return RC::SUCCESS;
 }
-bool BplusTreeScanner::satisfy_condition(const char *pkey)
-{
-  // i2,f2,s2表示条件中的内容，i1,f1,s1表示搜寻出的记录中的对应属性的值
-  // com_op_表示的是条件中的比较符号，不关乎属性在前还是值在前
-  int i1 = 0, i2 = 0;
-  float f1 = 0, f2 = 0;
-  const char *s1 = nullptr, *s2 = nullptr;
 
-  if (comp_op_ == NO_OP || comp_op_ == IS_NOT_NULL)
+RC BplusTreeBulkLoader::finish()
+{
+  DiskBufferPool *disk_buffer_pool = handler_.disk_buffer_pool_;
+  if (disk_buffer_pool == nullptr)
   {
-    // TODO: 这里实际上扫描了全表，是否为null交由add_record判断，效率会很低
-    return true;
+    return RC::RECORD_CLOSED;
   }
-
-  AttrType attr_type = index_handler_.file_header_.attr_type;
-  switch (attr_type)
+  // 自底向上生成树的过程中树的结构一直在变化
+  StructureChangeGuard guard(handler_);
+  std::unique_ptr<BplusTreeHandler::NodeFrame> root(new BplusTreeHandler::NodeFrame(handler_));
+  RC rc = root->get(handler_.file_header_.root_page);
+  if (rc != RC::SUCCESS)
   {
-  case INTS:
-    i1 = *(int *)pkey;
-    i2 = *(int *)value_;
-    break;
-  case DATES:
-    i1 = *(int *)pkey;
-    i2 = *(int *)value_;
-    break;
-  case FLOATS:
-    f1 = *(float *)pkey;
-    f2 = *(float *)value_;
-    break;
-  case CHARS:
-    s1 = pkey;
-    s2 = value_;
-    break;
-  default:
-    LOG_PANIC("Unknown attr type: %d", attr_type);
+    return rc;
+  }
+  if (!root->node.is_leaf || root->node.key_num != 0)
+  {
+    LOG_ERROR("Bulk load can only be used on an empty bplus tree");
+    return RC::INVALID_ARGUMENT;
+  }
+  if (entry_num_ == 0)
+  {
+    return RC::SUCCESS;
   }
 
-  bool flag = false;
-
-  int attr_length = index_handler_.file_header_.attr_length;
-  switch (comp_op_)
+  if (runs_.empty())
   {
-  case EQUAL_TO:
-    switch (attr_type)
-    {
-    case INTS:
-      flag = (i1 == i2);
-      break;
-    case DATES:
-      flag = (i1 == i2);
-      break;
-    case FLOATS:
-      flag = 0 == float_compare(f1, f2);
-      break;
-    case CHARS:
-      flag = (strncmp(s1, s2, attr_length) == 0);
-      break;
-    default:
-      LOG_PANIC("Unknown attr type: %d", attr_type);
-    }
-    break;
-  case LESS_THAN:
-    switch (attr_type)
+    sort_buffer();
+  }
+  else
+  {
+    if (!buffer_.empty())
     {
-    case INTS:
-      flag = (i1 < i2);
-      break;
-    case DATES:
-      flag = (i1 < i2);
-      break;
-    case FLOATS:
-      flag = (f1 < f2);
-      break;
-    case CHARS:
-      flag = (strncmp(s1, s2, attr_length) < 0);
-      break;
-    default:
-      LOG_PANIC("Unknown attr type: %d", attr_type);
+      rc = spill_run();
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
     }
-    break;
-  case GREAT_THAN:
-    switch (attr_type)
+    rc = start_merge();
+    if (rc != RC::SUCCESS)
     {
-    case INTS:
-      flag = (i1 > i2);
-      break;
-    case DATES:
-      flag = (i1 > i2);
-      break;
-    case FLOATS:
-      flag = (f1 > f2);
-      break;
-    case CHARS:
-      flag = (strncmp(s1, s2, attr_length) > 0);
-      break;
-    default:
-      LOG_PANIC("Unknown attr type: %d", attr_type);
+      return rc;
     }
-    break;
-  case LESS_EQUAL:
-    switch (attr_type)
+  }
+
+  // 第一个叶子就是创建索引时的空根节点
+  levels_.clear();
+  levels_.push_back(std::move(root));
+  leaf_num_ = 1;
+  const int attr_length = handler_.file_header_.attr_length;
+  const int key_length = handler_.file_header_.key_length;
+  std::vector<char> last_unique(attr_length);
+  bool has_unique = false;
+  const char *entry = nullptr;
+  while ((rc = next_entry(&entry)) == RC::SUCCESS)
+  {
+    // 已经排好序，属性值相同的索引项都挨在一起
+    if (entry[key_length])
     {
-    case INTS:
-      flag = (i1 <= i2);
-      break;
-    case DATES:
-      flag = (i1 <= i2);
-      break;
-    case FLOATS:
-      flag = (f1 <= f2);
-      break;
-    case CHARS:
-      flag = (strncmp(s1, s2, attr_length) <= 0);
-      break;
-    default:
-      LOG_PANIC("Unknown attr type: %d", attr_type);
+      if (has_unique && handler_.compare_unique_attr(entry, last_unique.data()) == 0)
+      {
+        return RC::RECORD_DUPLICATE_KEY;
+      }
+      memcpy(last_unique.data(), entry, attr_length);
+      has_unique = true;
     }
-    break;
-  case GREAT_EQUAL:
-    switch (attr_type)
+    RID rid;
+    memcpy(&rid, entry + attr_length, sizeof(rid));
+    rc = append_leaf(entry, rid);
+    if (rc != RC::SUCCESS)
     {
-    case INTS:
-      flag = (i1 >= i2);
-      break;
-    case DATES:
-      flag = (i1 >= i2);
-      break;
-    case FLOATS:
-      flag = (f1 >= f2);
-      break;
-    case CHARS:
-      flag = (strncmp(s1, s2, attr_length) >= 0);
-      break;
-    default:
-      LOG_PANIC("Unknown attr type: %d", attr_type);
+      return rc;
     }
-    break;
-  case NOT_EQUAL:
-    switch (attr_type)
+  }
+  if (rc != RC::RECORD_EOF)
+  {
+    return rc;
+  }
+
+  // 每层最右边的节点还没有写回页面
+  for (std::unique_ptr<BplusTreeHandler::NodeFrame> &node : levels_)
+  {
+    rc = node->save();
+    if (rc != RC::SUCCESS)
     {
-    case INTS:
-      flag = (i1 != i2);
-      break;
-    case DATES:
-      flag = (i1 != i2);
-      break;
-    case FLOATS:
-      flag = 0 != float_compare(f1, f2);
-      break;
-    case CHARS:
-      flag = (strncmp(s1, s2, attr_length) != 0);
-      break;
-    default:
-      LOG_PANIC("Unknown attr type: %d", attr_type);
+      return rc;
     }
-    break;
-  case IS_NULL:
-    switch (attr_type)
+    rc = node->release();
+    if (rc != RC::SUCCESS)
     {
-    case INTS:
-      flag = (i1 == 0);
-      break;
-    case DATES:
-      flag = (i1 == 19700101);
-      break;
-    case FLOATS:
-      LOG_INFO("f1 = %f", f1);
-      flag = 0 == float_compare(f1, 0.0);
-      break;
-    case CHARS:
-      flag = (strncmp(s1, "NULL", attr_length) == 0);
-      break;
-    default:
-      LOG_PANIC("Unknown attr type: %d", attr_type);
+      return rc;
     }
-    break;
-  default:
-    LOG_PANIC("Unknown comp op: %d", comp_op_);
   }
-  return flag;
-}
\ No newline at end of file
+  if (levels_.size() > 1)
+  {
+    handler_.file_header_.root_page = levels_.back()->page_num();
+    handler_.header_dirty_ = true;
+  }
+  LOG_INFO("Bulk loaded %lld entries into %d leaves, tree height %d", entry_num_, leaf_num_, (int)levels_.size());
+  return RC::SUCCESS;
+}
@@ -14,23 +14,53 @@ See the Mulan PSL v2 for more details. */
 #ifndef __OBSERVER_STORAGE_COMMON_INDEX_MANAGER_H_
 #define __OBSERVER_STORAGE_COMMON_INDEX_MANAGER_H_
 
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <utility>
+
 #include "record_manager.h"
 #include "storage/default/disk_buffer_pool.h"
 #include "sql/parser/parse_defs.h"
 
+#define BPLUS_TREE_CACHED_INNER_NODES 256  // 每个索引最多缓存的内部节点个数，从根开始按查找的路径加入
+#define BPLUS_TREE_APPEND_SPLIT_RIGHT 10    // 在最右边的叶子末尾插入导致分裂时，新叶子只分到百分之几的key
+#define BPLUS_TREE_FILE_FORMAT 0x42540002  // 索引文件的格式，节点中的key按前缀压缩成变长的格式保存
+
 struct IndexFileHeader {
   int attr_length;
   int key_length;
   AttrType attr_type;
   PageNum root_page; // 初始时，root_page一定是1
   int node_num;
-  int order;
+  int format;        // BPLUS_TREE_FILE_FORMAT，旧格式的文件这里是节点的阶数
+};
+
+/**
+ * 索引key中的一个字段。多字段索引的属性值是各个字段按顺序拼在一起的
+ */
+struct IndexKeyColumn {
+  AttrType type;
+  int offset;
+  int length;
 };
 
+/**
+ * 解码之后的节点，key是定长的，属性值后面跟着rid。页面中保存的是压缩之后的变长格式，
+ * 修改时先解码，改完之后重新编码写回页面，放不下时才分裂。
+ * 叶子的rids[i]是第i个key的rid，next是下一个叶子；内部节点有key_num + 1个孩子，rids中只用page_num
+ */
 struct IndexNode {
   int is_leaf;
   int key_num;
   PageNum parent;
+  PageNum next;
   char *keys;
   RID *rids;
 };
@@ -50,32 +80,70 @@ struct Tree {
   TreeNode *root;
 };
 
+/**
+ * 并发控制：tree_latch_保护树的结构，叶子页面的内容用缓冲池的页面latch保护。
+ * 查找和扫描加tree_latch_的读锁，读叶子时再加叶子的读latch，内部节点只在持有写锁时修改，读的时候不用加latch。
+ * 插入和删除先乐观地加读锁找到叶子，加叶子的写latch，叶子不需要分裂或合并时只修改这个叶子；
+ * 否则放开之后加tree_latch_的写锁重新执行。节点中保存了父节点的页号，分裂时要修改被移动的孩子，
+ * 所以分裂和合并时锁住整棵树，而不是只锁住路径上的节点。
+ * find_leaf经过的内部节点复制一份缓存在内存中，父节点直接指向缓存的孩子，查找只需要从缓冲池读叶子；
+ * 内部节点只在加写锁修改树结构时变化，这时清空缓存，持有写锁期间不使用缓存
+ */
 class BplusTreeHandler {
 public:
+  BplusTreeHandler();
+  ~BplusTreeHandler();
+
   /**
    * 此函数创建一个名为fileName的索引。
-   * attrType描述被索引属性的类型，attrLength描述被索引属性的长度
+   * attrType描述被索引属性的类型，attrLength描述被索引属性的长度。
+   * 节点中的key是压缩过的，一个页面能放多少个key取决于key的内容，页面放不下三个最长的key时返回INVALID_ARGUMENT
+   */
+  RC create(const char *file_name, AttrType attr_type, int attr_length, int page_size = BP_PAGE_SIZE);
+  /**
+   * 创建多字段索引，key按字段顺序依次比较
    */
-  RC create(const char *file_name, AttrType attr_type, int attr_length);
+  RC create(const char *file_name, const AttrType attr_types[], const int attr_lengths[], int column_num,
+            int page_size = BP_PAGE_SIZE);
 
   /**
    * 打开名为fileName的索引文件。
    * 如果方法调用成功，则indexHandle为指向被打开的索引句柄的指针。
-   * 索引句柄用于在索引中插入或删除索引项，也可用于索引的扫描
+   * 索引句柄用于在索引中插入或删除索引项，也可用于索引的扫描。
+   * 文件头中只有总长度和第一个字段的类型，多字段索引需要传入创建时的字段，不传时当作单字段索引。
+   * 节点不是压缩格式的旧索引文件返回FORMAT，需要删除之后重新创建索引
    */
-  RC open(const char *file_name);
+  RC open(const char *file_name, const AttrType attr_types[] = nullptr, const int attr_lengths[] = nullptr,
+          int column_num = 0);
 
   /**
    * 关闭句柄indexHandle对应的索引文件
    */
   RC close();
+  /**
+   * 关闭索引文件，缓冲池中的页面直接丢弃，用于删除索引之前
+   */
+  RC drop();
+
+  /**
+   * 唯一性只检查前column_num个字段，后面的字段只是跟着key存放在叶子中，见IndexMeta::key_field_num。
+   * 不保存在文件中，每次创建或打开之后设置，0表示检查所有字段
+   */
+  void set_unique_column_num(int column_num)
+  {
+    unique_column_num_ = column_num;
+  }
 
   /**
    * 此函数向IndexHandle对应的索引中插入一个索引项。
    * 参数pData指向要插入的属性值，参数rid标识该索引项对应的元组，
-   * 即向索引中插入一个值为（*pData，rid）的键值对
+   * 即向索引中插入一个值为（*pData，rid）的键值对。
+   * unique为true时如果已经有属性值相同的索引项，返回RECORD_DUPLICATE_KEY。
+   * 检查在插入时找到的叶子上进行，只有插入位置在叶子开头时才需要再从根节点找一次。
+   * 比最右边叶子中所有key都大的key(自增的id、时间)不用从根节点查找，直接追加到这个叶子，
+   * 它满了时按90/10分裂，左边的叶子几乎是满的
    */
-  RC insert_entry(const char *pkey, const RID *rid);
+  RC insert_entry(const char *pkey, const RID *rid, bool unique = false);
 
   /**
    * 从IndexHandle句柄对应的索引中删除一个值为（*pData，rid）的索引项
@@ -89,85 +157,368 @@ public:
    */
   RC get_entry(const char *pkey, RID *rid);
 
+  /**
+   * 先写回缓存的修改，再刷新文件头和缓冲池中的页面
+   */
   RC sync();
+  /**
+   * 把缓存的插入和删除按key的顺序合并到树中，见set_bplus_tree_change_buffer。
+   * 查询、sync之前和后台整理时调用
+   */
+  RC merge_change_buffer();
+  /**
+   * 缓存中还没有合并到树中的修改个数
+   */
+  size_t buffered_changes() const;
+  /**
+   * 缓存的内部节点个数
+   */
+  size_t cached_inner_nodes();
+  /**
+   * 写回修改过的文件头之后把索引文件只读地映射到内存中，之后不能再修改
+   */
+  RC map_readonly();
 public:
   RC print();
   RC print_tree();
 protected:
+  class NodeFrame;
+
+  /**
+   * 持有tree_latch_读锁时只修改叶子的插入和删除。done为false时叶子需要分裂或合并，
+   * 或者唯一性检查需要读其它叶子，调用者要加写锁之后重新执行。pkey包含rid
+   */
+  RC insert_entry_optimistic(const char *pkey, const RID *rid, bool unique, bool *done);
+  RC delete_entry_optimistic(const char *pkey, bool *done);
+  /**
+   * 持有tree_latch_写锁时的插入，叶子满了时分裂
+   */
+  RC insert_entry_pessimistic(const char *pkey, const RID *rid, bool unique);
+
   RC find_leaf(const char *pkey, PageNum *leaf_page);
-  RC insert_into_leaf(PageNum leaf_page, const char *pkey, const RID *rid);
-  RC insert_into_leaf_after_split(PageNum leaf_page, const char *pkey, const RID *rid);
-  RC insert_into_parent(PageNum parent_page, PageNum leaf_page, const char *pkey, PageNum right_page);
-  RC insert_into_new_root(PageNum leaf_page, const char *pkey, PageNum right_page);
-  RC insert_intern_node(PageNum parent_page, PageNum leaf_page, PageNum right_page, const char *pkey);
-  RC insert_intern_node_after_split(PageNum intern_page, PageNum leaf_page, PageNum right_page, const char *pkey);
-
-  RC delete_entry_from_node(PageNum node_page, const char *pkey);
+  /**
+   * 节点中已经多插入了一个key，编码之后放不下，分成两个节点，分隔的key插入到父节点中。
+   * append为true时是在最右边的叶子末尾插入，新叶子只分到少量的key
+   */
+  RC split_node(NodeFrame &left, bool append);
+  RC insert_into_parent(PageNum parent_page, PageNum left_page, const char *pkey, PageNum right_page);
+  RC insert_into_new_root(PageNum left_page, const char *pkey, PageNum right_page);
+
   RC delete_entry_internal(PageNum page_num, const char *pkey);
-  RC coalesce_node(PageNum leaf_page, PageNum right_page);
+  RC coalesce_node(PageNum left_page, PageNum right_page);
+  /**
+   * 把两个节点的key重新平均分配。新的分隔key在父节点中放不下时不做修改
+   */
   RC redistribute_nodes(PageNum left_page, PageNum right_page);
 
-  RC find_first_index_satisfied(CompOp comp_op, const char *pkey, PageNum *page_num, int *rididx);
   RC get_first_leaf_page(PageNum *leaf_page);
+  /**
+   * 找到可能包含小于pkey的最大的key的叶子，pkey为nullptr时是最后一个叶子。
+   * 叶子中可能没有小于pkey的key，这时要用find_prev_leaf继续往前找。
+   * path记录从根往下经过的内部节点和孩子的位置，叶子之间没有指向前一个叶子的指针，往前走要靠它
+   */
+  RC find_leaf_before(const char *pkey, PageNum *leaf_page, std::vector<std::pair<PageNum, int>> &path);
+  /**
+   * 按照path找到前一个叶子，没有时leaf_page为-1。两次调用之间树的结构不能有变化
+   */
+  RC find_prev_leaf(std::vector<std::pair<PageNum, int>> &path, PageNum *leaf_page);
+
+  /**
+   * 唯一索引插入之前检查有没有属性值相同的key，leaf_page是pkey所在的叶子
+   */
+  RC check_unique(PageNum leaf_page, const char *pkey);
+  /**
+   * 在page_num及其后一个叶子中找和pkey属性值相同的key，只检查pkey插入位置pos前后相邻的key
+   */
+  RC find_equal_attr(PageNum page_num, const char *pkey, bool *found, int *pos);
+
+  /**
+   * 非唯一索引的插入和删除，叶子不在缓冲池中时只记到缓存里，不读叶子。
+   * 同一个key已经有缓存的修改时和它抵消。buffered为false时调用者按正常的方式修改树。pkey包含rid
+   */
+  RC buffer_change(const char *pkey, bool insert, bool *buffered);
 
 private:
-  IndexNode *get_index_node(char *page_data) const;
+  /**
+   * 每个页面中节点可以使用的空间，页面开头留着文件头的位置
+   */
+  int node_capacity() const;
+  /**
+   * 节点中的key的属性值共同的前缀长度，不包括所有key末尾都是0的部分
+   */
+  int prefix_length(const char *keys, int key_num) const;
+  /**
+   * 这些key编码之后节点占用的空间。key的属性值去掉共同的前缀和末尾的0，叶子中key的rid和索引项的rid相同，只存一份
+   */
+  int packed_size(bool is_leaf, const char *keys, int key_num) const;
+  bool node_fits(const IndexNode &node) const;
+  /**
+   * 删除之后节点是否太空，需要合并或者重新分配，叶子见bplus_tree_merge_threshold，内部节点是半满
+   */
+  bool node_underflow(const IndexNode &node) const;
+  /**
+   * 分裂的位置，尽量接近preferred，并且分开之后两边都放得下。没有这样的位置时返回-1
+   */
+  int choose_split(const IndexNode &node, int preferred) const;
+  /**
+   * 叶子分裂时放到父节点中的key：right_key的属性值最短的前缀，后面补0，rid取最小值，
+   * 只要它大于left_key并且不大于right_key。找不到时就是right_key
+   */
+  void make_separator(const char *left_key, const char *right_key, char *separator) const;
+  /**
+   * 只修改页面中节点头部的父节点页号，不用解码整个节点
+   */
+  RC set_parent(PageNum page_num, PageNum parent);
+
+  struct CachedNode;
+  /**
+   * 缓存的修改按完整的key排序，合并时依次访问的叶子是相邻的
+   */
+  struct ChangeKeyLess {
+    const BplusTreeHandler *handler;
+    bool operator()(const std::string &key1, const std::string &key2) const;
+  };
+  /**
+   * slot中还没有缓存的节点时读出page_num，是内部节点并且缓存没满时加入缓存，放到slot中。
+   * page_num是叶子时is_leaf为true，没有加入缓存时node为nullptr
+   */
+  RC load_cached_node(PageNum page_num, std::atomic<CachedNode *> &slot, CachedNode **node, bool *is_leaf);
+  /**
+   * 修改树结构之前调用，清空内部节点的缓存，之后到end_structure_change之前不再使用缓存。调用者持有写锁
+   */
+  void begin_structure_change();
+  void end_structure_change();
+
+  /**
+   * 设置key中的字段并选择比较函数，字段要和文件头中的长度、类型对得上
+   */
+  RC init_key_columns(const AttrType attr_types[], const int attr_lengths[], int column_num);
+  /**
+   * 根据索引字段的类型选择比较和查找函数，create和open时调用
+   */
+  RC init_comparator();
+  /**
+   * 节点中第一个不小于pkey的key的位置，没有时返回key_num。pkey包含rid
+   */
+  int lower_bound(const IndexNode *node, const char *pkey) const;
+  /**
+   * 节点中第一个大于pkey的key的位置，没有时返回key_num
+   */
+  int upper_bound(const IndexNode *node, const char *pkey) const;
+  /**
+   * 比较两个完整的key，属性值相同时比较rid
+   */
+  int compare_key(const char *key1, const char *key2) const;
+  /**
+   * 只比较属性值
+   */
+  int compare_attr(const char *value1, const char *value2) const;
+  /**
+   * 只比较前column_num个字段
+   */
+  int compare_attr_prefix(const char *value1, const char *value2, int column_num) const;
+  /**
+   * 比较唯一性检查的那几个字段
+   */
+  int compare_unique_attr(const char *value1, const char *value2) const;
+  /**
+   * 把属性值中从from_column开始的字段填成最小或最大值，用来定位只指定了前几个字段的边界
+   */
+  void fill_key_columns(char *value, int from_column, bool max_value) const;
 
 private:
   DiskBufferPool  * disk_buffer_pool_ = nullptr;
   int               file_id_ = -1;
   bool              header_dirty_ = false;
   IndexFileHeader   file_header_;
+  std::vector<IndexKeyColumn> key_columns_;
+  int               unique_column_num_ = 0;
+  int            (* attr_comparator_)(const char *value1, const char *value2, int attr_length,
+                                      const IndexKeyColumn *columns, int column_num) = nullptr;
+  int            (* key_comparator_)(const char *key1, const char *key2, int attr_length,
+                                     const IndexKeyColumn *columns, int column_num) = nullptr;
+  int            (* key_searcher_)(const char *keys, int key_num, int key_length, int attr_length,
+                                   const IndexKeyColumn *columns, int column_num,
+                                   const char *pkey, bool upper) = nullptr;
+
+  pthread_rwlock_t  tree_latch_;
+  int64_t           smo_count_ = 0;   // 加写锁修改的次数，扫描时用来判断叶子有没有可能被分裂或者释放
+
+  std::mutex        cache_mutex_;     // 保护缓存节点的加入，读取缓存不用加锁
+  std::atomic<CachedNode *> cached_root_{nullptr};
+  std::atomic<bool> root_is_leaf_{false};
+  std::atomic<bool> cache_full_{false};
+  std::atomic<PageNum> rightmost_leaf_{-1};  // 最右边的叶子，递增的key直接插入到这里，修改树结构时失效
+  std::vector<std::unique_ptr<CachedNode>> cached_nodes_;
+  bool              structure_changing_ = false;
+
+  std::mutex        change_mutex_;    // 保护changes_，修改时还要持有tree_latch_读锁
+  std::map<std::string, bool, ChangeKeyLess> changes_;  // 缓存的修改，true是插入，false是删除
+  std::atomic<size_t> change_count_{0};
 
 private:
   friend class BplusTreeScanner;
+  friend class BplusTreeBulkLoader;
+  friend class StructureChangeGuard;
 };
 
 class BplusTreeScanner {
 public:
   BplusTreeScanner(BplusTreeHandler &index_handler);
+  ~BplusTreeScanner();
 
   /**
    * 用于在indexHandle对应的索引上初始化一个基于条件的扫描。
-   * compOp和*value指定比较符和比较值，indexScan为初始化后的索引扫描结构指针
-   * 没有带两个边界的范围扫描
+   * compOp和*value指定比较符和比较值，转换成open_range的范围，多字段索引只比较第一个字段。
+   * 没法用范围表示的比较符会扫描整个索引，调用者需要再按条件过滤
    */
   RC open(CompOp comp_op, const char *value, int null_index = -1);
 
+  /**
+   * 范围扫描，返回属性值在low和high之间的索引项，low或high为nullptr表示没有这个边界，
+   * inclusive表示是否包含边界上的值。从下界所在的叶子开始，超过上界时结束
+   */
+  RC open_range(const char *low, bool low_inclusive, const char *high, bool high_inclusive);
+  /**
+   * 多字段索引的前缀范围扫描，low和high只包含前low_column_num和high_column_num个字段，
+   * 只按这些字段和边界比较。column_num为0时等同于没有这个边界。
+   * reverse为true时从上界开始按从大到小的顺序返回，低于下界时结束
+   */
+  RC open_range(const char *low, int low_column_num, bool low_inclusive,
+                const char *high, int high_column_num, bool high_inclusive, bool reverse = false);
+
   /**
    * 用于继续索引扫描，获得下一个满足条件的索引项，
-   * 并返回该索引项对应的记录的ID
+   * 并返回该索引项对应的记录的ID。key不为nullptr时同时复制索引项的属性值，长度为attr_length
    */
-  RC next_entry(RID *rid);
+  RC next_entry(RID *rid, char *key = nullptr);
 
   /**
    * 关闭一个索引扫描，释放相应的资源
    */
   RC close();
 
+private:
+  void copy_value(char *dest, const char *value, int column_num) const;
   /**
-   * 获取由fileName指定的B+树索引内容，返回指向B+树的指针。
-   * 此函数提供给测试程序调用，用于检查B+树索引内容的正确性
+   * 读取下一个叶子中满足条件的索引项。每次复制一个叶子的内容，两次调用之间不固定页面，
+   * 有分裂或合并发生过时从上次返回的key重新查找叶子
    */
-  // RC getIndexTree(char *fileName, Tree *index);
-
-private:
-  RC get_next_idx_in_memory(RID *rid);
-  RC find_idx_pages();
-  bool satisfy_condition(const char *key);
+  RC fetch_next_leaf();
+  /**
+   * 逆序扫描时读取前一个叶子中满足条件的索引项，按从大到小的顺序放到keys_中
+   */
+  RC fetch_prev_leaf();
 
 private:
   BplusTreeHandler   & index_handler_;
   bool opened_ = false;
-  CompOp comp_op_ = NO_OP;                      // 用于比较的操作符
-  const char *value_ = nullptr;		              // 与属性行比较的值  就是condition 中的值
-  int num_fixed_pages_ = -1;                    // 固定在缓冲区中的页，与指定的页面固定策略有关
-  int pinned_page_count_ = 0;                   // 实际固定在缓冲区的页面数
-  BPPageHandle page_handles_[BP_BUFFER_SIZE];   // 固定在缓冲区页面所对应的页面操作列表
-  int next_index_of_page_handle_ = -1;          // 当前被扫描页面的操作索引
-  int index_in_node_ = -1;                      // 当前B+ Tree页面上的key index
-  PageNum next_page_num_ = -1;                  // 下一个将要被读入的页面号
-  int null_index_ = -1;
+  std::vector<char> high_value_;                // 上界的属性值，为空表示没有上界
+  int high_column_num_ = 0;                     // 上界包含的字段数
+  bool high_inclusive_ = false;
+  std::vector<char> low_key_;                   // 下界，包含rid，为空表示没有下界
+  bool low_inclusive_ = false;
+  bool started_ = false;                        // 是否已经读取过叶子
+  bool eof_ = false;
+  bool reverse_ = false;                        // 是否从大到小扫描
+  std::vector<char> high_key_;                  // 逆序扫描时的起点，只返回小于它的key，为空表示没有上界
+  std::vector<std::pair<PageNum, int>> path_;   // 逆序扫描时从根到上一个叶子的路径
+  std::vector<char> last_key_;                  // 上一个叶子中最后返回的key，包含rid
+  PageNum next_page_ = -1;                      // 上一个叶子的下一个叶子
+  int64_t smo_count_ = 0;                       // 读取上一个叶子时树的修改次数
+  std::vector<char> keys_;                      // 当前叶子中满足条件的key，只有属性值
+  std::vector<RID> rids_;
+  size_t index_in_batch_ = 0;                   // keys_中下一个要返回的项
+};
+
+/**
+ * 批量建索引时节点填满的百分比，剩下的空间留给之后的插入，避免建完之后马上分裂。
+ * 取值50到100，默认90
+ */
+RC set_bplus_tree_fill_factor(int fill_factor);
+int bplus_tree_fill_factor();
+
+/**
+ * 删除之后叶子占用的空间少于页面的这个百分比时，才和兄弟节点合并或者重新分配key。
+ * 50在叶子不到半满时立即合并；小的值让叶子可以一直半空，先删除再插入时不会反复地合并、分裂，
+ * 到了这个值之后能放进一个叶子就合并。0只在叶子删空时合并。取值0到50，默认50
+ */
+RC set_bplus_tree_merge_threshold(int threshold);
+int bplus_tree_merge_threshold();
+
+/**
+ * 非唯一索引最多缓存的修改个数，0不缓存。叶子不在缓冲池中时插入和删除先缓存起来，
+ * 满了、查询这个索引或者后台整理时按key的顺序一起写到叶子上，减少随机读。
+ * 缓存的修改只在内存中，和redo日志一起使用时要关闭
+ */
+RC set_bplus_tree_change_buffer(int max_changes);
+int bplus_tree_change_buffer();
+
+/**
+ * 批量建索引时在内存中排序的数据量，超过之后排好序写到临时文件中，最后再归并
+ */
+const size_t BULK_LOAD_SORT_MEMORY = 64 * 1024 * 1024;
+
+/**
+ * 自底向上批量建索引。add_entry收集所有的(属性值, rid)，finish时排好序从左到右依次填满叶子，
+ * 节点占用的空间到了fill_factor时新开一个节点，分隔的key加到上一层，上一层满了再往上加，
+ * 叶子和内部节点都按顺序分配页面，不会发生分裂。只能用在刚创建的空B+树上
+ */
+class BplusTreeBulkLoader {
+public:
+  BplusTreeBulkLoader(BplusTreeHandler &handler, int fill_factor = bplus_tree_fill_factor(),
+                      size_t sort_memory = BULK_LOAD_SORT_MEMORY);
+  ~BplusTreeBulkLoader();
+
+  /**
+   * unique为true的索引项之间属性值不能相同，否则finish时返回RECORD_DUPLICATE_KEY
+   */
+  RC add_entry(const char *pkey, const RID *rid, bool unique = false);
+  /**
+   * 排序并生成B+树。失败时树中只有一部分索引项，调用者应该删除索引文件
+   */
+  RC finish();
+
+private:
+  /**
+   * 写到临时文件中的一段排好序的索引项
+   */
+  struct Run {
+    FILE *file;
+    std::vector<char> entry;  // 当前读到的索引项
+  };
+  int compare_entry(const char *entry1, const char *entry2) const;
+  void sort_buffer();
+  RC spill_run();
+  RC read_run(Run &run, bool *eof);
+  RC start_merge();
+  RC next_entry(const char **entry);
+
+  /**
+   * 节点占用的空间是否已经到了fill_factor
+   */
+  bool overfilled(const IndexNode &node) const;
+  RC append_leaf(const char *key, const RID &rid);
+  /**
+   * 把分隔的key和它右边的孩子加到level层最右边的节点中，放不下时新开一个节点，
+   * 新节点的第一个孩子是child，key再加到上一层。下面一层第一次有第二个节点时新建这一层
+   */
+  RC append_child(size_t level, const char *key, PageNum child);
+
+private:
+  BplusTreeHandler &handler_;
+  int fill_factor_;
+  size_t sort_memory_;
+  int entry_length_;                 // key之后多一个字节表示是否检查唯一
+  long long entry_num_ = 0;
+  std::vector<char> buffer_;
+  std::vector<int> order_;           // buffer_中的索引项排序之后的顺序
+  size_t next_ = 0;
+  std::vector<Run> runs_;
+  std::vector<int> heap_;            // 归并时每个临时文件当前的索引项组成的小顶堆
+  int last_run_ = -1;
+  std::vector<std::unique_ptr<BplusTreeHandler::NodeFrame>> levels_;  // 每层最右边的节点，从叶子开始
+  int leaf_num_ = 0;
 };
 
 #endif //__OBSERVER_STORAGE_COMMON_INDEX_MANAGER_H_
\ No newline at end of file
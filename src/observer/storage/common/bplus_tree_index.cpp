@@ -20,41 +20,50 @@ BplusTreeIndex::~BplusTreeIndex() noexcept
   close();
 }
 
-RC BplusTreeIndex::create(const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta) {
+RC BplusTreeIndex::create(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas,
+                          int page_size) {
   if (inited_) {
     LOG_INFO("BplusTreeIndex::create - RC::RECORD_OPENNED");
     return RC::RECORD_OPENNED;
   }
 
-  RC rc = Index::init(index_meta, field_meta);
+  RC rc = Index::init(index_meta, field_metas);
   if (rc != RC::SUCCESS)
   {
     return rc;
   }
 
-  rc = index_handler_.create(file_name, field_meta.type(), field_meta.len());
+  std::vector<AttrType> types;
+  std::vector<int> lengths;
+  key_columns(types, lengths);
+  rc = index_handler_.create(file_name, types.data(), lengths.data(), (int)types.size(), page_size);
   if (RC::SUCCESS == rc)
   {
+    index_handler_.set_unique_column_num(index_meta.key_field_num());
     inited_ = true;
   }
   return rc;
 }
 
-RC BplusTreeIndex::open(const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta)
+RC BplusTreeIndex::open(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas)
 {
   if (inited_)
   {
     return RC::RECORD_OPENNED;
   }
-  RC rc = Index::init(index_meta, field_meta);
+  RC rc = Index::init(index_meta, field_metas);
   if (rc != RC::SUCCESS)
   {
     return rc;
   }
 
-  rc = index_handler_.open(file_name);
+  std::vector<AttrType> types;
+  std::vector<int> lengths;
+  key_columns(types, lengths);
+  rc = index_handler_.open(file_name, types.data(), lengths.data(), (int)types.size());
   if (RC::SUCCESS == rc)
   {
+    index_handler_.set_unique_column_num(index_meta.key_field_num());
     inited_ = true;
   }
   return rc;
@@ -62,6 +71,8 @@ RC BplusTreeIndex::open(const char *file_name, const IndexMeta &index_meta, cons
 
 RC BplusTreeIndex::close()
 {
+  delete bulk_loader_;
+  bulk_loader_ = nullptr;
   if (inited_)
   {
     index_handler_.close();
@@ -70,18 +81,49 @@ RC BplusTreeIndex::close()
   return RC::SUCCESS;
 }
 
+RC BplusTreeIndex::drop()
+{
+  delete bulk_loader_;
+  bulk_loader_ = nullptr;
+  RC rc = RC::SUCCESS;
+  if (inited_)
+  {
+    rc = index_handler_.drop();
+    inited_ = false;
+  }
+  return rc;
+}
+
 RC BplusTreeIndex::insert_entry(const char *record, const RID *rid)
 {
-  return index_handler_.insert_entry(record + field_meta_.offset(), rid);
+  const bool unique = check_unique(record);
+  if (field_metas_.size() == 1)
+  {
+    return index_handler_.insert_entry(record + field_metas_[0].offset(), rid, unique);
+  }
+  std::vector<char> key;
+  make_key(record, key);
+  return index_handler_.insert_entry(key.data(), rid, unique);
 }
 
 RC BplusTreeIndex::delete_entry(const char *record, const RID *rid)
 {
-  return index_handler_.delete_entry(record + field_meta_.offset(), rid);
+  if (field_metas_.size() == 1)
+  {
+    return index_handler_.delete_entry(record + field_metas_[0].offset(), rid);
+  }
+  std::vector<char> key;
+  make_key(record, key);
+  return index_handler_.delete_entry(key.data(), rid);
 }
 
 IndexScanner *BplusTreeIndex::create_scanner(CompOp comp_op, const char *value, int null_field_index)
 {
+  if (index_meta_.prefix_length(0) > 0)
+  {
+    // 前缀相同的值在索引中是相等的，不包含边界会漏掉前缀等于边界的记录
+    comp_op = comp_op == GREAT_THAN ? GREAT_EQUAL : (comp_op == LESS_THAN ? LESS_EQUAL : comp_op);
+  }
   BplusTreeScanner *bplus_tree_scanner = new BplusTreeScanner(index_handler_);
   RC rc = bplus_tree_scanner->open(comp_op, value, null_field_index);
   if (rc != RC::SUCCESS)
@@ -95,11 +137,92 @@ IndexScanner *BplusTreeIndex::create_scanner(CompOp comp_op, const char *value,
   return index_scanner;
 }
 
+IndexScanner *BplusTreeIndex::create_range_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                                   const char *high, int high_column_num, bool high_inclusive)
+{
+  return create_ordered_scanner(low, low_column_num, low_inclusive, high, high_column_num, high_inclusive, false);
+}
+
+IndexScanner *BplusTreeIndex::create_ordered_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                                     const char *high, int high_column_num, bool high_inclusive,
+                                                     bool descending)
+{
+  // 同上，边界落在只索引前缀的字段上时要包含边界
+  if (low_column_num > 0 && index_meta_.prefix_length(low_column_num - 1) > 0)
+  {
+    low_inclusive = true;
+  }
+  if (high_column_num > 0 && index_meta_.prefix_length(high_column_num - 1) > 0)
+  {
+    high_inclusive = true;
+  }
+  BplusTreeScanner *bplus_tree_scanner = new BplusTreeScanner(index_handler_);
+  RC rc = bplus_tree_scanner->open_range(low, low_column_num, low_inclusive, high, high_column_num, high_inclusive,
+                                         descending);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to open index range scanner. rc=%d:%s", rc, strrc(rc));
+    delete bplus_tree_scanner;
+    return nullptr;
+  }
+
+  BplusTreeIndexScanner *index_scanner = new BplusTreeIndexScanner(bplus_tree_scanner);
+  return index_scanner;
+}
+
 RC BplusTreeIndex::sync()
 {
   return index_handler_.sync();
 }
 
+RC BplusTreeIndex::merge_changes()
+{
+  return index_handler_.merge_change_buffer();
+}
+
+RC BplusTreeIndex::map_readonly()
+{
+  return index_handler_.map_readonly();
+}
+
+RC BplusTreeIndex::begin_bulk_load()
+{
+  if (!inited_ || bulk_loader_ != nullptr)
+  {
+    return RC::GENERIC_ERROR;
+  }
+  bulk_loader_ = new BplusTreeBulkLoader(index_handler_);
+  return RC::SUCCESS;
+}
+
+RC BplusTreeIndex::bulk_load_entry(const char *record, const RID *rid)
+{
+  if (bulk_loader_ == nullptr)
+  {
+    return RC::GENERIC_ERROR;
+  }
+  const bool unique = check_unique(record);
+  if (field_metas_.size() == 1)
+  {
+    return bulk_loader_->add_entry(record + field_metas_[0].offset(), rid, unique);
+  }
+  std::vector<char> key;
+  make_key(record, key);
+  return bulk_loader_->add_entry(key.data(), rid, unique);
+}
+
+RC BplusTreeIndex::end_bulk_load()
+{
+  if (bulk_loader_ == nullptr)
+  {
+    return RC::GENERIC_ERROR;
+  }
+  RC rc = bulk_loader_->finish();
+  delete bulk_loader_;
+  bulk_loader_ = nullptr;
+  return rc;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 BplusTreeIndexScanner::BplusTreeIndexScanner(BplusTreeScanner *tree_scanner) : tree_scanner_(tree_scanner)
 {
@@ -116,6 +239,11 @@ RC BplusTreeIndexScanner::next_entry(RID *rid)
   return tree_scanner_->next_entry(rid);
 }
 
+RC BplusTreeIndexScanner::next_entry(RID *rid, char *key)
+{
+  return tree_scanner_->next_entry(rid, key);
+}
+
 RC BplusTreeIndexScanner::destroy()
 {
   delete this;
@@ -23,20 +23,37 @@ public:
   BplusTreeIndex() = default;
   virtual ~BplusTreeIndex() noexcept;
 
-  RC create(const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta);
-  RC open(const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta);
+  RC create(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas,
+            int page_size = BP_PAGE_SIZE) override;
+  RC open(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas) override;
   RC close();
+  RC drop() override;
 
   RC insert_entry(const char *record, const RID *rid) override;
   RC delete_entry(const char *record, const RID *rid) override;
 
   IndexScanner *create_scanner(CompOp comp_op, const char *value, int null_field_index) override;
+  IndexScanner *create_range_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                     const char *high, int high_column_num, bool high_inclusive) override;
+  IndexScanner *create_ordered_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                       const char *high, int high_column_num, bool high_inclusive,
+                                       bool descending) override;
 
   RC sync() override;
+  RC merge_changes() override;
+  RC map_readonly() override;
+
+  /**
+   * 排好序之后自底向上生成B+树
+   */
+  RC begin_bulk_load() override;
+  RC bulk_load_entry(const char *record, const RID *rid) override;
+  RC end_bulk_load() override;
 
 private:
   bool inited_ = false;
   BplusTreeHandler index_handler_;
+  BplusTreeBulkLoader *bulk_loader_ = nullptr;
 };
 
 class BplusTreeIndexScanner : public IndexScanner {
@@ -45,6 +62,7 @@ public:
   ~BplusTreeIndexScanner() noexcept override;
 
   RC next_entry(RID *rid) override;
+  RC next_entry(RID *rid, char *key) override;
   RC destroy() override;
 private:
   BplusTreeScanner * tree_scanner_;
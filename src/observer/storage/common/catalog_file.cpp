@@ -0,0 +1,226 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Binary catalog holding the table metas of a db.
+//
+
+#include "storage/common/catalog_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/log/log.h"
+#include "storage/common/meta_util.h"
+#include "storage/common/table_meta.h"
+
+static uint32_t catalog_checksum(const char *data, size_t len)
+{
+  // FNV-1a
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (uint8_t)data[i];
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+static RC write_fully(int fd, const void *data, size_t size)
+{
+  const char *p = (const char *)data;
+  while (size > 0) {
+    ssize_t n = ::write(fd, p, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return RC::IOERR_WRITE;
+    }
+    p += n;
+    size -= n;
+  }
+  return RC::SUCCESS;
+}
+
+static RC meta_file_stamp(const std::string &meta_file_path, int64_t *inode, int64_t *size, int64_t *mtime)
+{
+  struct stat st;
+  if (::stat(meta_file_path.c_str(), &st) != 0) {
+    LOG_WARN("Failed to stat table meta file %s: %s", meta_file_path.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  *inode = st.st_ino;
+  *size = st.st_size;
+  *mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+  return RC::SUCCESS;
+}
+
+CatalogFile::~CatalogFile()
+{
+  close();
+}
+
+RC CatalogFile::load(const std::string &file)
+{
+  close();
+  int fd = ::open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG_INFO("Catalog file %s can not be opened: %s", file.c_str(), strerror(errno));
+    return errno == ENOENT ? RC::NOTFOUND : RC::IOERR_ACCESS;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CatalogFileHeader)) {
+    LOG_WARN("Invalid catalog file %s. size=%ld", file.c_str(), (long)st.st_size);
+    ::close(fd);
+    return RC::CORRUPT;
+  }
+  void *data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    LOG_WARN("Failed to mmap catalog file %s: %s", file.c_str(), strerror(errno));
+    return RC::IOERR_READ;
+  }
+  mapped_ = (char *)data;
+  mapped_size_ = st.st_size;
+
+  CatalogFileHeader header;
+  memcpy(&header, mapped_, sizeof(header));
+  const char *body = mapped_ + sizeof(header);
+  const size_t body_len = mapped_size_ - sizeof(header);
+  if (header.magic != CATALOG_FILE_MAGIC || header.version != CATALOG_FILE_VERSION || header.table_num < 0 ||
+      header.checksum != catalog_checksum(body, body_len)) {
+    LOG_WARN("Invalid catalog file %s. magic=%x, version=%u, table num=%d",
+             file.c_str(), header.magic, header.version, header.table_num);
+    close();
+    return RC::CORRUPT;
+  }
+
+  MetaReader reader(body, body_len);
+  for (int i = 0; i < header.table_num; i++) {
+    std::string table_name;
+    Slot slot;
+    int32_t len = 0;
+    if (!reader.get_string(&table_name) || !reader.get_int64(&slot.meta_inode) || !reader.get_int64(&slot.meta_size) ||
+        !reader.get_int64(&slot.meta_mtime) || !reader.get_int32(&len) || !reader.get_bytes(len, &slot.data)) {
+      LOG_WARN("Catalog file %s is truncated at table %d", file.c_str(), i);
+      close();
+      return RC::CORRUPT;
+    }
+    slot.len = len;
+    slots_[table_name] = slot;
+  }
+  LOG_INFO("Load catalog from %s. tables=%d", file.c_str(), header.table_num);
+  return RC::SUCCESS;
+}
+
+void CatalogFile::close()
+{
+  slots_.clear();
+  if (mapped_ != nullptr) {
+    ::munmap(mapped_, mapped_size_);
+    mapped_ = nullptr;
+    mapped_size_ = 0;
+  }
+}
+
+RC CatalogFile::find(const char *table_name, const std::string &meta_file_path, TableMeta &table_meta) const
+{
+  auto iter = slots_.find(table_name);
+  if (iter == slots_.end()) {
+    return RC::NOTFOUND;
+  }
+  int64_t inode = 0;
+  int64_t size = 0;
+  int64_t mtime = 0;
+  RC rc = meta_file_stamp(meta_file_path, &inode, &size, &mtime);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  const Slot &slot = iter->second;
+  if (inode != slot.meta_inode || size != slot.meta_size || mtime != slot.meta_mtime) {
+    LOG_INFO("Table meta file %s was changed after the catalog had been saved", meta_file_path.c_str());
+    return RC::NOTFOUND;
+  }
+  return table_meta.deserialize_binary(slot.data, slot.len);
+}
+
+bool CatalogFile::entry(const char *table_name, CatalogEntry &entry) const
+{
+  auto iter = slots_.find(table_name);
+  if (iter == slots_.end()) {
+    return false;
+  }
+  entry.table_name = table_name;
+  entry.meta_inode = iter->second.meta_inode;
+  entry.meta_size = iter->second.meta_size;
+  entry.meta_mtime = iter->second.meta_mtime;
+  entry.data.assign(iter->second.data, iter->second.len);
+  return true;
+}
+
+RC CatalogFile::make_entry(const TableMeta &table_meta, const std::string &meta_file_path, CatalogEntry &entry)
+{
+  RC rc = meta_file_stamp(meta_file_path, &entry.meta_inode, &entry.meta_size, &entry.meta_mtime);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  entry.table_name = table_meta.name();
+  entry.data.clear();
+  table_meta.serialize_binary(entry.data);
+  return RC::SUCCESS;
+}
+
+RC CatalogFile::save(const std::string &file, const std::vector<CatalogEntry> &entries)
+{
+  std::string body;
+  MetaWriter writer(body);
+  for (const CatalogEntry &entry : entries) {
+    writer.put_string(entry.table_name);
+    writer.put_int64(entry.meta_inode);
+    writer.put_int64(entry.meta_size);
+    writer.put_int64(entry.meta_mtime);
+    writer.put_string(entry.data);
+  }
+
+  CatalogFileHeader header;
+  header.magic = CATALOG_FILE_MAGIC;
+  header.version = CATALOG_FILE_VERSION;
+  header.table_num = (int32_t)entries.size();
+  header.checksum = catalog_checksum(body.data(), body.size());
+
+  std::string tmp_file = file + ".tmp";
+  int fd = ::open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IREAD | S_IWRITE);
+  if (fd < 0) {
+    LOG_ERROR("Failed to create catalog file %s: %s", tmp_file.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  RC rc = write_fully(fd, &header, sizeof(header));
+  if (rc == RC::SUCCESS) {
+    rc = write_fully(fd, body.data(), body.size());
+  }
+  if (rc == RC::SUCCESS && ::fsync(fd) != 0) {
+    rc = RC::IOERR_FSYNC;
+  }
+  ::close(fd);
+  if (rc == RC::SUCCESS && ::rename(tmp_file.c_str(), file.c_str()) != 0) {
+    rc = RC::IOERR_WRITE;
+  }
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to save catalog file %s. rc=%d:%s, error=%s", file.c_str(), rc, strrc(rc), strerror(errno));
+    ::unlink(tmp_file.c_str());
+    return rc;
+  }
+  LOG_INFO("Save catalog to %s. tables=%d", file.c_str(), header.table_num);
+  return RC::SUCCESS;
+}
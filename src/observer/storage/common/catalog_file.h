@@ -0,0 +1,109 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Binary catalog holding the table metas of a db.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_CATALOG_FILE_H_
+#define __OBSERVER_STORAGE_COMMON_CATALOG_FILE_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rc.h"
+
+class TableMeta;
+
+#define CATALOG_FILE_MAGIC 0x474C5443  // "CTLG"
+#define CATALOG_FILE_VERSION 6
+
+/**
+ * catalog文件的头部，之后依次是每张表的条目。checksum覆盖头部之后的所有内容
+ */
+struct CatalogFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  int32_t table_num;
+  uint32_t checksum;
+};
+
+/**
+ * catalog中的一张表，meta_inode、meta_size和meta_mtime是写出时这张表的JSON元数据文件的inode、大小和修改时间(纳秒)。
+ * 元数据文件总是写到临时文件再改名，修改之后inode也会变化
+ */
+struct CatalogEntry {
+  std::string table_name;
+  int64_t meta_inode = 0;
+  int64_t meta_size = 0;
+  int64_t meta_mtime = 0;
+  std::string data;  // TableMeta的二进制格式
+};
+
+/**
+ * 一个数据库中所有表的元数据，保存在数据库目录下的一个二进制文件中，打开数据库时用mmap读取，
+ * 不需要逐个解析每张表的JSON文件。
+ * 每张表的.table文件仍然是JSON格式，DDL总是先改这个文件，它才是最新的元数据。
+ * 和JSON文件对不上的表(比如catalog写出之后又建了索引)仍然从JSON文件读取，
+ * catalog在sync或者打开时发现有表对不上的时候重新写出
+ */
+class CatalogFile {
+public:
+  CatalogFile() = default;
+  ~CatalogFile();
+
+  /**
+   * 文件不存在、版本不对或者校验失败时返回失败，这时所有的表都要从JSON文件读取
+   */
+  RC load(const std::string &file);
+  void close();
+
+  /**
+   * 表的JSON文件meta_file_path和catalog中记录的一致时，从catalog解码元数据。
+   * 没有这张表或者对不上时返回NOTFOUND
+   */
+  RC find(const char *table_name, const std::string &meta_file_path, TableMeta &table_meta) const;
+  /**
+   * 复制catalog中一张表的条目，没有时返回false
+   */
+  bool entry(const char *table_name, CatalogEntry &entry) const;
+
+  int table_num() const
+  {
+    return (int)slots_.size();
+  }
+
+  /**
+   * 根据JSON元数据文件当前的状态生成条目
+   */
+  static RC make_entry(const TableMeta &table_meta, const std::string &meta_file_path, CatalogEntry &entry);
+  /**
+   * 先写到临时文件再改名，写到一半时原来的文件仍然有效
+   */
+  static RC save(const std::string &file, const std::vector<CatalogEntry> &entries);
+
+private:
+  struct Slot {
+    int64_t meta_inode;
+    int64_t meta_size;
+    int64_t meta_mtime;
+    const char *data;  // 指向映射的文件
+    int len;
+  };
+
+  char *mapped_ = nullptr;
+  size_t mapped_size_ = 0;
+  std::unordered_map<std::string, Slot> slots_;
+};
+
+#endif  // __OBSERVER_STORAGE_COMMON_CATALOG_FILE_H_
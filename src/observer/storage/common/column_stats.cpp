@@ -0,0 +1,321 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Column statistics collected by ANALYZE TABLE.
+//
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "storage/common/column_stats.h"
+#include "storage/common/field_meta.h"
+#include "storage/common/meta_util.h"
+#include "storage/common/partition_meta.h"
+#include "common/metrics/histogram_snapshot.h"
+#include "common/log/log.h"
+#include "json/json.h"
+
+const static Json::StaticString FIELD_NAME("name");
+const static Json::StaticString FIELD_NULL_FRACTION("null_fraction");
+const static Json::StaticString FIELD_DISTINCT_COUNT("distinct_count");
+const static Json::StaticString FIELD_HISTOGRAM("histogram");
+
+#define HLL_REGISTER_NUM (1 << COLUMN_STATS_HLL_PRECISION)
+
+void HyperLogLog::add(uint32_t hash)
+{
+  if (registers_.empty())
+  {
+    registers_.assign(HLL_REGISTER_NUM, 0);
+  }
+  // 高位选寄存器，剩下的位中第一个1的位置越靠后，说明见过的不同值越多
+  const uint32_t index = hash >> (32 - COLUMN_STATS_HLL_PRECISION);
+  const uint32_t rest = hash << COLUMN_STATS_HLL_PRECISION;
+  const uint8_t rank = rest == 0 ? 32 - COLUMN_STATS_HLL_PRECISION + 1 : __builtin_clz(rest) + 1;
+  registers_[index] = std::max(registers_[index], rank);
+}
+
+void HyperLogLog::merge(const HyperLogLog &other)
+{
+  if (registers_.empty())
+  {
+    registers_ = other.registers_;
+    return;
+  }
+  for (size_t i = 0; i < other.registers_.size(); i++)
+  {
+    registers_[i] = std::max(registers_[i], other.registers_[i]);
+  }
+}
+
+double HyperLogLog::estimate() const
+{
+  if (registers_.empty())
+  {
+    return 0;
+  }
+  const double m = HLL_REGISTER_NUM;
+  double sum = 0;
+  int zeros = 0;
+  for (uint8_t rank : registers_)
+  {
+    sum += ldexp(1.0, -rank);
+    zeros += rank == 0 ? 1 : 0;
+  }
+  double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+  // 值较少时很多寄存器还是0，用线性计数更准确；接近2^32时哈希冲突变多，需要修正
+  if (estimate <= 2.5 * m && zeros > 0)
+  {
+    estimate = m * log(m / zeros);
+  }
+  else if (estimate > 4294967296.0 / 30)
+  {
+    estimate = -4294967296.0 * log(1 - estimate / 4294967296.0);
+  }
+  return estimate;
+}
+
+void ColumnStats::set(double null_fraction, int64_t distinct_count, std::vector<double> &&histogram)
+{
+  valid_ = true;
+  null_fraction_ = null_fraction;
+  distinct_count_ = distinct_count;
+  histogram_ = std::move(histogram);
+}
+
+double ColumnStats::equal_selectivity() const
+{
+  return (1 - null_fraction_) / std::max<int64_t>(distinct_count_, 1);
+}
+
+double ColumnStats::fraction_below(double value) const
+{
+  if (value <= histogram_.front())
+  {
+    return 0;
+  }
+  if (value > histogram_.back())
+  {
+    return 1;
+  }
+  // 落在第bucket个桶中，桶内按均匀分布估计
+  const int bucket_num = (int)histogram_.size() - 1;
+  const int bucket =
+      std::min<int>(std::upper_bound(histogram_.begin(), histogram_.end(), value) - histogram_.begin() - 1,
+                    bucket_num - 1);
+  const double low = histogram_[bucket];
+  const double high = histogram_[bucket + 1];
+  const double in_bucket = high > low ? (value - low) / (high - low) : 1;
+  return (bucket + in_bucket) / bucket_num;
+}
+
+double ColumnStats::compare_selectivity(CompOp op, double value) const
+{
+  if (histogram_.size() < 2)
+  {
+    return -1;
+  }
+  const double below = fraction_below(value);
+  const double equal = 1.0 / std::max<int64_t>(distinct_count_, 1);
+  double fraction = 0;
+  switch (op)
+  {
+  case LESS_THAN:
+    fraction = below;
+    break;
+  case LESS_EQUAL:
+    fraction = below + equal;
+    break;
+  case GREAT_THAN:
+    fraction = 1 - below - equal;
+    break;
+  case GREAT_EQUAL:
+    fraction = 1 - below;
+    break;
+  default:
+    return -1;
+  }
+  return std::min(1.0, std::max(0.0, fraction)) * (1 - null_fraction_);
+}
+
+void ColumnStats::to_json(const FieldMeta &field, Json::Value &json_value) const
+{
+  json_value[FIELD_NAME] = field.name();
+  json_value[FIELD_NULL_FRACTION] = null_fraction_;
+  json_value[FIELD_DISTINCT_COUNT] = (Json::Int64)distinct_count_;
+  if (!histogram_.empty())
+  {
+    Json::Value histogram_value;
+    for (double bound : histogram_)
+    {
+      histogram_value.append(bound);
+    }
+    json_value[FIELD_HISTOGRAM] = std::move(histogram_value);
+  }
+}
+
+RC ColumnStats::from_json(const Json::Value &json_value, ColumnStats &stats)
+{
+  const Json::Value &null_fraction_value = json_value[FIELD_NULL_FRACTION];
+  const Json::Value &distinct_count_value = json_value[FIELD_DISTINCT_COUNT];
+  const Json::Value &histogram_value = json_value[FIELD_HISTOGRAM];
+  if (!null_fraction_value.isNumeric() || !distinct_count_value.isIntegral() ||
+      (!histogram_value.isNull() && !histogram_value.isArray()))
+  {
+    LOG_ERROR("Invalid column statistics. json value=%s", json_value.toStyledString().c_str());
+    return RC::GENERIC_ERROR;
+  }
+  std::vector<double> histogram;
+  for (int i = 0; i < (int)histogram_value.size(); i++)
+  {
+    if (!histogram_value[i].isNumeric())
+    {
+      LOG_ERROR("Invalid histogram of column statistics. json value=%s", json_value.toStyledString().c_str());
+      return RC::GENERIC_ERROR;
+    }
+    histogram.push_back(histogram_value[i].asDouble());
+  }
+  stats.set(null_fraction_value.asDouble(), distinct_count_value.asInt64(), std::move(histogram));
+  return RC::SUCCESS;
+}
+
+static int64_t double_bits(double value)
+{
+  int64_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static double bits_double(int64_t bits)
+{
+  double value = 0;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void ColumnStats::to_binary(MetaWriter &writer) const
+{
+  writer.put_int64(double_bits(null_fraction_));
+  writer.put_int64(distinct_count_);
+  writer.put_int32((int32_t)histogram_.size());
+  for (double bound : histogram_)
+  {
+    writer.put_int64(double_bits(bound));
+  }
+}
+
+RC ColumnStats::from_binary(MetaReader &reader, ColumnStats &stats)
+{
+  int64_t null_fraction = 0;
+  int64_t distinct_count = 0;
+  int32_t bucket_bound_num = 0;
+  if (!reader.get_int64(&null_fraction) || !reader.get_int64(&distinct_count) ||
+      !reader.get_int32(&bucket_bound_num) || bucket_bound_num < 0)
+  {
+    LOG_ERROR("Failed to decode column statistics. data is truncated");
+    return RC::GENERIC_ERROR;
+  }
+  std::vector<double> histogram(bucket_bound_num);
+  for (int i = 0; i < bucket_bound_num; i++)
+  {
+    int64_t bound = 0;
+    if (!reader.get_int64(&bound))
+    {
+      LOG_ERROR("Failed to decode histogram of column statistics. data is truncated");
+      return RC::GENERIC_ERROR;
+    }
+    histogram[i] = bits_double(bound);
+  }
+  stats.set(bits_double(null_fraction), distinct_count, std::move(histogram));
+  return RC::SUCCESS;
+}
+
+bool ColumnStats::to_number(AttrType type, const void *value, double *number)
+{
+  switch (type)
+  {
+  case INTS:
+  case DATES:
+  {
+    int int_value = 0;
+    memcpy(&int_value, value, sizeof(int_value));
+    *number = int_value;
+    return true;
+  }
+  case FLOATS:
+  {
+    float float_value = 0;
+    memcpy(&float_value, value, sizeof(float_value));
+    *number = float_value;
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+ColumnStatsCollector::ColumnStatsCollector(common::RandomGenerator &random, const FieldMeta &field, const NullFlag &null_flag)
+    : field_(field), null_flag_(null_flag), values_(random, COLUMN_STATS_SAMPLE_SIZE)
+{}
+
+void ColumnStatsCollector::add(const char *record)
+{
+  if (null_flag_.test(record))
+  {
+    null_count_++;
+    return;
+  }
+  const char *value = record + field_.offset();
+  // FNV-1a的高位分布不够均匀，再混合一次，HyperLogLog用高位选寄存器
+  uint32_t hash = PartitionMeta::hash(field_, value);
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+  distinct_.add(hash);
+  double number = 0;
+  if (ColumnStats::to_number(field_.type(), value, &number))
+  {
+    values_.update(number);
+  }
+}
+
+void ColumnStatsCollector::build(int64_t sample_rows, int64_t total_rows, ColumnStats &stats)
+{
+  const int64_t non_null_rows = sample_rows - null_count_;
+  int64_t distinct = std::min<int64_t>(llround(distinct_.estimate()), non_null_rows);
+  if (non_null_rows > 0)
+  {
+    distinct = std::max<int64_t>(distinct, 1);
+  }
+  // 样本中几乎没有重复值的字段，没读到的页面中也大多是新的值；否则认为样本中已经包含了大部分的值
+  if (total_rows > sample_rows && distinct > non_null_rows * COLUMN_STATS_UNIQUE_RATIO)
+  {
+    distinct = distinct * total_rows / sample_rows;
+  }
+
+  std::vector<double> histogram;
+  if (values_.get_count() > 0)
+  {
+    values_.snapshot();
+    common::HistogramSnapShot *snapshot = (common::HistogramSnapShot *)values_.get_snapshot();
+    const int bucket_num = (int)std::min<size_t>(COLUMN_STATS_HISTOGRAM_BUCKETS, snapshot->size());
+    histogram.push_back(snapshot->get_min());
+    for (int i = 1; i < bucket_num; i++)
+    {
+      histogram.push_back(snapshot->get_value((double)i / bucket_num));
+    }
+    histogram.push_back(snapshot->get_max());
+  }
+  stats.set(sample_rows > 0 ? (double)null_count_ / sample_rows : 0, distinct, std::move(histogram));
+}
@@ -0,0 +1,142 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Column statistics collected by ANALYZE TABLE.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_COLUMN_STATS_H__
+#define __OBSERVER_STORAGE_COMMON_COLUMN_STATS_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "rc.h"
+#include "sql/parser/parse_defs.h"
+#include "common/math/random_generator.h"
+#include "common/metrics/uniform_reservoir.h"
+#include "storage/common/field_meta.h"
+
+#define COLUMN_STATS_HLL_PRECISION 10        // HyperLogLog用2^10个寄存器，标准误差约3%
+#define COLUMN_STATS_SAMPLE_SIZE 4096        // 每个字段最多保留这么多个值用来画直方图
+#define COLUMN_STATS_HISTOGRAM_BUCKETS 32    // 等深直方图的桶数
+#define COLUMN_STATS_UNIQUE_RATIO 0.9        // 样本中不同值的比例超过这个值时认为字段基本没有重复的值
+
+class MetaWriter;
+class MetaReader;
+
+namespace Json {
+class Value;
+} // namespace Json
+
+/**
+ * 估算不同值个数的HyperLogLog，只保存每个寄存器中最长的前导0个数，可以合并。
+ * 寄存器在第一次add时才分配，没有值时estimate为0
+ */
+class HyperLogLog {
+public:
+  void add(uint32_t hash);
+  void merge(const HyperLogLog &other);
+  double estimate() const;
+
+  size_t memory_size() const
+  {
+    return registers_.capacity();
+  }
+
+private:
+  std::vector<uint8_t> registers_;
+};
+
+/**
+ * 一个字段的统计信息。null_fraction是null值占所有记录的比例，distinct_count是不同的非null值的个数。
+ * 数值类型(INTS、FLOATS、DATES)还有等深直方图，histogram是从最小值到最大值的桶边界，
+ * 相邻两个边界之间的记录数相同。字符串没有直方图
+ */
+class ColumnStats {
+public:
+  ColumnStats() = default;
+
+  bool valid() const
+  {
+    return valid_;
+  }
+  double null_fraction() const
+  {
+    return null_fraction_;
+  }
+  int64_t distinct_count() const
+  {
+    return distinct_count_;
+  }
+  const std::vector<double> &histogram() const
+  {
+    return histogram_;
+  }
+
+  void set(double null_fraction, int64_t distinct_count, std::vector<double> &&histogram);
+
+  /**
+   * 字段等于一个值的记录占所有记录的比例
+   */
+  double equal_selectivity() const;
+  /**
+   * 字段满足 "字段 op value" 的记录占所有记录的比例，没有直方图时返回负数。op是比较大小的操作符
+   */
+  double compare_selectivity(CompOp op, double value) const;
+
+public:
+  void to_json(const FieldMeta &field, Json::Value &json_value) const;
+  static RC from_json(const Json::Value &json_value, ColumnStats &stats);
+  void to_binary(MetaWriter &writer) const;
+  static RC from_binary(MetaReader &reader, ColumnStats &stats);
+
+  /**
+   * 可以画直方图的类型返回true，number是按字段在记录中的格式保存的value对应的数
+   */
+  static bool to_number(AttrType type, const void *value, double *number);
+
+private:
+  /**
+   * 小于value的非null值占非null值的比例
+   */
+  double fraction_below(double value) const;
+
+private:
+  bool valid_ = false;
+  double null_fraction_ = 0;
+  int64_t distinct_count_ = 0;
+  std::vector<double> histogram_;
+};
+
+/**
+ * 从抽样读到的记录中收集一个字段的统计信息，null_flag是字段的null标志在记录中的位置
+ */
+class ColumnStatsCollector {
+public:
+  ColumnStatsCollector(common::RandomGenerator &random, const FieldMeta &field, const NullFlag &null_flag);
+
+  void add(const char *record);
+  /**
+   * sample_rows是读到的记录数，total_rows是估计的表中的记录数
+   */
+  void build(int64_t sample_rows, int64_t total_rows, ColumnStats &stats);
+
+private:
+  const FieldMeta &field_;
+  NullFlag null_flag_;
+  int64_t null_count_ = 0;
+  HyperLogLog distinct_;
+  common::UniformReservoir values_;
+};
+
+#endif // __OBSERVER_STORAGE_COMMON_COLUMN_STATS_H__
@@ -12,11 +12,17 @@ See the Mulan PSL v2 for more details. */
 // Created by Wangyunlai on 2021/5/7.
 //
 
+#include <limits.h>
 #include <stddef.h>
+#include <string.h>
 #include "condition_filter.h"
 #include "record_manager.h"
 #include "common/log/log.h"
 #include "storage/common/table.h"
+#include "storage/common/dictionary.h"
+#include "storage/common/scan_kernel.h"
+#include "common/lang/bitmap.h"
+#include "common/time/datetime.h"
 
 using namespace common;
 
@@ -24,17 +30,43 @@ ConditionFilter::~ConditionFilter()
 {
 }
 
+void ConditionFilter::filter(const char *const *records, int n, uint8_t *sel) const
+{
+  Record record;
+  for (int i = 0; i < n; i++)
+  {
+    record.data = (char *)records[i];
+    sel[i] = filter(record);
+  }
+}
+
+void ConditionFilter::filter_page(const char *first_record, int record_size, int capacity, char *bitmap) const
+{
+  Bitmap bits(bitmap, capacity);
+  Record record;
+  for (int index = bits.next_setted_bit(0); index >= 0; index = bits.next_setted_bit(index + 1))
+  {
+    record.data = (char *)first_record + index * record_size;
+    if (!filter(record))
+    {
+      bits.clear_bit(index);
+    }
+  }
+}
+
 DefaultConditionFilter::DefaultConditionFilter()
 {
   left_.is_attr = false;
   left_.attr_length = 0;
   left_.attr_offset = 0;
   left_.value = nullptr;
+  left_.dictionary = nullptr;
 
   right_.is_attr = false;
   right_.attr_length = 0;
   right_.attr_offset = 0;
   right_.value = nullptr;
+  right_.dictionary = nullptr;
 }
 DefaultConditionFilter::~DefaultConditionFilter()
 {
@@ -59,6 +91,7 @@ RC DefaultConditionFilter::init(const ConDesc &left, const ConDesc &right, AttrT
   attr_type_ = attr_type;
   comp_op_ = comp_op;
   another_attr_type_ = another_attr_type;
+  compile();
   // LOG_INFO("default condition filter init 完成 comp_op = %d", comp_op_);
   return RC::SUCCESS;
 }
@@ -85,20 +118,21 @@ RC DefaultConditionFilter::init(Table &table, const Condition &condition)
     const FieldMeta *field_left = table_meta.field(i);
     // const FieldMeta *field_left = table_meta.field(condition.left_attr.attribute_name);
     // 这里检查了where子句中的列名是否存在
-    left.attr_length = field_left->len();
+    left.attr_length = field_left->value_len();
     left.attr_offset = field_left->offset();
 
     left.value = nullptr;
+    left.dictionary = field_left->dictionary();
 
     type_left = field_left->type();
 
-    auto last_field = table_meta.field(table_meta.field_num() - 1);
-    left.null_field_index = last_field->offset() + last_field->len() + i - 1;
+    left.null_flag = table_meta.null_flag(i);
   }
   else
   {
     left.is_attr = false;
     left.value = condition.left_value.data; // 校验type 或者转换类型
+    left.dictionary = nullptr;
     type_left = condition.left_value.type;
 
     left.attr_length = 0;
@@ -117,19 +151,20 @@ RC DefaultConditionFilter::init(Table &table, const Condition &condition)
     const FieldMeta *field_right = table_meta.field(i);
     // const FieldMeta *field_right = table_meta.field(condition.right_attr.attribute_name);
     // 这里检查了where子句中的列名是否存在
-    right.attr_length = field_right->len();
+    right.attr_length = field_right->value_len();
     right.attr_offset = field_right->offset();
     type_right = field_right->type();
 
     right.value = nullptr;
+    right.dictionary = field_right->dictionary();
 
-    auto last_field = table_meta.field(table_meta.field_num() - 1);
-    right.null_field_index = last_field->offset() + last_field->len() + i - 1;
+    right.null_flag = table_meta.null_flag(i);
   }
   else
   {
     right.is_attr = false;
     right.value = condition.right_value.data;
+    right.dictionary = nullptr;
     type_right = condition.right_value.type;
 
     right.attr_length = 0;
@@ -141,6 +176,10 @@ RC DefaultConditionFilter::init(Table &table, const Condition &condition)
   {
     return init(left, right, type_left, condition.comp, type_right);
   }
+  if (condition.comp == CompOp::LIKE_OP || condition.comp == CompOp::NOT_LIKE_OP)
+  {
+    return init_like(left, right, type_left, condition.comp, type_right);
+  }
   //  if (!field_type_compare_compatible_table[type_left][type_right]) {
   //    // 不能比较的两个字段， 要把信息传给客户端
   //    return RC::SCHEMA_FIELD_TYPE_MISMATCH;
@@ -192,168 +231,415 @@ RC DefaultConditionFilter::init(Table &table, const Condition &condition)
     // }
   }
 
+  // 字典编码的字段和字符串常量的等值比较直接比较编码，这样可以按INTS扫描页面和使用索引。
+  // 不在字典中的值编码是-1，和任何记录都不相等。编码和值的大小没有关系，其它比较仍然按值比较
+  if ((condition.comp == EQUAL_TO || condition.comp == NOT_EQUAL) && type_left == CHARS && type_right == CHARS &&
+      left.is_attr != right.is_attr)
+  {
+    ConDesc &attr = left.is_attr ? left : right;
+    ConDesc &value = left.is_attr ? right : left;
+    if (attr.dictionary != nullptr && value.value != nullptr)
+    {
+      const char *s = (const char *)value.value;
+      dictionary_code_ = strlen(s) > (size_t)attr.dictionary->value_len() ? -1 : attr.dictionary->find(s);
+      value.value = &dictionary_code_;
+      attr.dictionary = nullptr;
+      attr.attr_length = sizeof(int);
+      type_left = INTS;
+      type_right = INTS;
+    }
+  }
+
   return init(left, right, type_left, condition.comp, type_right);
 }
 
-bool DefaultConditionFilter::filter(const Record &rec) const
+RC DefaultConditionFilter::init_like(const ConDesc &left, const ConDesc &right, AttrType type_left, CompOp comp_op,
+                                     AttrType type_right)
 {
-  // 根据record的type来判断比较
-  AttrType main_type = UNDEFINED;
-  if (attr_type_ == AttrType::NULLS || another_attr_type_ == AttrType::NULLS)
+  if (right.is_attr)
+  {
+    LOG_WARN("The pattern of like must be a constant");
+    return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+  }
+  // 和null匹配的结果总是不成立，编译成常量
+  if (type_left == NULLS || type_right == NULLS)
   {
-    // 两侧只要有一侧的类型为null，则传递null类型
-    main_type = NULLS;
+    return init(left, right, type_left, comp_op, type_right);
   }
-  else
+  if (type_left != CHARS || (type_right != CHARS && type_right != DATES))
   {
-    main_type = attr_type_;
+    LOG_WARN("Like can only match chars. type=%d, pattern type=%d", type_left, type_right);
+    return RC::SCHEMA_FIELD_TYPE_MISMATCH;
   }
 
-  // 对于null的一般运算符，全部返回错误
-  if (main_type == AttrType::NULLS && comp_op_ != IS_NULL && comp_op_ != IS_NOT_NULL)
+  // 像日期的字符串常量在解析时转换成了DATES，这里换回yyyy-mm-dd
+  char date[DATE_STRING_LEN + 1];
+  const char *pattern = (const char *)right.value;
+  if (type_right == DATES)
   {
-    return false;
+    int days;
+    memcpy(&days, right.value, sizeof(days));
+    common::format_date(days, date);
+    pattern = date;
   }
+  like_.reset(new LikeMatcher());
+  like_->init(pattern);
+  ConDesc pattern_desc = right;
+  pattern_desc.value = (void *)like_->pattern().c_str();
+  return init(left, pattern_desc, CHARS, comp_op, CHARS);
+}
 
-  bool left_is_value = false;
-  char *left_value = nullptr;
-  char *right_value = nullptr;
+namespace {
 
-  if (left_.is_attr)
-  { // value
-    left_value = (char *)(rec.data + left_.attr_offset);
+struct IntComparator
+{
+  static int compare(const char *left, const char *right, int length)
+  {
+    // 记录中的字段不一定对齐
+    int left_value;
+    int right_value;
+    memcpy(&left_value, left, sizeof(left_value));
+    memcpy(&right_value, right, sizeof(right_value));
+    return (left_value > right_value) - (left_value < right_value);
   }
-  else
+};
+
+struct FloatComparator
+{
+  static int compare(const char *left, const char *right, int length)
   {
-    left_value = (char *)left_.value;
-    left_is_value = true;
+    float left_value;
+    float right_value;
+    memcpy(&left_value, left, sizeof(left_value));
+    memcpy(&right_value, right, sizeof(right_value));
+    float result = left_value - right_value;
+    if (result < 1e-6 && result > -1e-6)
+    {
+      return 0;
+    }
+    return result > 0 ? 1 : -1;
   }
+};
 
-  if (right_.is_attr)
+struct CharsComparator
+{
+  static int compare(const char *left, const char *right, int length)
   {
-    right_value = (char *)(rec.data + right_.attr_offset);
+    // 字符串都是定长的，按照C字符串风格比较
+    return strncmp(left, right, length);
   }
-  else
+};
+
+template <CompOp op>
+inline bool compare_result(int cmp_result)
+{
+  switch (op)
   {
-    right_value = (char *)right_.value;
+  case EQUAL_TO:
+    return 0 == cmp_result;
+  case LESS_EQUAL:
+    return cmp_result <= 0;
+  case NOT_EQUAL:
+    return cmp_result != 0;
+  case LESS_THAN:
+    return cmp_result < 0;
+  case GREAT_EQUAL:
+    return cmp_result >= 0;
+  default:
+    return cmp_result > 0;
   }
+}
 
-  int cmp_result = 0;
-  switch (main_type)
+template <typename Comparator, CompOp op, bool left_attr, bool right_attr>
+bool evaluate_compare(const CompiledCondition &condition, const char *data)
+{
+  // null和任何值比较都不成立
+  if ((left_attr && condition.left_null.test(data)) || (right_attr && condition.right_null.test(data)))
   {
-  case CHARS:
-  { // 字符串都是定长的，直接比较
-    // 按照C字符串风格来定
-    // LOG_INFO("THE left_value length = %d right_value length = %d in defaultconditionfilter",strlen(left_value),strlen(right_value));
-    cmp_result = strncmp(left_value, right_value, left_.attr_length);
+    return false;
   }
-  break;
-  case INTS:
+  const char *left = left_attr ? data + condition.left_offset : condition.left_value;
+  const char *right = right_attr ? data + condition.right_offset : condition.right_value;
+  return compare_result<op>(Comparator::compare(left, right, condition.length));
+}
+
+/**
+ * 字段是字典编码的时候按记录中的编码从字典中取出值
+ */
+inline const char *chars_value(const char *data, bool is_attr, int offset, const Dictionary *dictionary,
+                               const char *value)
+{
+  if (!is_attr)
   {
-    // 没有考虑大小端问题
-    // 对int和float，要考虑字节对齐问题,有些平台下直接转换可能会跪
-    int left = *(int *)left_value;
-    int right = *(int *)right_value;
-    cmp_result = left - right;
+    return value;
   }
-  break;
-  case DATES:
+  if (dictionary == nullptr)
   {
-    // 没有考虑大小端问题
-    // 对int和float，要考虑字节对齐问题,有些平台下直接转换可能会跪
-    int left = *(int *)left_value;
-    int right = *(int *)right_value;
-    cmp_result = left - right;
+    return data + offset;
   }
-  break;
-  case FLOATS:
+  int code;
+  memcpy(&code, data + offset, sizeof(code));
+  return dictionary->value(code).c_str();
+}
+
+template <CompOp op>
+bool evaluate_dictionary_compare(const CompiledCondition &condition, const char *data)
+{
+  if ((condition.left_is_attr && condition.left_null.test(data)) ||
+      (condition.right_is_attr && condition.right_null.test(data)))
   {
-    float left = *(float *)left_value;
-    float right = *(float *)right_value;
-    float result = left - right;
-    if (result < 1e-6 && result > -1e-6)
-    {
-      cmp_result = 0;
-    }
-    else if (result > 0)
-    {
-      cmp_result = 1;
-    }
-    else
-    {
-      cmp_result = -1;
-    }
-    // 原来这个写法有问题，差值在1以内都会判断为相等
-    // cmp_result = (int)(left - right);
+    return false;
   }
-  break;
-  default:
+  const char *left = chars_value(data, condition.left_is_attr, condition.left_offset, condition.left_dictionary,
+                                 condition.left_value);
+  const char *right = chars_value(data, condition.right_is_attr, condition.right_offset, condition.right_dictionary,
+                                  condition.right_value);
+  return compare_result<op>(CharsComparator::compare(left, right, condition.length));
+}
+
+template <bool negate>
+bool evaluate_like(const CompiledCondition &condition, const char *data)
+{
+  if (condition.left_null.test(data))
   {
+    return false;
   }
+  // 定长的字符串不够长时后面补'\0'
+  const char *value = data + condition.left_offset;
+  return condition.like->match(value, strnlen(value, condition.length)) != negate;
+}
+
+template <bool negate>
+bool evaluate_dictionary_like(const CompiledCondition &condition, const char *data)
+{
+  if (condition.left_null.test(data))
+  {
+    return false;
   }
+  int code;
+  memcpy(&code, data + condition.left_offset, sizeof(code));
+  const std::string &value = condition.left_dictionary->value(code);
+  return condition.like->match(value.data(), value.size()) != negate;
+}
 
-  bool is_null = false;
-  if (!left_is_value)
+template <bool result>
+bool evaluate_constant(const CompiledCondition &condition, const char *data)
+{
+  return result;
+}
+
+template <bool is_null>
+bool evaluate_null(const CompiledCondition &condition, const char *data)
+{
+  return condition.left_null.test(data) == is_null;
+}
+
+typedef bool (*Evaluator)(const CompiledCondition &condition, const char *data);
+
+template <typename Comparator, bool left_attr, bool right_attr>
+Evaluator select_evaluator(CompOp comp_op)
+{
+  switch (comp_op)
   {
-    memcpy(&is_null, rec.data + left_.null_field_index, 1);
-    // LOG_INFO("left_.null_field_index = %d, is_null = %d", left_.null_field_index, is_null);
+  case EQUAL_TO:
+    return evaluate_compare<Comparator, EQUAL_TO, left_attr, right_attr>;
+  case LESS_EQUAL:
+    return evaluate_compare<Comparator, LESS_EQUAL, left_attr, right_attr>;
+  case NOT_EQUAL:
+    return evaluate_compare<Comparator, NOT_EQUAL, left_attr, right_attr>;
+  case LESS_THAN:
+    return evaluate_compare<Comparator, LESS_THAN, left_attr, right_attr>;
+  case GREAT_EQUAL:
+    return evaluate_compare<Comparator, GREAT_EQUAL, left_attr, right_attr>;
+  case GREAT_THAN:
+    return evaluate_compare<Comparator, GREAT_THAN, left_attr, right_attr>;
+  default:
+    return evaluate_constant<false>;
   }
+}
 
-  switch (comp_op_)
+Evaluator select_dictionary_evaluator(CompOp comp_op)
+{
+  switch (comp_op)
   {
   case EQUAL_TO:
-    return 0 == cmp_result && !is_null;
+    return evaluate_dictionary_compare<EQUAL_TO>;
   case LESS_EQUAL:
-    return cmp_result <= 0 && !is_null;
+    return evaluate_dictionary_compare<LESS_EQUAL>;
   case NOT_EQUAL:
-    return cmp_result != 0 && !is_null;
+    return evaluate_dictionary_compare<NOT_EQUAL>;
   case LESS_THAN:
-    return cmp_result < 0 && !is_null;
+    return evaluate_dictionary_compare<LESS_THAN>;
   case GREAT_EQUAL:
-    return cmp_result >= 0 && !is_null;
+    return evaluate_dictionary_compare<GREAT_EQUAL>;
   case GREAT_THAN:
-    return cmp_result > 0 && !is_null;
-  case IS_NULL:
+    return evaluate_dictionary_compare<GREAT_THAN>;
+  default:
+    return evaluate_constant<false>;
+  }
+}
+
+template <typename Comparator>
+Evaluator select_evaluator(CompOp comp_op, bool left_attr, bool right_attr)
+{
+  if (left_attr)
+  {
+    return right_attr ? select_evaluator<Comparator, true, true>(comp_op)
+                      : select_evaluator<Comparator, true, false>(comp_op);
+  }
+  return right_attr ? select_evaluator<Comparator, false, true>(comp_op)
+                    : select_evaluator<Comparator, false, false>(comp_op);
+}
+
+} // namespace
+
+void DefaultConditionFilter::compile()
+{
+  compiled_ = CompiledCondition();
+  compiled_.left_value = (const char *)left_.value;
+  compiled_.right_value = (const char *)right_.value;
+  compiled_.left_offset = left_.attr_offset;
+  compiled_.right_offset = right_.attr_offset;
+  compiled_.left_null = left_.is_attr ? left_.null_flag : NullFlag();
+  compiled_.right_null = right_.is_attr ? right_.null_flag : NullFlag();
+  // 两边都是值时按照完整的字符串比较
+  compiled_.length = left_.is_attr ? left_.attr_length : (right_.is_attr ? right_.attr_length : INT_MAX);
+  compiled_.type = attr_type_ == NULLS || another_attr_type_ == NULLS ? NULLS : attr_type_;
+  compiled_.comp_op = comp_op_;
+  compiled_.left_is_attr = left_.is_attr;
+  compiled_.right_is_attr = right_.is_attr;
+  compiled_.left_dictionary = left_.is_attr ? left_.dictionary : nullptr;
+  compiled_.right_dictionary = right_.is_attr ? right_.dictionary : nullptr;
+
+  if (IS_NULL == comp_op_ || IS_NOT_NULL == comp_op_)
   {
-    if (left_is_value)
+    const bool is_null = IS_NULL == comp_op_;
+    if (left_.is_attr)
     {
-      if (attr_type_ == NULLS)
-      {
-        // null is null
-        return true;
-      }
-      return false;
+      compiled_.evaluate = is_null ? evaluate_null<true> : evaluate_null<false>;
     }
     else
     {
-      return is_null;
+      // null is null
+      compiled_.evaluate = (attr_type_ == NULLS) == is_null ? evaluate_constant<true> : evaluate_constant<false>;
     }
+    return;
   }
-  break;
-  case IS_NOT_NULL:
+
+  if (LIKE_OP == comp_op_ || NOT_LIKE_OP == comp_op_)
   {
-    if (left_is_value)
+    const bool negate = NOT_LIKE_OP == comp_op_;
+    compiled_.like = like_.get();
+    if (like_ == nullptr || compiled_.type != CHARS)
     {
-      if (attr_type_ == NULLS)
-      {
-        // null is not null
-        return false;
-      }
-      return true;
+      compiled_.evaluate = evaluate_constant<false>;
+    }
+    else if (!left_.is_attr)
+    {
+      const char *value = (const char *)left_.value;
+      const bool result = like_->match(value, strlen(value)) != negate;
+      compiled_.evaluate = result ? evaluate_constant<true> : evaluate_constant<false>;
+    }
+    else if (compiled_.left_dictionary != nullptr)
+    {
+      compiled_.evaluate = negate ? evaluate_dictionary_like<true> : evaluate_dictionary_like<false>;
     }
     else
     {
-      return !is_null;
+      compiled_.evaluate = negate ? evaluate_like<true> : evaluate_like<false>;
     }
+    return;
   }
-  break;
 
+  switch (compiled_.type)
+  {
+  case CHARS:
+    if (compiled_.left_dictionary != nullptr || compiled_.right_dictionary != nullptr)
+    {
+      compiled_.evaluate = select_dictionary_evaluator(comp_op_);
+      break;
+    }
+    compiled_.evaluate = select_evaluator<CharsComparator>(comp_op_, left_.is_attr, right_.is_attr);
+    break;
+  case INTS:
+  case DATES:
+    compiled_.evaluate = select_evaluator<IntComparator>(comp_op_, left_.is_attr, right_.is_attr);
+    break;
+  case FLOATS:
+    compiled_.evaluate = select_evaluator<FloatComparator>(comp_op_, left_.is_attr, right_.is_attr);
+    break;
   default:
+    // 对于null的一般运算符，全部返回错误
+    compiled_.evaluate = evaluate_constant<false>;
     break;
   }
+}
+
+/**
+ * 字段和常量比较的INTS、DATES、FLOATS条件用扫描函数一次比较页面上所有的记录，
+ * 其它的条件逐条判断bitmap中还是1的记录
+ */
+static void filter_page(const CompiledCondition &condition, const char *first_record, int record_size, int capacity,
+                        char *bitmap)
+{
+  const int bitmap_size = (capacity + 7) / 8;
+  const bool compare = condition.comp_op >= EQUAL_TO && condition.comp_op <= GREAT_THAN;
+  if (compare && condition.left_is_attr != condition.right_is_attr &&
+      (INTS == condition.type || DATES == condition.type || FLOATS == condition.type))
+  {
+    const bool left = condition.left_is_attr;
+    const char *values = first_record + (left ? condition.left_offset : condition.right_offset);
+    const NullFlag &null_flag = left ? condition.left_null : condition.right_null;
+    const char *nulls = first_record + null_flag.offset;
+    const char *value = left ? condition.right_value : condition.left_value;
+    const CompOp comp_op = left ? condition.comp_op : reverse_comp_op(condition.comp_op);
+    char bits[BP_MAX_PAGE_SIZE / 8];
+    if (FLOATS == condition.type)
+    {
+      float v;
+      memcpy(&v, value, sizeof(v));
+      scan_compare_float(values, nulls, null_flag.mask, record_size, capacity, comp_op, v, bits);
+    }
+    else
+    {
+      int v;
+      memcpy(&v, value, sizeof(v));
+      scan_compare_int(values, nulls, null_flag.mask, record_size, capacity, comp_op, v, bits);
+    }
+    for (int i = 0; i < bitmap_size; i++)
+    {
+      bitmap[i] &= bits[i];
+    }
+    return;
+  }
 
-  LOG_PANIC("Never should print this.");
-  return cmp_result; // should not go here
+  Bitmap bits(bitmap, capacity);
+  for (int index = bits.next_setted_bit(0); index >= 0; index = bits.next_setted_bit(index + 1))
+  {
+    if (!condition.evaluate(condition, first_record + index * record_size))
+    {
+      bits.clear_bit(index);
+    }
+  }
+}
+
+bool DefaultConditionFilter::filter(const Record &rec) const
+{
+  return compiled_.evaluate(compiled_, rec.data);
+}
+
+void DefaultConditionFilter::filter(const char *const *records, int n, uint8_t *sel) const
+{
+  const CompiledCondition &condition = compiled_;
+  for (int i = 0; i < n; i++)
+  {
+    sel[i] = condition.evaluate(condition, records[i]);
+  }
+}
+
+void DefaultConditionFilter::filter_page(const char *first_record, int record_size, int capacity, char *bitmap) const
+{
+  ::filter_page(compiled_, first_record, record_size, capacity, bitmap);
 }
 
 CompositeConditionFilter::~CompositeConditionFilter()
@@ -370,6 +656,22 @@ RC CompositeConditionFilter::init(const ConditionFilter *filters[], int filter_n
   filters_ = filters;
   filter_num_ = filter_num;
   memory_owner_ = own_memory;
+
+  compiled_.clear();
+  all_compiled_ = true;
+  for (int i = 0; i < filter_num && all_compiled_; i++)
+  {
+    const DefaultConditionFilter *default_filter = dynamic_cast<const DefaultConditionFilter *>(filters[i]);
+    all_compiled_ = default_filter != nullptr && default_filter->compiled().evaluate != nullptr;
+    if (all_compiled_)
+    {
+      compiled_.push_back(default_filter->compiled());
+    }
+  }
+  if (!all_compiled_)
+  {
+    compiled_.clear();
+  }
   return RC::SUCCESS;
 }
 RC CompositeConditionFilter::init(const ConditionFilter *filters[], int filter_num)
@@ -413,6 +715,18 @@ RC CompositeConditionFilter::init(Table &table, const Condition *conditions, int
 
 bool CompositeConditionFilter::filter(const Record &rec) const
 {
+  if (all_compiled_)
+  {
+    for (const CompiledCondition &condition : compiled_)
+    {
+      if (!condition.evaluate(condition, rec.data))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
   for (int i = 0; i < filter_num_; i++)
   {
     if (!filters_[i]->filter(rec))
@@ -422,3 +736,195 @@ bool CompositeConditionFilter::filter(const Record &rec) const
   }
   return true;
 }
+
+void CompositeConditionFilter::filter(const char *const *records, int n, uint8_t *sel) const
+{
+  if (!all_compiled_)
+  {
+    // 依次调用每个条件的批量过滤，只把前面的条件留下的记录交给后面的条件，表达式这样的条件可以按批计算
+    std::vector<const char *> left(records, records + n);
+    std::vector<int> rows(n);
+    std::vector<uint8_t> left_sel(n);
+    for (int i = 0; i < n; i++)
+    {
+      rows[i] = i;
+    }
+    memset(sel, 0, n);
+    int left_num = n;
+    for (int f = 0; f < filter_num_ && left_num > 0; f++)
+    {
+      filters_[f]->filter(left.data(), left_num, left_sel.data());
+      int kept = 0;
+      for (int i = 0; i < left_num; i++)
+      {
+        left[kept] = left[i];
+        rows[kept] = rows[i];
+        kept += left_sel[i];
+      }
+      left_num = kept;
+    }
+    for (int i = 0; i < left_num; i++)
+    {
+      sel[rows[i]] = 1;
+    }
+    return;
+  }
+
+  // 一次判断一个条件，前面的条件已经不满足的记录不再判断
+  memset(sel, 1, n);
+  for (const CompiledCondition &condition : compiled_)
+  {
+    for (int i = 0; i < n; i++)
+    {
+      if (sel[i])
+      {
+        sel[i] = condition.evaluate(condition, records[i]);
+      }
+    }
+  }
+}
+
+void CompositeConditionFilter::filter_page(const char *first_record, int record_size, int capacity, char *bitmap) const
+{
+  if (!all_compiled_)
+  {
+    for (int i = 0; i < filter_num_; i++)
+    {
+      filters_[i]->filter_page(first_record, record_size, capacity, bitmap);
+    }
+    return;
+  }
+  for (const CompiledCondition &condition : compiled_)
+  {
+    ::filter_page(condition, first_record, record_size, capacity, bitmap);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void subquery_key_append(std::string &key, AttrType type, const char *data, int len)
+{
+  if (FLOATS == type)
+  {
+    // 0.0和-0.0相等
+    float value = *(const float *)data;
+    value = value == 0 ? 0 : value;
+    key.append((const char *)&value, sizeof(value));
+  }
+  else if (CHARS == type)
+  {
+    key.append(data, len);
+    key.push_back('\0');
+  }
+  else
+  {
+    key.append(data, sizeof(int));
+  }
+}
+
+RC SubqueryConditionFilter::init_key_field(Table &table, const RelAttr &attr, AttrType type, KeyField &field)
+{
+  const TableMeta &table_meta = table.table_meta();
+  int i = table_meta.find_field_index_by_name(attr.attribute_name);
+  if (-1 == i)
+  {
+    LOG_WARN("No such field in condition. %s.%s", table.name(), attr.attribute_name);
+    return RC::SCHEMA_FIELD_MISSING;
+  }
+  const FieldMeta *field_meta = table_meta.field(i);
+  if (field_meta->type() != type)
+  {
+    LOG_WARN("Field %s.%s cannot be compared with the result of sub query", table.name(), attr.attribute_name);
+    return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+  }
+  field.type = type;
+  field.offset = field_meta->offset();
+  field.length = field_meta->len();
+  field.null_flag = table_meta.null_flag(i);
+  field.dictionary = field_meta->dictionary();
+  return RC::SUCCESS;
+}
+
+RC SubqueryConditionFilter::init(Table &table, const Condition &condition,
+                                 const std::vector<const RelAttr *> &outer_attrs, const SubqueryResult &result)
+{
+  if (condition.comp <= NO_OP || outer_attrs.size() != result.correlated_types.size())
+  {
+    LOG_ERROR("Invalid sub query condition. comp=%d", condition.comp);
+    return RC::INVALID_ARGUMENT;
+  }
+  comp_op_ = condition.comp;
+  result_ = &result;
+  correlated_fields_.resize(outer_attrs.size());
+  for (size_t i = 0; i < outer_attrs.size(); i++)
+  {
+    RC rc = init_key_field(table, *outer_attrs[i], result.correlated_types[i], correlated_fields_[i]);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+  if (comp_op_ == IN_SUBQUERY || comp_op_ == NOT_IN_SUBQUERY)
+  {
+    return init_key_field(table, condition.left_attr, result.value_type, value_field_);
+  }
+  return RC::SUCCESS;
+}
+
+bool SubqueryConditionFilter::append_key(const KeyField &field, const char *data, std::string &key)
+{
+  if (field.null_flag.test(data))
+  {
+    return false;
+  }
+  const char *value = data + field.offset;
+  if (field.dictionary != nullptr)
+  {
+    // 子查询的结果是字符串，按值比较
+    int code;
+    memcpy(&code, value, sizeof(code));
+    const std::string &s = field.dictionary->value(code);
+    subquery_key_append(key, field.type, s.data(), (int)s.size());
+    return true;
+  }
+  subquery_key_append(key, field.type, value, CHARS == field.type ? strnlen(value, field.length) : field.length);
+  return true;
+}
+
+bool SubqueryConditionFilter::filter(const Record &rec) const
+{
+  // 关联字段是null时关联条件不成立，子查询没有结果
+  std::string group;
+  bool has_group = true;
+  for (const KeyField &field : correlated_fields_)
+  {
+    if (!append_key(field, rec.data, group))
+    {
+      has_group = false;
+      break;
+    }
+  }
+  has_group = has_group && result_->groups.count(group) > 0;
+  if (comp_op_ == EXISTS_SUBQUERY || comp_op_ == NOT_EXISTS_SUBQUERY)
+  {
+    return has_group == (comp_op_ == EXISTS_SUBQUERY);
+  }
+
+  // 子查询没有结果时in不成立，not in成立，左边的值是null也一样
+  if (!has_group)
+  {
+    return comp_op_ == NOT_IN_SUBQUERY;
+  }
+  std::string key = group;
+  if (!append_key(value_field_, rec.data, key))
+  {
+    // null in (...)的结果是unknown
+    return false;
+  }
+  const bool found = result_->keys.count(key) > 0;
+  if (comp_op_ == IN_SUBQUERY)
+  {
+    return found;
+  }
+  // 没有找到但是结果中有null时not in的结果也是unknown
+  return !found && result_->null_groups.count(group) == 0;
+}
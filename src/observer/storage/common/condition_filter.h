@@ -15,18 +15,49 @@ See the Mulan PSL v2 for more details. */
 #ifndef __OBSERVER_STORAGE_COMMON_CONDITION_FILTER_H_
 #define __OBSERVER_STORAGE_COMMON_CONDITION_FILTER_H_
 
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include "rc.h"
 #include "sql/parser/parse.h"
+#include "storage/common/field_meta.h"
+#include "storage/common/like_matcher.h"
 
 struct Record;
 class Table;
 
 struct ConDesc {
   bool   is_attr;     // 是否属性，false 表示是值
-  int   null_field_index;     // 如果是属性，标明null_index的位置
+  NullFlag null_flag;         // 如果是属性，字段的null标志
   int    attr_length; // 如果是属性，表示属性值长度
   int    attr_offset; // 如果是属性，表示在记录中的偏移量
   void * value;       // 如果是值类型，这里记录值的数据
+  const Dictionary *dictionary; // 如果是字典编码的字段，记录中的编码按字典取出值再比较
+};
+
+/**
+ * init时根据字段类型、比较符和两边是否是字段选出的比较函数，evaluate直接按偏移读取记录中的值，
+ * 不再对每一行判断类型和比较符
+ */
+struct CompiledCondition {
+  bool (*evaluate)(const CompiledCondition &condition, const char *data) = nullptr;
+  const char *left_value = nullptr;   // 左边是值时指向值的数据
+  const char *right_value = nullptr;
+  int left_offset = 0;                // 左边是字段时字段在记录中的偏移
+  int right_offset = 0;
+  NullFlag left_null;                 // 左边是字段时字段的null标志
+  NullFlag right_null;
+  int length = 0;                     // 字符串比较的最大长度
+  AttrType type = UNDEFINED;          // 比较的类型，扫描页面时按类型选择比较函数
+  CompOp comp_op = NO_OP;
+  bool left_is_attr = false;
+  bool right_is_attr = false;
+  const Dictionary *left_dictionary = nullptr;  // 字段是字典编码的CHARS字段时用来解码
+  const Dictionary *right_dictionary = nullptr;
+  const LikeMatcher *like = nullptr;  // LIKE和NOT LIKE编译好的模式串，属于DefaultConditionFilter
 };
 
 class ConditionFilter {
@@ -39,6 +70,17 @@ public:
    * @return true means match condition, false means failed to match.
    */
   virtual bool filter(const Record &rec) const = 0;
+
+  /**
+   * 过滤一批记录，records[i]满足条件时sel[i]为1，否则为0
+   */
+  virtual void filter(const char *const *records, int n, uint8_t *sel) const;
+
+  /**
+   * 过滤行格式页面上的所有记录，第i条记录在first_record + i * record_size。
+   * bitmap是页面slot bitmap的副本，不满足条件的记录对应的位被清掉
+   */
+  virtual void filter_page(const char *first_record, int record_size, int capacity, char *bitmap) const;
 };
 
 class DefaultConditionFilter : public ConditionFilter {
@@ -50,6 +92,8 @@ public:
   RC init(Table &table, const Condition &condition);
 
   virtual bool filter(const Record &rec) const;
+  virtual void filter(const char *const *records, int n, uint8_t *sel) const;
+  virtual void filter_page(const char *first_record, int record_size, int capacity, char *bitmap) const;
 
 public:
   const ConDesc &left() const {
@@ -64,12 +108,41 @@ public:
     return comp_op_;
   }
 
+  AttrType attr_type() const {
+    return attr_type_;
+  }
+
+  AttrType another_attr_type() const {
+    return another_attr_type_;
+  }
+
+  const CompiledCondition &compiled() const {
+    return compiled_;
+  }
+
+  /**
+   * LIKE和NOT LIKE条件的匹配器，其它条件是nullptr
+   */
+  const LikeMatcher *like() const {
+    return like_.get();
+  }
+
+private:
+  /**
+   * LIKE的左边必须是CHARS，右边必须是常量，模式串在这里编译一次
+   */
+  RC init_like(const ConDesc &left, const ConDesc &right, AttrType type_left, CompOp comp_op, AttrType type_right);
+  void compile();
+
 private:
   ConDesc  left_;
   ConDesc  right_;
   AttrType attr_type_ = UNDEFINED; // 存放左运算符类型
   AttrType another_attr_type_ = UNDEFINED; // 存放右运算符类型
   CompOp   comp_op_ = NO_OP;
+  CompiledCondition compiled_;
+  int dictionary_code_ = -1;  // 和字典编码的字段等值比较的字符串换成的编码，不在字典中时是-1
+  std::unique_ptr<LikeMatcher> like_;
 };
 
 class CompositeConditionFilter : public ConditionFilter {
@@ -77,9 +150,14 @@ public:
   CompositeConditionFilter() = default;
   virtual ~CompositeConditionFilter();
 
+  /**
+   * filters需要先初始化好。都是DefaultConditionFilter时复制编译好的条件，过滤时不再调用虚函数
+   */
   RC init(const ConditionFilter *filters[], int filter_num);
   RC init(Table &table, const Condition *conditions, int condition_num);
   virtual bool filter(const Record &rec) const;
+  virtual void filter(const char *const *records, int n, uint8_t *sel) const;
+  virtual void filter_page(const char *first_record, int record_size, int capacity, char *bitmap) const;
 
 public:
   int filter_num() const {
@@ -95,6 +173,64 @@ private:
   const ConditionFilter **      filters_ = nullptr;
   int                           filter_num_ = 0;
   bool                          memory_owner_ = false; // filters_的内存是否由自己来控制
+  std::vector<CompiledCondition> compiled_;             // 所有的子条件都能编译时按顺序依次判断
+  bool                          all_compiled_ = false;
+};
+
+/**
+ * 子查询的结果，执行外层的查询之前计算一次。关联子查询按照关联字段的值分组，不关联的子查询只有一个空的分组
+ */
+struct SubqueryResult {
+  AttrType value_type = UNDEFINED;              // in的子查询输出的列的类型
+  std::vector<AttrType> correlated_types;       // 关联字段在子查询中的类型
+  std::unordered_set<std::string> keys;         // 关联字段的值和in的列的值拼成的key
+  std::unordered_set<std::string> groups;       // 有结果的关联字段的值
+  std::unordered_set<std::string> null_groups;  // in的列有null的关联字段的值
+};
+
+/**
+ * 把一个值追加到子查询结果的key中。INTS和DATES是4个字节的int，FLOATS是4个字节的float，
+ * CHARS是len个字符再加上'\0'
+ */
+void subquery_key_append(std::string &key, AttrType type, const char *data, int len);
+
+/**
+ * in、not in、exists和not exists子查询的条件。用外层记录中关联字段和in的字段的值在子查询的结果中查找，
+ * 相当于外层的表和子查询的结果做hash semi join(in、exists)或者anti join(not in、not exists)
+ */
+class SubqueryConditionFilter : public ConditionFilter {
+public:
+  SubqueryConditionFilter() = default;
+  virtual ~SubqueryConditionFilter() = default;
+
+  /**
+   * outer_attrs是关联条件中外层的字段，和result.correlated_types一一对应。过滤结束之前result不能释放
+   */
+  RC init(Table &table, const Condition &condition, const std::vector<const RelAttr *> &outer_attrs,
+          const SubqueryResult &result);
+
+  virtual bool filter(const Record &rec) const;
+
+private:
+  struct KeyField {
+    AttrType type = UNDEFINED;
+    int offset = 0;
+    int length = 0;
+    NullFlag null_flag;
+    const Dictionary *dictionary = nullptr;
+  };
+
+  static RC init_key_field(Table &table, const RelAttr &attr, AttrType type, KeyField &field);
+  /**
+   * 字段的值是null时返回false
+   */
+  static bool append_key(const KeyField &field, const char *data, std::string &key);
+
+private:
+  CompOp comp_op_ = NO_OP;
+  KeyField value_field_;                   // in左边的字段
+  std::vector<KeyField> correlated_fields_;
+  const SubqueryResult *result_ = nullptr;
 };
 
 #endif // __OBSERVER_STORAGE_COMMON_CONDITION_FILTER_H_
\ No newline at end of file
@@ -14,8 +14,13 @@ See the Mulan PSL v2 for more details. */
 
 #include "storage/common/db.h"
 
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+
+#include <algorithm>
 #include <vector>
 
 #include "common/log/log.h"
@@ -23,10 +28,30 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/string.h"
 #include "storage/common/table_meta.h"
 #include "storage/common/table.h"
+#include "storage/common/materialized_view.h"
 #include "storage/common/meta_util.h"
+#include "storage/default/redo_log.h"
+#include "storage/trx/trx.h"
+
+static int table_open_threads = DB_DEFAULT_TABLE_OPEN_THREADS;
+static bool lazy_table_open = false;
+
+void Db::set_table_open_threads(int thread_num)
+{
+  table_open_threads = std::max(1, std::min(thread_num, DB_MAX_TABLE_OPEN_THREADS));
+}
+
+void Db::set_lazy_table_open(bool lazy)
+{
+  lazy_table_open = lazy;
+}
 
 Db::~Db()
 {
+  for (auto &iter : views_)
+  {
+    delete iter.second;
+  }
   for (auto &iter : opened_tables_)
   {
     delete iter.second;
@@ -55,31 +80,139 @@ RC Db::init(const char *name, const char *dbpath)
   return open_all_tables();
 }
 
-RC Db::create_table(const char *table_name, int attribute_count, const AttrInfo *attributes)
+RC Db::create_table(const char *table_name, int attribute_count, const AttrInfo *attributes, int page_size,
+                    const char *compression, const char *format, const char *engine, const PartitionDef *partition,
+                    const char *bloom_filter, int primary_key_num, const char *const primary_keys[])
 {
   RC rc = RC::SUCCESS;
   // check table_name
-  // 检查是否有重名table
-  if (opened_tables_.count(table_name) != 0)
+  // 检查是否有重名table，包括还没有打开的表
   {
-    return RC::SCHEMA_TABLE_EXIST;
+    std::lock_guard<std::mutex> lock(tables_mutex_);
+    if (opened_tables_.count(table_name) != 0 || lazy_tables_.count(table_name) != 0)
+    {
+      return RC::SCHEMA_TABLE_EXIST;
+    }
   }
 
   std::string table_file_path = table_meta_file(path_.c_str(), table_name); // 文件路径可以移到Table模块
   std::cout << table_file_path << std::endl;
   Table *table = new Table();
-  rc = table->create(table_file_path.c_str(), table_name, path_.c_str(), attribute_count, attributes);
+  rc = table->create(table_file_path.c_str(), table_name, path_.c_str(), attribute_count, attributes, page_size,
+                     compression, format, engine, partition, bloom_filter, primary_key_num, primary_keys);
   if (rc != RC::SUCCESS)
   {
     delete table;
     return rc;
   }
 
-  opened_tables_[table_name] = table;
+  {
+    std::lock_guard<std::mutex> lock(tables_mutex_);
+    opened_tables_[table_name] = table;
+  }
   LOG_INFO("Create table success. table name=%s", table_name);
   return RC::SUCCESS;
 }
 
+RC Db::create_materialized_view(const char *view_name, const Selects &selects)
+{
+  Table *base = selects.relation_num == 1 ? find_table(selects.relations[0]) : nullptr;
+  if (nullptr == base)
+  {
+    LOG_WARN("Materialized view %s must be defined on one existing table", view_name);
+    return selects.relation_num == 1 ? RC::SCHEMA_TABLE_NOT_EXIST : RC::INVALID_ARGUMENT;
+  }
+  if (base->materialized_view() != nullptr)
+  {
+    LOG_WARN("Cannot create materialized view %s on view %s", view_name, base->name());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  MaterializedView *view = new MaterializedView();
+  std::vector<AttrInfo> attributes;
+  RC rc = view->init(view_name, *base, selects);
+  if (rc == RC::SUCCESS)
+  {
+    rc = view->table_attributes(*base, attributes);
+  }
+  if (rc == RC::SUCCESS)
+  {
+    rc = create_table(view_name, (int)attributes.size(), attributes.data());
+  }
+  if (rc != RC::SUCCESS)
+  {
+    delete view;
+    return rc;
+  }
+  Table *table = find_table(view_name);
+  table->set_materialized_view(view);
+
+  // 先注册到基表上再计算，计算之后提交的事务都会更新视图
+  const std::string view_file = path_ + "/" + view_name + MATERIALIZED_VIEW_SUFFIX;
+  rc = view->save(view_file);
+  if (rc == RC::SUCCESS)
+  {
+    base->add_materialized_view(view);
+    rc = view->open(base, table);
+  }
+  {
+    std::lock_guard<std::mutex> lock(views_mutex_);
+    views_[view_name] = view;
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to create materialized view %s. rc=%d:%s", view_name, rc, strrc(rc));
+    drop_table(view_name);
+    return rc;
+  }
+  LOG_INFO("Create materialized view success. view=%s, base table=%s", view_name, base->name());
+  return RC::SUCCESS;
+}
+
+RC Db::open_views()
+{
+  std::vector<std::string> view_files;
+  int ret = common::list_file(path_.c_str(), MATERIALIZED_VIEW_FILE_PATTERN, view_files);
+  if (ret < 0)
+  {
+    LOG_ERROR("Failed to list materialized view files under %s.", path_.c_str());
+    return RC::IOERR;
+  }
+  for (const std::string &filename : view_files)
+  {
+    MaterializedView *view = new MaterializedView();
+    RC rc = view->load(path_ + "/" + filename);
+    Table *base = rc == RC::SUCCESS ? find_table(view->base_name()) : nullptr;
+    Table *table = rc == RC::SUCCESS ? find_table(view->name()) : nullptr;
+    if (nullptr == base || nullptr == table)
+    {
+      LOG_ERROR("Failed to open materialized view. filename=%s, rc=%d:%s", filename.c_str(), rc, strrc(rc));
+      delete view;
+      return rc == RC::SUCCESS ? RC::SCHEMA_TABLE_NOT_EXIST : rc;
+    }
+    table->set_materialized_view(view);
+    {
+      std::lock_guard<std::mutex> lock(views_mutex_);
+      views_[view->name()] = view;
+    }
+    if (Trx::replica())
+    {
+      // 备库的视图表和基表一样从主库复制过来，不在本地计算
+      LOG_INFO("Open materialized view %s on replica without refreshing", view->name());
+      continue;
+    }
+    base->add_materialized_view(view);
+    rc = view->open(base, table);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to refresh materialized view %s. rc=%d:%s", view->name(), rc, strrc(rc));
+      return rc;
+    }
+    LOG_INFO("Open materialized view: %s, base table: %s", view->name(), base->name());
+  }
+  return RC::SUCCESS;
+}
+
 RC Db::drop_table(const char *table_name)
 {
   RC rc = RC::SUCCESS;
@@ -90,48 +223,101 @@ RC Db::drop_table(const char *table_name)
   {
     return RC::SCHEMA_TABLE_NOT_EXIST;
   }
+  if (table->has_materialized_views())
+  {
+    LOG_WARN("Cannot drop table %s, there are materialized views on it", table_name);
+    return RC::CONSTRAINT;
+  }
 
-  // 删除index文件
-  std::vector<const char *> index_names = table->get_index_names();
-  int n = index_names.size();
-  for (int i = 0; i < n; ++i)
+  // 删除视图时先从基表上去掉，之后的提交不再更新它
+  MaterializedView *view = table->materialized_view();
+  if (view != nullptr)
   {
-    LOG_ERROR("start");
-    const char * index_name = index_names[i];
-    std::string indexfile_path = path_ + "/" + table_name + "-" + index_name + TABLE_INDEX_SUFFIX;
-    std::cout << indexfile_path << std::endl;
-    if (::remove(indexfile_path.c_str()) != 0)
+    if (view->base() != nullptr)
     {
-      LOG_ERROR("Failed to remove table file: %s", indexfile_path.c_str());
+      view->base()->remove_materialized_view(view);
+    }
+    const std::string view_file = path_ + "/" + table_name + MATERIALIZED_VIEW_SUFFIX;
+    if (::remove(view_file.c_str()) != 0 && errno != ENOENT)
+    {
+      LOG_ERROR("Failed to remove materialized view file: %s", view_file.c_str());
       return RC::IOERR;
     }
+    std::lock_guard<std::mutex> lock(views_mutex_);
+    views_.erase(table_name);
   }
 
-  // 删除table_meta文件
+  // 先删除table_meta文件，中途崩溃最多留下没有用的数据文件
   std::string table_file_path = table_meta_file(path_.c_str(), table_name);
-  std::cout << table_file_path << std::endl;
   if (::remove(table_file_path.c_str()) != 0)
   {
     LOG_ERROR("Failed to remove table file: %s", table_file_path.c_str());
     return RC::IOERR;
   }
-
-  // 删除data文件
-  std::string datafile_path = path_ + "/" + table_name + TABLE_DATA_SUFFIX;
-  if (::remove(datafile_path.c_str()) != 0)
   {
-    LOG_ERROR("Failed to remove table file: %s", datafile_path.c_str());
-    return RC::IOERR;
+    std::lock_guard<std::mutex> lock(tables_mutex_);
+    opened_tables_.erase(table_name);
   }
-  opened_tables_.erase(table_name);
 
+  // 数据文件和索引文件在缓冲池中的页面直接丢弃，不逐页写回
+  rc = table->drop_files();
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to remove files of table %s. rc=%d:%s", table_name, rc, strrc(rc));
+  }
   delete table; // 释放表
+  delete view;
+  return rc;
+}
 
-  return RC::SUCCESS;
+RC Db::truncate_table(const char *table_name)
+{
+  Table *table = find_table(table_name);
+  if (table == nullptr)
+  {
+    return RC::SCHEMA_TABLE_NOT_EXIST;
+  }
+  if (table->materialized_view() != nullptr)
+  {
+    LOG_WARN("Cannot truncate materialized view %s", table_name);
+    return RC::READONLY;
+  }
+  RC rc = table->truncate();
+  // 清空不经过事务，视图重新计算
+  for (MaterializedView *view : table->materialized_views())
+  {
+    RC view_rc = view->rebuild();
+    if (view_rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to rebuild materialized view %s. rc=%d:%s", view->name(), view_rc, strrc(view_rc));
+    }
+  }
+  return rc;
+}
+
+RC Db::analyze_table(const char *table_name)
+{
+  Table *table = find_table(table_name);
+  if (table == nullptr)
+  {
+    return RC::SCHEMA_TABLE_NOT_EXIST;
+  }
+  return table->analyze_table();
 }
 
 Table *Db::find_table(const char *table_name) const
 {
+  if (lazy_table_count_.load() > 0)
+  {
+    std::lock_guard<std::mutex> lock(tables_mutex_);
+    auto iter = opened_tables_.find(table_name);
+    if (iter != opened_tables_.end())
+    {
+      return iter->second;
+    }
+    return open_lazy_table(table_name);
+  }
+
   std::unordered_map<std::string, Table *>::const_iterator iter = opened_tables_.find(table_name);
   if (iter != opened_tables_.end())
   {
@@ -140,6 +326,123 @@ Table *Db::find_table(const char *table_name) const
   return nullptr;
 }
 
+/**
+ * catalog中有和JSON文件对得上的元数据时直接使用，否则解析JSON文件，这时from_json设为true
+ */
+static RC open_table(const CatalogFile &catalog, const std::string &filename, const char *base_dir, Table *table,
+                     bool *from_json)
+{
+  const std::string table_name = filename.substr(0, filename.size() - strlen(TABLE_META_SUFFIX));
+  TableMeta table_meta;
+  if (RC::SUCCESS == catalog.find(table_name.c_str(), std::string(base_dir) + "/" + filename, table_meta) &&
+      table_name == table_meta.name())
+  {
+    *from_json = false;
+    return table->open(filename.c_str(), base_dir, &table_meta);
+  }
+  *from_json = true;
+  return table->open(filename.c_str(), base_dir);
+}
+
+struct TableOpenTask
+{
+  const std::vector<std::string> *table_meta_files;
+  const char *base_dir;
+  const CatalogFile *catalog;
+  std::vector<Table *> *tables;
+  std::atomic<size_t> *next;
+  std::atomic<bool> *failed;
+  std::atomic<int> *json_tables;
+  RC rc;
+};
+
+/**
+ * 每个线程依次领取下一个还没有打开的元数据文件，有线程失败之后其它线程不再领取
+ */
+static void *table_open_routine(void *arg)
+{
+  TableOpenTask *task = (TableOpenTask *)arg;
+  while (!task->failed->load())
+  {
+    const size_t i = task->next->fetch_add(1);
+    if (i >= task->table_meta_files->size())
+    {
+      break;
+    }
+    const std::string &filename = (*task->table_meta_files)[i];
+    Table *table = new Table();
+    bool from_json = true;
+    RC rc = open_table(*task->catalog, filename, task->base_dir, table, &from_json);
+    if (from_json)
+    {
+      (*task->json_tables)++;
+    }
+    if (rc != RC::SUCCESS)
+    {
+      delete table;
+      LOG_ERROR("Failed to open table. filename=%s", filename.c_str());
+      task->rc = rc;
+      task->failed->store(true);
+      break;
+    }
+    (*task->tables)[i] = table;
+  }
+  return nullptr;
+}
+
+RC Db::open_tables(const std::vector<std::string> &table_meta_files, std::vector<Table *> &tables, int *json_tables)
+{
+  tables.assign(table_meta_files.size(), nullptr);
+  const int thread_num = std::max(1, std::min(table_open_threads, (int)table_meta_files.size()));
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  std::atomic<int> json_table_count(0);
+  std::vector<TableOpenTask> tasks(thread_num);
+  for (int i = 0; i < thread_num; i++)
+  {
+    tasks[i] = TableOpenTask{&table_meta_files, path_.c_str(), &catalog_, &tables, &next, &failed, &json_table_count,
+                             RC::SUCCESS};
+  }
+
+  // 创建线程失败时剩下的表由当前线程打开
+  std::vector<pthread_t> threads(thread_num);
+  std::vector<bool> started(thread_num, false);
+  for (int i = 1; i < thread_num; i++)
+  {
+    int ret = pthread_create(&threads[i], nullptr, table_open_routine, &tasks[i]);
+    if (ret != 0)
+    {
+      LOG_WARN("Failed to create table open thread. error=%s", strerror(ret));
+      continue;
+    }
+    started[i] = true;
+  }
+  table_open_routine(&tasks[0]);
+  RC rc = tasks[0].rc;
+  for (int i = 1; i < thread_num; i++)
+  {
+    if (started[i])
+    {
+      pthread_join(threads[i], nullptr);
+      if (rc == RC::SUCCESS)
+      {
+        rc = tasks[i].rc;
+      }
+    }
+  }
+
+  *json_tables = json_table_count.load();
+  if (rc != RC::SUCCESS)
+  {
+    for (Table *table : tables)
+    {
+      delete table;
+    }
+    tables.clear();
+  }
+  return rc;
+}
+
 RC Db::open_all_tables()
 {
   std::vector<std::string> table_meta_files;
@@ -149,32 +452,64 @@ RC Db::open_all_tables()
     LOG_ERROR("Failed to list table meta files under %s.", path_.c_str());
     return RC::IOERR;
   }
+  // 没有catalog文件或者文件无效时所有的表都从JSON文件读取
+  catalog_.load(path_ + "/" + DB_CATALOG_FILE_NAME);
 
-  RC rc = RC::SUCCESS;
-  for (const std::string &filename : table_meta_files)
+  // 元数据文件的名字就是表名加上后缀
+  if (lazy_table_open && !RedoLog::instance().recovering())
   {
-    Table *table = new Table();
-    rc = table->open(filename.c_str(), path_.c_str());
-    if (rc != RC::SUCCESS)
+    std::lock_guard<std::mutex> lock(tables_mutex_);
+    for (const std::string &filename : table_meta_files)
     {
-      delete table;
-      LOG_ERROR("Failed to open table. filename=%s", filename.c_str());
-      return rc;
+      lazy_tables_[filename.substr(0, filename.size() - strlen(TABLE_META_SUFFIX))] = filename;
     }
+    lazy_table_count_ = (int)lazy_tables_.size();
+    LOG_INFO("All tables will be opened lazily. num=%d", lazy_table_count_.load());
+  }
+  if (lazy_table_open && !RedoLog::instance().recovering())
+  {
+    // 视图用到的表在这里打开
+    return open_views();
+  }
+
+  std::vector<Table *> tables;
+  int json_tables = 0;
+  RC rc = open_tables(table_meta_files, tables, &json_tables);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
 
+  for (size_t i = 0; i < tables.size(); i++)
+  {
+    Table *table = tables[i];
     if (opened_tables_.count(table->name()) != 0)
     {
-      delete table;
       LOG_ERROR("Duplicate table with difference file name. table=%s, the other filename=%s",
-                table->name(), filename.c_str());
+                table->name(), table_meta_files[i].c_str());
+      for (size_t j = i; j < tables.size(); j++)
+      {
+        delete tables[j];
+      }
       return RC::GENERIC_ERROR;
     }
 
     opened_tables_[table->name()] = table;
-    LOG_INFO("Open table: %s, file: %s", table->name(), filename.c_str());
+    LOG_INFO("Open table: %s, file: %s", table->name(), table_meta_files[i].c_str());
   }
 
-  LOG_INFO("All table have been opened. num=%d", opened_tables_.size());
+  LOG_INFO("All table have been opened. num=%d, from json=%d", opened_tables_.size(), json_tables);
+
+  // 有表的元数据和catalog对不上，或者catalog中有已经删除的表
+  if (json_tables > 0 || catalog_.table_num() != (int)opened_tables_.size())
+  {
+    save_catalog();
+  }
+  // 恢复时视图在所有的表恢复之后再计算
+  if (!RedoLog::instance().recovering())
+  {
+    rc = open_views();
+  }
   return rc;
 }
 
@@ -183,20 +518,93 @@ const char *Db::name() const
   return name_.c_str();
 }
 
+Table *Db::open_lazy_table(const char *table_name) const
+{
+  auto iter = lazy_tables_.find(table_name);
+  if (iter == lazy_tables_.end())
+  {
+    return nullptr;
+  }
+
+  Table *table = new Table();
+  bool from_json = true;
+  RC rc = open_table(catalog_, iter->second, path_.c_str(), table, &from_json);
+  if (rc != RC::SUCCESS)
+  {
+    delete table;
+    LOG_ERROR("Failed to open table lazily. filename=%s, rc=%d:%s", iter->second.c_str(), rc, strrc(rc));
+    return nullptr;
+  }
+  if (0 != strcmp(table->name(), table_name))
+  {
+    LOG_ERROR("Table name does not match its file name. table=%s, filename=%s", table->name(), iter->second.c_str());
+    delete table;
+    return nullptr;
+  }
+
+  opened_tables_[table_name] = table;
+  lazy_tables_.erase(iter);
+  lazy_table_count_--;
+  LOG_INFO("Open table lazily: %s", table_name);
+  return table;
+}
+
+RC Db::save_catalog()
+{
+  std::vector<CatalogEntry> entries;
+  {
+    std::lock_guard<std::mutex> lock(tables_mutex_);
+    for (const auto &table_pair : opened_tables_)
+    {
+      CatalogEntry entry;
+      const std::string meta_file = table_meta_file(path_.c_str(), table_pair.first.c_str());
+      if (RC::SUCCESS == CatalogFile::make_entry(table_pair.second->table_meta(), meta_file, entry))
+      {
+        entries.push_back(std::move(entry));
+      }
+    }
+    // 还没有打开的表不在catalog中时下次仍然从JSON文件读取
+    for (const auto &table_pair : lazy_tables_)
+    {
+      CatalogEntry entry;
+      if (catalog_.entry(table_pair.first.c_str(), entry))
+      {
+        entries.push_back(std::move(entry));
+      }
+    }
+  }
+  return CatalogFile::save(path_ + "/" + DB_CATALOG_FILE_NAME, entries);
+}
+
+void Db::opened_table_list(std::vector<Table *> &tables) const
+{
+  std::lock_guard<std::mutex> lock(tables_mutex_);
+  for (const auto &table_pair : opened_tables_)
+  {
+    tables.push_back(table_pair.second);
+  }
+}
+
 void Db::all_tables(std::vector<std::string> &table_names) const
 {
+  std::lock_guard<std::mutex> lock(tables_mutex_);
   for (const auto &table_item : opened_tables_)
   {
     table_names.emplace_back(table_item.first);
   }
+  for (const auto &table_item : lazy_tables_)
+  {
+    table_names.emplace_back(table_item.first);
+  }
 }
 
 RC Db::sync()
 {
   RC rc = RC::SUCCESS;
-  for (const auto &table_pair : opened_tables_)
+  std::vector<Table *> tables;
+  opened_table_list(tables);
+  for (Table *table : tables)
   {
-    Table *table = table_pair.second;
     rc = table->sync();
     if (rc != RC::SUCCESS)
     {
@@ -204,6 +612,52 @@ RC Db::sync()
       return rc;
     }
   }
+  // catalog只是用来加快打开，写失败时下次打开解析JSON文件
+  if (RC::SUCCESS != save_catalog())
+  {
+    LOG_WARN("Failed to save catalog of db %s", name_.c_str());
+  }
   LOG_INFO("Sync db over. db=%s", name_.c_str());
   return rc;
+}
+
+RC Db::finish_open_tables()
+{
+  std::vector<Table *> tables;
+  opened_table_list(tables);
+  for (Table *table : tables)
+  {
+    RC rc = table->finish_open();
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to finish opening table. table=%s.%s, rc=%d:%s", name_.c_str(), table->name(), rc, strrc(rc));
+      return rc;
+    }
+  }
+  return open_views();
+}
+
+RC Db::compact(int max_pages)
+{
+  RC rc = RC::SUCCESS;
+  std::vector<Table *> tables;
+  opened_table_list(tables);
+  for (Table *table : tables)
+  {
+    if (table->pinned_by_cursor())
+    {
+      // 整理每个页面都要加写锁，要等游标关闭
+      LOG_DEBUG("Skip compacting table %s.%s scanned by a cursor", name_.c_str(), table->name());
+      continue;
+    }
+    int moved_records = 0;
+    int freed_pages = 0;
+    rc = table->compact(max_pages, &moved_records, &freed_pages);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to compact table. table=%s.%s, rc=%d:%s", name_.c_str(), table->name(), rc, strrc(rc));
+      return rc;
+    }
+  }
+  return rc;
 }
\ No newline at end of file
@@ -15,14 +15,21 @@ See the Mulan PSL v2 for more details. */
 #ifndef __OBSERVER_STORAGE_COMMON_DB_H__
 #define __OBSERVER_STORAGE_COMMON_DB_H__
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <unordered_map>
 
 #include "rc.h"
 #include "sql/parser/parse_defs.h"
+#include "storage/common/catalog_file.h"
+
+#define DB_DEFAULT_TABLE_OPEN_THREADS 4
+#define DB_MAX_TABLE_OPEN_THREADS 64
 
 class Table;
+class MaterializedView;
 
 class Db
 {
@@ -38,12 +45,38 @@ public:
    * @param table_name 表名
    * @param attribute_count 字段个数
    * @param attributes 字段
+   * @param page_size 数据和索引文件的页面大小，0表示默认大小
+   * @param compression 数据文件的页面压缩方式，nullptr表示不压缩
+   * @param format 数据文件的记录格式(row/pax)，nullptr表示row
+   * @param engine 存储引擎(disk/memory)，nullptr表示disk
+   * @param bloom_filter 建布隆过滤器的字段，nullptr表示不建
+   * @param primary_key_num 主键字段的个数，0表示没有主键
    * @return RC 执行结果状态
    */
-  RC create_table(const char *table_name, int attribute_count, const AttrInfo *attributes);
+  RC create_table(const char *table_name, int attribute_count, const AttrInfo *attributes, int page_size = 0,
+                  const char *compression = nullptr, const char *format = nullptr, const char *engine = nullptr,
+                  const PartitionDef *partition = nullptr, const char *bloom_filter = nullptr,
+                  int primary_key_num = 0, const char *const primary_keys[] = nullptr);
+
+  /**
+   * 创建select上的物化视图，结果保存在名为view_name的表中，见MaterializedView。
+   * 删除视图和删除表一样用drop_table，基表上还有视图时不能删除
+   */
+  RC create_materialized_view(const char *view_name, const Selects &selects);
 
   RC drop_table(const char *table_name);
+  /**
+   * 清空表中的记录，见Table::truncate
+   */
+  RC truncate_table(const char *table_name);
+  /**
+   * 收集表的统计信息，见Table::analyze_table
+   */
+  RC analyze_table(const char *table_name);
 
+  /**
+   * 延迟打开时，第一次查找某张表的时候才打开它
+   */
   Table *find_table(const char *table_name) const;
 
   const char *name() const;
@@ -52,13 +85,64 @@ public:
 
   RC sync();
 
+  /**
+   * 整理所有表的记录文件，每张表最多处理max_pages个页面
+   */
+  RC compact(int max_pages);
+
+  /**
+   * redo日志恢复结束之后完成所有打开的表的打开过程，见Table::finish_open
+   */
+  RC finish_open_tables();
+
+  /**
+   * 打开db时同时打开表使用的线程数，1表示逐个打开
+   */
+  static void set_table_open_threads(int thread_num);
+  /**
+   * 打开db时只列出表的元数据文件，表在第一次使用时才打开。
+   * 有redo日志要恢复时所有的表都要处理遗留的事务字段，这时仍然全部打开
+   */
+  static void set_lazy_table_open(bool lazy);
+
 private:
   RC open_all_tables();
+  /**
+   * 用多个线程打开这些元数据文件对应的表，有一张表打开失败时关闭所有已经打开的表。
+   * json_tables返回没有用catalog、解析了JSON文件的表数
+   */
+  RC open_tables(const std::vector<std::string> &table_meta_files, std::vector<Table *> &tables, int *json_tables);
+  /**
+   * 需要持有tables_mutex_
+   */
+  Table *open_lazy_table(const char *table_name) const;
+  /**
+   * 把所有表的元数据写到catalog文件中，还没有打开的表沿用catalog中原来的条目
+   */
+  RC save_catalog();
+  /**
+   * 当前打开的所有表，避免遍历的时候有表被延迟打开
+   */
+  void opened_table_list(std::vector<Table *> &tables) const;
+  /**
+   * 加载所有物化视图的定义，从基表重新计算。表都打开并完成恢复之后调用
+   */
+  RC open_views();
 
 private:
   std::string name_;
   std::string path_;
-  std::unordered_map<std::string, Table *> opened_tables_;
+  mutable std::unordered_map<std::string, Table *> opened_tables_;
+
+  // 还没有打开的表名到元数据文件名的映射，减到0之后find_table不再加锁
+  mutable std::mutex tables_mutex_;
+  mutable std::unordered_map<std::string, std::string> lazy_tables_;
+  mutable std::atomic<int> lazy_table_count_{0};
+
+  CatalogFile catalog_;  // 打开db时加载，延迟打开表的时候还要用
+
+  std::mutex views_mutex_;
+  std::unordered_map<std::string, MaterializedView *> views_;  // 视图名到视图，由views_mutex_保护
 };
 
 #endif // __OBSERVER_STORAGE_COMMON_DB_H__
\ No newline at end of file
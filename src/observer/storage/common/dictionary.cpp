@@ -0,0 +1,117 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Dictionary of a dictionary encoded CHARS field.
+//
+
+#include <string.h>
+
+#include "storage/common/dictionary.h"
+#include "common/log/log.h"
+
+Dictionary::Dictionary(int value_len) : value_len_(value_len)
+{
+  pthread_rwlock_init(&lock_, nullptr);
+}
+
+Dictionary::~Dictionary()
+{
+  pthread_rwlock_destroy(&lock_);
+}
+
+int Dictionary::find(const char *value) const
+{
+  const std::string key(value, strnlen(value, value_len_));
+  pthread_rwlock_rdlock(&lock_);
+  auto iter = codes_.find(key);
+  const int code = iter == codes_.end() ? -1 : iter->second;
+  pthread_rwlock_unlock(&lock_);
+  return code;
+}
+
+RC Dictionary::add(const char *value, int *code, bool *added)
+{
+  *added = false;
+  *code = find(value);
+  if (*code >= 0)
+  {
+    return RC::SUCCESS;
+  }
+
+  std::string key(value, strnlen(value, value_len_));
+  pthread_rwlock_wrlock(&lock_);
+  auto iter = codes_.find(key);
+  if (iter != codes_.end())
+  {
+    // 其它线程已经加进来了
+    *code = iter->second;
+    pthread_rwlock_unlock(&lock_);
+    return RC::SUCCESS;
+  }
+  const int size = size_.load(std::memory_order_relaxed);
+  if (size >= DICTIONARY_MAX_SIZE)
+  {
+    pthread_rwlock_unlock(&lock_);
+    LOG_WARN("Dictionary is full. size=%d", size);
+    return RC::FULL;
+  }
+  std::unique_ptr<std::string[]> &chunk = chunks_[size / DICTIONARY_CHUNK_SIZE];
+  if (chunk == nullptr)
+  {
+    chunk.reset(new std::string[DICTIONARY_CHUNK_SIZE]);
+  }
+  chunk[size % DICTIONARY_CHUNK_SIZE] = key;
+  codes_.emplace(std::move(key), size);
+  // 值写好之后再发布size
+  size_.store(size + 1, std::memory_order_release);
+  pthread_rwlock_unlock(&lock_);
+
+  *code = size;
+  *added = true;
+  return RC::SUCCESS;
+}
+
+void Dictionary::values(std::vector<std::string> &values) const
+{
+  const int size = this->size();
+  values.clear();
+  values.reserve(size);
+  for (int code = 0; code < size; code++)
+  {
+    values.push_back(value(code));
+  }
+}
+
+RC Dictionary::load(const std::vector<std::string> &values)
+{
+  for (const std::string &v : values)
+  {
+    if (v.size() > (size_t)value_len_ || v.find('\0') != std::string::npos)
+    {
+      LOG_ERROR("Invalid dictionary value. value=%s, max length=%d", v.c_str(), value_len_);
+      return RC::GENERIC_ERROR;
+    }
+    int code = -1;
+    bool added = false;
+    RC rc = add(v.c_str(), &code, &added);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+    if (!added)
+    {
+      LOG_ERROR("Duplicate dictionary value. value=%s", v.c_str());
+      return RC::GENERIC_ERROR;
+    }
+  }
+  set_saved_size(size());
+  return RC::SUCCESS;
+}
@@ -0,0 +1,101 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Dictionary of a dictionary encoded CHARS field.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_DICTIONARY_H__
+#define __OBSERVER_STORAGE_COMMON_DICTIONARY_H__
+
+#include <pthread.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rc.h"
+
+#define DICTIONARY_MAX_SIZE 65536   // 一个字段的字典最多保存的不同的值
+#define DICTIONARY_CHUNK_SIZE 1024  // 字典的值按块分配，已经分配的值的地址不会改变
+
+/**
+ * 字典编码的CHARS字段的字典。记录和索引中保存的是值在字典中的编码(int)，编码是值加入字典的顺序，
+ * 和值的大小没有关系，所以只有等值比较可以直接比较编码。
+ * 字典只增加不删除，已经分配的编码不会改变。按值查编码加读锁，按编码取值不加锁
+ */
+class Dictionary {
+public:
+  /**
+   * @param value_len 建表时字段定义的长度，值不能超过这个长度
+   */
+  explicit Dictionary(int value_len);
+  ~Dictionary();
+
+  Dictionary(const Dictionary &) = delete;
+  Dictionary &operator=(const Dictionary &) = delete;
+
+  int value_len() const
+  {
+    return value_len_;
+  }
+  int size() const
+  {
+    return size_.load(std::memory_order_acquire);
+  }
+  /**
+   * 已经保存到元数据文件中的值的个数，编码小于这个数的值才能写到记录中
+   */
+  int saved_size() const
+  {
+    return saved_size_.load(std::memory_order_acquire);
+  }
+  void set_saved_size(int saved_size)
+  {
+    saved_size_.store(saved_size, std::memory_order_release);
+  }
+
+  /**
+   * 值的编码，不在字典中时返回-1。值是C字符串，超过value_len的部分不算
+   */
+  int find(const char *value) const;
+  /**
+   * 值不在字典中时加到最后，added返回是不是新加的值。字典已经有DICTIONARY_MAX_SIZE个值时返回RC::FULL
+   */
+  RC add(const char *value, int *code, bool *added);
+
+  /**
+   * 编码对应的值，以'\0'结尾。code必须是find或者add返回的编码
+   */
+  const std::string &value(int code) const
+  {
+    return chunks_[code / DICTIONARY_CHUNK_SIZE][code % DICTIONARY_CHUNK_SIZE];
+  }
+
+  /**
+   * 按照编码的顺序返回所有的值，用于保存元数据
+   */
+  void values(std::vector<std::string> &values) const;
+  /**
+   * 从元数据中恢复，按顺序加入所有的值，有重复的值或者超过长度时返回错误。恢复的值都是已经保存的
+   */
+  RC load(const std::vector<std::string> &values);
+
+private:
+  int value_len_;
+  std::atomic<int> size_{0};
+  std::atomic<int> saved_size_{0};
+  std::unique_ptr<std::string[]> chunks_[DICTIONARY_MAX_SIZE / DICTIONARY_CHUNK_SIZE];
+  std::unordered_map<std::string, int> codes_;
+  mutable pthread_rwlock_t lock_;
+};
+
+#endif // __OBSERVER_STORAGE_COMMON_DICTIONARY_H__
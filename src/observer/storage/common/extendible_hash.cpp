@@ -0,0 +1,810 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Extendible hash file for equality-only indexes.
+//
+
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+
+#include "storage/common/extendible_hash.h"
+#include "common/log/log.h"
+
+static const PageNum NO_PAGE = -1;
+// 目录项的下标是size_t，哈希值也只用低位
+static const int MAX_HASH_DEPTH = 30;
+
+/**
+ * 哈希文件的读写锁，在析构时释放
+ */
+class HashLatchGuard
+{
+public:
+  HashLatchGuard(pthread_rwlock_t &latch, bool exclusive) : latch_(latch)
+  {
+    if (exclusive)
+    {
+      pthread_rwlock_wrlock(&latch_);
+    }
+    else
+    {
+      pthread_rwlock_rdlock(&latch_);
+    }
+  }
+  ~HashLatchGuard()
+  {
+    pthread_rwlock_unlock(&latch_);
+  }
+
+private:
+  pthread_rwlock_t &latch_;
+};
+
+void HashKeyOperator::init(const std::vector<IndexKeyColumn> &columns)
+{
+  columns_ = columns;
+}
+
+int HashKeyOperator::compare(const void *data1, const void *data2) const
+{
+  const char *v1 = (const char *)data1;
+  const char *v2 = (const char *)data2;
+  for (const IndexKeyColumn &column : columns_)
+  {
+    int result = column.type == CHARS ? strncmp(v1 + column.offset, v2 + column.offset, column.length)
+                                      : memcmp(v1 + column.offset, v2 + column.offset, column.length);
+    if (result != 0)
+    {
+      return result;
+    }
+  }
+  return 0;
+}
+
+size_t HashKeyOperator::hash(const void *data) const
+{
+  // FNV-1a，最后再混合一次让低位也足够分散
+  uint64_t h = 14695981039346656037ULL;
+  const char *value = (const char *)data;
+  for (const IndexKeyColumn &column : columns_)
+  {
+    const char *field = value + column.offset;
+    int length = column.type == CHARS ? (int)strnlen(field, column.length) : column.length;
+    for (int i = 0; i < length; i++)
+    {
+      h ^= (unsigned char)field[i];
+      h *= 1099511628211ULL;
+    }
+    // 字段之间加一个分隔，("ab", "c")和("a", "bc")的哈希值不同
+    h ^= 0xff;
+    h *= 1099511628211ULL;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return (size_t)h;
+}
+
+ExtendibleHashHandler::ExtendibleHashHandler()
+{
+  pthread_rwlock_init(&latch_, nullptr);
+  memset(&file_header_, 0, sizeof(file_header_));
+}
+
+ExtendibleHashHandler::~ExtendibleHashHandler()
+{
+  pthread_rwlock_destroy(&latch_);
+}
+
+RC ExtendibleHashHandler::init_key_columns(const AttrType attr_types[], const int attr_lengths[], int column_num)
+{
+  std::vector<IndexKeyColumn> columns;
+  int offset = 0;
+  for (int i = 0; i < column_num; i++)
+  {
+    IndexKeyColumn column;
+    column.type = attr_types[i];
+    column.offset = offset;
+    column.length = attr_lengths[i];
+    columns.push_back(column);
+    offset += attr_lengths[i];
+  }
+  if (column_num <= 0 || offset != file_header_.attr_length)
+  {
+    LOG_ERROR("Hash index key columns do not match the index file. column num=%d, length=%d, file attr length=%d",
+              column_num, offset, file_header_.attr_length);
+    return RC::INVALID_ARGUMENT;
+  }
+  key_operator_.init(columns);
+
+  // 文件头页面的剩余空间放目录页面的页号，决定了目录最多有多少项
+  const int page_data_size = disk_buffer_pool_->page_data_size();
+  const size_t max_dir_pages = (page_data_size - sizeof(HashFileHeader)) / sizeof(PageNum);
+  const size_t max_dir_entries = max_dir_pages * (page_data_size / sizeof(PageNum));
+  max_depth_ = 0;
+  while (max_depth_ < MAX_HASH_DEPTH && ((size_t)2 << max_depth_) <= max_dir_entries)
+  {
+    max_depth_++;
+  }
+  return RC::SUCCESS;
+}
+
+RC ExtendibleHashHandler::create(const char *file_name, const AttrType attr_types[], const int attr_lengths[],
+                                 int column_num, int page_size)
+{
+  if (disk_buffer_pool_ != nullptr)
+  {
+    return RC::RECORD_OPENNED;
+  }
+  if (column_num <= 0)
+  {
+    LOG_ERROR("Invalid column num %d of hash index file %s", column_num, file_name);
+    return RC::INVALID_ARGUMENT;
+  }
+  int attr_length = 0;
+  for (int i = 0; i < column_num; i++)
+  {
+    attr_length += attr_lengths[i];
+  }
+
+  DiskBufferPool *disk_buffer_pool = theGlobalDiskBufferPool(page_size);
+  if (disk_buffer_pool == nullptr)
+  {
+    LOG_ERROR("Invalid page size %d of hash index file %s", page_size, file_name);
+    return RC::INVALID_ARGUMENT;
+  }
+  HashFileHeader file_header;
+  file_header.attr_length = attr_length;
+  file_header.entry_length = attr_length + sizeof(RID);
+  file_header.bucket_capacity =
+      (disk_buffer_pool->page_data_size() - (int)sizeof(HashBucket)) / file_header.entry_length;
+  file_header.global_depth = 0;
+  file_header.dir_page_num = 0;
+  if (file_header.bucket_capacity < 2)
+  {
+    LOG_ERROR("Hash index key is too long. file name=%s, attr length=%d", file_name, attr_length);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  RC rc = disk_buffer_pool->create_file(file_name);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  int file_id;
+  rc = disk_buffer_pool->open_file(file_name, &file_id);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to open file. file name=%s, rc=%d:%s", file_name, rc, strrc(rc));
+    return rc;
+  }
+
+  // 第一个页面是文件头，然后是第一个桶
+  BPPageHandle page_handle;
+  rc = disk_buffer_pool->allocate_page(file_id, &page_handle);
+  if (rc == RC::SUCCESS)
+  {
+    disk_buffer_pool->unpin_page(&page_handle);
+    rc = disk_buffer_pool->allocate_page(file_id, &page_handle);
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to allocate page. file name=%s, rc=%d:%s", file_name, rc, strrc(rc));
+    disk_buffer_pool->close_file(file_id);
+    return rc;
+  }
+  char *pdata;
+  PageNum bucket_page;
+  disk_buffer_pool->get_data(&page_handle, &pdata);
+  disk_buffer_pool->get_page_num(&page_handle, &bucket_page);
+  HashBucket *bucket = (HashBucket *)pdata;
+  bucket->local_depth = 0;
+  bucket->entry_num = 0;
+  bucket->next = NO_PAGE;
+  disk_buffer_pool->mark_dirty(&page_handle);
+  disk_buffer_pool->unpin_page(&page_handle);
+
+  disk_buffer_pool_ = disk_buffer_pool;
+  file_id_ = file_id;
+  file_header_ = file_header;
+  dir_pages_.clear();
+  directory_.assign(1, bucket_page);
+  meta_dirty_ = true;
+  rc = init_key_columns(attr_types, attr_lengths, column_num);
+  if (rc == RC::SUCCESS)
+  {
+    rc = sync();
+  }
+  if (rc != RC::SUCCESS)
+  {
+    close();
+  }
+  return rc;
+}
+
+RC ExtendibleHashHandler::open(const char *file_name, const AttrType attr_types[], const int attr_lengths[],
+                               int column_num)
+{
+  if (disk_buffer_pool_ != nullptr)
+  {
+    return RC::RECORD_OPENNED;
+  }
+  int page_size = BP_PAGE_SIZE;
+  RC rc = DiskBufferPool::read_file_page_size(file_name, &page_size);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  DiskBufferPool *disk_buffer_pool = theGlobalDiskBufferPool(page_size);
+  int file_id;
+  rc = disk_buffer_pool->open_file(file_name, &file_id);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  disk_buffer_pool_ = disk_buffer_pool;
+  file_id_ = file_id;
+  rc = load_directory();
+  if (rc == RC::SUCCESS)
+  {
+    rc = init_key_columns(attr_types, attr_lengths, column_num);
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to open hash index file %s. rc=%d:%s", file_name, rc, strrc(rc));
+    close();
+  }
+  return rc;
+}
+
+RC ExtendibleHashHandler::close()
+{
+  if (disk_buffer_pool_ == nullptr)
+  {
+    return RC::SUCCESS;
+  }
+  sync();
+  disk_buffer_pool_->close_file(file_id_);
+  file_id_ = -1;
+  disk_buffer_pool_ = nullptr;
+  directory_.clear();
+  dir_pages_.clear();
+  return RC::SUCCESS;
+}
+
+RC ExtendibleHashHandler::drop()
+{
+  if (disk_buffer_pool_ == nullptr)
+  {
+    return RC::SUCCESS;
+  }
+  RC rc = disk_buffer_pool_->drop_file(file_id_);
+  file_id_ = -1;
+  disk_buffer_pool_ = nullptr;
+  meta_dirty_ = false;
+  directory_.clear();
+  dir_pages_.clear();
+  return rc;
+}
+
+RC ExtendibleHashHandler::sync()
+{
+  HashLatchGuard guard(latch_, true);
+  if (meta_dirty_)
+  {
+    RC rc = write_directory();
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+    meta_dirty_ = false;
+  }
+  return disk_buffer_pool_->flush_all_pages(file_id_);
+}
+
+RC ExtendibleHashHandler::map_readonly()
+{
+  RC rc = sync();
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  return disk_buffer_pool_->map_file(file_id_);
+}
+
+RC ExtendibleHashHandler::load_directory()
+{
+  BPPageHandle page_handle;
+  char *pdata;
+  RC rc = disk_buffer_pool_->get_this_page(file_id_, 1, &page_handle);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  disk_buffer_pool_->get_data(&page_handle, &pdata);
+  memcpy(&file_header_, pdata, sizeof(file_header_));
+  const PageNum *dir_pages = (const PageNum *)(pdata + sizeof(HashFileHeader));
+  dir_pages_.assign(dir_pages, dir_pages + file_header_.dir_page_num);
+  disk_buffer_pool_->unpin_page(&page_handle);
+
+  const size_t entries_per_page = disk_buffer_pool_->page_data_size() / sizeof(PageNum);
+  const size_t dir_size = (size_t)1 << file_header_.global_depth;
+  directory_.clear();
+  for (size_t i = 0; i < dir_pages_.size() && directory_.size() < dir_size; i++)
+  {
+    rc = disk_buffer_pool_->get_this_page(file_id_, dir_pages_[i], &page_handle);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to read hash directory page %d. rc=%d:%s", dir_pages_[i], rc, strrc(rc));
+      return rc;
+    }
+    disk_buffer_pool_->get_data(&page_handle, &pdata);
+    size_t count = std::min(entries_per_page, dir_size - directory_.size());
+    directory_.insert(directory_.end(), (const PageNum *)pdata, (const PageNum *)pdata + count);
+    disk_buffer_pool_->unpin_page(&page_handle);
+  }
+  if (directory_.size() != dir_size)
+  {
+    LOG_ERROR("Hash directory is incomplete. expect %lu entries, got %lu", dir_size, directory_.size());
+    return RC::GENERIC_ERROR;
+  }
+  meta_dirty_ = false;
+  return RC::SUCCESS;
+}
+
+RC ExtendibleHashHandler::write_directory()
+{
+  RC rc;
+  BPPageHandle page_handle;
+  char *pdata;
+  const size_t entries_per_page = disk_buffer_pool_->page_data_size() / sizeof(PageNum);
+  const size_t need_pages = (directory_.size() + entries_per_page - 1) / entries_per_page;
+  // 目录只会变大，不够时分配新的目录页面
+  while (dir_pages_.size() < need_pages)
+  {
+    rc = disk_buffer_pool_->allocate_page(file_id_, &page_handle);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate hash directory page. rc=%d:%s", rc, strrc(rc));
+      return rc;
+    }
+    PageNum page_num;
+    disk_buffer_pool_->get_page_num(&page_handle, &page_num);
+    disk_buffer_pool_->unpin_page(&page_handle);
+    dir_pages_.push_back(page_num);
+  }
+  for (size_t i = 0; i < need_pages; i++)
+  {
+    rc = disk_buffer_pool_->get_this_page(file_id_, dir_pages_[i], &page_handle);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+    disk_buffer_pool_->get_data(&page_handle, &pdata);
+    size_t begin = i * entries_per_page;
+    size_t count = std::min(entries_per_page, directory_.size() - begin);
+    memcpy(pdata, directory_.data() + begin, count * sizeof(PageNum));
+    disk_buffer_pool_->mark_dirty(&page_handle);
+    disk_buffer_pool_->unpin_page(&page_handle);
+  }
+
+  file_header_.dir_page_num = (int)dir_pages_.size();
+  rc = disk_buffer_pool_->get_this_page(file_id_, 1, &page_handle);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  disk_buffer_pool_->get_data(&page_handle, &pdata);
+  memcpy(pdata, &file_header_, sizeof(file_header_));
+  memcpy(pdata + sizeof(HashFileHeader), dir_pages_.data(), dir_pages_.size() * sizeof(PageNum));
+  disk_buffer_pool_->mark_dirty(&page_handle);
+  disk_buffer_pool_->unpin_page(&page_handle);
+  return RC::SUCCESS;
+}
+
+RC ExtendibleHashHandler::insert_entry(const char *pkey, const RID *rid, bool unique)
+{
+  HashLatchGuard guard(latch_, true);
+  const int attr_length = file_header_.attr_length;
+  const int entry_length = file_header_.entry_length;
+  const size_t hash = key_operator_.hash(pkey);
+  while (true)
+  {
+    // 遍历桶的所有页面检查重复，同时找一个有空位的页面
+    PageNum free_page = NO_PAGE;
+    PageNum last_page = NO_PAGE;
+    int local_depth = 0;
+    for (PageNum page_num = directory_[hash & dir_mask()]; page_num != NO_PAGE;)
+    {
+      BPPageHandle page_handle;
+      char *pdata;
+      RC rc = disk_buffer_pool_->get_this_page(file_id_, page_num, &page_handle);
+      if (rc != RC::SUCCESS)
+      {
+        LOG_ERROR("Failed to get hash bucket page %d. rc=%d:%s", page_num, rc, strrc(rc));
+        return rc;
+      }
+      disk_buffer_pool_->get_data(&page_handle, &pdata);
+      HashBucket *bucket = (HashBucket *)pdata;
+      const char *entries = pdata + sizeof(HashBucket);
+      for (int i = 0; i < bucket->entry_num; i++)
+      {
+        const char *entry = entries + i * entry_length;
+        if (key_operator_.compare(entry, pkey) == 0 &&
+            (unique || 0 == memcmp(entry + attr_length, rid, sizeof(RID))))
+        {
+          disk_buffer_pool_->unpin_page(&page_handle);
+          return RC::RECORD_DUPLICATE_KEY;
+        }
+      }
+      if (last_page == NO_PAGE)
+      {
+        local_depth = bucket->local_depth;
+      }
+      if (free_page == NO_PAGE && bucket->entry_num < file_header_.bucket_capacity)
+      {
+        free_page = page_num;
+      }
+      last_page = page_num;
+      page_num = bucket->next;
+      disk_buffer_pool_->unpin_page(&page_handle);
+    }
+
+    if (free_page != NO_PAGE)
+    {
+      BPPageHandle page_handle;
+      char *pdata;
+      RC rc = disk_buffer_pool_->get_this_page(file_id_, free_page, &page_handle);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+      disk_buffer_pool_->get_data(&page_handle, &pdata);
+      HashBucket *bucket = (HashBucket *)pdata;
+      char *entry = pdata + sizeof(HashBucket) + bucket->entry_num * entry_length;
+      memcpy(entry, pkey, attr_length);
+      memcpy(entry + attr_length, rid, sizeof(RID));
+      bucket->entry_num++;
+      disk_buffer_pool_->mark_dirty(&page_handle);
+      disk_buffer_pool_->unpin_page(&page_handle);
+      return RC::SUCCESS;
+    }
+
+    // 桶满了，能分裂就分裂之后重新找桶，否则加一个溢出页
+    if (local_depth < max_depth_)
+    {
+      std::vector<PageNum> pages;
+      std::vector<char> entries;
+      RC rc = read_bucket(directory_[hash & dir_mask()], pages, entries, &local_depth);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+      if (can_split(entries, hash))
+      {
+        rc = split_bucket(hash);
+        if (rc != RC::SUCCESS)
+        {
+          return rc;
+        }
+        continue;
+      }
+    }
+    return append_overflow_page(last_page, pkey, rid);
+  }
+}
+
+bool ExtendibleHashHandler::can_split(const std::vector<char> &entries, size_t hash) const
+{
+  const size_t mask = ((size_t)1 << max_depth_) - 1;
+  for (size_t offset = 0; offset < entries.size(); offset += file_header_.entry_length)
+  {
+    if ((key_operator_.hash(entries.data() + offset) & mask) != (hash & mask))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+RC ExtendibleHashHandler::append_overflow_page(PageNum last_page, const char *pkey, const RID *rid)
+{
+  BPPageHandle page_handle;
+  char *pdata;
+  RC rc = disk_buffer_pool_->allocate_page(file_id_, &page_handle);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to allocate hash overflow page. rc=%d:%s", rc, strrc(rc));
+    return rc;
+  }
+  PageNum page_num;
+  disk_buffer_pool_->get_page_num(&page_handle, &page_num);
+  disk_buffer_pool_->get_data(&page_handle, &pdata);
+  HashBucket *bucket = (HashBucket *)pdata;
+  bucket->local_depth = 0;
+  bucket->entry_num = 1;
+  bucket->next = NO_PAGE;
+  char *entry = pdata + sizeof(HashBucket);
+  memcpy(entry, pkey, file_header_.attr_length);
+  memcpy(entry + file_header_.attr_length, rid, sizeof(RID));
+  disk_buffer_pool_->mark_dirty(&page_handle);
+  disk_buffer_pool_->unpin_page(&page_handle);
+
+  rc = disk_buffer_pool_->get_this_page(file_id_, last_page, &page_handle);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  disk_buffer_pool_->get_data(&page_handle, &pdata);
+  ((HashBucket *)pdata)->next = page_num;
+  disk_buffer_pool_->mark_dirty(&page_handle);
+  disk_buffer_pool_->unpin_page(&page_handle);
+  return RC::SUCCESS;
+}
+
+RC ExtendibleHashHandler::read_bucket(PageNum bucket_page, std::vector<PageNum> &pages, std::vector<char> &entries,
+                                      int *local_depth)
+{
+  const int entry_length = file_header_.entry_length;
+  for (PageNum page_num = bucket_page; page_num != NO_PAGE;)
+  {
+    BPPageHandle page_handle;
+    char *pdata;
+    RC rc = disk_buffer_pool_->get_this_page(file_id_, page_num, &page_handle);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to get hash bucket page %d. rc=%d:%s", page_num, rc, strrc(rc));
+      return rc;
+    }
+    disk_buffer_pool_->get_data(&page_handle, &pdata);
+    HashBucket *bucket = (HashBucket *)pdata;
+    if (pages.empty())
+    {
+      *local_depth = bucket->local_depth;
+    }
+    const char *begin = pdata + sizeof(HashBucket);
+    entries.insert(entries.end(), begin, begin + bucket->entry_num * entry_length);
+    pages.push_back(page_num);
+    page_num = bucket->next;
+    disk_buffer_pool_->unpin_page(&page_handle);
+  }
+  return RC::SUCCESS;
+}
+
+RC ExtendibleHashHandler::write_bucket(std::vector<PageNum> &pages, const char *entries, int entry_num,
+                                       int local_depth)
+{
+  RC rc;
+  const int capacity = file_header_.bucket_capacity;
+  const size_t need_pages = entry_num == 0 ? 1 : (entry_num + capacity - 1) / capacity;
+  BPPageHandle page_handle;
+  while (pages.size() < need_pages)
+  {
+    rc = disk_buffer_pool_->allocate_page(file_id_, &page_handle);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate hash bucket page. rc=%d:%s", rc, strrc(rc));
+      return rc;
+    }
+    PageNum page_num;
+    disk_buffer_pool_->get_page_num(&page_handle, &page_num);
+    disk_buffer_pool_->unpin_page(&page_handle);
+    pages.push_back(page_num);
+  }
+  for (size_t i = need_pages; i < pages.size(); i++)
+  {
+    disk_buffer_pool_->dispose_page(file_id_, pages[i]);
+  }
+  pages.resize(need_pages);
+
+  for (size_t i = 0; i < need_pages; i++)
+  {
+    char *pdata;
+    rc = disk_buffer_pool_->get_this_page(file_id_, pages[i], &page_handle);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+    disk_buffer_pool_->get_data(&page_handle, &pdata);
+    HashBucket *bucket = (HashBucket *)pdata;
+    int begin = (int)i * capacity;
+    bucket->local_depth = local_depth;
+    bucket->entry_num = std::min(capacity, entry_num - begin);
+    bucket->next = i + 1 < need_pages ? pages[i + 1] : NO_PAGE;
+    memcpy(pdata + sizeof(HashBucket), entries + begin * file_header_.entry_length,
+           bucket->entry_num * file_header_.entry_length);
+    disk_buffer_pool_->mark_dirty(&page_handle);
+    disk_buffer_pool_->unpin_page(&page_handle);
+  }
+  return RC::SUCCESS;
+}
+
+RC ExtendibleHashHandler::split_bucket(size_t hash)
+{
+  std::vector<PageNum> old_pages;
+  std::vector<char> entries;
+  int local_depth = 0;
+  RC rc = read_bucket(directory_[hash & dir_mask()], old_pages, entries, &local_depth);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  if (local_depth == file_header_.global_depth)
+  {
+    // 目录加倍，新的一半和原来的一半指向相同的桶
+    directory_.insert(directory_.end(), directory_.begin(), directory_.end());
+    file_header_.global_depth++;
+  }
+
+  const size_t bit = (size_t)1 << local_depth;
+  const int entry_length = file_header_.entry_length;
+  std::vector<char> stay_entries;
+  std::vector<char> move_entries;
+  for (size_t offset = 0; offset < entries.size(); offset += entry_length)
+  {
+    const char *entry = entries.data() + offset;
+    std::vector<char> &target = (key_operator_.hash(entry) & bit) ? move_entries : stay_entries;
+    target.insert(target.end(), entry, entry + entry_length);
+  }
+
+  std::vector<PageNum> new_pages;
+  rc = write_bucket(old_pages, stay_entries.data(), (int)(stay_entries.size() / entry_length), local_depth + 1);
+  if (rc == RC::SUCCESS)
+  {
+    rc = write_bucket(new_pages, move_entries.data(), (int)(move_entries.size() / entry_length), local_depth + 1);
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to split hash bucket. rc=%d:%s", rc, strrc(rc));
+    return rc;
+  }
+
+  // 低local_depth位相同的目录项原来都指向这个桶，其中第local_depth位是1的改为指向新桶
+  for (size_t i = hash & (bit - 1); i < directory_.size(); i += bit)
+  {
+    if (i & bit)
+    {
+      directory_[i] = new_pages[0];
+    }
+  }
+  meta_dirty_ = true;
+  return RC::SUCCESS;
+}
+
+RC ExtendibleHashHandler::delete_entry(const char *pkey, const RID *rid)
+{
+  HashLatchGuard guard(latch_, true);
+  const int attr_length = file_header_.attr_length;
+  const int entry_length = file_header_.entry_length;
+  PageNum prev_page = NO_PAGE;
+  for (PageNum page_num = directory_[key_operator_.hash(pkey) & dir_mask()]; page_num != NO_PAGE;)
+  {
+    BPPageHandle page_handle;
+    char *pdata;
+    RC rc = disk_buffer_pool_->get_this_page(file_id_, page_num, &page_handle);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to get hash bucket page %d. rc=%d:%s", page_num, rc, strrc(rc));
+      return rc;
+    }
+    disk_buffer_pool_->get_data(&page_handle, &pdata);
+    HashBucket *bucket = (HashBucket *)pdata;
+    char *entries = pdata + sizeof(HashBucket);
+    for (int i = 0; i < bucket->entry_num; i++)
+    {
+      char *entry = entries + i * entry_length;
+      if (key_operator_.compare(entry, pkey) != 0 || 0 != memcmp(entry + attr_length, rid, sizeof(RID)))
+      {
+        continue;
+      }
+      // 页面内的索引项没有顺序，用最后一个填上空位
+      bucket->entry_num--;
+      memmove(entry, entries + bucket->entry_num * entry_length, entry_length);
+      PageNum next = bucket->next;
+      bool release = bucket->entry_num == 0 && prev_page != NO_PAGE;
+      disk_buffer_pool_->mark_dirty(&page_handle);
+      disk_buffer_pool_->unpin_page(&page_handle);
+      if (release)
+      {
+        // 空的溢出页从链表中摘掉，桶的第一个页面一直保留
+        rc = disk_buffer_pool_->get_this_page(file_id_, prev_page, &page_handle);
+        if (rc != RC::SUCCESS)
+        {
+          return rc;
+        }
+        disk_buffer_pool_->get_data(&page_handle, &pdata);
+        ((HashBucket *)pdata)->next = next;
+        disk_buffer_pool_->mark_dirty(&page_handle);
+        disk_buffer_pool_->unpin_page(&page_handle);
+        disk_buffer_pool_->dispose_page(file_id_, page_num);
+      }
+      return RC::SUCCESS;
+    }
+    prev_page = page_num;
+    page_num = bucket->next;
+    disk_buffer_pool_->unpin_page(&page_handle);
+  }
+  return RC::RECORD_INVALID_KEY;
+}
+
+RC ExtendibleHashHandler::get_entries(const char *pkey, std::vector<RID> &rids, std::vector<char> *keys)
+{
+  HashLatchGuard guard(latch_, false);
+  const int attr_length = file_header_.attr_length;
+  const int entry_length = file_header_.entry_length;
+  for (PageNum page_num = directory_[key_operator_.hash(pkey) & dir_mask()]; page_num != NO_PAGE;)
+  {
+    BPPageHandle page_handle;
+    char *pdata;
+    RC rc = disk_buffer_pool_->get_this_page(file_id_, page_num, &page_handle);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to get hash bucket page %d. rc=%d:%s", page_num, rc, strrc(rc));
+      return rc;
+    }
+    disk_buffer_pool_->get_data(&page_handle, &pdata);
+    const HashBucket *bucket = (const HashBucket *)pdata;
+    const char *entries = pdata + sizeof(HashBucket);
+    for (int i = 0; i < bucket->entry_num; i++)
+    {
+      const char *entry = entries + i * entry_length;
+      if (key_operator_.compare(entry, pkey) == 0)
+      {
+        RID rid;
+        memcpy(&rid, entry + attr_length, sizeof(RID));
+        rids.push_back(rid);
+        if (keys != nullptr)
+        {
+          keys->insert(keys->end(), entry, entry + attr_length);
+        }
+      }
+    }
+    page_num = bucket->next;
+    disk_buffer_pool_->unpin_page(&page_handle);
+  }
+  return RC::SUCCESS;
+}
+
+ExtendibleHashScanner::ExtendibleHashScanner(ExtendibleHashHandler &handler) : handler_(handler)
+{}
+
+RC ExtendibleHashScanner::open(const char *pkey)
+{
+  rids_.clear();
+  keys_.clear();
+  index_ = 0;
+  return handler_.get_entries(pkey, rids_, &keys_);
+}
+
+RC ExtendibleHashScanner::next_entry(RID *rid, char *key)
+{
+  if (index_ >= rids_.size())
+  {
+    return RC::RECORD_EOF;
+  }
+  *rid = rids_[index_];
+  if (key != nullptr)
+  {
+    const int attr_length = handler_.attr_length();
+    memcpy(key, keys_.data() + index_ * attr_length, attr_length);
+  }
+  index_++;
+  return RC::SUCCESS;
+}
+
+RC ExtendibleHashScanner::close()
+{
+  rids_.clear();
+  keys_.clear();
+  index_ = 0;
+  return RC::SUCCESS;
+}
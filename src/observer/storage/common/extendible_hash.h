@@ -0,0 +1,174 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Extendible hash file for equality-only indexes.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_EXTENDIBLE_HASH_H_
+#define __OBSERVER_STORAGE_COMMON_EXTENDIBLE_HASH_H_
+
+#include <stddef.h>
+#include <pthread.h>
+#include <vector>
+
+#include "rc.h"
+#include "storage/common/index.h"
+#include "storage/common/bplus_tree.h"
+#include "storage/default/disk_buffer_pool.h"
+
+/**
+ * 文件的第一个数据页面，后面紧跟着目录页面的页号
+ */
+struct HashFileHeader {
+  int attr_length;
+  int entry_length;     // 索引项的长度，属性值后面跟着RID
+  int bucket_capacity;  // 一个桶页面最多放的索引项数
+  int global_depth;     // 目录有2^global_depth项
+  int dir_page_num;     // 保存目录的页面数
+};
+
+/**
+ * 桶页面的头部，后面是entry_num个索引项。同一个桶的页面用next串起来，
+ * 哈希值相同的索引项太多、不能再分裂时放到溢出页中
+ */
+struct HashBucket {
+  int local_depth;
+  int entry_num;
+  PageNum next;
+};
+
+/**
+ * 按索引字段比较和计算哈希值。相等的key哈希值一定相同，比如 0.0 和 -0.0，
+ * 字符串只看结束符之前的部分
+ */
+class HashKeyOperator : public IndexDataOperator {
+public:
+  void init(const std::vector<IndexKeyColumn> &columns);
+
+  /**
+   * 只区分是否相等，不相等时返回非0
+   */
+  int compare(const void *data1, const void *data2) const override;
+  size_t hash(const void *data) const override;
+
+private:
+  std::vector<IndexKeyColumn> columns_;
+};
+
+/**
+ * 可扩展哈希：key的哈希值的低global_depth位在目录中找到桶，一次读一个页面就可以完成等值查找。
+ * 桶满时分裂，局部深度达到全局深度时目录加倍；删除时不合并桶。
+ * 目录在打开时全部读到内存中，和文件头一起在sync时写回。
+ * 并发控制：latch_保护整个文件，查找加读锁，插入和删除加写锁
+ */
+class ExtendibleHashHandler {
+public:
+  ExtendibleHashHandler();
+  ~ExtendibleHashHandler();
+
+  /**
+   * 创建多字段的哈希索引，key是各个字段按顺序拼在一起
+   */
+  RC create(const char *file_name, const AttrType attr_types[], const int attr_lengths[], int column_num,
+            int page_size = BP_PAGE_SIZE);
+  RC open(const char *file_name, const AttrType attr_types[], const int attr_lengths[], int column_num);
+  RC close();
+  /**
+   * 关闭文件并丢弃缓冲池中的页面，用于删除索引之前
+   */
+  RC drop();
+  RC sync();
+  /**
+   * 写回目录之后把索引文件只读地映射到内存中，之后不能再修改
+   */
+  RC map_readonly();
+
+  /**
+   * key和rid都相同的索引项已经存在时返回RECORD_DUPLICATE_KEY，
+   * unique为true时只要有属性值相同的索引项就返回RECORD_DUPLICATE_KEY
+   */
+  RC insert_entry(const char *pkey, const RID *rid, bool unique = false);
+  /**
+   * 没有这个索引项时返回RECORD_INVALID_KEY
+   */
+  RC delete_entry(const char *pkey, const RID *rid);
+  /**
+   * 找出属性值等于pkey的所有索引项，keys不为空时同时返回保存的属性值
+   */
+  RC get_entries(const char *pkey, std::vector<RID> &rids, std::vector<char> *keys = nullptr);
+
+  int attr_length() const
+  {
+    return file_header_.attr_length;
+  }
+  int global_depth() const
+  {
+    return file_header_.global_depth;
+  }
+
+private:
+  RC init_key_columns(const AttrType attr_types[], const int attr_lengths[], int column_num);
+  RC load_directory();
+  RC write_directory();
+  /**
+   * 把hash所在的桶分成两个，局部深度加1
+   */
+  RC split_bucket(size_t hash);
+  /**
+   * 读出一个桶所有页面中的索引项
+   */
+  RC read_bucket(PageNum bucket_page, std::vector<PageNum> &pages, std::vector<char> &entries, int *local_depth);
+  /**
+   * 把索引项依次写到pages中，页面不够时分配，多出来的释放掉
+   */
+  RC write_bucket(std::vector<PageNum> &pages, const char *entries, int entry_num, int local_depth);
+  /**
+   * 桶中的索引项加上新的key，哈希值在最大深度内都相同时分裂也分不开
+   */
+  bool can_split(const std::vector<char> &entries, size_t hash) const;
+  RC append_overflow_page(PageNum last_page, const char *pkey, const RID *rid);
+
+  size_t dir_mask() const
+  {
+    return ((size_t)1 << file_header_.global_depth) - 1;
+  }
+
+private:
+  pthread_rwlock_t latch_;
+  DiskBufferPool *disk_buffer_pool_ = nullptr;
+  int file_id_ = -1;
+  HashFileHeader file_header_;
+  std::vector<PageNum> dir_pages_;
+  std::vector<PageNum> directory_;
+  bool meta_dirty_ = false;
+  int max_depth_ = 0;
+  HashKeyOperator key_operator_;
+};
+
+/**
+ * 等值查找的扫描器，open时把所有满足条件的索引项复制出来，之后不再访问页面
+ */
+class ExtendibleHashScanner {
+public:
+  explicit ExtendibleHashScanner(ExtendibleHashHandler &handler);
+
+  RC open(const char *pkey);
+  RC next_entry(RID *rid, char *key = nullptr);
+  RC close();
+
+private:
+  ExtendibleHashHandler &handler_;
+  std::vector<RID> rids_;
+  std::vector<char> keys_;
+  size_t index_ = 0;
+};
+
+#endif  // __OBSERVER_STORAGE_COMMON_EXTENDIBLE_HASH_H_
@@ -13,6 +13,8 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include "storage/common/field_meta.h"
+#include "storage/common/dictionary.h"
+#include "storage/common/meta_util.h"
 #include "common/log/log.h"
 
 #include "json/json.h"
@@ -24,6 +26,9 @@ const static Json::StaticString FIELD_OFFSET("offset");
 const static Json::StaticString FIELD_LEN("len");
 const static Json::StaticString FIELD_VISIBLE("visible");
 const static Json::StaticString FIELD_NULLABLE("nullable");
+const static Json::StaticString FIELD_DICTIONARY("dictionary");
+const static Json::StaticString FIELD_DICTIONARY_LEN("len");
+const static Json::StaticString FIELD_DICTIONARY_VALUES("values");
 
 const char *ATTR_TYPE_NAME[] = {
     "undefined",
@@ -83,6 +88,7 @@ RC FieldMeta::init(const char *name, AttrType attr_type, int attr_offset, int at
   attr_offset_ = attr_offset;
   visible_ = visible;
   nullable_ = nullable;
+  dictionary_.reset();
 
   LOG_INFO("Init a field with name=%s type =%d, attr_offset=%d,attr_len=%d,nullable_=%d", name, attr_type, attr_offset, attr_len, nullable_);
   return RC::SUCCESS;
@@ -118,13 +124,27 @@ bool FieldMeta::nullable() const
   return nullable_;
 }
 
+void FieldMeta::set_dictionary(std::shared_ptr<Dictionary> dictionary)
+{
+  dictionary_ = std::move(dictionary);
+}
+
+int FieldMeta::value_len() const
+{
+  return dictionary_ != nullptr ? dictionary_->value_len() : attr_len_;
+}
+
 void FieldMeta::desc(std::ostream &os) const
 {
   os << "field name=" << name_
      << ", type=" << attr_type_to_string(attr_type_)
-     << ", len=" << attr_len_
+     << ", len=" << value_len()
      << ", visible=" << (visible_ ? "yes" : "no")
      << ", nullable=" << (nullable_ ? "yes" : "no");
+  if (dictionary_ != nullptr)
+  {
+    os << ", dictionary=" << dictionary_->size();
+  }
 }
 
 void FieldMeta::to_json(Json::Value &json_value) const
@@ -135,6 +155,42 @@ void FieldMeta::to_json(Json::Value &json_value) const
   json_value[FIELD_LEN] = attr_len_;
   json_value[FIELD_VISIBLE] = visible_;
   json_value[FIELD_NULLABLE] = nullable_;
+  if (dictionary_ != nullptr)
+  {
+    Json::Value dictionary_value;
+    dictionary_value[FIELD_DICTIONARY_LEN] = dictionary_->value_len();
+    Json::Value values_value(Json::arrayValue);
+    std::vector<std::string> values;
+    dictionary_->values(values);
+    for (const std::string &value : values)
+    {
+      values_value.append(value);
+    }
+    dictionary_value[FIELD_DICTIONARY_VALUES] = std::move(values_value);
+    json_value[FIELD_DICTIONARY] = std::move(dictionary_value);
+  }
+}
+
+/**
+ * 按保存的值重建字段的字典，编码就是值在数组中的位置
+ */
+static RC load_dictionary(FieldMeta &field, int value_len, const std::vector<std::string> &values)
+{
+  if (field.type() != CHARS || field.len() != sizeof(int) || value_len <= 0)
+  {
+    LOG_ERROR("Invalid dictionary field. field=%s, type=%d, len=%d, value len=%d",
+              field.name(), field.type(), field.len(), value_len);
+    return RC::GENERIC_ERROR;
+  }
+  std::shared_ptr<Dictionary> dictionary = std::make_shared<Dictionary>(value_len);
+  RC rc = dictionary->load(values);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to load dictionary of field %s. rc=%d:%s", field.name(), rc, strrc(rc));
+    return RC::GENERIC_ERROR;
+  }
+  field.set_dictionary(std::move(dictionary));
+  return RC::SUCCESS;
 }
 
 RC FieldMeta::from_json(const Json::Value &json_value, FieldMeta &field)
@@ -199,5 +255,94 @@ RC FieldMeta::from_json(const Json::Value &json_value, FieldMeta &field)
   bool visible = visible_value.asBool();
   bool nullable = nullable_value.asBool();
 
-  return field.init(name, type, offset, len, visible, nullable);
+  RC rc = field.init(name, type, offset, len, visible, nullable);
+  if (rc != RC::SUCCESS || !json_value.isMember(FIELD_DICTIONARY))
+  {
+    return rc;
+  }
+
+  const Json::Value &dictionary_value = json_value[FIELD_DICTIONARY];
+  const Json::Value &dictionary_len_value = dictionary_value[FIELD_DICTIONARY_LEN];
+  const Json::Value &values_value = dictionary_value[FIELD_DICTIONARY_VALUES];
+  if (!dictionary_len_value.isInt() || !values_value.isArray())
+  {
+    LOG_ERROR("Invalid dictionary of field %s. json value=%s", name, dictionary_value.toStyledString().c_str());
+    return RC::GENERIC_ERROR;
+  }
+  std::vector<std::string> values;
+  values.reserve(values_value.size());
+  for (const Json::Value &value : values_value)
+  {
+    if (!value.isString())
+    {
+      LOG_ERROR("Dictionary value is not a string. json value=%s", value.toStyledString().c_str());
+      return RC::GENERIC_ERROR;
+    }
+    values.push_back(value.asString());
+  }
+  return load_dictionary(field, dictionary_len_value.asInt(), values);
+}
+
+void FieldMeta::to_binary(MetaWriter &writer) const
+{
+  writer.put_string(name_);
+  writer.put_int32(attr_type_);
+  writer.put_int32(attr_offset_);
+  writer.put_int32(attr_len_);
+  writer.put_int32((visible_ ? 1 : 0) | (nullable_ ? 2 : 0) | (dictionary_ != nullptr ? 4 : 0));
+  if (dictionary_ != nullptr)
+  {
+    std::vector<std::string> values;
+    dictionary_->values(values);
+    writer.put_int32(dictionary_->value_len());
+    writer.put_int32((int32_t)values.size());
+    for (const std::string &value : values)
+    {
+      writer.put_string(value);
+    }
+  }
+}
+
+RC FieldMeta::from_binary(MetaReader &reader, FieldMeta &field)
+{
+  std::string name;
+  int32_t type = 0;
+  int32_t offset = 0;
+  int32_t len = 0;
+  int32_t flags = 0;
+  if (!reader.get_string(&name) || !reader.get_int32(&type) || !reader.get_int32(&offset) ||
+      !reader.get_int32(&len) || !reader.get_int32(&flags))
+  {
+    LOG_ERROR("Failed to decode field. data is truncated");
+    return RC::GENERIC_ERROR;
+  }
+  if (type <= UNDEFINED || type > DATES)
+  {
+    LOG_ERROR("Got invalid field type. field=%s, type=%d", name.c_str(), type);
+    return RC::GENERIC_ERROR;
+  }
+  RC rc = field.init(name.c_str(), (AttrType)type, offset, len, (flags & 1) != 0, (flags & 2) != 0);
+  if (rc != RC::SUCCESS || (flags & 4) == 0)
+  {
+    return rc;
+  }
+
+  int32_t value_len = 0;
+  int32_t value_num = 0;
+  if (!reader.get_int32(&value_len) || !reader.get_int32(&value_num) || value_num < 0 ||
+      value_num > DICTIONARY_MAX_SIZE)
+  {
+    LOG_ERROR("Failed to decode dictionary of field %s", name.c_str());
+    return RC::GENERIC_ERROR;
+  }
+  std::vector<std::string> values(value_num);
+  for (std::string &value : values)
+  {
+    if (!reader.get_string(&value))
+    {
+      LOG_ERROR("Failed to decode dictionary of field %s. data is truncated", name.c_str());
+      return RC::GENERIC_ERROR;
+    }
+  }
+  return load_dictionary(field, value_len, values);
 }
@@ -15,6 +15,7 @@ See the Mulan PSL v2 for more details. */
 #ifndef __OBSERVER_STORAGE_COMMON_FIELD_META_H__
 #define __OBSERVER_STORAGE_COMMON_FIELD_META_H__
 
+#include <memory>
 #include <string>
 
 #include "rc.h"
@@ -24,6 +25,10 @@ namespace Json {
 class Value;
 } // namespace Json
 
+class MetaWriter;
+class MetaReader;
+class Dictionary;
+
 class FieldMeta {
 public:
   FieldMeta();
@@ -48,11 +53,37 @@ public:
   bool        visible() const;
   bool        nullable() const;
 
+  /**
+   * 字典编码的CHARS字段，type()仍然是CHARS，记录和索引中保存4字节的编码，len()是4，
+   * 建表时定义的长度是value_len()。字典在表的元数据的各个副本和分区之间共享
+   */
+  Dictionary *dictionary() const
+  {
+    return dictionary_.get();
+  }
+  void set_dictionary(std::shared_ptr<Dictionary> dictionary);
+  /**
+   * 记录中保存的数据的类型，字典编码的字段是INTS
+   */
+  AttrType storage_type() const
+  {
+    return dictionary_ != nullptr ? INTS : attr_type_;
+  }
+  /**
+   * 值的最大长度，字典编码的字段是定义的长度，其它字段和len()相同
+   */
+  int value_len() const;
+
 public:
   void desc(std::ostream &os) const;
 public:
   void to_json(Json::Value &json_value) const;
   static RC from_json(const Json::Value &json_value, FieldMeta &field);
+  /**
+   * 数据库目录中二进制catalog文件使用的格式
+   */
+  void to_binary(MetaWriter &writer) const;
+  static RC from_binary(MetaReader &reader, FieldMeta &field);
 
 private:
   std::string  name_;
@@ -61,5 +92,24 @@ private:
   int          attr_len_;
   bool         visible_;
   bool         nullable_; // 默认为false
+  std::shared_ptr<Dictionary> dictionary_;
+};
+
+/**
+ * 字段的null标志在记录中的位置，record[offset] & mask不为0时字段是null。
+ * 位置由TableMeta::null_flag给出，按位图保存时mask是字段对应的位，以前的版本每个字段一个字节，mask是1
+ */
+struct NullFlag {
+  int offset = 0;
+  unsigned char mask = 0;
+
+  bool test(const char *record) const
+  {
+    return (record[offset] & mask) != 0;
+  }
+  void set(char *record, bool is_null) const
+  {
+    record[offset] = (char)(is_null ? (record[offset] | mask) : (record[offset] & ~mask));
+  }
 };
 #endif // __OBSERVER_STORAGE_COMMON_FIELD_META_H__
\ No newline at end of file
@@ -0,0 +1,178 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Hash index on top of the extendible hash file.
+//
+
+#include <string.h>
+
+#include "storage/common/hash_index.h"
+#include "common/log/log.h"
+
+HashIndex::~HashIndex() noexcept
+{
+  close();
+}
+
+RC HashIndex::create(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas,
+                     int page_size)
+{
+  if (inited_)
+  {
+    return RC::RECORD_OPENNED;
+  }
+  RC rc = Index::init(index_meta, field_metas);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  std::vector<AttrType> types;
+  std::vector<int> lengths;
+  key_columns(types, lengths);
+  rc = index_handler_.create(file_name, types.data(), lengths.data(), (int)types.size(), page_size);
+  if (RC::SUCCESS == rc)
+  {
+    inited_ = true;
+  }
+  return rc;
+}
+
+RC HashIndex::open(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas)
+{
+  if (inited_)
+  {
+    return RC::RECORD_OPENNED;
+  }
+  RC rc = Index::init(index_meta, field_metas);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  std::vector<AttrType> types;
+  std::vector<int> lengths;
+  key_columns(types, lengths);
+  rc = index_handler_.open(file_name, types.data(), lengths.data(), (int)types.size());
+  if (RC::SUCCESS == rc)
+  {
+    inited_ = true;
+  }
+  return rc;
+}
+
+RC HashIndex::close()
+{
+  if (inited_)
+  {
+    index_handler_.close();
+    inited_ = false;
+  }
+  return RC::SUCCESS;
+}
+
+RC HashIndex::drop()
+{
+  RC rc = RC::SUCCESS;
+  if (inited_)
+  {
+    rc = index_handler_.drop();
+    inited_ = false;
+  }
+  return rc;
+}
+
+RC HashIndex::insert_entry(const char *record, const RID *rid)
+{
+  std::vector<char> key;
+  make_key(record, key);
+  return index_handler_.insert_entry(key.data(), rid, check_unique(record));
+}
+
+RC HashIndex::delete_entry(const char *record, const RID *rid)
+{
+  std::vector<char> key;
+  make_key(record, key);
+  return index_handler_.delete_entry(key.data(), rid);
+}
+
+IndexScanner *HashIndex::create_equal_scanner(const char *key)
+{
+  HashIndexScanner *scanner = new HashIndexScanner(index_handler_);
+  RC rc = scanner->open(key);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to open hash index scanner. rc=%d:%s", rc, strrc(rc));
+    delete scanner;
+    return nullptr;
+  }
+  return scanner;
+}
+
+IndexScanner *HashIndex::create_scanner(CompOp comp_op, const char *value, int null_field_index)
+{
+  if (comp_op != EQUAL_TO || field_metas_.size() != 1)
+  {
+    LOG_WARN("Hash index %s only supports equality on all fields", index_meta_.name());
+    return nullptr;
+  }
+  return create_equal_scanner(value);
+}
+
+IndexScanner *HashIndex::create_range_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                              const char *high, int high_column_num, bool high_inclusive)
+{
+  // 只有上下界相同而且包含了所有字段时才是等值查找
+  const int column_num = (int)field_metas_.size();
+  if (low == nullptr || high == nullptr || low_column_num != column_num || high_column_num != column_num ||
+      !low_inclusive || !high_inclusive || 0 != memcmp(low, high, key_length()))
+  {
+    LOG_WARN("Hash index %s only supports equality on all fields", index_meta_.name());
+    return nullptr;
+  }
+  return create_equal_scanner(low);
+}
+
+RC HashIndex::sync()
+{
+  return index_handler_.sync();
+}
+
+RC HashIndex::map_readonly()
+{
+  return index_handler_.map_readonly();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HashIndexScanner::HashIndexScanner(ExtendibleHashHandler &handler) : scanner_(handler)
+{
+}
+
+RC HashIndexScanner::open(const char *key)
+{
+  return scanner_.open(key);
+}
+
+RC HashIndexScanner::next_entry(RID *rid)
+{
+  return scanner_.next_entry(rid);
+}
+
+RC HashIndexScanner::next_entry(RID *rid, char *key)
+{
+  return scanner_.next_entry(rid, key);
+}
+
+RC HashIndexScanner::destroy()
+{
+  delete this;
+  return RC::SUCCESS;
+}
@@ -0,0 +1,67 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Hash index on top of the extendible hash file.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_HASH_INDEX_H_
+#define __OBSERVER_STORAGE_COMMON_HASH_INDEX_H_
+
+#include "storage/common/index.h"
+#include "storage/common/extendible_hash.h"
+
+/**
+ * 哈希索引只支持所有字段都是等值条件的查找，其它扫描返回nullptr
+ */
+class HashIndex : public Index {
+public:
+  HashIndex() = default;
+  virtual ~HashIndex() noexcept;
+
+  RC create(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas,
+            int page_size = BP_PAGE_SIZE) override;
+  RC open(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas) override;
+  RC close();
+  RC drop() override;
+
+  RC insert_entry(const char *record, const RID *rid) override;
+  RC delete_entry(const char *record, const RID *rid) override;
+
+  IndexScanner *create_scanner(CompOp comp_op, const char *value, int null_field_index) override;
+  IndexScanner *create_range_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                     const char *high, int high_column_num, bool high_inclusive) override;
+
+  RC sync() override;
+  RC map_readonly() override;
+
+private:
+  IndexScanner *create_equal_scanner(const char *key);
+
+private:
+  bool inited_ = false;
+  ExtendibleHashHandler index_handler_;
+};
+
+class HashIndexScanner : public IndexScanner {
+public:
+  explicit HashIndexScanner(ExtendibleHashHandler &handler);
+  ~HashIndexScanner() noexcept override = default;
+
+  RC open(const char *key);
+  RC next_entry(RID *rid) override;
+  RC next_entry(RID *rid, char *key) override;
+  RC destroy() override;
+
+private:
+  ExtendibleHashScanner scanner_;
+};
+
+#endif  // __OBSERVER_STORAGE_COMMON_HASH_INDEX_H_
@@ -12,10 +12,69 @@ See the Mulan PSL v2 for more details. */
 // Created by wangyunlai.wyl on 2021/5/19.
 //
 
+#include <string.h>
+
 #include "storage/common/index.h"
 
-RC Index::init(const IndexMeta &index_meta, const FieldMeta &field_meta) {
+RC Index::init(const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas) {
   index_meta_ = index_meta;
-  field_meta_ = field_meta;
+  field_metas_ = field_metas;
+  // 只索引前缀的字段，在索引里就当作一个更短的字段。字典编码的字段索引中是编码，当作INTS字段
+  for (size_t i = 0; i < field_metas_.size(); i++) {
+    FieldMeta &field_meta = field_metas_[i];
+    int prefix_length = index_meta_.prefix_length((int)i);
+    if (field_meta.dictionary() != nullptr) {
+      RC rc = field_meta.init(field_meta.name(), INTS, field_meta.offset(), field_meta.len(), field_meta.visible(),
+                              field_meta.nullable());
+      if (rc != RC::SUCCESS) {
+        return rc;
+      }
+    } else if (prefix_length > 0) {
+      RC rc = field_meta.init(field_meta.name(), field_meta.type(), field_meta.offset(), prefix_length,
+                              field_meta.visible(), field_meta.nullable());
+      if (rc != RC::SUCCESS) {
+        return rc;
+      }
+    }
+  }
   return RC::SUCCESS;
-}
\ No newline at end of file
+}
+void Index::copy_key_to_record(const char *key, char *record) const {
+  for (const FieldMeta &field_meta : field_metas_) {
+    memcpy(record + field_meta.offset(), key, field_meta.len());
+    key += field_meta.len();
+  }
+}
+
+int Index::key_length() const {
+  int length = 0;
+  for (const FieldMeta &field_meta : field_metas_) {
+    length += field_meta.len();
+  }
+  return length;
+}
+
+void Index::key_columns(std::vector<AttrType> &types, std::vector<int> &lengths) const {
+  for (const FieldMeta &field_meta : field_metas_) {
+    types.push_back(field_meta.type());
+    lengths.push_back(field_meta.len());
+  }
+}
+
+void Index::make_key(const char *record, std::vector<char> &key) const {
+  for (const FieldMeta &field_meta : field_metas_) {
+    key.insert(key.end(), record + field_meta.offset(), record + field_meta.offset() + field_meta.len());
+  }
+}
+
+bool Index::check_unique(const char *record) const {
+  if (!index_meta_.unique()) {
+    return false;
+  }
+  for (const NullFlag &null_flag : null_flags_) {
+    if (null_flag.test(record)) {
+      return false;
+    }
+  }
+  return true;
+}
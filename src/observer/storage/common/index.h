@@ -41,20 +41,119 @@ public:
   const IndexMeta &index_meta() const {
     return index_meta_;
   }
+  /**
+   * 索引中的字段，只索引前缀的字段长度是前缀的长度
+   */
+  const std::vector<FieldMeta> &field_metas() const {
+    return field_metas_;
+  }
+  /**
+   * 索引字段中可以为null的那些的null标志，同一个字节中的合并成一个，唯一索引不检查有null字段的记录
+   */
+  void set_null_flags(const std::vector<NullFlag> &null_flags) {
+    null_flags_ = null_flags;
+  }
+
+  /**
+   * 创建或者打开索引文件，field_metas是索引的各个字段，顺序和index_meta中的一致
+   */
+  virtual RC create(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas,
+                    int page_size) = 0;
+  virtual RC open(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas) = 0;
 
   virtual RC insert_entry(const char *record, const RID *rid) = 0;
   virtual RC delete_entry(const char *record, const RID *rid) = 0;
 
   virtual IndexScanner *create_scanner(CompOp comp_op, const char *value, int null_field_index) = 0;
+  /**
+   * 扫描属性值在low和high之间的索引项，low或high为nullptr表示没有这个边界。
+   * low和high是索引前column_num个字段的值按顺序拼在一起，多字段索引可以只指定前几个字段
+   */
+  virtual IndexScanner *create_range_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                             const char *high, int high_column_num, bool high_inclusive) = 0;
+  /**
+   * 和create_range_scanner一样，但是保证按索引字段的顺序返回，descending为true时从大到小。
+   * 不能按顺序扫描的索引(比如哈希索引)返回nullptr
+   */
+  virtual IndexScanner *create_ordered_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                               const char *high, int high_column_num, bool high_inclusive,
+                                               bool descending)
+  {
+    return nullptr;
+  }
 
   virtual RC sync() = 0;
 
+  /**
+   * 把缓存的修改合并到索引中，表在后台整理时调用。没有缓存修改的索引什么也不做
+   */
+  virtual RC merge_changes()
+  {
+    return RC::SUCCESS;
+  }
+
+  /**
+   * 索引文件之后不再修改，页面改为直接从文件的只读映射中读取，见DiskBufferPool::map_file。
+   * 没有索引文件的索引什么也不做
+   */
+  virtual RC map_readonly()
+  {
+    return RC::SUCCESS;
+  }
+
+  /**
+   * 关闭索引并丢弃缓冲池中的页面，不写回脏页，文件由调用者删除
+   */
+  virtual RC drop()
+  {
+    return RC::SUCCESS;
+  }
+
+  /**
+   * 在刚创建的空索引上导入已有的记录：begin_bulk_load之后用bulk_load_entry加入所有记录，
+   * 最后调用end_bulk_load。默认逐条插入，B+树会排序之后自底向上生成
+   */
+  virtual RC begin_bulk_load()
+  {
+    return RC::SUCCESS;
+  }
+  virtual RC bulk_load_entry(const char *record, const RID *rid)
+  {
+    return insert_entry(record, rid);
+  }
+  virtual RC end_bulk_load()
+  {
+    return RC::SUCCESS;
+  }
+
+  /**
+   * 索引的key是索引字段的值按顺序拼在一起，把key中的字段值复制到record中对应的位置
+   */
+  void copy_key_to_record(const char *key, char *record) const;
+  /**
+   * 索引字段值的总长度，也就是扫描时返回的key的长度
+   */
+  int key_length() const;
+
 protected:
-  RC init(const IndexMeta &index_meta, const FieldMeta &field_meta);
+  RC init(const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas);
+  /**
+   * 多字段索引的key是各个字段的值按顺序拼在一起
+   */
+  void make_key(const char *record, std::vector<char> &key) const;
+  /**
+   * 创建和打开索引文件时需要的每个字段的类型和长度
+   */
+  void key_columns(std::vector<AttrType> &types, std::vector<int> &lengths) const;
+  /**
+   * 唯一索引中是否需要检查这条记录的属性值有没有重复，有null字段的记录不检查
+   */
+  bool check_unique(const char *record) const;
 
 protected:
   IndexMeta   index_meta_;
-  FieldMeta   field_meta_;    /// 当前实现仅考虑一个字段的索引
+  std::vector<FieldMeta> field_metas_;    /// 索引的字段，多字段索引按顺序比较
+  std::vector<NullFlag> null_flags_;
 };
 
 class IndexScanner {
@@ -63,6 +162,10 @@ public:
   virtual ~IndexScanner() = default;
 
   virtual RC next_entry(RID *rid) = 0;
+  /**
+   * 同时返回索引项的key，key的长度是Index::key_length()
+   */
+  virtual RC next_entry(RID *rid, char *key) = 0;
   virtual RC destroy() = 0;
 };
 
@@ -12,9 +12,14 @@ See the Mulan PSL v2 for more details. */
 // Created by wangyunlai.wyl on 2021/5/18.
 //
 
+#include <string.h>
+
+#include <algorithm>
+
 #include "storage/common/index_meta.h"
 #include "storage/common/field_meta.h"
 #include "storage/common/table_meta.h"
+#include "storage/common/meta_util.h"
 #include "common/lang/string.h"
 #include "common/log/log.h"
 #include "rc.h"
@@ -22,21 +27,103 @@ See the Mulan PSL v2 for more details. */
 
 const static Json::StaticString FIELD_NAME("name");
 const static Json::StaticString FIELD_FIELD_NAME("field_name");
+const static Json::StaticString FIELD_FIELD_NAMES("field_names");
+const static Json::StaticString FIELD_UNIQUE("unique");
+const static Json::StaticString FIELD_PREFIX_LENGTHS("prefix_lengths");
+const static Json::StaticString FIELD_TYPE("type");
+const static Json::StaticString FIELD_KEY_FIELD_NUM("key_field_num");
+const static char *HASH_INDEX_TYPE_NAME = "hash";
 
 RC IndexMeta::init(const char *name, const FieldMeta &field) {
-  if (nullptr == name || common::is_blank(name)) {
+  std::vector<const FieldMeta *> fields(1, &field);
+  return init(name, fields);
+}
+
+RC IndexMeta::init(const char *name, const std::vector<const FieldMeta *> &fields, bool unique,
+                   const std::vector<int> &prefix_lengths, IndexType type, int key_field_num) {
+  if (nullptr == name || common::is_blank(name) || fields.empty() ||
+      (!prefix_lengths.empty() && prefix_lengths.size() != fields.size()) || key_field_num < 0 ||
+      key_field_num > (int)fields.size()) {
     LOG_ERROR("IndexMeta::init - RC::INVALID_ARGUMENT");
     return RC::INVALID_ARGUMENT;
   }
 
+  std::vector<int> prefixes;
+  bool has_prefix = false;
+  for (size_t i = 0; i < prefix_lengths.size(); i++) {
+    int prefix_length = prefix_lengths[i];
+    const FieldMeta *field = fields[i];
+    // 字典编码的字段索引中是编码，没有前缀
+    if (prefix_length < 0 ||
+        (prefix_length > 0 &&
+            (field->type() != CHARS || field->dictionary() != nullptr || prefix_length > field->len()))) {
+      LOG_ERROR("Invalid prefix length %d of index field %s", prefix_length, field->name());
+      return RC::INVALID_ARGUMENT;
+    }
+    // 前缀和字段一样长时就是整个字段
+    prefixes.push_back(prefix_length == field->len() ? 0 : prefix_length);
+    has_prefix = has_prefix || prefixes.back() > 0;
+  }
+  if (has_prefix && unique) {
+    LOG_ERROR("Unique index %s can not index prefixes of fields", name);
+    return RC::INVALID_ARGUMENT;
+  }
+  // 跟在key后面的字段要能从索引中还原，哈希索引不保存它们的顺序
+  if (key_field_num > 0 && key_field_num < (int)fields.size() && (has_prefix || type == HASH_INDEX)) {
+    LOG_ERROR("Index %s can not store non-key fields", name);
+    return RC::INVALID_ARGUMENT;
+  }
+  if (type == HASH_INDEX) {
+    for (const FieldMeta *field : fields) {
+      if (field->type() == FLOATS) {
+        LOG_ERROR("Hash index %s can not contain float field %s", name, field->name());
+        return RC::INVALID_ARGUMENT;
+      }
+    }
+  }
+
   name_ = name;
-  field_ = field.name();
+  fields_.clear();
+  for (const FieldMeta *field : fields) {
+    fields_.push_back(field->name());
+  }
+  unique_ = unique;
+  prefix_lengths_.clear();
+  if (has_prefix) {
+    prefix_lengths_ = std::move(prefixes);
+  }
+  type_ = type;
+  key_field_num_ = key_field_num == (int)fields.size() ? 0 : key_field_num;
   return RC::SUCCESS;
 }
 
 void IndexMeta::to_json(Json::Value &json_value) const {
   json_value[FIELD_NAME] = name_;
-  json_value[FIELD_FIELD_NAME] = field_;
+  // field_name保留第一个字段，单字段索引的格式和以前一样
+  json_value[FIELD_FIELD_NAME] = fields_[0];
+  if (fields_.size() > 1) {
+    Json::Value fields_value;
+    for (const std::string &field : fields_) {
+      fields_value.append(field);
+    }
+    json_value[FIELD_FIELD_NAMES] = std::move(fields_value);
+  }
+  if (unique_) {
+    json_value[FIELD_UNIQUE] = true;
+  }
+  if (!prefix_lengths_.empty()) {
+    Json::Value prefix_lengths_value;
+    for (int prefix_length : prefix_lengths_) {
+      prefix_lengths_value.append(prefix_length);
+    }
+    json_value[FIELD_PREFIX_LENGTHS] = std::move(prefix_lengths_value);
+  }
+  if (type_ == HASH_INDEX) {
+    json_value[FIELD_TYPE] = HASH_INDEX_TYPE_NAME;
+  }
+  if (key_field_num_ > 0) {
+    json_value[FIELD_KEY_FIELD_NUM] = key_field_num_;
+  }
 }
 
 RC IndexMeta::from_json(const TableMeta &table, const Json::Value &json_value, IndexMeta &index) {
@@ -53,13 +140,106 @@ RC IndexMeta::from_json(const TableMeta &table, const Json::Value &json_value, I
     return RC::GENERIC_ERROR;
   }
 
-  const FieldMeta *field = table.field(field_value.asCString());
-  if (nullptr == field) {
-    LOG_ERROR("Deserialize index [%s]: no such field: %s", name_value.asCString(), field_value.asCString());
-    return RC::SCHEMA_FIELD_MISSING;
+  std::vector<const FieldMeta *> fields;
+  const Json::Value &fields_value = json_value[FIELD_FIELD_NAMES];
+  if (fields_value.isArray()) {
+    for (int i = 0; i < (int)fields_value.size(); i++) {
+      const FieldMeta *field = fields_value[i].isString() ? table.field(fields_value[i].asCString()) : nullptr;
+      if (nullptr == field) {
+        LOG_ERROR("Deserialize index [%s]: invalid field: %s",
+                  name_value.asCString(), fields_value[i].toStyledString().c_str());
+        return RC::SCHEMA_FIELD_MISSING;
+      }
+      fields.push_back(field);
+    }
+  } else {
+    const FieldMeta *field = table.field(field_value.asCString());
+    if (nullptr == field) {
+      LOG_ERROR("Deserialize index [%s]: no such field: %s", name_value.asCString(), field_value.asCString());
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    fields.push_back(field);
+  }
+
+  std::vector<int> prefix_lengths;
+  const Json::Value &prefix_lengths_value = json_value[FIELD_PREFIX_LENGTHS];
+  if (prefix_lengths_value.isArray()) {
+    for (int i = 0; i < (int)prefix_lengths_value.size(); i++) {
+      if (!prefix_lengths_value[i].isInt()) {
+        LOG_ERROR("Deserialize index [%s]: invalid prefix length: %s",
+                  name_value.asCString(), prefix_lengths_value[i].toStyledString().c_str());
+        return RC::GENERIC_ERROR;
+      }
+      prefix_lengths.push_back(prefix_lengths_value[i].asInt());
+    }
+  }
+
+  // 以前的元数据中没有类型，都是B+树
+  IndexType type = BPLUS_TREE_INDEX;
+  const Json::Value &type_value = json_value[FIELD_TYPE];
+  if (type_value.isString() && 0 == strcmp(type_value.asCString(), HASH_INDEX_TYPE_NAME)) {
+    type = HASH_INDEX;
+  } else if (!type_value.isNull()) {
+    LOG_ERROR("Deserialize index [%s]: invalid index type: %s",
+              name_value.asCString(), type_value.toStyledString().c_str());
+    return RC::GENERIC_ERROR;
   }
 
-  return index.init(name_value.asCString(), *field);
+  const Json::Value &unique_value = json_value[FIELD_UNIQUE];
+  const Json::Value &key_field_num_value = json_value[FIELD_KEY_FIELD_NUM];
+  return index.init(name_value.asCString(), fields, unique_value.isBool() && unique_value.asBool(), prefix_lengths,
+                    type, key_field_num_value.isInt() ? key_field_num_value.asInt() : 0);
+}
+
+void IndexMeta::to_binary(MetaWriter &writer) const {
+  writer.put_string(name_);
+  writer.put_int32((int32_t)fields_.size());
+  // 不是key的字段没有前缀，前缀长度写成-1，以前的版本没有这样的字段
+  for (size_t i = 0; i < fields_.size(); i++) {
+    writer.put_string(fields_[i]);
+    writer.put_int32((int)i < key_field_num() ? prefix_length(i) : -1);
+  }
+  writer.put_int32(unique_ ? 1 : 0);
+  writer.put_int32(type_);
+}
+
+RC IndexMeta::from_binary(const TableMeta &table, MetaReader &reader, IndexMeta &index) {
+  std::string name;
+  int32_t field_num = 0;
+  if (!reader.get_string(&name) || !reader.get_int32(&field_num) || field_num <= 0) {
+    LOG_ERROR("Failed to decode index. data is truncated");
+    return RC::GENERIC_ERROR;
+  }
+
+  std::vector<const FieldMeta *> fields;
+  std::vector<int> prefix_lengths;
+  int key_field_num = 0;
+  for (int i = 0; i < field_num; i++) {
+    std::string field_name;
+    int32_t prefix_length = 0;
+    if (!reader.get_string(&field_name) || !reader.get_int32(&prefix_length)) {
+      LOG_ERROR("Failed to decode index [%s]. data is truncated", name.c_str());
+      return RC::GENERIC_ERROR;
+    }
+    const FieldMeta *field = table.field(field_name.c_str());
+    if (nullptr == field) {
+      LOG_ERROR("Decode index [%s]: no such field: %s", name.c_str(), field_name.c_str());
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    fields.push_back(field);
+    if (prefix_length < 0 && key_field_num == 0) {
+      key_field_num = i;
+    }
+    prefix_lengths.push_back(std::max(prefix_length, 0));
+  }
+
+  int32_t unique = 0;
+  int32_t type = 0;
+  if (!reader.get_int32(&unique) || !reader.get_int32(&type) || (type != BPLUS_TREE_INDEX && type != HASH_INDEX)) {
+    LOG_ERROR("Failed to decode index [%s]. invalid unique or type", name.c_str());
+    return RC::GENERIC_ERROR;
+  }
+  return index.init(name.c_str(), fields, unique != 0, prefix_lengths, (IndexType)type, key_field_num);
 }
 
 const char *IndexMeta::name() const {
@@ -67,10 +247,63 @@ const char *IndexMeta::name() const {
 }
 
 const char *IndexMeta::field() const {
-  return field_.c_str();
+  return fields_[0].c_str();
+}
+
+int IndexMeta::field_num() const {
+  return (int)fields_.size();
+}
+
+int IndexMeta::key_field_num() const {
+  return key_field_num_ > 0 ? key_field_num_ : (int)fields_.size();
+}
+
+const char *IndexMeta::field(int index) const {
+  return fields_[index].c_str();
+}
+
+bool IndexMeta::has_field(const char *field) const {
+  for (const std::string &name : fields_) {
+    if (name == field) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IndexMeta::unique() const {
+  return unique_;
+}
+
+int IndexMeta::prefix_length(int index) const {
+  return prefix_lengths_.empty() ? 0 : prefix_lengths_[index];
+}
+
+bool IndexMeta::has_prefix() const {
+  return !prefix_lengths_.empty();
+}
+
+IndexType IndexMeta::type() const {
+  return type_;
 }
 
 void IndexMeta::desc(std::ostream &os) const {
-  os << "index name=" << name_
-      << ", field=" << field_;
+  os << "index name=" << name_ << ", field=";
+  for (int i = 0; i < (int)fields_.size(); i++) {
+    if (key_field_num_ > 0 && i == key_field_num_) {
+      os << ", include=";
+    } else if (i != 0) {
+      os << ",";
+    }
+    os << fields_[i];
+    if (prefix_length(i) > 0) {
+      os << "(" << prefix_length(i) << ")";
+    }
+  }
+  if (type_ == HASH_INDEX) {
+    os << ", hash";
+  }
+  if (unique_) {
+    os << ", unique";
+  }
 }
\ No newline at end of file
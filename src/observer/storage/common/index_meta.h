@@ -16,10 +16,14 @@ See the Mulan PSL v2 for more details. */
 #define __OBSERVER_STORAGE_COMMON_INDEX_META_H__
 
 #include <string>
+#include <vector>
 #include "rc.h"
+#include "sql/parser/parse_defs.h"
 
 class TableMeta;
 class FieldMeta;
+class MetaWriter;
+class MetaReader;
 
 namespace Json {
 class Value;
@@ -30,18 +34,56 @@ public:
   IndexMeta() = default;
 
   RC init(const char *name, const FieldMeta &field);
+  /**
+   * 多字段索引，字段按照比较的顺序排列。
+   * prefix_lengths不为空时和fields一一对应，大于0表示字符串字段只把前这么多个字符放到索引中，
+   * 索引只用来缩小范围，查到的记录还要按条件过滤，所以唯一索引不能只索引前缀。
+   * 哈希索引的浮点数字段按值精确比较，和条件中带误差的相等不一致，所以不能有浮点数字段。
+   * key_field_num大于0时只有前key_field_num个字段是key，后面的字段跟在key后面存放在B+树的叶子中，
+   * 主键索引用这种方式在叶子中保存整条记录，见key_field_num
+   */
+  RC init(const char *name, const std::vector<const FieldMeta *> &fields, bool unique = false,
+          const std::vector<int> &prefix_lengths = std::vector<int>(), IndexType type = BPLUS_TREE_INDEX,
+          int key_field_num = 0);
 
 public:
   const char *name() const;
+  /**
+   * 第一个字段
+   */
   const char *field() const;
+  int field_num() const;
+  /**
+   * 唯一性只检查前key_field_num个字段。主键索引的key是主键字段，记录中其它的字段按顺序跟在后面，
+   * 索引项的顺序仍然由所有字段决定，按主键的范围扫描时不用回表。普通索引所有字段都是key
+   */
+  int key_field_num() const;
+  const char *field(int index) const;
+  bool has_field(const char *field) const;
+  /**
+   * 唯一索引中所有字段都不是null的记录，属性值不能重复
+   */
+  bool unique() const;
+  /**
+   * 第index个字段在索引中的前缀长度，0表示整个字段都在索引中
+   */
+  int prefix_length(int index) const;
+  bool has_prefix() const;
+  IndexType type() const;
 
   void desc(std::ostream &os) const;
 public:
   void to_json(Json::Value &json_value) const;
   static RC from_json(const TableMeta &table, const Json::Value &json_value, IndexMeta &index);
+  void to_binary(MetaWriter &writer) const;
+  static RC from_binary(const TableMeta &table, MetaReader &reader, IndexMeta &index);
 
 private:
   std::string       name_;
-  std::string       field_;
+  std::vector<std::string> fields_;
+  bool              unique_ = false;
+  std::vector<int>  prefix_lengths_;      // 为空表示所有字段都是完整的
+  IndexType         type_ = BPLUS_TREE_INDEX;
+  int               key_field_num_ = 0;     // 0表示所有字段都是key
 };
 #endif // __OBSERVER_STORAGE_COMMON_INDEX_META_H__
\ No newline at end of file
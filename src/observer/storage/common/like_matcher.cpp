@@ -0,0 +1,233 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Matcher for LIKE patterns, compiled once per condition.
+//
+
+#include <string.h>
+
+#include "storage/common/like_matcher.h"
+
+void LikeMatcher::init(const char *pattern)
+{
+  pattern_ = pattern;
+  segments_.clear();
+  prefix_.clear();
+  anchor_begin_ = true;
+  anchor_end_ = true;
+
+  // 按%切成几段，连续的%相当于一个
+  Segment current;
+  bool in_prefix = true;
+  for (const char *p = pattern; *p != '\0'; p++)
+  {
+    char c = *p;
+    bool any = false;
+    if (c == '%')
+    {
+      in_prefix = false;
+      if (segments_.empty() && current.text.empty())
+      {
+        anchor_begin_ = false;
+      }
+      if (!current.text.empty())
+      {
+        segments_.push_back(std::move(current));
+        current = Segment();
+      }
+      continue;
+    }
+    if (c == '_')
+    {
+      any = true;
+      in_prefix = false;
+    }
+    else if (c == LIKE_ESCAPE_CHAR && p[1] != '\0')
+    {
+      c = *++p;
+    }
+    if (in_prefix)
+    {
+      prefix_.push_back(c);
+    }
+    current.text.push_back(c);
+    current.any.push_back(any);
+    current.has_any |= any;
+  }
+  const bool ends_with_percent = current.text.empty() && (!segments_.empty() || !anchor_begin_);
+  if (!current.text.empty() || segments_.empty())
+  {
+    segments_.push_back(std::move(current));
+  }
+  anchor_end_ = !ends_with_percent;
+
+  upper_bound_ = prefix_;
+  while (!upper_bound_.empty() && (unsigned char)upper_bound_.back() == 0xff)
+  {
+    upper_bound_.pop_back();
+  }
+  has_upper_bound_ = !upper_bound_.empty();
+  if (has_upper_bound_)
+  {
+    upper_bound_.back() = (char)((unsigned char)upper_bound_.back() + 1);
+  }
+
+  const bool single = segments_.size() == 1 && !segments_[0].has_any;
+  if (single && anchor_begin_ && anchor_end_)
+  {
+    kind_ = Kind::EXACT;
+  }
+  else if (single && anchor_begin_)
+  {
+    kind_ = Kind::PREFIX;
+  }
+  else if (single && anchor_end_)
+  {
+    kind_ = Kind::SUFFIX;
+  }
+  else if (single)
+  {
+    kind_ = Kind::CONTAINS;
+  }
+  else
+  {
+    kind_ = Kind::GENERIC;
+  }
+}
+
+bool LikeMatcher::segment_equal(const Segment &segment, const char *s)
+{
+  if (!segment.has_any)
+  {
+    return 0 == memcmp(s, segment.text.data(), segment.text.size());
+  }
+  for (size_t i = 0; i < segment.text.size(); i++)
+  {
+    if (!segment.any[i] && s[i] != segment.text[i])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+const char *LikeMatcher::segment_find(const Segment &segment, const char *s, int len)
+{
+  const int n = (int)segment.text.size();
+  if (n == 0)
+  {
+    return s;
+  }
+  if (n > len)
+  {
+    return nullptr;
+  }
+  const char *last = s + len - n;
+  if (segment.has_any)
+  {
+    for (const char *p = s; p <= last; p++)
+    {
+      if (segment_equal(segment, p))
+      {
+        return p;
+      }
+    }
+    return nullptr;
+  }
+  // 先用memchr跳到第一个字符出现的位置，glibc的memchr按向量比较
+  const char first = segment.text[0];
+  for (const char *p = s; p <= last; p++)
+  {
+    p = (const char *)memchr(p, first, last - p + 1);
+    if (p == nullptr)
+    {
+      return nullptr;
+    }
+    if (0 == memcmp(p + 1, segment.text.data() + 1, n - 1))
+    {
+      return p;
+    }
+  }
+  return nullptr;
+}
+
+bool LikeMatcher::match(const char *s, int len) const
+{
+  const Segment &first = segments_.front();
+  const int first_len = (int)first.text.size();
+  switch (kind_)
+  {
+  case Kind::EXACT:
+    return len == first_len && 0 == memcmp(s, first.text.data(), len);
+  case Kind::PREFIX:
+    return len >= first_len && 0 == memcmp(s, first.text.data(), first_len);
+  case Kind::SUFFIX:
+    return len >= first_len && 0 == memcmp(s + len - first_len, first.text.data(), first_len);
+  case Kind::CONTAINS:
+    return segment_find(first, s, len) != nullptr;
+  default:
+    break;
+  }
+
+  const char *end = s + len;
+  size_t begin_index = 0;
+  size_t end_index = segments_.size();
+  if (anchor_begin_)
+  {
+    if (len < first_len || !segment_equal(first, s))
+    {
+      return false;
+    }
+    s += first_len;
+    begin_index = 1;
+  }
+  if (anchor_end_ && end_index > begin_index)
+  {
+    // 最后一段对齐结尾，不能和已经匹配的部分重叠
+    const Segment &last = segments_.back();
+    const int last_len = (int)last.text.size();
+    if (end - s < last_len || !segment_equal(last, end - last_len))
+    {
+      return false;
+    }
+    end -= last_len;
+    end_index--;
+  }
+  else if (anchor_end_ && anchor_begin_)
+  {
+    // 只有一段并且两头都对齐，比如'a_c'
+    return s == end;
+  }
+  for (size_t i = begin_index; i < end_index; i++)
+  {
+    const char *found = segment_find(segments_[i], s, (int)(end - s));
+    if (found == nullptr)
+    {
+      return false;
+    }
+    s = found + segments_[i].text.size();
+  }
+  return true;
+}
+
+bool like_pattern_has_prefix(const Value &pattern)
+{
+  if (pattern.is_null || pattern.data == nullptr)
+  {
+    return false;
+  }
+  if (pattern.type == DATES)
+  {
+    return true;
+  }
+  const char c = *(const char *)pattern.data;
+  return pattern.type == CHARS && c != '\0' && c != '%' && c != '_';
+}
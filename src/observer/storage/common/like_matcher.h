@@ -0,0 +1,110 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Matcher for LIKE patterns, compiled once per condition.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_LIKE_MATCHER_H_
+#define __OBSERVER_STORAGE_COMMON_LIKE_MATCHER_H_
+
+#include <string>
+#include <vector>
+
+#include "sql/parser/parse_defs.h"
+
+#define LIKE_ESCAPE_CHAR '\\'
+
+/**
+ * LIKE的模式串编译成的匹配器。%匹配任意个字符，_匹配一个字符，\把下一个字符当作普通字符，区分大小写，和=一致。
+ * 编译时按模式串的形状选择匹配方法，匹配时不再解析模式串：
+ * - 没有通配符时比较整个串，'abc%'只比较前缀，'%abc'只比较后缀；
+ * - '%abc%'用memchr找第一个字符可能的位置，再用memcmp比较；
+ * - 其它的模式按%切成几段，每段依次在剩下的串中找最左边的位置，第一段对齐开头、最后一段对齐结尾
+ */
+class LikeMatcher
+{
+public:
+  void init(const char *pattern);
+
+  /**
+   * s是len个字符，不需要以'\0'结尾
+   */
+  bool match(const char *s, int len) const;
+
+  const std::string &pattern() const
+  {
+    return pattern_;
+  }
+  /**
+   * 模式串开头第一个通配符之前的字符，去掉了转义符。以它开头的串才可能匹配，用来确定索引扫描的范围
+   */
+  const std::string &prefix() const
+  {
+    return prefix_;
+  }
+  /**
+   * 模式串没有通配符时为true，这时只有和prefix相等的串匹配
+   */
+  bool exact() const
+  {
+    return kind_ == Kind::EXACT;
+  }
+  /**
+   * 以prefix开头的串都小于它，是prefix最后一个字符加一。prefix为空或者全是0xff时没有上界，返回nullptr
+   */
+  const char *upper_bound() const
+  {
+    return has_upper_bound_ ? upper_bound_.c_str() : nullptr;
+  }
+
+private:
+  enum class Kind
+  {
+    EXACT,
+    PREFIX,
+    SUFFIX,
+    CONTAINS,
+    GENERIC,
+  };
+
+  /**
+   * 两个%之间的一段，any[i]表示第i个字符是_
+   */
+  struct Segment
+  {
+    std::string text;
+    std::vector<bool> any;
+    bool has_any = false;
+  };
+
+  static bool segment_equal(const Segment &segment, const char *s);
+  /**
+   * 在[s, s + len)中找segment最左边出现的位置，没有时返回nullptr
+   */
+  static const char *segment_find(const Segment &segment, const char *s, int len);
+
+private:
+  std::string pattern_;
+  Kind kind_ = Kind::EXACT;
+  std::vector<Segment> segments_;
+  bool anchor_begin_ = true;  // 第一段从开头匹配，即模式串不以%开头
+  bool anchor_end_ = true;
+  std::string prefix_;
+  std::string upper_bound_;
+  bool has_upper_bound_ = false;
+};
+
+/**
+ * LIKE的模式串开头有普通字符，可以用索引缩小扫描范围。DATES的值是解析时当成日期的字符串，一定可以
+ */
+bool like_pattern_has_prefix(const Value &pattern);
+
+#endif // __OBSERVER_STORAGE_COMMON_LIKE_MATCHER_H_
@@ -0,0 +1,824 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Incrementally maintained materialized views of group by aggregates.
+//
+
+#include <ctype.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include "storage/common/materialized_view.h"
+#include "storage/common/table.h"
+#include "storage/trx/trx.h"
+#include "common/log/log.h"
+#include "json/json.h"
+
+static const Json::StaticString FIELD_VIEW_NAME("view_name");
+static const Json::StaticString FIELD_BASE_TABLE("base_table");
+static const Json::StaticString FIELD_GROUP_BY("group_by");
+static const Json::StaticString FIELD_COLUMNS("columns");
+static const Json::StaticString FIELD_COLUMN_NAME("name");
+static const Json::StaticString FIELD_COLUMN_FUNC("func");
+static const Json::StaticString FIELD_COLUMN_FIELD("field");
+
+static const char *FUNC_NAMES[] = {"", "count", "sum", "avg", "min", "max"};
+
+static bool parse_func(const char *name, ViewColumn::Func *func)
+{
+  for (size_t i = 1; i < sizeof(FUNC_NAMES) / sizeof(FUNC_NAMES[0]); i++)
+  {
+    if (0 == strcasecmp(name, FUNC_NAMES[i]))
+    {
+      *func = (ViewColumn::Func)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool is_row_count_argument(const char *attr_name)
+{
+  return strcmp(attr_name, "*") == 0 || isdigit(attr_name[0]) || attr_name[0] == '-';
+}
+
+/**
+ * 基表中可以作为分组字段或者聚合函数参数的用户字段，找不到时返回nullptr
+ */
+static const FieldMeta *find_user_field(const Table &base, const RelAttr &attr)
+{
+  if (attr.relation_name != nullptr && 0 != strcmp(attr.relation_name, base.name()))
+  {
+    LOG_WARN("Materialized view can only use fields of table %s. relation=%s", base.name(), attr.relation_name);
+    return nullptr;
+  }
+  const TableMeta &table_meta = base.table_meta();
+  const int index = table_meta.find_field_index_by_name(attr.attribute_name);
+  if (index < table_meta.sys_field_num())
+  {
+    LOG_WARN("No such field %s in table %s", attr.attribute_name, base.name());
+    return nullptr;
+  }
+  const FieldMeta *field = table_meta.field(index);
+  if (field->dictionary() != nullptr)
+  {
+    LOG_WARN("Materialized view does not support dictionary encoded field %s", field->name());
+    return nullptr;
+  }
+  return field;
+}
+
+RC MaterializedView::init(const char *name, const Table &base, const Selects &selects)
+{
+  if (selects.relation_num != 1 || selects.condition_num != 0 || selects.expr_condition_num != 0 ||
+      selects.order_num != 0 || selects.has_limit ||
+      selects.distinct || selects.explain != EXPLAIN_NONE || selects.outfile != nullptr)
+  {
+    LOG_WARN("Materialized view %s must be a group by query on one table without conditions, order or limit", name);
+    return RC::INVALID_ARGUMENT;
+  }
+  if (base.partitioned())
+  {
+    LOG_WARN("Materialized view %s on partitioned table %s is not supported", name, base.name());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  name_ = name;
+  base_name_ = base.name();
+  group_fields_.clear();
+  columns_.clear();
+  for (size_t i = 0; i < selects.group_num; i++)
+  {
+    const FieldMeta *field = find_user_field(base, selects.group_attrs[i]);
+    if (nullptr == field)
+    {
+      return RC::SCHEMA_FIELD_NOT_EXIST;
+    }
+    group_fields_.push_back(field->name());
+  }
+
+  // select中的列按照相反的顺序保存
+  for (int i = (int)selects.attr_num - 1; i >= 0; i--)
+  {
+    const RelAttr &attr = selects.attributes[i];
+    ViewColumn column;
+    if (attr.window != nullptr || attr.is_distinct || attr.expr != nullptr ||
+        (nullptr == attr.window_function_name && 0 == strcmp(attr.attribute_name, "*")))
+    {
+      LOG_WARN("Materialized view %s does not support window functions, distinct, expressions or *", name);
+      return RC::INVALID_ARGUMENT;
+    }
+    if (nullptr == attr.window_function_name)
+    {
+      const FieldMeta *field = find_user_field(base, attr);
+      if (nullptr == field)
+      {
+        return RC::SCHEMA_FIELD_NOT_EXIST;
+      }
+      if (std::find(group_fields_.begin(), group_fields_.end(), field->name()) == group_fields_.end())
+      {
+        LOG_WARN("Field %s of materialized view %s is not in group by", field->name(), name);
+        return RC::INVALID_ARGUMENT;
+      }
+      column.func = ViewColumn::Func::GROUP;
+      column.field = field->name();
+      column.name = field->name();
+    }
+    else
+    {
+      if (!parse_func(attr.window_function_name, &column.func))
+      {
+        LOG_WARN("Materialized view %s does not support function %s", name, attr.window_function_name);
+        return RC::INVALID_ARGUMENT;
+      }
+      if (column.func == ViewColumn::Func::COUNT && is_row_count_argument(attr.attribute_name))
+      {
+        column.field = "*";
+        column.name = FUNC_NAMES[(int)column.func];
+      }
+      else
+      {
+        const FieldMeta *field = find_user_field(base, attr);
+        if (nullptr == field)
+        {
+          return RC::SCHEMA_FIELD_NOT_EXIST;
+        }
+        if ((column.func == ViewColumn::Func::SUM || column.func == ViewColumn::Func::AVG) &&
+            field->type() != INTS && field->type() != FLOATS)
+        {
+          LOG_WARN("Cannot compute %s of field %s", FUNC_NAMES[(int)column.func], field->name());
+          return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+        }
+        column.field = field->name();
+        column.name = std::string(FUNC_NAMES[(int)column.func]) + "_" + field->name();
+      }
+    }
+    for (const ViewColumn &other : columns_)
+    {
+      if (other.name == column.name)
+      {
+        LOG_WARN("Duplicate column %s in materialized view %s", column.name.c_str(), name);
+        return RC::SCHEMA_FIELD_REDUNDAN;
+      }
+    }
+    columns_.push_back(std::move(column));
+  }
+  if (columns_.empty())
+  {
+    return RC::INVALID_ARGUMENT;
+  }
+  return RC::SUCCESS;
+}
+
+RC MaterializedView::table_attributes(const Table &base, std::vector<AttrInfo> &attributes) const
+{
+  const TableMeta &table_meta = base.table_meta();
+  attributes.clear();
+  for (const ViewColumn &column : columns_)
+  {
+    AttrInfo attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.name = const_cast<char *>(column.name.c_str());
+    attr.type = INTS;
+    attr.length = sizeof(int);
+    attr.is_nullable = 1;
+    const FieldMeta *field = column.field == "*" ? nullptr : table_meta.field(column.field.c_str());
+    if (nullptr == field && column.field != "*")
+    {
+      LOG_WARN("No such field %s in table %s", column.field.c_str(), base.name());
+      return RC::SCHEMA_FIELD_NOT_EXIST;
+    }
+    switch (column.func)
+    {
+    case ViewColumn::Func::GROUP:
+      attr.type = field->type();
+      attr.length = field->len();
+      attr.is_nullable = field->nullable() ? 1 : 0;
+      break;
+    case ViewColumn::Func::COUNT:
+      attr.is_nullable = 0;
+      break;
+    case ViewColumn::Func::AVG:
+      attr.type = FLOATS;
+      attr.length = sizeof(float);
+      break;
+    default:
+      attr.type = field->type();
+      attr.length = field->len();
+      break;
+    }
+    attributes.push_back(attr);
+  }
+  return RC::SUCCESS;
+}
+
+RC MaterializedView::save(const std::string &file) const
+{
+  Json::Value view_value;
+  view_value[FIELD_VIEW_NAME] = name_;
+  view_value[FIELD_BASE_TABLE] = base_name_;
+  Json::Value group_value(Json::arrayValue);
+  for (const std::string &field : group_fields_)
+  {
+    group_value.append(field);
+  }
+  view_value[FIELD_GROUP_BY] = std::move(group_value);
+  Json::Value columns_value(Json::arrayValue);
+  for (const ViewColumn &column : columns_)
+  {
+    Json::Value column_value;
+    column_value[FIELD_COLUMN_NAME] = column.name;
+    column_value[FIELD_COLUMN_FUNC] = FUNC_NAMES[(int)column.func];
+    column_value[FIELD_COLUMN_FIELD] = column.field;
+    columns_value.append(std::move(column_value));
+  }
+  view_value[FIELD_COLUMNS] = std::move(columns_value);
+
+  // 和表的元数据一样先写临时文件再改名
+  std::string tmp_file = file + ".tmp";
+  std::ofstream ofs(tmp_file, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  if (!ofs.is_open())
+  {
+    LOG_ERROR("Failed to open file for write. file name=%s, errmsg=%s", tmp_file.c_str(), strerror(errno));
+    return RC::IOERR;
+  }
+  Json::StreamWriterBuilder builder;
+  ofs << Json::writeString(builder, view_value);
+  ofs.close();
+  if (!ofs || rename(tmp_file.c_str(), file.c_str()) != 0)
+  {
+    LOG_ERROR("Failed to write materialized view file %s. errmsg=%s", file.c_str(), strerror(errno));
+    return RC::IOERR;
+  }
+  return RC::SUCCESS;
+}
+
+RC MaterializedView::load(const std::string &file)
+{
+  std::ifstream ifs(file, std::ios_base::in | std::ios_base::binary);
+  if (!ifs.is_open())
+  {
+    LOG_ERROR("Failed to open materialized view file %s. errmsg=%s", file.c_str(), strerror(errno));
+    return RC::IOERR;
+  }
+  Json::Value view_value;
+  Json::CharReaderBuilder builder;
+  std::string errors;
+  if (!Json::parseFromStream(builder, ifs, &view_value, &errors))
+  {
+    LOG_ERROR("Failed to parse materialized view file %s. error=%s", file.c_str(), errors.c_str());
+    return RC::GENERIC_ERROR;
+  }
+
+  const Json::Value &name_value = view_value[FIELD_VIEW_NAME];
+  const Json::Value &base_value = view_value[FIELD_BASE_TABLE];
+  const Json::Value &group_value = view_value[FIELD_GROUP_BY];
+  const Json::Value &columns_value = view_value[FIELD_COLUMNS];
+  if (!name_value.isString() || !base_value.isString() || !group_value.isArray() || !columns_value.isArray() ||
+      columns_value.empty())
+  {
+    LOG_ERROR("Invalid materialized view file %s", file.c_str());
+    return RC::GENERIC_ERROR;
+  }
+  name_ = name_value.asString();
+  base_name_ = base_value.asString();
+  group_fields_.clear();
+  for (Json::ArrayIndex i = 0; i < group_value.size(); i++)
+  {
+    if (!group_value[i].isString())
+    {
+      LOG_ERROR("Invalid group by field in materialized view file %s", file.c_str());
+      return RC::GENERIC_ERROR;
+    }
+    group_fields_.push_back(group_value[i].asString());
+  }
+  columns_.clear();
+  for (Json::ArrayIndex i = 0; i < columns_value.size(); i++)
+  {
+    const Json::Value &column_value = columns_value[i];
+    const Json::Value &func_value = column_value[FIELD_COLUMN_FUNC];
+    ViewColumn column;
+    if (!column_value[FIELD_COLUMN_NAME].isString() || !column_value[FIELD_COLUMN_FIELD].isString() ||
+        !func_value.isString())
+    {
+      LOG_ERROR("Invalid column in materialized view file %s", file.c_str());
+      return RC::GENERIC_ERROR;
+    }
+    column.name = column_value[FIELD_COLUMN_NAME].asString();
+    column.field = column_value[FIELD_COLUMN_FIELD].asString();
+    column.func = ViewColumn::Func::GROUP;
+    if (!func_value.asString().empty() && !parse_func(func_value.asCString(), &column.func))
+    {
+      LOG_ERROR("Invalid function %s in materialized view file %s", func_value.asCString(), file.c_str());
+      return RC::GENERIC_ERROR;
+    }
+    columns_.push_back(std::move(column));
+  }
+  return RC::SUCCESS;
+}
+
+RC MaterializedView::resolve_fields()
+{
+  const TableMeta &base_meta = base_->table_meta();
+  group_indexes_.clear();
+  for (const std::string &field : group_fields_)
+  {
+    const int index = base_meta.find_field_index_by_name(field.c_str());
+    if (index < base_meta.sys_field_num())
+    {
+      LOG_ERROR("No such group by field %s in table %s", field.c_str(), base_->name());
+      return RC::SCHEMA_FIELD_NOT_EXIST;
+    }
+    group_indexes_.push_back(index);
+  }
+  column_indexes_.clear();
+  for (const ViewColumn &column : columns_)
+  {
+    const int index = column.field == "*" ? -1 : base_meta.find_field_index_by_name(column.field.c_str());
+    if (column.field != "*" && index < base_meta.sys_field_num())
+    {
+      LOG_ERROR("No such field %s in table %s", column.field.c_str(), base_->name());
+      return RC::SCHEMA_FIELD_NOT_EXIST;
+    }
+    column_indexes_.push_back(index);
+  }
+  if (table_->table_meta().field_num() - table_->table_meta().sys_field_num() != (int)columns_.size())
+  {
+    LOG_ERROR("Table %s does not match materialized view %s", table_->name(), name());
+    return RC::SCHEMA_FIELD_MISSING;
+  }
+  return RC::SUCCESS;
+}
+
+RC MaterializedView::open(Table *base, Table *table)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  base_ = base;
+  table_ = table;
+  RC rc = resolve_fields();
+  if (rc != RC::SUCCESS)
+  {
+    base_ = nullptr;
+    table_ = nullptr;
+    return rc;
+  }
+  return refresh();
+}
+
+RC MaterializedView::rebuild()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (nullptr == table_)
+  {
+    return RC::SUCCESS;
+  }
+  return refresh();
+}
+
+void MaterializedView::mark_stale()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  stale_ = true;
+}
+
+bool MaterializedView::is_null(const char *record, int field_index) const
+{
+  const TableMeta &base_meta = base_->table_meta();
+  return base_meta.field(field_index)->nullable() && base_meta.null_flag(field_index).test(record);
+}
+
+void MaterializedView::make_key(const char *record, std::string &key) const
+{
+  // 每个分组字段是一个字节的null标志加上定长的值，字符串后面补0
+  key.clear();
+  for (int index : group_indexes_)
+  {
+    const FieldMeta *field = base_->table_meta().field(index);
+    const bool null = is_null(record, index);
+    key.push_back(null ? 1 : 0);
+    const size_t pos = key.size();
+    key.resize(pos + field->len(), 0);
+    if (null)
+    {
+      continue;
+    }
+    const char *value = record + field->offset();
+    const size_t len = field->type() == CHARS ? strnlen(value, field->len()) : field->len();
+    memcpy(&key[pos], value, len);
+  }
+}
+
+/**
+ * value比extreme更大(is_max)或者更小时返回大于0的值，相等时返回0
+ */
+static int compare_extreme(AttrType type, const char *value, int len, int int_value, float float_value,
+                           const std::string &chars_value, bool is_max)
+{
+  int cmp = 0;
+  if (type == FLOATS)
+  {
+    const float v = *(const float *)value;
+    cmp = v > float_value ? 1 : (v < float_value ? -1 : 0);
+  }
+  else if (type == CHARS)
+  {
+    cmp = std::string(value, strnlen(value, len)).compare(chars_value);
+  }
+  else
+  {
+    const int v = *(const int *)value;
+    cmp = v > int_value ? 1 : (v < int_value ? -1 : 0);
+  }
+  return is_max ? cmp : -cmp;
+}
+
+void MaterializedView::add_record(Group &group, const char *record)
+{
+  group.row_count++;
+  group.dirty = true;
+  for (size_t j = 0; j < columns_.size(); j++)
+  {
+    const ViewColumn::Func func = columns_[j].func;
+    const int index = column_indexes_[j];
+    if (func == ViewColumn::Func::GROUP || index < 0 || is_null(record, index))
+    {
+      continue;
+    }
+    const FieldMeta *field = base_->table_meta().field(index);
+    const char *value = record + field->offset();
+    AggregateState &state = group.states[j];
+    state.count++;
+    if (func == ViewColumn::Func::SUM || func == ViewColumn::Func::AVG)
+    {
+      if (field->type() == INTS)
+      {
+        state.int_sum += *(const int *)value;
+      }
+      else
+      {
+        state.float_sum += *(const float *)value;
+      }
+    }
+    else if (func == ViewColumn::Func::MIN || func == ViewColumn::Func::MAX)
+    {
+      const bool is_max = func == ViewColumn::Func::MAX;
+      if (state.count == 1 || compare_extreme(field->type(), value, field->len(), state.int_value, state.float_value,
+                                              state.chars_value, is_max) > 0)
+      {
+        state.int_value = *(const int *)value;
+        state.float_value = *(const float *)value;
+        if (field->type() == CHARS)
+        {
+          state.chars_value.assign(value, strnlen(value, field->len()));
+        }
+      }
+    }
+  }
+}
+
+void MaterializedView::remove_record(Group &group, const char *record)
+{
+  group.row_count--;
+  group.dirty = true;
+  for (size_t j = 0; j < columns_.size(); j++)
+  {
+    const ViewColumn::Func func = columns_[j].func;
+    const int index = column_indexes_[j];
+    if (func == ViewColumn::Func::GROUP || index < 0 || is_null(record, index))
+    {
+      continue;
+    }
+    const FieldMeta *field = base_->table_meta().field(index);
+    const char *value = record + field->offset();
+    AggregateState &state = group.states[j];
+    state.count--;
+    if (func == ViewColumn::Func::SUM || func == ViewColumn::Func::AVG)
+    {
+      if (field->type() == INTS)
+      {
+        state.int_sum -= *(const int *)value;
+      }
+      else
+      {
+        state.float_sum -= *(const float *)value;
+      }
+    }
+    else if (func == ViewColumn::Func::MIN || func == ViewColumn::Func::MAX)
+    {
+      // 删掉的不是当前的最大最小值时结果不变
+      if (state.count > 0 && 0 == compare_extreme(field->type(), value, field->len(), state.int_value,
+                                                   state.float_value, state.chars_value, false))
+      {
+        group.recompute = true;
+      }
+    }
+  }
+}
+
+RC MaterializedView::recompute(const std::unordered_map<std::string, Group *> *keys)
+{
+  // 从提交之后最新的快照中读
+  Trx trx;
+  trx.acquire_read_view();
+  if (nullptr == keys)
+  {
+    // 快照中已经提交的事务都计算在内了，之后再来的修改中提交序号不大于它的跳过
+    refresh_ts_ = trx.read_view();
+    groups_.clear();
+  }
+
+  struct Context {
+    MaterializedView *view;
+    const std::unordered_map<std::string, Group *> *keys;
+    std::string key;
+    std::unordered_map<std::string, std::vector<AggregateState>> extremes;
+  } context{this, keys, std::string(), {}};
+  RC rc = base_->scan_record(&trx, nullptr, -1, &context, [](const char *record, void *ctx) {
+    Context *context = (Context *)ctx;
+    MaterializedView *view = context->view;
+    view->make_key(record, context->key);
+    if (nullptr == context->keys)
+    {
+      Group &group = view->groups_[context->key];
+      group.states.resize(view->columns_.size());
+      view->add_record(group, record);
+      return;
+    }
+    if (context->keys->count(context->key) == 0)
+    {
+      return;
+    }
+    // 只重新计算最大最小值，行数和和仍然是增量维护的。这时已经提交还没有更新视图的修改之后还会来，
+    // 重新计算的时候已经看到了它们，再加一次最大最小值结果不变，行数和和就重复了
+    std::vector<AggregateState> &states = context->extremes[context->key];
+    if (states.empty())
+    {
+      states.resize(view->columns_.size());
+    }
+    Group group;
+    group.states.swap(states);
+    view->add_record(group, record);
+    group.states.swap(states);
+  });
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to scan table %s for materialized view %s. rc=%d:%s", base_->name(), name(), rc, strrc(rc));
+    return rc;
+  }
+
+  if (keys != nullptr)
+  {
+    for (const auto &key_group : *keys)
+    {
+      Group *group = key_group.second;
+      auto iter = context.extremes.find(key_group.first);
+      for (size_t j = 0; j < columns_.size(); j++)
+      {
+        if (columns_[j].func != ViewColumn::Func::MIN && columns_[j].func != ViewColumn::Func::MAX)
+        {
+          continue;
+        }
+        if (iter != context.extremes.end() && iter->second[j].count > 0)
+        {
+          const AggregateState &found = iter->second[j];
+          group->states[j].int_value = found.int_value;
+          group->states[j].float_value = found.float_value;
+          group->states[j].chars_value = found.chars_value;
+        }
+      }
+      group->recompute = false;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+void MaterializedView::make_row(const std::string &key, const Group &group, std::vector<char> &row) const
+{
+  const TableMeta &table_meta = table_->table_meta();
+  const TableMeta &base_meta = base_->table_meta();
+  row.assign(table_meta.record_data_size(), 0);
+  for (size_t j = 0; j < columns_.size(); j++)
+  {
+    const int field_index = table_meta.sys_field_num() + (int)j;
+    const FieldMeta *field = table_meta.field(field_index);
+    char *dest = row.data() + field->offset();
+    const AggregateState &state = group.states[j];
+    const int index = column_indexes_[j];
+    bool null = false;
+    switch (columns_[j].func)
+    {
+    case ViewColumn::Func::GROUP:
+    {
+      // 在key中找到这个分组字段的位置
+      size_t pos = 0;
+      for (int group_index : group_indexes_)
+      {
+        if (group_index == index)
+        {
+          break;
+        }
+        pos += 1 + base_meta.field(group_index)->len();
+      }
+      null = key[pos] != 0;
+      memcpy(dest, key.data() + pos + 1, field->len());
+    }
+    break;
+    case ViewColumn::Func::COUNT:
+      *(int *)dest = (int)(index < 0 ? group.row_count : state.count);
+      break;
+    case ViewColumn::Func::SUM:
+      null = state.count == 0;
+      if (field->type() == INTS)
+      {
+        *(int *)dest = (int)state.int_sum;
+      }
+      else
+      {
+        *(float *)dest = (float)state.float_sum;
+      }
+      break;
+    case ViewColumn::Func::AVG:
+      null = state.count == 0;
+      if (!null)
+      {
+        *(float *)dest = base_meta.field(index)->type() == INTS ? (float)state.int_sum / state.count
+                                                                : (float)(state.float_sum / state.count);
+      }
+      break;
+    default:
+      null = state.count == 0;
+      if (field->type() == CHARS)
+      {
+        memcpy(dest, state.chars_value.data(), std::min((int)state.chars_value.size(), field->len()));
+      }
+      else if (field->type() == FLOATS)
+      {
+        *(float *)dest = state.float_value;
+      }
+      else
+      {
+        *(int *)dest = state.int_value;
+      }
+      break;
+    }
+    if (null)
+    {
+      table_meta.null_flag(field_index).set(row.data(), true);
+    }
+  }
+}
+
+RC MaterializedView::write_groups(Trx &trx)
+{
+  RC rc = RC::SUCCESS;
+  std::vector<char> data;
+  for (auto iter = groups_.begin(); iter != groups_.end() && rc == RC::SUCCESS; ++iter)
+  {
+    Group &group = iter->second;
+    if (!group.dirty)
+    {
+      continue;
+    }
+    if (group.has_row)
+    {
+      rc = table_->fetch_record(group.rid, data);
+      if (rc == RC::SUCCESS)
+      {
+        Record record;
+        record.rid = group.rid;
+        record.data = data.data();
+        rc = table_->delete_record(&trx, &record);
+      }
+      group.has_row = false;
+    }
+    if (rc == RC::SUCCESS && group.row_count > 0)
+    {
+      make_row(iter->first, group, data);
+      Record record;
+      record.data = data.data();
+      rc = table_->insert_record(&trx, &record);
+      group.rid = record.rid;
+      group.has_row = rc == RC::SUCCESS;
+    }
+    group.dirty = false;
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to write materialized view %s. rc=%d:%s", name(), rc, strrc(rc));
+    trx.rollback();
+    stale_ = true;
+    return rc;
+  }
+
+  for (auto iter = groups_.begin(); iter != groups_.end();)
+  {
+    if (iter->second.row_count <= 0)
+    {
+      iter = groups_.erase(iter);
+    }
+    else
+    {
+      ++iter;
+    }
+  }
+  return trx.commit();
+}
+
+RC MaterializedView::refresh()
+{
+  RC rc = recompute(nullptr);
+  if (rc != RC::SUCCESS)
+  {
+    stale_ = true;
+    return rc;
+  }
+  // 删除视图表中原来所有的行，和新的结果在同一个事务中提交
+  Trx trx;
+  int deleted_count = 0;
+  rc = table_->delete_record(&trx, nullptr, &deleted_count);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to clear materialized view %s. rc=%d:%s", name(), rc, strrc(rc));
+    trx.rollback();
+    stale_ = true;
+    return rc;
+  }
+  stale_ = false;
+  return write_groups(trx);
+}
+
+RC MaterializedView::apply(const RecordChanges &changes)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (nullptr == table_ || changes.commit_ts <= refresh_ts_)
+  {
+    // 还没有打开或者重新计算的时候已经包含了这个事务
+    return RC::SUCCESS;
+  }
+  if (stale_)
+  {
+    return refresh();
+  }
+
+  std::string key;
+  std::unordered_map<std::string, Group *> recompute_groups;
+  for (const std::vector<char> &record : changes.old_records)
+  {
+    make_key(record.data(), key);
+    auto iter = groups_.find(key);
+    if (iter == groups_.end())
+    {
+      // 视图和基表对不上
+      LOG_WARN("Group of a deleted record is missing in materialized view %s, refresh it", name());
+      return refresh();
+    }
+    remove_record(iter->second, record.data());
+    if (iter->second.recompute)
+    {
+      recompute_groups[key] = &iter->second;
+    }
+  }
+  for (const std::vector<char> &record : changes.new_records)
+  {
+    make_key(record.data(), key);
+    Group &group = groups_[key];
+    group.states.resize(columns_.size());
+    add_record(group, record.data());
+  }
+
+  for (auto iter = recompute_groups.begin(); iter != recompute_groups.end();)
+  {
+    if (iter->second->row_count <= 0)
+    {
+      iter = recompute_groups.erase(iter);
+    }
+    else
+    {
+      ++iter;
+    }
+  }
+  if (!recompute_groups.empty())
+  {
+    RC rc = recompute(&recompute_groups);
+    if (rc != RC::SUCCESS)
+    {
+      stale_ = true;
+      return rc;
+    }
+  }
+
+  Trx trx;
+  return write_groups(trx);
+}
@@ -0,0 +1,177 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Incrementally maintained materialized views of group by aggregates.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_MATERIALIZED_VIEW_H_
+#define __OBSERVER_STORAGE_COMMON_MATERIALIZED_VIEW_H_
+
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rc.h"
+#include "sql/parser/parse_defs.h"
+#include "storage/common/record_manager.h"
+
+static constexpr char MATERIALIZED_VIEW_SUFFIX[] = ".view";
+static constexpr char MATERIALIZED_VIEW_FILE_PATTERN[] = ".*\\.view$";
+
+class Table;
+class Trx;
+
+/**
+ * 一个事务提交的一张表上的修改，old_records是修改之前的记录，new_records是提交之后的记录，
+ * 都是table_meta中定长的格式。更新的记录两边各有一条，插入之后又删除的记录两边都没有
+ */
+struct RecordChanges {
+  uint64_t commit_ts = 0;  // 事务的提交序号
+  std::vector<std::vector<char>> old_records;
+  std::vector<std::vector<char>> new_records;
+};
+
+/**
+ * 物化视图中的一列，func为GROUP时是分组字段，其它是基表字段上的聚合函数，COUNT(*)的field是"*"
+ */
+struct ViewColumn {
+  enum class Func { GROUP, COUNT, SUM, AVG, MIN, MAX };
+  std::string name;   // 视图表中的字段名
+  Func func;
+  std::string field;  // 基表的字段名
+};
+
+/**
+ * 单表上按字段分组的聚合查询(count/sum/avg/min/max)的物化视图。
+ * 结果保存在一张普通的表中，每个分组一行，查询视图就是读这张小表；定义保存在数据库目录中的"视图名.view"文件里。
+ * 每个分组的中间结果(行数、非null值的个数、和、最大最小值)在内存中，基表上的事务提交之后用它修改前后的记录增量地更新，
+ * 修改过的分组在视图表中删除旧的一行再插入新的一行，这些修改在一个内部事务中提交，查询视图的事务看到的总是完整的结果。
+ * 删除或更新掉了某个分组的最大最小值时，重新扫描基表计算这些分组。
+ * 视图表的修改和基表的提交不是原子的，打开数据库时从基表重新计算整个视图
+ */
+class MaterializedView {
+public:
+  MaterializedView() = default;
+  ~MaterializedView() = default;
+
+  /**
+   * 检查select是不是能增量维护的单表分组聚合：只有一张表，没有条件、排序、limit和distinct，
+   * 输出的列是分组字段或者count/sum/avg/min/max，分组字段都在group by中
+   */
+  RC init(const char *name, const Table &base, const Selects &selects);
+  /**
+   * 视图表的字段，init或者load之后使用。分组字段和min/max的类型和基表字段相同，count是INTS，
+   * sum和基表字段的类型相同，avg是FLOATS
+   */
+  RC table_attributes(const Table &base, std::vector<AttrInfo> &attributes) const;
+
+  RC save(const std::string &file) const;
+  RC load(const std::string &file);
+
+  /**
+   * 关联基表和保存结果的表，从基表重新计算整个视图。视图表中原来的行都被删除
+   */
+  RC open(Table *base, Table *table);
+  /**
+   * 基表上一个事务提交之后调用，按提交之前和之后的记录更新受影响的分组
+   */
+  RC apply(const RecordChanges &changes);
+  /**
+   * 基表的修改没有取出来时调用，下次更新时重新计算整个视图
+   */
+  void mark_stale();
+  /**
+   * 基表不经过事务修改之后(load data、truncate)调用，从基表重新计算整个视图
+   */
+  RC rebuild();
+
+  const char *name() const
+  {
+    return name_.c_str();
+  }
+  const char *base_name() const
+  {
+    return base_name_.c_str();
+  }
+  Table *base() const
+  {
+    return base_;
+  }
+  Table *table() const
+  {
+    return table_;
+  }
+  const std::vector<ViewColumn> &columns() const
+  {
+    return columns_;
+  }
+
+private:
+  /**
+   * 一个聚合函数的中间结果，count是非null值的个数
+   */
+  struct AggregateState {
+    int64_t count = 0;
+    int64_t int_sum = 0;
+    double float_sum = 0;
+    int int_value = 0;
+    float float_value = 0;
+    std::string chars_value;
+  };
+  struct Group {
+    int64_t row_count = 0;
+    std::vector<AggregateState> states;
+    bool has_row = false;  // 视图表中已经有这个分组的一行
+    RID rid;
+    bool dirty = false;
+    bool recompute = false;  // 删除了最大或最小值，需要重新扫描
+  };
+
+  RC resolve_fields();
+  void make_key(const char *record, std::string &key) const;
+  bool is_null(const char *record, int field_index) const;
+  /**
+   * 把一条记录加到分组上或者从分组中减掉。减掉的是当前的最大最小值时标记为需要重新计算
+   */
+  void add_record(Group &group, const char *record);
+  void remove_record(Group &group, const char *record);
+  /**
+   * 扫描基表，重新计算keys中的分组，keys为nullptr时重新计算所有的分组
+   */
+  RC recompute(const std::unordered_map<std::string, Group *> *keys);
+  /**
+   * 把dirty的分组写到视图表中
+   */
+  RC write_groups(Trx &trx);
+  void make_row(const std::string &key, const Group &group, std::vector<char> &row) const;
+  RC refresh();
+
+private:
+  std::string name_;
+  std::string base_name_;
+  std::vector<std::string> group_fields_;  // group by中的字段，按顺序组成分组的key
+  std::vector<ViewColumn> columns_;
+
+  Table *base_ = nullptr;
+  Table *table_ = nullptr;
+  std::vector<int> group_indexes_;   // 分组字段在基表中的序号
+  std::vector<int> column_indexes_;  // 每一列的基表字段的序号，COUNT(*)是-1
+
+  std::mutex mutex_;  // 同时只有一个事务更新视图
+  std::unordered_map<std::string, Group> groups_;
+  bool stale_ = false;
+  uint64_t refresh_ts_ = 0;  // 上次重新计算整个视图时读到的最新的提交序号，不大于它的提交已经包含在结果中
+};
+
+#endif  // __OBSERVER_STORAGE_COMMON_MATERIALIZED_VIEW_H_
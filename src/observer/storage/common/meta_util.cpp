@@ -11,6 +11,8 @@ See the Mulan PSL v2 for more details. */
 // Created by wangyunlai.wyl on 2021/5/18.
 //
 
+#include <string.h>
+
 #include "storage/common/meta_util.h"
 
 std::string table_meta_file(const char *base_dir, const char *table_name) {
@@ -21,3 +23,60 @@ std::string index_data_file(const char *base_dir, const char *table_name, const
   return std::string(base_dir) + "/" + table_name + "-" + index_name + TABLE_INDEX_SUFFIX;
 }
 
+
+void MetaWriter::put_int32(int32_t value) {
+  output_.append((const char *)&value, sizeof(value));
+}
+
+void MetaWriter::put_int64(int64_t value) {
+  output_.append((const char *)&value, sizeof(value));
+}
+
+void MetaWriter::put_string(const std::string &value) {
+  put_int32((int32_t)value.size());
+  put_bytes(value.data(), (int)value.size());
+}
+
+void MetaWriter::put_bytes(const char *data, int len) {
+  output_.append(data, len);
+}
+
+bool MetaReader::get_int32(int32_t *value) {
+  if (end_ - data_ < (int64_t)sizeof(*value)) {
+    data_ = end_;
+    return false;
+  }
+  memcpy(value, data_, sizeof(*value));
+  data_ += sizeof(*value);
+  return true;
+}
+
+bool MetaReader::get_int64(int64_t *value) {
+  if (end_ - data_ < (int64_t)sizeof(*value)) {
+    data_ = end_;
+    return false;
+  }
+  memcpy(value, data_, sizeof(*value));
+  data_ += sizeof(*value);
+  return true;
+}
+
+bool MetaReader::get_string(std::string *value) {
+  const char *data = nullptr;
+  int32_t len = 0;
+  if (!get_int32(&len) || !get_bytes(len, &data)) {
+    return false;
+  }
+  value->assign(data, len);
+  return true;
+}
+
+bool MetaReader::get_bytes(int len, const char **data) {
+  if (len < 0 || end_ - data_ < len) {
+    data_ = end_;
+    return false;
+  }
+  *data = data_;
+  data_ += len;
+  return true;
+}
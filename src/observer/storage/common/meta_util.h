@@ -14,14 +14,65 @@ See the Mulan PSL v2 for more details. */
 #ifndef __OBSERVER_STORAGE_COMMON_META_UTIL_H_
 #define __OBSERVER_STORAGE_COMMON_META_UTIL_H_
 
+#include <stdint.h>
+
 #include <string>
 
 static const char *TABLE_META_SUFFIX = ".table";
 static const char *TABLE_META_FILE_PATTERN = ".*\\.table$";
 static const char *TABLE_DATA_SUFFIX = ".data";
 static const char *TABLE_INDEX_SUFFIX = ".index";
+static constexpr char TABLE_ZONE_SUFFIX[] = ".zone";
+static constexpr char TABLE_COUNT_SUFFIX[] = ".count";
+static constexpr char TABLE_UNDO_SUFFIX[] = ".undo";
+static constexpr char DB_CATALOG_FILE_NAME[] = "catalog";
 
 std::string table_meta_file(const char *base_dir, const char *table_name);
 std::string index_data_file(const char *base_dir, const char *table_name, const char *index_name);
 
+/**
+ * 元数据的二进制编码，整数按本机字节序追加到output后面，字符串前面是4字节的长度
+ */
+class MetaWriter {
+public:
+  explicit MetaWriter(std::string &output) : output_(output)
+  {}
+
+  void put_int32(int32_t value);
+  void put_int64(int64_t value);
+  void put_string(const std::string &value);
+  /**
+   * 不写长度，读取时由调用者给出
+   */
+  void put_bytes(const char *data, int len);
+
+private:
+  std::string &output_;
+};
+
+/**
+ * 读取MetaWriter写出的内容，数据不够时返回false，之后的读取都失败
+ */
+class MetaReader {
+public:
+  MetaReader(const char *data, int64_t len) : data_(data), end_(data + len)
+  {}
+
+  bool get_int32(int32_t *value);
+  bool get_int64(int64_t *value);
+  bool get_string(std::string *value);
+  /**
+   * data指向原来的数据，不复制
+   */
+  bool get_bytes(int len, const char **data);
+  bool eof() const
+  {
+    return data_ == end_;
+  }
+
+private:
+  const char *data_;
+  const char *end_;
+};
+
 #endif //__OBSERVER_STORAGE_COMMON_META_UTIL_H_
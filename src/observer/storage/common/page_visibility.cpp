@@ -0,0 +1,59 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Pages of a table whose records are all visible to every read view.
+//
+
+#include "storage/common/page_visibility.h"
+#include "common/log/log.h"
+
+void PageVisibility::add(PageNum page_num)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  pages_[page_num]++;
+  total_++;
+}
+
+void PageVisibility::remove(PageNum page_num)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto iter = pages_.find(page_num);
+  if (iter == pages_.end())
+  {
+    LOG_WARN("No trx operation on page %d", page_num);
+    return;
+  }
+  if (--iter->second == 0)
+  {
+    pages_.erase(iter);
+  }
+  total_--;
+}
+
+bool PageVisibility::all_visible(PageNum page_num) const
+{
+  if (inserting_.load() > 0)
+  {
+    return false;
+  }
+  if (total_.load() == 0)
+  {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pages_.find(page_num) == pages_.end();
+}
+
+int PageVisibility::page_count() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return (int)pages_.size();
+}
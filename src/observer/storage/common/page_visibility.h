@@ -0,0 +1,97 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Pages of a table whose records are all visible to every read view.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_PAGE_VISIBILITY_H_
+#define __OBSERVER_STORAGE_COMMON_PAGE_VISIBILITY_H_
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+#include "storage/default/disk_buffer_pool.h"
+
+/**
+ * 记录页面的可见性标记(visibility map)。记录上的事务字段不是0或者带着删除标记时，
+ * 一定有还没有结束、或者已经提交但是还没有清理的事务在这条记录上有操作。
+ * 这里按页面统计这样的操作数，没有操作的页面上所有的记录都已经提交并且对所有的读视图可见，
+ * 扫描这些页面时不用再逐条读取事务字段判断可见性。
+ * 打开表时的恢复已经清除了所有记录上的事务字段，所以只在内存中维护，开始时所有页面都是全部可见的。
+ * 插入的记录写到页面上之后才知道位置，插入过程中所有的页面都不算全部可见
+ */
+class PageVisibility {
+public:
+  /**
+   * 事务第一次操作页面上的一条记录时调用，在修改记录上的事务字段之前。插入在写到页面之前用begin_insert
+   */
+  void add(PageNum page_num);
+  /**
+   * 操作已经清理或者回滚，记录上不再有这个事务的事务号。每次add都要有对应的remove
+   */
+  void remove(PageNum page_num);
+
+  /**
+   * 带事务号的记录写到页面之前调用，到add之后end_insert
+   */
+  void begin_insert()
+  {
+    inserting_++;
+  }
+  void end_insert()
+  {
+    inserting_--;
+  }
+
+  /**
+   * 页面上的记录都对所有的读视图可见
+   */
+  bool all_visible(PageNum page_num) const;
+
+  /**
+   * 有事务操作的页面数
+   */
+  int page_count() const;
+
+private:
+  mutable std::mutex mutex_;
+  std::unordered_map<PageNum, int> pages_;  // 页面上还有的事务操作数，没有操作的页面不在这里
+  std::atomic<int> total_{0};               // pages_中操作的总数，为0时读取不用加锁
+  std::atomic<int> inserting_{0};
+};
+
+/**
+ * 表的插入，enabled为true时构造时begin_insert，析构时end_insert
+ */
+class PageVisibilityInsert {
+public:
+  PageVisibilityInsert(PageVisibility &visibility, bool enabled) : visibility_(enabled ? &visibility : nullptr)
+  {
+    if (visibility_ != nullptr) {
+      visibility_->begin_insert();
+    }
+  }
+  ~PageVisibilityInsert()
+  {
+    if (visibility_ != nullptr) {
+      visibility_->end_insert();
+    }
+  }
+
+  PageVisibilityInsert(const PageVisibilityInsert &) = delete;
+  PageVisibilityInsert &operator=(const PageVisibilityInsert &) = delete;
+
+private:
+  PageVisibility *visibility_;
+};
+
+#endif  // __OBSERVER_STORAGE_COMMON_PAGE_VISIBILITY_H_
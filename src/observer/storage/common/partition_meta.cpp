@@ -0,0 +1,230 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Meta of one partition of a partitioned table.
+//
+
+#include <string.h>
+
+#include "storage/common/partition_meta.h"
+#include "storage/common/field_meta.h"
+#include "storage/common/meta_util.h"
+#include "common/lang/string.h"
+#include "common/log/log.h"
+#include "json/json.h"
+
+const static Json::StaticString FIELD_NAME("name");
+const static Json::StaticString FIELD_BOUND("bound");
+
+RC PartitionMeta::init(const char *name, const FieldMeta &field, const Value *bound)
+{
+  if (nullptr == name || common::is_blank(name))
+  {
+    LOG_ERROR("Partition name cannot be empty");
+    return RC::INVALID_ARGUMENT;
+  }
+  if (bound != nullptr && (bound->type != field.type() || bound->data == nullptr))
+  {
+    LOG_ERROR("Invalid bound of partition %s. field=%s, type=%d, but given=%d",
+              name, field.name(), field.type(), bound->type);
+    return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+  }
+
+  name_ = name;
+  bound_.clear();
+  if (bound != nullptr)
+  {
+    // 和记录中的字段一样按字段长度保存，字符串后面补0
+    bound_.assign(field.len(), '\0');
+    if (field.type() == CHARS)
+    {
+      const char *s = (const char *)bound->data;
+      if (strlen(s) > (size_t)field.len())
+      {
+        LOG_ERROR("Bound of partition %s is longer than field %s", name, field.name());
+        return RC::INVALID_ARGUMENT;
+      }
+      memcpy(&bound_[0], s, strlen(s));
+    }
+    else
+    {
+      memcpy(&bound_[0], bound->data, field.len());
+    }
+  }
+  return RC::SUCCESS;
+}
+
+const char *PartitionMeta::name() const
+{
+  return name_.c_str();
+}
+
+bool PartitionMeta::has_bound() const
+{
+  return !bound_.empty();
+}
+
+const char *PartitionMeta::bound() const
+{
+  return bound_.data();
+}
+
+static void bound_to_value(const FieldMeta &field, const char *bound, Value &value, int &int_value)
+{
+  value.is_null = 0;
+  value.type = field.type();
+  if (field.type() == CHARS)
+  {
+    value.data = (void *)bound;
+  }
+  else
+  {
+    memcpy(&int_value, bound, sizeof(int_value));
+    value.data = &int_value;
+  }
+}
+
+void PartitionMeta::desc(const FieldMeta &field, std::ostream &os) const
+{
+  os << "partition name=" << name_;
+  if (!has_bound())
+  {
+    return;
+  }
+  os << ", less than=";
+  if (field.type() == CHARS)
+  {
+    os << std::string(bound_.data(), strnlen(bound_.data(), bound_.size()));
+  }
+  else
+  {
+    int value = 0;
+    memcpy(&value, bound_.data(), sizeof(value));
+    os << value;
+  }
+}
+
+void PartitionMeta::to_json(const FieldMeta &field, Json::Value &json_value) const
+{
+  json_value[FIELD_NAME] = name_;
+  if (!has_bound())
+  {
+    return;
+  }
+  if (field.type() == CHARS)
+  {
+    json_value[FIELD_BOUND] = std::string(bound_.data(), strnlen(bound_.data(), bound_.size()));
+  }
+  else
+  {
+    int value = 0;
+    memcpy(&value, bound_.data(), sizeof(value));
+    json_value[FIELD_BOUND] = value;
+  }
+}
+
+RC PartitionMeta::from_json(const FieldMeta &field, const Json::Value &json_value, PartitionMeta &partition)
+{
+  const Json::Value &name_value = json_value[FIELD_NAME];
+  if (!name_value.isString())
+  {
+    LOG_ERROR("Partition name is not a string. json value=%s", name_value.toStyledString().c_str());
+    return RC::GENERIC_ERROR;
+  }
+
+  const Json::Value &bound_value = json_value[FIELD_BOUND];
+  if (bound_value.isNull())
+  {
+    return partition.init(name_value.asCString(), field, nullptr);
+  }
+  const bool chars = field.type() == CHARS;
+  if (chars ? !bound_value.isString() : !bound_value.isInt())
+  {
+    LOG_ERROR("Invalid bound of partition [%s]. json value=%s",
+              name_value.asCString(), bound_value.toStyledString().c_str());
+    return RC::GENERIC_ERROR;
+  }
+  std::string chars_bound;
+  int int_bound = 0;
+  Value bound;
+  if (chars)
+  {
+    chars_bound = bound_value.asString();
+    chars_bound.resize(field.len(), '\0');
+    bound_to_value(field, chars_bound.data(), bound, int_bound);
+  }
+  else
+  {
+    int value = bound_value.asInt();
+    bound_to_value(field, (const char *)&value, bound, int_bound);
+  }
+  return partition.init(name_value.asCString(), field, &bound);
+}
+
+void PartitionMeta::to_binary(MetaWriter &writer) const
+{
+  writer.put_string(name_);
+  writer.put_string(bound_);
+}
+
+RC PartitionMeta::from_binary(const FieldMeta &field, MetaReader &reader, PartitionMeta &partition)
+{
+  std::string name;
+  std::string bound;
+  if (!reader.get_string(&name) || !reader.get_string(&bound) ||
+      (!bound.empty() && bound.size() != (size_t)field.len()))
+  {
+    LOG_ERROR("Failed to decode partition. data is truncated");
+    return RC::GENERIC_ERROR;
+  }
+  partition.name_.swap(name);
+  partition.bound_.swap(bound);
+  return RC::SUCCESS;
+}
+
+int PartitionMeta::compare(const FieldMeta &field, const char *value1, const char *value2)
+{
+  switch (field.type())
+  {
+  case CHARS:
+    return strncmp(value1, value2, field.len());
+  case FLOATS:
+  {
+    float f1 = 0;
+    float f2 = 0;
+    memcpy(&f1, value1, sizeof(f1));
+    memcpy(&f2, value2, sizeof(f2));
+    return f1 < f2 ? -1 : (f1 > f2 ? 1 : 0);
+  }
+  default:
+  {
+    // INTS和DATES都是4个字节的int，日期是从1970-01-01开始的天数
+    int i1 = 0;
+    int i2 = 0;
+    memcpy(&i1, value1, sizeof(i1));
+    memcpy(&i2, value2, sizeof(i2));
+    return i1 < i2 ? -1 : (i1 > i2 ? 1 : 0);
+  }
+  }
+}
+
+uint32_t PartitionMeta::hash(const FieldMeta &field, const char *value)
+{
+  // FNV-1a
+  const int len = field.storage_type() == CHARS ? strnlen(value, field.len()) : field.len();
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < len; i++)
+  {
+    hash ^= (uint8_t)value[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
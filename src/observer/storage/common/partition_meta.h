@@ -0,0 +1,78 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Meta of one partition of a partitioned table.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_PARTITION_META_H__
+#define __OBSERVER_STORAGE_COMMON_PARTITION_META_H__
+
+#include <stdint.h>
+
+#include <ostream>
+#include <string>
+
+#include "rc.h"
+#include "sql/parser/parse_defs.h"
+
+class FieldMeta;
+class MetaWriter;
+class MetaReader;
+
+namespace Json {
+class Value;
+} // namespace Json
+
+/**
+ * 分区表的一个分区。range分区的上界(不含)按分区字段在记录中的格式保存，没有上界的是maxvalue分区；
+ * hash分区没有上界。每个分区有自己的数据文件和索引文件，文件名中的表名是"表名.分区名"
+ */
+class PartitionMeta {
+public:
+  PartitionMeta() = default;
+
+  /**
+   * bound为nullptr时没有上界。bound的类型需要和分区字段相同
+   */
+  RC init(const char *name, const FieldMeta &field, const Value *bound);
+
+public:
+  const char *name() const;
+  bool has_bound() const;
+  /**
+   * 上界的数据，长度和分区字段相同
+   */
+  const char *bound() const;
+
+  void desc(const FieldMeta &field, std::ostream &os) const;
+
+public:
+  void to_json(const FieldMeta &field, Json::Value &json_value) const;
+  static RC from_json(const FieldMeta &field, const Json::Value &json_value, PartitionMeta &partition);
+  void to_binary(MetaWriter &writer) const;
+  static RC from_binary(const FieldMeta &field, MetaReader &reader, PartitionMeta &partition);
+
+public:
+  /**
+   * 按分区字段的类型比较两个字段值，CHARS只比较到字符串的结尾
+   */
+  static int compare(const FieldMeta &field, const char *value1, const char *value2);
+  /**
+   * hash分区使用的哈希值，和运行的机器、编译器无关，数据文件中的记录分布在重新启动之后不变
+   */
+  static uint32_t hash(const FieldMeta &field, const char *value);
+
+private:
+  std::string name_;
+  std::string bound_;  // 为空表示没有上界
+};
+
+#endif // __OBSERVER_STORAGE_COMMON_PARTITION_META_H__
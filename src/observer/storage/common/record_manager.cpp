@@ -15,8 +15,11 @@ See the Mulan PSL v2 for more details. */
 #include "rc.h"
 #include "common/log/log.h"
 #include "common/lang/bitmap.h"
+#include "common/lang/mutex.h"
 #include "condition_filter.h"
 
+#include <algorithm>
+
 using namespace common;
 
 struct PageHeader
@@ -24,8 +27,64 @@ struct PageHeader
   int record_num;          // 当前页面记录的个数
   int record_capacity;     // 最大记录个数
   int record_real_size;    // 每条记录的实际大小
-  int record_size;         // 每条记录占用实际空间大小(可能对齐)
-  int first_record_offset; // 第一条记录的偏移量
+  int record_size;         // 每条记录占用实际空间大小(可能对齐)，PAX页面是负的列数
+  int first_record_offset; // 第一条记录的偏移量，PAX页面是第一列的偏移量
+};
+
+#define RECORD_FSM_MAGIC 0x4d534652 // "RFSM"，记录页的第一个字段是记录数，不会是这个值
+
+struct FreeSpaceMapHeader
+{
+  int magic;
+  int record_format;       // 记录文件的格式，以前的版本是0
+};
+
+#define RECORD_FORMAT_FIXED    0
+#define RECORD_FORMAT_VARIABLE 1
+#define RECORD_FORMAT_PAX      2  // header之后是列数和每一列的长度，然后才是bitmap
+
+#define PAX_MAX_COLUMN_NUM     256
+
+/**
+ * 变长记录页面的header，record_size和PageHeader::record_size在同一个位置，总是0
+ */
+struct VarPageHeader
+{
+  int record_num;          // 当前页面记录的个数
+  int slot_count;          // slot目录的长度
+  int fragment_size;       // 删除或缩短记录留下的碎片大小，整理页面之后可以重新使用
+  int record_size;         // 总是0
+  int data_offset;         // 记录数据区的起始位置，记录从页尾向前存放
+};
+
+/**
+ * slot目录中的一项，offset为0表示slot没有被使用
+ */
+struct VarSlot
+{
+  uint16_t offset;
+  uint16_t length;         // 记录在页面内的长度，最高位表示记录有溢出页
+};
+
+#define VAR_SLOT_OVERFLOW     0x8000
+#define VAR_MIN_RECORD_SPACE  16   // 每条记录至少占用的空间，保证记录总能原地改成溢出记录
+
+#define RECORD_OVERFLOW_MAGIC 0x4c465652 // "RVFL"
+
+struct OverflowPageHeader
+{
+  int magic;
+  PageNum next_page;       // 下一个溢出页，最后一个是BP_INVALID_PAGE_NUM
+  int data_len;            // 这个页面中的数据长度
+};
+
+/**
+ * 有溢出页的记录在页面内的部分是记录的前缀加上这个结构
+ */
+struct OverflowStub
+{
+  int total_len;           // 记录的总长度
+  PageNum first_page;      // 第一个溢出页
 };
 
 int align8(int size)
@@ -50,16 +109,154 @@ int page_bitmap_size(int record_capacity)
   return record_capacity / 8 + ((record_capacity % 8 == 0) ? 0 : 1);
 }
 
+/**
+ * PAX页面的header之后是每一列的长度，然后是bitmap，之后依次是每一列的minipage，
+ * 第i列的minipage中连续存放所有slot的第i列。minipage从8字节对齐的位置开始
+ */
+int pax_page_fix_size(int column_num)
+{
+  return page_fix_size() + column_num * (int)sizeof(int);
+}
+
+int pax_page_record_capacity(int page_size, int column_num, int record_size)
+{
+  // 和page_record_capacity一样，另外留出对齐minipage的空间
+  return (int)((page_size - pax_page_fix_size(column_num) - 8) / (record_size + 0.125));
+}
+
 int page_header_size(int record_capacity)
 {
   const int bitmap_size = page_bitmap_size(record_capacity);
   return align8(page_fix_size() + bitmap_size);
 }
+int overflow_page_capacity(int page_data_size)
+{
+  return page_data_size - (int)sizeof(OverflowPageHeader);
+}
+
+RC free_overflow_pages(DiskBufferPool &buffer_pool, int file_id, PageNum page_num)
+{
+  while (page_num != BP_INVALID_PAGE_NUM)
+  {
+    BPPageHandle page_handle;
+    RC rc = buffer_pool.get_this_page(file_id, page_num, &page_handle);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to get overflow page %d of file %d. rc=%d:%s", page_num, file_id, rc, strrc(rc));
+      return rc;
+    }
+    PageNum next_page = ((const OverflowPageHeader *)page_handle.frame->page->data)->next_page;
+    buffer_pool.unpin_page(&page_handle);
+    rc = buffer_pool.dispose_page(file_id, page_num);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to dispose overflow page %d of file %d. rc=%d:%s", page_num, file_id, rc, strrc(rc));
+      return rc;
+    }
+    page_num = next_page;
+  }
+  return RC::SUCCESS;
+}
+
+/**
+ * 把data写到新分配的溢出页链中，从最后一段开始写，写每个页面时已经知道下一个页面
+ */
+RC write_overflow_pages(DiskBufferPool &buffer_pool, int file_id, const char *data, int len, PageNum *first_page)
+{
+  const int capacity = overflow_page_capacity(buffer_pool.page_data_size());
+  const int page_count = (len + capacity - 1) / capacity;
+  PageNum next_page = BP_INVALID_PAGE_NUM;
+  RC rc = RC::SUCCESS;
+  for (int i = page_count - 1; i >= 0; i--)
+  {
+    BPPageHandle page_handle;
+    rc = buffer_pool.allocate_page(file_id, &page_handle);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate overflow page of file %d. rc=%d:%s", file_id, rc, strrc(rc));
+      break;
+    }
+    const int offset = i * capacity;
+    const int data_len = std::min(capacity, len - offset);
+    OverflowPageHeader *header = (OverflowPageHeader *)page_handle.frame->page->data;
+    header->magic = RECORD_OVERFLOW_MAGIC;
+    header->next_page = next_page;
+    header->data_len = data_len;
+    memcpy(page_handle.frame->page->data + sizeof(OverflowPageHeader), data + offset, data_len);
+    next_page = page_handle.frame->page->page_num;
+    buffer_pool.mark_dirty(&page_handle);
+    buffer_pool.unpin_page(&page_handle);
+  }
+
+  if (rc != RC::SUCCESS)
+  {
+    free_overflow_pages(buffer_pool, file_id, next_page);
+    return rc;
+  }
+  *first_page = next_page;
+  return RC::SUCCESS;
+}
+
+RC read_overflow_pages(DiskBufferPool &buffer_pool, int file_id, PageNum page_num, char *data, int len)
+{
+  int offset = 0;
+  while (offset < len)
+  {
+    if (page_num == BP_INVALID_PAGE_NUM)
+    {
+      LOG_ERROR("Overflow page chain of file %d is too short, expect %d bytes but got %d", file_id, len, offset);
+      return RC::RECORD_INVALIDRID;
+    }
+    BPPageHandle page_handle;
+    RC rc = buffer_pool.get_this_page(file_id, page_num, &page_handle);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to get overflow page %d of file %d. rc=%d:%s", page_num, file_id, rc, strrc(rc));
+      return rc;
+    }
+    const OverflowPageHeader *header = (const OverflowPageHeader *)page_handle.frame->page->data;
+    const int data_len = std::min(header->data_len, len - offset);
+    memcpy(data + offset, page_handle.frame->page->data + sizeof(OverflowPageHeader), data_len);
+    offset += data_len;
+    page_num = header->next_page;
+    buffer_pool.unpin_page(&page_handle);
+  }
+  return RC::SUCCESS;
+}
+
+/**
+ * 记录在页面内的部分data(长度为len)没有溢出页时就是完整的记录，否则从溢出页中读取剩下的部分
+ */
+RC read_var_record(DiskBufferPool &buffer_pool, int file_id, const char *data, int len, bool overflow,
+                   std::vector<char> &record)
+{
+  if (!overflow)
+  {
+    record.assign(data, data + len);
+    return RC::SUCCESS;
+  }
+  OverflowStub stub;
+  const int prefix_len = len - (int)sizeof(OverflowStub);
+  memcpy(&stub, data + prefix_len, sizeof(stub));
+  record.resize(stub.total_len);
+  memcpy(record.data(), data, prefix_len);
+  return read_overflow_pages(buffer_pool, file_id, stub.first_page, record.data() + prefix_len,
+                             stub.total_len - prefix_len);
+}
+
+PageNum overflow_first_page(const char *data, int len)
+{
+  OverflowStub stub;
+  memcpy(&stub, data + len - sizeof(OverflowStub), sizeof(stub));
+  return stub.first_page;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 RecordPageHandler::RecordPageHandler() : disk_buffer_pool_(nullptr),
                                          file_id_(-1),
                                          page_header_(nullptr),
-                                         bitmap_(nullptr)
+                                         bitmap_(nullptr),
+                                         pax_(false)
 {
   page_handle_.open = false;
   page_handle_.frame = nullptr;
@@ -99,6 +296,20 @@ RC RecordPageHandler::init(DiskBufferPool &buffer_pool, int file_id, PageNum pag
   // 2. 后面data指针会被销毁，但是这里已经地址传给了当前类的中指针，存放具体数据的地址已经留存下来了
   page_header_ = (PageHeader *)(data);
   bitmap_ = data + page_fix_size();
+  pax_ = false;
+  if (page_header_->record_size < 0 && !is_free_space_map() && !is_overflow())
+  {
+    const int column_num = -page_header_->record_size;
+    const int *column_lens = (const int *)(data + page_fix_size());
+    pax_ = true;
+    pax_offsets_.resize(column_num + 1);
+    pax_offsets_[0] = 0;
+    for (int i = 0; i < column_num; i++)
+    {
+      pax_offsets_[i + 1] = pax_offsets_[i] + column_lens[i];
+    }
+    bitmap_ = data + pax_page_fix_size(column_num);
+  }
   LOG_TRACE("Successfully init file_id:page_num %d:%d.", file_id, page_num);
   return ret;
 }
@@ -112,14 +323,30 @@ RC RecordPageHandler::init_empty_page(DiskBufferPool &buffer_pool, int file_id,
     return ret;
   }
 
-  int page_size = sizeof(page_handle_.frame->page.data);
+  int page_size = buffer_pool.page_data_size();
+  if (record_size == 0)
+  { // 变长记录页面
+    VarPageHeader *header = (VarPageHeader *)page_header_;
+    header->record_num = 0;
+    header->slot_count = 0;
+    header->fragment_size = 0;
+    header->record_size = 0;
+    header->data_offset = page_size;
+    ret = disk_buffer_pool_->mark_dirty(&page_handle_);
+    if (ret != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to mark page dirty. ret=%s", strrc(ret));
+    }
+    return RC::SUCCESS;
+  }
+
   int record_phy_size = align8(record_size);
   page_header_->record_num = 0;
   page_header_->record_capacity = page_record_capacity(page_size, record_phy_size);
   page_header_->record_real_size = record_size;
   page_header_->record_size = record_phy_size;
   page_header_->first_record_offset = page_header_size(page_header_->record_capacity);
-  bitmap_ = page_handle_.frame->page.data + page_fix_size();
+  bitmap_ = page_handle_.frame->page->data + page_fix_size();
 
   memset(bitmap_, 0, page_bitmap_size(page_header_->record_capacity));
   ret = disk_buffer_pool_->mark_dirty(&page_handle_);
@@ -131,11 +358,97 @@ RC RecordPageHandler::init_empty_page(DiskBufferPool &buffer_pool, int file_id,
   return RC::SUCCESS;
 }
 
+RC RecordPageHandler::init_empty_pax_page(DiskBufferPool &buffer_pool, int file_id, PageNum page_num,
+                                            const std::vector<int> &columns)
+{
+  RC ret = init(buffer_pool, file_id, page_num);
+  if (ret != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to init empty pax page file_id:page_num %d:%d.", file_id, page_num);
+    return ret;
+  }
+
+  const int column_num = (int)columns.size();
+  char *data = page_handle_.frame->page->data;
+  int record_size = 0;
+  pax_offsets_.resize(column_num + 1);
+  pax_offsets_[0] = 0;
+  for (int i = 0; i < column_num; i++)
+  {
+    ((int *)(data + page_fix_size()))[i] = columns[i];
+    record_size += columns[i];
+    pax_offsets_[i + 1] = record_size;
+  }
+  pax_ = true;
+
+  const int capacity = pax_page_record_capacity(buffer_pool.page_data_size(), column_num, record_size);
+  page_header_->record_num = 0;
+  page_header_->record_capacity = capacity;
+  page_header_->record_real_size = record_size;
+  page_header_->record_size = -column_num;
+  page_header_->first_record_offset = align8(pax_page_fix_size(column_num) + page_bitmap_size(capacity));
+  bitmap_ = data + pax_page_fix_size(column_num);
+
+  memset(bitmap_, 0, page_bitmap_size(capacity));
+  ret = disk_buffer_pool_->mark_dirty(&page_handle_);
+  if (ret != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to mark page dirty. ret=%s", strrc(ret));
+  }
+  return RC::SUCCESS;
+}
+
+/**
+ * 从各个minipage中取出一条记录的列拼接到pax_row_中，columns为nullptr时读取所有的列
+ */
+char *RecordPageHandler::pax_read(SlotNum slot_num, const std::vector<int> *columns)
+{
+  const int column_num = (int)pax_offsets_.size() - 1;
+  const int capacity = page_header_->record_capacity;
+  const char *minipages = page_handle_.frame->page->data + page_header_->first_record_offset;
+  pax_row_.resize(page_header_->record_real_size);
+  char *row = pax_row_.data();
+  if (columns == nullptr)
+  {
+    for (int i = 0; i < column_num; i++)
+    {
+      const int offset = pax_offsets_[i];
+      const int len = pax_offsets_[i + 1] - offset;
+      memcpy(row + offset, minipages + capacity * offset + slot_num * len, len);
+    }
+    return row;
+  }
+  for (int i : *columns)
+  {
+    if (i < 0 || i >= column_num)
+    {
+      continue;
+    }
+    const int offset = pax_offsets_[i];
+    const int len = pax_offsets_[i + 1] - offset;
+    memcpy(row + offset, minipages + capacity * offset + slot_num * len, len);
+  }
+  return row;
+}
+
+void RecordPageHandler::pax_write(SlotNum slot_num, const char *data)
+{
+  const int column_num = (int)pax_offsets_.size() - 1;
+  const int capacity = page_header_->record_capacity;
+  char *minipages = page_handle_.frame->page->data + page_header_->first_record_offset;
+  for (int i = 0; i < column_num; i++)
+  {
+    const int offset = pax_offsets_[i];
+    const int len = pax_offsets_[i + 1] - offset;
+    memcpy(minipages + capacity * offset + slot_num * len, data + offset, len);
+  }
+}
+
 RC RecordPageHandler::deinit()
 {
   // if (page_header_ != nullptr) {
   //   disk_buffer_pool_->unpin_page(&page_handle_);
-  //   disk_buffer_pool_->force_page(file_id_, page_handle_.frame->page.page_num);
+  //   disk_buffer_pool_->force_page(file_id_, page_handle_.frame->page->page_num);
   //   page_header_ = nullptr;
   // }
   if (disk_buffer_pool_ != nullptr)
@@ -147,30 +460,63 @@ RC RecordPageHandler::deinit()
     }
     disk_buffer_pool_ = nullptr;
   }
+  // 页面unpin之后frame可能被别的页面复用，不能再通过它获取页号
+  page_header_ = nullptr;
+  bitmap_ = nullptr;
+  pax_ = false;
 
   return RC::SUCCESS;
 }
 
 RC RecordPageHandler::insert_record(const char *data, RID *rid)
 {
+  int inserted = 0;
+  return insert_records(&data, 1, rid, &inserted);
+}
 
+RC RecordPageHandler::insert_records(const char *const *rows, int n, RID *rids, int *inserted)
+{
+  *inserted = 0;
+  // 修改页面时加写锁，防止多个线程同时在同一页上分配slot
+  disk_buffer_pool_->latch_page(&page_handle_, true);
   if (page_header_->record_num == page_header_->record_capacity)
   {
+    disk_buffer_pool_->unlatch_page(&page_handle_);
     LOG_WARN("Page is full, file_id:page_num %d:%d.", file_id_,
-             page_handle_.frame->page.page_num);
+             page_handle_.frame->page->page_num);
     return RC::RECORD_NOMEM;
   }
 
   // 找到空闲位置
   Bitmap bitmap(bitmap_, page_header_->record_capacity);
-  int index = bitmap.next_unsetted_bit(0);
-  bitmap.set_bit(index);
-  page_header_->record_num++;
+  int index = -1;
+  PageNum page_num = get_page_num();
+  while (*inserted < n && page_header_->record_num < page_header_->record_capacity)
+  {
+    index = bitmap.next_unsetted_bit(index + 1);
+    bitmap.set_bit(index);
+    page_header_->record_num++;
 
-  // assert index < page_header_->record_capacity
-  char *record_data = page_handle_.frame->page.data +
-                      page_header_->first_record_offset + (index * page_header_->record_size);
-  memcpy(record_data, data, page_header_->record_real_size);
+    // assert index < page_header_->record_capacity
+    if (pax_)
+    {
+      pax_write(index, rows[*inserted]);
+    }
+    else
+    {
+      char *record_data = page_handle_.frame->page->data +
+                          page_header_->first_record_offset + (index * page_header_->record_size);
+      memcpy(record_data, rows[*inserted], page_header_->record_real_size);
+    }
+    if (rids)
+    {
+      rids[*inserted].page_num = page_num;
+      rids[*inserted].slot_num = index;
+    }
+    (*inserted)++;
+    LOG_TRACE("Insert record. rid page_num=%d, slot num=%d", page_num, index);
+  }
+  disk_buffer_pool_->unlatch_page(&page_handle_);
 
   RC rc = disk_buffer_pool_->mark_dirty(&page_handle_);
   if (rc != RC::SUCCESS)
@@ -178,14 +524,6 @@ RC RecordPageHandler::insert_record(const char *data, RID *rid)
     LOG_ERROR("Failed to mark page dirty. rc =%d:%s", rc, strrc(rc));
     // hard to rollback
   }
-
-  if (rid)
-  {
-    rid->page_num = get_page_num();
-    rid->slot_num = index;
-  }
-
-  LOG_TRACE("Insert record. rid page_num=%d, slot num=%d", get_page_num(), index);
   return RC::SUCCESS;
 }
 
@@ -198,7 +536,7 @@ RC RecordPageHandler::update_record(const Record *rec)
     LOG_ERROR("Invalid slot_num %d, exceed page's record capacity, file_id:page_num %d:%d.",
               rec->rid.slot_num,
               file_id_,
-              page_handle_.frame->page.page_num);
+              page_handle_.frame->page->page_num);
     return RC::INVALID_ARGUMENT;
   }
 
@@ -208,14 +546,23 @@ RC RecordPageHandler::update_record(const Record *rec)
     LOG_ERROR("Invalid slot_num %d, slot is empty, file_id:page_num %d:%d.",
               rec->rid.slot_num,
               file_id_,
-              page_handle_.frame->page.page_num);
+              page_handle_.frame->page->page_num);
     ret = RC::RECORD_RECORD_NOT_EXIST;
   }
   else
   {
-    char *record_data = page_handle_.frame->page.data +
-                        page_header_->first_record_offset + (rec->rid.slot_num * page_header_->record_size);
-    memcpy(record_data, rec->data, page_header_->record_real_size);
+    disk_buffer_pool_->latch_page(&page_handle_, true);
+    if (pax_)
+    {
+      pax_write(rec->rid.slot_num, rec->data);
+    }
+    else
+    {
+      char *record_data = page_handle_.frame->page->data +
+                          page_header_->first_record_offset + (rec->rid.slot_num * page_header_->record_size);
+      memcpy(record_data, rec->data, page_header_->record_real_size);
+    }
+    disk_buffer_pool_->unlatch_page(&page_handle_);
     ret = disk_buffer_pool_->mark_dirty(&page_handle_);
     if (ret != RC::SUCCESS)
     {
@@ -229,6 +576,11 @@ RC RecordPageHandler::update_record(const Record *rec)
 
 RC RecordPageHandler::delete_record(const RID *rid)
 {
+  if (is_variable())
+  {
+    return delete_var_record(rid);
+  }
+
   RC ret = RC::SUCCESS;
 
   if (rid->slot_num >= page_header_->record_capacity)
@@ -236,15 +588,17 @@ RC RecordPageHandler::delete_record(const RID *rid)
     LOG_ERROR("Invalid slot_num %d, exceed page's record capacity, file_id:page_num %d:%d.",
               rid->slot_num,
               file_id_,
-              page_handle_.frame->page.page_num);
+              page_handle_.frame->page->page_num);
     return RC::INVALID_ARGUMENT;
   }
 
   Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  disk_buffer_pool_->latch_page(&page_handle_, true);
   if (bitmap.get_bit(rid->slot_num))
   {
     bitmap.clear_bit(rid->slot_num);
     page_header_->record_num--;
+    disk_buffer_pool_->unlatch_page(&page_handle_);
     ret = disk_buffer_pool_->mark_dirty(&page_handle_);
     if (ret != RC::SUCCESS)
     {
@@ -263,10 +617,11 @@ RC RecordPageHandler::delete_record(const RID *rid)
   }
   else
   {
+    disk_buffer_pool_->unlatch_page(&page_handle_);
     LOG_ERROR("Invalid slot_num %d, slot is empty, file_id:page_num %d:%d.",
               rid->slot_num,
               file_id_,
-              page_handle_.frame->page.page_num);
+              page_handle_.frame->page->page_num);
     ret = RC::RECORD_RECORD_NOT_EXIST;
   }
   return ret;
@@ -274,12 +629,19 @@ RC RecordPageHandler::delete_record(const RID *rid)
 
 RC RecordPageHandler::get_record(const RID *rid, Record *rec)
 {
+  if (is_variable())
+  {
+    int len = 0;
+    bool overflow = false;
+    return get_record(rid, rec, &len, &overflow);
+  }
+
   if (rid->slot_num >= page_header_->record_capacity)
   {
     LOG_ERROR("Invalid slot_num:%d, exceed page's record capacity, file_id:page_num %d:%d.",
               rid->slot_num,
               file_id_,
-              page_handle_.frame->page.page_num);
+              page_handle_.frame->page->page_num);
     return RC::RECORD_INVALIDRID;
   }
 
@@ -289,16 +651,19 @@ RC RecordPageHandler::get_record(const RID *rid, Record *rec)
     LOG_ERROR("Invalid slot_num:%d, slot is empty, file_id:page_num %d:%d.",
               rid->slot_num,
               file_id_,
-              page_handle_.frame->page.page_num);
+              page_handle_.frame->page->page_num);
     return RC::RECORD_RECORD_NOT_EXIST;
   }
 
-  char *data = page_handle_.frame->page.data +
-               page_header_->first_record_offset + (page_header_->record_size * rid->slot_num);
-
   // rec->valid = true;
   rec->rid = *rid;
-  rec->data = data;
+  if (pax_)
+  {
+    rec->data = pax_read(rid->slot_num, nullptr);
+    return RC::SUCCESS;
+  }
+  rec->data = page_handle_.frame->page->data +
+              page_header_->first_record_offset + (page_header_->record_size * rid->slot_num);
   return RC::SUCCESS;
 }
 
@@ -310,170 +675,1014 @@ RC RecordPageHandler::get_first_record(Record *rec)
 
 RC RecordPageHandler::get_next_record(Record *rec)
 {
+  if (is_variable())
+  {
+    const VarPageHeader *header = (const VarPageHeader *)page_header_;
+    const VarSlot *slots = (const VarSlot *)(header + 1);
+    disk_buffer_pool_->latch_page(&page_handle_, false);
+    SlotNum slot_num = rec->rid.slot_num + 1;
+    while (slot_num < header->slot_count && slots[slot_num].offset == 0)
+    {
+      slot_num++;
+    }
+    const bool found = slot_num < header->slot_count;
+    disk_buffer_pool_->unlatch_page(&page_handle_);
+    if (!found)
+    {
+      return RC::RECORD_EOF;
+    }
+    return get_var_record(slot_num, rec);
+  }
+
   if (rec->rid.slot_num >= page_header_->record_capacity - 1)
   {
-    LOG_ERROR("Invalid slot_num:%d, exceed page's record capacity, file_id:page_num %d:%d.",
-              rec->rid.slot_num,
-              file_id_,
-              page_handle_.frame->page.page_num);
+    // 扫描到页面的最后一个slot之后是正常结束，不是错误
     return RC::RECORD_EOF;
   }
 
   Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  disk_buffer_pool_->latch_page(&page_handle_, false);
   int index = bitmap.next_setted_bit(rec->rid.slot_num + 1);
+  disk_buffer_pool_->unlatch_page(&page_handle_);
 
   if (index < 0)
   {
     LOG_TRACE("There is no empty slot, file_id:page_num %d:%d.",
               file_id_,
-              page_handle_.frame->page.page_num);
+              page_handle_.frame->page->page_num);
     return RC::RECORD_EOF;
   }
 
   rec->rid.page_num = get_page_num();
   rec->rid.slot_num = index;
   // rec->valid = true;
+  if (pax_)
+  {
+    rec->data = pax_read(index, nullptr);
+    return RC::SUCCESS;
+  }
 
-  char *record_data = page_handle_.frame->page.data +
+  char *record_data = page_handle_.frame->page->data +
                       page_header_->first_record_offset + (index * page_header_->record_size);
   rec->data = record_data;
   return RC::SUCCESS;
 }
 
+RC RecordPageHandler::visit_records(RC (*visitor)(Record *record, void *context), void *context,
+                                    const std::vector<int> *columns, const ConditionFilter *filter)
+{
+  if (is_variable())
+  {
+    // 和定长记录一样先复制一份哪些slot被使用了，visitor删除记录时slot目录会变化
+    const VarPageHeader *header = (const VarPageHeader *)page_header_;
+    const VarSlot *slots = (const VarSlot *)(header + 1);
+    SlotNum used_slots[BP_MAX_PAGE_SIZE / sizeof(VarSlot)];
+    int used_num = 0;
+    disk_buffer_pool_->latch_page(&page_handle_, false);
+    for (SlotNum slot_num = 0; slot_num < header->slot_count; slot_num++)
+    {
+      if (slots[slot_num].offset != 0)
+      {
+        used_slots[used_num++] = slot_num;
+      }
+    }
+    disk_buffer_pool_->unlatch_page(&page_handle_);
+
+    Record record;
+    for (int i = 0; i < used_num; i++)
+    {
+      RC rc = get_var_record(used_slots[i], &record);
+      if (rc == RC::RECORD_RECORD_NOT_EXIST)
+      {
+        continue;  // 被前面的visitor删除了
+      }
+      if (rc == RC::SUCCESS && (filter == nullptr || filter->filter(record)))
+      {
+        rc = visitor(&record, context);
+      }
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+    }
+    return RC::SUCCESS;
+  }
+
+  const int capacity = page_header_->record_capacity;
+  const int bitmap_size = capacity % 8 == 0 ? capacity / 8 : capacity / 8 + 1;
+  char bits[BP_MAX_PAGE_SIZE / 8];
+  disk_buffer_pool_->latch_page(&page_handle_, false);
+  memcpy(bits, bitmap_, bitmap_size);
+  disk_buffer_pool_->unlatch_page(&page_handle_);
+
+  Bitmap bitmap(bits, capacity);
+  char *first_record = page_handle_.frame->page->data + page_header_->first_record_offset;
+  Record record;
+  record.rid.page_num = get_page_num();
+  if (pax_ || nullptr == filter)
+  {
+    // PAX页面上的记录每次拼接到同一个缓存中，只能逐条判断
+    for (int index = bitmap.next_setted_bit(0); index >= 0; index = bitmap.next_setted_bit(index + 1))
+    {
+      record.rid.slot_num = index;
+      record.data = pax_ ? pax_read(index, columns) : first_record + index * page_header_->record_size;
+      if (filter != nullptr && !filter->filter(record))
+      {
+        continue;
+      }
+      RC rc = visitor(&record, context);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+    }
+    return RC::SUCCESS;
+  }
+
+  // 行格式的记录直接在页面上，先对整个页面的记录一起过滤，再访问满足条件的记录
+  filter->filter_page(first_record, page_header_->record_size, capacity, bits);
+  for (int index = bitmap.next_setted_bit(0); index >= 0; index = bitmap.next_setted_bit(index + 1))
+  {
+    record.rid.slot_num = index;
+    record.data = first_record + index * page_header_->record_size;
+    RC rc = visitor(&record, context);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+  return RC::SUCCESS;
+}
+
 PageNum RecordPageHandler::get_page_num() const
 {
   if (nullptr == page_header_)
   {
     return (PageNum)(-1);
   }
-  return page_handle_.frame->page.page_num;
+  return page_handle_.frame->page->page_num;
 }
 
 bool RecordPageHandler::is_full() const
 {
+  if (is_variable())
+  {
+    // 空闲空间表中有空闲的页面一定能放下任何一条记录在页面内的部分
+    return free_space() < max_inline_record_size(disk_buffer_pool_->page_data_size()) + (int)sizeof(VarSlot);
+  }
   return page_header_->record_num >= page_header_->record_capacity;
 }
 
-////////////////////////////////////////////////////////////////////////////////
+bool RecordPageHandler::is_free_space_map() const
+{
+  return RecordFreeSpaceMap::is_free_space_map_page((const char *)page_header_);
+}
 
-RecordFileHandler::RecordFileHandler() : disk_buffer_pool_(nullptr),
-                                         file_id_(-1)
+bool RecordPageHandler::is_overflow() const
 {
+  return ((const OverflowPageHeader *)page_header_)->magic == RECORD_OVERFLOW_MAGIC;
 }
 
-RC RecordFileHandler::init(DiskBufferPool &buffer_pool, int file_id)
+bool RecordPageHandler::is_variable() const
 {
+  return page_header_->record_size == 0;
+}
 
-  RC ret = RC::SUCCESS;
+int RecordPageHandler::free_space() const
+{
+  const VarPageHeader *header = (const VarPageHeader *)page_header_;
+  const int directory_end = (int)sizeof(VarPageHeader) + header->slot_count * (int)sizeof(VarSlot);
+  return header->data_offset - directory_end + header->fragment_size;
+}
 
-  if (disk_buffer_pool_ != nullptr)
+int RecordPageHandler::used_percent() const
+{
+  if (!is_variable())
   {
-    LOG_ERROR("%d has been openned.", file_id);
-    return RC::RECORD_OPENNED;
+    return page_header_->record_num * 100 / page_header_->record_capacity;
   }
+  const int usable = disk_buffer_pool_->page_data_size() - (int)sizeof(VarPageHeader);
+  return (usable - free_space()) * 100 / usable;
+}
 
-  disk_buffer_pool_ = &buffer_pool;
-  file_id_ = file_id;
-
-  LOG_TRACE("Successfully open %d.", file_id);
-  return ret;
+int RecordPageHandler::max_inline_record_size(int page_data_size)
+{
+  return (page_data_size - (int)sizeof(VarPageHeader)) / 4 - (int)sizeof(VarSlot);
 }
 
-void RecordFileHandler::close()
+static int var_record_space(int len)
 {
-  if (disk_buffer_pool_ != nullptr)
-  {
-    disk_buffer_pool_ = nullptr;
-  }
+  return std::max(len, VAR_MIN_RECORD_SPACE);
 }
 
-RC RecordFileHandler::insert_record(const char *data, int record_size, RID *rid)
+RC RecordPageHandler::insert_record(const char *data, int len, bool overflow, RID *rid)
 {
-  RC ret = RC::SUCCESS;
-  // 找到没有填满的页面
-  int page_count = 0;
-  if ((ret = disk_buffer_pool_->get_page_count(file_id_, &page_count)) != RC::SUCCESS)
+  VarPageHeader *header = (VarPageHeader *)page_header_;
+  VarSlot *slots = (VarSlot *)(header + 1);
+  const int space = var_record_space(len);
+
+  disk_buffer_pool_->latch_page(&page_handle_, true);
+  SlotNum slot_num = 0;
+  while (slot_num < header->slot_count && slots[slot_num].offset != 0)
   {
-    LOG_ERROR("Failed to get page count while inserting record");
-    return ret;
+    slot_num++;
   }
-
-  PageNum current_page_num = record_page_handler_.get_page_num();
-  if (current_page_num < 0)
+  const int slot_space = slot_num == header->slot_count ? (int)sizeof(VarSlot) : 0;
+  if (free_space() < space + slot_space)
   {
-    if (page_count >= 2)
-    { // 当前buffer pool 有页面时才尝试加载第一页
-      // 参考diskBufferPool，pageNum从1开始
-      if ((ret = record_page_handler_.init(*disk_buffer_pool_, file_id_, 1)) != RC::SUCCESS)
-      {
-        LOG_ERROR("Failed to init record page handler.ret=%d", ret);
-        return ret;
-      }
-      current_page_num = record_page_handler_.get_page_num();
-    }
-    else
-    {
-      current_page_num = 0;
-    }
+    disk_buffer_pool_->unlatch_page(&page_handle_);
+    return RC::RECORD_NOMEM;
+  }
+  if (slot_space > 0)
+  {
+    header->slot_count++;
+    slots[slot_num].offset = 0;
+  }
+  const int directory_end = (int)sizeof(VarPageHeader) + header->slot_count * (int)sizeof(VarSlot);
+  if (header->data_offset - directory_end < space)
+  {
+    compact();
   }
 
-  bool page_found = false;
-  for (int i = 0; i < page_count; i++)
+  header->data_offset -= space;
+  memcpy(page_handle_.frame->page->data + header->data_offset, data, len);
+  slots[slot_num].offset = (uint16_t)header->data_offset;
+  slots[slot_num].length = (uint16_t)(len | (overflow ? VAR_SLOT_OVERFLOW : 0));
+  header->record_num++;
+  disk_buffer_pool_->unlatch_page(&page_handle_);
+
+  RC rc = disk_buffer_pool_->mark_dirty(&page_handle_);
+  if (rc != RC::SUCCESS)
   {
-    current_page_num = (current_page_num + i) % page_count; // 从当前打开的页面开始查找
-    if (current_page_num == 0)
+    LOG_ERROR("Failed to mark page dirty. rc =%d:%s", rc, strrc(rc));
+  }
+  if (rid != nullptr)
+  {
+    rid->page_num = get_page_num();
+    rid->slot_num = slot_num;
+  }
+  LOG_TRACE("Insert variable length record. rid page_num=%d, slot num=%d, len=%d", get_page_num(), slot_num, len);
+  return RC::SUCCESS;
+}
+
+RC RecordPageHandler::update_record(const RID *rid, const char *data, int len, bool overflow)
+{
+  VarPageHeader *header = (VarPageHeader *)page_header_;
+  VarSlot *slots = (VarSlot *)(header + 1);
+  const int space = var_record_space(len);
+
+  disk_buffer_pool_->latch_page(&page_handle_, true);
+  if (rid->slot_num < 0 || rid->slot_num >= header->slot_count || slots[rid->slot_num].offset == 0)
+  {
+    disk_buffer_pool_->unlatch_page(&page_handle_);
+    LOG_ERROR("Invalid slot_num %d, slot is empty, file_id:page_num %d:%d.", rid->slot_num, file_id_, get_page_num());
+    return RC::RECORD_RECORD_NOT_EXIST;
+  }
+
+  VarSlot &slot = slots[rid->slot_num];
+  const int old_space = var_record_space(slot.length & ~VAR_SLOT_OVERFLOW);
+  if (space > old_space)
+  {
+    if (free_space() + old_space < space)
+    {
+      disk_buffer_pool_->unlatch_page(&page_handle_);
+      return RC::RECORD_NOMEM;
+    }
+    // 原来的位置放不下，释放之后重新分配。整理页面时这个slot被当作空闲的
+    header->fragment_size += old_space;
+    slot.offset = 0;
+    const int directory_end = (int)sizeof(VarPageHeader) + header->slot_count * (int)sizeof(VarSlot);
+    if (header->data_offset - directory_end < space)
+    {
+      compact();
+    }
+    header->data_offset -= space;
+    slot.offset = (uint16_t)header->data_offset;
+  }
+  else
+  {
+    header->fragment_size += old_space - space;
+  }
+  memcpy(page_handle_.frame->page->data + slot.offset, data, len);
+  slot.length = (uint16_t)(len | (overflow ? VAR_SLOT_OVERFLOW : 0));
+  disk_buffer_pool_->unlatch_page(&page_handle_);
+
+  RC rc = disk_buffer_pool_->mark_dirty(&page_handle_);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to mark page dirty. rc =%d:%s", rc, strrc(rc));
+  }
+  return RC::SUCCESS;
+}
+
+RC RecordPageHandler::get_record(const RID *rid, Record *rec, int *len, bool *overflow)
+{
+  if (!is_variable())
+  {
+    RC rc = get_record(rid, rec);
+    *len = page_header_->record_real_size;
+    *overflow = false;
+    return rc;
+  }
+
+  const VarPageHeader *header = (const VarPageHeader *)page_header_;
+  const VarSlot *slots = (const VarSlot *)(header + 1);
+  disk_buffer_pool_->latch_page(&page_handle_, false);
+  if (rid->slot_num < 0 || rid->slot_num >= header->slot_count || slots[rid->slot_num].offset == 0)
+  {
+    disk_buffer_pool_->unlatch_page(&page_handle_);
+    LOG_ERROR("Invalid slot_num:%d, slot is empty, file_id:page_num %d:%d.", rid->slot_num, file_id_, get_page_num());
+    return RC::RECORD_RECORD_NOT_EXIST;
+  }
+  const VarSlot slot = slots[rid->slot_num];
+  disk_buffer_pool_->unlatch_page(&page_handle_);
+
+  rec->rid = *rid;
+  rec->data = page_handle_.frame->page->data + slot.offset;
+  *len = slot.length & ~VAR_SLOT_OVERFLOW;
+  *overflow = (slot.length & VAR_SLOT_OVERFLOW) != 0;
+  return RC::SUCCESS;
+}
+
+RC RecordPageHandler::get_var_record(SlotNum slot_num, Record *rec)
+{
+  RID rid;
+  rid.page_num = get_page_num();
+  rid.slot_num = slot_num;
+  int len = 0;
+  bool overflow = false;
+  RC rc = get_record(&rid, rec, &len, &overflow);
+  if (rc != RC::SUCCESS || !overflow)
+  {
+    return rc;
+  }
+
+  rc = read_var_record(*disk_buffer_pool_, file_id_, rec->data, len, overflow, overflow_buffer_);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to read overflow record. page num=%d, slot num=%d, rc=%d:%s",
+              rid.page_num, slot_num, rc, strrc(rc));
+    return rc;
+  }
+  rec->data = overflow_buffer_.data();
+  return RC::SUCCESS;
+}
+
+RC RecordPageHandler::delete_var_record(const RID *rid)
+{
+  VarPageHeader *header = (VarPageHeader *)page_header_;
+  VarSlot *slots = (VarSlot *)(header + 1);
+
+  disk_buffer_pool_->latch_page(&page_handle_, true);
+  if (rid->slot_num < 0 || rid->slot_num >= header->slot_count || slots[rid->slot_num].offset == 0)
+  {
+    disk_buffer_pool_->unlatch_page(&page_handle_);
+    LOG_ERROR("Invalid slot_num %d, slot is empty, file_id:page_num %d:%d.", rid->slot_num, file_id_, get_page_num());
+    return RC::RECORD_RECORD_NOT_EXIST;
+  }
+
+  header->fragment_size += var_record_space(slots[rid->slot_num].length & ~VAR_SLOT_OVERFLOW);
+  slots[rid->slot_num].offset = 0;
+  slots[rid->slot_num].length = 0;
+  // 末尾空闲的slot已经没有rid指向它们了，可以从目录中去掉
+  while (header->slot_count > 0 && slots[header->slot_count - 1].offset == 0)
+  {
+    header->slot_count--;
+  }
+  header->record_num--;
+  disk_buffer_pool_->unlatch_page(&page_handle_);
+
+  RC ret = disk_buffer_pool_->mark_dirty(&page_handle_);
+  if (ret != RC::SUCCESS)
+  {
+    LOG_ERROR("failed to mark page dirty in delete record. ret=%d:%s", ret, strrc(ret));
+  }
+
+  if (header->record_num == 0)
+  {
+    DiskBufferPool *disk_buffer_pool = disk_buffer_pool_;
+    int file_id = file_id_;
+    PageNum page_num = get_page_num();
+    deinit();
+    disk_buffer_pool->dispose_page(file_id, page_num);
+  }
+  return RC::SUCCESS;
+}
+
+/**
+ * 把所有记录重新紧凑地放到页尾，碎片合并到空闲空间中。调用者持有页面写锁
+ */
+void RecordPageHandler::compact()
+{
+  VarPageHeader *header = (VarPageHeader *)page_header_;
+  VarSlot *slots = (VarSlot *)(header + 1);
+  char *data = page_handle_.frame->page->data;
+  const int page_size = disk_buffer_pool_->page_data_size();
+
+  char copy[BP_MAX_PAGE_SIZE];
+  memcpy(copy, data, page_size);
+  int data_offset = page_size;
+  for (SlotNum slot_num = 0; slot_num < header->slot_count; slot_num++)
+  {
+    VarSlot &slot = slots[slot_num];
+    if (slot.offset == 0)
+    {
+      continue;
+    }
+    const int space = var_record_space(slot.length & ~VAR_SLOT_OVERFLOW);
+    data_offset -= space;
+    memcpy(data + data_offset, copy + slot.offset, space);
+    slot.offset = (uint16_t)data_offset;
+  }
+  header->data_offset = data_offset;
+  header->fragment_size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+RecordFreeSpaceMap::RecordFreeSpaceMap() : disk_buffer_pool_(nullptr),
+                                           file_id_(-1),
+                                           page_num_(BP_INVALID_PAGE_NUM),
+                                           capacity_(0),
+                                           hint_(0),
+                                           variable_length_(false),
+                                           bits_offset_((int)sizeof(FreeSpaceMapHeader))
+{
+  MUTEX_INIT(&mutex_, nullptr);
+}
+
+RecordFreeSpaceMap::~RecordFreeSpaceMap()
+{
+  MUTEX_DESTROY(&mutex_);
+}
+
+bool RecordFreeSpaceMap::is_free_space_map_page(const char *data)
+{
+  return ((const FreeSpaceMapHeader *)data)->magic == RECORD_FSM_MAGIC;
+}
+
+RC RecordFreeSpaceMap::init(DiskBufferPool &buffer_pool, int file_id, bool variable_length,
+                            const std::vector<int> &pax_columns)
+{
+  disk_buffer_pool_ = &buffer_pool;
+  file_id_ = file_id;
+  page_num_ = BP_INVALID_PAGE_NUM;
+  hint_ = 0;
+  variable_length_ = false;
+  pax_columns_.clear();
+  bits_offset_ = (int)sizeof(FreeSpaceMapHeader);
+  capacity_ = (buffer_pool.page_data_size() - bits_offset_) * 8;
+
+  int page_count = 0;
+  RC rc = buffer_pool.get_page_count(file_id, &page_count);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to get page count of file %d. rc=%d:%s", file_id, rc, strrc(rc));
+    return rc;
+  }
+
+  if (page_count == 1)
+  { // 新文件，第1页作为空闲空间表页
+    return format_page(variable_length, pax_columns);
+  }
+
+  BPPageHandle page_handle;
+  rc = buffer_pool.get_this_page(file_id, 1, &page_handle);
+  if (rc != RC::SUCCESS && rc != RC::BUFFERPOOL_INVALID_PAGE_NUM)
+  {
+    LOG_ERROR("Failed to get page 1 of file %d. rc=%d:%s", file_id, rc, strrc(rc));
+    return rc;
+  }
+  if (rc == RC::SUCCESS)
+  {
+    const char *data = page_handle.frame->page->data;
+    if (is_free_space_map_page(data))
+    {
+      page_num_ = 1;
+      const int record_format = ((const FreeSpaceMapHeader *)data)->record_format;
+      variable_length_ = record_format == RECORD_FORMAT_VARIABLE;
+      if (record_format == RECORD_FORMAT_PAX)
+      {
+        const int *columns = (const int *)(data + sizeof(FreeSpaceMapHeader));
+        if (columns[0] <= 0 || columns[0] > PAX_MAX_COLUMN_NUM)
+        {
+          LOG_ERROR("Invalid pax column num %d in free space map of file %d", columns[0], file_id);
+          buffer_pool.unpin_page(&page_handle);
+          return RC::CORRUPT;
+        }
+        pax_columns_.assign(columns + 1, columns + 1 + columns[0]);
+        bits_offset_ = (int)sizeof(FreeSpaceMapHeader) + (1 + columns[0]) * (int)sizeof(int);
+        capacity_ = (buffer_pool.page_data_size() - bits_offset_) * 8;
+      }
+    }
+    buffer_pool.unpin_page(&page_handle);
+  }
+  if (page_num_ == BP_INVALID_PAGE_NUM)
+  {
+    return build_in_memory();
+  }
+  return RC::SUCCESS;
+}
+
+RC RecordFreeSpaceMap::format_page(bool variable_length, const std::vector<int> &pax_columns)
+{
+  if (pax_columns.size() > PAX_MAX_COLUMN_NUM)
+  {
+    LOG_ERROR("Too many pax columns %d of file %d", (int)pax_columns.size(), file_id_);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  BPPageHandle page_handle;
+  RC rc = disk_buffer_pool_->allocate_page(file_id_, &page_handle);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to allocate free space map page of file %d. rc=%d:%s", file_id_, rc, strrc(rc));
+    return rc;
+  }
+  char *data = page_handle.frame->page->data;
+  memset(data, 0, disk_buffer_pool_->page_data_size());
+  ((FreeSpaceMapHeader *)data)->magic = RECORD_FSM_MAGIC;
+  ((FreeSpaceMapHeader *)data)->record_format = variable_length ? RECORD_FORMAT_VARIABLE : RECORD_FORMAT_FIXED;
+  if (!pax_columns.empty())
+  {
+    ((FreeSpaceMapHeader *)data)->record_format = RECORD_FORMAT_PAX;
+    int *columns = (int *)(data + sizeof(FreeSpaceMapHeader));
+    columns[0] = (int)pax_columns.size();
+    memcpy(columns + 1, pax_columns.data(), pax_columns.size() * sizeof(int));
+    pax_columns_ = pax_columns;
+    bits_offset_ = (int)sizeof(FreeSpaceMapHeader) + (1 + columns[0]) * (int)sizeof(int);
+    capacity_ = (disk_buffer_pool_->page_data_size() - bits_offset_) * 8;
+  }
+  page_num_ = page_handle.frame->page->page_num;
+  variable_length_ = variable_length && pax_columns.empty();
+  disk_buffer_pool_->mark_dirty(&page_handle);
+  disk_buffer_pool_->unpin_page(&page_handle);
+  LOG_INFO("Create free space map page %d of file %d", page_num_, file_id_);
+  return RC::SUCCESS;
+}
+
+RC RecordFreeSpaceMap::build_in_memory()
+{
+  int page_count = 0;
+  RC rc = disk_buffer_pool_->get_page_count(file_id_, &page_count);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  memory_bitmap_.assign(capacity_ / 8, 0);
+  Bitmap bitmap(memory_bitmap_.data(), capacity_);
+  for (PageNum page_num = 1; page_num < page_count && page_num < capacity_; page_num++)
+  {
+    RecordPageHandler page_handler;
+    rc = page_handler.init(*disk_buffer_pool_, file_id_, page_num);
+    if (rc == RC::BUFFERPOOL_INVALID_PAGE_NUM)
+    {
+      continue;
+    }
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to init record page %d of file %d. rc=%d:%s", page_num, file_id_, rc, strrc(rc));
+      return rc;
+    }
+    if (!page_handler.is_full())
+    {
+      bitmap.set_bit(page_num);
+    }
+  }
+  LOG_INFO("Build free space map of file %d in memory, page count=%d", file_id_, page_count);
+  return RC::SUCCESS;
+}
+
+void RecordFreeSpaceMap::close()
+{
+  disk_buffer_pool_ = nullptr;
+  memory_bitmap_.clear();
+}
+
+RC RecordFreeSpaceMap::find_free_page(PageNum *page_num)
+{
+  int page_count = 0;
+  RC rc = disk_buffer_pool_->get_page_count(file_id_, &page_count);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  if (page_count > capacity_)
+  {
+    page_count = capacity_;
+  }
+
+  BPPageHandle page_handle;
+  char *bits = memory_bitmap_.data();
+  if (page_num_ != BP_INVALID_PAGE_NUM)
+  {
+    if ((rc = disk_buffer_pool_->get_this_page(file_id_, page_num_, &page_handle)) != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to get free space map page of file %d. rc=%d:%s", file_id_, rc, strrc(rc));
+      return rc;
+    }
+    bits = page_handle.frame->page->data + bits_offset_;
+    disk_buffer_pool_->latch_page(&page_handle, false);
+  }
+
+  MUTEX_LOCK(&mutex_);
+  Bitmap bitmap(bits, page_count);
+  int index = bitmap.next_setted_bit(hint_);
+  if (index >= 0)
+  {
+    hint_ = index;
+  }
+  MUTEX_UNLOCK(&mutex_);
+
+  if (page_num_ != BP_INVALID_PAGE_NUM)
+  {
+    disk_buffer_pool_->unlatch_page(&page_handle);
+    disk_buffer_pool_->unpin_page(&page_handle);
+  }
+  if (index < 0)
+  {
+    return RC::RECORD_EOF;
+  }
+  *page_num = index;
+  return RC::SUCCESS;
+}
+
+RC RecordFreeSpaceMap::set_free(PageNum page_num, bool free)
+{
+  if (page_num < 0 || page_num >= capacity_)
+  {
+    LOG_ERROR("Invalid page num %d for free space map of file %d, capacity=%d", page_num, file_id_, capacity_);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  RC rc = RC::SUCCESS;
+  BPPageHandle page_handle;
+  char *bits = memory_bitmap_.data();
+  if (page_num_ != BP_INVALID_PAGE_NUM)
+  {
+    if ((rc = disk_buffer_pool_->get_this_page(file_id_, page_num_, &page_handle)) != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to get free space map page of file %d. rc=%d:%s", file_id_, rc, strrc(rc));
+      return rc;
+    }
+    bits = page_handle.frame->page->data + bits_offset_;
+    disk_buffer_pool_->latch_page(&page_handle, true);
+  }
+
+  MUTEX_LOCK(&mutex_);
+  Bitmap bitmap(bits, capacity_);
+  bool changed = bitmap.get_bit(page_num) != free;
+  if (free)
+  {
+    bitmap.set_bit(page_num);
+    if (page_num < hint_)
+    {
+      hint_ = page_num;
+    }
+  }
+  else
+  {
+    bitmap.clear_bit(page_num);
+  }
+  MUTEX_UNLOCK(&mutex_);
+
+  if (page_num_ != BP_INVALID_PAGE_NUM)
+  {
+    disk_buffer_pool_->unlatch_page(&page_handle);
+    // 状态没有变化时不需要写回
+    if (changed)
+    {
+      disk_buffer_pool_->mark_dirty(&page_handle);
+    }
+    disk_buffer_pool_->unpin_page(&page_handle);
+  }
+  return RC::SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+RecordFileHandler::RecordFileHandler() : disk_buffer_pool_(nullptr),
+                                         file_id_(-1)
+{
+}
+
+RC RecordFileHandler::init(DiskBufferPool &buffer_pool, int file_id, bool variable_length)
+{
+  return init_format(buffer_pool, file_id, variable_length, std::vector<int>());
+}
+
+RC RecordFileHandler::init(DiskBufferPool &buffer_pool, int file_id, const std::vector<int> &pax_columns)
+{
+  return init_format(buffer_pool, file_id, false, pax_columns);
+}
+
+RC RecordFileHandler::init_format(DiskBufferPool &buffer_pool, int file_id, bool variable_length,
+                                  const std::vector<int> &pax_columns)
+{
+  RC ret = RC::SUCCESS;
+
+  if (disk_buffer_pool_ != nullptr)
+  {
+    LOG_ERROR("%d has been openned.", file_id);
+    return RC::RECORD_OPENNED;
+  }
+
+  if ((ret = free_space_map_.init(buffer_pool, file_id, variable_length, pax_columns)) != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to init free space map of %d. ret=%d:%s", file_id, ret, strrc(ret));
+    return ret;
+  }
+
+  disk_buffer_pool_ = &buffer_pool;
+  file_id_ = file_id;
+
+  LOG_TRACE("Successfully open %d.", file_id);
+  return ret;
+}
+
+void RecordFileHandler::close()
+{
+  if (disk_buffer_pool_ != nullptr)
+  {
+    free_space_map_.close();
+    disk_buffer_pool_ = nullptr;
+  }
+}
+
+RC RecordFileHandler::prepare_insert_page(int record_size, PageNum page_limit)
+{
+  RC ret = RC::SUCCESS;
+  // 从空闲空间表中找到没有填满的页面
+  PageNum current_page_num = BP_INVALID_PAGE_NUM;
+  bool page_found = false;
+  while ((ret = free_space_map_.find_free_page(&current_page_num)) == RC::SUCCESS)
+  {
+    // 空闲空间表总是返回页号最小的空闲页面
+    if (page_limit != BP_INVALID_PAGE_NUM && current_page_num >= page_limit)
+    {
+      break;
+    }
+    if (current_page_num != record_page_handler_.get_page_num())
+    {
+      record_page_handler_.deinit();
+      ret = record_page_handler_.init(*disk_buffer_pool_, file_id_, current_page_num);
+      if (ret != RC::SUCCESS && ret != RC::BUFFERPOOL_INVALID_PAGE_NUM)
+      {
+        LOG_ERROR("Failed to init record page handler. page number is %d. ret=%d:%s", current_page_num, ret, strrc(ret));
+        return ret;
+      }
+    }
+
+    if (ret == RC::SUCCESS && !record_page_handler_.is_overflow() && !record_page_handler_.is_full())
+    {
+      page_found = true;
+      break;
+    }
+    // 页面已经被释放、重新分配成了溢出页或者已经满了，空闲空间表中的信息过期了
+    if ((ret = free_space_map_.set_free(current_page_num, false)) != RC::SUCCESS)
+    {
+      return ret;
+    }
+  }
+  if (ret != RC::SUCCESS && ret != RC::RECORD_EOF)
+  {
+    LOG_ERROR("Failed to find free page while inserting record. ret=%d:%s", ret, strrc(ret));
+    return ret;
+  }
+
+  if (!page_found && page_limit != BP_INVALID_PAGE_NUM)
+  {
+    return RC::RECORD_NOMEM;
+  }
+
+  // 找不到就分配一个新的页面
+  if (!page_found)
+  {
+    BPPageHandle page_handle;
+    if ((ret = disk_buffer_pool_->allocate_page(file_id_, &page_handle)) != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate page while inserting record. file_it:%d, ret:%d",
+                file_id_, ret);
+      return ret;
+    }
+
+    current_page_num = page_handle.frame->page->page_num;
+    record_page_handler_.deinit();
+    if (pax())
+    {
+      ret = record_page_handler_.init_empty_pax_page(*disk_buffer_pool_, file_id_, current_page_num,
+                                                     free_space_map_.pax_columns());
+    }
+    else
+    {
+      ret = record_page_handler_.init_empty_page(*disk_buffer_pool_, file_id_, current_page_num, record_size);
+    }
+    if (ret != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to init empty page. file_id:%d, ret:%d", file_id_, ret);
+      if (RC::SUCCESS != disk_buffer_pool_->unpin_page(&page_handle))
+      {
+        LOG_ERROR("Failed to unpin page. file_id:%d", file_id_);
+      }
+      return ret;
+    }
+    if (RC::SUCCESS != disk_buffer_pool_->unpin_page(&page_handle))
+    {
+      LOG_ERROR("Failed to unpin page. file_id:%d", file_id_);
+    }
+    if ((ret = free_space_map_.set_free(current_page_num, true)) != RC::SUCCESS)
+    {
+      return ret;
+    }
+  }
+
+  return RC::SUCCESS;
+}
+
+RC RecordFileHandler::insert_record(const char *data, int record_size, RID *rid)
+{
+  if (variable_length())
+  {
+    return insert_var_record(data, record_size, rid);
+  }
+
+  RC ret = prepare_insert_page(record_size);
+  if (ret != RC::SUCCESS)
+  {
+    return ret;
+  }
+
+  // 找到空闲位置
+  ret = record_page_handler_.insert_record(data, rid);
+  if (ret == RC::SUCCESS && record_page_handler_.is_full())
+  {
+    ret = free_space_map_.set_free(record_page_handler_.get_page_num(), false);
+  }
+  return ret;
+}
+
+RC RecordFileHandler::insert_records(const char *const *rows, int n, int record_size, RID *rids)
+{
+  RC ret = RC::SUCCESS;
+  int done = 0;
+  while (done < n && ret == RC::SUCCESS)
+  {
+    if ((ret = prepare_insert_page(record_size)) != RC::SUCCESS)
     {
-      continue;
+      break;
     }
-    if (current_page_num != record_page_handler_.get_page_num())
+
+    int inserted = 0;
+    ret = record_page_handler_.insert_records(rows + done, n - done, rids + done, &inserted);
+    done += inserted;
+    if (ret == RC::SUCCESS && record_page_handler_.is_full())
     {
-      record_page_handler_.deinit();
-      ret = record_page_handler_.init(*disk_buffer_pool_, file_id_, current_page_num);
-      if (ret != RC::SUCCESS && ret != RC::BUFFERPOOL_INVALID_PAGE_NUM)
+      ret = free_space_map_.set_free(record_page_handler_.get_page_num(), false);
+    }
+  }
+
+  if (ret != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to insert records, rollback %d inserted records. ret=%d:%s", done, ret, strrc(ret));
+    for (int i = 0; i < done; i++)
+    {
+      RC rc = delete_record(&rids[i]);
+      if (rc != RC::SUCCESS)
       {
-        LOG_ERROR("Failed to init record page handler. page number is %d. ret=%d:%s", current_page_num, ret, strrc(ret));
-        return ret;
+        LOG_PANIC("Failed to rollback record. page num=%d, slot num=%d, rc=%d:%s",
+                  rids[i].page_num, rids[i].slot_num, rc, strrc(rc));
       }
     }
+  }
+  return ret;
+}
 
-    if (!record_page_handler_.is_full())
+RC RecordFileHandler::insert_var_record(const char *data, int len, RID *rid)
+{
+  // 超过页面内限制的记录，前面的部分留在页面内，剩下的部分写到溢出页中
+  const int max_inline_size = RecordPageHandler::max_inline_record_size(disk_buffer_pool_->page_data_size());
+  std::vector<char> inline_data;
+  bool overflow = len > max_inline_size;
+  if (overflow)
+  {
+    const int prefix_len = max_inline_size - (int)sizeof(OverflowStub);
+    OverflowStub stub;
+    stub.total_len = len;
+    RC ret = write_overflow_pages(*disk_buffer_pool_, file_id_, data + prefix_len, len - prefix_len, &stub.first_page);
+    if (ret != RC::SUCCESS)
     {
-      page_found = true;
-      break;
+      return ret;
     }
+    inline_data.resize(max_inline_size);
+    memcpy(inline_data.data(), data, prefix_len);
+    memcpy(inline_data.data() + prefix_len, &stub, sizeof(stub));
+    data = inline_data.data();
+    len = max_inline_size;
   }
 
-  // 找不到就分配一个新的页面
-  if (!page_found)
+  RC ret = prepare_insert_page(0);
+  if (ret == RC::SUCCESS)
   {
-    BPPageHandle page_handle;
-    if ((ret = disk_buffer_pool_->allocate_page(file_id_, &page_handle)) != RC::SUCCESS)
+    ret = record_page_handler_.insert_record(data, len, overflow, rid);
+  }
+  if (ret == RC::SUCCESS && record_page_handler_.is_full())
+  {
+    ret = free_space_map_.set_free(record_page_handler_.get_page_num(), false);
+  }
+  else if (ret != RC::SUCCESS && overflow)
+  {
+    free_overflow_pages(*disk_buffer_pool_, file_id_, overflow_first_page(data, len));
+  }
+  return ret;
+}
+
+RC RecordFileHandler::insert_records(const char *const *rows, const int *lengths, int n, RID *rids)
+{
+  RC ret = RC::SUCCESS;
+  int done = 0;
+  for (; done < n; done++)
+  {
+    if ((ret = insert_var_record(rows[done], lengths[done], &rids[done])) != RC::SUCCESS)
     {
-      LOG_ERROR("Failed to allocate page while inserting record. file_it:%d, ret:%d",
-                file_id_, ret);
-      return ret;
+      break;
     }
+  }
 
-    current_page_num = page_handle.frame->page.page_num;
-    record_page_handler_.deinit();
-    ret = record_page_handler_.init_empty_page(*disk_buffer_pool_, file_id_, current_page_num, record_size);
-    if (ret != RC::SUCCESS)
+  if (ret != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to insert records, rollback %d inserted records. ret=%d:%s", done, ret, strrc(ret));
+    for (int i = 0; i < done; i++)
     {
-      LOG_ERROR("Failed to init empty page. file_id:%d, ret:%d", file_id_, ret);
-      if (RC::SUCCESS != disk_buffer_pool_->unpin_page(&page_handle))
+      RC rc = delete_record(&rids[i]);
+      if (rc != RC::SUCCESS)
       {
-        LOG_ERROR("Failed to unpin page. file_id:%d", file_id_);
+        LOG_PANIC("Failed to rollback record. page num=%d, slot num=%d, rc=%d:%s",
+                  rids[i].page_num, rids[i].slot_num, rc, strrc(rc));
       }
+    }
+  }
+  return ret;
+}
+
+RC RecordFileHandler::update_record(const RID *rid, const char *data, int len)
+{
+  RecordPageHandler page_handler;
+  RC ret = page_handler.init(*disk_buffer_pool_, file_id_, rid->page_num);
+  if (ret != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to init record page handler.page number=%d, file_id=%d", rid->page_num, file_id_);
+    return ret;
+  }
+
+  Record old_record;
+  int old_len = 0;
+  bool old_overflow = false;
+  if ((ret = page_handler.get_record(rid, &old_record, &old_len, &old_overflow)) != RC::SUCCESS)
+  {
+    return ret;
+  }
+  const PageNum old_first_page = old_overflow ? overflow_first_page(old_record.data, old_len) : BP_INVALID_PAGE_NUM;
+
+  const int max_inline_size = RecordPageHandler::max_inline_record_size(disk_buffer_pool_->page_data_size());
+  ret = len <= max_inline_size ? page_handler.update_record(rid, data, len, false) : RC::RECORD_NOMEM;
+  if (ret == RC::RECORD_NOMEM)
+  {
+    // 页面里放不下新的记录时改成溢出记录，在页面内至少可以保留VAR_MIN_RECORD_SPACE个字节
+    int prefix_len = std::min(len, max_inline_size) - (int)sizeof(OverflowStub);
+    if (page_handler.free_space() + std::max(old_len, VAR_MIN_RECORD_SPACE) < prefix_len + (int)sizeof(OverflowStub))
+    {
+      prefix_len = std::min(len, VAR_MIN_RECORD_SPACE - (int)sizeof(OverflowStub));
+    }
+    OverflowStub stub;
+    stub.total_len = len;
+    ret = write_overflow_pages(*disk_buffer_pool_, file_id_, data + prefix_len, len - prefix_len, &stub.first_page);
+    if (ret != RC::SUCCESS)
+    {
       return ret;
     }
-    if (RC::SUCCESS != disk_buffer_pool_->unpin_page(&page_handle))
+    std::vector<char> inline_data(prefix_len + sizeof(OverflowStub));
+    memcpy(inline_data.data(), data, prefix_len);
+    memcpy(inline_data.data() + prefix_len, &stub, sizeof(stub));
+    ret = page_handler.update_record(rid, inline_data.data(), (int)inline_data.size(), true);
+    if (ret != RC::SUCCESS)
     {
-      LOG_ERROR("Failed to unpin page. file_id:%d", file_id_);
+      LOG_ERROR("Failed to update overflow record. page num=%d, slot num=%d, ret=%d:%s",
+                rid->page_num, rid->slot_num, ret, strrc(ret));
+      free_overflow_pages(*disk_buffer_pool_, file_id_, stub.first_page);
+      return ret;
     }
   }
-
-  // 找到空闲位置
-  return record_page_handler_.insert_record(data, rid);
+  if (ret == RC::SUCCESS && old_first_page != BP_INVALID_PAGE_NUM)
+  {
+    ret = free_overflow_pages(*disk_buffer_pool_, file_id_, old_first_page);
+  }
+  if (ret == RC::SUCCESS)
+  {
+    // 记录变短之后页面可能又有空闲空间了
+    ret = free_space_map_.set_free(rid->page_num, !page_handler.is_full());
+  }
+  return ret;
 }
 
 RC RecordFileHandler::update_record(const Record *rec)
@@ -503,7 +1712,151 @@ RC RecordFileHandler::delete_record(const RID *rid)
               rid->page_num, file_id_);
     return ret;
   }
-  return page_handler.delete_record(rid);
+  Record record;
+  int len = 0;
+  bool overflow = false;
+  PageNum overflow_page = BP_INVALID_PAGE_NUM;
+  if (page_handler.is_variable() && page_handler.get_record(rid, &record, &len, &overflow) == RC::SUCCESS && overflow)
+  {
+    overflow_page = overflow_first_page(record.data, len);
+  }
+  ret = page_handler.delete_record(rid);
+  if (ret == RC::SUCCESS && overflow_page != BP_INVALID_PAGE_NUM)
+  {
+    ret = free_overflow_pages(*disk_buffer_pool_, file_id_, overflow_page);
+  }
+  if (ret == RC::SUCCESS)
+  {
+    // 最后一条记录被删除时页面会被释放，插入时发现页面不存在会再清除这个标记
+    // 变长记录页面删除一条记录之后不一定能放下最长的记录，插入时会再检查
+    ret = free_space_map_.set_free(rid->page_num, true);
+  }
+  return ret;
+}
+
+RC RecordFileHandler::find_sparse_page(PageNum before, int used_percent, PageNum *page_num)
+{
+  int page_count = 0;
+  RC ret = disk_buffer_pool_->get_page_count(file_id_, &page_count);
+  if (ret != RC::SUCCESS)
+  {
+    return ret;
+  }
+  if (before == BP_INVALID_PAGE_NUM || before > page_count)
+  {
+    before = page_count;
+  }
+
+  // 第0页是文件头，第1页通常是空闲空间表
+  for (PageNum current = before - 1; current >= 1; current--)
+  {
+    if (!disk_buffer_pool_->is_page_allocated(file_id_, current))
+    {
+      continue;
+    }
+    RecordPageHandler page_handler;
+    ret = page_handler.init(*disk_buffer_pool_, file_id_, current);
+    if (ret != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to init record page handler. page number=%d, file_id=%d", current, file_id_);
+      return ret;
+    }
+    if (!page_handler.is_free_space_map() && !page_handler.is_overflow() && page_handler.used_percent() < used_percent)
+    {
+      *page_num = current;
+      return RC::SUCCESS;
+    }
+  }
+  return RC::RECORD_EOF;
+}
+
+static RC collect_rid(Record *record, void *context)
+{
+  ((std::vector<RID> *)context)->push_back(record->rid);
+  return RC::SUCCESS;
+}
+
+RC RecordFileHandler::get_page_rids(PageNum page_num, std::vector<RID> &rids)
+{
+  RecordPageHandler page_handler;
+  RC ret = page_handler.init(*disk_buffer_pool_, file_id_, page_num);
+  if (ret != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to init record page handler. page number=%d, file_id=%d", page_num, file_id_);
+    return ret;
+  }
+  return page_handler.visit_records(collect_rid, &rids);
+}
+
+RC RecordFileHandler::move_record(const RID *rid, RID *new_rid)
+{
+  RecordPageHandler page_handler;
+  RC ret = page_handler.init(*disk_buffer_pool_, file_id_, rid->page_num);
+  if (ret != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to init record page handler. page number=%d, file_id=%d", rid->page_num, file_id_);
+    return ret;
+  }
+
+  Record record;
+  int len = 0;
+  bool overflow = false;
+  if ((ret = page_handler.get_record(rid, &record, &len, &overflow)) != RC::SUCCESS)
+  {
+    return ret;
+  }
+  const bool variable = page_handler.is_variable();
+  std::vector<char> data(record.data, record.data + len);
+
+  if ((ret = prepare_insert_page(variable ? 0 : len, rid->page_num)) != RC::SUCCESS)
+  {
+    return ret;
+  }
+  ret = variable ? record_page_handler_.insert_record(data.data(), len, overflow, new_rid)
+                 : record_page_handler_.insert_record(data.data(), new_rid);
+  if (ret == RC::SUCCESS && record_page_handler_.is_full())
+  {
+    ret = free_space_map_.set_free(record_page_handler_.get_page_num(), false);
+  }
+  if (ret != RC::SUCCESS)
+  {
+    return ret;
+  }
+
+  // 溢出页已经属于新的记录，这里只删除页面内的部分
+  if ((ret = page_handler.delete_record(rid)) != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to delete moved record. page num=%d, slot num=%d, ret=%d:%s",
+              rid->page_num, rid->slot_num, ret, strrc(ret));
+    return ret;
+  }
+  return free_space_map_.set_free(rid->page_num, true);
+}
+
+RC RecordFileHandler::dispose_empty_page(PageNum page_num)
+{
+  std::vector<RID> rids;
+  RC ret = get_page_rids(page_num, rids);
+  if (ret != RC::SUCCESS)
+  {
+    return ret;
+  }
+  if (!rids.empty())
+  {
+    return RC::RECORD_INVALID_KEY;
+  }
+
+  // 插入时缓存的页面也要放开，否则无法释放
+  if (record_page_handler_.get_page_num() == page_num)
+  {
+    record_page_handler_.deinit();
+  }
+  if ((ret = disk_buffer_pool_->dispose_page(file_id_, page_num)) != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to dispose empty page %d of file %d. ret=%d:%s", page_num, file_id_, ret, strrc(ret));
+    return ret;
+  }
+  return free_space_map_.set_free(page_num, false);
 }
 
 RC RecordFileHandler::get_record(const RID *rid, Record *rec)
@@ -522,7 +1875,71 @@ RC RecordFileHandler::get_record(const RID *rid, Record *rec)
               rid->page_num, file_id_);
     return ret;
   }
-  return page_handler.get_record(rid, rec);
+  int len = 0;
+  bool overflow = false;
+  ret = page_handler.get_record(rid, rec, &len, &overflow);
+  if (ret == RC::SUCCESS && page_handler.is_pax())
+  {
+    // 拼接出来的记录属于page_handler，返回之前复制一份
+    static thread_local std::vector<char> pax_record;
+    pax_record.assign(rec->data, rec->data + len);
+    rec->data = pax_record.data();
+  }
+  return ret;
+}
+
+RC RecordFileHandler::get_record(const RID *rid, std::vector<char> &data)
+{
+  RecordPageHandler page_handler;
+  return get_record(rid, data, page_handler);
+}
+
+/**
+ * cursor固定的页面不是rid所在的页面时换成这个页面
+ */
+static RC move_cursor(DiskBufferPool &buffer_pool, int file_id, const RID *rid, RecordPageHandler &cursor)
+{
+  if (cursor.get_page_num() == rid->page_num)
+  {
+    return RC::SUCCESS;
+  }
+  cursor.deinit();
+  RC ret = cursor.init(buffer_pool, file_id, rid->page_num);
+  if (ret != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to init record page handler.page number=%d, file_id:%d", rid->page_num, file_id);
+  }
+  return ret;
+}
+
+RC RecordFileHandler::get_record(const RID *rid, Record *rec, RecordPageHandler &cursor)
+{
+  RC ret = move_cursor(*disk_buffer_pool_, file_id_, rid, cursor);
+  if (ret != RC::SUCCESS)
+  {
+    return ret;
+  }
+  int len = 0;
+  bool overflow = false;
+  return cursor.get_record(rid, rec, &len, &overflow);
+}
+
+RC RecordFileHandler::get_record(const RID *rid, std::vector<char> &data, RecordPageHandler &cursor)
+{
+  RC ret = move_cursor(*disk_buffer_pool_, file_id_, rid, cursor);
+  if (ret != RC::SUCCESS)
+  {
+    return ret;
+  }
+
+  Record record;
+  int len = 0;
+  bool overflow = false;
+  if ((ret = cursor.get_record(rid, &record, &len, &overflow)) != RC::SUCCESS)
+  {
+    return ret;
+  }
+  return read_var_record(*disk_buffer_pool_, file_id_, record.data, len, overflow, data);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -539,6 +1956,7 @@ RC RecordFileScanner::open_scan(DiskBufferPool &buffer_pool, int file_id, Condit
 
   disk_buffer_pool_ = &buffer_pool;
   file_id_ = file_id;
+  next_page_num_ = 1;
 
   condition_filter_ = condition_filter;
   return RC::SUCCESS;
@@ -567,6 +1985,92 @@ RC RecordFileScanner::get_first_record(Record *rec)
   return get_next_record(rec);
 }
 
+RC RecordFileScanner::visit_records(RC (*visitor)(Record *record, void *context), void *context)
+{
+  next_page_num_ = 1;
+  RC rc = RC::SUCCESS;
+  while (RC::SUCCESS == rc)
+  {
+    rc = visit_next_page(visitor, context);
+  }
+  // 页面都访问完了才算成功，visitor返回的RECORD_EOF原样返回
+  if (RC::RECORD_EOF == rc && BP_INVALID_PAGE_NUM == next_page_num_)
+  {
+    rc = RC::SUCCESS;
+  }
+  return rc;
+}
+
+RC RecordFileScanner::visit_next_page(RC (*visitor)(Record *record, void *context), void *context)
+{
+  if (nullptr == disk_buffer_pool_)
+  {
+    LOG_ERROR("Scanner has been closed.");
+    return RC::RECORD_CLOSED;
+  }
+  if (BP_INVALID_PAGE_NUM == next_page_num_)
+  {
+    return RC::RECORD_EOF;
+  }
+
+  int page_count = 0;
+  RC rc = disk_buffer_pool_->get_page_count(file_id_, &page_count);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to get page count while visiting records. file id=%d", file_id_);
+    return rc;
+  }
+
+  while (true)
+  {
+    PageNum end_page_num = page_count;
+    if (morsels_ != nullptr)
+    {
+      if (next_page_num_ >= morsel_end_ && !morsels_->next(page_count, next_page_num_, morsel_end_))
+      {
+        break;
+      }
+      end_page_num = std::min(morsel_end_, page_count);
+    }
+    for (; next_page_num_ < end_page_num; next_page_num_++)
+    {
+      PageNum page_num = next_page_num_;
+      record_page_handler_.deinit();
+      if (page_filter_ != nullptr && !page_filter_(page_num, page_filter_context_))
+      {
+        continue;
+      }
+      rc = record_page_handler_.init(*disk_buffer_pool_, file_id_, page_num);
+      if (RC::BUFFERPOOL_INVALID_PAGE_NUM == rc)
+      {
+        continue;
+      }
+      if (rc != RC::SUCCESS)
+      {
+        LOG_ERROR("Failed to init record page handler. page num=%d", page_num);
+        return rc;
+      }
+      if (record_page_handler_.is_free_space_map() || record_page_handler_.is_overflow())
+      {
+        continue;
+      }
+      next_page_num_++;
+      rc = record_page_handler_.visit_records(visitor, context, project_ ? &columns_ : nullptr, condition_filter_);
+      record_page_handler_.deinit();
+      return rc;
+    }
+    if (nullptr == morsels_)
+    {
+      break;
+    }
+    // 文件在扫描过程中变短时当前这段剩下的页面也不再访问
+    next_page_num_ = morsel_end_;
+  }
+  record_page_handler_.deinit();
+  next_page_num_ = BP_INVALID_PAGE_NUM;
+  return RC::RECORD_EOF;
+}
+
 RC RecordFileScanner::get_next_record(Record *rec)
 {
   if (nullptr == disk_buffer_pool_)
@@ -603,8 +2107,11 @@ RC RecordFileScanner::get_next_record(Record *rec)
         return ret;
       }
 
-      if (RC::BUFFERPOOL_INVALID_PAGE_NUM == ret)
+      if (RC::BUFFERPOOL_INVALID_PAGE_NUM == ret || record_page_handler_.is_free_space_map() ||
+          record_page_handler_.is_overflow())
       {
+        // 跳过的页面是最后一页时不能把init的结果当作找到了记录
+        ret = RC::RECORD_EOF;
         current_record.rid.page_num++;
         current_record.rid.slot_num = -1;
         continue;
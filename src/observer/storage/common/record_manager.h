@@ -14,6 +14,10 @@ See the Mulan PSL v2 for more details. */
 #ifndef __OBSERVER_STORAGE_COMMON_RECORD_MANAGER_H_
 #define __OBSERVER_STORAGE_COMMON_RECORD_MANAGER_H_
 
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
 #include "storage/default/disk_buffer_pool.h"
 
 typedef int SlotNum;
@@ -29,6 +33,12 @@ struct RID
   bool operator== (const RID &other) const {
     return page_num == other.page_num && slot_num == other.slot_num;
   }
+  /**
+   * 按页面、页面内的位置排序，按这个顺序读取记录时每个页面只访问一次，页面也是按文件中的顺序访问的
+   */
+  bool operator< (const RID &other) const {
+    return page_num < other.page_num || (page_num == other.page_num && slot_num < other.slot_num);
+  }
 };
 
 class RidDigest {
@@ -51,11 +61,35 @@ public:
   ~RecordPageHandler();
   RC init(DiskBufferPool &buffer_pool, int file_id, PageNum page_num);
   RC init_empty_page(DiskBufferPool &buffer_pool, int file_id, PageNum page_num, int record_size);
+  /**
+   * 初始化一个PAX格式的空页面，columns是每一列的长度，一条记录由所有的列依次拼接而成
+   */
+  RC init_empty_pax_page(DiskBufferPool &buffer_pool, int file_id, PageNum page_num, const std::vector<int> &columns);
   RC deinit();
 
   RC insert_record(const char *data, RID *rid);
+  /**
+   * 在当前页面中插入最多n条记录，直到页面填满，页面只加一次锁、标记一次脏页。
+   * inserted返回实际插入的记录数，rids可以为nullptr。页面已经满了时返回RECORD_NOMEM
+   */
+  RC insert_records(const char *const *rows, int n, RID *rids, int *inserted);
   RC update_record(const Record *rec);
 
+  /**
+   * 变长记录页面插入一条长度为len的记录，overflow表示data是溢出记录在页面内的部分。
+   * 页面剩余空间不够时返回RECORD_NOMEM
+   */
+  RC insert_record(const char *data, int len, bool overflow, RID *rid);
+  /**
+   * 变长记录页面更新一条记录，变长之后可能在页面内移动位置，rid不变。
+   * 页面剩余空间不够时返回RECORD_NOMEM，原来的记录不变
+   */
+  RC update_record(const RID *rid, const char *data, int len, bool overflow);
+  /**
+   * 和get_record相同，另外返回变长记录在页面内的长度和是否有溢出页
+   */
+  RC get_record(const RID *rid, Record *rec, int *len, bool *overflow);
+
   template <class RecordUpdater>
   RC update_record_in_place(const RID *rid, RecordUpdater updater) {
     Record record;
@@ -63,7 +97,13 @@ public:
     if (rc != RC::SUCCESS) {
       return rc;
     }
+    disk_buffer_pool_->latch_page(&page_handle_, true);
     rc = updater(record);
+    if (pax_) {
+      // PAX页面上拿到的是拼接出来的副本，需要写回各个列
+      pax_write(rid->slot_num, record.data);
+    }
+    disk_buffer_pool_->unlatch_page(&page_handle_);
     disk_buffer_pool_->mark_dirty(&page_handle_);
     return rc;
   }
@@ -74,24 +114,174 @@ public:
   RC get_first_record(Record *rec);
   RC get_next_record(Record *rec);
 
+  /**
+   * 依次访问页面上的所有记录，record的data直接指向页面中的数据，不复制记录。
+   * 开始时在页面读锁下复制一份slot bitmap，调用visitor时不持有页面锁，visitor可以修改或删除记录。
+   * 有溢出页的变长记录会拼接成完整的记录，data只在visitor调用期间有效。
+   * visitor返回非SUCCESS时停止访问并返回该值。
+   * PAX页面上的记录拼接到临时的缓存中，columns不为nullptr时只读取其中的列，其它列的内容不确定。
+   * filter不为nullptr时只访问满足条件的记录，行格式的页面上用filter_page一次过滤所有的记录
+   */
+  RC visit_records(RC (*visitor)(Record *record, void *context), void *context,
+                   const std::vector<int> *columns = nullptr, const ConditionFilter *filter = nullptr);
+
   PageNum get_page_num() const;
 
   bool is_full() const;
 
+  /**
+   * 当前页面是不是空闲空间表页，扫描记录时需要跳过
+   */
+  bool is_free_space_map() const;
+
+  /**
+   * 当前页面是不是变长记录的溢出页，扫描记录时需要跳过
+   */
+  bool is_overflow() const;
+
+  /**
+   * 当前页面是不是变长记录页面，变长记录页面的header中record_size为0
+   */
+  bool is_variable() const;
+
+  /**
+   * 当前页面是不是PAX格式的页面，同一列的数据连续存放在一起，record_size是负的列数
+   */
+  bool is_pax() const
+  {
+    return pax_;
+  }
+
+  /**
+   * 变长记录页面可以使用的空间，包括删除或缩短记录留下的碎片
+   */
+  int free_space() const;
+
+  /**
+   * 记录占用的空间在页面中的百分比，定长记录按slot计算，变长记录按字节计算
+   */
+  int used_percent() const;
+
+  /**
+   * 变长记录文件中页面内可以存放的最长记录，更长的记录超出的部分放到溢出页中
+   */
+  static int max_inline_record_size(int page_data_size);
+
+private:
+  RC get_var_record(SlotNum slot_num, Record *rec);
+  RC delete_var_record(const RID *rid);
+  void compact();
+  char *pax_read(SlotNum slot_num, const std::vector<int> *columns);
+  void pax_write(SlotNum slot_num, const char *data);
+
 private:
   DiskBufferPool * disk_buffer_pool_;
   int              file_id_;
   BPPageHandle     page_handle_;
   PageHeader    *  page_header_;
   char *           bitmap_;
+  std::vector<char> overflow_buffer_;  // 扫描时拼接有溢出页的记录
+  bool             pax_;
+  std::vector<int> pax_offsets_;       // PAX页面每一列在记录中的偏移，最后一项是记录的长度
+  std::vector<char> pax_row_;          // 从PAX页面中拼接出来的记录
+};
+
+/**
+ * 记录文件的空闲空间表(FSM)，每个页面一个bit，1表示页面中还有空闲的slot，
+ * 插入记录时不需要逐个打开页面查找。
+ * 新建的文件把第1页作为空闲空间表页，一个页面的bitmap可以覆盖文件能分配的所有页面。
+ * 旧版本的文件第1页是记录页，打开时扫描一遍所有页面，在内存中建立空闲空间表
+ */
+class RecordFreeSpaceMap {
+public:
+  RecordFreeSpaceMap();
+  ~RecordFreeSpaceMap();
+
+  /**
+   * variable_length和pax_columns只在新文件创建空闲空间表时使用，已有的文件从空闲空间表页中读取记录格式。
+   * pax_columns不为空时使用PAX格式
+   */
+  RC init(DiskBufferPool &buffer_pool, int file_id, bool variable_length = false,
+          const std::vector<int> &pax_columns = std::vector<int>());
+  void close();
+
+  /**
+   * 找一个还有空闲slot的页面，没有时返回RECORD_EOF
+   */
+  RC find_free_page(PageNum *page_num);
+  RC set_free(PageNum page_num, bool free);
+
+  /**
+   * 空闲空间表持久化在文件中时返回它的页号，旧版本的文件返回BP_INVALID_PAGE_NUM
+   */
+  PageNum page_num() const
+  {
+    return page_num_;
+  }
+
+  static bool is_free_space_map_page(const char *data);
+
+  bool variable_length() const
+  {
+    return variable_length_;
+  }
+
+  /**
+   * PAX格式的文件中每一列的长度，其它格式的文件为空
+   */
+  const std::vector<int> &pax_columns() const
+  {
+    return pax_columns_;
+  }
+
+private:
+  RC format_page(bool variable_length, const std::vector<int> &pax_columns);
+  RC build_in_memory();
+
+private:
+  DiskBufferPool *    disk_buffer_pool_;
+  int                 file_id_;
+  PageNum             page_num_;
+  int                 capacity_;                   // bitmap能记录的页面数
+  PageNum             hint_;                       // 比hint_小的页面都没有空闲空间
+  std::vector<char>   memory_bitmap_;              // 旧版本的文件在内存中的空闲空间表
+  bool                variable_length_;
+  std::vector<int>    pax_columns_;
+  int                 bits_offset_;                // bitmap在空闲空间表页中的偏移，PAX文件在header之后保存列的长度
+  pthread_mutex_t     mutex_;
 };
 
+/**
+ * 记录文件有三种格式，创建文件时决定，记录在空闲空间表页中：
+ * 1. 定长记录，每个页面上的记录长度相同，用bitmap记录slot是否被使用
+ * 2. 变长记录，页面头之后是slot目录，记录从页尾向前存放。记录超过页面的1/4时，
+ *    开头的部分留在页面内，剩下的部分放在溢出页链中。溢出页不会被扫描，随记录一起删除
+ * 3. PAX，定长记录按列拆开存放，页面内每一列的数据连续存放(minipage)，只读取部分列时访问的内存更少。
+ *    读取到的记录是拼接出来的副本，修改之后需要用update_record写回
+ */
 class RecordFileHandler {
 public:
   RecordFileHandler();
-  RC init(DiskBufferPool &buffer_pool, int file_id);
+  /**
+   * @param variable_length 新文件是否使用变长记录格式，打开已有的文件时忽略
+   */
+  RC init(DiskBufferPool &buffer_pool, int file_id, bool variable_length = false);
+  /**
+   * 新文件使用PAX格式，pax_columns是每一列的长度。打开已有的文件时忽略
+   */
+  RC init(DiskBufferPool &buffer_pool, int file_id, const std::vector<int> &pax_columns);
   void close();
 
+  bool variable_length() const
+  {
+    return free_space_map_.variable_length();
+  }
+
+  bool pax() const
+  {
+    return !free_space_map_.pax_columns().empty();
+  }
+
   /**
    * 更新指定文件中的记录，rec指向的记录结构中的rid字段为要更新的记录的标识符，
    * pData字段指向新的记录内容
@@ -100,6 +290,11 @@ public:
    */
   RC update_record(const Record *rec);
 
+  /**
+   * 更新变长记录文件中的记录，rid不变
+   */
+  RC update_record(const RID *rid, const char *data, int len);
+
   /**
    * 从指定文件中删除标识符为rid的记录
    * @param rid
@@ -116,13 +311,39 @@ public:
   RC insert_record(const char *data, int record_size, RID *rid);
 
   /**
-   * 获取指定文件中标识符为rid的记录内容到rec指向的记录结构中
+   * 批量插入n条记录，一个页面填满之后再换下一个页面。
+   * 任何一条插入失败时已经插入的记录都会被删除
+   */
+  RC insert_records(const char *const *rows, int n, int record_size, RID *rids);
+
+  /**
+   * 变长记录文件的批量插入，第i条记录的长度为lengths[i]
+   */
+  RC insert_records(const char *const *rows, const int *lengths, int n, RID *rids);
+
+  /**
+   * 获取指定文件中标识符为rid的记录内容到rec指向的记录结构中。
+   * PAX文件中的记录拼接到线程自己的缓存中，下一次在同一个线程中调用之前有效
    * @param rid
    * @param rec
    * @return
    */
   RC get_record(const RID *rid, Record *rec);
 
+  /**
+   * 复制一份完整的记录到data中。变长记录文件中有溢出页的记录只能用这个接口读取，
+   * get_record只能拿到页面内的部分
+   */
+  RC get_record(const RID *rid, std::vector<char> &data);
+  /**
+   * 连续读取多条记录时使用：cursor固定着上一次读取的页面，rid还在这个页面上时不再重新获取页面，
+   * 否则换成rid所在的页面，按rid的顺序读取时每个页面只获取一次。rec指向cursor中的页面，
+   * 下一次读取之前有效。用完之后调用cursor.deinit()放开页面，固定着的页面不能被释放，
+   * 所以读取的过程中不能删除记录
+   */
+  RC get_record(const RID *rid, Record *rec, RecordPageHandler &cursor);
+  RC get_record(const RID *rid, std::vector<char> &data, RecordPageHandler &cursor);
+
   template<class RecordUpdater> // 改成普通模式, 不使用模板
   RC update_record_in_place(const RID *rid, RecordUpdater updater) {
 
@@ -135,11 +356,71 @@ public:
     return page_handler.update_record_in_place(rid, updater);
   }
 
+  /**
+   * 从页号小于before的页面中从后往前找到一个稀疏的记录页，记录占用的空间不到used_percent%。
+   * 没有这样的页面时返回RECORD_EOF
+   */
+  RC find_sparse_page(PageNum before, int used_percent, PageNum *page_num);
+
+  /**
+   * 获取页面上所有记录的rid
+   */
+  RC get_page_rids(PageNum page_num, std::vector<RID> &rids);
+
+  /**
+   * 把记录移动到页号更小的、有空闲空间的页面中，new_rid返回新的位置。变长记录的溢出页不变，
+   * 只移动页面内的部分。最后一条记录移走之后页面会被释放。
+   * 前面的页面都放不下这条记录时返回RECORD_NOMEM，记录留在原来的位置
+   */
+  RC move_record(const RID *rid, RID *new_rid);
+
+  /**
+   * 释放没有任何记录的页面。删除最后一条记录时页面可能正被扫描固定住，没能及时释放
+   */
+  RC dispose_empty_page(PageNum page_num);
+
+private:
+  /**
+   * 让record_page_handler_指向一个还有空闲slot的页面，找不到时分配新页面。
+   * page_limit有效时只使用页号小于page_limit的页面，找不到时返回RECORD_NOMEM，不分配新页面
+   */
+  RC prepare_insert_page(int record_size, PageNum page_limit = BP_INVALID_PAGE_NUM);
+  RC insert_var_record(const char *data, int len, RID *rid);
+  RC init_format(DiskBufferPool &buffer_pool, int file_id, bool variable_length, const std::vector<int> &pax_columns);
+
 private:
   DiskBufferPool  *   disk_buffer_pool_;
   int                 file_id_;                    // 参考DiskBufferPool中的fileId
 
   RecordPageHandler   record_page_handler_;        // 目前只有insert record使用
+  RecordFreeSpaceMap  free_space_map_;
+};
+
+#define PAGE_MORSEL_SIZE 16  // 并行扫描时每次分配的页面数
+
+/**
+ * 多个RecordFileScanner并行扫描同一个文件时共享的页面分配器，每次分配连续PAGE_MORSEL_SIZE个页面。
+ * 扫描得快的线程自然会领到更多的页面
+ */
+class PageMorsels
+{
+public:
+  /**
+   * 分配下一段页面[begin, end)，页面都已经分配完时返回false。page_count是文件当前的页面数
+   */
+  bool next(int page_count, PageNum &begin, PageNum &end)
+  {
+    begin = next_page_num_.fetch_add(PAGE_MORSEL_SIZE);
+    if (begin >= page_count)
+    {
+      return false;
+    }
+    end = std::min(begin + PAGE_MORSEL_SIZE, page_count);
+    return true;
+  }
+
+private:
+  std::atomic<int> next_page_num_{1};  // 第0页是文件头
 };
 
 class RecordFileScanner 
@@ -179,12 +460,59 @@ public:
    */
   RC get_next_record(Record *rec);
 
+  /**
+   * 按页面访问所有满足扫描条件的记录，每个页面只固定一次。record的data直接指向页面中的数据，
+   * 只在visitor调用期间有效，需要保留的记录由visitor自己复制。
+   * visitor返回非SUCCESS时停止扫描并返回该值，扫描完所有页面返回SUCCESS
+   */
+  RC visit_records(RC (*visitor)(Record *record, void *context), void *context);
+
+  /**
+   * 和visit_records相同，但是每次只访问下一个需要读取的页面，可以分多次调用完成扫描。
+   * 没有更多页面时返回RECORD_EOF
+   */
+  RC visit_next_page(RC (*visitor)(Record *record, void *context), void *context);
+
+  /**
+   * 只读取部分列，只对PAX格式的页面有效，其它列的内容不确定。过滤条件用到的列也要包含在内
+   */
+  void set_columns(const std::vector<int> &columns)
+  {
+    columns_ = columns;
+    project_ = true;
+  }
+
+  /**
+   * 只访问从morsels中分配到的页面，其它页面由共享同一个morsels的扫描访问。在open_scan之后设置
+   */
+  void set_morsels(PageMorsels *morsels)
+  {
+    morsels_ = morsels;
+    morsel_end_ = 0;
+  }
+
+  /**
+   * visit_records时先用page_filter判断页面，返回false的页面不读取，直接跳过
+   */
+  void set_page_filter(bool (*page_filter)(PageNum page_num, void *context), void *context)
+  {
+    page_filter_ = page_filter;
+    page_filter_context_ = context;
+  }
+
 private:
   DiskBufferPool  *   disk_buffer_pool_;
   int                 file_id_;                    // 参考DiskBufferPool中的fileId
 
   ConditionFilter *   condition_filter_;
   RecordPageHandler   record_page_handler_;
+  std::vector<int>    columns_;
+  bool                project_ = false;
+  bool             (* page_filter_)(PageNum page_num, void *context) = nullptr;
+  void *              page_filter_context_ = nullptr;
+  PageNum             next_page_num_ = 1;          // visit_next_page下次开始查找的页面
+  PageMorsels *       morsels_ = nullptr;
+  PageNum             morsel_end_ = 0;             // 当前分配到的页面的结束位置
 };
 
 
@@ -0,0 +1,191 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Maintained count of committed records of a table.
+//
+
+#include "storage/common/row_count.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/log/log.h"
+
+void RowCount::init(const std::string &file)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  file_ = file;
+  count_ = file.empty() ? 0 : -1;
+  epoch_++;
+  pending_ = 0;
+  clean_on_disk_ = false;
+}
+
+RC RowCount::load()
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (file_.empty()) {
+    return RC::SUCCESS;
+  }
+  int fd = ::open(file_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG_INFO("Row count file %s can not be opened: %s", file_.c_str(), strerror(errno));
+    return errno == ENOENT ? RC::NOTFOUND : RC::IOERR_ACCESS;
+  }
+  RowCountFileHeader header;
+  const ssize_t n = ::read(fd, &header, sizeof(header));
+  ::close(fd);
+  if (n != (ssize_t)sizeof(header) || header.magic != ROW_COUNT_MAGIC || header.row_count < 0) {
+    LOG_WARN("Invalid row count file %s", file_.c_str());
+    return RC::CORRUPT;
+  }
+  if (!header.clean) {
+    LOG_INFO("Row count file %s was not saved completely", file_.c_str());
+    return RC::CORRUPT;
+  }
+  count_ = header.row_count;
+  epoch_++;
+  clean_on_disk_ = true;
+  return RC::SUCCESS;
+}
+
+RC RowCount::save()
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (file_.empty() || count_ < 0 || pending_ > 0) {
+    return RC::SUCCESS;
+  }
+
+  // 先写到临时文件再改名，写到一半时原来的文件仍然有效
+  std::string tmp_file = file_ + ".tmp";
+  int fd = ::open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IREAD | S_IWRITE);
+  if (fd < 0) {
+    LOG_ERROR("Failed to create row count file %s: %s", tmp_file.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  RowCountFileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = ROW_COUNT_MAGIC;
+  header.clean = 1;
+  header.row_count = count_;
+  RC rc = RC::SUCCESS;
+  if (::write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+    rc = RC::IOERR_WRITE;
+  } else if (::fsync(fd) != 0) {
+    rc = RC::IOERR_FSYNC;
+  }
+  ::close(fd);
+  if (rc == RC::SUCCESS && ::rename(tmp_file.c_str(), file_.c_str()) != 0) {
+    rc = RC::IOERR_WRITE;
+  }
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to save row count file %s. rc=%d:%s, error=%s", file_.c_str(), rc, strrc(rc), strerror(errno));
+    ::unlink(tmp_file.c_str());
+    return rc;
+  }
+  clean_on_disk_ = true;
+  return RC::SUCCESS;
+}
+
+void RowCount::clear()
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  count_ = -1;
+  epoch_++;
+  if (!file_.empty() && ::unlink(file_.c_str()) != 0 && errno != ENOENT) {
+    LOG_WARN("Failed to remove row count file %s: %s", file_.c_str(), strerror(errno));
+  }
+  clean_on_disk_ = false;
+}
+
+RC RowCount::reset()
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  RC rc = mark_dirty_locked();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  count_ = 0;
+  epoch_++;
+  return RC::SUCCESS;
+}
+
+RC RowCount::mark_dirty_locked()
+{
+  if (!clean_on_disk_) {
+    return RC::SUCCESS;
+  }
+  int fd = ::open(file_.c_str(), O_WRONLY);
+  if (fd < 0) {
+    LOG_ERROR("Failed to open row count file %s: %s", file_.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  int clean = 0;
+  RC rc = RC::SUCCESS;
+  if (::pwrite(fd, &clean, sizeof(clean), offsetof(RowCountFileHeader, clean)) != (ssize_t)sizeof(clean)) {
+    rc = RC::IOERR_WRITE;
+  } else if (::fdatasync(fd) != 0) {
+    rc = RC::IOERR_FSYNC;
+  }
+  ::close(fd);
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to mark row count file %s dirty. rc=%d:%s", file_.c_str(), rc, strrc(rc));
+    return rc;
+  }
+  clean_on_disk_ = false;
+  return RC::SUCCESS;
+}
+
+RC RowCount::begin_change()
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  RC rc = mark_dirty_locked();
+  if (rc != RC::SUCCESS) {
+    // 文件中的记录数会过时，删掉文件，内存中的记录数也不再使用
+    count_ = -1;
+    if (::unlink(file_.c_str()) == 0 || errno == ENOENT) {
+      clean_on_disk_ = false;
+    }
+  }
+  pending_++;
+  epoch_++;
+  return rc;
+}
+
+void RowCount::end_change(int64_t delta)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (count_ >= 0) {
+    count_ += delta;
+  }
+  pending_--;
+  epoch_++;
+}
+
+bool RowCount::get(int64_t *count, uint64_t *epoch) const
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  *count = count_;
+  *epoch = epoch_;
+  return count_ >= 0;
+}
+
+void RowCount::learn(uint64_t epoch, int64_t count)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (epoch == epoch_ && pending_ == 0) {
+    count_ = count;
+  }
+}
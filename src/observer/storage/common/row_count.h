@@ -0,0 +1,123 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Maintained count of committed records of a table.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_ROW_COUNT_H_
+#define __OBSERVER_STORAGE_COMMON_ROW_COUNT_H_
+
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+
+#include "rc.h"
+
+#define ROW_COUNT_MAGIC 0x544E4352  // "RCNT"
+
+struct RowCountFileHeader {
+  int magic;
+  int clean;          // 1表示row_count是文件写出时表中已经提交的记录数，0表示之后修改过，不可信
+  int64_t row_count;
+};
+
+/**
+ * 表中已经提交的记录数，没有过滤条件的COUNT(*)直接返回这个值。
+ * 事务提交时加上事务插入和删除的记录数，不经过事务的修改完成时直接加上。
+ * 和zone map一样，修改之前先把文件标记为不完整，同步表时写出；打开表时文件不完整说明上次没有正常同步，
+ * 记录数未知，在第一次完整扫描时重新得到
+ */
+class RowCount {
+public:
+  /**
+   * file为空时只在内存中维护，比如内存表
+   */
+  void init(const std::string &file);
+  /**
+   * 从文件中读出记录数，文件不存在或者没有完整写出时返回失败，记录数未知
+   */
+  RC load();
+  /**
+   * 记录数已知并且没有正在进行的修改时写到文件中，标记为完整
+   */
+  RC save();
+  /**
+   * 记录数变成未知并删除文件
+   */
+  void clear();
+  /**
+   * 清空表之后记录数是0
+   */
+  RC reset();
+
+  /**
+   * 修改记录数之前调用，文件标记为完整时先改成不完整。每次begin_change都要有对应的end_change
+   */
+  RC begin_change();
+  /**
+   * 修改已经对新的读视图可见时调用，delta是增加的记录数
+   */
+  void end_change(int64_t delta);
+
+  /**
+   * 记录数已知时返回true。epoch在每次修改时增加，用来判断一次扫描期间有没有修改
+   */
+  bool get(int64_t *count, uint64_t *epoch) const;
+  /**
+   * 扫描得到的记录数。从得到epoch到现在没有修改过时作为记录数
+   */
+  void learn(uint64_t epoch, int64_t count);
+
+private:
+  RC mark_dirty_locked();
+
+private:
+  std::string file_;
+  mutable std::mutex mutex_;
+  int64_t count_ = -1;      // 小于0表示未知
+  uint64_t epoch_ = 0;
+  int pending_ = 0;         // 已经begin_change还没有end_change的修改
+  bool clean_on_disk_ = false;
+};
+
+/**
+ * 不经过事务的修改，enabled为true时构造时begin_change，析构时end_change。修改成功之后用add记下变化的记录数
+ */
+class RowCountChange {
+public:
+  RowCountChange(RowCount &row_count, bool enabled) : row_count_(enabled ? &row_count : nullptr)
+  {
+    if (row_count_ != nullptr) {
+      row_count_->begin_change();
+    }
+  }
+  ~RowCountChange()
+  {
+    if (row_count_ != nullptr) {
+      row_count_->end_change(delta_);
+    }
+  }
+
+  RowCountChange(const RowCountChange &) = delete;
+  RowCountChange &operator=(const RowCountChange &) = delete;
+
+  void add(int64_t delta)
+  {
+    delta_ += delta;
+  }
+
+private:
+  RowCount *row_count_;
+  int64_t delta_ = 0;
+};
+
+#endif  // __OBSERVER_STORAGE_COMMON_ROW_COUNT_H_
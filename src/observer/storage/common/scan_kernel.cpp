@@ -0,0 +1,295 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Kernels comparing a fixed-offset field of every record on a page with a constant.
+//
+
+#include <string.h>
+
+#include "storage/common/scan_kernel.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define SCAN_KERNEL_AVX2 1
+#endif
+
+CompOp reverse_comp_op(CompOp comp_op)
+{
+  switch (comp_op)
+  {
+  case LESS_EQUAL:
+    return GREAT_EQUAL;
+  case LESS_THAN:
+    return GREAT_THAN;
+  case GREAT_EQUAL:
+    return LESS_EQUAL;
+  case GREAT_THAN:
+    return LESS_THAN;
+  default:
+    return comp_op;
+  }
+}
+
+namespace {
+
+template <CompOp comp_op>
+inline bool compare_value(int left, int right)
+{
+  switch (comp_op)
+  {
+  case EQUAL_TO:
+    return left == right;
+  case LESS_EQUAL:
+    return left <= right;
+  case NOT_EQUAL:
+    return left != right;
+  case LESS_THAN:
+    return left < right;
+  case GREAT_EQUAL:
+    return left >= right;
+  default:
+    return left > right;
+  }
+}
+
+template <CompOp comp_op>
+inline bool compare_value(float left, float right)
+{
+  float result = left - right;
+  int cmp_result = 0;
+  if (!(result < 1e-6 && result > -1e-6))
+  {
+    cmp_result = result > 0 ? 1 : -1;
+  }
+  return compare_value<comp_op>(cmp_result, 0);
+}
+
+/**
+ * 从start开始逐条比较，start是8的倍数
+ */
+template <typename T, CompOp comp_op>
+void scan_compare_scalar(
+    const char *values, const char *nulls, unsigned char null_mask, int stride, int start, int count, T value, char *bits)
+{
+  for (int i = start; i < count; i += 8)
+  {
+    unsigned char byte = 0;
+    const int end = i + 8 < count ? i + 8 : count;
+    for (int j = i; j < end; j++)
+    {
+      T v;
+      memcpy(&v, values + j * stride, sizeof(v));
+      const bool match = compare_value<comp_op>(v, value) && (nulls[j * stride] & null_mask) == 0;
+      byte |= (unsigned char)match << (j - i);
+    }
+    bits[i / 8] = (char)byte;
+  }
+}
+
+#ifdef SCAN_KERNEL_AVX2
+
+__attribute__((target("avx2"))) inline __m256i gather_offsets(int stride)
+{
+  return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+}
+
+/**
+ * 8条记录的null标志，不是null的位置全是1
+ */
+__attribute__((target("avx2"))) inline __m256i not_null_mask(const char *nulls, unsigned char null_mask, __m256i offsets)
+{
+  __m256i flags = _mm256_i32gather_epi32((const int *)nulls, offsets, 1);
+  flags = _mm256_and_si256(flags, _mm256_set1_epi32(null_mask));
+  return _mm256_cmpeq_epi32(flags, _mm256_setzero_si256());
+}
+
+template <CompOp comp_op>
+__attribute__((target("avx2"))) int scan_compare_int_avx2(
+    const char *values, const char *nulls, unsigned char null_mask, int stride, int count, int value, char *bits)
+{
+  const __m256i offsets = gather_offsets(stride);
+  const __m256i target = _mm256_set1_epi32(value);
+  const __m256i ones = _mm256_set1_epi32(-1);
+  int i = 0;
+  // null标志按4个字节读取，最后一组留给逐条比较，不会读到页面之外
+  for (; i + 8 < count; i += 8)
+  {
+    const __m256i v = _mm256_i32gather_epi32((const int *)(values + i * stride), offsets, 1);
+    __m256i match;
+    switch (comp_op)
+    {
+    case EQUAL_TO:
+      match = _mm256_cmpeq_epi32(v, target);
+      break;
+    case NOT_EQUAL:
+      match = _mm256_xor_si256(_mm256_cmpeq_epi32(v, target), ones);
+      break;
+    case LESS_THAN:
+      match = _mm256_cmpgt_epi32(target, v);
+      break;
+    case LESS_EQUAL:
+      match = _mm256_xor_si256(_mm256_cmpgt_epi32(v, target), ones);
+      break;
+    case GREAT_THAN:
+      match = _mm256_cmpgt_epi32(v, target);
+      break;
+    default:
+      match = _mm256_xor_si256(_mm256_cmpgt_epi32(target, v), ones);
+      break;
+    }
+    match = _mm256_and_si256(match, not_null_mask(nulls + i * stride, null_mask, offsets));
+    bits[i / 8] = (char)_mm256_movemask_ps(_mm256_castsi256_ps(match));
+  }
+  return i;
+}
+
+template <CompOp comp_op>
+__attribute__((target("avx2"))) int scan_compare_float_avx2(
+    const char *values, const char *nulls, unsigned char null_mask, int stride, int count, float value, char *bits)
+{
+  const __m256i offsets = gather_offsets(stride);
+  const __m256 target = _mm256_set1_ps(value);
+  // float的差值r满足r < 1e-6(double)等价于r <= 1e-6f，结果和逐条比较相同
+  const __m256 epsilon = _mm256_set1_ps(1e-6f);
+  const __m256 negative_epsilon = _mm256_set1_ps(-1e-6f);
+  int i = 0;
+  for (; i + 8 < count; i += 8)
+  {
+    const __m256 v = _mm256_i32gather_ps((const float *)(values + i * stride), offsets, 1);
+    const __m256 result = _mm256_sub_ps(v, target);
+    const __m256 equal =
+        _mm256_and_ps(_mm256_cmp_ps(result, epsilon, _CMP_LE_OQ), _mm256_cmp_ps(result, negative_epsilon, _CMP_GE_OQ));
+    const __m256 greater = _mm256_cmp_ps(result, epsilon, _CMP_GT_OQ);
+    const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    __m256 match;
+    switch (comp_op)
+    {
+    case EQUAL_TO:
+      match = equal;
+      break;
+    case NOT_EQUAL:
+      match = _mm256_xor_ps(equal, all);
+      break;
+    case LESS_THAN:
+      // 和逐条比较一样，既不相等也不大于的都算小于
+      match = _mm256_xor_ps(_mm256_or_ps(equal, greater), all);
+      break;
+    case LESS_EQUAL:
+      match = _mm256_xor_ps(greater, all);
+      break;
+    case GREAT_THAN:
+      match = greater;
+      break;
+    default:
+      match = _mm256_or_ps(equal, greater);
+      break;
+    }
+    match = _mm256_and_ps(match, _mm256_castsi256_ps(not_null_mask(nulls + i * stride, null_mask, offsets)));
+    bits[i / 8] = (char)_mm256_movemask_ps(match);
+  }
+  return i;
+}
+
+bool cpu_has_avx2()
+{
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+}
+
+#endif // SCAN_KERNEL_AVX2
+
+template <CompOp comp_op>
+void scan_compare_int(
+    const char *values, const char *nulls, unsigned char null_mask, int stride, int count, int value, char *bits)
+{
+  int start = 0;
+#ifdef SCAN_KERNEL_AVX2
+  if (cpu_has_avx2())
+  {
+    start = scan_compare_int_avx2<comp_op>(values, nulls, null_mask, stride, count, value, bits);
+  }
+#endif
+  scan_compare_scalar<int, comp_op>(values, nulls, null_mask, stride, start, count, value, bits);
+}
+
+template <CompOp comp_op>
+void scan_compare_float(
+    const char *values, const char *nulls, unsigned char null_mask, int stride, int count, float value, char *bits)
+{
+  int start = 0;
+#ifdef SCAN_KERNEL_AVX2
+  if (cpu_has_avx2())
+  {
+    start = scan_compare_float_avx2<comp_op>(values, nulls, null_mask, stride, count, value, bits);
+  }
+#endif
+  scan_compare_scalar<float, comp_op>(values, nulls, null_mask, stride, start, count, value, bits);
+}
+
+} // namespace
+
+void scan_compare_int(const char *values, const char *nulls, unsigned char null_mask, int stride, int count,
+                      CompOp comp_op, int value, char *bits)
+{
+  switch (comp_op)
+  {
+  case EQUAL_TO:
+    scan_compare_int<EQUAL_TO>(values, nulls, null_mask, stride, count, value, bits);
+    break;
+  case LESS_EQUAL:
+    scan_compare_int<LESS_EQUAL>(values, nulls, null_mask, stride, count, value, bits);
+    break;
+  case NOT_EQUAL:
+    scan_compare_int<NOT_EQUAL>(values, nulls, null_mask, stride, count, value, bits);
+    break;
+  case LESS_THAN:
+    scan_compare_int<LESS_THAN>(values, nulls, null_mask, stride, count, value, bits);
+    break;
+  case GREAT_EQUAL:
+    scan_compare_int<GREAT_EQUAL>(values, nulls, null_mask, stride, count, value, bits);
+    break;
+  case GREAT_THAN:
+    scan_compare_int<GREAT_THAN>(values, nulls, null_mask, stride, count, value, bits);
+    break;
+  default:
+    memset(bits, 0, (count + 7) / 8);
+    break;
+  }
+}
+
+void scan_compare_float(const char *values, const char *nulls, unsigned char null_mask, int stride, int count,
+                        CompOp comp_op, float value, char *bits)
+{
+  switch (comp_op)
+  {
+  case EQUAL_TO:
+    scan_compare_float<EQUAL_TO>(values, nulls, null_mask, stride, count, value, bits);
+    break;
+  case LESS_EQUAL:
+    scan_compare_float<LESS_EQUAL>(values, nulls, null_mask, stride, count, value, bits);
+    break;
+  case NOT_EQUAL:
+    scan_compare_float<NOT_EQUAL>(values, nulls, null_mask, stride, count, value, bits);
+    break;
+  case LESS_THAN:
+    scan_compare_float<LESS_THAN>(values, nulls, null_mask, stride, count, value, bits);
+    break;
+  case GREAT_EQUAL:
+    scan_compare_float<GREAT_EQUAL>(values, nulls, null_mask, stride, count, value, bits);
+    break;
+  case GREAT_THAN:
+    scan_compare_float<GREAT_THAN>(values, nulls, null_mask, stride, count, value, bits);
+    break;
+  default:
+    memset(bits, 0, (count + 7) / 8);
+    break;
+  }
+}
@@ -0,0 +1,39 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Kernels comparing a fixed-offset field of every record on a page with a constant.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_SCAN_KERNEL_H_
+#define __OBSERVER_STORAGE_COMMON_SCAN_KERNEL_H_
+
+#include "sql/parser/parse_defs.h"
+
+/**
+ * 对count条记录判断 字段 comp_op value。第i条记录的字段在values + i * stride，null标志是nulls + i * stride
+ * 这个字节中null_mask对应的位。字段不是null并且比较成立时bits中的第i位是1，否则是0，位的顺序和页面的slot bitmap相同。
+ * bits至少要有(count + 7) / 8个字节。支持AVX2的CPU上每次用gather比较8条记录，否则逐条比较
+ */
+void scan_compare_int(const char *values, const char *nulls, unsigned char null_mask, int stride, int count,
+                      CompOp comp_op, int value, char *bits);
+
+/**
+ * 和scan_compare_int相同，差值在1e-6以内的浮点数认为相等，和DefaultConditionFilter一致
+ */
+void scan_compare_float(const char *values, const char *nulls, unsigned char null_mask, int stride, int count,
+                        CompOp comp_op, float value, char *bits);
+
+/**
+ * 值在左边的比较改写成字段在左边时的比较符
+ */
+CompOp reverse_comp_op(CompOp comp_op);
+
+#endif // __OBSERVER_STORAGE_COMMON_SCAN_KERNEL_H_
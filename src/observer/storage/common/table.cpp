@@ -14,30 +14,99 @@ See the Mulan PSL v2 for more details. */
 
 #include <limits.h>
 #include <string.h>
+#include <strings.h>
 #include <algorithm>
+#include <iterator>
+#include <unordered_set>
 
 #include "storage/common/table.h"
 #include "storage/common/table_meta.h"
+#include "storage/common/partition_meta.h"
+#include "storage/common/dictionary.h"
 #include "common/log/log.h"
 #include "common/lang/string.h"
+#include "common/seda/request_trace.h"
+#include "common/time/datetime.h"
+#include "session/query_cancel.h"
 #include "storage/default/disk_buffer_pool.h"
+#include "storage/default/page_loader.h"
+#include "storage/default/redo_log.h"
 #include "storage/common/record_manager.h"
 #include "storage/common/condition_filter.h"
+#include "storage/common/zone_map.h"
+#include "storage/common/undo_file.h"
 #include "storage/common/meta_util.h"
 #include "storage/common/index.h"
 #include "storage/common/bplus_tree_index.h"
+#include "storage/common/hash_index.h"
+#include "storage/common/table_scanner.h"
 #include "storage/trx/trx.h"
+#include "storage/mem/mem_record_store.h"
+#include "storage/mem/mem_hash_index.h"
+#include "storage/lsm/lsm_index.h"
+
+/**
+ * 表上的读写操作加compact_lock_的读锁，整理记录时加写锁，保证操作过程中记录不会被移动
+ */
+class CompactLockGuard
+{
+public:
+  CompactLockGuard(pthread_rwlock_t &lock, bool exclusive) : lock_(lock)
+  {
+    if (exclusive)
+    {
+      pthread_rwlock_wrlock(&lock_);
+    }
+    else
+    {
+      pthread_rwlock_rdlock(&lock_);
+    }
+  }
+  ~CompactLockGuard()
+  {
+    pthread_rwlock_unlock(&lock_);
+  }
+
+private:
+  pthread_rwlock_t &lock_;
+};
+
+// 所有表共用的版本序号，保证不同的表和同一个表的不同时刻版本都不相同
+static std::atomic<uint64_t> table_version_seq(0);
 
 Table::Table() : data_buffer_pool_(nullptr),
                  file_id_(-1),
-                 record_handler_(nullptr)
+                 record_handler_(nullptr),
+                 mem_records_(nullptr),
+                 zone_map_(nullptr),
+                 undo_file_(nullptr),
+                 stats_valid_(false),
+                 stats_row_delta_(0),
+                 stats_changes_(0),
+                 version_(++table_version_seq)
 {
+  pthread_rwlock_init(&compact_lock_, nullptr);
+  pthread_mutex_init(&stats_lock_, nullptr);
 }
 
 Table::~Table()
 {
+  for (Table *partition : partitions_)
+  {
+    delete partition;
+  }
+  partitions_.clear();
+  pthread_rwlock_destroy(&compact_lock_);
+  pthread_mutex_destroy(&stats_lock_);
+  for (Index *index : indexes_)
+  {
+    delete index;
+  }
+  indexes_.clear();
   delete record_handler_;
   record_handler_ = nullptr;
+  delete mem_records_;
+  mem_records_ = nullptr;
 
   if (data_buffer_pool_ != nullptr && file_id_ >= 0)
   {
@@ -45,10 +114,59 @@ Table::~Table()
     data_buffer_pool_ = nullptr;
   }
 
+  // 没有其它的操作了，zone map包含了记录文件中所有的数据
+  if (zone_map_ != nullptr)
+  {
+    zone_map_->save();
+    delete zone_map_;
+    zone_map_ = nullptr;
+  }
+  row_count_.save();
+
+  // undo文件只在这次运行中有效，关闭时删除
+  delete undo_file_;
+  undo_file_ = nullptr;
+
   LOG_INFO("Table has been closed: %s", name());
 }
 
-RC Table::create(const char *path, const char *name, const char *base_dir, int attribute_count, const AttrInfo attributes[])
+/**
+ * 按建表语句中的分区定义生成每个分区的元数据，hash分区按序号命名为p0、p1...
+ */
+static RC init_partition_metas(const TableMeta &table_meta, const PartitionDef &partition_def,
+                               std::vector<PartitionMeta> &partitions)
+{
+  const FieldMeta *field = table_meta.field(partition_def.field_name);
+  if (nullptr == field)
+  {
+    LOG_WARN("No such partition field %s. table=%s", partition_def.field_name, table_meta.name());
+    return RC::SCHEMA_FIELD_MISSING;
+  }
+  partitions.resize(partition_def.partition_num);
+  for (size_t i = 0; i < partition_def.partition_num; i++)
+  {
+    RC rc = RC::SUCCESS;
+    if (partition_def.type == HASH_PARTITION)
+    {
+      rc = partitions[i].init(("p" + std::to_string(i)).c_str(), *field, nullptr);
+    }
+    else
+    {
+      const Value &bound = partition_def.bounds[i];
+      rc = partitions[i].init(partition_def.partition_names[i], *field, bound.type == UNDEFINED ? nullptr : &bound);
+    }
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC Table::create(const char *path, const char *name, const char *base_dir, int attribute_count, const AttrInfo attributes[],
+                 int page_size, const char *compression, const char *format, const char *engine,
+                 const PartitionDef *partition, const char *bloom_filter, int primary_key_num,
+                 const char *const primary_keys[])
 {
   // 检查表名参数
   if (nullptr == name || common::is_blank(name))
@@ -66,6 +184,110 @@ RC Table::create(const char *path, const char *name, const char *base_dir, int a
     return RC::INVALID_ARGUMENT;
   }
 
+  if (page_size == 0)
+  {
+    page_size = BP_PAGE_SIZE;
+  }
+  if (!is_valid_page_size(page_size))
+  {
+    LOG_WARN("Invalid page size %d. table_name=%s", page_size, name);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  PageCompression page_compression = PAGE_COMPRESSION_NONE;
+  if (compression != nullptr && page_compression_from_string(compression, &page_compression) != RC::SUCCESS)
+  {
+    LOG_WARN("Invalid page compression %s. table_name=%s", compression, name);
+    return RC::INVALID_ARGUMENT;
+  }
+  if (!page_compression_supported(page_compression))
+  {
+    LOG_WARN("Page compression %s is not supported by this build. table_name=%s", compression, name);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  bool pax_format = false;
+  if (format != nullptr)
+  {
+    if (0 == strcasecmp(format, "pax"))
+    {
+      pax_format = true;
+    }
+    else if (0 != strcasecmp(format, "row"))
+    {
+      LOG_WARN("Invalid record format %s. table_name=%s", format, name);
+      return RC::INVALID_ARGUMENT;
+    }
+  }
+
+  bool in_memory = false;
+  bool mmap_engine = false;
+  bool lsm_engine = false;
+  if (engine != nullptr)
+  {
+    if (0 == strcasecmp(engine, "memory"))
+    {
+      in_memory = true;
+    }
+    else if (0 == strcasecmp(engine, "mmap"))
+    {
+      mmap_engine = true;
+    }
+    else if (0 == strcasecmp(engine, "lsm"))
+    {
+      lsm_engine = true;
+    }
+    else if (0 != strcasecmp(engine, "disk"))
+    {
+      LOG_WARN("Invalid storage engine %s. table_name=%s", engine, name);
+      return RC::INVALID_ARGUMENT;
+    }
+  }
+  if (mmap_engine && page_compression != PAGE_COMPRESSION_NONE)
+  {
+    LOG_WARN("Mmap table %s cannot be compressed, pages are mapped from data file directly", name);
+    return RC::INVALID_ARGUMENT;
+  }
+  if (in_memory && (page_compression != PAGE_COMPRESSION_NONE || pax_format))
+  {
+    LOG_WARN("Memory table %s has no data file to compress or store in pax format", name);
+    return RC::INVALID_ARGUMENT;
+  }
+  const bool partitioned = partition != nullptr && partition->type != NO_PARTITION;
+  if (in_memory && partitioned)
+  {
+    LOG_WARN("Memory table %s cannot be partitioned", name);
+    return RC::INVALID_ARGUMENT;
+  }
+  if (in_memory && bloom_filter != nullptr)
+  {
+    LOG_WARN("Memory table %s has no data file to build bloom filters", name);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  // 主键字段不能为null
+  std::vector<AttrInfo> attribute_infos(attributes, attributes + attribute_count);
+  bool partition_in_primary_key = false;
+  for (int i = 0; i < primary_key_num; i++)
+  {
+    auto iter = std::find_if(attribute_infos.begin(), attribute_infos.end(),
+                             [&](const AttrInfo &attr) { return 0 == strcmp(attr.name, primary_keys[i]); });
+    if (iter == attribute_infos.end() ||
+        std::find_if(primary_keys, primary_keys + i,
+                     [&](const char *key) { return 0 == strcmp(key, primary_keys[i]); }) != primary_keys + i)
+    {
+      LOG_WARN("Invalid primary key field %s. table_name=%s", primary_keys[i], name);
+      return RC::INVALID_ARGUMENT;
+    }
+    iter->is_nullable = 0;
+    partition_in_primary_key = partition_in_primary_key || (partitioned && 0 == strcmp(partition->field_name, iter->name));
+  }
+  if (partitioned && primary_key_num > 0 && !partition_in_primary_key)
+  {
+    LOG_WARN("Primary key of partitioned table %s must contain the partition field", name);
+    return RC::INVALID_ARGUMENT;
+  }
+
   RC rc = RC::SUCCESS;
 
   // 使用 table_name.table记录一个表的元数据
@@ -87,11 +309,35 @@ RC Table::create(const char *path, const char *name, const char *base_dir, int a
   close(fd);
 
   // 创建文件
-  if ((rc = table_meta_.init(name, attribute_count, attributes)) != RC::SUCCESS)
+  if ((rc = table_meta_.init(name, attribute_count, attribute_infos.data())) != RC::SUCCESS)
   {
     LOG_ERROR("Failed to init table meta. name:%s, ret:%d", name, rc);
     return rc; // delete table file
   }
+  table_meta_.set_in_memory(in_memory);
+  table_meta_.set_mmap_engine(mmap_engine);
+  table_meta_.set_lsm_engine(lsm_engine);
+  if (partitioned)
+  {
+    std::vector<PartitionMeta> partitions;
+    rc = init_partition_metas(table_meta_, *partition, partitions);
+    if (rc == RC::SUCCESS)
+    {
+      rc = table_meta_.set_partitions(partition->type, partition->field_name, partitions);
+    }
+    if (rc != RC::SUCCESS)
+    {
+      // 分区定义写错时可以重新建表
+      LOG_WARN("Invalid partitions of table %s. rc=%d:%s", name, rc, strrc(rc));
+      ::remove(path);
+      return rc;
+    }
+  }
+  if (bloom_filter != nullptr && (rc = table_meta_.set_bloom_filter_field(bloom_filter)) != RC::SUCCESS)
+  {
+    ::remove(path);
+    return rc;
+  }
 
   std::fstream fs;
   fs.open(path, std::ios_base::out | std::ios_base::binary);
@@ -105,1127 +351,4623 @@ RC Table::create(const char *path, const char *name, const char *base_dir, int a
   table_meta_.serialize(fs);
   fs.close();
 
-  std::string data_file = std::string(base_dir) + "/" + name + TABLE_DATA_SUFFIX;
-  std::cout << data_file << std::endl;
-  data_buffer_pool_ = theGlobalDiskBufferPool();
-  rc = data_buffer_pool_->create_file(data_file.c_str());
-  if (rc != RC::SUCCESS)
+  if (in_memory)
   {
-    LOG_ERROR("Failed to create disk buffer pool of data file. file name=%s", data_file.c_str());
-    return rc;
+    rc = init_mem_records();
+    if (rc == RC::SUCCESS)
+    {
+      rc = init_undo_file(base_dir);
+    }
   }
-
-  rc = init_record_handler(base_dir);
-
-  base_dir_ = base_dir;
-  LOG_INFO("Successfully create table %s:%s", base_dir, name);
-  return rc;
-}
-
-RC Table::open(const char *meta_file, const char *base_dir)
-{
-  // 加载元数据文件
-  std::fstream fs;
-  std::string meta_file_path = std::string(base_dir) + "/" + meta_file;
-  fs.open(meta_file_path, std::ios_base::in | std::ios_base::binary);
-  if (!fs.is_open())
+  else if (partitioned)
   {
-    LOG_ERROR("Failed to open meta file for read. file name=%s, errmsg=%s", meta_file, strerror(errno));
-    return RC::IOERR;
+    rc = create_partitions(base_dir, page_size, page_compression, pax_format);
   }
-  if (table_meta_.deserialize(fs) < 0)
+  else
   {
-    LOG_ERROR("Failed to deserialize table meta. file name=%s", meta_file);
-    return RC::GENERIC_ERROR;
+    rc = create_storage(base_dir, page_size, page_compression, pax_format);
   }
-  fs.close();
-
-  // 加载数据文件
-  RC rc = init_record_handler(base_dir);
-
   base_dir_ = base_dir;
-
-  const int index_num = table_meta_.index_num();
-  for (int i = 0; i < index_num; i++)
+  if (rc == RC::SUCCESS && primary_key_num > 0)
   {
-    const IndexMeta *index_meta = table_meta_.index(i);
-    const FieldMeta *field_meta = table_meta_.field(index_meta->field());
-
-    if (field_meta == nullptr)
+    // 记录太长时主键索引只包含主键字段，查找之后还要读数据文件
+    const bool include_all_columns = !in_memory && can_include_all_columns();
+    if (!include_all_columns)
     {
-      LOG_PANIC("Found invalid index meta info which has a non-exists field. table=%s, index=%s, field=%s",
-                name(), index_meta->name(), index_meta->field());
-      return RC::GENERIC_ERROR;
+      LOG_INFO("Primary key index of table %s only contains the key fields", name);
     }
-
-    BplusTreeIndex *index = new BplusTreeIndex();
-    std::string index_file = index_data_file(base_dir, name(), index_meta->name());
-    rc = index->open(index_file.c_str(), *index_meta, *field_meta);
+    rc = create_index(nullptr, PRIMARY_KEY_INDEX_NAME, primary_key_num, primary_keys, true, nullptr,
+                      BPLUS_TREE_INDEX, include_all_columns);
     if (rc != RC::SUCCESS)
     {
-      delete index;
-      LOG_ERROR("Failed to open index. table=%s, index=%s, file=%s, rc=%d:%s",
-                name(), index_meta->name(), index_file.c_str(), rc, strrc(rc));
-      return rc;
+      LOG_WARN("Failed to create primary key of table %s. rc=%d:%s", name, rc, strrc(rc));
+      drop_files();
+      ::remove(path);
     }
-    indexes_.push_back(index);
   }
-  return rc;
-}
-
-RC Table::commit_insert(Trx *trx, const RID &rid)
-{
-  Record record;
-  RC rc = record_handler_->get_record(&rid, &record);
-  if (rc != RC::SUCCESS)
+  if (rc == RC::SUCCESS)
   {
-    return rc;
+    LOG_INFO("Successfully create %stable %s:%s", in_memory ? "memory " : "", base_dir, name);
   }
-
-  return trx->commit_insert(this, record);
+  return rc;
 }
 
-RC Table::rollback_insert(Trx *trx, const RID &rid)
+RC Table::create_storage(const char *base_dir, int page_size, int page_compression, bool pax_format)
 {
-
-  Record record;
-  RC rc = record_handler_->get_record(&rid, &record);
+  std::string data_file = std::string(base_dir) + "/" + name() + TABLE_DATA_SUFFIX;
+  std::cout << data_file << std::endl;
+  data_buffer_pool_ = theGlobalDiskBufferPool(page_size);
+  RC rc = data_buffer_pool_->create_file(data_file.c_str(), (PageCompression)page_compression);
   if (rc != RC::SUCCESS)
   {
+    LOG_ERROR("Failed to create disk buffer pool of data file. file name=%s", data_file.c_str());
     return rc;
   }
 
-  // remove all indexes
-  rc = delete_entry_of_indexes(record.data, rid, false);
-  if (rc != RC::SUCCESS)
+  if (pax_format)
   {
-    LOG_ERROR("Failed to delete indexes of record(rid=%d.%d) while rollback insert, rc=%d:%s",
-              rid.page_num, rid.slot_num, rc, strrc(rc));
+    // 每个字段一列，所有字段的null标志合在一起作为最后一列
+    std::vector<int> pax_columns;
+    for (int i = 0; i < table_meta_.field_num(); i++)
+    {
+      pax_columns.push_back(table_meta_.field(i)->len());
+    }
+    pax_columns.push_back(table_meta_.null_flags_size());
+    rc = init_record_handler(base_dir, false, pax_columns);
   }
   else
   {
-    rc = record_handler_->delete_record(&rid);
+    // 有CHARS字段的表使用变长记录，不用按照定义的长度保存字符串
+    bool variable_length = false;
+    for (int i = table_meta_.sys_field_num(); i < table_meta_.field_num(); i++)
+    {
+      variable_length = variable_length || table_meta_.field(i)->storage_type() == CHARS;
+    }
+    rc = init_record_handler(base_dir, variable_length);
   }
-  return rc;
-}
-
-RC Table::insert_record(Trx *trx, Record *record)
-{
-  // 首先insert到record中，再将记录insert到index索引中
-  RC rc = RC::SUCCESS;
-
-  if (trx != nullptr)
+  if (rc == RC::SUCCESS)
   {
-    trx->init_trx_info(this, *record);
+    rc = init_zone_map(base_dir);
   }
-  // 插入到record中，并获取对应的rid
-  // 这里需要加上分配给null的大小
-  rc = record_handler_->insert_record(record->data, table_meta_.record_size() + table_meta_.field_num(), &record->rid);
-  if (rc != RC::SUCCESS)
+  if (rc == RC::SUCCESS)
   {
-    LOG_ERROR("Insert record failed. table name=%s, rc=%d:%s", table_meta_.name(), rc, strrc(rc));
-    return rc;
+    rc = init_row_count(base_dir, true);
+  }
+  if (rc == RC::SUCCESS)
+  {
+    rc = init_undo_file(base_dir);
   }
+  base_dir_ = base_dir;
+  return rc;
+}
 
-  if (trx != nullptr)
+RC Table::create_partitions(const char *base_dir, int page_size, int page_compression, bool pax_format)
+{
+  for (int i = 0; i < table_meta_.partition_num(); i++)
   {
-    rc = trx->insert_record(this, record);
+    Table *partition = new Table();
+    partition->is_partition_ = true;
+    table_meta_.partition_table_meta(i, partition->table_meta_);
+    RC rc = partition->create_storage(base_dir, page_size, page_compression, pax_format);
     if (rc != RC::SUCCESS)
     {
-      LOG_ERROR("Failed to log operation(insertion) to trx");
-      RC rc2 = record_handler_->delete_record(&record->rid);
-      if (rc2 != RC::SUCCESS)
-      {
-        LOG_PANIC("Failed to rollback record data when insert index entries failed. table name=%s, rc=%d:%s",
-                  name(), rc2, strrc(rc2));
-      }
+      LOG_ERROR("Failed to create partition %s. rc=%d:%s", partition->name(), rc, strrc(rc));
+      delete partition;
       return rc;
     }
+    partitions_.push_back(partition);
   }
-  // LOG_INFO("INSERT ENTRY OF INDEXES with data %d, rid:page_num :%d,slotnum :%d\n",record->data,record->rid.page_num,record->rid.slot_num);
-  // record->data为key,record->rid为value
-  rc = insert_entry_of_indexes(record->data, record->rid);
-  if (rc != RC::SUCCESS)
+  return RC::SUCCESS;
+}
+
+RC Table::open_partitions(const char *base_dir)
+{
+  for (int i = 0; i < table_meta_.partition_num(); i++)
   {
-    RC rc2 = delete_entry_of_indexes(record->data, record->rid, true);
-    if (rc2 != RC::SUCCESS)
-    {
-      LOG_PANIC("Failed to rollback index data when insert index entries failed. table name=%s, rc=%d:%s",
-                name(), rc2, strrc(rc2));
-    }
-    rc2 = record_handler_->delete_record(&record->rid);
-    if (rc2 != RC::SUCCESS)
+    Table *partition = new Table();
+    partition->is_partition_ = true;
+    table_meta_.partition_table_meta(i, partition->table_meta_);
+    RC rc = partition->open_storage(base_dir);
+    if (rc != RC::SUCCESS)
     {
-      LOG_PANIC("Failed to rollback record data when insert index entries failed. table name=%s, rc=%d:%s",
-                name(), rc2, strrc(rc2));
+      LOG_ERROR("Failed to open partition %s. rc=%d:%s", partition->name(), rc, strrc(rc));
+      delete partition;
+      return rc;
     }
-    return rc;
+    partitions_.push_back(partition);
   }
-  return rc;
+  return RC::SUCCESS;
 }
 
-RC Table::insert_record(Trx *trx, int value_num, const Value *values, Record **ret_record)
+static Index *new_index(IndexType type, bool in_memory, bool lsm)
 {
-  // value_num->value的数量,values->value数组，ret_record->用于返回
-  if (value_num <= 0 || nullptr == values)
+  if (in_memory)
   {
-    LOG_ERROR("Invalid argument. value num=%d, values=%p", value_num, values);
-    return RC::INVALID_ARGUMENT;
+    return new MemHashIndex();
   }
-
-  // record_data只是单纯用来装数据
-  char *record_data;
-  RC rc = make_record(value_num, values, record_data);
-  if (rc != RC::SUCCESS)
+  if (lsm)
   {
-    LOG_ERROR("Failed to create a record. rc=%d:%s", rc, strrc(rc));
-    return rc;
+    return new LsmIndex();
   }
-  Record record;
-  record.data = record_data;
-  // record.valid = true;
-  rc = insert_record(trx, &record);
-  if (ret_record != nullptr)
+  if (type == HASH_INDEX)
   {
-    *ret_record = &record;
+    return new HashIndex();
   }
-  delete[] record_data;
-  return rc;
+  return new BplusTreeIndex();
 }
 
-const char *Table::name() const
+RC Table::open(const char *meta_file, const char *base_dir, const TableMeta *table_meta)
 {
-  return table_meta_.name();
-}
+  // 加载元数据文件，调用者已经从catalog中得到元数据时不用再解析
+  if (table_meta != nullptr)
+  {
+    TableMeta copy(*table_meta);
+    table_meta_.swap(copy);
+  }
+  else
+  {
+    std::fstream fs;
+    std::string meta_file_path = std::string(base_dir) + "/" + meta_file;
+    fs.open(meta_file_path, std::ios_base::in | std::ios_base::binary);
+    if (!fs.is_open())
+    {
+      LOG_ERROR("Failed to open meta file for read. file name=%s, errmsg=%s", meta_file, strerror(errno));
+      return RC::IOERR;
+    }
+    if (table_meta_.deserialize(fs) < 0)
+    {
+      LOG_ERROR("Failed to deserialize table meta. file name=%s", meta_file);
+      return RC::GENERIC_ERROR;
+    }
+    fs.close();
+  }
 
-const TableMeta &Table::table_meta() const
-{
-  return table_meta_;
-}
+  base_dir_ = base_dir;
+  RC rc = RC::SUCCESS;
+  if (partitioned())
+  {
+    rc = open_partitions(base_dir);
+  }
+  else
+  {
+    // 分析过的表直接使用保存的统计信息，不用在第一次优化时扫描全表。内存表重新启动之后是空表
+    if (table_meta_.analyzed() && !in_memory())
+    {
+      load_analyzed_stats();
+    }
+    rc = open_storage(base_dir);
+  }
+  // redo日志恢复时打开表之后还要恢复记录，恢复结束之后再调用finish_open
+  if (rc == RC::SUCCESS && !RedoLog::instance().recovering())
+  {
+    rc = finish_open();
+  }
+  return rc;
+}
+
+RC Table::open_storage(const char *base_dir)
+{
+  // 加载数据文件，内存表从空表开始
+  RC rc = RC::SUCCESS;
+  if (in_memory())
+  {
+    rc = init_mem_records();
+  }
+  else
+  {
+    rc = init_record_handler(base_dir);
+    if (rc == RC::SUCCESS)
+    {
+      rc = init_zone_map(base_dir);
+    }
+    if (rc == RC::SUCCESS)
+    {
+      rc = init_row_count(base_dir, false);
+    }
+  }
+  if (rc == RC::SUCCESS)
+  {
+    rc = init_undo_file(base_dir);
+  }
+
+  base_dir_ = base_dir;
+
+  const int index_num = table_meta_.index_num();
+  for (int i = 0; i < index_num; i++)
+  {
+    const IndexMeta *index_meta = table_meta_.index(i);
+    std::vector<FieldMeta> field_metas;
+    for (int j = 0; j < index_meta->field_num(); j++)
+    {
+      const FieldMeta *field_meta = table_meta_.field(index_meta->field(j));
+      if (field_meta == nullptr)
+      {
+        LOG_PANIC("Found invalid index meta info which has a non-exists field. table=%s, index=%s, field=%s",
+                  name(), index_meta->name(), index_meta->field(j));
+        return RC::GENERIC_ERROR;
+      }
+      field_metas.push_back(*field_meta);
+    }
+
+    Index *index = new_index(index_meta->type(), in_memory(), table_meta_.lsm_engine());
+    std::string index_file = index_data_file(base_dir, name(), index_meta->name());
+    rc = index->open(index_file.c_str(), *index_meta, field_metas);
+    if (rc != RC::SUCCESS)
+    {
+      delete index;
+      LOG_ERROR("Failed to open index. table=%s, index=%s, file=%s, rc=%d:%s",
+                name(), index_meta->name(), index_file.c_str(), rc, strrc(rc));
+      return rc;
+    }
+    std::vector<NullFlag> null_flags;
+    index_null_flags(*index_meta, null_flags);
+    index->set_null_flags(null_flags);
+    indexes_.push_back(index);
+  }
+  if (rc == RC::SUCCESS && RedoLog::instance().recovering() && !in_memory())
+  {
+    rc = recover_trx_records();
+  }
+  return rc;
+}
+
+void Table::map_storage()
+{
+  RC rc = data_buffer_pool_->map_file(file_id_);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_WARN("Failed to map data file of table %s, read it through buffer pool. rc=%d:%s", name(), rc, strrc(rc));
+    return;
+  }
+  read_only_ = true;
+  for (Index *index : indexes_)
+  {
+    rc = index->map_readonly();
+    if (rc != RC::SUCCESS)
+    {
+      LOG_WARN("Failed to map index file of table %s, read it through buffer pool. rc=%d:%s", name(), rc, strrc(rc));
+    }
+  }
+  LOG_INFO("Table %s is mapped read only", name());
+}
+
+RC Table::finish_open()
+{
+  if (!table_meta_.date_in_days())
+  {
+    RC rc = upgrade_dates();
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+  if (table_meta_.mmap_engine())
+  {
+    for (Table *partition : partitions_)
+    {
+      if (!partition->read_only_)
+      {
+        partition->map_storage();
+      }
+    }
+    if (partitions_.empty() && !read_only_)
+    {
+      map_storage();
+    }
+  }
+  return RC::SUCCESS;
+}
+
+bool Table::read_only() const
+{
+  for (const Table *partition : partitions_)
+  {
+    if (partition->read_only_)
+    {
+      return true;
+    }
+  }
+  return read_only_;
+}
+
+RC Table::purge_record(int64_t trx_id, const RID &rid)
+{
+  CompactLockGuard guard(compact_lock_, false);
+  Record record;
+  std::vector<char> buffer;
+  RC rc = get_record(rid, &record, buffer);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  int64_t record_trx_id = 0;
+  bool deleted = false;
+  Trx::get_record_trx_id(this, record, record_trx_id, deleted);
+  if (record_trx_id != trx_id)
+  {
+    // 之后又被其它事务修改了，事务字段由那个事务清除
+    return RC::SUCCESS;
+  }
+  if (deleted)
+  {
+    rc = delete_entry_of_indexes(record.data, rid, false);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to delete indexes of record(rid=%d.%d). rc=%d:%s",
+                rid.page_num, rid.slot_num, rc, strrc(rc)); // panic?
+    }
+    rc = remove_record(rid);
+  }
+  else
+  {
+    const FieldMeta *trx_field = table_meta_.trx_field();
+    memset(record.data + trx_field->offset(), 0, trx_field->len());
+    rc = write_back_trx_field(record);
+  }
+  data_changed();
+  return rc;
+}
+
+RC Table::restore_record(const RID &rid, const char *data, bool update_indexes)
+{
+  CompactLockGuard guard(compact_lock_, false);
+  Record record;
+  std::vector<char> buffer;
+  RC rc = get_record(rid, &record, buffer);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  // 删除没有修改索引，更新之后的索引项换回原来的，键没有变的索引不用修改
+  std::vector<char> current(record.data, record.data + record_data_size());
+  std::vector<Index *> indexes;
+  for (Index *index : indexes_)
+  {
+    if (update_indexes && index_key_changed(*index, current.data(), data))
+    {
+      indexes.push_back(index);
+    }
+  }
+  for (Index *index : indexes)
+  {
+    rc = index->delete_entry(current.data(), &rid);
+    if (rc != RC::SUCCESS && rc != RC::RECORD_INVALID_KEY)
+    {
+      LOG_ERROR("Failed to delete indexes of record(rid=%d.%d) while restoring it. rc=%d:%s",
+                rid.page_num, rid.slot_num, rc, strrc(rc));
+      return rc;
+    }
+  }
+  if (update_indexes)
+  {
+    log_index_change(false, current.data(), rid);
+  }
+  memcpy(record.data, data, record_data_size());
+  rc = write_record(record);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to restore record(rid=%d.%d). rc=%d:%s", rid.page_num, rid.slot_num, rc, strrc(rc));
+    return rc;
+  }
+  for (Index *index : indexes)
+  {
+    rc = index->insert_entry(record.data, &rid);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_PANIC("Failed to restore indexes of record(rid=%d.%d). rc=%d:%s",
+                rid.page_num, rid.slot_num, rc, strrc(rc));
+      return rc;
+    }
+  }
+  if (update_indexes)
+  {
+    log_index_change(true, record.data, rid);
+  }
+  data_changed();
+  return RC::SUCCESS;
+}
+
+uint64_t Table::version() const
+{
+  if (!partitioned())
+  {
+    return version_;
+  }
+  // 分区中的记录修改时只改变分区的版本
+  CompactLockGuard guard(const_cast<pthread_rwlock_t &>(compact_lock_), false);
+  uint64_t version = version_;
+  for (const Table *partition : partitions_)
+  {
+    version = std::max(version, partition->version());
+  }
+  return version;
+}
+
+void Table::data_changed()
+{
+  version_ = ++table_version_seq;
+}
+
+RC Table::rollback_insert(Trx *trx, const RID &rid)
+{
+  CompactLockGuard guard(compact_lock_, false);
+
+  Record record;
+  std::vector<char> buffer;
+  RC rc = get_record(rid, &record, buffer);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  // remove all indexes
+  rc = delete_entry_of_indexes(record.data, rid, false);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to delete indexes of record(rid=%d.%d) while rollback insert, rc=%d:%s",
+              rid.page_num, rid.slot_num, rc, strrc(rc));
+  }
+  else
+  {
+    rc = remove_record(rid);
+  }
+  if (rc == RC::SUCCESS)
+  {
+    record_changed(-1);
+  }
+  return rc;
+}
+
+Table *Table::find_record_partition(const char *record) const
+{
+  const int index = table_meta_.find_partition(record);
+  return index < 0 ? nullptr : partitions_[index];
+}
+
+RC Table::insert_record(Trx *trx, Record *record)
+{
+  CompactLockGuard guard(compact_lock_, false);
+  if (partitioned())
+  {
+    Table *partition = find_record_partition(record->data);
+    if (partition == nullptr)
+    {
+      LOG_WARN("No partition of table %s for the record", name());
+      return RC::INVALID_ARGUMENT;
+    }
+    return partition->insert_record(trx, record);
+  }
+  if (read_only_)
+  {
+    LOG_WARN("Cannot insert into table %s, it is mapped read only", name());
+    return RC::READONLY;
+  }
+  // 首先insert到record中，再将记录insert到index索引中
+  RC rc = RC::SUCCESS;
+
+  if (trx != nullptr)
+  {
+    rc = trx->init_trx_info(this, *record);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+  RowCountChange row_change(row_count_, trx == nullptr);
+  PageVisibilityInsert visibility_insert(page_visibility_, trx != nullptr);
+  rc = zone_map_->mark_dirty();
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  // 插入到record中，并获取对应的rid
+  // 这里需要加上分配给null的大小
+  if (in_memory())
+  {
+    rc = mem_records_->insert_record(record->data, &record->rid);
+  }
+  else if (variable_length())
+  {
+    std::vector<char> stored;
+    encode_record(record->data, stored);
+    rc = record_handler_->insert_record(stored.data(), (int)stored.size(), &record->rid);
+  }
+  else
+  {
+    rc = record_handler_->insert_record(record->data, record_data_size(), &record->rid);
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Insert record failed. table name=%s, rc=%d:%s", table_meta_.name(), rc, strrc(rc));
+    return rc;
+  }
+  zone_map_->update(record->rid.page_num, record->data);
+
+  // LOG_INFO("INSERT ENTRY OF INDEXES with data %d, rid:page_num :%d,slotnum :%d\n",record->data,record->rid.page_num,record->rid.slot_num);
+  // record->data为key,record->rid为value
+  rc = insert_entry_of_indexes(record->data, record->rid);
+  // 索引插入成功之后再记到事务中，插入失败的记录不会留在事务的操作里
+  if (rc == RC::SUCCESS && trx != nullptr)
+  {
+    rc = trx->insert_record(this, record);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to log operation(insertion) to trx");
+    }
+  }
+  if (rc != RC::SUCCESS)
+  {
+    RC rc2 = delete_entry_of_indexes(record->data, record->rid, true);
+    if (rc2 != RC::SUCCESS)
+    {
+      LOG_PANIC("Failed to rollback index data when insert index entries failed. table name=%s, rc=%d:%s",
+                name(), rc2, strrc(rc2));
+    }
+    rc2 = remove_record(record->rid);
+    if (rc2 != RC::SUCCESS)
+    {
+      LOG_PANIC("Failed to rollback record data when insert index entries failed. table name=%s, rc=%d:%s",
+                name(), rc2, strrc(rc2));
+    }
+    return rc;
+  }
+  row_change.add(1);
+  record_changed(1);
+  return rc;
+}
+
+RC Table::insert_record(Trx *trx, int value_num, const Value *values, Record **ret_record)
+{
+  common::TraceSpanScope span("storage", "insert_record");
+  // value_num->value的数量,values->value数组，ret_record->用于返回
+  if (value_num <= 0 || nullptr == values)
+  {
+    LOG_ERROR("Invalid argument. value num=%d, values=%p", value_num, values);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  // record_data只是单纯用来装数据
+  char *record_data;
+  RC rc = make_record(value_num, values, record_data);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to create a record. rc=%d:%s", rc, strrc(rc));
+    return rc;
+  }
+  Record record;
+  record.data = record_data;
+  // record.valid = true;
+  rc = insert_record(trx, &record);
+  if (ret_record != nullptr)
+  {
+    *ret_record = &record;
+  }
+  delete[] record_data;
+  return rc;
+}
+
+RC Table::insert_records(Trx *trx, int row_num, const int *value_nums, const Value *const *values)
+{
+  common::TraceSpanScope span("storage", "insert_records");
+  if (row_num <= 0 || nullptr == value_nums || nullptr == values)
+  {
+    LOG_ERROR("Invalid argument. row num=%d, value nums=%p, values=%p", row_num, value_nums, values);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  // 所有的记录都生成在一块内存中，有一行不合法时不需要回滚。没有事务时系统字段为0
+  const int record_size = record_data_size();
+  std::vector<char> buffer((size_t)row_num * record_size, 0);
+  std::vector<Record> records(row_num);
+  for (int i = 0; i < row_num; i++)
+  {
+    records[i].data = buffer.data() + (size_t)i * record_size;
+    RC rc = fill_record(value_nums[i], values[i], records[i].data);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to create record of row %d. rc=%d:%s", i, rc, strrc(rc));
+      return rc;
+    }
+  }
+  return insert_records(trx, records.data(), row_num);
+}
+
+RC Table::insert_records(Trx *trx, Record *records, int record_num, bool update_indexes)
+{
+  CompactLockGuard guard(compact_lock_, false);
+  if (partitioned())
+  {
+    return insert_partition_records(trx, records, record_num, update_indexes);
+  }
+  if (read_only_)
+  {
+    LOG_WARN("Cannot insert into table %s, it is mapped read only", name());
+    return RC::READONLY;
+  }
+  if (trx != nullptr)
+  {
+    for (int i = 0; i < record_num; i++)
+    {
+      RC rc = trx->init_trx_info(this, records[i]);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+    }
+  }
+
+  std::vector<const char *> rows(record_num);
+  std::vector<RID> rids(record_num);
+  RowCountChange row_change(row_count_, trx == nullptr);
+  PageVisibilityInsert visibility_insert(page_visibility_, trx != nullptr);
+  RC rc = zone_map_->mark_dirty();
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  if (in_memory())
+  {
+    for (int i = 0; i < record_num && rc == RC::SUCCESS; i++)
+    {
+      rc = mem_records_->insert_record(records[i].data, &rids[i]);
+      if (rc != RC::SUCCESS)
+      {
+        // 已经插入的记录在这里删掉，后面的回滚只处理所有记录都插入之后的失败
+        for (int j = 0; j < i; j++)
+        {
+          mem_records_->delete_record(rids[j]);
+        }
+      }
+    }
+  }
+  else if (variable_length())
+  {
+    std::vector<std::vector<char>> stored(record_num);
+    std::vector<int> lengths(record_num);
+    for (int i = 0; i < record_num; i++)
+    {
+      encode_record(records[i].data, stored[i]);
+      rows[i] = stored[i].data();
+      lengths[i] = (int)stored[i].size();
+    }
+    rc = record_handler_->insert_records(rows.data(), lengths.data(), record_num, rids.data());
+  }
+  else
+  {
+    for (int i = 0; i < record_num; i++)
+    {
+      rows[i] = records[i].data;
+    }
+    rc = record_handler_->insert_records(rows.data(), record_num, record_data_size(), rids.data());
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Insert records failed. table name=%s, rc=%d:%s", table_meta_.name(), rc, strrc(rc));
+    return rc;
+  }
+  for (int i = 0; i < record_num; i++)
+  {
+    records[i].rid = rids[i];
+    zone_map_->update(rids[i].page_num, records[i].data);
+  }
+
+  // 一个索引插入完所有的记录之后再插入下一个索引，访问的B+树页面更集中
+  // 延迟更新索引时由调用者在之后调用build_index_entries
+  for (size_t index_pos = 0; update_indexes && index_pos < indexes_.size(); index_pos++)
+  {
+    Index *index = indexes_[index_pos];
+    for (int i = 0; i < record_num && rc == RC::SUCCESS; i++)
+    {
+      rc = index->insert_entry(records[i].data, &records[i].rid);
+    }
+    if (rc != RC::SUCCESS)
+    {
+      break;
+    }
+  }
+  for (int i = 0; update_indexes && rc == RC::SUCCESS && i < record_num; i++)
+  {
+    log_index_change(true, records[i].data, records[i].rid);
+  }
+
+  if (rc == RC::SUCCESS && trx != nullptr)
+  {
+    rc = trx->insert_records(this, records, record_num);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to log operation(insertion) to trx");
+    }
+  }
+
+  if (rc != RC::SUCCESS)
+  {
+    for (int i = 0; i < record_num; i++)
+    {
+      RC rc2 = delete_entry_of_indexes(records[i].data, records[i].rid, true);
+      if (rc2 != RC::SUCCESS && rc2 != RC::RECORD_INVALID_KEY)
+      {
+        LOG_PANIC("Failed to rollback index data when insert index entries failed. table name=%s, rc=%d:%s",
+                  name(), rc2, strrc(rc2));
+      }
+      rc2 = remove_record(records[i].rid);
+      if (rc2 != RC::SUCCESS)
+      {
+        LOG_PANIC("Failed to rollback record data when insert index entries failed. table name=%s, rc=%d:%s",
+                  name(), rc2, strrc(rc2));
+      }
+    }
+  }
+  else
+  {
+    row_change.add(record_num);
+    record_changed(record_num);
+  }
+  return rc;
+}
+
+RC Table::insert_partition_records(Trx *trx, Record *records, int record_num, bool update_indexes)
+{
+  // 先确定所有记录的分区，有一条记录没有分区时什么都不插入
+  std::vector<std::vector<Record>> groups(partitions_.size());
+  std::vector<std::vector<int>> positions(partitions_.size());
+  for (int i = 0; i < record_num; i++)
+  {
+    const int index = table_meta_.find_partition(records[i].data);
+    if (index < 0)
+    {
+      LOG_WARN("No partition of table %s for record %d", name(), i);
+      return RC::INVALID_ARGUMENT;
+    }
+    groups[index].push_back(records[i]);
+    positions[index].push_back(i);
+  }
+  // 一个分区插入失败时已经插入其它分区的记录由事务回滚
+  for (size_t i = 0; i < partitions_.size(); i++)
+  {
+    if (groups[i].empty())
+    {
+      continue;
+    }
+    RC rc = partitions_[i]->insert_records(trx, groups[i].data(), (int)groups[i].size(), update_indexes);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+    for (size_t j = 0; j < groups[i].size(); j++)
+    {
+      records[positions[i][j]].rid = groups[i][j].rid;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC Table::build_index_entries(std::vector<RID> &rids)
+{
+  CompactLockGuard guard(compact_lock_, false);
+  if (indexes_.empty() || rids.empty())
+  {
+    return RC::SUCCESS;
+  }
+
+  // 按页面顺序访问记录，同一个页面上的记录只需要固定一次页面
+  std::sort(rids.begin(), rids.end(), [](const RID &a, const RID &b) {
+    return a.page_num < b.page_num || (a.page_num == b.page_num && a.slot_num < b.slot_num);
+  });
+
+  RC rc = RC::SUCCESS;
+  RecordPageHandler page_handler;
+  for (size_t i = 0; in_memory() && i < rids.size() && rc == RC::SUCCESS; i++)
+  {
+    Record record;
+    rc = mem_records_->get_record(rids[i], &record);
+    if (rc == RC::SUCCESS)
+    {
+      rc = insert_entry_of_indexes(record.data, record.rid);
+    }
+  }
+  for (size_t begin = 0, end = 0; !in_memory() && begin < rids.size() && rc == RC::SUCCESS; begin = end)
+  {
+    end = begin;
+    while (end < rids.size() && rids[end].page_num == rids[begin].page_num)
+    {
+      end++;
+    }
+
+    rc = page_handler.init(*data_buffer_pool_, file_id_, rids[begin].page_num);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to init record page handler. page num=%d, rc=%d:%s", rids[begin].page_num, rc, strrc(rc));
+      break;
+    }
+    std::vector<char> buffer(record_data_size());
+    for (size_t i = begin; i < end && rc == RC::SUCCESS; i++)
+    {
+      Record record;
+      rc = page_handler.get_record(&rids[i], &record);
+      if (rc == RC::SUCCESS && !record_in_page())
+      {
+        // 页面被固定着，再读一次完整的记录不会有额外的IO
+        rc = get_record(rids[i], &record, buffer);
+      }
+      if (rc == RC::SUCCESS)
+      {
+        rc = insert_entry_of_indexes(record.data, record.rid);
+      }
+    }
+    page_handler.deinit();
+  }
+
+  if (rc != RC::SUCCESS)
+  {
+    // 没有索引的记录不能留在表里，把这一批记录全部删掉
+    LOG_ERROR("Failed to build index entries, rollback %d records. table name=%s, rc=%d:%s",
+              (int)rids.size(), name(), rc, strrc(rc));
+    RowCountChange row_change(row_count_, true);
+    std::vector<char> buffer;
+    for (const RID &rid : rids)
+    {
+      Record record;
+      RC rc2 = get_record(rid, &record, buffer);
+      if (rc2 == RC::SUCCESS)
+      {
+        rc2 = delete_entry_of_indexes(record.data, rid, true);
+      }
+      if (rc2 != RC::SUCCESS && rc2 != RC::RECORD_INVALID_KEY)
+      {
+        LOG_PANIC("Failed to rollback index data when build index entries failed. table name=%s, rc=%d:%s",
+                  name(), rc2, strrc(rc2));
+      }
+      rc2 = remove_record(rid);
+      if (rc2 != RC::SUCCESS)
+      {
+        LOG_PANIC("Failed to rollback record data when build index entries failed. table name=%s, rc=%d:%s",
+                  name(), rc2, strrc(rc2));
+      }
+      else
+      {
+        row_change.add(-1);
+      }
+    }
+  }
+  return rc;
+}
+
+const char *Table::name() const
+{
+  return table_meta_.name();
+}
+
+const TableMeta &Table::table_meta() const
+{
+  return table_meta_;
+}
+
+RC Table::is_legal(const Value &value, const FieldMeta *field)
+{
+  // 比赛里暂时不要支持这种转换
+  // if (value.type == AttrType::INTS && field->type() == AttrType::FLOATS)
+  // {
+  //   // 允许int类型给float类型赋值，例如17 -> 17.00
+  //   return RC::SUCCESS;
+  // }
+
+  if (value.type == AttrType::NULLS)
+  {
+    // field->desc(std::cout);
+    if (!field->nullable())
+    {
+      LOG_ERROR("该列不允许插入null值");
+      return RC::SCHEMA_FIELD_NAME_ILLEGAL;
+    }
+  }
+  else if (field->type() != value.type)
+  {
+    LOG_ERROR("Invalid value type. field name=%s, type=%d, but given=%d",
+              field->name(), field->type(), value.type);
+    return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+  }
+
+  if (value.type == AttrType::CHARS)
+  {
+    // CHARS值需要判断长度，字典编码的字段按定义的长度
+    char *s = (char *)value.data;
+    if (strlen(s) > (size_t)field->value_len())
+    {
+      LOG_ERROR("待插入CHARS类型值过长");
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+  }
+
+  return RC::SUCCESS;
+}
+
+RC Table::make_record(int value_num, const Value *values, char *&record_out)
+{
+  // 写入record文件时按照record_data_size的长度复制，这里按同样的长度申请并清零，没有事务时系统字段为0
+  char *record = new char[record_data_size()]();
+  RC rc = fill_record(value_num, values, record);
+  if (rc != RC::SUCCESS)
+  {
+    delete[] record;
+    return rc;
+  }
+  record_out = record;
+  return RC::SUCCESS;
+}
+
+RC Table::fill_record(int value_num, const Value *values, char *record)
+{
+  // 首先确定插入的数据依次和当前的table属性一样
+  // 然后将制作好的record放在record中
+
+  // 检查字段类型是否一致
+  if (value_num + table_meta_.sys_field_num() != table_meta_.field_num())
+  {
+    return RC::SCHEMA_FIELD_MISSING;
+  }
+
+  Value new_value;
+  const int normal_field_start_index = table_meta_.sys_field_num();
+  for (int i = 0; i < value_num; i++)
+  {
+    const FieldMeta *field = table_meta_.field(i + normal_field_start_index);
+    const Value &value = values[i];
+
+    RC rc = is_legal(value, field);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+
+  // 复制所有字段的值，最后一个字段之后是null标志
+  for (int i = 0; i < value_num; i++)
+  {
+    const FieldMeta *field = table_meta_.field(i + normal_field_start_index);
+    const Value &value = values[i];
+    const NullFlag null_flag = table_meta_.null_flag(i + normal_field_start_index);
+
+    if (value.is_null)
+    {
+      // 如果是null值，int/float类型放0，char类型直接放null，date放0(1970-01-01)，字典编码的字段放0
+      switch (field->storage_type())
+      {
+      case AttrType::CHARS:
+      {
+        strncpy(record + field->offset(), "NULL", field->len());
+      }
+      break;
+      case AttrType::DATES:
+      {
+        int v = 0;
+        memcpy(record + field->offset(), &v, field->len());
+      }
+      break;
+      case AttrType::FLOATS:
+      {
+        float v = 0;
+        memcpy(record + field->offset(), &v, field->len());
+      }
+      break;
+      case AttrType::INTS:
+      {
+        int v = 0;
+        memcpy(record + field->offset(), &v, field->len());
+      }
+      break;
+      default:
+        break;
+      }
+
+      null_flag.set(record, true);
+    }
+    else if (field->dictionary() != nullptr)
+    {
+      int code = 0;
+      RC rc = encode_dictionary_value(*field, (const char *)value.data, &code);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+      memcpy(record + field->offset(), &code, sizeof(code));
+      null_flag.set(record, false);
+    }
+    else if (field->type() == CHARS)
+    {
+      // 字符串可能比字段短，不能按字段长度复制
+      strncpy(record + field->offset(), (const char *)value.data, field->len());
+      null_flag.set(record, false);
+    }
+    else
+    {
+      memcpy(record + field->offset(), value.data, field->len());
+      null_flag.set(record, false);
+    }
+    // LOG_INFO("name = %s,index = %d, is null = %d", field->name(), i, is_null);
+    // 用于char 乱码问题追踪测试   如果是char则存储中只会放入4字节内容
+    // if(value.type==1){
+    //   LOG_INFO("调用make record函数，将value值 %s 放进内存 record中结果为 %s",value.data,record+field->offset());
+    // }
+  }
+  return RC::SUCCESS;
+}
+
+RC Table::encode_dictionary_value(const FieldMeta &field, const char *value, int *code)
+{
+  Dictionary *dictionary = field.dictionary();
+  *code = dictionary->find(value);
+  if (*code >= 0 && *code < dictionary->saved_size())
+  {
+    return RC::SUCCESS;
+  }
+
+  std::lock_guard<std::mutex> lock(dictionary_mutex_);
+  bool added = false;
+  RC rc = dictionary->add(value, code, &added);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_WARN("Failed to add value to dictionary of %s.%s. rc=%d:%s", name(), field.name(), rc, strrc(rc));
+    return rc;
+  }
+  // 其它线程加的值可能已经一起保存了
+  if (*code < dictionary->saved_size())
+  {
+    return RC::SUCCESS;
+  }
+  const int size = dictionary->size();
+  {
+    CompactLockGuard guard(compact_lock_, false);
+    rc = save_meta(table_meta_);
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to save dictionary of %s.%s. rc=%d:%s", name(), field.name(), rc, strrc(rc));
+    return rc;
+  }
+  dictionary->set_saved_size(size);
+  return RC::SUCCESS;
+}
+
+bool Table::variable_length() const
+{
+  return record_handler_ != nullptr && record_handler_->variable_length();
+}
+
+bool Table::pax() const
+{
+  return record_handler_ != nullptr && record_handler_->pax();
+}
+
+/**
+ * CHARS字段的长度用几个字节保存
+ */
+static int chars_length_size(const FieldMeta *field)
+{
+  return field->len() <= UINT16_MAX ? (int)sizeof(uint16_t) : (int)sizeof(uint32_t);
+}
+
+void Table::encode_record(const char *data, std::vector<char> &stored) const
+{
+  stored.clear();
+  stored.reserve(record_data_size());
+  const int field_num = table_meta_.field_num();
+  for (int i = 0; i < field_num; i++)
+  {
+    const FieldMeta *field = table_meta_.field(i);
+    const char *value = data + field->offset();
+    if (field->storage_type() != CHARS)
+    {
+      stored.insert(stored.end(), value, value + field->len());
+      continue;
+    }
+    // 字符串只保存到第一个'\0'为止，前面是实际的长度
+    uint32_t len = (uint32_t)strnlen(value, field->len());
+    const int length_size = chars_length_size(field);
+    if (length_size == (int)sizeof(uint16_t))
+    {
+      uint16_t short_len = (uint16_t)len;
+      stored.insert(stored.end(), (const char *)&short_len, (const char *)&short_len + length_size);
+    }
+    else
+    {
+      stored.insert(stored.end(), (const char *)&len, (const char *)&len + length_size);
+    }
+    stored.insert(stored.end(), value, value + len);
+  }
+  // 最后是null标志
+  stored.insert(stored.end(), data + table_meta_.record_size(), data + record_data_size());
+}
+
+void Table::decode_record(const char *stored, char *data) const
+{
+  memset(data, 0, record_data_size());
+  const int field_num = table_meta_.field_num();
+  for (int i = 0; i < field_num; i++)
+  {
+    const FieldMeta *field = table_meta_.field(i);
+    char *value = data + field->offset();
+    if (field->storage_type() != CHARS)
+    {
+      memcpy(value, stored, field->len());
+      stored += field->len();
+      continue;
+    }
+    uint32_t len = 0;
+    const int length_size = chars_length_size(field);
+    if (length_size == (int)sizeof(uint16_t))
+    {
+      uint16_t short_len = 0;
+      memcpy(&short_len, stored, length_size);
+      len = short_len;
+    }
+    else
+    {
+      memcpy(&len, stored, length_size);
+    }
+    stored += length_size;
+    memcpy(value, stored, len);
+    stored += len;
+  }
+  memcpy(data + table_meta_.record_size(), stored, table_meta_.null_flags_size());
+}
+
+RC Table::get_record(const RID &rid, Record *record, std::vector<char> &buffer, RecordPageHandler *cursor)
+{
+  if (in_memory())
+  {
+    return mem_records_->get_record(rid, record);
+  }
+  if (record_in_page())
+  {
+    return cursor != nullptr ? record_handler_->get_record(&rid, record, *cursor)
+                             : record_handler_->get_record(&rid, record);
+  }
+
+  RC rc = RC::SUCCESS;
+  if (pax())
+  {
+    // 拼接出来的记录复制到buffer中，页面放开之后仍然有效
+    rc = cursor != nullptr ? record_handler_->get_record(&rid, buffer, *cursor)
+                           : record_handler_->get_record(&rid, buffer);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+    record->rid = rid;
+    record->data = buffer.data();
+    return RC::SUCCESS;
+  }
+
+  std::vector<char> stored;
+  rc = cursor != nullptr ? record_handler_->get_record(&rid, stored, *cursor)
+                         : record_handler_->get_record(&rid, stored);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  buffer.resize(record_data_size());
+  decode_record(stored.data(), buffer.data());
+  record->rid = rid;
+  record->data = buffer.data();
+  return RC::SUCCESS;
+}
+
+void Table::lock_records()
+{
+  pthread_rwlock_rdlock(&compact_lock_);
+}
+
+void Table::unlock_records()
+{
+  pthread_rwlock_unlock(&compact_lock_);
+}
+
+RC Table::fetch_record(const RID &rid, std::vector<char> &data, RecordPageHandler *cursor)
+{
+  Record record;
+  RC rc = get_record(rid, &record, data, cursor);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to fetch record of rid=%d:%d, rc=%d:%s", rid.page_num, rid.slot_num, rc, strrc(rc));
+    return rc;
+  }
+  if (record.data != data.data())
+  {
+    // 定长记录指向页面中的数据
+    data.assign(record.data, record.data + record_data_size());
+  }
+  return RC::SUCCESS;
+}
+
+RC Table::write_record(const Record &record)
+{
+  RC rc = zone_map_->mark_dirty();
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  if (in_memory())
+  {
+    rc = mem_records_->update_record(record.rid, record.data);
+  }
+  else if (!variable_length())
+  {
+    rc = record_handler_->update_record(&record);
+  }
+  else
+  {
+    std::vector<char> stored;
+    encode_record(record.data, stored);
+    rc = record_handler_->update_record(&record.rid, stored.data(), (int)stored.size());
+  }
+  if (rc == RC::SUCCESS)
+  {
+    zone_map_->update(record.rid.page_num, record.data);
+  }
+  return rc;
+}
+
+RC Table::write_back_trx_field(const Record &record)
+{
+  // 事务字段是第一个字段，编码之后的位置不变，而且总是在页面内。PAX页面在更新之后写回各列。
+  // 定长记录已经直接修改了页面，也要标记为脏页，否则页面被淘汰时修改会丢失，开启redo日志时也不会写到日志中
+  const FieldMeta *trx_field = table_meta_.trx_field();
+  if (in_memory())
+  {
+    Record stored;
+    RC rc = mem_records_->get_record(record.rid, &stored);
+    if (rc == RC::SUCCESS && stored.data != record.data)
+    {
+      memcpy(stored.data + trx_field->offset(), record.data + trx_field->offset(), trx_field->len());
+    }
+    return rc;
+  }
+  return record_handler_->update_record_in_place(&record.rid, [&record, trx_field](Record &stored) {
+    if (stored.data != record.data)
+    {
+      memcpy(stored.data + trx_field->offset(), record.data + trx_field->offset(), trx_field->len());
+    }
+    return RC::SUCCESS;
+  });
+}
+
+RC Table::remove_record(const RID &rid)
+{
+  if (in_memory())
+  {
+    return mem_records_->delete_record(rid);
+  }
+  return record_handler_->delete_record(&rid);
+}
+
+RC Table::init_mem_records()
+{
+  mem_records_ = new MemRecordStore(record_data_size());
+  zone_map_ = new ZoneMap();
+  // 内存表的记录数只在内存中维护，从0开始
+  row_count_.init(std::string());
+  return RC::SUCCESS;
+}
+
+RC Table::init_record_handler(const char *base_dir, bool variable_length, const std::vector<int> &pax_columns)
+{
+  std::string data_file = std::string(base_dir) + "/" + table_meta_.name() + TABLE_DATA_SUFFIX;
+  if (nullptr == data_buffer_pool_)
+  {
+    // 数据文件头中记录了页面大小，使用对应的缓冲池
+    int page_size = BP_PAGE_SIZE;
+    RC rc = DiskBufferPool::read_file_page_size(data_file.c_str(), &page_size);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to read page size of data file:%s. rc=%d:%s", data_file.c_str(), rc, strrc(rc));
+      return rc;
+    }
+    data_buffer_pool_ = theGlobalDiskBufferPool(page_size);
+  }
+
+  int data_buffer_pool_file_id;
+  RC rc = data_buffer_pool_->open_file(data_file.c_str(), &data_buffer_pool_file_id);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to open disk buffer pool for file:%s. rc=%d:%s",
+              data_file.c_str(), rc, strrc(rc));
+    return rc;
+  }
+
+  record_handler_ = new RecordFileHandler();
+  if (!pax_columns.empty())
+  {
+    rc = record_handler_->init(*data_buffer_pool_, data_buffer_pool_file_id, pax_columns);
+  }
+  else
+  {
+    rc = record_handler_->init(*data_buffer_pool_, data_buffer_pool_file_id, variable_length);
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to init record handler. rc=%d:%s", rc, strrc(rc));
+    return rc;
+  }
+
+  file_id_ = data_buffer_pool_file_id;
+  return rc;
+}
+
+struct ZoneMapBuildContext
+{
+  Table *table;
+  ZoneMap *zone_map;
+  bool variable_length;
+  std::vector<char> buffer;
+};
+
+static RC zone_map_build_adapter(Record *record, void *context)
+{
+  ZoneMapBuildContext &build_context = *(ZoneMapBuildContext *)context;
+  const char *data = record->data;
+  if (build_context.variable_length)
+  {
+    build_context.table->decode_record(record->data, build_context.buffer.data());
+    data = build_context.buffer.data();
+  }
+  build_context.zone_map->update(record->rid.page_num, data);
+  return RC::SUCCESS;
+}
+
+RC Table::init_undo_file(const char *base_dir)
+{
+  undo_file_ = new UndoFile();
+  RC rc = undo_file_->open(theGlobalDiskBufferPool(), std::string(base_dir) + "/" + table_meta_.name() + TABLE_UNDO_SUFFIX);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to open undo file of table %s. rc=%d:%s", name(), rc, strrc(rc));
+  }
+  return rc;
+}
+
+RC Table::init_zone_map(const char *base_dir)
+{
+  zone_map_ = new ZoneMap();
+  if (Trx::replica())
+  {
+    // 重放的页面不经过zone map，备库上不维护，不用它跳过页面
+    return RC::SUCCESS;
+  }
+  zone_map_->init(table_meta_, std::string(base_dir) + "/" + table_meta_.name() + TABLE_ZONE_SUFFIX);
+  if (!zone_map_->enabled() || zone_map_->load() == RC::SUCCESS)
+  {
+    return RC::SUCCESS;
+  }
+
+  // 文件不存在或者上次没有正常关闭，扫描所有的记录重建
+  return build_zone_map();
+}
+
+RC Table::init_row_count(const char *base_dir, bool created)
+{
+  row_count_.init(std::string(base_dir) + "/" + table_meta_.name() + TABLE_COUNT_SUFFIX);
+  if (created)
+  {
+    return row_count_.reset();
+  }
+  if (row_count_.load() != RC::SUCCESS)
+  {
+    // 记录数未知，没有过滤条件的COUNT(*)第一次扫描全表时得到
+    LOG_INFO("Row count of table %s is unknown", name());
+  }
+  return RC::SUCCESS;
+}
+
+RC Table::build_zone_map()
+{
+  zone_map_->clear();
+  RecordFileScanner scanner;
+  RC rc = scanner.open_scan(*data_buffer_pool_, file_id_, nullptr);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to open scanner to build zone map. table=%s, rc=%d:%s", name(), rc, strrc(rc));
+    return rc;
+  }
+  ZoneMapBuildContext build_context = {this, zone_map_, variable_length(), std::vector<char>(record_data_size())};
+  rc = scanner.visit_records(zone_map_build_adapter, &build_context);
+  scanner.close_scan();
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to build zone map. table=%s, rc=%d:%s", name(), rc, strrc(rc));
+    return rc;
+  }
+  LOG_INFO("Build zone map of table %s by scanning records", name());
+  return RC::SUCCESS;
+}
+
+/**
+ * 只读取需要重建布隆过滤器的区段中的页面
+ */
+static bool bloom_extent_page_filter(PageNum page_num, void *context)
+{
+  const std::unordered_set<int> &extents = *(const std::unordered_set<int> *)context;
+  return extents.count(page_num / ZONE_MAP_EXTENT_PAGES) > 0;
+}
+
+RC Table::rebuild_bloom_filters(const std::unordered_set<int> &extents)
+{
+  for (int extent : extents)
+  {
+    zone_map_->reset_extent_bloom_filter(extent);
+  }
+  RecordFileScanner scanner;
+  RC rc = scanner.open_scan(*data_buffer_pool_, file_id_, nullptr);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to open scanner to rebuild bloom filters. table=%s, rc=%d:%s", name(), rc, strrc(rc));
+    return rc;
+  }
+  scanner.set_page_filter(bloom_extent_page_filter, (void *)&extents);
+  // 区段中的记录都重新update一遍，页面的范围本来就包含这些值，不会变化
+  ZoneMapBuildContext build_context = {this, zone_map_, variable_length(), std::vector<char>(record_data_size())};
+  rc = scanner.visit_records(zone_map_build_adapter, &build_context);
+  scanner.close_scan();
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to rebuild bloom filters. table=%s, rc=%d:%s", name(), rc, strrc(rc));
+  }
+  return rc;
+}
+
+struct TrxRecordCollector
+{
+  const FieldMeta *trx_field;
+  std::vector<RID> rids;
+};
+
+/**
+ * 记录上的事务字段不是0，也就是还有没有完成提交或回滚的事务
+ */
+static bool has_trx_mark(const FieldMeta *trx_field, const char *data)
+{
+  static const char zeros[sizeof(int64_t)] = {0};
+  return memcmp(data + trx_field->offset(), zeros, trx_field->len()) != 0;
+}
+
+static RC trx_record_collect_adapter(Record *record, void *context)
+{
+  // 事务字段是第一个字段，编码之后的位置不变
+  TrxRecordCollector &collector = *(TrxRecordCollector *)context;
+  if (has_trx_mark(collector.trx_field, record->data))
+  {
+    collector.rids.push_back(record->rid);
+  }
+  return RC::SUCCESS;
+}
+
+RC Table::recover_trx_records()
+{
+  RecordFileScanner scanner;
+  RC rc = scanner.open_scan(*data_buffer_pool_, file_id_, nullptr);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to open scanner to recover records. table=%s, rc=%d:%s", name(), rc, strrc(rc));
+    return rc;
+  }
+  const FieldMeta *trx_field = table_meta_.trx_field();
+  TrxRecordCollector collector = {trx_field, std::vector<RID>()};
+  rc = scanner.visit_records(trx_record_collect_adapter, &collector);
+  scanner.close_scan();
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to collect records to recover. table=%s, rc=%d:%s", name(), rc, strrc(rc));
+    return rc;
+  }
+
+  RedoLog &redo_log = RedoLog::instance();
+  int committed = 0;
+  int rolled_back = 0;
+  std::vector<char> buffer;
+  for (const RID &rid : collector.rids)
+  {
+    Record record;
+    rc = get_record(rid, &record, buffer);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to read record to recover. table=%s, rid=%d.%d, rc=%d:%s",
+                name(), rid.page_num, rid.slot_num, rc, strrc(rc));
+      return rc;
+    }
+    int64_t trx_id = 0;
+    bool deleted = false;
+    Trx::get_record_trx_id(this, record, trx_id, deleted);
+    const bool commit = redo_log.recovered_committed(trx_id);
+    const std::string *undo = commit ? nullptr : redo_log.recovered_undo(name(), trx_id, rid.page_num, rid.slot_num);
+    if (undo != nullptr && (int)undo->size() == record_data_size())
+    {
+      // 回滚更新或者删除，恢复成修改之前已经提交的内容
+      rc = restore_record(rid, undo->data(), true);
+    }
+    else if (!commit || deleted)
+    {
+      // 提交删除或者回滚插入，回滚插入时索引可能还没有插入
+      rc = delete_entry_of_indexes(record.data, rid, false);
+      if (rc != RC::SUCCESS && rc != RC::RECORD_INVALID_KEY)
+      {
+        LOG_WARN("Failed to delete index entries of record while recovering. table=%s, rid=%d.%d, rc=%d:%s",
+                 name(), rid.page_num, rid.slot_num, rc, strrc(rc));
+      }
+      rc = remove_record(rid);
+    }
+    else
+    {
+      // 提交插入和更新，清除事务字段
+      memset(record.data + trx_field->offset(), 0, trx_field->len());
+      rc = write_back_trx_field(record);
+    }
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to recover record. table=%s, rid=%d.%d, rc=%d:%s",
+                name(), rid.page_num, rid.slot_num, rc, strrc(rc));
+      return rc;
+    }
+    commit ? committed++ : rolled_back++;
+  }
+  if (!collector.rids.empty())
+  {
+    data_changed();
+    LOG_INFO("Recover table %s: %d records of committed trx, %d records of rolled back trx",
+             name(), committed, rolled_back);
+  }
+  return RC::SUCCESS;
+}
+
+/**
+ * 以前的版本把日期保存成yyyymmdd格式的整数，都比现在保存的天数大
+ */
+#define LEGACY_DATE_MIN 10000000
+
+static bool upgrade_date(char *data)
+{
+  int value = 0;
+  memcpy(&value, data, sizeof(value));
+  if (value < LEGACY_DATE_MIN)
+  {
+    return false;
+  }
+  value = common::days_from_civil(value / 10000, value / 100 % 100, value % 100);
+  memcpy(data, &value, sizeof(value));
+  return true;
+}
+
+static RC rid_collect_adapter(Record *record, void *context)
+{
+  ((std::vector<RID> *)context)->push_back(record->rid);
+  return RC::SUCCESS;
+}
+
+RC Table::upgrade_dates()
+{
+  std::vector<int> date_offsets;
+  for (int i = table_meta_.sys_field_num(); i < table_meta_.field_num(); i++)
+  {
+    if (table_meta_.field(i)->type() == DATES)
+    {
+      date_offsets.push_back(table_meta_.field(i)->offset());
+    }
+  }
+
+  // 范围分区的上界先转换，哈希分区转换之后记录所在的分区按新的值计算
+  TableMeta new_table_meta(table_meta_);
+  const FieldMeta *partition_field = table_meta_.partition_field();
+  if (partitioned() && partition_field->type() == DATES)
+  {
+    std::vector<PartitionMeta> partitions;
+    for (int i = 0; i < table_meta_.partition_num(); i++)
+    {
+      const PartitionMeta &partition = *table_meta_.partition(i);
+      partitions.push_back(partition);
+      if (!partition.has_bound())
+      {
+        continue;
+      }
+      std::string bound(partition.bound(), partition_field->len());
+      upgrade_date(&bound[0]);
+      Value value = {DATES, &bound[0], 0};
+      RC rc = partitions.back().init(partition.name(), *partition_field, &value);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+    }
+    RC rc = new_table_meta.set_partitions(table_meta_.partition_type(), partition_field->name(), partitions);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to upgrade partition bounds of table %s. rc=%d:%s", name(), rc, strrc(rc));
+      return rc;
+    }
+    TableMeta copy(new_table_meta);
+    table_meta_.swap(copy);
+  }
+
+  RC rc = RC::SUCCESS;
+  if (!date_offsets.empty() && !in_memory())
+  {
+    const bool rehash = table_meta_.partition_type() == HASH_PARTITION && partition_field->type() == DATES;
+    for (size_t i = 0; rc == RC::SUCCESS && i < partitions_.size(); i++)
+    {
+      rc = partitions_[i]->upgrade_date_records(date_offsets, rehash ? this : nullptr, (int)i);
+    }
+    if (rc == RC::SUCCESS && !partitioned())
+    {
+      rc = upgrade_date_records(date_offsets, nullptr, 0);
+    }
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to upgrade dates of table %s. rc=%d:%s", name(), rc, strrc(rc));
+      return rc;
+    }
+  }
+
+  new_table_meta.set_date_in_days(true);
+  rc = save_meta(new_table_meta);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to save meta of table %s after upgrading dates. rc=%d:%s", name(), rc, strrc(rc));
+    return rc;
+  }
+  table_meta_.swap(new_table_meta);
+  for (Table *partition : partitions_)
+  {
+    partition->table_meta_.set_date_in_days(true);
+  }
+  LOG_INFO("Upgrade dates of table %s to days since 1970-01-01. date fields=%d",
+           name(), (int)date_offsets.size());
+
+  // 直方图还是旧的编码，重新统计
+  if (!date_offsets.empty() && table_meta_.analyzed() && !in_memory())
+  {
+    rc = analyze_table();
+  }
+  return rc;
+}
+
+RC Table::upgrade_date_records(const std::vector<int> &date_offsets, Table *parent, int partition_index)
+{
+  RecordFileScanner scanner;
+  RC rc = scanner.open_scan(*data_buffer_pool_, file_id_, nullptr);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to open scanner to upgrade dates. table=%s, rc=%d:%s", name(), rc, strrc(rc));
+    return rc;
+  }
+  std::vector<RID> rids;
+  rc = scanner.visit_records(rid_collect_adapter, &rids);
+  scanner.close_scan();
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to collect records to upgrade dates. table=%s, rc=%d:%s", name(), rc, strrc(rc));
+    return rc;
+  }
+
+  std::vector<char> buffer;
+  std::vector<char> data;
+  int upgraded = 0;
+  int moved = 0;
+  for (const RID &rid : rids)
+  {
+    Record record;
+    rc = get_record(rid, &record, buffer);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to read record to upgrade dates. table=%s, rid=%d.%d, rc=%d:%s",
+                name(), rid.page_num, rid.slot_num, rc, strrc(rc));
+      return rc;
+    }
+    // null值也保存了日期，一起转换
+    data.assign(record.data, record.data + record_data_size());
+    bool changed = false;
+    for (int offset : date_offsets)
+    {
+      changed = upgrade_date(data.data() + offset) || changed;
+    }
+    const int target = parent == nullptr ? partition_index : parent->table_meta_.find_partition(data.data());
+    if (!changed && target == partition_index)
+    {
+      continue;
+    }
+
+    rc = delete_entry_of_indexes(record.data, rid, false);
+    if (rc != RC::SUCCESS && rc != RC::RECORD_INVALID_KEY)
+    {
+      LOG_ERROR("Failed to delete index entries to upgrade dates. table=%s, rid=%d.%d, rc=%d:%s",
+                name(), rid.page_num, rid.slot_num, rc, strrc(rc));
+      return rc;
+    }
+    Record new_record;
+    new_record.rid = rid;
+    new_record.data = data.data();
+    if (target == partition_index)
+    {
+      rc = write_record(new_record);
+      if (rc == RC::SUCCESS)
+      {
+        rc = insert_entry_of_indexes(new_record.data, rid);
+      }
+    }
+    else
+    {
+      // 哈希值变了，移到新的分区
+      rc = remove_record(rid);
+      if (rc == RC::SUCCESS)
+      {
+        rc = parent->partitions_[target]->insert_record(nullptr, &new_record);
+      }
+      moved++;
+    }
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to upgrade dates of record. table=%s, rid=%d.%d, rc=%d:%s",
+                name(), rid.page_num, rid.slot_num, rc, strrc(rc));
+      return rc;
+    }
+    upgraded++;
+  }
+
+  // 页面上的范围还包括旧的值，重建zone map
+  if (upgraded > 0 && zone_map_->enabled())
+  {
+    rc = build_zone_map();
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+  if (upgraded > 0)
+  {
+    data_changed();
+  }
+  LOG_INFO("Upgrade dates of %d records in table %s, %d records moved to other partitions", upgraded, name(), moved);
+  return sync();
+}
+
+static void count_record_adapter(const char *data, void *context)
+{
+  (*(int64_t *)context)++;
+}
+
+bool Table::maintained_row_count(Trx *trx, int64_t *count, uint64_t *epoch)
+{
+  *epoch = 0;
+  if (trx == nullptr)
+  {
+    return false;
+  }
+  if (!partitioned())
+  {
+    int64_t known = -1;
+    uint64_t known_epoch = 0;
+    if (!trx->latest_row_count(this, &known, &known_epoch))
+    {
+      return false;
+    }
+    if (known < 0)
+    {
+      *epoch = known_epoch;
+      return false;
+    }
+    *count = known;
+    return true;
+  }
+
+  // 每个分区分别维护记录数，记录数未知的分区单独扫描一次
+  CompactLockGuard guard(compact_lock_, false);
+  int64_t total = 0;
+  for (Table *partition : partitions_)
+  {
+    int64_t partition_count = -1;
+    uint64_t partition_epoch = 0;
+    if (!trx->latest_row_count(partition, &partition_count, &partition_epoch))
+    {
+      return false;
+    }
+    if (partition_count < 0)
+    {
+      partition_count = 0;
+      const std::vector<int> no_columns;
+      if (partition->scan_record(trx, nullptr, -1, &partition_count, count_record_adapter, &no_columns) != RC::SUCCESS)
+      {
+        return false;
+      }
+      partition->learn_row_count(partition_epoch, partition_count);
+    }
+    total += partition_count;
+  }
+  *count = total;
+  return true;
+}
+
+RC Table::scan_record(Trx *trx, ConditionFilter *filter, int limit, void *context, void (*record_reader)(const char *data, void *context),
+                      const std::vector<int> *field_indexes)
+{
+  TableScanner scanner;
+  RC rc = scanner.open(trx, this, filter, limit, field_indexes);
+  while (RC::SUCCESS == rc)
+  {
+    rc = scanner.next_batch(context, record_reader);
+  }
+  scanner.close();
+  return RC::RECORD_EOF == rc ? RC::SUCCESS : rc;
+}
+
+bool Table::collect_filter_columns(const ConditionFilter *filter, std::vector<int> &columns) const
+{
+  if (filter == nullptr)
+  {
+    return true;
+  }
+  const CompositeConditionFilter *composite_filter = dynamic_cast<const CompositeConditionFilter *>(filter);
+  if (composite_filter != nullptr)
+  {
+    for (int i = 0; i < composite_filter->filter_num(); i++)
+    {
+      if (!collect_filter_columns(&composite_filter->filter(i), columns))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+  const DefaultConditionFilter *default_filter = dynamic_cast<const DefaultConditionFilter *>(filter);
+  if (default_filter == nullptr)
+  {
+    return false;
+  }
+  for (const ConDesc *desc : {&default_filter->left(), &default_filter->right()})
+  {
+    if (!desc->is_attr)
+    {
+      continue;
+    }
+    const FieldMeta *field = table_meta_.find_field_by_offset(desc->attr_offset);
+    if (field == nullptr)
+    {
+      return false;
+    }
+    columns.push_back(table_meta_.find_field_index_by_name(field->name()));
+  }
+  return true;
+}
+
+struct ScanVisitContext
+{
+  Table *table;
+  Trx *trx;
+  ConditionFilter *filter;
+  bool page_filtered;  // 过滤条件已经在页面上判断过了
+  int limit;
+  int record_count;
+  void *context;
+  RC (*record_reader)(Record *record, void *context);
+  std::vector<char> version;  // 页面上的版本不可见时读到的更早的版本
+  unsigned int cancel_check = 0;
+};
+
+static RC scan_visit_adapter(Record *record, void *context)
+{
+  ScanVisitContext &visit_context = *(ScanVisitContext *)context;
+  // 不满足条件的记录也计数，过滤掉大部分记录的扫描也能及时停下来
+  if (QueryCancel::poll(visit_context.cancel_check))
+  {
+    return RC::INTERRUPT;
+  }
+  const char *data = record->data;
+  if (visit_context.trx != nullptr && !visit_context.trx->is_visible(visit_context.table, record, visit_context.version))
+  {
+    return RC::SUCCESS;
+  }
+  // 读到的是更早的版本时，页面上判断的过滤条件不算数
+  if (visit_context.filter != nullptr && (!visit_context.page_filtered || record->data != data) &&
+      !visit_context.filter->filter(*record))
+  {
+    return RC::SUCCESS;
+  }
+  // 将record添加进tupleset
+  RC rc = visit_context.record_reader(record, visit_context.context);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  if (++visit_context.record_count >= visit_context.limit)
+  {
+    return RC::RECORD_EOF;
+  }
+  return RC::SUCCESS;
+}
+
+/**
+ * 变长记录先解码，过滤条件按照字段的偏移访问记录，只能在解码之后判断
+ */
+struct DecodeVisitContext
+{
+  ScanVisitContext *scan_context;
+  std::vector<char> buffer;
+};
+
+static RC decode_visit_adapter(Record *record, void *context)
+{
+  DecodeVisitContext &visit_context = *(DecodeVisitContext *)context;
+  Record decoded;
+  decoded.rid = record->rid;
+  decoded.data = visit_context.buffer.data();
+  visit_context.scan_context->table->decode_record(record->data, decoded.data);
+  return scan_visit_adapter(&decoded, visit_context.scan_context);
+}
+
+/**
+ * zone map判断页面上不可能有满足条件的记录时跳过页面
+ */
+struct ZoneMapPageFilterContext
+{
+  const ZoneMap *zone_map;
+  const ConditionFilter *filter;
+  int skipped_pages;
+};
+
+static bool zone_map_page_filter(PageNum page_num, void *context)
+{
+  ZoneMapPageFilterContext &filter_context = *(ZoneMapPageFilterContext *)context;
+  if (filter_context.zone_map->may_match(page_num, filter_context.filter))
+  {
+    return true;
+  }
+  filter_context.skipped_pages++;
+  return false;
+}
+
+RC Table::scan_record(Trx *trx, ConditionFilter *filter, int limit, void *context, RC (*record_reader)(Record *record, void *context),
+                      const std::vector<int> *columns)
+{
+  if (nullptr == record_reader)
+  {
+    return RC::INVALID_ARGUMENT;
+  }
+
+  if (0 == limit)
+  {
+    return RC::SUCCESS;
+  }
+
+  if (limit < 0)
+  {
+    limit = INT_MAX;
+  }
+
+  if (trx != nullptr)
+  {
+    trx->acquire_read_view();
+  }
+  // filter == nullptr，则index_scanner也为nullptr
+  IndexScanner *index_scanner = find_index_for_scan(filter);
+  if (index_scanner != nullptr)
+  {
+    return scan_record_by_index(trx, index_scanner, filter, limit, context, record_reader);
+  }
+  if (in_memory())
+  {
+    ScanVisitContext visit_context = {this, trx, filter, false, limit, 0, context, record_reader, std::vector<char>()};
+    return mem_records_->visit_records(scan_visit_adapter, &visit_context);
+  }
+  // filter == nullptr时，scanner会扫描所有元组。
+  // 可能读到更早的版本时，页面上的数据不满足条件的记录也可能可见，过滤条件在判断可见性之后判断
+  const bool page_filtered = !variable_length() && (trx == nullptr || trx->all_visible(this));
+  RC rc = RC::SUCCESS;
+  RecordFileScanner scanner;
+  rc = scanner.open_scan(*data_buffer_pool_, file_id_, page_filtered ? filter : nullptr);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("failed to open scanner. file id=%d. rc=%d:%s", file_id_, rc, strrc(rc));
+    return rc;
+  }
+  if (columns != nullptr)
+  {
+    scanner.set_columns(*columns);
+  }
+  ZoneMapPageFilterContext page_filter_context = {zone_map_, filter, 0};
+  if (filter != nullptr && zone_map_->enabled())
+  {
+    scanner.set_page_filter(zone_map_page_filter, &page_filter_context);
+  }
+
+  // 按页面访问记录，过滤条件和可见性直接在页面数据上判断，只有满足条件的记录交给record_reader
+  ScanVisitContext visit_context = {this, trx, filter, page_filtered, limit, 0, context, record_reader,
+                                    std::vector<char>()};
+  if (variable_length())
+  {
+    DecodeVisitContext decode_context = {&visit_context, std::vector<char>(record_data_size())};
+    rc = scanner.visit_records(decode_visit_adapter, &decode_context);
+  }
+  else
+  {
+    rc = scanner.visit_records(scan_visit_adapter, &visit_context);
+  }
+  if (RC::RECORD_EOF == rc)
+  {
+    rc = RC::SUCCESS;
+  }
+  else if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("failed to scan record. file id=%d, rc=%d:%s", file_id_, rc, strrc(rc));
+  }
+  if (page_filter_context.skipped_pages > 0)
+  {
+    LOG_DEBUG("Skip %d pages of table %s by zone map", page_filter_context.skipped_pages, name());
+  }
+  scanner.close_scan();
+  return rc;
+}
+
+RC Table::scan_target_records(Trx *trx, ConditionFilter *filter, void *context, RC (*record_reader)(Record *, void *))
+{
+  IndexScanner *index_scanner = find_index_for_scan(filter);
+  if (nullptr == index_scanner)
+  {
+    // 顺序扫描时修改的记录rid不变，不会再次访问到
+    return scan_record(trx, filter, -1, context, record_reader);
+  }
+  if (trx != nullptr)
+  {
+    trx->acquire_read_view();
+  }
+  return scan_record_by_index(trx, index_scanner, filter, INT_MAX, context, record_reader);
+}
+
+RC Table::scan_record_by_index(Trx *trx, IndexScanner *scanner, ConditionFilter *filter, int limit, void *context,
+                               RC (*record_reader)(Record *, void *))
+{
+  // 先从索引中取出所有的rid再回表，record_reader修改记录和索引（比如update索引字段）时
+  // 不会影响正在进行的索引扫描，回表时也不用一直固定着索引页面
+  RC rc = RC::SUCCESS;
+  RID rid;
+  std::vector<RID> rids;
+  while ((rc = scanner->next_entry(&rid)) == RC::SUCCESS)
+  {
+    rids.push_back(rid);
+  }
+  scanner->destroy();
+  if (rc != RC::RECORD_EOF)
+  {
+    LOG_ERROR("Failed to scan table by index. rc=%d:%s", rc, strrc(rc));
+    return rc;
+  }
+  // 要在补上旧版本的记录之前求交集，旧版本在所有的索引中都可能没有
+  rc = intersect_index_rids(filter, rids);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  if (trx != nullptr)
+  {
+    // 更早的版本可能在索引中已经没有了，按过滤条件判断
+    Trx::add_version_rids(this, rids);
+  }
+  // 按页面的顺序回表，同一个页面上的记录一起访问，每个页面只读一次
+  std::sort(rids.begin(), rids.end());
+
+  rc = RC::SUCCESS;
+  Record record;
+  std::vector<char> buffer;
+  std::vector<char> version;
+  int record_count = 0;
+  unsigned int cancel_check = 0;
+  for (const RID &index_rid : rids)
+  {
+    if (record_count >= limit)
+    {
+      break;
+    }
+    if (QueryCancel::poll(cancel_check))
+    {
+      rc = RC::INTERRUPT;
+      break;
+    }
+    // 根据rid获取record
+    rc = get_record(index_rid, &record, buffer);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to fetch record of rid=%d:%d, rc=%d:%s",
+                index_rid.page_num, index_rid.slot_num, rc, strrc(rc));
+      break;
+    }
+
+    // 索引只给出了范围，记录还需要满足所有的过滤条件
+    if ((trx == nullptr || trx->is_visible(this, &record, version)) && (filter == nullptr || filter->filter(record)))
+    {
+      rc = record_reader(&record, context);
+      if (rc != RC::SUCCESS)
+      {
+        LOG_TRACE("Record reader break the table scanning. rc=%d:%s", rc, strrc(rc));
+        break;
+      }
+      record_count++;
+    }
+  }
+  return rc;
+}
+
+class IndexInserter
+{
+public:
+  explicit IndexInserter(Index *index) : index_(index)
+  {
+  }
+
+  RC insert_index(const Record *record)
+  {
+    return index_->bulk_load_entry(record->data, &record->rid);
+  }
+
+private:
+  Index *index_;
+};
+
+static RC insert_index_record_reader_adapter(Record *record, void *context)
+{
+  IndexInserter &inserter = *(IndexInserter *)context;
+  return inserter.insert_index(record);
+}
+
+std::vector<const char *> Table::get_index_names()
+{
+  std::vector<const char *> res;
+  for (auto idx : indexes_)
+  {
+    LOG_ERROR("index_name = %s", idx->index_meta().name());
+    res.push_back(idx->index_meta().name());
+  }
+
+  return res;
+}
+
+Index *Table::find_index_for_lookup(const char *field_name) const
+{
+  if (Trx::replica())
+  {
+    return nullptr;
+  }
+  for (Index *index : indexes_)
+  {
+    const IndexMeta &index_meta = index->index_meta();
+    if (index_meta.type() == BPLUS_TREE_INDEX && 0 == strcmp(index_meta.field(0), field_name) &&
+        index_meta.prefix_length(0) == 0)
+    {
+      return index;
+    }
+  }
+  return nullptr;
+}
+
+struct StatsCollector
+{
+  std::vector<const FieldMeta *> fields;  // 需要统计不同值个数的字段
+  std::vector<NullFlag> null_flags;       // 这些字段的null标志
+  std::vector<std::unordered_set<std::string>> values;
+  int row_count = 0;
+};
+
+static void collect_stats_record_reader(const char *data, void *context)
+{
+  StatsCollector &collector = *(StatsCollector *)context;
+  collector.row_count++;
+  for (size_t i = 0; i < collector.fields.size(); i++)
+  {
+    if (collector.null_flags[i].test(data))
+    {
+      continue;
+    }
+    const FieldMeta *field = collector.fields[i];
+    const char *value = data + field->offset();
+    const int len = CHARS == field->storage_type() ? strnlen(value, field->len()) : field->len();
+    collector.values[i].emplace(value, len);
+  }
+}
+
+RC Table::analyze()
+{
+  StatsCollector collector;
+  std::vector<int> field_indexes;
+  for (int i = 0; i < table_meta_.index_num(); i++)
+  {
+    const char *field_name = table_meta_.index(i)->field(0);
+    int field_index = table_meta_.find_field_index_by_name(field_name);
+    if (std::find(field_indexes.begin(), field_indexes.end(), field_index) != field_indexes.end())
+    {
+      continue;
+    }
+    field_indexes.push_back(field_index);
+    collector.fields.push_back(table_meta_.field(field_index));
+    collector.null_flags.push_back(table_meta_.null_flag(field_index));
+  }
+  collector.values.resize(collector.fields.size());
+
+  // 先清零，统计期间的修改计入下一次
+  stats_row_delta_ = 0;
+  stats_changes_ = 0;
+  RC rc = scan_record(nullptr, nullptr, -1, &collector, collect_stats_record_reader, &field_indexes);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to collect statistics of table %s. rc=%d:%s", name(), rc, strrc(rc));
+    return rc;
+  }
+
+  stats_.row_count = collector.row_count;
+  stats_.distinct_counts.assign(table_meta_.field_num(), -1);
+  for (size_t i = 0; i < field_indexes.size(); i++)
+  {
+    stats_.distinct_counts[field_indexes[i]] = collector.values[i].size();
+  }
+  stats_valid_ = true;
+  LOG_INFO("Collected statistics of table %s. rows=%d", name(), stats_.row_count);
+  return RC::SUCCESS;
+}
+
+RC Table::missing_pages(int max_pages, std::vector<PageLoadFile> &files)
+{
+  if (in_memory())
+  {
+    return RC::SUCCESS;
+  }
+  CompactLockGuard guard(compact_lock_, false);
+  if (partitioned())
+  {
+    for (Table *partition : partitions_)
+    {
+      RC rc = partition->missing_pages(max_pages, files);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+      max_pages -= files.back().pages.size();
+    }
+    return RC::SUCCESS;
+  }
+
+  files.emplace_back();
+  PageLoadFile &file = files.back();
+  file.buffer_pool = data_buffer_pool_;
+  return data_buffer_pool_->missing_pages(file_id_, max_pages, file.file_name, file.pages);
+}
+
+RC Table::statistics(TableStats &stats)
+{
+  if (partitioned())
+  {
+    // 分区字段的值不会出现在两个分区中，不同值的个数可以相加，其它字段取最大的分区
+    CompactLockGuard guard(compact_lock_, false);
+    const int partition_field_index = table_meta_.find_field_index_by_name(table_meta_.partition_field()->name());
+    stats.row_count = 0;
+    stats.distinct_counts.assign(table_meta_.field_num(), -1);
+    for (Table *partition : partitions_)
+    {
+      TableStats partition_stats;
+      RC rc = partition->statistics(partition_stats);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+      stats.row_count += partition_stats.row_count;
+      for (size_t i = 0; i < partition_stats.distinct_counts.size() && i < stats.distinct_counts.size(); i++)
+      {
+        const int count = partition_stats.distinct_counts[i];
+        if (count < 0)
+        {
+          continue;
+        }
+        if ((int)i == partition_field_index)
+        {
+          stats.distinct_counts[i] = std::max(0, stats.distinct_counts[i]) + count;
+        }
+        else
+        {
+          stats.distinct_counts[i] = std::max(stats.distinct_counts[i], count);
+        }
+      }
+    }
+    apply_column_stats(stats);
+    return RC::SUCCESS;
+  }
+  pthread_mutex_lock(&stats_lock_);
+  RC rc = RC::SUCCESS;
+  if (!stats_valid_ || stats_changes_ > stats_.row_count / 5)
+  {
+    rc = analyze();
+  }
+  if (rc == RC::SUCCESS)
+  {
+    stats = stats_;
+    stats.row_count = std::max(0, stats_.row_count + stats_row_delta_);
+    apply_column_stats(stats);
+  }
+  pthread_mutex_unlock(&stats_lock_);
+  return rc;
+}
+
+void Table::apply_column_stats(TableStats &stats) const
+{
+  if (!table_meta_.analyzed())
+  {
+    return;
+  }
+  stats.columns.assign(table_meta_.field_num(), ColumnStats());
+  for (int i = 0; i < table_meta_.field_num(); i++)
+  {
+    const ColumnStats *column_stats = table_meta_.column_stats(i);
+    if (column_stats == nullptr)
+    {
+      continue;
+    }
+    stats.columns[i] = *column_stats;
+    if (i < (int)stats.distinct_counts.size() && stats.distinct_counts[i] < 0)
+    {
+      stats.distinct_counts[i] = (int)std::min<int64_t>(column_stats->distinct_count(), INT_MAX);
+    }
+  }
+}
+
+void Table::load_analyzed_stats()
+{
+  stats_.row_count = (int)std::min<int64_t>(table_meta_.stats_row_count(), INT_MAX);
+  stats_.distinct_counts.assign(table_meta_.field_num(), -1);
+  apply_column_stats(stats_);
+  // 每次statistics时从元数据中复制
+  stats_.columns.clear();
+  stats_valid_ = true;
+}
+
+/**
+ * 每个页面以sample_pages / page_count的概率被选中
+ */
+struct StatsPageSampler
+{
+  common::RandomGenerator *random;
+  int page_count;
+  int sample_pages;
+  int visited_pages;
+  int sampled_pages;
+};
+
+static bool stats_page_sampler(PageNum page_num, void *context)
+{
+  StatsPageSampler &sampler = *(StatsPageSampler *)context;
+  sampler.visited_pages++;
+  if ((int)sampler.random->next(sampler.page_count) >= sampler.sample_pages)
+  {
+    return false;
+  }
+  sampler.sampled_pages++;
+  return true;
+}
+
+struct StatsSampleContext
+{
+  Table *table;
+  bool decode;  // 变长记录需要先解码
+  std::deque<ColumnStatsCollector> *collectors;
+  std::vector<char> buffer;  // 解码之后的数据
+  int64_t rows;
+};
+
+static RC collect_column_stats_visitor(Record *record, void *context)
+{
+  StatsSampleContext &sample_context = *(StatsSampleContext *)context;
+  const char *data = record->data;
+  if (sample_context.decode)
+  {
+    sample_context.table->decode_record(record->data, sample_context.buffer.data());
+    data = sample_context.buffer.data();
+  }
+  for (ColumnStatsCollector &collector : *sample_context.collectors)
+  {
+    collector.add(data);
+  }
+  sample_context.rows++;
+  return RC::SUCCESS;
+}
+
+RC Table::sample_column_stats(common::RandomGenerator &random, std::deque<ColumnStatsCollector> &collectors,
+                              int64_t *sample_rows, int64_t *total_rows)
+{
+  CompactLockGuard guard(compact_lock_, false);
+  StatsSampleContext sample_context = {this, variable_length(), &collectors, std::vector<char>(record_data_size()), 0};
+  if (in_memory())
+  {
+    // 内存表没有页面，读取所有的记录
+    RC rc = mem_records_->visit_records(collect_column_stats_visitor, &sample_context);
+    *sample_rows += sample_context.rows;
+    *total_rows += sample_context.rows;
+    return rc;
+  }
+
+  int page_count = 0;
+  RC rc = data_buffer_pool_->get_page_count(file_id_, &page_count);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  RecordFileScanner scanner;
+  rc = scanner.open_scan(*data_buffer_pool_, file_id_, nullptr);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("failed to open scanner. file id=%d. rc=%d:%s", file_id_, rc, strrc(rc));
+    return rc;
+  }
+  StatsPageSampler sampler = {&random, std::max(page_count, 1), TABLE_ANALYZE_SAMPLE_PAGES, 0, 0};
+  scanner.set_page_filter(stats_page_sampler, &sampler);
+  rc = scanner.visit_records(collect_column_stats_visitor, &sample_context);
+  scanner.close_scan();
+  if (rc != RC::SUCCESS && rc != RC::RECORD_EOF)
+  {
+    LOG_ERROR("failed to sample records. file id=%d, rc=%d:%s", file_id_, rc, strrc(rc));
+    return rc;
+  }
+  *sample_rows += sample_context.rows;
+  if (sampler.sampled_pages > 0)
+  {
+    // 空页面和没有记录的页面也可能被选中，按读到的页面中的平均记录数估计
+    *total_rows += sample_context.rows * sampler.visited_pages / sampler.sampled_pages;
+  }
+  return RC::SUCCESS;
+}
+
+RC Table::analyze_table()
+{
+  // 元数据只在持有这个锁时修改
+  std::lock_guard<std::mutex> build_guard(index_build_mutex_);
+  common::RandomGenerator random;
+  std::deque<ColumnStatsCollector> collectors;
+  for (int i = table_meta_.sys_field_num(); i < table_meta_.field_num(); i++)
+  {
+    collectors.emplace_back(random, *table_meta_.field(i), table_meta_.null_flag(i));
+  }
+
+  // 先清零，统计期间的修改计入下一次
+  stats_row_delta_ = 0;
+  stats_changes_ = 0;
+  int64_t sample_rows = 0;
+  int64_t total_rows = 0;
+  RC rc = RC::SUCCESS;
+  if (partitioned())
+  {
+    CompactLockGuard guard(compact_lock_, false);
+    for (size_t i = 0; rc == RC::SUCCESS && i < partitions_.size(); i++)
+    {
+      rc = partitions_[i]->sample_column_stats(random, collectors, &sample_rows, &total_rows);
+    }
+  }
+  else
+  {
+    rc = sample_column_stats(random, collectors, &sample_rows, &total_rows);
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to analyze table %s. rc=%d:%s", name(), rc, strrc(rc));
+    return rc;
+  }
+
+  std::vector<ColumnStats> column_stats(table_meta_.field_num());
+  for (size_t i = 0; i < collectors.size(); i++)
+  {
+    collectors[i].build(sample_rows, total_rows, column_stats[table_meta_.sys_field_num() + i]);
+  }
+  TableMeta new_table_meta(table_meta_);
+  new_table_meta.set_stats(total_rows, std::move(column_stats));
+
+  CompactLockGuard guard(compact_lock_, true);
+  rc = save_meta(new_table_meta);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to save statistics of table %s. rc=%d:%s", name(), rc, strrc(rc));
+    return rc;
+  }
+  table_meta_.swap(new_table_meta);
+  for (Table *partition : partitions_)
+  {
+    CompactLockGuard partition_guard(partition->compact_lock_, true);
+    std::vector<ColumnStats> partition_stats;
+    for (int i = 0; i < table_meta_.field_num(); i++)
+    {
+      const ColumnStats *stats = table_meta_.column_stats(i);
+      partition_stats.push_back(stats != nullptr ? *stats : ColumnStats());
+    }
+    partition->table_meta_.set_stats(total_rows, std::move(partition_stats));
+  }
+
+  if (!partitioned())
+  {
+    pthread_mutex_lock(&stats_lock_);
+    load_analyzed_stats();
+    pthread_mutex_unlock(&stats_lock_);
+  }
+  LOG_INFO("Analyzed table %s. rows=%lld, sampled rows=%lld", name(), (long long)total_rows, (long long)sample_rows);
+  return RC::SUCCESS;
+}
+
+/**
+ * 在线创建索引期间对索引项的一次修改，data是修改时的记录
+ */
+struct IndexChange
+{
+  bool insert;
+  RID rid;
+  std::vector<char> data;
+};
+
+struct Table::IndexBuildLog
+{
+  std::mutex mutex;
+  std::vector<IndexChange> changes;  // 按发生的顺序
+};
+
+bool Table::can_include_all_columns() const
+{
+  // 叶子中保存整条记录，太长时每个叶子放不下几条
+  const int page_size = data_buffer_pool_ != nullptr ? data_buffer_pool_->page_size() : BP_PAGE_SIZE;
+  const int record_size = table_meta_.record_size() - table_meta_.sys_field_num() * Trx::trx_field_len();
+  return (record_size + 2 * (int)sizeof(RID)) * COVERING_INDEX_MIN_LEAF_RECORDS <= page_size;
+}
+
+RC Table::create_index(Trx *trx, const char *index_name, int attribute_num, const char *const attribute_names[],
+                       bool unique, const int prefix_lengths[], IndexType index_type, bool include_all_columns)
+{
+  common::TraceSpanScope span("storage", "create_index");
+  // 元数据只在持有这个锁时修改，扫描记录期间不持有整理锁
+  std::lock_guard<std::mutex> build_guard(index_build_mutex_);
+  // LOG_INFO("create_index starts");
+  if (index_name == nullptr || common::is_blank(index_name) || attribute_num <= 0)
+  {
+    LOG_ERROR("create_index - INVALID_ARGUMENT");
+    return RC::INVALID_ARGUMENT;
+  }
+  if (read_only())
+  {
+    LOG_WARN("Cannot create index on table %s, it is mapped read only", name());
+    return RC::READONLY;
+  }
+  if (table_meta_.index(index_name) != nullptr ||
+      table_meta_.find_index_by_fields(attribute_num, attribute_names))
+  {
+    LOG_ERROR("create_index - SCHEMA_INDEX_EXIST");
+    return RC::SCHEMA_INDEX_EXIST;
+  }
+
+  std::vector<const FieldMeta *> field_metas;
+  std::vector<FieldMeta> index_fields;
+  for (int i = 0; i < attribute_num; i++)
+  {
+    if (attribute_names[i] == nullptr || common::is_blank(attribute_names[i]))
+    {
+      LOG_ERROR("create_index - INVALID_ARGUMENT");
+      return RC::INVALID_ARGUMENT;
+    }
+    const FieldMeta *field_meta = table_meta_.field(attribute_names[i]);
+    if (!field_meta)
+    {
+      LOG_ERROR("create_index - SCHEMA_FIELD_MISSING");
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    if (std::find(field_metas.begin(), field_metas.end(), field_meta) != field_metas.end())
+    {
+      LOG_ERROR("create_index - duplicate field %s", attribute_names[i]);
+      return RC::INVALID_ARGUMENT;
+    }
+    field_metas.push_back(field_meta);
+    index_fields.push_back(*field_meta);
+  }
+
+  if (in_memory() && index_type != HASH_INDEX)
+  {
+    // 内存表只有哈希索引，范围条件扫描全表
+    LOG_INFO("Index %s of memory table %s is created as a hash index", index_name, name());
+    index_type = HASH_INDEX;
+  }
+  if (table_meta_.lsm_engine() && index_type != BPLUS_TREE_INDEX)
+  {
+    // lsm表的索引都是有序的LsmIndex
+    LOG_INFO("Index %s of lsm table %s is created as an lsm index", index_name, name());
+    index_type = BPLUS_TREE_INDEX;
+  }
+
+  int key_field_num = 0;
+  if (include_all_columns)
+  {
+    if (index_type != BPLUS_TREE_INDEX || prefix_lengths != nullptr || !can_include_all_columns())
+    {
+      LOG_WARN("Index %s of table %s cannot include all columns", index_name, name());
+      return RC::INVALID_ARGUMENT;
+    }
+    for (const FieldMeta *field_meta : field_metas)
+    {
+      if (field_meta->nullable())
+      {
+        LOG_WARN("Key field %s of index %s on table %s is nullable", field_meta->name(), index_name, name());
+        return RC::INVALID_ARGUMENT;
+      }
+    }
+    unique = true;
+    key_field_num = attribute_num;
+    for (int i = table_meta_.sys_field_num(); i < table_meta_.field_num(); i++)
+    {
+      const FieldMeta *field_meta = table_meta_.field(i);
+      if (std::find(field_metas.begin(), field_metas.end(), field_meta) == field_metas.end())
+      {
+        field_metas.push_back(field_meta);
+        index_fields.push_back(*field_meta);
+      }
+    }
+  }
+
+  IndexMeta new_index_meta;
+  std::vector<int> index_prefix_lengths;
+  if (prefix_lengths != nullptr)
+  {
+    index_prefix_lengths.assign(prefix_lengths, prefix_lengths + attribute_num);
+  }
+  RC rc = new_index_meta.init(index_name, field_metas, unique, index_prefix_lengths, index_type, key_field_num);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("fail to init index meta");
+    return rc;
+  }
+
+  // 分区表的索引建在每个分区上，表本身只记录索引的元数据
+  Index *index = nullptr;
+  if (partitioned())
+  {
+    CompactLockGuard guard(compact_lock_, false);
+    rc = build_partition_indexes(new_index_meta, index_fields);
+  }
+  else
+  {
+    rc = build_index(new_index_meta, index_fields, &index);
+  }
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  // 补上最后的修改、保存元数据和发布索引时不能有其它线程在修改记录
+  CompactLockGuard guard(compact_lock_, true);
+  TableMeta new_table_meta(table_meta_);
+  rc = new_table_meta.add_index(new_index_meta);
+  if (rc == RC::SUCCESS)
+  {
+    rc = save_meta(new_table_meta);
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to add index (%s) on table (%s). error=%d:%s", index_name, name(), rc, strrc(rc));
+    if (index != nullptr)
+    {
+      finish_index_build(index, false);
+    }
+    return rc; // 创建索引中途出错，要做还原操作
+  }
+  if (index != nullptr)
+  {
+    rc = finish_index_build(index, true);
+    if (rc != RC::SUCCESS)
+    {
+      // 元数据已经保存了，恢复成原来的元数据
+      RC rc2 = save_meta(table_meta_);
+      if (rc2 != RC::SUCCESS)
+      {
+        LOG_ERROR("Failed to restore meta of table %s. rc=%d:%s", name(), rc2, strrc(rc2));
+      }
+      return rc;
+    }
+  }
+
+  table_meta_.swap(new_table_meta);
+  data_changed();
+  // 新索引的字段还没有统计不同值的个数
+  stats_valid_ = false;
+
+  LOG_INFO("successfully add a new index (%s) on the table (%s)", index_name, name());
+
+  return rc;
+}
+
+RC Table::create_empty_index(const IndexMeta &index_meta, const std::vector<FieldMeta> &index_fields,
+                             Index **index)
+{
+  // 创建索引相关数据
+  *index = new_index(index_meta.type(), in_memory(), table_meta_.lsm_engine());
+  std::string index_file = index_data_file(base_dir_.c_str(), name(), index_meta.name());
+  // 创建对应文件，内存表的索引没有文件
+  RC rc = (*index)->create(index_file.c_str(), index_meta, index_fields,
+                           in_memory() ? BP_PAGE_SIZE : data_buffer_pool_->page_size());
+  if (rc != RC::SUCCESS)
+  {
+    delete *index;
+    *index = nullptr;
+    LOG_ERROR("Failed to create index. file name=%s, rc=%d:%s", index_file.c_str(), rc, strrc(rc));
+    return rc;
+  }
+  std::vector<NullFlag> null_flags;
+  index_null_flags(index_meta, null_flags);
+  (*index)->set_null_flags(null_flags);
+  return RC::SUCCESS;
+}
+
+RC Table::build_index(const IndexMeta &index_meta, const std::vector<FieldMeta> &index_fields, Index **index)
+{
+  RC rc = create_empty_index(index_meta, index_fields, index);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  {
+    // 之后开始的修改都会记到日志中，正在进行的修改已经结束
+    CompactLockGuard guard(compact_lock_, true);
+    index_build_ = new IndexBuildLog();
+  }
+
+  // 遍历当前的所有数据，B+树排好序之后自底向上生成索引，避免逐条插入时随机的分裂。
+  // 读的是页面上的记录，包括其它事务还没有提交的修改，和已有的索引一样
+  {
+    CompactLockGuard guard(compact_lock_, false);
+    IndexInserter index_inserter(*index);
+    rc = (*index)->begin_bulk_load();
+    if (rc == RC::SUCCESS)
+    {
+      rc = scan_record(nullptr, nullptr, -1, &index_inserter, insert_index_record_reader_adapter);
+    }
+    if (rc == RC::SUCCESS)
+    {
+      rc = (*index)->end_bulk_load();
+    }
+  }
+
+  // 扫描期间的修改分几轮补上，修改很少的时候就不用再等了
+  size_t applied = 0;
+  for (int round = 0; rc == RC::SUCCESS && round < INDEX_BUILD_CATCH_UP_ROUNDS; round++)
+  {
+    CompactLockGuard guard(compact_lock_, false);
+    rc = apply_index_changes(*index, &applied);
+    if (applied < INDEX_BUILD_CATCH_UP_CHANGES)
+    {
+      break;
+    }
+  }
+  if (rc != RC::SUCCESS)
+  {
+    // rollback，唯一索引遇到重复的数据时也会走到这里
+    LOG_ERROR("Failed to insert index to all records. table=%s, rc=%d:%s", name(), rc, strrc(rc));
+    CompactLockGuard guard(compact_lock_, true);
+    finish_index_build(*index, false);
+    *index = nullptr;
+    return rc;
+  }
+  return RC::SUCCESS;
+}
+
+RC Table::finish_index_build(Index *index, bool publish)
+{
+  RC rc = RC::SUCCESS;
+  size_t applied = 0;
+  if (publish)
+  {
+    rc = apply_index_changes(index, &applied);
+  }
+  delete index_build_;
+  index_build_ = nullptr;
+  if (publish && rc == RC::SUCCESS)
+  {
+    LOG_INFO("Publish index %s of table %s, %d changes applied at last", index->index_meta().name(), name(),
+             (int)applied);
+    indexes_.push_back(index);
+    return RC::SUCCESS;
+  }
+  std::string index_file = index_data_file(base_dir_.c_str(), name(), index->index_meta().name());
+  index->drop();
+  delete index;
+  remove(index_file.c_str());
+  return rc;
+}
+
+void Table::log_index_change(bool insert, const char *record, const RID &rid)
+{
+  if (index_build_ == nullptr)
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(index_build_->mutex);
+  index_build_->changes.push_back(IndexChange{insert, rid, std::vector<char>(record, record + record_data_size())});
+}
+
+RC Table::apply_index_changes(Index *index, size_t *applied)
+{
+  std::vector<IndexChange> changes;
+  {
+    std::lock_guard<std::mutex> lock(index_build_->mutex);
+    changes.swap(index_build_->changes);
+  }
+  *applied = changes.size();
+  for (const IndexChange &change : changes)
+  {
+    // 扫描时可能已经读到了修改之后的记录，先删除再插入，重复应用同一个修改结果不变
+    RC rc = index->delete_entry(change.data.data(), &change.rid);
+    if (rc != RC::SUCCESS && rc != RC::RECORD_INVALID_KEY)
+    {
+      return rc;
+    }
+    if (change.insert)
+    {
+      rc = index->insert_entry(change.data.data(), &change.rid);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC Table::build_partition_indexes(const IndexMeta &index_meta, const std::vector<FieldMeta> &index_fields)
+{
+  RC rc = RC::SUCCESS;
+  size_t built = 0;
+  for (; built < partitions_.size(); built++)
+  {
+    Table *partition = partitions_[built];
+    Index *index = nullptr;
+    rc = partition->build_index(index_meta, index_fields, &index);
+    if (rc == RC::SUCCESS)
+    {
+      CompactLockGuard guard(partition->compact_lock_, true);
+      rc = partition->finish_index_build(index, true);
+    }
+    if (rc != RC::SUCCESS)
+    {
+      break;
+    }
+  }
+  if (rc != RC::SUCCESS)
+  {
+    // 唯一索引只在每个分区内检查，一个分区失败时删掉已经建好的分区索引
+    for (size_t i = 0; i < built; i++)
+    {
+      Table *partition = partitions_[i];
+      CompactLockGuard guard(partition->compact_lock_, true);
+      Index *index = partition->indexes_.back();
+      partition->indexes_.pop_back();
+      index->drop();
+      delete index;
+      remove(index_data_file(base_dir_.c_str(), partition->name(), index_meta.name()).c_str());
+    }
+    return rc;
+  }
+  for (Table *partition : partitions_)
+  {
+    CompactLockGuard guard(partition->compact_lock_, true);
+    partition->table_meta_.add_index(index_meta);
+    partition->stats_valid_ = false;
+  }
+  return RC::SUCCESS;
+}
+
+RC Table::save_meta(const TableMeta &table_meta)
+{
+  // 分区的元数据保存在表的元数据文件中
+  if (is_partition_)
+  {
+    return RC::SUCCESS;
+  }
+  // 创建元数据临时文件
+  std::string tmp_file = table_meta_file(base_dir_.c_str(), name()) + ".tmp";
+  std::fstream fs;
+  fs.open(tmp_file, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  if (!fs.is_open())
+  {
+    LOG_ERROR("Failed to open file for write. file name=%s, errmsg=%s", tmp_file.c_str(), strerror(errno));
+    return RC::IOERR;
+  }
+  if (table_meta.serialize(fs) < 0)
+  {
+    LOG_ERROR("Failed to dump new table meta to file: %s. sys err=%d:%s", tmp_file.c_str(), errno, strerror(errno));
+    return RC::IOERR;
+  }
+  fs.close();
+
+  // 覆盖原始元数据文件
+  std::string meta_file = table_meta_file(base_dir_.c_str(), name());
+  int ret = rename(tmp_file.c_str(), meta_file.c_str());
+  if (ret != 0)
+  {
+    LOG_ERROR("Failed to rename tmp meta file (%s) to normal meta file (%s) of table (%s). system error=%d:%s",
+              tmp_file.c_str(), meta_file.c_str(), name(), errno, strerror(errno));
+    return RC::IOERR;
+  }
+  return RC::SUCCESS;
+}
+
+class RecordUpdater
+{
+public:
+  RecordUpdater(Table &table, Trx *trx, const char *attribute_name, const Value *value) : table_(table), trx_(trx), attribute_name_(attribute_name), value_(value)
+  {
+  }
+
+  RC update_record(Record *record)
+  {
+    RC rc = RC::SUCCESS;
+    rc = table_.update_record(trx_, record, attribute_name_, value_);
+    if (rc == RC::SUCCESS)
+    {
+      ++updated_count_;
+    }
+    return rc;
+  }
+
+  int updated_count() const
+  {
+    return updated_count_;
+  }
+
+private:
+  Table &table_;
+  Trx *trx_;
+  int updated_count_ = 0;
+  const char *attribute_name_;
+  const Value *value_;
+};
+
+static RC record_reader_update_adapter(Record *record, void *context)
+{
+  RecordUpdater &record_updater = *(RecordUpdater *)context;
+  // std::cout << record->data << std::endl;
+
+  return record_updater.update_record(record);
+}
+
+RC Table::update_record(Trx *trx, const char *attribute_name, const Value *value, int condition_num, const Condition conditions[], int *updated_count)
+{
+  common::TraceSpanScope span("storage", "update_records");
+  // 字典编码的字段先把新的值加到字典中，更新每条记录时只查找编码
+  const FieldMeta *dictionary_field = attribute_name == nullptr ? nullptr : table_meta_.field(attribute_name);
+  if (dictionary_field != nullptr && dictionary_field->dictionary() != nullptr && value != nullptr &&
+      !value->is_null && is_legal(*value, dictionary_field) == RC::SUCCESS)
+  {
+    int code = 0;
+    RC rc = encode_dictionary_value(*dictionary_field, (const char *)value->data, &code);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+  CompactLockGuard guard(compact_lock_, false);
+  // TODO(xiong): 任务3 实现udpate功能，update单个字段即可。
+  if (nullptr == value || nullptr == attribute_name)
+  {
+    LOG_ERROR("Invalid argument. values=%p, attribute_name=%p", value, attribute_name);
+    return RC::INVALID_ARGUMENT;
+  }
+  if (read_only())
+  {
+    LOG_WARN("Cannot update table %s, it is mapped read only", name());
+    return RC::READONLY;
+  }
+  // 修改分区字段需要把记录移到别的分区
+  const FieldMeta *partition_field = table_meta_.partition_field();
+  if (partition_field != nullptr && 0 == strcmp(partition_field->name(), attribute_name))
+  {
+    LOG_WARN("Cannot update partition field %s of table %s", attribute_name, name());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  // 1.1 有条件，则获取条件过滤器
+  RC rc = RC::SUCCESS;
+  if (condition_num > 0)
+  {
+    // 元数据检查：判断where中表名是否与要update的表名一致
+    const char *rel_name = table_meta_.name();
+    for (int i = 0; i < condition_num; i++)
+    {
+      const Condition &cond = conditions[i];
+      if (cond.left_is_attr == 1)
+      {
+        const char *cond_rel_name = cond.left_attr.relation_name;
+        if (cond_rel_name != nullptr && strcmp(cond_rel_name, rel_name) != 0)
+        {
+          LOG_ERROR("update的表名和where条件中不一致");
+          return RC::SCHEMA_TABLE_NAME_ILLEGAL;
+        }
+      }
+
+      if (cond.right_is_attr == 1)
+      {
+        const char *cond_rel_name = cond.right_attr.relation_name;
+        if (cond_rel_name != nullptr && strcmp(cond_rel_name, rel_name) != 0)
+        {
+          LOG_ERROR("update的表名和where条件中不一致");
+          return RC::SCHEMA_TABLE_NAME_ILLEGAL;
+        }
+      }
+    }
+
+    CompositeConditionFilter condition_filter;
+    rc = condition_filter.init(*this, conditions, condition_num);
+    if (rc == RC::SUCCESS)
+    {
+      // 2. 筛选满足所有条件的record，逐条进行更新
+      rc = update_records(trx, &condition_filter, attribute_name, value, updated_count);
+    }
+  }
+  else
+  {
+    // 1.2 没条件，则遍历所有元组
+    rc = update_records(trx, nullptr, attribute_name, value, updated_count);
+  }
+  return rc;
+}
+
+RC Table::update_records(Trx *trx, ConditionFilter *filter, const char *attribute_name, const Value *value,
+                         int *updated_count)
+{
+  if (partitioned())
+  {
+    std::vector<Table *> partitions;
+    prune_partitions(filter, partitions);
+    int total = 0;
+    RC rc = RC::SUCCESS;
+    for (size_t i = 0; i < partitions.size() && rc == RC::SUCCESS; i++)
+    {
+      CompactLockGuard guard(partitions[i]->compact_lock_, false);
+      int count = 0;
+      rc = partitions[i]->update_records(trx, filter, attribute_name, value, &count);
+      total += count;
+    }
+    if (updated_count != nullptr)
+    {
+      *updated_count = total;
+    }
+    return rc;
+  }
 
-RC Table::is_legal(const Value &value, const FieldMeta *field)
+  RecordUpdater updater(*this, trx, attribute_name, value);
+  // 和删除一样更新最新提交的版本
+  if (trx != nullptr)
+  {
+    trx->set_current_read(true);
+  }
+  RC rc = scan_target_records(trx, filter, &updater, record_reader_update_adapter);
+  if (trx != nullptr)
+  {
+    trx->set_current_read(false);
+  }
+  if (updated_count != nullptr)
+  {
+    *updated_count = updater.updated_count();
+  }
+  return rc;
+}
+
+RC Table::update_record(Trx *trx, Record *record, const char *attribute_name, const Value *value)
 {
-  // 比赛里暂时不要支持这种转换
-  // if (value.type == AttrType::INTS && field->type() == AttrType::FLOATS)
-  // {
-  //   // 允许int类型给float类型赋值，例如17 -> 17.00
-  //   return RC::SUCCESS;
-  // }
+  // 1. 获得字段数据
+  int i = table_meta_.find_field_index_by_name(attribute_name);
+  if (i == -1)
+  {
+    // 不存在该属性
+    return RC::SCHEMA_FIELD_NOT_EXIST;
+  }
+  const FieldMeta *field_meta = table_meta_.field(i);
 
-  if (value.type == AttrType::NULLS)
+  RC rc = is_legal(*value, field_meta);
+  if (rc != RC::SUCCESS)
   {
-    // field->desc(std::cout);
-    if (!field->nullable())
+    return rc;
+  }
+  const NullFlag null_flag = table_meta_.null_flag(i);
+  const char *data = (const char *)value->data;
+  int code = 0;
+  if (field_meta->dictionary() != nullptr)
+  {
+    // 值已经在update_record开始的时候加到字典中了
+    code = value->is_null ? 0 : field_meta->dictionary()->find(data);
+    if (code < 0)
     {
-      LOG_ERROR("该列不允许插入null值");
-      return RC::SCHEMA_FIELD_NAME_ILLEGAL;
+      LOG_ERROR("Value is not in dictionary of %s.%s", name(), field_meta->name());
+      return RC::GENERIC_ERROR;
     }
+    data = (const char *)&code;
   }
-  else if (field->type() != value.type)
+
+  // 直接修改页面上的记录，事务在undo文件中保存被修改的字段和null标志原来的值，其它事务的读视图从版本链中读
+  if (trx != nullptr)
   {
-    LOG_ERROR("Invalid value type. field name=%s, type=%d, but given=%d",
-              field->name(), field->type(), value.type);
-    return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+    const UndoRange ranges[] = {{field_meta->offset(), field_meta->len()}, {null_flag.offset, 1}};
+    rc = trx->update_record(this, record, ranges, sizeof(ranges) / sizeof(ranges[0]));
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+
+  // 更新record，插入索引失败时恢复成原来的数据
+  std::vector<char> old_data(record->data, record->data + record_data_size());
+  if (field_meta->storage_type() == CHARS)
+  {
+    strncpy(record->data + field_meta->offset(), data, field_meta->len());
+  }
+  else
+  {
+    memcpy(record->data + field_meta->offset(), data, field_meta->len());
+  }
+  // 更新null状态
+  null_flag.set(record->data, value->is_null);
+
+  // 记录的rid不变，只有包含这个字段并且键变了的索引需要更新，多字段索引也一样。
+  // 更新的字段不在任何索引中时不用修改索引
+  std::vector<Index *> indexes;
+  for (Index *index : indexes_)
+  {
+    if (index->index_meta().has_field(attribute_name) && index_key_changed(*index, old_data.data(), record->data))
+    {
+      indexes.push_back(index);
+    }
+  }
+
+  // 删除索引index
+  for (size_t deleted = 0; deleted < indexes.size(); deleted++)
+  {
+    rc = indexes[deleted]->delete_entry(old_data.data(), &record->rid);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to delete indexes of record (rid=%d.%d). rc=%d:%s",
+                record->rid.page_num, record->rid.slot_num, rc, strrc(rc));
+      for (size_t j = 0; j < deleted; j++)
+      {
+        RC rc2 = indexes[j]->insert_entry(old_data.data(), &record->rid);
+        if (rc2 != RC::SUCCESS)
+        {
+          LOG_PANIC("Failed to rollback index data when delete index entries failed. table name=%s, rc=%d:%s",
+                    name(), rc2, strrc(rc2));
+        }
+      }
+      memcpy(record->data, old_data.data(), old_data.size());
+      return rc;
+    }
+  }
+
+  rc = write_record(*record);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Update record failed. table name=%s, rc=%d:%s", table_meta_.name(), rc, strrc(rc));
+    return rc;
+  }
+
+  // 插入index
+  size_t inserted = 0;
+  for (; inserted < indexes.size(); inserted++)
+  {
+    rc = indexes[inserted]->insert_entry(record->data, &record->rid);
+    if (rc != RC::SUCCESS)
+    {
+      break;
+    }
+  }
+  if (rc == RC::SUCCESS)
+  {
+    // 正在创建的索引可能包含更新的字段，也要记下来
+    log_index_change(false, old_data.data(), record->rid);
+    log_index_change(true, record->data, record->rid);
+    data_changed();
+    return rc;
+  }
+
+  // 比如唯一索引中已经有了新的值，把记录和索引都恢复成更新之前的样子
+  LOG_WARN("Failed to insert index entries of updated record, rollback. table name=%s, rc=%d:%s",
+           name(), rc, strrc(rc));
+  for (size_t j = 0; j < inserted; j++)
+  {
+    RC rc2 = indexes[j]->delete_entry(record->data, &record->rid);
+    if (rc2 != RC::SUCCESS)
+    {
+      LOG_PANIC("Failed to rollback index data when insert index entries failed. table name=%s, rc=%d:%s",
+                name(), rc2, strrc(rc2));
+    }
+  }
+  memcpy(record->data, old_data.data(), old_data.size());
+  RC rc2 = write_record(*record);
+  if (rc2 != RC::SUCCESS)
+  {
+    LOG_PANIC("Failed to rollback record data when insert index entries failed. table name=%s, rc=%d:%s",
+              name(), rc2, strrc(rc2));
+  }
+  for (Index *index : indexes)
+  {
+    rc2 = index->insert_entry(record->data, &record->rid);
+    if (rc2 != RC::SUCCESS)
+    {
+      LOG_PANIC("Failed to rollback index data when insert index entries failed. table name=%s, rc=%d:%s",
+                name(), rc2, strrc(rc2));
+    }
+  }
+  return rc;
+}
+
+class RecordDeleter
+{
+public:
+  RecordDeleter(Table &table, Trx *trx) : table_(table), trx_(trx)
+  {
+  }
+
+  RC delete_record(Record *record)
+  {
+    RC rc = RC::SUCCESS;
+    rc = table_.delete_record(trx_, record);
+    if (rc == RC::SUCCESS)
+    {
+      deleted_count_++;
+    }
+    return rc;
+  }
+
+  int deleted_count() const
+  {
+    return deleted_count_;
+  }
+
+private:
+  Table &table_;
+  Trx *trx_;
+  int deleted_count_ = 0;
+};
+
+static RC record_reader_delete_adapter(Record *record, void *context)
+{
+  RecordDeleter &record_deleter = *(RecordDeleter *)context;
+  // std::cout << record->data << std::endl;
+  return record_deleter.delete_record(record);
+}
+
+RC Table::delete_record(Trx *trx, ConditionFilter *filter, int *deleted_count)
+{
+  common::TraceSpanScope span("storage", "delete_records");
+  CompactLockGuard guard(compact_lock_, false);
+  if (read_only())
+  {
+    LOG_WARN("Cannot delete from table %s, it is mapped read only", name());
+    return RC::READONLY;
+  }
+  if (partitioned())
+  {
+    std::vector<Table *> partitions;
+    prune_partitions(filter, partitions);
+    int total = 0;
+    RC rc = RC::SUCCESS;
+    for (size_t i = 0; i < partitions.size() && rc == RC::SUCCESS; i++)
+    {
+      int count = 0;
+      rc = partitions[i]->delete_record(trx, filter, &count);
+      total += count;
+    }
+    if (deleted_count != nullptr)
+    {
+      *deleted_count = total;
+    }
+    return rc;
+  }
+  RecordDeleter deleter(*this, trx);
+  // 删除最新提交的版本，其它事务正在修改的记录返回写冲突
+  if (trx != nullptr)
+  {
+    trx->set_current_read(true);
+  }
+  RC rc = scan_target_records(trx, filter, &deleter, record_reader_delete_adapter);
+  if (trx != nullptr)
+  {
+    trx->set_current_read(false);
+  }
+  if (deleted_count != nullptr)
+  {
+    *deleted_count = deleter.deleted_count();
+  }
+  return rc;
+}
+
+RC Table::delete_record(Trx *trx, Record *record)
+{
+  RC rc = RC::SUCCESS;
+  if (trx != nullptr)
+  {
+    rc = trx->delete_record(this, record);
+    if (rc == RC::SUCCESS)
+    {
+      rc = write_back_trx_field(*record);
+    }
+  }
+  else
+  {
+    RowCountChange row_change(row_count_, true);
+    rc = delete_entry_of_indexes(record->data, record->rid, false); // 重复代码 refer to purge_record
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to delete indexes of record (rid=%d.%d). rc=%d:%s",
+                record->rid.page_num, record->rid.slot_num, rc, strrc(rc));
+    }
+    else
+    {
+      rc = remove_record(record->rid);
+    }
+    if (rc == RC::SUCCESS)
+    {
+      row_change.add(-1);
+    }
+  }
+  if (rc == RC::SUCCESS)
+  {
+    record_changed(-1);
+  }
+  return rc;
+}
+
+RC Table::insert_entry_of_indexes(const char *record, const RID &rid)
+{
+  RC rc = RC::SUCCESS;
+  for (Index *index : indexes_)
+  {
+    // 这里record就是Key,*rid就是value   bplustree的kv结构
+    rc = index->insert_entry(record, &rid);
+    if (rc != RC::SUCCESS)
+    {
+      break;
+    }
   }
+  if (rc == RC::SUCCESS)
+  {
+    log_index_change(true, record, rid);
+  }
+  return rc;
+}
+
+RC Table::delete_entry_of_indexes(const char *record, const RID &rid, bool error_on_not_exists)
+{
+  RC rc = RC::SUCCESS;
+  for (Index *index : indexes_)
+  {
+    rc = index->delete_entry(record, &rid);
+    if (rc != RC::SUCCESS)
+    {
+      if (rc != RC::RECORD_INVALID_KEY || !error_on_not_exists)
+      {
+        break;
+      }
+    }
+  }
+  log_index_change(false, record, rid);
+  return rc;
+}
+
+bool Table::index_key_changed(const Index &index, const char *old_record, const char *new_record) const
+{
+  for (const FieldMeta &field : index.field_metas())
+  {
+    if (0 != memcmp(old_record + field.offset(), new_record + field.offset(), field.len()))
+    {
+      return true;
+    }
+    if (field.nullable())
+    {
+      const NullFlag null_flag = table_meta_.null_flag(table_meta_.find_field_index_by_name(field.name()));
+      if (null_flag.test(old_record) != null_flag.test(new_record))
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
 
-  if (value.type == AttrType::CHARS)
+void Table::index_null_flags(const IndexMeta &index_meta, std::vector<NullFlag> &null_flags) const
+{
+  // 只有key字段为null时不检查唯一性，主键索引中跟在key后面的字段不影响
+  for (int i = 0; i < index_meta.key_field_num(); i++)
   {
-    // CHARS值需要判断长度
-    char *s = (char *)value.data;
-    if (strlen(s) > field->len())
+    const FieldMeta *field = table_meta_.field(index_meta.field(i));
+    if (field == nullptr || !field->nullable())
     {
-      LOG_ERROR("待插入CHARS类型值过长");
-      return RC::SCHEMA_FIELD_MISSING;
+      continue;
+    }
+    const NullFlag null_flag = table_meta_.null_flag(table_meta_.find_field_index_by_name(field->name()));
+    auto iter = std::find_if(null_flags.begin(), null_flags.end(),
+                             [&null_flag](const NullFlag &flag) { return flag.offset == null_flag.offset; });
+    if (iter != null_flags.end())
+    {
+      iter->mask |= null_flag.mask;
+    }
+    else
+    {
+      null_flags.push_back(null_flag);
     }
   }
-
-  return RC::SUCCESS;
 }
 
-RC Table::make_record(int value_num, const Value *values, char *&record_out)
+Index *Table::find_index(const char *index_name) const
 {
-  // 首先确定插入的数据依次和当前的table属性一样
-  // 然后将制作好的record放在record_out中
-
-  // 检查字段类型是否一致
-  if (value_num + table_meta_.sys_field_num() != table_meta_.field_num())
+  for (Index *index : indexes_)
   {
-    return RC::SCHEMA_FIELD_MISSING;
+    if (0 == strcmp(index->index_meta().name(), index_name))
+    {
+      return index;
+    }
   }
+  return nullptr;
+}
 
-  Value new_value;
-  const int normal_field_start_index = table_meta_.sys_field_num();
-  for (int i = 0; i < value_num; i++)
-  {
-    const FieldMeta *field = table_meta_.field(i + normal_field_start_index);
-    const Value &value = values[i];
+/**
+ * 可以用索引的条件，比较符已经统一成"字段 op 值"，只有=、<、<=、>、>=
+ */
+struct IndexCondition {
+  const FieldMeta *field = nullptr;
+  CompOp comp_op = NO_OP;
+  const char *value = nullptr;
+};
 
-    RC rc = is_legal(value, field);
-    if (rc != RC::SUCCESS)
+/**
+ * 一个索引上能用的条件合并成的扫描范围。前eq_column_num个字段是等值条件，
+ * 之后一个字段可以再加上范围条件。low和high是按索引字段顺序拼起来的边界值，
+ * 只有前low_column_num和high_column_num个字段有效
+ */
+struct IndexScanRange {
+  Index *index = nullptr;
+  int eq_column_num = 0;
+  std::vector<char> low;
+  int low_column_num = 0;
+  bool low_inclusive = true;
+  std::vector<char> high;
+  int high_column_num = 0;
+  bool high_inclusive = true;
+};
+
+static int compare_index_value(const FieldMeta *field, const char *value1, const char *value2)
+{
+  switch (field->type())
+  {
+  case FLOATS:
+  {
+    float result = *(float *)value1 - *(float *)value2;
+    if (-1e-6 < result && result < 1e-6)
     {
-      return rc;
+      return 0;
     }
+    return result > 0 ? 1 : -1;
+  }
+  case CHARS:
+    return strncmp(value1, value2, field->len());
+  default:
+  {
+    int v1 = *(int *)value1;
+    int v2 = *(int *)value2;
+    return v1 < v2 ? -1 : (v1 > v2 ? 1 : 0);
+  }
   }
+}
 
-  // 复制所有字段的值
-  int record_size = table_meta_.record_size();
-  const FieldMeta *field = table_meta_.field(value_num - 1 + normal_field_start_index);
-  int null_field_index = field->offset() + field->len();
-  // record大小增加value_num个字节，用来存放是否null值
-  char *record = new char[record_size + value_num];
+static void copy_index_value(const FieldMeta &field, const char *value, char *dest)
+{
+  if (field.type() == CHARS)
+  {
+    // 条件中的字符串可能比字段短
+    memset(dest, 0, field.len());
+    strncpy(dest, value, field.len());
+  }
+  else
+  {
+    memcpy(dest, value, field.len());
+  }
+}
 
-  for (int i = 0; i < value_num; i++)
+/**
+ * 按索引字段的顺序匹配条件：前面的字段有等值条件时继续匹配下一个字段，
+ * 遇到只有范围条件的字段时合并这个字段上所有的范围，之后的字段就用不上了
+ */
+static bool build_index_scan_range(Index *index, const std::vector<IndexCondition> &conditions, IndexScanRange &range)
+{
+  const std::vector<FieldMeta> &fields = index->field_metas();
+  int key_length = 0;
+  for (const FieldMeta &field : fields)
   {
-    const FieldMeta *field = table_meta_.field(i + normal_field_start_index);
-    const Value &value = values[i];
-    bool is_null;
+    key_length += field.len();
+  }
+  range.index = index;
+  range.low.resize(key_length);
+  range.high.resize(key_length);
 
-    if (value.is_null)
+  int offset = 0;
+  for (size_t i = 0; i < fields.size(); i++)
+  {
+    const FieldMeta &field = fields[i];
+    const IndexCondition *equal = nullptr;
+    const IndexCondition *low = nullptr;
+    const IndexCondition *high = nullptr;
+    for (const IndexCondition &condition : conditions)
     {
-      // 如果是null值，int/float类型放0，char类型直接放null，date放int类型19700101
-      switch (field->type())
-      {
-      case AttrType::CHARS:
+      if (condition.field->offset() != field.offset())
       {
-        const char *v = "NULL";
-        memcpy(record + field->offset(), v, field->len());
+        continue;
       }
-      break;
-      case AttrType::DATES:
+      switch (condition.comp_op)
       {
-        int v = 19700101;
-        memcpy(record + field->offset(), &v, field->len());
-      }
-      break;
-      case AttrType::FLOATS:
+      case EQUAL_TO:
+        equal = equal == nullptr ? &condition : equal;
+        break;
+      case GREAT_THAN:
+      case GREAT_EQUAL:
       {
-        float v = 0;
-        memcpy(record + field->offset(), &v, field->len());
+        // 取更紧的下界，值相同时不包含边界的更紧
+        int result = low == nullptr ? 1 : compare_index_value(&field, condition.value, low->value);
+        if (result > 0 || (result == 0 && condition.comp_op == GREAT_THAN))
+        {
+          low = &condition;
+        }
       }
       break;
-      case AttrType::INTS:
+      default:
       {
-        int v = 0;
-        memcpy(record + field->offset(), &v, field->len());
+        int result = high == nullptr ? -1 : compare_index_value(&field, condition.value, high->value);
+        if (result < 0 || (result == 0 && condition.comp_op == LESS_THAN))
+        {
+          high = &condition;
+        }
       }
       break;
-      default:
-        break;
       }
+    }
 
-      // 放入null标志
-      is_null = true;
-      memcpy(record + null_field_index + i, &is_null, 1);
+    if (equal != nullptr)
+    {
+      copy_index_value(field, equal->value, range.low.data() + offset);
+      copy_index_value(field, equal->value, range.high.data() + offset);
+      range.eq_column_num++;
+      range.low_column_num = range.high_column_num = (int)i + 1;
+      offset += field.len();
+      continue;
     }
-    else
+
+    if (low != nullptr)
     {
-      memcpy(record + field->offset(), value.data, field->len());
-      // 放入null标志
-      is_null = false;
-      memcpy(record + null_field_index + i, &is_null, 1);
+      copy_index_value(field, low->value, range.low.data() + offset);
+      range.low_column_num = (int)i + 1;
+      range.low_inclusive = low->comp_op == GREAT_EQUAL;
     }
-    // LOG_INFO("name = %s,index = %d, is null = %d", field->name(), i, is_null);
-    // 用于char 乱码问题追踪测试   如果是char则存储中只会放入4字节内容
-    // if(value.type==1){
-    //   LOG_INFO("调用make record函数，将value值 %s 放进内存 record中结果为 %s",value.data,record+field->offset());
-    // }
+    if (high != nullptr)
+    {
+      copy_index_value(field, high->value, range.high.data() + offset);
+      range.high_column_num = (int)i + 1;
+      range.high_inclusive = high->comp_op == LESS_EQUAL;
+    }
+    break;
+  }
+  if (index->index_meta().type() == HASH_INDEX)
+  {
+    // 哈希索引只能查找所有字段都相等的索引项
+    return range.eq_column_num == (int)fields.size();
   }
+  return range.low_column_num > 0 || range.high_column_num > 0;
+}
 
-  record_out = record;
-  return RC::SUCCESS;
+/**
+ * 范围越窄越好：等值的字段越多越好，字段数相同时两个边界比一个边界好。
+ * 等值的字段相同时哈希索引只读一个桶，比B+树从根节点往下找要好
+ */
+static int index_scan_range_rank(const IndexScanRange &range)
+{
+  return range.eq_column_num * 3 + (range.low_column_num > range.eq_column_num ? 1 : 0) +
+         (range.high_column_num > range.eq_column_num ? 1 : 0) +
+         (range.index->index_meta().type() == HASH_INDEX ? 1 : 0);
 }
 
-RC Table::init_record_handler(const char *base_dir)
+double Table::index_scan_range_selectivity(const IndexScanRange &range) const
 {
-  std::string data_file = std::string(base_dir) + "/" + table_meta_.name() + TABLE_DATA_SUFFIX;
-  if (nullptr == data_buffer_pool_)
+  const std::vector<FieldMeta> &fields = range.index->field_metas();
+  double selectivity = 1;
+  for (int i = 0; i < range.eq_column_num; i++)
   {
-    data_buffer_pool_ = theGlobalDiskBufferPool();
+    const ColumnStats *stats = table_meta_.column_stats(table_meta_.find_field_index_by_name(fields[i].name()));
+    selectivity *= nullptr == stats ? TABLE_DEFAULT_EQUAL_SELECTIVITY : stats->equal_selectivity();
   }
-
-  int data_buffer_pool_file_id;
-  RC rc = data_buffer_pool_->open_file(data_file.c_str(), &data_buffer_pool_file_id);
-  if (rc != RC::SUCCESS)
+  if (range.eq_column_num >= (int)fields.size())
   {
-    LOG_ERROR("Failed to open disk buffer pool for file:%s. rc=%d:%s",
-              data_file.c_str(), rc, strrc(rc));
-    return rc;
+    return selectivity;
   }
 
-  record_handler_ = new RecordFileHandler();
-  rc = record_handler_->init(*data_buffer_pool_, data_buffer_pool_file_id);
-  if (rc != RC::SUCCESS)
+  // 等值字段之后的一个字段上可能还有范围条件
+  const FieldMeta &field = fields[range.eq_column_num];
+  const bool has_low = range.low_column_num > range.eq_column_num;
+  const bool has_high = range.high_column_num > range.eq_column_num;
+  if (!has_low && !has_high)
   {
-    LOG_ERROR("Failed to init record handler. rc=%d:%s", rc, strrc(rc));
-    return rc;
+    return selectivity;
   }
-
-  file_id_ = data_buffer_pool_file_id;
-  return rc;
-}
-
-/**
- * 为了不把Record暴露出去，封装一下
- */
-class RecordReaderScanAdapter
-{
-public:
-  explicit RecordReaderScanAdapter(void (*record_reader)(const char *data, void *context), void *context)
-      : record_reader_(record_reader), context_(context)
+  const ColumnStats *stats = table_meta_.column_stats(table_meta_.find_field_index_by_name(field.name()));
+  if (nullptr == stats || stats->histogram().empty())
   {
+    return selectivity * (has_low ? TABLE_DEFAULT_RANGE_SELECTIVITY : 1) *
+           (has_high ? TABLE_DEFAULT_RANGE_SELECTIVITY : 1);
   }
 
-  void consume(const Record *record)
+  // 边界值按索引字段顺序拼在一起，取出这个字段的部分
+  int offset = 0;
+  for (int i = 0; i < range.eq_column_num; i++)
   {
-    record_reader_(record->data, context_);
+    offset += fields[i].len();
   }
-
-private:
-  void (*record_reader_)(const char *, void *);
-  void *context_;
-};
-static RC scan_record_reader_adapter(Record *record, void *context)
-{
-  RecordReaderScanAdapter &adapter = *(RecordReaderScanAdapter *)context;
-  adapter.consume(record);
-  return RC::SUCCESS;
-}
-
-RC Table::scan_record(Trx *trx, ConditionFilter *filter, int limit, void *context, void (*record_reader)(const char *data, void *context))
-{ //当前scan_record 调用下面的scan_record函数
-  RecordReaderScanAdapter adapter(record_reader, context);
-  return scan_record(trx, filter, limit, (void *)&adapter, scan_record_reader_adapter);
-}
-
-RC Table::scan_record(Trx *trx, ConditionFilter *filter, int limit, void *context, RC (*record_reader)(Record *record, void *context))
-{
-  if (nullptr == record_reader)
+  const double not_null = 1 - stats->null_fraction();
+  double fraction = not_null;
+  double value = 0;
+  if (has_low && ColumnStats::to_number(field.type(), range.low.data() + offset, &value))
   {
-    return RC::INVALID_ARGUMENT;
+    const double above = stats->compare_selectivity(range.low_inclusive ? GREAT_EQUAL : GREAT_THAN, value);
+    fraction -= above < 0 ? 0 : not_null - above;
   }
-
-  if (0 == limit)
+  if (has_high && ColumnStats::to_number(field.type(), range.high.data() + offset, &value))
   {
-    return RC::SUCCESS;
+    const double below = stats->compare_selectivity(range.high_inclusive ? LESS_EQUAL : LESS_THAN, value);
+    fraction -= below < 0 ? 0 : not_null - below;
   }
+  return selectivity * std::max(0.0, fraction);
+}
 
-  if (limit < 0)
-  {
-    limit = INT_MAX;
-  }
+double Table::index_scan_cost(const IndexScanRange &range) const
+{
+  const double lookup_cost = range.index->index_meta().type() == HASH_INDEX ? 1 : TABLE_BTREE_LOOKUP_COST;
+  const double rows = (double)table_meta_.stats_row_count() * index_scan_range_selectivity(range);
+  return lookup_cost + rows * TABLE_INDEX_ROW_COST;
+}
 
-  // filter == nullptr，则index_scanner也为nullptr
-  IndexScanner *index_scanner = find_index_for_scan(filter);
-  if (index_scanner != nullptr)
+bool Table::find_index_conditions(const DefaultConditionFilter &filter, std::vector<IndexCondition> &conditions) const
+{
+  if (filter.like() != nullptr)
   {
-    return scan_record_by_index(trx, index_scanner, filter, limit, context, record_reader);
+    return find_like_index_conditions(filter, conditions);
   }
-  // filter == nullptr时，scanner会扫描所有元组
-  RC rc = RC::SUCCESS;
-  RecordFileScanner scanner;
-  rc = scanner.open_scan(*data_buffer_pool_, file_id_, filter);
-  if (rc != RC::SUCCESS)
+  const ConDesc *field_cond_desc = nullptr;
+  const ConDesc *value_cond_desc = nullptr;
+  AttrType value_type = UNDEFINED;
+  CompOp comp_op = filter.comp_op();
+  if (filter.left().is_attr && !filter.right().is_attr)
   {
-    LOG_ERROR("failed to open scanner. file id=%d. rc=%d:%s", file_id_, rc, strrc(rc));
-    return rc;
+    field_cond_desc = &filter.left();
+    value_cond_desc = &filter.right();
+    value_type = filter.another_attr_type();
   }
-
-  int record_count = 0;
-  Record record;
-  rc = scanner.get_first_record(&record);
-  for (; RC::SUCCESS == rc && record_count < limit; rc = scanner.get_next_record(&record))
+  else if (filter.right().is_attr && !filter.left().is_attr)
   {
-    if (trx == nullptr || trx->is_visible(this, &record))
+    field_cond_desc = &filter.right();
+    value_cond_desc = &filter.left();
+    value_type = filter.attr_type();
+    // 值在左边时翻转比较符，都按照"字段 op 值"处理
+    switch (comp_op)
     {
-      // 将record添加进tupleset
-      rc = record_reader(&record, context);
-      if (rc != RC::SUCCESS)
-      {
-        break;
-      }
-      record_count++;
+    case LESS_THAN:
+      comp_op = GREAT_THAN;
+      break;
+    case LESS_EQUAL:
+      comp_op = GREAT_EQUAL;
+      break;
+    case GREAT_THAN:
+      comp_op = LESS_THAN;
+      break;
+    case GREAT_EQUAL:
+      comp_op = LESS_EQUAL;
+      break;
+    default:
+      break;
     }
   }
-
-  if (RC::RECORD_EOF == rc)
+  if (field_cond_desc == nullptr || value_cond_desc == nullptr || value_cond_desc->value == nullptr)
   {
-    rc = RC::SUCCESS;
+    return false;
   }
-  else
+  // NOT_EQUAL、IS_NULL等只能扫描整个索引再回表，还不如直接扫描记录
+  if (comp_op != EQUAL_TO && comp_op != LESS_THAN && comp_op != LESS_EQUAL &&
+      comp_op != GREAT_THAN && comp_op != GREAT_EQUAL)
   {
-    LOG_ERROR("failed to scan record. file id=%d, rc=%d:%s", file_id_, rc, strrc(rc));
+    return false;
   }
-  scanner.close_scan();
-  return rc;
-}
 
-RC Table::scan_record_by_index(Trx *trx, IndexScanner *scanner, ConditionFilter *filter, int limit, void *context,
-                               RC (*record_reader)(Record *, void *))
-{
-  RC rc = RC::SUCCESS;
-  RID rid;
-  Record record;
-  int record_count = 0;
-  while (record_count < limit)
+  const FieldMeta *field_meta = table_meta_.find_field_by_offset(field_cond_desc->attr_offset);
+  if (nullptr == field_meta)
   {
-    // 通过bplustree搜索获取rid
-    rc = scanner->next_entry(&rid);
-    if (rc != RC::SUCCESS)
-    {
-      if (RC::RECORD_EOF == rc)
-      {
-        rc = RC::SUCCESS;
-        break;
-      }
-      LOG_ERROR("Failed to scan table by index. rc=%d:%s", rc, strrc(rc));
-      break;
-    }
-    // 根据rid获取record
-    rc = record_handler_->get_record(&rid, &record);
-    if (rc != RC::SUCCESS)
-    {
-      LOG_ERROR("Failed to fetch record of rid=%d:%d, rc=%d:%s", rid.page_num, rid.slot_num, rc, strrc(rc));
-      break;
-    }
-    LOG_INFO("get record");
-
-    if ((trx == nullptr || trx->is_visible(this, &record)) && (filter == nullptr || filter->filter(record)))
-    {
-      rc = record_reader(&record, context);
-      if (rc != RC::SUCCESS)
-      {
-        LOG_TRACE("Record reader break the table scanning. rc=%d:%s", rc, strrc(rc));
-        break;
-      }
-    }
-    record_count++;
+    LOG_PANIC("Cannot find field by offset %d. table=%s",
+              field_cond_desc->attr_offset, name());
+    return false;
+  }
+  // 类型不同的值（比如null）没法和索引中的key比较，字典编码的字段只有换成编码的等值条件可以用索引
+  if (field_meta->storage_type() != value_type)
+  {
+    return false;
   }
 
-  scanner->destroy();
-  return rc;
+  IndexCondition condition;
+  condition.field = field_meta;
+  condition.comp_op = comp_op;
+  condition.value = (const char *)value_cond_desc->value;
+  conditions.push_back(condition);
+  return true;
 }
 
-class IndexInserter
+bool Table::find_like_index_conditions(const DefaultConditionFilter &filter,
+                                       std::vector<IndexCondition> &conditions) const
 {
-public:
-  explicit IndexInserter(Index *index) : index_(index)
+  // 'abc%'换成 >= 'abc' and < 'abd'，没有通配符时就是等值条件。
+  // 范围中不匹配的记录（比如'abc_d'中_的位置）由过滤条件去掉
+  const LikeMatcher *like = filter.like();
+  if (filter.comp_op() != LIKE_OP || !filter.left().is_attr || like->prefix().empty())
   {
+    return false;
   }
-
-  RC insert_index(const Record *record)
+  const FieldMeta *field_meta = table_meta_.find_field_by_offset(filter.left().attr_offset);
+  if (nullptr == field_meta || field_meta->storage_type() != CHARS)
+  {
+    return false;
+  }
+  IndexCondition condition;
+  condition.field = field_meta;
+  condition.value = like->prefix().c_str();
+  if (like->exact())
+  {
+    condition.comp_op = EQUAL_TO;
+    conditions.push_back(condition);
+    return true;
+  }
+  condition.comp_op = GREAT_EQUAL;
+  conditions.push_back(condition);
+  if (like->upper_bound() != nullptr)
   {
-    return index_->insert_entry(record->data, &record->rid);
+    condition.comp_op = LESS_THAN;
+    condition.value = like->upper_bound();
+    conditions.push_back(condition);
   }
+  return true;
+}
 
-private:
-  Index *index_;
-};
 
-static RC insert_index_record_reader_adapter(Record *record, void *context)
+
+/**
+ * 范围分区i的记录在[bound(i-1), bound(i))中，第一个分区没有下界，没有上界的分区到正无穷。
+ * 分区字段是null的记录放在第一个分区，比较条件对null都不成立
+ */
+static bool range_partition_match(const FieldMeta &field, const PartitionMeta *low, const PartitionMeta &high,
+                                  const IndexCondition &condition)
 {
-  IndexInserter &inserter = *(IndexInserter *)context;
-  return inserter.insert_index(record);
+  const char *value = condition.value;
+  switch (condition.comp_op)
+  {
+  case EQUAL_TO:
+    return (low == nullptr || PartitionMeta::compare(field, low->bound(), value) <= 0) &&
+           (!high.has_bound() || PartitionMeta::compare(field, value, high.bound()) < 0);
+  case LESS_THAN:
+    return low == nullptr || PartitionMeta::compare(field, low->bound(), value) < 0;
+  case LESS_EQUAL:
+    return low == nullptr || PartitionMeta::compare(field, low->bound(), value) <= 0;
+  case GREAT_THAN:
+  case GREAT_EQUAL:
+    return !high.has_bound() || PartitionMeta::compare(field, high.bound(), value) > 0;
+  default:
+    return true;
+  }
 }
 
-std::vector<const char *> Table::get_index_names()
+void Table::prune_partitions(const ConditionFilter *filter, std::vector<Table *> &partitions) const
 {
-  std::vector<const char *> res;
-  for (auto idx : indexes_)
+  const FieldMeta *field = table_meta_.partition_field();
+  std::vector<IndexCondition> conditions;
+  collect_index_conditions(filter, conditions);
+  conditions.erase(std::remove_if(conditions.begin(), conditions.end(),
+                                  [field](const IndexCondition &condition) {
+                                    return condition.field->offset() != field->offset();
+                                  }),
+                   conditions.end());
+
+  partitions.clear();
+  const int partition_num = table_meta_.partition_num();
+  for (int i = 0; i < partition_num; i++)
   {
-    LOG_ERROR("index_name = %s", idx->index_meta().name());
-    res.push_back(idx->index_meta().name());
+    bool match = true;
+    for (size_t j = 0; j < conditions.size() && match; j++)
+    {
+      if (table_meta_.partition_type() == HASH_PARTITION)
+      {
+        // hash分区只能按等值条件确定分区
+        match = conditions[j].comp_op != EQUAL_TO ||
+                (int)(PartitionMeta::hash(*field, conditions[j].value) % partition_num) == i;
+      }
+      else
+      {
+        match = range_partition_match(*field, i == 0 ? nullptr : table_meta_.partition(i - 1),
+                                      *table_meta_.partition(i), conditions[j]);
+      }
+    }
+    if (match)
+    {
+      partitions.push_back(partitions_[i]);
+    }
   }
-
-  return res;
+  LOG_DEBUG("Table %s scans %d of %d partitions", name(), (int)partitions.size(), partition_num);
 }
 
-RC Table::create_index(Trx *trx, const char *index_name, const char *attribute_name)
+RC Table::drop_partition(const char *partition_name)
 {
-  // LOG_INFO("create_index starts");
-  if (index_name == nullptr || common::is_blank(index_name) ||
-      attribute_name == nullptr || common::is_blank(attribute_name))
+  std::lock_guard<std::mutex> build_guard(index_build_mutex_);
+  CompactLockGuard guard(compact_lock_, true);
+  if (!partitioned())
   {
-    LOG_ERROR("create_index - INVALID_ARGUMENT");
+    LOG_WARN("Table %s is not partitioned", name());
     return RC::INVALID_ARGUMENT;
   }
-  if (table_meta_.index(index_name) != nullptr ||
-      table_meta_.find_index_by_field(attribute_name))
+  // 删除文件之后事务没法回滚分区中的修改
+  if (Trx::active_trx_count() > 0)
   {
-    LOG_ERROR("create_index - SCHEMA_INDEX_EXIST");
-    return RC::SCHEMA_INDEX_EXIST;
+    LOG_WARN("Cannot drop partition %s of table %s while some transactions are active", partition_name, name());
+    return RC::LOCKED;
   }
-
-  const FieldMeta *field_meta = table_meta_.field(attribute_name);
-  if (!field_meta)
+  const int index = table_meta_.find_partition_by_name(partition_name);
+  if (index < 0)
   {
-    LOG_ERROR("create_index - SCHEMA_FIELD_MISSING");
-    return RC::SCHEMA_FIELD_MISSING;
+    LOG_WARN("No such partition %s of table %s", partition_name, name());
+    return RC::NOTFOUND;
   }
 
-  IndexMeta new_index_meta;
-  RC rc = new_index_meta.init(index_name, *field_meta);
+  TableMeta new_table_meta(table_meta_);
+  RC rc = new_table_meta.remove_partition(partition_name);
   if (rc != RC::SUCCESS)
   {
-    LOG_ERROR("fail to init index meta");
     return rc;
   }
-
-  // 创建索引相关数据
-  BplusTreeIndex *index = new BplusTreeIndex();
-  std::string index_file = index_data_file(base_dir_.c_str(), name(), index_name);
-  // 创建对应文件
-  rc = index->create(index_file.c_str(), new_index_meta, *field_meta);
+  // 先保存元数据再删除文件，中途崩溃最多留下没有用的文件
+  rc = save_meta(new_table_meta);
   if (rc != RC::SUCCESS)
   {
-    delete index;
-    LOG_ERROR("Failed to create bplus tree index. file name=%s, rc=%d:%s", index_file.c_str(), rc, strrc(rc));
     return rc;
   }
+  Table *partition = partitions_[index];
+  partitions_.erase(partitions_.begin() + index);
+  table_meta_.swap(new_table_meta);
+  data_changed();
+  LOG_INFO("Drop partition %s of table %s", partition_name, name());
+  return remove_partition(partition);
+}
 
-  // 遍历当前的所有数据，插入这个索引
-  IndexInserter index_inserter(index);
-  rc = scan_record(trx, nullptr, -1, &index_inserter, insert_index_record_reader_adapter);
-  if (rc != RC::SUCCESS)
+RC Table::drop_files()
+{
+  std::lock_guard<std::mutex> build_guard(index_build_mutex_);
+  CompactLockGuard guard(compact_lock_, true);
+  if (!partitioned())
   {
-    // rollback
-    delete index;
-    LOG_ERROR("Failed to insert index to all records. table=%s, rc=%d:%s", name(), rc, strrc(rc));
-    return rc;
+    return drop_storage();
+  }
+  RC rc = RC::SUCCESS;
+  for (Table *partition : partitions_)
+  {
+    RC rc2 = remove_partition(partition);
+    if (rc2 != RC::SUCCESS)
+    {
+      rc = rc2;
+    }
   }
-  indexes_.push_back(index);
+  partitions_.clear();
+  return rc;
+}
 
-  TableMeta new_table_meta(table_meta_);
-  rc = new_table_meta.add_index(new_index_meta);
-  if (rc != RC::SUCCESS)
+RC Table::truncate()
+{
+  std::lock_guard<std::mutex> build_guard(index_build_mutex_);
+  CompactLockGuard guard(compact_lock_, true);
+  // 删除文件之后事务没法回滚表中的修改
+  if (Trx::active_trx_count() > 0)
   {
-    LOG_ERROR("Failed to add index (%s) on table (%s). error=%d:%s", index_name, name(), rc, strrc(rc));
-    return rc;
+    LOG_WARN("Cannot truncate table %s while some transactions are active", name());
+    return RC::LOCKED;
   }
-  // 创建元数据临时文件
-  std::string tmp_file = table_meta_file(base_dir_.c_str(), name()) + ".tmp";
-  std::fstream fs;
-  fs.open(tmp_file, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
-  if (!fs.is_open())
+  RC rc = RC::SUCCESS;
+  if (partitioned())
   {
-    LOG_ERROR("Failed to open file for write. file name=%s, errmsg=%s", tmp_file.c_str(), strerror(errno));
-    return RC::IOERR; // 创建索引中途出错，要做还原操作
+    for (Table *partition : partitions_)
+    {
+      CompactLockGuard partition_guard(partition->compact_lock_, true);
+      rc = partition->truncate_storage();
+      partition->stats_valid_ = false;
+      if (rc != RC::SUCCESS)
+      {
+        break;
+      }
+    }
   }
-  if (new_table_meta.serialize(fs) < 0)
+  else
   {
-    LOG_ERROR("Failed to dump new table meta to file: %s. sys err=%d:%s", tmp_file.c_str(), errno, strerror(errno));
-    return RC::IOERR;
+    rc = truncate_storage();
   }
-  fs.close();
-
-  // 覆盖原始元数据文件
-  std::string meta_file = table_meta_file(base_dir_.c_str(), name());
-  int ret = rename(tmp_file.c_str(), meta_file.c_str());
-  if (ret != 0)
+  stats_valid_ = false;
+  stats_row_delta_ = 0;
+  stats_changes_ = 0;
+  data_changed();
+  if (rc != RC::SUCCESS)
   {
-    LOG_ERROR("Failed to rename tmp meta file (%s) to normal meta file (%s) while creating index (%s) on table (%s). "
-              "system error=%d:%s",
-              tmp_file.c_str(), meta_file.c_str(), index_name, name(), errno, strerror(errno));
-    return RC::IOERR;
+    LOG_ERROR("Failed to truncate table %s. rc=%d:%s", name(), rc, strrc(rc));
+    return rc;
   }
+  LOG_INFO("Truncate table %s", name());
+  return rc;
+}
 
-  table_meta_.swap(new_table_meta);
+void Table::add_materialized_view(MaterializedView *view)
+{
+  std::lock_guard<std::mutex> lock(views_mutex_);
+  views_.push_back(view);
+  has_views_ = true;
+}
 
-  LOG_INFO("successfully add a new index (%s) on the table (%s)", index_name, name());
+void Table::remove_materialized_view(MaterializedView *view)
+{
+  std::lock_guard<std::mutex> lock(views_mutex_);
+  views_.erase(std::remove(views_.begin(), views_.end(), view), views_.end());
+  has_views_ = !views_.empty();
+}
+
+std::vector<MaterializedView *> Table::materialized_views()
+{
+  std::lock_guard<std::mutex> lock(views_mutex_);
+  return views_;
+}
 
+RC Table::remove_partition(Table *partition)
+{
+  RC rc = partition->drop_files();
+  delete partition;
   return rc;
 }
 
-class RecordUpdater
+RC Table::drop_storage()
 {
-public:
-  RecordUpdater(Table &table, Trx *trx, const char *attribute_name, const Value *value) : table_(table), trx_(trx), attribute_name_(attribute_name), value_(value)
+  // 版本链和等待清理的修改都按表的指针保存
+  Trx::drop_table(this);
+
+  std::vector<std::string> files;
+  for (size_t i = 0; i < indexes_.size(); i++)
   {
+    files.push_back(index_data_file(base_dir_.c_str(), name(), indexes_[i]->index_meta().name()));
+    indexes_[i]->drop();
+    delete indexes_[i];
   }
+  indexes_.clear();
 
-  RC update_record(Record *record)
+  delete record_handler_;
+  record_handler_ = nullptr;
+  delete mem_records_;
+  mem_records_ = nullptr;
+  RC rc = RC::SUCCESS;
+  if (data_buffer_pool_ != nullptr && file_id_ >= 0)
+  {
+    rc = data_buffer_pool_->drop_file(file_id_);
+    file_id_ = -1;
+  }
+  data_buffer_pool_ = nullptr;
+  // 文件马上删除，zone map不用保存
+  delete zone_map_;
+  zone_map_ = nullptr;
+  row_count_.clear();
+  delete undo_file_;
+  undo_file_ = nullptr;
+
+  // 内存表只有undo文件
+  if (in_memory())
   {
-    RC rc = RC::SUCCESS;
-    rc = table_.update_record(trx_, record, attribute_name_, value_);
-    if (rc == RC::SUCCESS)
-    {
-      ++updated_count_;
-    }
     return rc;
   }
-
-  int updated_count() const
+  files.push_back(base_dir_ + "/" + name() + TABLE_DATA_SUFFIX);
+  files.push_back(base_dir_ + "/" + name() + TABLE_ZONE_SUFFIX);
+  for (const std::string &file : files)
   {
-    return updated_count_;
+    if (::remove(file.c_str()) != 0 && errno != ENOENT)
+    {
+      LOG_ERROR("Failed to remove table file: %s, errmsg=%s", file.c_str(), strerror(errno));
+      rc = RC::IOERR;
+    }
   }
-
-private:
-  Table &table_;
-  Trx *trx_;
-  int updated_count_ = 0;
-  const char *attribute_name_;
-  const Value *value_;
-};
-
-static RC record_reader_update_adapter(Record *record, void *context)
-{
-  RecordUpdater &record_updater = *(RecordUpdater *)context;
-  // std::cout << record->data << std::endl;
-
-  return record_updater.update_record(record);
+  return rc;
 }
 
-RC Table::update_record(Trx *trx, const char *attribute_name, const Value *value, int condition_num, const Condition conditions[], int *updated_count)
+RC Table::truncate_storage()
 {
-  // TODO(xiong): 任务3 实现udpate功能，update单个字段即可。
-  if (nullptr == value || nullptr == attribute_name)
+  const bool memory = in_memory();
+  const bool pax_format = pax();
+  const int page_size = memory ? BP_PAGE_SIZE : data_buffer_pool_->page_size();
+  PageCompression compression = PAGE_COMPRESSION_NONE;
+  if (!memory)
   {
-    LOG_ERROR("Invalid argument. values=%p, attribute_name=%p", value, attribute_name);
-    return RC::INVALID_ARGUMENT;
+    data_buffer_pool_->get_file_compression(file_id_, &compression);
   }
 
-  // 1.1 有条件，则获取条件过滤器
-  RecordUpdater updater(*this, trx, attribute_name, value);
-  RC rc = RC::SUCCESS;
-
-  if (condition_num > 0)
+  RC rc = drop_storage();
+  if (rc != RC::SUCCESS)
   {
-    // 元数据检查：判断where中表名是否与要update的表名一致
-    const char *rel_name = table_meta_.name();
-    for (int i = 0; i < condition_num; i++)
+    return rc;
+  }
+  // 新建的空文件不再映射，可以重新加载，下次打开表时再映射
+  read_only_ = false;
+  if (memory)
+  {
+    rc = init_mem_records();
+    if (rc == RC::SUCCESS)
     {
-      const Condition &cond = conditions[i];
-      if (cond.left_is_attr == 1)
-      {
-        const char *cond_rel_name = cond.left_attr.relation_name;
-        if (cond_rel_name != nullptr && strcmp(cond_rel_name, rel_name) != 0)
-        {
-          LOG_ERROR("update的表名和where条件中不一致");
-          return RC::SCHEMA_TABLE_NAME_ILLEGAL;
-        }
-      }
-
-      if (cond.right_is_attr == 1)
-      {
-        const char *cond_rel_name = cond.right_attr.relation_name;
-        if (cond_rel_name != nullptr && strcmp(cond_rel_name, rel_name) != 0)
-        {
-          LOG_ERROR("update的表名和where条件中不一致");
-          return RC::SCHEMA_TABLE_NAME_ILLEGAL;
-        }
-      }
+      rc = init_undo_file(base_dir_.c_str());
     }
+  }
+  else
+  {
+    rc = create_storage(base_dir_.c_str(), page_size, compression, pax_format);
+  }
 
-    CompositeConditionFilter condition_filter;
-    rc = condition_filter.init(*this, conditions, condition_num);
-    if (rc != RC::SUCCESS)
+  for (int i = 0; rc == RC::SUCCESS && i < table_meta_.index_num(); i++)
+  {
+    const IndexMeta *index_meta = table_meta_.index(i);
+    std::vector<FieldMeta> field_metas;
+    for (int j = 0; j < index_meta->field_num(); j++)
     {
-      return rc;
+      field_metas.push_back(*table_meta_.field(index_meta->field(j)));
+    }
+    Index *index = nullptr;
+    rc = create_empty_index(*index_meta, field_metas, &index);
+    if (rc == RC::SUCCESS)
+    {
+      indexes_.push_back(index);
     }
-    // 2. 筛选满足所有条件的record，逐条进行更新
-    // -1表示不对筛选数量进行限制，
-    rc = scan_record(trx, &condition_filter, -1, &updater, record_reader_update_adapter);
   }
-  else
+  // 新文件马上写到磁盘上。已经持有整理锁的写锁，不能调用sync
+  if (rc == RC::SUCCESS && !memory)
   {
-    // 1.2 没条件，则遍历所有元组
-    rc = scan_record(trx, nullptr, -1, &updater, record_reader_update_adapter);
+    rc = data_buffer_pool_->flush_all_pages(file_id_);
   }
-
-  if (updated_count != nullptr)
+  for (size_t i = 0; rc == RC::SUCCESS && !memory && i < indexes_.size(); i++)
   {
-    *updated_count = updater.updated_count();
+    rc = indexes_[i]->sync();
   }
-
-  if (rc != RC::SUCCESS)
+  if (rc == RC::SUCCESS && !memory)
   {
-    return rc;
+    rc = zone_map_->save();
+  }
+  if (rc == RC::SUCCESS && !memory)
+  {
+    rc = row_count_.save();
   }
-
   return rc;
 }
 
-RC Table::update_record(Trx *trx, Record *record, const char *attribute_name, const Value *value)
+bool Table::index_covers(const Index &index, const std::vector<int> &columns) const
 {
-  // 1. 获得字段数据
-  int i = table_meta_.find_field_index_by_name(attribute_name);
-  if (i == -1)
+  // 只有前缀的字段没法从索引中还原出来
+  if (index.index_meta().has_prefix())
   {
-    // 不存在该属性
-    return RC::SCHEMA_FIELD_NOT_EXIST;
+    return false;
   }
-  const FieldMeta *field_meta = table_meta_.field(i);
-
-  RC rc = RC::SUCCESS;
-  // if (trx != nullptr)
-  if (false)
+  for (int column : columns)
   {
-    // 更新record
-    // 深拷贝record->data
-    char *new_record_data = new char[strlen(record->data) + 1];
-    strcpy(new_record_data, record->data);
-    memcpy(new_record_data + field_meta->offset(), value->data, field_meta->len());
-
-    // 更新事务
-    rc = trx->update_record(this, record, new_record_data);
-    if (rc != RC::SUCCESS)
+    const FieldMeta *field = table_meta_.field(column);
+    bool found = false;
+    for (const FieldMeta &index_field : index.field_metas())
     {
-      return rc;
+      if (0 == strcmp(index_field.name(), field->name()))
+      {
+        found = !index_field.nullable();
+        break;
+      }
     }
-  }
-
-  Index *index = find_index(attribute_name);
-
-  // 删除索引index
-  if (index != nullptr)
-  {
-    // RC rc = delete_entry_of_indexes(record->data, record->rid, false); // 重复代码 refer to commit_delete
-    rc = index->delete_entry(record->data, &record->rid);
-    if (rc != RC::SUCCESS)
+    if (!found)
     {
-      LOG_ERROR("Failed to delete indexes of record (rid=%d.%d). rc=%d:%s",
-                record->rid.page_num, record->rid.slot_num, rc, strrc(rc));
-      return rc;
+      return false;
     }
   }
+  return true;
+}
 
-  // 更新record
-  rc = is_legal(*value, field_meta);
-  if (rc != RC::SUCCESS)
-  {
-    return rc;
-  }
-  memcpy(record->data + field_meta->offset(), value->data, field_meta->len());
-  // 更新null状态
-  auto last_field = table_meta_.field(table_meta_.field_num() - 1);
-  int null_field_index = last_field->offset() + last_field->len();
-  memcpy(record->data + null_field_index + i - 1, &value->is_null, 1);
-
-  rc = record_handler_->update_record(record);
-  if (rc != RC::SUCCESS)
+void Table::collect_index_conditions(const ConditionFilter *filter, std::vector<IndexCondition> &conditions) const
+{
+  // remove dynamic_cast
+  const DefaultConditionFilter *default_condition_filter = dynamic_cast<const DefaultConditionFilter *>(filter);
+  const CompositeConditionFilter *composite_condition_filter = dynamic_cast<const CompositeConditionFilter *>(filter);
+  if (default_condition_filter != nullptr)
   {
-    LOG_ERROR("Update record failed. table name=%s, rc=%d:%s", table_meta_.name(), rc, strrc(rc));
-    return rc;
+    find_index_conditions(*default_condition_filter, conditions);
   }
-
-  // 插入index
-  if (index != nullptr)
+  else if (composite_condition_filter != nullptr)
   {
-    // rc = insert_entry_of_indexes(record->data, record->rid);
-    rc = index->insert_entry(record->data, &record->rid);
-    if (rc != RC::SUCCESS)
+    int filter_num = composite_condition_filter->filter_num();
+    for (int i = 0; i < filter_num; i++)
     {
-      LOG_ERROR("insert_entry_of_indexes fail");
-      RC rc2 = delete_entry_of_indexes(record->data, record->rid, true);
-      if (rc2 != RC::SUCCESS)
+      default_condition_filter = dynamic_cast<const DefaultConditionFilter *>(&composite_condition_filter->filter(i));
+      if (default_condition_filter != nullptr)
       {
-        LOG_PANIC("Failed to rollback index data when insert index entries failed. table name=%s, rc=%d:%s",
-                  name(), rc2, strrc(rc2));
-      }
-      rc2 = record_handler_->delete_record(&record->rid);
-      if (rc2 != RC::SUCCESS)
-      {
-        LOG_PANIC("Failed to rollback record data when insert index entries failed. table name=%s, rc=%d:%s",
-                  name(), rc2, strrc(rc2));
+        find_index_conditions(*default_condition_filter, conditions);
       }
-      return rc;
     }
   }
-  return rc;
 }
 
-RC Table::commit_update(Trx *trx, const RID &rid, char *new_record_data)
+bool Table::choose_index_scan_range(const ConditionFilter *filter, IndexScanRange &best) const
 {
-  RC rc = RC::SUCCESS;
-  Record record;
-  rc = record_handler_->get_record(&rid, &record);
-  if (rc != RC::SUCCESS)
+  // 备库的B+树在打开时缓存的根节点等信息不随重放更新，只用顺序扫描
+  if (nullptr == filter || indexes_.empty() || Trx::replica())
   {
-    return rc;
+    return false;
+  }
+  std::vector<IndexCondition> conditions;
+  collect_index_conditions(filter, conditions);
+  if (conditions.empty())
+  {
+    return false;
   }
 
-  // 删除索引index
-  rc = delete_entry_of_indexes(record.data, record.rid, false); // 重复代码 refer to commit_delete
-  if (rc != RC::SUCCESS)
+  // 每个索引按字段前缀匹配条件，比如(a, b)上的索引可以用 a = 1 and b > 5，只有 b > 5 时用不上。
+  // 执行过ANALYZE TABLE的表按统计信息估计代价，选代价最小的索引，比顺序扫描还贵时不用索引；
+  // 没有统计信息时选范围最窄的索引
+  const bool analyzed = table_meta_.analyzed();
+  double best_cost = analyzed ? (double)table_meta_.stats_row_count() : 0;
+  for (Index *index : indexes_)
   {
-    LOG_ERROR("Failed to delete indexes of record (rid=%d.%d). rc=%d:%s",
-              record.rid.page_num, record.rid.slot_num, rc, strrc(rc));
-    return rc;
+    IndexScanRange range;
+    if (!build_index_scan_range(index, conditions, range))
+    {
+      continue;
+    }
+    if (analyzed)
+    {
+      const double cost = index_scan_cost(range);
+      if (cost < best_cost)
+      {
+        best_cost = cost;
+        best = std::move(range);
+      }
+    }
+    else if (best.index == nullptr || index_scan_range_rank(range) > index_scan_range_rank(best))
+    {
+      best = std::move(range);
+    }
   }
+  return best.index != nullptr;
+}
 
-  // 更新record
-  strcpy(record.data, new_record_data);
-  rc = record_handler_->update_record(&record);
-  if (rc != RC::SUCCESS)
+void Table::choose_intersect_ranges(const ConditionFilter *filter, std::vector<IndexScanRange> &ranges) const
+{
+  IndexScanRange best;
+  if (!choose_index_scan_range(filter, best))
   {
-    LOG_ERROR("Update record failed. table name=%s, rc=%d:%s", table_meta_.name(), rc, strrc(rc));
-    return rc;
+    return;
   }
+  std::vector<IndexCondition> conditions;
+  collect_index_conditions(filter, conditions);
 
-  // 插入index
-  rc = insert_entry_of_indexes(record.data, record.rid);
-  if (rc != RC::SUCCESS)
+  // 已经用来缩小范围的字段
+  std::vector<std::string> used_fields;
+  const int best_column_num = std::max(best.low_column_num, best.high_column_num);
+  for (int i = 0; i < best_column_num; i++)
   {
-    LOG_ERROR("insert_entry_of_indexes fail");
-    RC rc2 = delete_entry_of_indexes(record.data, record.rid, true);
-    if (rc2 != RC::SUCCESS)
+    used_fields.push_back(best.index->field_metas()[i].name());
+  }
+  const bool analyzed = table_meta_.analyzed();
+  for (Index *index : indexes_)
+  {
+    if ((int)ranges.size() >= TABLE_INTERSECT_MAX_INDEXES)
     {
-      LOG_PANIC("Failed to rollback index data when insert index entries failed. table name=%s, rc=%d:%s",
-                name(), rc2, strrc(rc2));
+      break;
     }
-    rc2 = record_handler_->delete_record(&record.rid);
-    if (rc2 != RC::SUCCESS)
+    const char *first_field = index->field_metas()[0].name();
+    if (index == best.index || std::find(used_fields.begin(), used_fields.end(), first_field) != used_fields.end())
     {
-      LOG_PANIC("Failed to rollback record data when insert index entries failed. table name=%s, rc=%d:%s",
-                name(), rc2, strrc(rc2));
+      continue;
     }
-    return rc;
+    // 只用等值条件，范围条件选中的rid通常太多
+    IndexScanRange range;
+    if (!build_index_scan_range(index, conditions, range) || range.eq_column_num == 0 ||
+        (analyzed && index_scan_range_selectivity(range) > TABLE_INTERSECT_MAX_SELECTIVITY))
+    {
+      continue;
+    }
+    for (int i = 0; i < range.eq_column_num; i++)
+    {
+      used_fields.push_back(index->field_metas()[i].name());
+    }
+    ranges.push_back(std::move(range));
   }
-  return rc;
 }
 
-class RecordDeleter
+RC Table::intersect_index_rids(const ConditionFilter *filter, std::vector<RID> &rids)
 {
-public:
-  RecordDeleter(Table &table, Trx *trx) : table_(table), trx_(trx)
+  std::vector<IndexScanRange> ranges;
+  choose_intersect_ranges(filter, ranges);
+  if (ranges.empty())
   {
+    return RC::SUCCESS;
   }
 
-  RC delete_record(Record *record)
+  std::sort(rids.begin(), rids.end());
+  std::vector<RID> other;
+  std::vector<RID> result;
+  for (const IndexScanRange &range : ranges)
   {
+    if (rids.empty())
+    {
+      break;
+    }
+    IndexScanner *scanner = range.index->create_range_scanner(range.low.data(), range.low_column_num,
+                                                              range.low_inclusive, range.high.data(),
+                                                              range.high_column_num, range.high_inclusive);
+    if (nullptr == scanner)
+    {
+      continue;
+    }
+    other.clear();
+    RID rid;
     RC rc = RC::SUCCESS;
-    rc = table_.delete_record(trx_, record);
-    if (rc == RC::SUCCESS)
+    while ((rc = scanner->next_entry(&rid)) == RC::SUCCESS)
     {
-      deleted_count_++;
+      other.push_back(rid);
     }
-    return rc;
+    scanner->destroy();
+    if (rc != RC::RECORD_EOF)
+    {
+      LOG_ERROR("Failed to scan index for intersection. index=%s, rc=%d:%s",
+                range.index->index_meta().name(), rc, strrc(rc));
+      return rc;
+    }
+    std::sort(other.begin(), other.end());
+    result.clear();
+    std::set_intersection(rids.begin(), rids.end(), other.begin(), other.end(), std::back_inserter(result));
+    rids.swap(result);
   }
+  return RC::SUCCESS;
+}
 
-  int deleted_count() const
+void Table::find_intersect_indexes(const ConditionFilter *filter, std::vector<Index *> &indexes) const
+{
+  std::vector<IndexScanRange> ranges;
+  choose_intersect_ranges(filter, ranges);
+  for (const IndexScanRange &range : ranges)
   {
-    return deleted_count_;
+    indexes.push_back(range.index);
   }
+}
 
-private:
-  Table &table_;
-  Trx *trx_;
-  int deleted_count_ = 0;
-};
-
-static RC record_reader_delete_adapter(Record *record, void *context)
+IndexScanner *Table::find_index_for_scan(const ConditionFilter *filter, Index **index)
 {
-  RecordDeleter &record_deleter = *(RecordDeleter *)context;
-  // std::cout << record->data << std::endl;
-  return record_deleter.delete_record(record);
+  IndexScanRange best;
+  if (!choose_index_scan_range(filter, best))
+  {
+    return nullptr;
+  }
+  if (index != nullptr)
+  {
+    *index = best.index;
+  }
+  return best.index->create_range_scanner(best.low.data(), best.low_column_num, best.low_inclusive,
+                                          best.high.data(), best.high_column_num, best.high_inclusive);
 }
 
-RC Table::delete_record(Trx *trx, ConditionFilter *filter, int *deleted_count)
+/**
+ * order_fields是不是从index的第skip个字段开始的连续几个字段，并且索引中的顺序就是值的顺序
+ */
+static bool index_provides_order(const Index &index, const std::vector<const FieldMeta *> &order_fields, int skip)
 {
-  RecordDeleter deleter(*this, trx);
-  RC rc = scan_record(trx, filter, -1, &deleter, record_reader_delete_adapter);
-  if (deleted_count != nullptr)
+  const std::vector<FieldMeta> &fields = index.field_metas();
+  if (index.index_meta().type() != BPLUS_TREE_INDEX || skip + order_fields.size() > fields.size())
   {
-    *deleted_count = deleter.deleted_count();
+    return false;
   }
-  return rc;
+  for (size_t i = 0; i < order_fields.size(); i++)
+  {
+    const FieldMeta *field = order_fields[i];
+    // 字典编码保存的是编码，FLOATS的比较有误差，只索引前缀的字段只有前缀有序
+    if (field->dictionary() != nullptr || field->type() == FLOATS || index.index_meta().prefix_length(skip + i) > 0 ||
+        strcmp(field->name(), fields[skip + i].name()) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
 }
 
-RC Table::delete_record(Trx *trx, Record *record)
+IndexScanner *Table::find_index_for_order(const ConditionFilter *filter,
+                                          const std::vector<const FieldMeta *> &order_fields, bool descending,
+                                          Index **index)
 {
-  RC rc = RC::SUCCESS;
-  if (trx != nullptr)
+  if (order_fields.empty() || indexes_.empty() || Trx::replica())
   {
-    rc = trx->delete_record(this, record);
+    return nullptr;
+  }
+  // 条件能用上索引时只考虑选中的那个索引，前面等值比较的字段可以跳过，比如(a, b)上的索引在 a = 1 时按b有序
+  IndexScanRange range;
+  if (choose_index_scan_range(filter, range))
+  {
+    // 等值比较的字段在结果中是常量，不影响顺序，比如a = 1时(a, b)上的索引按(b, a)也有序
+    const std::vector<FieldMeta> &index_fields = range.index->field_metas();
+    std::vector<const FieldMeta *> remaining;
+    for (const FieldMeta *field : order_fields)
+    {
+      bool constant = false;
+      for (int i = 0; i < range.eq_column_num && !constant; i++)
+      {
+        constant = 0 == strcmp(field->name(), index_fields[i].name());
+      }
+      if (!constant)
+      {
+        remaining.push_back(field);
+      }
+    }
+    bool found = remaining.empty();
+    for (int skip = 0; skip <= range.eq_column_num && !found; skip++)
+    {
+      found = index_provides_order(*range.index, remaining, skip);
+    }
+    if (!found)
+    {
+      return nullptr;
+    }
   }
   else
   {
-    rc = delete_entry_of_indexes(record->data, record->rid, false); // 重复代码 refer to commit_delete
-    if (rc != RC::SUCCESS)
+    for (Index *candidate : indexes_)
     {
-      LOG_ERROR("Failed to delete indexes of record (rid=%d.%d). rc=%d:%s",
-                record->rid.page_num, record->rid.slot_num, rc, strrc(rc));
+      if (index_provides_order(*candidate, order_fields, 0))
+      {
+        range = IndexScanRange();
+        range.index = candidate;
+        break;
+      }
     }
-    else
+    if (range.index == nullptr)
     {
-      rc = record_handler_->delete_record(&record->rid);
+      return nullptr;
     }
   }
-  return rc;
+  if (index != nullptr)
+  {
+    *index = range.index;
+  }
+  return range.index->create_ordered_scanner(range.low.data(), range.low_column_num, range.low_inclusive,
+                                             range.high.data(), range.high_column_num, range.high_inclusive,
+                                             descending);
 }
 
-RC Table::commit_delete(Trx *trx, const RID &rid)
+RC Table::sync()
 {
-  RC rc = RC::SUCCESS;
-  Record record;
-  rc = record_handler_->get_record(&rid, &record);
+  if (in_memory())
+  {
+    return RC::SUCCESS;
+  }
+  if (partitioned())
+  {
+    CompactLockGuard guard(compact_lock_, false);
+    for (Table *partition : partitions_)
+    {
+      RC rc = partition->sync();
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+    }
+    return RC::SUCCESS;
+  }
+  RC rc = data_buffer_pool_->flush_all_pages(file_id_);
   if (rc != RC::SUCCESS)
   {
+    LOG_ERROR("Failed to flush table's data pages. table=%s, rc=%d:%s", name(), rc, strrc(rc));
     return rc;
   }
-  rc = delete_entry_of_indexes(record.data, record.rid, false);
-  if (rc != RC::SUCCESS)
+
+  for (Index *index : indexes_)
   {
-    LOG_ERROR("Failed to delete indexes of record(rid=%d.%d). rc=%d:%s",
-              rid.page_num, rid.slot_num, rc, strrc(rc)); // panic?
+    rc = index->sync();
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to flush index's pages. table=%s, index=%s, rc=%d:%s",
+                name(), index->index_meta().name(), rc, strrc(rc));
+      return rc;
+    }
   }
 
-  rc = record_handler_->delete_record(&rid);
+  // 保存zone map时不能有其它线程在修改记录
+  {
+    CompactLockGuard guard(compact_lock_, true);
+    rc = zone_map_->save();
+  }
   if (rc != RC::SUCCESS)
   {
+    LOG_ERROR("Failed to save zone map. table=%s, rc=%d:%s", name(), rc, strrc(rc));
     return rc;
   }
-
-  return rc;
-}
-
-RC Table::rollback_delete(Trx *trx, const RID &rid)
-{
-  RC rc = RC::SUCCESS;
-  Record record;
-  rc = record_handler_->get_record(&rid, &record);
+  rc = row_count_.save();
   if (rc != RC::SUCCESS)
   {
+    LOG_ERROR("Failed to save row count. table=%s, rc=%d:%s", name(), rc, strrc(rc));
     return rc;
   }
-
-  return trx->rollback_delete(this, record); // update record in place
+  LOG_INFO("Sync table over. table=%s", name());
+  return rc;
 }
 
-RC Table::insert_entry_of_indexes(const char *record, const RID &rid)
+RC Table::compact(int max_pages, int *moved_records, int *freed_pages)
 {
   RC rc = RC::SUCCESS;
-  for (Index *index : indexes_)
+  int moved = 0;
+  int freed = 0;
+  if (partitioned())
   {
-    // 这里record就是Key,*rid就是value   bplustree的kv结构
-    rc = index->insert_entry(record, &rid);
-    if (rc != RC::SUCCESS)
+    CompactLockGuard guard(compact_lock_, false);
+    for (size_t i = 0; i < partitions_.size() && rc == RC::SUCCESS; i++)
     {
-      break;
+      int partition_moved = 0;
+      int partition_freed = 0;
+      rc = partitions_[i]->compact(max_pages, &partition_moved, &partition_freed);
+      moved += partition_moved;
+      freed += partition_freed;
+    }
+    if (moved_records != nullptr)
+    {
+      *moved_records = moved;
+    }
+    if (freed_pages != nullptr)
+    {
+      *freed_pages = freed;
     }
+    return rc;
   }
-  return rc;
-}
-
-RC Table::delete_entry_of_indexes(const char *record, const RID &rid, bool error_on_not_exists)
-{
-  RC rc = RC::SUCCESS;
-  for (Index *index : indexes_)
   {
-    rc = index->delete_entry(record, &rid);
-    if (rc != RC::SUCCESS)
+    // 索引中缓存的修改在后台写回，不留到下次查询时
+    CompactLockGuard guard(compact_lock_, false);
+    for (Index *index : indexes_)
     {
-      if (rc != RC::RECORD_INVALID_KEY || !error_on_not_exists)
+      rc = index->merge_changes();
+      if (rc != RC::SUCCESS)
       {
-        break;
+        LOG_WARN("Failed to merge buffered index changes. table=%s, index=%s, rc=%d:%s",
+                 name(), index->index_meta().name(), rc, strrc(rc));
       }
     }
+    rc = RC::SUCCESS;
   }
-  return rc;
-}
-
-Index *Table::find_index(const char *index_name) const
-{
-  for (Index *index : indexes_)
+  PageNum before = BP_INVALID_PAGE_NUM;
+  std::unordered_set<int> bloom_extents;
+  // 内存表删除之后空出的位置在插入时复用，不需要整理。只读映射的表不会有删除
+  for (int i = 0; i < max_pages && !in_memory() && !read_only_; i++)
   {
-    if (0 == strcmp(index->index_meta().name(), index_name))
+    CompactLockGuard guard(compact_lock_, true);
+    if (Trx::active_trx_count() > 0 || Trx::has_versions())
     {
-      return index;
+      break;
     }
-  }
-  return nullptr;
-}
 
-IndexScanner *Table::find_index_for_scan(const DefaultConditionFilter &filter)
-{
-  const ConDesc *field_cond_desc = nullptr;
-  const ConDesc *value_cond_desc = nullptr;
-  if (filter.left().is_attr && !filter.right().is_attr)
+    PageNum page_num = BP_INVALID_PAGE_NUM;
+    rc = record_handler_->find_sparse_page(before, TABLE_COMPACT_SPARSE_PERCENT, &page_num);
+    if (rc != RC::SUCCESS)
+    {
+      break;
+    }
+    before = page_num;
+
+    bool page_freed = false;
+    const int moved_before = moved;
+    rc = compact_page(page_num, &moved, &page_freed);
+    if (moved > moved_before && zone_map_->bloom_enabled())
+    {
+      bloom_extents.insert(page_num / ZONE_MAP_EXTENT_PAGES);
+    }
+    if (rc != RC::SUCCESS)
+    {
+      break;
+    }
+    if (page_freed)
+    {
+      freed++;
+    }
+  }
+  // 没有稀疏的页面了，或者前面的页面已经放不下更多的记录
+  if (rc == RC::RECORD_EOF || rc == RC::RECORD_NOMEM)
   {
-    field_cond_desc = &filter.left();
-    value_cond_desc = &filter.right();
+    rc = RC::SUCCESS;
   }
-  else if (filter.right().is_attr && !filter.left().is_attr)
+  if (rc == RC::SUCCESS && !bloom_extents.empty())
   {
-    field_cond_desc = &filter.right();
-    value_cond_desc = &filter.left();
+    CompactLockGuard guard(compact_lock_, true);
+    rc = rebuild_bloom_filters(bloom_extents);
   }
-  if (field_cond_desc == nullptr || value_cond_desc == nullptr)
+  if (rc != RC::SUCCESS)
   {
-    return nullptr;
+    LOG_ERROR("Failed to compact table %s. rc=%d:%s", name(), rc, strrc(rc));
   }
-
-  const FieldMeta *field_meta = table_meta_.find_field_by_offset(field_cond_desc->attr_offset);
-  if (nullptr == field_meta)
+  else if (moved > 0)
   {
-    LOG_PANIC("Cannot find field by offset %d. table=%s",
-              field_cond_desc->attr_offset, name());
-    return nullptr;
+    LOG_INFO("Compact table %s, moved %d records, freed %d pages", name(), moved, freed);
   }
-
-  const IndexMeta *index_meta = table_meta_.find_index_by_field(field_meta->name());
-  if (nullptr == index_meta)
+  if (moved_records != nullptr)
   {
-    return nullptr;
+    *moved_records = moved;
   }
-
-  Index *index = find_index(index_meta->name());
-  if (nullptr == index)
+  if (freed_pages != nullptr)
   {
-    return nullptr;
+    *freed_pages = freed;
   }
-
-  return index->create_scanner(filter.comp_op(), (const char *)value_cond_desc->value, field_cond_desc->null_field_index);
+  return rc;
 }
 
-IndexScanner *Table::find_index_for_scan(const ConditionFilter *filter)
+RC Table::compact_page(int page_num, int *moved_records, bool *freed)
 {
-  if (nullptr == filter)
-  {
-    return nullptr;
-  }
-
-  // remove dynamic_cast
-  const DefaultConditionFilter *default_condition_filter = dynamic_cast<const DefaultConditionFilter *>(filter);
-  if (default_condition_filter != nullptr)
+  std::vector<RID> rids;
+  RC rc = record_handler_->get_page_rids(page_num, rids);
+  if (rc != RC::SUCCESS)
   {
-    return find_index_for_scan(*default_condition_filter);
+    return rc;
   }
-
-  const CompositeConditionFilter *composite_condition_filter = dynamic_cast<const CompositeConditionFilter *>(filter);
-  if (composite_condition_filter != nullptr)
+  if (rids.empty())
   {
-    int filter_num = composite_condition_filter->filter_num();
-    for (int i = 0; i < filter_num; i++)
+    rc = record_handler_->dispose_empty_page(page_num);
+    *freed = (rc == RC::SUCCESS);
+    if (*freed)
     {
-      IndexScanner *scanner = find_index_for_scan(&composite_condition_filter->filter(i));
-      if (scanner != nullptr)
-      {
-        return scanner; // 可以找到一个最优的，比如比较符号是=
-      }
+      zone_map_->reset_page(page_num);
     }
+    return rc;
   }
-  return nullptr;
-}
-
-RC Table::sync()
-{
-  RC rc = data_buffer_pool_->flush_all_pages(file_id_);
-  if (rc != RC::SUCCESS)
+  if ((rc = zone_map_->mark_dirty()) != RC::SUCCESS)
   {
-    LOG_ERROR("Failed to flush table's data pages. table=%s, rc=%d:%s", name(), rc, strrc(rc));
     return rc;
   }
 
-  for (Index *index : indexes_)
+  const FieldMeta *trx_field = table_meta_.trx_field();
+  std::vector<char> stored;
+  std::vector<char> data(record_data_size());
+  int moved = 0;
+  for (const RID &rid : rids)
   {
-    rc = index->sync();
+    // 复制一份记录，更新索引时原来的位置已经被删除了
+    if ((rc = record_handler_->get_record(&rid, stored)) != RC::SUCCESS)
+    {
+      return rc;
+    }
+    if (variable_length())
+    {
+      decode_record(stored.data(), data.data());
+    }
+    else
+    {
+      memcpy(data.data(), stored.data(), std::min(data.size(), stored.size()));
+    }
+    // 异常退出时留下的未提交记录不移动
+    if (has_trx_mark(trx_field, data.data()))
+    {
+      continue;
+    }
+
+    RID new_rid;
+    if ((rc = record_handler_->move_record(&rid, &new_rid)) != RC::SUCCESS)
+    {
+      return rc;
+    }
+    zone_map_->update(new_rid.page_num, data.data());
+    rc = delete_entry_of_indexes(data.data(), rid, false);
+    if (rc == RC::SUCCESS)
+    {
+      rc = insert_entry_of_indexes(data.data(), new_rid);
+    }
     if (rc != RC::SUCCESS)
     {
-      LOG_ERROR("Failed to flush index's pages. table=%s, index=%s, rc=%d:%s",
-                name(), index->index_meta().name(), rc, strrc(rc));
+      LOG_ERROR("Failed to update indexes of moved record. rid=%d.%d -> %d.%d, rc=%d:%s",
+                rid.page_num, rid.slot_num, new_rid.page_num, new_rid.slot_num, rc, strrc(rc));
       return rc;
     }
+    moved++;
+    (*moved_records)++;
   }
-  LOG_INFO("Sync table over. table=%s", name());
-  return rc;
+  *freed = moved == (int)rids.size();
+  return RC::SUCCESS;
 }
@@ -16,23 +16,67 @@ See the Mulan PSL v2 for more details. */
 #define __OBSERVER_STORAGE_COMMON_TABLE_H__
 
 #include "storage/common/table_meta.h"
+#include "storage/common/row_count.h"
+#include "storage/common/page_visibility.h"
 
+#include <pthread.h>
+#include <atomic>
 #include <cstring>
+#include <deque>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#define TABLE_COMPACT_SPARSE_PERCENT 25  // 记录占用的空间不到这个比例(百分比)的页面需要整理
+#define INDEX_BUILD_CATCH_UP_ROUNDS 8     // 在线创建索引时不阻塞修改补日志的最多轮数
+#define INDEX_BUILD_CATCH_UP_CHANGES 64   // 一轮补上的修改少于这个数时就不再等，阻塞修改补上剩下的
+#define TABLE_ANALYZE_SAMPLE_PAGES 256    // ANALYZE TABLE平均抽样读取的页面数
+#define TABLE_INDEX_ROW_COST 4.0          // 通过索引回表读一条记录的代价，顺序扫描读一条记录的代价是1
+#define TABLE_BTREE_LOOKUP_COST 3.0       // B+树从根节点找到第一个叶子节点的代价，哈希索引是1
+#define TABLE_DEFAULT_EQUAL_SELECTIVITY 0.1   // 没有统计信息的字段上等值条件选中的记录比例
+#define TABLE_DEFAULT_RANGE_SELECTIVITY 0.33  // 没有直方图的字段上一个范围边界选中的记录比例
+#define TABLE_INTERSECT_MAX_INDEXES 3         // 索引扫描时最多再用几个索引的rid求交集
+#define PRIMARY_KEY_INDEX_NAME "primary"      // 建表时指定的主键创建的索引
+#define COVERING_INDEX_MIN_LEAF_RECORDS 8     // 叶子中至少能放下这么多条记录时，索引才能包含所有的字段
+#define TABLE_INTERSECT_MAX_SELECTIVITY 0.2   // 估计选中的记录比例超过这个值的索引不参与求交集，读索引的代价比省下的回表多
 
 class DiskBufferPool;
 class RecordFileHandler;
+class RecordPageHandler;
 class ConditionFilter;
 class DefaultConditionFilter;
+class ZoneMap;
+class UndoFile;
+class MemRecordStore;
 struct Record;
 struct RID;
 class Index;
 class IndexScanner;
+struct IndexCondition;
+struct IndexScanRange;
+struct PageLoadFile;
 class RecordDeleter;
 class Trx;
+class MaterializedView;
+
+/**
+ * 优化器估算代价用的统计信息。distinct_counts按照table_meta中字段的序号保存不同的非null值的个数，
+ * 自动统计只统计作为索引第一个字段的字段，ANALYZE TABLE之后其它字段使用分析的结果，都没有时是-1。
+ * columns是ANALYZE TABLE得到的每个字段的统计信息，没有分析过时为空
+ */
+struct TableStats
+{
+  int row_count = 0;
+  std::vector<int> distinct_counts;
+  std::vector<ColumnStats> columns;
+};
 
 class Table
 {
   friend class DefaultStorageStage;
+  friend class TableLoader;
+  friend class TableScanner;
+  friend class MaterializedView;
 
 public:
   Table();
@@ -46,18 +90,46 @@ public:
    * @param base_dir 表数据存放的路径
    * @param attribute_count 字段个数
    * @param attributes 字段
+   * @param page_size 数据和索引文件的页面大小，0表示默认大小
+   * @param compression 数据文件的页面压缩方式(none/zlib/lz4/zstd)，nullptr表示不压缩。索引文件不压缩
+   * @param format 数据文件的记录格式，row(默认)或者pax。pax按列存放页面内的数据，分析查询只读取用到的列，
+   *               CHARS字段按定义的长度保存
+   * @param engine 存储引擎，disk(默认)、memory或者mmap。memory的记录和索引只保存在内存中，不经过缓冲池，
+   *               也不写redo日志，重新启动之后是空表，索引都是哈希索引。
+   *               mmap用于加载一次之后不再修改的表，建表之后可以像磁盘表一样写入，重新打开表时数据文件和索引文件
+   *               只读地映射到内存中，直接从映射中读取页面，不再占用缓冲池，这之后只能清空(truncate)不能修改。
+   *               mmap的表不能压缩。
+   *               lsm用于写入多的表，记录和磁盘表一样，索引是LsmIndex，修改顺序写入wal和有序的run
+   * @param partition 不为空并且type不是NO_PARTITION时按照分区字段把记录放到各个分区中，每个分区有自己的
+   *               数据文件和索引文件，表本身只有元数据文件。内存表不能分区
+   * @param bloom_filter 不为空时记录文件的每个区段为这个字段建布隆过滤器，扫描时跳过等值条件的值不在其中的区段。
+   *               内存表没有记录文件，不能建布隆过滤器
+   * @param primary_keys 主键字段，这些字段不能为null。建表之后在这些字段上创建名为primary的唯一索引，
+   *               记录足够短时索引包含所有的字段，见create_index的include_all_columns，否则只包含主键字段。
+   *               记录仍然放在数据文件中，不是按主键聚簇存放的。分区表的主键要包含分区字段，唯一性才能在每个分区内检查
    */
-  RC create(const char *path, const char *name, const char *base_dir, int attribute_count, const AttrInfo attributes[]);
+  RC create(const char *path, const char *name, const char *base_dir, int attribute_count, const AttrInfo attributes[],
+            int page_size = 0, const char *compression = nullptr, const char *format = nullptr,
+            const char *engine = nullptr, const PartitionDef *partition = nullptr, const char *bloom_filter = nullptr,
+            int primary_key_num = 0, const char *const primary_keys[] = nullptr);
 
   /**
    * 打开一个表
    * @param meta_file 保存表元数据的文件完整路径
    * @param base_dir 表所在的文件夹，表记录数据文件、索引数据文件存放位置
+   * @param table_meta 不为空时使用这份元数据，不再读取meta_file
    */
-  RC open(const char *meta_file, const char *base_dir);
+  RC open(const char *meta_file, const char *base_dir, const TableMeta *table_meta = nullptr);
 
   RC insert_record(Trx *trx, int value_num, const Value *values, Record **ret_record = nullptr);
 
+  /**
+   * 批量插入row_num行，第i行有value_nums[i]个值values[i]。
+   * 所有的记录先生成在一块内存中，再按页面批量写入，索引按索引逐个批量更新，在事务中一次登记。
+   * 任何一行失败时所有行都不插入
+   */
+  RC insert_records(Trx *trx, int row_num, const int *value_nums, const Value *const *values);
+
   /**
    * @brief 该函数用于更新表中所有满足指定条件的元组，
    * 在每一个更新的元组中将属性attrName的值设置为一个新的值。
@@ -76,11 +148,144 @@ public:
 
   RC delete_record(Trx *trx, ConditionFilter *filter, int *deleted_count);
 
-  RC scan_record(Trx *trx, ConditionFilter *filter, int limit, void *context, void (*record_reader)(const char *data, void *context));
+  /**
+   * field_indexes不为nullptr时record_reader只会读取这些字段，PAX格式的表只从页面中读取这些字段和过滤条件用到的字段，
+   * 其它字段的内容不确定。需要分批拉取记录时使用TableScanner
+   */
+  RC scan_record(Trx *trx, ConditionFilter *filter, int limit, void *context, void (*record_reader)(const char *data, void *context),
+                 const std::vector<int> *field_indexes = nullptr);
 
-  RC create_index(Trx *trx, const char *index_name, const char *attribute_name);
+  /**
+   * unique为true时创建唯一索引，已有的记录中有重复的属性值时失败。
+   * prefix_lengths不为空时是每个字段只索引的前缀长度，0表示整个字段。
+   * 索引在线创建，导入已有记录期间其它线程可以继续修改表，只有最后补上剩下的修改并发布索引时短暂地阻塞修改。
+   * include_all_columns为true时创建包含所有字段的唯一索引(覆盖索引)：字段都不能为null，唯一性只检查这些字段，
+   * 记录中其它的字段跟在key后面放在B+树的叶子中，按这些字段查找和范围扫描时不用再读数据文件。
+   * 记录本身仍然在数据文件中，其它索引仍然指向rid。只能是B+树索引，不能指定前缀，
+   * 叶子中要能放下COVERING_INDEX_MIN_LEAF_RECORDS条记录，否则返回INVALID_ARGUMENT，见can_include_all_columns
+   */
+  RC create_index(Trx *trx, const char *index_name, int attribute_num, const char *const attribute_names[],
+                  bool unique = false, const int prefix_lengths[] = nullptr, IndexType index_type = BPLUS_TREE_INDEX,
+                  bool include_all_columns = false);
+  /**
+   * 记录是否足够短，能够创建包含所有字段的索引
+   */
+  bool can_include_all_columns() const;
 
   std::vector<const char *> get_index_names();
+  /**
+   * 第一个字段是field_name并且索引了完整字段值的B+树索引，可以按照这个字段的值查找记录。没有时返回nullptr
+   */
+  Index *find_index_for_lookup(const char *field_name) const;
+
+  /**
+   * 获取统计信息。第一次调用或者上次统计之后修改的记录超过了总数的1/5时扫描全表重新统计，
+   * 其它时候行数按照之后插入和删除的记录数调整。统计时不判断可见性，结果只是估计值
+   */
+  RC statistics(TableStats &stats);
+  /**
+   * 数据文件中不在缓冲池里的页面，分区表包括所有分区，总数最多max_pages个。内存表没有
+   */
+  RC missing_pages(int max_pages, std::vector<PageLoadFile> &files);
+  /**
+   * ANALYZE TABLE。随机抽样大约TABLE_ANALYZE_SAMPLE_PAGES个页面，估计行数和每个字段的null比例、不同值的个数，
+   * 数值字段还有等深直方图，结果保存在元数据中，重新打开之后仍然有效。分区表在所有分区中抽样
+   */
+  RC analyze_table();
+
+  /**
+   * 数据的版本。插入、删除、修改记录以及提交和回滚事务之后都会改变，取值来自全局递增的序号，
+   * 删除之后重新创建的同名表也不会得到用过的版本。查询结果缓存据此判断结果是否过期
+   */
+  uint64_t version() const;
+
+  /**
+   * 没有过滤条件的COUNT(*)。trx能直接使用表中维护的记录数时返回true，count是结果，分区表中记录数未知的分区在这里扫描。
+   * 返回false时由调用者扫描全表，epoch不为0时再用learn_row_count记下扫描的结果
+   */
+  bool maintained_row_count(Trx *trx, int64_t *count, uint64_t *epoch);
+  void learn_row_count(uint64_t epoch, int64_t count)
+  {
+    row_count_.learn(epoch, count);
+  }
+  /**
+   * 已经提交的记录数，事务提交时调整
+   */
+  RowCount &row_count()
+  {
+    return row_count_;
+  }
+  /**
+   * 事务操作过的页面，其它页面上的记录扫描时不用判断可见性
+   */
+  PageVisibility &page_visibility()
+  {
+    return page_visibility_;
+  }
+
+  /**
+   * 内存表，见create的engine参数
+   */
+  bool in_memory() const
+  {
+    return table_meta_.in_memory();
+  }
+
+  /**
+   * mmap引擎的表打开时数据文件映射成了只读，插入、修改、删除和创建索引返回RC::READONLY
+   */
+  bool read_only() const;
+  /**
+   * 打开表的最后一步：升级以前的版本创建的表中日期的编码，映射mmap引擎的表。
+   * redo日志恢复时表打开之后还要恢复记录，这一步放到恢复结束之后
+   */
+  RC finish_open();
+
+  /**
+   * 分区表，见create的partition参数。分区表上的操作按分区字段上的条件只访问可能有满足条件的记录的分区，
+   * 不能按rid读取记录，也不能用索引按字段值查找(find_index_for_lookup返回nullptr)。分区字段不能修改
+   */
+  bool partitioned() const
+  {
+    return table_meta_.partitioned();
+  }
+  /**
+   * 删除一个range分区，直接删除分区的数据文件和索引文件，其中的记录不再逐条删除。
+   * 有未结束的事务时返回LOCKED，事务中的修改按分区记录
+   */
+  RC drop_partition(const char *partition_name);
+  /**
+   * 关闭并删除表的数据文件、索引文件和zone map，分区表删除所有分区的文件。
+   * 缓冲池中这些文件的页面直接丢弃，脏页不写回，删除表时调用，之后只能释放这个对象
+   */
+  RC drop_files();
+  /**
+   * 清空表中的记录。删除数据文件和索引文件之后按原来的页面大小、压缩方式和格式重新创建空的文件，
+   * 不逐条删除记录。有未结束的事务时返回LOCKED
+   */
+  RC truncate();
+
+  /**
+   * 以这张表为基表的物化视图，事务提交之后用它在这张表上的修改更新这些视图
+   */
+  void add_materialized_view(MaterializedView *view);
+  void remove_materialized_view(MaterializedView *view);
+  std::vector<MaterializedView *> materialized_views();
+  bool has_materialized_views() const
+  {
+    return has_views_.load();
+  }
+  /**
+   * 保存物化视图结果的表，只能由视图修改
+   */
+  void set_materialized_view(MaterializedView *view)
+  {
+    materialized_view_ = view;
+  }
+  MaterializedView *materialized_view() const
+  {
+    return materialized_view_;
+  }
 
 public:
   const char *name() const;
@@ -89,20 +294,215 @@ public:
 
   RC sync();
 
+  /**
+   * 整理记录文件。从文件末尾开始找稀疏的页面，把上面的记录移动到前面有空闲空间的页面中并更新索引，
+   * 移空的页面被释放，文件末尾的空闲页面会从文件中截掉。
+   * 每次最多整理max_pages个页面，每个页面单独加一次表的写锁，其它操作可以穿插进行。
+   * 事务中的操作按照rid记录，有未结束的事务时不整理。moved_records和freed_pages可以为nullptr
+   */
+  RC compact(int max_pages, int *moved_records, int *freed_pages);
+  /**
+   * 加上整理锁的读锁，unlock_records之前记录不会被移动，扫描时得到的rid一直有效
+   */
+  void lock_records();
+  void unlock_records();
+  /**
+   * 服务器端游标从声明到关闭一直在扫描这张表，期间持有整理锁的读锁。
+   * 这时整理跳过这张表，需要写锁的DDL直接失败，不等待游标关闭
+   */
+  void pin_by_cursor()
+  {
+    cursor_pins_++;
+  }
+  void unpin_by_cursor()
+  {
+    cursor_pins_--;
+  }
+  bool pinned_by_cursor() const
+  {
+    return cursor_pins_.load() > 0;
+  }
+  /**
+   * 读取rid对应的记录，按table_meta_排列的数据复制到data中。需要先lock_records。
+   * 连续读取多条记录时可以传入cursor，见RecordFileHandler::get_record
+   */
+  RC fetch_record(const RID &rid, std::vector<char> &data, RecordPageHandler *cursor = nullptr);
+
+  /**
+   * 把record文件中的变长记录解码成按table_meta_排列的定长格式，data的长度为record_data_size()
+   */
+  void decode_record(const char *stored, char *data) const;
+  /**
+   * 记录在record文件中的长度，所有字段之后是null标志
+   */
+  int record_data_size() const
+  {
+    return table_meta_.record_data_size();
+  }
+  /**
+   * 保存事务修改之前的字段值的undo文件
+   */
+  UndoFile *undo_file() const
+  {
+    return undo_file_;
+  }
+
 public:
-  RC commit_insert(Trx *trx, const RID &rid);
-  RC commit_delete(Trx *trx, const RID &rid);
-  RC commit_update(Trx *trx, const RID &rid, char *new_record_data);
+  /**
+   * 事务提交之后，所有的读视图都能看到它的修改时调用。记录上还是这个事务的删除标记时删除记录和索引，
+   * 否则清除事务字段。记录已经被之后的事务修改时什么也不做
+   */
+  RC purge_record(int64_t trx_id, const RID &rid);
   RC rollback_insert(Trx *trx, const RID &rid);
-  RC rollback_delete(Trx *trx, const RID &rid);
+  /**
+   * 回滚更新和删除，把记录恢复成data。update_indexes为true时索引项也换回data中的值
+   */
+  RC restore_record(const RID &rid, const char *data, bool update_indexes);
 
 private:
-  RC scan_record(Trx *trx, ConditionFilter *filter, int limit, void *context, RC (*record_reader)(Record *record, void *context));
-  RC scan_record_by_index(Trx *trx, IndexScanner *scanner, ConditionFilter *filter, int limit, void *context, RC (*record_reader)(Record *record, void *context));
-  IndexScanner *find_index_for_scan(const ConditionFilter *filter);
-  IndexScanner *find_index_for_scan(const DefaultConditionFilter &filter);
+  /**
+   * 创建或者打开数据文件、zone map、undo文件和索引，不分区的表和分区表的每个分区使用
+   */
+  RC create_storage(const char *base_dir, int page_size, int page_compression, bool pax_format);
+  RC open_storage(const char *base_dir);
+  /**
+   * 把mmap引擎的表的数据文件和索引文件映射到内存中，映射失败时仍然从缓冲池中读取
+   */
+  void map_storage();
+  RC create_partitions(const char *base_dir, int page_size, int page_compression, bool pax_format);
+  RC open_partitions(const char *base_dir);
+  /**
+   * 关闭分区并删除它的数据文件、索引文件和zone map
+   */
+  static RC remove_partition(Table *partition);
+  /**
+   * 关闭并删除不分区的表或者一个分区的文件，调用者持有整理锁的写锁
+   */
+  RC drop_storage();
+  /**
+   * 删除文件之后重新创建空的数据文件、zone map、undo文件和索引
+   */
+  RC truncate_storage();
+  /**
+   * 创建空的索引，不导入已有的记录
+   */
+  RC create_empty_index(const IndexMeta &index_meta, const std::vector<FieldMeta> &index_fields, Index **index);
+  /**
+   * 按照过滤条件中"分区字段 op 常量"的条件，可能有满足条件的记录的分区
+   */
+  void prune_partitions(const ConditionFilter *filter, std::vector<Table *> &partitions) const;
+  /**
+   * 记录应该放到的分区，没有合适的分区时返回nullptr
+   */
+  Table *find_record_partition(const char *record) const;
+  /**
+   * 在线创建索引。先注册修改日志，再加着整理锁的读锁扫描记录导入到新的索引中，这期间其它线程对索引项的修改
+   * 记到日志中，扫描之后分几轮补到新的索引上。返回时日志还在，调用者加上整理锁的写锁之后调用finish_index_build
+   */
+  RC build_index(const IndexMeta &index_meta, const std::vector<FieldMeta> &index_fields, Index **index);
+  /**
+   * 需要持有整理锁的写锁。publish为true时补上日志中剩下的修改并把索引加到indexes_中，
+   * 失败或者publish为false时删除索引和文件。最后注销修改日志
+   */
+  RC finish_index_build(Index *index, bool publish);
+  /**
+   * 分区表在每个分区上创建索引，一个分区失败时删掉已经建好的分区索引
+   */
+  RC build_partition_indexes(const IndexMeta &index_meta, const std::vector<FieldMeta> &index_fields);
+  /**
+   * 正在在线创建索引时，把对索引项的插入或者删除记到修改日志中。调用者持有整理锁的读锁
+   */
+  void log_index_change(bool insert, const char *record, const RID &rid);
+  /**
+   * 把修改日志中已有的修改应用到index上，applied返回应用的个数
+   */
+  RC apply_index_changes(Index *index, size_t *applied);
+  /**
+   * 写到临时文件之后替换元数据文件，分区没有自己的元数据文件
+   */
+  RC save_meta(const TableMeta &table_meta);
+
+  RC update_records(Trx *trx, ConditionFilter *filter, const char *attribute_name, const Value *value,
+                    int *updated_count);
+  /**
+   * 把记录按分区分组之后插入到各个分区
+   */
+  RC insert_partition_records(Trx *trx, Record *records, int record_num, bool update_indexes);
+
+private:
+  RC scan_record(Trx *trx, ConditionFilter *filter, int limit, void *context, RC (*record_reader)(Record *record, void *context),
+                 const std::vector<int> *columns = nullptr);
+  /**
+   * 先从索引中取出所有的rid，按rid的顺序回表，同一个页面上的记录一起访问，页面按文件中的顺序读取。
+   * 输出的记录不是索引的顺序
+   */
+  RC scan_record_by_index(Trx *trx, IndexScanner *scanner, ConditionFilter *filter, int limit, void *context,
+                          RC (*record_reader)(Record *record, void *context));
+  /**
+   * UPDATE和DELETE查找要修改的记录，和查询一样能用索引时用索引。要修改的记录都确定之后才修改，
+   * 修改记录和索引不影响查找，回表按rid的顺序
+   */
+  RC scan_target_records(Trx *trx, ConditionFilter *filter, void *context, RC (*record_reader)(Record *record, void *context));
+  /**
+   * 按照过滤条件选择范围最窄的索引，多字段索引按字段前缀匹配条件。没有能用的索引时返回nullptr。
+   * index不为nullptr时返回选中的索引
+   */
+  IndexScanner *find_index_for_scan(const ConditionFilter *filter, Index **index = nullptr);
+  /**
+   * 按order_fields的顺序读取记录时用的B+树索引，descending为true时从大到小。order_fields依次是索引的字段，
+   * 前面可以跳过条件中等值比较的字段。字典编码的字段、FLOATS字段和只索引前缀的字段在索引中的顺序
+   * 和值的顺序不完全一致，不能使用。条件选中了别的索引时返回nullptr，调用者自己排序
+   */
+  IndexScanner *find_index_for_order(const ConditionFilter *filter, const std::vector<const FieldMeta *> &order_fields,
+                                     bool descending, Index **index = nullptr);
+  /**
+   * 从过滤条件中找出能用来确定索引扫描范围的条件
+   */
+  void collect_index_conditions(const ConditionFilter *filter, std::vector<IndexCondition> &conditions) const;
+  /**
+   * find_index_for_scan选择索引和扫描范围的部分，没有能用的索引时返回false
+   */
+  bool choose_index_scan_range(const ConditionFilter *filter, IndexScanRange &best) const;
+  /**
+   * 除了find_index_for_scan选中的索引，其它索引上还有等值条件时，这些索引扫描出来的rid可以和选中的索引求交集，
+   * 回表之前就排除不满足这些条件的记录。选中的索引已经用上的字段不再用别的索引
+   */
+  void choose_intersect_ranges(const ConditionFilter *filter, std::vector<IndexScanRange> &ranges) const;
+  /**
+   * 用choose_intersect_ranges选出的索引和rids求交集，rids是find_index_for_scan的扫描结果，返回时按rid排序
+   */
+  RC intersect_index_rids(const ConditionFilter *filter, std::vector<RID> &rids);
+  /**
+   * 用来求交集的索引，用于EXPLAIN
+   */
+  void find_intersect_indexes(const ConditionFilter *filter, std::vector<Index *> &indexes) const;
+  /**
+   * columns中的字段都在索引中并且不能为null时返回true，这时只读索引就可以得到这些字段的值
+   */
+  bool index_covers(const Index &index, const std::vector<int> &columns) const;
+  /**
+   * 条件是"字段 op 常量"并且可以用来确定索引扫描范围时，把换成的索引条件加到conditions中，返回true
+   */
+  bool find_index_conditions(const DefaultConditionFilter &filter, std::vector<IndexCondition> &conditions) const;
+  /**
+   * 模式串有前缀的LIKE换成前缀的范围，没有通配符时换成等值条件
+   */
+  bool find_like_index_conditions(const DefaultConditionFilter &filter, std::vector<IndexCondition> &conditions) const;
+  /**
+   * 用ANALYZE TABLE收集的统计信息估计扫描范围选中的记录比例，各个字段上的条件按互相独立处理
+   */
+  double index_scan_range_selectivity(const IndexScanRange &range) const;
+  /**
+   * 按扫描范围读取索引并回表的代价，单位是顺序扫描读一条记录的代价
+   */
+  double index_scan_cost(const IndexScanRange &range) const;
 
   RC insert_record(Trx *trx, Record *record);
+  RC insert_records(Trx *trx, Record *records, int record_num, bool update_indexes = true);
+  /**
+   * 为已经插入到record文件中的记录插入索引，失败时删除这些记录。rids会按位置排序
+   */
+  RC build_index_entries(std::vector<RID> &rids);
   RC delete_record(Trx *trx, Record *record);
   RC update_record(Trx *trx, Record *record, const char *attribute_name, const Value *value);
 
@@ -112,14 +512,137 @@ private:
 
   RC insert_entry_of_indexes(const char *record, const RID &rid);
   RC delete_entry_of_indexes(const char *record, const RID &rid, bool error_on_not_exists);
+  /**
+   * 索引字段中可以为null的字段的null标志，在同一个字节中的合并成一个
+   */
+  void index_null_flags(const IndexMeta &index_meta, std::vector<NullFlag> &null_flags) const;
+  /**
+   * 两个版本的记录在索引中的键是否不同，按索引的field_metas比较每个字段在记录中的len()个字节和null标志
+   */
+  bool index_key_changed(const Index &index, const char *old_record, const char *new_record) const;
 
 private:
-  RC init_record_handler(const char *base_dir);
+  RC init_record_handler(const char *base_dir, bool variable_length = false,
+                         const std::vector<int> &pax_columns = std::vector<int>());
+  /**
+   * 内存表没有数据文件，zone map不记录任何字段
+   */
+  RC init_mem_records();
+  /**
+   * 加载记录文件的zone map，文件不可用时扫描所有记录重建
+   */
+  RC init_zone_map(const char *base_dir);
+  /**
+   * 扫描所有记录重建zone map
+   */
+  RC build_zone_map();
+  /**
+   * 新建的表记录数是0，打开表时从文件中加载，文件不可用时记录数未知
+   */
+  RC init_row_count(const char *base_dir, bool created);
+  /**
+   * 创建这次运行使用的undo文件
+   */
+  RC init_undo_file(const char *base_dir);
+  /**
+   * 崩溃恢复时处理记录上遗留的事务字段: 日志中已经提交的事务完成提交，其它事务回滚
+   */
+  RC recover_trx_records();
+  /**
+   * 以前的版本创建的表中日期是yyyymmdd格式的整数，转换成天数，包括记录、索引、zone map、
+   * 分区的上界和统计信息，最后在元数据中记下新的编码
+   */
+  RC upgrade_dates();
+  /**
+   * 转换记录中date_offsets位置上的日期并更新索引。已经是天数的值不再转换，中途失败之后可以重新执行。
+   * 按日期哈希分区时转换之后可能属于parent的另一个分区，partition_index是自己在parent中的位置
+   */
+  RC upgrade_date_records(const std::vector<int> &date_offsets, Table *parent, int partition_index);
   RC make_record(int value_num, const Value *values, char *&record_out);
+  /**
+   * 和make_record相同，记录写入已经清零的record中，record的长度为record_data_size()
+   */
+  RC fill_record(int value_num, const Value *values, char *record);
+  /**
+   * 字典编码的字段的值对应的编码。新的值加到字典中之后先保存元数据，保存之后编码才能写到记录中，
+   * 这样重启之后记录中的编码都能解码。调用者不能持有compact_lock_
+   */
+  RC encode_dictionary_value(const FieldMeta &field, const char *value, int *code);
+  /**
+   * 有CHARS字段的表使用变长记录文件，CHARS字段只保存实际的内容，
+   * 其它字段和null标志按原样保存，事务字段仍然在记录的开头
+   */
+  bool variable_length() const;
+  bool pax() const;
+  /**
+   * 定长的行存记录可以直接读写页面中的数据，变长记录和PAX记录读到的都是副本
+   */
+  bool record_in_page() const
+  {
+    return !variable_length() && !pax();
+  }
+  /**
+   * 过滤条件用到的字段加入columns中，不认识的过滤条件返回false，这时需要读取所有的字段
+   */
+  bool collect_filter_columns(const ConditionFilter *filter, std::vector<int> &columns) const;
+  void encode_record(const char *data, std::vector<char> &stored) const;
+  /**
+   * 读取rid对应的记录，变长记录解码到buffer中，定长记录直接指向页面中的数据。
+   * cursor不为nullptr时固定着读取的页面，下一条记录在同一个页面上时不再重新获取
+   */
+  RC get_record(const RID &rid, Record *record, std::vector<char> &buffer, RecordPageHandler *cursor = nullptr);
+  /**
+   * 把修改之后的记录写回record文件
+   */
+  RC write_record(const Record &record);
+  /**
+   * 从record文件或者内存表中删除记录，不修改索引
+   */
+  RC remove_record(const RID &rid);
+  /**
+   * 事务直接修改记录中的事务字段，变长记录修改的是解码之后的副本，需要写回页面
+   */
+  RC write_back_trx_field(const Record &record);
+  /**
+   * 把页面上的记录都移动到前面的页面中，前面的页面放不下时返回RECORD_NOMEM
+   */
+  RC compact_page(int page_num, int *moved_records, bool *freed);
+  /**
+   * 整理之后布隆过滤器中还有移走的记录的值，清空这些区段的布隆过滤器，重新加入区段中现有的记录。
+   * 需要持有整理锁的写锁
+   */
+  RC rebuild_bloom_filters(const std::unordered_set<int> &extents);
 
 private:
   Index *find_index(const char *index_name) const;
   RC is_legal(const Value &value, const FieldMeta *field);
+  RC analyze();
+  /**
+   * 按页面抽样读取记录交给collectors，sample_rows累加读到的记录数，total_rows累加估计的记录总数
+   */
+  RC sample_column_stats(common::RandomGenerator &random, std::deque<ColumnStatsCollector> &collectors,
+                         int64_t *sample_rows, int64_t *total_rows);
+  /**
+   * 用元数据中ANALYZE TABLE的结果补充stats，需要持有stats_lock_或者stats是局部变量
+   */
+  void apply_column_stats(TableStats &stats) const;
+  /**
+   * 用ANALYZE TABLE的结果作为自动统计的结果，需要持有stats_lock_
+   */
+  void load_analyzed_stats();
+  /**
+   * 插入和删除记录之后调用，统计信息据此判断是否需要重新统计
+   */
+  void record_changed(int row_delta)
+  {
+    stats_row_delta_ += row_delta;
+    stats_changes_ += row_delta < 0 ? -row_delta : row_delta;
+    data_changed();
+  }
+  /**
+   * 记录的内容改变之后调用，数据改变已经可见之后才能更新版本
+   */
+  void data_changed();
 
 private:
   std::string base_dir_;
@@ -127,7 +650,35 @@ private:
   DiskBufferPool *data_buffer_pool_; /// 数据文件关联的buffer pool
   int file_id_;
   RecordFileHandler *record_handler_; /// 记录操作
+  MemRecordStore *mem_records_;       /// 内存表的记录，这时没有数据文件和record_handler_
+  ZoneMap *zone_map_;                 /// 每个页面数值和日期字段的范围，扫描时跳过不满足条件的页面
+  UndoFile *undo_file_;               /// 事务修改之前的字段值，回滚和读旧版本时使用
+  RowCount row_count_;                /// 已经提交的记录数，没有过滤条件的COUNT(*)直接使用
+  PageVisibility page_visibility_;    /// 还有事务操作的页面
   std::vector<Index *> indexes_;
+  pthread_rwlock_t compact_lock_;  // 整理记录文件时加写锁，其它读写操作加读锁
+  std::atomic<int> cursor_pins_{0};  // 正在扫描这张表的游标数
+
+  pthread_mutex_t stats_lock_;
+  TableStats stats_;                   // 上次统计的结果，由stats_lock_保护
+  std::atomic<bool> stats_valid_;
+  std::atomic<int> stats_row_delta_;   // 上次统计之后增加的记录数
+  std::atomic<int> stats_changes_;     // 上次统计之后插入和删除的记录数
+  std::atomic<uint64_t> version_;
+
+  struct IndexBuildLog;
+  std::mutex index_build_mutex_;          // 同一张表同时只创建一个索引，删除和清空表时也要获取
+  IndexBuildLog *index_build_ = nullptr;  // 正在在线创建索引时的修改日志，持有整理锁的写锁时设置和清除
+  std::mutex dictionary_mutex_;           // 向字典编码的字段的字典中加值并保存元数据
+
+  bool is_partition_ = false;       // 分区表的一个分区，没有自己的元数据文件
+  bool read_only_ = false;          // 数据文件已经只读地映射到内存中，见map_storage
+  std::vector<Table *> partitions_;  // 分区表的每个分区，和table_meta_中的分区一一对应，由compact_lock_保护
+
+  std::mutex views_mutex_;
+  std::vector<MaterializedView *> views_;  // 以这张表为基表的物化视图，由views_mutex_保护
+  std::atomic<bool> has_views_{false};
+  MaterializedView *materialized_view_ = nullptr;  // 这张表保存的是这个物化视图的结果
 };
 
 #endif // __OBSERVER_STORAGE_COMMON_TABLE_H__
\ No newline at end of file
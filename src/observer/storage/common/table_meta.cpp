@@ -12,9 +12,12 @@ See the Mulan PSL v2 for more details. */
 // Created by Wangyunlai on 2021/5/12.
 //
 
+#include <string.h>
 #include <algorithm>
 
 #include "storage/common/table_meta.h"
+#include "storage/common/meta_util.h"
+#include "storage/common/dictionary.h"
 #include "json/json.h"
 #include "common/log/log.h"
 #include "storage/trx/trx.h"
@@ -22,13 +25,43 @@ See the Mulan PSL v2 for more details. */
 static const Json::StaticString FIELD_TABLE_NAME("table_name");
 static const Json::StaticString FIELD_FIELDS("fields");
 static const Json::StaticString FIELD_INDEXES("indexes");
+static const Json::StaticString FIELD_ENGINE("engine");
+static const Json::StaticString FIELD_DATE_FORMAT("date_format");
+static const Json::StaticString FIELD_NULL_FORMAT("null_format");
+static const Json::StaticString FIELD_BLOOM_FILTER("bloom_filter");
+static const Json::StaticString FIELD_PARTITION("partition");
+static const Json::StaticString FIELD_PARTITION_TYPE("type");
+static const Json::StaticString FIELD_PARTITION_FIELD("field");
+static const Json::StaticString FIELD_PARTITIONS("partitions");
+static const Json::StaticString FIELD_STATISTICS("statistics");
+static const Json::StaticString FIELD_ROW_COUNT("row_count");
+static const Json::StaticString FIELD_COLUMNS("columns");
+static const Json::StaticString FIELD_COLUMN_NAME("name");
+static const char *MEMORY_ENGINE_NAME = "memory";
+static const char *MMAP_ENGINE_NAME = "mmap";
+static const char *LSM_ENGINE_NAME = "lsm";
+static const char *DATE_FORMAT_DAYS = "days";
+static const char *NULL_FORMAT_BITMAP = "bitmap";
+static const char *RANGE_PARTITION_NAME = "range";
+static const char *HASH_PARTITION_NAME = "hash";
 
 std::vector<FieldMeta> TableMeta::sys_fields_;
 
 TableMeta::TableMeta(const TableMeta &other) : name_(other.name_),
                                                fields_(other.fields_),
                                                indexes_(other.indexes_),
-                                               record_size_(other.record_size_)
+                                               record_size_(other.record_size_),
+                                               in_memory_(other.in_memory_),
+                                               mmap_engine_(other.mmap_engine_),
+                                               lsm_engine_(other.lsm_engine_),
+                                               date_in_days_(other.date_in_days_),
+                                               null_bitmap_(other.null_bitmap_),
+                                               bloom_filter_field_(other.bloom_filter_field_),
+                                               partition_type_(other.partition_type_),
+                                               partition_field_(other.partition_field_),
+                                               partitions_(other.partitions_),
+                                               stats_row_count_(other.stats_row_count_),
+                                               column_stats_(other.column_stats_)
 {
 }
 
@@ -38,6 +71,17 @@ void TableMeta::swap(TableMeta &other) noexcept
   fields_.swap(other.fields_);
   indexes_.swap(other.indexes_);
   std::swap(record_size_, other.record_size_);
+  std::swap(in_memory_, other.in_memory_);
+  std::swap(mmap_engine_, other.mmap_engine_);
+  std::swap(lsm_engine_, other.lsm_engine_);
+  std::swap(date_in_days_, other.date_in_days_);
+  std::swap(null_bitmap_, other.null_bitmap_);
+  bloom_filter_field_.swap(other.bloom_filter_field_);
+  std::swap(partition_type_, other.partition_type_);
+  partition_field_.swap(other.partition_field_);
+  partitions_.swap(other.partitions_);
+  std::swap(stats_row_count_, other.stats_row_count_);
+  column_stats_.swap(other.column_stats_);
 }
 
 RC TableMeta::init_sys_fields()
@@ -92,14 +136,27 @@ RC TableMeta::init(const char *name, int field_num, const AttrInfo attributes[])
   for (int i = 0; i < field_num; i++)
   {
     const AttrInfo &attr_info = attributes[i];
-    rc = fields_[i + sys_fields_.size()].init(attr_info.name, attr_info.type, field_offset, attr_info.length, true, attr_info.is_nullable == 1);
+    // 字典编码的字段在记录中保存4字节的编码
+    const bool dictionary = attr_info.dictionary == 1 && attr_info.type == CHARS;
+    const int len = dictionary ? (int)sizeof(int) : attr_info.length;
+    FieldMeta &field = fields_[i + sys_fields_.size()];
+    rc = field.init(attr_info.name, attr_info.type, field_offset, len, true, attr_info.is_nullable == 1);
     if (rc != RC::SUCCESS)
     {
       LOG_ERROR("Failed to init field meta. table name=%s, field name: %s", name, attr_info.name);
       return rc;
     }
+    if (dictionary)
+    {
+      if (attr_info.length <= 0)
+      {
+        LOG_ERROR("Invalid length of dictionary field. table name=%s, field name: %s", name, attr_info.name);
+        return RC::INVALID_ARGUMENT;
+      }
+      field.set_dictionary(std::make_shared<Dictionary>(attr_info.length));
+    }
 
-    field_offset += attr_info.length;
+    field_offset += len;
   }
 
   record_size_ = field_offset;
@@ -191,10 +248,24 @@ const IndexMeta *TableMeta::index(const char *name) const
 }
 
 const IndexMeta *TableMeta::find_index_by_field(const char *field) const
+{
+  return find_index_by_fields(1, &field);
+}
+
+const IndexMeta *TableMeta::find_index_by_fields(int field_num, const char *const fields[]) const
 {
   for (const IndexMeta &index : indexes_)
   {
-    if (0 == strcmp(index.field(), field))
+    if (index.field_num() != field_num)
+    {
+      continue;
+    }
+    int i = 0;
+    while (i < field_num && 0 == strcmp(index.field(i), fields[i]))
+    {
+      i++;
+    }
+    if (i == field_num)
     {
       return &index;
     }
@@ -217,6 +288,201 @@ int TableMeta::record_size() const
   return record_size_;
 }
 
+int TableMeta::null_flags_size() const
+{
+  const int user_field_num = (int)fields_.size() - sys_field_num();
+  // 以前的版本所有字段(包括系统字段)都占一个字节，最后一个字节没有使用
+  return null_bitmap_ ? (user_field_num + 7) / 8 : (int)fields_.size();
+}
+
+NullFlag TableMeta::null_flag(int field_index) const
+{
+  const int user_field_index = field_index - sys_field_num();
+  NullFlag flag;
+  if (null_bitmap_)
+  {
+    flag.offset = record_size_ + user_field_index / 8;
+    flag.mask = (unsigned char)(1 << (user_field_index % 8));
+  }
+  else
+  {
+    flag.offset = record_size_ + user_field_index;
+    flag.mask = 1;
+  }
+  return flag;
+}
+
+RC TableMeta::set_partitions(PartitionType type, const char *field_name,
+                             const std::vector<PartitionMeta> &partitions)
+{
+  const int field_index = find_field_index_by_name(field_name);
+  if (field_index < sys_field_num())
+  {
+    LOG_ERROR("No such partition field %s. table=%s", field_name == nullptr ? "" : field_name, name_.c_str());
+    return RC::SCHEMA_FIELD_MISSING;
+  }
+  const FieldMeta &field = fields_[field_index];
+  // 浮点数的相等带误差，按值路由的分区和条件不一致，所以不能作为分区字段。
+  // 字典编码的字段记录中是编码，range分区的上界按值比较
+  if ((field.type() != INTS && field.type() != DATES && field.type() != CHARS) || field.dictionary() != nullptr)
+  {
+    LOG_ERROR("Field %s cannot be used to partition table %s", field_name, name_.c_str());
+    return RC::SCHEMA_FIELD_TYPE_MISMATCH;
+  }
+  if ((type != RANGE_PARTITION && type != HASH_PARTITION) || partitions.empty() ||
+      partitions.size() > MAX_PARTITION_NUM)
+  {
+    LOG_ERROR("Invalid partitions of table %s. type=%d, partition num=%d", name_.c_str(), type, (int)partitions.size());
+    return RC::INVALID_ARGUMENT;
+  }
+  for (size_t i = 0; i < partitions.size(); i++)
+  {
+    const PartitionMeta &partition = partitions[i];
+    for (size_t j = 0; j < i; j++)
+    {
+      if (0 == strcmp(partitions[j].name(), partition.name()))
+      {
+        LOG_ERROR("Duplicate partition %s of table %s", partition.name(), name_.c_str());
+        return RC::INVALID_ARGUMENT;
+      }
+    }
+    if (type == HASH_PARTITION && partition.has_bound())
+    {
+      LOG_ERROR("Hash partition %s of table %s cannot have a bound", partition.name(), name_.c_str());
+      return RC::INVALID_ARGUMENT;
+    }
+    if (type == RANGE_PARTITION && !partition.has_bound() && i + 1 != partitions.size())
+    {
+      LOG_ERROR("Only the last partition of table %s can be maxvalue", name_.c_str());
+      return RC::INVALID_ARGUMENT;
+    }
+    if (type == RANGE_PARTITION && i > 0 && partition.has_bound() &&
+        PartitionMeta::compare(field, partitions[i - 1].bound(), partition.bound()) >= 0)
+    {
+      LOG_ERROR("Bounds of range partitions of table %s must be strictly increasing. partition=%s",
+                name_.c_str(), partition.name());
+      return RC::INVALID_ARGUMENT;
+    }
+  }
+
+  partition_type_ = type;
+  partition_field_ = field.name();
+  partitions_ = partitions;
+  return RC::SUCCESS;
+}
+
+RC TableMeta::remove_partition(const char *name)
+{
+  const int index = find_partition_by_name(name);
+  if (index < 0)
+  {
+    return RC::NOTFOUND;
+  }
+  // hash分区按分区个数取模，去掉一个分区之后其它记录也不在应该在的分区中了
+  if (partition_type_ != RANGE_PARTITION || partitions_.size() == 1)
+  {
+    LOG_ERROR("Cannot drop partition %s of table %s", name, name_.c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+  partitions_.erase(partitions_.begin() + index);
+  return RC::SUCCESS;
+}
+
+const FieldMeta *TableMeta::bloom_filter_field() const
+{
+  return bloom_filter_field_.empty() ? nullptr : field(bloom_filter_field_.c_str());
+}
+
+RC TableMeta::set_bloom_filter_field(const char *field_name)
+{
+  // 系统字段不能用，浮点数的等值条件允许误差，不能用布隆过滤器判断。
+  // 字典编码的字段不在字典中的值直接就没有结果，不需要布隆过滤器
+  const int field_index = find_field_index_by_name(field_name);
+  if (field_index < sys_field_num() || field(field_index)->type() == FLOATS ||
+      field(field_index)->dictionary() != nullptr)
+  {
+    LOG_WARN("Invalid bloom filter field %s of table %s", field_name, name_.c_str());
+    return RC::SCHEMA_FIELD_NOT_EXIST;
+  }
+  bloom_filter_field_ = field_name;
+  return RC::SUCCESS;
+}
+
+const FieldMeta *TableMeta::partition_field() const
+{
+  return partitioned() ? field(partition_field_.c_str()) : nullptr;
+}
+
+int TableMeta::find_partition_by_name(const char *name) const
+{
+  for (size_t i = 0; i < partitions_.size(); i++)
+  {
+    if (0 == strcmp(partitions_[i].name(), name))
+    {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+int TableMeta::find_partition(const char *record) const
+{
+  const int field_index = find_field_index_by_name(partition_field_.c_str());
+  const FieldMeta &field = fields_[field_index];
+  if (null_flag(field_index).test(record))
+  {
+    return 0;
+  }
+  const char *value = record + field.offset();
+  if (partition_type_ == HASH_PARTITION)
+  {
+    return (int)(PartitionMeta::hash(field, value) % partitions_.size());
+  }
+  for (size_t i = 0; i < partitions_.size(); i++)
+  {
+    if (!partitions_[i].has_bound() || PartitionMeta::compare(field, value, partitions_[i].bound()) < 0)
+    {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+void TableMeta::partition_table_meta(int i, TableMeta &meta) const
+{
+  meta.name_ = name_ + "." + partitions_[i].name();
+  meta.fields_ = fields_;
+  meta.indexes_ = indexes_;
+  meta.record_size_ = record_size_;
+  meta.in_memory_ = in_memory_;
+  meta.mmap_engine_ = mmap_engine_;
+  meta.lsm_engine_ = lsm_engine_;
+  meta.date_in_days_ = date_in_days_;
+  meta.null_bitmap_ = null_bitmap_;
+  meta.bloom_filter_field_ = bloom_filter_field_;
+  meta.partition_type_ = NO_PARTITION;
+  meta.partition_field_.clear();
+  meta.partitions_.clear();
+  // 分区用表的统计信息估计选择率，行数按表计算
+  meta.stats_row_count_ = stats_row_count_;
+  meta.column_stats_ = column_stats_;
+}
+
+const ColumnStats *TableMeta::column_stats(int field_index) const
+{
+  if (field_index < 0 || field_index >= (int)column_stats_.size() || !column_stats_[field_index].valid())
+  {
+    return nullptr;
+  }
+  return &column_stats_[field_index];
+}
+
+void TableMeta::set_stats(int64_t row_count, std::vector<ColumnStats> &&column_stats)
+{
+  stats_row_count_ = row_count;
+  column_stats_ = std::move(column_stats);
+}
+
 int TableMeta::serialize(std::ostream &ss) const
 {
 
@@ -241,6 +507,64 @@ int TableMeta::serialize(std::ostream &ss) const
     indexes_value.append(std::move(index_value));
   }
   table_value[FIELD_INDEXES] = std::move(indexes_value);
+  if (in_memory_)
+  {
+    table_value[FIELD_ENGINE] = MEMORY_ENGINE_NAME;
+  }
+  else if (mmap_engine_)
+  {
+    table_value[FIELD_ENGINE] = MMAP_ENGINE_NAME;
+  }
+  else if (lsm_engine_)
+  {
+    table_value[FIELD_ENGINE] = LSM_ENGINE_NAME;
+  }
+  if (date_in_days_)
+  {
+    table_value[FIELD_DATE_FORMAT] = DATE_FORMAT_DAYS;
+  }
+  if (null_bitmap_)
+  {
+    table_value[FIELD_NULL_FORMAT] = NULL_FORMAT_BITMAP;
+  }
+  if (!bloom_filter_field_.empty())
+  {
+    table_value[FIELD_BLOOM_FILTER] = bloom_filter_field_;
+  }
+  if (partitioned())
+  {
+    const FieldMeta &field = *partition_field();
+    Json::Value partition_value;
+    partition_value[FIELD_PARTITION_TYPE] =
+        partition_type_ == RANGE_PARTITION ? RANGE_PARTITION_NAME : HASH_PARTITION_NAME;
+    partition_value[FIELD_PARTITION_FIELD] = partition_field_;
+    Json::Value partitions_value;
+    for (const PartitionMeta &partition : partitions_)
+    {
+      Json::Value value;
+      partition.to_json(field, value);
+      partitions_value.append(std::move(value));
+    }
+    partition_value[FIELD_PARTITIONS] = std::move(partitions_value);
+    table_value[FIELD_PARTITION] = std::move(partition_value);
+  }
+  if (analyzed())
+  {
+    Json::Value stats_value;
+    stats_value[FIELD_ROW_COUNT] = (Json::Int64)stats_row_count_;
+    Json::Value columns_value;
+    for (size_t i = 0; i < column_stats_.size(); i++)
+    {
+      if (column_stats_[i].valid())
+      {
+        Json::Value column_value;
+        column_stats_[i].to_json(fields_[i], column_value);
+        columns_value.append(std::move(column_value));
+      }
+    }
+    stats_value[FIELD_COLUMNS] = std::move(columns_value);
+    table_value[FIELD_STATISTICS] = std::move(stats_value);
+  }
 
   Json::StreamWriterBuilder builder;
   Json::StreamWriter *writer = builder.newStreamWriter();
@@ -336,9 +660,286 @@ int TableMeta::deserialize(std::istream &is)
     indexes_.swap(indexes);
   }
 
+  // 没有engine的是磁盘上的表
+  const Json::Value &engine_value = table_value[FIELD_ENGINE];
+  in_memory_ = engine_value.isString() && 0 == strcmp(engine_value.asCString(), MEMORY_ENGINE_NAME);
+  mmap_engine_ = engine_value.isString() && 0 == strcmp(engine_value.asCString(), MMAP_ENGINE_NAME);
+  lsm_engine_ = engine_value.isString() && 0 == strcmp(engine_value.asCString(), LSM_ENGINE_NAME);
+  // 没有date_format的是以前的版本创建的表，日期是yyyymmdd
+  const Json::Value &date_format_value = table_value[FIELD_DATE_FORMAT];
+  date_in_days_ = date_format_value.isString() && 0 == strcmp(date_format_value.asCString(), DATE_FORMAT_DAYS);
+  // 没有null_format的表每个字段的null标志占一个字节
+  const Json::Value &null_format_value = table_value[FIELD_NULL_FORMAT];
+  null_bitmap_ = null_format_value.isString() && 0 == strcmp(null_format_value.asCString(), NULL_FORMAT_BITMAP);
+
+  // 没有bloom_filter的表不建布隆过滤器
+  const Json::Value &bloom_filter_value = table_value[FIELD_BLOOM_FILTER];
+  bloom_filter_field_.clear();
+  if (!bloom_filter_value.isNull() &&
+      (!bloom_filter_value.isString() || set_bloom_filter_field(bloom_filter_value.asCString()) != RC::SUCCESS))
+  {
+    LOG_ERROR("Invalid bloom filter of table meta. json value=%s", bloom_filter_value.toStyledString().c_str());
+    return -1;
+  }
+
+  // 没有partition的表不分区
+  const Json::Value &partition_value = table_value[FIELD_PARTITION];
+  if (!partition_value.isNull())
+  {
+    const Json::Value &type_value = partition_value[FIELD_PARTITION_TYPE];
+    const Json::Value &field_value = partition_value[FIELD_PARTITION_FIELD];
+    const Json::Value &partitions_value = partition_value[FIELD_PARTITIONS];
+    PartitionType type = NO_PARTITION;
+    if (type_value.isString() && 0 == strcmp(type_value.asCString(), RANGE_PARTITION_NAME))
+    {
+      type = RANGE_PARTITION;
+    }
+    else if (type_value.isString() && 0 == strcmp(type_value.asCString(), HASH_PARTITION_NAME))
+    {
+      type = HASH_PARTITION;
+    }
+    const FieldMeta *field = field_value.isString() ? this->field(field_value.asCString()) : nullptr;
+    if (type == NO_PARTITION || nullptr == field || !partitions_value.isArray())
+    {
+      LOG_ERROR("Invalid partition of table meta. json value=%s", partition_value.toStyledString().c_str());
+      return -1;
+    }
+    std::vector<PartitionMeta> partitions(partitions_value.size());
+    for (int i = 0; i < (int)partitions_value.size(); i++)
+    {
+      if (PartitionMeta::from_json(*field, partitions_value[i], partitions[i]) != RC::SUCCESS)
+      {
+        LOG_ERROR("Failed to deserialize partitions of table meta. table name=%s", name_.c_str());
+        return -1;
+      }
+    }
+    if (set_partitions(type, field->name(), partitions) != RC::SUCCESS)
+    {
+      return -1;
+    }
+  }
+
+  // 没有statistics的表没有分析过
+  const Json::Value &stats_value = table_value[FIELD_STATISTICS];
+  if (!stats_value.isNull())
+  {
+    const Json::Value &row_count_value = stats_value[FIELD_ROW_COUNT];
+    const Json::Value &columns_value = stats_value[FIELD_COLUMNS];
+    if (!row_count_value.isIntegral() || !columns_value.isArray())
+    {
+      LOG_ERROR("Invalid statistics of table meta. json value=%s", stats_value.toStyledString().c_str());
+      return -1;
+    }
+    std::vector<ColumnStats> column_stats(fields_.size());
+    for (int i = 0; i < (int)columns_value.size(); i++)
+    {
+      const Json::Value &name_value = columns_value[i][FIELD_COLUMN_NAME];
+      const int field_index = name_value.isString() ? find_field_index_by_name(name_value.asCString()) : -1;
+      if (field_index < 0 || ColumnStats::from_json(columns_value[i], column_stats[field_index]) != RC::SUCCESS)
+      {
+        LOG_ERROR("Failed to deserialize statistics of table meta. table name=%s", name_.c_str());
+        return -1;
+      }
+    }
+    set_stats(row_count_value.asInt64(), std::move(column_stats));
+  }
+
   return (int)(is.tellg() - old_pos);
 }
 
+void TableMeta::serialize_binary(std::string &output) const
+{
+  MetaWriter writer(output);
+  writer.put_string(name_);
+  // 存储引擎: 0是磁盘表，1是内存表，2是mmap，3是lsm
+  writer.put_int32(in_memory_ ? 1 : (mmap_engine_ ? 2 : (lsm_engine_ ? 3 : 0)));
+  writer.put_int32(date_in_days_ ? 1 : 0);
+  writer.put_int32(null_bitmap_ ? 1 : 0);
+  writer.put_int32((int32_t)fields_.size());
+  for (const FieldMeta &field : fields_)
+  {
+    field.to_binary(writer);
+  }
+  writer.put_int32((int32_t)indexes_.size());
+  for (const IndexMeta &index : indexes_)
+  {
+    index.to_binary(writer);
+  }
+  writer.put_string(bloom_filter_field_);
+  writer.put_int32(partition_type_);
+  if (partitioned())
+  {
+    writer.put_string(partition_field_);
+    writer.put_int32((int32_t)partitions_.size());
+    for (const PartitionMeta &partition : partitions_)
+    {
+      partition.to_binary(writer);
+    }
+  }
+  // 统计信息放在最后，没有分析过的表到这里就结束了
+  if (analyzed())
+  {
+    writer.put_int64(stats_row_count_);
+    writer.put_int32((int32_t)column_stats_.size());
+    for (const ColumnStats &stats : column_stats_)
+    {
+      writer.put_int32(stats.valid() ? 1 : 0);
+      if (stats.valid())
+      {
+        stats.to_binary(writer);
+      }
+    }
+  }
+}
+
+RC TableMeta::deserialize_binary(const char *data, int len)
+{
+  if (sys_fields_.empty())
+  {
+    init_sys_fields();
+  }
+
+  MetaReader reader(data, len);
+  std::string table_name;
+  int32_t engine = 0;
+  int32_t date_in_days = 0;
+  int32_t null_bitmap = 0;
+  int32_t field_num = 0;
+  if (!reader.get_string(&table_name) || !reader.get_int32(&engine) || !reader.get_int32(&date_in_days) ||
+      !reader.get_int32(&null_bitmap) || !reader.get_int32(&field_num) || field_num <= 0)
+  {
+    LOG_ERROR("Failed to decode table meta. data is truncated");
+    return RC::GENERIC_ERROR;
+  }
+
+  RC rc = RC::SUCCESS;
+  std::vector<FieldMeta> fields(field_num);
+  for (int i = 0; i < field_num; i++)
+  {
+    rc = FieldMeta::from_binary(reader, fields[i]);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to decode table meta. table name=%s", table_name.c_str());
+      return rc;
+    }
+  }
+  std::sort(fields.begin(), fields.end(),
+            [](const FieldMeta &f1, const FieldMeta &f2)
+            { return f1.offset() < f2.offset(); });
+
+  name_.swap(table_name);
+  fields_.swap(fields);
+  record_size_ = fields_.back().offset() + fields_.back().len();
+  in_memory_ = engine == 1;
+  mmap_engine_ = engine == 2;
+  lsm_engine_ = engine == 3;
+  date_in_days_ = date_in_days != 0;
+  null_bitmap_ = null_bitmap != 0;
+
+  int32_t index_num = 0;
+  if (!reader.get_int32(&index_num) || index_num < 0)
+  {
+    LOG_ERROR("Failed to decode indexes of table meta. table name=%s", name_.c_str());
+    return RC::GENERIC_ERROR;
+  }
+  std::vector<IndexMeta> indexes(index_num);
+  for (int i = 0; i < index_num; i++)
+  {
+    rc = IndexMeta::from_binary(*this, reader, indexes[i]);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to decode table meta. table name=%s", name_.c_str());
+      return rc;
+    }
+  }
+  indexes_.swap(indexes);
+
+  std::string bloom_filter_field;
+  if (!reader.get_string(&bloom_filter_field) ||
+      (!bloom_filter_field.empty() && nullptr == field(bloom_filter_field.c_str())))
+  {
+    LOG_ERROR("Failed to decode bloom filter of table meta. table name=%s", name_.c_str());
+    return RC::GENERIC_ERROR;
+  }
+  bloom_filter_field_.swap(bloom_filter_field);
+
+  int32_t partition_type = NO_PARTITION;
+  if (!reader.get_int32(&partition_type))
+  {
+    LOG_ERROR("Failed to decode partitions of table meta. table name=%s", name_.c_str());
+    return RC::GENERIC_ERROR;
+  }
+  partition_type_ = NO_PARTITION;
+  partition_field_.clear();
+  partitions_.clear();
+  if (partition_type != NO_PARTITION)
+  {
+    std::string field_name;
+    int32_t partition_num = 0;
+    if (!reader.get_string(&field_name) || !reader.get_int32(&partition_num) || partition_num <= 0 ||
+        nullptr == field(field_name.c_str()))
+    {
+      LOG_ERROR("Failed to decode partitions of table meta. table name=%s", name_.c_str());
+      return RC::GENERIC_ERROR;
+    }
+    std::vector<PartitionMeta> partitions(partition_num);
+    for (int i = 0; i < partition_num; i++)
+    {
+      rc = PartitionMeta::from_binary(*field(field_name.c_str()), reader, partitions[i]);
+      if (rc != RC::SUCCESS)
+      {
+        LOG_ERROR("Failed to decode table meta. table name=%s", name_.c_str());
+        return rc;
+      }
+    }
+    rc = set_partitions((PartitionType)partition_type, field_name.c_str(), partitions);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+
+  stats_row_count_ = 0;
+  column_stats_.clear();
+  if (!reader.eof())
+  {
+    int64_t row_count = 0;
+    int32_t column_num = 0;
+    if (!reader.get_int64(&row_count) || !reader.get_int32(&column_num) || column_num != (int32_t)fields_.size())
+    {
+      LOG_ERROR("Failed to decode statistics of table meta. table name=%s", name_.c_str());
+      return RC::GENERIC_ERROR;
+    }
+    std::vector<ColumnStats> column_stats(column_num);
+    for (int i = 0; i < column_num; i++)
+    {
+      int32_t valid = 0;
+      if (!reader.get_int32(&valid))
+      {
+        LOG_ERROR("Failed to decode statistics of table meta. table name=%s", name_.c_str());
+        return RC::GENERIC_ERROR;
+      }
+      if (valid != 0)
+      {
+        rc = ColumnStats::from_binary(reader, column_stats[i]);
+        if (rc != RC::SUCCESS)
+        {
+          LOG_ERROR("Failed to decode table meta. table name=%s", name_.c_str());
+          return rc;
+        }
+      }
+    }
+    set_stats(row_count, std::move(column_stats));
+  }
+
+  if (!reader.eof())
+  {
+    LOG_ERROR("Unexpected data after table meta. table name=%s", name_.c_str());
+    return RC::GENERIC_ERROR;
+  }
+  return RC::SUCCESS;
+}
+
 int TableMeta::get_serial_size() const
 {
   return -1;
@@ -364,5 +965,11 @@ void TableMeta::desc(std::ostream &os) const
     index.desc(os);
     os << std::endl;
   }
+  for (const auto &partition : partitions_)
+  {
+    os << '\t';
+    partition.desc(*partition_field(), os);
+    os << std::endl;
+  }
   os << ')' << std::endl;
 }
@@ -21,6 +21,8 @@ See the Mulan PSL v2 for more details. */
 #include "rc.h"
 #include "storage/common/field_meta.h"
 #include "storage/common/index_meta.h"
+#include "storage/common/partition_meta.h"
+#include "storage/common/column_stats.h"
 #include "common/lang/serializable.h"
 
 class TableMeta : public common::Serializable {
@@ -56,10 +58,136 @@ public:
 
   const IndexMeta * index(const char *name) const;
   const IndexMeta * find_index_by_field(const char *field) const;
+  /**
+   * 按顺序正好建在这些字段上的索引
+   */
+  const IndexMeta * find_index_by_fields(int field_num, const char *const fields[]) const;
   const IndexMeta * index(int i) const;
   int index_num() const;
 
+  /**
+   * 所有字段的长度，不包括之后的null标志
+   */
   int record_size() const;
+  /**
+   * 记录中所有字段之后是null标志，每个非系统字段一位，按字段的顺序排列。
+   * 以前的版本创建的表每个字段一个字节，见null_bitmap
+   */
+  int null_flags_size() const;
+  int record_data_size() const
+  {
+    return record_size_ + null_flags_size();
+  }
+  NullFlag null_flag(int field_index) const;
+  bool null_bitmap() const
+  {
+    return null_bitmap_;
+  }
+
+  /**
+   * 内存表的记录和索引只在内存中，元数据仍然保存在文件中，重新启动之后是空表
+   */
+  bool in_memory() const
+  {
+    return in_memory_;
+  }
+  void set_in_memory(bool in_memory)
+  {
+    in_memory_ = in_memory;
+  }
+  /**
+   * mmap引擎的表和磁盘表一样有数据文件和索引文件，用于加载一次之后不再修改的表。
+   * 打开表时文件只读地映射到内存中，不再占用缓冲池，之后不能修改
+   */
+  bool mmap_engine() const
+  {
+    return mmap_engine_;
+  }
+  void set_mmap_engine(bool mmap_engine)
+  {
+    mmap_engine_ = mmap_engine;
+  }
+  /**
+   * lsm引擎的表记录仍然追加到数据文件中，索引是LsmIndex，修改顺序写入wal和run，不随机地修改索引页面，
+   * 用于写入多、查询少的表
+   */
+  bool lsm_engine() const
+  {
+    return lsm_engine_;
+  }
+  void set_lsm_engine(bool lsm_engine)
+  {
+    lsm_engine_ = lsm_engine;
+  }
+  /**
+   * 记录中的日期是从1970-01-01开始的天数。以前的版本创建的表日期是yyyymmdd格式的整数，
+   * 打开时转换一次，见Table::upgrade_dates
+   */
+  bool date_in_days() const
+  {
+    return date_in_days_;
+  }
+  void set_date_in_days(bool date_in_days)
+  {
+    date_in_days_ = date_in_days;
+  }
+
+  /**
+   * 记录文件中每个区段为这个字段建布隆过滤器，没有指定时返回nullptr
+   */
+  const FieldMeta *bloom_filter_field() const;
+  RC set_bloom_filter_field(const char *field_name);
+
+  /**
+   * 按field_name分区，partitions按照建表时的顺序排列，range分区的上界需要递增，只有最后一个分区可以没有上界
+   */
+  RC set_partitions(PartitionType type, const char *field_name, const std::vector<PartitionMeta> &partitions);
+  RC remove_partition(const char *name);
+
+  PartitionType partition_type() const
+  {
+    return partition_type_;
+  }
+  bool partitioned() const
+  {
+    return partition_type_ != NO_PARTITION;
+  }
+  const FieldMeta *partition_field() const;
+  int partition_num() const
+  {
+    return (int)partitions_.size();
+  }
+  const PartitionMeta *partition(int i) const
+  {
+    return &partitions_[i];
+  }
+  int find_partition_by_name(const char *name) const;
+  /**
+   * 记录应该放到的分区，按record_data_size格式的数据判断，分区字段是null时放到第一个分区。
+   * range分区中没有包含这个值的分区时返回-1
+   */
+  int find_partition(const char *record) const;
+  /**
+   * 第i个分区使用的元数据，字段和索引都和这张表相同，名字是"表名.分区名"，本身不分区
+   */
+  void partition_table_meta(int i, TableMeta &meta) const;
+
+  /**
+   * ANALYZE TABLE的结果，和表的元数据一起保存。column_stats按字段的序号排列，系统字段没有统计信息
+   */
+  bool analyzed() const
+  {
+    return !column_stats_.empty();
+  }
+  int64_t stats_row_count() const
+  {
+    return stats_row_count_;
+  }
+  /**
+   * 没有分析过或者字段没有统计信息时返回nullptr
+   */
+  const ColumnStats *column_stats(int field_index) const;
+  void set_stats(int64_t row_count, std::vector<ColumnStats> &&column_stats);
 
 public:
   int  serialize(std::ostream &os) const override;
@@ -68,6 +196,12 @@ public:
   void to_string(std::string &output) const override;
   void desc(std::ostream &os) const;
 
+  /**
+   * 数据库目录中catalog文件使用的二进制格式，打开表时不用解析JSON。表的.table文件仍然是JSON
+   */
+  void serialize_binary(std::string &output) const;
+  RC deserialize_binary(const char *data, int len);
+
 private:
   static RC init_sys_fields();
 private:
@@ -76,6 +210,19 @@ private:
   std::vector<IndexMeta>  indexes_;
 
   int  record_size_ = 0;
+  bool in_memory_ = false;
+  bool mmap_engine_ = false;
+  bool lsm_engine_ = false;
+  bool date_in_days_ = true;
+  bool null_bitmap_ = true;
+  std::string bloom_filter_field_;
+
+  PartitionType partition_type_ = NO_PARTITION;
+  std::string partition_field_;
+  std::vector<PartitionMeta> partitions_;
+
+  int64_t stats_row_count_ = 0;
+  std::vector<ColumnStats> column_stats_;
 
   static std::vector<FieldMeta> sys_fields_;
 };
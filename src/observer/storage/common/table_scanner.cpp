@@ -0,0 +1,698 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Pull-style table scan that hands out records batch by batch.
+//
+
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+
+#include "storage/common/table_scanner.h"
+#include "storage/common/table.h"
+#include "storage/common/index.h"
+#include "storage/common/zone_map.h"
+#include "storage/common/condition_filter.h"
+#include "storage/trx/trx.h"
+#include "storage/mem/mem_record_store.h"
+#include "common/log/log.h"
+#include "common/metrics/latency_histogram.h"
+#include "common/seda/request_trace.h"
+#include "session/query_cancel.h"
+
+static thread_local long thread_scanned_records = 0;
+
+long &scanned_record_count()
+{
+  return thread_scanned_records;
+}
+
+TableScanner::~TableScanner()
+{
+  close();
+}
+
+RC TableScanner::open(Trx *trx, Table *table, ConditionFilter *filter, int limit,
+                      const std::vector<int> *field_indexes)
+{
+  if (opened_)
+  {
+    return RC::RECORD_OPENNED;
+  }
+  start(trx, table, filter, limit);
+  return open_started(field_indexes);
+}
+
+RC TableScanner::open_started(const std::vector<int> *field_indexes)
+{
+  if (0 == limit_)
+  {
+    mode_ = Mode::INDEX;  // rids_为空，第一次next_batch就结束
+    return RC::SUCCESS;
+  }
+
+  if (table_->partitioned())
+  {
+    // 分区在next_batch时才打开，分区的扫描自己选择索引
+    mode_ = Mode::PARTITION;
+    table_->prune_partitions(filter_, partitions_);
+    has_field_indexes_ = field_indexes != nullptr;
+    if (has_field_indexes_)
+    {
+      field_indexes_ = *field_indexes;
+    }
+    return RC::SUCCESS;
+  }
+
+  std::vector<int> columns;
+  bool known_columns = field_indexes != nullptr && table_->collect_filter_columns(filter_, columns);
+  if (known_columns)
+  {
+    columns.insert(columns.end(), field_indexes->begin(), field_indexes->end());
+  }
+
+  // filter == nullptr，则index_scanner也为nullptr
+  Index *index = nullptr;
+  IndexScanner *index_scanner = table_->find_index_for_scan(filter_, &index);
+  if (index_scanner != nullptr)
+  {
+    if (use_covering_index(index, columns, known_columns))
+    {
+      mode_ = Mode::COVERING_INDEX;
+      index_ = index;
+      index_scanner_ = index_scanner;
+      key_.resize(index->key_length());
+      buffer_.assign(table_->record_data_size(), 0);
+      return RC::SUCCESS;
+    }
+
+    mode_ = Mode::INDEX;
+    return collect_rids(index_scanner, true);
+  }
+
+  return open_sequential(filter_, columns, known_columns);
+}
+
+bool TableScanner::use_covering_index(const Index *index, const std::vector<int> &columns, bool known_columns) const
+{
+  // 没有旧版本时只有别的事务插入或者删除的记录可能不可见，这些记录所在的页面回表判断
+  return known_columns && (trx_ == nullptr || trx_->all_visible(table_) || !Trx::has_versions(table_)) &&
+         table_->index_covers(*index, columns);
+}
+
+RC TableScanner::open_ordered(Trx *trx, Table *table, ConditionFilter *filter, int limit,
+                              const std::vector<const FieldMeta *> &order_fields, bool descending, bool *ordered,
+                              const std::vector<int> *field_indexes)
+{
+  *ordered = false;
+  if (opened_)
+  {
+    return RC::RECORD_OPENNED;
+  }
+  start(trx, table, filter, limit);
+
+  // 索引中只有最新的版本，有别的事务的修改时可见的版本可能不在索引项的位置上，只能扫描之后排序
+  Index *index = nullptr;
+  IndexScanner *index_scanner = nullptr;
+  if (!table_->partitioned() && limit_ > 0 && (trx_ == nullptr || trx_->all_visible(table_)))
+  {
+    index_scanner = table_->find_index_for_order(filter, order_fields, descending, &index);
+  }
+  if (nullptr == index_scanner)
+  {
+    return open_started(field_indexes);
+  }
+
+  std::vector<int> columns;
+  bool known_columns = field_indexes != nullptr && table_->collect_filter_columns(filter, columns);
+  if (known_columns)
+  {
+    columns.insert(columns.end(), field_indexes->begin(), field_indexes->end());
+  }
+  *ordered = true;
+  index_ = index;
+  index_scanner_ = index_scanner;
+  if (use_covering_index(index, columns, known_columns))
+  {
+    mode_ = Mode::COVERING_INDEX;
+    key_.resize(index->key_length());
+    buffer_.assign(table_->record_data_size(), 0);
+    return RC::SUCCESS;
+  }
+  // 边读索引边回表，有limit或者只需要第一条记录时不用读完整个索引
+  mode_ = Mode::INDEX;
+  return RC::SUCCESS;
+}
+
+void TableScanner::intersect_indexes(Table *table, const ConditionFilter *filter, std::vector<Index *> &indexes)
+{
+  if (table->partitioned())
+  {
+    return;
+  }
+  pthread_rwlock_rdlock(&table->compact_lock_);
+  table->find_intersect_indexes(filter, indexes);
+  pthread_rwlock_unlock(&table->compact_lock_);
+}
+
+Index *TableScanner::order_index(Table *table, const ConditionFilter *filter,
+                                 const std::vector<const FieldMeta *> &order_fields)
+{
+  if (table->partitioned())
+  {
+    return nullptr;
+  }
+  Index *index = nullptr;
+  pthread_rwlock_rdlock(&table->compact_lock_);
+  IndexScanner *index_scanner = table->find_index_for_order(filter, order_fields, false, &index);
+  pthread_rwlock_unlock(&table->compact_lock_);
+  if (index_scanner == nullptr)
+  {
+    return nullptr;
+  }
+  index_scanner->destroy();
+  return index;
+}
+
+RC TableScanner::open_morsels(Trx *trx, Table *table, ConditionFilter *filter, PageMorsels *morsels,
+                              const std::vector<int> *field_indexes)
+{
+  if (opened_)
+  {
+    return RC::RECORD_OPENNED;
+  }
+  start(trx, table, filter, -1);
+
+  std::vector<int> columns;
+  bool known_columns = field_indexes != nullptr && table_->collect_filter_columns(filter, columns);
+  if (known_columns)
+  {
+    columns.insert(columns.end(), field_indexes->begin(), field_indexes->end());
+  }
+  RC rc = open_sequential(filter, columns, known_columns);
+  if (rc == RC::SUCCESS)
+  {
+    record_scanner_.set_morsels(morsels);
+  }
+  return rc;
+}
+
+bool TableScanner::parallel_scannable(Table *table, const ConditionFilter *filter, int min_pages)
+{
+  // 内存表的扫描只是访问内存，不值得分给多个线程。分区表按分区顺序扫描
+  int page_count = 0;
+  if (table->in_memory() || table->partitioned() ||
+      table->data_buffer_pool_->get_page_count(table->file_id_, &page_count) != RC::SUCCESS || page_count < min_pages)
+  {
+    return false;
+  }
+  pthread_rwlock_rdlock(&table->compact_lock_);
+  IndexScanner *index_scanner = table->find_index_for_scan(filter);
+  pthread_rwlock_unlock(&table->compact_lock_);
+  if (index_scanner != nullptr)
+  {
+    index_scanner->destroy();
+    return false;
+  }
+  return true;
+}
+
+Index *TableScanner::scan_index(Table *table, const ConditionFilter *filter)
+{
+  if (table->partitioned())
+  {
+    return nullptr;
+  }
+  Index *index = nullptr;
+  pthread_rwlock_rdlock(&table->compact_lock_);
+  IndexScanner *index_scanner = table->find_index_for_scan(filter, &index);
+  pthread_rwlock_unlock(&table->compact_lock_);
+  if (index_scanner == nullptr)
+  {
+    return nullptr;
+  }
+  index_scanner->destroy();
+  return index;
+}
+
+int TableScanner::scan_partition_num(Table *table, const ConditionFilter *filter)
+{
+  std::vector<Table *> partitions;
+  pthread_rwlock_rdlock(&table->compact_lock_);
+  table->prune_partitions(filter, partitions);
+  pthread_rwlock_unlock(&table->compact_lock_);
+  return (int)partitions.size();
+}
+
+RC TableScanner::open_sequential(ConditionFilter *filter, std::vector<int> &columns, bool known_columns)
+{
+  mode_ = Mode::SEQUENTIAL;
+  if (table_->in_memory())
+  {
+    // 每批访问内存表的一块记录，过滤条件在visit_record中判断
+    mem_block_ = 0;
+    return RC::SUCCESS;
+  }
+  // 可能读到更早的版本时，过滤条件在判断可见性之后判断
+  page_filtered_ = !table_->variable_length() && (trx_ == nullptr || trx_->all_visible(table_));
+  RC rc = record_scanner_.open_scan(*table_->data_buffer_pool_, table_->file_id_, page_filtered_ ? filter : nullptr);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("failed to open scanner. file id=%d. rc=%d:%s", table_->file_id_, rc, strrc(rc));
+    return rc;
+  }
+  // PAX的列和字段一一对应，最后一列是null标志。事务字段用来判断可见性，总是需要读取
+  if (known_columns && table_->pax())
+  {
+    const TableMeta &table_meta = table_->table_meta();
+    columns.push_back(table_meta.find_field_index_by_name(table_meta.trx_field()->name()));
+    columns.push_back(table_meta.field_num());
+    std::sort(columns.begin(), columns.end());
+    columns.erase(std::unique(columns.begin(), columns.end()), columns.end());
+    record_scanner_.set_columns(columns);
+  }
+  if ((filter != nullptr && table_->zone_map_->enabled()) || trx_ != nullptr)
+  {
+    record_scanner_.set_page_filter(page_filter, this);
+  }
+  if (table_->variable_length())
+  {
+    buffer_.resize(table_->record_data_size());
+  }
+  return RC::SUCCESS;
+}
+
+RC TableScanner::open_lookup(Trx *trx, Table *table, ConditionFilter *filter, Index *index, const char *key)
+{
+  if (opened_)
+  {
+    return RC::RECORD_OPENNED;
+  }
+  start(trx, table, filter, -1);
+
+  mode_ = Mode::INDEX;
+  lookup_field_ = &index->field_metas()[0];
+  lookup_key_.assign(key, key + lookup_field_->len());
+  IndexScanner *index_scanner = index->create_range_scanner(key, 1, true, key, 1, true);
+  if (nullptr == index_scanner)
+  {
+    LOG_ERROR("Failed to create index scanner. index=%s", index->index_meta().name());
+    return RC::GENERIC_ERROR;
+  }
+  return collect_rids(index_scanner);
+}
+
+void TableScanner::start(Trx *trx, Table *table, ConditionFilter *filter, int limit)
+{
+  table_ = table;
+  trx_ = trx;
+  filter_ = filter;
+  limit_ = limit < 0 ? INT_MAX : limit;
+  record_count_ = 0;
+  skipped_pages_ = 0;
+  rids_.clear();
+  rid_pos_ = 0;
+  index_ = nullptr;
+  index_scanner_ = nullptr;
+  page_filtered_ = false;
+  page_all_visible_ = false;
+  version_rids_ = false;
+  lookup_field_ = nullptr;
+  partitions_.clear();
+  partition_pos_ = 0;
+  trace_ = common::RequestTrace::current();
+  trace_begin_us_ = trace_ == nullptr ? 0 : common::LatencyHistogram::now_us();
+
+  // 整个扫描使用同一个读视图
+  if (trx_ != nullptr)
+  {
+    trx_->acquire_read_view();
+  }
+  pthread_rwlock_rdlock(&table_->compact_lock_);
+  opened_ = true;
+}
+
+RC TableScanner::collect_rids(IndexScanner *index_scanner, bool intersect)
+{
+  RID rid;
+  RC rc = RC::SUCCESS;
+  while ((rc = index_scanner->next_entry(&rid)) == RC::SUCCESS)
+  {
+    rids_.push_back(rid);
+  }
+  index_scanner->destroy();
+  if (rc != RC::RECORD_EOF)
+  {
+    LOG_ERROR("Failed to scan table by index. rc=%d:%s", rc, strrc(rc));
+    return rc;
+  }
+  // 其它索引上的等值条件在回表之前就用rid的交集排除掉，旧版本在所有的索引中都可能没有，之后再补上
+  if (intersect)
+  {
+    rc = table_->intersect_index_rids(filter_, rids_);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+  // 更早的版本可能在索引中已经没有了，补上有旧版本的记录，之后在可见的版本上判断条件
+  version_rids_ = trx_ != nullptr && Trx::add_version_rids(table_, rids_);
+  // 按页面的顺序回表，索引中相邻的项通常在不同的页面上，按索引的顺序会反复随机地访问同一些页面
+  std::sort(rids_.begin(), rids_.end());
+  return RC::SUCCESS;
+}
+
+RC TableScanner::next_batch(void *context, void (*record_reader)(const char *data, void *context))
+{
+  if (!opened_)
+  {
+    return RC::RECORD_CLOSED;
+  }
+  if (record_count_ >= limit_)
+  {
+    return RC::RECORD_EOF;
+  }
+  // 每批最多一个页面，每批检查一次语句是否被取消
+  if (QueryCancel::current_cancelled())
+  {
+    return RC::INTERRUPT;
+  }
+
+  context_ = context;
+  record_reader_ = record_reader;
+  switch (mode_)
+  {
+  case Mode::SEQUENTIAL:
+    return next_sequential_batch();
+  case Mode::INDEX:
+    return next_index_batch();
+  case Mode::COVERING_INDEX:
+    return next_covering_index_batch();
+  case Mode::PARTITION:
+    return next_partition_batch();
+  }
+  return RC::GENERIC_ERROR;
+}
+
+RC TableScanner::close()
+{
+  if (!opened_)
+  {
+    return RC::SUCCESS;
+  }
+  if (index_scanner_ != nullptr)
+  {
+    index_scanner_->destroy();
+    index_scanner_ = nullptr;
+  }
+  if (partition_scanner_ != nullptr)
+  {
+    delete partition_scanner_;
+    partition_scanner_ = nullptr;
+  }
+  record_scanner_.close_scan();
+  if (skipped_pages_ > 0)
+  {
+    LOG_DEBUG("Skip %d pages of table %s by zone map", skipped_pages_, table_->name());
+  }
+  rids_.clear();
+  pthread_rwlock_unlock(&table_->compact_lock_);
+  if (mode_ != Mode::PARTITION)
+  {
+    thread_scanned_records += record_count_;
+  }
+  if (trace_ != nullptr)
+  {
+    static const char *const MODE_NAMES[] = {"table_scan", "index_scan", "covering_index_scan", "partition_scan"};
+    trace_->add_span("storage", MODE_NAMES[(int)mode_], trace_begin_us_, common::LatencyHistogram::now_us());
+    trace_ = nullptr;
+  }
+  opened_ = false;
+  return RC::SUCCESS;
+}
+
+RC TableScanner::next_sequential_batch()
+{
+  if (table_->in_memory())
+  {
+    RC rc = table_->mem_records_->visit_block(mem_block_++, visit_record, this);
+    // visitor在达到limit时返回RECORD_EOF，这一批记录已经交给record_reader了
+    return RC::RECORD_EOF == rc && record_count_ >= limit_ ? RC::SUCCESS : rc;
+  }
+  // 按页面访问记录，可见性和过滤条件直接在页面数据上判断，只有满足条件的记录交给record_reader
+  RC rc = record_scanner_.visit_next_page(table_->variable_length() ? decode_visit_record : visit_record, this);
+  if (RC::RECORD_EOF == rc && record_count_ < limit_)
+  {
+    // 所有页面都访问完了
+    return rc;
+  }
+  if (RC::RECORD_EOF == rc)
+  {
+    // visitor在达到limit时返回的，这一批记录已经交给record_reader了
+    return RC::SUCCESS;
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("failed to scan record. file id=%d, rc=%d:%s", table_->file_id_, rc, strrc(rc));
+  }
+  return rc;
+}
+
+RC TableScanner::next_index_batch()
+{
+  if (rid_pos_ >= rids_.size() && index_scanner_ != nullptr)
+  {
+    // 按顺序扫描时每批从索引中取出下一批rid
+    rids_.clear();
+    rid_pos_ = 0;
+    RID rid;
+    RC rc = RC::SUCCESS;
+    while (rids_.size() < TABLE_SCANNER_BATCH_SIZE && (rc = index_scanner_->next_entry(&rid)) == RC::SUCCESS)
+    {
+      rids_.push_back(rid);
+    }
+    if (rc != RC::SUCCESS)
+    {
+      index_scanner_->destroy();
+      index_scanner_ = nullptr;
+      if (rc != RC::RECORD_EOF)
+      {
+        LOG_ERROR("Failed to scan table by index. rc=%d:%s", rc, strrc(rc));
+        return rc;
+      }
+    }
+  }
+  if (rid_pos_ >= rids_.size())
+  {
+    return RC::RECORD_EOF;
+  }
+
+  RC rc = RC::SUCCESS;
+  Record record;
+  // rid按页面排过序，同一个页面上的记录连在一起，页面只获取一次，这一批结束时放开。
+  // 页面是否全部可见也只在换页面时判断一次
+  RecordPageHandler cursor;
+  PageNum checked_page = BP_INVALID_PAGE_NUM;
+  bool page_all_visible = false;
+  const size_t batch_end = std::min(rids_.size(), rid_pos_ + TABLE_SCANNER_BATCH_SIZE);
+  for (; rid_pos_ < batch_end && record_count_ < limit_; rid_pos_++)
+  {
+    const RID &rid = rids_[rid_pos_];
+    rc = table_->get_record(rid, &record, buffer_, &cursor);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to fetch record of rid=%d:%d, rc=%d:%s", rid.page_num, rid.slot_num, rc, strrc(rc));
+      return rc;
+    }
+
+    if (trx_ != nullptr && rid.page_num != checked_page)
+    {
+      checked_page = rid.page_num;
+      page_all_visible = table_->page_visibility_.all_visible(checked_page);
+    }
+
+    // 索引只给出了范围，记录还需要满足所有的过滤条件
+    if ((trx_ == nullptr || page_all_visible || trx_->is_visible(table_, &record, version_)) &&
+        (filter_ == nullptr || filter_->filter(record)) && (!version_rids_ || lookup_matches(record)))
+    {
+      current_rid_ = rid;
+      record_reader_(record.data, context_);
+      record_count_++;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC TableScanner::next_covering_index_batch()
+{
+  if (nullptr == index_scanner_)
+  {
+    return RC::RECORD_EOF;
+  }
+
+  // 索引字段不能为null，记录中的null标志都是0。record_reader只读取数据，可以一边扫描索引一边处理
+  RC rc = RC::SUCCESS;
+  RID rid;
+  Record record;
+  record.data = buffer_.data();
+  for (int i = 0; i < TABLE_SCANNER_BATCH_SIZE && record_count_ < limit_; i++)
+  {
+    rc = index_scanner_->next_entry(&rid, key_.data());
+    if (rc != RC::SUCCESS)
+    {
+      break;
+    }
+    if (trx_ != nullptr && !table_->page_visibility_.all_visible(rid.page_num))
+    {
+      // 页面上有事务操作过的记录，回表判断可见性
+      Record fetched;
+      rc = table_->get_record(rid, &fetched, fetch_buffer_);
+      if (rc != RC::SUCCESS)
+      {
+        LOG_ERROR("Failed to fetch record of rid=%d:%d, rc=%d:%s", rid.page_num, rid.slot_num, rc, strrc(rc));
+        break;
+      }
+      if (trx_->is_visible(table_, &fetched, version_) && (filter_ == nullptr || filter_->filter(fetched)))
+      {
+        current_rid_ = rid;
+        record_reader_(fetched.data, context_);
+        record_count_++;
+      }
+      continue;
+    }
+    index_->copy_key_to_record(key_.data(), buffer_.data());
+    record.rid = rid;
+    if (filter_ == nullptr || filter_->filter(record))
+    {
+      current_rid_ = rid;
+      record_reader_(buffer_.data(), context_);
+      record_count_++;
+    }
+  }
+  if (RC::SUCCESS == rc)
+  {
+    return rc;
+  }
+
+  index_scanner_->destroy();
+  index_scanner_ = nullptr;
+  if (rc != RC::RECORD_EOF)
+  {
+    LOG_ERROR("Failed to scan table by covering index. rc=%d:%s", rc, strrc(rc));
+    return rc;
+  }
+  // 这一批可能已经读到了一些记录，下一次next_batch再返回RECORD_EOF
+  return RC::SUCCESS;
+}
+
+RC TableScanner::next_partition_batch()
+{
+  while (true)
+  {
+    if (nullptr == partition_scanner_)
+    {
+      if (partition_pos_ >= partitions_.size())
+      {
+        return RC::RECORD_EOF;
+      }
+      partition_scanner_ = new TableScanner();
+      RC rc = partition_scanner_->open(trx_, partitions_[partition_pos_++], filter_,
+                                       limit_ == INT_MAX ? -1 : limit_ - record_count_,
+                                       has_field_indexes_ ? &field_indexes_ : nullptr);
+      if (rc != RC::SUCCESS)
+      {
+        delete partition_scanner_;
+        partition_scanner_ = nullptr;
+        return rc;
+      }
+    }
+
+    const int before = partition_scanner_->record_count_;
+    RC rc = partition_scanner_->next_batch(context_, record_reader_);
+    record_count_ += partition_scanner_->record_count_ - before;
+    if (rc != RC::RECORD_EOF)
+    {
+      return rc;
+    }
+    delete partition_scanner_;
+    partition_scanner_ = nullptr;
+  }
+}
+
+RC TableScanner::visit_record(Record *record, void *context)
+{
+  TableScanner &scanner = *(TableScanner *)context;
+  const char *data = record->data;
+  if (scanner.trx_ != nullptr && !scanner.page_all_visible_ &&
+      !scanner.trx_->is_visible(scanner.table_, record, scanner.version_))
+  {
+    return RC::SUCCESS;
+  }
+  // 读到的是更早的版本时，页面上判断的过滤条件不算数
+  if (scanner.filter_ != nullptr && (!scanner.page_filtered_ || record->data != data) &&
+      !scanner.filter_->filter(*record))
+  {
+    return RC::SUCCESS;
+  }
+  scanner.current_rid_ = record->rid;
+  scanner.record_reader_(record->data, scanner.context_);
+  if (++scanner.record_count_ >= scanner.limit_)
+  {
+    return RC::RECORD_EOF;
+  }
+  return RC::SUCCESS;
+}
+
+/**
+ * 变长记录先解码，过滤条件按照字段的偏移访问记录，只能在解码之后判断
+ */
+RC TableScanner::decode_visit_record(Record *record, void *context)
+{
+  TableScanner &scanner = *(TableScanner *)context;
+  Record decoded;
+  decoded.rid = record->rid;
+  decoded.data = scanner.buffer_.data();
+  scanner.table_->decode_record(record->data, decoded.data);
+  return visit_record(&decoded, context);
+}
+
+bool TableScanner::lookup_matches(const Record &record) const
+{
+  if (nullptr == lookup_field_)
+  {
+    return true;
+  }
+  // 和查找用的key格式相同，字符串只比较到结尾
+  const char *value = record.data + lookup_field_->offset();
+  if (lookup_field_->type() == CHARS)
+  {
+    return 0 == strncmp(value, lookup_key_.data(), lookup_key_.size());
+  }
+  return 0 == memcmp(value, lookup_key_.data(), lookup_key_.size());
+}
+
+/**
+ * zone map判断页面上不可能有满足条件的记录时跳过页面。要读取的页面上没有事务操作过的记录时，
+ * 这个页面上的记录不再逐条判断可见性
+ */
+bool TableScanner::page_filter(PageNum page_num, void *context)
+{
+  TableScanner &scanner = *(TableScanner *)context;
+  if (scanner.filter_ != nullptr && scanner.table_->zone_map_->enabled() &&
+      !scanner.table_->zone_map_->may_match(page_num, scanner.filter_))
+  {
+    scanner.skipped_pages_++;
+    return false;
+  }
+  scanner.page_all_visible_ =
+      scanner.trx_ != nullptr && !Trx::replica() && scanner.table_->page_visibility_.all_visible(page_num);
+  return true;
+}
@@ -0,0 +1,194 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Pull-style table scan that hands out records batch by batch.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_TABLE_SCANNER_H_
+#define __OBSERVER_STORAGE_COMMON_TABLE_SCANNER_H_
+
+#include <vector>
+
+#include "rc.h"
+#include "storage/common/record_manager.h"
+
+#define TABLE_SCANNER_BATCH_SIZE 256  // 索引扫描时每批最多读取的记录数
+
+namespace common {
+class RequestTrace;
+}  // namespace common
+
+class Table;
+class Trx;
+class Index;
+class IndexScanner;
+class ConditionFilter;
+class FieldMeta;
+
+/**
+ * 当前线程中TableScanner输出的记录的累计数，分区表只计算每个分区的扫描。慢查询日志用语句前后的差作为检查的行数
+ */
+long &scanned_record_count();
+
+/**
+ * 拉取方式的表扫描，选择索引和读取字段的方式和Table::scan_record相同。
+ * 每次next_batch把下一批满足条件的记录交给record_reader：顺序扫描时是一个页面上的记录，
+ * 索引扫描时最多TABLE_SCANNER_BATCH_SIZE条记录，调用者只需要缓存一批记录。
+ * 从open到close一直持有表的整理锁(读锁)，扫描过程中记录不会被移动。
+ * 分区表依次扫描可能有满足条件的记录的分区，每个分区用一个TableScanner
+ */
+class TableScanner {
+public:
+  TableScanner() = default;
+  ~TableScanner();
+
+  /**
+   * 参数的含义和Table::scan_record相同，limit小于0表示不限制。filter在close之前需要一直有效
+   */
+  RC open(Trx *trx, Table *table, ConditionFilter *filter, int limit, const std::vector<int> *field_indexes = nullptr);
+  /**
+   * 顺序扫描从morsels中分配到的页面，和共享同一个morsels的其它TableScanner一起扫描全表，不使用索引。
+   * 每个TableScanner只能在一个线程中使用
+   */
+  RC open_morsels(Trx *trx, Table *table, ConditionFilter *filter, PageMorsels *morsels,
+                  const std::vector<int> *field_indexes = nullptr);
+  /**
+   * 表至少有min_pages个页面，并且open时不会选择索引扫描时返回true，这时适合用open_morsels并行扫描
+   */
+  static bool parallel_scannable(Table *table, const ConditionFilter *filter, int min_pages);
+  /**
+   * open时会用来扫描的索引，顺序扫描或者分区表返回nullptr。用于EXPLAIN输出访问路径
+   */
+  static Index *scan_index(Table *table, const ConditionFilter *filter);
+  /**
+   * open时和scan_index的结果求rid交集的其它索引，用于EXPLAIN
+   */
+  static void intersect_indexes(Table *table, const ConditionFilter *filter, std::vector<Index *> &indexes);
+  /**
+   * 分区表按filter裁剪之后需要扫描的分区数
+   */
+  static int scan_partition_num(Table *table, const ConditionFilter *filter);
+  /**
+   * 按order_fields的顺序扫描，索引的选择见Table::find_index_for_order。ordered返回记录是否按顺序输出：
+   * 没有合适的索引，或者表中有对当前事务不可见的修改(可见的版本不一定在索引中对应的位置上)时为false，
+   * 这时和open一样扫描，调用者需要自己排序
+   */
+  RC open_ordered(Trx *trx, Table *table, ConditionFilter *filter, int limit,
+                  const std::vector<const FieldMeta *> &order_fields, bool descending, bool *ordered,
+                  const std::vector<int> *field_indexes = nullptr);
+  /**
+   * open_ordered可能使用的索引，没有时返回nullptr。用于生成执行计划和EXPLAIN
+   */
+  static Index *order_index(Table *table, const ConditionFilter *filter,
+                            const std::vector<const FieldMeta *> &order_fields);
+  /**
+   * 用index查找第一个字段等于key的记录，记录还需要满足filter。key的格式和记录中的字段相同
+   */
+  RC open_lookup(Trx *trx, Table *table, ConditionFilter *filter, Index *index, const char *key);
+  /**
+   * 没有更多记录时返回RECORD_EOF。record_reader拿到的数据只在调用期间有效
+   */
+  RC next_batch(void *context, void (*record_reader)(const char *data, void *context));
+  RC close();
+
+  /**
+   * record_reader调用期间是当前记录的rid
+   */
+  const RID &current_rid() const
+  {
+    return partition_scanner_ != nullptr ? partition_scanner_->current_rid() : current_rid_;
+  }
+
+private:
+  enum class Mode { SEQUENTIAL, INDEX, COVERING_INDEX, PARTITION };
+
+  /**
+   * 初始化扫描的状态并加上表的整理锁
+   */
+  void start(Trx *trx, Table *table, ConditionFilter *filter, int limit);
+  /**
+   * start之后按filter选择顺序扫描、索引扫描或者分区扫描
+   */
+  RC open_started(const std::vector<int> *field_indexes);
+  /**
+   * 打开顺序扫描，known_columns为true时只读取columns中的字段
+   */
+  RC open_sequential(ConditionFilter *filter, std::vector<int> &columns, bool known_columns);
+  /**
+   * 用到的字段都在index中，并且不需要按记录上的事务字段判断可见性时，直接从索引中读取，不再回表
+   */
+  bool use_covering_index(const Index *index, const std::vector<int> &columns, bool known_columns) const;
+  /**
+   * 取出index_scanner中所有的rid并按页面排序，之后销毁index_scanner。
+   * intersect为true时再和其它能用上的索引的rid求交集，见Table::intersect_index_rids
+   */
+  RC collect_rids(IndexScanner *index_scanner, bool intersect = false);
+
+  RC next_sequential_batch();
+  RC next_index_batch();
+  RC next_covering_index_batch();
+  /**
+   * 当前分区扫描完之后打开下一个分区
+   */
+  RC next_partition_batch();
+
+  /**
+   * open_lookup时记录可见的版本是否等于查找的key，索引只保证最新的版本
+   */
+  bool lookup_matches(const Record &record) const;
+
+  static RC visit_record(Record *record, void *context);
+  static RC decode_visit_record(Record *record, void *context);
+  static bool page_filter(PageNum page_num, void *context);
+
+private:
+  Table *table_ = nullptr;
+  Trx *trx_ = nullptr;
+  ConditionFilter *filter_ = nullptr;
+  int limit_ = 0;
+  int record_count_ = 0;
+  bool opened_ = false;
+  Mode mode_ = Mode::SEQUENTIAL;
+  common::RequestTrace *trace_ = nullptr;  // 请求被采样跟踪时，关闭扫描时记录从打开到关闭的时间
+  uint64_t trace_begin_us_ = 0;
+
+  // 当前next_batch的输出
+  void *context_ = nullptr;
+  void (*record_reader_)(const char *data, void *context) = nullptr;
+  RID current_rid_;
+
+  RecordFileScanner record_scanner_;
+  int mem_block_ = 0;         // 内存表下一批访问的块
+  bool page_filtered_ = false;  // 过滤条件已经在页面上判断过了
+  bool page_all_visible_ = false;  // 正在访问的页面上的记录都可见
+  int skipped_pages_ = 0;
+  std::vector<char> buffer_;  // 变长记录解码之后的数据，或者用索引构造的记录
+  std::vector<char> version_; // 页面上的版本不可见时读到的更早的版本
+
+  const Index *index_ = nullptr;
+  IndexScanner *index_scanner_ = nullptr;
+  std::vector<RID> rids_;     // 索引扫描时先取出所有的rid，按页面排序之后回表，不用一直固定着索引页面。
+                              // 按顺序扫描时index_scanner_不为空，每批从中取出一批rid
+  size_t rid_pos_ = 0;
+  bool version_rids_ = false;  // 表中有旧版本，rids_中补上了这些记录
+  std::vector<char> key_;
+  std::vector<char> fetch_buffer_;  // 覆盖索引扫描回表时读到的记录
+  const FieldMeta *lookup_field_ = nullptr;  // open_lookup查找的字段和key
+  std::vector<char> lookup_key_;
+
+  std::vector<Table *> partitions_;  // 分区表需要扫描的分区
+  size_t partition_pos_ = 0;
+  TableScanner *partition_scanner_ = nullptr;
+  bool has_field_indexes_ = false;
+  std::vector<int> field_indexes_;
+};
+
+#endif  // __OBSERVER_STORAGE_COMMON_TABLE_SCANNER_H_
@@ -0,0 +1,156 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Undo records of a table kept in buffer pool pages.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "storage/common/undo_file.h"
+#include "common/log/log.h"
+
+UndoFile::~UndoFile()
+{
+  close();
+}
+
+RC UndoFile::open(DiskBufferPool *buffer_pool, const std::string &file_name)
+{
+  // 上一次运行留下的undo文件没有用了
+  ::remove(file_name.c_str());
+  RC rc = buffer_pool->create_file(file_name.c_str());
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to create undo file %s. rc=%d:%s", file_name.c_str(), rc, strrc(rc));
+    return rc;
+  }
+  rc = buffer_pool->open_file(file_name.c_str(), &file_id_);
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to open undo file %s. rc=%d:%s", file_name.c_str(), rc, strrc(rc));
+    ::remove(file_name.c_str());
+    return rc;
+  }
+  buffer_pool->disable_file_redo(file_id_);
+  buffer_pool_ = buffer_pool;
+  file_name_ = file_name;
+  return RC::SUCCESS;
+}
+
+void UndoFile::close()
+{
+  if (file_id_ < 0) {
+    return;
+  }
+  // 文件马上删除，页面不用写回
+  buffer_pool_->drop_file(file_id_);
+  ::remove(file_name_.c_str());
+  file_id_ = -1;
+  pages_.clear();
+  used_ = 0;
+}
+
+RC UndoFile::page_at(size_t index, PageNum *page_num)
+{
+  while (pages_.size() <= index) {
+    BPPageHandle page_handle;
+    RC rc = buffer_pool_->allocate_page(file_id_, &page_handle);
+    if (rc != RC::SUCCESS) {
+      LOG_ERROR("Failed to allocate undo page of %s. rc=%d:%s", file_name_.c_str(), rc, strrc(rc));
+      return rc;
+    }
+    PageNum allocated;
+    buffer_pool_->get_page_num(&page_handle, &allocated);
+    buffer_pool_->unpin_page(&page_handle);
+    pages_.push_back(allocated);
+  }
+  *page_num = pages_[index];
+  return RC::SUCCESS;
+}
+
+RC UndoFile::copy(int64_t offset, char *data, int len, bool write)
+{
+  const int page_data_size = buffer_pool_->page_data_size();
+  while (len > 0) {
+    const size_t index = offset / page_data_size;
+    const int in_page = offset % page_data_size;
+    const int n = std::min(len, page_data_size - in_page);
+    PageNum page_num;
+    RC rc = page_at(index, &page_num);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+
+    BPPageHandle page_handle;
+    rc = buffer_pool_->get_this_page(file_id_, page_num, &page_handle);
+    if (rc != RC::SUCCESS) {
+      LOG_ERROR("Failed to get undo page %d of %s. rc=%d:%s", page_num, file_name_.c_str(), rc, strrc(rc));
+      return rc;
+    }
+    char *page_data = nullptr;
+    buffer_pool_->get_data(&page_handle, &page_data);
+    if (write) {
+      memcpy(page_data + in_page, data, n);
+      buffer_pool_->mark_dirty(&page_handle);
+    } else {
+      memcpy(data, page_data + in_page, n);
+    }
+    buffer_pool_->unpin_page(&page_handle);
+
+    offset += n;
+    data += n;
+    len -= n;
+  }
+  return RC::SUCCESS;
+}
+
+RC UndoFile::append(const char *data, int len, UndoPtr *ptr)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_id_ < 0) {
+    return RC::BUFFERPOOL_CLOSED;
+  }
+  RC rc = copy(used_, const_cast<char *>(data), len, true);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  ptr->offset = used_;
+  ptr->len = len;
+  used_ += len;
+  return RC::SUCCESS;
+}
+
+RC UndoFile::read(const UndoPtr &ptr, std::vector<char> &data)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_id_ < 0) {
+    return RC::BUFFERPOOL_CLOSED;
+  }
+  if (ptr.offset + ptr.len > used_) {
+    LOG_ERROR("Invalid undo pointer %ld+%d of %s, used=%ld", ptr.offset, ptr.len, file_name_.c_str(), used_);
+    return RC::INTERNAL;
+  }
+  data.resize(ptr.len);
+  return copy(ptr.offset, data.data(), ptr.len, false);
+}
+
+void UndoFile::reset()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  used_ = 0;
+}
+
+int64_t UndoFile::used_size()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return used_;
+}
@@ -0,0 +1,77 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Undo records of a table kept in buffer pool pages.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_UNDO_FILE_H_
+#define __OBSERVER_STORAGE_COMMON_UNDO_FILE_H_
+
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "storage/default/disk_buffer_pool.h"
+#include "rc.h"
+
+/**
+ * undo记录在文件中的位置，offset是所有页面的数据区连在一起之后的偏移
+ */
+struct UndoPtr
+{
+  int64_t offset = 0;
+  int32_t len = 0;
+};
+
+/**
+ * 一张表的undo记录，顺序追加到缓冲池管理的页面中，一条记录可以跨越多个页面。
+ * 页面和数据文件的页面一样可以被淘汰到磁盘上，事务修改的记录数不受内存大小的限制。
+ * 文件只在一次运行中有效，打开时重新创建，关闭时删除，页面也不写redo日志，崩溃恢复使用redo日志中的undo记录。
+ * 表中没有旧版本时调用reset，之后从头开始复用已经分配的页面
+ */
+class UndoFile
+{
+public:
+  UndoFile() = default;
+  ~UndoFile();
+
+  RC open(DiskBufferPool *buffer_pool, const std::string &file_name);
+  void close();
+
+  RC append(const char *data, int len, UndoPtr *ptr);
+  RC read(const UndoPtr &ptr, std::vector<char> &data);
+  void reset();
+
+  /**
+   * 正在使用的字节数
+   */
+  int64_t used_size();
+
+private:
+  /**
+   * 第index个数据区对应的页面，还没有分配的页面这时分配出来
+   */
+  RC page_at(size_t index, PageNum *page_num);
+  RC copy(int64_t offset, char *data, int len, bool write);
+
+private:
+  DiskBufferPool *buffer_pool_ = nullptr;
+  int file_id_ = -1;
+  std::string file_name_;
+
+  std::mutex mutex_;
+  std::vector<PageNum> pages_;  // 按分配的顺序排列的页面
+  int64_t used_ = 0;
+};
+
+#endif  // __OBSERVER_STORAGE_COMMON_UNDO_FILE_H_
@@ -0,0 +1,460 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Per-page min/max summaries of record files.
+//
+
+#include "storage/common/zone_map.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <float.h>
+
+#include "common/log/log.h"
+#include "storage/common/condition_filter.h"
+#include "storage/common/partition_meta.h"
+#include "storage/common/table_meta.h"
+
+// DefaultConditionFilter认为差值在1e-6以内的浮点数相等，再留一些余量避免舍入误差
+static const double ZONE_MAP_FLOAT_EPSILON = 2e-6;
+
+class ZoneMapLockGuard {
+public:
+  ZoneMapLockGuard(pthread_rwlock_t &lock, bool exclusive) : lock_(lock)
+  {
+    if (exclusive) {
+      pthread_rwlock_wrlock(&lock_);
+    } else {
+      pthread_rwlock_rdlock(&lock_);
+    }
+  }
+  ~ZoneMapLockGuard()
+  {
+    pthread_rwlock_unlock(&lock_);
+  }
+
+private:
+  pthread_rwlock_t &lock_;
+};
+
+static RC write_fully(int fd, const void *data, size_t size)
+{
+  const char *p = (const char *)data;
+  while (size > 0) {
+    ssize_t n = ::write(fd, p, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return RC::IOERR_WRITE;
+    }
+    p += n;
+    size -= n;
+  }
+  return RC::SUCCESS;
+}
+
+static RC read_fully(int fd, void *data, size_t size)
+{
+  char *p = (char *)data;
+  while (size > 0) {
+    ssize_t n = ::read(fd, p, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return RC::IOERR_READ;
+    }
+    if (n == 0) {
+      return RC::IOERR_SHORT_READ;
+    }
+    p += n;
+    size -= n;
+  }
+  return RC::SUCCESS;
+}
+
+ZoneMap::ZoneMap() : clean_on_disk_(false)
+{
+  pthread_rwlock_init(&lock_, nullptr);
+}
+
+ZoneMap::~ZoneMap()
+{
+  pthread_rwlock_destroy(&lock_);
+}
+
+void ZoneMap::init(const TableMeta &table_meta, const std::string &file)
+{
+  file_ = file;
+  columns_.clear();
+  ranges_.clear();
+  bloom_offset_ = -1;
+  bloom_filters_.clear();
+
+  for (int i = table_meta.sys_field_num(); i < table_meta.field_num(); i++) {
+    const FieldMeta *field = table_meta.field(i);
+    if (field->type() != INTS && field->type() != FLOATS && field->type() != DATES) {
+      continue;
+    }
+    columns_.push_back({field->offset(), table_meta.null_flag(i), field->type()});
+  }
+
+  const FieldMeta *bloom_field = table_meta.bloom_filter_field();
+  if (bloom_field != nullptr) {
+    bloom_field_ = *bloom_field;
+    bloom_offset_ = bloom_field->offset();
+    bloom_null_flag_ = table_meta.null_flag(table_meta.find_field_index_by_name(bloom_field->name()));
+  }
+}
+
+RC ZoneMap::load()
+{
+  int fd = ::open(file_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG_INFO("Zone map file %s can not be opened: %s", file_.c_str(), strerror(errno));
+    return errno == ENOENT ? RC::NOTFOUND : RC::IOERR_ACCESS;
+  }
+
+  ZoneMapFileHeader header;
+  RC rc = read_fully(fd, &header, sizeof(header));
+  if (rc == RC::SUCCESS && (header.magic != ZONE_MAP_MAGIC || header.column_num != (int)columns_.size() ||
+                            header.page_num < 0 || header.bloom_offset != bloom_offset_ || header.extent_num < 0)) {
+    LOG_WARN("Invalid zone map file %s. magic=%x, column num=%d, page num=%d, bloom offset=%d, extent num=%d",
+             file_.c_str(), header.magic, header.column_num, header.page_num, header.bloom_offset,
+             header.extent_num);
+    rc = RC::CORRUPT;
+  }
+  if (rc == RC::SUCCESS && !header.clean) {
+    LOG_INFO("Zone map file %s was not saved completely", file_.c_str());
+    rc = RC::CORRUPT;
+  }
+
+  std::vector<int> offsets(columns_.size());
+  if (rc == RC::SUCCESS) {
+    rc = read_fully(fd, offsets.data(), offsets.size() * sizeof(int));
+  }
+  for (size_t i = 0; rc == RC::SUCCESS && i < columns_.size(); i++) {
+    if (offsets[i] != columns_[i].offset) {
+      LOG_WARN("Zone map file %s does not match the table. column %d offset=%d, expect %d",
+               file_.c_str(), (int)i, offsets[i], columns_[i].offset);
+      rc = RC::CORRUPT;
+    }
+  }
+
+  std::vector<Range> ranges;
+  if (rc == RC::SUCCESS) {
+    ranges.resize((size_t)header.page_num * columns_.size());
+    rc = read_fully(fd, ranges.data(), ranges.size() * sizeof(Range));
+  }
+  std::vector<BloomFilter> bloom_filters;
+  if (rc == RC::SUCCESS) {
+    bloom_filters.resize(header.extent_num, BloomFilter(ZONE_MAP_BLOOM_FILTER_BITS));
+  }
+  for (size_t i = 0; rc == RC::SUCCESS && i < bloom_filters.size(); i++) {
+    std::vector<uint64_t> &words = bloom_filters[i].words();
+    rc = read_fully(fd, words.data(), words.size() * sizeof(uint64_t));
+  }
+  ::close(fd);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  ZoneMapLockGuard guard(lock_, true);
+  ranges_.swap(ranges);
+  bloom_filters_.swap(bloom_filters);
+  clean_on_disk_ = true;
+  LOG_INFO("Load zone map from %s. pages=%d, columns=%d, extents=%d",
+           file_.c_str(), header.page_num, header.column_num, header.extent_num);
+  return RC::SUCCESS;
+}
+
+RC ZoneMap::save()
+{
+  if (!enabled()) {
+    return RC::SUCCESS;
+  }
+
+  ZoneMapLockGuard guard(lock_, true);
+
+  // 先写到临时文件再改名，写到一半时原来的文件仍然有效
+  std::string tmp_file = file_ + ".tmp";
+  int fd = ::open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IREAD | S_IWRITE);
+  if (fd < 0) {
+    LOG_ERROR("Failed to create zone map file %s: %s", tmp_file.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+
+  ZoneMapFileHeader header;
+  header.magic = ZONE_MAP_MAGIC;
+  header.clean = 1;
+  header.column_num = (int)columns_.size();
+  header.page_num = columns_.empty() ? 0 : (int)(ranges_.size() / columns_.size());
+  header.bloom_offset = bloom_offset_;
+  header.extent_num = (int)bloom_filters_.size();
+  std::vector<int> offsets;
+  for (const Column &column : columns_) {
+    offsets.push_back(column.offset);
+  }
+
+  RC rc = write_fully(fd, &header, sizeof(header));
+  if (rc == RC::SUCCESS) {
+    rc = write_fully(fd, offsets.data(), offsets.size() * sizeof(int));
+  }
+  if (rc == RC::SUCCESS) {
+    rc = write_fully(fd, ranges_.data(), ranges_.size() * sizeof(Range));
+  }
+  for (size_t i = 0; rc == RC::SUCCESS && i < bloom_filters_.size(); i++) {
+    const std::vector<uint64_t> &words = bloom_filters_[i].words();
+    rc = write_fully(fd, words.data(), words.size() * sizeof(uint64_t));
+  }
+  if (rc == RC::SUCCESS && ::fsync(fd) != 0) {
+    rc = RC::IOERR_FSYNC;
+  }
+  ::close(fd);
+  if (rc == RC::SUCCESS && ::rename(tmp_file.c_str(), file_.c_str()) != 0) {
+    rc = RC::IOERR_WRITE;
+  }
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to save zone map file %s. rc=%d:%s, error=%s", file_.c_str(), rc, strrc(rc), strerror(errno));
+    ::unlink(tmp_file.c_str());
+    return rc;
+  }
+  clean_on_disk_ = true;
+  return RC::SUCCESS;
+}
+
+void ZoneMap::clear()
+{
+  ZoneMapLockGuard guard(lock_, true);
+  ranges_.clear();
+  bloom_filters_.clear();
+  if (::unlink(file_.c_str()) != 0 && errno != ENOENT) {
+    LOG_WARN("Failed to remove zone map file %s: %s", file_.c_str(), strerror(errno));
+  }
+  clean_on_disk_ = false;
+}
+
+RC ZoneMap::mark_dirty()
+{
+  if (!clean_on_disk_) {
+    return RC::SUCCESS;
+  }
+
+  ZoneMapLockGuard guard(lock_, true);
+  if (!clean_on_disk_) {
+    return RC::SUCCESS;
+  }
+  int fd = ::open(file_.c_str(), O_WRONLY);
+  if (fd < 0) {
+    LOG_ERROR("Failed to open zone map file %s: %s", file_.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  int clean = 0;
+  RC rc = RC::SUCCESS;
+  if (::pwrite(fd, &clean, sizeof(clean), offsetof(ZoneMapFileHeader, clean)) != (ssize_t)sizeof(clean)) {
+    rc = RC::IOERR_WRITE;
+  } else if (::fdatasync(fd) != 0) {
+    rc = RC::IOERR_FSYNC;
+  }
+  ::close(fd);
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to mark zone map file %s dirty. rc=%d:%s", file_.c_str(), rc, strrc(rc));
+    return rc;
+  }
+  clean_on_disk_ = false;
+  return RC::SUCCESS;
+}
+
+void ZoneMap::update(PageNum page_num, const char *data)
+{
+  if (!enabled()) {
+    return;
+  }
+
+  ZoneMapLockGuard guard(lock_, true);
+  if (bloom_enabled() && !bloom_null_flag_.test(data)) {
+    const size_t extent = page_num / ZONE_MAP_EXTENT_PAGES;
+    if (bloom_filters_.size() <= extent) {
+      bloom_filters_.resize(extent + 1, BloomFilter(ZONE_MAP_BLOOM_FILTER_BITS));
+    }
+    bloom_filters_[extent].add(PartitionMeta::hash(bloom_field_, data + bloom_offset_));
+  }
+
+  const size_t column_num = columns_.size();
+  if (column_num == 0) {
+    return;
+  }
+  if (ranges_.size() < (size_t)(page_num + 1) * column_num) {
+    ranges_.resize((size_t)(page_num + 1) * column_num, Range{DBL_MAX, -DBL_MAX});
+  }
+  Range *ranges = &ranges_[(size_t)page_num * column_num];
+  for (size_t i = 0; i < column_num; i++) {
+    const Column &column = columns_[i];
+    if (column.null_flag.test(data)) {
+      continue;
+    }
+    double value = 0;
+    if (column.type == FLOATS) {
+      float f;
+      memcpy(&f, data + column.offset, sizeof(f));
+      value = f;
+    } else {
+      int v;
+      memcpy(&v, data + column.offset, sizeof(v));
+      value = v;
+    }
+    if (value < ranges[i].min) {
+      ranges[i].min = value;
+    }
+    if (value > ranges[i].max) {
+      ranges[i].max = value;
+    }
+  }
+}
+
+void ZoneMap::reset_page(PageNum page_num)
+{
+  ZoneMapLockGuard guard(lock_, true);
+  const size_t column_num = columns_.size();
+  if (ranges_.size() < (size_t)(page_num + 1) * column_num) {
+    return;
+  }
+  for (size_t i = 0; i < column_num; i++) {
+    ranges_[(size_t)page_num * column_num + i] = Range{DBL_MAX, -DBL_MAX};
+  }
+}
+
+void ZoneMap::reset_extent_bloom_filter(int extent)
+{
+  ZoneMapLockGuard guard(lock_, true);
+  if (extent < (int)bloom_filters_.size()) {
+    bloom_filters_[extent].clear();
+  }
+}
+
+int ZoneMap::find_column(int offset) const
+{
+  for (size_t i = 0; i < columns_.size(); i++) {
+    if (columns_[i].offset == offset) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+bool ZoneMap::may_match(PageNum page_num, const ConditionFilter *filter) const
+{
+  if (filter == nullptr || !enabled()) {
+    return true;
+  }
+
+  ZoneMapLockGuard guard(lock_, false);
+  // 没有记录过的页面不知道范围，没有记录过的区段没有布隆过滤器
+  const size_t column_num = columns_.size();
+  const Range *ranges = nullptr;
+  if (column_num > 0 && ranges_.size() >= (size_t)(page_num + 1) * column_num) {
+    ranges = &ranges_[(size_t)page_num * column_num];
+  }
+  const BloomFilter *bloom_filter = nullptr;
+  const size_t extent = page_num / ZONE_MAP_EXTENT_PAGES;
+  if (extent < bloom_filters_.size()) {
+    bloom_filter = &bloom_filters_[extent];
+  }
+  if (ranges == nullptr && bloom_filter == nullptr) {
+    return true;
+  }
+  return may_match(ranges, bloom_filter, filter);
+}
+
+bool ZoneMap::may_match(const Range *ranges, const BloomFilter *bloom_filter, const ConditionFilter *filter) const
+{
+  const CompositeConditionFilter *composite_filter = dynamic_cast<const CompositeConditionFilter *>(filter);
+  if (composite_filter != nullptr) {
+    for (int i = 0; i < composite_filter->filter_num(); i++) {
+      if (!may_match(ranges, bloom_filter, &composite_filter->filter(i))) {
+        return false;
+      }
+    }
+    return true;
+  }
+  const DefaultConditionFilter *default_filter = dynamic_cast<const DefaultConditionFilter *>(filter);
+  if (default_filter == nullptr) {
+    return true;
+  }
+  return may_match(ranges, bloom_filter, *default_filter);
+}
+
+bool ZoneMap::may_match(const Range *ranges, const BloomFilter *bloom_filter,
+                        const DefaultConditionFilter &filter) const
+{
+  // 只处理字段和值的比较，值在左边时交换比较符号
+  const ConDesc &left = filter.left();
+  const ConDesc &right = filter.right();
+  if (left.is_attr == right.is_attr) {
+    return true;
+  }
+  const ConDesc &attr = left.is_attr ? left : right;
+  const ConDesc &value = left.is_attr ? right : left;
+  AttrType value_type = left.is_attr ? filter.another_attr_type() : filter.attr_type();
+  CompOp comp_op = filter.comp_op();
+  if (!left.is_attr) {
+    switch (comp_op) {
+      case LESS_EQUAL: comp_op = GREAT_EQUAL; break;
+      case LESS_THAN: comp_op = GREAT_THAN; break;
+      case GREAT_EQUAL: comp_op = LESS_EQUAL; break;
+      case GREAT_THAN: comp_op = LESS_THAN; break;
+      default: break;
+    }
+  }
+
+  // 浮点数相等时允许误差，不能用布隆过滤器判断
+  if (bloom_filter != nullptr && comp_op == EQUAL_TO && attr.attr_offset == bloom_offset_ &&
+      value.value != nullptr && value_type == bloom_field_.type() && value_type != FLOATS &&
+      !bloom_filter->may_contain(PartitionMeta::hash(bloom_field_, (const char *)value.value))) {
+    return false;
+  }
+
+  int column_index = find_column(attr.attr_offset);
+  if (ranges == nullptr || column_index < 0 || value.value == nullptr || value_type != columns_[column_index].type) {
+    return true;
+  }
+
+  const Column &column = columns_[column_index];
+  double v = 0;
+  double epsilon = 0;
+  if (column.type == FLOATS) {
+    float f;
+    memcpy(&f, value.value, sizeof(f));
+    v = f;
+    epsilon = ZONE_MAP_FLOAT_EPSILON;
+  } else {
+    int i;
+    memcpy(&i, value.value, sizeof(i));
+    v = i;
+  }
+
+  // null值和任何值比较都不成立，页面上没有非null的值时比较都不会成立
+  const Range &range = ranges[column_index];
+  const bool empty = range.min > range.max;
+  switch (comp_op) {
+    case EQUAL_TO: return !empty && v >= range.min - epsilon && v <= range.max + epsilon;
+    case NOT_EQUAL: return !empty && !(range.min == range.max && range.min == v);
+    case LESS_THAN: return !empty && range.min < v;
+    case LESS_EQUAL: return !empty && range.min <= v + epsilon;
+    case GREAT_THAN: return !empty && range.max > v;
+    case GREAT_EQUAL: return !empty && range.max >= v - epsilon;
+    default: return true;
+  }
+}
@@ -0,0 +1,139 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Per-page min/max summaries of record files.
+//
+
+#ifndef __OBSERVER_STORAGE_COMMON_ZONE_MAP_H_
+#define __OBSERVER_STORAGE_COMMON_ZONE_MAP_H_
+
+#include <pthread.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "rc.h"
+#include "sql/parser/parse_defs.h"
+#include "storage/common/bloom_filter.h"
+#include "storage/common/field_meta.h"
+#include "storage/default/disk_buffer_pool.h"
+
+class TableMeta;
+class ConditionFilter;
+class DefaultConditionFilter;
+
+#define ZONE_MAP_MAGIC 0x324E4F5A  // "ZON2"，加上布隆过滤器之后的格式，以前的文件在打开表时重建
+#define ZONE_MAP_EXTENT_PAGES 8         // 连续的这么多个页面组成一个区段，每个区段一个布隆过滤器
+#define ZONE_MAP_BLOOM_FILTER_BITS 32768  // 每个区段的布隆过滤器的位数
+
+/**
+ * zone map文件的头部，之后是每个字段在记录中的偏移，再之后是每个页面每个字段的范围，
+ * 最后是每个区段的布隆过滤器
+ */
+struct ZoneMapFileHeader {
+  int magic;
+  int clean;       // 1表示文件中的范围包含了记录文件中所有的数据，0表示需要扫描记录文件重建
+  int column_num;
+  int page_num;    // 文件中保存了多少个页面的范围
+  int bloom_offset;  // 建布隆过滤器的字段在记录中的偏移，-1表示没有布隆过滤器
+  int extent_num;    // 文件中保存了多少个区段的布隆过滤器
+};
+
+/**
+ * 记录文件每个页面上INTS、FLOATS、DATES字段的最小值和最大值，扫描时跳过不可能满足过滤条件的页面。
+ * 范围只会扩大，删除记录时不缩小，所以总是包含页面上所有非null的值。
+ * 建表时指定了bloom_filter字段时，每个区段还有这个字段的值的布隆过滤器，
+ * 等值条件的值不在布隆过滤器中时跳过整个区段。布隆过滤器也只加入不删除，页面整理之后由调用者重建。
+ * 文件只在sync和关闭表时完整地写出，在这之后第一次修改记录之前先把文件标记为不完整，
+ * 这样异常退出之后打开表时会扫描记录文件重建
+ */
+class ZoneMap {
+public:
+  ZoneMap();
+  ~ZoneMap();
+
+  /**
+   * file是保存zone map的文件，没有需要跟踪的字段并且没有布隆过滤器时不维护zone map
+   */
+  void init(const TableMeta &table_meta, const std::string &file);
+  bool enabled() const
+  {
+    return !columns_.empty() || bloom_enabled();
+  }
+  bool bloom_enabled() const
+  {
+    return bloom_offset_ >= 0;
+  }
+
+  /**
+   * 从文件加载。文件不存在、和表的字段对不上或者没有完整写出时返回失败，调用者需要清空之后重建
+   */
+  RC load();
+  /**
+   * 把所有页面的范围完整地写到文件中。调用者要保证这期间没有其它线程修改记录
+   */
+  RC save();
+  /**
+   * 清空所有页面的范围并删除文件
+   */
+  void clear();
+
+  /**
+   * 修改记录文件之前调用，文件标记为完整时先改成不完整
+   */
+  RC mark_dirty();
+  /**
+   * 把一条记录的值合并到所在页面的范围中，data是按照table_meta排列的记录
+   */
+  void update(PageNum page_num, const char *data);
+  /**
+   * 页面被释放时清空它的范围。区段的布隆过滤器不变
+   */
+  void reset_page(PageNum page_num);
+  /**
+   * 清空区段的布隆过滤器，调用者之后把区段中现有的记录重新update一遍
+   */
+  void reset_extent_bloom_filter(int extent);
+
+  /**
+   * 页面上是否可能有满足过滤条件的记录。只认识DefaultConditionFilter和CompositeConditionFilter，
+   * 其它的过滤条件总是返回true
+   */
+  bool may_match(PageNum page_num, const ConditionFilter *filter) const;
+
+private:
+  struct Column {
+    int offset;       // 字段在记录中的偏移
+    NullFlag null_flag;
+    AttrType type;
+  };
+  struct Range {
+    double min;
+    double max;  // min > max表示页面上这个字段没有非null的值
+  };
+
+  int find_column(int offset) const;
+  bool may_match(const Range *ranges, const BloomFilter *bloom_filter, const ConditionFilter *filter) const;
+  bool may_match(const Range *ranges, const BloomFilter *bloom_filter, const DefaultConditionFilter &filter) const;
+
+private:
+  std::string file_;
+  std::vector<Column> columns_;
+  std::vector<Range> ranges_;  // 每个页面有columns_.size()个范围
+  int bloom_offset_ = -1;      // 建布隆过滤器的字段在记录中的偏移，-1表示没有
+  NullFlag bloom_null_flag_;
+  FieldMeta bloom_field_;
+  std::vector<BloomFilter> bloom_filters_;  // 每个区段一个
+  std::atomic<bool> clean_on_disk_;
+  mutable pthread_rwlock_t lock_;
+};
+
+#endif  // __OBSERVER_STORAGE_COMMON_ZONE_MAP_H_
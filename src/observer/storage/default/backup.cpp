@@ -0,0 +1,471 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Online backup with copy-on-write snapshots of data files.
+//
+
+#include "storage/default/backup.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include "common/io/io.h"
+#include "common/log/log.h"
+#include "common/os/path.h"
+#include "storage/default/disk_buffer_pool.h"
+#include "storage/default/redo_log.h"
+
+static long long now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static RC write_fully(int fd, const char *data, size_t len)
+{
+  while (len > 0) {
+    ssize_t ret = write(fd, data, len);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return RC::IOERR_WRITE;
+    }
+    data += ret;
+    len -= ret;
+  }
+  return RC::SUCCESS;
+}
+
+/**
+ * 目录不存在或者是空的
+ */
+static bool empty_directory(const std::string &dir)
+{
+  DIR *dirp = opendir(dir.c_str());
+  if (dirp == nullptr) {
+    return errno == ENOENT;
+  }
+  bool empty = true;
+  struct dirent *entry = nullptr;
+  while (empty && (entry = readdir(dirp)) != nullptr) {
+    empty = strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0;
+  }
+  closedir(dirp);
+  return empty;
+}
+
+PageSnapshot &PageSnapshot::instance()
+{
+  static PageSnapshot instance;
+  return instance;
+}
+
+RC PageSnapshot::begin(const std::vector<std::pair<std::string, std::string>> &files)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (active_) {
+    return RC::BUSY;
+  }
+  RC rc = RC::SUCCESS;
+  for (const auto &file_names : files) {
+    std::shared_ptr<File> file = std::make_shared<File>();
+    file->name = file_names.first;
+    file->src_fd = open(file_names.first.c_str(), O_RDONLY);
+    if (file->src_fd < 0) {
+      // 列出文件之后被删除的临时文件
+      LOG_WARN("Skip %s in backup. error=%s", file_names.first.c_str(), strerror(errno));
+      continue;
+    }
+    struct stat st;
+    if (fstat(file->src_fd, &st) != 0) {
+      LOG_ERROR("Failed to stat %s. error=%s", file_names.first.c_str(), strerror(errno));
+      close(file->src_fd);
+      rc = RC::IOERR_FSTAT;
+      break;
+    }
+    file->dst_fd = open(file_names.second.c_str(), O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (file->dst_fd < 0) {
+      LOG_ERROR("Failed to create %s. error=%s", file_names.second.c_str(), strerror(errno));
+      close(file->src_fd);
+      rc = RC::IOERR_ACCESS;
+      break;
+    }
+    posix_fadvise(file->src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    file->size = st.st_size;
+    file->copied.resize((st.st_size + BACKUP_COW_BLOCK_SIZE - 1) / BACKUP_COW_BLOCK_SIZE, false);
+    files_[std::make_pair(st.st_dev, st.st_ino)] = file;
+  }
+  if (rc != RC::SUCCESS) {
+    close_files();
+    return rc;
+  }
+  failed_ = false;
+  cow_blocks_ = 0;
+  active_.store(true, std::memory_order_release);
+  LOG_INFO("Begin copy-on-write snapshot of %d files", (int)files_.size());
+  return RC::SUCCESS;
+}
+
+RC PageSnapshot::copy_blocks(File &file, off_t offset, off_t len, std::vector<char> &buffer)
+{
+  const off_t end = std::min(offset + len, file.size);
+  if (file.dst_fd < 0 || offset >= end) {
+    return RC::SUCCESS;
+  }
+  size_t block = offset / BACKUP_COW_BLOCK_SIZE;
+  const size_t last_block = (end - 1) / BACKUP_COW_BLOCK_SIZE;
+  while (block <= last_block) {
+    if (file.copied[block]) {
+      block++;
+      continue;
+    }
+    // 连续的没有复制过的块一起读写
+    size_t run_end = block + 1;
+    while (run_end <= last_block && !file.copied[run_end]) {
+      run_end++;
+    }
+    const off_t run_offset = (off_t)block * BACKUP_COW_BLOCK_SIZE;
+    const off_t run_len = std::min((off_t)run_end * BACKUP_COW_BLOCK_SIZE, file.size) - run_offset;
+    buffer.resize(run_len);
+    off_t done = 0;
+    while (done < run_len) {
+      ssize_t ret = pread(file.src_fd, buffer.data() + done, run_len - done, run_offset + done);
+      if (ret < 0 && errno == EINTR) {
+        continue;
+      }
+      if (ret < 0) {
+        LOG_ERROR("Failed to read %s at %lld for backup. error=%s", file.name.c_str(), (long long)(run_offset + done),
+                  strerror(errno));
+        return RC::IOERR_READ;
+      }
+      if (ret == 0) {
+        // 文件被截短了，后面的内容按空洞处理
+        memset(buffer.data() + done, 0, run_len - done);
+        break;
+      }
+      done += ret;
+    }
+    done = 0;
+    while (done < run_len) {
+      ssize_t ret = pwrite(file.dst_fd, buffer.data() + done, run_len - done, run_offset + done);
+      if (ret < 0 && errno == EINTR) {
+        continue;
+      }
+      if (ret < 0) {
+        LOG_ERROR("Failed to write backup of %s at %lld. error=%s", file.name.c_str(), (long long)(run_offset + done),
+                  strerror(errno));
+        return RC::IOERR_WRITE;
+      }
+      done += ret;
+    }
+    std::fill(file.copied.begin() + block, file.copied.begin() + run_end, true);
+    block = run_end;
+  }
+  return RC::SUCCESS;
+}
+
+void PageSnapshot::copy_on_write(int fd, off_t offset, off_t len)
+{
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    LOG_ERROR("Failed to stat fd %d for copy-on-write. error=%s", fd, strerror(errno));
+    failed_ = true;
+    return;
+  }
+  std::shared_ptr<File> file;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = files_.find(std::make_pair(st.st_dev, st.st_ino));
+    if (iter == files_.end()) {
+      // 快照开始之后新建的文件
+      return;
+    }
+    file = iter->second;
+  }
+
+  std::lock_guard<std::mutex> lock(file->mutex);
+  if (offset >= file->size) {
+    return;
+  }
+  const size_t first = offset / BACKUP_COW_BLOCK_SIZE;
+  const size_t last = (std::min(offset + len, file->size) - 1) / BACKUP_COW_BLOCK_SIZE;
+  long long blocks = 0;
+  for (size_t i = first; i <= last; i++) {
+    blocks += file->copied[i] ? 0 : 1;
+  }
+  if (blocks == 0) {
+    return;
+  }
+  std::vector<char> buffer;
+  if (copy_blocks(*file, offset, len, buffer) != RC::SUCCESS) {
+    // 不影响写盘，备份失败
+    failed_ = true;
+    return;
+  }
+  cow_blocks_ += blocks;
+}
+
+RC PageSnapshot::copy(const std::string &file_name, long long rate_limit, long long *bytes)
+{
+  std::shared_ptr<File> file;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &iter : files_) {
+      if (iter.second->name == file_name) {
+        file = iter.second;
+        break;
+      }
+    }
+  }
+  if (file == nullptr) {
+    return RC::SUCCESS;
+  }
+
+  std::vector<char> buffer;
+  const long long start_us = now_us();
+  RC rc = RC::SUCCESS;
+  for (off_t offset = 0; offset < file->size && rc == RC::SUCCESS; offset += BACKUP_CHUNK_SIZE) {
+    {
+      // 每次只在复制一段时持有文件锁，期间写这一段的页面需要等待
+      std::lock_guard<std::mutex> lock(file->mutex);
+      rc = copy_blocks(*file, offset, BACKUP_CHUNK_SIZE, buffer);
+      posix_fadvise(file->src_fd, offset, BACKUP_CHUNK_SIZE, POSIX_FADV_DONTNEED);
+    }
+    const long long copied = std::min((long long)offset + BACKUP_CHUNK_SIZE, (long long)file->size);
+    if (rate_limit > 0) {
+      const long long wait_us = copied * 1000000LL / rate_limit - (now_us() - start_us);
+      if (wait_us > 0) {
+        usleep(wait_us);
+      }
+    }
+  }
+  std::lock_guard<std::mutex> lock(file->mutex);
+  if (rc == RC::SUCCESS && fdatasync(file->dst_fd) != 0) {
+    LOG_ERROR("Failed to sync backup of %s. error=%s", file_name.c_str(), strerror(errno));
+    rc = RC::IOERR_FSYNC;
+  }
+  posix_fadvise(file->dst_fd, 0, 0, POSIX_FADV_DONTNEED);
+  *bytes += file->size;
+  return rc;
+}
+
+void PageSnapshot::close_files()
+{
+  for (auto &iter : files_) {
+    File &file = *iter.second;
+    std::lock_guard<std::mutex> lock(file.mutex);
+    close(file.src_fd);
+    close(file.dst_fd);
+    file.src_fd = -1;
+    file.dst_fd = -1;
+  }
+  files_.clear();
+}
+
+RC PageSnapshot::end()
+{
+  active_.store(false, std::memory_order_release);
+  std::lock_guard<std::mutex> lock(mutex_);
+  close_files();
+  LOG_INFO("End copy-on-write snapshot, %lld blocks copied before overwritten", cow_blocks_.load());
+  return failed_ ? RC::IOERR_WRITE : RC::SUCCESS;
+}
+
+BackupManager &BackupManager::instance()
+{
+  static BackupManager instance;
+  return instance;
+}
+
+RC BackupManager::copy_files(const std::string &dir, long long *bytes)
+{
+  std::vector<std::string> dbs;
+  std::vector<std::string> files;
+  if (common::getDirList(dbs, db_dir_, "") < 0 || common::getFileList(files, db_dir_, "", true) < 0) {
+    LOG_ERROR("Failed to list files under %s", db_dir_.c_str());
+    return RC::IOERR_ACCESS;
+  }
+  // 没有表的数据库也要有目录
+  for (const std::string &db : dbs) {
+    std::string db_dir = dir + "/" + db.substr(db_dir_.size());
+    if (!common::check_directory(db_dir)) {
+      LOG_ERROR("Failed to create %s. error=%s", db_dir.c_str(), strerror(errno));
+      return RC::IOERR_ACCESS;
+    }
+  }
+  std::vector<std::pair<std::string, std::string>> file_names;
+  for (const std::string &file : files) {
+    std::string target = dir + "/" + file.substr(db_dir_.size());
+    std::string parent = target.substr(0, target.rfind('/'));
+    if (!common::check_directory(parent)) {
+      LOG_ERROR("Failed to create %s. error=%s", parent.c_str(), strerror(errno));
+      return RC::IOERR_ACCESS;
+    }
+    file_names.emplace_back(file, target);
+  }
+
+  PageSnapshot &snapshot = PageSnapshot::instance();
+  RC rc = snapshot.begin(file_names);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  for (size_t i = 0; i < file_names.size() && rc == RC::SUCCESS; i++) {
+    rc = snapshot.copy(file_names[i].first, rate_limit_, bytes);
+  }
+  RC end_rc = snapshot.end();
+  return rc != RC::SUCCESS ? rc : end_rc;
+}
+
+void BackupManager::CapturedLog::append(const char *data, size_t len)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  bytes += len;
+  size_t offset = 0;
+  RedoRecordHeader header;
+  while (RedoLog::decode_record(data + offset, len - offset, header)) {
+    const char *record = data + offset;
+    const size_t record_len = sizeof(header) + header.name_len + header.data_len;
+    offset += record_len;
+
+    if (header.type != REDO_PAGE_IMAGE && header.type != REDO_FILE_CREATE) {
+      // 提交记录和修改之前的内容不依赖文件的位置，原样留给打开备份时的恢复
+      trx_log.append(record, record_len);
+      continue;
+    }
+    // 和恢复一样，重新创建的文件之前的页面都作废
+    std::string file_name(record + sizeof(header), header.name_len);
+    if (header.type == REDO_FILE_CREATE) {
+      images.erase(file_name);
+    } else if ((int)header.data_len == header.page_size) {
+      FilePages &file_pages = images[file_name];
+      if (file_pages.page_size != header.page_size) {
+        file_pages.pages.clear();
+        file_pages.page_size = header.page_size;
+      }
+      file_pages.pages[header.page_num].assign(record + sizeof(header) + header.name_len, header.data_len);
+    }
+  }
+  if (offset != len) {
+    LOG_ERROR("Redo log captured during backup is broken at %lu of %lu bytes", offset, len);
+    broken = true;
+  }
+}
+
+RC BackupManager::apply_log(const std::string &dir, CapturedLog &log)
+{
+  // 写备份文件时不持有锁，移除之前取出了shipper的落盘线程不会被阻塞
+  std::map<std::string, CapturedLog::FilePages> images;
+  std::string trx_log;
+  long long bytes = 0;
+  {
+    std::lock_guard<std::mutex> lock(log.mutex);
+    if (log.broken) {
+      return RC::IOERR_READ;
+    }
+    images.swap(log.images);
+    trx_log.swap(log.trx_log);
+    bytes = log.bytes;
+  }
+  int files = 0;
+  for (const auto &file : images) {
+    if (file.first.compare(0, db_dir_.size(), db_dir_) != 0) {
+      continue;
+    }
+    std::string file_name = dir + "/db/" + file.first.substr(db_dir_.size());
+    RC rc = DiskBufferPool::restore_pages(file_name.c_str(), file.second.page_size, file.second.pages);
+    if (rc != RC::SUCCESS) {
+      LOG_ERROR("Failed to apply redo log to backup %s. rc=%d:%s", file_name.c_str(), rc, strrc(rc));
+      return rc;
+    }
+    files++;
+  }
+  const std::string log_file = dir + "/redo/" + BACKUP_REDO_LOG_FILE;
+  int fd = open(log_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    LOG_ERROR("Failed to create %s. error=%s", log_file.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  RC rc = write_fully(fd, trx_log.data(), trx_log.size());
+  if (rc == RC::SUCCESS && fsync(fd) != 0) {
+    rc = RC::IOERR_FSYNC;
+  }
+  close(fd);
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to write %s. error=%s", log_file.c_str(), strerror(errno));
+    return rc;
+  }
+  LOG_INFO("Apply %lld bytes of redo log to %d files of backup, keep %lu bytes of transaction records",
+           bytes, files, trx_log.size());
+  return RC::SUCCESS;
+}
+
+RC BackupManager::backup(const char *dir)
+{
+  std::unique_lock<std::mutex> running(backup_mutex_, std::try_to_lock);
+  if (!running.owns_lock()) {
+    LOG_WARN("Another backup is running");
+    return RC::BUSY;
+  }
+  RedoLog &redo_log = RedoLog::instance();
+  if (!redo_log.enabled()) {
+    LOG_ERROR("Online backup needs redo log");
+    return RC::MISUSE;
+  }
+  std::string target(dir);
+  while (target.size() > 1 && target.back() == '/') {
+    target.pop_back();
+  }
+  if (target.empty() || !empty_directory(target)) {
+    LOG_ERROR("Backup dir %s is not empty", dir);
+    return RC::INVALID_ARGUMENT;
+  }
+  std::string db_target = target + "/db";
+  std::string redo_target = target + "/redo";
+  if (!common::check_directory(db_target) || !common::check_directory(redo_target)) {
+    LOG_ERROR("Failed to create backup dir %s. error=%s", dir, strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+
+  const long long start_us = now_us();
+  // 移除之前已经取出shipper的落盘线程还可能调用它，截取的日志随着shipper一起释放
+  std::shared_ptr<CapturedLog> captured = std::make_shared<CapturedLog>();
+  int shipper = redo_log.add_shipper([captured](const char *data, size_t len, uint64_t) {
+    captured->append(data, len);
+  });
+  long long bytes = 0;
+  RC rc = RC::SUCCESS;
+  {
+    std::unique_lock<std::shared_mutex> ddl_guard(ddl_mutex_);
+    rc = redo_log.checkpoint();
+    if (rc == RC::SUCCESS) {
+      rc = copy_files(db_target, &bytes);
+    }
+    if (rc == RC::SUCCESS) {
+      rc = redo_log.flush(redo_log.current_lsn());
+    }
+  }
+  redo_log.remove_shipper(shipper);
+  if (rc == RC::SUCCESS) {
+    rc = apply_log(target, *captured);
+  }
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to backup to %s. rc=%d:%s", dir, rc, strrc(rc));
+    return rc;
+  }
+  LOG_INFO("Backup %lld bytes to %s in %lld ms", bytes, dir, (now_us() - start_us) / 1000);
+  return RC::SUCCESS;
+}
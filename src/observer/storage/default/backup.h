@@ -0,0 +1,171 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Online backup with copy-on-write snapshots of data files.
+//
+
+#ifndef __OBSERVER_STORAGE_DEFAULT_BACKUP_H_
+#define __OBSERVER_STORAGE_DEFAULT_BACKUP_H_
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rc.h"
+
+#define BACKUP_COW_BLOCK_SIZE (1 << 12)            // 写时复制的粒度，页面写出之前复制它覆盖的所有块
+#define BACKUP_CHUNK_SIZE (4 << 20)                // 复制文件时每次顺序读取的大小
+#define BACKUP_DEFAULT_RATE_LIMIT (64LL << 20)     // 每秒最多复制的字节数，0表示不限制
+#define BACKUP_REDO_LOG_FILE "redo.1"              // 备份的redo目录中的日志文件，只有提交记录和修改之前的内容
+
+/**
+ * 数据文件的写时复制快照。begin之后，文件中原有的内容第一次被覆盖或者截掉之前，
+ * 先把磁盘上原来的内容复制到备份文件的相同位置，copy只复制还没有复制过的块，
+ * 所以备份文件得到的是begin时刻磁盘上的内容，不会读到写了一半的页面。
+ * 文件按inode识别，缓冲池写盘时不需要知道文件名，也不受fd缓存重新打开文件的影响
+ */
+class PageSnapshot {
+public:
+  static PageSnapshot &instance();
+
+  /**
+   * 开始快照，files是(源文件, 备份文件)。备份文件需要还不存在
+   */
+  RC begin(const std::vector<std::pair<std::string, std::string>> &files);
+  /**
+   * 用大块的顺序读复制一个文件中还没有复制的部分，每秒最多复制rate_limit字节，0表示不限制。
+   * 读取不经过缓冲池，读过的部分从操作系统的缓存中丢弃。bytes加上文件的大小
+   */
+  RC copy(const std::string &file_name, long long rate_limit, long long *bytes);
+  /**
+   * 结束快照，关闭所有的文件。复制过程中有写时复制失败过时返回错误
+   */
+  RC end();
+
+  /**
+   * 缓冲池向fd的[offset, offset + len)写数据或者截掉这部分之前调用
+   */
+  void before_write(int fd, off_t offset, off_t len)
+  {
+    if (active_.load(std::memory_order_acquire)) {
+      copy_on_write(fd, offset, len);
+    }
+  }
+
+  /**
+   * 写时复制的块数，测试使用
+   */
+  long long cow_blocks() const
+  {
+    return cow_blocks_;
+  }
+
+private:
+  PageSnapshot() = default;
+
+  struct File {
+    std::mutex mutex;             // 复制和写时复制互斥，保护下面的成员
+    std::string name;
+    int src_fd = -1;
+    int dst_fd = -1;
+    off_t size = 0;               // begin时文件的大小，之后扩展的部分不需要复制
+    std::vector<bool> copied;     // 每个块是否已经复制了
+  };
+
+  void copy_on_write(int fd, off_t offset, off_t len);
+  /**
+   * 把[offset, offset + len)中还没有复制的块复制到备份文件中，调用时需要持有file.mutex
+   */
+  RC copy_blocks(File &file, off_t offset, off_t len, std::vector<char> &buffer);
+  void close_files();
+
+private:
+  std::atomic<bool> active_{false};
+  std::atomic<bool> failed_{false};
+  std::atomic<long long> cow_blocks_{0};
+  std::mutex mutex_;  // 保护files_，只在begin和end时修改
+  std::map<std::pair<dev_t, ino_t>, std::shared_ptr<File>> files_;
+};
+
+/**
+ * 在线备份，执行 backup to 'dir'。需要打开redo日志：
+ * 1. 先截取之后落盘的redo日志，再做一次checkpoint，这之后每个页面最新的内容要么在数据文件中，要么在截取的日志中；
+ * 2. 对数据库目录中的所有文件开始写时复制快照，限速复制到dir/db中；
+ * 3. 让日志落盘到当前位置之后停止截取，截取的日志中每个页面最后的内容写到备份的数据文件中，
+ *    提交记录和修改之前的内容写到dir/redo中。
+ * 备份目录可以直接作为BaseDir打开，打开redo日志时据此处理记录上遗留的事务字段，
+ * 得到的是第3步时已经提交的数据。
+ * 备份期间建表、删表等修改文件的语句需要等待，增删改查照常执行
+ */
+class BackupManager {
+public:
+  static BackupManager &instance();
+
+  void init(const std::string &db_dir, long long rate_limit = BACKUP_DEFAULT_RATE_LIMIT)
+  {
+    db_dir_ = db_dir;
+    rate_limit_ = rate_limit;
+  }
+  /**
+   * 备份到dir，dir需要不存在或者是空的目录。同时只能有一个备份
+   */
+  RC backup(const char *dir);
+
+  /**
+   * 修改文件的语句执行时共享持有，备份复制文件时独占持有
+   */
+  std::shared_mutex &ddl_mutex()
+  {
+    return ddl_mutex_;
+  }
+
+private:
+  BackupManager() = default;
+
+  /**
+   * 备份期间截取的redo日志。落盘时就合并，每个页面只保留最后的内容，占用的内存不随日志的长度增长
+   */
+  struct CapturedLog {
+    struct FilePages {
+      int page_size = 0;
+      std::map<int, std::string> pages;
+    };
+
+    std::mutex mutex;  // 保护下面的成员
+    std::map<std::string, FilePages> images;  // 源文件名 -> 页面最后的内容
+    std::string trx_log;                      // 提交记录、修改之前的内容和checkpoint记录
+    long long bytes = 0;
+    bool broken = false;
+
+    void append(const char *data, size_t len);
+  };
+
+  RC copy_files(const std::string &dir, long long *bytes);
+  /**
+   * 把截取的日志应用到备份中
+   */
+  RC apply_log(const std::string &dir, CapturedLog &log);
+
+private:
+  std::string db_dir_;
+  long long rate_limit_ = BACKUP_DEFAULT_RATE_LIMIT;
+  std::mutex backup_mutex_;  // 同时只做一个备份
+  std::shared_mutex ddl_mutex_;
+};
+
+#endif  // __OBSERVER_STORAGE_DEFAULT_BACKUP_H_
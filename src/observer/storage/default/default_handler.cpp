@@ -23,6 +23,7 @@ See the Mulan PSL v2 for more details. */
 #include "storage/common/bplus_tree.h"
 #include "storage/common/table.h"
 #include "storage/common/condition_filter.h"
+#include "storage/default/redo_log.h"
 
 DefaultHandler &DefaultHandler::get_default()
 {
@@ -60,6 +61,8 @@ RC DefaultHandler::init(const char *base_dir)
 void DefaultHandler::destroy()
 {
   sync();
+  // 脏页都已经写出，checkpoint之后就不需要日志了
+  RedoLog::instance().close();
 
   for (const auto &iter : opened_dbs_)
   {
@@ -137,14 +140,18 @@ RC DefaultHandler::execute(const char *sql)
   return RC::GENERIC_ERROR;
 }
 
-RC DefaultHandler::create_table(const char *dbname, const char *relation_name, int attribute_count, const AttrInfo *attributes)
+RC DefaultHandler::create_table(const char *dbname, const char *relation_name, int attribute_count, const AttrInfo *attributes,
+                                int page_size, const char *compression, const char *format, const char *engine,
+                                const PartitionDef *partition, const char *bloom_filter, int primary_key_num,
+                                const char *const primary_keys[])
 {
   Db *db = find_db(dbname);
   if (db == nullptr)
   {
     return RC::SCHEMA_DB_NOT_OPENED;
   }
-  return db->create_table(relation_name, attribute_count, attributes);
+  return db->create_table(relation_name, attribute_count, attributes, page_size, compression, format, engine,
+                          partition, bloom_filter, primary_key_num, primary_keys);
 }
 
 RC DefaultHandler::drop_table(const char *dbname, const char *relation_name) {
@@ -155,7 +162,33 @@ RC DefaultHandler::drop_table(const char *dbname, const char *relation_name) {
   return db->drop_table(relation_name);
 }
 
-RC DefaultHandler::create_index(Trx *trx, const char *dbname, const char *relation_name, const char *index_name, const char *attribute_name)
+RC DefaultHandler::create_materialized_view(const char *dbname, const char *view_name, const Selects &selects) {
+  Db *db = find_db(dbname);
+  if (db == nullptr) {
+    return RC::SCHEMA_DB_NOT_OPENED;
+  }
+  return db->create_materialized_view(view_name, selects);
+}
+
+RC DefaultHandler::truncate_table(const char *dbname, const char *relation_name) {
+  Db *db = find_db(dbname);
+  if (db == nullptr) {
+    return RC::SCHEMA_DB_NOT_OPENED;
+  }
+  return db->truncate_table(relation_name);
+}
+
+RC DefaultHandler::analyze_table(const char *dbname, const char *relation_name) {
+  Db *db = find_db(dbname);
+  if (db == nullptr) {
+    return RC::SCHEMA_DB_NOT_OPENED;
+  }
+  return db->analyze_table(relation_name);
+}
+
+RC DefaultHandler::create_index(Trx *trx, const char *dbname, const char *relation_name, const char *index_name,
+                                int attribute_num, const char *const attribute_names[], bool unique,
+                                const int prefix_lengths[], IndexType index_type)
 {
   
   Table *table = find_table(dbname, relation_name);
@@ -163,7 +196,7 @@ RC DefaultHandler::create_index(Trx *trx, const char *dbname, const char *relati
   {
     return RC::SCHEMA_TABLE_NOT_EXIST;
   }
-  return table->create_index(trx, index_name, attribute_name);
+  return table->create_index(trx, index_name, attribute_num, attribute_names, unique, prefix_lengths, index_type);
 }
 
 RC DefaultHandler::drop_index(Trx *trx, const char *dbname, const char *relation_name, const char *index_name)
@@ -179,9 +212,31 @@ RC DefaultHandler::insert_record(Trx *trx, const char *dbname, const char *relat
   {
     return RC::SCHEMA_TABLE_NOT_EXIST;
   }
+  if (table->materialized_view() != nullptr)
+  {
+    LOG_WARN("Materialized view %s can only be modified by its base table", relation_name);
+    return RC::READONLY;
+  }
 
   return table->insert_record(trx, value_num, values, record);
 }
+RC DefaultHandler::insert_records(Trx *trx, const char *dbname, const char *relation_name, int row_num,
+                                  const int *value_nums, const Value *const *values)
+{
+  Table *table = find_table(dbname, relation_name);
+  if (nullptr == table)
+  {
+    return RC::SCHEMA_TABLE_NOT_EXIST;
+  }
+  if (table->materialized_view() != nullptr)
+  {
+    LOG_WARN("Materialized view %s can only be modified by its base table", relation_name);
+    return RC::READONLY;
+  }
+
+  return table->insert_records(trx, row_num, value_nums, values);
+}
+
 RC DefaultHandler::delete_record(Trx *trx, const char *dbname, const char *relation_name,
                                  int condition_num, const Condition *conditions, int *deleted_count)
 {
@@ -190,6 +245,11 @@ RC DefaultHandler::delete_record(Trx *trx, const char *dbname, const char *relat
   {
     return RC::SCHEMA_TABLE_NOT_EXIST;
   }
+  if (table->materialized_view() != nullptr)
+  {
+    LOG_WARN("Materialized view %s can only be modified by its base table", relation_name);
+    return RC::READONLY;
+  }
 
   CompositeConditionFilter condition_filter;
   RC rc = condition_filter.init(*table, conditions, condition_num);
@@ -208,6 +268,11 @@ RC DefaultHandler::update_record(Trx *trx, const char *dbname, const char *relat
   {
     return RC::SCHEMA_TABLE_NOT_EXIST;
   }
+  if (table->materialized_view() != nullptr)
+  {
+    LOG_WARN("Materialized view %s can only be modified by its base table", relation_name);
+    return RC::READONLY;
+  }
 
   return table->update_record(trx, attribute_name, value, condition_num, conditions, updated_count);
 }
@@ -252,4 +317,33 @@ RC DefaultHandler::sync()
     }
   }
   return rc;
+}
+
+RC DefaultHandler::finish_open_tables()
+{
+  for (const auto &db_pair : opened_dbs_)
+  {
+    RC rc = db_pair.second->finish_open_tables();
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC DefaultHandler::compact(int max_pages)
+{
+  RC rc = RC::SUCCESS;
+  for (const auto &db_pair : opened_dbs_)
+  {
+    Db *db = db_pair.second;
+    rc = db->compact(max_pages);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to compact db. name=%s, rc=%d:%s", db->name(), rc, strrc(rc));
+      return rc;
+    }
+  }
+  return rc;
 }
\ No newline at end of file
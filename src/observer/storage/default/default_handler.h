@@ -81,9 +81,19 @@ public:
    * @param relName
    * @param attrCount
    * @param attributes
+   * @param page_size 数据和索引文件的页面大小，0表示默认大小
+   * @param compression 数据文件的页面压缩方式，nullptr表示不压缩
+   * @param format 数据文件的记录格式(row/pax)，nullptr表示row
+   * @param engine 存储引擎(disk/memory)，nullptr表示disk
+   * @param bloom_filter 建布隆过滤器的字段，nullptr表示不建
+   * @param primary_key_num 主键字段的个数，0表示没有主键
    * @return
    */
-  RC create_table(const char *dbname, const char *relation_name, int attribute_count, const AttrInfo *attributes);
+  RC create_table(const char *dbname, const char *relation_name, int attribute_count, const AttrInfo *attributes,
+                  int page_size = 0, const char *compression = nullptr, const char *format = nullptr,
+                  const char *engine = nullptr, const PartitionDef *partition = nullptr,
+                  const char *bloom_filter = nullptr, int primary_key_num = 0,
+                  const char *const primary_keys[] = nullptr);
 
   /**
    * 销毁名为relName的表以及在该表上建立的所有索引
@@ -91,6 +101,18 @@ public:
    * @return
    */
   RC drop_table(const char *dbname, const char *relation_name);
+  /**
+   * 创建单表分组聚合查询的物化视图，见Db::create_materialized_view
+   */
+  RC create_materialized_view(const char *dbname, const char *view_name, const Selects &selects);
+  /**
+   * 删除表中的所有记录，重新创建空的数据文件和索引文件
+   */
+  RC truncate_table(const char *dbname, const char *relation_name);
+  /**
+   * 抽样收集表和字段的统计信息，保存在表的元数据中
+   */
+  RC analyze_table(const char *dbname, const char *relation_name);
 
   /**
    * 该函数在关系relName的属性attrName上创建名为indexName的索引。
@@ -101,10 +123,15 @@ public:
    * ②逐个扫描被索引的记录，并向索引文件中插入索引项；③关闭索引
    * @param indexName
    * @param relName
-   * @param attrName
+   * @param attrName 多字段索引按顺序传入所有字段
+   * @param unique 唯一索引，插入和更新时拒绝属性值重复的记录
+   * @param prefix_lengths 字符串字段只索引前几个字符，0表示整个字段
+   * @param index_type B+树或者只支持等值查找的哈希索引
    * @return
    */
-  RC create_index(Trx *trx, const char *dbname, const char *relation_name, const char *index_name, const char *attribute_name);
+  RC create_index(Trx *trx, const char *dbname, const char *relation_name, const char *index_name,
+                  int attribute_num, const char *const attribute_names[], bool unique = false,
+                  const int prefix_lengths[] = nullptr, IndexType index_type = BPLUS_TREE_INDEX);
 
   /**
    * 该函数用来删除名为indexName的索引。
@@ -126,6 +153,12 @@ public:
    */
   RC insert_record(Trx *trx, const char *dbname, const char *relation_name, int value_num, const Value *values, Record **record = nullptr);
 
+  /**
+   * 批量插入多行，参考 Table::insert_records
+   */
+  RC insert_records(Trx *trx, const char *dbname, const char *relation_name, int row_num, const int *value_nums,
+                    const Value *const *values);
+
   /**
    * 该函数用来删除relName表中所有满足指定条件的元组以及该元组对应的索引项。
    * 如果没有指定条件，则此方法删除relName关系中所有元组。
@@ -159,6 +192,17 @@ public:
 
   RC sync();
 
+  /**
+   * 整理所有打开的表的记录文件，把稀疏页面上的记录搬到前面的页面中，释放空出来的页面
+   * @param max_pages 每张表最多处理的页面数
+   */
+  RC compact(int max_pages);
+
+  /**
+   * redo日志恢复结束之后完成所有打开的表的打开过程，比如映射mmap引擎的表
+   */
+  RC finish_open_tables();
+
 public:
   static DefaultHandler &get_default();
 
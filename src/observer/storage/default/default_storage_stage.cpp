@@ -13,7 +13,12 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include <string.h>
+#include <strings.h>
 #include <string>
+#include <vector>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
 
 #include "storage/default/default_storage_stage.h"
 
@@ -25,24 +30,161 @@ See the Mulan PSL v2 for more details. */
 #include "common/metrics/metrics_registry.h"
 #include "rc.h"
 #include "storage/default/default_handler.h"
+#include "storage/default/disk_buffer_pool.h"
+#include "storage/default/backup.h"
+#include "storage/default/redo_log.h"
+#include "storage/default/replication.h"
+#include "storage/default/table_loader.h"
+#include "storage/common/bplus_tree.h"
 #include "storage/common/condition_filter.h"
+#include "storage/common/db.h"
+#include "storage/common/materialized_view.h"
 #include "storage/common/table.h"
 #include "storage/common/table_meta.h"
+#include "storage/lsm/lsm_index.h"
+#include "storage/trx/lock_manager.h"
 #include "storage/trx/trx.h"
 #include "event/execution_plan_event.h"
 #include "event/session_event.h"
 #include "event/sql_event.h"
 #include "event/storage_event.h"
 #include "session/session.h"
+#include "sql/plan_cache/plan_cache.h"
 
 using namespace common;
 
 const std::string DefaultStorageStage::QUERY_METRIC_TAG = "DefaultStorageStage.query";
 const char *CONF_BASE_DIR = "BaseDir";
 const char *CONF_SYSTEM_DB = "SystemDb";
+const char *CONF_BUFFER_POOL_SIZE = "BufferPoolSize";
+const char *CONF_BUFFER_POOL_REPLACER = "BufferPoolReplacer";
+const char *CONF_BUFFER_POOL_DIRTY_RATIO = "BufferPoolDirtyRatio";
+const char *CONF_BUFFER_POOL_IO = "BufferPoolIo";
+const char *CONF_BUFFER_POOL_DIRECT_IO = "BufferPoolDirectIo";
+const char *CONF_BUFFER_POOL_NUMA = "BufferPoolNuma";
+const char *CONF_BUFFER_POOL_MAX_OPEN_FILES = "BufferPoolMaxOpenFiles";
+const char *CONF_BUFFER_POOL_WARM_UP = "BufferPoolWarmUp";
+const char *CONF_LOAD_DATA_THREADS = "LoadDataThreads";
+const char *CONF_LOAD_DATA_DEFER_INDEX = "LoadDataDeferIndex";
+const char *CONF_RECORD_COMPACT_INTERVAL = "RecordCompactInterval";
+const char *CONF_RECORD_COMPACT_PAGES = "RecordCompactPages";
+const char *CONF_INDEX_FILL_FACTOR = "IndexFillFactor";
+const char *CONF_INDEX_MERGE_THRESHOLD = "IndexMergeThreshold";
+const char *CONF_REDO_LOG = "RedoLog";
+const char *CONF_REDO_LOG_CHECKPOINT_SIZE = "RedoLogCheckpointSize";
+const char *CONF_REDO_LOG_CHECKPOINT_INTERVAL = "RedoLogCheckpointInterval";
+const char *CONF_REDO_LOG_RECOVERY_TIME = "RedoLogRecoveryTime";
+const char *CONF_LOCK_WAIT_TIMEOUT = "LockWaitTimeout";
+const char *CONF_REDO_LOG_ASYNC_COMMIT_LAG = "RedoLogAsyncCommitLag";
+const char *CONF_TABLE_OPEN_THREADS = "TableOpenThreads";
+const char *CONF_TABLE_OPEN_LAZY = "TableOpenLazy";
+const char *CONF_MAX_BATCH = "MaxBatch";
+const char *CONF_INDEX_CHANGE_BUFFER = "IndexChangeBuffer";
+const char *CONF_LSM_MEMTABLE_SIZE = "LsmMemtableSize";
+const char *CONF_REPLICATION_PORT = "ReplicationPort";
+const char *CONF_REPLICATION_MAX_LAG = "ReplicationMaxLag";
+const char *CONF_REPLICA_OF = "ReplicaOf";
+const char *CONF_BACKUP_RATE_LIMIT = "BackupRateLimit";
 
 const char *DEFAULT_SYSTEM_DB = "sys";
 
+/**
+ * 解析布尔类型的配置，支持true/false/1/0，不区分大小写
+ */
+static bool parse_bool_config(const std::string &value, bool *result)
+{
+  if (0 == strcasecmp(value.c_str(), "true") || value == "1")
+  {
+    *result = true;
+    return true;
+  }
+  if (0 == strcasecmp(value.c_str(), "false") || value == "0")
+  {
+    *result = false;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * 解析正整数的配置，可以带K/M/G后缀，has_unit返回是否带了后缀，带后缀时返回字节数。解析失败返回-1
+ */
+static long long parse_size_config(const std::string &value, bool *has_unit)
+{
+  std::string str = value;
+  strip(str);
+  if (str.empty())
+  {
+    return -1;
+  }
+
+  long long unit = 0;
+  switch (str.back())
+  {
+  case 'k':
+  case 'K':
+    unit = 1LL << 10;
+    break;
+  case 'm':
+  case 'M':
+    unit = 1LL << 20;
+    break;
+  case 'g':
+  case 'G':
+    unit = 1LL << 30;
+    break;
+  default:
+    break;
+  }
+  if (unit != 0)
+  {
+    str.pop_back();
+  }
+
+  long long num = 0;
+  if (!str_to_val(str, num) || num <= 0 || (unit != 0 && num > INT64_MAX / unit))
+  {
+    return -1;
+  }
+  *has_unit = unit != 0;
+  return unit != 0 ? num * unit : num;
+}
+
+/**
+ * 解析缓冲池大小配置。纯数字表示frame的数量，带K/M/G后缀表示字节数，
+ * 按照页面大小换算成frame数量。解析失败返回-1
+ */
+static int parse_buffer_pool_size(const std::string &value)
+{
+  bool has_unit = false;
+  long long num = parse_size_config(value, &has_unit);
+  if (num > 0 && has_unit)
+  {
+    num = num / BP_PAGE_SIZE;
+  }
+  if (num <= 0 || num > INT32_MAX)
+  {
+    return -1;
+  }
+  return (int)num;
+}
+
+/**
+ * 定时整理记录文件的事件，一直在本stage和TimerStage之间循环
+ */
+class CompactEvent : public StageEvent {
+public:
+  bool timer_fired = false;  // 定时器已经到期，需要执行一次整理
+};
+
+/**
+ * 定时检查redo日志是否需要checkpoint的事件，和CompactEvent一样循环
+ */
+class CheckpointEvent : public StageEvent {
+public:
+  bool timer_fired = false;
+};
+
 //! Constructor
 DefaultStorageStage::DefaultStorageStage(const char *tag) : Stage(tag), handler_(nullptr)
 {
@@ -93,6 +235,415 @@ bool DefaultStorageStage::set_properties()
     LOG_INFO("Use %s as system db", sys_db);
   }
 
+  // 缓冲池大小需要在打开任何表之前确定
+  iter = section.find(CONF_BUFFER_POOL_SIZE);
+  if (iter != section.end())
+  {
+    int pool_size = parse_buffer_pool_size(iter->second);
+    if (pool_size <= 0 || RC::SUCCESS != set_global_buffer_pool_size(pool_size))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_BUFFER_POOL_SIZE, iter->second.c_str());
+      return false;
+    }
+    LOG_INFO("Use %d frames as buffer pool size", pool_size);
+  }
+
+  iter = section.find(CONF_BUFFER_POOL_REPLACER);
+  if (iter != section.end())
+  {
+    ReplacerType replacer_type;
+    if (RC::SUCCESS != replacer_type_from_string(iter->second.c_str(), &replacer_type) ||
+        RC::SUCCESS != set_global_buffer_pool_replacer(replacer_type))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_BUFFER_POOL_REPLACER, iter->second.c_str());
+      return false;
+    }
+    LOG_INFO("Use %s as buffer pool replacer", iter->second.c_str());
+  }
+
+  iter = section.find(CONF_BUFFER_POOL_DIRTY_RATIO);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long dirty_ratio = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' ||
+        RC::SUCCESS != set_global_buffer_pool_dirty_ratio((int)dirty_ratio))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_BUFFER_POOL_DIRTY_RATIO, iter->second.c_str());
+      return false;
+    }
+    LOG_INFO("Use %ld%% as buffer pool dirty ratio", dirty_ratio);
+  }
+
+  iter = section.find(CONF_BUFFER_POOL_IO);
+  if (iter != section.end())
+  {
+    PageIoType page_io_type;
+    if (RC::SUCCESS != page_io_type_from_string(iter->second.c_str(), &page_io_type) ||
+        RC::SUCCESS != set_global_buffer_pool_page_io(page_io_type))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_BUFFER_POOL_IO, iter->second.c_str());
+      return false;
+    }
+    LOG_INFO("Use %s as buffer pool io", iter->second.c_str());
+  }
+
+  iter = section.find(CONF_BUFFER_POOL_DIRECT_IO);
+  if (iter != section.end())
+  {
+    bool direct_io = false;
+    if (!parse_bool_config(iter->second, &direct_io))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_BUFFER_POOL_DIRECT_IO, iter->second.c_str());
+      return false;
+    }
+    set_global_buffer_pool_direct_io(direct_io);
+    LOG_INFO("Use %s as buffer pool direct io", iter->second.c_str());
+  }
+
+  iter = section.find(CONF_BUFFER_POOL_NUMA);
+  if (iter != section.end())
+  {
+    bool numa = false;
+    if (!parse_bool_config(iter->second, &numa))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_BUFFER_POOL_NUMA, iter->second.c_str());
+      return false;
+    }
+    set_global_buffer_pool_numa(numa);
+    LOG_INFO("Use %s as buffer pool numa", iter->second.c_str());
+  }
+
+  iter = section.find(CONF_BUFFER_POOL_MAX_OPEN_FILES);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long max_open_files = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || max_open_files < 0 || max_open_files > INT_MAX ||
+        RC::SUCCESS != set_global_buffer_pool_max_open_files((int)max_open_files))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_BUFFER_POOL_MAX_OPEN_FILES, iter->second.c_str());
+      return false;
+    }
+    LOG_INFO("Keep at most %d fds of data and index files open", FileDescCache::instance().capacity());
+  }
+
+  bool warm_up = true;
+  iter = section.find(CONF_BUFFER_POOL_WARM_UP);
+  if (iter != section.end())
+  {
+    if (!parse_bool_config(iter->second, &warm_up))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_BUFFER_POOL_WARM_UP, iter->second.c_str());
+      return false;
+    }
+    LOG_INFO("Use %s as buffer pool warm up", iter->second.c_str());
+  }
+
+  iter = section.find(CONF_LOAD_DATA_THREADS);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long thread_num = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || thread_num < 0 || thread_num > LOAD_DATA_MAX_PARSE_THREADS)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_LOAD_DATA_THREADS, iter->second.c_str());
+      return false;
+    }
+    load_data_options_.parse_threads = (int)thread_num;
+    LOG_INFO("Use %ld threads to parse load data", thread_num);
+  }
+
+  iter = section.find(CONF_LOAD_DATA_DEFER_INDEX);
+  if (iter != section.end())
+  {
+    if (!parse_bool_config(iter->second, &load_data_options_.defer_index))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_LOAD_DATA_DEFER_INDEX, iter->second.c_str());
+      return false;
+    }
+    LOG_INFO("Use %s as load data defer index", iter->second.c_str());
+  }
+
+  iter = section.find(CONF_RECORD_COMPACT_INTERVAL);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long interval = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || interval < 0 || interval > INT32_MAX)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_RECORD_COMPACT_INTERVAL, iter->second.c_str());
+      return false;
+    }
+    compact_interval_ = (int)interval;
+    LOG_INFO("Use %ld seconds as record compact interval", interval);
+  }
+
+  iter = section.find(CONF_RECORD_COMPACT_PAGES);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long pages = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || pages <= 0 || pages > INT32_MAX)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_RECORD_COMPACT_PAGES, iter->second.c_str());
+      return false;
+    }
+    compact_pages_ = (int)pages;
+    LOG_INFO("Use %ld pages as record compact pages", pages);
+  }
+
+  iter = section.find(CONF_INDEX_FILL_FACTOR);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long fill_factor = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || fill_factor < 0 || fill_factor > 100 ||
+        RC::SUCCESS != set_bplus_tree_fill_factor((int)fill_factor))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_INDEX_FILL_FACTOR, iter->second.c_str());
+      return false;
+    }
+    LOG_INFO("Use %ld%% as index fill factor", fill_factor);
+  }
+
+  iter = section.find(CONF_INDEX_MERGE_THRESHOLD);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long threshold = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || threshold < 0 || threshold > 100 ||
+        RC::SUCCESS != set_bplus_tree_merge_threshold((int)threshold))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_INDEX_MERGE_THRESHOLD, iter->second.c_str());
+      return false;
+    }
+    LOG_INFO("Use %ld%% as index merge threshold", threshold);
+  }
+
+  iter = section.find(CONF_MAX_BATCH);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long max_batch = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || max_batch < 1 || max_batch > MAX_EVENT_BATCH)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_MAX_BATCH, iter->second.c_str());
+      return false;
+    }
+    set_max_batch((int)max_batch);
+    LOG_INFO("Handle at most %ld events at a time", max_batch);
+  }
+
+  bool redo_log = false;
+  iter = section.find(CONF_REDO_LOG);
+  if (iter != section.end())
+  {
+    if (!parse_bool_config(iter->second, &redo_log))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_REDO_LOG, iter->second.c_str());
+      return false;
+    }
+  }
+
+  iter = section.find(CONF_INDEX_CHANGE_BUFFER);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long max_changes = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || max_changes < 0 || max_changes > INT_MAX)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_INDEX_CHANGE_BUFFER, iter->second.c_str());
+      return false;
+    }
+    if (redo_log && max_changes > 0)
+    {
+      // 缓存的修改不写日志，恢复时会丢失
+      LOG_WARN("Ignore config %s=%s because redo log is enabled", CONF_INDEX_CHANGE_BUFFER, iter->second.c_str());
+    }
+    else
+    {
+      set_bplus_tree_change_buffer((int)max_changes);
+      LOG_INFO("Buffer at most %ld changes of each index", max_changes);
+    }
+  }
+
+  iter = section.find(CONF_LSM_MEMTABLE_SIZE);
+  if (iter != section.end())
+  {
+    bool has_unit = false;
+    long long memtable_size = parse_size_config(iter->second, &has_unit);
+    if (memtable_size <= 0 || set_lsm_memtable_size((size_t)memtable_size) != RC::SUCCESS)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_LSM_MEMTABLE_SIZE, iter->second.c_str());
+      return false;
+    }
+    LOG_INFO("Memtable of each lsm index is flushed at %lld bytes", memtable_size);
+  }
+
+  long long checkpoint_size = REDO_LOG_DEFAULT_CHECKPOINT_SIZE;
+  iter = section.find(CONF_REDO_LOG_CHECKPOINT_SIZE);
+  if (iter != section.end())
+  {
+    bool has_unit = false;
+    checkpoint_size = parse_size_config(iter->second, &has_unit);
+    if (checkpoint_size <= 0)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_REDO_LOG_CHECKPOINT_SIZE, iter->second.c_str());
+      return false;
+    }
+    LOG_INFO("Use %lld bytes as redo log checkpoint size", checkpoint_size);
+  }
+
+  iter = section.find(CONF_REDO_LOG_CHECKPOINT_INTERVAL);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long interval = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || interval < 0 || interval > INT32_MAX)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_REDO_LOG_CHECKPOINT_INTERVAL, iter->second.c_str());
+      return false;
+    }
+    checkpoint_interval_ = (int)interval;
+    LOG_INFO("Use %ld seconds as redo log checkpoint interval", interval);
+  }
+
+  iter = section.find(CONF_REDO_LOG_RECOVERY_TIME);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long recovery_time = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || recovery_time < 0 || recovery_time > INT32_MAX)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_REDO_LOG_RECOVERY_TIME, iter->second.c_str());
+      return false;
+    }
+    recovery_time_ = (int)recovery_time;
+    LOG_INFO("Use %ld seconds as redo log target recovery time", recovery_time);
+  }
+
+  iter = section.find(CONF_LOCK_WAIT_TIMEOUT);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long timeout = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || timeout < 0 || timeout > INT32_MAX)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_LOCK_WAIT_TIMEOUT, iter->second.c_str());
+      return false;
+    }
+    LockManager::instance().set_wait_timeout((int)timeout);
+    LOG_INFO("Use %ld milliseconds as lock wait timeout", timeout);
+  }
+
+  iter = section.find(CONF_REDO_LOG_ASYNC_COMMIT_LAG);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long lag = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || lag < 0 || lag > INT32_MAX)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_REDO_LOG_ASYNC_COMMIT_LAG, iter->second.c_str());
+      return false;
+    }
+    RedoLog::instance().set_async_commit_lag((int)lag);
+    LOG_INFO("Use %ld milliseconds as redo log asynchronous commit lag", lag);
+  }
+
+  iter = section.find(CONF_TABLE_OPEN_THREADS);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long threads = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || threads <= 0 || threads > DB_MAX_TABLE_OPEN_THREADS)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_TABLE_OPEN_THREADS, iter->second.c_str());
+      return false;
+    }
+    Db::set_table_open_threads((int)threads);
+    LOG_INFO("Use %ld threads to open tables", threads);
+  }
+
+  iter = section.find(CONF_TABLE_OPEN_LAZY);
+  if (iter != section.end())
+  {
+    bool lazy = false;
+    if (!parse_bool_config(iter->second, &lazy))
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_TABLE_OPEN_LAZY, iter->second.c_str());
+      return false;
+    }
+    Db::set_lazy_table_open(lazy);
+    LOG_INFO("Open tables %s", lazy ? "lazily" : "at startup");
+  }
+
+  int replication_port = -1;
+  iter = section.find(CONF_REPLICATION_PORT);
+  if (iter != section.end())
+  {
+    char *end = nullptr;
+    long port = strtol(iter->second.c_str(), &end, 10);
+    if (end == iter->second.c_str() || *end != '\0' || port < 0 || port > 65535)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_REPLICATION_PORT, iter->second.c_str());
+      return false;
+    }
+    if (!redo_log)
+    {
+      LOG_ERROR("Config %s needs %s=true", CONF_REPLICATION_PORT, CONF_REDO_LOG);
+      return false;
+    }
+    replication_port = (int)port;
+  }
+
+  long long replication_max_lag = REPLICATION_DEFAULT_MAX_LAG;
+  iter = section.find(CONF_REPLICATION_MAX_LAG);
+  if (iter != section.end())
+  {
+    bool has_unit = false;
+    replication_max_lag = parse_size_config(iter->second, &has_unit);
+    if (replication_max_lag <= 0)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_REPLICATION_MAX_LAG, iter->second.c_str());
+      return false;
+    }
+  }
+
+  long long backup_rate_limit = BACKUP_DEFAULT_RATE_LIMIT;
+  iter = section.find(CONF_BACKUP_RATE_LIMIT);
+  if (iter != section.end())
+  {
+    bool has_unit = false;
+    backup_rate_limit = iter->second == "0" ? 0 : parse_size_config(iter->second, &has_unit);
+    if (backup_rate_limit < 0)
+    {
+      LOG_ERROR("Invalid config %s=%s", CONF_BACKUP_RATE_LIMIT, iter->second.c_str());
+      return false;
+    }
+  }
+
+  std::string replica_of;
+  iter = section.find(CONF_REPLICA_OF);
+  if (iter != section.end() && !iter->second.empty())
+  {
+    if (replication_port >= 0)
+    {
+      LOG_ERROR("Config %s and %s cannot be used together", CONF_REPLICA_OF, CONF_REPLICATION_PORT);
+      return false;
+    }
+    replica_of = iter->second;
+    if (redo_log)
+    {
+      // 备库的页面都来自主库的日志，自己不写日志
+      LOG_WARN("Ignore config %s=true because this is a replica", CONF_REDO_LOG);
+      redo_log = false;
+    }
+    // 备库上不使用索引等从数据派生的状态，表在打开数据库时全部打开
+    Trx::set_replica(true);
+    Db::set_lazy_table_open(false);
+  }
+
   handler_ = &DefaultHandler::get_default();
   if (RC::SUCCESS != handler_->init(base_dir))
   {
@@ -100,6 +651,27 @@ bool DefaultStorageStage::set_properties()
     return false;
   }
 
+  // 备库打开数据库之前先从主库复制快照
+  if (!replica_of.empty() &&
+      RC::SUCCESS != ReplicaClient::instance().connect(replica_of, std::string(base_dir) + "/db/"))
+  {
+    LOG_ERROR("Failed to copy snapshot from primary %s", replica_of.c_str());
+    return false;
+  }
+
+  BackupManager::instance().init(std::string(base_dir) + "/db/", backup_rate_limit);
+
+  // 打开数据文件之前先用redo日志恢复
+  if (redo_log)
+  {
+    std::string redo_dir = std::string(base_dir) + "/redo";
+    if (RC::SUCCESS != RedoLog::instance().open(redo_dir.c_str(), checkpoint_size))
+    {
+      LOG_ERROR("Failed to open redo log in %s", redo_dir.c_str());
+      return false;
+    }
+  }
+
   RC ret = handler_->create_db(sys_db);
   if (ret != RC::SUCCESS && ret != RC::SCHEMA_DB_EXIST)
   {
@@ -113,6 +685,38 @@ bool DefaultStorageStage::set_properties()
     LOG_ERROR("Failed to open system db");
     return false;
   }
+  // 打开表时已经处理了记录上遗留的事务字段
+  bool recovered = RedoLog::instance().recovering();
+  if (RC::SUCCESS != RedoLog::instance().finish_recovery())
+  {
+    LOG_ERROR("Failed to finish redo log recovery");
+    return false;
+  }
+  if (recovered && RC::SUCCESS != handler_->finish_open_tables())
+  {
+    LOG_ERROR("Failed to open tables after redo log recovery");
+    return false;
+  }
+
+  if (!replica_of.empty() && RC::SUCCESS != ReplicaClient::instance().start())
+  {
+    LOG_ERROR("Failed to start replicating from %s", replica_of.c_str());
+    return false;
+  }
+  if (replication_port >= 0 &&
+      RC::SUCCESS !=
+          ReplicationServer::instance().start(replication_port, std::string(base_dir) + "/db/", replication_max_lag))
+  {
+    LOG_ERROR("Failed to serve replicas on port %d", replication_port);
+    return false;
+  }
+
+  // 表都打开之后再预热，预热在后台进行，不影响开始处理请求
+  if (warm_up)
+  {
+    set_global_buffer_pool_dump_file(std::string(base_dir) + "/" + BUFFER_POOL_DUMP_FILE);
+    start_global_buffer_pool_warm_up();
+  }
 
   Session &default_session = Session::default_session();
   default_session.set_current_db(sys_db);
@@ -130,6 +734,33 @@ bool DefaultStorageStage::initialize()
   query_metric_ = new SimpleTimer();
   metricsRegistry.register_metric(QUERY_METRIC_TAG, query_metric_);
 
+  // 备库上的记录文件和主库保持一致，不能自己整理
+  if (compact_interval_ > 0 && !Trx::replica())
+  {
+    if (next_stage_list_.empty())
+    {
+      LOG_WARN("Record compaction is disabled, since no TimerStage is configured as next stage");
+    }
+    else
+    {
+      timer_stage_ = next_stage_list_.front();
+      add_event(new CompactEvent());
+    }
+  }
+
+  if (checkpoint_interval_ > 0 && RedoLog::instance().enabled())
+  {
+    if (next_stage_list_.empty())
+    {
+      LOG_WARN("Timed redo log checkpoint is disabled, since no TimerStage is configured as next stage");
+    }
+    else
+    {
+      timer_stage_ = next_stage_list_.front();
+      add_event(new CheckpointEvent());
+    }
+  }
+
   LOG_TRACE("Exit");
   return true;
 }
@@ -141,15 +772,172 @@ void DefaultStorageStage::cleanup()
 
   if (handler_)
   {
+    // 预热线程会访问打开的文件
+    stop_global_buffer_pool_warm_up();
+    // 复制线程会写日志和缓冲池
+    ReplicationServer::instance().stop();
+    ReplicaClient::instance().stop();
     handler_->destroy();
     handler_ = nullptr;
   }
   LOG_TRACE("Exit");
 }
 
+void DefaultStorageStage::handle_compact_event(StageEvent *event)
+{
+  CompactEvent *compact_event = static_cast<CompactEvent *>(event);
+  if (compact_event->timer_fired)
+  {
+    compact_event->timer_fired = false;
+    RC rc = handler_->compact(compact_pages_);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_WARN("Failed to compact record files. rc=%d:%s", rc, strrc(rc));
+    }
+  }
+  register_timer(event, compact_interval_);
+}
+
+void DefaultStorageStage::handle_checkpoint_event(StageEvent *event)
+{
+  CheckpointEvent *checkpoint_event = static_cast<CheckpointEvent *>(event);
+  if (checkpoint_event->timer_fired)
+  {
+    checkpoint_event->timer_fired = false;
+    // checkpoint在redo日志的后台线程中执行，这里只做判断，不占用本stage的线程。
+    // 估计的恢复时间到达目标的一半就开始，留出checkpoint本身的时间和期间新写的日志
+    RedoLog &redo_log = RedoLog::instance();
+    long long recovery_ms = redo_log.estimated_recovery_ms();
+    if (recovery_time_ == 0 ? redo_log.log_size() > 0 : recovery_ms * 2 >= recovery_time_ * 1000LL)
+    {
+      LOG_INFO("Request redo log checkpoint, estimated recovery time %lld ms", recovery_ms);
+      redo_log.request_checkpoint();
+    }
+  }
+  register_timer(event, checkpoint_interval_);
+}
+
+void DefaultStorageStage::register_timer(StageEvent *event, int interval)
+{
+  CompletionCallback *cb = new (std::nothrow) CompletionCallback(this, nullptr);
+  if (cb == nullptr)
+  {
+    LOG_ERROR("Failed to new callback for timer event");
+    event->done();
+    return;
+  }
+
+  TimerRegisterEvent *tm_event = new (std::nothrow) TimerRegisterEvent(event, (u64_t)interval * USEC_PER_SEC);
+  if (tm_event == nullptr)
+  {
+    LOG_ERROR("Failed to new TimerRegisterEvent for timer event");
+    delete cb;
+    event->done();
+    return;
+  }
+
+  event->push_callback(cb);
+  timer_stage_->add_event(tm_event);
+}
+
 void DefaultStorageStage::handle_event(StageEvent *event)
 {
   LOG_TRACE("Enter\n");
+  if (dynamic_cast<CompactEvent *>(event) != nullptr)
+  {
+    handle_compact_event(event);
+    LOG_TRACE("Exit\n");
+    return;
+  }
+  if (dynamic_cast<CheckpointEvent *>(event) != nullptr)
+  {
+    handle_checkpoint_event(event);
+    LOG_TRACE("Exit\n");
+    return;
+  }
+
+  handle_storage_event(event, false);
+  LOG_TRACE("Exit\n");
+}
+
+bool DefaultStorageStage::group_committable(StageEvent *event) const
+{
+  StorageEvent *storage_event = dynamic_cast<StorageEvent *>(event);
+  if (storage_event == nullptr || !RedoLog::instance().enabled())
+  {
+    return false;
+  }
+  const SqlCommandFlag flag = storage_event->exe_event()->sqls()->flag;
+  Session *session = storage_event->exe_event()->sql_event()->session_event()->get_client()->session;
+  return (flag == SCF_INSERT || flag == SCF_UPDATE || flag == SCF_DELETE) &&
+         !session->is_trx_multi_operation_mode() && session->synchronous_commit();
+}
+
+void DefaultStorageStage::handle_events(StageEvent **events, int n)
+{
+  // 自动提交的事务提交时只把日志写到缓冲中，整批执行完之后一起等待落盘再返回结果，n个事务共用一次fsync。
+  // 落盘之前其它会话可能已经看到了这些事务的修改，但是客户端收到结果时修改一定已经持久化了
+  std::vector<StageEvent *> grouped;
+  for (int i = 0; i < n; i++)
+  {
+    if (group_committable(events[i]))
+    {
+      if (handle_storage_event(events[i], true))
+      {
+        grouped.push_back(events[i]);
+      }
+    }
+    else
+    {
+      handle_event(events[i]);
+    }
+  }
+  if (grouped.empty())
+  {
+    return;
+  }
+
+  LOG_DEBUG("Flush redo log once for %d grouped statement(s)", (int)grouped.size());
+  RedoLog &redo_log = RedoLog::instance();
+  RC rc = redo_log.flush(redo_log.current_lsn());
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to flush redo log of %d grouped statement(s). rc=%d:%s", (int)grouped.size(), rc, strrc(rc));
+  }
+  for (StageEvent *event : grouped)
+  {
+    if (rc != RC::SUCCESS)
+    {
+      static_cast<StorageEvent *>(event)->exe_event()->sql_event()->session_event()->set_response("FAILURE\n");
+    }
+    event->done_immediate();
+  }
+}
+
+/**
+ * 需要整理锁的写锁或者删除表文件的DDL作用的表，其它语句返回nullptr
+ */
+static const char *exclusive_ddl_table(const Query *sql)
+{
+  switch (sql->flag)
+  {
+  case SCF_DROP_TABLE:
+    return sql->sstr.drop_table.relation_name;
+  case SCF_TRUNCATE_TABLE:
+    return sql->sstr.truncate_table.relation_name;
+  case SCF_ANALYZE_TABLE:
+    return sql->sstr.analyze_table.relation_name;
+  case SCF_DROP_PARTITION:
+    return sql->sstr.drop_partition.relation_name;
+  case SCF_CREATE_INDEX:
+    return sql->sstr.create_index.relation_name;
+  default:
+    return nullptr;
+  }
+}
+
+bool DefaultStorageStage::handle_storage_event(StageEvent *event, bool group_commit)
+{
   TimerStat timerStat(*query_metric_);
 
   StorageEvent *storage_event = static_cast<StorageEvent *>(event);
@@ -158,13 +946,14 @@ void DefaultStorageStage::handle_event(StageEvent *event)
   {
     LOG_ERROR("Failed to new callback for SessionEvent");
     storage_event->done_immediate();
-    return;
+    return false;
   }
   storage_event->push_callback(cb);
 
   Query *sql = storage_event->exe_event()->sqls();
 
   SessionEvent *session_event = storage_event->exe_event()->sql_event()->session_event();
+  session_event->query_trace().enter_stage("storage");
 
   Session *session = session_event->get_client()->session;
   const char *current_db = session->get_current_db().c_str();
@@ -173,41 +962,56 @@ void DefaultStorageStage::handle_event(StageEvent *event)
 
   RC rc = RC::SUCCESS;
 
+  // 游标可能很久都不关闭，要等它放开整理锁的DDL直接失败
+  const char *ddl_table = exclusive_ddl_table(sql);
+  Table *ddl_target = ddl_table != nullptr ? handler_->find_table(current_db, ddl_table) : nullptr;
+  if (ddl_target != nullptr && ddl_target->pinned_by_cursor())
+  {
+    LOG_WARN("Table %s is scanned by an open cursor", ddl_table);
+    session_event->set_response("FAILURE\n");
+    if (!group_commit)
+    {
+      event->done_immediate();
+    }
+    return group_commit;
+  }
+
+  // 多语句事务中失败的修改语句只回滚自己的修改，事务可以继续，不用从头重做
+  const bool statement_rollback = session->is_trx_multi_operation_mode() &&
+                                  (sql->flag == SCF_INSERT || sql->flag == SCF_UPDATE || sql->flag == SCF_DELETE);
+  if (statement_rollback)
+  {
+    current_trx->begin_statement();
+  }
+
+  // 在线备份复制文件期间，新建和删除文件的语句等它完成
+  std::shared_lock<std::shared_mutex> ddl_guard(BackupManager::instance().ddl_mutex(), std::defer_lock);
+  if (sql->flag == SCF_CREATE_TABLE || sql->flag == SCF_CREATE_INDEX || sql->flag == SCF_DROP_TABLE ||
+      sql->flag == SCF_CREATE_VIEW || sql->flag == SCF_TRUNCATE_TABLE || sql->flag == SCF_ANALYZE_TABLE ||
+      sql->flag == SCF_DROP_PARTITION)
+  {
+    ddl_guard.lock();
+  }
+
   char response[256];
+  std::string long_response;  // 超过response大小的结果
   switch (sql->flag)
   {
   case SCF_INSERT:
   { // insert into
     const Inserts &inserts = sql->sstr.insertion;
     const char *table_name = inserts.relation_name;
-    RC rc = RC::SUCCESS;
-    std::vector<Record> records;
-
+    // 所有组一起插入，一组失败时所有组都不插入
+    std::vector<int> value_nums(inserts.group_num);
     for (size_t i = 0; i < inserts.group_num; ++i)
     {
-      Record *record;
-      rc = handler_->insert_record(current_trx, current_db, table_name, inserts.value_num[i], inserts.values[i], &record);
-      if (rc != RC::SUCCESS)
-      {
-        LOG_ERROR("插入第%ld组失败", i);
-        // 不能用rollback，因为可能会遇到连续输入两条insert，后一条失败的情况
-        // 使用rollback会导致成功的insert语句也被回滚
-        // current_trx->rollback();
-        // 一个插入失败，则全部失败，处理面前可能成功的插入
-        if (i != 0)
-        {
-          Table *table = handler_->find_table(current_db, table_name);
-          int n = records.size();
-          for (int j = 0; j < n; ++j)
-          {
-            // table->delete_record(current_trx, &records[j]);
-            table->delete_record(nullptr, &records[j]);
-          }
-        }
-        break;
-      }
-
-      records.push_back(*record);
+      value_nums[i] = (int)inserts.value_num[i];
+    }
+    rc = handler_->insert_records(current_trx, current_db, table_name, (int)inserts.group_num, value_nums.data(),
+                                  inserts.values);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to insert %d group(s) into %s. rc=%d:%s", (int)inserts.group_num, table_name, rc, strrc(rc));
     }
     snprintf(response, sizeof(response), "%s\n", rc == RC::SUCCESS ? "SUCCESS" : "FAILURE");
   }
@@ -236,7 +1040,13 @@ void DefaultStorageStage::handle_event(StageEvent *event)
   { // create table
     const CreateTable &create_table = sql->sstr.create_table;
     rc = handler_->create_table(current_db, create_table.relation_name,
-                                create_table.attribute_count, create_table.attributes);
+                                create_table.attribute_count, create_table.attributes, create_table.page_size,
+                                create_table.compression, create_table.format, create_table.engine,
+                                &create_table.partition, create_table.bloom_filter,
+                                (int)create_table.primary_key_num, create_table.primary_keys);
+    if (rc == RC::SUCCESS) {
+      PlanCache::instance().invalidate(current_db, create_table.relation_name);
+    }
     snprintf(response, sizeof(response), "%s\n", rc == RC::SUCCESS ? "SUCCESS" : "FAILURE");
   }
   break;
@@ -244,7 +1054,12 @@ void DefaultStorageStage::handle_event(StageEvent *event)
   {
     const CreateIndex &create_index = sql->sstr.create_index;
     rc = handler_->create_index(current_trx, current_db, create_index.relation_name,
-                                create_index.index_name, create_index.attribute_name);
+                                create_index.index_name, (int)create_index.attribute_num,
+                                create_index.attribute_names, create_index.unique != 0,
+                                create_index.prefix_lengths, create_index.index_type);
+    if (rc == RC::SUCCESS) {
+      PlanCache::instance().invalidate(current_db, create_index.relation_name);
+    }
     snprintf(response, sizeof(response), "%s\n", rc == RC::SUCCESS ? "SUCCESS" : "FAILURE");
   }
   break;
@@ -257,6 +1072,66 @@ void DefaultStorageStage::handle_event(StageEvent *event)
     const DropTable &drop_table = sql->sstr.drop_table;
     int deleted_count = 0;
     rc = handler_->drop_table(current_db, drop_table.relation_name);
+    if (rc == RC::SUCCESS) {
+      PlanCache::instance().invalidate(current_db, drop_table.relation_name);
+    }
+    snprintf(response, sizeof(response), "%s\n", rc == RC::SUCCESS ? "SUCCESS" : "FAILURE");
+  }
+  break;
+  case SCF_CREATE_VIEW:
+  {
+    const CreateView &create_view = sql->sstr.create_view;
+    rc = handler_->create_materialized_view(current_db, create_view.view_name, create_view.query->sstr.selection);
+    if (rc == RC::SUCCESS) {
+      PlanCache::instance().invalidate(current_db, create_view.view_name);
+    }
+    snprintf(response, sizeof(response), "%s\n", rc == RC::SUCCESS ? "SUCCESS" : "FAILURE");
+  }
+  break;
+  case SCF_TRUNCATE_TABLE:
+  {
+    const TruncateTable &truncate_table = sql->sstr.truncate_table;
+    rc = handler_->truncate_table(current_db, truncate_table.relation_name);
+    if (rc == RC::SCHEMA_TABLE_NOT_EXIST)
+    {
+      snprintf(response, sizeof(response), "No such table: %s\n", truncate_table.relation_name);
+      break;
+    }
+    if (rc == RC::SUCCESS) {
+      PlanCache::instance().invalidate(current_db, truncate_table.relation_name);
+    }
+    snprintf(response, sizeof(response), "%s\n", rc == RC::SUCCESS ? "SUCCESS" : "FAILURE");
+  }
+  break;
+  case SCF_ANALYZE_TABLE:
+  {
+    const AnalyzeTable &analyze_table = sql->sstr.analyze_table;
+    rc = handler_->analyze_table(current_db, analyze_table.relation_name);
+    if (rc == RC::SCHEMA_TABLE_NOT_EXIST)
+    {
+      snprintf(response, sizeof(response), "No such table: %s\n", analyze_table.relation_name);
+      break;
+    }
+    // 缓存的计划是按照之前的统计信息选出来的
+    if (rc == RC::SUCCESS) {
+      PlanCache::instance().invalidate(current_db, analyze_table.relation_name);
+    }
+    snprintf(response, sizeof(response), "%s\n", rc == RC::SUCCESS ? "SUCCESS" : "FAILURE");
+  }
+  break;
+  case SCF_DROP_PARTITION:
+  {
+    const DropPartition &drop_partition = sql->sstr.drop_partition;
+    Table *table = handler_->find_table(current_db, drop_partition.relation_name);
+    if (nullptr == table)
+    {
+      snprintf(response, sizeof(response), "No such table: %s\n", drop_partition.relation_name);
+      break;
+    }
+    rc = table->drop_partition(drop_partition.partition_name);
+    if (rc == RC::SUCCESS) {
+      PlanCache::instance().invalidate(current_db, drop_partition.relation_name);
+    }
     snprintf(response, sizeof(response), "%s\n", rc == RC::SUCCESS ? "SUCCESS" : "FAILURE");
   }
   break;
@@ -287,6 +1162,13 @@ void DefaultStorageStage::handle_event(StageEvent *event)
     }
   }
   break;
+  case SCF_SHOW_BUFFER_POOL:
+  {
+    std::stringstream ss;
+    dump_global_buffer_pool_status(ss);
+    long_response = ss.str();
+  }
+  break;
   case SCF_DESC_TABLE:
   {
     const char *table_name = sql->sstr.desc_table.relation_name;
@@ -300,7 +1182,8 @@ void DefaultStorageStage::handle_event(StageEvent *event)
     {
       ss << "No such table: " << table_name << std::endl;
     }
-    snprintf(response, sizeof(response), "%s", ss.str().c_str());
+    // 分区表的每个分区占一行，超过response的大小
+    long_response = ss.str();
   }
   break;
 
@@ -316,6 +1199,12 @@ void DefaultStorageStage::handle_event(StageEvent *event)
     snprintf(response, sizeof(response), "%s", result.c_str());
   }
   break;
+  case SCF_BACKUP:
+  {
+    rc = BackupManager::instance().backup(sql->sstr.backup.dir);
+    snprintf(response, sizeof(response), "%s\n", rc == RC::SUCCESS ? "SUCCESS" : "FAILURE");
+  }
+  break;
   default:
     snprintf(response, sizeof(response), "Unsupported sql: %d\n", sql->flag);
     break;
@@ -323,131 +1212,75 @@ void DefaultStorageStage::handle_event(StageEvent *event)
 
   if (rc == RC::SUCCESS && !session->is_trx_multi_operation_mode())
   {
+    if (group_commit)
+    {
+      current_trx->set_synchronous_commit(false);
+    }
     rc = current_trx->commit();
     if (rc != RC::SUCCESS)
     {
       LOG_ERROR("Failed to commit trx. rc=%d:%s", rc, strrc(rc));
     }
+    if (group_commit)
+    {
+      current_trx->set_synchronous_commit(session->synchronous_commit());
+    }
   }
-
-  session_event->set_response(response);
-  event->done_immediate();
-
-  LOG_TRACE("Exit\n");
-}
-
-void DefaultStorageStage::callback_event(StageEvent *event,
-                                         CallbackContext *context)
-{
-  LOG_TRACE("Enter\n");
-  StorageEvent *storage_event = static_cast<StorageEvent *>(event);
-  storage_event->exe_event()->done_immediate();
-  LOG_TRACE("Exit\n");
-  return;
-}
-
-/**
- * 从文件中导入数据时使用。尝试向表中插入解析后的一行数据。
- * @param table  要导入的表
- * @param file_values 从文件中读取到的一行数据，使用分隔符拆分后的几个字段值
- * @param record_values Table::insert_record使用的参数，为了防止频繁的申请内存
- * @param errmsg 如果出现错误，通过这个参数返回错误信息
- * @return 成功返回RC::SUCCESS
- */
-RC insert_record_from_file(Table *table, std::vector<std::string> &file_values,
-                           std::vector<Value> &record_values, std::stringstream &errmsg)
-{
-
-  const int field_num = record_values.size();
-  const int sys_field_num = table->table_meta().sys_field_num();
-
-  if (file_values.size() < record_values.size())
+  else if (!session->is_trx_multi_operation_mode() || rc == RC::LOCKED_DEADLOCK)
   {
-    return RC::SCHEMA_FIELD_MISSING;
+    // 失败的语句不留下修改，也不再占用读视图。死锁时回滚整个事务，放开它持有的锁
+    current_trx->rollback();
   }
-
-  RC rc = RC::SUCCESS;
-
-  std::stringstream deserialize_stream;
-  for (int i = 0; i < field_num && RC::SUCCESS == rc; i++)
+  else if (statement_rollback)
   {
-    const FieldMeta *field = table->table_meta().field(i + sys_field_num);
-
-    std::string &file_value = file_values[i];
-    common::strip(file_value);
-
-    switch (field->type())
-    {
-    case INTS:
+    RC rc2 = current_trx->end_statement(rc == RC::SUCCESS);
+    if (rc2 != RC::SUCCESS)
     {
-      deserialize_stream.clear(); // 清理stream的状态，防止多次解析出现异常
-      deserialize_stream.str(file_value);
-
-      int int_value;
-      deserialize_stream >> int_value;
-      if (!deserialize_stream || !deserialize_stream.eof())
-      {
-        errmsg << "need an integer but got '" << file_values[i]
-               << "' (field index:" << i << ")";
-
-        rc = RC::SCHEMA_FIELD_TYPE_MISMATCH;
-      }
-      else
-      {
-        value_init_integer(&record_values[i], int_value, false);
-      }
+      LOG_ERROR("Failed to rollback failed statement. rc=%d:%s", rc2, strrc(rc2));
     }
+  }
 
-    break;
-    case FLOATS:
-    {
-      deserialize_stream.clear();
-      deserialize_stream.str(file_value);
-
-      float float_value;
-      deserialize_stream >> float_value;
-      if (!deserialize_stream || !deserialize_stream.eof())
-      {
-        errmsg << "need a float number but got '" << file_values[i]
-               << "'(field index:" << i << ")";
-        rc = RC::SCHEMA_FIELD_TYPE_MISMATCH;
-      }
-      else
-      {
-        value_init_float(&record_values[i], float_value, false);
-      }
-    }
-    break;
-    case CHARS:
-    {
-      value_init_string(&record_values[i], file_value.c_str(), false);
-    }
-    break;
-    // case NULLS: {
-    //   value_init_string(&record_values[i], file_value.c_str(), true);
-    // }
-    default:
-    {
-      errmsg << "Unsupported field type to loading: " << field->type();
-      rc = RC::SCHEMA_FIELD_TYPE_MISMATCH;
-    }
-    break;
-    }
+  if (!long_response.empty())
+  {
+    session_event->set_response(std::move(long_response));
   }
+  else
+  {
+    session_event->set_response(response);
+  }
+  if (!group_commit)
+  {
+    event->done_immediate();
+  }
+  return group_commit;
+}
 
-  if (RC::SUCCESS == rc)
+void DefaultStorageStage::callback_event(StageEvent *event,
+                                         CallbackContext *context)
+{
+  LOG_TRACE("Enter\n");
+  CompactEvent *compact_event = dynamic_cast<CompactEvent *>(event);
+  if (compact_event != nullptr)
   {
-    rc = table->insert_record(nullptr, field_num, record_values.data());
-    if (rc != RC::SUCCESS)
-    {
-      errmsg << "insert failed.";
-    }
+    // 定时器线程回调，回到本stage的线程中执行整理
+    compact_event->timer_fired = true;
+    add_event(compact_event);
+    LOG_TRACE("Exit\n");
+    return;
   }
-  for (int i = 0; i < field_num; i++)
+  CheckpointEvent *checkpoint_event = dynamic_cast<CheckpointEvent *>(event);
+  if (checkpoint_event != nullptr)
   {
-    value_destroy(&record_values[i]);
+    checkpoint_event->timer_fired = true;
+    add_event(checkpoint_event);
+    LOG_TRACE("Exit\n");
+    return;
   }
-  return rc;
+
+  StorageEvent *storage_event = static_cast<StorageEvent *>(event);
+  storage_event->exe_event()->done_immediate();
+  LOG_TRACE("Exit\n");
+  return;
 }
 
 std::string DefaultStorageStage::load_data(const char *db_name,
@@ -461,61 +1294,22 @@ std::string DefaultStorageStage::load_data(const char *db_name,
     result_string << "No such table " << db_name << "." << table_name << std::endl;
     return result_string.str();
   }
-
-  std::fstream fs;
-  fs.open(file_name, std::ios_base::in | std::ios_base::binary);
-  if (!fs.is_open())
+  if (table->materialized_view() != nullptr)
   {
-    result_string << "Failed to open file: " << file_name
-                  << ". system error=" << strerror(errno) << std::endl;
+    result_string << "Cannot load data into materialized view " << table_name << std::endl;
     return result_string.str();
   }
 
-  struct timespec begin_time;
-  clock_gettime(CLOCK_MONOTONIC, &begin_time);
-  const int sys_field_num = table->table_meta().sys_field_num();
-  const int field_num = table->table_meta().field_num() - sys_field_num;
-
-  std::vector<Value> record_values(field_num);
-  std::string line;
-  std::vector<std::string> file_values;
-  const std::string delim("|");
-  int line_num = 0;
-  int insertion_count = 0;
-  RC rc = RC::SUCCESS;
-  while (!fs.eof() && RC::SUCCESS == rc)
+  TableLoader loader(table, load_data_options_);
+  loader.load(file_name, result_string);
+  // 导入不经过事务，表上的物化视图重新计算
+  for (MaterializedView *view : table->materialized_views())
   {
-    std::getline(fs, line);
-    line_num++;
-    if (common::is_blank(line.c_str()))
-    {
-      continue;
-    }
-
-    file_values.clear();
-    common::split_string(line, delim, file_values);
-    std::stringstream errmsg;
-    rc = insert_record_from_file(table, file_values, record_values, errmsg);
+    RC rc = view->rebuild();
     if (rc != RC::SUCCESS)
     {
-      result_string << "Line:" << line_num << " insert record failed:"
-                    << errmsg.str() << ". error:" << strrc(rc) << std::endl;
-    }
-    else
-    {
-      insertion_count++;
+      LOG_ERROR("Failed to rebuild materialized view %s. rc=%d:%s", view->name(), rc, strrc(rc));
     }
   }
-  fs.close();
-
-  struct timespec end_time;
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  long cost_nano = (end_time.tv_sec - begin_time.tv_sec) * 1000000000L + (end_time.tv_nsec - begin_time.tv_nsec);
-  if (RC::SUCCESS == rc)
-  {
-    result_string << strrc(rc) << ". total " << line_num << " line(s) handled and "
-                  << insertion_count << " record(s) loaded, total cost " << cost_nano / 1000000000.0
-                  << " second(s)" << std::endl;
-  }
   return result_string.str();
 }
\ No newline at end of file
@@ -17,6 +17,7 @@ See the Mulan PSL v2 for more details. */
 
 #include "common/seda/stage.h"
 #include "common/metrics/metrics.h"
+#include "storage/default/table_loader.h"
 
 class DefaultHandler;
 
@@ -33,11 +34,26 @@ protected:
   bool initialize() override;
   void cleanup() override;
   void handle_event(common::StageEvent *event) override;
+  void handle_events(common::StageEvent **events, int n) override;
   void callback_event(common::StageEvent *event,
                      common::CallbackContext *context) override;
 
 private:
+  /**
+   * 执行一条语句。group_commit为true时自动提交的事务不等待日志落盘，也不结束event，返回true，由handle_events处理
+   */
+  bool handle_storage_event(common::StageEvent *event, bool group_commit);
+  /**
+   * 自动提交的增删改语句，同一批中的这些语句可以共用一次日志落盘
+   */
+  bool group_committable(common::StageEvent *event) const;
   std::string load_data(const char *db_name, const char *table_name, const char *file_name);
+  void handle_compact_event(common::StageEvent *event);
+  void handle_checkpoint_event(common::StageEvent *event);
+  /**
+   * 把定时事件交给TimerStage，interval秒之后回调到本stage
+   */
+  void register_timer(common::StageEvent *event, int interval);
 
 protected:
   common::SimpleTimer *query_metric_ = nullptr;
@@ -45,6 +61,13 @@ protected:
 
 private:
   DefaultHandler * handler_;
+  TableLoaderOptions load_data_options_;
+
+  common::Stage *timer_stage_ = nullptr;
+  int compact_interval_ = 0;  // 整理记录文件的间隔(秒)，0表示不整理
+  int compact_pages_ = 64;    // 每次整理时每张表最多处理的页面数
+  int checkpoint_interval_ = 0;  // 检查是否需要checkpoint的间隔(秒)，0表示只按日志大小checkpoint
+  int recovery_time_ = 0;        // 目标恢复时间(秒)，0表示每次检查时只要写过日志就checkpoint
 };
 
 #endif //__OBSERVER_STORAGE_DEFAULT_STORAGE_STAGE_H__
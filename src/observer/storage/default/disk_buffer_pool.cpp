@@ -13,10 +13,28 @@ See the Mulan PSL v2 for more details. */
 //
 #include "disk_buffer_pool.h"
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <stddef.h>
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
+#include "common/lang/mutex.h"
 #include "common/log/log.h"
+#include "common/math/crc32c.h"
+#include "common/metrics/metrics_registry.h"
+#include "common/metrics/snapshot.h"
+#include "common/os/os.h"
+#include "common/seda/request_trace.h"
+#include "storage/default/backup.h"
+#include "storage/default/redo_log.h"
 
 using namespace common;
 
@@ -26,6 +44,215 @@ unsigned long current_time()
   clock_gettime(CLOCK_MONOTONIC, &tp);
   return tp.tv_sec * 1000 * 1000 * 1000UL + tp.tv_nsec;
 }
+#define BP_METRIC_TAG_PREFIX "DiskBufferPool."
+
+static thread_local BPThreadStat thread_stat;
+
+BPThreadStat &bp_thread_stat()
+{
+  return thread_stat;
+}
+
+BPFileMetric::BPFileMetric()
+  : hits(0), misses(0), evictions(0), dirty_flushes(0), read_bytes(0), write_bytes(0), pin_wait_ns(0),
+    checksum_errors(0)
+{
+  snapshot_value_ = nullptr;
+}
+
+BPFileMetric::~BPFileMetric()
+{
+  delete snapshot_value_;
+  snapshot_value_ = nullptr;
+}
+
+void BPFileMetric::snapshot()
+{
+  if (snapshot_value_ == nullptr) {
+    snapshot_value_ = new SnapshotBasic<std::string>();
+  }
+  std::string value = to_string();
+  ((SnapshotBasic<std::string> *)snapshot_value_)->setValue(value);
+}
+
+double BPFileMetric::hit_ratio() const
+{
+  long total = hits.load() + misses.load();
+  return total == 0 ? 0 : hits.load() * 100.0 / total;
+}
+
+std::string BPFileMetric::to_string() const
+{
+  std::stringstream ss;
+  ss << "hits:" << hits.load() << ",misses:" << misses.load() << ",hit_ratio:" << std::fixed
+     << std::setprecision(2) << hit_ratio() << ",evictions:" << evictions.load()
+     << ",dirty_flushes:" << dirty_flushes.load() << ",read_bytes:" << read_bytes.load()
+     << ",write_bytes:" << write_bytes.load() << ",pin_wait_us:" << pin_wait_ns.load() / 1000
+     << ",checksum_errors:" << checksum_errors.load();
+  return ss.str();
+}
+
+FileDescCache &FileDescCache::instance()
+{
+  static FileDescCache instance;
+  return instance;
+}
+
+FileDescCache::FileDescCache()
+{
+  MUTEX_INIT(&mutex_, nullptr);
+  set_capacity(0);
+}
+
+RC FileDescCache::set_capacity(int capacity)
+{
+  if (capacity < 0) {
+    LOG_ERROR("Invalid max open files %d", capacity);
+    return RC::INVALID_ARGUMENT;
+  }
+  if (capacity == 0) {
+    // 留一半给redo日志、网络连接和临时打开的文件
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+      capacity = (int)std::min<rlim_t>(limit.rlim_cur / 2, INT_MAX);
+    } else {
+      capacity = BP_FILE_CHUNK_SIZE;
+    }
+  }
+  MUTEX_LOCK(&mutex_);
+  capacity_ = std::max(capacity, BP_MIN_CACHED_FDS);
+  evict(capacity_);
+  MUTEX_UNLOCK(&mutex_);
+  return RC::SUCCESS;
+}
+
+void FileDescCache::link_front(BPFileHandle *file_handle)
+{
+  file_handle->fd_prev = nullptr;
+  file_handle->fd_next = lru_head_;
+  if (lru_head_ != nullptr) {
+    lru_head_->fd_prev = file_handle;
+  } else {
+    lru_tail_ = file_handle;
+  }
+  lru_head_ = file_handle;
+}
+
+void FileDescCache::unlink(BPFileHandle *file_handle)
+{
+  if (file_handle->fd_prev != nullptr) {
+    file_handle->fd_prev->fd_next = file_handle->fd_next;
+  } else {
+    lru_head_ = file_handle->fd_next;
+  }
+  if (file_handle->fd_next != nullptr) {
+    file_handle->fd_next->fd_prev = file_handle->fd_prev;
+  } else {
+    lru_tail_ = file_handle->fd_prev;
+  }
+  file_handle->fd_prev = nullptr;
+  file_handle->fd_next = nullptr;
+}
+
+void FileDescCache::evict(int limit)
+{
+  BPFileHandle *file_handle = lru_tail_;
+  while (open_count_ > limit && file_handle != nullptr) {
+    BPFileHandle *prev = file_handle->fd_prev;
+    if (file_handle->fd_refs == 0) {
+      // 写出的数据已经在内核中，之后用重新打开的fd sync同样可以落盘
+      if (close(file_handle->file_desc) != 0) {
+        LOG_WARN("Failed to close cached fd of %s. error=%s", file_handle->file_name, strerror(errno));
+      }
+      LOG_DEBUG("Close cached fd of %s", file_handle->file_name);
+      file_handle->file_desc = -1;
+      unlink(file_handle);
+      open_count_--;
+    }
+    file_handle = prev;
+  }
+}
+
+void FileDescCache::add(BPFileHandle *file_handle, int fd, int open_flags)
+{
+  MUTEX_LOCK(&mutex_);
+  evict(capacity_ - 1);
+  file_handle->file_desc = fd;
+  file_handle->open_flags = open_flags;
+  file_handle->fd_refs = 0;
+  link_front(file_handle);
+  open_count_++;
+  MUTEX_UNLOCK(&mutex_);
+}
+
+RC FileDescCache::remove(BPFileHandle *file_handle)
+{
+  RC rc = RC::SUCCESS;
+  MUTEX_LOCK(&mutex_);
+  if (file_handle->file_desc >= 0) {
+    unlink(file_handle);
+    open_count_--;
+    if (close(file_handle->file_desc) != 0) {
+      LOG_ERROR("Failed to close %s. error=%s", file_handle->file_name, strerror(errno));
+      rc = RC::IOERR_CLOSE;
+    }
+    file_handle->file_desc = -1;
+  }
+  MUTEX_UNLOCK(&mutex_);
+  return rc;
+}
+
+RC FileDescCache::acquire(BPFileHandle *file_handle, int *fd)
+{
+  MUTEX_LOCK(&mutex_);
+  if (file_handle->file_desc < 0) {
+    evict(capacity_ - 1);
+    int new_fd = open(file_handle->file_name, file_handle->open_flags);
+    if (new_fd < 0) {
+      MUTEX_UNLOCK(&mutex_);
+      LOG_ERROR("Failed to reopen %s. error=%s", file_handle->file_name, strerror(errno));
+      return RC::IOERR_ACCESS;
+    }
+    file_handle->file_desc = new_fd;
+    open_count_++;
+    reopens_++;
+  } else {
+    unlink(file_handle);
+  }
+  link_front(file_handle);
+  file_handle->fd_refs++;
+  *fd = file_handle->file_desc;
+  MUTEX_UNLOCK(&mutex_);
+  return RC::SUCCESS;
+}
+
+void FileDescCache::release(BPFileHandle *file_handle)
+{
+  MUTEX_LOCK(&mutex_);
+  file_handle->fd_refs--;
+  if (open_count_ > capacity_) {
+    // 之前所有的fd都在使用中，超过上限临时打开的fd这时关闭
+    evict(capacity_);
+  }
+  MUTEX_UNLOCK(&mutex_);
+}
+
+int FileDescCache::open_count()
+{
+  MUTEX_LOCK(&mutex_);
+  int count = open_count_;
+  MUTEX_UNLOCK(&mutex_);
+  return count;
+}
+
+long FileDescCache::reopens()
+{
+  MUTEX_LOCK(&mutex_);
+  long count = reopens_;
+  MUTEX_UNLOCK(&mutex_);
+  return count;
+}
+
 /**
  *   added for LRUReplacer function implementation
 */
@@ -42,7 +269,7 @@ bool LRUReplacer::Victim(int *frame_id) {
   *frame_id = List.front();
   List.pop_front();
   map_.erase(*frame_id);
-  std::cout<<"victim frame "<<*frame_id<<std::endl;
+  LOG_DEBUG("victim frame %d", *frame_id);
   return true;
 }
 
@@ -77,10 +304,247 @@ void LRUReplacer::Refresh(int frame_id) {
     map_[frame_id] = --List.end();
   }
 }
+void LRUReplacer::Remove(int frame_id) {
+  Pin(frame_id);
+}
+
 int LRUReplacer::Size() {
   return List.size();
 }
 
+ClockReplacer::ClockReplacer(int num_frames)
+    : num_frames_(num_frames), referenced_(num_frames, 0), evictable_(num_frames, 0) {
+}
+
+bool ClockReplacer::Victim(int *frame_id) {
+  if (size_ == 0) {
+    return false;
+  }
+  // 最多转两圈就能找到一个访问位为0的frame
+  while (true) {
+    int current = hand_;
+    hand_ = (hand_ + 1) % num_frames_;
+    if (!evictable_[current]) {
+      continue;
+    }
+    if (referenced_[current]) {
+      referenced_[current] = 0;
+      continue;
+    }
+    evictable_[current] = 0;
+    size_--;
+    *frame_id = current;
+    return true;
+  }
+}
+
+void ClockReplacer::Pin(int frame_id) {
+  if (evictable_[frame_id]) {
+    evictable_[frame_id] = 0;
+    size_--;
+  }
+  referenced_[frame_id] = 1;
+}
+
+void ClockReplacer::Unpin(int frame_id) {
+  if (!evictable_[frame_id]) {
+    evictable_[frame_id] = 1;
+    size_++;
+  }
+  referenced_[frame_id] = 1;
+}
+
+void ClockReplacer::Refresh(int frame_id) {
+  referenced_[frame_id] = 1;
+}
+
+void ClockReplacer::Remove(int frame_id) {
+  if (evictable_[frame_id]) {
+    evictable_[frame_id] = 0;
+    size_--;
+  }
+  referenced_[frame_id] = 0;
+}
+
+int ClockReplacer::Size() {
+  return size_;
+}
+
+LRUKReplacer::LRUKReplacer(int num_frames, int k)
+    : num_frames_(num_frames), k_(k), access_count_(num_frames, 0), list_of_(num_frames, NO_LIST),
+      prev_(num_frames + 2), next_(num_frames + 2) {
+  for (int list = HISTORY_LIST; list <= CACHE_LIST; list++) {
+    int sentinel = num_frames_ + list;
+    prev_[sentinel] = sentinel;
+    next_[sentinel] = sentinel;
+  }
+}
+
+void LRUKReplacer::link(int list, int frame_id) {
+  int sentinel = num_frames_ + list;
+  int tail = prev_[sentinel];
+  next_[tail] = frame_id;
+  prev_[frame_id] = tail;
+  next_[frame_id] = sentinel;
+  prev_[sentinel] = frame_id;
+  list_of_[frame_id] = list;
+  size_++;
+}
+
+void LRUKReplacer::unlink(int frame_id) {
+  next_[prev_[frame_id]] = next_[frame_id];
+  prev_[next_[frame_id]] = prev_[frame_id];
+  list_of_[frame_id] = NO_LIST;
+  size_--;
+}
+
+bool LRUKReplacer::Victim(int *frame_id) {
+  int victim = head(HISTORY_LIST);
+  if (victim >= num_frames_) {
+    victim = head(CACHE_LIST);
+    if (victim >= num_frames_) {
+      return false;
+    }
+  }
+  unlink(victim);
+  access_count_[victim] = 0;
+  *frame_id = victim;
+  return true;
+}
+
+void LRUKReplacer::Pin(int frame_id) {
+  if (list_of_[frame_id] != NO_LIST) {
+    unlink(frame_id);
+  }
+  if (access_count_[frame_id] < k_) {
+    access_count_[frame_id]++;
+  }
+}
+
+void LRUKReplacer::Unpin(int frame_id) {
+  if (list_of_[frame_id] == NO_LIST) {
+    link(access_count_[frame_id] >= k_ ? CACHE_LIST : HISTORY_LIST, frame_id);
+  }
+}
+
+void LRUKReplacer::Refresh(int frame_id) {
+  if (access_count_[frame_id] < k_) {
+    access_count_[frame_id]++;
+  }
+  if (list_of_[frame_id] != NO_LIST) {
+    unlink(frame_id);
+    link(access_count_[frame_id] >= k_ ? CACHE_LIST : HISTORY_LIST, frame_id);
+  }
+}
+
+void LRUKReplacer::Remove(int frame_id) {
+  if (list_of_[frame_id] != NO_LIST) {
+    unlink(frame_id);
+  }
+  access_count_[frame_id] = 0;
+}
+
+int LRUKReplacer::Size() {
+  return size_;
+}
+
+RC replacer_type_from_string(const char *name, ReplacerType *type) {
+  if (0 == strcasecmp(name, "lru")) {
+    *type = LRU_REPLACER;
+  } else if (0 == strcasecmp(name, "clock")) {
+    *type = CLOCK_REPLACER;
+  } else if (0 == strcasecmp(name, "lru-k") || 0 == strcasecmp(name, "lru-2")) {
+    *type = LRUK_REPLACER;
+  } else {
+    return RC::INVALID_ARGUMENT;
+  }
+  return RC::SUCCESS;
+}
+
+Replacer *create_replacer(ReplacerType type, int num_frames) {
+  switch (type) {
+    case CLOCK_REPLACER:
+      return new ClockReplacer(num_frames);
+    case LRUK_REPLACER:
+      return new LRUKReplacer(num_frames);
+    case LRU_REPLACER:
+    default:
+      return new LRUReplacer(num_frames);
+  }
+}
+
+BPManager::BPManager(int size, ReplacerType replacer_type, int page_size, int numa_node) {
+  // 所有页面作为一块连续内存分配，按照huge page大小对齐，减少TLB miss
+  arena_size_ = ((size_t)page_size * size + BP_ARENA_ALIGN - 1) / BP_ARENA_ALIGN * BP_ARENA_ALIGN;
+  void *arena = nullptr;
+  if (posix_memalign(&arena, BP_ARENA_ALIGN, arena_size_) != 0) {
+    LOG_ERROR("Failed to allocate buffer pool arena. frames=%d, bytes=%lu", size, arena_size_);
+    arena = nullptr;
+    arena_size_ = 0;
+    size = 0;
+  }
+#ifdef MADV_HUGEPAGE
+  if (arena != nullptr) {
+    madvise(arena, arena_size_, MADV_HUGEPAGE);
+  }
+#endif
+  // 在memset第一次访问之前指定节点，页面才会分配在这个节点上
+  if (arena != nullptr && numa_node >= 0 && bind_memory_to_numa_node(arena, arena_size_, numa_node) != 0) {
+    LOG_WARN("Failed to bind buffer pool arena to numa node %d. error=%s", numa_node, strerror(errno));
+  }
+  if (arena != nullptr) {
+    memset(arena, 0, arena_size_);
+  }
+
+  this->size = size;
+  this->page_size = page_size;
+  page_arena_ = (char *)arena;
+  // Frame按cache line对齐，C++14的new不保证对齐
+  void *frames = nullptr;
+  if (posix_memalign(&frames, BP_CACHE_LINE_SIZE, sizeof(Frame) * (size > 0 ? size : 1)) != 0) {
+    LOG_ERROR("Failed to allocate buffer pool frames. frames=%d", size);
+    free(page_arena_);
+    page_arena_ = nullptr;
+    arena_size_ = 0;
+    frames = nullptr;
+    this->size = size = 0;
+  } else {
+    memset(frames, 0, sizeof(Frame) * size);
+  }
+  frame = (Frame *)frames;
+  allocated = new bool[size];
+  for (int i = 0; i < size; i++) {
+    allocated[i] = false;
+    frame[i].pin_count = 0;
+    frame[i].page = (Page *)(page_arena_ + (size_t)i * page_size);
+    pthread_rwlock_init(&frame[i].latch, nullptr);
+  }
+  MUTEX_INIT(&mutex, nullptr);
+
+  // following self-add actually allocated is no longer used
+  // Initially, every frame is in the free list.
+  replacer_ = create_replacer(replacer_type, size);
+  for (int i = 0; i < size; ++i) {
+    free_list_.emplace_back(i);
+  }
+}
+
+BPManager::~BPManager() {
+  for (int i = 0; i < size; i++) {
+    pthread_rwlock_destroy(&frame[i].latch);
+  }
+  MUTEX_DESTROY(&mutex);
+  free(frame);
+  free(page_arena_);
+  page_arena_ = nullptr;
+  delete[] allocated;
+  delete replacer_;
+  size = 0;
+  arena_size_ = 0;
+  frame = nullptr;
+  allocated = nullptr;
+}
+
 int BPManager::get_replace_frame(){
   int  replace_frame_id;
   if (!free_list_.empty()) {
@@ -101,525 +565,2410 @@ Frame *BPManager::alloc() {
     return nullptr;
   }
   int replace_frame_id = this->get_replace_frame();
+  // 被淘汰的frame原来的页表项要去掉
+  unbind_frame(replace_frame_id);
   frame[replace_frame_id].acc_time=current_time();
   // 测试中没有考虑unpin或者pin,这里调用此函数是为了将其放进lru list中
   replacer_->Unpin(replace_frame_id);
   return frame+replace_frame_id;
 }
 
-Frame *BPManager::get(int file_desc, PageNum page_num) {
-  // TODO for test   比较暴力，这里需要进行优化，看测试中的file_desc赋值，暂时没想到怎么处理
-  for(int i=0;i<size;i++){
-    if(frame[i].file_desc==file_desc && frame[i].page.page_num == page_num){
-      frame[i].acc_time=current_time();
-      replacer_->Refresh(i);
-      return frame+i;
-    }
+Frame *BPManager::get(int file_id, PageNum page_num) {
+  int frame_id = find_frame(file_id, page_num);
+  if (frame_id == -1) {
+    return nullptr;
   }
-  return nullptr;
+  frame[frame_id].acc_time=current_time();
+  replacer_->Refresh(frame_id);
+  return frame+frame_id;
 }
 
+int BPManager::find_frame(int file_id, PageNum page_num) {
+  auto file_iter = page_table_.find(file_id);
+  if (file_iter == page_table_.end()) {
+    return -1;
+  }
+  auto page_iter = file_iter->second.find(page_num);
+  if (page_iter == file_iter->second.end()) {
+    return -1;
+  }
+  int frame_id = page_iter->second;
+  if (frame[frame_id].file_id != file_id || frame[frame_id].page->page_num != page_num) {
+    // frame 已经被别的页面复用了
+    file_iter->second.erase(page_iter);
+    return -1;
+  }
+  return frame_id;
+}
 
-
-DiskBufferPool *theGlobalDiskBufferPool()
-{
-  static DiskBufferPool *instance = new DiskBufferPool();
-
-  return instance;
+void BPManager::bind_frame(int file_id, PageNum page_num, int frame_id) {
+  page_table_[file_id][page_num] = frame_id;
 }
 
-RC DiskBufferPool::create_file(const char *file_name)
-{
-  int fd = open(file_name, O_RDWR | O_CREAT | O_EXCL, S_IREAD | S_IWRITE);
-  if (fd < 0) {
-    LOG_ERROR("Failed to create %s, due to %s.", file_name, strerror(errno));
-    return RC::SCHEMA_DB_EXIST;
+void BPManager::unbind_frame(int frame_id) {
+  auto file_iter = page_table_.find(frame[frame_id].file_id);
+  if (file_iter == page_table_.end()) {
+    return;
   }
-
-  close(fd);
-
-  /**
-   * Here don't care about the failure
-   */
-  fd = open(file_name, O_RDWR);
-  if (fd < 0) {
-    LOG_ERROR("Failed to open for readwrite %s, due to %s.", file_name, strerror(errno));
-    return RC::IOERR_ACCESS;
+  auto page_iter = file_iter->second.find(frame[frame_id].page->page_num);
+  if (page_iter != file_iter->second.end() && page_iter->second == frame_id) {
+    file_iter->second.erase(page_iter);
+  }
+  if (file_iter->second.empty()) {
+    page_table_.erase(file_iter);
   }
+}
 
-  Page page;
-  memset(&page, 0, sizeof(Page));
+void BPManager::free_frame(int frame_id) {
+  unbind_frame(frame_id);
+  replacer_->Remove(frame_id);
+  allocated[frame_id] = false;
+  frame[frame_id].unlogged = false;
+  free_list_.push_back(frame_id);
+}
 
-  BPFileSubHeader *fileSubHeader;
-  fileSubHeader = (BPFileSubHeader *)page.data;
-  fileSubHeader->allocated_pages = 1;
-  fileSubHeader->page_count = 1;
+static int global_buffer_pool_size = BP_BUFFER_SIZE;
+static ReplacerType global_buffer_pool_replacer = LRU_REPLACER;
+static int global_buffer_pool_dirty_ratio = BP_DEFAULT_DIRTY_RATIO;
+static PageIoType global_buffer_pool_page_io = SYNC_PAGE_IO;
+static bool global_buffer_pool_direct_io = false;
+static bool global_buffer_pool_numa = false;
+// 4k/8k/16k/32k 每种页面大小一个缓冲池，第一次使用时创建
+#define BP_PAGE_SIZE_CLASSES 4
+static DiskBufferPool *global_buffer_pools[BP_PAGE_SIZE_CLASSES] = {nullptr};
+static bool global_buffer_pool_created = false;
+static pthread_mutex_t global_buffer_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+// 缓冲池预热
+static std::string global_buffer_pool_dump_file;
+static pthread_t global_buffer_pool_warm_up_thread;
+static bool global_buffer_pool_warm_up_started = false;
+static std::atomic<bool> global_buffer_pool_warming_up{false};
+static std::atomic<bool> global_buffer_pool_warm_up_stop{false};
+
+bool is_valid_page_size(int page_size)
+{
+  return page_size >= BP_MIN_PAGE_SIZE && page_size <= BP_MAX_PAGE_SIZE && (page_size & (page_size - 1)) == 0;
+}
 
-  char *bitmap = page.data + (int)BP_FILE_SUB_HDR_SIZE;
-  bitmap[0] |= 0x01;
-  if (lseek(fd, 0, SEEK_SET) == -1) {
-    LOG_ERROR("Failed to seek file %s to position 0, due to %s .", file_name, strerror(errno));
-    close(fd);
-    return RC::IOERR_SEEK;
+RC set_global_buffer_pool_size(int pool_size)
+{
+  if (pool_size <= 0) {
+    LOG_ERROR("Invalid buffer pool size %d", pool_size);
+    return RC::INVALID_ARGUMENT;
   }
-
-  if (write(fd, (char *)&page, sizeof(Page)) != sizeof(Page)) {
-    LOG_ERROR("Failed to write header to file %s, due to %s.", file_name, strerror(errno));
-    close(fd);
-    return RC::IOERR_WRITE;
+  if (global_buffer_pool_created) {
+    LOG_WARN("Global buffer pool has been created, cannot resize to %d", pool_size);
+    return RC::GENERIC_ERROR;
   }
+  global_buffer_pool_size = pool_size;
+  return RC::SUCCESS;
+}
 
-  close(fd);
-  LOG_INFO("Successfully create %s.", file_name);
+RC set_global_buffer_pool_replacer(ReplacerType replacer_type)
+{
+  if (global_buffer_pool_created) {
+    LOG_WARN("Global buffer pool has been created, cannot change replacer");
+    return RC::GENERIC_ERROR;
+  }
+  global_buffer_pool_replacer = replacer_type;
   return RC::SUCCESS;
 }
 
-RC DiskBufferPool::open_file(const char *file_name, int *file_id)
+RC set_global_buffer_pool_dirty_ratio(int dirty_ratio)
 {
-  int fd, i;
-  // This part isn't gentle, the better method is using LRU queue.
-  for (i = 0; i < MAX_OPEN_FILE; i++) {
-    if (open_list_[i]) {
-      if (!strcmp(open_list_[i]->file_name, file_name)) {
-        *file_id = i;
-        LOG_INFO("%s has already been opened.", file_name);
-        return RC::SUCCESS;
-      }
-    }
+  if (dirty_ratio < 0 || dirty_ratio > 100) {
+    LOG_ERROR("Invalid buffer pool dirty ratio %d", dirty_ratio);
+    return RC::INVALID_ARGUMENT;
   }
-  i = 0;
-  while (i < MAX_OPEN_FILE && open_list_[i++])
-    ;
-  if (i >= MAX_OPEN_FILE && open_list_[i - 1]) {
-    LOG_ERROR("Failed to open file %s, because too much files has been opened.", file_name);
-    return RC::BUFFERPOOL_OPEN_TOO_MANY_FILES;
+  if (global_buffer_pool_created) {
+    LOG_WARN("Global buffer pool has been created, cannot change dirty ratio");
+    return RC::GENERIC_ERROR;
   }
+  global_buffer_pool_dirty_ratio = dirty_ratio;
+  return RC::SUCCESS;
+}
 
-  if ((fd = open(file_name, O_RDWR)) < 0) {
-    LOG_ERROR("Failed to open file %s, because %s.", file_name, strerror(errno));
-    return RC::IOERR_ACCESS;
+RC set_global_buffer_pool_page_io(PageIoType page_io_type)
+{
+  if (global_buffer_pool_created) {
+    LOG_WARN("Global buffer pool has been created, cannot change page io");
+    return RC::GENERIC_ERROR;
   }
-  LOG_INFO("Successfully open file %s.", file_name);
+  global_buffer_pool_page_io = page_io_type;
+  return RC::SUCCESS;
+}
 
-  BPFileHandle *file_handle = new (std::nothrow) BPFileHandle();
-  if (file_handle == nullptr) {
-    LOG_ERROR("Failed to alloc memory of BPFileHandle for %s.", file_name);
-    close(fd);
-    return RC::NOMEM;
+RC set_global_buffer_pool_direct_io(bool direct_io)
+{
+  if (global_buffer_pool_created) {
+    LOG_WARN("Global buffer pool has been created, cannot change direct io");
+    return RC::GENERIC_ERROR;
   }
+  global_buffer_pool_direct_io = direct_io;
+  return RC::SUCCESS;
+}
 
-  RC tmp;
-  file_handle->bopen = true;
-  int file_name_len = strlen(file_name) + 1;
-  char *cloned_file_name = new char[file_name_len];
-  snprintf(cloned_file_name, file_name_len, "%s", file_name);
-  cloned_file_name[file_name_len - 1] = '\0';
-  file_handle->file_name = cloned_file_name;
-  file_handle->file_desc = fd;
-  if ((tmp = allocate_block(&file_handle->hdr_frame)) != RC::SUCCESS) {
-    LOG_ERROR("Failed to allocate block for %s's BPFileHandle.", file_name);
-    delete file_handle;
-    close(fd);
-    return tmp;
-  }
-  file_handle->hdr_frame->dirty = false;
-  file_handle->hdr_frame->acc_time = current_time();
-  file_handle->hdr_frame->file_desc = fd;
-  file_handle->hdr_frame->pin_count = 1;
-  if ((tmp = load_page(0, file_handle, file_handle->hdr_frame)) != RC::SUCCESS) {
-    file_handle->hdr_frame->pin_count = 0;
-    dispose_block(file_handle->hdr_frame);
-    close(fd);
-    delete file_handle;
-    return tmp;
+RC set_global_buffer_pool_numa(bool numa)
+{
+  if (global_buffer_pool_created) {
+    LOG_WARN("Global buffer pool has been created, cannot change numa");
+    return RC::GENERIC_ERROR;
   }
-
-  file_handle->hdr_page = &(file_handle->hdr_frame->page);
-  file_handle->bitmap = file_handle->hdr_page->data + BP_FILE_SUB_HDR_SIZE;
-  file_handle->file_sub_header = (BPFileSubHeader *)file_handle->hdr_page->data;
-  open_list_[i - 1] = file_handle;
-  *file_id = i - 1;
-  LOG_INFO("Successfully open %s. file_id=%d, hdr_frame=%p", file_name, *file_id, file_handle->hdr_frame);
+  global_buffer_pool_numa = numa;
   return RC::SUCCESS;
 }
 
-RC DiskBufferPool::close_file(int file_id)
+RC set_global_buffer_pool_max_open_files(int max_open_files)
 {
-  RC tmp;
-  if ((tmp = check_file_id(file_id)) != RC::SUCCESS) {
-    LOG_ERROR("Failed to close file, due to invalid fileId %d", file_id);
-    return tmp;
-  }
+  return FileDescCache::instance().set_capacity(max_open_files);
+}
 
-  BPFileHandle *file_handle = open_list_[file_id];
-  file_handle->hdr_frame->pin_count--;
-  if ((tmp = force_all_pages(file_handle)) != RC::SUCCESS) {
-    file_handle->hdr_frame->pin_count++;
-    LOG_ERROR("Failed to closeFile %d:%s, due to failed to force all pages.", file_id, file_handle->file_name);
-    return tmp;
+static DiskBufferPool *create_global_buffer_pool(int page_size)
+{
+  // 不同页面大小的缓冲池使用相同大小的内存，但至少有BP_BUFFER_SIZE个frame
+  int pool_size = (int)((long long)global_buffer_pool_size * BP_PAGE_SIZE / page_size);
+  if (pool_size < BP_BUFFER_SIZE) {
+    pool_size = BP_BUFFER_SIZE;
+  }
+  DiskBufferPool *pool =
+      new DiskBufferPool(pool_size, global_buffer_pool_replacer, global_buffer_pool_page_io, page_size,
+                         global_buffer_pool_numa);
+  pool->set_direct_io(global_buffer_pool_direct_io);
+  LOG_INFO("Create global buffer pool with %d frames of %d bytes, %d shards, page io %s, direct io %d, numa %d",
+           pool->pool_size(), page_size, pool->shard_num(), pool->page_io_name(), global_buffer_pool_direct_io,
+           global_buffer_pool_numa);
+  if (global_buffer_pool_dirty_ratio > 0) {
+    pool->start_flusher(global_buffer_pool_dirty_ratio);
+  }
+  return pool;
+}
+
+DiskBufferPool *theGlobalDiskBufferPool(int page_size)
+{
+  if (!is_valid_page_size(page_size)) {
+    LOG_ERROR("Invalid page size %d", page_size);
+    return nullptr;
+  }
+  int index = 0;
+  while ((BP_MIN_PAGE_SIZE << index) < page_size) {
+    index++;
   }
 
-  if (close(file_handle->file_desc) < 0) {
-    LOG_ERROR("Failed to close fileId:%d, fileName:%s, error:%s", file_id, file_handle->file_name, strerror(errno));
-    return RC::IOERR_CLOSE;
+  MUTEX_LOCK(&global_buffer_pool_mutex);
+  if (global_buffer_pools[index] == nullptr) {
+    global_buffer_pools[index] = create_global_buffer_pool(page_size);
+    global_buffer_pool_created = true;
   }
-  open_list_[file_id] = nullptr;
-  delete (file_handle);
-  LOG_INFO("Successfully close file %d:%s.", file_id, file_handle->file_name);
+  DiskBufferPool *pool = global_buffer_pools[index];
+  MUTEX_UNLOCK(&global_buffer_pool_mutex);
+  return pool;
+}
+
+RC log_global_buffer_pool_pages(int64_t trx_id, bool wait_durable)
+{
+  RedoLog &redo_log = RedoLog::instance();
+  if (!redo_log.enabled()) {
+    return RC::SUCCESS;
+  }
+  // 别的线程可能已经把这个事务修改的页面写到了日志中，log_pages返回的LSN包括这些页面
+  uint64_t lsn = 0;
+  MUTEX_LOCK(&global_buffer_pool_mutex);
+  for (int i = 0; i < BP_PAGE_SIZE_CLASSES; i++) {
+    if (global_buffer_pools[i] != nullptr) {
+      lsn = std::max(lsn, global_buffer_pools[i]->log_pages(false));
+    }
+  }
+  MUTEX_UNLOCK(&global_buffer_pool_mutex);
+  if (trx_id != 0) {
+    lsn = redo_log.append_commit(trx_id);
+  }
+  if (!wait_durable) {
+    redo_log.flush_async(lsn);
+    return RC::SUCCESS;
+  }
+  // 只读的语句没有需要等待的日志，durable_lsn已经超过lsn时不会fsync
+  return redo_log.flush(lsn);
+}
+
+RC checkpoint_global_buffer_pools()
+{
+  RC rc = RC::SUCCESS;
+  MUTEX_LOCK(&global_buffer_pool_mutex);
+  for (int i = 0; i < BP_PAGE_SIZE_CLASSES && rc == RC::SUCCESS; i++) {
+    if (global_buffer_pools[i] != nullptr) {
+      rc = global_buffer_pools[i]->checkpoint();
+    }
+  }
+  MUTEX_UNLOCK(&global_buffer_pool_mutex);
+  // 进程没有正常关闭时，重启之后用最近一次checkpoint时的页面列表预热
+  if (rc == RC::SUCCESS && !global_buffer_pool_warming_up) {
+    dump_global_buffer_pool_pages();
+  }
+  return rc;
+}
+
+RC apply_global_buffer_pool_page(const char *file_name, int page_size, PageNum page_num, const char *data)
+{
+  RC rc = RC::NOTFOUND;
+  if (is_valid_page_size(page_size)) {
+    int index = 0;
+    while ((BP_MIN_PAGE_SIZE << index) < page_size) {
+      index++;
+    }
+    MUTEX_LOCK(&global_buffer_pool_mutex);
+    DiskBufferPool *pool = global_buffer_pools[index];
+    MUTEX_UNLOCK(&global_buffer_pool_mutex);
+    if (pool != nullptr) {
+      rc = pool->apply_page(file_name, page_num, data);
+    }
+  }
+  if (rc != RC::NOTFOUND) {
+    return rc;
+  }
+  std::map<PageNum, std::string> pages;
+  pages[page_num].assign(data, page_size);
+  return DiskBufferPool::restore_pages(file_name, page_size, pages);
+}
+
+void dump_global_buffer_pool_status(std::ostream &os)
+{
+  os << "page_size | frames | dirty_pages | file | hits | misses | hit_ratio | evictions | dirty_flushes"
+     << " | read_bytes | write_bytes | pin_wait_us | checksum_errors" << std::endl;
+  MUTEX_LOCK(&global_buffer_pool_mutex);
+  for (int i = 0; i < BP_PAGE_SIZE_CLASSES; i++) {
+    if (global_buffer_pools[i] != nullptr) {
+      global_buffer_pools[i]->dump_status(os);
+    }
+  }
+  MUTEX_UNLOCK(&global_buffer_pool_mutex);
+}
+
+void set_global_buffer_pool_dump_file(const std::string &dump_file)
+{
+  global_buffer_pool_dump_file = dump_file;
+}
+
+RC dump_global_buffer_pool_pages()
+{
+  if (global_buffer_pool_dump_file.empty()) {
+    return RC::SUCCESS;
+  }
+  // 每行一个页面: 页面大小 文件名 页号
+  std::vector<std::pair<int, std::vector<std::pair<std::string, PageNum>>>> pool_pages;
+  MUTEX_LOCK(&global_buffer_pool_mutex);
+  for (int i = 0; i < BP_PAGE_SIZE_CLASSES; i++) {
+    if (global_buffer_pools[i] != nullptr) {
+      pool_pages.emplace_back(global_buffer_pools[i]->page_size(), std::vector<std::pair<std::string, PageNum>>());
+      global_buffer_pools[i]->resident_pages(pool_pages.back().second);
+    }
+  }
+  MUTEX_UNLOCK(&global_buffer_pool_mutex);
+
+  std::string tmp_file = global_buffer_pool_dump_file + ".tmp";
+  FILE *file = fopen(tmp_file.c_str(), "w");
+  if (file == nullptr) {
+    LOG_ERROR("Failed to open buffer pool dump file %s. error=%s", tmp_file.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  int page_num = 0;
+  for (const auto &pages : pool_pages) {
+    for (const auto &page : pages.second) {
+      fprintf(file, "%d %s %d\n", pages.first, page.first.c_str(), page.second);
+      page_num++;
+    }
+  }
+  bool failed = ferror(file) != 0;
+  failed = fclose(file) != 0 || failed;
+  if (failed || rename(tmp_file.c_str(), global_buffer_pool_dump_file.c_str()) != 0) {
+    LOG_ERROR("Failed to write buffer pool dump file %s. error=%s", global_buffer_pool_dump_file.c_str(), strerror(errno));
+    remove(tmp_file.c_str());
+    return RC::IOERR_WRITE;
+  }
+  LOG_INFO("Dump %d buffer pool pages to %s", page_num, global_buffer_pool_dump_file.c_str());
   return RC::SUCCESS;
 }
 
-RC DiskBufferPool::get_this_page(int file_id, PageNum page_num, BPPageHandle *page_handle)
+static void *buffer_pool_warm_up_routine(void *arg)
 {
-  RC tmp;
-  if ((tmp = check_file_id(file_id)) != RC::SUCCESS) {
-    LOG_ERROR("Failed to load page %d, due to invalid fileId %d", page_num, file_id);
-    return tmp;
+  // 按缓冲池和文件分组，同一个文件的页面已经按页号排好序
+  std::map<std::pair<int, std::string>, std::vector<PageNum>> file_pages;
+  FILE *file = fopen(global_buffer_pool_dump_file.c_str(), "r");
+  if (file != nullptr) {
+    char line[PATH_MAX + 64];
+    char file_name[PATH_MAX + 1];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+      int page_size = 0;
+      PageNum page_num = 0;
+      if (sscanf(line, "%d %4096s %d", &page_size, file_name, &page_num) != 3) {
+        LOG_WARN("Skip invalid line in buffer pool dump file: %s", line);
+        continue;
+      }
+      file_pages[std::make_pair(page_size, std::string(file_name))].push_back(page_num);
+    }
+    fclose(file);
   }
 
-  BPFileHandle *file_handle = open_list_[file_id];
-  if ((tmp = check_page_num(page_num, file_handle)) != RC::SUCCESS) {
-    LOG_ERROR("Failed to load page %s:%d, due to invalid pageNum.", file_handle->file_name, page_num);
-    return tmp;
+  unsigned long begin_time = current_time();
+  int total = 0;
+  int loaded = 0;
+  for (auto &iter : file_pages) {
+    if (global_buffer_pool_warm_up_stop) {
+      break;
+    }
+    // 只预热已经创建的缓冲池，没有这种页面大小的文件打开时不用创建
+    DiskBufferPool *pool = nullptr;
+    MUTEX_LOCK(&global_buffer_pool_mutex);
+    for (int i = 0; i < BP_PAGE_SIZE_CLASSES; i++) {
+      if (global_buffer_pools[i] != nullptr && global_buffer_pools[i]->page_size() == iter.first.first) {
+        pool = global_buffer_pools[i];
+      }
+    }
+    MUTEX_UNLOCK(&global_buffer_pool_mutex);
+    total += (int)iter.second.size();
+    if (pool != nullptr) {
+      loaded += pool->warm_up(iter.first.second, iter.second, global_buffer_pool_warm_up_stop);
+    }
   }
+  LOG_INFO("Warm up buffer pool %s, loaded %d of %d pages in %lu ms",
+           global_buffer_pool_warm_up_stop ? "stopped" : "finished", loaded, total,
+           (current_time() - begin_time) / 1000000);
+  global_buffer_pool_warming_up = false;
+  return nullptr;
+}
 
-  for (int i = 0; i < BP_BUFFER_SIZE; i++) {
-    if (!bp_manager_.allocated[i])
-      continue;
-    if (bp_manager_.frame[i].file_desc != file_handle->file_desc)
-      continue;
+RC start_global_buffer_pool_warm_up()
+{
+  if (global_buffer_pool_dump_file.empty() || access(global_buffer_pool_dump_file.c_str(), R_OK) != 0) {
+    return RC::SUCCESS;
+  }
+  global_buffer_pool_warm_up_stop = false;
+  global_buffer_pool_warming_up = true;
+  if (pthread_create(&global_buffer_pool_warm_up_thread, nullptr, buffer_pool_warm_up_routine, nullptr) != 0) {
+    global_buffer_pool_warming_up = false;
+    LOG_ERROR("Failed to create buffer pool warm up thread. error=%s", strerror(errno));
+    return RC::GENERIC_ERROR;
+  }
+  global_buffer_pool_warm_up_started = true;
+  LOG_INFO("Start to warm up buffer pool from %s", global_buffer_pool_dump_file.c_str());
+  return RC::SUCCESS;
+}
 
-    // This page has been loaded.
-    if (bp_manager_.frame[i].page.page_num == page_num) {
-      page_handle->frame = bp_manager_.frame + i;
-      page_handle->frame->pin_count++;
-      page_handle->frame->acc_time = current_time();
-      page_handle->open = true;
-      return RC::SUCCESS;
+void stop_global_buffer_pool_warm_up()
+{
+  if (!global_buffer_pool_warm_up_started) {
+    return;
+  }
+  global_buffer_pool_warm_up_stop = true;
+  pthread_join(global_buffer_pool_warm_up_thread, nullptr);
+  global_buffer_pool_warm_up_started = false;
+}
+
+DiskBufferPool::DiskBufferPool(
+    int pool_size, ReplacerType replacer_type, PageIoType page_io_type, int page_size, bool numa)
+  : page_size_(page_size)
+{
+  if (!is_valid_page_size(page_size_)) {
+    LOG_ERROR("Invalid page size %d, use %d instead", page_size_, BP_PAGE_SIZE);
+    page_size_ = BP_PAGE_SIZE;
+  }
+  int shard_num = pool_size / BP_MIN_SHARD_FRAMES;
+  if (shard_num > BP_MAX_SHARD_NUM) {
+    shard_num = BP_MAX_SHARD_NUM;
+  }
+  if (shard_num < 1) {
+    shard_num = 1;
+  }
+
+  // 分片轮流分配在各个numa节点上，不再都挤在第一次访问内存的线程所在的节点
+  std::vector<int> numa_nodes;
+  if (numa) {
+    get_numa_nodes(numa_nodes);
+  }
+  for (int i = 0; i < shard_num; i++) {
+    int shard_size = pool_size / shard_num + (i < pool_size % shard_num ? 1 : 0);
+    int numa_node = numa_nodes.size() > 1 ? numa_nodes[i % numa_nodes.size()] : -1;
+    BPManager *shard = new BPManager(shard_size, replacer_type, page_size_, numa_node);
+    pool_size_ += shard->size;
+    shards_.push_back(shard);
+  }
+  page_io_ = create_page_io(page_io_type);
+  MUTEX_INIT(&open_mutex_, nullptr);
+  MUTEX_INIT(&flusher_mutex_, nullptr);
+  COND_INIT(&flusher_cond_, nullptr);
+}
+
+DiskBufferPool::~DiskBufferPool()
+{
+  stop_flusher();
+  COND_DESTROY(&flusher_cond_);
+  MUTEX_DESTROY(&flusher_mutex_);
+  for (BPManager *shard : shards_) {
+    delete shard;
+  }
+  shards_.clear();
+  delete page_io_;
+  page_io_ = nullptr;
+  for (int i = 0; i < BP_MAX_FILE_CHUNKS; i++) {
+    delete[] file_chunks_[i];
+  }
+  MUTEX_DESTROY(&open_mutex_);
+}
+
+BPManager &DiskBufferPool::shard_of(int file_id, PageNum page_num)
+{
+  // 同一个文件的连续页面会落在不同的分片上
+  unsigned int hash = (unsigned int)file_id * 2654435761U + (unsigned int)page_num;
+  return *shards_[hash % shards_.size()];
+}
+
+RC DiskBufferPool::alloc_file_id(int *file_id)
+{
+  if (!free_file_ids_.empty()) {
+    *file_id = free_file_ids_.back();
+    free_file_ids_.pop_back();
+    return RC::SUCCESS;
+  }
+  int chunk = file_slots_ / BP_FILE_CHUNK_SIZE;
+  if (chunk >= BP_MAX_FILE_CHUNKS) {
+    return RC::BUFFERPOOL_OPEN_TOO_MANY_FILES;
+  }
+  BPFileHandle **handles = new (std::nothrow) BPFileHandle *[BP_FILE_CHUNK_SIZE]();
+  if (handles == nullptr) {
+    return RC::NOMEM;
+  }
+  file_chunks_[chunk] = handles;
+  // 新的一块中的编号从大到小放进空闲列表，先使用小的编号
+  for (int i = file_slots_ + BP_FILE_CHUNK_SIZE - 1; i > file_slots_; i--) {
+    free_file_ids_.push_back(i);
+  }
+  *file_id = file_slots_;
+  file_slots_ += BP_FILE_CHUNK_SIZE;
+  return RC::SUCCESS;
+}
+
+PageNum page_checksum(PageNum page_num, const Page *page, int page_size)
+{
+  uint32_t crc = common::crc32c(0, &page_num, sizeof(page_num));
+  crc = common::crc32c(crc, page->data, page_size - sizeof(PageNum));
+  return (PageNum)(crc & 0x7fffffff);
+}
+
+/**
+ * 准备写到磁盘上的页面，返回要写的字节数，要写的数据放在data中。
+ * 带校验和的页面复制到image中，开头的页号换成校验和；compression不是NONE时压缩到image中；
+ * 都不需要时data就是page本身。image至少有page_size个字节，按块对齐，O_DIRECT也可以直接写
+ */
+static int page_image(
+    const Page *page, int page_size, bool checksum, PageCompression compression, char *image, const char **data)
+{
+  *data = (const char *)page;
+  if (checksum) {
+    memcpy(image, page, page_size);
+    ((Page *)image)->page_num = page_checksum(page->page_num, page, page_size);
+    *data = image;
+  }
+  if (compression == PAGE_COMPRESSION_NONE) {
+    return page_size;
+  }
+  if (!checksum) {
+    int compressed_len = compress_page(compression, (const char *)page, page_size, image);
+    if (compressed_len <= 0) {
+      return page_size;
     }
+    *data = image;
+    return compressed_len;
+  }
+  // 压缩的输入和输出不能重叠，先压缩到线程自己的缓冲区中再复制回来
+  static thread_local std::vector<char> compressed;
+  compressed.resize(page_size);
+  int compressed_len = compress_page(compression, image, page_size, compressed.data());
+  if (compressed_len <= 0) {
+    return page_size;
   }
+  memcpy(image, compressed.data(), compressed_len);
+  return compressed_len;
+}
 
-  // Allocate one page and load the data into this page
-  if ((tmp = allocate_block(&(page_handle->frame))) != RC::SUCCESS) {
-    LOG_ERROR("Failed to load page %s:%d, due to failed to alloc page.", file_handle->file_name, page_num);
+RC DiskBufferPool::create_file(const char *file_name, PageCompression compression)
+{
+  if (!page_compression_supported(compression)) {
+    LOG_ERROR("Failed to create %s, page compression %s is not supported by this build.",
+              file_name, page_compression_name(compression));
+    return RC::INVALID_ARGUMENT;
+  }
+
+  int fd = open(file_name, O_RDWR | O_CREAT | O_EXCL, S_IREAD | S_IWRITE);
+  if (fd < 0) {
+    LOG_ERROR("Failed to create %s, due to %s.", file_name, strerror(errno));
+    return RC::SCHEMA_DB_EXIST;
+  }
+
+  close(fd);
+
+  /**
+   * Here don't care about the failure
+   */
+  fd = open(file_name, O_RDWR);
+  if (fd < 0) {
+    LOG_ERROR("Failed to open for readwrite %s, due to %s.", file_name, strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+
+  std::vector<char> buffer(page_size_, 0);
+  Page *page = (Page *)buffer.data();
+
+  BPFileSubHeader *fileSubHeader;
+  fileSubHeader = (BPFileSubHeader *)page->data;
+  fileSubHeader->allocated_pages = 1;
+  fileSubHeader->page_count = 1;
+  fileSubHeader->page_size = page_size_ | (compression << BP_FILE_COMPRESSION_SHIFT) | BP_FILE_CHECKSUM_FLAG;
+
+  char *bitmap = page->data + (int)BP_FILE_SUB_HDR_SIZE;
+  bitmap[0] |= 0x01;
+  page->page_num = page_checksum(0, page, page_size_);
+  if (pwrite(fd, page, page_size_, 0) != page_size_) {
+    LOG_ERROR("Failed to write header to file %s, due to %s.", file_name, strerror(errno));
+    close(fd);
+    return RC::IOERR_WRITE;
+  }
+
+  close(fd);
+  // 同名的文件以前可能被删除过，日志中它的页面在恢复时不能再写到新文件中
+  RedoLog &redo_log = RedoLog::instance();
+  if (redo_log.enabled()) {
+    RC rc = redo_log.flush(redo_log.append_file_create(file_name));
+    if (rc != RC::SUCCESS) {
+      LOG_ERROR("Failed to write redo log of creating %s.", file_name);
+      return rc;
+    }
+  }
+  LOG_INFO("Successfully create %s with page size %d, compression %s.",
+           file_name, page_size_, page_compression_name(compression));
+  return RC::SUCCESS;
+}
+
+/**
+ * 读取文件头中的页面大小、压缩方式和页面是否带有校验和。
+ * legacy表示是没有记录页面大小的旧版本文件，bitmap紧跟在page_size字段的位置
+ */
+static RC read_page_size(
+    int fd, const char *file_name, int *page_size, PageCompression *compression, bool *checksum, bool *legacy)
+{
+  char buffer[sizeof(PageNum) + sizeof(BPFileSubHeader)];
+  if (pread(fd, buffer, sizeof(buffer), 0) != sizeof(buffer)) {
+    LOG_ERROR("Failed to read header of %s, due to %s.", file_name, strerror(errno));
+    return RC::IOERR_READ;
+  }
+  BPFileSubHeader *file_sub_header = (BPFileSubHeader *)(buffer + sizeof(PageNum));
+  // 旧版本文件中这个位置是bitmap的前4个字节，第0页总是被分配，所以一定是奇数
+  // 低16位同样是奇数，不会被当成合法的页面大小
+  int value = file_sub_header->page_size;
+  *legacy = !is_valid_page_size(value & BP_FILE_PAGE_SIZE_MASK);
+  *page_size = *legacy ? BP_PAGE_SIZE : (value & BP_FILE_PAGE_SIZE_MASK);
+  *compression = *legacy ? PAGE_COMPRESSION_NONE
+                         : (PageCompression)(((unsigned int)value >> BP_FILE_COMPRESSION_SHIFT) & BP_FILE_COMPRESSION_MASK);
+  *checksum = !*legacy && ((unsigned int)value & BP_FILE_CHECKSUM_FLAG) != 0;
+  return RC::SUCCESS;
+}
+
+RC DiskBufferPool::read_file_page_size(const char *file_name, int *page_size)
+{
+  int fd = open(file_name, O_RDONLY);
+  if (fd < 0) {
+    LOG_ERROR("Failed to open file %s, because %s.", file_name, strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  bool legacy = false;
+  bool checksum = false;
+  PageCompression compression = PAGE_COMPRESSION_NONE;
+  RC rc = read_page_size(fd, file_name, page_size, &compression, &checksum, &legacy);
+  close(fd);
+  return rc;
+}
+
+RC DiskBufferPool::open_file(const char *file_name, int *file_id)
+{
+  int fd;
+  MUTEX_LOCK(&open_mutex_);
+  auto id_iter = file_ids_.find(file_name);
+  if (id_iter != file_ids_.end()) {
+    *file_id = id_iter->second;
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_INFO("%s has already been opened.", file_name);
+    return RC::SUCCESS;
+  }
+
+  if ((fd = open(file_name, O_RDWR)) < 0) {
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_ERROR("Failed to open file %s, because %s.", file_name, strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  LOG_INFO("Successfully open file %s.", file_name);
+
+  int file_page_size = 0;
+  PageCompression compression = PAGE_COMPRESSION_NONE;
+  bool checksum = false;
+  bool legacy = false;
+  RC tmp = read_page_size(fd, file_name, &file_page_size, &compression, &checksum, &legacy);
+  if (tmp != RC::SUCCESS || file_page_size != page_size_) {
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_ERROR("Failed to open file %s, page size of file is %d, but buffer pool's is %d.",
+              file_name, file_page_size, page_size_);
+    close(fd);
+    return tmp != RC::SUCCESS ? tmp : RC::INVALID_ARGUMENT;
+  }
+  if (!page_compression_supported(compression)) {
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_ERROR("Failed to open file %s, page compression %s is not supported by this build.",
+              file_name, page_compression_name(compression));
+    close(fd);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  // 文件头已经用普通IO读过了，这之后的读写都是整页、按页对齐的，可以绕过page cache
+  bool direct_io = false;
+  int open_flags = O_RDWR;
+  if (direct_io_) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags != -1 && fcntl(fd, F_SETFL, flags | O_DIRECT) == 0) {
+      direct_io = true;
+      open_flags |= O_DIRECT;
+    } else {
+      LOG_WARN("Failed to enable O_DIRECT on %s, use buffered io instead. error=%s", file_name, strerror(errno));
+    }
+  }
+
+  int new_file_id = -1;
+  if ((tmp = alloc_file_id(&new_file_id)) != RC::SUCCESS) {
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_ERROR("Failed to open file %s, because too much files has been opened.", file_name);
+    close(fd);
     return tmp;
   }
-  page_handle->frame->dirty = false;
-  page_handle->frame->file_desc = file_handle->file_desc;
-  page_handle->frame->pin_count = 1;
-  page_handle->frame->acc_time = current_time();
-  if ((tmp = load_page(page_num, file_handle, page_handle->frame)) != RC::SUCCESS) {
-    LOG_ERROR("Failed to load page %s:%d", file_handle->file_name, page_num);
-    page_handle->frame->pin_count = 0;
-    dispose_block(page_handle->frame);
+  BPFileHandle *file_handle = new (std::nothrow) BPFileHandle();
+  if (file_handle == nullptr) {
+    free_file_ids_.push_back(new_file_id);
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_ERROR("Failed to alloc memory of BPFileHandle for %s.", file_name);
+    close(fd);
+    return RC::NOMEM;
+  }
+
+  file_handle->bopen = true;
+  int file_name_len = strlen(file_name) + 1;
+  char *cloned_file_name = new char[file_name_len];
+  snprintf(cloned_file_name, file_name_len, "%s", file_name);
+  cloned_file_name[file_name_len - 1] = '\0';
+  file_handle->file_name = cloned_file_name;
+  file_handle->file_id = new_file_id;
+  file_handle->direct_io = direct_io;
+  file_handle->checksum = checksum;
+  file_handle->metric = new BPFileMetric();
+  FileDescCache &fd_cache = FileDescCache::instance();
+  fd_cache.add(file_handle, fd, open_flags);
+
+  BPManager &shard = shard_of(new_file_id, 0);
+  MUTEX_LOCK(&shard.mutex);
+  if ((tmp = allocate_block(shard, &file_handle->hdr_frame)) != RC::SUCCESS) {
+    MUTEX_UNLOCK(&shard.mutex);
+    free_file_ids_.push_back(new_file_id);
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_ERROR("Failed to allocate block for %s's BPFileHandle.", file_name);
+    fd_cache.remove(file_handle);
+    delete file_handle->metric;
+    delete[] file_handle->file_name;
+    delete file_handle;
+    return tmp;
+  }
+  bind_file(file_handle->hdr_frame, file_handle);
+  file_handle->hdr_frame->acc_time = current_time();
+  file_handle->hdr_frame->compression = PAGE_COMPRESSION_NONE;
+  file_handle->hdr_frame->pin_count = 1;
+  if ((tmp = load_page(0, file_handle, file_handle->hdr_frame)) != RC::SUCCESS) {
+    file_handle->hdr_frame->pin_count = 0;
+    dispose_block(shard, file_handle->hdr_frame);
+    MUTEX_UNLOCK(&shard.mutex);
+    free_file_ids_.push_back(new_file_id);
+    MUTEX_UNLOCK(&open_mutex_);
+    fd_cache.remove(file_handle);
+    delete file_handle->metric;
+    delete[] file_handle->file_name;
+    delete file_handle;
     return tmp;
   }
+  shard.bind_frame(new_file_id, 0, file_handle->hdr_frame - shard.frame);
+  shard.replacer_->Pin(file_handle->hdr_frame - shard.frame);
+  MUTEX_UNLOCK(&shard.mutex);
 
-  page_handle->open = true;
+  file_handle->hdr_page = file_handle->hdr_frame->page;
+  file_handle->file_sub_header = (BPFileSubHeader *)file_handle->hdr_page->data;
+  int bitmap_offset = legacy ? (int)offsetof(BPFileSubHeader, page_size) : (int)BP_FILE_SUB_HDR_SIZE;
+  file_handle->bitmap = file_handle->hdr_page->data + bitmap_offset;
+  file_handle->max_page_count = (page_data_size() - bitmap_offset) * 8;
+  // 文件头页已经按原样读进来了，之后的页面才需要解压
+  file_handle->compression = compression;
+  MUTEX_INIT(&file_handle->mutex, nullptr);
+  file_handle->metric_registered =
+      get_metrics_registry().register_metric(std::string(BP_METRIC_TAG_PREFIX) + file_name, file_handle->metric);
+  file_chunks_[new_file_id / BP_FILE_CHUNK_SIZE][new_file_id % BP_FILE_CHUNK_SIZE] = file_handle;
+  file_ids_[file_handle->file_name] = new_file_id;
+  *file_id = new_file_id;
+  MUTEX_UNLOCK(&open_mutex_);
+  LOG_INFO("Successfully open %s. file_id=%d, hdr_frame=%p", file_name, *file_id, file_handle->hdr_frame);
   return RC::SUCCESS;
 }
 
-RC DiskBufferPool::allocate_page(int file_id, BPPageHandle *page_handle)
+RC DiskBufferPool::close_file(int file_id)
+{
+  return close_file(file_id, false);
+}
+
+RC DiskBufferPool::drop_file(int file_id)
+{
+  return close_file(file_id, true);
+}
+
+RC DiskBufferPool::close_file(int file_id, bool discard)
 {
   RC tmp;
+  MUTEX_LOCK(&open_mutex_);
   if ((tmp = check_file_id(file_id)) != RC::SUCCESS) {
-    LOG_ERROR("Failed to alloc page, due to invalid fileId %d", file_id);
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_ERROR("Failed to close file, due to invalid fileId %d", file_id);
     return tmp;
   }
 
-  BPFileHandle *file_handle = open_list_[file_id];
+  BPFileHandle *file_handle = file_handle_of(file_id);
+  BPManager &hdr_shard = shard_of(file_handle->hdr_frame);
+  MUTEX_LOCK(&hdr_shard.mutex);
+  if (--file_handle->hdr_frame->pin_count == 0) {
+    hdr_shard.replacer_->Unpin(file_handle->hdr_frame - hdr_shard.frame);
+  }
+  MUTEX_UNLOCK(&hdr_shard.mutex);
+  if (discard) {
+    discard_all_pages(file_handle);
+  } else if ((tmp = force_all_pages(file_handle, true)) != RC::SUCCESS) {
+    MUTEX_LOCK(&hdr_shard.mutex);
+    file_handle->hdr_frame->pin_count++;
+    hdr_shard.replacer_->Pin(file_handle->hdr_frame - hdr_shard.frame);
+    MUTEX_UNLOCK(&hdr_shard.mutex);
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_ERROR("Failed to closeFile %d:%s, due to failed to force all pages.", file_id, file_handle->file_name);
+    return tmp;
+  }
 
-  int byte = 0, bit = 0;
-  if ((file_handle->file_sub_header->allocated_pages) < (file_handle->file_sub_header->page_count)) {
-    // There is one free page
-    for (int i = 0; i < file_handle->file_sub_header->page_count; i++) {
-      byte = i / 8;
-      bit = i % 8;
+  unmap_file(file_handle);
+  // fd关闭失败时页面已经都写出去了，文件一样从文件表中移除
+  RC close_rc = FileDescCache::instance().remove(file_handle);
+  file_chunks_[file_id / BP_FILE_CHUNK_SIZE][file_id % BP_FILE_CHUNK_SIZE] = nullptr;
+  file_ids_.erase(file_handle->file_name);
+  free_file_ids_.push_back(file_id);
+  MUTEX_UNLOCK(&open_mutex_);
+  LOG_INFO("Successfully close file %d:%s.", file_id, file_handle->file_name);
+  if (file_handle->metric_registered) {
+    get_metrics_registry().unregister(std::string(BP_METRIC_TAG_PREFIX) + file_handle->file_name);
+  }
+  delete file_handle->metric;
+  MUTEX_DESTROY(&file_handle->mutex);
+  delete (file_handle);
+  return close_rc;
+}
+
+RC DiskBufferPool::map_file(int file_id)
+{
+  MUTEX_LOCK(&open_mutex_);
+  RC rc = check_file_id(file_id);
+  if (rc != RC::SUCCESS) {
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_ERROR("Failed to map file, due to invalid fileId %d", file_id);
+    return rc;
+  }
+  BPFileHandle *file_handle = file_handle_of(file_id);
+  if (file_handle->mapped_frames != nullptr) {
+    MUTEX_UNLOCK(&open_mutex_);
+    return RC::SUCCESS;
+  }
+  if (file_handle->compression != PAGE_COMPRESSION_NONE) {
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_WARN("Cannot map %s, pages on disk are compressed", file_handle->file_name);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  // 映射之后读的是文件中的内容，缓冲池中的脏页要先写回，释放之后也不会再有两份页面
+  MUTEX_LOCK(&file_handle->mutex);
+  rc = force_all_pages(file_handle);
+  for (int i = 0; rc == RC::SUCCESS && i < (int)shards_.size(); i++) {
+    MUTEX_LOCK(&shards_[i]->mutex);
+    auto file_iter = shards_[i]->page_table_.find(file_id);
+    if (file_iter != shards_[i]->page_table_.end() && (file_iter->second.size() > 1 || file_iter->second.count(0) == 0)) {
+      rc = RC::BUFFERPOOL_PAGE_PINNED;
+    }
+    MUTEX_UNLOCK(&shards_[i]->mutex);
+  }
+  if (rc != RC::SUCCESS) {
+    MUTEX_UNLOCK(&file_handle->mutex);
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_WARN("Cannot map %s, failed to release its pages in buffer pool. rc=%d:%s",
+             file_handle->file_name, rc, strrc(rc));
+    return rc;
+  }
+
+  const int page_count = file_handle->file_sub_header->page_count;
+  const size_t len = (size_t)page_count * page_size_;
+  FileDescCache &fd_cache = FileDescCache::instance();
+  int fd = -1;
+  char *data = nullptr;
+  if ((rc = fd_cache.acquire(file_handle, &fd)) == RC::SUCCESS) {
+    // 带校验和的页面开头要换回页号，B+树读取节点时也会在页面中填上keys和rids指针，
+    // 所以使用可写的私有映射，修改的页面复制一份，不会写回文件
+    void *addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    fd_cache.release(file_handle);
+    if (addr == MAP_FAILED) {
+      LOG_WARN("Failed to map %s. error=%s", file_handle->file_name, strerror(errno));
+      rc = RC::IOERR_MMAP;
+    } else {
+      data = (char *)addr;
+    }
+  }
+
+  // 页面不再经过load_page，这里一次校验所有分配了的页面
+  void *frames = nullptr;
+  if (rc == RC::SUCCESS && posix_memalign(&frames, BP_CACHE_LINE_SIZE, sizeof(Frame) * page_count) != 0) {
+    frames = nullptr;
+    rc = RC::NOMEM;
+  }
+  for (PageNum page_num = 0; rc == RC::SUCCESS && page_num < page_count; page_num++) {
+    Page *page = (Page *)(data + (size_t)page_num * page_size_);
+    if (file_handle->checksum && (file_handle->bitmap[page_num / 8] & (1 << (page_num % 8))) != 0) {
+      if (page->page_num != page_checksum(page_num, page, page_size_)) {
+        file_handle->metric->checksum_errors++;
+        LOG_ERROR("Failed to map %s, page %d has a checksum mismatch.", file_handle->file_name, page_num);
+        rc = RC::CORRUPT;
+        break;
+      }
+      page->page_num = page_num;
+    }
+  }
+  if (rc != RC::SUCCESS) {
+    if (data != nullptr) {
+      munmap(data, len);
+    }
+    free(frames);
+    MUTEX_UNLOCK(&file_handle->mutex);
+    MUTEX_UNLOCK(&open_mutex_);
+    return rc;
+  }
+
+  Frame *mapped_frames = (Frame *)frames;
+  memset(mapped_frames, 0, sizeof(Frame) * page_count);
+  for (PageNum page_num = 0; page_num < page_count; page_num++) {
+    Frame *frame = &mapped_frames[page_num];
+    bind_file(frame, file_handle);
+    frame->page = (Page *)(data + (size_t)page_num * page_size_);
+    pthread_rwlock_init(&frame->latch, nullptr);
+  }
+  file_handle->mapped_data = data;
+  file_handle->mapped_len = len;
+  file_handle->mapped_pages = page_count;
+  file_handle->mapped_frames = mapped_frames;
+  MUTEX_UNLOCK(&file_handle->mutex);
+  MUTEX_UNLOCK(&open_mutex_);
+  LOG_INFO("Successfully map %s. pages=%d, bytes=%lu", file_handle->file_name, page_count, len);
+  return RC::SUCCESS;
+}
+
+void DiskBufferPool::unmap_file(BPFileHandle *file_handle)
+{
+  if (file_handle->mapped_frames == nullptr) {
+    return;
+  }
+  for (int i = 0; i < file_handle->mapped_pages; i++) {
+    pthread_rwlock_destroy(&file_handle->mapped_frames[i].latch);
+  }
+  free(file_handle->mapped_frames);
+  munmap(file_handle->mapped_data, file_handle->mapped_len);
+  file_handle->mapped_frames = nullptr;
+  file_handle->mapped_data = nullptr;
+  file_handle->mapped_len = 0;
+  file_handle->mapped_pages = 0;
+}
+
+RC DiskBufferPool::get_this_page(int file_id, PageNum page_num, BPPageHandle *page_handle)
+{
+  RC tmp;
+  if ((tmp = check_file_id(file_id)) != RC::SUCCESS) {
+    LOG_ERROR("Failed to load page %d, due to invalid fileId %d", page_num, file_id);
+    return tmp;
+  }
+
+  BPFileHandle *file_handle = file_handle_of(file_id);
+  if ((tmp = check_page_num(page_num, file_handle)) != RC::SUCCESS) {
+    LOG_ERROR("Failed to load page %s:%d, due to invalid pageNum.", file_handle->file_name, page_num);
+    return tmp;
+  }
+
+  BPFileMetric *metric = file_handle->metric;
+  if (file_handle->mapped_frames != nullptr) {
+    // 映射的页面一直在内存中，也不会被修改，不用加锁和pin
+    page_handle->frame = &file_handle->mapped_frames[page_num];
+    page_handle->open = true;
+    metric->hits++;
+    thread_stat.hits++;
+    return RC::SUCCESS;
+  }
+  unsigned long begin_time = current_time();
+  BPManager &shard = shard_of(file_handle->file_id, page_num);
+  MUTEX_LOCK(&shard.mutex);
+  int frame_id = shard.find_frame(file_handle->file_id, page_num);
+  if (frame_id != -1 && shard.allocated[frame_id]) {
+    // This page has been loaded.
+    page_handle->frame = shard.frame + frame_id;
+    page_handle->frame->pin_count++;
+    shard.replacer_->Pin(frame_id);
+    unsigned long now = current_time();
+    page_handle->frame->acc_time = now;
+    page_handle->open = true;
+    MUTEX_UNLOCK(&shard.mutex);
+    metric->hits++;
+    thread_stat.hits++;
+    metric->pin_wait_ns += now - begin_time;
+    return RC::SUCCESS;
+  }
+
+  // Allocate one page and load the data into this page
+  // 加载页面期间一直持有分片锁，避免其它线程看到还没有读完的页面
+  if ((tmp = allocate_block(shard, &(page_handle->frame))) != RC::SUCCESS) {
+    MUTEX_UNLOCK(&shard.mutex);
+    LOG_ERROR("Failed to load page %s:%d, due to failed to alloc page.", file_handle->file_name, page_num);
+    return tmp;
+  }
+  bind_file(page_handle->frame, file_handle);
+  page_handle->frame->pin_count = 1;
+  page_handle->frame->acc_time = current_time();
+  if ((tmp = load_page(page_num, file_handle, page_handle->frame)) != RC::SUCCESS) {
+    LOG_ERROR("Failed to load page %s:%d", file_handle->file_name, page_num);
+    page_handle->frame->pin_count = 0;
+    dispose_block(shard, page_handle->frame);
+    MUTEX_UNLOCK(&shard.mutex);
+    return tmp;
+  }
+  shard.bind_frame(file_handle->file_id, page_num, page_handle->frame - shard.frame);
+  shard.replacer_->Pin(page_handle->frame - shard.frame);
+  MUTEX_UNLOCK(&shard.mutex);
+  metric->misses++;
+  thread_stat.misses++;
+  metric->pin_wait_ns += current_time() - begin_time;
+
+  read_ahead(file_handle, page_num);
+  page_handle->open = true;
+  return RC::SUCCESS;
+}
+
+void DiskBufferPool::read_ahead(BPFileHandle *file_handle, PageNum page_num)
+{
+  if (file_handle->direct_io) {
+    // 不经过page cache，posix_fadvise没有作用
+    return;
+  }
+  MUTEX_LOCK(&file_handle->mutex);
+  if (page_num == file_handle->last_load_page + 1) {
+    file_handle->sequential_loads++;
+  } else {
+    file_handle->sequential_loads = 0;
+  }
+  file_handle->last_load_page = page_num;
+
+  // 连续顺序读了几个页面之后，在已经预读的范围快用完时再预读一批
+  PageNum start = page_num + 1;
+  if (start < file_handle->read_ahead_page) {
+    start = file_handle->read_ahead_page;
+  }
+  PageNum end = page_num + 1 + BP_READ_AHEAD_PAGES;
+  if (end > file_handle->file_sub_header->page_count) {
+    end = file_handle->file_sub_header->page_count;
+  }
+  bool need_read_ahead = file_handle->sequential_loads >= BP_READ_AHEAD_TRIGGER &&
+                         page_num + BP_READ_AHEAD_PAGES / 2 >= file_handle->read_ahead_page &&
+                         start < end;
+  if (need_read_ahead) {
+    file_handle->read_ahead_page = end;
+  }
+  MUTEX_UNLOCK(&file_handle->mutex);
+
+  if (need_read_ahead) {
+    // 交给内核异步预读，后面的load_page就可以直接命中page cache
+    FileDescCache &fd_cache = FileDescCache::instance();
+    int fd = -1;
+    if (fd_cache.acquire(file_handle, &fd) != RC::SUCCESS) {
+      return;
+    }
+    int ret = posix_fadvise(fd, (s64_t)start * page_size_, (s64_t)(end - start) * page_size_, POSIX_FADV_WILLNEED);
+    fd_cache.release(file_handle);
+    if (ret != 0) {
+      LOG_WARN("Failed to read ahead pages [%d, %d) of %s. error=%s",
+               start, end, file_handle->file_name, strerror(ret));
+    }
+  }
+}
+
+RC DiskBufferPool::allocate_page(int file_id, BPPageHandle *page_handle)
+{
+  RC tmp;
+  if ((tmp = check_file_id(file_id)) != RC::SUCCESS) {
+    LOG_ERROR("Failed to alloc page, due to invalid fileId %d", file_id);
+    return tmp;
+  }
+
+  BPFileHandle *file_handle = file_handle_of(file_id);
+  if (file_handle->mapped_frames != nullptr) {
+    LOG_ERROR("Failed to alloc page of %s, file is mapped read only.", file_handle->file_name);
+    return RC::READONLY;
+  }
+
+  int byte = 0, bit = 0;
+  MUTEX_LOCK(&file_handle->mutex);
+  if ((file_handle->file_sub_header->allocated_pages) < (file_handle->file_sub_header->page_count)) {
+    // There is one free page
+    for (int i = 0; i < file_handle->file_sub_header->page_count; i++) {
+      byte = i / 8;
+      bit = i % 8;
       if (((file_handle->bitmap[byte]) & (1 << bit)) == 0) {
         (file_handle->file_sub_header->allocated_pages)++;
         file_handle->bitmap[byte] |= (1 << bit);
+        mark_dirty_frame(file_handle->hdr_frame);
+        MUTEX_UNLOCK(&file_handle->mutex);
         return get_this_page(file_id, i, page_handle);
       }
     }
   }
-
-  if ((tmp = allocate_block(&(page_handle->frame))) != RC::SUCCESS) {
-    LOG_ERROR("Failed to allocate page %s, due to no free page.", file_handle->file_name);
-    return tmp;
+
+  PageNum page_num = file_handle->file_sub_header->page_count;
+  if (page_num >= file_handle->max_page_count) {
+    MUTEX_UNLOCK(&file_handle->mutex);
+    LOG_ERROR("Failed to allocate page %s, file is full. max page count=%d",
+              file_handle->file_name, file_handle->max_page_count);
+    return RC::BUFFERPOOL_NOBUF;
+  }
+  BPManager &shard = shard_of(file_handle->file_id, page_num);
+  MUTEX_LOCK(&shard.mutex);
+  if ((tmp = allocate_block(shard, &(page_handle->frame))) != RC::SUCCESS) {
+    MUTEX_UNLOCK(&shard.mutex);
+    MUTEX_UNLOCK(&file_handle->mutex);
+    LOG_ERROR("Failed to allocate page %s, due to no free page.", file_handle->file_name);
+    return tmp;
+  }
+
+  file_handle->file_sub_header->allocated_pages++;
+  file_handle->file_sub_header->page_count++;
+
+  byte = page_num / 8;
+  bit = page_num % 8;
+  file_handle->bitmap[byte] |= (1 << bit);
+
+  bind_file(page_handle->frame, file_handle);
+  page_handle->frame->pin_count = 1;
+  page_handle->frame->acc_time = current_time();
+  memset(page_handle->frame->page, 0, page_size_);
+  page_handle->frame->page->page_num = page_num;
+  shard.bind_frame(file_handle->file_id, page_num, page_handle->frame - shard.frame);
+  shard.replacer_->Pin(page_handle->frame - shard.frame);
+
+  // Use flush operation to extion file
+  if ((tmp = flush_block(page_handle->frame)) != RC::SUCCESS) {
+    MUTEX_UNLOCK(&shard.mutex);
+    MUTEX_UNLOCK(&file_handle->mutex);
+    LOG_ERROR("Failed to alloc page %s , due to failed to extend one page.", file_handle->file_name);
+    return tmp;
+  }
+  MUTEX_UNLOCK(&shard.mutex);
+  // 文件头页可能和新页面在同一个分片上，放开分片锁之后再标记
+  mark_dirty_frame(file_handle->hdr_frame);
+  MUTEX_UNLOCK(&file_handle->mutex);
+
+  page_handle->open = true;
+  return RC::SUCCESS;
+}
+
+RC DiskBufferPool::get_page_num(BPPageHandle *page_handle, PageNum *page_num)
+{
+  if (!page_handle->open)
+    return RC::BUFFERPOOL_CLOSED;
+  *page_num = page_handle->frame->page->page_num;
+  return RC::SUCCESS;
+}
+
+RC DiskBufferPool::get_data(BPPageHandle *page_handle, char **data)
+{
+  if (!page_handle->open)
+    return RC::BUFFERPOOL_CLOSED;
+  *data = page_handle->frame->page->data;
+  return RC::SUCCESS;
+}
+
+RC DiskBufferPool::mark_dirty(BPPageHandle *page_handle)
+{
+  if (page_handle->frame->file_handle->mapped_frames != nullptr) {
+    LOG_ERROR("Failed to mark page %d of %s dirty, file is mapped read only.",
+              page_handle->frame->page->page_num, page_handle->frame->file_name);
+    return RC::READONLY;
+  }
+  mark_dirty_frame(page_handle->frame);
+  return RC::SUCCESS;
+}
+
+void DiskBufferPool::mark_dirty_frame(Frame *frame)
+{
+  BPManager &shard = shard_of(frame);
+  MUTEX_LOCK(&shard.mutex);
+  set_frame_dirty(shard, frame);
+  MUTEX_UNLOCK(&shard.mutex);
+}
+
+void DiskBufferPool::set_frame_dirty(BPManager &shard, Frame *frame)
+{
+  frame->dirty = true;
+  if (!frame->unlogged && !frame->no_redo && RedoLog::instance().enabled()) {
+    frame->unlogged = true;
+    shard.unlogged_frames_.push_back(frame - shard.frame);
+    has_unlogged_ = true;
+  }
+}
+
+void DiskBufferPool::log_frame(Frame *frame)
+{
+  if (frame->unlogged) {
+    frame->lsn = RedoLog::instance().append_page(frame->file_name, frame->page->page_num, (const char *)frame->page,
+                                                page_size_);
+    frame->unlogged = false;
+  }
+}
+
+void DiskBufferPool::bind_file(Frame *frame, BPFileHandle *file_handle)
+{
+  frame->dirty = false;
+  frame->unlogged = false;
+  frame->lsn = 0;
+  frame->file_id = file_handle->file_id;
+  frame->file_handle = file_handle;
+  frame->file_name = file_handle->file_name;
+  frame->metric = file_handle->metric;
+  frame->checksum = file_handle->checksum;
+  frame->compression = file_handle->compression;
+  frame->no_redo = file_handle->no_redo;
+}
+
+RC DiskBufferPool::wait_logged(Frame **frames, int num)
+{
+  uint64_t lsn = 0;
+  for (int i = 0; i < num; i++) {
+    lsn = std::max(lsn, frames[i]->lsn);
+  }
+  return lsn == 0 ? RC::SUCCESS : RedoLog::instance().flush(lsn);
+}
+
+RC DiskBufferPool::unpin_page(BPPageHandle *page_handle)
+{
+  if (is_mapped_frame(page_handle->frame)) {
+    page_handle->open = false;
+    return RC::SUCCESS;
+  }
+  // 页面被pin住时不会被替换，frame上的file_id和page_num可以放心读取
+  BPManager &shard = shard_of(page_handle->frame);
+  MUTEX_LOCK(&shard.mutex);
+  page_handle->open = false;
+  if (--page_handle->frame->pin_count == 0) {
+    shard.replacer_->Unpin(page_handle->frame - shard.frame);
+  }
+  MUTEX_UNLOCK(&shard.mutex);
+  return RC::SUCCESS;
+}
+
+RC DiskBufferPool::latch_page(BPPageHandle *page_handle, bool exclusive)
+{
+  if (!page_handle->open)
+    return RC::BUFFERPOOL_CLOSED;
+
+  int ret = exclusive ? pthread_rwlock_wrlock(&page_handle->frame->latch)
+                      : pthread_rwlock_rdlock(&page_handle->frame->latch);
+  if (ret != 0) {
+    LOG_ERROR("Failed to latch page %d of %d. error=%s",
+              page_handle->frame->page->page_num, page_handle->frame->file_id, strerror(ret));
+    return RC::LOCKED_LOCK;
+  }
+  return RC::SUCCESS;
+}
+
+RC DiskBufferPool::unlatch_page(BPPageHandle *page_handle)
+{
+  int ret = pthread_rwlock_unlock(&page_handle->frame->latch);
+  if (ret != 0) {
+    LOG_ERROR("Failed to unlatch page %d of %d. error=%s",
+              page_handle->frame->page->page_num, page_handle->frame->file_id, strerror(ret));
+    return RC::LOCKED_UNLOCK;
+  }
+  return RC::SUCCESS;
+}
+
+/**
+ * dispose_page will delete the data of the page of pageNum
+ * force_page will flush the page of pageNum
+ * @param fileID
+ * @param pageNum
+ * @return
+ */
+RC DiskBufferPool::dispose_page(int file_id, PageNum page_num)
+{
+  RC rc;
+  if ((rc = check_file_id(file_id)) != RC::SUCCESS) {
+    LOG_ERROR("Failed to alloc page, due to invalid fileId %d", file_id);
+    return rc;
+  }
+
+  BPFileHandle *file_handle = file_handle_of(file_id);
+  if (file_handle->mapped_frames != nullptr) {
+    LOG_ERROR("Failed to dispose page %s:%d, file is mapped read only.", file_handle->file_name, page_num);
+    return RC::READONLY;
+  }
+  MUTEX_LOCK(&file_handle->mutex);
+  if ((rc = check_page_num(page_num, file_handle)) != RC::SUCCESS) {
+    MUTEX_UNLOCK(&file_handle->mutex);
+    LOG_ERROR("Failed to dispose page %s:%d, due to invalid pageNum", file_handle->file_name, page_num);
+    return rc;
+  }
+
+  BPManager &shard = shard_of(file_handle->file_id, page_num);
+  MUTEX_LOCK(&shard.mutex);
+  int frame_id = shard.find_frame(file_handle->file_id, page_num);
+  if (frame_id != -1 && shard.allocated[frame_id]) {
+    if (shard.frame[frame_id].pin_count != 0) {
+      MUTEX_UNLOCK(&shard.mutex);
+      MUTEX_UNLOCK(&file_handle->mutex);
+      return RC::BUFFERPOOL_PAGE_PINNED;
+    }
+    shard.free_frame(frame_id);
+  }
+  MUTEX_UNLOCK(&shard.mutex);
+
+  mark_dirty_frame(file_handle->hdr_frame);
+  file_handle->file_sub_header->allocated_pages--;
+  char tmp = 1 << (page_num % 8);
+  file_handle->bitmap[page_num / 8] &= ~tmp;
+
+  // 文件末尾的页面都被释放时缩小文件，这些页面已经不在缓冲池中了
+  PageNum page_count = file_handle->file_sub_header->page_count;
+  while (page_count > 1 && (file_handle->bitmap[(page_count - 1) / 8] & (1 << ((page_count - 1) % 8))) == 0) {
+    page_count--;
+  }
+  if (page_count < file_handle->file_sub_header->page_count) {
+    // 先写出文件头，文件头中的页数不能超过文件的实际长度
+    const PageNum old_page_count = file_handle->file_sub_header->page_count;
+    file_handle->file_sub_header->page_count = page_count;
+    BPManager &hdr_shard = shard_of(file_handle->hdr_frame);
+    MUTEX_LOCK(&hdr_shard.mutex);
+    RC flush_rc = flush_block(file_handle->hdr_frame);
+    MUTEX_UNLOCK(&hdr_shard.mutex);
+    FileDescCache &fd_cache = FileDescCache::instance();
+    int fd = -1;
+    if (flush_rc != RC::SUCCESS || fd_cache.acquire(file_handle, &fd) != RC::SUCCESS) {
+      LOG_WARN("Failed to flush header of %s, file is not truncated", file_handle->file_name);
+    } else {
+      const s64_t new_size = ((s64_t)page_count) * page_size_;
+      PageSnapshot::instance().before_write(fd, new_size, ((s64_t)old_page_count - page_count) * page_size_);
+      if (ftruncate(fd, new_size) != 0) {
+        // 多出来的部分之后扩展文件时会被覆盖
+        LOG_WARN("Failed to truncate %s to %d pages, due to %s", file_handle->file_name, page_count, strerror(errno));
+      }
+      fd_cache.release(file_handle);
+    }
+  }
+  MUTEX_UNLOCK(&file_handle->mutex);
+  return RC::SUCCESS;
+}
+
+RC DiskBufferPool::force_page(int file_id, PageNum page_num)
+{
+  RC rc;
+  if ((rc = check_file_id(file_id)) != RC::SUCCESS) {
+    LOG_ERROR("Failed to alloc page, due to invalid fileId %d", file_id);
+    return rc;
+  }
+  BPFileHandle *file_handle = file_handle_of(file_id);
+  return force_page(file_handle, page_num);
+}
+/**
+ * dispose_page will delete the data of the page of pageNum
+ * force_page will flush the page of pageNum
+ * @param fileHandle
+ * @param pageNum
+ * @return
+ */
+RC DiskBufferPool::force_page(BPFileHandle *file_handle, PageNum page_num)
+{
+  // 后台刷盘线程会在持有文件锁期间pin住一批页面，等它刷完再释放页面
+  MUTEX_LOCK(&file_handle->mutex);
+  RC rc = RC::SUCCESS;
+  if (page_num == -1) {
+    // 刷新该文件所有的页
+    for (BPManager *shard : shards_) {
+      MUTEX_LOCK(&shard->mutex);
+      std::vector<int> frame_ids;
+      auto file_iter = shard->page_table_.find(file_handle->file_id);
+      if (file_iter != shard->page_table_.end()) {
+        for (auto &entry : file_iter->second) {
+          frame_ids.push_back(entry.second);
+        }
+      }
+      for (int frame_id : frame_ids) {
+        rc = force_frame(*shard, file_handle, frame_id);
+        if (rc != RC::SUCCESS) {
+          MUTEX_UNLOCK(&shard->mutex);
+          MUTEX_UNLOCK(&file_handle->mutex);
+          return rc;
+        }
+      }
+      MUTEX_UNLOCK(&shard->mutex);
+    }
+    MUTEX_UNLOCK(&file_handle->mutex);
+    return RC::SUCCESS;
+  }
+
+  BPManager &shard = shard_of(file_handle->file_id, page_num);
+  MUTEX_LOCK(&shard.mutex);
+  int frame_id = shard.find_frame(file_handle->file_id, page_num);
+  if (frame_id != -1) {
+    rc = force_frame(shard, file_handle, frame_id);
+  }
+  MUTEX_UNLOCK(&shard.mutex);
+  MUTEX_UNLOCK(&file_handle->mutex);
+  return rc;
+}
+
+RC DiskBufferPool::force_frame(BPManager &shard, BPFileHandle *file_handle, int frame_id)
+{
+  if (!shard.allocated[frame_id]) {
+    return RC::SUCCESS;
+  }
+
+  Frame *frame = &shard.frame[frame_id];
+  if (frame->pin_count != 0) {
+    LOG_ERROR("Page :%s:%d has been pinned.", file_handle->file_name, frame->page->page_num);
+    return RC::BUFFERPOOL_PAGE_PINNED;
+  }
+
+  if (frame->dirty) {
+    RC rc = RC::SUCCESS;
+    if ((rc = flush_block(frame)) != RC::SUCCESS) {
+      LOG_ERROR("Failed to flush page:%s:%d.", file_handle->file_name, frame->page->page_num);
+      return rc;
+    }
+  }
+  shard.free_frame(frame_id);
+  return RC::SUCCESS;
+}
+
+RC DiskBufferPool::flush_all_pages(int file_id)
+{
+  RC rc = check_file_id(file_id);
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to flush pages due to invalid file_id %d", file_id);
+    return rc;
+  }
+
+  BPFileHandle *file_handle = file_handle_of(file_id);
+  return force_all_pages(file_handle);
+}
+
+RC DiskBufferPool::force_all_pages(BPFileHandle *file_handle, bool release_pinned)
+{
+  for (BPManager *shard : shards_) {
+    MUTEX_LOCK(&shard->mutex);
+    auto file_iter = shard->page_table_.find(file_handle->file_id);
+    if (file_iter == shard->page_table_.end()) {
+      MUTEX_UNLOCK(&shard->mutex);
+      continue;
+    }
+
+    std::unordered_map<PageNum, int> &file_pages = file_iter->second;
+    // 分片中这个文件的脏页按页号排序后一次提交
+    std::vector<Frame *> dirty_frames;
+    for (auto &entry : file_pages) {
+      Frame *frame = &shard->frame[entry.second];
+      if (shard->allocated[entry.second] && frame->file_id == file_handle->file_id && frame->dirty) {
+        log_frame(frame);
+        dirty_frames.push_back(frame);
+      }
+    }
+    if (!dirty_frames.empty()) {
+      std::sort(dirty_frames.begin(), dirty_frames.end(),
+                [](const Frame *left, const Frame *right) { return left->page->page_num < right->page->page_num; });
+      RC rc = flush_frames(dirty_frames.data(), (int)dirty_frames.size());
+      if (rc != RC::SUCCESS) {
+        MUTEX_UNLOCK(&shard->mutex);
+        LOG_ERROR("Failed to flush all pages' of %s.", file_handle->file_name);
+        return rc;
+      }
+      for (Frame *frame : dirty_frames) {
+        frame->dirty = false;
+      }
+    }
+
+    for (auto iter = file_pages.begin(); iter != file_pages.end(); ) {
+      int frame_id = iter->second;
+      Frame *frame = &shard->frame[frame_id];
+      if (!shard->allocated[frame_id] || frame->file_id != file_handle->file_id) {
+        iter = file_pages.erase(iter);
+        continue;
+      }
+
+      // 还有人在使用的页面(比如文件头页)不能释放，否则frame可能被别的页面复用
+      if (frame->pin_count != 0 && !release_pinned) {
+        ++iter;
+        continue;
+      }
+      shard->replacer_->Remove(frame_id);
+      shard->allocated[frame_id] = false;
+      frame->unlogged = false;
+      shard->free_list_.push_back(frame_id);
+      iter = file_pages.erase(iter);
+    }
+    if (file_pages.empty()) {
+      shard->page_table_.erase(file_iter);
+    }
+    MUTEX_UNLOCK(&shard->mutex);
+  }
+  return RC::SUCCESS;
+}
+
+void DiskBufferPool::discard_all_pages(BPFileHandle *file_handle)
+{
+  int discarded = 0;
+  for (BPManager *shard : shards_) {
+    MUTEX_LOCK(&shard->mutex);
+    auto file_iter = shard->page_table_.find(file_handle->file_id);
+    if (file_iter == shard->page_table_.end()) {
+      MUTEX_UNLOCK(&shard->mutex);
+      continue;
+    }
+    for (auto &entry : file_iter->second) {
+      int frame_id = entry.second;
+      Frame *frame = &shard->frame[frame_id];
+      if (!shard->allocated[frame_id] || frame->file_id != file_handle->file_id) {
+        continue;
+      }
+      shard->replacer_->Remove(frame_id);
+      shard->allocated[frame_id] = false;
+      frame->dirty = false;
+      frame->unlogged = false;
+      frame->pin_count = 0;
+      shard->free_list_.push_back(frame_id);
+      discarded++;
+    }
+    shard->page_table_.erase(file_iter);
+    MUTEX_UNLOCK(&shard->mutex);
+  }
+  LOG_INFO("Discard %d pages of file %s", discarded, file_handle->file_name);
+}
+
+/**
+ * 压缩页面使用的缓冲区，O_DIRECT写盘时也要求按块对齐。用free释放
+ */
+static char *alloc_compress_buffer(size_t size)
+{
+  void *buffer = nullptr;
+  if (posix_memalign(&buffer, PAGE_COMPRESSION_BLOCK, size) != 0) {
+    LOG_WARN("Failed to alloc compress buffer of %d bytes, write page without compression", (int)size);
+    return nullptr;
+  }
+  return (char *)buffer;
+}
+
+/**
+ * 文件头页不压缩，打开文件时要先按原样读出来才知道文件的压缩方式
+ */
+static bool need_compress(Frame *frame)
+{
+  return frame->compression != PAGE_COMPRESSION_NONE && frame->page->page_num != 0;
+}
+
+/**
+ * 写盘之前是否要把页面复制到缓冲区中处理
+ */
+static bool need_image(Frame *frame)
+{
+  return frame->checksum || need_compress(frame);
+}
+
+RC DiskBufferPool::flush_block(Frame *frame)
+{
+  // The better way is use mmap the block into memory,
+  // so it is easier to flush data to file.
+
+  // 页面的内容要先在redo日志中落盘
+  log_frame(frame);
+  RC rc = wait_logged(&frame, 1);
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to flush page %d of %d, due to failed to write redo log.", frame->page->page_num,
+              frame->file_id);
+    return rc;
+  }
+
+  const char *data = (const char *)frame->page;
+  int len = page_size_;
+  char *buffer = nullptr;
+  if (need_image(frame) && (buffer = alloc_compress_buffer(page_size_)) != nullptr) {
+    len = page_image(frame->page, page_size_, frame->checksum,
+        need_compress(frame) ? frame->compression : PAGE_COMPRESSION_NONE, buffer, &data);
+  } else if (frame->checksum) {
+    // 没有校验和的页面加载时通不过校验，不能按原样写出
+    LOG_ERROR("Failed to flush page %d of %d, due to failed to alloc buffer.", frame->page->page_num, frame->file_id);
+    return RC::NOMEM;
+  }
+
+  FileDescCache &fd_cache = FileDescCache::instance();
+  int fd = -1;
+  if ((rc = fd_cache.acquire(frame->file_handle, &fd)) != RC::SUCCESS) {
+    LOG_ERROR("Failed to flush page %d of %d, due to failed to open file.", frame->page->page_num, frame->file_id);
+    free(buffer);
+    return rc;
+  }
+  // 使用pwrite，不同分片可以同时读写同一个文件，不会互相修改文件偏移
+  s64_t offset = ((s64_t)frame->page->page_num) * page_size_;
+  // 压缩的页面在写出之后还会打洞，整页都算作被覆盖
+  PageSnapshot::instance().before_write(fd, offset, page_size_);
+  if (pwrite(fd, data, len, offset) != len) {
+    LOG_ERROR("Failed to flush page %lld of %d due to %s.", offset, frame->file_id, strerror(errno));
+    fd_cache.release(frame->file_handle);
+    free(buffer);
+    return RC::IOERR_WRITE;
+  }
+  free(buffer);
+  if (len < page_size_) {
+    punch_page_tail(fd, frame, len);
+  }
+  fd_cache.release(frame->file_handle);
+  // 新分配的页面扩展文件时也会写盘，只计入写的字节数
+  if (frame->dirty) {
+    frame->metric->dirty_flushes++;
+  }
+  frame->metric->write_bytes += len;
+  frame->dirty = false;
+  LOG_DEBUG("Flush block. file desc=%d, page num=%d", frame->file_id, frame->page->page_num);
+
+  return RC::SUCCESS;
+}
+
+void DiskBufferPool::punch_page_tail(int fd, Frame *frame, int written)
+{
+  s64_t offset = ((s64_t)frame->page->page_num) * page_size_ + written;
+  if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, page_size_ - written) != 0) {
+    // 页面后面的旧数据留在文件中也没有关系，读取时只看压缩数据的长度
+    LOG_DEBUG("Failed to punch hole at %lld of %d due to %s.", offset, frame->file_id, strerror(errno));
+  }
+}
+
+RC DiskBufferPool::allocate_block(BPManager &shard, Frame **buffer)
+{
+  // There is one Frame which is free.
+  if (!shard.free_list_.empty()) {
+    int frame_id = shard.free_list_.front();
+    shard.free_list_.pop_front();
+    shard.allocated[frame_id] = true;
+    *buffer = shard.frame + frame_id;
+    LOG_DEBUG("Allocate block frame=%p", *buffer);
+    return RC::SUCCESS;
+  }
+
+  int victim = -1;
+  do {
+    if (!shard.replacer_->Victim(&victim)) {
+      LOG_ERROR("All pages have been used and pinned.");
+      return RC::NOMEM;
+    }
+    // 正在被后台线程刷盘的页面，刷完之后会重新放回替换策略中
+  } while (shard.frame[victim].pin_count != 0);
+
+  if (shard.frame[victim].dirty) {
+    RC rc = flush_block(&(shard.frame[victim]));
+    if (rc != RC::SUCCESS) {
+      // 刷盘失败，这个frame还要留在缓冲池中
+      shard.replacer_->Unpin(victim);
+      LOG_ERROR("Failed to flush block of %d for %d.", victim, shard.frame[victim].file_id);
+      return rc;
+    }
+  }
+  shard.frame[victim].metric->evictions++;
+  shard.unbind_frame(victim);
+  *buffer = shard.frame + victim;
+  return RC::SUCCESS;
+}
+
+RC DiskBufferPool::flush_frames(Frame **frames, int num)
+{
+  // 调用者已经在持有分片锁时把这些页面写到了redo日志中
+  RC rc = wait_logged(frames, num);
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to flush %d pages, due to failed to write redo log.", num);
+    return rc;
+  }
+
+  // 带校验和的页面复制到buffer中写出，需要压缩的页面压缩到buffer中，压缩后的长度不是整页，单独作为一个请求写出
+  char *buffer = nullptr;
+  for (int i = 0; i < num; i++) {
+    if (need_image(frames[i])) {
+      buffer = alloc_compress_buffer((size_t)num * page_size_);
+      if (buffer == nullptr && frames[i]->checksum) {
+        LOG_ERROR("Failed to flush %d pages, due to failed to alloc buffer.", num);
+        return RC::NOMEM;
+      }
+      break;
+    }
+  }
+
+  // 写盘期间这些文件的fd不能被fd缓存关闭
+  FileDescCache &fd_cache = FileDescCache::instance();
+  std::vector<BPFileHandle *> files;
+  std::vector<int> fds(num, -1);
+  for (int i = 0; i < num && rc == RC::SUCCESS; i++) {
+    if (i > 0 && frames[i]->file_handle == frames[i - 1]->file_handle) {
+      fds[i] = fds[i - 1];
+      continue;
+    }
+    if ((rc = fd_cache.acquire(frames[i]->file_handle, &fds[i])) == RC::SUCCESS) {
+      files.push_back(frames[i]->file_handle);
+    }
+  }
+  if (rc != RC::SUCCESS) {
+    for (BPFileHandle *file_handle : files) {
+      fd_cache.release(file_handle);
+    }
+    free(buffer);
+    LOG_ERROR("Failed to flush %d pages, due to failed to open file.", num);
+    return rc;
   }
 
-  PageNum page_num = file_handle->file_sub_header->page_count;
-  file_handle->file_sub_header->allocated_pages++;
-  file_handle->file_sub_header->page_count++;
+  std::vector<struct iovec> iov(num);
+  std::vector<PageIoRequest> requests;
+  std::vector<ssize_t> expected;  // 每个请求应该写出的字节数
+  for (int i = 0; i < num; i++) {
+    iov[i].iov_base = frames[i]->page;
+    iov[i].iov_len = page_size_;
+    if (buffer != nullptr && need_image(frames[i])) {
+      const char *data = nullptr;
+      iov[i].iov_len = page_image(frames[i]->page, page_size_, frames[i]->checksum,
+          need_compress(frames[i]) ? frames[i]->compression : PAGE_COMPRESSION_NONE,
+          buffer + (size_t)i * page_size_, &data);
+      iov[i].iov_base = (void *)data;
+    }
+    // 合并页号连续的整页，一个请求写出
+    if (i > 0 && frames[i]->file_id == frames[i - 1]->file_id &&
+        frames[i]->page->page_num == frames[i - 1]->page->page_num + 1 &&
+        iov[i].iov_len == (size_t)page_size_ && iov[i - 1].iov_len == (size_t)page_size_ &&
+        requests.back().iovcnt < IOV_MAX) {
+      requests.back().iovcnt++;
+      expected.back() += page_size_;
+      continue;
+    }
+    PageIoRequest request;
+    request.fd = fds[i];
+    request.offset = ((s64_t)frames[i]->page->page_num) * page_size_;
+    request.iov = nullptr;
+    request.iovcnt = 1;
+    request.write = true;
+    request.result = 0;
+    requests.push_back(request);
+    expected.push_back(iov[i].iov_len);
+  }
+  // iov的内存已经不会再变，这时再设置每个请求的iov
+  int iov_index = 0;
+  for (PageIoRequest &request : requests) {
+    request.iov = &iov[iov_index];
+    iov_index += request.iovcnt;
+  }
 
-  byte = page_num / 8;
-  bit = page_num % 8;
-  file_handle->bitmap[byte] |= (1 << bit);
-  file_handle->hdr_frame->dirty = true;
+  // 在线备份中的文件，页面原来的内容先复制到备份中
+  PageSnapshot &snapshot = PageSnapshot::instance();
+  for (const PageIoRequest &request : requests) {
+    snapshot.before_write(request.fd, request.offset, (s64_t)request.iovcnt * page_size_);
+  }
 
-  page_handle->frame->dirty = false;
-  page_handle->frame->file_desc = file_handle->file_desc;
-  page_handle->frame->pin_count = 1;
-  page_handle->frame->acc_time = current_time();
-  memset(&(page_handle->frame->page), 0, sizeof(Page));
-  page_handle->frame->page.page_num = file_handle->file_sub_header->page_count - 1;
+  // 所有请求一起交给IO后端，io_uring可以让它们同时执行
+  rc = page_io_->submit_and_wait(requests.data(), (int)requests.size());
+  int frame_index = 0;
+  for (size_t i = 0; i < requests.size(); i++) {
+    PageIoRequest &request = requests[i];
+    Frame *frame = frames[frame_index];
+    frame_index += request.iovcnt;
+    if (request.result != expected[i]) {
+      LOG_ERROR("Failed to flush %d pages from %lld of %d. result=%ld",
+                request.iovcnt, request.offset, request.fd, (long)request.result);
+      rc = RC::IOERR_WRITE;
+      continue;
+    }
+    if (request.result < page_size_) {
+      punch_page_tail(request.fd, frame, (int)request.result);
+    }
+    frame->metric->dirty_flushes += request.iovcnt;
+    frame->metric->write_bytes += request.result;
+  }
+  for (BPFileHandle *file_handle : files) {
+    fd_cache.release(file_handle);
+  }
+  free(buffer);
+  LOG_DEBUG("Flush %d blocks with %d requests by %s", num, (int)requests.size(), page_io_->name());
+  return rc;
+}
 
-  // Use flush operation to extion file
-  if ((tmp = flush_block(page_handle->frame)) != RC::SUCCESS) {
-    LOG_ERROR("Failed to alloc page %s , due to failed to extend one page.", file_handle->file_name);
-    return tmp;
+RC DiskBufferPool::start_flusher(int dirty_ratio)
+{
+  if (dirty_ratio <= 0 || dirty_ratio > 100) {
+    LOG_ERROR("Invalid dirty ratio %d", dirty_ratio);
+    return RC::INVALID_ARGUMENT;
   }
 
-  page_handle->open = true;
+  MUTEX_LOCK(&flusher_mutex_);
+  if (flusher_running_) {
+    MUTEX_UNLOCK(&flusher_mutex_);
+    LOG_WARN("Buffer pool flusher has been started");
+    return RC::SUCCESS;
+  }
+  dirty_ratio_ = dirty_ratio;
+  flusher_stop_ = false;
+  int ret = pthread_create(&flusher_, nullptr, flusher_routine, this);
+  if (ret != 0) {
+    MUTEX_UNLOCK(&flusher_mutex_);
+    LOG_ERROR("Failed to create buffer pool flusher thread. error=%s", strerror(ret));
+    return RC::GENERIC_ERROR;
+  }
+  flusher_running_ = true;
+  MUTEX_UNLOCK(&flusher_mutex_);
+  LOG_INFO("Start buffer pool flusher with dirty ratio %d%%", dirty_ratio);
   return RC::SUCCESS;
 }
 
-RC DiskBufferPool::get_page_num(BPPageHandle *page_handle, PageNum *page_num)
+void DiskBufferPool::stop_flusher()
 {
-  if (!page_handle->open)
-    return RC::BUFFERPOOL_CLOSED;
-  *page_num = page_handle->frame->page.page_num;
-  return RC::SUCCESS;
+  MUTEX_LOCK(&flusher_mutex_);
+  if (!flusher_running_) {
+    MUTEX_UNLOCK(&flusher_mutex_);
+    return;
+  }
+  flusher_stop_ = true;
+  COND_SIGNAL(&flusher_cond_);
+  MUTEX_UNLOCK(&flusher_mutex_);
+
+  pthread_join(flusher_, nullptr);
+  flusher_running_ = false;
+  LOG_INFO("Buffer pool flusher stopped");
 }
 
-RC DiskBufferPool::get_data(BPPageHandle *page_handle, char **data)
+void *DiskBufferPool::flusher_routine(void *arg)
 {
-  if (!page_handle->open)
-    return RC::BUFFERPOOL_CLOSED;
-  *data = page_handle->frame->page.data;
-  return RC::SUCCESS;
+  DiskBufferPool *pool = (DiskBufferPool *)arg;
+  MUTEX_LOCK(&pool->flusher_mutex_);
+  while (!pool->flusher_stop_) {
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    long nsec = now.tv_usec * 1000L + BP_FLUSH_INTERVAL_MS * 1000000L;
+    struct timespec deadline;
+    deadline.tv_sec = now.tv_sec + nsec / 1000000000L;
+    deadline.tv_nsec = nsec % 1000000000L;
+    int ret = 0;
+    COND_WAIT_TIMEOUT(&pool->flusher_cond_, &pool->flusher_mutex_, &deadline, ret);
+    (void)ret;
+    if (pool->flusher_stop_) {
+      break;
+    }
+
+    MUTEX_UNLOCK(&pool->flusher_mutex_);
+    pool->flush_round();
+    MUTEX_LOCK(&pool->flusher_mutex_);
+  }
+  MUTEX_UNLOCK(&pool->flusher_mutex_);
+  return nullptr;
 }
 
-RC DiskBufferPool::mark_dirty(BPPageHandle *page_handle)
+int DiskBufferPool::dirty_page_count()
 {
-  page_handle->frame->dirty = true;
-  return RC::SUCCESS;
+  int count = 0;
+  for (BPManager *shard : shards_) {
+    MUTEX_LOCK(&shard->mutex);
+    for (int i = 0; i < shard->size; i++) {
+      if (shard->allocated[i] && shard->frame[i].dirty) {
+        count++;
+      }
+    }
+    MUTEX_UNLOCK(&shard->mutex);
+  }
+  return count;
 }
 
-RC DiskBufferPool::unpin_page(BPPageHandle *page_handle)
+uint64_t DiskBufferPool::log_pages(bool all_dirty)
 {
-  page_handle->open = false;
-  page_handle->frame->pin_count--;
-  return RC::SUCCESS;
+  // 持有open_mutex_，多个线程同时调用时不会在别的线程写完日志之前返回，文件也不会被关闭
+  MUTEX_LOCK(&open_mutex_);
+  if (!all_dirty && !has_unlogged_.exchange(false)) {
+    uint64_t lsn = logged_lsn_;
+    MUTEX_UNLOCK(&open_mutex_);
+    return lsn;
+  }
+  // 先pin住要写日志的页面，之后按照先页面锁后分片锁的顺序加锁
+  std::vector<Frame *> frames;
+  for (BPManager *shard : shards_) {
+    MUTEX_LOCK(&shard->mutex);
+    if (all_dirty) {
+      for (int i = 0; i < shard->size; i++) {
+        if (shard->allocated[i] && shard->frame[i].dirty) {
+          set_frame_dirty(*shard, &shard->frame[i]);
+        }
+      }
+    }
+    std::vector<int> frame_ids;
+    frame_ids.swap(shard->unlogged_frames_);
+    for (int frame_id : frame_ids) {
+      Frame *frame = &shard->frame[frame_id];
+      if (shard->allocated[frame_id] && frame->unlogged && file_handle_of(frame->file_id) != nullptr) {
+        frame->pin_count++;
+        shard->replacer_->Pin(frame_id);
+        frames.push_back(frame);
+      } else if (shard->allocated[frame_id] && frame->unlogged) {
+        shard->unlogged_frames_.push_back(frame_id);
+        has_unlogged_ = true;
+      }
+    }
+    MUTEX_UNLOCK(&shard->mutex);
+  }
+
+  for (Frame *frame : frames) {
+    // 文件头页由文件锁保护，其它页面由页面锁保护
+    BPFileHandle *file_handle = frame->file_handle;
+    bool hdr_page = frame == file_handle->hdr_frame;
+    if (hdr_page) {
+      MUTEX_LOCK(&file_handle->mutex);
+    } else {
+      pthread_rwlock_rdlock(&frame->latch);
+    }
+    BPManager &shard = shard_of(frame);
+    MUTEX_LOCK(&shard.mutex);
+    log_frame(frame);
+    if (--frame->pin_count == 0) {
+      shard.replacer_->Unpin(frame - shard.frame);
+    }
+    MUTEX_UNLOCK(&shard.mutex);
+    if (hdr_page) {
+      MUTEX_UNLOCK(&file_handle->mutex);
+    } else {
+      pthread_rwlock_unlock(&frame->latch);
+    }
+  }
+  logged_lsn_ = RedoLog::instance().current_lsn();
+  uint64_t lsn = logged_lsn_;
+  MUTEX_UNLOCK(&open_mutex_);
+  return lsn;
 }
 
-/**
- * dispose_page will delete the data of the page of pageNum
- * force_page will flush the page of pageNum
- * @param fileID
- * @param pageNum
- * @return
- */
-RC DiskBufferPool::dispose_page(int file_id, PageNum page_num)
+RC DiskBufferPool::checkpoint()
 {
-  RC rc;
-  if ((rc = check_file_id(file_id)) != RC::SUCCESS) {
-    LOG_ERROR("Failed to alloc page, due to invalid fileId %d", file_id);
-    return rc;
+  RedoLog &redo_log = RedoLog::instance();
+  MUTEX_LOCK(&open_mutex_);
+  for (int i = 0; i < file_slots_; i++) {
+    BPFileHandle *file_handle = file_handle_of(i);
+    if (file_handle == nullptr) {
+      continue;
+    }
+    while (flush_file_pages(file_handle, BP_FLUSH_BATCH_PAGES) == BP_FLUSH_BATCH_PAGES) {
+    }
   }
+  MUTEX_UNLOCK(&open_mutex_);
 
-  BPFileHandle *file_handle = open_list_[file_id];
-  if ((rc = check_page_num(page_num, file_handle)) != RC::SUCCESS) {
-    LOG_ERROR("Failed to dispose page %s:%d, due to invalid pageNum", file_handle->file_name, page_num);
+  // 被pin住的脏页写不出去，把它们现在的内容写到新的日志中
+  log_pages(true);
+  RC rc = redo_log.flush(redo_log.current_lsn());
+  if (rc != RC::SUCCESS) {
     return rc;
   }
 
-  for (int i = 0; i < BP_BUFFER_SIZE; i++) {
-    if (!bp_manager_.allocated[i])
-      continue;
-    if (bp_manager_.frame[i].file_desc != file_handle->file_desc) {
+  // 持有文件锁时后台线程不会正在刷这个文件，之前写出的页面都会被sync。
+  // fsync作用在文件上，fd被缓存关闭过也没有关系，重新打开的fd同样会把之前写出的页面落盘
+  FileDescCache &fd_cache = FileDescCache::instance();
+  MUTEX_LOCK(&open_mutex_);
+  for (int i = 0; i < file_slots_ && rc == RC::SUCCESS; i++) {
+    BPFileHandle *file_handle = file_handle_of(i);
+    if (file_handle == nullptr) {
       continue;
     }
+    MUTEX_LOCK(&file_handle->mutex);
+    int fd = -1;
+    rc = fd_cache.acquire(file_handle, &fd);
+    if (rc == RC::SUCCESS) {
+      if (fsync(fd) != 0) {
+        LOG_ERROR("Failed to sync %s. error=%s", file_handle->file_name, strerror(errno));
+        rc = RC::IOERR_FSYNC;
+      }
+      fd_cache.release(file_handle);
+    }
+    MUTEX_UNLOCK(&file_handle->mutex);
+  }
+  MUTEX_UNLOCK(&open_mutex_);
+  return rc;
+}
+
+RC DiskBufferPool::apply_page(const char *file_name, PageNum page_num, const char *data)
+{
+  // 持有open_mutex_，文件不会在重放期间被打开或者关闭
+  MUTEX_LOCK(&open_mutex_);
+  auto id_iter = file_ids_.find(file_name);
+  if (id_iter == file_ids_.end()) {
+    MUTEX_UNLOCK(&open_mutex_);
+    return RC::NOTFOUND;
+  }
+  BPFileHandle *file_handle = file_handle_of(id_iter->second);
+  if (file_handle->mapped_frames != nullptr || page_num < 0 || page_num >= file_handle->max_page_count) {
+    MUTEX_UNLOCK(&open_mutex_);
+    LOG_ERROR("Failed to apply page %s:%d, file is mapped or page num is invalid.", file_name, page_num);
+    return RC::BUFFERPOOL_INVALID_PAGE_NUM;
+  }
+
+  if (page_num == 0) {
+    // 文件头页由文件锁保护，位图和子文件头指向这个页面，直接覆盖内容
+    MUTEX_LOCK(&file_handle->mutex);
+    memcpy(file_handle->hdr_frame->page, data, page_size_);
+    mark_dirty_frame(file_handle->hdr_frame);
+    MUTEX_UNLOCK(&file_handle->mutex);
+    MUTEX_UNLOCK(&open_mutex_);
+    return RC::SUCCESS;
+  }
 
-    if (bp_manager_.frame[i].page.page_num == page_num) {
-      if (bp_manager_.frame[i].pin_count != 0)
-        return RC::BUFFERPOOL_PAGE_PINNED;
-      bp_manager_.allocated[i] = false;
+  BPManager &shard = shard_of(file_handle->file_id, page_num);
+  MUTEX_LOCK(&shard.mutex);
+  int frame_id = shard.find_frame(file_handle->file_id, page_num);
+  if (frame_id == -1 || !shard.allocated[frame_id]) {
+    Frame *frame = nullptr;
+    RC rc = allocate_block(shard, &frame);
+    if (rc != RC::SUCCESS) {
+      MUTEX_UNLOCK(&shard.mutex);
+      MUTEX_UNLOCK(&open_mutex_);
+      LOG_ERROR("Failed to apply page %s:%d, due to failed to alloc page.", file_name, page_num);
+      return rc;
     }
+    bind_file(frame, file_handle);
+    frame->pin_count = 0;
+    frame->acc_time = current_time();
+    memcpy(frame->page, data, page_size_);
+    shard.bind_frame(file_handle->file_id, page_num, frame - shard.frame);
+    shard.replacer_->Unpin(frame - shard.frame);
+    set_frame_dirty(shard, frame);
+    MUTEX_UNLOCK(&shard.mutex);
+    MUTEX_UNLOCK(&open_mutex_);
+    return RC::SUCCESS;
   }
 
-  file_handle->hdr_frame->dirty = true;
-  file_handle->file_sub_header->allocated_pages--;
-  // file_handle->pFileSubHeader->pageCount--;
-  char tmp = 1 << (page_num % 8);
-  file_handle->bitmap[page_num / 8] &= ~tmp;
+  // 和修改页面的线程一样，先放开分片锁再加页面锁
+  Frame *frame = shard.frame + frame_id;
+  frame->pin_count++;
+  shard.replacer_->Pin(frame_id);
+  MUTEX_UNLOCK(&shard.mutex);
+  pthread_rwlock_wrlock(&frame->latch);
+  memcpy(frame->page, data, page_size_);
+  pthread_rwlock_unlock(&frame->latch);
+  MUTEX_LOCK(&shard.mutex);
+  set_frame_dirty(shard, frame);
+  if (--frame->pin_count == 0) {
+    shard.replacer_->Unpin(frame_id);
+  }
+  MUTEX_UNLOCK(&shard.mutex);
+  MUTEX_UNLOCK(&open_mutex_);
   return RC::SUCCESS;
 }
 
-RC DiskBufferPool::force_page(int file_id, PageNum page_num)
+RC DiskBufferPool::restore_pages(const char *file_name, int page_size, const std::map<PageNum, std::string> &pages)
 {
-  RC rc;
-  if ((rc = check_file_id(file_id)) != RC::SUCCESS) {
-    LOG_ERROR("Failed to alloc page, due to invalid fileId %d", file_id);
-    return rc;
+  int fd = open(file_name, O_RDWR);
+  if (fd < 0) {
+    // 文件之后被删除了
+    LOG_INFO("Skip restoring %d pages of %s, because %s.", (int)pages.size(), file_name, strerror(errno));
+    return RC::SUCCESS;
   }
-  BPFileHandle *file_handle = open_list_[file_id];
-  return force_page(file_handle, page_num);
+
+  // 文件头页先按原样写回去，之后的页面按照文件头中的压缩方式和有没有校验和写
+  RC rc = RC::SUCCESS;
+  auto hdr_iter = pages.find(0);
+  if (hdr_iter != pages.end() && pwrite(fd, hdr_iter->second.data(), page_size, 0) != page_size) {
+    LOG_ERROR("Failed to restore header of %s, due to %s.", file_name, strerror(errno));
+    rc = RC::IOERR_WRITE;
+  }
+  int file_page_size = 0;
+  PageCompression compression = PAGE_COMPRESSION_NONE;
+  bool checksum = false;
+  bool legacy = false;
+  if (rc == RC::SUCCESS) {
+    rc = read_page_size(fd, file_name, &file_page_size, &compression, &checksum, &legacy);
+  }
+  if (rc == RC::SUCCESS && file_page_size != page_size) {
+    LOG_ERROR("Failed to restore pages of %s, page size of file is %d, but redo log's is %d.",
+              file_name, file_page_size, page_size);
+    rc = RC::INVALID_ARGUMENT;
+  }
+
+  char *buffer = nullptr;
+  if (rc == RC::SUCCESS && (compression != PAGE_COMPRESSION_NONE || checksum)) {
+    buffer = alloc_compress_buffer(page_size);
+    if (buffer == nullptr && checksum) {
+      LOG_ERROR("Failed to restore pages of %s, due to failed to alloc buffer.", file_name);
+      rc = RC::NOMEM;
+    }
+  }
+  for (auto iter = pages.begin(); iter != pages.end() && rc == RC::SUCCESS; ++iter) {
+    // 带校验和的文件头页要再写一次，换上校验和
+    if (iter->first == 0 && !checksum) {
+      continue;
+    }
+    const char *data = iter->second.data();
+    int len = page_size;
+    if (buffer != nullptr) {
+      len = page_image((const Page *)data, page_size, checksum,
+          iter->first == 0 ? PAGE_COMPRESSION_NONE : compression, buffer, &data);
+    }
+    s64_t offset = ((s64_t)iter->first) * page_size;
+    if (pwrite(fd, data, len, offset) != len) {
+      LOG_ERROR("Failed to restore page %d of %s, due to %s.", iter->first, file_name, strerror(errno));
+      rc = RC::IOERR_WRITE;
+    } else if (len < page_size &&
+               fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset + len, page_size - len) != 0) {
+      LOG_DEBUG("Failed to punch hole at %lld of %s due to %s.", offset + len, file_name, strerror(errno));
+    }
+  }
+  free(buffer);
+
+  if (rc == RC::SUCCESS && fsync(fd) != 0) {
+    LOG_ERROR("Failed to sync %s, due to %s.", file_name, strerror(errno));
+    rc = RC::IOERR_FSYNC;
+  }
+  close(fd);
+  if (rc == RC::SUCCESS) {
+    LOG_INFO("Restore %d pages of %s from redo log.", (int)pages.size(), file_name);
+  }
+  return rc;
 }
-/**
- * dispose_page will delete the data of the page of pageNum
- * force_page will flush the page of pageNum
- * @param fileHandle
- * @param pageNum
- * @return
- */
-RC DiskBufferPool::force_page(BPFileHandle *file_handle, PageNum page_num)
+
+void DiskBufferPool::dump_status(std::ostream &os)
 {
-  int i;
-  for (i = 0; i < BP_BUFFER_SIZE; i++) {
-    if (!bp_manager_.allocated[i])
+  int dirty_pages = dirty_page_count();
+  BPFileMetric total;
+  MUTEX_LOCK(&open_mutex_);
+  for (int i = 0; i < file_slots_; i++) {
+    BPFileHandle *file_handle = file_handle_of(i);
+    if (file_handle == nullptr) {
       continue;
+    }
+    BPFileMetric *metric = file_handle->metric;
+    total.hits += metric->hits;
+    total.misses += metric->misses;
+    total.evictions += metric->evictions;
+    total.dirty_flushes += metric->dirty_flushes;
+    total.read_bytes += metric->read_bytes;
+    total.write_bytes += metric->write_bytes;
+    total.pin_wait_ns += metric->pin_wait_ns;
+    total.checksum_errors += metric->checksum_errors;
+    dump_metric(os, dirty_pages, file_handle->file_name, *metric);
+  }
+  MUTEX_UNLOCK(&open_mutex_);
+  dump_metric(os, dirty_pages, "total", total);
+}
 
-    Frame *frame = &bp_manager_.frame[i];
-    if (frame->file_desc != file_handle->file_desc)
-      continue;
-    if (frame->page.page_num != page_num && page_num != -1) {
-      continue;
+void DiskBufferPool::dump_metric(std::ostream &os, int dirty_pages, const char *name, const BPFileMetric &metric)
+{
+  os << page_size_ << " | " << pool_size_ << " | " << dirty_pages << " | " << name << " | " << metric.hits << " | "
+     << metric.misses << " | " << std::fixed << std::setprecision(2) << metric.hit_ratio() << " | "
+     << metric.evictions << " | " << metric.dirty_flushes << " | " << metric.read_bytes << " | "
+     << metric.write_bytes << " | " << metric.pin_wait_ns / 1000 << " | " << metric.checksum_errors << std::endl;
+}
+
+void DiskBufferPool::resident_pages(std::vector<std::pair<std::string, PageNum>> &pages)
+{
+  MUTEX_LOCK(&open_mutex_);
+  for (BPManager *shard : shards_) {
+    MUTEX_LOCK(&shard->mutex);
+    for (const auto &file_pages : shard->page_table_) {
+      BPFileHandle *file_handle = file_handle_of(file_pages.first);
+      if (file_handle == nullptr) {
+        continue;
+      }
+      for (const auto &page : file_pages.second) {
+        pages.emplace_back(file_handle->file_name, page.first);
+      }
     }
+    MUTEX_UNLOCK(&shard->mutex);
+  }
+  MUTEX_UNLOCK(&open_mutex_);
+  std::sort(pages.begin(), pages.end());
+}
 
-    if (frame->pin_count != 0) {
-      LOG_ERROR("Page :%s:%d has been pinned.", file_handle->file_name, page_num);
-      return RC::BUFFERPOOL_PAGE_PINNED;
+int DiskBufferPool::warm_up(const std::string &file_name, const std::vector<PageNum> &pages,
+                            const std::atomic<bool> &stop)
+{
+  int loaded = 0;
+  size_t begin = 0;
+  while (begin < pages.size() && !stop) {
+    // 每次处理页号连续的一段，最多BP_READ_AHEAD_PAGES个页面，处理完放开锁，不会长时间阻塞打开关闭文件和刷盘
+    size_t end = begin + 1;
+    while (end < pages.size() && end - begin < BP_READ_AHEAD_PAGES && pages[end] == pages[end - 1] + 1) {
+      end++;
     }
 
-    if (frame->dirty) {
-      RC rc = RC::SUCCESS;
-      if ((rc = flush_block(frame)) != RC::SUCCESS) {
-        LOG_ERROR("Failed to flush page:%s:%d.", file_handle->file_name, page_num);
-        return rc;
+    // 持有open_mutex_时文件不会被关闭，持有文件锁时页面不会被dispose_page释放
+    MUTEX_LOCK(&open_mutex_);
+    auto iter = file_ids_.find(file_name);
+    if (iter == file_ids_.end()) {
+      // 表已经被删除或者还没有打开
+      MUTEX_UNLOCK(&open_mutex_);
+      break;
+    }
+    BPFileHandle *file_handle = file_handle_of(iter->second);
+    MUTEX_LOCK(&file_handle->mutex);
+    PageNum start = pages[begin];
+    PageNum stop_page = std::min(pages[end - 1] + 1, (PageNum)file_handle->file_sub_header->page_count);
+    if (!file_handle->direct_io && stop_page - start > 1) {
+      // 一次大的顺序读交给内核，后面逐页加载时直接命中page cache
+      FileDescCache &fd_cache = FileDescCache::instance();
+      int fd = -1;
+      if (fd_cache.acquire(file_handle, &fd) == RC::SUCCESS) {
+        posix_fadvise(fd, (s64_t)start * page_size_, (s64_t)(stop_page - start) * page_size_, POSIX_FADV_WILLNEED);
+        fd_cache.release(file_handle);
       }
     }
-    bp_manager_.allocated[i] = false;
-    return RC::SUCCESS;
+    for (size_t i = begin; i < end; i++) {
+      if (prefetch_page(file_handle, pages[i]) == RC::SUCCESS) {
+        loaded++;
+      }
+    }
+    MUTEX_UNLOCK(&file_handle->mutex);
+    MUTEX_UNLOCK(&open_mutex_);
+    begin = end;
   }
-  return RC::SUCCESS;
+  return loaded;
 }
 
-RC DiskBufferPool::flush_all_pages(int file_id)
+RC DiskBufferPool::missing_pages(int file_id, int max_pages, std::string &file_name, std::vector<PageNum> &pages)
 {
   RC rc = check_file_id(file_id);
   if (rc != RC::SUCCESS) {
-    LOG_ERROR("Failed to flush pages due to invalid file_id %d", file_id);
     return rc;
   }
-
-  BPFileHandle *file_handle = open_list_[file_id];
-  return force_all_pages(file_handle);
-}
-
-RC DiskBufferPool::force_all_pages(BPFileHandle *file_handle)
-{
-
-  for (int i = 0; i < BP_BUFFER_SIZE; i++) {
-    if (!bp_manager_.allocated[i])
-      continue;
-
-    if (bp_manager_.frame[i].file_desc != file_handle->file_desc)
-      continue;
-
-    if (bp_manager_.frame[i].dirty) {
-      RC rc = flush_block(&bp_manager_.frame[i]);
-      if (rc != RC::SUCCESS) {
-        LOG_ERROR("Failed to flush all pages' of %s.", file_handle->file_name);
-        return rc;
+  BPFileHandle *file_handle = file_handle_of(file_id);
+  MUTEX_LOCK(&file_handle->mutex);
+  file_name = file_handle->file_name;
+  if (file_handle->mapped_frames == nullptr) {
+    const PageNum page_count = file_handle->file_sub_header->page_count;
+    for (PageNum page_num = 1; page_num < page_count && (int)pages.size() < max_pages; page_num++) {
+      if ((file_handle->bitmap[page_num / 8] & (1 << (page_num % 8))) == 0) {
+        continue;
+      }
+      BPManager &shard = shard_of(file_id, page_num);
+      MUTEX_LOCK(&shard.mutex);
+      const bool resident = shard.find_frame(file_id, page_num) != -1;
+      MUTEX_UNLOCK(&shard.mutex);
+      if (!resident) {
+        pages.push_back(page_num);
       }
     }
-    bp_manager_.allocated[i] = false;
   }
+  MUTEX_UNLOCK(&file_handle->mutex);
   return RC::SUCCESS;
 }
 
-RC DiskBufferPool::flush_block(Frame *frame)
+bool DiskBufferPool::is_page_resident(int file_id, PageNum page_num)
 {
-  // The better way is use mmap the block into memory,
-  // so it is easier to flush data to file.
-
-  s64_t offset = ((s64_t)frame->page.page_num) * sizeof(Page);
-  if (lseek(frame->file_desc, offset, SEEK_SET) == offset - 1) {
-    LOG_ERROR("Failed to flush page %lld of %d due to failed to seek %s.", offset, frame->file_desc, strerror(errno));
-    return RC::IOERR_SEEK;
+  if (check_file_id(file_id) != RC::SUCCESS) {
+    return false;
   }
+  if (file_handle_of(file_id)->mapped_frames != nullptr) {
+    return true;
+  }
+  BPManager &shard = shard_of(file_id, page_num);
+  MUTEX_LOCK(&shard.mutex);
+  const bool resident = shard.find_frame(file_id, page_num) != -1;
+  MUTEX_UNLOCK(&shard.mutex);
+  return resident;
+}
 
-  if (write(frame->file_desc, &(frame->page), sizeof(Page)) != sizeof(Page)) {
-    LOG_ERROR("Failed to flush page %lld of %d due to %s.", offset, frame->file_desc, strerror(errno));
-    return RC::IOERR_WRITE;
+RC DiskBufferPool::prefetch_page(BPFileHandle *file_handle, PageNum page_num)
+{
+  // 映射的文件不用预热。文件头页一直在缓冲池中。文件在上次记录之后可能被截断或者释放了页面
+  if (file_handle->mapped_frames != nullptr) {
+    return RC::BUFFERPOOL_EXIST;
+  }
+  if (page_num <= 0 || page_num >= file_handle->file_sub_header->page_count ||
+      (file_handle->bitmap[page_num / 8] & (1 << (page_num % 8))) == 0) {
+    return RC::BUFFERPOOL_INVALID_PAGE_NUM;
   }
-  frame->dirty = false;
-  LOG_DEBUG("Flush block. file desc=%d, page num=%d", frame->file_desc, frame->page.page_num);
 
+  BPManager &shard = shard_of(file_handle->file_id, page_num);
+  MUTEX_LOCK(&shard.mutex);
+  if (shard.find_frame(file_handle->file_id, page_num) != -1) {
+    MUTEX_UNLOCK(&shard.mutex);
+    return RC::BUFFERPOOL_EXIST;
+  }
+  // 只使用空闲的frame，不淘汰请求已经加载的页面
+  if (shard.free_list_.empty()) {
+    MUTEX_UNLOCK(&shard.mutex);
+    return RC::BUFFERPOOL_NOBUF;
+  }
+  Frame *frame = nullptr;
+  RC rc = allocate_block(shard, &frame);
+  if (rc != RC::SUCCESS) {
+    MUTEX_UNLOCK(&shard.mutex);
+    return rc;
+  }
+  bind_file(frame, file_handle);
+  frame->pin_count = 0;
+  frame->acc_time = current_time();
+  rc = load_page(page_num, file_handle, frame);
+  if (rc != RC::SUCCESS) {
+    LOG_WARN("Failed to warm up page %s:%d", file_handle->file_name, page_num);
+    dispose_block(shard, frame);
+    MUTEX_UNLOCK(&shard.mutex);
+    return rc;
+  }
+  int frame_id = frame - shard.frame;
+  shard.bind_frame(file_handle->file_id, page_num, frame_id);
+  shard.replacer_->Unpin(frame_id);
+  MUTEX_UNLOCK(&shard.mutex);
   return RC::SUCCESS;
 }
 
-RC DiskBufferPool::allocate_block(Frame **buffer)
+void DiskBufferPool::flush_round()
 {
-  // There is one Frame which is free.
-  for (int i = 0; i < BP_BUFFER_SIZE; i++) {
-    if (!bp_manager_.allocated[i]) {
-      bp_manager_.allocated[i] = true;
-      *buffer = bp_manager_.frame + i;
-      LOG_DEBUG("Allocate block frame=%p", bp_manager_.frame + i);
-      return RC::SUCCESS;
-    }
-  }
-  int min = 0;
-  unsigned long mintime = 0;
-  bool flag = false;
-  for (int i = 0; i < BP_BUFFER_SIZE; i++) {
-    if (bp_manager_.frame[i].pin_count != 0)
+  int dirty_pages = dirty_page_count();
+  int high_water = pool_size_ * dirty_ratio_ / 100;
+  int target = dirty_pages >= high_water ? dirty_pages - high_water / 2 : std::min(dirty_pages, BP_FLUSH_TRICKLE_PAGES);
+  if (target <= 0) {
+    return;
+  }
+
+  MUTEX_LOCK(&open_mutex_);
+  for (int i = 0; i < file_slots_ && target > 0; i++) {
+    BPFileHandle *file_handle = file_handle_of(i);
+    if (file_handle == nullptr) {
       continue;
-    if (!flag) {
-      flag = true;
-      min = i;
-      mintime = bp_manager_.frame[i].acc_time;
     }
-    if (bp_manager_.frame[i].acc_time < mintime) {
-      min = i;
-      mintime = bp_manager_.frame[i].acc_time;
+    // 一个文件可能要分多批才能刷完
+    int flushed = 0;
+    do {
+      flushed = flush_file_pages(file_handle, std::min(target, BP_FLUSH_BATCH_PAGES));
+      target -= flushed;
+    } while (flushed == BP_FLUSH_BATCH_PAGES && target > 0);
+  }
+  MUTEX_UNLOCK(&open_mutex_);
+}
+
+int DiskBufferPool::flush_file_pages(BPFileHandle *file_handle, int max_pages)
+{
+  int file_id = file_handle->file_id;
+  // 持有文件锁，避免刷盘期间页面被dispose_page/force_page释放
+  MUTEX_LOCK(&file_handle->mutex);
+  std::vector<PageNum> dirty_pages;
+  for (BPManager *shard : shards_) {
+    MUTEX_LOCK(&shard->mutex);
+    auto file_iter = shard->page_table_.find(file_id);
+    if (file_iter != shard->page_table_.end()) {
+      for (auto &entry : file_iter->second) {
+        Frame *frame = &shard->frame[entry.second];
+        if (shard->allocated[entry.second] && frame->file_id == file_id && frame->dirty && frame->pin_count == 0) {
+          dirty_pages.push_back(entry.first);
+        }
+      }
     }
+    MUTEX_UNLOCK(&shard->mutex);
   }
-  if (!flag) {
-    LOG_ERROR("All pages have been used and pinned.");
-    return RC::NOMEM;
+  if (dirty_pages.empty()) {
+    MUTEX_UNLOCK(&file_handle->mutex);
+    return 0;
   }
 
-  if (bp_manager_.frame[min].dirty) {
-    RC rc = flush_block(&(bp_manager_.frame[min]));
-    if (rc != RC::SUCCESS) {
-      LOG_ERROR("Failed to flush block of %d for %d.", min, bp_manager_.frame[min].file_desc);
-      return rc;
+  // 从上次停下的位置开始按页号顺序刷，刷到文件末尾之后从头开始
+  std::sort(dirty_pages.begin(), dirty_pages.end());
+  size_t start = std::lower_bound(dirty_pages.begin(), dirty_pages.end(), file_handle->flush_page) - dirty_pages.begin();
+  if (start == dirty_pages.size()) {
+    start = 0;
+  }
+  std::rotate(dirty_pages.begin(), dirty_pages.begin() + start, dirty_pages.end());
+  if ((int)dirty_pages.size() > max_pages) {
+    dirty_pages.resize(max_pages);
+  }
+
+  // pin住要刷的页面，这样写盘时不用持有分片锁。
+  // 先清除脏标记，写盘期间如果页面又被修改，mark_dirty会重新设置脏标记
+  std::vector<Frame *> frames;
+  for (PageNum page_num : dirty_pages) {
+    BPManager &shard = shard_of(file_id, page_num);
+    MUTEX_LOCK(&shard.mutex);
+    int frame_id = shard.find_frame(file_id, page_num);
+    if (frame_id != -1 && shard.allocated[frame_id]) {
+      Frame *frame = &shard.frame[frame_id];
+      if (frame->dirty && frame->pin_count == 0) {
+        log_frame(frame);
+        frame->pin_count++;
+        frame->dirty = false;
+        frames.push_back(frame);
+      }
     }
+    MUTEX_UNLOCK(&shard.mutex);
   }
-  *buffer = bp_manager_.frame + min;
-  return RC::SUCCESS;
+
+  if (!frames.empty()) {
+    for (Frame *frame : frames) {
+      pthread_rwlock_rdlock(&frame->latch);
+    }
+    RC rc = flush_frames(frames.data(), (int)frames.size());
+    for (Frame *frame : frames) {
+      pthread_rwlock_unlock(&frame->latch);
+    }
+
+    for (Frame *frame : frames) {
+      BPManager &shard = shard_of(frame);
+      MUTEX_LOCK(&shard.mutex);
+      if (rc != RC::SUCCESS) {
+        frame->dirty = true;
+      }
+      if (--frame->pin_count == 0) {
+        shard.replacer_->Unpin(frame - shard.frame);
+      }
+      MUTEX_UNLOCK(&shard.mutex);
+    }
+  }
+
+  file_handle->flush_page = dirty_pages.back() + 1;
+  MUTEX_UNLOCK(&file_handle->mutex);
+  return (int)frames.size();
 }
 
-RC DiskBufferPool::dispose_block(Frame *buf)
+RC DiskBufferPool::dispose_block(BPManager &shard, Frame *buf)
 {
   if (buf->pin_count != 0) {
-    LOG_WARN("Begin to free page %d of %d, but it's pinned.", buf->page.page_num, buf->file_desc);
+    LOG_WARN("Begin to free page %d of %d, but it's pinned.", buf->page->page_num, buf->file_id);
     return RC::LOCKED_UNLOCK;
   }
   if (buf->dirty) {
     RC rc = flush_block(buf);
     if (rc != RC::SUCCESS) {
-      LOG_WARN("Failed to flush block %d of %d during dispose block.", buf->page.page_num, buf->file_desc);
+      LOG_WARN("Failed to flush block %d of %d during dispose block.", buf->page->page_num, buf->file_id);
       return rc;
     }
   }
   buf->dirty = false;
-  int pos = buf - bp_manager_.frame;
-  bp_manager_.allocated[pos] = false;
+  int pos = buf - shard.frame;
+  shard.free_frame(pos);
   LOG_DEBUG("dispost block frame =%p", buf);
   return RC::SUCCESS;
 }
 
 RC DiskBufferPool::check_file_id(int file_id)
 {
-  if (file_id < 0 || file_id >= MAX_OPEN_FILE) {
+  if (file_id < 0 || file_id >= BP_FILE_CHUNK_SIZE * BP_MAX_FILE_CHUNKS) {
     LOG_ERROR("Invalid fileId:%d.", file_id);
     return RC::BUFFERPOOL_ILLEGAL_FILE_ID;
   }
-  if (!open_list_[file_id]) {
+  if (file_handle_of(file_id) == nullptr) {
     LOG_ERROR("Invalid fileId:%d, it is empty.", file_id);
     return RC::BUFFERPOOL_ILLEGAL_FILE_ID;
   }
@@ -632,7 +2981,42 @@ RC DiskBufferPool::get_page_count(int file_id, int *page_count)
   if ((rc = check_file_id(file_id)) != RC::SUCCESS) {
     return rc;
   }
-  *page_count = open_list_[file_id]->file_sub_header->page_count;
+  *page_count = file_handle_of(file_id)->file_sub_header->page_count;
+  return RC::SUCCESS;
+}
+
+bool DiskBufferPool::is_page_allocated(int file_id, PageNum page_num)
+{
+  if (check_file_id(file_id) != RC::SUCCESS) {
+    return false;
+  }
+  BPFileHandle *file_handle = file_handle_of(file_id);
+  MUTEX_LOCK(&file_handle->mutex);
+  bool allocated = page_num >= 0 && page_num < file_handle->file_sub_header->page_count &&
+                   (file_handle->bitmap[page_num / 8] & (1 << (page_num % 8))) != 0;
+  MUTEX_UNLOCK(&file_handle->mutex);
+  return allocated;
+}
+
+RC DiskBufferPool::disable_file_redo(int file_id)
+{
+  RC rc = RC::SUCCESS;
+  if ((rc = check_file_id(file_id)) != RC::SUCCESS) {
+    return rc;
+  }
+  BPFileHandle *file_handle = file_handle_of(file_id);
+  file_handle->no_redo = true;
+  file_handle->hdr_frame->no_redo = true;
+  return RC::SUCCESS;
+}
+
+RC DiskBufferPool::get_file_compression(int file_id, PageCompression *compression)
+{
+  RC rc = RC::SUCCESS;
+  if ((rc = check_file_id(file_id)) != RC::SUCCESS) {
+    return rc;
+  }
+  *compression = file_handle_of(file_id)->compression;
   return RC::SUCCESS;
 }
 
@@ -651,17 +3035,41 @@ RC DiskBufferPool::check_page_num(PageNum page_num, BPFileHandle *file_handle)
 
 RC DiskBufferPool::load_page(PageNum page_num, BPFileHandle *file_handle, Frame *frame)
 {
-  s64_t offset = ((s64_t)page_num) * sizeof(Page);
-  if (lseek(file_handle->file_desc, offset, SEEK_SET) == -1) {
-    LOG_ERROR(
-        "Failed to load page %s:%d, due to failed to lseek:%s.", file_handle->file_name, page_num, strerror(errno));
-
-    return RC::IOERR_SEEK;
+  common::TraceSpanScope span("storage", "page_read");
+  FileDescCache &fd_cache = FileDescCache::instance();
+  int fd = -1;
+  RC rc = fd_cache.acquire(file_handle, &fd);
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to load page %s:%d, due to failed to open file.", file_handle->file_name, page_num);
+    return rc;
   }
-  if (read(file_handle->file_desc, &(frame->page), sizeof(Page)) != sizeof(Page)) {
+  s64_t offset = ((s64_t)page_num) * page_size_;
+  ssize_t len = pread(fd, frame->page, page_size_, offset);
+  fd_cache.release(file_handle);
+  // 文件最后一个页面压缩之后只写了前面一部分，文件长度可能不到一整页
+  bool compressed = file_handle->compression != PAGE_COMPRESSION_NONE && len > 0 &&
+                    is_compressed_page((const char *)frame->page, (int)len);
+  if (len != page_size_ && !compressed) {
     LOG_ERROR(
         "Failed to load page %s:%d, due to failed to read data:%s.", file_handle->file_name, page_num, strerror(errno));
     return RC::IOERR_READ;
   }
+  if (compressed) {
+    std::vector<char> data((const char *)frame->page, (const char *)frame->page + len);
+    rc = decompress_page(data.data(), (int)len, (char *)frame->page, page_size_);
+    if (rc != RC::SUCCESS) {
+      LOG_ERROR("Failed to load page %s:%d, due to failed to decompress.", file_handle->file_name, page_num);
+      return rc;
+    }
+  }
+  file_handle->metric->read_bytes += len;
+  if (file_handle->checksum) {
+    if (frame->page->page_num != page_checksum(page_num, frame->page, page_size_)) {
+      file_handle->metric->checksum_errors++;
+      LOG_ERROR("Failed to load page %s:%d, due to checksum mismatch.", file_handle->file_name, page_num);
+      return RC::CORRUPT;
+    }
+    frame->page->page_num = page_num;
+  }
   return RC::SUCCESS;
 }
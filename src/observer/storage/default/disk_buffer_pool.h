@@ -15,6 +15,7 @@ See the Mulan PSL v2 for more details. */
 #define __OBSERVER_STORAGE_COMMON_PAGE_MANAGER_H_
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <sys/types.h>
 
@@ -22,43 +23,134 @@ See the Mulan PSL v2 for more details. */
 #include <sys/stat.h>
 #include <time.h>
 
+#include <atomic>
+#include <map>
+#include <ostream>
+#include <string>
 #include <vector>
 // self added 21/10/16
 #include <list>
 #include <unordered_map>
 
 #include "rc.h"
+#include "common/metrics/metric.h"
+#include "storage/default/page_compressor.h"
+#include "storage/default/page_io.h"
 
 typedef int PageNum;
 
 //
 #define BP_INVALID_PAGE_NUM (-1)
-#define BP_PAGE_SIZE (1 << 12)   // 4k byte
+#define BP_PAGE_SIZE (1 << 12)   // 默认页面大小 4k byte
 #define BP_PAGE_DATA_SIZE (BP_PAGE_SIZE - sizeof(PageNum)) // 4k-8 byte
+#define BP_MIN_PAGE_SIZE BP_PAGE_SIZE
+#define BP_MAX_PAGE_SIZE (1 << 15)   // 32k byte
 #define BP_FILE_SUB_HDR_SIZE (sizeof(BPFileSubHeader))
-#define BP_BUFFER_SIZE 50
-#define MAX_OPEN_FILE 1024
-
+#define BP_FILE_PAGE_SIZE_MASK 0xffff   // 文件头page_size字段的低16位是页面大小
+#define BP_FILE_COMPRESSION_SHIFT 16    // 高16位是页面的压缩方式
+#define BP_FILE_COMPRESSION_MASK 0x7fff
+#define BP_FILE_CHECKSUM_FLAG 0x80000000u  // 最高位表示文件中的页面带有校验和，旧版本创建的文件没有
+#define BP_BUFFER_SIZE 50   // 默认的缓冲池frame数量，可以通过配置项BufferPoolSize调整
+#define BP_ARENA_ALIGN (2 << 20) // 页面内存按照huge page(2M)对齐分配
+#define BP_CACHE_LINE_SIZE 64    // frame的元数据按照cache line对齐
+#define BP_FILE_CHUNK_SIZE 1024    // 文件表每次扩展的大小
+#define BP_MAX_FILE_CHUNKS 1024    // 一个缓冲池最多打开 BP_FILE_CHUNK_SIZE * BP_MAX_FILE_CHUNKS 个文件
+#define BP_MIN_CACHED_FDS 16       // fd缓存至少可以保留的fd数
+#define BP_MAX_SHARD_NUM 16       // 缓冲池最多拆分的分片数
+#define BP_MIN_SHARD_FRAMES 64    // 每个分片至少包含的frame数，太小的分片容易被pin满
+#define BP_READ_AHEAD_TRIGGER 2   // 连续顺序加载多少个页面之后开始预读
+#define BP_READ_AHEAD_PAGES 32    // 每次预读的页面数
+#define BP_DEFAULT_DIRTY_RATIO 50 // 脏页比例(百分比)超过这个值时后台线程集中刷盘
+#define BP_FLUSH_INTERVAL_MS 100  // 后台刷盘线程的检查间隔
+#define BP_FLUSH_BATCH_PAGES 64   // 后台线程每批最多刷的页面数
+#define BP_FLUSH_TRICKLE_PAGES 8  // 脏页比例没有超过阈值时，每次检查慢慢刷出去的页面数
+#define BUFFER_POOL_DUMP_FILE "buffer_pool.dump"  // 数据目录下记录缓冲池页面列表的文件，重启之后用来预热
+
+// 页面大小由文件决定，data的实际长度是 page_size - sizeof(PageNum)
 typedef struct {
   PageNum page_num;
   char data[BP_PAGE_DATA_SIZE];
 } Page;
-// sizeof(Page) should be equal to BP_PAGE_SIZE  4k
+// sizeof(Page) is equal to BP_PAGE_SIZE  4k, the default page size
 
 typedef struct {
   PageNum page_count;
   int allocated_pages;
+  int page_size;   // 旧版本的文件没有这个字段，这个位置是bitmap，值一定是奇数(第0页总是被分配)
+                   // 低16位是页面大小，高16位是PageCompression
 } BPFileSubHeader;
 
+/**
+ * 页面大小需要是4k到32k之间的2的幂
+ */
+bool is_valid_page_size(int page_size);
+
+
+/**
+ * 一个打开的文件在缓冲池中的统计信息，打开文件时以 DiskBufferPool.<文件名> 注册到MetricsRegistry，
+ * 关闭文件时注销。计数都是打开文件之后的累计值
+ */
+class BPFileMetric : public common::Metric {
+public:
+  BPFileMetric();
+  ~BPFileMetric();
+
+  void snapshot() override;
+
+  /**
+   * 命中缓冲池的比例(百分比)，还没有访问时返回0
+   */
+  double hit_ratio() const;
+  std::string to_string() const;
+
+public:
+  std::atomic<long> hits;            // get_this_page时页面已经在缓冲池中
+  std::atomic<long> misses;          // get_this_page时需要从磁盘加载
+  std::atomic<long> evictions;       // 被替换策略淘汰出缓冲池的页面数
+  std::atomic<long> dirty_flushes;   // 写回磁盘的脏页数
+  std::atomic<long> read_bytes;
+  std::atomic<long> write_bytes;
+  std::atomic<long> pin_wait_ns;     // get_this_page等待分片锁和加载页面的总时间
+  std::atomic<long> checksum_errors; // 从磁盘加载时校验和不匹配的页面数
+};
+
+/**
+ * 当前线程中get_this_page的累计次数，不区分文件。EXPLAIN ANALYZE用前后两次的差计算一个算子访问的页面
+ */
+struct BPThreadStat {
+  long hits = 0;
+  long misses = 0;
+};
+BPThreadStat &bp_thread_stat();
+
+/**
+ * 页面的校验和，包括页号和页面的数据。带校验和的文件中，写盘时代替页号写在页面开头，加载时校验之后再换回页号。
+ * 最高位清零，和页号一样是非负数，不会被当成压缩页面的magic
+ */
+PageNum page_checksum(PageNum page_num, const Page *page, int page_size);
+
+class BPFileHandle;
 
 // frame wraps a page in it
-typedef struct {
+// frame中只有页面的元数据，页面内容在分片的page arena中。遍历frame和替换时访问的字段放在第一个cache line中，
+// frame按cache line对齐，页面锁等不常访问的字段放在后面
+typedef struct alignas(BP_CACHE_LINE_SIZE) {
   bool dirty;
+  bool unlogged;           // 修改之后还没有写redo日志
+  bool no_redo;            // 页面所属文件不写redo日志
+  bool checksum;           // 页面所属文件带有校验和，刷盘时计算
+  PageCompression compression;  // 页面所属文件的压缩方式，刷盘时压缩
   unsigned int pin_count;
+  int file_id;             // 页面所属文件在缓冲池中的编号，页表按它索引
   unsigned long acc_time;
-  int file_desc;
-  Page page;
-} Frame;           
+  uint64_t lsn;            // 最近一次写到redo日志中的LSN，写回数据文件之前要等这个LSN落盘
+  Page *page;              // 指向分片中页面大小的内存
+  BPFileHandle *file_handle;  // 页面所属的文件，读写页面时从它获取fd
+  BPFileMetric *metric;    // 页面所属文件的统计信息，淘汰和刷盘时计数
+  const char *file_name;   // 页面所属文件的名字，写redo日志时使用
+  // 以上字段在第一个cache line中
+  pthread_rwlock_t latch;  // 页面内容的读写锁，由使用者通过latch_page/unlatch_page加解锁
+} Frame;
 
 // BPPageHandle wrap a frame in it 
 typedef struct {
@@ -77,18 +169,129 @@ public:
 public:
   bool bopen;
   const char *file_name;
-  int file_desc;
+  int file_id;
+  int file_desc;           // 以下5个字段由FileDescCache维护，file_desc为-1表示fd已经被关闭，使用时重新打开
+  int open_flags;
+  int fd_refs;             // 正在使用fd的读写操作数
+  BPFileHandle *fd_prev;   // fd缓存的LRU链表
+  BPFileHandle *fd_next;
   Frame *hdr_frame;
   Page *hdr_page;
   char *bitmap;
   BPFileSubHeader *file_sub_header;
+  pthread_mutex_t mutex;  // 保护文件头页中的页面分配信息和下面的顺序读统计
+  PageNum last_load_page;  // 最近一次从磁盘加载的页面
+  int sequential_loads;    // 连续顺序加载的页面数
+  PageNum read_ahead_page; // 已经预读到的位置(不包含)
+  PageNum flush_page;      // 后台刷盘下一次开始的页号，按页号顺序循环刷
+  int max_page_count;      // 文件头页中的bitmap最多可以记录的页面数
+  bool direct_io;          // 文件是否以O_DIRECT方式读写
+  PageCompression compression;  // 除了文件头页，其它页面写盘时压缩
+  bool checksum;           // 页面在磁盘上开头的页号换成了校验和，加载时校验
+  bool no_redo;            // 文件的内容在重启之后没有用，页面修改之后不写redo日志
+  Frame *mapped_frames;    // map_file之后每个页面一个frame，指向文件映射中的页面，不属于任何分片
+  char *mapped_data;       // 文件的私有映射，页面上的修改不会写回文件
+  size_t mapped_len;
+  int mapped_pages;
+  BPFileMetric *metric;
+  bool metric_registered;  // 同名的文件在别的缓冲池中打开时不会重复注册
 } ;
 
+/**
+ * 所有缓冲池打开的文件共用的fd缓存，保留的fd超过上限时关闭最久没有读写过的文件的fd，
+ * 再次读写这个文件时重新打开。文件在缓冲池中的编号和缓冲池中的页面都不受影响，
+ * 打开的表和索引文件可以超过进程的fd上限。
+ * 读写文件之前用acquire获取fd，之后release，正在使用的fd不会被关闭，所以同时使用的fd可能暂时超过上限
+ */
+class FileDescCache {
+public:
+  static FileDescCache &instance();
+
+  /**
+   * 最多保留的fd数，0表示使用进程fd上限(RLIMIT_NOFILE)的一半
+   */
+  RC set_capacity(int capacity);
+  int capacity() const
+  {
+    return capacity_;
+  }
+
+  /**
+   * 文件刚刚打开，fd交给缓存管理
+   */
+  void add(BPFileHandle *file_handle, int fd, int open_flags);
+  /**
+   * 关闭文件，fd还打开着时关闭fd
+   */
+  RC remove(BPFileHandle *file_handle);
+
+  RC acquire(BPFileHandle *file_handle, int *fd);
+  void release(BPFileHandle *file_handle);
+
+  int open_count();
+  /**
+   * 被关闭之后又重新打开的次数
+   */
+  long reopens();
+
+private:
+  FileDescCache();
+
+  // 以下几个函数调用时需要持有mutex_
+  void link_front(BPFileHandle *file_handle);
+  void unlink(BPFileHandle *file_handle);
+  /**
+   * 关闭没有在使用的fd，直到保留的fd不超过limit个
+   */
+  void evict(int limit);
+
+private:
+  pthread_mutex_t mutex_;
+  int capacity_ = BP_MIN_CACHED_FDS;
+  int open_count_ = 0;
+  long reopens_ = 0;
+  BPFileHandle *lru_head_ = nullptr;  // 最近使用的在前面
+  BPFileHandle *lru_tail_ = nullptr;
+};
+
+/**
+ * 页面替换策略的接口，只记录可以被淘汰(没有被pin住)的frame
+ * Pin:     frame被使用，不能再被淘汰，同时算作一次访问
+ * Unpin:   frame不再被使用，可以被淘汰
+ * Refresh: 记录一次访问，不改变frame是否可以被淘汰
+ * Remove:  frame被释放，清除它的所有访问记录
+ */
+class Replacer {
+public:
+  virtual ~Replacer() = default;
+
+  virtual bool Victim(int *frame_id) = 0;
+
+  virtual void Pin(int frame_id) = 0;
+  virtual void Unpin(int frame_id) = 0;
+  virtual void Refresh(int frame_id) = 0;
+  virtual void Remove(int frame_id) = 0;
+
+  virtual int Size() = 0;
+};
+
+enum ReplacerType {
+  LRU_REPLACER,
+  CLOCK_REPLACER,
+  LRUK_REPLACER,   // LRU-2，只被访问过一次的页面(比如全表扫描)优先被淘汰
+};
+
+/**
+ * 根据名字(lru/clock/lru-k)获取替换策略，名字不区分大小写
+ */
+RC replacer_type_from_string(const char *name, ReplacerType *type);
+Replacer *create_replacer(ReplacerType type, int num_frames);
+
 /**
  * LRUReplacer implements the lru replacement policy.  added by xishuai 2021/10/16
  * to record unpinned pages
  */
-class LRUReplacer {
+class LRUReplacer : public Replacer {
  public:
   /**
    * Create a new LRUReplacer.
@@ -99,18 +302,19 @@ class LRUReplacer {
   /**
    * Destroys the LRUReplacer.
    */
-  ~LRUReplacer();
+  ~LRUReplacer() override;
 
-  bool Victim(int *frame_id);
+  bool Victim(int *frame_id) override;
 
-  void Pin(int frame_id);
-  void Unpin(int frame_id);
+  void Pin(int frame_id) override;
+  void Unpin(int frame_id) override;
   /**
    * 对已经在lru list中的frame重新更新位置，比如在本来靠前，但是现在被调用了就需要重新放在后面
    * */
-  void Refresh(int frame_id);
+  void Refresh(int frame_id) override;
+  void Remove(int frame_id) override;
 
-  int Size();
+  int Size() override;
 
  private:
   std::list<int> List;
@@ -118,66 +322,204 @@ class LRUReplacer {
   std::unordered_map<int, std::list<int>::iterator> map_;
 };
 
-class BPManager {
+/**
+ * CLOCK 替换策略，每个frame一个访问位，淘汰时时钟指针扫过的frame访问位为1时清零，为0时淘汰。
+ * 所有操作都不需要分配内存
+ */
+class ClockReplacer : public Replacer {
 public:
-  BPManager(int size = BP_BUFFER_SIZE) {
-    this->size = size;
-    frame = new Frame[size];
-    allocated = new bool[size];
-    for (int i = 0; i < size; i++) {
-      allocated[i] = false;
-      frame[i].pin_count = 0;
-    }
-
-    // following self-add actually allocated is no longer used
-    // Initially, every frame is in the free list.
-    replacer_ = new LRUReplacer(size);
-    for (int i = 0; i < size; ++i) {
-      free_list_.emplace_back(i);
-    }
-  }
+  explicit ClockReplacer(int num_frames);
+
+  bool Victim(int *frame_id) override;
+
+  void Pin(int frame_id) override;
+  void Unpin(int frame_id) override;
+  void Refresh(int frame_id) override;
+  void Remove(int frame_id) override;
+
+  int Size() override;
+
+private:
+  int num_frames_;
+  int hand_ = 0;
+  int size_ = 0;
+  std::vector<char> referenced_;
+  std::vector<char> evictable_;
+};
 
-  ~BPManager() {
-    delete[] frame;
-    delete[] allocated;
-    delete replacer_;
-    size = 0;
-    frame = nullptr;
-    allocated = nullptr;
+/**
+ * LRU-K(K=2) 替换策略。访问次数不足K次的frame放在history链表中按照FIFO淘汰，
+ * 访问了K次及以上的frame放在cache链表中按照LRU淘汰，淘汰时优先选择history中的frame。
+ * 这样大范围的顺序扫描只会在history中轮转，不会把B+树的内部节点等热点页挤出缓冲池。
+ * 链表用数组实现，不需要分配内存
+ */
+class LRUKReplacer : public Replacer {
+public:
+  explicit LRUKReplacer(int num_frames, int k = 2);
+
+  bool Victim(int *frame_id) override;
+
+  void Pin(int frame_id) override;
+  void Unpin(int frame_id) override;
+  void Refresh(int frame_id) override;
+  void Remove(int frame_id) override;
+
+  int Size() override;
+
+private:
+  enum { NO_LIST = -1, HISTORY_LIST = 0, CACHE_LIST = 1 };
+
+  void link(int list, int frame_id);
+  void unlink(int frame_id);
+  int head(int list) const
+  {
+    return next_[num_frames_ + list];
   }
+
+private:
+  int num_frames_;
+  int k_;
+  int size_ = 0;
+  std::vector<int> access_count_;
+  std::vector<int> list_of_;
+  // 下标 num_frames_ 和 num_frames_ + 1 分别是history和cache链表的哨兵节点
+  std::vector<int> prev_;
+  std::vector<int> next_;
+};
+
+class BPManager {
+public:
+  /**
+   * numa_node不小于0时，页面内存优先分配在这个numa节点上
+   */
+  BPManager(int size = BP_BUFFER_SIZE, ReplacerType replacer_type = LRU_REPLACER, int page_size = BP_PAGE_SIZE,
+            int numa_node = -1);
+
+  ~BPManager();
+
   int get_replace_frame();  // self-added
 
   Frame *alloc(); // TODO for test
 
-  Frame *get(int file_desc, PageNum page_num); // TODO for test
+  /**
+   * 按页表查找，alloc之后要先用bind_frame登记frame中的页面
+   */
+  Frame *get(int file_id, PageNum page_num);
 
   Frame *getFrame() { return frame; }
 
   bool *getAllocated() { return allocated; }
 
+  /**
+   * 页表相关操作: (file_id, page_num) --> frame id
+   * find_frame 找不到时返回-1
+   */
+  int find_frame(int file_id, PageNum page_num);
+  void bind_frame(int file_id, PageNum page_num, int frame_id);
+  void unbind_frame(int frame_id);
+
+  /**
+   * 释放frame，放回空闲链表
+   */
+  void free_frame(int frame_id);
+
 public:
 /**   注释
+ *    一个BPManager就是缓冲池的一个分片，mutex 保护分片内的页表、frame分配状态和pin_count
  *    allocated-->表示是否被分配
  *    allocated[i]=true-->frame[i]保存了相关内容
  * 
 */
   int size;
+  int page_size;
+  pthread_mutex_t mutex;
   // now fram contains pinned/unpinned/free frames
   Frame *frame = nullptr;
   bool *allocated = nullptr;
   // self-added 
   std::list<int> free_list_;
-  LRUReplacer *replacer_;
-  // for get function map<&file_desc,frame_id>
-  // std::unordered_map<*int, int> page_table_;
+  Replacer *replacer_;
+  char *page_arena_ = nullptr; // 所有frame的页面内存
+  size_t arena_size_ = 0; // 页面内存实际占用的大小
+  // 页表 map<file_id, map<page_num, frame_id>>，按文件分组便于刷整个文件的页
+  std::unordered_map<int, std::unordered_map<PageNum, int>> page_table_;
+  // 被标记为unlogged的frame，事务提交时从这里找到需要写日志的页面。frame被复用之后可能还留在这里
+  std::vector<int> unlogged_frames_;
 };
 
 class DiskBufferPool {
 public:
   /**
-  * 创建一个名称为指定文件名的分页文件
+   * 按照pool_size创建缓冲池，frame较多时会拆成多个分片，页面按(file_id, page_num)哈希到分片上，
+   * 每个分片有自己的锁，不同分片上的页面访问可以并发进行。
+   * 一个缓冲池只管理页面大小为page_size的文件。
+   * numa为true时，各个分片的页面内存轮流分配在不同的numa节点上
+   */
+  explicit DiskBufferPool(int pool_size = BP_BUFFER_SIZE, ReplacerType replacer_type = LRU_REPLACER,
+                          PageIoType page_io_type = SYNC_PAGE_IO, int page_size = BP_PAGE_SIZE, bool numa = false);
+  ~DiskBufferPool();
+
+  /**
+   * 缓冲池中frame的数量
+   */
+  int pool_size() const
+  {
+    return pool_size_;
+  }
+
+  int shard_num() const
+  {
+    return (int)shards_.size();
+  }
+
+  int page_size() const
+  {
+    return page_size_;
+  }
+
+  /**
+   * 页面中可以给使用者存放数据的大小
+   */
+  int page_data_size() const
+  {
+    return page_size_ - (int)sizeof(PageNum);
+  }
+
+  /**
+   * 之后打开的文件使用O_DIRECT读写，页面内存不会在内核page cache中再缓存一份。
+   * frame的页面内存按照huge page对齐，页面大小是4k的倍数，满足O_DIRECT的对齐要求。
+   * 文件系统不支持O_DIRECT时退回到普通IO
+   */
+  void set_direct_io(bool direct_io)
+  {
+    direct_io_ = direct_io;
+  }
+
+  /**
+   * 从文件头中读取文件的页面大小，不需要打开文件
+   */
+  static RC read_file_page_size(const char *file_name, int *page_size);
+
+  /**
+   * 把redo日志中的页面写回文件，文件已经不存在时忽略。压缩的文件按照文件头中的压缩方式写出。
+   * 写完之后sync文件，恢复时在打开文件之前使用
+   */
+  static RC restore_pages(const char *file_name, int page_size, const std::map<PageNum, std::string> &pages);
+
+  /**
+   * 实际使用的IO后端，io_uring不可用时会退回到sync
+   */
+  const char *page_io_name() const
+  {
+    return page_io_->name();
+  }
+
+  /**
+  * 创建一个名称为指定文件名的分页文件。
+  * compression不是NONE时，除了文件头页之外的页面写盘时压缩，压缩后多出的空间在文件中打洞释放，
+  * 读取时解压到frame中，缓冲池中的页面总是未压缩的。适合很少访问的冷数据，页面大小至少8k才能节省空间
   */
-  RC create_file(const char *file_name);
+  RC create_file(const char *file_name, PageCompression compression = PAGE_COMPRESSION_NONE);
 
   /**
    * 根据文件名打开一个分页文件，返回文件ID
@@ -189,6 +531,19 @@ public:
    * 关闭fileID对应的分页文件
    */
   RC close_file(int file_id);
+  /**
+   * 关闭马上要删除的文件：缓冲池中这个文件的页面按照页表一次全部释放，脏页不写回，也不写redo日志。
+   * 文件由调用者删除
+   */
+  RC drop_file(int file_id);
+
+  /**
+   * 把文件整个映射到内存中(MAP_PRIVATE|MAP_POPULATE)，之后get_this_page直接返回映射中的页面，
+   * 不占用缓冲池的frame，也不用加分片锁和计算pin。文件之后不能再修改，allocate_page、dispose_page
+   * 和mark_dirty返回RC::READONLY，直到close_file时解除映射。
+   * 缓冲池中这个文件的脏页先写回并释放，这时除了文件头页不能有被pin住的页面。压缩的文件不能映射
+   */
+  RC map_file(int file_id);
 
   /**
    * 根据文件ID和页号获取指定页面到缓冲区，返回页面句柄指针。
@@ -239,16 +594,115 @@ public:
    */
   RC unpin_page(BPPageHandle *page_handle);
 
+  /**
+   * 对已经pin住的页面加读锁(exclusive=false)或写锁(exclusive=true)，
+   * 用于多个线程同时访问同一个页面的场景。使用完之后调用unlatch_page释放
+   */
+  RC latch_page(BPPageHandle *page_handle, bool exclusive);
+  RC unlatch_page(BPPageHandle *page_handle);
+
   /**
    * 获取文件的总页数
    */
   RC get_page_count(int file_id, int *page_count);
 
+  /**
+   * 页面是否已经分配，释放掉的页面返回false
+   */
+  bool is_page_allocated(int file_id, PageNum page_num);
+
+  /**
+   * 文件的页面修改之后不再写redo日志，刷盘时也不用等日志落盘。只用于重启之后就丢弃的文件，比如undo页面
+   */
+  RC disable_file_redo(int file_id);
+
+  /**
+   * 获取文件的页面压缩方式
+   */
+  RC get_file_compression(int file_id, PageCompression *compression);
+
   RC flush_all_pages(int file_id);
 
+  /**
+   * 启动后台刷盘线程。脏页数量超过dirty_ratio%时集中刷到dirty_ratio/2%以下，
+   * 否则每隔BP_FLUSH_INTERVAL_MS慢慢刷出一小批。相邻的页面合并成一次pwritev
+   */
+  RC start_flusher(int dirty_ratio = BP_DEFAULT_DIRTY_RATIO);
+  void stop_flusher();
+
+  /**
+   * 当前缓冲池中的脏页数量
+   */
+  int dirty_page_count();
+
+  /**
+   * 把修改之后还没有写redo日志的页面都写到日志中(不等待落盘)。all_dirty为true时所有的脏页都写一遍，checkpoint时使用。
+   * 返回需要等待落盘的LSN，包括别的线程之前收集的页面
+   */
+  uint64_t log_pages(bool all_dirty);
+
+  /**
+   * checkpoint: 刷出所有没有被pin住的脏页，剩下的脏页重新写到redo日志中，然后sync所有打开的文件。
+   * 完成之后，调用之前的redo日志就不再需要了
+   */
+  RC checkpoint();
+
+  /**
+   * 备库重放主库的页面日志：file_name已经打开时把页面内容换成data并标记为脏页，不在缓冲池中的页面直接装入新的frame，
+   * 不从磁盘读取。页号可以超过文件头中的页面数，主库扩展文件时新页面可能先于文件头页到达。
+   * 文件没有打开时返回RC::NOTFOUND
+   */
+  RC apply_page(const char *file_name, PageNum page_num, const char *data);
+
+  /**
+   * 输出缓冲池和每个打开文件的统计信息，每行一个文件，最后一行是所有文件的合计
+   */
+  void dump_status(std::ostream &os);
+
+  /**
+   * 缓冲池中所有页面的(文件名, 页号)，按文件名和页号排序。重启之后按照这个列表预热缓冲池
+   */
+  void resident_pages(std::vector<std::pair<std::string, PageNum>> &pages);
+  /**
+   * 把文件中按页号排好序的页面加载到空闲的frame中，不淘汰已经在缓冲池中的页面，分片没有空闲frame时跳过。
+   * 页号连续的一段先交给内核一次预读，文件没有打开时忽略。stop为true时提前结束，返回加载的页面数
+   */
+  int warm_up(const std::string &file_name, const std::vector<PageNum> &pages, const std::atomic<bool> &stop);
+  /**
+   * 按页号顺序找出文件中已经分配、但是不在缓冲池中的数据页，最多max_pages个，同时返回文件名，
+   * 交给PageLoader异步加载。映射的文件返回空
+   */
+  RC missing_pages(int file_id, int max_pages, std::string &file_name, std::vector<PageNum> &pages);
+  /**
+   * 页面是否已经在缓冲池中，访问它不用读磁盘。映射的文件总是返回true
+   */
+  bool is_page_resident(int file_id, PageNum page_num);
+
 protected:
-  RC allocate_block(Frame **buf);
-  RC dispose_block(Frame *buf);
+  BPManager &shard_of(int file_id, PageNum page_num);
+  BPManager &shard_of(Frame *frame)
+  {
+    return shard_of(frame->file_id, frame->page->page_num);
+  }
+
+  /**
+   * 文件表中编号为file_id的文件，没有时返回nullptr。文件表只会扩展，已经打开的文件的位置不会变化，
+   * 读取时不需要持有open_mutex_
+   */
+  BPFileHandle *file_handle_of(int file_id) const
+  {
+    BPFileHandle **chunk = file_chunks_[file_id / BP_FILE_CHUNK_SIZE];
+    return chunk == nullptr ? nullptr : chunk[file_id % BP_FILE_CHUNK_SIZE];
+  }
+  /**
+   * 找一个空闲的编号，文件表满时扩展一块。调用时需要持有open_mutex_
+   */
+  RC alloc_file_id(int *file_id);
+
+  // 以下几个函数调用时需要持有shard的锁
+  RC allocate_block(BPManager &shard, Frame **buf);
+  RC dispose_block(BPManager &shard, Frame *buf);
+  RC force_frame(BPManager &shard, BPFileHandle *file_handle, int frame_id);
 
   /**
    * 刷新指定文件关联的所有脏页到磁盘，除了pinned page
@@ -256,17 +710,149 @@ protected:
    * @param page_num 如果不指定page_num 将刷新所有页
    */
   RC force_page(BPFileHandle *file_handle, PageNum page_num);
-  RC force_all_pages(BPFileHandle *file_handle);
+  /**
+   * 刷新文件所有的脏页，并释放没有被pin住的页。release_pinned为true时pin住的页也一起释放，关闭文件时使用
+   */
+  RC force_all_pages(BPFileHandle *file_handle, bool release_pinned = false);
+  /**
+   * 释放文件所有的页面，包括脏页和pin住的页面，不写盘
+   */
+  void discard_all_pages(BPFileHandle *file_handle);
+  /**
+   * 解除map_file的映射，释放映射页面的frame
+   */
+  void unmap_file(BPFileHandle *file_handle);
+  /**
+   * frame是不是map_file映射的页面，这样的frame不在分片中
+   */
+  static bool is_mapped_frame(const Frame *frame)
+  {
+    const BPFileHandle *file_handle = frame->file_handle;
+    return file_handle != nullptr && file_handle->mapped_frames != nullptr && frame >= file_handle->mapped_frames &&
+           frame < file_handle->mapped_frames + file_handle->mapped_pages;
+  }
+  RC close_file(int file_id, bool discard);
   RC check_file_id(int file_id);
   RC check_page_num(PageNum page_num, BPFileHandle *file_handle);
   RC load_page(PageNum page_num, BPFileHandle *file_handle, Frame *frame);
+  /**
+   * 预热时加载一个页面，加载之后不pin住，可以直接被淘汰。调用时需要持有文件锁。
+   * 页面已经在缓冲池中时返回BUFFERPOOL_EXIST，分片没有空闲frame时返回BUFFERPOOL_NOBUF
+   */
+  RC prefetch_page(BPFileHandle *file_handle, PageNum page_num);
+  /**
+   * 检测顺序读，如果是顺序读就提前预读后面的页面
+   */
+  void read_ahead(BPFileHandle *file_handle, PageNum page_num);
   RC flush_block(Frame *frame);
+  /**
+   * 除了mark_dirty_frame，以下几个函数调用时需要持有frame所在分片的锁。
+   * set_frame_dirty 标记脏页，开启redo日志时同时标记为unlogged
+   * log_frame 页面是unlogged时把它写到redo日志中
+   * bind_file 把frame分配给文件中的一个页面
+   */
+  void set_frame_dirty(BPManager &shard, Frame *frame);
+  void mark_dirty_frame(Frame *frame);
+  void log_frame(Frame *frame);
+  void bind_file(Frame *frame, BPFileHandle *file_handle);
+  /**
+   * 等待一组frame的日志落盘，log before page
+   */
+  RC wait_logged(Frame **frames, int num);
+  /**
+   * 压缩的页面只写出了前面一部分，释放页面中剩下的空间。文件系统不支持打洞时忽略
+   */
+  void punch_page_tail(int fd, Frame *frame, int written);
+
+  static void *flusher_routine(void *arg);
+  void flush_round();
+  /**
+   * 按页号顺序刷出文件中最多max_pages个没有被pin住的脏页，返回刷出的页面数。
+   * 调用时需要持有open_mutex_
+   */
+  int flush_file_pages(BPFileHandle *file_handle, int max_pages);
+  /**
+   * 把一组按页号排好序的frame写到文件中，页号连续的合并成一个请求，所有请求一起交给IO后端
+   */
+  RC flush_frames(Frame **frames, int num);
+  void dump_metric(std::ostream &os, int dirty_pages, const char *name, const BPFileMetric &metric);
 
 private:
-  BPManager bp_manager_;
-  BPFileHandle *open_list_[MAX_OPEN_FILE] = {nullptr};
+  int pool_size_ = 0;
+  int page_size_ = BP_PAGE_SIZE;
+  bool direct_io_ = false;
+  std::vector<BPManager *> shards_;
+  PageIo *page_io_ = nullptr;   // 批量刷盘使用的IO后端，单个页面的读写直接用pread/pwrite
+  pthread_mutex_t open_mutex_;  // 保护文件表
+  std::atomic<bool> has_unlogged_{false};  // 有被标记为unlogged的页面，没有时事务提交不需要遍历分片
+  uint64_t logged_lsn_ = 0;                // 最近一次log_pages写完日志时的LSN，由open_mutex_保护
+  // 打开的文件按编号分块存放，块分配之后不再移动
+  BPFileHandle **file_chunks_[BP_MAX_FILE_CHUNKS] = {nullptr};
+  int file_slots_ = 0;                      // 已经分配的块中的编号数，遍历文件表时的上界
+  std::vector<int> free_file_ids_;          // 被关闭的文件空出来的编号
+  std::unordered_map<std::string, int> file_ids_;  // 文件名到编号
+
+  // 后台刷盘线程
+  pthread_t flusher_;
+  bool flusher_running_ = false;
+  bool flusher_stop_ = false;
+  int dirty_ratio_ = BP_DEFAULT_DIRTY_RATIO;
+  pthread_mutex_t flusher_mutex_;
+  pthread_cond_t flusher_cond_;
 };
 
-DiskBufferPool *theGlobalDiskBufferPool();
+/**
+ * 设置全局缓冲池的frame数量，需要在第一次调用theGlobalDiskBufferPool之前设置
+ */
+RC set_global_buffer_pool_size(int pool_size);
+RC set_global_buffer_pool_replacer(ReplacerType replacer_type);
+/**
+ * 设置全局缓冲池后台刷盘的脏页比例(百分比)，0表示不启动后台刷盘线程
+ */
+RC set_global_buffer_pool_dirty_ratio(int dirty_ratio);
+RC set_global_buffer_pool_page_io(PageIoType page_io_type);
+RC set_global_buffer_pool_direct_io(bool direct_io);
+RC set_global_buffer_pool_numa(bool numa);
+/**
+ * 设置所有缓冲池最多保留打开的fd数，0表示使用进程fd上限的一半
+ */
+RC set_global_buffer_pool_max_open_files(int max_open_files);
+/**
+ * 每种页面大小有一个全局缓冲池，都按照BufferPoolSize的内存大小创建
+ */
+DiskBufferPool *theGlobalDiskBufferPool(int page_size = BP_PAGE_SIZE);
+/**
+ * 开启redo日志时，把所有全局缓冲池中还没有写日志的页面写到日志中，trx_id不为0时再写一条事务的提交记录，
+ * 然后等待日志落盘。语句和事务提交时调用，多个事务同时提交时共用一次fsync。
+ * wait_durable为false时不等待，由redo日志的后台线程在异步提交的延迟之内落盘
+ */
+RC log_global_buffer_pool_pages(int64_t trx_id = 0, bool wait_durable = true);
+RC checkpoint_global_buffer_pools();
+/**
+ * 备库重放一个页面：文件在page_size对应的全局缓冲池中打开时修改缓冲池中的页面，否则直接写回文件
+ */
+RC apply_global_buffer_pool_page(const char *file_name, int page_size, PageNum page_num, const char *data);
+/**
+ * 输出所有已经创建的全局缓冲池的统计信息，show buffer pool status 使用
+ */
+void dump_global_buffer_pool_status(std::ostream &os);
+
+/**
+ * 设置缓冲池预热文件，为空时不预热。之后关闭缓冲池和每次checkpoint时把全局缓冲池中的页面列表写到这个文件中
+ */
+void set_global_buffer_pool_dump_file(const std::string &dump_file);
+/**
+ * 把全局缓冲池中的页面列表写到预热文件中，先写临时文件再改名，写到一半时进程退出也不会破坏之前的文件
+ */
+RC dump_global_buffer_pool_pages();
+/**
+ * 启动后台线程，按照预热文件中的列表把页面重新加载到全局缓冲池。需要在打开表之后调用，
+ * 预热的同时就可以处理请求，请求需要的页面由请求自己加载
+ */
+RC start_global_buffer_pool_warm_up();
+/**
+ * 预热还没有结束时让它提前结束，并等待后台线程退出。关闭文件之前调用
+ */
+void stop_global_buffer_pool_warm_up();
 
 #endif //__OBSERVER_STORAGE_COMMON_PAGE_MANAGER_H_
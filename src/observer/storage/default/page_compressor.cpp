@@ -0,0 +1,182 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Page compression for DiskBufferPool.
+//
+
+#include "storage/default/page_compressor.h"
+
+#include <string.h>
+#include <strings.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "common/log/log.h"
+
+RC page_compression_from_string(const char *name, PageCompression *compression)
+{
+  if (0 == strcasecmp(name, "none")) {
+    *compression = PAGE_COMPRESSION_NONE;
+  } else if (0 == strcasecmp(name, "zlib")) {
+    *compression = PAGE_COMPRESSION_ZLIB;
+  } else if (0 == strcasecmp(name, "lz4")) {
+    *compression = PAGE_COMPRESSION_LZ4;
+  } else if (0 == strcasecmp(name, "zstd")) {
+    *compression = PAGE_COMPRESSION_ZSTD;
+  } else {
+    LOG_ERROR("Unknown page compression: %s", name);
+    return RC::INVALID_ARGUMENT;
+  }
+  return RC::SUCCESS;
+}
+
+const char *page_compression_name(PageCompression compression)
+{
+  switch (compression) {
+    case PAGE_COMPRESSION_NONE: return "none";
+    case PAGE_COMPRESSION_ZLIB: return "zlib";
+    case PAGE_COMPRESSION_LZ4: return "lz4";
+    case PAGE_COMPRESSION_ZSTD: return "zstd";
+  }
+  return "unknown";
+}
+
+bool page_compression_supported(PageCompression compression)
+{
+  switch (compression) {
+    case PAGE_COMPRESSION_NONE: return true;
+#ifdef HAVE_ZLIB
+    case PAGE_COMPRESSION_ZLIB: return true;
+#endif
+#ifdef HAVE_LZ4
+    case PAGE_COMPRESSION_LZ4: return true;
+#endif
+#ifdef HAVE_ZSTD
+    case PAGE_COMPRESSION_ZSTD: return true;
+#endif
+    default: return false;
+  }
+}
+
+/**
+ * 压缩到dst中，dst最多可以写capacity个字节，失败或者放不下时返回0
+ */
+static int compress_data(PageCompression compression, const char *src, int len, char *dst, int capacity)
+{
+  switch (compression) {
+#ifdef HAVE_ZLIB
+    case PAGE_COMPRESSION_ZLIB: {
+      // 刷盘路径上压缩，用最快的级别
+      uLongf dst_len = capacity;
+      if (compress2((Bytef *)dst, &dst_len, (const Bytef *)src, len, Z_BEST_SPEED) != Z_OK) {
+        return 0;
+      }
+      return (int)dst_len;
+    }
+#endif
+#ifdef HAVE_LZ4
+    case PAGE_COMPRESSION_LZ4: {
+      return LZ4_compress_default(src, dst, len, capacity);
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case PAGE_COMPRESSION_ZSTD: {
+      size_t dst_len = ZSTD_compress(dst, capacity, src, len, 1);
+      return ZSTD_isError(dst_len) ? 0 : (int)dst_len;
+    }
+#endif
+    default: return 0;
+  }
+}
+
+/**
+ * 解压到dst中，必须正好得到len个字节
+ */
+static bool decompress_data(PageCompression compression, const char *src, int src_len, char *dst, int len)
+{
+  switch (compression) {
+#ifdef HAVE_ZLIB
+    case PAGE_COMPRESSION_ZLIB: {
+      uLongf dst_len = len;
+      return uncompress((Bytef *)dst, &dst_len, (const Bytef *)src, src_len) == Z_OK && dst_len == (uLongf)len;
+    }
+#endif
+#ifdef HAVE_LZ4
+    case PAGE_COMPRESSION_LZ4: {
+      return LZ4_decompress_safe(src, dst, src_len, len) == len;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case PAGE_COMPRESSION_ZSTD: {
+      size_t dst_len = ZSTD_decompress(dst, len, src, src_len);
+      return !ZSTD_isError(dst_len) && dst_len == (size_t)len;
+    }
+#endif
+    default: return false;
+  }
+}
+
+int compress_page(PageCompression compression, const char *page, int page_size, char *out)
+{
+  // 至少要省下一个块，否则压缩没有意义
+  int capacity = page_size - PAGE_COMPRESSION_BLOCK - (int)sizeof(CompressedPageHeader);
+  if (compression == PAGE_COMPRESSION_NONE || capacity <= 0) {
+    return 0;
+  }
+  int compressed_len = compress_data(compression, page, page_size, out + sizeof(CompressedPageHeader), capacity);
+  if (compressed_len <= 0) {
+    return 0;
+  }
+
+  CompressedPageHeader *header = (CompressedPageHeader *)out;
+  header->magic = PAGE_COMPRESSION_MAGIC;
+  header->compression = (short)compression;
+  header->reserved = 0;
+  header->compressed_len = compressed_len;
+
+  int len = (int)sizeof(CompressedPageHeader) + compressed_len;
+  int aligned_len = (len + PAGE_COMPRESSION_BLOCK - 1) / PAGE_COMPRESSION_BLOCK * PAGE_COMPRESSION_BLOCK;
+  memset(out + len, 0, aligned_len - len);
+  return aligned_len;
+}
+
+bool is_compressed_page(const char *data, int len)
+{
+  return len >= (int)sizeof(CompressedPageHeader) && ((const CompressedPageHeader *)data)->magic == PAGE_COMPRESSION_MAGIC;
+}
+
+RC decompress_page(const char *data, int len, char *page, int page_size)
+{
+  const CompressedPageHeader *header = (const CompressedPageHeader *)data;
+  PageCompression compression = (PageCompression)header->compression;
+  if (header->compressed_len <= 0 || header->compressed_len > len - (int)sizeof(CompressedPageHeader)) {
+    LOG_ERROR("Invalid compressed page. compressed len=%d, len=%d", header->compressed_len, len);
+    return RC::CORRUPT;
+  }
+  if (!page_compression_supported(compression)) {
+    LOG_ERROR("Page compression %s is not supported by this build", page_compression_name(compression));
+    return RC::CORRUPT;
+  }
+  if (!decompress_data(compression, data + sizeof(CompressedPageHeader), header->compressed_len, page, page_size)) {
+    LOG_ERROR("Failed to decompress page by %s. compressed len=%d", page_compression_name(compression),
+              header->compressed_len);
+    return RC::CORRUPT;
+  }
+  return RC::SUCCESS;
+}
@@ -0,0 +1,72 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Page compression for DiskBufferPool.
+//
+
+#ifndef __OBSERVER_STORAGE_DEFAULT_PAGE_COMPRESSOR_H_
+#define __OBSERVER_STORAGE_DEFAULT_PAGE_COMPRESSOR_H_
+
+#include "rc.h"
+
+#define PAGE_COMPRESSION_MAGIC ((int)0xC5A7E9D1)  // 负数，不会和未压缩页面开头的页号冲突
+#define PAGE_COMPRESSION_BLOCK 4096                // 压缩后的页面按这个大小对齐写盘，之后的部分打洞释放
+
+/**
+ * 数据文件的页面压缩方式，记录在文件头中，建表时指定
+ */
+enum PageCompression {
+  PAGE_COMPRESSION_NONE = 0,
+  PAGE_COMPRESSION_ZLIB = 1,
+  PAGE_COMPRESSION_LZ4 = 2,
+  PAGE_COMPRESSION_ZSTD = 3,
+};
+
+/**
+ * 压缩之后写到磁盘上的页面，头部之后是压缩的数据。
+ * 解压之后得到完整的页面，包括开头的页号
+ */
+struct CompressedPageHeader {
+  int magic;
+  short compression;
+  short reserved;
+  int compressed_len;  // 头部之后压缩数据的长度
+};
+
+/**
+ * 根据名字(none/zlib/lz4/zstd)获取压缩方式，名字不区分大小写
+ */
+RC page_compression_from_string(const char *name, PageCompression *compression);
+const char *page_compression_name(PageCompression compression);
+
+/**
+ * 当前编译的版本是否支持这种压缩方式，编译时没有找到对应的库就不支持
+ */
+bool page_compression_supported(PageCompression compression);
+
+/**
+ * 压缩一个page_size大小的页面，结果写到out中，out至少有page_size个字节。
+ * 返回需要写盘的字节数，是PAGE_COMPRESSION_BLOCK的倍数；
+ * 压缩之后节省不了一个块时返回0，调用者应该按原样写出页面
+ */
+int compress_page(PageCompression compression, const char *page, int page_size, char *out);
+
+/**
+ * 从磁盘上读到的len个字节是不是压缩格式的页面
+ */
+bool is_compressed_page(const char *data, int len);
+
+/**
+ * 把压缩格式的页面解压到page中，page有page_size个字节，data和page不能重叠
+ */
+RC decompress_page(const char *data, int len, char *page, int page_size);
+
+#endif  // __OBSERVER_STORAGE_DEFAULT_PAGE_COMPRESSOR_H_
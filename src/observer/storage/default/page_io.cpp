@@ -0,0 +1,251 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Page io backends for DiskBufferPool.
+//
+
+#include "storage/default/page_io.h"
+
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "common/lang/mutex.h"
+#include "common/log/log.h"
+
+RC page_io_type_from_string(const char *name, PageIoType *type)
+{
+  if (0 == strcasecmp(name, "sync")) {
+    *type = SYNC_PAGE_IO;
+  } else if (0 == strcasecmp(name, "io_uring") || 0 == strcasecmp(name, "uring")) {
+    *type = URING_PAGE_IO;
+  } else {
+    LOG_ERROR("Unknown page io type: %s", name);
+    return RC::INVALID_ARGUMENT;
+  }
+  return RC::SUCCESS;
+}
+
+PageIo *create_page_io(PageIoType type)
+{
+  if (type == URING_PAGE_IO) {
+#ifdef HAVE_IO_URING
+    UringPageIo *uring = new UringPageIo();
+    if (uring->init(PAGE_IO_URING_ENTRIES) == RC::SUCCESS) {
+      return uring;
+    }
+    delete uring;
+    LOG_WARN("Failed to init io_uring, fall back to sync page io");
+#else
+    LOG_WARN("io_uring is not supported by this build, fall back to sync page io");
+#endif
+  }
+  return new SyncPageIo();
+}
+
+RC SyncPageIo::submit_and_wait(PageIoRequest *requests, int num)
+{
+  RC rc = RC::SUCCESS;
+  for (int i = 0; i < num; i++) {
+    PageIoRequest &request = requests[i];
+    if (request.write) {
+      request.result = pwritev(request.fd, request.iov, request.iovcnt, request.offset);
+    } else {
+      request.result = preadv(request.fd, request.iov, request.iovcnt, request.offset);
+    }
+    if (request.result < 0) {
+      request.result = -errno;
+      rc = request.write ? RC::IOERR_WRITE : RC::IOERR_READ;
+    }
+  }
+  return rc;
+}
+
+#ifdef HAVE_IO_URING
+
+static int io_uring_setup(unsigned int entries, struct io_uring_params *params)
+{
+  return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int ring_fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+  return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+UringPageIo::UringPageIo()
+{
+  MUTEX_INIT(&mutex_, nullptr);
+}
+
+UringPageIo::~UringPageIo()
+{
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != nullptr) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+  MUTEX_DESTROY(&mutex_);
+}
+
+RC UringPageIo::init(unsigned int entries)
+{
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = io_uring_setup(entries, &params);
+  if (ring_fd_ < 0) {
+    LOG_WARN("Failed to setup io_uring. error=%s", strerror(errno));
+    return RC::IOERR;
+  }
+  entries_ = params.sq_entries;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap && cq_ring_size_ > sq_ring_size_) {
+    sq_ring_size_ = cq_ring_size_;
+  }
+
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                  IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    LOG_WARN("Failed to mmap io_uring sq ring. error=%s", strerror(errno));
+    return RC::IOERR;
+  }
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      cq_ring_ = nullptr;
+      LOG_WARN("Failed to mmap io_uring cq ring. error=%s", strerror(errno));
+      return RC::IOERR;
+    }
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    LOG_WARN("Failed to mmap io_uring sqes. error=%s", strerror(errno));
+    return RC::IOERR;
+  }
+  sqes_ = (struct io_uring_sqe *)sqes;
+
+  char *sq = (char *)sq_ring_;
+  sq_head_ = (unsigned int *)(sq + params.sq_off.head);
+  sq_tail_ = (unsigned int *)(sq + params.sq_off.tail);
+  sq_mask_ = (unsigned int *)(sq + params.sq_off.ring_mask);
+  sq_array_ = (unsigned int *)(sq + params.sq_off.array);
+  char *cq = (char *)cq_ring_;
+  cq_head_ = (unsigned int *)(cq + params.cq_off.head);
+  cq_tail_ = (unsigned int *)(cq + params.cq_off.tail);
+  cq_mask_ = (unsigned int *)(cq + params.cq_off.ring_mask);
+  cqes_ = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+  LOG_INFO("Init io_uring with %u entries", entries_);
+  return RC::SUCCESS;
+}
+
+RC UringPageIo::submit_and_wait(PageIoRequest *requests, int num)
+{
+  RC rc = RC::SUCCESS;
+  MUTEX_LOCK(&mutex_);
+  // 请求数超过ring的大小时分批提交
+  for (int begin = 0; begin < num; begin += entries_) {
+    int batch = num - begin < (int)entries_ ? num - begin : (int)entries_;
+    RC batch_rc = submit_batch(requests + begin, batch);
+    if (batch_rc != RC::SUCCESS) {
+      rc = batch_rc;
+    }
+  }
+  MUTEX_UNLOCK(&mutex_);
+  return rc;
+}
+
+RC UringPageIo::submit_batch(PageIoRequest *requests, int num)
+{
+  // 只有持有mutex_的线程会修改sq，不需要和其它提交者竞争
+  unsigned int tail = *sq_tail_;
+  for (int i = 0; i < num; i++) {
+    unsigned int index = tail & *sq_mask_;
+    struct io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = requests[i].write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = requests[i].fd;
+    sqe->off = requests[i].offset;
+    sqe->addr = (unsigned long)requests[i].iov;
+    sqe->len = requests[i].iovcnt;
+    sqe->user_data = i;
+    sq_array_[index] = index;
+    tail++;
+  }
+  __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+  RC rc = RC::SUCCESS;
+  int submitted = 0;  // 已经被内核取走的请求数，内核按顺序取
+  int expected = num;
+  int completed = 0;
+  while (completed < expected) {
+    int ret = io_uring_enter(ring_fd_, expected - submitted, 1, IORING_ENTER_GETEVENTS);
+    if (ret < 0) {
+      int error = errno;
+      if (error == EINTR || error == EAGAIN || error == EBUSY || submitted == expected) {
+        // 已经提交的请求还在执行，必须等它们完成，否则调用者可能释放请求的内存
+        continue;
+      }
+      LOG_ERROR("Failed to submit %d requests to io_uring. error=%s", num - submitted, strerror(error));
+      // 没有被内核取走的请求撤回，只等待已经提交的请求
+      __atomic_store_n(sq_tail_, tail - (num - submitted), __ATOMIC_RELEASE);
+      for (int i = submitted; i < num; i++) {
+        requests[i].result = -error;
+      }
+      expected = submitted;
+      rc = RC::IOERR;
+      continue;
+    }
+    submitted += ret;
+
+    unsigned int head = *cq_head_;
+    while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      struct io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+      PageIoRequest &request = requests[cqe->user_data];
+      request.result = cqe->res;
+      if (cqe->res < 0) {
+        LOG_ERROR("Failed to %s %d at %lld. error=%s",
+                  request.write ? "write" : "read", request.fd, request.offset, strerror(-cqe->res));
+        rc = request.write ? RC::IOERR_WRITE : RC::IOERR_READ;
+      }
+      head++;
+      completed++;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  }
+  return rc;
+}
+
+#endif  // HAVE_IO_URING
@@ -0,0 +1,118 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Page io backends for DiskBufferPool.
+//
+
+#ifndef __OBSERVER_STORAGE_DEFAULT_PAGE_IO_H_
+#define __OBSERVER_STORAGE_DEFAULT_PAGE_IO_H_
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "rc.h"
+
+#define PAGE_IO_URING_ENTRIES 64  // io_uring的队列深度，一次最多同时执行的请求数
+
+/**
+ * 一个页面读写请求，iov指向的内存由调用者负责，完成后result记录实际读写的字节数，出错时为-errno
+ */
+struct PageIoRequest {
+  int fd;
+  long long offset;
+  struct iovec *iov;
+  int iovcnt;
+  bool write;
+  ssize_t result;
+};
+
+/**
+ * 执行页面读写的后端。submit_and_wait一次提交一批请求，等待全部完成后返回，
+ * 支持异步IO的后端可以让这一批请求同时在磁盘上执行
+ */
+class PageIo {
+public:
+  virtual ~PageIo() = default;
+
+  virtual const char *name() const = 0;
+  virtual RC submit_and_wait(PageIoRequest *requests, int num) = 0;
+};
+
+enum PageIoType {
+  SYNC_PAGE_IO,   // preadv/pwritev，逐个请求执行
+  URING_PAGE_IO,  // io_uring，一批请求同时提交
+};
+
+/**
+ * 根据名字(sync/io_uring)获取IO后端类型，名字不区分大小写
+ */
+RC page_io_type_from_string(const char *name, PageIoType *type);
+
+/**
+ * 创建IO后端。当前环境不支持io_uring时退回到sync后端，不会返回nullptr
+ */
+PageIo *create_page_io(PageIoType type);
+
+class SyncPageIo : public PageIo {
+public:
+  const char *name() const override
+  {
+    return "sync";
+  }
+  RC submit_and_wait(PageIoRequest *requests, int num) override;
+};
+
+#ifdef HAVE_IO_URING
+/**
+ * 直接使用io_uring系统调用实现，不依赖liburing。
+ * 一个实例只有一个ring，多个线程提交时用mutex串行
+ */
+class UringPageIo : public PageIo {
+public:
+  UringPageIo();
+  ~UringPageIo() override;
+
+  RC init(unsigned int entries);
+
+  const char *name() const override
+  {
+    return "io_uring";
+  }
+  RC submit_and_wait(PageIoRequest *requests, int num) override;
+
+private:
+  RC submit_batch(PageIoRequest *requests, int num);
+
+private:
+  pthread_mutex_t mutex_;
+  int ring_fd_ = -1;
+  unsigned int entries_ = 0;
+
+  void *sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void *cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  struct io_uring_sqe *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned int *sq_head_ = nullptr;
+  unsigned int *sq_tail_ = nullptr;
+  unsigned int *sq_mask_ = nullptr;
+  unsigned int *sq_array_ = nullptr;
+  unsigned int *cq_head_ = nullptr;
+  unsigned int *cq_tail_ = nullptr;
+  unsigned int *cq_mask_ = nullptr;
+  struct io_uring_cqe *cqes_ = nullptr;
+};
+#endif  // HAVE_IO_URING
+
+#endif  // __OBSERVER_STORAGE_DEFAULT_PAGE_IO_H_
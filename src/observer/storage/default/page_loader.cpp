@@ -0,0 +1,91 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Asynchronous loading of the pages a query is going to scan.
+//
+
+#include "storage/default/page_loader.h"
+
+#include "common/log/log.h"
+
+PageLoader::~PageLoader()
+{
+  stop();
+}
+
+PageLoader &PageLoader::instance()
+{
+  static PageLoader instance;
+  return instance;
+}
+
+void PageLoader::start(int threads)
+{
+  stop();
+  stop_ = false;
+  for (int i = 0; i < threads; i++) {
+    threads_.emplace_back(&PageLoader::routine, this);
+  }
+  if (threads > 0) {
+    LOG_INFO("Start %d page loader thread(s)", threads);
+  }
+}
+
+void PageLoader::stop()
+{
+  if (threads_.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+    cond_.notify_all();
+  }
+  // 线程退出之前处理完队列，stop_为true时warm_up立即返回
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+}
+
+void PageLoader::submit(std::vector<PageLoadFile> &&files, std::function<void()> &&done)
+{
+  Job *job = new Job{std::move(files), std::move(done)};
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_.push_back(job);
+  cond_.notify_one();
+}
+
+void PageLoader::routine()
+{
+  while (true) {
+    Job *job = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      job = queue_.front();
+      queue_.pop_front();
+    }
+
+    long loaded = 0;
+    for (const PageLoadFile &file : job->files) {
+      loaded += file.buffer_pool->warm_up(file.file_name, file.pages, stop_);
+    }
+    jobs_++;
+    loaded_pages_ += loaded;
+    LOG_DEBUG("Loaded %ld page(s) of %d file(s) asynchronously", loaded, (int)job->files.size());
+    job->done();
+    delete job;
+  }
+}
@@ -0,0 +1,98 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Asynchronous loading of the pages a query is going to scan.
+//
+
+#ifndef __OBSERVER_STORAGE_DEFAULT_PAGE_LOADER_H_
+#define __OBSERVER_STORAGE_DEFAULT_PAGE_LOADER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "storage/default/disk_buffer_pool.h"
+
+#define PAGE_LOAD_MIN_PAGES 64     // 缺页少于这个数的查询直接执行，不值得让出线程
+#define PAGE_LOAD_MAX_PAGES 4096   // 一个查询每次最多异步加载的页面数
+
+/**
+ * 一个文件中要加载的页面，按页号排序
+ */
+struct PageLoadFile {
+  DiskBufferPool *buffer_pool = nullptr;
+  std::string file_name;
+  std::vector<PageNum> pages;
+};
+
+/**
+ * 查询执行之前把要扫描的表中不在缓冲池里的页面交给加载线程，SQL线程不用阻塞在磁盘IO上，
+ * 可以去执行其它请求；加载完成之后调用done，由调用者把查询重新加回stage执行。
+ * 页面用DiskBufferPool::warm_up加载，只使用空闲的frame，缓冲池满时只把数据读到page cache中。
+ * 加载线程数为0时不启用
+ */
+class PageLoader {
+public:
+  PageLoader() = default;
+  ~PageLoader();
+
+  static PageLoader &instance();
+
+  void start(int threads);
+  /**
+   * 等待加载线程退出，还没有加载的任务不再加载，直接调用done
+   */
+  void stop();
+
+  bool enabled() const
+  {
+    return !threads_.empty();
+  }
+
+  /**
+   * done在加载线程上调用，调用之后任务被删除
+   */
+  void submit(std::vector<PageLoadFile> &&files, std::function<void()> &&done);
+
+  long jobs() const
+  {
+    return jobs_.load();
+  }
+  long loaded_pages() const
+  {
+    return loaded_pages_.load();
+  }
+
+private:
+  struct Job {
+    std::vector<PageLoadFile> files;
+    std::function<void()> done;
+  };
+
+  void routine();
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<Job *> queue_;
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stop_{false};
+
+  std::atomic<long> jobs_{0};
+  std::atomic<long> loaded_pages_{0};
+};
+
+#endif  // __OBSERVER_STORAGE_DEFAULT_PAGE_LOADER_H_
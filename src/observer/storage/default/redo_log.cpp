@@ -0,0 +1,674 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Redo log of page images with group commit.
+//
+
+#include "storage/default/redo_log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "common/io/io.h"
+#include "common/log/log.h"
+#include "common/os/path.h"
+#include "common/seda/request_trace.h"
+#include "storage/default/disk_buffer_pool.h"
+
+/**
+ * FNV-1a，用来发现没有写完整的记录
+ */
+static uint32_t redo_checksum(const char *data, size_t len, uint32_t hash = 2166136261U)
+{
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (unsigned char)data[i];
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+static uint32_t record_checksum(const RedoRecordHeader &header, const char *body)
+{
+  const size_t skip = offsetof(RedoRecordHeader, lsn);
+  uint32_t hash = redo_checksum((const char *)&header + skip, sizeof(header) - skip);
+  return redo_checksum(body, header.name_len + header.data_len, hash);
+}
+
+/**
+ * 按序号从小到大列出dir中的日志文件
+ */
+static void list_log_files(const std::string &dir, std::vector<std::pair<long, std::string>> &files)
+{
+  std::vector<std::string> paths;
+  common::getFileList(paths, dir, std::string("^") + REDO_LOG_FILE_PREFIX + "[0-9]+$", false);
+  for (const std::string &path : paths) {
+    const char *name = path.c_str() + path.rfind('/') + 1;
+    files.emplace_back(strtol(name + strlen(REDO_LOG_FILE_PREFIX), nullptr, 10), path);
+  }
+  std::sort(files.begin(), files.end());
+}
+
+static std::string log_file_path(const std::string &dir, long seq)
+{
+  return dir + "/" + REDO_LOG_FILE_PREFIX + std::to_string(seq);
+}
+
+static RC write_fully(int fd, const char *data, size_t len)
+{
+  while (len > 0) {
+    ssize_t ret = write(fd, data, len);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return RC::IOERR_WRITE;
+    }
+    data += ret;
+    len -= ret;
+  }
+  return RC::SUCCESS;
+}
+
+RedoLog &RedoLog::instance()
+{
+  static RedoLog instance;
+  return instance;
+}
+
+RC RedoLog::recover(const char *dir, std::set<int64_t> *committed_trx, RedoUndoImages *undo_images)
+{
+  std::vector<std::pair<long, std::string>> files;
+  list_log_files(dir, files);
+
+  // 每个页面只保留最后的内容
+  struct FilePages {
+    int page_size = 0;
+    std::map<PageNum, std::string> pages;
+  };
+  std::map<std::string, FilePages> images;
+  std::set<int64_t> committed;
+  RedoUndoImages undo;
+  int records = 0;
+  bool broken = false;
+  for (size_t i = 0; i < files.size() && !broken; i++) {
+    std::ifstream in(files[i].second, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string data = ss.str();
+
+    size_t offset = 0;
+    RedoRecordHeader header;
+    while (decode_record(data.data() + offset, data.size() - offset, header)) {
+      const char *body = data.data() + offset + sizeof(header);
+      offset += sizeof(header) + header.name_len + header.data_len;
+      records++;
+
+      std::string file_name(body, header.name_len);
+      if (header.type == REDO_TRX_COMMIT && header.data_len >= sizeof(int64_t)) {
+        int64_t trx_id = 0;
+        memcpy(&trx_id, body + header.name_len, sizeof(trx_id));
+        committed.insert(trx_id);
+      } else if (header.type == REDO_UNDO_IMAGE && header.data_len >= sizeof(int64_t) + 2 * sizeof(int32_t)) {
+        // 同一个事务对一条记录只记一次修改之前的内容，重新写到新日志中的记录和原来的相同
+        const char *undo_data = body + header.name_len;
+        int64_t trx_id = 0;
+        int32_t position[2];
+        memcpy(&trx_id, undo_data, sizeof(trx_id));
+        memcpy(position, undo_data + sizeof(trx_id), sizeof(position));
+        const size_t head_len = sizeof(trx_id) + sizeof(position);
+        undo.emplace(std::make_tuple(file_name, trx_id, position[0], position[1]),
+                     std::string(undo_data + head_len, header.data_len - head_len));
+      } else if (header.type == REDO_FILE_CREATE) {
+        images.erase(file_name);
+      } else if (header.type == REDO_PAGE_IMAGE && (int)header.data_len == header.page_size) {
+        FilePages &file_pages = images[file_name];
+        if (file_pages.page_size != header.page_size) {
+          file_pages.pages.clear();
+          file_pages.page_size = header.page_size;
+        }
+        file_pages.pages[header.page_num].assign(body + header.name_len, header.data_len);
+      }
+    }
+    if (offset != data.size()) {
+      // 后面的日志都不可信了
+      LOG_WARN("Redo log %s is truncated at %lu of %lu bytes", files[i].second.c_str(), offset, data.size());
+      broken = true;
+    }
+  }
+
+  if (committed_trx != nullptr) {
+    committed_trx->insert(committed.begin(), committed.end());
+  }
+  if (undo_images != nullptr) {
+    // 已经提交的事务不需要回滚
+    for (auto &image : undo) {
+      if (committed.count(std::get<1>(image.first)) == 0) {
+        undo_images->insert(std::move(image));
+      }
+    }
+  }
+
+  for (const auto &file : images) {
+    RC rc = DiskBufferPool::restore_pages(file.first.c_str(), file.second.page_size, file.second.pages);
+    if (rc != RC::SUCCESS) {
+      LOG_ERROR("Failed to restore pages of %s from redo log. rc=%d:%s", file.first.c_str(), rc, strrc(rc));
+      return rc;
+    }
+  }
+  LOG_INFO("Recover %d redo records of %d files from %s", records, (int)images.size(), dir);
+  return RC::SUCCESS;
+}
+
+bool RedoLog::decode_record(const char *data, size_t size, RedoRecordHeader &header)
+{
+  if (size < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  return header.magic == REDO_LOG_MAGIC && sizeof(header) + header.name_len + header.data_len <= size &&
+         record_checksum(header, data + sizeof(header)) == header.checksum;
+}
+
+void RedoLog::set_shipper(RedoLogShipper shipper)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (shipper) {
+    shippers_[0] = std::move(shipper);
+  } else {
+    shippers_.erase(0);
+  }
+}
+
+int RedoLog::add_shipper(RedoLogShipper shipper)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int id = next_shipper_id_++;
+  shippers_[id] = std::move(shipper);
+  return id;
+}
+
+void RedoLog::remove_shipper(int id)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  shippers_.erase(id);
+}
+
+RC RedoLog::open(const char *dir, long long checkpoint_size)
+{
+  dir_ = dir;
+  if (!common::check_directory(dir_)) {
+    LOG_ERROR("Cannot access redo log dir: %s. error=%s", dir, strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  committing_trx_.clear();
+  recovered_trx_.clear();
+  undo_records_.clear();
+  recovered_undo_.clear();
+  std::vector<std::pair<long, std::string>> files;
+  list_log_files(dir_, files);
+  long long log_bytes = 0;
+  for (const auto &file : files) {
+    struct stat st;
+    if (stat(file.second.c_str(), &st) == 0) {
+      log_bytes += st.st_size;
+    }
+  }
+  struct timespec begin;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  RC rc = recover(dir, &recovered_trx_, &recovered_undo_);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  long long elapsed_us = (end.tv_sec - begin.tv_sec) * 1000000LL + (end.tv_nsec - begin.tv_nsec) / 1000;
+  if (log_bytes >= (1LL << 20) && elapsed_us > 0) {
+    // 日志太少时测量不准，继续使用默认的速度
+    replay_rate_ = std::max(log_bytes * 1000000LL / elapsed_us, 1LL);
+    LOG_INFO("Replay %lld bytes of redo log in %lld us", log_bytes, elapsed_us);
+  }
+
+  // 恢复的页面都已经sync到数据文件中，已经提交的事务和没有提交的事务修改之前的内容写到新的日志中之后旧的日志就可以删掉了
+  long seq = files.empty() ? 1 : files.back().first + 1;
+  if ((rc = open_file(seq)) != RC::SUCCESS) {
+    return rc;
+  }
+  // 正常关闭时最后的日志文件是空的，不需要处理记录上的事务字段
+  recovering_ = log_bytes > 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    append_live_records_locked();
+  }
+  if ((rc = flush(current_lsn())) != RC::SUCCESS) {
+    return rc;
+  }
+  remove_files(seq - 1);
+
+  checkpoint_size_ = checkpoint_size;
+  checkpoint_stop_ = false;
+  checkpoint_requested_ = false;
+  checkpoint_thread_ = std::thread(&RedoLog::checkpoint_routine, this);
+  async_flush_stop_ = false;
+  async_lsn_ = 0;
+  async_flush_thread_ = std::thread(&RedoLog::async_flush_routine, this);
+  enabled_ = true;
+  LOG_INFO("Open redo log %s, checkpoint size %lld", log_file_path(dir_, seq).c_str(), checkpoint_size);
+  return RC::SUCCESS;
+}
+
+void RedoLog::close()
+{
+  if (!enabled_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkpoint_stop_ = true;
+    checkpoint_cond_.notify_all();
+    async_flush_stop_ = true;
+    async_flush_cond_.notify_all();
+  }
+  checkpoint_thread_.join();
+  async_flush_thread_.join();
+  // checkpoint会让所有的日志落盘，包括还没有写出去的异步提交
+  checkpoint();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  enabled_ = false;
+  ::close(fd_);
+  fd_ = -1;
+  LOG_INFO("Close redo log at lsn %llu", (unsigned long long)lsn_);
+}
+
+RC RedoLog::open_file(long seq)
+{
+  std::string path = log_file_path(dir_, seq);
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    LOG_ERROR("Failed to create redo log %s. error=%s", path.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+  fd_ = fd;
+  seq_ = seq;
+  file_size_ = 0;
+  return RC::SUCCESS;
+}
+
+void RedoLog::remove_files(long max_seq)
+{
+  std::vector<std::pair<long, std::string>> files;
+  list_log_files(dir_, files);
+  for (const auto &file : files) {
+    if (file.first <= max_seq && unlink(file.second.c_str()) != 0) {
+      LOG_WARN("Failed to remove redo log %s. error=%s", file.second.c_str(), strerror(errno));
+    }
+  }
+}
+
+uint64_t RedoLog::append(RedoRecordType type, const char *file_name, int32_t page_num, const char *data,
+                         int data_len, int page_size)
+{
+  RedoRecordHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = REDO_LOG_MAGIC;
+  header.type = type;
+  header.name_len = (uint16_t)strlen(file_name);
+  header.page_num = page_num;
+  header.page_size = page_size;
+  header.data_len = data_len;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ < 0) {
+    // 日志已经关闭，不需要等待
+    return 0;
+  }
+  if (type == REDO_TRX_COMMIT || type == REDO_UNDO_IMAGE) {
+    int64_t trx_id = 0;
+    memcpy(&trx_id, data, sizeof(trx_id));
+    if (type == REDO_TRX_COMMIT) {
+      committing_trx_.insert(trx_id);
+    } else {
+      undo_records_[trx_id].emplace_back(std::string(file_name, header.name_len),
+                                         std::string(data + sizeof(trx_id), data_len - sizeof(trx_id)));
+    }
+  }
+  append_locked(header, file_name, data);
+  if (file_size_ >= checkpoint_size_ && !checkpoint_requested_) {
+    checkpoint_requested_ = true;
+    checkpoint_cond_.notify_all();
+  }
+  return lsn_;
+}
+
+void RedoLog::append_locked(RedoRecordHeader &header, const char *file_name, const char *data)
+{
+  size_t record_len = sizeof(header) + header.name_len + header.data_len;
+  lsn_ += record_len;
+  header.lsn = lsn_;
+  const size_t skip = offsetof(RedoRecordHeader, lsn);
+  uint32_t hash = redo_checksum((const char *)&header + skip, sizeof(header) - skip);
+  hash = redo_checksum(file_name, header.name_len, hash);
+  header.checksum = redo_checksum(data, header.data_len, hash);
+
+  buffer_.append((const char *)&header, sizeof(header));
+  buffer_.append(file_name, header.name_len);
+  buffer_.append(data, header.data_len);
+  file_size_ += record_len;
+}
+
+void RedoLog::append_live_records_locked()
+{
+  // 还没有完成提交的事务，记录上的事务字段可能还没有清除，提交记录需要一直留在日志中
+  std::set<int64_t> trx_ids(committing_trx_);
+  trx_ids.insert(recovered_trx_.begin(), recovered_trx_.end());
+  for (int64_t trx_id : trx_ids) {
+    RedoRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = REDO_LOG_MAGIC;
+    header.type = REDO_TRX_COMMIT;
+    header.data_len = sizeof(trx_id);
+    append_locked(header, "", (const char *)&trx_id);
+  }
+
+  // 没有结束的事务修改过的页面可能已经写回数据文件，回滚需要修改之前的内容
+  auto append_undo_record = [this](const std::string &table_name, int64_t trx_id, const std::string &data) {
+    std::string undo_data((const char *)&trx_id, sizeof(trx_id));
+    undo_data.append(data);
+    RedoRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = REDO_LOG_MAGIC;
+    header.type = REDO_UNDO_IMAGE;
+    header.name_len = (uint16_t)table_name.size();
+    header.data_len = (uint32_t)undo_data.size();
+    append_locked(header, table_name.data(), undo_data.data());
+  };
+  for (const auto &trx_records : undo_records_) {
+    for (const auto &record : trx_records.second) {
+      append_undo_record(record.first, trx_records.first, record.second);
+    }
+  }
+  for (const auto &image : recovered_undo_) {
+    int32_t position[2] = {std::get<2>(image.first), std::get<3>(image.first)};
+    std::string data((const char *)position, sizeof(position));
+    data.append(image.second);
+    append_undo_record(std::get<0>(image.first), std::get<1>(image.first), data);
+  }
+}
+
+uint64_t RedoLog::append_page(const char *file_name, int32_t page_num, const char *page, int page_size)
+{
+  return append(REDO_PAGE_IMAGE, file_name, page_num, page, page_size, page_size);
+}
+
+uint64_t RedoLog::append_file_create(const char *file_name)
+{
+  return append(REDO_FILE_CREATE, file_name, 0, nullptr, 0, 0);
+}
+
+uint64_t RedoLog::append_commit(int64_t trx_id)
+{
+  return append(REDO_TRX_COMMIT, "", 0, (const char *)&trx_id, sizeof(trx_id), 0);
+}
+
+void RedoLog::end_commit(int64_t trx_id)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  committing_trx_.erase(trx_id);
+}
+
+uint64_t RedoLog::append_undo(int64_t trx_id, const char *table_name, int32_t page_num, int32_t slot_num,
+                              const char *data, int data_len)
+{
+  int32_t position[2] = {page_num, slot_num};
+  std::string undo_data((const char *)&trx_id, sizeof(trx_id));
+  undo_data.append((const char *)position, sizeof(position));
+  undo_data.append(data, data_len);
+  return append(REDO_UNDO_IMAGE, table_name, 0, undo_data.data(), (int)undo_data.size(), 0);
+}
+
+void RedoLog::end_undo(int64_t trx_id)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  undo_records_.erase(trx_id);
+}
+
+const std::string *RedoLog::recovered_undo(const char *table_name, int64_t trx_id, int32_t page_num,
+                                           int32_t slot_num) const
+{
+  auto iter = recovered_undo_.find(std::make_tuple(std::string(table_name), trx_id, page_num, slot_num));
+  return iter == recovered_undo_.end() ? nullptr : &iter->second;
+}
+
+RC RedoLog::finish_recovery()
+{
+  if (!recovering_) {
+    return RC::SUCCESS;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recovering_ = false;
+    recovered_trx_.clear();
+    recovered_undo_.clear();
+  }
+  // 处理事务字段时修改的页面写回数据文件之后，恢复的提交记录就不再需要了
+  RC rc = checkpoint();
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to checkpoint after recovery. rc=%d:%s", rc, strrc(rc));
+    return rc;
+  }
+  LOG_INFO("Finish redo log recovery");
+  return RC::SUCCESS;
+}
+
+RC RedoLog::flush(uint64_t lsn)
+{
+  common::TraceSpanScope span("storage", "redo_flush");
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (durable_lsn_ < lsn) {
+    if (flushing_) {
+      // 正在写的这一批可能已经包含了需要的日志
+      flushed_.wait(lock);
+      continue;
+    }
+
+    // 成为这一批的leader，把缓冲中所有的日志一起写出去
+    flushing_ = true;
+    std::string data;
+    data.swap(buffer_);
+    uint64_t end_lsn = lsn_;
+    int fd = fd_;
+    std::vector<RedoLogShipper> shippers;
+    for (const auto &shipper : shippers_) {
+      shippers.push_back(shipper.second);
+    }
+    lock.unlock();
+
+    RC rc = write_fully(fd, data.data(), data.size());
+    if (rc == RC::SUCCESS && fdatasync(fd) != 0) {
+      rc = RC::IOERR_FSYNC;
+    }
+    sync_count_++;
+    // 下一个leader要等flushing_清除，落盘的日志按顺序交给shipper
+    if (rc == RC::SUCCESS && !data.empty()) {
+      for (const RedoLogShipper &shipper : shippers) {
+        shipper(data.data(), data.size(), end_lsn);
+      }
+    }
+
+    lock.lock();
+    flushing_ = false;
+    if (rc == RC::SUCCESS) {
+      durable_lsn_ = end_lsn;
+    }
+    flushed_.notify_all();
+    if (rc != RC::SUCCESS) {
+      LOG_ERROR("Failed to write redo log to %llu. error=%s", (unsigned long long)end_lsn, strerror(errno));
+      return rc;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+void RedoLog::flush_async(uint64_t lsn)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (lsn <= durable_lsn_ || lsn <= async_lsn_) {
+    return;
+  }
+  // 后台线程空闲时唤醒它开始计时
+  const bool idle = async_lsn_ <= durable_lsn_;
+  async_lsn_ = lsn;
+  if (idle) {
+    async_flush_cond_.notify_one();
+  }
+}
+
+uint64_t RedoLog::current_lsn()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return lsn_;
+}
+
+uint64_t RedoLog::durable_lsn()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return durable_lsn_;
+}
+
+RC RedoLog::switch_file(long *old_seq)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (flushing_) {
+    flushed_.wait(lock);
+  }
+  // 切换期间持有锁，新的记录只会写到新文件中
+  RC rc = write_fully(fd_, buffer_.data(), buffer_.size());
+  if (rc == RC::SUCCESS && fdatasync(fd_) != 0) {
+    rc = RC::IOERR_FSYNC;
+  }
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to write redo log %s. error=%s", log_file_path(dir_, seq_).c_str(), strerror(errno));
+    return rc;
+  }
+  if (!buffer_.empty()) {
+    for (const auto &shipper : shippers_) {
+      shipper.second(buffer_.data(), buffer_.size(), lsn_);
+    }
+  }
+  buffer_.clear();
+  durable_lsn_ = lsn_;
+  flushed_.notify_all();
+
+  *old_seq = seq_;
+  rc = open_file(seq_ + 1);
+  if (rc == RC::SUCCESS) {
+    append_live_records_locked();
+  }
+  return rc;
+}
+
+RC RedoLog::checkpoint()
+{
+  std::lock_guard<std::mutex> guard(checkpoint_mutex_);
+  long old_seq = 0;
+  RC rc = switch_file(&old_seq);
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+
+  // 旧日志中的页面要么已经在数据文件中，要么还是脏页，会重新写到新的日志中
+  rc = checkpoint_global_buffer_pools();
+  if (rc == RC::SUCCESS) {
+    // 重新写到新日志中的提交记录落盘之后才能删除旧的日志
+    append(REDO_CHECKPOINT, "", 0, nullptr, 0, 0);
+    rc = flush(current_lsn());
+  }
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to checkpoint buffer pools, keep redo logs before %ld. rc=%d:%s", old_seq, rc, strrc(rc));
+    return rc;
+  }
+  remove_files(old_seq);
+  LOG_INFO("Checkpoint redo log, remove logs before %ld", old_seq + 1);
+  return RC::SUCCESS;
+}
+
+void RedoLog::request_checkpoint()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!checkpoint_requested_) {
+    checkpoint_requested_ = true;
+    checkpoint_cond_.notify_all();
+  }
+}
+
+long long RedoLog::estimated_recovery_ms()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_size_ * 1000 / replay_rate_;
+}
+
+long long RedoLog::log_size()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_size_;
+}
+
+void RedoLog::async_flush_routine()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!async_flush_stop_) {
+    if (async_lsn_ <= durable_lsn_) {
+      async_flush_cond_.wait(lock);
+      continue;
+    }
+    // 从第一个等待落盘的异步提交开始计时，这期间追加的提交一起落盘
+    async_flush_cond_.wait_for(lock, std::chrono::milliseconds(async_commit_lag_ms_.load()),
+                               [this]() { return async_flush_stop_; });
+    const uint64_t lsn = async_lsn_;
+    lock.unlock();
+    RC rc = flush(lsn);
+    if (rc != RC::SUCCESS) {
+      LOG_ERROR("Failed to flush redo log of asynchronous commits to %llu. rc=%d:%s",
+                (unsigned long long)lsn, rc, strrc(rc));
+    }
+    lock.lock();
+  }
+}
+
+void RedoLog::checkpoint_routine()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!checkpoint_stop_) {
+    if (!checkpoint_requested_) {
+      checkpoint_cond_.wait(lock);
+      continue;
+    }
+    lock.unlock();
+    checkpoint();
+    lock.lock();
+    checkpoint_requested_ = false;
+  }
+}
@@ -0,0 +1,277 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Redo log of page images with group commit.
+//
+
+#ifndef __OBSERVER_STORAGE_DEFAULT_REDO_LOG_H_
+#define __OBSERVER_STORAGE_DEFAULT_REDO_LOG_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "rc.h"
+
+#define REDO_LOG_MAGIC 0x4f444552                          // "REDO"
+#define REDO_LOG_FILE_PREFIX "redo."                      // 日志文件名是 redo.<序号>
+#define REDO_LOG_DEFAULT_CHECKPOINT_SIZE (64LL << 20)     // 日志超过这个大小时做一次checkpoint
+#define REDO_LOG_DEFAULT_REPLAY_RATE (32LL << 20)         // 没有测量过时假定恢复每秒处理的日志字节数
+#define REDO_LOG_DEFAULT_ASYNC_COMMIT_LAG 10               // 毫秒，异步提交的日志最多延迟这么久落盘
+
+enum RedoRecordType {
+  REDO_PAGE_IMAGE = 1,   // 页面的完整内容
+  REDO_FILE_CREATE = 2,  // 文件被重新创建，之前记录的这个文件的页面都作废
+  REDO_TRX_COMMIT = 3,   // 事务提交，数据是64位的事务号
+  REDO_UNDO_IMAGE = 4,   // 事务第一次修改记录之前的内容，文件名是表名，数据是64位的事务号、记录的位置和内容
+  REDO_CHECKPOINT = 5,   // checkpoint完成，没有数据。恢复时忽略，复制的备库用它清理不再需要的事务状态
+};
+
+/**
+ * 恢复的日志中没有提交的事务修改之前的记录内容，按(表名, 事务号, 页号, 槽号)查找
+ */
+using RedoUndoImages = std::map<std::tuple<std::string, int64_t, int32_t, int32_t>, std::string>;
+
+/**
+ * 日志落盘之后收到写出的数据，data是完整的若干条记录，end_lsn是最后一条记录的LSN。
+ * 按照落盘的顺序调用，调用时可能持有日志的锁，不能再调用RedoLog的方法
+ */
+using RedoLogShipper = std::function<void(const char *data, size_t len, uint64_t end_lsn)>;
+
+/**
+ * 日志记录的头部，后面依次是文件名(name_len字节，没有结尾的'\0')和data_len字节的数据。
+ * checksum覆盖checksum字段之后的头部和所有数据，恢复时遇到校验失败的记录就认为日志到此结束
+ */
+struct RedoRecordHeader {
+  uint32_t magic;
+  uint32_t checksum;
+  uint64_t lsn;        // 记录结束的位置
+  uint16_t type;
+  uint16_t name_len;
+  int32_t page_num;
+  int32_t page_size;
+  uint32_t data_len;
+};
+
+/**
+ * 记录页面完整内容的redo日志。
+ * LSN是日志的逻辑长度，每条记录的LSN是它结束的位置，只在内存中使用，每次启动都从0开始。
+ * 脏页写回数据文件之前，它的内容必须已经写到日志中并且落盘(log before page)；
+ * 事务提交时把修改过的页面写到日志中，并等待日志落盘。
+ * 多个线程同时等待落盘时，只有一个线程写日志并执行fdatasync，其它线程等它完成，一次fsync可以提交多个事务。
+ * 日志中记录的都是完整页面，恢复时按顺序把每个页面最后的内容写回数据文件，重复执行也没有关系。
+ *
+ * 事务的提交点是提交记录落盘：提交时先把事务修改过的页面和提交记录写到日志中并等待落盘，
+ * 之后清除记录上的事务字段只修改缓冲池中的页面，和其它页面一样延迟写日志和刷盘。
+ * 恢复分为三步：analysis 扫描日志找出每个页面最后的内容和已经提交的事务；redo 把页面写回数据文件；
+ * undo 在打开表时处理记录上遗留的事务字段，已经提交的事务完成提交，其它事务回滚。
+ * undo完成之前，已经提交的事务会重新写到新的日志中，恢复过程中再次崩溃也不会丢失。
+ * 更新和删除已经提交的记录之前，记录原来的内容先写到日志中，undo时据此回滚没有提交的修改
+ *
+ * 日志超过checkpoint_size之后，后台线程切换到新的日志文件，把所有脏页重新写一遍日志，
+ * 再sync所有打开的数据文件，之后就可以删除旧的日志文件了。
+ * checkpoint是模糊的：切换文件之后前台的提交照常写新的日志，刷脏页时每批只短暂持有页面和分片锁，
+ * 没有完成提交的事务和被pin住的脏页重新写到新的日志中，代替单独记录的活跃事务表和脏页表。
+ * 除了日志大小，也可以由定时器按照目标恢复时间请求checkpoint
+ *
+ * 异步提交的事务只把提交记录追加到日志缓冲中就返回，后台线程在async_commit_lag毫秒之内让它落盘，
+ * 崩溃时最多丢失这段时间内提交的事务。日志的顺序不变，之后同步提交的事务落盘时也会带上它们
+ */
+class RedoLog {
+public:
+  static RedoLog &instance();
+
+  /**
+   * 在dir中恢复已有的日志，然后打开新的日志文件并启动checkpoint线程。
+   * 需要在打开任何数据文件之前调用
+   */
+  RC open(const char *dir, long long checkpoint_size = REDO_LOG_DEFAULT_CHECKPOINT_SIZE);
+  /**
+   * 停止checkpoint线程，做最后一次checkpoint并关闭日志。调用之前所有的数据文件应该已经刷盘了
+   */
+  void close();
+
+  bool enabled() const
+  {
+    return enabled_;
+  }
+
+  /**
+   * 追加一条记录到日志缓冲中，返回这条记录的LSN，不等待落盘
+   */
+  uint64_t append_page(const char *file_name, int32_t page_num, const char *page, int page_size);
+  uint64_t append_file_create(const char *file_name);
+  /**
+   * 追加事务的提交记录。end_commit之前，checkpoint切换日志文件时会把它重新写到新的日志中
+   */
+  uint64_t append_commit(int64_t trx_id);
+  void end_commit(int64_t trx_id);
+  /**
+   * 追加事务修改记录之前的内容，不等待落盘。日志顺序保证它在修改之后的页面之前落盘。
+   * end_undo之前，checkpoint切换日志文件时会把它重新写到新的日志中
+   */
+  uint64_t append_undo(int64_t trx_id, const char *table_name, int32_t page_num, int32_t slot_num, const char *data,
+                       int data_len);
+  /**
+   * 事务已经提交或者回滚完成，不再需要修改之前的内容
+   */
+  void end_undo(int64_t trx_id);
+
+  /**
+   * 等待LSN之前的日志都落盘
+   */
+  RC flush(uint64_t lsn);
+  /**
+   * 不等待落盘，后台线程在async_commit_lag毫秒之内把LSN之前的日志写到磁盘上
+   */
+  void flush_async(uint64_t lsn);
+  void set_async_commit_lag(int lag_ms)
+  {
+    async_commit_lag_ms_ = lag_ms;
+  }
+
+  uint64_t current_lsn();
+  uint64_t durable_lsn();
+
+  /**
+   * 执行fdatasync的次数，多个事务一起提交时会小于提交的次数
+   */
+  long sync_count() const
+  {
+    return sync_count_;
+  }
+
+  RC checkpoint();
+  /**
+   * 请求后台线程做一次checkpoint，不等待完成
+   */
+  void request_checkpoint();
+  /**
+   * 按照上一次checkpoint之后写的日志估计崩溃恢复需要的毫秒数。
+   * 恢复速度在启动恢复时测量，没有测量过时使用REDO_LOG_DEFAULT_REPLAY_RATE
+   */
+  long long estimated_recovery_ms();
+  /**
+   * 上一次checkpoint之后写的日志字节数
+   */
+  long long log_size();
+
+  /**
+   * 打开日志时恢复了已有的日志，表打开时还需要处理记录上遗留的事务字段
+   */
+  bool recovering() const
+  {
+    return recovering_;
+  }
+  /**
+   * 恢复的日志中事务是否已经提交
+   */
+  bool recovered_committed(int64_t trx_id) const
+  {
+    return recovered_trx_.count(trx_id) != 0;
+  }
+  /**
+   * 恢复的日志中没有提交的事务修改记录之前的内容，没有时返回nullptr，说明记录是这个事务插入的
+   */
+  const std::string *recovered_undo(const char *table_name, int64_t trx_id, int32_t page_num, int32_t slot_num) const;
+  /**
+   * 所有的表都已经打开，记录上的事务字段都处理完了，做一次checkpoint之后就不再需要恢复的日志了
+   */
+  RC finish_recovery();
+
+  /**
+   * 读取dir中的日志，把每个页面最后的内容写回数据文件，日志本身不会被删除。
+   * committed_trx不为空时返回日志中已经提交的事务，undo_images不为空时返回没有提交的事务修改之前的记录内容
+   */
+  static RC recover(const char *dir, std::set<int64_t> *committed_trx = nullptr,
+                    RedoUndoImages *undo_images = nullptr);
+  /**
+   * data开头是不是一条完整并且校验通过的记录，是的话返回它的头部，记录的长度是头部加上name_len和data_len
+   */
+  static bool decode_record(const char *data, size_t size, RedoRecordHeader &header);
+
+  /**
+   * 设置之后每次落盘的日志都交给shipper，用来把日志复制到备库
+   */
+  void set_shipper(RedoLogShipper shipper);
+  /**
+   * 再增加一个shipper，和set_shipper设置的同时收到落盘的日志，返回用来移除它的编号。在线备份用它截取备份期间的日志
+   */
+  int add_shipper(RedoLogShipper shipper);
+  void remove_shipper(int id);
+
+private:
+  RedoLog() = default;
+
+  uint64_t append(RedoRecordType type, const char *file_name, int32_t page_num, const char *data, int data_len,
+                  int page_size);
+  // 调用时需要持有mutex_
+  void append_locked(RedoRecordHeader &header, const char *file_name, const char *data);
+  /**
+   * 没有完成提交的事务的提交记录和没有结束的事务修改之前的内容需要一直留在日志中，换新的日志文件时重新写一遍
+   */
+  void append_live_records_locked();
+  /**
+   * 把缓冲中的日志都写到当前的日志文件中，然后换一个新的日志文件，返回旧文件的序号
+   */
+  RC switch_file(long *old_seq);
+  RC open_file(long seq);
+  void remove_files(long max_seq);
+  void checkpoint_routine();
+  void async_flush_routine();
+
+private:
+  std::atomic<bool> enabled_{false};
+  std::string dir_;
+  long long checkpoint_size_ = REDO_LOG_DEFAULT_CHECKPOINT_SIZE;
+  long long replay_rate_ = REDO_LOG_DEFAULT_REPLAY_RATE;  // 恢复时每秒处理的日志字节数
+
+  std::mutex mutex_;               // 保护下面的成员，只在很短的时间内持有
+  std::condition_variable flushed_;
+  std::string buffer_;             // 还没有写到文件中的日志
+  uint64_t lsn_ = 0;               // 已经追加的日志的末尾
+  uint64_t durable_lsn_ = 0;       // 已经落盘的日志的末尾
+  bool flushing_ = false;          // 有线程正在写日志文件
+  int fd_ = -1;
+  long seq_ = 0;                   // 当前日志文件的序号
+  long long file_size_ = 0;        // 当前日志文件已经追加的大小
+  std::atomic<long> sync_count_{0};
+  std::map<int, RedoLogShipper> shippers_;  // set_shipper设置的编号是0
+  int next_shipper_id_ = 1;
+  std::set<int64_t> committing_trx_;  // 已经写了提交记录，还没有完成提交的事务
+  std::set<int64_t> recovered_trx_;   // 恢复的日志中已经提交的事务，undo完成之前一直保留
+  std::map<int64_t, std::vector<std::pair<std::string, std::string>>> undo_records_;  // 事务号 -> (表名, 数据)
+  RedoUndoImages recovered_undo_;     // 恢复的日志中没有提交的事务修改之前的内容，undo完成之前一直保留
+  bool recovering_ = false;
+
+  std::mutex checkpoint_mutex_;    // 同时只做一个checkpoint
+  std::thread checkpoint_thread_;
+  std::condition_variable checkpoint_cond_;
+  bool checkpoint_stop_ = false;   // 以下两个由mutex_保护
+  bool checkpoint_requested_ = false;
+
+  std::thread async_flush_thread_;
+  std::condition_variable async_flush_cond_;
+  bool async_flush_stop_ = false;  // 以下两个由mutex_保护
+  uint64_t async_lsn_ = 0;         // 异步提交的事务需要落盘的日志末尾
+  std::atomic<int> async_commit_lag_ms_{REDO_LOG_DEFAULT_ASYNC_COMMIT_LAG};
+};
+
+#endif  // __OBSERVER_STORAGE_DEFAULT_REDO_LOG_H_
@@ -0,0 +1,779 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Read replicas fed by shipping the redo log.
+//
+
+#include "storage/default/replication.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include "common/io/io.h"
+#include "common/log/log.h"
+#include "common/metrics/metrics_registry.h"
+#include "common/metrics/snapshot.h"
+#include "common/os/path.h"
+#include "storage/common/record_manager.h"
+#include "storage/common/table.h"
+#include "storage/default/disk_buffer_pool.h"
+#include "storage/default/redo_log.h"
+
+static long long now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static RC send_fully(int fd, const char *data, size_t len)
+{
+  while (len > 0) {
+    ssize_t ret = send(fd, data, len, MSG_NOSIGNAL);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return RC::IOERR_WRITE;
+    }
+    data += ret;
+    len -= ret;
+  }
+  return RC::SUCCESS;
+}
+
+static RC recv_fully(int fd, char *data, size_t len)
+{
+  while (len > 0) {
+    ssize_t ret = recv(fd, data, len, 0);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return RC::IOERR_READ;
+    }
+    data += ret;
+    len -= ret;
+  }
+  return RC::SUCCESS;
+}
+
+static RC send_frame(int fd, ReplicationFrameType type, uint64_t lsn, const char *data, size_t len)
+{
+  ReplicationFrameHeader header;
+  header.magic = REPLICATION_MAGIC;
+  header.type = type;
+  header.lsn = lsn;
+  header.len = len;
+  RC rc = send_fully(fd, (const char *)&header, sizeof(header));
+  if (rc == RC::SUCCESS && len > 0) {
+    rc = send_fully(fd, data, len);
+  }
+  return rc;
+}
+
+static RC recv_frame(int fd, ReplicationFrameHeader &header, std::string &data)
+{
+  RC rc = recv_fully(fd, (char *)&header, sizeof(header));
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  if (header.magic != REPLICATION_MAGIC || header.len > (uint64_t)REPLICATION_MAX_FRAME_SIZE) {
+    LOG_ERROR("Invalid replication frame. magic=%x, type=%u, len=%llu",
+              header.magic, header.type, (unsigned long long)header.len);
+    return RC::IOERR_READ;
+  }
+  data.resize(header.len);
+  return header.len == 0 ? RC::SUCCESS : recv_fully(fd, &data[0], header.len);
+}
+
+ReplicationServer &ReplicationServer::instance()
+{
+  static ReplicationServer instance;
+  return instance;
+}
+
+RC ReplicationServer::start(int port, const std::string &db_dir, long long max_lag)
+{
+  if (!RedoLog::instance().enabled()) {
+    LOG_ERROR("Replication needs redo log");
+    return RC::INVALID_ARGUMENT;
+  }
+  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    LOG_ERROR("Failed to create socket of replication. error=%s", strerror(errno));
+    return RC::IOERR;
+  }
+  int yes = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  socklen_t addr_len = sizeof(addr);
+  if (bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd_, 16) < 0 ||
+      getsockname(listen_fd_, (struct sockaddr *)&addr, &addr_len) < 0) {
+    LOG_ERROR("Failed to listen on port %d for replication. error=%s", port, strerror(errno));
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return RC::IOERR;
+  }
+  port_ = ntohs(addr.sin_port);
+  db_dir_ = db_dir;
+  max_lag_ = max_lag;
+
+  // 一直保持设置，没有备库时只是空转
+  RedoLog::instance().set_shipper(
+      [this](const char *data, size_t len, uint64_t end_lsn) { ship(data, len, end_lsn); });
+  running_ = true;
+  accept_thread_ = std::thread(&ReplicationServer::accept_routine, this);
+  LOG_INFO("Serve replicas on port %d, max lag %lld bytes", port_, max_lag_);
+  return RC::SUCCESS;
+}
+
+void ReplicationServer::stop()
+{
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+  accept_thread_.join();
+  close(listen_fd_);
+  listen_fd_ = -1;
+  RedoLog::instance().set_shipper(nullptr);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::shared_ptr<Session> &session : sessions_) {
+      std::lock_guard<std::mutex> session_lock(session->mutex);
+      session->broken = true;
+      // 让阻塞在send上的线程返回
+      shutdown(session->fd, SHUT_RDWR);
+      session->cond.notify_all();
+    }
+  }
+  reap_sessions(true);
+  LOG_INFO("Stop serving replicas");
+}
+
+int ReplicationServer::replica_count()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  int count = 0;
+  for (const std::shared_ptr<Session> &session : sessions_) {
+    std::lock_guard<std::mutex> session_lock(session->mutex);
+    count += session->finished ? 0 : 1;
+  }
+  return count;
+}
+
+void ReplicationServer::reap_sessions(bool all)
+{
+  std::vector<std::shared_ptr<Session>> finished;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = sessions_.begin();
+    while (iter != sessions_.end()) {
+      bool done = all;
+      if (!done) {
+        std::lock_guard<std::mutex> session_lock((*iter)->mutex);
+        done = (*iter)->finished;
+      }
+      if (done) {
+        finished.push_back(*iter);
+        iter = sessions_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+  }
+  for (const std::shared_ptr<Session> &session : finished) {
+    session->thread.join();
+    close(session->fd);
+  }
+}
+
+void ReplicationServer::accept_routine()
+{
+  while (running_) {
+    reap_sessions(false);
+    struct pollfd pfd;
+    pfd.fd = listen_fd_;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, REPLICATION_ACCEPT_TIMEOUT_MS) <= 0) {
+      continue;
+    }
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int fd = accept(listen_fd_, (struct sockaddr *)&addr, &addr_len);
+    if (fd < 0) {
+      continue;
+    }
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    LOG_INFO("Replica %s:%d connected", inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+
+    std::shared_ptr<Session> session = std::make_shared<Session>();
+    session->fd = fd;
+    {
+      // 先登记再启动线程，checkpoint之前落盘的日志也会发给它，重放旧的页面之后还会收到新的
+      std::lock_guard<std::mutex> lock(mutex_);
+      sessions_.push_back(session);
+    }
+    session->thread = std::thread(&ReplicationServer::serve, this, session);
+  }
+}
+
+void ReplicationServer::ship(const char *data, size_t len, uint64_t end_lsn)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const std::shared_ptr<Session> &session : sessions_) {
+    std::lock_guard<std::mutex> session_lock(session->mutex);
+    if (session->broken) {
+      continue;
+    }
+    if ((long long)(session->pending.size() + len) > max_lag_) {
+      LOG_WARN("Replica on fd %d falls behind more than %lld bytes, disconnect it", session->fd, max_lag_);
+      session->broken = true;
+      shutdown(session->fd, SHUT_RDWR);
+    } else {
+      session->pending.append(data, len);
+      session->pending_lsn = end_lsn;
+    }
+    session->cond.notify_all();
+  }
+}
+
+RC ReplicationServer::send_snapshot(Session &session)
+{
+  RC rc = send_frame(session.fd, REPL_FRAME_HELLO, 0, db_dir_.data(), db_dir_.size());
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  rc = RedoLog::instance().checkpoint();
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to checkpoint before sending snapshot. rc=%d:%s", rc, strrc(rc));
+    return rc;
+  }
+
+  std::vector<std::string> files;
+  if (common::getFileList(files, db_dir_, "", true) < 0) {
+    LOG_ERROR("Failed to list files under %s", db_dir_.c_str());
+    return RC::IOERR_ACCESS;
+  }
+  long long bytes = 0;
+  std::vector<char> buffer;
+  for (const std::string &file : files) {
+    std::string path = file.substr(db_dir_.size());
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+      // 复制期间被删除的文件
+      LOG_WARN("Skip %s in replication snapshot. error=%s", file.c_str(), strerror(errno));
+      continue;
+    }
+    // 每一段都带着路径，第一段即使是空的也要发送，备库据此创建文件
+    const uint16_t path_len = (uint16_t)path.size();
+    buffer.resize(sizeof(path_len) + path.size() + REPLICATION_FILE_CHUNK_SIZE);
+    memcpy(buffer.data(), &path_len, sizeof(path_len));
+    memcpy(buffer.data() + sizeof(path_len), path.data(), path.size());
+    const size_t head_len = sizeof(path_len) + path.size();
+    bool first = true;
+    while (rc == RC::SUCCESS) {
+      ssize_t len = read(fd, buffer.data() + head_len, REPLICATION_FILE_CHUNK_SIZE);
+      if (len < 0 && errno == EINTR) {
+        continue;
+      }
+      if (len < 0) {
+        LOG_ERROR("Failed to read %s for replication snapshot. error=%s", file.c_str(), strerror(errno));
+        rc = RC::IOERR_READ;
+        break;
+      }
+      if (len == 0 && !first) {
+        break;
+      }
+      rc = send_frame(session.fd, REPL_FRAME_FILE, 0, buffer.data(), head_len + len);
+      bytes += len;
+      first = false;
+      if (len == 0) {
+        break;
+      }
+    }
+    close(fd);
+    if (rc != RC::SUCCESS) {
+      return rc;
+    }
+  }
+  LOG_INFO("Send snapshot of %d files, %lld bytes to replica on fd %d", (int)files.size(), bytes, session.fd);
+
+  // checkpoint时固定在缓冲池中的页面只写了日志，没有写回文件，备库要在打开表之前重放到这里
+  std::string data;
+  uint64_t lsn = 0;
+  {
+    std::lock_guard<std::mutex> lock(session.mutex);
+    data.swap(session.pending);
+    lsn = session.pending_lsn;
+  }
+  if (!data.empty()) {
+    rc = send_frame(session.fd, REPL_FRAME_LOG, lsn, data.data(), data.size());
+  }
+  return rc != RC::SUCCESS ? rc : send_frame(session.fd, REPL_FRAME_SNAPSHOT_END, lsn, nullptr, 0);
+}
+
+void ReplicationServer::serve(std::shared_ptr<Session> session)
+{
+  RC rc = send_snapshot(*session);
+  uint64_t sent_lsn = 0;
+  std::string data;
+  while (rc == RC::SUCCESS) {
+    uint64_t lsn = 0;
+    {
+      std::unique_lock<std::mutex> lock(session->mutex);
+      if (session->pending.empty() && !session->broken) {
+        session->cond.wait_for(lock, std::chrono::milliseconds(REPLICATION_HEARTBEAT_MS));
+      }
+      if (session->broken) {
+        break;
+      }
+      data.clear();
+      data.swap(session->pending);
+      lsn = session->pending_lsn;
+    }
+    if (data.empty()) {
+      rc = send_frame(session->fd, REPL_FRAME_HEARTBEAT, sent_lsn, nullptr, 0);
+    } else {
+      rc = send_frame(session->fd, REPL_FRAME_LOG, lsn, data.data(), data.size());
+      sent_lsn = lsn;
+    }
+  }
+  LOG_INFO("Replica on fd %d disconnected. rc=%d:%s", session->fd, rc, strrc(rc));
+
+  std::lock_guard<std::mutex> lock(session->mutex);
+  session->broken = true;
+  session->finished = true;
+  session->pending.clear();
+}
+
+ReplicationMetric::~ReplicationMetric()
+{
+  delete snapshot_value_;
+  snapshot_value_ = nullptr;
+}
+
+void ReplicationMetric::snapshot()
+{
+  if (snapshot_value_ == nullptr) {
+    snapshot_value_ = new common::SnapshotBasic<std::string>();
+  }
+  std::string value = to_string();
+  ((common::SnapshotBasic<std::string> *)snapshot_value_)->setValue(value);
+}
+
+std::string ReplicationMetric::to_string() const
+{
+  const uint64_t received = received_lsn.load();
+  const uint64_t applied = applied_lsn.load();
+  const long long oldest = oldest_pending_us.load();
+  std::stringstream ss;
+  ss << "connected:" << (connected.load() ? 1 : 0) << ",lag_bytes:" << (received > applied ? received - applied : 0)
+     << ",lag_ms:" << (oldest == 0 ? 0 : std::max(now_us() - oldest, 0LL) / 1000)
+     << ",received_bytes:" << received_bytes.load() << ",applied_records:" << applied_records.load();
+  return ss.str();
+}
+
+ReplicaClient &ReplicaClient::instance()
+{
+  static ReplicaClient instance;
+  return instance;
+}
+
+RC ReplicaClient::connect(const std::string &primary, const std::string &db_dir)
+{
+  size_t colon = primary.rfind(':');
+  if (colon == std::string::npos || colon == 0 || colon + 1 == primary.size()) {
+    LOG_ERROR("Invalid primary address %s, should be host:port", primary.c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+  std::string host = primary.substr(0, colon);
+  std::string port = primary.substr(colon + 1);
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *result = nullptr;
+  int ret = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+  if (ret != 0) {
+    LOG_ERROR("Failed to resolve primary %s. error=%s", primary.c_str(), gai_strerror(ret));
+    return RC::INVALID_ARGUMENT;
+  }
+  fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd_ < 0 || ::connect(fd_, result->ai_addr, result->ai_addrlen) != 0) {
+    LOG_ERROR("Failed to connect to primary %s. error=%s", primary.c_str(), strerror(errno));
+    freeaddrinfo(result);
+    if (fd_ >= 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+    return RC::IOERR;
+  }
+  freeaddrinfo(result);
+  primary_ = primary;
+  db_dir_ = db_dir;
+
+  RC rc = receive_snapshot();
+  if (rc != RC::SUCCESS) {
+    LOG_ERROR("Failed to receive snapshot from primary %s. rc=%d:%s", primary.c_str(), rc, strrc(rc));
+    close(fd_);
+    fd_ = -1;
+    return rc;
+  }
+  metric_.connected = true;
+  return RC::SUCCESS;
+}
+
+RC ReplicaClient::receive_snapshot()
+{
+  ReplicationFrameHeader header;
+  std::string data;
+  RC rc = recv_frame(fd_, header, data);
+  if (rc != RC::SUCCESS || header.type != REPL_FRAME_HELLO) {
+    return rc != RC::SUCCESS ? rc : RC::IOERR_READ;
+  }
+  primary_db_dir_ = data;
+
+  // 备库的数据全部来自主库，原来的文件都不要了
+  std::vector<std::string> files;
+  common::getFileList(files, db_dir_, "", true);
+  for (const std::string &file : files) {
+    if (unlink(file.c_str()) != 0) {
+      LOG_ERROR("Failed to remove %s before receiving snapshot. error=%s", file.c_str(), strerror(errno));
+      return RC::IOERR_ACCESS;
+    }
+  }
+
+  int fd = -1;
+  std::string current;
+  int file_num = 0;
+  long long bytes = 0;
+  while ((rc = recv_frame(fd_, header, data)) == RC::SUCCESS &&
+         (header.type == REPL_FRAME_FILE || header.type == REPL_FRAME_LOG)) {
+    if (header.type == REPL_FRAME_LOG) {
+      // 文件都已经收到了，表还没有打开，页面直接写到文件中
+      if (fd >= 0) {
+        rc = fsync(fd) == 0 ? RC::SUCCESS : RC::IOERR_FSYNC;
+        close(fd);
+        fd = -1;
+      }
+      if (rc == RC::SUCCESS) {
+        rc = apply(data.data(), data.size());
+      }
+      if (rc != RC::SUCCESS) {
+        break;
+      }
+      metric_.received_lsn = header.lsn;
+      metric_.applied_lsn = header.lsn;
+      metric_.received_bytes += data.size();
+      continue;
+    }
+    uint16_t path_len = 0;
+    if (data.size() < sizeof(path_len)) {
+      rc = RC::IOERR_READ;
+      break;
+    }
+    memcpy(&path_len, data.data(), sizeof(path_len));
+    if (data.size() < sizeof(path_len) + path_len) {
+      rc = RC::IOERR_READ;
+      break;
+    }
+    std::string path = data.substr(sizeof(path_len), path_len);
+    if (path != current || fd < 0) {
+      if (fd >= 0 && (fsync(fd) != 0 || close(fd) != 0)) {
+        rc = RC::IOERR_FSYNC;
+        break;
+      }
+      current = path;
+      std::string file = db_dir_ + path;
+      std::string dir = file.substr(0, file.rfind('/'));
+      if (path.find("..") != std::string::npos || !common::check_directory(dir)) {
+        LOG_ERROR("Invalid file %s in snapshot", path.c_str());
+        rc = RC::IOERR_ACCESS;
+        fd = -1;
+        break;
+      }
+      fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+      if (fd < 0) {
+        LOG_ERROR("Failed to create %s. error=%s", file.c_str(), strerror(errno));
+        rc = RC::IOERR_ACCESS;
+        break;
+      }
+      file_num++;
+    }
+    const size_t head_len = sizeof(path_len) + path_len;
+    size_t len = data.size() - head_len;
+    const char *p = data.data() + head_len;
+    while (len > 0) {
+      ssize_t ret = write(fd, p, len);
+      if (ret < 0 && errno == EINTR) {
+        continue;
+      }
+      if (ret < 0) {
+        rc = RC::IOERR_WRITE;
+        break;
+      }
+      p += ret;
+      len -= ret;
+    }
+    bytes += data.size() - head_len;
+    if (rc != RC::SUCCESS) {
+      break;
+    }
+  }
+  if (fd >= 0) {
+    if (rc == RC::SUCCESS && fsync(fd) != 0) {
+      rc = RC::IOERR_FSYNC;
+    }
+    close(fd);
+  }
+  if (rc == RC::SUCCESS && header.type != REPL_FRAME_SNAPSHOT_END) {
+    LOG_ERROR("Unexpected replication frame %u while receiving snapshot", header.type);
+    rc = RC::IOERR_READ;
+  }
+  if (rc == RC::SUCCESS) {
+    LOG_INFO("Receive snapshot of %d files, %lld bytes from primary %s", file_num, bytes, primary_.c_str());
+  }
+  return rc;
+}
+
+RC ReplicaClient::start()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = false;
+  }
+  metric_registered_ = common::get_metrics_registry().register_metric(REPLICATION_METRIC_TAG, &metric_);
+  receive_thread_ = std::thread(&ReplicaClient::receive_routine, this);
+  apply_thread_ = std::thread(&ReplicaClient::apply_routine, this);
+  LOG_INFO("Start replicating from primary %s", primary_.c_str());
+  return RC::SUCCESS;
+}
+
+void ReplicaClient::stop()
+{
+  if (fd_ < 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+    cond_.notify_all();
+  }
+  shutdown(fd_, SHUT_RDWR);
+  if (receive_thread_.joinable()) {
+    receive_thread_.join();
+  }
+  if (apply_thread_.joinable()) {
+    apply_thread_.join();
+  }
+  close(fd_);
+  fd_ = -1;
+  if (metric_registered_) {
+    common::get_metrics_registry().unregister(REPLICATION_METRIC_TAG);
+    metric_registered_ = false;
+  }
+  metric_.connected = false;
+  LOG_INFO("Stop replicating from primary %s", primary_.c_str());
+}
+
+void ReplicaClient::receive_routine()
+{
+  ReplicationFrameHeader header;
+  std::string data;
+  RC rc = RC::SUCCESS;
+  while ((rc = recv_frame(fd_, header, data)) == RC::SUCCESS) {
+    if (header.lsn > metric_.received_lsn.load()) {
+      metric_.received_lsn = header.lsn;
+    }
+    if (header.type != REPL_FRAME_LOG) {
+      continue;
+    }
+    metric_.received_bytes += data.size();
+    std::unique_lock<std::mutex> lock(mutex_);
+    // 重放跟不上时不再接收，主库缓存的日志太多时会断开这个备库
+    while (!stop_ && pending_bytes_ > REPLICA_MAX_PENDING_BYTES) {
+      cond_.wait(lock);
+    }
+    if (stop_) {
+      break;
+    }
+    PendingLog log;
+    log.data.swap(data);
+    log.lsn = header.lsn;
+    log.receive_us = now_us();
+    if (pending_.empty()) {
+      metric_.oldest_pending_us = log.receive_us;
+    }
+    pending_bytes_ += log.data.size();
+    pending_.push_back(std::move(log));
+    cond_.notify_all();
+  }
+
+  metric_.connected = false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!stop_) {
+    LOG_ERROR("Disconnected from primary %s, restart this replica to copy a new snapshot. rc=%d:%s",
+              primary_.c_str(), rc, strrc(rc));
+  }
+}
+
+void ReplicaClient::apply_routine()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    if (pending_.empty()) {
+      cond_.wait(lock);
+      continue;
+    }
+    PendingLog log = std::move(pending_.front());
+    pending_.pop_front();
+    lock.unlock();
+
+    RC rc = apply(log.data.data(), log.data.size());
+    if (rc != RC::SUCCESS) {
+      LOG_ERROR("Failed to apply redo log to %llu from primary. rc=%d:%s", (unsigned long long)log.lsn, rc, strrc(rc));
+    }
+    metric_.applied_lsn = log.lsn;
+
+    lock.lock();
+    pending_bytes_ -= log.data.size();
+    metric_.oldest_pending_us = pending_.empty() ? 0 : pending_.front().receive_us;
+    cond_.notify_all();
+  }
+}
+
+bool ReplicaClient::local_file_name(const char *name, size_t len, std::string &local) const
+{
+  if (len < primary_db_dir_.size() || memcmp(name, primary_db_dir_.data(), primary_db_dir_.size()) != 0) {
+    return false;
+  }
+  local = db_dir_;
+  local.append(name + primary_db_dir_.size(), len - primary_db_dir_.size());
+  return true;
+}
+
+RC ReplicaClient::apply(const char *data, size_t len)
+{
+  size_t offset = 0;
+  RedoRecordHeader header;
+  while (RedoLog::decode_record(data + offset, len - offset, header)) {
+    const char *name = data + offset + sizeof(header);
+    const char *body = name + header.name_len;
+    offset += sizeof(header) + header.name_len + header.data_len;
+    metric_.applied_records++;
+
+    switch (header.type) {
+      case REDO_PAGE_IMAGE: {
+        std::string file_name;
+        if ((int)header.data_len != header.page_size || !local_file_name(name, header.name_len, file_name)) {
+          break;
+        }
+        // 新建的文件在备库上没有，restore_pages会跳过
+        RC rc = apply_global_buffer_pool_page(file_name.c_str(), header.page_size, header.page_num, body);
+        if (rc != RC::SUCCESS) {
+          LOG_WARN("Failed to apply page %s:%d. rc=%d:%s", file_name.c_str(), header.page_num, rc, strrc(rc));
+        }
+      } break;
+      case REDO_TRX_COMMIT: {
+        if (header.data_len < sizeof(int64_t)) {
+          break;
+        }
+        int64_t trx_id = 0;
+        memcpy(&trx_id, body, sizeof(trx_id));
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        committed_[trx_id] = generation_;
+      } break;
+      case REDO_UNDO_IMAGE: {
+        const size_t head_len = sizeof(int64_t) + 2 * sizeof(int32_t);
+        if (header.data_len < head_len) {
+          break;
+        }
+        int64_t trx_id = 0;
+        int32_t position[2];
+        memcpy(&trx_id, body, sizeof(trx_id));
+        memcpy(position, body + sizeof(trx_id), sizeof(position));
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        auto &image = undo_images_[std::make_tuple(std::string(name, header.name_len), trx_id, position[0], position[1])];
+        image.first.assign(body + head_len, header.data_len - head_len);
+        image.second = generation_;
+      } break;
+      case REDO_FILE_CREATE: {
+        LOG_WARN("File %.*s is created on primary, tables created after the snapshot are not replicated",
+                 (int)header.name_len, name);
+      } break;
+      case REDO_CHECKPOINT: {
+        // 还需要的提交记录和修改之前的内容都在上一个checkpoint记录之后重新写过了
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        for (auto iter = committed_.begin(); iter != committed_.end();) {
+          iter = iter->second < generation_ ? committed_.erase(iter) : std::next(iter);
+        }
+        for (auto iter = undo_images_.begin(); iter != undo_images_.end();) {
+          iter = iter->second.second < generation_ ? undo_images_.erase(iter) : std::next(iter);
+        }
+        generation_++;
+      } break;
+      default:
+        break;
+    }
+  }
+  if (offset != len) {
+    LOG_ERROR("Broken redo log from primary at %lu of %lu bytes", offset, len);
+    return RC::IOERR_READ;
+  }
+  return RC::SUCCESS;
+}
+
+bool ReplicaClient::committed(int64_t trx_id)
+{
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  return committed_.count(trx_id) != 0;
+}
+
+bool ReplicaClient::is_visible(Table *table, Record *record, int64_t trx_id, bool deleted, std::vector<char> &version)
+{
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  if (committed_.count(trx_id) != 0) {
+    return !deleted;
+  }
+  // 没有提交的事务修改的记录，日志中有修改之前的内容时看到的是它，否则是这个事务插入的记录
+  auto iter = undo_images_.find(
+      std::make_tuple(std::string(table->name()), trx_id, record->rid.page_num, record->rid.slot_num));
+  if (iter == undo_images_.end()) {
+    return false;
+  }
+  const std::string &image = iter->second.first;
+  version.assign(table->record_data_size(), 0);
+  memcpy(version.data(), image.data(), std::min(image.size(), version.size()));
+  record->data = version.data();
+  return true;
+}
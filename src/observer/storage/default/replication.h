@@ -0,0 +1,228 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Read replicas fed by shipping the redo log.
+//
+
+#ifndef __OBSERVER_STORAGE_DEFAULT_REPLICATION_H_
+#define __OBSERVER_STORAGE_DEFAULT_REPLICATION_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "rc.h"
+#include "common/metrics/metric.h"
+
+class Table;
+struct Record;
+
+#define REPLICATION_MAGIC 0x4c504552                  // "REPL"
+#define REPLICATION_FILE_CHUNK_SIZE (1 << 20)         // 快照中的文件按这个大小分段发送
+#define REPLICATION_HEARTBEAT_MS 1000                 // 没有新日志时发送心跳的间隔
+#define REPLICATION_ACCEPT_TIMEOUT_MS 500             // 等待连接时检查是否停止的间隔
+#define REPLICATION_DEFAULT_MAX_LAG (256LL << 20)     // 主库为一个备库缓存的日志超过这么多时断开这个备库
+#define REPLICATION_MAX_FRAME_SIZE (1LL << 30)
+#define REPLICA_MAX_PENDING_BYTES (64LL << 20)        // 备库收到还没有重放的日志超过这么多时暂停接收
+#define REPLICATION_METRIC_TAG "Replication.lag"
+
+enum ReplicationFrameType {
+  REPL_FRAME_HELLO = 1,          // 连接之后主库先发送自己的数据库目录，日志中的文件名以它开头
+  REPL_FRAME_FILE = 2,           // 快照中一个文件的一段，数据是16位的路径长度、相对数据库目录的路径和文件内容
+  REPL_FRAME_SNAPSHOT_END = 3,   // 快照发送完了，之后都是日志。lsn是快照之前的日志的末尾
+  REPL_FRAME_LOG = 4,            // 落盘的redo日志，是完整的若干条记录，lsn是最后一条记录的LSN。
+                                 // 在SNAPSHOT_END之前的是复制快照期间的日志，备库打开表之前重放
+  REPL_FRAME_HEARTBEAT = 5,      // 一段时间没有新日志时发送，lsn是已经发送的日志的末尾
+};
+
+/**
+ * 主库和备库之间每一帧的头部，后面是len字节的数据。两边需要是相同的字节序
+ */
+struct ReplicationFrameHeader {
+  uint32_t magic;
+  uint32_t type;
+  uint64_t lsn;
+  uint64_t len;
+};
+
+/**
+ * 主库上的复制服务。备库连接之后：
+ * 1. 先登记这个备库，之后落盘的redo日志都会缓存给它；
+ * 2. 做一次checkpoint，这之后数据文件中的页面要么是checkpoint时的内容，要么在登记之后写过日志；
+ * 3. 把数据库目录中的文件作为快照发送过去，复制期间被写出的页面在日志中有更新的内容，重放之后是一致的；
+ * 4. 发送到这时为止缓存的日志，备库在打开表之前重放它们，checkpoint时没有写回的页面由此得到；
+ * 5. 之后持续发送缓存的日志。
+ * 备库接收太慢、缓存的日志超过max_lag时断开它，备库需要重启之后重新复制
+ */
+class ReplicationServer {
+public:
+  static ReplicationServer &instance();
+
+  /**
+   * 在port上监听备库的连接，port为0时随机选择一个端口。需要已经打开了redo日志
+   */
+  RC start(int port, const std::string &db_dir, long long max_lag = REPLICATION_DEFAULT_MAX_LAG);
+  void stop();
+
+  int port() const
+  {
+    return port_;
+  }
+  /**
+   * 当前连接着的备库数
+   */
+  int replica_count();
+
+private:
+  ReplicationServer() = default;
+
+  struct Session {
+    int fd = -1;
+    std::thread thread;
+    std::mutex mutex;              // 保护下面的成员
+    std::condition_variable cond;
+    std::string pending;           // 已经落盘还没有发送的日志
+    uint64_t pending_lsn = 0;
+    bool broken = false;           // 发送失败或者落后太多
+    bool finished = false;         // 线程已经退出，可以回收
+  };
+
+  void accept_routine();
+  void serve(std::shared_ptr<Session> session);
+  RC send_snapshot(Session &session);
+  /**
+   * redo日志落盘之后调用，把日志追加到每个备库的缓存中
+   */
+  void ship(const char *data, size_t len, uint64_t end_lsn);
+  void reap_sessions(bool all);
+
+private:
+  std::atomic<bool> running_{false};
+  int listen_fd_ = -1;
+  int port_ = 0;
+  std::string db_dir_;
+  long long max_lag_ = REPLICATION_DEFAULT_MAX_LAG;
+  std::thread accept_thread_;
+
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<Session>> sessions_;
+};
+
+/**
+ * 备库的复制延迟，以 Replication.lag 注册到MetricsRegistry。
+ * lag_bytes是收到的主库日志末尾和已经重放的位置之差，lag_ms是收到之后还没有重放的日志中最早的一段等待的时间
+ */
+class ReplicationMetric : public common::Metric {
+public:
+  ~ReplicationMetric();
+
+  void snapshot() override;
+  std::string to_string() const;
+
+public:
+  std::atomic<bool> connected{false};
+  std::atomic<uint64_t> received_lsn{0};
+  std::atomic<uint64_t> applied_lsn{0};
+  std::atomic<long long> received_bytes{0};
+  std::atomic<long long> applied_records{0};
+  std::atomic<long long> oldest_pending_us{0};  // 还没有重放的日志中最早的一段收到的时间，0表示没有
+};
+
+/**
+ * 备库：启动时从主库接收快照，打开数据库之后一个线程接收日志，另一个线程按顺序重放。
+ * 页面直接换到缓冲池中，可见性按照日志中的提交记录判断：记录上的事务已经提交时可见；
+ * 没有提交时用日志中这个事务修改记录之前的内容，没有的话是这个事务插入的记录，不可见。
+ * 主库每次checkpoint都会把没有结束的事务的提交记录和修改之前的内容重新写一遍，
+ * 所以收到checkpoint记录时，上一次checkpoint记录之前的事务状态都可以丢掉。
+ * 重放和查询同时进行，一条语句可能看到不同时刻的页面，只保证每条记录是已经提交的版本
+ */
+class ReplicaClient {
+public:
+  static ReplicaClient &instance();
+
+  /**
+   * 连接主库(host:port)，清空db_dir之后把主库的快照写进去。需要在打开数据库之前调用
+   */
+  RC connect(const std::string &primary, const std::string &db_dir);
+  /**
+   * 数据库已经打开，开始接收和重放日志
+   */
+  RC start();
+  void stop();
+
+  /**
+   * Trx::is_visible在备库上的实现，trx_id是记录上不为0的事务号
+   */
+  bool is_visible(Table *table, Record *record, int64_t trx_id, bool deleted, std::vector<char> &version);
+
+  /**
+   * 按顺序重放一段日志，data是完整的若干条记录
+   */
+  RC apply(const char *data, size_t len);
+  /**
+   * 日志中的事务是否已经提交，测试使用
+   */
+  bool committed(int64_t trx_id);
+  const ReplicationMetric &metric() const
+  {
+    return metric_;
+  }
+
+private:
+  ReplicaClient() = default;
+
+  struct PendingLog {
+    std::string data;
+    uint64_t lsn = 0;
+    long long receive_us = 0;
+  };
+
+  RC receive_snapshot();
+  void receive_routine();
+  void apply_routine();
+  /**
+   * 主库的文件名换成本地数据库目录中的文件名，不在主库数据库目录中的返回false
+   */
+  bool local_file_name(const char *name, size_t len, std::string &local) const;
+
+private:
+  int fd_ = -1;
+  std::string primary_;
+  std::string db_dir_;
+  std::string primary_db_dir_;
+  bool metric_registered_ = false;
+  ReplicationMetric metric_;
+
+  std::thread receive_thread_;
+  std::thread apply_thread_;
+  std::mutex mutex_;               // 保护下面三个成员
+  std::condition_variable cond_;
+  std::deque<PendingLog> pending_;
+  long long pending_bytes_ = 0;
+  bool stop_ = false;
+
+  std::mutex state_mutex_;  // 保护事务状态，查询判断可见性和重放时都要获取
+  uint64_t generation_ = 0; // 收到的checkpoint记录数，每条状态记下最后一次出现时的值
+  std::unordered_map<int64_t, uint64_t> committed_;
+  std::map<std::tuple<std::string, int64_t, int32_t, int32_t>, std::pair<std::string, uint64_t>> undo_images_;
+};
+
+#endif  // __OBSERVER_STORAGE_DEFAULT_REPLICATION_H_
@@ -0,0 +1,226 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Temporary files that sorts, aggregations, hash joins and index builds spill to.
+//
+
+#include "storage/default/spill_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "common/log/log.h"
+#include "common/os/path.h"
+
+#define SPILL_FILE_PREFIX "miniob_spill_"
+
+SpillQuota::SpillQuota() : limit_(SpillFileManager::instance().query_limit())
+{}
+
+bool SpillQuota::try_consume(size_t bytes)
+{
+  size_t used = used_.load();
+  do {
+    if (limit_ > 0 && used + bytes > limit_) {
+      return false;
+    }
+  } while (!used_.compare_exchange_weak(used, used + bytes));
+
+  size_t peak = peak_.load();
+  while (used + bytes > peak && !peak_.compare_exchange_weak(peak, used + bytes)) {
+  }
+  return true;
+}
+
+void SpillQuota::release(size_t bytes)
+{
+  used_ -= bytes;
+}
+
+/**
+ * fopencookie的cookie。size是文件写到过的最大长度，已经计入quota
+ */
+struct SpillFileManager::SpillFile {
+  SpillFileManager *manager;
+  SpillQuota *quota;
+  int fd;
+  off64_t offset;
+  off64_t size;
+  char *buffer;
+};
+
+SpillFileManager &SpillFileManager::instance()
+{
+  static SpillFileManager instance;
+  return instance;
+}
+
+RC SpillFileManager::init(const std::string &dir, size_t query_limit)
+{
+  std::string path = dir;
+  if (!path.empty()) {
+    if (!common::check_directory(path)) {
+      LOG_ERROR("Failed to create spill directory %s. error=%s", path.c_str(), strerror(errno));
+      return RC::IOERR_ACCESS;
+    }
+    // 只有在O_TMPFILE不可用时才会有带名字的文件，创建之后立即删除，崩溃时可能残留在这里
+    std::vector<std::string> files;
+    common::list_file(path.c_str(), "^" SPILL_FILE_PREFIX, files);
+    for (const std::string &file : files) {
+      const std::string file_path = path + "/" + file;
+      if (::unlink(file_path.c_str()) == 0) {
+        LOG_INFO("Removed stale spill file %s", file_path.c_str());
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  dir_ = path;
+  query_limit_ = query_limit;
+  LOG_INFO("Spill files are created in %s, query spill limit=%lu",
+      path.empty() ? P_tmpdir : path.c_str(), query_limit);
+  return RC::SUCCESS;
+}
+
+int SpillFileManager::open_fd()
+{
+  std::string dir;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dir = dir_.empty() ? P_tmpdir : dir_;
+  }
+#ifdef O_TMPFILE
+  int fd = ::open(dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+  if (fd >= 0 || (errno != EOPNOTSUPP && errno != EISDIR && errno != EINVAL)) {
+    return fd;
+  }
+#endif
+  std::string path = dir + "/" SPILL_FILE_PREFIX "XXXXXX";
+  int fd2 = mkostemp(&path[0], O_CLOEXEC);
+  if (fd2 >= 0) {
+    ::unlink(path.c_str());
+  }
+  return fd2;
+}
+
+FILE *SpillFileManager::create(SpillQuota *quota)
+{
+  int fd = open_fd();
+  if (fd < 0) {
+    return nullptr;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  SpillFile *spill_file = new SpillFile{this, quota, fd, 0, 0, new char[SPILL_FILE_BUFFER_SIZE]};
+  cookie_io_functions_t functions = {read_file, write_file, seek_file, close_file};
+  FILE *file = fopencookie(spill_file, "w+", functions);
+  if (nullptr == file) {
+    const int error = errno;
+    ::close(fd);
+    delete[] spill_file->buffer;
+    delete spill_file;
+    errno = error;
+    return nullptr;
+  }
+  setvbuf(file, spill_file->buffer, _IOFBF, SPILL_FILE_BUFFER_SIZE);
+  open_files_++;
+  return file;
+}
+
+ssize_t SpillFileManager::read_file(void *cookie, char *buf, size_t size)
+{
+  SpillFile *spill_file = (SpillFile *)cookie;
+  ssize_t ret = ::pread(spill_file->fd, buf, size, spill_file->offset);
+  if (ret > 0) {
+    spill_file->offset += ret;
+  }
+  return ret;
+}
+
+ssize_t SpillFileManager::write_file(void *cookie, const char *buf, size_t size)
+{
+  SpillFile *spill_file = (SpillFile *)cookie;
+  const off64_t end = spill_file->offset + (off64_t)size;
+  if (end > spill_file->size) {
+    const size_t grow = end - spill_file->size;
+    if (spill_file->quota != nullptr && !spill_file->quota->try_consume(grow)) {
+      LOG_WARN("Spill file exceeds query spill limit %lu, used=%lu",
+          spill_file->quota->limit(), spill_file->quota->used());
+      errno = EDQUOT;
+      return -1;
+    }
+    spill_file->manager->used_bytes_ += grow;
+    spill_file->size = end;
+  }
+
+  size_t written = 0;
+  while (written < size) {
+    ssize_t ret = ::pwrite(spill_file->fd, buf + written, size - written, spill_file->offset + written);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_ERROR("Failed to write spill file. error=%s", strerror(errno));
+      break;
+    }
+    written += ret;
+  }
+  spill_file->offset += written;
+  spill_file->manager->written_bytes_ += written;
+  // 没写进去的部分仍然计入，直到文件关闭
+  return written > 0 ? (ssize_t)written : -1;
+}
+
+int SpillFileManager::seek_file(void *cookie, off64_t *offset, int whence)
+{
+  SpillFile *spill_file = (SpillFile *)cookie;
+  off64_t position = 0;
+  switch (whence) {
+    case SEEK_SET:
+      position = *offset;
+      break;
+    case SEEK_CUR:
+      position = spill_file->offset + *offset;
+      break;
+    case SEEK_END:
+      position = spill_file->size + *offset;
+      break;
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+  if (position < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  spill_file->offset = position;
+  *offset = position;
+  return 0;
+}
+
+int SpillFileManager::close_file(void *cookie)
+{
+  SpillFile *spill_file = (SpillFile *)cookie;
+  if (spill_file->quota != nullptr) {
+    spill_file->quota->release(spill_file->size);
+  }
+  spill_file->manager->used_bytes_ -= spill_file->size;
+  spill_file->manager->open_files_--;
+  int ret = ::close(spill_file->fd);
+  // fclose在调用close之后不再使用缓冲区
+  delete[] spill_file->buffer;
+  delete spill_file;
+  return ret;
+}
@@ -0,0 +1,129 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Temporary files that sorts, aggregations, hash joins and index builds spill to.
+//
+
+#ifndef __OBSERVER_STORAGE_DEFAULT_SPILL_FILE_H_
+#define __OBSERVER_STORAGE_DEFAULT_SPILL_FILE_H_
+
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "rc.h"
+
+#define SPILL_FILE_BUFFER_SIZE (256 * 1024)  // 临时文件的读写缓冲区，顺序读写时按这个大小访问磁盘
+#define QUERY_SPILL_LIMIT 0                  // 一个查询最多写入的临时文件字节数，0表示不限制
+
+/**
+ * 一个查询可以写入临时文件的字节数。文件关闭时归还，扫描线程也可能写临时文件，所以计数是原子的
+ */
+class SpillQuota {
+public:
+  explicit SpillQuota(size_t limit) : limit_(limit)
+  {}
+  SpillQuota();
+
+  /**
+   * 加上bytes之后不超过限制时计入并返回true，否则不计入
+   */
+  bool try_consume(size_t bytes);
+  void release(size_t bytes);
+
+  size_t used() const
+  {
+    return used_.load();
+  }
+  size_t peak() const
+  {
+    return peak_.load();
+  }
+  size_t limit() const
+  {
+    return limit_;
+  }
+
+private:
+  size_t limit_;
+  std::atomic<size_t> used_{0};
+  std::atomic<size_t> peak_{0};
+};
+
+/**
+ * 临时文件都创建在配置项SpillDir指定的目录中，创建之后就没有名字(O_TMPFILE或者创建后立即unlink)，
+ * 关闭文件或者进程退出、崩溃时由操作系统回收，不会残留。
+ * 返回的是普通的FILE，读写不经过缓冲池，使用SPILL_FILE_BUFFER_SIZE的缓冲区，
+ * 写入时扩大了文件就计入quota，超出quota的写入失败，errno为EDQUOT；fclose时归还文件占用的quota
+ */
+class SpillFileManager {
+public:
+  SpillFileManager() = default;
+
+  static SpillFileManager &instance();
+
+  /**
+   * dir为空时使用系统的临时目录，目录不存在时创建
+   */
+  RC init(const std::string &dir, size_t query_limit);
+
+  const std::string &dir() const
+  {
+    return dir_;
+  }
+  size_t query_limit() const
+  {
+    return query_limit_;
+  }
+
+  /**
+   * 创建一个读写的临时文件，quota可以为nullptr。失败时返回nullptr，errno表示原因
+   */
+  FILE *create(SpillQuota *quota);
+
+  /**
+   * 当前打开的临时文件个数和它们的总大小，以及启动以来写入的总字节数
+   */
+  long open_files() const
+  {
+    return open_files_.load();
+  }
+  size_t used_bytes() const
+  {
+    return used_bytes_.load();
+  }
+  size_t written_bytes() const
+  {
+    return written_bytes_.load();
+  }
+
+private:
+  struct SpillFile;
+  static ssize_t read_file(void *cookie, char *buf, size_t size);
+  static ssize_t write_file(void *cookie, const char *buf, size_t size);
+  static int seek_file(void *cookie, off64_t *offset, int whence);
+  static int close_file(void *cookie);
+
+  int open_fd();
+
+private:
+  std::mutex mutex_;  // 保护dir_
+  std::string dir_;
+  size_t query_limit_ = QUERY_SPILL_LIMIT;
+
+  std::atomic<long> open_files_{0};
+  std::atomic<size_t> used_bytes_{0};
+  std::atomic<size_t> written_bytes_{0};
+};
+
+#endif  // __OBSERVER_STORAGE_DEFAULT_SPILL_FILE_H_
@@ -0,0 +1,374 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Pipelined loader for LOAD DATA.
+//
+
+#include "storage/default/table_loader.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string_view>
+
+#include "common/lang/mutex.h"
+#include "common/log/log.h"
+#include "common/seda/request_trace.h"
+#include "sql/parser/value_parser.h"
+#include "storage/common/table.h"
+
+namespace {
+
+/**
+ * 解析一行时使用的临时数据，每个解析线程一份，避免每一行都申请内存
+ */
+struct LineContext {
+  std::vector<Value> values;
+  std::vector<ValueBuffer> buffers;  // values的数据
+};
+
+bool is_blank(const char *begin, const char *end)
+{
+  for (const char *p = begin; p < end; p++) {
+    if (!isspace((unsigned char)*p)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * 把一行数据按照'|'拆分，解析成表的各个字段的值。值的数据放在context中，下一行解析时覆盖
+ */
+RC parse_line(const Table *table, const char *begin, const char *end, LineContext &context, std::string &errmsg)
+{
+  const TableMeta &table_meta = table->table_meta();
+  const int sys_field_num = table_meta.sys_field_num();
+  const int field_num = (int)context.values.size();
+
+  const char *field_begin = begin;
+  for (int i = 0; i < field_num; i++) {
+    if (field_begin > end) {
+      std::stringstream ss;
+      ss << "need " << field_num << " fields but got " << i;
+      errmsg = ss.str();
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    const char *field_end = (const char *)memchr(field_begin, '|', end - field_begin);
+    if (nullptr == field_end) {
+      field_end = end;
+    }
+    const char *next = field_end + 1;
+
+    // 去掉字段前后的空白字符
+    while (field_begin < field_end && isspace((unsigned char)*field_begin)) {
+      field_begin++;
+    }
+    while (field_end > field_begin && isspace((unsigned char)field_end[-1])) {
+      field_end--;
+    }
+    const std::string_view text(field_begin, field_end - field_begin);
+    field_begin = next;
+
+    const FieldMeta *field = table_meta.field(i + sys_field_num);
+    RC rc = parse_value(field->type(), text, context.buffers[i], context.values[i]);
+    if (rc != RC::SUCCESS) {
+      const char *expected = nullptr;
+      switch (field->type()) {
+        case INTS: expected = "an integer"; break;
+        case FLOATS: expected = "a float number"; break;
+        case DATES: expected = "a date"; break;
+        default: {
+          errmsg = "Unsupported field type to loading: " + std::to_string(field->type());
+          return rc;
+        }
+      }
+      errmsg = std::string("need ") + expected + " but got '" + std::string(text) +
+               "' (field index:" + std::to_string(i) + ")";
+      return rc;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+}  // namespace
+
+TableLoader::TableLoader(Table *table, const TableLoaderOptions &options) : table_(table), options_(options)
+{
+  MUTEX_INIT(&mutex_, nullptr);
+  COND_INIT(&cond_, nullptr);
+  field_num_ = table->table_meta().field_num() - table->table_meta().sys_field_num();
+  record_size_ = table->record_data_size();
+  // 分区表的索引在各个分区上，记录插入到分区时直接更新
+  if (table->partitioned()) {
+    options_.defer_index = false;
+  }
+}
+
+TableLoader::~TableLoader()
+{
+  COND_DESTROY(&cond_);
+  MUTEX_DESTROY(&mutex_);
+}
+
+void TableLoader::split_chunks(const char *data, size_t size)
+{
+  const char *end = data + size;
+  const char *begin = data;
+  while (begin < end) {
+    const char *chunk_end = end;
+    if ((size_t)(end - begin) > LOAD_DATA_CHUNK_SIZE) {
+      const char *newline = (const char *)memchr(begin + LOAD_DATA_CHUNK_SIZE, '\n',
+                                                 end - begin - LOAD_DATA_CHUNK_SIZE);
+      chunk_end = (newline == nullptr) ? end : newline + 1;
+    }
+    Chunk chunk;
+    chunk.begin = begin;
+    chunk.end = chunk_end;
+    chunks_.push_back(std::move(chunk));
+    begin = chunk_end;
+  }
+}
+
+void *TableLoader::parse_routine(void *arg)
+{
+  TableLoader *loader = (TableLoader *)arg;
+  loader->parse_chunks();
+  return nullptr;
+}
+
+void TableLoader::parse_chunks()
+{
+  MUTEX_LOCK(&mutex_);
+  while (!stop_ && next_chunk_ < chunks_.size()) {
+    // 领先插入太多时等待，控制内存中解析好的记录数量
+    if (next_chunk_ >= inserted_chunks_ + max_pending_chunks_) {
+      COND_WAIT(&cond_, &mutex_);
+      continue;
+    }
+    Chunk &chunk = chunks_[next_chunk_++];
+    MUTEX_UNLOCK(&mutex_);
+
+    parse_chunk(chunk);
+
+    MUTEX_LOCK(&mutex_);
+    chunk.parsed = true;
+    COND_BRAODCAST(&cond_);
+  }
+  MUTEX_UNLOCK(&mutex_);
+}
+
+void TableLoader::parse_chunk(Chunk &chunk)
+{
+  LineContext context;
+  context.values.resize(field_num_);
+  context.buffers.resize(field_num_);
+
+  const char *line_begin = chunk.begin;
+  while (line_begin < chunk.end) {
+    const char *line_end = (const char *)memchr(line_begin, '\n', chunk.end - line_begin);
+    if (nullptr == line_end) {
+      line_end = chunk.end;
+    }
+    const char *next = line_end + 1;
+    chunk.line_count++;
+    if (is_blank(line_begin, line_end)) {
+      line_begin = next;
+      continue;
+    }
+
+    RC rc = parse_line(table_, line_begin, line_end, context, chunk.errmsg);
+    if (rc == RC::SUCCESS) {
+      // vector扩展时新的空间会被清零
+      size_t offset = chunk.records.size();
+      chunk.records.resize(offset + record_size_);
+      rc = table_->fill_record(field_num_, context.values.data(), chunk.records.data() + offset);
+      if (rc != RC::SUCCESS) {
+        chunk.records.resize(offset);
+        chunk.errmsg = "insert failed";
+      }
+    }
+    if (rc != RC::SUCCESS) {
+      chunk.rc = rc;
+      break;
+    }
+    chunk.record_lines.push_back(chunk.line_count);
+    line_begin = next;
+  }
+}
+
+RC TableLoader::insert_chunk(Chunk &chunk, int first_line, std::ostream &result)
+{
+  const int record_num = (int)chunk.record_lines.size();
+  Record records[LOAD_DATA_BATCH_ROWS];
+  for (int begin = 0; begin < record_num; begin += LOAD_DATA_BATCH_ROWS) {
+    const int num = std::min(LOAD_DATA_BATCH_ROWS, record_num - begin);
+    for (int i = 0; i < num; i++) {
+      records[i].data = chunk.records.data() + (size_t)(begin + i) * record_size_;
+    }
+    RC rc = table_->insert_records(nullptr, records, num, !options_.defer_index);
+    if (rc != RC::SUCCESS) {
+      result << "Line:" << first_line + chunk.record_lines[begin] << "-"
+             << first_line + chunk.record_lines[begin + num - 1] << " insert records failed. error:" << strrc(rc)
+             << std::endl;
+      return rc;
+    }
+    if (options_.defer_index) {
+      for (int i = 0; i < num; i++) {
+        deferred_rids_.push_back(records[i].rid);
+      }
+    }
+    insertion_count_ += num;
+  }
+
+  if (chunk.rc != RC::SUCCESS) {
+    result << "Line:" << first_line + chunk.line_count << " insert record failed:" << chunk.errmsg
+           << ". error:" << strrc(chunk.rc) << std::endl;
+  }
+  return chunk.rc;
+}
+
+void TableLoader::release_chunk(Chunk &chunk)
+{
+  std::vector<char>().swap(chunk.records);
+  std::vector<int>().swap(chunk.record_lines);
+
+  // 已经导入的部分不会再访问，从进程的地址空间中释放
+  long page_size = sysconf(_SC_PAGESIZE);
+  size_t release_end = (size_t)(chunk.end - data_) / page_size * page_size;
+  if (release_end > released_size_) {
+    madvise((void *)(data_ + released_size_), release_end - released_size_, MADV_DONTNEED);
+    released_size_ = release_end;
+  }
+}
+
+RC TableLoader::load(const char *file_name, std::ostream &result)
+{
+  common::TraceSpanScope span("storage", "load_data");
+  struct timespec begin_time;
+  clock_gettime(CLOCK_MONOTONIC, &begin_time);
+
+  int fd = open(file_name, O_RDONLY);
+  if (fd < 0) {
+    result << "Failed to open file: " << file_name << ". system error=" << strerror(errno) << std::endl;
+    return RC::CANTOPEN;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    result << "Failed to stat file: " << file_name << ". system error=" << strerror(errno) << std::endl;
+    close(fd);
+    return RC::IOERR_FSTAT;
+  }
+  data_size_ = st.st_size;
+  if (data_size_ > 0) {
+    void *data = mmap(nullptr, data_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == data) {
+      result << "Failed to map file: " << file_name << ". system error=" << strerror(errno) << std::endl;
+      close(fd);
+      return RC::IOERR_MMAP;
+    }
+    data_ = (const char *)data;
+    madvise(data, data_size_, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  split_chunks(data_, data_size_);
+
+  int thread_num = options_.parse_threads;
+  if (thread_num <= 0) {
+    thread_num = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  thread_num = std::max(1, std::min(thread_num, LOAD_DATA_MAX_PARSE_THREADS));
+  thread_num = std::max(1, std::min(thread_num, (int)chunks_.size()));
+  max_pending_chunks_ = (size_t)thread_num * LOAD_DATA_PENDING_CHUNKS_PER_THREAD;
+
+  std::vector<pthread_t> threads;
+  for (int i = 0; i < thread_num && !chunks_.empty(); i++) {
+    pthread_t thread;
+    int ret = pthread_create(&thread, nullptr, parse_routine, this);
+    if (ret != 0) {
+      LOG_WARN("Failed to create load data parse thread. error=%s", strerror(ret));
+      break;
+    }
+    threads.push_back(thread);
+  }
+
+  RC rc = RC::SUCCESS;
+  int line_num = 0;
+  if (threads.empty() && !chunks_.empty()) {
+    result << "Failed to create parse thread." << std::endl;
+    rc = RC::GENERIC_ERROR;
+  }
+
+  // 按照文件中的顺序插入解析好的块
+  for (size_t i = 0; RC::SUCCESS == rc && i < chunks_.size(); i++) {
+    Chunk &chunk = chunks_[i];
+    MUTEX_LOCK(&mutex_);
+    while (!chunk.parsed) {
+      COND_WAIT(&cond_, &mutex_);
+    }
+    MUTEX_UNLOCK(&mutex_);
+
+    rc = insert_chunk(chunk, line_num, result);
+    line_num += chunk.line_count;
+    release_chunk(chunk);
+
+    MUTEX_LOCK(&mutex_);
+    inserted_chunks_ = i + 1;
+    if (rc != RC::SUCCESS) {
+      stop_ = true;
+    }
+    COND_BRAODCAST(&cond_);
+    MUTEX_UNLOCK(&mutex_);
+  }
+
+  for (pthread_t thread : threads) {
+    pthread_join(thread, nullptr);
+  }
+  chunks_.clear();
+  if (data_ != nullptr) {
+    munmap((void *)data_, data_size_);
+    data_ = nullptr;
+  }
+
+  // 出错时已经导入的记录也需要插入索引
+  if (options_.defer_index && !deferred_rids_.empty()) {
+    RC index_rc = table_->build_index_entries(deferred_rids_);
+    if (index_rc != RC::SUCCESS) {
+      result << "Failed to build indexes, " << deferred_rids_.size() << " loaded record(s) removed. error:"
+             << strrc(index_rc) << std::endl;
+      insertion_count_ = 0;
+      if (RC::SUCCESS == rc) {
+        rc = index_rc;
+      }
+    }
+    std::vector<RID>().swap(deferred_rids_);
+  }
+
+  struct timespec end_time;
+  clock_gettime(CLOCK_MONOTONIC, &end_time);
+  long cost_nano = (end_time.tv_sec - begin_time.tv_sec) * 1000000000L + (end_time.tv_nsec - begin_time.tv_nsec);
+  if (RC::SUCCESS == rc) {
+    result << strrc(rc) << ". total " << line_num << " line(s) handled and " << insertion_count_
+           << " record(s) loaded, total cost " << cost_nano / 1000000000.0 << " second(s)" << std::endl;
+  }
+  LOG_INFO("Load data from %s finished. parse threads=%d, lines=%d, records=%d, cost=%ldns, rc=%d:%s",
+           file_name, (int)threads.size(), line_num, insertion_count_, cost_nano, rc, strrc(rc));
+  return rc;
+}
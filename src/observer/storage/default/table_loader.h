@@ -0,0 +1,101 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Pipelined loader for LOAD DATA.
+//
+
+#ifndef __OBSERVER_STORAGE_DEFAULT_TABLE_LOADER_H_
+#define __OBSERVER_STORAGE_DEFAULT_TABLE_LOADER_H_
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "rc.h"
+#include "sql/parser/parse_defs.h"
+#include "storage/common/record_manager.h"
+
+class Table;
+
+#define LOAD_DATA_CHUNK_SIZE (4 * 1024 * 1024)  // 每个解析任务处理的数据量，在行边界切分
+#define LOAD_DATA_BATCH_ROWS 256                // 每批一起插入的行数
+#define LOAD_DATA_MAX_PARSE_THREADS 16          // 解析线程数的上限
+#define LOAD_DATA_PENDING_CHUNKS_PER_THREAD 2   // 每个解析线程最多领先插入几个块
+
+struct TableLoaderOptions {
+  int parse_threads = 0;     // 解析数据的线程数，0表示根据CPU核数决定
+  bool defer_index = false;  // 导入时不更新索引，全部导入之后再一起插入索引项
+};
+
+/**
+ * LOAD DATA使用的流水线：
+ * 1. 文件用mmap映射到内存，按行边界切分成若干块
+ * 2. 多个解析线程并行把块中的每一行解析成记录
+ * 3. 调用线程按照文件中的顺序把解析好的记录批量插入到表中
+ * 解析线程最多领先插入若干个块，导入很大的文件时不会把整个文件的记录都放在内存里。
+ * 遇到第一个错误时停止导入，之前导入的数据保留
+ */
+class TableLoader {
+public:
+  TableLoader(Table *table, const TableLoaderOptions &options);
+  ~TableLoader();
+
+  /**
+   * 导入数据，出错的行和最终的结果写入result
+   */
+  RC load(const char *file_name, std::ostream &result);
+
+private:
+  struct Chunk {
+    const char *begin = nullptr;
+    const char *end = nullptr;
+    bool parsed = false;
+
+    RC rc = RC::SUCCESS;            // 解析的结果，失败时只保留出错的行之前的记录
+    int line_count = 0;             // 已经解析的行数，包括空行和出错的行
+    std::string errmsg;
+    std::vector<char> records;      // 解析好的记录，每条记录record_size_个字节
+    std::vector<int> record_lines;  // 每条记录所在的行在块中的序号，从1开始
+  };
+
+  void split_chunks(const char *data, size_t size);
+  static void *parse_routine(void *arg);
+  void parse_chunks();
+  void parse_chunk(Chunk &chunk);
+  RC insert_chunk(Chunk &chunk, int first_line, std::ostream &result);
+  void release_chunk(Chunk &chunk);
+
+private:
+  Table *table_;
+  TableLoaderOptions options_;
+  int field_num_ = 0;
+  int record_size_ = 0;
+
+  const char *data_ = nullptr;
+  size_t data_size_ = 0;
+  size_t released_size_ = 0;  // 文件映射中已经释放的长度
+
+  std::vector<Chunk> chunks_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+  size_t next_chunk_ = 0;      // 下一个要解析的块
+  size_t inserted_chunks_ = 0;  // 已经插入完成的块数
+  size_t max_pending_chunks_ = 0;
+  bool stop_ = false;
+
+  int insertion_count_ = 0;
+  std::vector<RID> deferred_rids_;  // 延迟插入索引的记录
+};
+
+#endif  // __OBSERVER_STORAGE_DEFAULT_TABLE_LOADER_H_
@@ -0,0 +1,904 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Log-structured merge tree index of lsm tables.
+//
+
+#include "storage/lsm/lsm_index.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+#include "common/log/log.h"
+#include "common/os/path.h"
+
+#define LSM_MANIFEST_MAGIC "lsm"
+
+LsmMergeIterator::LsmMergeIterator(const LsmKeyComparator &comparator)
+    : comparator_(comparator), entry_(comparator.entry_size())
+{}
+
+void LsmMergeIterator::add_entries(std::vector<char> &&entries)
+{
+  sources_.emplace_back();
+  sources_.back().entries = std::move(entries);
+}
+
+void LsmMergeIterator::add_run(std::shared_ptr<LsmRun> run)
+{
+  sources_.emplace_back();
+  sources_.back().cursor.reset(new LsmRunCursor(std::move(run)));
+}
+
+RC LsmMergeIterator::seek(const char *key)
+{
+  for (Source &source : sources_)
+  {
+    if (source.cursor != nullptr)
+    {
+      RC rc = source.cursor->seek(key);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+    }
+  }
+  return RC::SUCCESS;
+}
+
+const char *LsmMergeIterator::current(const Source &source) const
+{
+  if (source.cursor != nullptr)
+  {
+    return source.cursor->current();
+  }
+  return source.pos < source.entries.size() ? source.entries.data() + source.pos : nullptr;
+}
+
+RC LsmMergeIterator::advance(Source &source)
+{
+  if (source.cursor != nullptr)
+  {
+    return source.cursor->next();
+  }
+  source.pos += comparator_.entry_size();
+  return RC::SUCCESS;
+}
+
+RC LsmMergeIterator::next(const char **entry)
+{
+  // 相同的key取最前面的来源，也就是最新的一项
+  const char *smallest = nullptr;
+  for (const Source &source : sources_)
+  {
+    const char *candidate = current(source);
+    if (candidate != nullptr && (smallest == nullptr || comparator_.compare_key(candidate, smallest) < 0))
+    {
+      smallest = candidate;
+    }
+  }
+  if (smallest == nullptr)
+  {
+    return RC::RECORD_EOF;
+  }
+  memcpy(entry_.data(), smallest, entry_.size());
+
+  for (Source &source : sources_)
+  {
+    const char *candidate = current(source);
+    if (candidate != nullptr && comparator_.compare_key(candidate, entry_.data()) == 0)
+    {
+      RC rc = advance(source);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+    }
+  }
+  *entry = entry_.data();
+  return RC::SUCCESS;
+}
+
+LsmIndex::~LsmIndex() noexcept
+{
+  close();
+}
+
+RC LsmIndex::init_comparator(const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas)
+{
+  RC rc = Index::init(index_meta, field_metas);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  std::vector<AttrType> types;
+  std::vector<int> lengths;
+  key_columns(types, lengths);
+  comparator_.init(types, lengths);
+  return RC::SUCCESS;
+}
+
+std::string LsmIndex::wal_path() const
+{
+  return file_name_ + ".wal";
+}
+
+std::string LsmIndex::run_path(int64_t seq) const
+{
+  return file_name_ + "." + std::to_string(seq) + ".run";
+}
+
+RC LsmIndex::create(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas,
+                    int page_size)
+{
+  if (inited_)
+  {
+    return RC::RECORD_OPENNED;
+  }
+  RC rc = init_comparator(index_meta, field_metas);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  int fd = ::open(file_name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd < 0)
+  {
+    LOG_ERROR("Failed to create lsm index file %s. error=%s", file_name, strerror(errno));
+    return errno == EEXIST ? RC::SCHEMA_INDEX_EXIST : RC::IOERR_ACCESS;
+  }
+  ::close(fd);
+
+  file_name_ = file_name;
+  ::unlink(wal_path().c_str());
+  memtable_.reset(new LsmMemTable(comparator_));
+  levels_.assign(1, std::vector<std::shared_ptr<LsmRun>>());
+  next_seq_ = 1;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rc = write_manifest();
+  }
+  if (rc == RC::SUCCESS)
+  {
+    rc = open_wal();
+  }
+  inited_ = rc == RC::SUCCESS;
+  return rc;
+}
+
+RC LsmIndex::open(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas)
+{
+  if (inited_)
+  {
+    return RC::RECORD_OPENNED;
+  }
+  RC rc = init_comparator(index_meta, field_metas);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  file_name_ = file_name;
+  memtable_.reset(new LsmMemTable(comparator_));
+  rc = load_manifest();
+  if (rc != RC::SUCCESS)
+  {
+    levels_.clear();
+    return rc;
+  }
+  remove_orphan_runs();
+  rc = replay_wal();
+  if (rc == RC::SUCCESS)
+  {
+    rc = open_wal();
+  }
+  inited_ = rc == RC::SUCCESS;
+  return rc;
+}
+
+RC LsmIndex::close()
+{
+  if (!inited_)
+  {
+    return RC::SUCCESS;
+  }
+  RC rc;
+  {
+    // 关闭之前写成run，下次打开时不用重放wal
+    std::lock_guard<std::mutex> lock(mutex_);
+    rc = flush_locked();
+  }
+  std::lock_guard<std::mutex> compact_lock(compact_mutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (wal_fd_ >= 0)
+  {
+    ::close(wal_fd_);
+    wal_fd_ = -1;
+  }
+  levels_.clear();
+  memtable_.reset();
+  inited_ = false;
+  return rc;
+}
+
+RC LsmIndex::drop()
+{
+  if (!inited_)
+  {
+    return RC::SUCCESS;
+  }
+  std::lock_guard<std::mutex> compact_lock(compact_mutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (wal_fd_ >= 0)
+  {
+    ::close(wal_fd_);
+    wal_fd_ = -1;
+  }
+  ::unlink(wal_path().c_str());
+  for (auto &level : levels_)
+  {
+    for (auto &run : level)
+    {
+      run->set_obsolete();
+    }
+  }
+  levels_.clear();
+  memtable_.reset();
+  inited_ = false;
+  return RC::SUCCESS;
+}
+
+RC LsmIndex::open_wal()
+{
+  wal_fd_ = ::open(wal_path().c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+  if (wal_fd_ < 0)
+  {
+    LOG_ERROR("Failed to open lsm wal %s. error=%s", wal_path().c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  return RC::SUCCESS;
+}
+
+RC LsmIndex::replay_wal()
+{
+  const std::string path = wal_path();
+  std::ifstream fs(path, std::ios_base::in | std::ios_base::binary);
+  if (!fs.is_open())
+  {
+    return RC::SUCCESS;
+  }
+  const int entry_size = comparator_.entry_size();
+  std::vector<char> entry(entry_size);
+  int64_t count = 0;
+  while (fs.read(entry.data(), entry_size))
+  {
+    memtable_->put(entry.data());
+    count++;
+  }
+  fs.close();
+
+  // 崩溃时最后一项可能只写了一部分，截掉之后再追加
+  if (::truncate(path.c_str(), count * entry_size) != 0)
+  {
+    LOG_ERROR("Failed to truncate lsm wal %s. error=%s", path.c_str(), strerror(errno));
+    return RC::IOERR_TRUNCATE;
+  }
+  if (count > 0)
+  {
+    LOG_INFO("Replayed %ld entries from lsm wal %s", count, path.c_str());
+  }
+  return RC::SUCCESS;
+}
+
+RC LsmIndex::load_manifest()
+{
+  std::ifstream fs(file_name_);
+  std::string magic;
+  int entry_size = 0;
+  if (!fs.is_open() || !(fs >> magic >> entry_size >> next_seq_) || magic != LSM_MANIFEST_MAGIC ||
+      entry_size != comparator_.entry_size())
+  {
+    LOG_ERROR("Invalid lsm index file %s", file_name_.c_str());
+    return RC::IOERR_READ;
+  }
+
+  levels_.assign(1, std::vector<std::shared_ptr<LsmRun>>());
+  int level = 0;
+  int64_t seq = 0;
+  while (fs >> level >> seq)
+  {
+    if (level < 0 || seq >= next_seq_)
+    {
+      LOG_ERROR("Invalid run %d:%ld in lsm index file %s", level, seq, file_name_.c_str());
+      return RC::IOERR_READ;
+    }
+    if ((int)levels_.size() <= level)
+    {
+      levels_.resize(level + 1);
+    }
+    std::shared_ptr<LsmRun> run = std::make_shared<LsmRun>(comparator_, seq, run_path(seq));
+    RC rc = run->open();
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+    levels_[level].push_back(run);
+  }
+  return RC::SUCCESS;
+}
+
+RC LsmIndex::write_manifest()
+{
+  std::stringstream ss;
+  ss << LSM_MANIFEST_MAGIC << " " << comparator_.entry_size() << " " << next_seq_ << "\n";
+  for (size_t level = 0; level < levels_.size(); level++)
+  {
+    for (const auto &run : levels_[level])
+    {
+      ss << level << " " << run->seq() << "\n";
+    }
+  }
+  const std::string content = ss.str();
+
+  // 先写到临时文件再改名，崩溃时manifest要么是旧的要么是新的
+  const std::string tmp_file = file_name_ + ".tmp";
+  int fd = ::open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0)
+  {
+    LOG_ERROR("Failed to create %s. error=%s", tmp_file.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  const bool written = ::write(fd, content.data(), content.size()) == (ssize_t)content.size() && ::fdatasync(fd) == 0;
+  ::close(fd);
+  if (!written || ::rename(tmp_file.c_str(), file_name_.c_str()) != 0)
+  {
+    LOG_ERROR("Failed to write lsm index file %s. error=%s", file_name_.c_str(), strerror(errno));
+    ::unlink(tmp_file.c_str());
+    return RC::IOERR_WRITE;
+  }
+  return RC::SUCCESS;
+}
+
+void LsmIndex::remove_orphan_runs()
+{
+  const size_t slash = file_name_.rfind('/');
+  const std::string dir = slash == std::string::npos ? "." : file_name_.substr(0, slash);
+  const std::string prefix = (slash == std::string::npos ? file_name_ : file_name_.substr(slash + 1)) + ".";
+
+  std::set<std::string> runs;
+  for (const auto &level : levels_)
+  {
+    for (const auto &run : level)
+    {
+      runs.insert(run->path());
+    }
+  }
+  std::vector<std::string> files;
+  common::list_file(dir.c_str(), "\\.run$", files);
+  for (const std::string &file : files)
+  {
+    const std::string path = dir + "/" + file;
+    if (file.compare(0, prefix.size(), prefix) != 0 || runs.count(run_path(atoll(file.c_str() + prefix.size()))) > 0)
+    {
+      continue;
+    }
+    if (::unlink(path.c_str()) == 0)
+    {
+      LOG_INFO("Removed orphan lsm run %s", path.c_str());
+    }
+  }
+}
+
+RC LsmIndex::flush_locked()
+{
+  if (memtable_ == nullptr || memtable_->size() == 0)
+  {
+    return RC::SUCCESS;
+  }
+  const int64_t seq = next_seq_++;
+  const std::string path = run_path(seq);
+  LsmRunWriter writer(comparator_, path, memtable_->size());
+  RC rc = writer.open();
+  for (auto node = memtable_->lower_bound(nullptr); rc == RC::SUCCESS && node != nullptr;
+       node = LsmMemTable::next(node))
+  {
+    rc = writer.append(LsmMemTable::entry(node));
+  }
+  if (rc == RC::SUCCESS)
+  {
+    rc = writer.finish();
+  }
+  std::shared_ptr<LsmRun> run = std::make_shared<LsmRun>(comparator_, seq, path);
+  if (rc == RC::SUCCESS)
+  {
+    rc = run->open();
+  }
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to flush memtable of lsm index %s. rc=%d:%s", file_name_.c_str(), rc, strrc(rc));
+    run->set_obsolete();
+    return rc;
+  }
+
+  levels_[0].insert(levels_[0].begin(), run);
+  rc = write_manifest();
+  if (rc != RC::SUCCESS)
+  {
+    levels_[0].erase(levels_[0].begin());
+    run->set_obsolete();
+    return rc;
+  }
+  // manifest中有了新的run之后wal中的修改不再需要
+  if (::ftruncate(wal_fd_, 0) != 0)
+  {
+    LOG_WARN("Failed to truncate lsm wal %s. error=%s", wal_path().c_str(), strerror(errno));
+  }
+  memtable_.reset(new LsmMemTable(comparator_));
+  return RC::SUCCESS;
+}
+
+void LsmIndex::snapshot(LsmMergeIterator &iterator, const char *low_key, const char *high, int high_column_num,
+                        bool point, uint32_t hash)
+{
+  const int entry_size = comparator_.entry_size();
+  std::vector<char> entries;
+  for (auto node = memtable_->lower_bound(low_key); node != nullptr; node = LsmMemTable::next(node))
+  {
+    const char *entry = LsmMemTable::entry(node);
+    if (high != nullptr && comparator_.compare_attr_prefix(entry, high, high_column_num) > 0)
+    {
+      break;
+    }
+    entries.insert(entries.end(), entry, entry + entry_size);
+  }
+  iterator.add_entries(std::move(entries));
+
+  for (const auto &level : levels_)
+  {
+    for (const auto &run : level)
+    {
+      if (!point || run->may_contain(hash))
+      {
+        iterator.add_run(run);
+      }
+    }
+  }
+}
+
+RC LsmIndex::find_attr(const char *attr, bool *found)
+{
+  *found = false;
+  std::vector<char> low_key(comparator_.key_length());
+  memcpy(low_key.data(), attr, comparator_.attr_length());
+  RID rid;
+  rid.page_num = -1;
+  rid.slot_num = -1;
+  memcpy(low_key.data() + comparator_.attr_length(), &rid, sizeof(rid));
+  // 唯一性只检查key字段，后面的字段从最小值开始找
+  const int column_num = index_meta_.key_field_num();
+  comparator_.fill_columns(low_key.data(), column_num, false);
+
+  LsmMergeIterator iterator(comparator_);
+  snapshot(iterator, low_key.data(), attr, column_num, true, comparator_.hash_first_column(attr));
+  RC rc = iterator.seek(low_key.data());
+  const char *entry = nullptr;
+  while (rc == RC::SUCCESS && (rc = iterator.next(&entry)) == RC::SUCCESS)
+  {
+    if (comparator_.compare_attr_prefix(entry, attr, column_num) != 0)
+    {
+      break;
+    }
+    if (entry[comparator_.key_length()] == 0)
+    {
+      *found = true;
+      break;
+    }
+  }
+  return rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+}
+
+RC LsmIndex::write_entry(const char *key, bool deleted, bool unique)
+{
+  const int key_length = comparator_.key_length();
+  std::vector<char> entry(comparator_.entry_size());
+  memcpy(entry.data(), key, key_length);
+  entry[key_length] = deleted ? 1 : 0;
+
+  bool stall = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!inited_)
+    {
+      return RC::RECORD_CLOSED;
+    }
+    if (unique)
+    {
+      bool found = false;
+      RC rc = find_attr(key, &found);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+      if (found)
+      {
+        return RC::RECORD_DUPLICATE_KEY;
+      }
+    }
+
+    if (::write(wal_fd_, entry.data(), entry.size()) != (ssize_t)entry.size())
+    {
+      LOG_ERROR("Failed to write lsm wal %s. error=%s", wal_path().c_str(), strerror(errno));
+      return RC::IOERR_WRITE;
+    }
+    memtable_->put(entry.data());
+    if (memtable_->bytes() >= lsm_memtable_size())
+    {
+      RC rc = flush_locked();
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+      stall = levels_[0].size() >= LSM_LEVEL0_STOP_RUNS;
+    }
+  }
+  return stall ? compact(false) : RC::SUCCESS;
+}
+
+RC LsmIndex::insert_entry(const char *record, const RID *rid)
+{
+  std::vector<char> key;
+  make_key(record, key);
+  key.insert(key.end(), (const char *)rid, (const char *)rid + sizeof(*rid));
+  return write_entry(key.data(), false, check_unique(record));
+}
+
+RC LsmIndex::delete_entry(const char *record, const RID *rid)
+{
+  std::vector<char> key;
+  make_key(record, key);
+  key.insert(key.end(), (const char *)rid, (const char *)rid + sizeof(*rid));
+  return write_entry(key.data(), true, false);
+}
+
+IndexScanner *LsmIndex::create_scanner(CompOp comp_op, const char *value, int null_field_index)
+{
+  if (index_meta_.prefix_length(0) > 0)
+  {
+    // 前缀相同的值在索引中是相等的，不包含边界会漏掉前缀等于边界的记录
+    comp_op = comp_op == GREAT_THAN ? GREAT_EQUAL : (comp_op == LESS_THAN ? LESS_EQUAL : comp_op);
+  }
+  switch (comp_op)
+  {
+  case EQUAL_TO:
+    return create_range_scanner(value, 1, true, value, 1, true);
+  case GREAT_EQUAL:
+    return create_range_scanner(value, 1, true, nullptr, 0, false);
+  case GREAT_THAN:
+    return create_range_scanner(value, 1, false, nullptr, 0, false);
+  case LESS_EQUAL:
+    return create_range_scanner(nullptr, 0, false, value, 1, true);
+  case LESS_THAN:
+    return create_range_scanner(nullptr, 0, false, value, 1, false);
+  default:
+    return create_range_scanner(nullptr, 0, false, nullptr, 0, false);
+  }
+}
+
+IndexScanner *LsmIndex::create_range_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                             const char *high, int high_column_num, bool high_inclusive)
+{
+  return create_ordered_scanner(low, low_column_num, low_inclusive, high, high_column_num, high_inclusive, false);
+}
+
+IndexScanner *LsmIndex::create_ordered_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                               const char *high, int high_column_num, bool high_inclusive,
+                                               bool descending)
+{
+  if (descending)
+  {
+    return nullptr;
+  }
+  if (low_column_num > 0 && index_meta_.prefix_length(low_column_num - 1) > 0)
+  {
+    low_inclusive = true;
+  }
+  if (high_column_num > 0 && index_meta_.prefix_length(high_column_num - 1) > 0)
+  {
+    high_inclusive = true;
+  }
+  const int column_num = comparator_.column_num();
+  low_column_num = low == nullptr ? 0 : std::min(low_column_num, column_num);
+  high_column_num = high == nullptr ? 0 : std::min(high_column_num, column_num);
+
+  // 和B+树一样，下界配上最小或最大的rid，只指定了前几个字段时剩下的字段填成最小或最大的值
+  std::vector<char> low_key;
+  if (low_column_num > 0)
+  {
+    low_key.resize(comparator_.key_length());
+    comparator_.copy_value(low_key.data(), low, low_column_num);
+    comparator_.fill_columns(low_key.data(), low_column_num, !low_inclusive);
+    RID rid;
+    rid.page_num = low_inclusive ? -1 : INT_MAX;
+    rid.slot_num = low_inclusive ? -1 : INT_MAX;
+    memcpy(low_key.data() + comparator_.attr_length(), &rid, sizeof(rid));
+  }
+  std::vector<char> high_value;
+  if (high_column_num > 0)
+  {
+    high_value.resize(comparator_.attr_length());
+    comparator_.copy_value(high_value.data(), high, high_column_num);
+  }
+  // 上下界的第一个字段相同时，范围内的key第一个字段都是这个值，可以用布隆过滤器跳过run
+  const bool point = !low_key.empty() && !high_value.empty() &&
+                     comparator_.compare_attr_prefix(low_key.data(), high_value.data(), 1) == 0;
+  const char *low_ptr = low_key.empty() ? nullptr : low_key.data();
+
+  std::unique_ptr<LsmMergeIterator> iterator(new LsmMergeIterator(comparator_));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!inited_)
+    {
+      return nullptr;
+    }
+    snapshot(*iterator, low_ptr, high_value.empty() ? nullptr : high_value.data(), high_column_num, point,
+             point ? comparator_.hash_first_column(high_value.data()) : 0);
+  }
+  RC rc = iterator->seek(low_ptr);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to open lsm index scanner. rc=%d:%s", rc, strrc(rc));
+    return nullptr;
+  }
+  return new LsmIndexScanner(comparator_, std::move(iterator), std::move(high_value), high_column_num, high_inclusive);
+}
+
+RC LsmIndex::sync()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (wal_fd_ >= 0 && ::fdatasync(wal_fd_) != 0)
+  {
+    LOG_ERROR("Failed to sync lsm wal %s. error=%s", wal_path().c_str(), strerror(errno));
+    return RC::IOERR_FSYNC;
+  }
+  return RC::SUCCESS;
+}
+
+RC LsmIndex::merge_changes()
+{
+  return compact(true);
+}
+
+RC LsmIndex::flush()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return flush_locked();
+}
+
+std::vector<int> LsmIndex::level_runs()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<int> runs;
+  for (const auto &level : levels_)
+  {
+    runs.push_back((int)level.size());
+  }
+  return runs;
+}
+
+size_t LsmIndex::memtable_entries()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return memtable_ == nullptr ? 0 : memtable_->size();
+}
+
+bool LsmIndex::pick_compaction(bool background, int *level, std::vector<std::shared_ptr<LsmRun>> &inputs)
+{
+  const size_t level0_runs = background ? LSM_LEVEL0_RUNS : LSM_LEVEL0_STOP_RUNS;
+  *level = -1;
+  if (levels_[0].size() >= level0_runs)
+  {
+    *level = 0;
+  }
+  double max_bytes = (double)lsm_memtable_size();
+  for (size_t i = 1; *level < 0 && i < levels_.size(); i++)
+  {
+    max_bytes *= LSM_LEVEL_SIZE_RATIO;
+    double bytes = 0;
+    for (const auto &run : levels_[i])
+    {
+      bytes += (double)run->entry_count() * run->entry_size();
+    }
+    if (bytes > max_bytes)
+    {
+      *level = (int)i;
+    }
+  }
+  if (*level < 0)
+  {
+    return false;
+  }
+
+  if ((int)levels_.size() < *level + 2)
+  {
+    levels_.resize(*level + 2);
+  }
+  inputs = levels_[*level];
+  inputs.insert(inputs.end(), levels_[*level + 1].begin(), levels_[*level + 1].end());
+  return true;
+}
+
+RC LsmIndex::compact(bool background)
+{
+  std::lock_guard<std::mutex> compact_lock(compact_mutex_);
+  while (true)
+  {
+    int level = 0;
+    int64_t seq = 0;
+    bool bottom = true;
+    std::vector<std::shared_ptr<LsmRun>> inputs;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!inited_ || !pick_compaction(background, &level, inputs))
+      {
+        return RC::SUCCESS;
+      }
+      seq = next_seq_++;
+      for (size_t i = level + 2; i < levels_.size(); i++)
+      {
+        bottom = bottom && levels_[i].empty();
+      }
+    }
+
+    // 输入的run不会再修改，合并时不用持有mutex_
+    LsmMergeIterator iterator(comparator_);
+    int64_t entry_count = 0;
+    for (const auto &run : inputs)
+    {
+      iterator.add_run(run);
+      entry_count += run->entry_count();
+    }
+    const std::string path = run_path(seq);
+    LsmRunWriter writer(comparator_, path, entry_count);
+    RC rc = writer.open();
+    if (rc == RC::SUCCESS)
+    {
+      rc = iterator.seek(nullptr);
+    }
+    const char *entry = nullptr;
+    while (rc == RC::SUCCESS && (rc = iterator.next(&entry)) == RC::SUCCESS)
+    {
+      // 下面没有更旧的项时删除标记不用保留
+      if (bottom && entry[comparator_.key_length()] != 0)
+      {
+        continue;
+      }
+      rc = writer.append(entry);
+    }
+    if (rc == RC::RECORD_EOF)
+    {
+      rc = writer.finish();
+    }
+    std::shared_ptr<LsmRun> output = std::make_shared<LsmRun>(comparator_, seq, path);
+    if (rc == RC::SUCCESS && writer.entry_count() > 0)
+    {
+      rc = output->open();
+    }
+    if (rc != RC::SUCCESS || writer.entry_count() == 0)
+    {
+      // 全是删除标记时合并结果为空，不需要这个run
+      output->set_obsolete();
+    }
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to compact level %d of lsm index %s. rc=%d:%s", level, file_name_.c_str(), rc, strrc(rc));
+      return rc;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::vector<std::shared_ptr<LsmRun>>> old_levels = levels_;
+    for (int i = level; i <= level + 1; i++)
+    {
+      auto &runs = levels_[i];
+      runs.erase(std::remove_if(runs.begin(), runs.end(),
+                                [&inputs](const std::shared_ptr<LsmRun> &run)
+                                { return std::find(inputs.begin(), inputs.end(), run) != inputs.end(); }),
+                 runs.end());
+    }
+    if (writer.entry_count() > 0)
+    {
+      levels_[level + 1].push_back(output);
+    }
+    rc = write_manifest();
+    if (rc != RC::SUCCESS)
+    {
+      levels_.swap(old_levels);
+      output->set_obsolete();
+      return rc;
+    }
+    for (const auto &run : inputs)
+    {
+      run->set_obsolete();
+    }
+    LOG_INFO("Compacted %d runs of level %d into level %d. index=%s, entries=%ld",
+             (int)inputs.size(), level, level + 1, file_name_.c_str(), writer.entry_count());
+  }
+}
+
+LsmIndexScanner::LsmIndexScanner(const LsmKeyComparator &comparator, std::unique_ptr<LsmMergeIterator> iterator,
+                                 std::vector<char> &&high, int high_column_num, bool high_inclusive)
+    : comparator_(comparator), iterator_(std::move(iterator)), high_(std::move(high)),
+      high_column_num_(high_column_num), high_inclusive_(high_inclusive)
+{}
+
+RC LsmIndexScanner::next_entry(RID *rid)
+{
+  return next_entry(rid, nullptr);
+}
+
+RC LsmIndexScanner::next_entry(RID *rid, char *key)
+{
+  const char *entry = nullptr;
+  RC rc;
+  while ((rc = iterator_->next(&entry)) == RC::SUCCESS)
+  {
+    if (!high_.empty())
+    {
+      int result = comparator_.compare_attr_prefix(entry, high_.data(), high_column_num_);
+      if (result > 0 || (result == 0 && !high_inclusive_))
+      {
+        return RC::RECORD_EOF;
+      }
+    }
+    if (entry[comparator_.key_length()] != 0)
+    {
+      continue;
+    }
+    memcpy(rid, entry + comparator_.attr_length(), sizeof(RID));
+    if (key != nullptr)
+    {
+      memcpy(key, entry, comparator_.attr_length());
+    }
+    return RC::SUCCESS;
+  }
+  return rc;
+}
+
+RC LsmIndexScanner::destroy()
+{
+  delete this;
+  return RC::SUCCESS;
+}
+
+static size_t global_lsm_memtable_size = LSM_DEFAULT_MEMTABLE_SIZE;
+
+RC set_lsm_memtable_size(size_t bytes)
+{
+  if (bytes == 0)
+  {
+    LOG_ERROR("Invalid lsm memtable size %lu", bytes);
+    return RC::INVALID_ARGUMENT;
+  }
+  global_lsm_memtable_size = bytes;
+  return RC::SUCCESS;
+}
+
+size_t lsm_memtable_size()
+{
+  return global_lsm_memtable_size;
+}
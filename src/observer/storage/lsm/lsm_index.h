@@ -0,0 +1,192 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Log-structured merge tree index of lsm tables.
+//
+
+#ifndef __OBSERVER_STORAGE_LSM_LSM_INDEX_H_
+#define __OBSERVER_STORAGE_LSM_LSM_INDEX_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "storage/common/index.h"
+#include "storage/lsm/lsm_memtable.h"
+#include "storage/lsm/lsm_run.h"
+
+#define LSM_DEFAULT_MEMTABLE_SIZE (4 * 1024 * 1024)
+#define LSM_LEVEL0_RUNS 4         // level 0的run达到这个数时，后台整理时合并到level 1
+#define LSM_LEVEL0_STOP_RUNS 12   // 达到这个数时由写入的线程合并，限制查找时要读的run数
+#define LSM_LEVEL_SIZE_RATIO 10   // level n最多是memtable大小的LSM_LEVEL_SIZE_RATIO的n次方倍
+
+/**
+ * 按key的顺序合并memtable和各个run，同一个key只返回最新的一项。
+ * 来源按从新到旧的顺序加入：memtable中复制出来的项、level 0从新到旧的run、level 1、level 2...
+ */
+class LsmMergeIterator {
+public:
+  explicit LsmMergeIterator(const LsmKeyComparator &comparator);
+
+  /**
+   * entries是按key排好序的项，第一个加入的来源最新
+   */
+  void add_entries(std::vector<char> &&entries);
+  void add_run(std::shared_ptr<LsmRun> run);
+  /**
+   * 各个run定位到第一个不小于key的项，key为nullptr时从头开始。memtable的项由调用者按同样的范围复制
+   */
+  RC seek(const char *key);
+  /**
+   * 下一项，包括删除标记为1的项，调用者在范围之内跳过它们。没有时返回RECORD_EOF
+   */
+  RC next(const char **entry);
+
+private:
+  struct Source {
+    std::vector<char> entries;
+    size_t pos = 0;
+    std::unique_ptr<LsmRunCursor> cursor;
+  };
+  const char *current(const Source &source) const;
+  RC advance(Source &source);
+
+private:
+  const LsmKeyComparator &comparator_;
+  std::vector<Source> sources_;
+  std::vector<char> entry_;
+};
+
+/**
+ * lsm表的索引。修改先追加到wal文件，再写到内存中的跳表，跳表超过lsm_memtable_size时按顺序写成level 0的run，
+ * 不会像B+树那样随机地修改页面。删除写入一个删除标记，不检查key是否存在。
+ * level 0的run之间key有重叠，其它每层只有一个run。level 0的run太多或者某一层太大时和下一层合并成一个新的run，
+ * 合并到最下面一层时去掉删除标记。后台整理(merge_changes)时合并，level 0超过LSM_LEVEL0_STOP_RUNS时由写入的线程合并。
+ * 索引文件本身是manifest，记录每层有哪些run；run和wal的文件名是索引文件名加上后缀。
+ * wal每次修改只write不fsync，进程崩溃时不丢失，sync时才刷盘
+ */
+class LsmIndex : public Index {
+public:
+  LsmIndex() = default;
+  ~LsmIndex() noexcept override;
+
+  RC create(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas,
+            int page_size = 0) override;
+  RC open(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas) override;
+  RC close();
+  /**
+   * 删除wal和所有的run，manifest由调用者删除
+   */
+  RC drop() override;
+
+  RC insert_entry(const char *record, const RID *rid) override;
+  RC delete_entry(const char *record, const RID *rid) override;
+
+  IndexScanner *create_scanner(CompOp comp_op, const char *value, int null_field_index) override;
+  IndexScanner *create_range_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                     const char *high, int high_column_num, bool high_inclusive) override;
+  /**
+   * 只支持从小到大的顺序，descending为true时返回nullptr
+   */
+  IndexScanner *create_ordered_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                       const char *high, int high_column_num, bool high_inclusive,
+                                       bool descending) override;
+
+  RC sync() override;
+  /**
+   * 合并level 0和超过大小的层
+   */
+  RC merge_changes() override;
+
+  /**
+   * 把memtable写成level 0的run
+   */
+  RC flush();
+  /**
+   * 每层的run个数，下标是层号
+   */
+  std::vector<int> level_runs();
+  size_t memtable_entries();
+
+private:
+  RC init_comparator(const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas);
+  std::string wal_path() const;
+  std::string run_path(int64_t seq) const;
+  RC open_wal();
+  RC replay_wal();
+  RC load_manifest();
+  /**
+   * 删除manifest中没有的run文件，它们是写了一半的run或者合并之后没来得及删除的run
+   */
+  void remove_orphan_runs();
+
+  /**
+   * 以下函数的调用者持有mutex_
+   */
+  RC write_manifest();
+  RC flush_locked();
+  /**
+   * 复制memtable中从low_key开始的项，high不为nullptr时到前high_column_num个字段大于high为止。
+   * 加入布隆过滤器中可能有hash的run，point为false时加入所有的run
+   */
+  void snapshot(LsmMergeIterator &iterator, const char *low_key, const char *high, int high_column_num, bool point,
+                uint32_t hash);
+  RC find_attr(const char *attr, bool *found);
+
+  RC write_entry(const char *key, bool deleted, bool unique);
+  /**
+   * 合并需要合并的层，同时只有一个线程合并。background为false时只在level 0达到LSM_LEVEL0_STOP_RUNS时合并level 0
+   */
+  RC compact(bool background);
+  /**
+   * 选出一次合并的输入，持有mutex_
+   */
+  bool pick_compaction(bool background, int *level, std::vector<std::shared_ptr<LsmRun>> &inputs);
+
+private:
+  bool inited_ = false;
+  std::string file_name_;
+  LsmKeyComparator comparator_;
+
+  std::mutex mutex_;          // 保护memtable_、levels_、wal和manifest
+  std::mutex compact_mutex_;  // 同时只有一个合并
+  std::unique_ptr<LsmMemTable> memtable_;
+  std::vector<std::vector<std::shared_ptr<LsmRun>>> levels_;  // level 0从新到旧
+  int wal_fd_ = -1;
+  int64_t next_seq_ = 1;
+};
+
+class LsmIndexScanner : public IndexScanner {
+public:
+  LsmIndexScanner(const LsmKeyComparator &comparator, std::unique_ptr<LsmMergeIterator> iterator,
+                  std::vector<char> &&high, int high_column_num, bool high_inclusive);
+  ~LsmIndexScanner() noexcept override = default;
+
+  RC next_entry(RID *rid) override;
+  RC next_entry(RID *rid, char *key) override;
+  RC destroy() override;
+
+private:
+  const LsmKeyComparator &comparator_;
+  std::unique_ptr<LsmMergeIterator> iterator_;
+  std::vector<char> high_;
+  int high_column_num_;
+  bool high_inclusive_;
+};
+
+/**
+ * memtable最多占用的内存，超过之后写成level 0的run
+ */
+RC set_lsm_memtable_size(size_t bytes);
+size_t lsm_memtable_size();
+
+#endif  // __OBSERVER_STORAGE_LSM_LSM_INDEX_H_
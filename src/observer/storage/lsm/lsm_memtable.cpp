@@ -0,0 +1,261 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Key comparator and skiplist memtable of LSM indexes.
+//
+
+#include "storage/lsm/lsm_memtable.h"
+
+#include <float.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+int float_compare(float f1, float f2);
+
+void LsmKeyComparator::init(const std::vector<AttrType> &types, const std::vector<int> &lengths)
+{
+  columns_.clear();
+  attr_length_ = 0;
+  for (size_t i = 0; i < types.size(); i++)
+  {
+    columns_.push_back(IndexKeyColumn{types[i], attr_length_, lengths[i]});
+    attr_length_ += lengths[i];
+  }
+}
+
+static int compare_column(const IndexKeyColumn &column, const char *v1, const char *v2)
+{
+  switch (column.type)
+  {
+  case INTS:
+  case DATES:
+  {
+    int i1 = *(const int *)v1;
+    int i2 = *(const int *)v2;
+    return i1 > i2 ? 1 : (i1 < i2 ? -1 : 0);
+  }
+  case FLOATS:
+    return float_compare(*(const float *)v1, *(const float *)v2);
+  default:
+    return strncmp(v1, v2, column.length);
+  }
+}
+
+int LsmKeyComparator::compare_key(const char *key1, const char *key2) const
+{
+  int result = compare_attr_prefix(key1, key2, (int)columns_.size());
+  if (result != 0)
+  {
+    return result;
+  }
+  const RID *rid1 = (const RID *)(key1 + attr_length_);
+  const RID *rid2 = (const RID *)(key2 + attr_length_);
+  if (rid1->page_num != rid2->page_num)
+  {
+    return rid1->page_num > rid2->page_num ? 1 : -1;
+  }
+  if (rid1->slot_num != rid2->slot_num)
+  {
+    return rid1->slot_num > rid2->slot_num ? 1 : -1;
+  }
+  return 0;
+}
+
+int LsmKeyComparator::compare_attr_prefix(const char *value1, const char *value2, int column_num) const
+{
+  for (int i = 0; i < column_num && i < (int)columns_.size(); i++)
+  {
+    const IndexKeyColumn &column = columns_[i];
+    int result = compare_column(column, value1 + column.offset, value2 + column.offset);
+    if (result != 0)
+    {
+      return result;
+    }
+  }
+  return 0;
+}
+
+void LsmKeyComparator::copy_value(char *dest, const char *value, int column_num) const
+{
+  for (int i = 0; i < column_num && i < (int)columns_.size(); i++)
+  {
+    const IndexKeyColumn &column = columns_[i];
+    if (column.type == CHARS)
+    {
+      memset(dest + column.offset, 0, column.length);
+      strncpy(dest + column.offset, value + column.offset, column.length);
+    }
+    else
+    {
+      memcpy(dest + column.offset, value + column.offset, column.length);
+    }
+  }
+}
+
+void LsmKeyComparator::fill_columns(char *value, int from_column, bool max_value) const
+{
+  for (int i = from_column; i < (int)columns_.size(); i++)
+  {
+    const IndexKeyColumn &column = columns_[i];
+    char *data = value + column.offset;
+    switch (column.type)
+    {
+    case INTS:
+    case DATES:
+    {
+      int v = max_value ? INT_MAX : INT_MIN;
+      memcpy(data, &v, sizeof(v));
+    }
+    break;
+    case FLOATS:
+    {
+      float v = max_value ? FLT_MAX : -FLT_MAX;
+      memcpy(data, &v, sizeof(v));
+    }
+    break;
+    default:
+      memset(data, max_value ? 0xFF : 0, column.length);
+      break;
+    }
+  }
+}
+
+uint32_t LsmKeyComparator::hash_first_column(const char *value) const
+{
+  // FNV-1a，字符串只计算结束符之前的部分
+  const IndexKeyColumn &column = columns_[0];
+  const int length = column.type == CHARS ? (int)strnlen(value, column.length) : column.length;
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < length; i++)
+  {
+    hash ^= (uint8_t)value[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * next有height个，节点的内容跟在next后面
+ */
+struct LsmMemTable::Node {
+  int height;
+  Node *next[1];
+};
+
+static size_t node_size(int height, int entry_size)
+{
+  return sizeof(LsmMemTable::Node) + (height - 1) * sizeof(LsmMemTable::Node *) + entry_size;
+}
+
+LsmMemTable::LsmMemTable(const LsmKeyComparator &comparator) : comparator_(comparator)
+{
+  head_ = (Node *)calloc(1, node_size(LSM_SKIPLIST_MAX_HEIGHT, 0));
+  head_->height = LSM_SKIPLIST_MAX_HEIGHT;
+}
+
+LsmMemTable::~LsmMemTable()
+{
+  Node *node = head_;
+  while (node != nullptr)
+  {
+    Node *next = node->next[0];
+    free(node);
+    node = next;
+  }
+}
+
+const char *LsmMemTable::entry(const Node *node)
+{
+  return (const char *)&node->next[node->height];
+}
+
+const LsmMemTable::Node *LsmMemTable::next(const Node *node)
+{
+  return node->next[0];
+}
+
+int LsmMemTable::random_height()
+{
+  // xorshift，每层以1/4的概率继续往上
+  int height = 1;
+  while (height < LSM_SKIPLIST_MAX_HEIGHT)
+  {
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 17;
+    random_state_ ^= random_state_ << 5;
+    if ((random_state_ & 3) != 0)
+    {
+      break;
+    }
+    height++;
+  }
+  return height;
+}
+
+LsmMemTable::Node *LsmMemTable::find_prev(const char *key, Node **prev) const
+{
+  Node *node = head_;
+  for (int level = height_ - 1; level >= 0; level--)
+  {
+    while (node->next[level] != nullptr && comparator_.compare_key(entry(node->next[level]), key) < 0)
+    {
+      node = node->next[level];
+    }
+    if (prev != nullptr)
+    {
+      prev[level] = node;
+    }
+  }
+  return node->next[0];
+}
+
+void LsmMemTable::put(const char *new_entry)
+{
+  const int entry_size = comparator_.entry_size();
+  Node *prev[LSM_SKIPLIST_MAX_HEIGHT];
+  Node *node = find_prev(new_entry, prev);
+  if (node != nullptr && comparator_.compare_key(entry(node), new_entry) == 0)
+  {
+    memcpy((char *)entry(node), new_entry, entry_size);
+    return;
+  }
+
+  const int height = random_height();
+  for (int level = height_; level < height; level++)
+  {
+    prev[level] = head_;
+  }
+  height_ = std::max(height_, height);
+
+  const size_t size = node_size(height, entry_size);
+  node = (Node *)malloc(size);
+  node->height = height;
+  memcpy((char *)entry(node), new_entry, entry_size);
+  for (int level = 0; level < height; level++)
+  {
+    node->next[level] = prev[level]->next[level];
+    prev[level]->next[level] = node;
+  }
+  size_++;
+  bytes_ += size;
+}
+
+const LsmMemTable::Node *LsmMemTable::lower_bound(const char *key) const
+{
+  if (key == nullptr)
+  {
+    return head_->next[0];
+  }
+  return find_prev(key, nullptr);
+}
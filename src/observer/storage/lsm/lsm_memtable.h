@@ -0,0 +1,128 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Key comparator and skiplist memtable of LSM indexes.
+//
+
+#ifndef __OBSERVER_STORAGE_LSM_LSM_MEMTABLE_H_
+#define __OBSERVER_STORAGE_LSM_LSM_MEMTABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "storage/common/bplus_tree.h"
+
+#define LSM_SKIPLIST_MAX_HEIGHT 12  // 跳表的最大层数，每往上一层节点数约为四分之一
+
+/**
+ * LSM索引中的一项是key后面跟着一个字节的删除标记，key和B+树一样是属性值后面跟着rid。
+ * 同一个key只保留最新的一项，删除标记为1时表示这个key已经被删除
+ */
+class LsmKeyComparator {
+public:
+  void init(const std::vector<AttrType> &types, const std::vector<int> &lengths);
+
+  int attr_length() const
+  {
+    return attr_length_;
+  }
+  int key_length() const
+  {
+    return attr_length_ + (int)sizeof(RID);
+  }
+  int entry_size() const
+  {
+    return key_length() + 1;
+  }
+  int column_num() const
+  {
+    return (int)columns_.size();
+  }
+
+  /**
+   * 比较两个完整的key，属性值相同时比较rid
+   */
+  int compare_key(const char *key1, const char *key2) const;
+  /**
+   * 只比较前column_num个字段
+   */
+  int compare_attr_prefix(const char *value1, const char *value2, int column_num) const;
+  /**
+   * 复制条件中前column_num个字段的值，条件中的字符串可能比字段短
+   */
+  void copy_value(char *dest, const char *value, int column_num) const;
+  /**
+   * 把从from_column开始的字段填成最小或最大值，用来定位只指定了前几个字段的边界
+   */
+  void fill_columns(char *value, int from_column, bool max_value) const;
+  /**
+   * 第一个字段的哈希值，run的布隆过滤器按第一个字段建立，第一个字段的等值查找可以跳过不包含它的run
+   */
+  uint32_t hash_first_column(const char *value) const;
+
+private:
+  std::vector<IndexKeyColumn> columns_;
+  int attr_length_ = 0;
+};
+
+/**
+ * 内存中的有序表，用跳表保存最近的修改。同一个key再次写入时覆盖原来的删除标记。
+ * 节点只在整个表销毁时释放，不加锁，由LsmIndex的互斥量保护
+ */
+class LsmMemTable {
+public:
+  struct Node;
+
+  explicit LsmMemTable(const LsmKeyComparator &comparator);
+  ~LsmMemTable();
+
+  /**
+   * entry是key加删除标记
+   */
+  void put(const char *entry);
+  /**
+   * 第一个不小于key的节点，key为nullptr时是第一个节点，没有时返回nullptr
+   */
+  const Node *lower_bound(const char *key) const;
+  static const Node *next(const Node *node);
+  static const char *entry(const Node *node);
+
+  size_t size() const
+  {
+    return size_;
+  }
+  /**
+   * 节点占用的内存，超过LsmIndex的限制时写成level 0的run
+   */
+  size_t bytes() const
+  {
+    return bytes_;
+  }
+
+private:
+  /**
+   * 每一层中最后一个小于key的节点，没有时是头节点
+   */
+  Node *find_prev(const char *key, Node **prev) const;
+  int random_height();
+
+private:
+  const LsmKeyComparator &comparator_;
+  Node *head_ = nullptr;
+  int height_ = 1;
+  size_t size_ = 0;
+  size_t bytes_ = 0;
+  uint32_t random_state_ = 0x9e3779b9;
+};
+
+#endif  // __OBSERVER_STORAGE_LSM_LSM_MEMTABLE_H_
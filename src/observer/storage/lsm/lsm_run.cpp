@@ -0,0 +1,297 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Immutable sorted runs of LSM indexes.
+//
+
+#include "storage/lsm/lsm_run.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "common/log/log.h"
+
+#define LSM_RUN_MAGIC 0x4C534D52  // "LSMR"
+
+static RC read_fully(int fd, void *buf, size_t size, int64_t offset)
+{
+  size_t done = 0;
+  while (done < size)
+  {
+    ssize_t ret = ::pread(fd, (char *)buf + done, size - done, offset + done);
+    if (ret < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (ret <= 0)
+    {
+      return ret == 0 ? RC::IOERR_SHORT_READ : RC::IOERR_READ;
+    }
+    done += ret;
+  }
+  return RC::SUCCESS;
+}
+
+static RC write_fully(int fd, const void *buf, size_t size, int64_t offset)
+{
+  size_t done = 0;
+  while (done < size)
+  {
+    ssize_t ret = ::pwrite(fd, (const char *)buf + done, size - done, offset + done);
+    if (ret < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (ret < 0)
+    {
+      return RC::IOERR_WRITE;
+    }
+    done += ret;
+  }
+  return RC::SUCCESS;
+}
+
+LsmRun::LsmRun(const LsmKeyComparator &comparator, int64_t seq, const std::string &path)
+    : comparator_(comparator), seq_(seq), path_(path)
+{}
+
+LsmRun::~LsmRun()
+{
+  if (fd_ >= 0)
+  {
+    ::close(fd_);
+  }
+  if (obsolete_ && ::unlink(path_.c_str()) != 0 && errno != ENOENT)
+  {
+    LOG_WARN("Failed to remove obsolete lsm run %s. error=%s", path_.c_str(), strerror(errno));
+  }
+}
+
+RC LsmRun::open()
+{
+  fd_ = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0)
+  {
+    LOG_ERROR("Failed to open lsm run %s. error=%s", path_.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  RC rc = read_fully(fd_, &header_, sizeof(header_), 0);
+  if (rc != RC::SUCCESS || header_.magic != LSM_RUN_MAGIC || header_.entry_size != comparator_.entry_size() ||
+      header_.entry_count < 0 || header_.bloom_words <= 0 || header_.fence_count < 0)
+  {
+    LOG_ERROR("Invalid lsm run %s. rc=%d:%s", path_.c_str(), rc, strrc(rc));
+    return rc != RC::SUCCESS ? rc : RC::IOERR_READ;
+  }
+
+  bloom_ = BloomFilter(header_.bloom_words * 64);
+  rc = read_fully(fd_, bloom_.words().data(), header_.bloom_words * sizeof(uint64_t), sizeof(header_));
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  data_offset_ = sizeof(header_) + header_.bloom_words * sizeof(uint64_t);
+  fences_.resize((size_t)header_.fence_count * comparator_.key_length());
+  return read_fully(fd_, fences_.data(), fences_.size(), data_offset_ + header_.entry_count * header_.entry_size);
+}
+
+RC LsmRun::read_entries(int64_t pos, int count, char *buffer, int *read_count) const
+{
+  count = (int)std::min<int64_t>(count, header_.entry_count - pos);
+  *read_count = std::max(count, 0);
+  if (count <= 0)
+  {
+    return RC::SUCCESS;
+  }
+  return read_fully(fd_, buffer, (size_t)count * header_.entry_size, data_offset_ + pos * header_.entry_size);
+}
+
+RC LsmRun::lower_bound(const char *key, int64_t *pos) const
+{
+  // 第一个大于key的fence，它前面的那一段里才可能有第一个不小于key的项
+  const int key_length = comparator_.key_length();
+  int low = 0;
+  int high = header_.fence_count;
+  while (low < high)
+  {
+    int mid = low + (high - low) / 2;
+    if (comparator_.compare_key(fences_.data() + (size_t)mid * key_length, key) <= 0)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+  if (low == 0)
+  {
+    *pos = 0;
+    return RC::SUCCESS;
+  }
+
+  const int64_t start = (int64_t)(low - 1) * LSM_RUN_FENCE_ENTRIES;
+  std::vector<char> block((size_t)LSM_RUN_FENCE_ENTRIES * header_.entry_size);
+  int count = 0;
+  RC rc = read_entries(start, LSM_RUN_FENCE_ENTRIES, block.data(), &count);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  int first = 0;
+  int last = count;
+  while (first < last)
+  {
+    int mid = first + (last - first) / 2;
+    if (comparator_.compare_key(block.data() + (size_t)mid * header_.entry_size, key) < 0)
+    {
+      first = mid + 1;
+    }
+    else
+    {
+      last = mid;
+    }
+  }
+  *pos = start + first;
+  return RC::SUCCESS;
+}
+
+static int bloom_bit_num(int64_t entry_count)
+{
+  int64_t bits = std::max<int64_t>(entry_count * LSM_RUN_BLOOM_BITS_PER_KEY, 64);
+  bits = std::min<int64_t>(bits, (int64_t)1 << 31);
+  return (int)((bits + 63) / 64 * 64);
+}
+
+LsmRunWriter::LsmRunWriter(const LsmKeyComparator &comparator, const std::string &path, int64_t entry_count_hint)
+    : comparator_(comparator), path_(path), bloom_(bloom_bit_num(entry_count_hint))
+{}
+
+LsmRunWriter::~LsmRunWriter()
+{
+  if (fd_ >= 0)
+  {
+    ::close(fd_);
+  }
+}
+
+RC LsmRunWriter::open()
+{
+  fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd_ < 0)
+  {
+    LOG_ERROR("Failed to create lsm run %s. error=%s", path_.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+  offset_ = sizeof(LsmRun::Header) + bloom_.words().size() * sizeof(uint64_t);
+  buffer_.reserve(LSM_RUN_WRITE_BUFFER);
+  return RC::SUCCESS;
+}
+
+RC LsmRunWriter::append(const char *entry)
+{
+  const int entry_size = comparator_.entry_size();
+  if (entry_count_ % LSM_RUN_FENCE_ENTRIES == 0)
+  {
+    fences_.insert(fences_.end(), entry, entry + comparator_.key_length());
+  }
+  bloom_.add(comparator_.hash_first_column(entry));
+  buffer_.insert(buffer_.end(), entry, entry + entry_size);
+  entry_count_++;
+  if (buffer_.size() + entry_size > LSM_RUN_WRITE_BUFFER)
+  {
+    return write_buffer();
+  }
+  return RC::SUCCESS;
+}
+
+RC LsmRunWriter::write_buffer()
+{
+  RC rc = write_fully(fd_, buffer_.data(), buffer_.size(), offset_);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to write lsm run %s. error=%s", path_.c_str(), strerror(errno));
+    return rc;
+  }
+  offset_ += buffer_.size();
+  buffer_.clear();
+  return RC::SUCCESS;
+}
+
+RC LsmRunWriter::finish()
+{
+  RC rc = write_buffer();
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  LsmRun::Header header;
+  header.magic = LSM_RUN_MAGIC;
+  header.entry_size = comparator_.entry_size();
+  header.entry_count = entry_count_;
+  header.bloom_words = (int32_t)bloom_.words().size();
+  header.fence_count = (int32_t)(fences_.size() / comparator_.key_length());
+  if ((rc = write_fully(fd_, fences_.data(), fences_.size(), offset_)) != RC::SUCCESS ||
+      (rc = write_fully(fd_, &header, sizeof(header), 0)) != RC::SUCCESS ||
+      (rc = write_fully(fd_, bloom_.words().data(), bloom_.words().size() * sizeof(uint64_t), sizeof(header))) !=
+          RC::SUCCESS)
+  {
+    LOG_ERROR("Failed to write lsm run %s. error=%s", path_.c_str(), strerror(errno));
+    return rc;
+  }
+  if (::fdatasync(fd_) != 0)
+  {
+    LOG_ERROR("Failed to sync lsm run %s. error=%s", path_.c_str(), strerror(errno));
+    return RC::IOERR_FSYNC;
+  }
+  ::close(fd_);
+  fd_ = -1;
+  return RC::SUCCESS;
+}
+
+LsmRunCursor::LsmRunCursor(std::shared_ptr<LsmRun> run)
+    : run_(std::move(run)), entry_size_(run_->entry_size()),
+      buffer_((size_t)LSM_RUN_READ_ENTRIES * entry_size_)
+{}
+
+RC LsmRunCursor::seek(const char *key)
+{
+  pos_ = 0;
+  if (key != nullptr)
+  {
+    RC rc = run_->lower_bound(key, &pos_);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+  return fill();
+}
+
+RC LsmRunCursor::fill()
+{
+  buffer_pos_ = 0;
+  return run_->read_entries(pos_, LSM_RUN_READ_ENTRIES, buffer_.data(), &buffer_count_);
+}
+
+RC LsmRunCursor::next()
+{
+  buffer_pos_++;
+  if (buffer_pos_ < buffer_count_ || buffer_count_ < LSM_RUN_READ_ENTRIES)
+  {
+    return RC::SUCCESS;
+  }
+  pos_ += buffer_count_;
+  return fill();
+}
@@ -0,0 +1,167 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Immutable sorted runs of LSM indexes.
+//
+
+#ifndef __OBSERVER_STORAGE_LSM_LSM_RUN_H_
+#define __OBSERVER_STORAGE_LSM_LSM_RUN_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rc.h"
+#include "storage/common/bloom_filter.h"
+#include "storage/lsm/lsm_memtable.h"
+
+#define LSM_RUN_FENCE_ENTRIES 128      // 每隔这么多项在内存中记一个key，查找时只读一段
+#define LSM_RUN_READ_ENTRIES 256       // 扫描时一次读出的项数
+#define LSM_RUN_BLOOM_BITS_PER_KEY 10  // 布隆过滤器每项的位数，误判率约为1%
+#define LSM_RUN_WRITE_BUFFER (64 * 1024)
+
+/**
+ * 磁盘上有序、不再修改的一组索引项，memtable写满或者合并时生成。
+ * 文件依次是文件头、布隆过滤器、按key排好序的定长项、每LSM_RUN_FENCE_ENTRIES项中第一项的key。
+ * 打开时把文件头、布隆过滤器和这些key读到内存中，查找时先在内存中定位，再读出一段项。
+ * 合并之后不再使用的run标记为obsolete，最后一个引用释放时删除文件，正在扫描的run不受影响
+ */
+class LsmRun {
+public:
+  struct Header {
+    uint32_t magic;
+    int32_t entry_size;
+    int64_t entry_count;
+    int32_t bloom_words;
+    int32_t fence_count;
+  };
+
+  LsmRun(const LsmKeyComparator &comparator, int64_t seq, const std::string &path);
+  ~LsmRun();
+
+  RC open();
+
+  int64_t seq() const
+  {
+    return seq_;
+  }
+  int64_t entry_count() const
+  {
+    return header_.entry_count;
+  }
+  int entry_size() const
+  {
+    return header_.entry_size;
+  }
+  const std::string &path() const
+  {
+    return path_;
+  }
+  bool may_contain(uint32_t hash) const
+  {
+    return bloom_.may_contain(hash);
+  }
+  void set_obsolete()
+  {
+    obsolete_ = true;
+  }
+
+  /**
+   * 第一个不小于key的项的位置，都小于key时是entry_count
+   */
+  RC lower_bound(const char *key, int64_t *pos) const;
+  /**
+   * 从pos开始读出最多count项，实际读出的项数放在read_count中
+   */
+  RC read_entries(int64_t pos, int count, char *buffer, int *read_count) const;
+
+private:
+  const LsmKeyComparator &comparator_;
+  int64_t seq_;
+  std::string path_;
+  int fd_ = -1;
+  Header header_{};
+  int64_t data_offset_ = 0;
+  BloomFilter bloom_{64};
+  std::vector<char> fences_;
+  std::atomic<bool> obsolete_{false};
+};
+
+/**
+ * 按key的顺序写入一个新的run，entry_count_hint是项数的上限，用来确定布隆过滤器的大小
+ */
+class LsmRunWriter {
+public:
+  LsmRunWriter(const LsmKeyComparator &comparator, const std::string &path, int64_t entry_count_hint);
+  ~LsmRunWriter();
+
+  RC open();
+  RC append(const char *entry);
+  /**
+   * 写回文件头、布隆过滤器和fence之后刷盘
+   */
+  RC finish();
+
+  int64_t entry_count() const
+  {
+    return entry_count_;
+  }
+
+private:
+  RC write_buffer();
+
+private:
+  const LsmKeyComparator &comparator_;
+  std::string path_;
+  int fd_ = -1;
+  BloomFilter bloom_;
+  int64_t entry_count_ = 0;
+  int64_t offset_ = 0;
+  std::vector<char> buffer_;
+  std::vector<char> fences_;
+};
+
+/**
+ * 从某个位置开始顺序读一个run，每次读出LSM_RUN_READ_ENTRIES项
+ */
+class LsmRunCursor {
+public:
+  explicit LsmRunCursor(std::shared_ptr<LsmRun> run);
+
+  /**
+   * 定位到第一个不小于key的项，key为nullptr时从头开始
+   */
+  RC seek(const char *key);
+  /**
+   * 当前项，读完时返回nullptr
+   */
+  const char *current() const
+  {
+    return buffer_pos_ < buffer_count_ ? buffer_.data() + buffer_pos_ * entry_size_ : nullptr;
+  }
+  RC next();
+
+private:
+  RC fill();
+
+private:
+  std::shared_ptr<LsmRun> run_;
+  int entry_size_;
+  int64_t pos_ = 0;  // buffer_中第一项的位置
+  std::vector<char> buffer_;
+  int buffer_count_ = 0;
+  int buffer_pos_ = 0;
+};
+
+#endif  // __OBSERVER_STORAGE_LSM_LSM_RUN_H_
@@ -0,0 +1,179 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Partitioned in-memory hash index of in-memory tables.
+//
+
+#include <string.h>
+
+#include "storage/mem/mem_hash_index.h"
+#include "common/log/log.h"
+
+RC MemHashIndex::create(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas,
+                        int page_size)
+{
+  return init_key_operator(index_meta, field_metas);
+}
+
+RC MemHashIndex::open(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas)
+{
+  return init_key_operator(index_meta, field_metas);
+}
+
+RC MemHashIndex::init_key_operator(const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas)
+{
+  RC rc = Index::init(index_meta, field_metas);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  std::vector<AttrType> types;
+  std::vector<int> lengths;
+  key_columns(types, lengths);
+  std::vector<IndexKeyColumn> columns;
+  int offset = 0;
+  for (size_t i = 0; i < types.size(); i++)
+  {
+    columns.push_back(IndexKeyColumn{types[i], offset, lengths[i]});
+    offset += lengths[i];
+  }
+  key_operator_.init(columns);
+  return RC::SUCCESS;
+}
+
+RC MemHashIndex::insert_entry(const char *record, const RID *rid)
+{
+  Entry entry;
+  make_key(record, entry.key);
+  entry.rid = *rid;
+  const size_t hash = key_operator_.hash(entry.key.data());
+  const bool unique = check_unique(record);
+
+  Partition &partition = partitions_[hash % MEM_HASH_INDEX_PARTITIONS];
+  std::lock_guard<std::mutex> lock(partition.mutex);
+  auto range = partition.entries.equal_range(hash);
+  for (auto iter = range.first; iter != range.second; ++iter)
+  {
+    const Entry &other = iter->second;
+    if (key_operator_.compare(other.key.data(), entry.key.data()) == 0 && (unique || other.rid == *rid))
+    {
+      return RC::RECORD_DUPLICATE_KEY;
+    }
+  }
+  partition.entries.emplace(hash, std::move(entry));
+  return RC::SUCCESS;
+}
+
+RC MemHashIndex::delete_entry(const char *record, const RID *rid)
+{
+  std::vector<char> key;
+  make_key(record, key);
+  const size_t hash = key_operator_.hash(key.data());
+
+  Partition &partition = partitions_[hash % MEM_HASH_INDEX_PARTITIONS];
+  std::lock_guard<std::mutex> lock(partition.mutex);
+  auto range = partition.entries.equal_range(hash);
+  for (auto iter = range.first; iter != range.second; ++iter)
+  {
+    const Entry &entry = iter->second;
+    if (entry.rid == *rid && key_operator_.compare(entry.key.data(), key.data()) == 0)
+    {
+      partition.entries.erase(iter);
+      return RC::SUCCESS;
+    }
+  }
+  return RC::RECORD_INVALID_KEY;
+}
+
+IndexScanner *MemHashIndex::create_equal_scanner(const char *key)
+{
+  const size_t hash = key_operator_.hash(key);
+  const int length = key_length();
+  std::vector<RID> rids;
+  std::vector<char> keys;
+
+  Partition &partition = partitions_[hash % MEM_HASH_INDEX_PARTITIONS];
+  {
+    std::lock_guard<std::mutex> lock(partition.mutex);
+    auto range = partition.entries.equal_range(hash);
+    for (auto iter = range.first; iter != range.second; ++iter)
+    {
+      const Entry &entry = iter->second;
+      if (key_operator_.compare(entry.key.data(), key) == 0)
+      {
+        rids.push_back(entry.rid);
+        keys.insert(keys.end(), entry.key.begin(), entry.key.end());
+      }
+    }
+  }
+  return new MemHashIndexScanner(std::move(rids), std::move(keys), length);
+}
+
+IndexScanner *MemHashIndex::create_scanner(CompOp comp_op, const char *value, int null_field_index)
+{
+  if (comp_op != EQUAL_TO || field_metas_.size() != 1)
+  {
+    LOG_WARN("Memory hash index %s only supports equality on all fields", index_meta_.name());
+    return nullptr;
+  }
+  return create_equal_scanner(value);
+}
+
+IndexScanner *MemHashIndex::create_range_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                                 const char *high, int high_column_num, bool high_inclusive)
+{
+  // 只有上下界相同而且包含了所有字段时才是等值查找
+  const int column_num = (int)field_metas_.size();
+  if (low == nullptr || high == nullptr || low_column_num != column_num || high_column_num != column_num ||
+      !low_inclusive || !high_inclusive || 0 != memcmp(low, high, key_length()))
+  {
+    LOG_WARN("Memory hash index %s only supports equality on all fields", index_meta_.name());
+    return nullptr;
+  }
+  return create_equal_scanner(low);
+}
+
+RC MemHashIndex::sync()
+{
+  return RC::SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemHashIndexScanner::MemHashIndexScanner(std::vector<RID> &&rids, std::vector<char> &&keys, int key_length)
+    : rids_(std::move(rids)), keys_(std::move(keys)), key_length_(key_length)
+{}
+
+RC MemHashIndexScanner::next_entry(RID *rid)
+{
+  return next_entry(rid, nullptr);
+}
+
+RC MemHashIndexScanner::next_entry(RID *rid, char *key)
+{
+  if (index_ >= rids_.size())
+  {
+    return RC::RECORD_EOF;
+  }
+  *rid = rids_[index_];
+  if (key != nullptr)
+  {
+    memcpy(key, keys_.data() + index_ * key_length_, key_length_);
+  }
+  index_++;
+  return RC::SUCCESS;
+}
+
+RC MemHashIndexScanner::destroy()
+{
+  delete this;
+  return RC::SUCCESS;
+}
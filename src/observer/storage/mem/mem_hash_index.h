@@ -0,0 +1,92 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Partitioned in-memory hash index of in-memory tables.
+//
+
+#ifndef __OBSERVER_STORAGE_MEM_MEM_HASH_INDEX_H_
+#define __OBSERVER_STORAGE_MEM_MEM_HASH_INDEX_H_
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "storage/common/index.h"
+#include "storage/common/extendible_hash.h"
+
+#define MEM_HASH_INDEX_PARTITIONS 16
+
+/**
+ * 内存表的哈希索引，不对应任何文件，每次打开时是空的，由表在插入记录时重新建立。
+ * 索引项按key的哈希值分到多个分区，每个分区有自己的互斥量，不同分区的查找和修改互不影响。
+ * 和HashIndex一样只支持所有字段都是等值条件的查找，其它扫描返回nullptr
+ */
+class MemHashIndex : public Index {
+public:
+  MemHashIndex() = default;
+  ~MemHashIndex() override = default;
+
+  /**
+   * 没有索引文件，file_name和page_size不使用
+   */
+  RC create(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas,
+            int page_size = 0) override;
+  RC open(const char *file_name, const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas) override;
+
+  RC insert_entry(const char *record, const RID *rid) override;
+  RC delete_entry(const char *record, const RID *rid) override;
+
+  IndexScanner *create_scanner(CompOp comp_op, const char *value, int null_field_index) override;
+  IndexScanner *create_range_scanner(const char *low, int low_column_num, bool low_inclusive,
+                                     const char *high, int high_column_num, bool high_inclusive) override;
+
+  RC sync() override;
+
+private:
+  struct Entry
+  {
+    std::vector<char> key;
+    RID rid;
+  };
+  struct Partition
+  {
+    std::mutex mutex;
+    std::unordered_multimap<size_t, Entry> entries;  // 以key的哈希值为键
+  };
+
+  RC init_key_operator(const IndexMeta &index_meta, const std::vector<FieldMeta> &field_metas);
+  IndexScanner *create_equal_scanner(const char *key);
+
+private:
+  HashKeyOperator key_operator_;
+  Partition partitions_[MEM_HASH_INDEX_PARTITIONS];
+};
+
+/**
+ * 创建时把所有满足条件的索引项复制出来，之后不再访问索引
+ */
+class MemHashIndexScanner : public IndexScanner {
+public:
+  MemHashIndexScanner(std::vector<RID> &&rids, std::vector<char> &&keys, int key_length);
+  ~MemHashIndexScanner() noexcept override = default;
+
+  RC next_entry(RID *rid) override;
+  RC next_entry(RID *rid, char *key) override;
+  RC destroy() override;
+
+private:
+  std::vector<RID> rids_;
+  std::vector<char> keys_;
+  int key_length_;
+  size_t index_ = 0;
+};
+
+#endif  // __OBSERVER_STORAGE_MEM_MEM_HASH_INDEX_H_
@@ -0,0 +1,190 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Arena row store of in-memory tables.
+//
+
+#include <string.h>
+
+#include "storage/mem/mem_record_store.h"
+#include "common/log/log.h"
+
+/**
+ * 块列表的读写锁，在析构时释放
+ */
+class MemLatchGuard
+{
+public:
+  MemLatchGuard(pthread_rwlock_t &latch, bool exclusive) : latch_(latch)
+  {
+    if (exclusive)
+    {
+      pthread_rwlock_wrlock(&latch_);
+    }
+    else
+    {
+      pthread_rwlock_rdlock(&latch_);
+    }
+  }
+  ~MemLatchGuard()
+  {
+    pthread_rwlock_unlock(&latch_);
+  }
+
+private:
+  pthread_rwlock_t &latch_;
+};
+
+MemRecordStore::MemRecordStore(int record_size) : record_size_(record_size)
+{
+  pthread_rwlock_init(&latch_, nullptr);
+}
+
+MemRecordStore::~MemRecordStore()
+{
+  for (Block &block : blocks_)
+  {
+    delete[] block.rows;
+  }
+  blocks_.clear();
+  pthread_rwlock_destroy(&latch_);
+}
+
+bool MemRecordStore::valid_rid(const RID &rid) const
+{
+  return rid.page_num >= 0 && rid.page_num < (int)blocks_.size() && rid.slot_num >= 0 &&
+         rid.slot_num < MEM_RECORD_BLOCK_ROWS && blocks_[rid.page_num].used[rid.slot_num];
+}
+
+RC MemRecordStore::insert_record(const char *data, RID *rid)
+{
+  MemLatchGuard guard(latch_, true);
+  if (free_slots_.empty())
+  {
+    // 新的块倒序放入空闲表，先用掉前面的位置
+    Block block;
+    block.rows = new (std::nothrow) char[(size_t)record_size_ * MEM_RECORD_BLOCK_ROWS];
+    if (nullptr == block.rows)
+    {
+      LOG_ERROR("Failed to allocate memory block of %d records, record size=%d", MEM_RECORD_BLOCK_ROWS, record_size_);
+      return RC::NOMEM;
+    }
+    block.used.assign(MEM_RECORD_BLOCK_ROWS, false);
+    const PageNum block_index = (PageNum)blocks_.size();
+    blocks_.push_back(std::move(block));
+    for (SlotNum slot = MEM_RECORD_BLOCK_ROWS - 1; slot >= 0; slot--)
+    {
+      free_slots_.push_back(RID{block_index, slot});
+    }
+  }
+
+  *rid = free_slots_.back();
+  free_slots_.pop_back();
+  Block &block = blocks_[rid->page_num];
+  memcpy(block.rows + (size_t)rid->slot_num * record_size_, data, record_size_);
+  block.used[rid->slot_num] = true;
+  record_count_++;
+  return RC::SUCCESS;
+}
+
+RC MemRecordStore::update_record(const RID &rid, const char *data)
+{
+  MemLatchGuard guard(latch_, false);
+  if (!valid_rid(rid))
+  {
+    return RC::RECORD_RECORD_NOT_EXIST;
+  }
+  char *row = blocks_[rid.page_num].rows + (size_t)rid.slot_num * record_size_;
+  if (row != data)
+  {
+    memmove(row, data, record_size_);
+  }
+  return RC::SUCCESS;
+}
+
+RC MemRecordStore::delete_record(const RID &rid)
+{
+  MemLatchGuard guard(latch_, true);
+  if (!valid_rid(rid))
+  {
+    return RC::RECORD_RECORD_NOT_EXIST;
+  }
+  blocks_[rid.page_num].used[rid.slot_num] = false;
+  free_slots_.push_back(rid);
+  record_count_--;
+  return RC::SUCCESS;
+}
+
+RC MemRecordStore::get_record(const RID &rid, Record *rec)
+{
+  MemLatchGuard guard(latch_, false);
+  if (!valid_rid(rid))
+  {
+    return RC::RECORD_RECORD_NOT_EXIST;
+  }
+  rec->rid = rid;
+  rec->data = blocks_[rid.page_num].rows + (size_t)rid.slot_num * record_size_;
+  return RC::SUCCESS;
+}
+
+RC MemRecordStore::visit_block(int block_index, RC (*visitor)(Record *record, void *context), void *context)
+{
+  char *rows = nullptr;
+  std::vector<bool> used;
+  {
+    MemLatchGuard guard(latch_, false);
+    if (block_index < 0 || block_index >= (int)blocks_.size())
+    {
+      return RC::RECORD_EOF;
+    }
+    rows = blocks_[block_index].rows;
+    used = blocks_[block_index].used;
+  }
+
+  Record record;
+  for (SlotNum slot = 0; slot < MEM_RECORD_BLOCK_ROWS; slot++)
+  {
+    if (!used[slot])
+    {
+      continue;
+    }
+    record.rid = RID{block_index, slot};
+    record.data = rows + (size_t)slot * record_size_;
+    RC rc = visitor(&record, context);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC MemRecordStore::visit_records(RC (*visitor)(Record *record, void *context), void *context)
+{
+  RC rc = RC::SUCCESS;
+  for (int block_index = 0; rc == RC::SUCCESS; block_index++)
+  {
+    rc = visit_block(block_index, visitor, context);
+  }
+  return RC::RECORD_EOF == rc ? RC::SUCCESS : rc;
+}
+
+int MemRecordStore::block_count()
+{
+  MemLatchGuard guard(latch_, false);
+  return (int)blocks_.size();
+}
+
+int MemRecordStore::record_count()
+{
+  MemLatchGuard guard(latch_, false);
+  return record_count_;
+}
@@ -0,0 +1,84 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Arena row store of in-memory tables.
+//
+
+#ifndef __OBSERVER_STORAGE_MEM_MEM_RECORD_STORE_H_
+#define __OBSERVER_STORAGE_MEM_MEM_RECORD_STORE_H_
+
+#include <pthread.h>
+
+#include <vector>
+
+#include "rc.h"
+#include "storage/common/record_manager.h"
+
+#define MEM_RECORD_BLOCK_ROWS 1024  // 每次向系统申请的一块内存中存放的记录数
+
+/**
+ * 内存表的记录。记录按定长保存在成块申请的内存中，rid的page_num是块的序号，slot_num是块内的位置，
+ * 块在表关闭之前不会释放，记录的地址一直有效，get_record直接返回指向记录的指针。
+ * 删除的位置放到空闲表中，之后插入时优先复用。
+ * latch_保护块的列表、使用标记和空闲表，拿到指针之后读取记录内容不加锁，和页面上的定长记录一样由事务字段保证可见性
+ */
+class MemRecordStore
+{
+public:
+  explicit MemRecordStore(int record_size);
+  ~MemRecordStore();
+
+  RC insert_record(const char *data, RID *rid);
+  RC update_record(const RID &rid, const char *data);
+  RC delete_record(const RID &rid);
+  /**
+   * rec的data指向块中的记录
+   */
+  RC get_record(const RID &rid, Record *rec);
+
+  /**
+   * 按rid的顺序访问第block_index块上的记录，开始时复制一份这个块的使用标记，visitor可以修改或删除记录。
+   * visitor返回非SUCCESS时停止访问并返回该值，block_index超过块数时返回RECORD_EOF
+   */
+  RC visit_block(int block_index, RC (*visitor)(Record *record, void *context), void *context);
+  /**
+   * 访问所有的记录，visitor的要求和visit_block相同，全部访问完或者visitor返回RECORD_EOF时返回SUCCESS
+   */
+  RC visit_records(RC (*visitor)(Record *record, void *context), void *context);
+
+  int record_size() const
+  {
+    return record_size_;
+  }
+  int block_count();
+  int record_count();
+
+private:
+  struct Block
+  {
+    char *rows;
+    std::vector<bool> used;
+  };
+
+  /**
+   * 需要持有latch_
+   */
+  bool valid_rid(const RID &rid) const;
+
+private:
+  const int record_size_;
+  pthread_rwlock_t latch_;
+  std::vector<Block> blocks_;
+  std::vector<RID> free_slots_;
+  int record_count_ = 0;
+};
+
+#endif  // __OBSERVER_STORAGE_MEM_MEM_RECORD_STORE_H_
@@ -0,0 +1,196 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Row lock manager with wait-for graph deadlock detection.
+//
+
+#include <chrono>
+
+#include "storage/trx/lock_manager.h"
+#include "common/log/log.h"
+#include "common/seda/request_trace.h"
+
+LockManager &LockManager::instance()
+{
+  static LockManager instance;
+  return instance;
+}
+
+void LockManager::blockers(const LockEntry &entry, int64_t trx_id, LockMode mode, std::vector<int64_t> &result)
+{
+  result.clear();
+  for (const auto &holder : entry.holders)
+  {
+    if (holder.first == trx_id)
+    {
+      continue;
+    }
+    if (mode == LockMode::EXCLUSIVE || holder.second == LockMode::EXCLUSIVE)
+    {
+      result.push_back(holder.first);
+    }
+  }
+}
+
+bool LockManager::add_wait_edges(int64_t trx_id, const std::vector<int64_t> &blockers)
+{
+  std::lock_guard<std::mutex> lock(graph_mutex_);
+  // 从持有者出发沿等待关系查找，能走到自己就成环
+  std::vector<int64_t> stack(blockers.begin(), blockers.end());
+  std::unordered_set<int64_t> visited;
+  while (!stack.empty())
+  {
+    const int64_t current = stack.back();
+    stack.pop_back();
+    if (current == trx_id)
+    {
+      waits_for_.erase(trx_id);
+      return true;
+    }
+    if (!visited.insert(current).second)
+    {
+      continue;
+    }
+    auto iter = waits_for_.find(current);
+    if (iter != waits_for_.end())
+    {
+      stack.insert(stack.end(), iter->second.begin(), iter->second.end());
+    }
+  }
+  waits_for_[trx_id] = blockers;
+  return false;
+}
+
+void LockManager::remove_wait_edges(int64_t trx_id)
+{
+  std::lock_guard<std::mutex> lock(graph_mutex_);
+  waits_for_.erase(trx_id);
+}
+
+RC LockManager::lock(int64_t trx_id, const LockKey &key, LockMode mode, std::vector<LockKey> &held)
+{
+  Partition &part = partition(key);
+  std::unique_lock<std::mutex> lock(part.mutex);
+  LockEntry &entry = part.locks[key];
+  auto own = entry.holders.find(trx_id);
+  if (own != entry.holders.end() && (own->second == LockMode::EXCLUSIVE || mode == LockMode::SHARED))
+  {
+    return RC::SUCCESS;
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(wait_timeout_ms_);
+  std::vector<int64_t> waiting_for;
+  RC rc = RC::SUCCESS;
+  blockers(entry, trx_id, mode, waiting_for);
+  if (!waiting_for.empty())
+  {
+    common::TraceSpanScope span("storage", "lock_wait");
+    entry.waiters++;
+    while (!waiting_for.empty())
+    {
+      // 持有者变化之后重新检查等待关系，等待的对象只会越来越少，但是新的等待边可能和别的事务成环
+      if (add_wait_edges(trx_id, waiting_for))
+      {
+        LOG_WARN("Deadlock detected, trx %ld waits for trx %ld. rid=%d.%d",
+                 trx_id, waiting_for.front(), key.page_num, key.slot_num);
+        rc = RC::LOCKED_DEADLOCK;
+        break;
+      }
+      if (part.cond.wait_until(lock, deadline) == std::cv_status::timeout)
+      {
+        blockers(entry, trx_id, mode, waiting_for);
+        if (!waiting_for.empty())
+        {
+          LOG_WARN("Lock wait timeout, trx %ld waits for trx %ld. rid=%d.%d",
+                   trx_id, waiting_for.front(), key.page_num, key.slot_num);
+          rc = RC::BUSY_TIMEOUT;
+        }
+        break;
+      }
+      blockers(entry, trx_id, mode, waiting_for);
+    }
+    remove_wait_edges(trx_id);
+    entry.waiters--;
+  }
+
+  if (rc != RC::SUCCESS)
+  {
+    if (entry.holders.empty() && entry.waiters == 0)
+    {
+      part.locks.erase(key);
+    }
+    return rc;
+  }
+
+  if (entry.holders.find(trx_id) == entry.holders.end())
+  {
+    held.push_back(key);
+  }
+  entry.holders[trx_id] = mode;
+  return RC::SUCCESS;
+}
+
+void LockManager::release(int64_t trx_id, const std::vector<LockKey> &held)
+{
+  if (held.empty())
+  {
+    return;
+  }
+  // 按分区依次释放，每个分区只唤醒一次
+  std::vector<bool> touched(LOCK_MANAGER_PARTITIONS, false);
+  for (const LockKey &key : held)
+  {
+    touched[LockKeyHasher()(key) % LOCK_MANAGER_PARTITIONS] = true;
+  }
+  for (int i = 0; i < LOCK_MANAGER_PARTITIONS; i++)
+  {
+    if (!touched[i])
+    {
+      continue;
+    }
+    Partition &part = partitions_[i];
+    bool wakeup = false;
+    {
+      std::lock_guard<std::mutex> lock(part.mutex);
+      for (const LockKey &key : held)
+      {
+        if (&partition(key) != &part)
+        {
+          continue;
+        }
+        auto iter = part.locks.find(key);
+        if (iter == part.locks.end())
+        {
+          continue;
+        }
+        iter->second.holders.erase(trx_id);
+        if (iter->second.waiters > 0)
+        {
+          wakeup = true;
+        }
+        else if (iter->second.holders.empty())
+        {
+          part.locks.erase(iter);
+        }
+      }
+    }
+    if (wakeup)
+    {
+      part.cond.notify_all();
+    }
+  }
+}
+
+int LockManager::waiting_trx_count()
+{
+  std::lock_guard<std::mutex> lock(graph_mutex_);
+  return (int)waits_for_.size();
+}
@@ -0,0 +1,136 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Row lock manager with wait-for graph deadlock detection.
+//
+
+#ifndef __OBSERVER_STORAGE_TRX_LOCK_MANAGER_H_
+#define __OBSERVER_STORAGE_TRX_LOCK_MANAGER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "rc.h"
+
+#define LOCK_MANAGER_PARTITIONS 64
+#define LOCK_DEFAULT_WAIT_TIMEOUT 50000   // 毫秒
+
+class Table;
+
+enum class LockMode : int
+{
+  SHARED,
+  EXCLUSIVE,
+};
+
+/**
+ * 加锁的对象，表中的一条记录
+ */
+struct LockKey
+{
+  const Table *table;
+  int32_t page_num;
+  int32_t slot_num;
+
+  bool operator==(const LockKey &other) const
+  {
+    return table == other.table && page_num == other.page_num && slot_num == other.slot_num;
+  }
+};
+
+struct LockKeyHasher
+{
+  size_t operator()(const LockKey &key) const
+  {
+    return std::hash<const void *>()(key.table) ^ (((size_t)(uint32_t)key.page_num << 32) | (uint32_t)key.slot_num);
+  }
+};
+
+/**
+ * 记录锁。锁表按记录的哈希值分成多个分区，每个分区有自己的互斥量和条件变量，不同分区的加锁互不影响。
+ * 锁由事务号持有，同一个事务重复加锁直接成功，只有自己持有共享锁时可以升级为排它锁。
+ * 需要等待时把等待关系加到全局的等待图中，如果从持有者出发能够回到自己就是死锁，
+ * 发起这次加锁的事务作为牺牲者返回LOCKED_DEADLOCK；等待超过超时时间时返回BUSY_TIMEOUT。
+ * 锁在事务提交或回滚之后由release一次全部释放
+ */
+class LockManager
+{
+public:
+  static LockManager &instance();
+
+  void set_wait_timeout(int timeout_ms)
+  {
+    wait_timeout_ms_ = timeout_ms;
+  }
+  int wait_timeout() const
+  {
+    return wait_timeout_ms_;
+  }
+
+  /**
+   * 事务trx_id给key加锁。新加的锁追加到held中，已经持有的锁不重复追加
+   */
+  RC lock(int64_t trx_id, const LockKey &key, LockMode mode, std::vector<LockKey> &held);
+  /**
+   * 释放事务持有的所有锁，唤醒等待这些锁的事务
+   */
+  void release(int64_t trx_id, const std::vector<LockKey> &held);
+
+  /**
+   * 正在等待的事务数
+   */
+  int waiting_trx_count();
+
+private:
+  struct LockEntry
+  {
+    std::unordered_map<int64_t, LockMode> holders;
+    int waiters = 0;
+  };
+
+  struct Partition
+  {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::unordered_map<LockKey, LockEntry, LockKeyHasher> locks;
+  };
+
+  Partition &partition(const LockKey &key)
+  {
+    return partitions_[LockKeyHasher()(key) % LOCK_MANAGER_PARTITIONS];
+  }
+
+  /**
+   * 和trx_id请求的mode冲突的持有者
+   */
+  static void blockers(const LockEntry &entry, int64_t trx_id, LockMode mode, std::vector<int64_t> &result);
+  /**
+   * 记录trx_id在等待blockers，加上这些边之后有环时不记录并返回true
+   */
+  bool add_wait_edges(int64_t trx_id, const std::vector<int64_t> &blockers);
+  void remove_wait_edges(int64_t trx_id);
+
+private:
+  int wait_timeout_ms_ = LOCK_DEFAULT_WAIT_TIMEOUT;
+  Partition partitions_[LOCK_MANAGER_PARTITIONS];
+
+  std::mutex graph_mutex_;   // 在分区的互斥量之后获取
+  std::unordered_map<int64_t, std::vector<int64_t>> waits_for_;
+};
+
+#endif  // __OBSERVER_STORAGE_TRX_LOCK_MANAGER_H_
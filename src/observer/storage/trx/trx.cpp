@@ -12,26 +12,397 @@ See the Mulan PSL v2 for more details. */
 // Created by Wangyunlai on 2021/5/24.
 //
 
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
 #include <atomic>
+#include <deque>
+#include <set>
 
 #include "storage/trx/trx.h"
 #include "storage/common/table.h"
+#include "storage/common/materialized_view.h"
 #include "storage/common/record_manager.h"
 #include "storage/common/field_meta.h"
+#include "storage/common/undo_file.h"
+#include "storage/default/disk_buffer_pool.h"
+#include "storage/default/redo_log.h"
+#include "storage/default/replication.h"
 #include "common/log/log.h"
+#include "common/seda/request_trace.h"
 
-static const uint32_t DELETED_FLAG_BIT_MASK = 0x80000000;
-static const uint32_t TRX_ID_BIT_MASK = 0x7FFFFFFF;
+// 事务字段的最高位是删除标记，其余是事务号。新建的表用64位的事务字段，之前建的表仍然是32位的
+static const uint64_t DELETED_FLAG_BIT_MASK = 0x8000000000000000ULL;
+static const uint64_t TRX_ID_BIT_MASK = 0x7FFFFFFFFFFFFFFFULL;
+static const uint32_t NARROW_DELETED_FLAG_BIT_MASK = 0x80000000;
+static const uint32_t NARROW_TRX_ID_BIT_MASK = 0x7FFFFFFF;
 
-int32_t Trx::default_trx_id()
+int64_t Trx::default_trx_id()
 {
   return 0;
 }
 
-int32_t Trx::next_trx_id()
+int64_t Trx::next_trx_id()
+{
+  // 每个线程一次从全局计数器中预留一段事务号，开始事务时不用每次都修改同一个缓存行。
+  // 事务号只用来区分事务，不要求按开始的顺序递增，可见性按提交序号判断
+  static std::atomic<int64_t> next_block(1);
+  thread_local int64_t next = 0;
+  thread_local int64_t block_end = 0;
+  if (next == block_end)
+  {
+    next = next_block.fetch_add(TRX_ID_BLOCK_SIZE);
+    block_end = next + TRX_ID_BLOCK_SIZE;
+  }
+  return next++;
+}
+
+static std::atomic<int> active_trx_num(0);
+
+/**
+ * 事务修改一条记录之前的版本。修改之前的事务字段保存在这里，被修改的字段原来的值保存在表的undo文件中，
+ * undo记录由若干段[int32偏移][int32长度][数据]组成。删除只修改事务字段，没有undo记录
+ */
+struct RecordVersion
+{
+  int64_t trx_id;       // 修改了这个版本的事务
+  int64_t prev_trx_id;  // 这个版本上的事务号和删除标记
+  bool prev_deleted;
+  UndoPtr undo;
+};
+
+/**
+ * 一条记录的版本链，越新的修改越靠后
+ */
+using VersionChain = std::vector<RecordVersion>;
+
+/**
+ * 已经提交、等待所有的读视图都能看到之后清理的事务
+ */
+struct PurgeItem
+{
+  uint64_t commit_ts;
+  int64_t trx_id;
+  std::unordered_map<Table *, std::vector<Operation>> operations;  // 按页面排序
+};
+
+// 下面的状态都由mvcc_mutex保护，只有修改记录和遇到带事务号的记录时才需要访问
+static std::mutex mvcc_mutex;
+static uint64_t commit_seq = 0;
+static std::unordered_set<int64_t> active_trx;
+static std::unordered_map<int64_t, uint64_t> committed_trx;  // 事务号 -> 提交序号，清理之后删除
+static std::atomic<int> committed_trx_num(0);
+static std::multiset<uint64_t> read_views;
+static std::deque<PurgeItem> purge_queue;  // 按提交序号排列
+static std::unordered_map<Table *, std::unordered_map<uint64_t, VersionChain>> versions;
+static std::atomic<bool> replica_mode(false);
+
+static uint64_t rid_key(const RID &rid)
+{
+  return ((uint64_t)(uint32_t)rid.page_num << 32) | (uint32_t)rid.slot_num;
+}
+
+static void read_trx_field(const FieldMeta *trx_field, const char *data, int64_t &trx_id, bool &deleted)
+{
+  if (trx_field->len() == sizeof(uint64_t))
+  {
+    uint64_t trx = 0;
+    memcpy(&trx, data + trx_field->offset(), sizeof(trx));
+    trx_id = (int64_t)(trx & TRX_ID_BIT_MASK);
+    deleted = (trx & DELETED_FLAG_BIT_MASK) != 0;
+  }
+  else
+  {
+    uint32_t trx = 0;
+    memcpy(&trx, data + trx_field->offset(), sizeof(trx));
+    trx_id = trx & NARROW_TRX_ID_BIT_MASK;
+    deleted = (trx & NARROW_DELETED_FLAG_BIT_MASK) != 0;
+  }
+}
+
+static void write_trx_field(const FieldMeta *trx_field, char *data, int64_t trx_id, bool deleted)
+{
+  if (trx_field->len() == sizeof(uint64_t))
+  {
+    const uint64_t trx = (uint64_t)trx_id | (deleted ? DELETED_FLAG_BIT_MASK : 0);
+    memcpy(data + trx_field->offset(), &trx, sizeof(trx));
+  }
+  else
+  {
+    const uint32_t trx = (uint32_t)trx_id | (deleted ? NARROW_DELETED_FLAG_BIT_MASK : 0);
+    memcpy(data + trx_field->offset(), &trx, sizeof(trx));
+  }
+}
+
+/**
+ * 32位的事务字段放不下的事务号不能修改这张表。事务号每次启动都从1开始，一次运行中超过2^31个事务才会出现
+ */
+static RC check_trx_field(Table *table, int64_t trx_id)
+{
+  const FieldMeta *trx_field = table->table_meta().trx_field();
+  if (trx_field->len() < (int)sizeof(uint64_t) && (uint64_t)trx_id > NARROW_TRX_ID_BIT_MASK)
+  {
+    LOG_ERROR("Trx id %ld does not fit in the 32 bits trx field of table %s", trx_id, table->name());
+    return RC::INTERNAL;
+  }
+  return RC::SUCCESS;
+}
+
+static void encode_undo(const char *data, const UndoRange *ranges, int range_num, std::vector<char> &undo)
+{
+  for (int i = 0; i < range_num; i++)
+  {
+    const int32_t header[2] = {ranges[i].offset, ranges[i].len};
+    undo.insert(undo.end(), (const char *)header, (const char *)header + sizeof(header));
+    undo.insert(undo.end(), data + ranges[i].offset, data + ranges[i].offset + ranges[i].len);
+  }
+}
+
+static bool undo_covers(const std::vector<char> &undo, int offset)
+{
+  int32_t header[2];
+  for (size_t pos = 0; pos + sizeof(header) <= undo.size(); pos += sizeof(header) + header[1])
+  {
+    memcpy(header, undo.data() + pos, sizeof(header));
+    if (header[0] == offset)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void apply_undo(const std::vector<char> &undo, char *data)
+{
+  int32_t header[2];
+  for (size_t pos = 0; pos + sizeof(header) <= undo.size(); pos += sizeof(header) + header[1])
+  {
+    memcpy(header, undo.data() + pos, sizeof(header));
+    memcpy(data + header[0], undo.data() + pos + sizeof(header), header[1]);
+  }
+}
+
+static RecordVersion *find_version_locked(Table *table, const RID &rid, int64_t trx_id)
+{
+  auto table_iter = versions.find(table);
+  if (table_iter == versions.end())
+  {
+    return nullptr;
+  }
+  auto chain_iter = table_iter->second.find(rid_key(rid));
+  if (chain_iter == table_iter->second.end())
+  {
+    return nullptr;
+  }
+  for (auto iter = chain_iter->second.rbegin(); iter != chain_iter->second.rend(); ++iter)
+  {
+    if (iter->trx_id == trx_id)
+    {
+      return &*iter;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * data是version的事务修改之后的记录，恢复成修改之前的版本
+ */
+static RC undo_version_locked(Table *table, const RecordVersion &version, char *data)
+{
+  if (version.undo.len > 0)
+  {
+    std::vector<char> undo;
+    RC rc = table->undo_file()->read(version.undo, undo);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to read undo record of trx %ld. table=%s, rc=%d:%s", version.trx_id, table->name(), rc, strrc(rc));
+      return rc;
+    }
+    apply_undo(undo, data);
+  }
+  write_trx_field(table->table_meta().trx_field(), data, version.prev_trx_id, version.prev_deleted);
+  return RC::SUCCESS;
+}
+
+/**
+ * 把一张表上的操作按页号和槽号排序。清理和回滚按这个顺序修改页面，同一个页面上的操作连续完成，
+ * 大事务也只是顺序地访问一遍页面，不会按哈希顺序来回换入换出缓冲池中的页面
+ */
+static std::vector<Operation> sorted_operations(const Trx::OperationSet &operation_set)
+{
+  std::vector<Operation> operations(operation_set.begin(), operation_set.end());
+  std::sort(operations.begin(), operations.end(), [](const Operation &op1, const Operation &op2) {
+    return op1.page_num() != op2.page_num() ? op1.page_num() < op2.page_num() : op1.slot_num() < op2.slot_num();
+  });
+  return operations;
+}
+
+/**
+ * 丢弃trx_id保存的版本。trx_id已经提交并且所有读视图都能看到时，更晚的版本上它的事务号也清除掉
+ */
+static void remove_versions_locked(Table *table, const std::vector<Operation> &operations, int64_t trx_id)
+{
+  auto table_iter = versions.find(table);
+  if (table_iter == versions.end())
+  {
+    return;
+  }
+  for (const Operation &operation : operations)
+  {
+    RID rid;
+    rid.page_num = operation.page_num();
+    rid.slot_num = operation.slot_num();
+    auto chain_iter = table_iter->second.find(rid_key(rid));
+    if (chain_iter == table_iter->second.end())
+    {
+      continue;
+    }
+    VersionChain &chain = chain_iter->second;
+    for (auto iter = chain.begin(); iter != chain.end();)
+    {
+      if (iter->trx_id == trx_id)
+      {
+        iter = chain.erase(iter);
+        continue;
+      }
+      if (iter->prev_trx_id == trx_id)
+      {
+        iter->prev_trx_id = 0;
+      }
+      ++iter;
+    }
+    if (chain.empty())
+    {
+      table_iter->second.erase(chain_iter);
+    }
+  }
+  if (table_iter->second.empty())
+  {
+    // 表中没有旧版本了，undo文件从头开始复用
+    table->undo_file()->reset();
+    versions.erase(table_iter);
+  }
+}
+
+/**
+ * 清理所有读视图都能看到的已经提交的事务，每个事务结束时都会调用
+ */
+static void purge_committed_trx()
+{
+  std::vector<PurgeItem> items;
+  {
+    std::lock_guard<std::mutex> lock(mvcc_mutex);
+    const uint64_t oldest_view = read_views.empty() ? UINT64_MAX : *read_views.begin();
+    while (!purge_queue.empty() && purge_queue.front().commit_ts <= oldest_view)
+    {
+      items.push_back(std::move(purge_queue.front()));
+      purge_queue.pop_front();
+    }
+  }
+  if (items.empty())
+  {
+    return;
+  }
+
+  // 先修改页面再删除版本，在这之间读到记录的事务按提交序号判断，结果是一样的
+  for (const PurgeItem &item : items)
+  {
+    for (const auto &table_operations : item.operations)
+    {
+      Table *table = table_operations.first;
+      for (const Operation &operation : table_operations.second)
+      {
+        RID rid;
+        rid.page_num = operation.page_num();
+        rid.slot_num = operation.slot_num();
+        RC rc = table->purge_record(item.trx_id, rid);
+        if (rc != RC::SUCCESS)
+        {
+          LOG_ERROR("Failed to purge record of trx %ld. rid=%d.%d, rc=%d:%s",
+                    item.trx_id, rid.page_num, rid.slot_num, rc, strrc(rc));
+        }
+        table->page_visibility().remove(rid.page_num);
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mvcc_mutex);
+    for (const PurgeItem &item : items)
+    {
+      for (const auto &table_operations : item.operations)
+      {
+        remove_versions_locked(table_operations.first, table_operations.second, item.trx_id);
+      }
+      committed_trx.erase(item.trx_id);
+      committed_trx_num--;
+    }
+  }
+  // 记录上已经没有这些事务号了，恢复时不再需要它们的提交记录
+  for (const PurgeItem &item : items)
+  {
+    RedoLog::instance().end_commit(item.trx_id);
+  }
+}
+
+void Trx::set_replica(bool replica)
+{
+  replica_mode = replica;
+}
+
+bool Trx::replica()
 {
-  static std::atomic<int32_t> trx_id;
-  return ++trx_id;
+  return replica_mode.load();
+}
+
+int Trx::active_trx_count()
+{
+  return active_trx_num.load();
+}
+
+bool Trx::has_versions()
+{
+  std::lock_guard<std::mutex> lock(mvcc_mutex);
+  return !committed_trx.empty() || !versions.empty();
+}
+
+void Trx::drop_table(Table *table)
+{
+  std::lock_guard<std::mutex> lock(mvcc_mutex);
+  versions.erase(table);
+  for (PurgeItem &item : purge_queue)
+  {
+    item.operations.erase(table);
+  }
+}
+
+bool Trx::has_versions(Table *table)
+{
+  std::lock_guard<std::mutex> lock(mvcc_mutex);
+  return versions.count(table) != 0;
+}
+
+bool Trx::add_version_rids(Table *table, std::vector<RID> &rids)
+{
+  std::lock_guard<std::mutex> lock(mvcc_mutex);
+  auto table_iter = versions.find(table);
+  if (table_iter == versions.end())
+  {
+    return false;
+  }
+  std::unordered_set<RID, RidDigest> existing(rids.begin(), rids.end());
+  for (const auto &chain : table_iter->second)
+  {
+    RID rid;
+    rid.page_num = (PageNum)(chain.first >> 32);
+    rid.slot_num = (SlotNum)(chain.first & 0xFFFFFFFF);
+    if (existing.insert(rid).second)
+    {
+      rids.push_back(rid);
+    }
+  }
+  return true;
 }
 
 const char *Trx::trx_field_name()
@@ -46,7 +417,7 @@ AttrType Trx::trx_field_type()
 
 int Trx::trx_field_len()
 {
-  return sizeof(int32_t);
+  return sizeof(int64_t);
 }
 
 Trx::Trx()
@@ -55,37 +426,155 @@ Trx::Trx()
 
 Trx::~Trx()
 {
+  // 连接断开时没有提交的修改都回滚
+  if (trx_id_ != 0 || has_read_view_)
+  {
+    rollback();
+  }
 }
 
-RC Trx::update_record(Table *table, Record *record, char *new_record_data)
+RC Trx::prepare_modify(Table *table, Record *record, Operation::Type type, const UndoRange *ranges, int range_num)
 {
-  LOG_ERROR("Start update");
   start_if_not_started();
   Operation *old_oper = find_operation(table, record->rid);
-
   if (old_oper != nullptr)
   {
     if (old_oper->type() == Operation::Type::DELETE)
     {
-      // 不能更新已经删除的记录
-      LOG_ERROR("Can not update record which is already deleted");
+      // 不能修改已经删除的记录
+      LOG_ERROR("Can not modify record which is already deleted");
       return RC::GENERIC_ERROR;
     }
-    else if (old_oper->type() == Operation::Type::UPDATE)
+    log_savepoint_undo(table, record->rid, old_oper->type(), record->data);
+    if (old_oper->type() == Operation::Type::INSERT || range_num == 0)
+    {
+      // 当前事务插入的记录不需要旧版本
+      return RC::SUCCESS;
+    }
+    // 当前事务更新过的记录，这次修改的字段如果之前没有改过，页面上还是原来的值，补充到undo记录中
+    std::lock_guard<std::mutex> lock(mvcc_mutex);
+    RecordVersion *version = find_version_locked(table, record->rid, trx_id_);
+    if (nullptr == version)
+    {
+      LOG_ERROR("Failed to find the version before trx %ld. rid=%d.%d", trx_id_, record->rid.page_num, record->rid.slot_num);
+      return RC::INTERNAL;
+    }
+    std::vector<char> undo;
+    if (version->undo.len > 0)
+    {
+      RC rc = table->undo_file()->read(version->undo, undo);
+      if (rc != RC::SUCCESS)
+      {
+        return rc;
+      }
+    }
+    std::vector<UndoRange> added;
+    for (int i = 0; i < range_num; i++)
+    {
+      if (!undo_covers(undo, ranges[i].offset))
+      {
+        added.push_back(ranges[i]);
+      }
+    }
+    if (added.empty())
+    {
+      return RC::SUCCESS;
+    }
+    encode_undo(record->data, added.data(), (int)added.size(), undo);
+    return table->undo_file()->append(undo.data(), (int)undo.size(), &version->undo);
+  }
+
+  RC rc = check_trx_field(table, trx_id_);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+
+  // 记录正在被其它事务修改时在这里等它提交或回滚，之后再检查扫描看到的是不是最新的版本
+  const LockKey lock_key = {table, record->rid.page_num, record->rid.slot_num};
+  rc = LockManager::instance().lock(trx_id_, lock_key, LockMode::EXCLUSIVE, locks_);
+  if (rc != RC::SUCCESS)
+  {
+    LOG_WARN("Failed to lock record rid=%d.%d, trx=%ld. rc=%d:%s",
+             record->rid.page_num, record->rid.slot_num, trx_id_, rc, strrc(rc));
+    return rc;
+  }
+
+  std::vector<char> current;
+  rc = table->fetch_record(record->rid, current);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  const FieldMeta *trx_field = table->table_meta().trx_field();
+  int64_t current_trx = 0;
+  bool current_deleted = false;
+  read_trx_field(trx_field, current.data(), current_trx, current_deleted);
+  int64_t record_trx = 0;
+  bool record_deleted = false;
+  read_trx_field(trx_field, record->data, record_trx, record_deleted);
+  if (current_trx != record_trx || current_deleted || record_deleted)
+  {
+    // 扫描看到的是更早的版本，等锁的时候其它事务提交了新的版本
+    LOG_WARN("Write conflict on record rid=%d.%d, trx=%ld", record->rid.page_num, record->rid.slot_num, trx_id_);
+    return RC::BUSY_SNAPSHOT;
+  }
+  std::vector<char> undo;
+  encode_undo(current.data(), ranges, range_num, undo);
+
+  {
+    std::lock_guard<std::mutex> lock(mvcc_mutex);
+    std::unordered_map<uint64_t, VersionChain> &table_versions = versions[table];
+    const uint64_t key = rid_key(record->rid);
+    auto chain_iter = table_versions.find(key);
+    // 最新的版本是没有结束的事务修改的，或者有事务已经保存了版本但是还没有修改页面
+    const bool conflict = (current_trx != 0 && active_trx.count(current_trx) != 0) ||
+                          (chain_iter != table_versions.end() && chain_iter->second.back().trx_id != current_trx);
+    RecordVersion version{trx_id_, current_trx, current_deleted, UndoPtr()};
+    // undo文件在表中没有旧版本时会从头复用，要在锁内追加
+    if (!conflict && !undo.empty())
+    {
+      rc = table->undo_file()->append(undo.data(), (int)undo.size(), &version.undo);
+    }
+    if (conflict || rc != RC::SUCCESS)
     {
-      // 每次更新都会删除上次更新的记录
-      // 即整个事务最多一次update
-      // 每次更新都会删除上次更新/插入的记录
-      // 即整个事务最多一次update或insert
-      delete_operation(table, record->rid);
+      if (table_versions.empty())
+      {
+        versions.erase(table);
+      }
+      if (conflict)
+      {
+        LOG_WARN("Write conflict on record rid=%d.%d, trx=%ld", record->rid.page_num, record->rid.slot_num, trx_id_);
+        return RC::BUSY_SNAPSHOT;
+      }
+      LOG_ERROR("Failed to append undo record of trx %ld. rid=%d.%d, rc=%d:%s",
+                trx_id_, record->rid.page_num, record->rid.slot_num, rc, strrc(rc));
+      return rc;
     }
+    table_versions[key].push_back(version);
+  }
+
+  RedoLog &redo_log = RedoLog::instance();
+  if (redo_log.enabled() && !table->in_memory())
+  {
+    // 页面上的版本已经提交了，崩溃恢复只需要回滚到这个版本，不需要它的事务号
+    write_trx_field(trx_field, current.data(), 0, false);
+    redo_log.append_undo(trx_id_, table->name(), record->rid.page_num, record->rid.slot_num, current.data(),
+                         (int)current.size());
   }
+  insert_operation(table, type, record->rid);
+  log_savepoint_undo(table, record->rid, type, nullptr);
+  return RC::SUCCESS;
+}
 
-  // digeset：相当于rid的哈希函数
-  reocrd_data_map_[digest_(record->rid)] = new_record_data;
+RC Trx::update_record(Table *table, Record *record, const UndoRange *ranges, int range_num)
+{
+  RC rc = prepare_modify(table, record, Operation::Type::UPDATE, ranges, range_num);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
   set_record_trx_id(table, *record, trx_id_, false);
-  insert_operation(table, Operation::Type::UPDATE, record->rid);
-  LOG_ERROR("finish update");
   return RC::SUCCESS;
 }
 
@@ -101,67 +590,62 @@ RC Trx::insert_record(Table *table, Record *record)
 
   start_if_not_started();
 
-  // 设置record中trx_field为当前的事务号
-  // commit insert的时候会将事务号设置为0，所以这里不用设置？
-  // set_record_trx_id(table, *record, trx_id_, false);
+  // 记录中的事务字段已经在init_trx_info中设置为当前的事务号
   // 记录到operations中
   insert_operation(table, Operation::Type::INSERT, record->rid);
+  log_savepoint_undo(table, record->rid, Operation::Type::INSERT, nullptr);
   return rc;
 }
 
-RC Trx::delete_record(Table *table, Record *record)
+RC Trx::insert_records(Table *table, Record *records, int record_num)
 {
-  ("delete_record record: %d - %d", record->rid.page_num, record->rid.slot_num);
-  RC rc = RC::SUCCESS;
-  start_if_not_started();
-  Operation *old_oper = find_operation(table, record->rid);
-  // 原代码
-  if (old_oper != nullptr)
+  // 一批记录只查找一次表的操作集合，并且一次预留好空间
+  OperationSet &table_operations = operations_[table];
+  for (int i = 0; i < record_num; i++)
   {
-    if (old_oper->type() != Operation::Type::DELETE)
+    if (table_operations.find(Operation(Operation::Type::UNDEFINED, records[i].rid)) != table_operations.end())
     {
-      // 上次操作是插入或更新，删除即为撤销
-      delete_operation(table, record->rid);
-      return RC::SUCCESS;
-    }
-    else
-    {
-      return RC::GENERIC_ERROR;
+      return RC::GENERIC_ERROR; // error code
     }
   }
 
-  // if (old_oper != nullptr)
-  // {
-  //   if (old_oper->type() == Operation::Type::DELETE)
-  //   {
-  //     return RC::GENERIC_ERROR;
-  //   }
-  //   // 上次操作是插入或更新，删除即为撤销
-  //   delete_operation(table, record->rid);
-  // }
-
-  set_record_trx_id(table, *record, trx_id_, true);
-  insert_operation(table, Operation::Type::DELETE, record->rid);
-  return rc;
+  start_if_not_started();
+  table_operations.reserve(table_operations.size() + record_num);
+  for (int i = 0; i < record_num; i++)
+  {
+    table_operations.emplace(Operation::Type::INSERT, records[i].rid);
+    table->page_visibility().add(records[i].rid.page_num);
+    log_savepoint_undo(table, records[i].rid, Operation::Type::INSERT, nullptr);
+  }
+  return RC::SUCCESS;
 }
 
-void Trx::set_record_trx_id(Table *table, Record &record, int32_t trx_id, bool deleted) const
+RC Trx::delete_record(Table *table, Record *record)
 {
-  const FieldMeta *trx_field = table->table_meta().trx_field();
-  int32_t *ptrx_id = (int32_t *)(record.data + trx_field->offset());
-  if (deleted)
+  // 删除只设置删除标记，索引和记录在清理时删除。当前事务插入的记录也一样，其它事务本来就看不到它
+  const Operation *old_oper = find_operation(table, record->rid);
+  const bool modified = old_oper != nullptr && old_oper->type() != Operation::Type::DELETE;
+  RC rc = prepare_modify(table, record, Operation::Type::DELETE, nullptr, 0);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
+  if (modified)
   {
-    trx_id |= DELETED_FLAG_BIT_MASK;
+    deleted_after_modify_[table].insert(rid_key(record->rid));
   }
-  *ptrx_id = trx_id;
+  set_record_trx_id(table, *record, trx_id_, true);
+  return RC::SUCCESS;
 }
 
-void Trx::get_record_trx_id(Table *table, const Record &record, int32_t &trx_id, bool &deleted)
+void Trx::set_record_trx_id(Table *table, Record &record, int64_t trx_id, bool deleted) const
 {
-  const FieldMeta *trx_field = table->table_meta().trx_field();
-  int32_t trx = *(int32_t *)(record.data + trx_field->offset());
-  trx_id = trx & TRX_ID_BIT_MASK;
-  deleted = (trx & DELETED_FLAG_BIT_MASK) != 0;
+  write_trx_field(table->table_meta().trx_field(), record.data, trx_id, deleted);
+}
+
+void Trx::get_record_trx_id(Table *table, const Record &record, int64_t &trx_id, bool &deleted)
+{
+  read_trx_field(table->table_meta().trx_field(), record.data, trx_id, deleted);
 }
 
 Operation *Trx::find_operation(Table *table, const RID &rid)
@@ -185,7 +669,10 @@ Operation *Trx::find_operation(Table *table, const RID &rid)
 void Trx::insert_operation(Table *table, Operation::Type type, const RID &rid)
 {
   OperationSet &table_operations = operations_[table];
-  table_operations.emplace(type, rid);
+  if (table_operations.emplace(type, rid).second)
+  {
+    table->page_visibility().add(rid.page_num);
+  }
 }
 
 void Trx::delete_operation(Table *table, const RID &rid)
@@ -202,166 +689,586 @@ void Trx::delete_operation(Table *table, const RID &rid)
   int delete_size = table_operations_iter->second.size();
 }
 
+/**
+ * 取出事务在table上修改之前和提交之后的记录，用来更新table上的物化视图。提交之前调用，这时记录上还有事务字段，
+ * 也还持有记录锁，修改之前的版本按版本链中这个事务的undo记录恢复
+ */
+static RC collect_record_changes(Table *table, int64_t trx_id, const std::vector<Operation> &operations,
+                                 RecordChanges &changes)
+{
+  std::vector<char> data;
+  RecordPageHandler cursor;
+  for (const Operation &operation : operations)
+  {
+    RID rid;
+    rid.page_num = operation.page_num();
+    rid.slot_num = operation.slot_num();
+    RC rc = table->fetch_record(rid, data, &cursor);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to fetch record of trx %ld. table=%s, rid=%d.%d, rc=%d:%s",
+                trx_id, table->name(), rid.page_num, rid.slot_num, rc, strrc(rc));
+      return rc;
+    }
+    int64_t record_trx = 0;
+    bool deleted = false;
+    read_trx_field(table->table_meta().trx_field(), data.data(), record_trx, deleted);
+    if (operation.type() != Operation::Type::INSERT)
+    {
+      std::vector<char> old_data = data;
+      std::lock_guard<std::mutex> lock(mvcc_mutex);
+      const RecordVersion *version = find_version_locked(table, rid, trx_id);
+      rc = version == nullptr ? RC::GENERIC_ERROR : undo_version_locked(table, *version, old_data.data());
+      if (rc != RC::SUCCESS)
+      {
+        LOG_ERROR("Failed to find the version before trx %ld. table=%s, rid=%d.%d, rc=%d:%s",
+                  trx_id, table->name(), rid.page_num, rid.slot_num, rc, strrc(rc));
+        return rc;
+      }
+      changes.old_records.push_back(std::move(old_data));
+    }
+    if (operation.type() != Operation::Type::DELETE && !deleted)
+    {
+      changes.new_records.push_back(data);
+    }
+  }
+  return RC::SUCCESS;
+}
+
 RC Trx::commit()
 {
+  common::TraceSpanScope span("storage", "trx_commit");
   RC rc = RC::SUCCESS;
+  // 记录数文件要在提交点之前标记为不完整，崩溃恢复出这个事务时不会用到旧的记录数
+  std::vector<std::pair<Table *, int64_t>> row_deltas;
   for (const auto &table_operations : operations_)
   {
-    Table *table = table_operations.first;
-    const OperationSet &operation_set = table_operations.second;
-    for (const Operation &operation : operation_set)
+    const int64_t delta = committed_row_delta(table_operations.first, table_operations.second);
+    if (delta != 0)
     {
+      table_operations.first->row_count().begin_change();
+      row_deltas.emplace_back(table_operations.first, delta);
+    }
+  }
 
-      RID rid;
-      rid.page_num = operation.page_num();
-      rid.slot_num = operation.slot_num();
-
-      switch (operation.type())
-      {
-      case Operation::Type::INSERT:
+  // 提交点: 事务修改过的页面和提交记录落盘之后事务就提交了，
+  // 之后清除记录上的事务字段只修改缓冲池中的页面，崩溃之后由恢复完成提交
+  RedoLog &redo_log = RedoLog::instance();
+  const bool log_commit = !operations_.empty() && redo_log.enabled();
+  if (log_commit)
+  {
+    rc = log_global_buffer_pool_pages(trx_id_, synchronous_commit_);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to write commit log of trx %ld, rollback it. rc=%d:%s", trx_id_, rc, strrc(rc));
+      for (const auto &row_delta : row_deltas)
       {
-        rc = table->commit_insert(this, rid);
-        if (rc != RC::SUCCESS)
-        {
-          // handle rc
-          LOG_ERROR("Failed to commit insert operation. rid=%d.%d, rc=%d:%s",
-                    rid.page_num, rid.slot_num, rc, strrc(rc));
-        }
+        row_delta.first->row_count().end_change(0);
       }
-      break;
-      case Operation::Type::DELETE:
+      redo_log.end_commit(trx_id_);
+      rollback();
+      return rc;
+    }
+  }
+  else
+  {
+    // 不经过事务的修改(比如DDL)在语句结束时写到日志中
+    rc = log_global_buffer_pool_pages();
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to write redo log of statement. rc=%d:%s", rc, strrc(rc));
+    }
+  }
+  redo_log.end_undo(trx_id_);
+
+  // 有物化视图的表，提交之后用修改前后的记录更新视图
+  std::vector<std::pair<Table *, RecordChanges>> view_changes;
+  std::vector<Table *> stale_view_tables;
+  if (!operations_.empty())
+  {
+    // 在锁外排好序，清理时按页面顺序进行
+    std::unordered_map<Table *, std::vector<Operation>> operations;
+    for (const auto &table_operations : operations_)
+    {
+      operations.emplace(table_operations.first, sorted_operations(table_operations.second));
+    }
+    for (const auto &table_operations : operations)
+    {
+      Table *table = table_operations.first;
+      if (!table->has_materialized_views())
       {
-        rc = table->commit_delete(this, rid);
-        if (rc != RC::SUCCESS)
-        {
-          // handle rc
-          LOG_ERROR("Failed to commit delete operation. rid=%d.%d, rc=%d:%s",
-                    rid.page_num, rid.slot_num, rc, strrc(rc));
-        }
+        continue;
       }
-      break;
-      case Operation::Type::UPDATE:
+      RecordChanges changes;
+      if (collect_record_changes(table, trx_id_, table_operations.second, changes) == RC::SUCCESS)
       {
-        char *new_record_data = reocrd_data_map_[digest_(rid)];
-        if (new_record_data == nullptr)
-        {
-          LOG_ERROR("new_record_data is nullptr, can not update record");
-          rc = RC::GENERIC_ERROR;
-        }
-        else
-        {
-          rc = table->commit_update(this, rid, new_record_data);
-        }
+        view_changes.emplace_back(table, std::move(changes));
       }
-      break;
-      default:
+      else
       {
-        LOG_PANIC("Unknown operation. type=%d", (int)operation.type());
-      }
-      break;
+        stale_view_tables.push_back(table);
       }
     }
+
+    // 分配提交序号和离开活跃事务集合要同时完成，读视图看到的事务要么没有提交要么有提交序号
+    std::lock_guard<std::mutex> lock(mvcc_mutex);
+    const uint64_t commit_ts = ++commit_seq;
+    for (auto &table_changes : view_changes)
+    {
+      table_changes.second.commit_ts = commit_ts;
+    }
+    committed_trx[trx_id_] = commit_ts;
+    committed_trx_num++;
+    active_trx.erase(trx_id_);
+    purge_queue.push_back(PurgeItem{commit_ts, trx_id_, std::move(operations)});
+    // 记录数的变化和提交序号一起对新的读视图可见
+    for (const auto &row_delta : row_deltas)
+    {
+      row_delta.first->row_count().end_change(row_delta.second);
+    }
   }
 
   operations_.clear();
-  trx_id_ = 0;
+  finish();
+
+  // 视图表的修改在视图内部的事务中提交，视图表本身没有视图
+  for (Table *table : stale_view_tables)
+  {
+    for (MaterializedView *view : table->materialized_views())
+    {
+      view->mark_stale();
+    }
+  }
+  for (const auto &table_changes : view_changes)
+  {
+    for (MaterializedView *view : table_changes.first->materialized_views())
+    {
+      RC view_rc = view->apply(table_changes.second);
+      if (view_rc != RC::SUCCESS)
+      {
+        LOG_ERROR("Failed to update materialized view %s of table %s. rc=%d:%s",
+                  view->name(), table_changes.first->name(), view_rc, strrc(view_rc));
+      }
+    }
+  }
+  return rc;
+}
+
+int64_t Trx::committed_row_delta(Table *table, const OperationSet &operations)
+{
+  int64_t delta = 0;
+  for (const Operation &operation : operations)
+  {
+    if (operation.type() == Operation::Type::INSERT)
+    {
+      delta++;
+    }
+    else if (operation.type() == Operation::Type::DELETE)
+    {
+      delta--;
+    }
+  }
+
+  auto deleted_iter = deleted_after_modify_.find(table);
+  if (deleted_iter == deleted_after_modify_.end())
+  {
+    return delta;
+  }
+  // 回滚到保存点可能撤销了删除，也可能撤销了整个操作。key按rid排序，同一个页面上的记录连续读取
+  std::vector<char> data;
+  RecordPageHandler cursor;
+  for (uint64_t key : deleted_iter->second)
+  {
+    RID rid;
+    rid.page_num = (PageNum)(key >> 32);
+    rid.slot_num = (SlotNum)(key & 0xFFFFFFFF);
+    auto oper_iter = operations.find(Operation(Operation::Type::UNDEFINED, rid));
+    if (oper_iter == operations.end() || oper_iter->type() == Operation::Type::DELETE)
+    {
+      continue;
+    }
+    int64_t record_trx = 0;
+    bool deleted = false;
+    if (table->fetch_record(rid, data, &cursor) == RC::SUCCESS)
+    {
+      read_trx_field(table->table_meta().trx_field(), data.data(), record_trx, deleted);
+    }
+    if (deleted)
+    {
+      delta--;
+    }
+  }
+  return delta;
+}
+
+RC Trx::rollback_operation(Table *table, const Operation &operation)
+{
+  RC rc = RC::SUCCESS;
+  RID rid;
+  rid.page_num = operation.page_num();
+  rid.slot_num = operation.slot_num();
+
+  switch (operation.type())
+  {
+  case Operation::Type::INSERT:
+  {
+    rc = table->rollback_insert(this, rid);
+    if (rc != RC::SUCCESS)
+    {
+      // handle rc
+      LOG_ERROR("Failed to rollback insert operation. rid=%d.%d, rc=%d:%s",
+                rid.page_num, rid.slot_num, rc, strrc(rc));
+    }
+  }
+  break;
+  case Operation::Type::DELETE:
+  case Operation::Type::UPDATE:
+  {
+    // 在页面上的记录上应用自己的undo记录，恢复成修改之前的版本，版本链中的版本在页面恢复之后才删除
+    std::vector<char> data;
+    rc = table->fetch_record(rid, data);
+    if (rc == RC::SUCCESS)
+    {
+      std::lock_guard<std::mutex> lock(mvcc_mutex);
+      const RecordVersion *version = find_version_locked(table, rid, trx_id_);
+      rc = version == nullptr ? RC::GENERIC_ERROR : undo_version_locked(table, *version, data.data());
+    }
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to find the version before trx %ld. rid=%d.%d, rc=%d:%s",
+                trx_id_, rid.page_num, rid.slot_num, rc, strrc(rc));
+      break;
+    }
+    rc = table->restore_record(rid, data.data(), operation.type() == Operation::Type::UPDATE);
+    if (rc != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to rollback %s operation. rid=%d.%d, rc=%d:%s",
+                operation.type() == Operation::Type::UPDATE ? "update" : "delete",
+                rid.page_num, rid.slot_num, rc, strrc(rc));
+    }
+  }
+  break;
+  default:
+  {
+    LOG_PANIC("Unknown operation. type=%d", (int)operation.type());
+  }
+  break;
+  }
   return rc;
 }
 
 RC Trx::rollback()
 {
   RC rc = RC::SUCCESS;
+  std::unordered_map<Table *, std::vector<Operation>> operations;
   for (const auto &table_operations : operations_)
+  {
+    operations.emplace(table_operations.first, sorted_operations(table_operations.second));
+  }
+  for (const auto &table_operations : operations)
   {
     Table *table = table_operations.first;
-    const OperationSet &operation_set = table_operations.second;
-    for (const Operation &operation : operation_set)
+    for (const Operation &operation : table_operations.second)
     {
+      rc = rollback_operation(table, operation);
+      table->page_visibility().remove(operation.page_num());
+    }
+  }
 
-      RID rid;
-      rid.page_num = operation.page_num();
-      rid.slot_num = operation.slot_num();
+  if (!operations.empty())
+  {
+    std::lock_guard<std::mutex> lock(mvcc_mutex);
+    for (const auto &table_operations : operations)
+    {
+      remove_versions_locked(table_operations.first, table_operations.second, trx_id_);
+    }
+  }
+  RedoLog::instance().end_undo(trx_id_);
 
-      switch (operation.type())
-      {
-      case Operation::Type::INSERT:
-      {
-        rc = table->rollback_insert(this, rid);
-        if (rc != RC::SUCCESS)
-        {
-          // handle rc
-          LOG_ERROR("Failed to rollback insert operation. rid=%d.%d, rc=%d:%s",
-                    rid.page_num, rid.slot_num, rc, strrc(rc));
-        }
-      }
-      break;
-      case Operation::Type::DELETE:
-      {
-        rc = table->rollback_delete(this, rid);
-        if (rc != RC::SUCCESS)
-        {
-          // handle rc
-          LOG_ERROR("Failed to rollback delete operation. rid=%d.%d, rc=%d:%s",
-                    rid.page_num, rid.slot_num, rc, strrc(rc));
-        }
-      }
+  operations_.clear();
+  finish();
+  return rc;
+}
+
+void Trx::savepoint(const char *name)
+{
+  for (auto iter = savepoints_.begin(); iter != savepoints_.end(); ++iter)
+  {
+    if (iter->first == name)
+    {
+      savepoints_.erase(iter);
       break;
-      // TODO(xiong): 先不写roll back
-      // case Operation::Type::UPDATE:
-      // {
-      //   rc = table->rollback_update(this, rid);
-      //   if (rc != RC::SUCCESS)
-      //   {
-      //     // handle rc
-      //     LOG_ERROR("Failed to rollback delete operation. rid=%d.%d, rc=%d:%s",
-      //               rid.page_num, rid.slot_num, rc, strrc(rc));
-      //   }
-      // }
-      // break;
-      default:
+    }
+  }
+  savepoints_.emplace_back(name, savepoint_undo_.size());
+  savepoint_images_.clear();
+}
+
+RC Trx::rollback_to_savepoint(const char *name)
+{
+  auto iter = savepoints_.rbegin();
+  while (iter != savepoints_.rend() && iter->first != name)
+  {
+    ++iter;
+  }
+  if (iter == savepoints_.rend())
+  {
+    LOG_WARN("No such savepoint: %s", name);
+    return RC::NOTFOUND;
+  }
+  const size_t undo_pos = iter->second;
+  savepoints_.erase(iter.base(), savepoints_.end());
+
+  // 从后往前撤销，同一条记录最早的一次修改最后撤销
+  RC rc = RC::SUCCESS;
+  while (savepoint_undo_.size() > undo_pos)
+  {
+    const SavepointUndo &undo = savepoint_undo_.back();
+    RC rc2 = RC::SUCCESS;
+    if (!undo.first)
+    {
+      rc2 = undo.table->restore_record(undo.rid, undo.image.data(), true);
+    }
+    else if (Operation *operation = find_operation(undo.table, undo.rid))
+    {
+      const Operation undone = *operation;
+      rc2 = rollback_operation(undo.table, undone);
+      if (undone.type() != Operation::Type::INSERT)
       {
-        LOG_PANIC("Unknown operation. type=%d", (int)operation.type());
-      }
-      break;
+        std::lock_guard<std::mutex> lock(mvcc_mutex);
+        remove_versions_locked(undo.table, std::vector<Operation>(1, undone), trx_id_);
       }
+      delete_operation(undo.table, undo.rid);
     }
+    if (rc2 != RC::SUCCESS)
+    {
+      LOG_ERROR("Failed to rollback record to savepoint %s. rid=%d.%d, rc=%d:%s",
+                name, undo.rid.page_num, undo.rid.slot_num, rc2, strrc(rc2));
+      rc = rc2;
+    }
+    savepoint_undo_.pop_back();
   }
-
-  operations_.clear();
-  trx_id_ = 0;
+  savepoint_images_.clear();
   return rc;
 }
 
-RC Trx::commit_insert(Table *table, Record &record)
+RC Trx::release_savepoint(const char *name)
 {
-  set_record_trx_id(table, record, 0, false);
+  auto iter = savepoints_.rbegin();
+  while (iter != savepoints_.rend() && iter->first != name)
+  {
+    ++iter;
+  }
+  if (iter == savepoints_.rend())
+  {
+    LOG_WARN("No such savepoint: %s", name);
+    return RC::NOTFOUND;
+  }
+  // 之后建立的保存点一起释放
+  savepoints_.erase(iter.base() - 1, savepoints_.end());
+  if (savepoints_.empty())
+  {
+    savepoint_undo_.clear();
+    savepoint_images_.clear();
+  }
   return RC::SUCCESS;
 }
 
-RC Trx::rollback_delete(Table *table, Record &record)
+void Trx::begin_statement()
 {
-  set_record_trx_id(table, record, 0, false);
-  return RC::SUCCESS;
+  savepoint("");
+}
+
+RC Trx::end_statement(bool success)
+{
+  RC rc = success ? RC::SUCCESS : rollback_to_savepoint("");
+  release_savepoint("");
+  return rc;
 }
 
-bool Trx::is_visible(Table *table, const Record *record)
+void Trx::log_savepoint_undo(Table *table, const RID &rid, Operation::Type type, const char *image)
 {
-  int32_t record_trx_id;
+  if (savepoints_.empty())
+  {
+    return;
+  }
+  if (!savepoint_images_[table].insert(rid_key(rid)).second)
+  {
+    // 最新的保存点之后已经记录过，回滚到任何保存点时都会恢复成那次记录的样子
+    return;
+  }
+  SavepointUndo undo{table, rid, type, image == nullptr, std::vector<char>()};
+  if (image != nullptr)
+  {
+    undo.image.assign(image, image + table->record_data_size());
+  }
+  savepoint_undo_.push_back(std::move(undo));
+}
+
+uint64_t Trx::read_view()
+{
+  acquire_read_view();
+  return read_view_;
+}
+
+void Trx::acquire_read_view()
+{
+  std::lock_guard<std::mutex> lock(mvcc_mutex);
+  if (!has_read_view_)
+  {
+    read_view_ = commit_seq;
+    read_views.insert(read_view_);
+    has_read_view_ = true;
+  }
+}
+
+bool Trx::is_visible(Table *table, Record *record, std::vector<char> &version)
+{
+  int64_t record_trx_id;
   bool record_deleted;
   get_record_trx_id(table, *record, record_trx_id, record_deleted);
 
-  // 0 表示这条数据已经提交
+  // 0 表示这条数据已经提交，并且所有的读视图都能看到
   if (0 == record_trx_id || record_trx_id == trx_id_)
   {
     return !record_deleted;
   }
+  if (replica_mode.load())
+  {
+    return ReplicaClient::instance().is_visible(table, record, record_trx_id, record_deleted, version);
+  }
+
+  std::lock_guard<std::mutex> lock(mvcc_mutex);
+  const VersionChain *chain = nullptr;
+  std::vector<char> data;
+  while (record_trx_id != 0 && record_trx_id != trx_id_)
+  {
+    auto committed_iter = committed_trx.find(record_trx_id);
+    if (committed_iter != committed_trx.end())
+    {
+      if (current_read_ || !has_read_view_ || committed_iter->second <= read_view_)
+      {
+        break;
+      }
+    }
+    else if (active_trx.count(record_trx_id) == 0)
+    {
+      // 已经清理过的事务，所有读视图都能看到它
+      break;
+    }
+
+    // 这个版本对读视图不可见，在版本链中找到record_trx_id修改之前的版本
+    if (nullptr == chain)
+    {
+      auto table_iter = versions.find(table);
+      if (table_iter == versions.end())
+      {
+        return false;
+      }
+      auto chain_iter = table_iter->second.find(rid_key(record->rid));
+      if (chain_iter == table_iter->second.end())
+      {
+        return false;
+      }
+      chain = &chain_iter->second;
+    }
+    const RecordVersion *previous = nullptr;
+    for (auto iter = chain->rbegin(); iter != chain->rend(); ++iter)
+    {
+      if (iter->trx_id == record_trx_id)
+      {
+        previous = &*iter;
+        break;
+      }
+    }
+    if (nullptr == previous)
+    {
+      // 记录是record_trx_id插入的
+      return false;
+    }
+    // 从页面上的版本开始，每次撤销一个事务的修改
+    if (data.empty())
+    {
+      data.assign(record->data, record->data + table->record_data_size());
+    }
+    if (undo_version_locked(table, *previous, data.data()) != RC::SUCCESS)
+    {
+      return false;
+    }
+    record_trx_id = previous->prev_trx_id;
+    record_deleted = previous->prev_deleted;
+  }
+
+  if (record_deleted)
+  {
+    return false;
+  }
+  if (!data.empty())
+  {
+    version.swap(data);
+    record->data = version.data();
+  }
+  return true;
+}
 
-  return record_deleted; // 当前记录上面有事务号，说明是未提交数据，那么如果有删除标记的话，就表示是未提交的删除
+bool Trx::all_visible(Table *table) const
+{
+  // 已经提交的事务还没有清理时，记录上的事务号对有的读视图不可见
+  if (committed_trx_num.load() > 0 || replica_mode.load())
+  {
+    return false;
+  }
+  int active_num = active_trx_count();
+  if (active_num == 0)
+  {
+    return true;
+  }
+  if (active_num > 1 || trx_id_ == 0)
+  {
+    return false;
+  }
+  auto table_operations_iter = operations_.find(table);
+  return table_operations_iter == operations_.end() || table_operations_iter->second.empty();
 }
 
-void Trx::init_trx_info(Table *table, Record &record)
+bool Trx::latest_row_count(Table *table, int64_t *count, uint64_t *epoch)
 {
+  if (replica_mode.load())
+  {
+    // 备库的记录数是打开表时的值，不随重放更新
+    return false;
+  }
+  auto table_operations_iter = operations_.find(table);
+  if (table_operations_iter != operations_.end() && !table_operations_iter->second.empty())
+  {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mvcc_mutex);
+  if (!has_read_view_)
+  {
+    read_view_ = commit_seq;
+    read_views.insert(read_view_);
+    has_read_view_ = true;
+  }
+  if (read_view_ != commit_seq)
+  {
+    return false;
+  }
+  table->row_count().get(count, epoch);
+  return true;
+}
+
+RC Trx::init_trx_info(Table *table, Record &record)
+{
+  // 记录写入之前调用，事务的第一条记录也要带上事务号，恢复时靠它回滚没有提交的插入
+  start_if_not_started();
+  RC rc = check_trx_field(table, trx_id_);
+  if (rc != RC::SUCCESS)
+  {
+    return rc;
+  }
   set_record_trx_id(table, record, trx_id_, false);
+  return RC::SUCCESS;
 }
 
 void Trx::start_if_not_started()
@@ -369,5 +1276,39 @@ void Trx::start_if_not_started()
   if (trx_id_ == 0)
   {
     trx_id_ = next_trx_id();
+    {
+      std::lock_guard<std::mutex> lock(mvcc_mutex);
+      active_trx.insert(trx_id_);
+    }
+    active_trx_num++;
   }
-}
\ No newline at end of file
+}
+
+void Trx::finish()
+{
+  {
+    std::lock_guard<std::mutex> lock(mvcc_mutex);
+    if (has_read_view_)
+    {
+      read_views.erase(read_views.find(read_view_));
+      has_read_view_ = false;
+    }
+    if (trx_id_ != 0)
+    {
+      active_trx.erase(trx_id_);
+    }
+  }
+  if (trx_id_ != 0)
+  {
+    active_trx_num--;
+  }
+  // 提交序号已经分配、回滚已经恢复了页面，等锁的事务醒来之后能看到结果
+  LockManager::instance().release(trx_id_, locks_);
+  locks_.clear();
+  trx_id_ = 0;
+  savepoints_.clear();
+  savepoint_undo_.clear();
+  savepoint_images_.clear();
+  deleted_after_modify_.clear();
+  purge_committed_trx();
+}
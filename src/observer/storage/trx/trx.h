@@ -16,17 +16,21 @@ See the Mulan PSL v2 for more details. */
 #define __OBSERVER_STORAGE_TRX_TRX_H_
 
 #include <stddef.h>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <mutex>
+#include <vector>
 
 #include "sql/parser/parse.h"
 #include "storage/common/record_manager.h"
+#include "storage/trx/lock_manager.h"
 #include "rc.h"
 
+#define TRX_ID_BLOCK_SIZE 64
+
 class Table;
 class RID;
-class RidDigest;
 
 class Operation
 {
@@ -40,7 +44,7 @@ public:
   };
 
 public:
-  Operation(Type type, const RID &rid, char *new_record_data = nullptr) : type_(type), page_num_(rid.page_num), slot_num_(rid.slot_num), new_record_data_(new_record_data)
+  Operation(Type type, const RID &rid) : type_(type), page_num_(rid.page_num), slot_num_(rid.slot_num)
   {
   }
 
@@ -59,17 +63,20 @@ public:
     return slot_num_;
   }
 
-  char *new_record_data() const
-  {
-    return new_record_data_;
-  }
-
 private:
   Type type_;
   PageNum page_num_;
   SlotNum slot_num_;
-  char *new_record_data_;
 };
+/**
+ * 更新时被修改的一段记录数据，按table_meta排列的定长格式中的偏移和长度
+ */
+struct UndoRange
+{
+  int offset;
+  int len;
+};
+
 class OperationHasher
 {
 public:
@@ -90,17 +97,57 @@ public:
 };
 
 /**
- * 这里是一个简单的事务实现，可以支持提交/回滚。但是没有对并发访问做控制
- * 可以在这个基础上做备份恢复，当然也可以重写
+ * 多版本并发控制的事务。
+ * 记录上的事务字段是最后修改它的事务号和删除标记，更新和删除都直接修改页面上的记录，
+ * 第一次修改一条记录之前把被修改的字段原来的值追加到表的undo文件中，内存中的版本链只保存修改之前的事务字段和undo记录的位置，
+ * 按修改它的事务号查找；完整的修改之前的记录写一份到redo日志中供崩溃后回滚。
+ * 旧版本从页面上的记录开始，沿着版本链依次应用undo记录得到，回滚也是在页面上的记录上应用自己的undo记录。
+ * 事务提交时分配递增的提交序号；读视图是获取时最新的提交序号，提交序号不大于它的事务对这个读视图可见，
+ * 没有提交的和之后提交的事务的修改沿着版本链找到更早的版本。
+ * 读视图在事务第一次读表时获取，直到提交或回滚，所以多语句事务是可重复读的，单条语句看到的是语句开始时的快照。
+ * 更新和删除是当前读，看到最新提交的版本。修改记录之前先加记录的排它锁，记录正在被其它事务修改时等它结束，
+ * 等到的是它提交的新版本时返回BUSY_SNAPSHOT；锁在事务结束时释放，死锁时返回LOCKED_DEADLOCK。
+ * 所有读视图都能看到一个已经提交的事务之后，清除它留在记录上的事务字段、删除它删掉的记录并丢弃它保存的版本
  */
 class Trx
 {
 public:
-  static int32_t default_trx_id();
-  static int32_t next_trx_id();
+  static int64_t default_trx_id();
+  /**
+   * 分配64位的事务号，每个线程一次预留TRX_ID_BLOCK_SIZE个
+   */
+  static int64_t next_trx_id();
   static const char *trx_field_name();
   static AttrType trx_field_type();
   static int trx_field_len();
+  /**
+   * 已经开始还没有提交或回滚的事务数。整理记录文件时会移动记录，只在没有事务时进行
+   */
+  static int active_trx_count();
+  /**
+   * 还有已经提交、但是因为有更早的读视图还没有清理的事务。版本链按记录的位置保存，这时也不能整理记录文件
+   */
+  static bool has_versions();
+  /**
+   * table中有记录的旧版本，也就是有别的事务修改过、还没有清理的记录。
+   * 没有旧版本时索引中的键就是每条记录可见的版本的键，只是记录可能不可见
+   */
+  static bool has_versions(Table *table);
+  /**
+   * 删除表之前调用，丢弃这张表的版本链和等待清理的修改
+   */
+  static void drop_table(Table *table);
+  /**
+   * 索引中只有记录最新的值，更早的版本可能不在索引扫描的结果中。把表中有旧版本的记录的位置补到rids中，
+   * 已经有的不重复加入。表中有旧版本时返回true，这时索引扫描出来的记录都要在可见的版本上重新判断条件
+   */
+  static bool add_version_rids(Table *table, std::vector<RID> &rids);
+  /**
+   * 备库上记录的可见性由从主库复制过来的提交记录和修改之前的内容决定，主库在内存中维护的
+   * 版本链、页面可见性、记录数和索引都不能用
+   */
+  static void set_replica(bool replica);
+  static bool replica();
 
 public:
   Trx();
@@ -108,40 +155,151 @@ public:
 
 public:
   RC insert_record(Table *table, Record *record);
+  /**
+   * 批量记录插入操作，有任何一条记录的操作已经存在时都不记录
+   */
+  RC insert_records(Table *table, Record *records, int record_num);
+  /**
+   * 删除和更新记录之前调用，先加记录的排它锁，加锁失败时返回LOCKED_DEADLOCK或BUSY_TIMEOUT。
+   * 加锁之后record需要是页面上最新的版本，否则返回BUSY_SNAPSHOT。成功时record中已经设置好了事务字段
+   */
   RC delete_record(Table *table, Record *record);
-  RC update_record(Table *table, Record *record, char *new_record_data);
+  /**
+   * ranges是这次更新要修改的数据，同一个事务多次更新同一条记录时也要保存新修改的字段原来的值
+   */
+  RC update_record(Table *table, Record *record, const UndoRange *ranges, int range_num);
 
   RC commit();
   RC rollback();
+  /**
+   * 关闭之后提交不等待redo日志落盘，崩溃时可能丢失最近RedoLogAsyncCommitLag毫秒内提交的事务
+   */
+  void set_synchronous_commit(bool synchronous_commit)
+  {
+    synchronous_commit_ = synchronous_commit;
+  }
 
-  RC commit_insert(Table *table, Record &record);
-  RC rollback_delete(Table *table, Record &record);
+  /**
+   * 保存点。回滚到保存点时撤销之后的修改，保存点本身保留，之后建立的保存点被删除，已经加的记录锁不释放。
+   * 同名的保存点替换之前的，事务结束时所有的保存点都被删除。找不到保存点时返回NOTFOUND
+   */
+  void savepoint(const char *name);
+  RC rollback_to_savepoint(const char *name);
+  RC release_savepoint(const char *name);
+  /**
+   * 多语句事务中的修改语句开始之前调用，相当于建立一个匿名的保存点。
+   * 语句失败时end_statement(false)只回滚这条语句的修改，事务可以继续执行
+   */
+  void begin_statement();
+  RC end_statement(bool success);
+  /**
+   * 事务已经开始，也就是有了修改，还没有提交或回滚
+   */
+  bool started() const
+  {
+    return trx_id_ != 0;
+  }
 
-  bool is_visible(Table *table, const Record *record);
+  /**
+   * 获取读视图，重复调用没有影响。扫描表之前调用，保证整个扫描看到的是同一个快照
+   */
+  void acquire_read_view();
+  /**
+   * 读视图中最新的提交序号，没有读视图时先获取。提交序号不大于它的事务都在这个快照中
+   */
+  uint64_t read_view();
+  /**
+   * 更新和删除时打开，扫描看到的是最新提交的版本而不是读视图中的版本
+   */
+  void set_current_read(bool current_read)
+  {
+    current_read_ = current_read;
+  }
+  /**
+   * record是页面上的记录，对当前事务可见时返回true。页面上的版本不可见但是有更早的可见版本时，
+   * 把这个版本复制到version中并让record->data指向它，过滤条件需要在这之后判断
+   */
+  bool is_visible(Table *table, Record *record, std::vector<char> &version);
+  /**
+   * 表中所有的记录对当前事务都可见，也就是没有其它未结束或者没有清理的事务，当前事务也没有修改过这张表。
+   * 这时读取记录时可以不检查记录上的事务字段
+   */
+  bool all_visible(Table *table) const;
+  /**
+   * 没有过滤条件的COUNT(*)使用表中维护的记录数之前调用。当前事务没有修改过table，
+   * 并且读视图(没有时获取)就是最新的提交状态时返回true，count和epoch是RowCount::get的结果
+   */
+  bool latest_row_count(Table *table, int64_t *count, uint64_t *epoch);
 
-  void init_trx_info(Table *table, Record &record);
+  /**
+   * 插入记录之前设置事务字段。之前建的表的事务字段只有32位，放不下当前的事务号时返回INTERNAL
+   */
+  RC init_trx_info(Table *table, Record &record);
 
-private:
-  void set_record_trx_id(Table *table, Record &record, int32_t trx_id, bool deleted) const;
-  static void get_record_trx_id(Table *table, const Record &record, int32_t &trx_id, bool &deleted);
+  /**
+   * 记录上的事务号和删除标记，恢复时据此完成或者回滚崩溃前的事务
+   */
+  static void get_record_trx_id(Table *table, const Record &record, int64_t &trx_id, bool &deleted);
 
-private:
   // OperationSet以rid作为计算作为哈希函数，与Operation::Type::UNDEFINED无关
   // 因此rid唯一则操作唯一
   using OperationSet = std::unordered_set<Operation, OperationHasher, OperationEqualer>;
 
+private:
+  void set_record_trx_id(Table *table, Record &record, int64_t trx_id, bool deleted) const;
+  /**
+   * 删除和更新的公共部分：检查写冲突，第一次修改已经提交的记录时保存原来的版本，ranges中的数据保存到undo文件中
+   */
+  RC prepare_modify(Table *table, Record *record, Operation::Type type, const UndoRange *ranges, int range_num);
+
+private:
   Operation *find_operation(Table *table, const RID &rid);
   void insert_operation(Table *table, Operation::Type type, const RID &rid);
   void delete_operation(Table *table, const RID &rid);
+  /**
+   * 回滚一条记录上的操作，恢复成事务修改之前的样子
+   */
+  RC rollback_operation(Table *table, const Operation &operation);
+  /**
+   * 事务提交之后table中已经提交的记录数的变化，operations是事务在table上的操作
+   */
+  int64_t committed_row_delta(Table *table, const OperationSet &operations);
+
+  /**
+   * 有保存点时记录之后的每次修改。image为nullptr表示这是事务第一次修改这条记录，
+   * 否则是修改之前的完整记录，只在最新的保存点之后第一次修改时保存
+   */
+  void log_savepoint_undo(Table *table, const RID &rid, Operation::Type type, const char *image);
 
 private:
   void start_if_not_started();
+  /**
+   * 提交或回滚之后释放读视图，然后清理所有读视图都能看到的已经提交的事务
+   */
+  void finish();
 
 private:
-  int32_t trx_id_ = 0;
+  int64_t trx_id_ = 0;
   std::unordered_map<Table *, OperationSet> operations_;
-  std::unordered_map<size_t, char *> reocrd_data_map_;
-  RidDigest digest_;
+  bool has_read_view_ = false;
+  uint64_t read_view_ = 0;  // 获取读视图时最新的提交序号
+  bool current_read_ = false;
+  bool synchronous_commit_ = true;
+  std::vector<LockKey> locks_;  // 持有的记录锁，事务结束时释放
+
+  struct SavepointUndo
+  {
+    Table *table;
+    RID rid;
+    Operation::Type type;
+    bool first;               // 事务第一次修改这条记录，回滚时整个操作都撤销
+    std::vector<char> image;  // first为false时是修改之前的记录
+  };
+  std::vector<std::pair<std::string, size_t>> savepoints_;  // 保存点的名字和建立时savepoint_undo_的长度
+  std::vector<SavepointUndo> savepoint_undo_;               // 最早的保存点之后的修改，按修改的顺序排列
+  std::unordered_map<Table *, std::unordered_set<uint64_t>> savepoint_images_;  // 最新的保存点之后已经记录过的rid
+  // 插入或者更新之后又删除的rid，操作类型仍然是INSERT或UPDATE，提交时看记录上的删除标记
+  std::unordered_map<Table *, std::unordered_set<uint64_t>> deleted_after_modify_;
 };
 
 #endif // __OBSERVER_STORAGE_TRX_TRX_H_
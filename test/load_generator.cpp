@@ -0,0 +1,345 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Load generator running a configurable mix of statements against an observer.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/defs.h"
+#include "common/metrics/latency_histogram.h"
+#include "common/metrics/latency_snapshot.h"
+#include "sql_connection.h"
+
+#define LOAD_BATCH_SIZE 100  // 准备数据时一条insert语句插入的行数
+
+using namespace common;
+
+enum OpType {
+  OP_POINT_SELECT,
+  OP_RANGE_SCAN,
+  OP_INSERT,
+  OP_UPDATE,
+  OP_JOIN,
+  OP_TYPE_NUM
+};
+
+static const char *OP_NAMES[OP_TYPE_NUM] = {"point", "range", "insert", "update", "join"};
+
+struct Options {
+  const char *host = LOCAL_HOST;
+  int port = PORT_DEFAULT;
+  const char *unix_socket_path = nullptr;
+  int threads = 8;
+  int connections = 8;      // 所有线程一共使用的连接数，每个线程轮流使用分给自己的连接
+  int duration = 60;        // 统计的时间，秒
+  int warmup = 10;          // 开始统计之前的预热时间，秒
+  int rows = 10000;         // 准备的数据行数，查询和更新的key在这个范围内
+  int range_size = 100;     // 范围查询覆盖的行数
+  bool prepare = true;      // 重新建表并导入数据
+  int weights[OP_TYPE_NUM] = {100, 0, 0, 0, 0};
+};
+
+static void usage(const char *program)
+{
+  fprintf(stderr,
+      "Usage: %s [options]\n"
+      "  -h host         server host, default %s\n"
+      "  -p port         server port, default %d\n"
+      "  -s path         unix socket path, used instead of host and port\n"
+      "  -t threads      concurrent client threads, default 8\n"
+      "  -c connections  total connections shared by the threads, default 8\n"
+      "  -d seconds      measured duration, default 60\n"
+      "  -w seconds      warmup before measuring, default 10\n"
+      "  -r rows         rows loaded into the tables, default 10000\n"
+      "  -l rows         rows covered by a range scan, default 100\n"
+      "  -m mix          weights of the operations, default point=100\n"
+      "                  for example point=50,range=20,insert=10,update=10,join=10\n"
+      "  -n              use the existing tables, do not load data\n",
+      program, LOCAL_HOST, PORT_DEFAULT);
+}
+
+/**
+ * 解析 point=50,range=20 格式的权重，没有出现的操作权重为0
+ */
+static bool parse_mix(const char *mix, int weights[OP_TYPE_NUM])
+{
+  for (int i = 0; i < OP_TYPE_NUM; i++) {
+    weights[i] = 0;
+  }
+  std::string text(mix);
+  size_t begin = 0;
+  int total = 0;
+  while (begin < text.size()) {
+    size_t end = text.find(',', begin);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    const std::string item = text.substr(begin, end - begin);
+    begin = end + 1;
+    const size_t eq = item.find('=');
+    if (eq == std::string::npos) {
+      return false;
+    }
+    const std::string name = item.substr(0, eq);
+    int op = 0;
+    while (op < OP_TYPE_NUM && name != OP_NAMES[op]) {
+      op++;
+    }
+    if (op == OP_TYPE_NUM) {
+      return false;
+    }
+    weights[op] = atoi(item.c_str() + eq + 1);
+    if (weights[op] < 0) {
+      return false;
+    }
+    total += weights[op];
+  }
+  return total > 0;
+}
+
+static std::atomic<bool> stopped(false);
+static std::atomic<int> next_insert_id(0);
+static LatencyHistogram histograms[OP_TYPE_NUM];
+static std::atomic<long> errors[OP_TYPE_NUM];
+
+/**
+ * load_t1(id, k, v) 和 load_t2(id, name)，id上都有索引，join按id连接
+ */
+static bool prepare_tables(const Options &options)
+{
+  SqlConnection connection;
+  if (!connection.open(options.host, options.port, options.unix_socket_path)) {
+    return false;
+  }
+  bool failed = false;
+  const char *ddl[] = {
+      "drop table load_t1;",
+      "drop table load_t2;",
+      "create table load_t1(id int, k int, v char(16));",
+      "create table load_t2(id int, name char(16));",
+      "create index load_t1_id on load_t1(id);",
+      "create index load_t2_id on load_t2(id);",
+  };
+  for (size_t i = 0; i < sizeof(ddl) / sizeof(ddl[0]); i++) {
+    // 表不存在时drop table失败，可以忽略
+    if (!connection.execute(ddl[i], &failed) || (failed && i >= 2)) {
+      fprintf(stderr, "Failed to execute: %s\n", ddl[i]);
+      return false;
+    }
+  }
+
+  for (int begin = 0; begin < options.rows; begin += LOAD_BATCH_SIZE) {
+    const int end = std::min(begin + LOAD_BATCH_SIZE, options.rows);
+    std::string t1 = "insert into load_t1 values ";
+    std::string t2 = "insert into load_t2 values ";
+    for (int id = begin; id < end; id++) {
+      const char *sep = id == begin ? "" : ",";
+      t1 += std::string(sep) + "(" + std::to_string(id) + "," + std::to_string(id % 1000) + ",'v" +
+            std::to_string(id) + "')";
+      t2 += std::string(sep) + "(" + std::to_string(id) + ",'n" + std::to_string(id) + "')";
+    }
+    t1 += ";";
+    t2 += ";";
+    if (!connection.execute(t1, &failed) || failed || !connection.execute(t2, &failed) || failed) {
+      fprintf(stderr, "Failed to load rows from %d to %d\n", begin, end);
+      return false;
+    }
+  }
+  printf("Loaded %d rows into load_t1 and load_t2\n", options.rows);
+  return true;
+}
+
+static std::string make_sql(OpType op, const Options &options, std::mt19937 &random)
+{
+  const int id = std::uniform_int_distribution<int>(0, std::max(options.rows - 1, 0))(random);
+  switch (op) {
+    case OP_POINT_SELECT:
+      return "select * from load_t1 where id=" + std::to_string(id) + ";";
+    case OP_RANGE_SCAN:
+      return "select * from load_t1 where id>=" + std::to_string(id) + " and id<" +
+             std::to_string(id + options.range_size) + ";";
+    case OP_INSERT: {
+      const int new_id = next_insert_id.fetch_add(1);
+      return "insert into load_t1 values (" + std::to_string(new_id) + "," + std::to_string(new_id % 1000) +
+             ",'i" + std::to_string(new_id) + "');";
+    }
+    case OP_UPDATE:
+      return "update load_t1 set k=" + std::to_string(random() % 1000) + " where id=" + std::to_string(id) + ";";
+    default:
+      return "select * from load_t1, load_t2 where load_t1.id=load_t2.id and load_t1.id=" + std::to_string(id) + ";";
+  }
+}
+
+static void run_client(const Options &options, int thread_index, std::vector<SqlConnection *> connections)
+{
+  int total_weight = 0;
+  for (int i = 0; i < OP_TYPE_NUM; i++) {
+    total_weight += options.weights[i];
+  }
+  std::mt19937 random(thread_index + 1);
+  size_t next_connection = 0;
+  while (!stopped.load(std::memory_order_relaxed)) {
+    int pick = random() % total_weight;
+    int op = 0;
+    while (pick >= options.weights[op]) {
+      pick -= options.weights[op];
+      op++;
+    }
+
+    const std::string sql = make_sql((OpType)op, options, random);
+    SqlConnection *connection = connections[next_connection];
+    next_connection = (next_connection + 1) % connections.size();
+    bool failed = false;
+    const uint64_t begin_us = LatencyHistogram::now_us();
+    if (!connection->execute(sql, &failed)) {
+      stopped = true;
+      break;
+    }
+    histograms[op].update(LatencyHistogram::now_us() - begin_us);
+    if (failed) {
+      errors[op]++;
+    }
+  }
+}
+
+static void report(double seconds)
+{
+  printf("%-8s %10s %10s %10s %10s %10s %10s %10s %10s %8s\n", "op", "count", "tps", "avg(us)", "p50(us)", "p90(us)",
+      "p99(us)", "p999(us)", "max(us)", "errors");
+  uint64_t total = 0;
+  for (int i = 0; i < OP_TYPE_NUM; i++) {
+    histograms[i].snapshot();
+    LatencySnapshot *snapshot = (LatencySnapshot *)histograms[i].get_snapshot();
+    if (snapshot->get_count() == 0) {
+      continue;
+    }
+    total += snapshot->get_count();
+    printf("%-8s %10lu %10.1f %10.1f %10.0f %10.0f %10.0f %10.0f %10.0f %8ld\n", OP_NAMES[i],
+        (unsigned long)snapshot->get_count(), snapshot->get_count() / seconds, snapshot->get_mean(),
+        snapshot->get_value(0.5), snapshot->get_value(0.9), snapshot->get_99th(), snapshot->get_999th(),
+        snapshot->get_max(), errors[i].load());
+  }
+  printf("%-8s %10lu %10.1f\n", "total", (unsigned long)total, total / seconds);
+}
+
+int main(int argc, char *argv[])
+{
+  Options options;
+  int opt;
+  while ((opt = getopt(argc, argv, "h:p:s:t:c:d:w:r:l:m:n")) > 0) {
+    switch (opt) {
+      case 'h':
+        options.host = optarg;
+        break;
+      case 'p':
+        options.port = atoi(optarg);
+        break;
+      case 's':
+        options.unix_socket_path = optarg;
+        break;
+      case 't':
+        options.threads = atoi(optarg);
+        break;
+      case 'c':
+        options.connections = atoi(optarg);
+        break;
+      case 'd':
+        options.duration = atoi(optarg);
+        break;
+      case 'w':
+        options.warmup = atoi(optarg);
+        break;
+      case 'r':
+        options.rows = atoi(optarg);
+        break;
+      case 'l':
+        options.range_size = atoi(optarg);
+        break;
+      case 'm':
+        if (!parse_mix(optarg, options.weights)) {
+          fprintf(stderr, "Invalid mix: %s\n", optarg);
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'n':
+        options.prepare = false;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (options.port <= 0 || options.port > 65535 || options.threads <= 0 || options.duration <= 0 ||
+      options.warmup < 0 || options.rows <= 0 || options.range_size <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+  // 每个线程至少有一个连接
+  options.connections = std::max(options.connections, options.threads);
+
+  if (options.prepare && !prepare_tables(options)) {
+    return 1;
+  }
+  // 新插入的id在准备的数据之后，多次运行时用当前时间区分，避免和上一次插入的重复
+  next_insert_id = options.rows + (options.prepare ? 0 : (int)(time(nullptr) % 100000) * 1000);
+
+  std::vector<SqlConnection *> connections;
+  for (int i = 0; i < options.connections; i++) {
+    SqlConnection *connection = new SqlConnection();
+    connections.push_back(connection);
+    if (!connection->open(options.host, options.port, options.unix_socket_path)) {
+      return 1;
+    }
+  }
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.threads; i++) {
+    std::vector<SqlConnection *> thread_connections;
+    for (int c = i; c < options.connections; c += options.threads) {
+      thread_connections.push_back(connections[c]);
+    }
+    threads.emplace_back(run_client, std::cref(options), i, thread_connections);
+  }
+
+  printf("Running %d threads on %d connections, warmup %ds, duration %ds\n", options.threads, options.connections,
+      options.warmup, options.duration);
+  sleep(options.warmup);
+  // 丢掉预热期间的统计
+  for (int i = 0; i < OP_TYPE_NUM; i++) {
+    histograms[i].snapshot();
+    errors[i] = 0;
+  }
+  const uint64_t begin_us = LatencyHistogram::now_us();
+  for (int i = 0; i < options.duration && !stopped; i++) {
+    sleep(1);
+  }
+  stopped = true;
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  report((LatencyHistogram::now_us() - begin_us) / 1000000.0);
+
+  for (SqlConnection *connection : connections) {
+    delete connection;
+  }
+  return 0;
+}
@@ -0,0 +1,141 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// A blocking client connection speaking the text protocol, shared by the load tools.
+//
+
+#ifndef __TEST_SQL_CONNECTION_H__
+#define __TEST_SQL_CONNECTION_H__
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <string>
+
+#define MAX_MEM_BUFFER_SIZE 8192
+#define PORT_DEFAULT 6789
+
+class SqlConnection {
+public:
+  ~SqlConnection()
+  {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  /**
+   * unix_socket_path不为nullptr时连接unix socket，否则连接host:port
+   */
+  bool open(const char *host, int port, const char *unix_socket_path)
+  {
+    if (unix_socket_path != nullptr) {
+      fd_ = socket(PF_UNIX, SOCK_STREAM, 0);
+      if (fd_ < 0) {
+        fprintf(stderr, "Failed to create unix socket. error=%s\n", strerror(errno));
+        return false;
+      }
+      struct sockaddr_un sockaddr;
+      memset(&sockaddr, 0, sizeof(sockaddr));
+      sockaddr.sun_family = PF_UNIX;
+      snprintf(sockaddr.sun_path, sizeof(sockaddr.sun_path), "%s", unix_socket_path);
+      if (connect(fd_, (struct sockaddr *)&sockaddr, sizeof(sockaddr)) < 0) {
+        fprintf(stderr, "Failed to connect to %s. error=%s\n", unix_socket_path, strerror(errno));
+        return false;
+      }
+      return true;
+    }
+
+    struct hostent *entry = gethostbyname(host);
+    if (entry == nullptr) {
+      fprintf(stderr, "Failed to resolve host %s\n", host);
+      return false;
+    }
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd_ < 0) {
+      fprintf(stderr, "Failed to create socket. error=%s\n", strerror(errno));
+      return false;
+    }
+    struct sockaddr_in serv_addr;
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons((uint16_t)port);
+    serv_addr.sin_addr = *((struct in_addr *)entry->h_addr);
+    if (connect(fd_, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+      fprintf(stderr, "Failed to connect to %s:%d. error=%s\n", host, port, strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * 发送一条语句并读取完整的应答，应答以'\0'结束。
+   * 连接断开时返回false，服务端返回FAILURE时failed为true。response不为nullptr时返回应答的内容
+   */
+  bool execute(const std::string &sql, bool *failed, std::string *response = nullptr)
+  {
+    const char *data = sql.c_str();
+    size_t left = sql.size() + 1;
+    while (left > 0) {
+      ssize_t len = send(fd_, data, left, MSG_NOSIGNAL);
+      if (len < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        fprintf(stderr, "Failed to send request. error=%s\n", strerror(errno));
+        return false;
+      }
+      data += len;
+      left -= len;
+    }
+
+    char buf[MAX_MEM_BUFFER_SIZE];
+    bool first = true;
+    *failed = false;
+    if (response != nullptr) {
+      response->clear();
+    }
+    while (true) {
+      ssize_t len = recv(fd_, buf, sizeof(buf), 0);
+      if (len < 0 && errno == EINTR) {
+        continue;
+      }
+      if (len <= 0) {
+        fprintf(stderr, "Connection was broken. error=%s\n", len < 0 ? strerror(errno) : "closed by server");
+        return false;
+      }
+      if (first) {
+        *failed = len >= 7 && 0 == strncmp(buf, "FAILURE", 7);
+        first = false;
+      }
+      const char *end = (const char *)memchr(buf, 0, len);
+      if (response != nullptr) {
+        response->append(buf, end == nullptr ? len : end - buf);
+      }
+      if (end != nullptr) {
+        return true;
+      }
+    }
+  }
+
+private:
+  int fd_ = -1;
+};
+
+#endif  // __TEST_SQL_CONNECTION_H__
@@ -0,0 +1,353 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// TPC-H style macro benchmark: generates a scaled dataset, loads it with
+// load data and runs a fixed query set.
+//
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/defs.h"
+#include "common/metrics/latency_histogram.h"
+#include "sql_connection.h"
+
+using namespace common;
+
+// 比例因子为1时各个表的行数，lineitem每个订单有1到7行
+#define TPCH_CUSTOMER_ROWS 15000
+#define TPCH_ORDERS_ROWS 150000
+#define TPCH_NATION_NUM 25
+#define TPCH_REGION_NUM 5
+
+struct Options {
+  const char *host = LOCAL_HOST;
+  int port = PORT_DEFAULT;
+  const char *unix_socket_path = nullptr;
+  double scale = 0.1;
+  const char *data_dir = "tpch_data";
+  int iterations = 5;      // 每个查询统计的执行次数，之前先执行一次预热
+  bool generate = true;    // 生成数据文件
+  bool load = true;        // 重新建表并导入数据
+};
+
+struct TableDef {
+  const char *name;
+  const char *create_sql;
+  const char *index_sql;  // 可以为nullptr
+};
+
+static const TableDef TABLES[] = {
+    {"region", "create table region(r_regionkey int, r_name char(16));", nullptr},
+    {"nation", "create table nation(n_nationkey int, n_name char(16), n_regionkey int);",
+        "create index nation_key on nation(n_nationkey);"},
+    {"customer",
+        "create table customer(c_custkey int, c_name char(20), c_nationkey int, c_acctbal float, "
+        "c_mktsegment char(12));",
+        "create index customer_key on customer(c_custkey);"},
+    {"orders",
+        "create table orders(o_orderkey int, o_custkey int, o_totalprice float, o_orderdate int, "
+        "o_orderpriority char(16));",
+        "create index orders_key on orders(o_orderkey);"},
+    {"lineitem",
+        "create table lineitem(l_orderkey int, l_linenumber int, l_quantity float, l_extendedprice float, "
+        "l_discount float, l_shipdate int, l_returnflag char(4));",
+        nullptr},
+};
+
+struct QueryDef {
+  const char *name;
+  const char *sql;
+};
+
+// 日期按yyyymmdd保存成int。不支持sum，用count和avg代替
+static const QueryDef QUERIES[] = {
+    {"scan_filter", "select count(*) from lineitem where l_quantity > 45.0;"},
+    {"pricing_summary",
+        "select l_returnflag, count(*), avg(l_quantity), avg(l_extendedprice), max(l_discount) from lineitem "
+        "where l_shipdate <= 19980901 group by l_returnflag;"},
+    {"forecast_revenue",
+        "select count(*), avg(l_extendedprice) from lineitem where l_shipdate >= 19940101 and l_shipdate < 19950101 "
+        "and l_discount >= 0.05 and l_discount <= 0.07 and l_quantity < 24.0;"},
+    {"shipping_priority",
+        "select orders.o_orderkey, orders.o_totalprice from customer, orders "
+        "where customer.c_custkey = orders.o_custkey and customer.c_mktsegment = 'BUILDING' "
+        "and orders.o_orderdate < 19930315 order by orders.o_totalprice desc;"},
+    {"order_lines",
+        "select orders.o_orderpriority, count(*) from orders, lineitem "
+        "where orders.o_orderkey = lineitem.l_orderkey and orders.o_orderdate >= 19930701 "
+        "and orders.o_orderdate < 19931001 group by orders.o_orderpriority;"},
+    {"nation_revenue",
+        "select nation.n_name, count(*), avg(orders.o_totalprice) from region, nation, customer, orders "
+        "where region.r_regionkey = nation.n_regionkey and nation.n_nationkey = customer.c_nationkey "
+        "and customer.c_custkey = orders.o_custkey and region.r_name = 'ASIA' group by nation.n_name;"},
+    {"top_customers", "select c_custkey, c_name, c_acctbal from customer order by c_acctbal desc, c_custkey;"},
+};
+
+static const char *REGION_NAMES[TPCH_REGION_NUM] = {"AFRICA", "AMERICA", "ASIA", "EUROPE", "MIDDLE EAST"};
+static const char *SEGMENTS[] = {"AUTOMOBILE", "BUILDING", "FURNITURE", "HOUSEHOLD", "MACHINERY"};
+static const char *PRIORITIES[] = {"1-URGENT", "2-HIGH", "3-MEDIUM", "4-NOT SPECIFIED", "5-LOW"};
+static const char *RETURN_FLAGS[] = {"A", "N", "R"};
+
+static void usage(const char *program)
+{
+  fprintf(stderr,
+      "Usage: %s [options]\n"
+      "  -h host         server host, default %s\n"
+      "  -p port         server port, default %d\n"
+      "  -s path         unix socket path, used instead of host and port\n"
+      "  -f scale        scale factor, 1 means 150000 orders, default 0.1\n"
+      "  -o dir          directory of the generated data files, default tpch_data\n"
+      "  -i iterations   measured runs of every query, default 5\n"
+      "  -g              use the existing data files, do not generate them\n"
+      "  -n              use the existing tables, do not load data\n",
+      program, LOCAL_HOST, PORT_DEFAULT);
+}
+
+/**
+ * 1992-01-01之后的第days天，每个月按28天算，不会生成不存在的日期
+ */
+static int make_date(int days)
+{
+  const int year = 1992 + days / (12 * 28);
+  const int month = days / 28 % 12 + 1;
+  const int day = days % 28 + 1;
+  return year * 10000 + month * 100 + day;
+}
+
+template <size_t N>
+static const char *pick(const char *(&values)[N], std::mt19937 &random)
+{
+  return values[random() % N];
+}
+
+static bool open_data_file(const std::string &data_dir, const char *table, FILE **file)
+{
+  const std::string path = data_dir + "/" + table + ".data";
+  *file = fopen(path.c_str(), "w");
+  if (*file == nullptr) {
+    fprintf(stderr, "Failed to create %s. error=%s\n", path.c_str(), strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+/**
+ * 生成load data使用的数据文件，每行一条记录，字段之间用'|'分隔。随机数种子固定，同样的比例因子生成同样的数据
+ */
+static bool generate_data(const Options &options)
+{
+  mkdir(options.data_dir, 0755);
+  std::mt19937 random(20210101);
+  const int customer_num = std::max(1, (int)(TPCH_CUSTOMER_ROWS * options.scale));
+  const int order_num = std::max(1, (int)(TPCH_ORDERS_ROWS * options.scale));
+
+  FILE *file = nullptr;
+  if (!open_data_file(options.data_dir, "region", &file)) {
+    return false;
+  }
+  for (int i = 0; i < TPCH_REGION_NUM; i++) {
+    fprintf(file, "%d|%s\n", i, REGION_NAMES[i]);
+  }
+  fclose(file);
+
+  if (!open_data_file(options.data_dir, "nation", &file)) {
+    return false;
+  }
+  for (int i = 0; i < TPCH_NATION_NUM; i++) {
+    fprintf(file, "%d|NATION#%02d|%d\n", i, i, i % TPCH_REGION_NUM);
+  }
+  fclose(file);
+
+  if (!open_data_file(options.data_dir, "customer", &file)) {
+    return false;
+  }
+  for (int i = 1; i <= customer_num; i++) {
+    fprintf(file, "%d|Customer#%09d|%d|%.2f|%s\n", i, i, (int)(random() % TPCH_NATION_NUM),
+        (int)(random() % 1100000 - 100000) / 100.0, pick(SEGMENTS, random));
+  }
+  fclose(file);
+
+  FILE *lineitem_file = nullptr;
+  if (!open_data_file(options.data_dir, "orders", &file) ||
+      !open_data_file(options.data_dir, "lineitem", &lineitem_file)) {
+    return false;
+  }
+  long lineitem_num = 0;
+  for (int i = 1; i <= order_num; i++) {
+    const int order_days = random() % (7 * 12 * 28 - 151);
+    const int line_num = random() % 7 + 1;
+    double total_price = 0;
+    for (int line = 1; line <= line_num; line++) {
+      const int quantity = random() % 50 + 1;
+      const double price = quantity * (900 + random() % 1000) / 10.0;
+      total_price += price;
+      fprintf(lineitem_file, "%d|%d|%d|%.2f|%.2f|%d|%s\n", i, line, quantity, price, (random() % 11) / 100.0,
+          make_date(order_days + random() % 121 + 1), pick(RETURN_FLAGS, random));
+    }
+    lineitem_num += line_num;
+    fprintf(file, "%d|%d|%.2f|%d|%s\n", i, (int)(random() % customer_num + 1), total_price, make_date(order_days),
+        pick(PRIORITIES, random));
+  }
+  fclose(file);
+  fclose(lineitem_file);
+  printf("Generated %d customers, %d orders and %ld lineitems in %s\n", customer_num, order_num, lineitem_num,
+      options.data_dir);
+  return true;
+}
+
+static bool load_data(const Options &options, SqlConnection &connection)
+{
+  char data_dir[PATH_MAX];
+  // 服务端按自己的工作目录解析相对路径，这里传绝对路径
+  if (realpath(options.data_dir, data_dir) == nullptr) {
+    fprintf(stderr, "Failed to resolve %s. error=%s\n", options.data_dir, strerror(errno));
+    return false;
+  }
+
+  bool failed = false;
+  std::string response;
+  for (const TableDef &table : TABLES) {
+    // 表不存在时drop table失败，可以忽略
+    connection.execute(std::string("drop table ") + table.name + ";", &failed);
+    if (!connection.execute(table.create_sql, &failed) || failed) {
+      fprintf(stderr, "Failed to execute: %s\n", table.create_sql);
+      return false;
+    }
+    if (table.index_sql != nullptr && (!connection.execute(table.index_sql, &failed) || failed)) {
+      fprintf(stderr, "Failed to execute: %s\n", table.index_sql);
+      return false;
+    }
+
+    const std::string sql =
+        std::string("load data infile '") + data_dir + "/" + table.name + ".data' into table " + table.name + ";";
+    const uint64_t begin_us = LatencyHistogram::now_us();
+    if (!connection.execute(sql, &failed, &response) || 0 != strncmp(response.c_str(), "SUCCESS", 7)) {
+      fprintf(stderr, "Failed to load %s: %s\n", table.name, response.c_str());
+      return false;
+    }
+    printf("Loaded %-10s in %8.1f ms: %s", table.name, (LatencyHistogram::now_us() - begin_us) / 1000.0,
+        response.c_str());
+  }
+  return true;
+}
+
+/**
+ * 应答是表头加上每行一条记录
+ */
+static int count_rows(const std::string &response)
+{
+  return std::max(0, (int)std::count(response.begin(), response.end(), '\n') - 1);
+}
+
+static bool run_queries(const Options &options, SqlConnection &connection)
+{
+  printf("%-18s %8s %10s %10s %10s %10s %10s\n", "query", "rows", "min(ms)", "avg(ms)", "p50(ms)", "max(ms)",
+      "qps");
+  double total_ms = 0;
+  int total_runs = 0;
+  std::string response;
+  for (const QueryDef &query : QUERIES) {
+    bool failed = false;
+    // 第一次执行用来预热缓冲池
+    if (!connection.execute(query.sql, &failed, &response) || failed) {
+      fprintf(stderr, "Failed to execute %s: %s\n", query.name, query.sql);
+      return false;
+    }
+    const int rows = count_rows(response);
+
+    std::vector<double> latencies;
+    for (int i = 0; i < options.iterations; i++) {
+      const uint64_t begin_us = LatencyHistogram::now_us();
+      if (!connection.execute(query.sql, &failed, &response) || failed) {
+        fprintf(stderr, "Failed to execute %s: %s\n", query.name, query.sql);
+        return false;
+      }
+      latencies.push_back((LatencyHistogram::now_us() - begin_us) / 1000.0);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double latency : latencies) {
+      sum += latency;
+    }
+    printf("%-18s %8d %10.2f %10.2f %10.2f %10.2f %10.1f\n", query.name, rows, latencies.front(),
+        sum / latencies.size(), latencies[latencies.size() / 2], latencies.back(),
+        sum > 0 ? latencies.size() * 1000 / sum : 0);
+    total_ms += sum;
+    total_runs += latencies.size();
+  }
+  printf("%-18s %8s %10s %10.2f %10s %10s %10.1f\n", "total", "", "", total_ms / total_runs, "", "",
+      total_ms > 0 ? total_runs * 1000 / total_ms : 0);
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  Options options;
+  int opt;
+  while ((opt = getopt(argc, argv, "h:p:s:f:o:i:gn")) > 0) {
+    switch (opt) {
+      case 'h':
+        options.host = optarg;
+        break;
+      case 'p':
+        options.port = atoi(optarg);
+        break;
+      case 's':
+        options.unix_socket_path = optarg;
+        break;
+      case 'f':
+        options.scale = atof(optarg);
+        break;
+      case 'o':
+        options.data_dir = optarg;
+        break;
+      case 'i':
+        options.iterations = atoi(optarg);
+        break;
+      case 'g':
+        options.generate = false;
+        break;
+      case 'n':
+        options.load = false;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (options.port <= 0 || options.port > 65535 || options.scale <= 0 || options.iterations <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (options.load && options.generate && !generate_data(options)) {
+    return 1;
+  }
+
+  SqlConnection connection;
+  if (!connection.open(options.host, options.port, options.unix_socket_path)) {
+    return 1;
+  }
+  if (options.load && !load_data(options, connection)) {
+    return 1;
+  }
+  return run_queries(options, connection) ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the admission control of heavy queries and low priority events.
+//
+
+#include <unistd.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "common/seda/stage.h"
+#include "common/seda/thread_pool.h"
+#include "event/execution_plan_event.h"
+#include "sql/executor/admission_control.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+/**
+ * 记录处理事件的优先级，第一个事件等到open之后才处理完
+ */
+class RecordStage : public Stage {
+public:
+  RecordStage() : Stage("RecordStage")
+  {}
+
+  void handle_event(StageEvent *event) override
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (priorities_.empty()) {
+      started_ = true;
+      cond_.notify_all();
+      cond_.wait(lock, [this]() { return opened_; });
+    }
+    priorities_.push_back(event->priority());
+    cond_.notify_all();
+    lock.unlock();
+    event->done_immediate();
+  }
+  void callback_event(StageEvent *event, CallbackContext *context) override
+  {}
+
+  void wait_started()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return started_; });
+  }
+  void open()
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    opened_ = true;
+    cond_.notify_all();
+  }
+  std::vector<StageEvent::Priority> wait_handled(size_t count)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this, count]() { return priorities_.size() >= count; });
+    return priorities_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool started_ = false;
+  bool opened_ = false;
+  std::vector<StageEvent::Priority> priorities_;
+};
+
+static ExecutionPlanEvent *new_plan_event()
+{
+  return new ExecutionPlanEvent(nullptr, query_create());
+}
+
+TEST(AdmissionControlTest, low_priority_runs_last)
+{
+  Threadpool::create_pool_key();
+  for (bool work_stealing : {false, true}) {
+    Threadpool *pool = new Threadpool(1, "test", work_stealing);
+    RecordStage *stage = new RecordStage();
+    stage->set_pool(pool);
+    ASSERT_TRUE(stage->connect());
+
+    stage->add_event(new StageEvent());
+    stage->wait_started();
+    // 唯一的线程被占住时加入的低优先级事件排在之后加入的普通事件后面
+    StageEvent *low_event = new StageEvent();
+    low_event->set_priority(StageEvent::LOW_PRIORITY);
+    stage->add_event(low_event);
+    stage->add_event(new StageEvent());
+    ASSERT_EQ(2u, stage->qlen());
+    stage->open();
+
+    std::vector<StageEvent::Priority> priorities = stage->wait_handled(3);
+    ASSERT_EQ(StageEvent::NORMAL_PRIORITY, priorities[1]);
+    ASSERT_EQ(StageEvent::LOW_PRIORITY, priorities[2]);
+
+    stage->disconnect();
+    delete stage;
+    delete pool;
+  }
+}
+
+TEST(AdmissionControlTest, admit)
+{
+  AdmissionControl admission;
+  ASSERT_FALSE(admission.heavy(1000000));
+  admission.init(1, 100, 60000, 1);
+  ASSERT_FALSE(admission.heavy(99));
+  ASSERT_TRUE(admission.heavy(100));
+
+  // 没有连接的stage保存加入的事件
+  RecordStage stage;
+  ExecutionPlanEvent *running = new_plan_event();
+  ExecutionPlanEvent *waiting = new_plan_event();
+  ExecutionPlanEvent *rejected = new_plan_event();
+  ASSERT_EQ(AdmissionResult::RUN, admission.admit(running, &stage));
+  ASSERT_EQ(AdmissionResult::QUEUED, admission.admit(waiting, &stage));
+  ASSERT_EQ(ExecutionPlanEvent::AdmissionState::WAITING, waiting->admission_state());
+  ASSERT_EQ(AdmissionResult::REJECTED, admission.admit(rejected, &stage));
+  ASSERT_EQ(1, admission.running());
+  ASSERT_EQ(1, admission.waiting());
+  ASSERT_EQ(1, admission.rejected());
+  ASSERT_EQ(0u, stage.qlen());
+
+  // 名额交给等待的查询，以低优先级加回stage
+  admission.release();
+  ASSERT_EQ(1, admission.running());
+  ASSERT_EQ(0, admission.waiting());
+  ASSERT_EQ(ExecutionPlanEvent::AdmissionState::ADMITTED, waiting->admission_state());
+  ASSERT_EQ(StageEvent::LOW_PRIORITY, waiting->priority());
+  ASSERT_EQ(1u, stage.qlen());
+
+  admission.release();
+  ASSERT_EQ(0, admission.running());
+  delete running;
+  delete rejected;
+}
+
+TEST(AdmissionControlTest, timeout)
+{
+  AdmissionControl admission;
+  admission.init(1, 100, 20, 8);
+
+  RecordStage stage;
+  ExecutionPlanEvent *running = new_plan_event();
+  ExecutionPlanEvent *waiting = new_plan_event();
+  ASSERT_EQ(AdmissionResult::RUN, admission.admit(running, &stage));
+  ASSERT_EQ(AdmissionResult::QUEUED, admission.admit(waiting, &stage));
+  admission.expire();
+  ASSERT_EQ(1, admission.waiting());
+
+  usleep(50 * 1000);
+  admission.expire();
+  ASSERT_EQ(0, admission.waiting());
+  ASSERT_EQ(1, admission.timed_out());
+  ASSERT_EQ(ExecutionPlanEvent::AdmissionState::TIMEOUT, waiting->admission_state());
+  ASSERT_EQ(1u, stage.qlen());
+
+  // 超时的查询没有占用名额
+  admission.release();
+  ASSERT_EQ(0, admission.running());
+  delete running;
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
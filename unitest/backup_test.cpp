@@ -0,0 +1,115 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for online backup with copy-on-write snapshots.
+//
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "storage/default/backup.h"
+#include "storage/default/redo_log.h"
+#include "gtest/gtest.h"
+
+static const char *REDO_DIR = "backup_test_redo";
+static const char *DB_DIR = "backup_test_db/";
+static const char *BACKUP_DIR = "backup_test_backup";
+
+static std::string read_file(const std::string &file_name)
+{
+  std::ifstream in(file_name, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+TEST(BackupTest, copy_on_write)
+{
+  system((std::string("rm -rf ") + DB_DIR + " " + BACKUP_DIR).c_str());
+  system((std::string("mkdir -p ") + DB_DIR + " " + BACKUP_DIR).c_str());
+  const std::string src = std::string(DB_DIR) + "t.data";
+  const std::string dst = std::string(BACKUP_DIR) + "/t.data";
+  const std::string before(3 * BACKUP_COW_BLOCK_SIZE + 100, 'a');
+  {
+    std::ofstream out(src, std::ios::binary);
+    out << before;
+  }
+
+  PageSnapshot &snapshot = PageSnapshot::instance();
+  ASSERT_EQ(RC::SUCCESS, snapshot.begin({{src, dst}}));
+  ASSERT_NE(RC::SUCCESS, snapshot.begin({{src, dst}}));
+
+  // 第二个块被覆盖之前复制，文件末尾之后的写不需要复制
+  int fd = open(src.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  const std::string after(BACKUP_COW_BLOCK_SIZE, 'b');
+  snapshot.before_write(fd, BACKUP_COW_BLOCK_SIZE, BACKUP_COW_BLOCK_SIZE);
+  ASSERT_EQ((ssize_t)after.size(), pwrite(fd, after.data(), after.size(), BACKUP_COW_BLOCK_SIZE));
+  snapshot.before_write(fd, BACKUP_COW_BLOCK_SIZE, BACKUP_COW_BLOCK_SIZE);
+  snapshot.before_write(fd, 4 * BACKUP_COW_BLOCK_SIZE, BACKUP_COW_BLOCK_SIZE);
+  ASSERT_EQ(1, snapshot.cow_blocks());
+  close(fd);
+
+  long long bytes = 0;
+  ASSERT_EQ(RC::SUCCESS, snapshot.copy(src, 0, &bytes));
+  ASSERT_EQ((long long)before.size(), bytes);
+  ASSERT_EQ(RC::SUCCESS, snapshot.end());
+  ASSERT_EQ(before, read_file(dst));
+  ASSERT_NE(before, read_file(src));
+
+  system((std::string("rm -rf ") + DB_DIR + " " + BACKUP_DIR).c_str());
+}
+
+TEST(BackupTest, backup_with_redo_log)
+{
+  BackupManager &backup = BackupManager::instance();
+  backup.init(DB_DIR, 0);
+  system((std::string("rm -rf ") + REDO_DIR + " " + DB_DIR + " " + BACKUP_DIR).c_str());
+  system((std::string("mkdir -p ") + DB_DIR + "sys " + DB_DIR + "empty").c_str());
+  {
+    std::ofstream file(std::string(DB_DIR) + "sys/t.table");
+    file << "table meta";
+  }
+
+  // 没有redo日志时不能在线备份
+  ASSERT_EQ(RC::MISUSE, backup.backup(BACKUP_DIR));
+
+  RedoLog &redo_log = RedoLog::instance();
+  ASSERT_EQ(RC::SUCCESS, redo_log.open(REDO_DIR));
+  // 没有完成提交的事务在checkpoint时重新写到日志中，备份打开时据此完成提交
+  ASSERT_EQ(RC::SUCCESS, redo_log.flush(redo_log.append_commit(301)));
+  ASSERT_EQ(RC::SUCCESS, backup.backup(BACKUP_DIR));
+  ASSERT_EQ("table meta", read_file(std::string(BACKUP_DIR) + "/db/sys/t.table"));
+  ASSERT_EQ(0, access((std::string(BACKUP_DIR) + "/db/empty").c_str(), F_OK));
+
+  std::set<int64_t> committed;
+  ASSERT_EQ(RC::SUCCESS, RedoLog::recover((std::string(BACKUP_DIR) + "/redo").c_str(), &committed));
+  ASSERT_EQ(1, (int)committed.count(301));
+
+  // 备份目录需要是空的
+  ASSERT_EQ(RC::INVALID_ARGUMENT, backup.backup(BACKUP_DIR));
+
+  redo_log.end_commit(301);
+  redo_log.close();
+  system((std::string("rm -rf ") + REDO_DIR + " " + DB_DIR + " " + BACKUP_DIR).c_str());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
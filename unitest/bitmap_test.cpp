@@ -12,6 +12,7 @@ See the Mulan PSL v2 for more details. */
 // Created by wangyunlai.wyl on 2021
 //
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "gtest/gtest.h"
@@ -64,6 +65,49 @@ TEST(test_bitmap, test_bitmap) {
   buf3[1] = 0;
   ASSERT_EQ(8, bitmap3.next_unsetted_bit(0));
   ASSERT_EQ(16, bitmap3.next_setted_bit(8));
+
+  // 从字节中间开始查找，跳过的字节之后要从下一个字节的第0位开始
+  memset(buf3, 0, sizeof(buf3));
+  bitmap3.set_bit(8);
+  ASSERT_EQ(8, bitmap3.next_setted_bit(3));
+  memset(buf3, -1, sizeof(buf3));
+  bitmap3.clear_bit(8);
+  ASSERT_EQ(8, bitmap3.next_unsetted_bit(3));
+}
+
+TEST(test_bitmap, test_bitmap_word_boundary) {
+  // 按64位的字查找，和逐位查找的结果比较
+  char buf[40];
+  for (int size : {1, 7, 8, 63, 64, 65, 127, 128, 200, 320}) {
+    for (int round = 0; round < 20; round++) {
+      for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (round % 4 == 0) ? 0 : (round % 4 == 1 ? -1 : (char)(rand() & (rand() & 0xff)));
+      }
+      Bitmap bitmap(buf, size);
+      for (int start = 0; start <= size; start++) {
+        int expect_setted = -1;
+        int expect_unsetted = -1;
+        for (int i = start; i < size; i++) {
+          if (expect_setted < 0 && bitmap.get_bit(i)) {
+            expect_setted = i;
+          }
+          if (expect_unsetted < 0 && !bitmap.get_bit(i)) {
+            expect_unsetted = i;
+          }
+        }
+        ASSERT_EQ(expect_setted, bitmap.next_setted_bit(start)) << "size=" << size << ", start=" << start;
+        ASSERT_EQ(expect_unsetted, bitmap.next_unsetted_bit(start)) << "size=" << size << ", start=" << start;
+      }
+    }
+  }
+
+  // 稀疏的bitmap中只有最后一位被设置
+  char sparse[40];
+  memset(sparse, 0, sizeof(sparse));
+  Bitmap sparse_bitmap(sparse, 320);
+  sparse_bitmap.set_bit(319);
+  ASSERT_EQ(319, sparse_bitmap.next_setted_bit(0));
+  ASSERT_EQ(-1, sparse_bitmap.next_setted_bit(320));
 }
 
 int main(int argc, char **argv) {
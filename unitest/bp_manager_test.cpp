@@ -12,6 +12,12 @@ See the Mulan PSL v2 for more details. */
 // Created by wangyunlai.wyl on 2021
 //
 
+#include <unistd.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
 #include "storage/default/disk_buffer_pool.h"
 #include "gtest/gtest.h"
 
@@ -21,29 +27,33 @@ TEST(test_bp_manager, test_bp_manager_simple_lru) {
   Frame * frame1 = bp_manager.alloc();
   ASSERT_NE(frame1, nullptr);
 
-  frame1->file_desc = 0;
-  frame1->page.page_num = 1;
+  frame1->file_id = 0;
+  frame1->page->page_num = 1;
+  bp_manager.bind_frame(0, 1, frame1 - bp_manager.getFrame());
 
   ASSERT_EQ(frame1, bp_manager.get(0, 1));
 
   Frame *frame2 = bp_manager.alloc();
   ASSERT_NE(frame2, nullptr);
-  frame2->file_desc = 0;
-  frame2->page.page_num = 2;
+  frame2->file_id = 0;
+  frame2->page->page_num = 2;
+  bp_manager.bind_frame(0, 2, frame2 - bp_manager.getFrame());
 
   ASSERT_EQ(frame1, bp_manager.get(0, 1));
 
   Frame *frame3 = bp_manager.alloc();
   ASSERT_NE(frame3, nullptr);
-  frame3->file_desc = 0;
-  frame3->page.page_num = 3;
+  frame3->file_id = 0;
+  frame3->page->page_num = 3;
+  bp_manager.bind_frame(0, 3, frame3 - bp_manager.getFrame());
 
   frame2 = bp_manager.get(0, 2);
   ASSERT_EQ(frame2, nullptr);
 
   Frame *frame4 = bp_manager.alloc();
-  frame4->file_desc = 0;
-  frame4->page.page_num = 4;
+  frame4->file_id = 0;
+  frame4->page->page_num = 4;
+  bp_manager.bind_frame(0, 4, frame4 - bp_manager.getFrame());
 
   frame1 = bp_manager.get(0, 1);
   ASSERT_EQ(frame1, nullptr);
@@ -55,6 +65,657 @@ TEST(test_bp_manager, test_bp_manager_simple_lru) {
   ASSERT_NE(frame4, nullptr);
 }
 
+TEST(test_bp_manager, test_frame_layout) {
+  // 遍历frame时访问的字段都在第一个cache line中，页面内存单独按huge page对齐
+  ASSERT_EQ(0u, sizeof(Frame) % BP_CACHE_LINE_SIZE);
+  ASSERT_LE(offsetof(Frame, file_name) + sizeof(const char *), (size_t)BP_CACHE_LINE_SIZE);
+  BPManager bp(100, LRU_REPLACER, 8192);
+  ASSERT_EQ(100, bp.size);
+  for (int i = 0; i < bp.size; i++) {
+    ASSERT_EQ(0u, (uintptr_t)&bp.frame[i] % BP_CACHE_LINE_SIZE);
+    ASSERT_EQ(0u, bp.frame[i].pin_count);
+    ASSERT_FALSE(bp.frame[i].dirty);
+    ASSERT_EQ(0u, (uintptr_t)bp.frame[i].page % 8192);
+  }
+  ASSERT_EQ(0u, (uintptr_t)bp.frame[0].page % BP_ARENA_ALIGN);
+}
+
+TEST(test_bp_manager, test_clock_replacer) {
+  ClockReplacer replacer(3);
+  int frame_id = -1;
+  ASSERT_FALSE(replacer.Victim(&frame_id));
+
+  replacer.Unpin(0);
+  replacer.Unpin(1);
+  replacer.Unpin(2);
+  ASSERT_EQ(3, replacer.Size());
+
+  // 所有访问位都是1，转一圈清零之后从0开始淘汰
+  ASSERT_TRUE(replacer.Victim(&frame_id));
+  ASSERT_EQ(0, frame_id);
+
+  // 1 被再次访问，下一次淘汰跳过它
+  replacer.Refresh(1);
+  ASSERT_TRUE(replacer.Victim(&frame_id));
+  ASSERT_EQ(2, frame_id);
+
+  replacer.Pin(1);
+  ASSERT_EQ(0, replacer.Size());
+  ASSERT_FALSE(replacer.Victim(&frame_id));
+
+  replacer.Unpin(1);
+  replacer.Remove(1);
+  ASSERT_FALSE(replacer.Victim(&frame_id));
+}
+
+TEST(test_bp_manager, test_lruk_replacer) {
+  LRUKReplacer replacer(4);
+  int frame_id = -1;
+
+  // frame 0、1 访问两次，是热点页
+  for (int i = 0; i < 2; i++) {
+    replacer.Pin(i);
+    replacer.Unpin(i);
+    replacer.Pin(i);
+    replacer.Unpin(i);
+  }
+  // frame 2、3 只访问一次，模拟顺序扫描
+  replacer.Pin(2);
+  replacer.Unpin(2);
+  replacer.Pin(3);
+  replacer.Unpin(3);
+  ASSERT_EQ(4, replacer.Size());
+
+  ASSERT_TRUE(replacer.Victim(&frame_id));
+  ASSERT_EQ(2, frame_id);
+  ASSERT_TRUE(replacer.Victim(&frame_id));
+  ASSERT_EQ(3, frame_id);
+
+  // 只剩热点页时按照LRU淘汰
+  replacer.Refresh(0);
+  ASSERT_TRUE(replacer.Victim(&frame_id));
+  ASSERT_EQ(1, frame_id);
+  ASSERT_TRUE(replacer.Victim(&frame_id));
+  ASSERT_EQ(0, frame_id);
+  ASSERT_FALSE(replacer.Victim(&frame_id));
+}
+
+TEST(test_bp_manager, test_replacer_type_from_string) {
+  ReplacerType type = LRU_REPLACER;
+  ASSERT_EQ(RC::SUCCESS, replacer_type_from_string("CLOCK", &type));
+  ASSERT_EQ(CLOCK_REPLACER, type);
+  ASSERT_EQ(RC::SUCCESS, replacer_type_from_string("lru-k", &type));
+  ASSERT_EQ(LRUK_REPLACER, type);
+  ASSERT_NE(RC::SUCCESS, replacer_type_from_string("fifo", &type));
+}
+
+TEST(test_bp_manager, test_background_flusher) {
+  const char *file_name = "bp_flusher_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(64);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+
+  const int page_num = 20;
+  for (int i = 0; i < page_num; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    snprintf(data, 16, "page %d", i + 1);
+    pool.mark_dirty(&page_handle);
+    pool.unpin_page(&page_handle);
+  }
+  // 文件头页一直被pin住，不会被后台线程刷出
+  ASSERT_EQ(page_num + 1, pool.dirty_page_count());
+
+  ASSERT_EQ(RC::SUCCESS, pool.start_flusher(10));
+  for (int i = 0; i < 50 && pool.dirty_page_count() > 1; i++) {
+    usleep(100 * 1000);
+  }
+  ASSERT_EQ(1, pool.dirty_page_count());
+  pool.stop_flusher();
+
+  // 不经过缓冲池直接读文件，确认页面已经写到磁盘上
+  int fd = open(file_name, O_RDONLY);
+  ASSERT_GE(fd, 0);
+  for (int i = 1; i <= page_num; i++) {
+    Page page;
+    ASSERT_EQ((ssize_t)sizeof(Page), pread(fd, &page, sizeof(Page), (off_t)i * sizeof(Page)));
+    ASSERT_EQ(page_checksum(i, &page, sizeof(Page)), page.page_num);
+    char expected[16];
+    snprintf(expected, sizeof(expected), "page %d", i);
+    ASSERT_STREQ(expected, page.data);
+  }
+  close(fd);
+
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+TEST(test_bp_manager, test_page_size) {
+  const char *file_name = "bp_page_size_test.data";
+  unlink(file_name);
+
+  const int page_size = 16 * 1024;
+  ASSERT_FALSE(is_valid_page_size(6 * 1024));
+  ASSERT_TRUE(is_valid_page_size(page_size));
+
+  DiskBufferPool pool(64, LRU_REPLACER, SYNC_PAGE_IO, page_size);
+  ASSERT_EQ(page_size - (int)sizeof(PageNum), pool.page_data_size());
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+
+  int read_page_size = 0;
+  ASSERT_EQ(RC::SUCCESS, DiskBufferPool::read_file_page_size(file_name, &read_page_size));
+  ASSERT_EQ(page_size, read_page_size);
+
+  // 页面大小不同的缓冲池不能打开这个文件
+  DiskBufferPool small_pool(64);
+  int file_id = -1;
+  ASSERT_NE(RC::SUCCESS, small_pool.open_file(file_name, &file_id));
+
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  for (int i = 0; i < 3; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    // 写在4k之后的位置
+    snprintf(data + pool.page_data_size() - 16, 16, "tail %d", i);
+    pool.mark_dirty(&page_handle);
+    pool.unpin_page(&page_handle);
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+
+  struct stat st;
+  ASSERT_EQ(0, stat(file_name, &st));
+  ASSERT_EQ(4 * page_size, st.st_size);
+
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  for (int i = 0; i < 3; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.get_this_page(file_id, i + 1, &page_handle));
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    char expected[16];
+    snprintf(expected, sizeof(expected), "tail %d", i);
+    ASSERT_STREQ(expected, data + pool.page_data_size() - 16);
+    pool.unpin_page(&page_handle);
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+TEST(test_bp_manager, test_page_compression) {
+  if (!page_compression_supported(PAGE_COMPRESSION_ZLIB)) {
+    return;
+  }
+  const char *file_name = "bp_compression_test.data";
+  unlink(file_name);
+
+  const int page_size = 16 * 1024;
+  PageCompression compression = PAGE_COMPRESSION_NONE;
+  ASSERT_EQ(RC::SUCCESS, page_compression_from_string("ZLIB", &compression));
+  ASSERT_EQ(PAGE_COMPRESSION_ZLIB, compression);
+  ASSERT_NE(RC::SUCCESS, page_compression_from_string("snappy", &compression));
+
+  DiskBufferPool pool(8, LRU_REPLACER, SYNC_PAGE_IO, page_size);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name, PAGE_COMPRESSION_ZLIB));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  ASSERT_EQ(RC::SUCCESS, pool.get_file_compression(file_id, &compression));
+  ASSERT_EQ(PAGE_COMPRESSION_ZLIB, compression);
+
+  // 偶数页容易压缩，奇数页是随机数据，压缩不了时按原样写出。页面数超过缓冲池大小，会被淘汰再读回来
+  const int page_num = 20;
+  for (int i = 0; i < page_num; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    srandom(i);
+    for (int j = 0; j < pool.page_data_size(); j++) {
+      data[j] = i % 2 == 0 ? (char)(j / 64 + i) : (char)random();
+    }
+    pool.mark_dirty(&page_handle);
+    pool.unpin_page(&page_handle);
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+
+  // 页面大小不变，压缩的页面开头是压缩头
+  int read_page_size = 0;
+  ASSERT_EQ(RC::SUCCESS, DiskBufferPool::read_file_page_size(file_name, &read_page_size));
+  ASSERT_EQ(page_size, read_page_size);
+  int fd = open(file_name, O_RDONLY);
+  ASSERT_GE(fd, 0);
+  std::vector<char> raw(page_size);
+  ASSERT_LT(0, pread(fd, raw.data(), page_size, (off_t)page_size));
+  ASSERT_TRUE(is_compressed_page(raw.data(), page_size));
+  ASSERT_EQ(page_size, pread(fd, raw.data(), page_size, (off_t)page_size * 2));
+  ASSERT_FALSE(is_compressed_page(raw.data(), page_size));
+  close(fd);
+
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  for (int i = 0; i < page_num; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.get_this_page(file_id, i + 1, &page_handle));
+    PageNum num = -1;
+    pool.get_page_num(&page_handle, &num);
+    ASSERT_EQ(i + 1, num);
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    srandom(i);
+    for (int j = 0; j < pool.page_data_size(); j++) {
+      ASSERT_EQ(i % 2 == 0 ? (char)(j / 64 + i) : (char)random(), data[j]);
+    }
+    pool.unpin_page(&page_handle);
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+TEST(test_bp_manager, test_legacy_file_header) {
+  const char *file_name = "bp_legacy_test.data";
+  unlink(file_name);
+
+  // 旧版本的文件头: page_count, allocated_pages之后直接是bitmap
+  char pages[2][BP_PAGE_SIZE];
+  memset(pages, 0, sizeof(pages));
+  int *header = (int *)(pages[0] + sizeof(PageNum));
+  header[0] = 2;
+  header[1] = 2;
+  pages[0][sizeof(PageNum) + 2 * sizeof(int)] = 0x03;
+  ((Page *)pages[1])->page_num = 1;
+  int fd = open(file_name, O_RDWR | O_CREAT, 0644);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ((ssize_t)sizeof(pages), write(fd, pages, sizeof(pages)));
+  close(fd);
+
+  int page_size = 0;
+  ASSERT_EQ(RC::SUCCESS, DiskBufferPool::read_file_page_size(file_name, &page_size));
+  ASSERT_EQ(BP_PAGE_SIZE, page_size);
+
+  DiskBufferPool pool(64);
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  BPPageHandle page_handle;
+  ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+  PageNum page_num = -1;
+  pool.get_page_num(&page_handle, &page_num);
+  ASSERT_EQ(2, page_num);
+  pool.unpin_page(&page_handle);
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+
+  fd = open(file_name, O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ((ssize_t)BP_PAGE_SIZE, pread(fd, pages[0], BP_PAGE_SIZE, 0));
+  close(fd);
+  ASSERT_EQ(3, header[0]);
+  ASSERT_EQ(0x07, pages[0][sizeof(PageNum) + 2 * sizeof(int)]);
+  unlink(file_name);
+}
+
+TEST(test_bp_manager, test_page_checksum) {
+  const char *file_name = "bp_checksum_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(8);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  for (int i = 0; i < 3; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    memset(data, 'a' + i, pool.page_data_size());
+    pool.mark_dirty(&page_handle);
+    pool.unpin_page(&page_handle);
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+
+  // 磁盘上页面开头是校验和，读进来之后还是页号
+  int fd = open(file_name, O_RDWR);
+  ASSERT_GE(fd, 0);
+  std::vector<char> raw(BP_PAGE_SIZE);
+  ASSERT_EQ(BP_PAGE_SIZE, pread(fd, raw.data(), BP_PAGE_SIZE, BP_PAGE_SIZE));
+  ASSERT_EQ(page_checksum(1, (Page *)raw.data(), BP_PAGE_SIZE), ((Page *)raw.data())->page_num);
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  BPPageHandle page_handle;
+  ASSERT_EQ(RC::SUCCESS, pool.get_this_page(file_id, 1, &page_handle));
+  PageNum page_num = -1;
+  pool.get_page_num(&page_handle, &page_num);
+  ASSERT_EQ(1, page_num);
+  char *data = nullptr;
+  pool.get_data(&page_handle, &data);
+  ASSERT_EQ('a', data[pool.page_data_size() - 1]);
+  pool.unpin_page(&page_handle);
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+
+  // 页面中改动一个字节，加载时校验失败
+  const char corrupted = 'x';
+  ASSERT_EQ(1, pwrite(fd, &corrupted, 1, BP_PAGE_SIZE * 2 + 100));
+  close(fd);
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  ASSERT_EQ(RC::CORRUPT, pool.get_this_page(file_id, 2, &page_handle));
+  ASSERT_EQ(RC::SUCCESS, pool.get_this_page(file_id, 3, &page_handle));
+  pool.unpin_page(&page_handle);
+  std::stringstream ss;
+  pool.dump_status(ss);
+  std::string line;
+  std::getline(ss, line);
+  ASSERT_EQ(" | 1", line.substr(line.size() - 4));
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+TEST(test_bp_manager, test_map_file) {
+  const char *file_name = "bp_map_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(8);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  for (int i = 0; i < 10; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    snprintf(data, 16, "mapped %d", i);
+    pool.mark_dirty(&page_handle);
+    pool.unpin_page(&page_handle);
+  }
+
+  // 映射之后页面不再经过缓冲池，缓冲池只有8个frame也能同时访问所有页面
+  ASSERT_EQ(RC::SUCCESS, pool.map_file(file_id));
+  std::vector<BPPageHandle> handles(10);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(RC::SUCCESS, pool.get_this_page(file_id, i + 1, &handles[i]));
+    PageNum page_num = -1;
+    pool.get_page_num(&handles[i], &page_num);
+    ASSERT_EQ(i + 1, page_num);
+    char *data = nullptr;
+    pool.get_data(&handles[i], &data);
+    char expected[16];
+    snprintf(expected, sizeof(expected), "mapped %d", i);
+    ASSERT_STREQ(expected, data);
+  }
+  ASSERT_EQ(RC::READONLY, pool.mark_dirty(&handles[0]));
+  for (BPPageHandle &page_handle : handles) {
+    ASSERT_EQ(RC::SUCCESS, pool.unpin_page(&page_handle));
+  }
+  BPPageHandle page_handle;
+  ASSERT_EQ(RC::READONLY, pool.allocate_page(file_id, &page_handle));
+  ASSERT_EQ(RC::READONLY, pool.dispose_page(file_id, 1));
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+
+  // 重新打开之后不再映射，可以修改
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+  ASSERT_EQ(RC::SUCCESS, pool.mark_dirty(&page_handle));
+  pool.unpin_page(&page_handle);
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+TEST(test_bp_manager, test_direct_io) {
+  const char *file_name = "bp_direct_io_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(64);
+  pool.set_direct_io(true);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  // 文件系统不支持O_DIRECT时会退回到普通IO，读写结果相同
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  for (int i = 0; i < 10; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    snprintf(data, 16, "direct %d", i);
+    pool.mark_dirty(&page_handle);
+    pool.unpin_page(&page_handle);
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  for (int i = 0; i < 10; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.get_this_page(file_id, i + 1, &page_handle));
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    char expected[16];
+    snprintf(expected, sizeof(expected), "direct %d", i);
+    ASSERT_STREQ(expected, data);
+    pool.unpin_page(&page_handle);
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+TEST(test_bp_manager, test_file_metric) {
+  const char *file_name = "bp_metric_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(8);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  // 页面数超过缓冲池大小，前面写过的脏页会被淘汰并写回磁盘
+  for (int i = 0; i < 20; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+    pool.mark_dirty(&page_handle);
+    pool.unpin_page(&page_handle);
+  }
+  for (int i = 0; i < 2; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.get_this_page(file_id, 1, &page_handle));
+    pool.unpin_page(&page_handle);
+  }
+
+  std::stringstream ss;
+  pool.dump_status(ss);
+  std::string line;
+  std::vector<std::string> rows;
+  while (std::getline(ss, line)) {
+    rows.push_back(line);
+  }
+  ASSERT_EQ(2, (int)rows.size());
+  // page_size | frames | dirty_pages | file | hits | misses | hit_ratio | evictions | dirty_flushes | ...
+  std::vector<std::string> fields;
+  std::string::size_type begin = 0;
+  std::string::size_type end = 0;
+  while ((end = rows[0].find(" | ", begin)) != std::string::npos) {
+    fields.push_back(rows[0].substr(begin, end - begin));
+    begin = end + 3;
+  }
+  fields.push_back(rows[0].substr(begin));
+  ASSERT_EQ(13, (int)fields.size());
+  ASSERT_EQ(file_name, fields[3]);
+  ASSERT_EQ(1, atol(fields[4].c_str()));
+  ASSERT_EQ(1, atol(fields[5].c_str()));
+  ASSERT_EQ("50.00", fields[6]);
+  ASSERT_LT(0, atol(fields[7].c_str()));
+  ASSERT_LT(0, atol(fields[8].c_str()));
+  ASSERT_EQ(0, rows[1].find("4096 | 8 | "));
+  ASSERT_NE(std::string::npos, rows[1].find(" | total | 1 | 1 | "));
+
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+TEST(test_bp_manager, test_drop_file) {
+  const char *file_name = "bp_drop_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(8);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  for (int i = 0; i < 4; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+    pool.mark_dirty(&page_handle);
+    pool.unpin_page(&page_handle);
+  }
+  ASSERT_LT(0, pool.dirty_page_count());
+
+  // 脏页直接丢弃，释放的页框可以给别的文件使用
+  ASSERT_EQ(RC::SUCCESS, pool.drop_file(file_id));
+  ASSERT_EQ(0, pool.dirty_page_count());
+  unlink(file_name);
+
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  std::vector<BPPageHandle> page_handles(7);
+  for (BPPageHandle &page_handle : page_handles) {
+    ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+  }
+  for (BPPageHandle &page_handle : page_handles) {
+    pool.unpin_page(&page_handle);
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+TEST(test_bp_manager, test_fd_cache) {
+  // 打开的文件比以前的文件表(1024)多，fd缓存只保留16个fd
+  const int file_num = 1100;
+  FileDescCache &fd_cache = FileDescCache::instance();
+  ASSERT_EQ(RC::SUCCESS, fd_cache.set_capacity(BP_MIN_CACHED_FDS));
+  long reopens = fd_cache.reopens();
+
+  DiskBufferPool pool(file_num * 2);
+  std::vector<std::string> file_names;
+  std::vector<int> file_ids;
+  for (int i = 0; i < file_num; i++) {
+    std::stringstream ss;
+    ss << "bp_fd_cache_test_" << i << ".data";
+    file_names.push_back(ss.str());
+    unlink(ss.str().c_str());
+    ASSERT_EQ(RC::SUCCESS, pool.create_file(ss.str().c_str()));
+    int file_id = -1;
+    ASSERT_EQ(RC::SUCCESS, pool.open_file(ss.str().c_str(), &file_id));
+    file_ids.push_back(file_id);
+
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    snprintf(data, 16, "file %d", i);
+    pool.mark_dirty(&page_handle);
+    pool.unpin_page(&page_handle);
+    ASSERT_GE(BP_MIN_CACHED_FDS, fd_cache.open_count());
+  }
+
+  // 刷盘和读取时关闭过的fd重新打开
+  ASSERT_EQ(RC::SUCCESS, pool.checkpoint());
+  for (int i = 0; i < file_num; i++) {
+    ASSERT_EQ(RC::SUCCESS, pool.flush_all_pages(file_ids[i]));
+  }
+  for (int i = 0; i < file_num; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.get_this_page(file_ids[i], 1, &page_handle));
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    char expected[16];
+    snprintf(expected, sizeof(expected), "file %d", i);
+    ASSERT_STREQ(expected, data);
+    pool.unpin_page(&page_handle);
+  }
+  ASSERT_LT(reopens, fd_cache.reopens());
+  ASSERT_GE(BP_MIN_CACHED_FDS, fd_cache.open_count());
+
+  // 关闭之后编号可以被新打开的文件复用
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_ids[0]));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_names[0].c_str(), &file_id));
+  ASSERT_EQ(file_ids[0], file_id);
+
+  for (int i = 0; i < file_num; i++) {
+    ASSERT_EQ(RC::SUCCESS, pool.close_file(file_ids[i]));
+    unlink(file_names[i].c_str());
+  }
+  ASSERT_EQ(0, fd_cache.open_count());
+  fd_cache.set_capacity(0);
+}
+
+TEST(test_bp_manager, test_warm_up) {
+  const char *file_name = "bp_warm_up_test.data";
+  unlink(file_name);
+
+  std::vector<std::pair<std::string, PageNum>> resident;
+  {
+    DiskBufferPool pool(16);
+    ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+    int file_id = -1;
+    ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+    for (int i = 1; i <= 10; i++) {
+      BPPageHandle page_handle;
+      ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+      char *data = nullptr;
+      pool.get_data(&page_handle, &data);
+      data[0] = (char)i;
+      pool.mark_dirty(&page_handle);
+      pool.unpin_page(&page_handle);
+    }
+    pool.resident_pages(resident);
+    ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  }
+  // 文件头页和10个数据页，按页号排序
+  ASSERT_EQ(11, (int)resident.size());
+  for (int i = 0; i <= 10; i++) {
+    ASSERT_EQ(file_name, resident[i].first);
+    ASSERT_EQ(i, resident[i].second);
+  }
+
+  std::vector<PageNum> pages;
+  for (auto &page : resident) {
+    pages.push_back(page.second);
+  }
+  pages.push_back(100);  // 文件中没有的页面被忽略
+  std::atomic<bool> stop(false);
+  {
+    DiskBufferPool pool(16);
+    ASSERT_EQ(0, pool.warm_up(file_name, pages, stop));  // 文件没有打开
+    int file_id = -1;
+    ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+    ASSERT_EQ(10, pool.warm_up(file_name, pages, stop));
+    for (int i = 1; i <= 10; i++) {
+      BPPageHandle page_handle;
+      ASSERT_EQ(RC::SUCCESS, pool.get_this_page(file_id, i, &page_handle));
+      char *data = nullptr;
+      pool.get_data(&page_handle, &data);
+      ASSERT_EQ((char)i, data[0]);
+      pool.unpin_page(&page_handle);
+    }
+    std::stringstream ss;
+    pool.dump_status(ss);
+    // 预热之后的访问都命中缓冲池: page_size | frames | dirty_pages | file | hits | misses
+    ASSERT_NE(std::string::npos, ss.str().find(std::string(file_name) + " | 10 | 0 | "));
+    ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  }
+  {
+    // 只使用空闲的frame，不淘汰已经在缓冲池中的页面
+    DiskBufferPool pool(8);
+    int file_id = -1;
+    ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.get_this_page(file_id, 1, &page_handle));
+    ASSERT_EQ(6, pool.warm_up(file_name, pages, stop));
+    pool.unpin_page(&page_handle);
+    stop = true;
+    ASSERT_EQ(0, pool.warm_up(file_name, pages, stop));
+    ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  }
+  unlink(file_name);
+}
+
 int main(int argc, char **argv) {
   // 分析gtest程序的命令行参数
   testing::InitGoogleTest(&argc, argv);
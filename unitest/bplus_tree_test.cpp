@@ -0,0 +1,1070 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for B+ tree index.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "storage/common/bplus_tree.h"
+#include "gtest/gtest.h"
+
+static const int KEY_NUM = 3000;
+
+static RID make_rid(int i)
+{
+  RID rid;
+  rid.page_num = i / 100 + 1;
+  rid.slot_num = i % 100;
+  return rid;
+}
+
+TEST(test_bplus_tree, test_int_keys)
+{
+  const char *index_file = "bplus_tree_int_test.index";
+  remove(index_file);
+
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, INTS, sizeof(int)));
+
+  std::vector<int> keys;
+  for (int i = 0; i < KEY_NUM; i++) {
+    keys.push_back(i);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+  for (int key : keys) {
+    RID rid = make_rid(key);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+  }
+  // 属性值和rid都相同的key不能重复插入，属性值相同rid不同的可以
+  RID rid = make_rid(5);
+  int key = 5;
+  ASSERT_EQ(RC::RECORD_DUPLICATE_KEY, handler.insert_entry((const char *)&key, &rid));
+  RID other_rid = make_rid(KEY_NUM + 5);
+  ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &other_rid));
+
+  ASSERT_EQ(RC::SUCCESS, handler.close());
+  ASSERT_EQ(RC::SUCCESS, handler.open(index_file));
+
+  for (int i = 0; i < KEY_NUM; i++) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, handler.get_entry((const char *)&i, &rid));
+    ASSERT_EQ(make_rid(i).page_num, rid.page_num);
+    ASSERT_EQ(make_rid(i).slot_num, rid.slot_num);
+  }
+  RID missing = make_rid(1);
+  key = KEY_NUM;
+  ASSERT_EQ(RC::RECORD_INVALID_KEY, handler.get_entry((const char *)&key, &missing));
+
+  for (int i = 0; i < KEY_NUM; i += 3) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)&i, &rid));
+  }
+  for (int i = 0; i < KEY_NUM; i++) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(i % 3 == 0 ? RC::RECORD_INVALID_KEY : RC::SUCCESS, handler.get_entry((const char *)&i, &rid));
+  }
+  key = 5;
+  ASSERT_EQ(RC::SUCCESS, handler.get_entry((const char *)&key, &other_rid));
+
+  handler.close();
+  remove(index_file);
+}
+
+TEST(test_bplus_tree, test_chars_and_float_keys)
+{
+  const char *chars_file = "bplus_tree_chars_test.index";
+  const char *float_file = "bplus_tree_float_test.index";
+  remove(chars_file);
+  remove(float_file);
+
+  BplusTreeHandler chars_handler;
+  BplusTreeHandler float_handler;
+  ASSERT_EQ(RC::SUCCESS, chars_handler.create(chars_file, CHARS, 8));
+  ASSERT_EQ(RC::SUCCESS, float_handler.create(float_file, FLOATS, sizeof(float)));
+
+  std::vector<int> keys;
+  for (int i = 0; i < KEY_NUM; i++) {
+    keys.push_back(i);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(11));
+  for (int i : keys) {
+    char name[8] = {0};
+    snprintf(name, sizeof(name), "k%05d", i);
+    float f = i * 0.25f;
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, chars_handler.insert_entry(name, &rid));
+    ASSERT_EQ(RC::SUCCESS, float_handler.insert_entry((const char *)&f, &rid));
+  }
+
+  for (int i = 0; i < KEY_NUM; i++) {
+    char name[8] = {0};
+    snprintf(name, sizeof(name), "k%05d", i);
+    float f = i * 0.25f;
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, chars_handler.get_entry(name, &rid));
+    ASSERT_EQ(RC::SUCCESS, float_handler.get_entry((const char *)&f, &rid));
+  }
+
+  char name[8] = "k99999";
+  RID rid = make_rid(0);
+  ASSERT_EQ(RC::RECORD_INVALID_KEY, chars_handler.get_entry(name, &rid));
+
+  chars_handler.close();
+  float_handler.close();
+  remove(chars_file);
+  remove(float_file);
+}
+
+static std::vector<int> scan_range(BplusTreeScanner &scanner, const int *low, bool low_inclusive, const int *high,
+                                   bool high_inclusive)
+{
+  std::vector<int> keys;
+  EXPECT_EQ(RC::SUCCESS, scanner.open_range((const char *)low, low_inclusive, (const char *)high, high_inclusive));
+  RID rid;
+  RC rc;
+  while ((rc = scanner.next_entry(&rid)) == RC::SUCCESS) {
+    keys.push_back((rid.page_num - 1) * 100 + rid.slot_num);
+  }
+  EXPECT_EQ(RC::RECORD_EOF, rc);
+  EXPECT_EQ(RC::SUCCESS, scanner.close());
+  return keys;
+}
+
+static std::vector<int> expected_range(int low, int high)
+{
+  std::vector<int> keys;
+  for (int i = low; i <= high; i++) {
+    if (i % 2 == 0) {
+      keys.push_back(i);
+    }
+  }
+  return keys;
+}
+
+TEST(test_bplus_tree, test_range_scan)
+{
+  const char *index_file = "bplus_tree_range_test.index";
+  remove(index_file);
+
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, INTS, sizeof(int)));
+  // 只插入偶数，边界落在不存在的key上时也要正确定位
+  std::vector<int> keys;
+  for (int i = 0; i < KEY_NUM; i += 2) {
+    keys.push_back(i);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(3));
+  for (int key : keys) {
+    RID rid = make_rid(key);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+  }
+
+  BplusTreeScanner scanner(handler);
+  int low = 100;
+  int high = 1000;
+  ASSERT_EQ(expected_range(100, 1000), scan_range(scanner, &low, true, &high, true));
+  ASSERT_EQ(expected_range(101, 999), scan_range(scanner, &low, false, &high, false));
+  low = 101;
+  high = 999;
+  ASSERT_EQ(expected_range(102, 998), scan_range(scanner, &low, true, &high, true));
+  ASSERT_EQ(expected_range(0, 998), scan_range(scanner, nullptr, false, &high, true));
+  ASSERT_EQ(expected_range(102, KEY_NUM - 1), scan_range(scanner, &low, false, nullptr, false));
+  ASSERT_EQ(expected_range(0, KEY_NUM - 1), scan_range(scanner, nullptr, false, nullptr, false));
+  low = 500;
+  ASSERT_EQ(expected_range(500, 500), scan_range(scanner, &low, true, &low, true));
+  ASSERT_TRUE(scan_range(scanner, &low, false, &low, true).empty());
+  high = 100;
+  ASSERT_TRUE(scan_range(scanner, &low, true, &high, true).empty());
+  low = KEY_NUM;
+  ASSERT_TRUE(scan_range(scanner, &low, true, nullptr, false).empty());
+
+  // 比较符的扫描转换成范围
+  int value = 10;
+  ASSERT_EQ(RC::SUCCESS, scanner.open(LESS_THAN, (const char *)&value));
+  RID rid;
+  int count = 0;
+  while (scanner.next_entry(&rid) == RC::SUCCESS) {
+    count++;
+  }
+  ASSERT_EQ(5, count);
+  ASSERT_EQ(RC::SUCCESS, scanner.close());
+
+  handler.close();
+  remove(index_file);
+}
+
+static std::vector<int> scan_reverse(BplusTreeScanner &scanner, const int *low, bool low_inclusive, const int *high,
+                                     bool high_inclusive)
+{
+  std::vector<int> keys;
+  EXPECT_EQ(RC::SUCCESS, scanner.open_range((const char *)low, 1, low_inclusive, (const char *)high, 1,
+                                            high_inclusive, true));
+  RID rid;
+  RC rc;
+  while ((rc = scanner.next_entry(&rid)) == RC::SUCCESS) {
+    keys.push_back((rid.page_num - 1) * 100 + rid.slot_num);
+  }
+  EXPECT_EQ(RC::RECORD_EOF, rc);
+  EXPECT_EQ(RC::SUCCESS, scanner.close());
+  return keys;
+}
+
+static std::vector<int> expected_reverse(int low, int high)
+{
+  std::vector<int> keys = expected_range(low, high);
+  std::reverse(keys.begin(), keys.end());
+  return keys;
+}
+
+TEST(test_bplus_tree, test_reverse_scan)
+{
+  const char *index_file = "bplus_tree_reverse_test.index";
+  remove(index_file);
+
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, INTS, sizeof(int)));
+  BplusTreeScanner scanner(handler);
+  ASSERT_TRUE(scan_reverse(scanner, nullptr, false, nullptr, false).empty());
+
+  std::vector<int> keys;
+  for (int i = 0; i < KEY_NUM; i += 2) {
+    keys.push_back(i);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(5));
+  for (int key : keys) {
+    RID rid = make_rid(key);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+  }
+
+  ASSERT_EQ(expected_reverse(0, KEY_NUM - 1), scan_reverse(scanner, nullptr, false, nullptr, false));
+  int low = 100;
+  int high = 1000;
+  ASSERT_EQ(expected_reverse(100, 1000), scan_reverse(scanner, &low, true, &high, true));
+  ASSERT_EQ(expected_reverse(101, 999), scan_reverse(scanner, &low, false, &high, false));
+  low = 101;
+  high = 999;
+  ASSERT_EQ(expected_reverse(102, 998), scan_reverse(scanner, &low, true, &high, true));
+  ASSERT_EQ(expected_reverse(0, 998), scan_reverse(scanner, nullptr, false, &high, true));
+  ASSERT_EQ(expected_reverse(102, KEY_NUM - 1), scan_reverse(scanner, &low, false, nullptr, false));
+  high = 100;
+  ASSERT_TRUE(scan_reverse(scanner, &low, true, &high, true).empty());
+  high = -1;
+  ASSERT_TRUE(scan_reverse(scanner, nullptr, false, &high, true).empty());
+
+  // 扫描过程中插入和删除导致分裂合并时，从上次返回的key继续往前，不重复也不遗漏没有修改的key
+  ASSERT_EQ(RC::SUCCESS, scanner.open_range(nullptr, 0, false, nullptr, 0, false, true));
+  std::vector<int> scanned;
+  RID rid;
+  int next_insert = 1;
+  int next_delete = 1000;
+  while (scanner.next_entry(&rid) == RC::SUCCESS) {
+    scanned.push_back((rid.page_num - 1) * 100 + rid.slot_num);
+    if (scanned.size() % 50 == 0) {
+      for (int i = 0; i < 20 && next_insert < KEY_NUM; i++, next_insert += 2) {
+        RID insert_rid = make_rid(next_insert);
+        ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&next_insert, &insert_rid));
+      }
+      for (int i = 0; i < 10 && next_delete >= 0; i++, next_delete -= 2) {
+        RID delete_rid = make_rid(next_delete);
+        ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)&next_delete, &delete_rid));
+      }
+    }
+  }
+  ASSERT_EQ(RC::SUCCESS, scanner.close());
+  ASSERT_TRUE(std::is_sorted(scanned.rbegin(), scanned.rend()));
+  ASSERT_EQ(scanned.end(), std::adjacent_find(scanned.begin(), scanned.end()));
+  for (int key = KEY_NUM - 2; key > 1000; key -= 2) {
+    ASSERT_TRUE(std::binary_search(scanned.rbegin(), scanned.rend(), key));
+  }
+
+  handler.close();
+  remove(index_file);
+}
+
+TEST(test_bplus_tree, test_composite_keys)
+{
+  const char *index_file = "bplus_tree_composite_test.index";
+  remove(index_file);
+
+  // (tenant int, name char(4), score float)
+  AttrType types[] = {INTS, CHARS, FLOATS};
+  int lengths[] = {4, 4, 4};
+  const int key_length = 12;
+  auto make_key = [](int tenant, const char *name, float score, char *key) {
+    memset(key, 0, key_length);
+    memcpy(key, &tenant, 4);
+    memcpy(key + 4, name, 4);
+    memcpy(key + 8, &score, 4);
+  };
+
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, types, lengths, 3));
+  std::vector<int> ids;
+  for (int i = 0; i < 2000; i++) {
+    ids.push_back(i);
+  }
+  std::shuffle(ids.begin(), ids.end(), std::mt19937(5));
+  // id = tenant * 100 + name * 10 + score
+  for (int id : ids) {
+    char name[5];
+    snprintf(name, sizeof(name), "n%d", id / 10 % 10);
+    char key[key_length];
+    make_key(id / 100, name, (float)(id % 10), key);
+    RID rid = make_rid(id);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry(key, &rid));
+  }
+  ASSERT_EQ(RC::SUCCESS, handler.close());
+
+  // 多字段索引打开时需要和创建时相同的字段
+  ASSERT_NE(RC::SUCCESS, handler.open(index_file, types, lengths, 2));
+  ASSERT_EQ(RC::SUCCESS, handler.open(index_file, types, lengths, 3));
+
+  char key[key_length];
+  make_key(7, "n3", 4.0f, key);
+  RID rid = make_rid(734);
+  ASSERT_EQ(RC::SUCCESS, handler.get_entry(key, &rid));
+  make_key(7, "n4", 4.0f, key);
+  ASSERT_EQ(RC::RECORD_INVALID_KEY, handler.get_entry(key, &rid));
+
+  auto scan = [&handler](const char *low, int low_columns, bool low_inclusive, const char *high, int high_columns,
+                  bool high_inclusive) {
+    std::vector<int> result;
+    BplusTreeScanner scanner(handler);
+    EXPECT_EQ(RC::SUCCESS, scanner.open_range(low, low_columns, low_inclusive, high, high_columns, high_inclusive));
+    RID rid;
+    while (scanner.next_entry(&rid) == RC::SUCCESS) {
+      result.push_back((rid.page_num - 1) * 100 + rid.slot_num);
+    }
+    scanner.close();
+    return result;
+  };
+  auto expect = [](int from, int to) {
+    std::vector<int> result;
+    for (int i = from; i <= to; i++) {
+      result.push_back(i);
+    }
+    return result;
+  };
+
+  // tenant = 7
+  make_key(7, "", 0, key);
+  ASSERT_EQ(expect(700, 799), scan(key, 1, true, key, 1, true));
+  // tenant = 7 and name = 'n3'
+  make_key(7, "n3", 0, key);
+  ASSERT_EQ(expect(730, 739), scan(key, 2, true, key, 2, true));
+  // tenant = 7 and name = 'n3' and 2 < score <= 5
+  char low[key_length];
+  char high[key_length];
+  make_key(7, "n3", 2.0f, low);
+  make_key(7, "n3", 5.0f, high);
+  ASSERT_EQ(expect(733, 735), scan(low, 3, false, high, 3, true));
+  // tenant = 7 and name > 'n3'
+  make_key(7, "n3", 0, low);
+  make_key(7, "", 0, high);
+  ASSERT_EQ(expect(740, 799), scan(low, 2, false, high, 1, true));
+  // tenant > 17
+  make_key(17, "", 0, low);
+  ASSERT_EQ(expect(1800, 1999), scan(low, 1, false, nullptr, 0, false));
+  // tenant < 2
+  make_key(2, "", 0, high);
+  ASSERT_EQ(expect(0, 199), scan(nullptr, 0, false, high, 1, false));
+
+  make_key(7, "n3", 4.0f, key);
+  rid = make_rid(734);
+  ASSERT_EQ(RC::SUCCESS, handler.delete_entry(key, &rid));
+  make_key(7, "n3", 0, key);
+  std::vector<int> expected = expect(730, 739);
+  expected.erase(expected.begin() + 4);
+  ASSERT_EQ(expected, scan(key, 2, true, key, 2, true));
+
+  // 扫描时可以同时取出key，只读索引就能得到字段的值
+  {
+    BplusTreeScanner scanner(handler);
+    make_key(12, "", 0, key);
+    ASSERT_EQ(RC::SUCCESS, scanner.open_range(key, 1, true, key, 1, true));
+    char scanned[key_length];
+    char expected_key[key_length];
+    int id = 1200;
+    while (scanner.next_entry(&rid, scanned) == RC::SUCCESS) {
+      char name[5];
+      snprintf(name, sizeof(name), "n%d", id / 10 % 10);
+      make_key(id / 100, name, (float)(id % 10), expected_key);
+      ASSERT_EQ(0, memcmp(expected_key, scanned, key_length));
+      ASSERT_EQ(id, (rid.page_num - 1) * 100 + rid.slot_num);
+      id++;
+    }
+    ASSERT_EQ(1300, id);
+    scanner.close();
+  }
+
+  handler.close();
+  remove(index_file);
+}
+
+TEST(test_bplus_tree, test_unique_keys)
+{
+  const char *index_file = "bplus_tree_unique_test.index";
+  remove(index_file);
+
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, INTS, sizeof(int)));
+  std::vector<int> keys;
+  for (int i = 0; i < KEY_NUM; i++) {
+    keys.push_back(i);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(11));
+  for (int key : keys) {
+    RID rid = make_rid(key);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid, true));
+  }
+
+  // 属性值相同的key不管rid比已有的大还是小都不能插入，相同的key可能在相邻的叶子中
+  auto expect_duplicate = [&handler](int key) {
+    RID larger = make_rid(KEY_NUM * 2 + key);
+    RID smaller;
+    smaller.page_num = 0;
+    smaller.slot_num = key % 100;
+    EXPECT_EQ(RC::RECORD_DUPLICATE_KEY, handler.insert_entry((const char *)&key, &larger, true));
+    EXPECT_EQ(RC::RECORD_DUPLICATE_KEY, handler.insert_entry((const char *)&key, &smaller, true));
+  };
+  for (int key = 0; key < KEY_NUM; key++) {
+    expect_duplicate(key);
+  }
+
+  // 删除之后内部节点中还会留下已经删除的key，这些属性值可以用新的rid再插入
+  for (int key = 0; key < KEY_NUM; key += 3) {
+    RID rid = make_rid(key);
+    ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)&key, &rid));
+  }
+  for (int key = 0; key < KEY_NUM; key++) {
+    if (key % 3 != 0) {
+      expect_duplicate(key);
+    }
+  }
+  for (int key = 0; key < KEY_NUM; key += 3) {
+    RID rid = make_rid(KEY_NUM * 3 + key);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid, true));
+    expect_duplicate(key);
+  }
+
+  // 非唯一的插入不检查属性值
+  int key = 1;
+  RID rid = make_rid(KEY_NUM * 4);
+  ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+  ASSERT_EQ(RC::SUCCESS, handler.close());
+  remove(index_file);
+}
+
+TEST(test_bplus_tree, test_unique_key_prefix)
+{
+  const char *index_file = "bplus_tree_unique_prefix_test.index";
+  remove(index_file);
+
+  // 主键索引(id int)后面跟着记录中的其它字段(value int)，只有id要唯一
+  AttrType types[] = {INTS, INTS};
+  int lengths[] = {4, 4};
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, types, lengths, 2));
+  handler.set_unique_column_num(1);
+  std::vector<int> ids;
+  for (int i = 0; i < KEY_NUM; i++) {
+    ids.push_back(i);
+  }
+  std::shuffle(ids.begin(), ids.end(), std::mt19937(13));
+  for (int id : ids) {
+    int key[2] = {id, KEY_NUM - id};
+    RID rid = make_rid(id);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)key, &rid, true));
+  }
+
+  // 其它字段不同，rid不同，id相同也不能插入
+  for (int id = 0; id < KEY_NUM; id++) {
+    int smaller[2] = {id, -1};
+    int larger[2] = {id, KEY_NUM * 2};
+    RID rid = make_rid(KEY_NUM + id);
+    ASSERT_EQ(RC::RECORD_DUPLICATE_KEY, handler.insert_entry((const char *)smaller, &rid, true));
+    ASSERT_EQ(RC::RECORD_DUPLICATE_KEY, handler.insert_entry((const char *)larger, &rid, true));
+  }
+
+  // 更新其它字段是先删除再插入
+  int old_key[2] = {7, KEY_NUM - 7};
+  int new_key[2] = {7, 0};
+  RID rid = make_rid(7);
+  ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)old_key, &rid));
+  ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)new_key, &rid, true));
+  ASSERT_EQ(RC::RECORD_DUPLICATE_KEY, handler.insert_entry((const char *)old_key, &rid, true));
+
+  // 按id查找时取出整个key
+  BplusTreeScanner scanner(handler);
+  ASSERT_EQ(RC::SUCCESS, scanner.open_range((const char *)new_key, 1, true, (const char *)new_key, 1, true));
+  int scanned[2];
+  ASSERT_EQ(RC::SUCCESS, scanner.next_entry(&rid, (char *)scanned));
+  ASSERT_EQ(7, scanned[0]);
+  ASSERT_EQ(0, scanned[1]);
+  ASSERT_EQ(RC::RECORD_EOF, scanner.next_entry(&rid, (char *)scanned));
+  scanner.close();
+
+  ASSERT_EQ(RC::SUCCESS, handler.close());
+  remove(index_file);
+}
+
+static std::vector<int> scan_all(BplusTreeHandler &handler)
+{
+  BplusTreeScanner scanner(handler);
+  return scan_range(scanner, nullptr, false, nullptr, false);
+}
+
+TEST(test_bplus_tree, test_bulk_load)
+{
+  const char *index_file = "bplus_tree_bulk_test.index";
+  // 覆盖空树、只有一个叶子和多层的情况，排序内存很小时会写临时文件再归并
+  const int counts[] = {0, 1, 150, 50000};
+  const int fill_factors[] = {50, 100};
+  for (int count : counts) {
+    for (int fill_factor : fill_factors) {
+      remove(index_file);
+      BplusTreeHandler handler;
+      ASSERT_EQ(RC::SUCCESS, handler.create(index_file, INTS, sizeof(int)));
+      std::vector<int> keys;
+      for (int i = 0; i < count; i++) {
+        keys.push_back(i);
+      }
+      std::shuffle(keys.begin(), keys.end(), std::mt19937(count));
+      {
+        BplusTreeBulkLoader loader(handler, fill_factor, 4096);
+        for (int key : keys) {
+          RID rid = make_rid(key);
+          ASSERT_EQ(RC::SUCCESS, loader.add_entry((const char *)&key, &rid, true));
+        }
+        ASSERT_EQ(RC::SUCCESS, loader.finish());
+      }
+      std::sort(keys.begin(), keys.end());
+      ASSERT_EQ(keys, scan_all(handler));
+
+      // 建好之后还能正常地插入、删除和查找
+      for (int key = count; key < count + 300; key++) {
+        RID rid = make_rid(key);
+        ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid, true));
+        keys.push_back(key);
+      }
+      for (int key = 0; key < count; key += 2) {
+        RID rid = make_rid(key);
+        ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)&key, &rid));
+      }
+      keys.erase(std::remove_if(keys.begin(), keys.end(), [count](int key) { return key < count && key % 2 == 0; }),
+                 keys.end());
+      for (int key : keys) {
+        RID rid = make_rid(key);
+        ASSERT_EQ(RC::SUCCESS, handler.get_entry((const char *)&key, &rid));
+      }
+      ASSERT_EQ(RC::SUCCESS, handler.sync());
+      ASSERT_EQ(RC::SUCCESS, handler.close());
+      ASSERT_EQ(RC::SUCCESS, handler.open(index_file));
+      ASSERT_EQ(keys, scan_all(handler));
+      ASSERT_EQ(RC::SUCCESS, handler.close());
+    }
+  }
+
+  // 只在检查唯一的索引项之间判断重复，不是空树时不能批量导入
+  remove(index_file);
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, INTS, sizeof(int)));
+  int key = 5;
+  RID rid1 = make_rid(1);
+  RID rid2 = make_rid(2);
+  RID rid3 = make_rid(3);
+  {
+    BplusTreeBulkLoader loader(handler);
+    ASSERT_EQ(RC::SUCCESS, loader.add_entry((const char *)&key, &rid1, true));
+    ASSERT_EQ(RC::SUCCESS, loader.add_entry((const char *)&key, &rid2, false));
+    ASSERT_EQ(RC::SUCCESS, loader.add_entry((const char *)&key, &rid3, true));
+    ASSERT_EQ(RC::RECORD_DUPLICATE_KEY, loader.finish());
+  }
+  ASSERT_EQ(RC::SUCCESS, handler.close());
+  remove(index_file);
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, INTS, sizeof(int)));
+  ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid1));
+  {
+    BplusTreeBulkLoader loader(handler);
+    ASSERT_EQ(RC::SUCCESS, loader.add_entry((const char *)&key, &rid2));
+    ASSERT_NE(RC::SUCCESS, loader.finish());
+  }
+  ASSERT_EQ(RC::SUCCESS, handler.close());
+  remove(index_file);
+}
+
+TEST(test_bplus_tree, test_concurrent_access)
+{
+  const char *index_file = "bplus_tree_concurrent_test.index";
+  remove(index_file);
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, INTS, sizeof(int)));
+
+  // 每个线程插入自己的一段key再删掉其中的奇数，同时有线程一直在扫描和查找
+  const int thread_num = 4;
+  const int keys_per_thread = 20000;
+  std::atomic<int> failures(0);
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> writers;
+  for (int t = 0; t < thread_num; t++) {
+    writers.emplace_back([&handler, &failures, t]() {
+      std::vector<int> keys;
+      for (int i = 0; i < keys_per_thread; i++) {
+        keys.push_back(t * keys_per_thread + i);
+      }
+      std::shuffle(keys.begin(), keys.end(), std::mt19937(t));
+      for (int key : keys) {
+        RID rid = make_rid(key);
+        if (handler.insert_entry((const char *)&key, &rid) != RC::SUCCESS) {
+          failures++;
+        }
+      }
+      for (int key : keys) {
+        RID rid = make_rid(key);
+        if (key % 2 == 1 && handler.delete_entry((const char *)&key, &rid) != RC::SUCCESS) {
+          failures++;
+        }
+      }
+    });
+  }
+  std::thread reader([&handler, &failures, &stop]() {
+    while (!stop) {
+      BplusTreeScanner scanner(handler);
+      if (scanner.open_range(nullptr, false, nullptr, false) != RC::SUCCESS) {
+        failures++;
+        return;
+      }
+      RID rid;
+      int key;
+      int last = -1;
+      while (scanner.next_entry(&rid, (char *)&key) == RC::SUCCESS) {
+        RID expected = make_rid(key);
+        if (key <= last || rid.page_num != expected.page_num || rid.slot_num != expected.slot_num) {
+          failures++;
+        }
+        last = key;
+      }
+      scanner.close();
+
+      int probe = last / 2;
+      RID found = make_rid(probe);
+      RC rc = handler.get_entry((const char *)&probe, &found);
+      if (rc != RC::SUCCESS && rc != RC::RECORD_INVALID_KEY) {
+        failures++;
+      }
+    }
+  });
+  for (std::thread &writer : writers) {
+    writer.join();
+  }
+  stop = true;
+  reader.join();
+  ASSERT_EQ(0, failures.load());
+
+  BplusTreeScanner scanner(handler);
+  ASSERT_EQ(RC::SUCCESS, scanner.open_range(nullptr, false, nullptr, false));
+  RID rid;
+  int count = 0;
+  while (scanner.next_entry(&rid) == RC::SUCCESS) {
+    ASSERT_EQ(make_rid(count * 2).page_num, rid.page_num);
+    ASSERT_EQ(make_rid(count * 2).slot_num, rid.slot_num);
+    count++;
+  }
+  scanner.close();
+  ASSERT_EQ(thread_num * keys_per_thread / 2, count);
+
+  handler.close();
+  remove(index_file);
+}
+
+TEST(test_bplus_tree, test_many_open_scanners)
+{
+  const char *index_file = "bplus_tree_scanners_test.index";
+  remove(index_file);
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, INTS, sizeof(int)));
+  const int key_num = 20000;
+  for (int key = 0; key < key_num; key++) {
+    RID rid = make_rid(key);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+  }
+
+  // 扫描器在两次next_entry之间不pin页面，同时打开的扫描器比缓冲池的frame还多也没关系。
+  // 轮流前进的时候插入范围之外的key，让树分裂，扫描器要从上次的位置重新查找
+  const int scanner_num = BP_BUFFER_SIZE * 2;
+  const int low = 0;
+  const int high = key_num - 1;
+  std::vector<BplusTreeScanner *> scanners;
+  std::vector<int> next_keys(scanner_num, 0);
+  for (int i = 0; i < scanner_num; i++) {
+    BplusTreeScanner *scanner = new BplusTreeScanner(handler);
+    ASSERT_EQ(RC::SUCCESS, scanner->open_range((const char *)&low, true, (const char *)&high, true));
+    scanners.push_back(scanner);
+  }
+  int extra_key = key_num * 10;
+  bool running = true;
+  while (running) {
+    running = false;
+    for (int i = 0; i < scanner_num; i++) {
+      // 每个扫描器的步长不同，停在不同的叶子上
+      for (int step = 0; step < (i % 7 + 1) * 37 && next_keys[i] < key_num; step++) {
+        RID rid;
+        int key;
+        ASSERT_EQ(RC::SUCCESS, scanners[i]->next_entry(&rid, (char *)&key));
+        ASSERT_EQ(next_keys[i], key);
+        next_keys[i]++;
+      }
+      running = running || next_keys[i] < key_num;
+      RID rid = make_rid(extra_key);
+      ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&extra_key, &rid));
+      extra_key++;
+    }
+  }
+  for (BplusTreeScanner *scanner : scanners) {
+    RID rid;
+    ASSERT_EQ(RC::RECORD_EOF, scanner->next_entry(&rid));
+    scanner->close();
+    delete scanner;
+  }
+
+  handler.close();
+  remove(index_file);
+}
+
+TEST(test_bplus_tree, test_map_readonly)
+{
+  const char *index_file = "bplus_tree_map_test.index";
+  remove(index_file);
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, INTS, sizeof(int)));
+  for (int key = 0; key < KEY_NUM; key += 2) {
+    RID rid = make_rid(key);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+  }
+
+  // 映射之后查找和扫描直接读文件映射中的页面
+  ASSERT_EQ(RC::SUCCESS, handler.map_readonly());
+  for (int key = 0; key < KEY_NUM; key++) {
+    RID rid = make_rid(key);
+    ASSERT_EQ(key % 2 == 0 ? RC::SUCCESS : RC::RECORD_INVALID_KEY, handler.get_entry((const char *)&key, &rid));
+  }
+  BplusTreeScanner scanner(handler);
+  int low = 100;
+  int high = 1000;
+  ASSERT_EQ(expected_range(100, 1000), scan_range(scanner, &low, true, &high, true));
+  ASSERT_EQ(expected_range(0, KEY_NUM - 1), scan_range(scanner, nullptr, false, nullptr, false));
+
+  handler.close();
+  remove(index_file);
+}
+
+TEST(test_bplus_tree, test_inner_node_cache)
+{
+  const char *index_file = "bplus_tree_cache_test.index";
+  remove(index_file);
+  BplusTreeHandler handler;
+  // 内部节点中只放能区分两个叶子的短key，要很多个没有共同前缀的长key才有好几层内部节点
+  const int key_length = 200;
+  const int key_num = 20000;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, CHARS, key_length));
+  auto make_key = [key_length](int i) {
+    std::vector<char> key(key_length, 0);
+    std::mt19937 random(i);
+    for (int j = 0; j < key_length - 1; j++) {
+      key[j] = 'a' + random() % 26;
+    }
+    return key;
+  };
+  for (int i = 0; i < key_num; i += 2) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry(make_key(i).data(), &rid));
+  }
+  for (int i = 0; i < key_num; i++) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(i % 2 == 0 ? RC::SUCCESS : RC::RECORD_INVALID_KEY, handler.get_entry(make_key(i).data(), &rid));
+  }
+  ASSERT_GT(handler.cached_inner_nodes(), 1u);
+
+  // 分裂和合并之后缓存的节点失效，查找仍然要找到正确的叶子
+  for (int i = 1; i < key_num; i += 2) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry(make_key(i).data(), &rid));
+    RID found = make_rid(i - 1);
+    ASSERT_EQ(RC::SUCCESS, handler.get_entry(make_key(i - 1).data(), &found));
+  }
+  for (int i = 0; i < key_num; i += 3) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, handler.delete_entry(make_key(i).data(), &rid));
+  }
+  for (int i = 0; i < key_num; i++) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(i % 3 == 0 ? RC::RECORD_INVALID_KEY : RC::SUCCESS, handler.get_entry(make_key(i).data(), &rid));
+  }
+  ASSERT_GT(handler.cached_inner_nodes(), 1u);
+
+  handler.close();
+  ASSERT_EQ(0u, handler.cached_inner_nodes());
+  remove(index_file);
+}
+
+static long index_file_size(const char *index_file, const std::vector<int> &keys)
+{
+  remove(index_file);
+  BplusTreeHandler handler;
+  const int key_length = 200;
+  if (handler.create(index_file, CHARS, key_length) != RC::SUCCESS) {
+    return -1;
+  }
+  std::vector<char> key(key_length, 0);
+  for (int i : keys) {
+    snprintf(key.data(), key_length, "key%06d", i);
+    RID rid = make_rid(i);
+    if (handler.insert_entry(key.data(), &rid, true) != RC::SUCCESS) {
+      return -1;
+    }
+  }
+  for (int i = 0; i < (int)keys.size(); i++) {
+    snprintf(key.data(), key_length, "key%06d", i);
+    RID rid = make_rid(i);
+    if (handler.get_entry(key.data(), &rid) != RC::SUCCESS) {
+      return -1;
+    }
+  }
+  handler.close();
+  struct stat st;
+  if (stat(index_file, &st) != 0) {
+    return -1;
+  }
+  remove(index_file);
+  return st.st_size;
+}
+
+TEST(test_bplus_tree, test_append_split)
+{
+  std::vector<int> keys;
+  for (int i = 0; i < KEY_NUM; i++) {
+    keys.push_back(i);
+  }
+  const long append_size = index_file_size("bplus_tree_append_test.index", keys);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+  const long random_size = index_file_size("bplus_tree_append_test.index", keys);
+  ASSERT_GT(append_size, 0);
+  ASSERT_GT(random_size, 0);
+  // 递增插入时左边的叶子几乎是满的
+  ASSERT_LT(append_size, random_size * 3 / 4);
+}
+
+TEST(test_bplus_tree, test_key_compression)
+{
+  const char *index_file = "bplus_tree_compression_test.index";
+  remove(index_file);
+  BplusTreeHandler handler;
+  // 一个页面放不下三个最长的key
+  ASSERT_EQ(RC::INVALID_ARGUMENT, handler.create(index_file, CHARS, 2000));
+  remove(index_file);
+
+  const int key_length = 200;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, CHARS, key_length));
+  auto make_key = [key_length](int i) {
+    std::vector<char> key(key_length, 0);
+    snprintf(key.data(), key_length, "/data/warehouse/customer/orders/%06d", i);
+    return key;
+  };
+  std::vector<int> keys;
+  for (int i = 0; i < KEY_NUM; i++) {
+    keys.push_back(i);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+  for (int i : keys) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry(make_key(i).data(), &rid));
+  }
+  ASSERT_EQ(RC::SUCCESS, handler.close());
+
+  // 共同的前缀和末尾的0都不保存，文件比不压缩时一个页面只能放下的key少得多
+  struct stat st;
+  ASSERT_EQ(0, stat(index_file, &st));
+  ASSERT_LT(st.st_size, (long)KEY_NUM * (key_length + (long)sizeof(RID)) / 4);
+
+  ASSERT_EQ(RC::SUCCESS, handler.open(index_file));
+  for (int i : keys) {
+    if (i % 10 != 0) {
+      RID rid = make_rid(i);
+      ASSERT_EQ(RC::SUCCESS, handler.delete_entry(make_key(i).data(), &rid));
+    }
+  }
+  for (int i = 0; i < KEY_NUM; i++) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(i % 10 == 0 ? RC::SUCCESS : RC::RECORD_INVALID_KEY, handler.get_entry(make_key(i).data(), &rid));
+  }
+  for (int i = 0; i < KEY_NUM; i += 10) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, handler.delete_entry(make_key(i).data(), &rid));
+  }
+  RID rid = make_rid(7);
+  ASSERT_EQ(RC::SUCCESS, handler.insert_entry(make_key(7).data(), &rid));
+  ASSERT_EQ(RC::SUCCESS, handler.get_entry(make_key(7).data(), &rid));
+
+  handler.close();
+  remove(index_file);
+}
+
+TEST(test_bplus_tree, test_lazy_merge)
+{
+  const char *index_file = "bplus_tree_lazy_merge_test.index";
+  remove(index_file);
+  ASSERT_EQ(RC::INVALID_ARGUMENT, set_bplus_tree_merge_threshold(60));
+  ASSERT_EQ(RC::SUCCESS, set_bplus_tree_merge_threshold(0));
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, INTS, sizeof(int)));
+  for (int key = 0; key < KEY_NUM; key++) {
+    RID rid = make_rid(key);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+  }
+
+  // 只在叶子删空时合并，叶子可以只剩很少的key
+  for (int round = 0; round < 3; round++) {
+    for (int key = 0; key < KEY_NUM; key++) {
+      if (key % 10 != 0) {
+        RID rid = make_rid(key);
+        ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)&key, &rid));
+      }
+    }
+    for (int key = 0; key < KEY_NUM; key++) {
+      RID rid = make_rid(key);
+      ASSERT_EQ(key % 10 == 0 ? RC::SUCCESS : RC::RECORD_INVALID_KEY, handler.get_entry((const char *)&key, &rid));
+    }
+    for (int key = 0; key < KEY_NUM; key++) {
+      if (key % 10 != 0) {
+        RID rid = make_rid(key);
+        ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+      }
+    }
+  }
+  std::vector<int> all_keys;
+  for (int key = 0; key < KEY_NUM; key++) {
+    all_keys.push_back(key);
+  }
+  BplusTreeScanner scanner(handler);
+  ASSERT_EQ(all_keys, scan_range(scanner, nullptr, false, nullptr, false));
+
+  // 全部删掉之后叶子都合并了
+  for (int key = 0; key < KEY_NUM; key++) {
+    RID rid = make_rid(key);
+    ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)&key, &rid));
+  }
+  ASSERT_TRUE(scan_range(scanner, nullptr, false, nullptr, false).empty());
+  int key = 7;
+  RID rid = make_rid(key);
+  ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+  ASSERT_EQ(RC::SUCCESS, handler.get_entry((const char *)&key, &rid));
+
+  ASSERT_EQ(RC::SUCCESS, set_bplus_tree_merge_threshold(50));
+  handler.close();
+  remove(index_file);
+}
+
+TEST(test_bplus_tree, test_change_buffer)
+{
+  const char *index_file = "bplus_tree_change_buffer_test.index";
+  remove(index_file);
+  {
+    BplusTreeHandler handler;
+    ASSERT_EQ(RC::SUCCESS, handler.create(index_file, INTS, sizeof(int)));
+    for (int key = 0; key < KEY_NUM; key += 2) {
+      RID rid = make_rid(key);
+      ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+    }
+    ASSERT_EQ(RC::SUCCESS, handler.close());
+  }
+
+  ASSERT_EQ(RC::INVALID_ARGUMENT, set_bplus_tree_change_buffer(-1));
+  ASSERT_EQ(RC::SUCCESS, set_bplus_tree_change_buffer(KEY_NUM * 2));
+  // 重新打开之后叶子都不在缓冲池中，修改先缓存起来
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.open(index_file));
+  for (int key = 1; key < KEY_NUM; key += 2) {
+    RID rid = make_rid(key);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+  }
+  for (int key = 0; key < KEY_NUM; key += 10) {
+    RID rid = make_rid(key);
+    ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)&key, &rid));
+  }
+  const size_t buffered = handler.buffered_changes();
+  ASSERT_GT(buffered, 0u);
+
+  // 重复的修改在缓存中就能发现，相反的修改互相抵消
+  int key = KEY_NUM / 2 + 1;
+  RID rid = make_rid(key);
+  ASSERT_EQ(RC::RECORD_DUPLICATE_KEY, handler.insert_entry((const char *)&key, &rid));
+  ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)&key, &rid));
+  key = KEY_NUM / 2;
+  rid = make_rid(key);
+  ASSERT_EQ(RC::RECORD_INVALID_KEY, handler.delete_entry((const char *)&key, &rid));
+  ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+  ASSERT_EQ(buffered - 2, handler.buffered_changes());
+
+  // 查询之前合并
+  std::vector<int> expected;
+  for (key = 0; key < KEY_NUM; key++) {
+    if (key != KEY_NUM / 2 + 1 && (key == KEY_NUM / 2 || key % 10 != 0)) {
+      expected.push_back(key);
+    }
+  }
+  ASSERT_EQ(expected, scan_all(handler));
+  ASSERT_EQ(0u, handler.buffered_changes());
+  key = 10;
+  rid = make_rid(key);
+  ASSERT_EQ(RC::RECORD_INVALID_KEY, handler.get_entry((const char *)&key, &rid));
+
+  // 缓存满了时合并
+  ASSERT_EQ(RC::SUCCESS, set_bplus_tree_change_buffer(8));
+  ASSERT_EQ(RC::SUCCESS, handler.close());
+  ASSERT_EQ(RC::SUCCESS, handler.open(index_file));
+  for (key = 0; key < KEY_NUM; key += 10) {
+    if (key == KEY_NUM / 2) {
+      continue;
+    }
+    RID rid = make_rid(key);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+    ASSERT_LT(handler.buffered_changes(), 8u);
+  }
+  ASSERT_EQ(RC::SUCCESS, set_bplus_tree_change_buffer(0));
+  ASSERT_EQ(RC::SUCCESS, handler.close());
+
+  // close时写回了缓存的修改
+  ASSERT_EQ(RC::SUCCESS, handler.open(index_file));
+  std::vector<int> all_keys;
+  for (key = 0; key < KEY_NUM; key++) {
+    if (key != KEY_NUM / 2 + 1) {
+      all_keys.push_back(key);
+    }
+  }
+  ASSERT_EQ(all_keys, scan_all(handler));
+  handler.close();
+  remove(index_file);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,201 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the binary catalog of table metas.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "json/json.h"
+#include "storage/common/catalog_file.h"
+#include "storage/common/table_meta.h"
+#include "gtest/gtest.h"
+
+static const char *CATALOG_FILE = "catalog_file_test.catalog";
+static const char *META_FILE = "catalog_file_test.table";
+
+static void init_table_meta(TableMeta &table_meta)
+{
+  AttrInfo attributes[] = {
+      {(char *)"id", INTS, 4, 0},
+      {(char *)"score", FLOATS, 4, 1},
+      {(char *)"name", CHARS, 8, 0},
+  };
+  ASSERT_EQ(RC::SUCCESS, table_meta.init("t", 3, attributes));
+  IndexMeta index;
+  std::vector<const FieldMeta *> fields = {table_meta.field("name"), table_meta.field("id")};
+  ASSERT_EQ(RC::SUCCESS, index.init("i_name_id", fields, false, std::vector<int>{4, 0}));
+  ASSERT_EQ(RC::SUCCESS, table_meta.add_index(index));
+}
+
+static void write_meta_file(const TableMeta &table_meta)
+{
+  std::fstream fs(META_FILE, std::ios_base::out | std::ios_base::trunc);
+  table_meta.serialize(fs);
+}
+
+TEST(CatalogFileTest, binary_round_trip)
+{
+  TableMeta table_meta;
+  init_table_meta(table_meta);
+  table_meta.set_in_memory(true);
+  std::string data;
+  table_meta.serialize_binary(data);
+
+  TableMeta decoded;
+  ASSERT_EQ(RC::SUCCESS, decoded.deserialize_binary(data.data(), (int)data.size()));
+  ASSERT_STREQ("t", decoded.name());
+  ASSERT_TRUE(decoded.in_memory());
+  ASSERT_EQ(table_meta.field_num(), decoded.field_num());
+  ASSERT_EQ(table_meta.record_size(), decoded.record_size());
+  ASSERT_TRUE(decoded.null_bitmap());
+  ASSERT_EQ(table_meta.record_data_size(), decoded.record_data_size());
+  ASSERT_TRUE(decoded.field("score")->nullable());
+  ASSERT_EQ(table_meta.field("name")->offset(), decoded.field("name")->offset());
+  const IndexMeta *index = decoded.index("i_name_id");
+  ASSERT_NE(nullptr, index);
+  ASSERT_EQ(2, index->field_num());
+  ASSERT_STREQ("id", index->field(1));
+  ASSERT_EQ(4, index->prefix_length(0));
+
+  // 截断的数据不能解码
+  TableMeta truncated;
+  ASSERT_NE(RC::SUCCESS, truncated.deserialize_binary(data.data(), (int)data.size() - 1));
+}
+
+TEST(CatalogFileTest, null_flags)
+{
+  TableMeta table_meta;
+  std::vector<std::string> names;
+  std::vector<AttrInfo> attributes;
+  for (int i = 0; i < 10; i++)
+  {
+    names.push_back("f" + std::to_string(i));
+  }
+  for (const std::string &name : names)
+  {
+    attributes.push_back({(char *)name.c_str(), INTS, 4, 1});
+  }
+  ASSERT_EQ(RC::SUCCESS, table_meta.init("t", (int)attributes.size(), attributes.data()));
+
+  // 10个字段的null标志占2个字节，第i个字段是第i位
+  ASSERT_TRUE(table_meta.null_bitmap());
+  ASSERT_EQ(2, table_meta.null_flags_size());
+  ASSERT_EQ(table_meta.record_size() + 2, table_meta.record_data_size());
+  NullFlag f0 = table_meta.null_flag(table_meta.find_field_index_by_name("f0"));
+  NullFlag f9 = table_meta.null_flag(table_meta.find_field_index_by_name("f9"));
+  ASSERT_EQ(table_meta.record_size(), f0.offset);
+  ASSERT_EQ(1, f0.mask);
+  ASSERT_EQ(table_meta.record_size() + 1, f9.offset);
+  ASSERT_EQ(2, f9.mask);
+
+  std::vector<char> record(table_meta.record_data_size(), 0);
+  f9.set(record.data(), true);
+  ASSERT_TRUE(f9.test(record.data()));
+  ASSERT_FALSE(table_meta.null_flag(table_meta.find_field_index_by_name("f8")).test(record.data()));
+  f9.set(record.data(), false);
+  ASSERT_FALSE(f9.test(record.data()));
+
+  // 没有null_format的是以前的版本创建的表，每个字段一个字节
+  std::stringstream ss;
+  table_meta.serialize(ss);
+  Json::Value table_value;
+  Json::CharReaderBuilder builder;
+  std::string errors;
+  ASSERT_TRUE(Json::parseFromStream(builder, ss, &table_value, &errors));
+  table_value.removeMember("null_format");
+  std::stringstream legacy_ss(Json::writeString(Json::StreamWriterBuilder(), table_value));
+  TableMeta legacy;
+  ASSERT_LT(0, legacy.deserialize(legacy_ss));
+  ASSERT_FALSE(legacy.null_bitmap());
+  ASSERT_EQ(legacy.field_num(), legacy.null_flags_size());
+  f9 = legacy.null_flag(legacy.find_field_index_by_name("f9"));
+  ASSERT_EQ(legacy.record_size() + 9, f9.offset);
+  ASSERT_EQ(1, f9.mask);
+}
+
+TEST(CatalogFileTest, save_and_find)
+{
+  remove(CATALOG_FILE);
+  TableMeta table_meta;
+  init_table_meta(table_meta);
+  write_meta_file(table_meta);
+
+  std::vector<CatalogEntry> entries(1);
+  ASSERT_EQ(RC::SUCCESS, CatalogFile::make_entry(table_meta, META_FILE, entries[0]));
+  ASSERT_EQ(RC::SUCCESS, CatalogFile::save(CATALOG_FILE, entries));
+
+  {
+    CatalogFile catalog;
+    ASSERT_EQ(RC::SUCCESS, catalog.load(CATALOG_FILE));
+    ASSERT_EQ(1, catalog.table_num());
+    TableMeta found;
+    ASSERT_EQ(RC::SUCCESS, catalog.find("t", META_FILE, found));
+    ASSERT_EQ(table_meta.field_num(), found.field_num());
+    ASSERT_NE(nullptr, found.index("i_name_id"));
+    ASSERT_EQ(RC::NOTFOUND, catalog.find("t2", META_FILE, found));
+  }
+
+  // JSON文件改过之后catalog中的条目就过期了
+  IndexMeta index;
+  ASSERT_EQ(RC::SUCCESS, index.init("i_id", *table_meta.field("id")));
+  ASSERT_EQ(RC::SUCCESS, table_meta.add_index(index));
+  write_meta_file(table_meta);
+  {
+    CatalogFile catalog;
+    ASSERT_EQ(RC::SUCCESS, catalog.load(CATALOG_FILE));
+    TableMeta found;
+    ASSERT_EQ(RC::NOTFOUND, catalog.find("t", META_FILE, found));
+  }
+
+  remove(CATALOG_FILE);
+  remove(META_FILE);
+}
+
+TEST(CatalogFileTest, corrupt)
+{
+  remove(CATALOG_FILE);
+  TableMeta table_meta;
+  init_table_meta(table_meta);
+  write_meta_file(table_meta);
+  std::vector<CatalogEntry> entries(1);
+  ASSERT_EQ(RC::SUCCESS, CatalogFile::make_entry(table_meta, META_FILE, entries[0]));
+  ASSERT_EQ(RC::SUCCESS, CatalogFile::save(CATALOG_FILE, entries));
+
+  // 改掉最后一个字节，校验和对不上
+  FILE *file = fopen(CATALOG_FILE, "r+b");
+  ASSERT_NE(nullptr, file);
+  fseek(file, -1, SEEK_END);
+  int c = fgetc(file);
+  fseek(file, -1, SEEK_END);
+  fputc(c ^ 0xff, file);
+  fclose(file);
+
+  CatalogFile catalog;
+  ASSERT_NE(RC::SUCCESS, catalog.load(CATALOG_FILE));
+  ASSERT_EQ(0, catalog.table_num());
+
+  ASSERT_NE(RC::SUCCESS, catalog.load("catalog_file_test.missing"));
+  remove(CATALOG_FILE);
+  remove(META_FILE);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
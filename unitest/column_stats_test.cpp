@@ -0,0 +1,172 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for column statistics collected by ANALYZE TABLE.
+//
+
+#include <string.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "storage/common/column_stats.h"
+#include "storage/common/table_meta.h"
+#include "gtest/gtest.h"
+
+static void init_table_meta(TableMeta &table_meta)
+{
+  AttrInfo attributes[] = {
+      {(char *)"id", INTS, 4, 0},
+      {(char *)"name", CHARS, 8, 1},
+  };
+  ASSERT_EQ(RC::SUCCESS, table_meta.init("t", 2, attributes));
+}
+
+/**
+ * 和Table中的记录格式相同，字段之后是null标志
+ */
+static void make_record(const TableMeta &table_meta, int id, const char *name, std::vector<char> &record)
+{
+  record.assign(table_meta.record_data_size(), 0);
+  memcpy(record.data() + table_meta.field("id")->offset(), &id, sizeof(id));
+  if (name == nullptr)
+  {
+    table_meta.null_flag(table_meta.find_field_index_by_name("name")).set(record.data(), true);
+  }
+  else
+  {
+    strncpy(record.data() + table_meta.field("name")->offset(), name, 8);
+  }
+}
+
+static NullFlag null_flag(const TableMeta &table_meta, const char *field_name)
+{
+  return table_meta.null_flag(table_meta.find_field_index_by_name(field_name));
+}
+
+static uint32_t mix(uint32_t hash)
+{
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+TEST(ColumnStatsTest, hyper_log_log)
+{
+  HyperLogLog small;
+  for (uint32_t i = 0; i < 100; i++)
+  {
+    small.add(mix(i));
+    small.add(mix(i));
+  }
+  ASSERT_NEAR(100, small.estimate(), 5);
+
+  HyperLogLog large;
+  HyperLogLog other;
+  for (uint32_t i = 0; i < 100000; i++)
+  {
+    (i % 2 == 0 ? large : other).add(mix(i));
+  }
+  large.merge(other);
+  ASSERT_NEAR(100000, large.estimate(), 100000 * 0.1);
+}
+
+TEST(ColumnStatsTest, collect)
+{
+  TableMeta table_meta;
+  init_table_meta(table_meta);
+  common::RandomGenerator random;
+  ColumnStatsCollector id_collector(random, *table_meta.field("id"), null_flag(table_meta, "id"));
+  ColumnStatsCollector name_collector(random, *table_meta.field("name"), null_flag(table_meta, "name"));
+
+  // id是0到999，name每4条记录中有1条是null，其它只有10个不同的值
+  std::vector<char> record;
+  for (int i = 0; i < 1000; i++)
+  {
+    std::string name = "n" + std::to_string(i % 10);
+    make_record(table_meta, i, i % 4 == 0 ? nullptr : name.c_str(), record);
+    id_collector.add(record.data());
+    name_collector.add(record.data());
+  }
+
+  ColumnStats id_stats;
+  id_collector.build(1000, 1000, id_stats);
+  ASSERT_TRUE(id_stats.valid());
+  ASSERT_EQ(0, id_stats.null_fraction());
+  ASSERT_NEAR(1000, id_stats.distinct_count(), 50);
+  ASSERT_EQ(COLUMN_STATS_HISTOGRAM_BUCKETS + 1, (int)id_stats.histogram().size());
+  ASSERT_EQ(0, id_stats.histogram().front());
+  ASSERT_EQ(999, id_stats.histogram().back());
+  ASSERT_NEAR(0.25, id_stats.compare_selectivity(LESS_THAN, 250), 0.02);
+  ASSERT_NEAR(0.1, id_stats.compare_selectivity(GREAT_EQUAL, 900), 0.02);
+  ASSERT_EQ(0, id_stats.compare_selectivity(LESS_THAN, -5));
+  ASSERT_EQ(1, id_stats.compare_selectivity(LESS_EQUAL, 5000));
+
+  ColumnStats name_stats;
+  name_collector.build(1000, 1000, name_stats);
+  ASSERT_DOUBLE_EQ(0.25, name_stats.null_fraction());
+  ASSERT_EQ(10, name_stats.distinct_count());
+  ASSERT_TRUE(name_stats.histogram().empty());
+  ASSERT_DOUBLE_EQ(0.075, name_stats.equal_selectivity());
+  ASSERT_LT(name_stats.compare_selectivity(LESS_THAN, 1), 0);
+
+  // 只读到一部分记录时，几乎没有重复值的字段按比例放大，有很多重复值的不放大
+  id_collector.build(1000, 10000, id_stats);
+  ASSERT_NEAR(10000, id_stats.distinct_count(), 500);
+  name_collector.build(1000, 10000, name_stats);
+  ASSERT_EQ(10, name_stats.distinct_count());
+}
+
+TEST(ColumnStatsTest, table_meta_round_trip)
+{
+  TableMeta table_meta;
+  init_table_meta(table_meta);
+  ASSERT_FALSE(table_meta.analyzed());
+  std::vector<ColumnStats> column_stats(table_meta.field_num());
+  column_stats[table_meta.find_field_index_by_name("id")].set(0, 100, std::vector<double>{1, 50, 100});
+  column_stats[table_meta.find_field_index_by_name("name")].set(0.5, 7, std::vector<double>());
+  table_meta.set_stats(200, std::move(column_stats));
+
+  std::stringstream ss;
+  ASSERT_GT(table_meta.serialize(ss), 0);
+  TableMeta from_json;
+  ASSERT_GT(from_json.deserialize(ss), 0);
+
+  std::string data;
+  table_meta.serialize_binary(data);
+  TableMeta from_binary;
+  ASSERT_EQ(RC::SUCCESS, from_binary.deserialize_binary(data.data(), (int)data.size()));
+
+  for (const TableMeta *decoded : {&from_json, &from_binary})
+  {
+    ASSERT_TRUE(decoded->analyzed());
+    ASSERT_EQ(200, decoded->stats_row_count());
+    ASSERT_EQ(nullptr, decoded->column_stats(0));
+    const ColumnStats *id_stats = decoded->column_stats(decoded->find_field_index_by_name("id"));
+    ASSERT_NE(nullptr, id_stats);
+    ASSERT_EQ(100, id_stats->distinct_count());
+    ASSERT_EQ(std::vector<double>({1, 50, 100}), id_stats->histogram());
+    const ColumnStats *name_stats = decoded->column_stats(decoded->find_field_index_by_name("name"));
+    ASSERT_NE(nullptr, name_stats);
+    ASSERT_DOUBLE_EQ(0.5, name_stats->null_fraction());
+    ASSERT_TRUE(name_stats->histogram().empty());
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
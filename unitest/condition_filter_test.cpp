@@ -0,0 +1,185 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for compiled condition filters.
+//
+
+#include <string.h>
+
+#include "storage/common/condition_filter.h"
+#include "storage/common/record_manager.h"
+#include "gtest/gtest.h"
+
+// 记录格式：id(int) | v(int) | f(float) | name(char(8)) | 三个字段的null标志
+#define ID_OFFSET 0
+#define V_OFFSET 4
+#define F_OFFSET 8
+#define NAME_OFFSET 12
+#define NULL_OFFSET 20
+#define RECORD_SIZE 24
+
+static void make_record(char *data, int id, int v, bool v_null, float f, const char *name)
+{
+  memset(data, 0, RECORD_SIZE);
+  memcpy(data + ID_OFFSET, &id, sizeof(id));
+  memcpy(data + V_OFFSET, &v, sizeof(v));
+  memcpy(data + F_OFFSET, &f, sizeof(f));
+  strncpy(data + NAME_OFFSET, name, 8);
+  // 字段的null标志是NULL_OFFSET处的位图，v是第1位
+  data[NULL_OFFSET] = v_null ? 0x02 : 0;
+}
+
+static ConDesc attr_desc(int offset, int length, int null_bit)
+{
+  return ConDesc{true, NullFlag{NULL_OFFSET, (unsigned char)(1 << null_bit)}, length, offset, nullptr};
+}
+
+static ConDesc value_desc(void *value)
+{
+  return ConDesc{false, NullFlag(), 0, 0, value};
+}
+
+static bool match(const ConditionFilter &filter, char *data)
+{
+  Record record;
+  record.data = data;
+  return filter.filter(record);
+}
+
+TEST(ConditionFilterTest, compare)
+{
+  char data[RECORD_SIZE];
+  make_record(data, 3, 5, false, 1.5f, "kiwi");
+
+  int three = 3;
+  DefaultConditionFilter id_equal;
+  ASSERT_EQ(RC::SUCCESS, id_equal.init(attr_desc(ID_OFFSET, 4, 0), value_desc(&three), INTS, EQUAL_TO, INTS));
+  ASSERT_TRUE(match(id_equal, data));
+
+  DefaultConditionFilter id_less_v;
+  ASSERT_EQ(RC::SUCCESS, id_less_v.init(attr_desc(ID_OFFSET, 4, 0), attr_desc(V_OFFSET, 4, 1),
+                                        INTS, LESS_THAN, INTS));
+  ASSERT_TRUE(match(id_less_v, data));
+
+  float f = 1.5000001f;
+  DefaultConditionFilter f_equal;
+  ASSERT_EQ(RC::SUCCESS, f_equal.init(attr_desc(F_OFFSET, 4, 2), value_desc(&f), FLOATS, EQUAL_TO, FLOATS));
+  ASSERT_TRUE(match(f_equal, data));
+
+  // 值在左边时按照右边字段的长度比较
+  char name[] = "kiwi";
+  DefaultConditionFilter name_greater;
+  ASSERT_EQ(RC::SUCCESS, name_greater.init(value_desc(name), attr_desc(NAME_OFFSET, 8, 2), CHARS,
+                                           GREAT_THAN, CHARS));
+  ASSERT_FALSE(match(name_greater, data));
+  make_record(data, 3, 5, false, 1.5f, "apple");
+  ASSERT_TRUE(match(name_greater, data));
+}
+
+TEST(ConditionFilterTest, null)
+{
+  char data[RECORD_SIZE];
+  make_record(data, 3, 0, true, 1.5f, "kiwi");
+
+  int zero = 0;
+  DefaultConditionFilter v_equal;
+  ASSERT_EQ(RC::SUCCESS, v_equal.init(attr_desc(V_OFFSET, 4, 1), value_desc(&zero), INTS, EQUAL_TO, INTS));
+  ASSERT_FALSE(match(v_equal, data));
+
+  // 右边的字段是null时比较也不成立
+  DefaultConditionFilter id_not_equal_v;
+  ASSERT_EQ(RC::SUCCESS, id_not_equal_v.init(attr_desc(ID_OFFSET, 4, 0),
+                                             attr_desc(V_OFFSET, 4, 1), INTS, NOT_EQUAL, INTS));
+  ASSERT_FALSE(match(id_not_equal_v, data));
+
+  DefaultConditionFilter v_is_null;
+  ASSERT_EQ(RC::SUCCESS, v_is_null.init(attr_desc(V_OFFSET, 4, 1), value_desc(nullptr), INTS, IS_NULL, NULLS));
+  ASSERT_TRUE(match(v_is_null, data));
+  DefaultConditionFilter v_is_not_null;
+  ASSERT_EQ(RC::SUCCESS, v_is_not_null.init(attr_desc(V_OFFSET, 4, 1), value_desc(nullptr), INTS,
+                                            IS_NOT_NULL, NULLS));
+  ASSERT_FALSE(match(v_is_not_null, data));
+}
+
+TEST(ConditionFilterTest, batch)
+{
+  const int num = 100;
+  char data[num][RECORD_SIZE];
+  const char *records[num];
+  for (int i = 0; i < num; i++) {
+    make_record(data[i], i, i % 7, i % 10 == 0, i * 0.5f, "x");
+    records[i] = data[i];
+  }
+
+  int low = 20;
+  int high = 3;
+  DefaultConditionFilter id_greater;
+  DefaultConditionFilter v_less;
+  ASSERT_EQ(RC::SUCCESS, id_greater.init(attr_desc(ID_OFFSET, 4, 0), value_desc(&low), INTS, GREAT_EQUAL, INTS));
+  ASSERT_EQ(RC::SUCCESS, v_less.init(attr_desc(V_OFFSET, 4, 1), value_desc(&high), INTS, LESS_THAN, INTS));
+  const ConditionFilter *filters[] = {&id_greater, &v_less};
+  CompositeConditionFilter composite;
+  ASSERT_EQ(RC::SUCCESS, composite.init(filters, 2));
+
+  uint8_t sel[num];
+  composite.filter(records, num, sel);
+  for (int i = 0; i < num; i++) {
+    const bool expected = i >= 20 && i % 10 != 0 && i % 7 < 3;
+    ASSERT_EQ(expected, sel[i] != 0) << "i=" << i;
+    ASSERT_EQ(expected, match(composite, data[i])) << "i=" << i;
+  }
+
+  id_greater.filter(records, num, sel);
+  for (int i = 0; i < num; i++) {
+    ASSERT_EQ(i >= 20, sel[i] != 0) << "i=" << i;
+  }
+}
+
+TEST(ConditionFilterTest, filter_page)
+{
+  const int num = 50;
+  char page[num * RECORD_SIZE];
+  char bitmap[(num + 7) / 8];
+  memset(bitmap, 0, sizeof(bitmap));
+  for (int i = 0; i < num; i++) {
+    make_record(page + i * RECORD_SIZE, i, i % 7, i % 10 == 0, i * 0.5f, i % 2 == 0 ? "even" : "odd");
+    if (i % 3 != 0) {
+      bitmap[i / 8] |= 1 << (i % 8);
+    }
+  }
+
+  // 值在左边：10 > v，也就是v < 10；浮点数条件；字符串条件逐条判断
+  int ten = 10;
+  float f = 5.0f;
+  char name[] = "even";
+  DefaultConditionFilter v_less;
+  DefaultConditionFilter f_greater;
+  DefaultConditionFilter name_equal;
+  ASSERT_EQ(RC::SUCCESS, v_less.init(value_desc(&ten), attr_desc(V_OFFSET, 4, 1), INTS, GREAT_THAN, INTS));
+  ASSERT_EQ(RC::SUCCESS, f_greater.init(attr_desc(F_OFFSET, 4, 2), value_desc(&f), FLOATS, GREAT_EQUAL,
+                                        FLOATS));
+  ASSERT_EQ(RC::SUCCESS, name_equal.init(attr_desc(NAME_OFFSET, 8, 2), value_desc(name), CHARS, EQUAL_TO,
+                                         CHARS));
+  const ConditionFilter *filters[] = {&v_less, &f_greater, &name_equal};
+  CompositeConditionFilter composite;
+  ASSERT_EQ(RC::SUCCESS, composite.init(filters, 3));
+  composite.filter_page(page, RECORD_SIZE, num, bitmap);
+  for (int i = 0; i < num; i++) {
+    const bool expected = i % 3 != 0 && i % 10 != 0 && i >= 10 && i % 2 == 0;
+    ASSERT_EQ(expected, (bitmap[i / 8] & (1 << (i % 8))) != 0) << "i=" << i;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,72 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the CPU time counter.
+//
+
+#include <unistd.h>
+
+#include <string>
+
+#include "common/metrics/cpu_time.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+TEST(CpuTimeTest, thread_clock)
+{
+  // 睡眠不占用CPU
+  const uint64_t before_sleep = CpuTimeCounter::thread_cpu_ns();
+  usleep(50000);
+  const uint64_t after_sleep = CpuTimeCounter::thread_cpu_ns();
+  ASSERT_LT(after_sleep - before_sleep, 20000000u);
+
+  volatile uint64_t sum = 0;
+  while (CpuTimeCounter::thread_cpu_ns() - after_sleep < 20000000) {
+    for (int i = 0; i < 10000; i++) {
+      sum += i;
+    }
+  }
+  ASSERT_GE(CpuTimeCounter::thread_cpu_ns() - after_sleep, 20000000u);
+}
+
+TEST(CpuTimeTest, snapshot)
+{
+  CpuTimeCounter counter;
+  counter.add(3000000);
+  counter.add(1000000);
+  ASSERT_EQ(2u, counter.events());
+  ASSERT_EQ(4000000u, counter.cpu_ns());
+
+  counter.snapshot();
+  const std::string text = counter.get_snapshot()->to_string();
+  ASSERT_EQ(0u, text.find("events:2,cpu_us:4000,avg_cpu_us:2000,cores:"));
+
+  // 报告的是两次snapshot之间的数字
+  counter.add(500000);
+  counter.snapshot();
+  ASSERT_EQ(0u, counter.get_snapshot()->to_string().find("events:1,cpu_us:500,avg_cpu_us:500,"));
+}
+
+TEST(CpuTimeTest, charge_current_event)
+{
+  CpuTimeCounter counter;
+  ASSERT_EQ(nullptr, CpuTimeCounter::take_current_event());
+  CpuTimeCounter::charge_current_event(&counter);
+  ASSERT_EQ(&counter, CpuTimeCounter::take_current_event());
+  ASSERT_EQ(nullptr, CpuTimeCounter::take_current_event());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,65 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the CRC32C checksum.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "common/math/crc32c.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+TEST(Crc32cTest, known_values)
+{
+  // RFC 3720 B.4
+  unsigned char buf[32];
+  memset(buf, 0, sizeof(buf));
+  ASSERT_EQ(0x8A9136AAu, crc32c(0, buf, sizeof(buf)));
+  memset(buf, 0xff, sizeof(buf));
+  ASSERT_EQ(0x62A8AB43u, crc32c(0, buf, sizeof(buf)));
+  for (int i = 0; i < 32; i++) {
+    buf[i] = (unsigned char)i;
+  }
+  ASSERT_EQ(0x46DD794Eu, crc32c(0, buf, sizeof(buf)));
+  ASSERT_EQ(0xE3069283u, crc32c(0, "123456789", 9));
+  ASSERT_EQ(0u, crc32c(0, buf, 0));
+  printf("crc32c hardware: %d\n", crc32c_hardware());
+}
+
+TEST(Crc32cTest, extend)
+{
+  // 分段计算和一次计算的结果一样，各种长度和不对齐的起始位置都要覆盖
+  std::vector<unsigned char> data(1000);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = (unsigned char)(i * 31 + 7);
+  }
+  const uint32_t whole = crc32c(0, data.data(), data.size());
+  for (size_t split = 0; split <= data.size(); split += 13) {
+    uint32_t crc = crc32c(0, data.data(), split);
+    crc = crc32c(crc, data.data() + split, data.size() - split);
+    ASSERT_EQ(whole, crc);
+  }
+
+  // 改动任何一个bit都能检查出来
+  data[500] ^= 0x10;
+  ASSERT_NE(whole, crc32c(0, data.data(), data.size()));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
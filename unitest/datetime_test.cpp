@@ -0,0 +1,84 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for dates as days since 1970-01-01.
+//
+
+#include <stdio.h>
+#include <time.h>
+
+#include "common/time/datetime.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+TEST(DateTest, civil_days)
+{
+  ASSERT_EQ(0, days_from_civil(1970, 1, 1));
+  ASSERT_EQ(-1, days_from_civil(1969, 12, 31));
+  ASSERT_EQ(59, days_from_civil(1970, 3, 1));
+  ASSERT_EQ(11016, days_from_civil(2000, 2, 29));
+  ASSERT_EQ(24855, days_from_civil(2038, 1, 19));
+
+  // 和gmtime的结果逐天比较
+  for (int days = -800000; days <= 800000; days++) {
+    time_t t = (time_t)days * 86400;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    int year = 0;
+    int month = 0;
+    int day = 0;
+    civil_from_days(days, &year, &month, &day);
+    ASSERT_EQ(tm.tm_year + 1900, year);
+    ASSERT_EQ(tm.tm_mon + 1, month);
+    ASSERT_EQ(tm.tm_mday, day);
+    ASSERT_EQ(days, days_from_civil(year, month, day));
+  }
+}
+
+TEST(DateTest, parse_format)
+{
+  int days = -1;
+  ASSERT_TRUE(parse_date("1970-01-01", &days));
+  ASSERT_EQ(0, days);
+  ASSERT_TRUE(parse_date("2000-2-29", &days));
+  ASSERT_EQ(11016, days);
+  ASSERT_TRUE(parse_date("2021-1-9", &days));
+  ASSERT_EQ(days_from_civil(2021, 1, 9), days);
+
+  const char *invalid[] = {"", "2021", "2021-", "2021-01", "2021-01-", "2021-00-10", "2021-13-01", "2021-02-29",
+      "1900-02-29", "2021-04-31", "2021-01-00", "2021-01-32", "2021-001-01", "2021-01-011", "2021-01-01 ",
+      "21-01-01", "2021/01/01", "2021-0a-01", "20x1-01-01"};
+  for (const char *s : invalid) {
+    ASSERT_FALSE(parse_date(s, &days)) << s;
+  }
+
+  char buf[DATE_STRING_LEN + 1];
+  char expected[32];
+  for (int days = 0; days <= 30000; days++) {
+    ASSERT_EQ(DATE_STRING_LEN, format_date(days, buf));
+    int year = 0;
+    int month = 0;
+    int day = 0;
+    civil_from_days(days, &year, &month, &day);
+    snprintf(expected, sizeof(expected), "%04d-%02d-%02d", year, month, day);
+    ASSERT_STREQ(expected, buf);
+    int parsed = -1;
+    ASSERT_TRUE(parse_date(buf, &parsed));
+    ASSERT_EQ(days, parsed);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,183 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for dictionary encoded CHARS fields.
+//
+
+#include <stdio.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "storage/common/dictionary.h"
+#include "storage/common/table_meta.h"
+#include "gtest/gtest.h"
+
+TEST(DictionaryTest, add_find)
+{
+  Dictionary dictionary(6);
+  int code = -1;
+  bool added = false;
+  ASSERT_EQ(-1, dictionary.find("open"));
+  ASSERT_EQ(RC::SUCCESS, dictionary.add("open", &code, &added));
+  ASSERT_EQ(0, code);
+  ASSERT_TRUE(added);
+  ASSERT_EQ(RC::SUCCESS, dictionary.add("closed", &code, &added));
+  ASSERT_EQ(1, code);
+  ASSERT_EQ(RC::SUCCESS, dictionary.add("open", &code, &added));
+  ASSERT_EQ(0, code);
+  ASSERT_FALSE(added);
+  ASSERT_EQ(2, dictionary.size());
+  ASSERT_EQ(0, dictionary.saved_size());
+
+  ASSERT_EQ(1, dictionary.find("closed"));
+  ASSERT_EQ("closed", dictionary.value(1));
+  // 超过定义长度的部分不算
+  ASSERT_EQ(1, dictionary.find("closedxx"));
+
+  std::vector<std::string> values;
+  dictionary.values(values);
+  ASSERT_EQ((std::vector<std::string>{"open", "closed"}), values);
+
+  Dictionary loaded(6);
+  ASSERT_EQ(RC::SUCCESS, loaded.load(values));
+  ASSERT_EQ(2, loaded.saved_size());
+  ASSERT_EQ(1, loaded.find("closed"));
+
+  Dictionary duplicate(6);
+  ASSERT_NE(RC::SUCCESS, duplicate.load(std::vector<std::string>{"a", "b", "a"}));
+  Dictionary too_long(6);
+  ASSERT_NE(RC::SUCCESS, too_long.load(std::vector<std::string>{"abcdefg"}));
+}
+
+TEST(DictionaryTest, full)
+{
+  Dictionary dictionary(8);
+  char value[16];
+  int code = -1;
+  bool added = false;
+  for (int i = 0; i < DICTIONARY_MAX_SIZE; i++)
+  {
+    snprintf(value, sizeof(value), "%d", i);
+    ASSERT_EQ(RC::SUCCESS, dictionary.add(value, &code, &added));
+    ASSERT_EQ(i, code);
+  }
+  ASSERT_EQ(RC::FULL, dictionary.add("x", &code, &added));
+  // 已有的值仍然可以查到
+  ASSERT_EQ(RC::SUCCESS, dictionary.add("65535", &code, &added));
+  ASSERT_EQ(65535, code);
+  ASSERT_EQ("1234", dictionary.value(1234));
+}
+
+TEST(DictionaryTest, concurrent_add)
+{
+  Dictionary dictionary(8);
+  const int thread_num = 4;
+  const int value_num = 3000;
+  std::vector<std::vector<int>> codes(thread_num, std::vector<int>(value_num));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; t++)
+  {
+    threads.emplace_back([&dictionary, &codes, t]() {
+      char value[16];
+      bool added = false;
+      for (int i = 0; i < value_num; i++)
+      {
+        snprintf(value, sizeof(value), "v%d", i);
+        dictionary.add(value, &codes[t][i], &added);
+      }
+    });
+  }
+  for (std::thread &thread : threads)
+  {
+    thread.join();
+  }
+  ASSERT_EQ(value_num, dictionary.size());
+  for (int i = 0; i < value_num; i++)
+  {
+    for (int t = 1; t < thread_num; t++)
+    {
+      ASSERT_EQ(codes[0][i], codes[t][i]);
+    }
+    ASSERT_EQ("v" + std::to_string(i), dictionary.value(codes[0][i]));
+  }
+}
+
+TEST(DictionaryTest, table_meta)
+{
+  AttrInfo attributes[] = {
+      {(char *)"id", INTS, 4, 0, 0},
+      {(char *)"status", CHARS, 20, 1, 1},
+      {(char *)"name", CHARS, 8, 0, 0},
+  };
+  TableMeta table_meta;
+  ASSERT_EQ(RC::SUCCESS, table_meta.init("t", 3, attributes));
+  const FieldMeta *status = table_meta.field("status");
+  ASSERT_NE(nullptr, status->dictionary());
+  ASSERT_EQ(CHARS, status->type());
+  ASSERT_EQ(INTS, status->storage_type());
+  ASSERT_EQ((int)sizeof(int), status->len());
+  ASSERT_EQ(20, status->value_len());
+  ASSERT_EQ(status->offset() + status->len(), table_meta.field("name")->offset());
+  ASSERT_EQ(nullptr, table_meta.field("name")->dictionary());
+  ASSERT_EQ(8, table_meta.field("name")->value_len());
+
+  // 元数据的副本共享字典
+  TableMeta copy(table_meta);
+  int code = -1;
+  bool added = false;
+  ASSERT_EQ(RC::SUCCESS, status->dictionary()->add("shipped", &code, &added));
+  ASSERT_EQ(RC::SUCCESS, status->dictionary()->add("", &code, &added));
+  ASSERT_EQ(1, copy.field("status")->dictionary()->find(""));
+
+  // 不能作为分区字段、布隆过滤器的字段和前缀索引的字段
+  std::vector<PartitionMeta> partitions(2);
+  ASSERT_EQ(RC::SUCCESS, partitions[0].init("p0", *status, nullptr));
+  ASSERT_EQ(RC::SUCCESS, partitions[1].init("p1", *status, nullptr));
+  ASSERT_NE(RC::SUCCESS, copy.set_partitions(HASH_PARTITION, "status", partitions));
+  ASSERT_NE(RC::SUCCESS, copy.set_bloom_filter_field("status"));
+  IndexMeta index;
+  std::vector<const FieldMeta *> fields = {status};
+  ASSERT_NE(RC::SUCCESS, index.init("i_status", fields, false, std::vector<int>{4}));
+
+  std::stringstream ss;
+  ASSERT_GT(table_meta.serialize(ss), 0);
+  TableMeta from_json;
+  ASSERT_GT(from_json.deserialize(ss), 0);
+
+  std::string data;
+  table_meta.serialize_binary(data);
+  TableMeta from_binary;
+  ASSERT_EQ(RC::SUCCESS, from_binary.deserialize_binary(data.data(), (int)data.size()));
+
+  for (const TableMeta *decoded : {&from_json, &from_binary})
+  {
+    const FieldMeta *field = decoded->field("status");
+    ASSERT_NE(nullptr, field->dictionary());
+    ASSERT_NE(status->dictionary(), field->dictionary());
+    ASSERT_EQ(20, field->value_len());
+    ASSERT_EQ(status->offset(), field->offset());
+    ASSERT_EQ(2, field->dictionary()->size());
+    ASSERT_EQ(2, field->dictionary()->saved_size());
+    ASSERT_EQ(0, field->dictionary()->find("shipped"));
+    ASSERT_EQ("", field->dictionary()->value(1));
+    ASSERT_EQ(nullptr, decoded->field("name")->dictionary());
+    ASSERT_EQ(table_meta.record_data_size(), decoded->record_data_size());
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
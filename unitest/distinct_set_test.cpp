@@ -0,0 +1,117 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the hash set used by DISTINCT and COUNT(DISTINCT).
+//
+
+#include <string.h>
+
+#include <string>
+
+#include "sql/executor/distinct_set.h"
+#include "storage/common/column_stats.h"
+#include "gtest/gtest.h"
+
+static bool insert_int(DistinctHashSet &set, int value)
+{
+  return set.insert((const char *)&value, sizeof(value));
+}
+
+TEST(DistinctSetTest, insert)
+{
+  DistinctHashSet set;
+  ASSERT_EQ(0, set.size());
+  ASSERT_EQ(0, set.capacity());
+
+  for (int i = 0; i < 10000; i++)
+  {
+    ASSERT_TRUE(insert_int(set, i));
+  }
+  for (int i = 0; i < 10000; i++)
+  {
+    ASSERT_FALSE(insert_int(set, i));
+  }
+  ASSERT_EQ(10000, set.size());
+  // 装载因子不超过1/2
+  ASSERT_GE(set.capacity(), set.size() * 2);
+
+  // 前缀相同、长度不同的值是不同的值，空串也是一个值
+  ASSERT_TRUE(set.insert("ab", 2));
+  ASSERT_TRUE(set.insert("abc", 3));
+  ASSERT_TRUE(set.insert("", 0));
+  ASSERT_FALSE(set.insert("ab", 2));
+  ASSERT_FALSE(set.insert("", 0));
+  ASSERT_EQ(10003, set.size());
+
+  set.clear();
+  ASSERT_EQ(0, set.size());
+  ASSERT_TRUE(insert_int(set, 1));
+}
+
+TEST(DistinctSetTest, expected)
+{
+  // 按预计的个数一次分配，插入这么多个值不再扩容
+  DistinctHashSet set(1000);
+  ASSERT_TRUE(insert_int(set, 0));
+  const size_t capacity = set.capacity();
+  ASSERT_GE(capacity, 2000);
+  for (int i = 1; i < 1000; i++)
+  {
+    insert_int(set, i);
+  }
+  ASSERT_EQ(capacity, set.capacity());
+
+  // 统计信息偏大时预分配有上限
+  DistinctHashSet large(1LL << 40);
+  ASSERT_TRUE(insert_int(large, 0));
+  ASSERT_LE(large.capacity(), (size_t)DISTINCT_SET_MAX_INITIAL * 4);
+}
+
+TEST(DistinctSetTest, merge)
+{
+  DistinctHashSet left;
+  DistinctHashSet right;
+  for (int i = 0; i < 3000; i++)
+  {
+    insert_int(left, i);
+    insert_int(right, i + 2000);
+  }
+  left.merge(right);
+  ASSERT_EQ(5000, left.size());
+  for (int i = 0; i < 5000; i++)
+  {
+    ASSERT_FALSE(insert_int(left, i));
+  }
+}
+
+TEST(DistinctSetTest, approx_count)
+{
+  // APPROX_COUNT_DISTINCT用hash值的高32位
+  HyperLogLog sketch;
+  ASSERT_EQ(0, sketch.estimate());
+  ASSERT_EQ(0, sketch.memory_size());
+  for (int i = 0; i < 50000; i++)
+  {
+    const int value = i % 20000;
+    sketch.add((uint32_t)(DistinctHashSet::hash((const char *)&value, sizeof(value)) >> 32));
+  }
+  ASSERT_NEAR(20000, sketch.estimate(), 20000 * 0.1);
+
+  HyperLogLog empty;
+  empty.merge(sketch);
+  ASSERT_EQ(sketch.estimate(), empty.estimate());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
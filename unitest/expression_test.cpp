@@ -0,0 +1,184 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the compiled expressions.
+//
+
+#include <string.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sql/executor/expression.h"
+#include "sql/parser/parse.h"
+#include "gtest/gtest.h"
+
+class ExpressionTest : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    schema_.add(INTS, "t", "id");
+    schema_.add(CHARS, "t", "name");
+    schema_.add(FLOATS, "t", "f");
+    schema_.add(DATES, "t", "d", true);
+    batch_.init(schema_, {0, 1, 2, 3});
+    // 第3行的日期是null
+    const char *names[] = {"abc", "Hello", "x"};
+    for (int i = 0; i < 3; i++) {
+      const int row = batch_.add_row();
+      batch_.set_int(0, row, i - 1);
+      batch_.set_chars(1, row, names[i], strlen(names[i]));
+      batch_.set_float(2, row, 1.5f * i);
+      if (i < 2) {
+        batch_.set_int(3, row, 18000 + i);
+      }
+    }
+    query_ = query_create();
+  }
+
+  void TearDown() override
+  {
+    query_destroy(query_);
+  }
+
+  const Selects &parse_select(const char *sql)
+  {
+    query_reset(query_);
+    EXPECT_EQ(RC::SUCCESS, parse(sql, query_));
+    return query_->sstr.selection;
+  }
+
+  /**
+   * 计算select中唯一的表达式，每行的结果转换成字符串
+   */
+  std::vector<std::string> eval(const char *sql)
+  {
+    const Selects &selects = parse_select(sql);
+    EXPECT_EQ(1u, selects.attr_num);
+    ExprProgram program;
+    int output = -1;
+    EXPECT_EQ(RC::SUCCESS, program.add_expr(selects.attributes[0].expr, schema_, &output));
+    ExprContext context;
+    program.init_context(context);
+    const ExprColumn &column = program.eval(output, batch_, context);
+    std::vector<std::string> values;
+    for (int row = 0; row < batch_.size(); row++) {
+      Tuple tuple;
+      expr_column_append(column, row, tuple);
+      std::stringstream ss;
+      tuple.print_value(ss, 0);
+      values.push_back(ss.str());
+    }
+    return values;
+  }
+
+  std::vector<int> filter(const char *sql)
+  {
+    const Selects &selects = parse_select(sql);
+    EXPECT_EQ(1u, selects.expr_condition_num);
+    ExprProgram program;
+    EXPECT_EQ(RC::SUCCESS, program.add_condition(selects.expr_conditions[0], schema_));
+    ExprContext context;
+    program.init_context(context);
+    std::vector<uint8_t> sel(batch_.size(), 1);
+    program.filter(batch_, context, sel.data());
+    return std::vector<int>(sel.begin(), sel.end());
+  }
+
+  RC compile(const char *sql)
+  {
+    const Selects &selects = parse_select(sql);
+    ExprProgram program;
+    int output = -1;
+    return program.add_expr(selects.attributes[0].expr, schema_, &output);
+  }
+
+protected:
+  TupleSchema schema_;
+  TupleBatch batch_;
+  Query *query_ = nullptr;
+};
+
+TEST_F(ExpressionTest, arithmetic)
+{
+  ASSERT_EQ((std::vector<std::string>{"1", "3", "5"}), eval("select id * 2 + 3 from t;"));
+  ASSERT_EQ((std::vector<std::string>{"-1", "0", "1"}), eval("select id-1+1 from t;"));
+  ASSERT_EQ((std::vector<std::string>{"1", "0", "-1"}), eval("select -id from t;"));
+  // 整数和浮点数运算时转换成浮点数，除法的结果是浮点数，除数是0时是null
+  ASSERT_EQ((std::vector<std::string>{"-1", "1.5", "4"}), eval("select id + f from t;"));
+  ASSERT_EQ((std::vector<std::string>{"-0.5", "NULL", "0.5"}), eval("select id / (id * 2) * id from t;"));
+  ASSERT_EQ((std::vector<std::string>{"NULL", "NULL", "NULL"}), eval("select id + null from t;"));
+  // 整数溢出时回绕
+  ASSERT_EQ((std::vector<std::string>{"2147483646", "2147483647", "-2147483648"}),
+      eval("select id + 2147483647 from t;"));
+}
+
+TEST_F(ExpressionTest, functions)
+{
+  ASSERT_EQ((std::vector<std::string>{"ABC", "HELLO", "X"}), eval("select upper(name) from t;"));
+  ASSERT_EQ((std::vector<std::string>{"abc-abc", "hello-Hello", "x-x"}), eval("select concat(lower(name), '-', name) from t;"));
+  ASSERT_EQ((std::vector<std::string>{"3", "5", "1"}), eval("select LENGTH(name) from t;"));
+  ASSERT_EQ((std::vector<std::string>{"1", "0", "1"}), eval("select abs(id) from t;"));
+  ASSERT_EQ((std::vector<std::string>{"2019", "2019", "NULL"}), eval("select year(d) from t;"));
+  ASSERT_EQ((std::vector<std::string>{"2019-04-15", "2019-04-16", "NULL"}), eval("select d + 1 from t;"));
+  ASSERT_EQ((std::vector<std::string>{"2019-03-14", "2019-03-15", "NULL"}), eval("select date_sub(d, 31) from t;"));
+  ASSERT_EQ((std::vector<std::string>{"0", "1", "NULL"}), eval("select datediff(d, '2019-04-14') from t;"));
+  // 超出范围的日期是null
+  ASSERT_EQ((std::vector<std::string>{"NULL", "NULL", "NULL"}), eval("select d - 20000 from t;"));
+}
+
+TEST_F(ExpressionTest, filter)
+{
+  ASSERT_EQ((std::vector<int>{0, 1, 1}), filter("select * from t where id * 2 >= 0;"));
+  ASSERT_EQ((std::vector<int>{1, 0, 0}), filter("select * from t where f + 1 = 1;"));
+  ASSERT_EQ((std::vector<int>{0, 1, 0}), filter("select * from t where upper(name) = 'HELLO';"));
+  ASSERT_EQ((std::vector<int>{0, 0, 1}), filter("select * from t where d + 1 is null;"));
+  ASSERT_EQ((std::vector<int>{1, 1, 0}), filter("select * from t where d - 1 < '2019-04-15';"));
+  ASSERT_EQ((std::vector<int>{0, 0, 0}), filter("select * from t where id + 1 = null;"));
+  ASSERT_EQ((std::vector<int>{1, 1, 1}), filter("select * from t where 1 + 1 = 2;"));
+  ASSERT_EQ((std::vector<int>{0, 1, 0}), filter("select * from t where upper(name) like 'HE%';"));
+  ASSERT_EQ((std::vector<int>{1, 0, 1}), filter("select * from t where lower(name) not like '%l_o';"));
+}
+
+TEST_F(ExpressionTest, errors)
+{
+  ASSERT_EQ(RC::SCHEMA_FIELD_TYPE_MISMATCH, compile("select name + 1 from t;"));
+  ASSERT_EQ(RC::SCHEMA_FIELD_TYPE_MISMATCH, compile("select d * 2 from t;"));
+  ASSERT_EQ(RC::SCHEMA_FIELD_TYPE_MISMATCH, compile("select upper(id) from t;"));
+  ASSERT_EQ(RC::SQL_SYNTAX, compile("select nosuch(id) from t;"));
+  ASSERT_EQ(RC::SQL_SYNTAX, compile("select abs(id, id) from t;"));
+  ASSERT_EQ(RC::SCHEMA_FIELD_MISSING, compile("select nosuch + 1 from t;"));
+  ASSERT_EQ(RC::SCHEMA_FIELD_MISSING, compile("select t2.id + 1 from t;"));
+}
+
+TEST_F(ExpressionTest, to_string)
+{
+  // 语句中有参数时只能按模板解析
+  size_t param_num = 0;
+  query_reset(query_);
+  ASSERT_EQ(RC::SUCCESS,
+      parse_template("select (t.id + 1) * 2, id - (1 - f), -(id + 1), concat(name, 'x', ?) from t;", query_, param_num));
+  ASSERT_EQ(1u, param_num);
+  const Selects &selects = query_->sstr.selection;
+  ASSERT_EQ(4u, selects.attr_num);
+  // attributes和select中的顺序相反
+  ASSERT_EQ("(t.id + 1) * 2", expr_to_string(selects.attributes[3].expr));
+  ASSERT_EQ("id - (1 - f)", expr_to_string(selects.attributes[2].expr));
+  ASSERT_EQ("-(id + 1)", expr_to_string(selects.attributes[1].expr));
+  ASSERT_EQ("concat(name, 'x', ?)", expr_to_string(selects.attributes[0].expr));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
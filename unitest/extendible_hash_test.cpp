@@ -0,0 +1,201 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for extendible hash index file.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "storage/common/extendible_hash.h"
+#include "gtest/gtest.h"
+
+static RID make_rid(int i)
+{
+  RID rid;
+  rid.page_num = i / 100 + 1;
+  rid.slot_num = i % 100;
+  return rid;
+}
+
+static int find_count(ExtendibleHashHandler &handler, int key)
+{
+  std::vector<RID> rids;
+  EXPECT_EQ(RC::SUCCESS, handler.get_entries((const char *)&key, rids));
+  return (int)rids.size();
+}
+
+TEST(test_extendible_hash, test_int_keys)
+{
+  const char *index_file = "extendible_hash_int_test.index";
+  remove(index_file);
+  AttrType type = INTS;
+  int length = sizeof(int);
+  const int key_num = 50000;
+
+  {
+    ExtendibleHashHandler handler;
+    ASSERT_EQ(RC::SUCCESS, handler.create(index_file, &type, &length, 1));
+    std::vector<int> keys;
+    for (int i = 0; i < key_num; i++) {
+      keys.push_back(i);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+    for (int key : keys) {
+      RID rid = make_rid(key);
+      ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+    }
+    // 桶分裂之后目录变大
+    ASSERT_GT(handler.global_depth(), 0);
+
+    // key和rid都相同的不能重复插入，唯一索引中属性值相同的也不行
+    int key = 5;
+    RID rid = make_rid(5);
+    ASSERT_EQ(RC::RECORD_DUPLICATE_KEY, handler.insert_entry((const char *)&key, &rid));
+    RID other_rid = make_rid(key_num + 5);
+    ASSERT_EQ(RC::RECORD_DUPLICATE_KEY, handler.insert_entry((const char *)&key, &other_rid, true));
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &other_rid));
+    ASSERT_EQ(2, find_count(handler, key));
+
+    for (int i = 0; i < key_num; i += 3) {
+      RID rid = make_rid(i);
+      ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)&i, &rid));
+    }
+    key = 3;
+    rid = make_rid(3);
+    ASSERT_EQ(RC::RECORD_INVALID_KEY, handler.delete_entry((const char *)&key, &rid));
+    ASSERT_EQ(RC::SUCCESS, handler.close());
+  }
+
+  // 重新打开之后目录和索引项都还在
+  ExtendibleHashHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.open(index_file, &type, &length, 1));
+  for (int i = 0; i < key_num; i++) {
+    std::vector<RID> rids;
+    ASSERT_EQ(RC::SUCCESS, handler.get_entries((const char *)&i, rids));
+    if (i % 3 == 0) {
+      ASSERT_TRUE(rids.empty());
+    } else {
+      ASSERT_EQ(i == 5 ? 2u : 1u, rids.size());
+      ASSERT_EQ(make_rid(i).page_num, rids[0].page_num);
+      ASSERT_EQ(make_rid(i).slot_num, rids[0].slot_num);
+    }
+  }
+  int missing = key_num;
+  ASSERT_EQ(0, find_count(handler, missing));
+  ASSERT_EQ(RC::SUCCESS, handler.close());
+  remove(index_file);
+}
+
+TEST(test_extendible_hash, test_duplicate_keys)
+{
+  const char *index_file = "extendible_hash_duplicate_test.index";
+  remove(index_file);
+  AttrType type = INTS;
+  int length = sizeof(int);
+  ExtendibleHashHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, &type, &length, 1));
+
+  // 同一个key的索引项比一个页面能放的多得多，只能放到溢出页中
+  const int dup_num = 5000;
+  int key = 42;
+  for (int i = 0; i < dup_num; i++) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid));
+  }
+  for (int other = 0; other < 2000; other++) {
+    if (other != key) {
+      RID rid = make_rid(other);
+      ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&other, &rid));
+    }
+  }
+  ASSERT_EQ(dup_num, find_count(handler, key));
+  for (int other = 0; other < 2000; other++) {
+    if (other != key) {
+      ASSERT_EQ(1, find_count(handler, other));
+    }
+  }
+
+  // 删除时释放空的溢出页，之后还能继续插入
+  for (int i = 0; i < dup_num; i += 2) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)&key, &rid));
+  }
+  ASSERT_EQ(dup_num / 2, find_count(handler, key));
+  for (int i = 1; i < dup_num; i += 2) {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)&key, &rid));
+  }
+  ASSERT_EQ(0, find_count(handler, key));
+  RID rid = make_rid(1);
+  ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid, true));
+  ASSERT_EQ(1, find_count(handler, key));
+
+  ASSERT_EQ(RC::SUCCESS, handler.close());
+  remove(index_file);
+}
+
+TEST(test_extendible_hash, test_composite_keys)
+{
+  const char *index_file = "extendible_hash_composite_test.index";
+  remove(index_file);
+  // (tenant int, name char(8))，字符串结束符之后的内容不影响比较和哈希
+  AttrType types[] = {INTS, CHARS};
+  int lengths[] = {4, 8};
+  auto make_key = [](int tenant, const char *name, char garbage, char *key) {
+    memset(key, garbage, 12);
+    memcpy(key, &tenant, 4);
+    strncpy(key + 4, name, 8);
+  };
+
+  ExtendibleHashHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(index_file, types, lengths, 2));
+  char key[12];
+  for (int i = 0; i < 3000; i++) {
+    char name[8];
+    snprintf(name, sizeof(name), "n%d", i % 100);
+    make_key(i / 100, name, 0, key);
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry(key, &rid));
+  }
+
+  make_key(7, "n42", 'x', key);
+  std::vector<RID> rids;
+  std::vector<char> keys;
+  ASSERT_EQ(RC::SUCCESS, handler.get_entries(key, rids, &keys));
+  ASSERT_EQ(1u, rids.size());
+  ASSERT_EQ(make_rid(742).page_num, rids[0].page_num);
+  ASSERT_EQ(make_rid(742).slot_num, rids[0].slot_num);
+  ASSERT_EQ(12u, keys.size());
+  ASSERT_EQ(0, strncmp(keys.data() + 4, "n42", 8));
+
+  ExtendibleHashScanner scanner(handler);
+  make_key(7, "n4", 0, key);
+  ASSERT_EQ(RC::SUCCESS, scanner.open(key));
+  RID rid;
+  ASSERT_EQ(RC::SUCCESS, scanner.next_entry(&rid));
+  ASSERT_EQ(make_rid(704).slot_num, rid.slot_num);
+  ASSERT_EQ(RC::RECORD_EOF, scanner.next_entry(&rid));
+  ASSERT_EQ(RC::SUCCESS, scanner.close());
+
+  ASSERT_EQ(RC::SUCCESS, handler.close());
+  remove(index_file);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,250 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for GROUP BY with the hash table in memory and spilled to partitions.
+//
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sql/executor/execution_node.h"
+#include "storage/default/spill_file.h"
+#include "gtest/gtest.h"
+
+/**
+ * 输入的一行，g或v为null时is_null为true
+ */
+struct Row {
+  int g;
+  bool g_null;
+  std::string name;
+  int v;
+  bool v_null;
+};
+
+/**
+ * 依次输出构造时给出的行，schema是(t.g int null, t.name chars, t.v int null)
+ */
+class RowsExeNode : public ExecutionNode {
+public:
+  explicit RowsExeNode(const std::vector<Row> &rows) : rows_(rows)
+  {
+    schema_.add(INTS, "t", "g", true);
+    schema_.add(CHARS, "t", "name");
+    schema_.add(INTS, "t", "v", true);
+  }
+
+  const TupleSchema &schema() const override
+  {
+    return schema_;
+  }
+  std::string explain() const override
+  {
+    return "ROWS";
+  }
+
+protected:
+  RC do_open() override
+  {
+    pos_ = 0;
+    return RC::SUCCESS;
+  }
+  RC do_next(Tuple &tuple) override
+  {
+    if (pos_ >= rows_.size()) {
+      return RC::RECORD_EOF;
+    }
+    const Row &row = rows_[pos_++];
+    Tuple result;
+    result.add(row.g, row.g_null);
+    result.add(row.name.c_str(), row.name.size());
+    result.add(row.v, row.v_null);
+    tuple = std::move(result);
+    return RC::SUCCESS;
+  }
+  RC do_close() override
+  {
+    return RC::SUCCESS;
+  }
+
+private:
+  TupleSchema schema_;
+  std::vector<Row> rows_;
+  size_t pos_ = 0;
+};
+
+/**
+ * select g, name, count(*), sum(v), max(v) from t group by g, name。
+ * max_open_files返回读取结果的过程中同时打开的临时文件最多有多少个
+ */
+static RC run_aggregate(const std::vector<Row> &rows, size_t memory_budget, std::vector<std::string> &output,
+    long *max_open_files = nullptr)
+{
+  static RelAttr group_attrs[2];
+  group_attrs[0].relation_name = (char *)"t";
+  group_attrs[0].attribute_name = (char *)"g";
+  group_attrs[1].relation_name = (char *)"t";
+  group_attrs[1].attribute_name = (char *)"name";
+  AttrFunction *attr_function = new AttrFunction;
+  attr_function->add_function_type("*", FuncType::COUNT, "t");
+  attr_function->add_function_type("v", FuncType::SUM, "t");
+  attr_function->add_function_type("v", FuncType::MAX, "t");
+  std::vector<HashAggregateExeNode::Output> outputs = {{true, 0}, {true, 1}, {false, 0}, {false, 1}, {false, 2}};
+  HashAggregateExeNode aggregate(
+      new RowsExeNode(rows), group_attrs, 2, attr_function, std::move(outputs), 1, nullptr, memory_budget);
+
+  const long base_files = SpillFileManager::instance().open_files();
+  RC rc = aggregate.open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  long max_files = SpillFileManager::instance().open_files() - base_files;
+  Tuple tuple;
+  while ((rc = aggregate.next(tuple)) == RC::SUCCESS) {
+    std::stringstream ss;
+    for (int i = 0; i < tuple.size(); i++) {
+      ss << (i == 0 ? "" : " | ");
+      tuple.print_value(ss, i);
+    }
+    output.push_back(ss.str());
+    max_files = std::max(max_files, SpillFileManager::instance().open_files() - base_files);
+  }
+  aggregate.close();
+  if (max_open_files != nullptr) {
+    *max_open_files = max_files;
+  }
+  return rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+}
+
+/**
+ * group_num个分组，每个分组rows_per_group行，相同分组的行分散在整个输入中。每100个分组有一个g为null
+ */
+static std::vector<Row> make_rows(int group_num, int rows_per_group)
+{
+  std::vector<Row> rows;
+  for (int r = 0; r < rows_per_group; r++) {
+    for (int i = 0; i < group_num; i++) {
+      const int group = (i * 7919) % group_num;
+      Row row;
+      row.g = group % 100 == 0 ? 0 : group;
+      row.g_null = group % 100 == 0;
+      row.name = "name-" + std::to_string(group);
+      row.v = r * group_num + i;
+      row.v_null = (r + i) % 5 == 0;
+      rows.push_back(row);
+    }
+  }
+  return rows;
+}
+
+/**
+ * 结果中分组字段的部分，用来比较分组输出的顺序
+ */
+static std::vector<std::string> group_columns(const std::vector<std::string> &output)
+{
+  std::vector<std::string> groups;
+  for (const std::string &line : output) {
+    size_t pos = line.find(" | ");
+    pos = line.find(" | ", pos + 3);
+    groups.push_back(line.substr(0, pos));
+  }
+  return groups;
+}
+
+/**
+ * 按照分组在输入中第一次出现的顺序列出分组字段，格式和group_columns相同
+ */
+static std::vector<std::string> first_seen_groups(const std::vector<Row> &rows)
+{
+  std::vector<std::string> groups;
+  for (const Row &row : rows) {
+    std::string group = (row.g_null ? std::string("NULL") : std::to_string(row.g)) + " | " + row.name;
+    if (std::find(groups.begin(), groups.end(), group) == groups.end()) {
+      groups.push_back(group);
+    }
+  }
+  return groups;
+}
+
+TEST(HashAggregateTest, in_memory)
+{
+  std::vector<Row> rows = {
+      {1, false, "a", 10, false},
+      {2, false, "b", 20, false},
+      {0, true, "a", 5, false},
+      {1, false, "a", 0, true},
+      {0, true, "a", 7, false},
+      {2, false, "c", 1, false},
+      {1, false, "a", 3, false},
+  };
+  std::vector<std::string> output;
+  ASSERT_EQ(RC::SUCCESS, run_aggregate(rows, HASH_AGGREGATE_MEMORY_BUDGET, output));
+  // 分组按第一次出现的顺序输出，g为null的行是一个分组，null的v不参与sum和max
+  std::vector<std::string> expected = {
+      "1 | a | 3 | 13 | 10", "2 | b | 1 | 20 | 20", "NULL | a | 2 | 12 | 7", "2 | c | 1 | 1 | 1"};
+  ASSERT_EQ(expected, output);
+}
+
+TEST(HashAggregateTest, spill_same_as_in_memory)
+{
+  std::vector<Row> rows = make_rows(3000, 5);
+  std::vector<std::string> in_memory;
+  ASSERT_EQ(RC::SUCCESS, run_aggregate(rows, HASH_AGGREGATE_MEMORY_BUDGET, in_memory));
+  ASSERT_EQ(3000u, in_memory.size());
+  ASSERT_EQ(first_seen_groups(rows), group_columns(in_memory));
+
+  // 预算只够一部分分组，其余分组的行写到第一层的分区中，每个分区都能在内存中聚合完
+  const size_t written = SpillFileManager::instance().written_bytes();
+  std::vector<std::string> spilled;
+  long max_open_files = 0;
+  ASSERT_EQ(RC::SUCCESS, run_aggregate(rows, 256 * 1024, spilled, &max_open_files));
+  ASSERT_GT(SpillFileManager::instance().written_bytes(), written);
+  ASSERT_GT(max_open_files, 0);
+  ASSERT_LE(max_open_files, HASH_AGGREGATE_PARTITIONS);
+
+  // 留在内存中的分组先按第一次出现的顺序输出，分区中的分组在它们之后
+  std::vector<std::string> spilled_groups = group_columns(spilled);
+  std::vector<std::string> expected_groups = first_seen_groups(rows);
+  ASSERT_EQ(spilled_groups[0], expected_groups[0]);
+  ASSERT_EQ(spilled_groups[1], expected_groups[1]);
+
+  std::sort(in_memory.begin(), in_memory.end());
+  std::sort(spilled.begin(), spilled.end());
+  ASSERT_EQ(in_memory, spilled);
+}
+
+TEST(HashAggregateTest, second_level_split)
+{
+  std::vector<Row> rows = make_rows(2000, 3);
+  std::vector<std::string> in_memory;
+  ASSERT_EQ(RC::SUCCESS, run_aggregate(rows, HASH_AGGREGATE_MEMORY_BUDGET, in_memory));
+
+  // 每一层只有第一个分组留在内存中，第一层的分区中仍然有一百多个分组，要再分到第二层的分区中。
+  // 处理第一个分区时其它第一层的分区还没有关闭，同时打开的文件超过一层的分区数
+  std::vector<std::string> spilled;
+  long max_open_files = 0;
+  ASSERT_EQ(RC::SUCCESS, run_aggregate(rows, 1, spilled, &max_open_files));
+  ASSERT_GT(max_open_files, HASH_AGGREGATE_PARTITIONS);
+  ASSERT_EQ(group_columns(spilled)[0], first_seen_groups(rows)[0]);
+
+  std::sort(in_memory.begin(), in_memory.end());
+  std::sort(spilled.begin(), spilled.end());
+  ASSERT_EQ(in_memory, spilled);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  SpillFileManager::instance().init("", 0);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,171 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the serial and the radix partitioned parallel hash join.
+//
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sql/executor/execution_node.h"
+#include "gtest/gtest.h"
+
+/**
+ * 依次输出构造时给出的tuple
+ */
+class VectorExeNode : public ExecutionNode {
+public:
+  VectorExeNode(const char *table_name, const std::vector<std::pair<int, int>> &rows) : rows_(rows)
+  {
+    schema_.add(INTS, table_name, "id", true);
+    schema_.add(INTS, table_name, "value");
+  }
+
+  const TupleSchema &schema() const override
+  {
+    return schema_;
+  }
+  std::string explain() const override
+  {
+    return "VECTOR";
+  }
+
+protected:
+  RC do_open() override
+  {
+    pos_ = 0;
+    return RC::SUCCESS;
+  }
+  RC do_next(Tuple &tuple) override
+  {
+    if (pos_ >= rows_.size()) {
+      return RC::RECORD_EOF;
+    }
+    const std::pair<int, int> &row = rows_[pos_++];
+    Tuple result;
+    // id为负数时表示null
+    result.add(row.first, row.first < 0);
+    result.add(row.second);
+    tuple = std::move(result);
+    return RC::SUCCESS;
+  }
+  RC do_close() override
+  {
+    return RC::SUCCESS;
+  }
+
+private:
+  TupleSchema schema_;
+  std::vector<std::pair<int, int>> rows_;
+  size_t pos_ = 0;
+};
+
+static RC run_join(const std::vector<std::pair<int, int>> &left, const std::vector<std::pair<int, int>> &right,
+    int parallelism, std::vector<std::string> &output, bool build_left = false)
+{
+  HashJoinExeNode join(new VectorExeNode("t1", left), new VectorExeNode("t2", right), {{0, 0}});
+  join.set_parallelism(parallelism);
+  join.set_build_left(build_left);
+  RC rc = join.open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  Tuple tuple;
+  while ((rc = join.next(tuple)) == RC::SUCCESS) {
+    std::stringstream ss;
+    for (int i = 0; i < tuple.size(); i++) {
+      ss << (i == 0 ? "" : " | ");
+      tuple.print_value(ss, i);
+    }
+    output.push_back(ss.str());
+  }
+  join.close();
+  return rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+}
+
+TEST(HashJoinTest, small)
+{
+  std::vector<std::pair<int, int>> left = {{1, 10}, {2, 20}, {-1, 30}, {3, 40}, {1, 50}};
+  std::vector<std::pair<int, int>> right = {{1, 100}, {3, 200}, {-1, 300}, {1, 400}};
+  std::vector<std::string> output;
+  ASSERT_EQ(RC::SUCCESS, run_join(left, right, 4, output));
+  ASSERT_EQ(5u, output.size());
+  // 输出按左边的顺序，同一个key的build端tuple按右边的顺序
+  std::vector<std::string> expected = {
+      "1 | 10 | 1 | 100", "1 | 10 | 1 | 400", "3 | 40 | 3 | 200", "1 | 50 | 1 | 100", "1 | 50 | 1 | 400"};
+  ASSERT_EQ(expected, output);
+}
+
+TEST(HashJoinTest, parallel_same_as_serial)
+{
+  const int left_rows = 100000;
+  const int right_rows = 50000;
+  std::vector<std::pair<int, int>> left;
+  std::vector<std::pair<int, int>> right;
+  for (int i = 0; i < left_rows; i++) {
+    left.emplace_back(i % 7 == 0 ? -1 : (i * 31) % 40000, i);
+  }
+  for (int i = 0; i < right_rows; i++) {
+    right.emplace_back(i % 11 == 0 ? -1 : (i * 17) % 30000, i);
+  }
+
+  std::vector<std::string> serial;
+  std::vector<std::string> parallel;
+  ASSERT_EQ(RC::SUCCESS, run_join(left, right, 1, serial));
+  ASSERT_EQ(RC::SUCCESS, run_join(left, right, 4, parallel));
+  ASSERT_FALSE(serial.empty());
+  ASSERT_EQ(serial, parallel);
+}
+
+TEST(HashJoinTest, build_left)
+{
+  std::vector<std::pair<int, int>> left = {{1, 10}, {2, 20}, {-1, 30}, {3, 40}, {1, 50}};
+  std::vector<std::pair<int, int>> right = {{1, 100}, {3, 200}, {-1, 300}, {1, 400}};
+  std::vector<std::string> output;
+  ASSERT_EQ(RC::SUCCESS, run_join(left, right, 1, output, true));
+  // 左边建hash表时输出按右边的顺序，列仍然是左边在前
+  std::vector<std::string> expected = {
+      "1 | 10 | 1 | 100", "1 | 50 | 1 | 100", "3 | 40 | 3 | 200", "1 | 10 | 1 | 400", "1 | 50 | 1 | 400"};
+  ASSERT_EQ(expected, output);
+}
+
+TEST(HashJoinTest, build_left_same_rows)
+{
+  const int left_rows = 30000;
+  const int right_rows = 100000;
+  std::vector<std::pair<int, int>> left;
+  std::vector<std::pair<int, int>> right;
+  for (int i = 0; i < left_rows; i++) {
+    left.emplace_back(i % 7 == 0 ? -1 : (i * 31) % 20000, i);
+  }
+  for (int i = 0; i < right_rows; i++) {
+    right.emplace_back(i % 11 == 0 ? -1 : (i * 17) % 50000, i);
+  }
+
+  std::vector<std::string> build_right;
+  ASSERT_EQ(RC::SUCCESS, run_join(left, right, 1, build_right));
+  ASSERT_FALSE(build_right.empty());
+  std::sort(build_right.begin(), build_right.end());
+  for (int parallelism : {1, 4}) {
+    std::vector<std::string> build_left;
+    ASSERT_EQ(RC::SUCCESS, run_join(left, right, parallelism, build_left, true));
+    std::sort(build_left.begin(), build_left.end());
+    ASSERT_EQ(build_right, build_left);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
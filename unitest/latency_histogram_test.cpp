@@ -0,0 +1,96 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the lock-free latency histogram.
+//
+
+#include <thread>
+#include <vector>
+
+#include "common/metrics/latency_histogram.h"
+#include "common/metrics/latency_snapshot.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+TEST(LatencyHistogramTest, buckets)
+{
+  for (uint64_t value = 0; value < (1ul << 20); value++) {
+    const int index = LatencyHistogram::bucket_index(value);
+    ASSERT_LT(index, LATENCY_BUCKET_NUM);
+    ASSERT_LE(LatencyHistogram::bucket_low(index), value);
+    ASSERT_GT(LatencyHistogram::bucket_low(index) + LatencyHistogram::bucket_width(index), value);
+    ASSERT_LE(LatencyHistogram::bucket_width(index) * 64, value < 128 ? 64 : value);
+  }
+  ASSERT_EQ(LATENCY_BUCKET_NUM - 1, LatencyHistogram::bucket_index(UINT64_MAX));
+}
+
+TEST(LatencyHistogramTest, quantiles)
+{
+  LatencyHistogram histogram;
+  for (uint64_t value = 1; value <= 100000; value++) {
+    histogram.update(value);
+  }
+  histogram.snapshot();
+  LatencySnapshot *snapshot = (LatencySnapshot *)histogram.get_snapshot();
+  ASSERT_EQ(100000u, snapshot->get_count());
+  ASSERT_EQ(1, snapshot->get_min());
+  ASSERT_EQ(100000, snapshot->get_max());
+  ASSERT_DOUBLE_EQ(50000.5, snapshot->get_mean());
+  ASSERT_NEAR(50000, snapshot->get_median(), 50000 * 0.02);
+  ASSERT_NEAR(99000, snapshot->get_99th(), 99000 * 0.02);
+  ASSERT_NEAR(99900, snapshot->get_999th(), 99900 * 0.02);
+
+  // 少量很慢的请求也能在999th中看到，不会因为抽样被漏掉
+  for (int i = 0; i < 10000; i++) {
+    histogram.update(i < 20 ? 1000000 : 10);
+  }
+  histogram.snapshot();
+  ASSERT_EQ(10000u, snapshot->get_count());
+  ASSERT_EQ(10, snapshot->get_median());
+  ASSERT_NEAR(1000000, snapshot->get_999th(), 1000000 * 0.02);
+
+  histogram.snapshot();
+  ASSERT_EQ(0u, snapshot->get_count());
+  ASSERT_EQ(0, snapshot->get_999th());
+}
+
+TEST(LatencyHistogramTest, concurrent_update)
+{
+  LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&histogram, i]() {
+      for (int j = 0; j < 100000; j++) {
+        histogram.update(i * 1000 + j % 1000);
+      }
+    });
+  }
+  // 更新的同时做快照，每个值只出现在一个快照中
+  uint64_t count = 0;
+  for (int i = 0; i < 10; i++) {
+    histogram.snapshot();
+    count += ((LatencySnapshot *)histogram.get_snapshot())->get_count();
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  histogram.snapshot();
+  LatencySnapshot *snapshot = (LatencySnapshot *)histogram.get_snapshot();
+  count += snapshot->get_count();
+  ASSERT_EQ(800000u, count);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,101 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the LIKE pattern matcher.
+//
+
+#include <string.h>
+
+#include "storage/common/like_matcher.h"
+#include "gtest/gtest.h"
+
+static bool like(const char *s, const char *pattern)
+{
+  LikeMatcher matcher;
+  matcher.init(pattern);
+  return matcher.match(s, strlen(s));
+}
+
+TEST(test_like_matcher, test_simple)
+{
+  ASSERT_TRUE(like("abc", "abc"));
+  ASSERT_FALSE(like("abcd", "abc"));
+  ASSERT_FALSE(like("ABC", "abc"));
+  ASSERT_TRUE(like("abcd", "abc%"));
+  ASSERT_TRUE(like("abc", "abc%"));
+  ASSERT_FALSE(like("xabc", "abc%"));
+  ASSERT_TRUE(like("xabc", "%abc"));
+  ASSERT_FALSE(like("abcx", "%abc"));
+  ASSERT_TRUE(like("xxabcxx", "%abc%"));
+  ASSERT_TRUE(like("aabababc", "%ababc%"));
+  ASSERT_FALSE(like("ababab", "%abc%"));
+  ASSERT_TRUE(like("", "%"));
+  ASSERT_TRUE(like("abc", "%%"));
+  ASSERT_TRUE(like("", ""));
+  ASSERT_FALSE(like("a", ""));
+}
+
+TEST(test_like_matcher, test_generic)
+{
+  ASSERT_TRUE(like("abc", "a_c"));
+  ASSERT_FALSE(like("abbc", "a_c"));
+  ASSERT_TRUE(like("abc", "___"));
+  ASSERT_FALSE(like("ab", "___"));
+  ASSERT_TRUE(like("a123b456c", "a%b%c"));
+  ASSERT_FALSE(like("a123b456", "a%b%c"));
+  ASSERT_TRUE(like("abc", "a%c"));
+  // 第一段和最后一段不能重叠
+  ASSERT_FALSE(like("aba", "ab%ba"));
+  ASSERT_TRUE(like("abba", "ab%ba"));
+  ASSERT_TRUE(like("name_199", "%_99"));
+  ASSERT_FALSE(like("99", "%_99"));
+  ASSERT_TRUE(like("xaybz", "%a_b%"));
+  ASSERT_FALSE(like("xaybz", "%a_c%"));
+}
+
+TEST(test_like_matcher, test_escape)
+{
+  ASSERT_TRUE(like("50%", "50\\%"));
+  ASSERT_FALSE(like("500", "50\\%"));
+  ASSERT_TRUE(like("a_b", "a\\_b"));
+  ASSERT_FALSE(like("axb", "a\\_b"));
+  ASSERT_TRUE(like("a\\b", "a\\\\b"));
+}
+
+TEST(test_like_matcher, test_prefix)
+{
+  LikeMatcher matcher;
+  matcher.init("abc");
+  ASSERT_TRUE(matcher.exact());
+  ASSERT_EQ("abc", matcher.prefix());
+
+  matcher.init("ab\\%c%d");
+  ASSERT_FALSE(matcher.exact());
+  ASSERT_EQ("ab%c", matcher.prefix());
+  ASSERT_STREQ("ab%d", matcher.upper_bound());
+
+  matcher.init("ab_c");
+  ASSERT_EQ("ab", matcher.prefix());
+  ASSERT_STREQ("ac", matcher.upper_bound());
+
+  matcher.init("a\xff%");
+  ASSERT_STREQ("b", matcher.upper_bound());
+
+  matcher.init("%abc");
+  ASSERT_EQ("", matcher.prefix());
+  ASSERT_EQ(nullptr, matcher.upper_bound());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
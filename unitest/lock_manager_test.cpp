@@ -0,0 +1,115 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the row lock manager.
+//
+
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "storage/trx/lock_manager.h"
+#include "gtest/gtest.h"
+
+static const Table *test_table = (const Table *)0x1000;
+
+static void wait_for_waiters(LockManager &manager, int count)
+{
+  for (int i = 0; i < 1000 && manager.waiting_trx_count() < count; i++)
+  {
+    usleep(1000);
+  }
+}
+
+TEST(LockManagerTest, shared_and_exclusive)
+{
+  LockManager &manager = LockManager::instance();
+  const LockKey key = {test_table, 1, 1};
+  std::vector<LockKey> held1, held2;
+  ASSERT_EQ(RC::SUCCESS, manager.lock(1, key, LockMode::SHARED, held1));
+  ASSERT_EQ(RC::SUCCESS, manager.lock(2, key, LockMode::SHARED, held2));
+  ASSERT_EQ(1, (int)held1.size());
+
+  // 重复加锁不重复记录；还有别的共享锁时不能升级
+  ASSERT_EQ(RC::SUCCESS, manager.lock(1, key, LockMode::SHARED, held1));
+  ASSERT_EQ(1, (int)held1.size());
+  manager.set_wait_timeout(20);
+  ASSERT_EQ(RC::BUSY_TIMEOUT, manager.lock(1, key, LockMode::EXCLUSIVE, held1));
+  manager.release(2, held2);
+  ASSERT_EQ(RC::SUCCESS, manager.lock(1, key, LockMode::EXCLUSIVE, held1));
+  ASSERT_EQ(1, (int)held1.size());
+
+  held2.clear();
+  ASSERT_EQ(RC::BUSY_TIMEOUT, manager.lock(2, key, LockMode::SHARED, held2));
+  ASSERT_TRUE(held2.empty());
+  const LockKey other = {test_table, 1, 2};
+  ASSERT_EQ(RC::SUCCESS, manager.lock(2, other, LockMode::EXCLUSIVE, held2));
+  manager.release(1, held1);
+  manager.release(2, held2);
+  manager.set_wait_timeout(LOCK_DEFAULT_WAIT_TIMEOUT);
+}
+
+TEST(LockManagerTest, wait)
+{
+  LockManager &manager = LockManager::instance();
+  const LockKey key = {test_table, 2, 1};
+  std::vector<LockKey> held1;
+  ASSERT_EQ(RC::SUCCESS, manager.lock(1, key, LockMode::EXCLUSIVE, held1));
+
+  // 持有者释放之后等待的事务拿到锁
+  std::atomic<bool> granted(false);
+  std::vector<LockKey> held2;
+  std::thread waiter([&]() {
+    if (manager.lock(2, key, LockMode::EXCLUSIVE, held2) == RC::SUCCESS)
+    {
+      granted = true;
+    }
+  });
+  wait_for_waiters(manager, 1);
+  ASSERT_EQ(1, manager.waiting_trx_count());
+  ASSERT_FALSE(granted.load());
+  manager.release(1, held1);
+  waiter.join();
+  ASSERT_TRUE(granted.load());
+  ASSERT_EQ(0, manager.waiting_trx_count());
+  manager.release(2, held2);
+}
+
+TEST(LockManagerTest, deadlock)
+{
+  LockManager &manager = LockManager::instance();
+  const LockKey key1 = {test_table, 3, 1};
+  const LockKey key2 = {test_table, 3, 2};
+  std::vector<LockKey> held1, held2;
+  ASSERT_EQ(RC::SUCCESS, manager.lock(1, key1, LockMode::EXCLUSIVE, held1));
+  ASSERT_EQ(RC::SUCCESS, manager.lock(2, key2, LockMode::EXCLUSIVE, held2));
+
+  RC waiter_rc = RC::GENERIC_ERROR;
+  std::thread waiter([&]() { waiter_rc = manager.lock(1, key2, LockMode::EXCLUSIVE, held1); });
+  wait_for_waiters(manager, 1);
+
+  // 事务2再等事务1就成环了，发起加锁的事务2是牺牲者，回滚之后事务1拿到锁
+  ASSERT_EQ(RC::LOCKED_DEADLOCK, manager.lock(2, key1, LockMode::EXCLUSIVE, held2));
+  ASSERT_EQ(1, (int)held2.size());
+  manager.release(2, held2);
+  waiter.join();
+  ASSERT_EQ(RC::SUCCESS, waiter_rc);
+  ASSERT_EQ(2, (int)held1.size());
+  manager.release(1, held1);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,143 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the lock contention profiler behind MUTEX_LOCK.
+//
+
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/lang/lock_profiler.h"
+#include "common/lang/mutex.h"
+#include "common/metrics/snapshot.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+static pthread_mutex_t test_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// 每次调用都是同一个加锁点
+static void lock_and_hold(int hold_us)
+{
+  MUTEX_LOCK(&test_mutex);
+  if (hold_us > 0) {
+    usleep(hold_us);
+  }
+  MUTEX_UNLOCK(&test_mutex);
+}
+
+static LockSiteStats site_stats(const char *file)
+{
+  std::vector<const LockSite *> sites;
+  std::vector<LockSiteStats> stats;
+  LockProfiler::collect(sites, stats);
+  LockSiteStats result;
+  for (size_t i = 0; i < sites.size(); i++) {
+    if (sites[i] != nullptr && std::string(sites[i]->file()) == file) {
+      result = stats[i];
+    }
+  }
+  return result;
+}
+
+TEST(LockProfilerTest, bucket_index)
+{
+  ASSERT_EQ(0, LockProfiler::bucket_index(0));
+  ASSERT_EQ(0, LockProfiler::bucket_index(999));
+  ASSERT_EQ(1, LockProfiler::bucket_index(1000));
+  ASSERT_EQ(2, LockProfiler::bucket_index(2000));
+  ASSERT_EQ(2, LockProfiler::bucket_index(3999));
+  ASSERT_EQ(3, LockProfiler::bucket_index(4000));
+  ASSERT_EQ(LOCK_PROFILER_BUCKETS - 1, LockProfiler::bucket_index(UINT64_MAX));
+}
+
+TEST(LockProfilerTest, quantile)
+{
+  LockSiteStats stats;
+  ASSERT_EQ(0u, stats.wait_quantile_us(0.99));
+  stats.buckets[3] = 99;
+  stats.buckets[10] = 1;
+  ASSERT_EQ(8u, stats.wait_quantile_us(0.5));
+  ASSERT_EQ(1024u, stats.wait_quantile_us(0.99));
+}
+
+TEST(LockProfilerTest, disabled)
+{
+  LockProfiler::set_enabled(false);
+  for (int i = 0; i < 1000; i++) {
+    lock_and_hold(0);
+  }
+  ASSERT_EQ(0u, site_stats(__FILE__).acquisitions);
+}
+
+TEST(LockProfilerTest, contention)
+{
+  LockProfiler::set_sample_rate(1);
+  LockProfiler::set_enabled(true);
+
+  LockContentionMetric metric;
+  metric.snapshot();
+
+  // 两个线程轮流持有锁一段时间，另一个线程一定会等待
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 2; t++) {
+    threads.emplace_back([]() {
+      for (int i = 0; i < 100; i++) {
+        lock_and_hold(200);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  LockProfiler::set_enabled(false);
+
+  const LockSiteStats stats = site_stats(__FILE__);
+  ASSERT_EQ(200u, stats.acquisitions);
+  ASSERT_GT(stats.contended, 0u);
+  ASSERT_LE(stats.contended, stats.acquisitions);
+  ASSERT_GT(stats.wait_ns, 0u);
+
+  metric.snapshot();
+  const std::string text = metric.get_snapshot()->to_string();
+  ASSERT_NE(std::string::npos, text.find("lock_profiler_test_cpp_"));
+  ASSERT_NE(std::string::npos, text.find("_acquisitions:200,"));
+
+  // 报告的是两次snapshot之间的数字
+  metric.snapshot();
+  ASSERT_EQ(std::string::npos, metric.get_snapshot()->to_string().find("lock_profiler_test_cpp_"));
+}
+
+TEST(LockProfilerTest, sampled)
+{
+  LockProfiler::set_sample_rate(10);
+  LockProfiler::set_enabled(true);
+  const uint64_t before = site_stats(__FILE__).acquisitions;
+  for (int i = 0; i < 1000; i++) {
+    lock_and_hold(0);
+  }
+  LockProfiler::set_enabled(false);
+  LockProfiler::set_sample_rate(LOCK_PROFILER_DEFAULT_SAMPLE_RATE);
+
+  // 抽样的每次加锁按抽样率计数，是全部加锁次数的估计
+  const uint64_t acquisitions = site_stats(__FILE__).acquisitions - before;
+  ASSERT_GE(acquisitions, 990u);
+  ASSERT_LE(acquisitions, 1010u);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
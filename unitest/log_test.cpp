@@ -16,6 +16,12 @@ See the Mulan PSL v2 for more details. */
 #include "log_test.h"
 
 
+#include <pthread.h>
+#include <stdio.h>
+
+#include <fstream>
+#include <string>
+
 #include "gtest/gtest.h"
 
 #include "common/log/log.h"
@@ -98,6 +104,58 @@ TEST(testEnableTest, CheckEnableTest)
 
 }
 
+static void *async_log_loop(void *param) {
+  Log *log = (Log *)param;
+  for (int i = 0; i < 2000; i++) {
+    log->output(LOG_LEVEL_INFO, __FILE__, "[async] ", "thread line %d", i);
+  }
+  return nullptr;
+}
+
+TEST(AsyncLogTest, AllLinesWritten)
+{
+  const char *file_name = "async_log_test.log";
+  remove(file_name);
+  {
+    Log log(file_name);
+    log.set_rotate_type(LOG_ROTATE_BYSIZE);
+    ASSERT_EQ(LOG_STATUS_OK, log.set_async(true));
+    ASSERT_TRUE(log.is_async());
+
+    // ERROR级别的日志叫醒后台线程马上写出
+    log.output(LOG_LEVEL_ERR, __FILE__, "[error] ", "error line");
+
+    // 每个线程写的日志超过了缓冲区的大小，需要等后台线程读走
+    const int thread_num = 4;
+    pthread_t threads[thread_num];
+    for (int i = 0; i < thread_num; i++) {
+      pthread_create(&threads[i], nullptr, async_log_loop, &log);
+    }
+    for (int i = 0; i < thread_num; i++) {
+      pthread_join(threads[i], nullptr);
+    }
+    // 没有开启的级别不输出
+    log.output(LOG_LEVEL_DEBUG, __FILE__, "[debug] ", "not written");
+    log.flush();
+    ASSERT_EQ(LOG_STATUS_OK, log.set_async(false));
+  }
+
+  std::ifstream ifs(file_name);
+  std::string line;
+  int async_lines = 0;
+  int other_lines = 0;
+  while (std::getline(ifs, line)) {
+    if (line.compare(0, 8, "[async] ") == 0) {
+      async_lines++;
+    } else {
+      other_lines++;
+    }
+  }
+  ASSERT_EQ(4 * 2000, async_lines);
+  ASSERT_EQ(1, other_lines);
+  remove(file_name);
+}
+
 int main(int argc, char **argv) {
 
 
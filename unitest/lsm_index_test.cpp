@@ -0,0 +1,203 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the log-structured merge tree index of lsm tables.
+//
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "storage/lsm/lsm_index.h"
+#include "gtest/gtest.h"
+
+static const char *INDEX_FILE = "lsm_index_test.index";
+
+static RID make_rid(int i)
+{
+  RID rid;
+  rid.page_num = i / 100;
+  rid.slot_num = i % 100;
+  return rid;
+}
+
+static int count_range(LsmIndex &index, int low, int high)
+{
+  IndexScanner *scanner = index.create_range_scanner((const char *)&low, 1, true, (const char *)&high, 1, true);
+  EXPECT_NE(nullptr, scanner);
+  int count = 0;
+  int last = low - 1;
+  RID rid;
+  int key = 0;
+  while (scanner->next_entry(&rid, (char *)&key) == RC::SUCCESS) {
+    EXPECT_LE(last, key);
+    EXPECT_EQ(make_rid(key).page_num, rid.page_num);
+    EXPECT_EQ(make_rid(key).slot_num, rid.slot_num);
+    last = key;
+    count++;
+  }
+  scanner->destroy();
+  return count;
+}
+
+class LsmIndexTest : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    set_lsm_memtable_size(4096);
+    ASSERT_EQ(RC::SUCCESS, field_.init("id", INTS, 0, sizeof(int), true, false));
+    fields_.push_back(field_);
+  }
+  void TearDown() override
+  {
+    remove(INDEX_FILE);
+    set_lsm_memtable_size(LSM_DEFAULT_MEMTABLE_SIZE);
+  }
+
+  IndexMeta index_meta(bool unique)
+  {
+    IndexMeta meta;
+    std::vector<const FieldMeta *> fields{&field_};
+    EXPECT_EQ(RC::SUCCESS, meta.init("i_id", fields, unique, std::vector<int>(), BPLUS_TREE_INDEX));
+    return meta;
+  }
+
+  FieldMeta field_;
+  std::vector<FieldMeta> fields_;
+};
+
+TEST_F(LsmIndexTest, insert_delete_scan)
+{
+  IndexMeta meta = index_meta(false);
+  LsmIndex index;
+  ASSERT_EQ(RC::SUCCESS, index.create(INDEX_FILE, meta, fields_));
+  LsmIndex other;
+  ASSERT_EQ(RC::SCHEMA_INDEX_EXIST, other.create(INDEX_FILE, meta, fields_));
+
+  const int key_num = 5000;
+  for (int i = key_num - 1; i >= 0; i--)
+  {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, index.insert_entry((const char *)&i, &rid));
+  }
+  // 写入的线程合并了太多的level 0
+  std::vector<int> runs = index.level_runs();
+  ASSERT_LT(runs[0], LSM_LEVEL0_STOP_RUNS);
+  ASSERT_GT(runs.size(), 1u);
+  ASSERT_EQ(key_num, count_range(index, 0, key_num));
+
+  // 删除一半，删除标记在memtable和较新的run中
+  for (int i = 0; i < key_num; i += 2)
+  {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, index.delete_entry((const char *)&i, &rid));
+  }
+  ASSERT_EQ(key_num / 2, count_range(index, 0, key_num));
+  ASSERT_EQ(5, count_range(index, 100, 110));
+
+  const int key = 101;
+  IndexScanner *scanner = index.create_scanner(EQUAL_TO, (const char *)&key, -1);
+  ASSERT_NE(nullptr, scanner);
+  RID rid;
+  ASSERT_EQ(RC::SUCCESS, scanner->next_entry(&rid));
+  ASSERT_EQ(1, rid.page_num);
+  ASSERT_EQ(1, rid.slot_num);
+  ASSERT_EQ(RC::RECORD_EOF, scanner->next_entry(&rid));
+  scanner->destroy();
+  scanner = index.create_scanner(LESS_THAN, (const char *)&key, -1);
+  ASSERT_NE(nullptr, scanner);
+  int count = 0;
+  while (scanner->next_entry(&rid) == RC::SUCCESS) {
+    count++;
+  }
+  scanner->destroy();
+  ASSERT_EQ(50, count);
+  ASSERT_EQ(nullptr, index.create_ordered_scanner(nullptr, 0, false, nullptr, 0, false, true));
+
+  // 后台整理之后level 0为空，最下面一层去掉了删除标记
+  ASSERT_EQ(RC::SUCCESS, index.flush());
+  ASSERT_EQ(0u, index.memtable_entries());
+  ASSERT_EQ(RC::SUCCESS, index.merge_changes());
+  ASSERT_LT(index.level_runs()[0], LSM_LEVEL0_RUNS);
+  ASSERT_EQ(key_num / 2, count_range(index, 0, key_num));
+
+  ASSERT_EQ(RC::SUCCESS, index.drop());
+}
+
+TEST_F(LsmIndexTest, reopen)
+{
+  IndexMeta meta = index_meta(false);
+  const int key_num = 1000;
+  {
+    LsmIndex index;
+    ASSERT_EQ(RC::SUCCESS, index.create(INDEX_FILE, meta, fields_));
+    for (int i = 0; i < key_num; i++)
+    {
+      RID rid = make_rid(i);
+      ASSERT_EQ(RC::SUCCESS, index.insert_entry((const char *)&i, &rid));
+    }
+    ASSERT_EQ(RC::SUCCESS, index.close());
+  }
+  {
+    LsmIndex index;
+    ASSERT_EQ(RC::SUCCESS, index.open(INDEX_FILE, meta, fields_));
+    ASSERT_EQ(key_num, count_range(index, 0, key_num));
+    for (int i = 0; i < 10; i++)
+    {
+      RID rid = make_rid(i);
+      ASSERT_EQ(RC::SUCCESS, index.delete_entry((const char *)&i, &rid));
+    }
+    ASSERT_EQ(RC::SUCCESS, index.sync());
+
+    // 没有close，memtable中的修改从wal中恢复
+    LsmIndex reopened;
+    ASSERT_EQ(RC::SUCCESS, reopened.open(INDEX_FILE, meta, fields_));
+    ASSERT_EQ(10u, reopened.memtable_entries());
+    ASSERT_EQ(key_num - 10, count_range(reopened, 0, key_num));
+    ASSERT_EQ(RC::SUCCESS, reopened.drop());
+    ASSERT_EQ(RC::SUCCESS, index.drop());
+  }
+  std::string wal = std::string(INDEX_FILE) + ".wal";
+  ASSERT_NE(0, access(wal.c_str(), F_OK));
+}
+
+TEST_F(LsmIndexTest, unique)
+{
+  IndexMeta meta = index_meta(true);
+  LsmIndex index;
+  ASSERT_EQ(RC::SUCCESS, index.create(INDEX_FILE, meta, fields_));
+  for (int i = 0; i < 1000; i++)
+  {
+    RID rid = make_rid(i);
+    ASSERT_EQ(RC::SUCCESS, index.insert_entry((const char *)&i, &rid));
+  }
+  ASSERT_GT(index.level_runs()[0], 0);
+
+  // 在run中和memtable中的key都要检查
+  RID rid = make_rid(2000);
+  const int old_key = 3;
+  const int new_key = 999;
+  ASSERT_EQ(RC::RECORD_DUPLICATE_KEY, index.insert_entry((const char *)&old_key, &rid));
+  ASSERT_EQ(RC::RECORD_DUPLICATE_KEY, index.insert_entry((const char *)&new_key, &rid));
+
+  RID old_rid = make_rid(old_key);
+  ASSERT_EQ(RC::SUCCESS, index.delete_entry((const char *)&old_key, &old_rid));
+  ASSERT_EQ(RC::SUCCESS, index.insert_entry((const char *)&old_key, &rid));
+  ASSERT_EQ(RC::SUCCESS, index.drop());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,113 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the in-memory record store and hash index.
+//
+
+#include <string.h>
+
+#include <vector>
+
+#include "storage/mem/mem_record_store.h"
+#include "storage/mem/mem_hash_index.h"
+#include "gtest/gtest.h"
+
+static RC count_visitor(Record *record, void *context)
+{
+  (*(int *)context)++;
+  return RC::SUCCESS;
+}
+
+TEST(MemRecordStoreTest, insert_delete_visit)
+{
+  MemRecordStore store(sizeof(int));
+  const int record_num = MEM_RECORD_BLOCK_ROWS + 10;
+  std::vector<RID> rids;
+  for (int i = 0; i < record_num; i++) {
+    RID rid;
+    ASSERT_EQ(RC::SUCCESS, store.insert_record((const char *)&i, &rid));
+    rids.push_back(rid);
+  }
+  ASSERT_EQ(2, store.block_count());
+  ASSERT_EQ(record_num, store.record_count());
+
+  Record record;
+  ASSERT_EQ(RC::SUCCESS, store.get_record(rids[5], &record));
+  ASSERT_EQ(5, *(int *)record.data);
+  const int value = 100;
+  ASSERT_EQ(RC::SUCCESS, store.update_record(rids[5], (const char *)&value));
+  ASSERT_EQ(RC::SUCCESS, store.get_record(rids[5], &record));
+  ASSERT_EQ(value, *(int *)record.data);
+
+  // 删除之后的位置再插入时复用
+  ASSERT_EQ(RC::SUCCESS, store.delete_record(rids[7]));
+  ASSERT_NE(RC::SUCCESS, store.get_record(rids[7], &record));
+  ASSERT_NE(RC::SUCCESS, store.delete_record(rids[7]));
+  RID rid;
+  ASSERT_EQ(RC::SUCCESS, store.insert_record((const char *)&value, &rid));
+  ASSERT_TRUE(rid == rids[7]);
+
+  ASSERT_EQ(RC::SUCCESS, store.delete_record(rids[0]));
+  int count = 0;
+  ASSERT_EQ(RC::SUCCESS, store.visit_records(count_visitor, &count));
+  ASSERT_EQ(record_num - 1, count);
+  count = 0;
+  ASSERT_EQ(RC::SUCCESS, store.visit_block(1, count_visitor, &count));
+  ASSERT_EQ(10, count);
+  ASSERT_EQ(RC::RECORD_EOF, store.visit_block(2, count_visitor, &count));
+}
+
+TEST(MemHashIndexTest, unique_lookup_delete)
+{
+  FieldMeta field;
+  ASSERT_EQ(RC::SUCCESS, field.init("id", INTS, 0, sizeof(int), true, false));
+  std::vector<const FieldMeta *> fields{&field};
+  IndexMeta index_meta;
+  ASSERT_EQ(RC::SUCCESS, index_meta.init("m_id", fields, true, std::vector<int>(), HASH_INDEX));
+  MemHashIndex index;
+  ASSERT_EQ(RC::SUCCESS, index.create(nullptr, index_meta, std::vector<FieldMeta>{field}));
+
+  for (int i = 0; i < 1000; i++) {
+    RID rid;
+    rid.page_num = i / 100;
+    rid.slot_num = i % 100;
+    ASSERT_EQ(RC::SUCCESS, index.insert_entry((const char *)&i, &rid));
+  }
+  const int key = 123;
+  RID rid;
+  rid.page_num = 50;
+  rid.slot_num = 0;
+  ASSERT_EQ(RC::RECORD_DUPLICATE_KEY, index.insert_entry((const char *)&key, &rid));
+
+  IndexScanner *scanner = index.create_scanner(EQUAL_TO, (const char *)&key, -1);
+  ASSERT_NE(nullptr, scanner);
+  ASSERT_EQ(RC::SUCCESS, scanner->next_entry(&rid));
+  ASSERT_EQ(1, rid.page_num);
+  ASSERT_EQ(23, rid.slot_num);
+  ASSERT_EQ(RC::RECORD_EOF, scanner->next_entry(&rid));
+  scanner->destroy();
+
+  // 只支持等值查询
+  ASSERT_EQ(nullptr, index.create_scanner(LESS_THAN, (const char *)&key, -1));
+
+  ASSERT_EQ(RC::SUCCESS, index.delete_entry((const char *)&key, &rid));
+  ASSERT_EQ(RC::RECORD_INVALID_KEY, index.delete_entry((const char *)&key, &rid));
+  scanner = index.create_scanner(EQUAL_TO, (const char *)&key, -1);
+  ASSERT_NE(nullptr, scanner);
+  ASSERT_EQ(RC::RECORD_EOF, scanner->next_entry(&rid));
+  scanner->destroy();
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,58 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the per-query memory tracker.
+//
+
+#include "sql/executor/memory_tracker.h"
+#include "gtest/gtest.h"
+
+TEST(MemoryTrackerTest, limit)
+{
+  MemoryTracker tracker(100);
+  ASSERT_TRUE(tracker.try_consume(60));
+  ASSERT_TRUE(tracker.try_consume(40));
+  // 超过限制时不计入
+  ASSERT_FALSE(tracker.try_consume(1));
+  ASSERT_EQ(100u, tracker.used());
+
+  tracker.release(50);
+  ASSERT_TRUE(tracker.try_consume(30));
+  ASSERT_EQ(80u, tracker.used());
+
+  // consume总是计入，之后的申请都会失败
+  tracker.consume(40);
+  ASSERT_EQ(120u, tracker.used());
+  ASSERT_EQ(120u, tracker.peak());
+  ASSERT_FALSE(tracker.try_consume(1));
+
+  tracker.release(200);
+  ASSERT_EQ(0u, tracker.used());
+  ASSERT_EQ(120u, tracker.peak());
+}
+
+TEST(MemoryTrackerTest, unlimited)
+{
+  MemoryTracker tracker(0);
+  ASSERT_TRUE(tracker.try_consume((size_t)1 << 40));
+
+  set_query_memory_limit(4096);
+  MemoryTracker configured;
+  ASSERT_EQ(4096u, configured.limit());
+  ASSERT_FALSE(configured.try_consume(4097));
+  set_query_memory_limit(QUERY_MEMORY_LIMIT);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the lock-free event queue of stages.
+//
+
+#include <pthread.h>
+
+#include <atomic>
+#include <vector>
+
+#include "common/seda/mpmc_queue.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+TEST(MpmcQueueTest, order)
+{
+  MpmcQueue<int> queue;
+  int items[10];
+  ASSERT_EQ(nullptr, queue.pop());
+  for (int i = 0; i < 10; i++) {
+    items[i] = i;
+    ASSERT_TRUE(queue.push(&items[i]));
+  }
+  ASSERT_EQ(10u, queue.size());
+  ASSERT_EQ(&items[0], queue.pop());
+
+  // 批量取出时最多取max个，按先进先出的顺序
+  int *batch[4];
+  ASSERT_EQ(4, queue.pop_batch(batch, 4));
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(&items[i + 1], batch[i]);
+  }
+  ASSERT_EQ(4, queue.pop_batch(batch, 4));
+  ASSERT_EQ(1, queue.pop_batch(batch, 4));
+  ASSERT_EQ(&items[9], batch[0]);
+  ASSERT_EQ(0, queue.pop_batch(batch, 4));
+}
+
+TEST(MpmcQueueTest, full)
+{
+  MpmcQueue<int> queue;
+  int item = 0;
+  for (uint64_t i = 0; i < MpmcQueue<int>::CAPACITY; i++) {
+    ASSERT_TRUE(queue.push(&item));
+  }
+  ASSERT_FALSE(queue.push(&item));
+  ASSERT_EQ(&item, queue.pop());
+  ASSERT_TRUE(queue.push(&item));
+}
+
+struct QueueContext {
+  MpmcQueue<int> *queue;
+  std::vector<int> *values;
+  std::vector<int> *taken;  // 每个元素被取走的次数
+  std::atomic<int> *consumed;
+  int begin;
+  int end;
+};
+
+static const int ITEM_NUM = 100000;
+
+static void *producer(void *arg)
+{
+  QueueContext *ctx = (QueueContext *)arg;
+  for (int i = ctx->begin; i < ctx->end; i++) {
+    while (!ctx->queue->push(&(*ctx->values)[i])) {
+    }
+  }
+  return nullptr;
+}
+
+static void *consumer(void *arg)
+{
+  QueueContext *ctx = (QueueContext *)arg;
+  int *batch[8];
+  while (ctx->consumed->load() < ITEM_NUM) {
+    int count = ctx->queue->pop_batch(batch, 8);
+    for (int i = 0; i < count; i++) {
+      __sync_fetch_and_add(&(*ctx->taken)[*batch[i]], 1);
+    }
+    ctx->consumed->fetch_add(count);
+  }
+  return nullptr;
+}
+
+TEST(MpmcQueueTest, concurrent)
+{
+  const int thread_num = 3;
+  MpmcQueue<int> queue;
+  std::vector<int> values(ITEM_NUM);
+  std::vector<int> taken(ITEM_NUM, 0);
+  std::atomic<int> consumed(0);
+  for (int i = 0; i < ITEM_NUM; i++) {
+    values[i] = i;
+  }
+
+  QueueContext contexts[thread_num];
+  pthread_t producers[thread_num];
+  pthread_t consumers[thread_num];
+  for (int i = 0; i < thread_num; i++) {
+    contexts[i] = QueueContext{&queue, &values, &taken, &consumed, ITEM_NUM * i / thread_num,
+                               ITEM_NUM * (i + 1) / thread_num};
+    ASSERT_EQ(0, pthread_create(&producers[i], nullptr, producer, &contexts[i]));
+    ASSERT_EQ(0, pthread_create(&consumers[i], nullptr, consumer, &contexts[i]));
+  }
+  for (int i = 0; i < thread_num; i++) {
+    pthread_join(producers[i], nullptr);
+    pthread_join(consumers[i], nullptr);
+  }
+
+  ASSERT_EQ(ITEM_NUM, consumed.load());
+  for (int i = 0; i < ITEM_NUM; i++) {
+    ASSERT_EQ(1, taken[i]) << "i=" << i;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,175 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for memory pools.
+//
+
+#include <pthread.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "common/mm/mpool.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+class Base : public PooledObject {
+ public:
+  virtual ~Base() = default;
+  int id = 0;
+};
+
+class Derived : public Base {
+ public:
+  char payload[100];
+};
+
+TEST(MpoolTest, mem_pool)
+{
+  // 池子空了之后会自动补充
+  MemPool<int> pool;
+  ASSERT_EQ(0, pool.init(2));
+  std::vector<int *> items;
+  for (int i = 0; i < 40; i++) {
+    int *item = pool.get();
+    ASSERT_NE(nullptr, item);
+    items.push_back(item);
+  }
+  for (int *item : items) {
+    pool.put(item);
+  }
+}
+
+TEST(MpoolTest, reuse)
+{
+  void *p1 = BlockPool::alloc(40);
+  BlockPool::free(p1, 40);
+  // 同一个大小类别的块在本线程里复用
+  void *p2 = BlockPool::alloc(48);
+  ASSERT_EQ(p1, p2);
+  BlockPool::free(p2, 48);
+
+  void *big = BlockPool::alloc(MPOOL_MAX_BLOCK_SIZE + 1);
+  ASSERT_NE(nullptr, big);
+  memset(big, 0, MPOOL_MAX_BLOCK_SIZE + 1);
+  BlockPool::free(big, MPOOL_MAX_BLOCK_SIZE + 1);
+}
+
+TEST(MpoolTest, pooled_object)
+{
+  // 通过基类指针删除时按照真实的大小归还
+  Base *base = new Derived();
+  base->id = 3;
+  delete base;
+  void *block = BlockPool::alloc(sizeof(Derived));
+  ASSERT_EQ((void *)base, block);
+  BlockPool::free(block, sizeof(Derived));
+
+  Base *nothrow = new (std::nothrow) Base();
+  ASSERT_NE(nullptr, nothrow);
+  delete nothrow;
+}
+
+static void *free_blocks(void *arg)
+{
+  std::vector<void *> *blocks = (std::vector<void *> *)arg;
+  for (void *block : *blocks) {
+    BlockPool::free(block, 64);
+  }
+  return nullptr;
+}
+
+TEST(MpoolTest, cross_thread)
+{
+  // 另一个线程释放的块先回到它自己的缓存，线程退出后回到共享链表
+  const int num = 1000;
+  std::vector<void *> blocks;
+  for (int i = 0; i < num; i++) {
+    void *block = BlockPool::alloc(64);
+    memset(block, i & 0xff, 64);
+    blocks.push_back(block);
+  }
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, nullptr, free_blocks, &blocks));
+  pthread_join(thread, nullptr);
+
+  for (int i = 0; i < num; i++) {
+    void *block = BlockPool::alloc(64);
+    ASSERT_NE(nullptr, block);
+    blocks[i] = block;
+  }
+  for (void *block : blocks) {
+    BlockPool::free(block, 64);
+  }
+}
+
+static ThreadLocalMemPool<int> *local_pool = nullptr;
+
+static void *use_local_pool(void *arg)
+{
+  std::vector<int *> *items = (std::vector<int *> *)arg;
+  for (int i = 0; i < 500; i++) {
+    items->push_back(local_pool->get());
+  }
+  for (int i = 0; i < 500; i += 2) {
+    local_pool->put((*items)[i]);
+  }
+  return nullptr;
+}
+
+TEST(MpoolTest, thread_local_mem_pool)
+{
+  ThreadLocalMemPool<int> pool(16);
+  local_pool = &pool;
+  ASSERT_EQ(0, pool.init(20));
+
+  // 同一个线程里优先拿回刚放回的对象
+  int *a = pool.get();
+  int *b = pool.get();
+  ASSERT_NE(a, b);
+  ASSERT_EQ(a + 1, b);
+  pool.put(b);
+  ASSERT_EQ(b, pool.get());
+  pool.put(a);
+  pool.put(b);
+
+  // 每个线程拿到的对象互不相同，线程退出后剩余的对象还给共享链表
+  const int thread_num = 3;
+  pthread_t threads[thread_num];
+  std::vector<int *> items[thread_num];
+  for (int i = 0; i < thread_num; i++) {
+    ASSERT_EQ(0, pthread_create(&threads[i], nullptr, use_local_pool, &items[i]));
+  }
+  for (int i = 0; i < thread_num; i++) {
+    pthread_join(threads[i], nullptr);
+  }
+  std::vector<int *> all;
+  for (int i = 0; i < thread_num; i++) {
+    for (int j = 1; j < 500; j += 2) {
+      all.push_back(items[i][j]);
+    }
+  }
+  std::sort(all.begin(), all.end());
+  ASSERT_EQ(all.end(), std::adjacent_find(all.begin(), all.end()));
+  for (int *item : all) {
+    ASSERT_NE(nullptr, item);
+    pool.put(item);
+  }
+  local_pool = nullptr;
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,102 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the receive buffer of connections.
+//
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "net/net_buffer.h"
+#include "gtest/gtest.h"
+
+static void write_data(NetBuffer &buf, const char *data, int len)
+{
+  while (len > 0) {
+    int space_len = 0;
+    char *space = buf.write_space(space_len);
+    ASSERT_NE(nullptr, space);
+    int n = std::min(space_len, len);
+    memcpy(space, data, n);
+    buf.commit(n);
+    data += n;
+    len -= n;
+  }
+}
+
+TEST(NetBufferTest, messages)
+{
+  NetBuffer buf;
+  ASSERT_EQ(0, buf.block_num());
+
+  std::string message;
+  const char data[] = "select 1;\0insert into t values(1);\0sel";
+  write_data(buf, data, sizeof(data) - 1);
+  ASSERT_TRUE(buf.pop_message(message));
+  ASSERT_EQ("select 1;", message);
+  ASSERT_TRUE(buf.pop_message(message));
+  ASSERT_EQ("insert into t values(1);", message);
+  ASSERT_FALSE(buf.pop_message(message));
+  ASSERT_EQ(3, buf.size());
+
+  // 不完整的请求留在缓冲区，接着收到的数据拼在后面
+  write_data(buf, "ect 2;", 7);
+  ASSERT_TRUE(buf.pop_message(message));
+  ASSERT_EQ("select 2;", message);
+  ASSERT_EQ(0, buf.size());
+
+  // 空闲时不占用块
+  buf.reclaim();
+  ASSERT_EQ(0, buf.block_num());
+  ASSERT_FALSE(buf.pop_message(message));
+}
+
+TEST(NetBufferTest, large_message)
+{
+  NetBuffer buf;
+  // 比一个块大得多的请求，分多次到达
+  std::string large;
+  for (int i = 0; large.size() < 5 * SOCKET_BUFFER_SIZE; i++) {
+    large += std::to_string(i) + ",";
+  }
+  std::string message;
+  for (size_t pos = 0; pos < large.size(); pos += 1000) {
+    write_data(buf, large.data() + pos, std::min<size_t>(1000, large.size() - pos));
+    ASSERT_FALSE(buf.pop_message(message));
+  }
+  ASSERT_GE(buf.block_num(), 5);
+  write_data(buf, "\0x\0", 3);
+  ASSERT_TRUE(buf.pop_message(message));
+  ASSERT_EQ(large, message);
+  ASSERT_EQ(1, buf.block_num());
+  ASSERT_TRUE(buf.pop_message(message));
+  ASSERT_EQ("x", message);
+
+  // 正好在块的边界结束的请求
+  std::string full(SOCKET_BUFFER_SIZE - 1, 'a');
+  buf.reclaim();
+  write_data(buf, full.c_str(), SOCKET_BUFFER_SIZE);
+  ASSERT_EQ(1, buf.block_num());
+  ASSERT_TRUE(buf.pop_message(message));
+  ASSERT_EQ(full, message);
+  ASSERT_EQ(0, buf.block_num());
+  write_data(buf, "b\0", 2);
+  ASSERT_TRUE(buf.pop_message(message));
+  ASSERT_EQ("b", message);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
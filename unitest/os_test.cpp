@@ -0,0 +1,64 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for cpu lists and numa helpers.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "common/defs.h"
+#include "common/os/os.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+TEST(OsTest, parse_cpu_list)
+{
+  std::vector<int> cpus;
+  ASSERT_EQ(0, parse_cpu_list("0-3,8, 10-11", cpus));
+  ASSERT_EQ((std::vector<int>{0, 1, 2, 3, 8, 10, 11}), cpus);
+
+  cpus.clear();
+  ASSERT_EQ(0, parse_cpu_list("5", cpus));
+  ASSERT_EQ((std::vector<int>{5}), cpus);
+
+  const char *invalid[] = {"", "a", "3-1", "1-", "-1", "0-3x", "100000"};
+  for (const char *str : invalid) {
+    cpus.clear();
+    ASSERT_EQ(-1, parse_cpu_list(str, cpus)) << str;
+  }
+}
+
+TEST(OsTest, numa)
+{
+  std::vector<int> nodes;
+  get_numa_nodes(nodes);
+  ASSERT_FALSE(nodes.empty());
+
+  // 只检查绑定之后内存可以正常使用，不支持numa的系统上绑定失败
+  const size_t len = 1 << 20;
+  void *memory = nullptr;
+  ASSERT_EQ(0, posix_memalign(&memory, 4096, len));
+  bind_memory_to_numa_node(memory, len, nodes[0]);
+  memset(memory, 1, len);
+  ASSERT_EQ(1, ((char *)memory)[len - 1]);
+  free(memory);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,100 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for page io backends.
+//
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "storage/default/page_io.h"
+#include "gtest/gtest.h"
+
+static void write_and_read(PageIoType type)
+{
+  const char *file_name = "page_io_test.data";
+  unlink(file_name);
+  int fd = open(file_name, O_RDWR | O_CREAT, 0644);
+  ASSERT_GE(fd, 0);
+
+  PageIo *page_io = create_page_io(type);
+  ASSERT_NE(nullptr, page_io);
+
+  const int block_size = 4096;
+  const int block_num = 8;
+  static char write_buf[block_num][block_size];
+  static char read_buf[block_num][block_size];
+  for (int i = 0; i < block_num; i++) {
+    memset(write_buf[i], 'a' + i, block_size);
+  }
+
+  // 前两个请求各写3个块，最后一个请求写2个块，写的顺序和在文件中的顺序不同
+  struct iovec write_iov[block_num];
+  for (int i = 0; i < block_num; i++) {
+    write_iov[i].iov_base = write_buf[i];
+    write_iov[i].iov_len = block_size;
+  }
+  PageIoRequest writes[3] = {
+      {fd, 5 * block_size, &write_iov[5], 3, true, 0},
+      {fd, 0, &write_iov[0], 3, true, 0},
+      {fd, 3 * block_size, &write_iov[3], 2, true, 0},
+  };
+  ASSERT_EQ(RC::SUCCESS, page_io->submit_and_wait(writes, 3));
+  ASSERT_EQ(3 * block_size, writes[0].result);
+  ASSERT_EQ(3 * block_size, writes[1].result);
+  ASSERT_EQ(2 * block_size, writes[2].result);
+
+  struct iovec read_iov[block_num];
+  PageIoRequest reads[block_num];
+  for (int i = 0; i < block_num; i++) {
+    read_iov[i].iov_base = read_buf[i];
+    read_iov[i].iov_len = block_size;
+    reads[i] = {fd, (long long)i * block_size, &read_iov[i], 1, false, 0};
+  }
+  ASSERT_EQ(RC::SUCCESS, page_io->submit_and_wait(reads, block_num));
+  for (int i = 0; i < block_num; i++) {
+    ASSERT_EQ(block_size, reads[i].result);
+    ASSERT_EQ(0, memcmp(write_buf[i], read_buf[i], block_size));
+  }
+
+  // 读文件末尾之后的数据返回0字节
+  PageIoRequest eof_read = {fd, (long long)block_num * block_size, &read_iov[0], 1, false, -1};
+  ASSERT_EQ(RC::SUCCESS, page_io->submit_and_wait(&eof_read, 1));
+  ASSERT_EQ(0, eof_read.result);
+
+  delete page_io;
+  close(fd);
+  unlink(file_name);
+}
+
+TEST(test_page_io, test_sync_page_io) {
+  write_and_read(SYNC_PAGE_IO);
+}
+
+TEST(test_page_io, test_uring_page_io) {
+  // 不支持io_uring的环境下会退回到sync后端，测试结果相同
+  write_and_read(URING_PAGE_IO);
+}
+
+TEST(test_page_io, test_page_io_type_from_string) {
+  PageIoType type = SYNC_PAGE_IO;
+  ASSERT_EQ(RC::SUCCESS, page_io_type_from_string("IO_URING", &type));
+  ASSERT_EQ(URING_PAGE_IO, type);
+  ASSERT_EQ(RC::SUCCESS, page_io_type_from_string("sync", &type));
+  ASSERT_EQ(SYNC_PAGE_IO, type);
+  ASSERT_NE(RC::SUCCESS, page_io_type_from_string("aio", &type));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
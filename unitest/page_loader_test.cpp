@@ -0,0 +1,116 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the asynchronous page loader.
+//
+
+#include <unistd.h>
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include "storage/default/disk_buffer_pool.h"
+#include "storage/default/page_loader.h"
+#include "gtest/gtest.h"
+
+static void create_pages(const char *file_name, int page_num)
+{
+  unlink(file_name);
+  DiskBufferPool pool(16);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  for (int i = 1; i <= page_num; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    data[0] = (char)i;
+    pool.mark_dirty(&page_handle);
+    pool.unpin_page(&page_handle);
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+}
+
+TEST(PageLoaderTest, missing_pages)
+{
+  const char *file_name = "page_loader_missing.data";
+  create_pages(file_name, 10);
+
+  DiskBufferPool pool(32);
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  BPPageHandle page_handle;
+  ASSERT_EQ(RC::SUCCESS, pool.get_this_page(file_id, 3, &page_handle));
+  pool.unpin_page(&page_handle);
+
+  // 文件头页不算，已经在缓冲池中的页面跳过
+  std::string name;
+  std::vector<PageNum> pages;
+  ASSERT_EQ(RC::SUCCESS, pool.missing_pages(file_id, 100, name, pages));
+  ASSERT_EQ(file_name, name);
+  ASSERT_EQ((std::vector<PageNum>{1, 2, 4, 5, 6, 7, 8, 9, 10}), pages);
+
+  pages.clear();
+  ASSERT_EQ(RC::SUCCESS, pool.missing_pages(file_id, 3, name, pages));
+  ASSERT_EQ((std::vector<PageNum>{1, 2, 4}), pages);
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+TEST(PageLoaderTest, load)
+{
+  const char *file_name = "page_loader_load.data";
+  create_pages(file_name, 10);
+
+  DiskBufferPool pool(32);
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  std::vector<PageLoadFile> files(1);
+  files[0].buffer_pool = &pool;
+  ASSERT_EQ(RC::SUCCESS, pool.missing_pages(file_id, 100, files[0].file_name, files[0].pages));
+  ASSERT_EQ(10, (int)files[0].pages.size());
+
+  PageLoader loader;
+  ASSERT_FALSE(loader.enabled());
+  loader.start(2);
+  ASSERT_TRUE(loader.enabled());
+  std::promise<void> done;
+  loader.submit(std::move(files), [&done]() { done.set_value(); });
+  done.get_future().wait();
+  ASSERT_EQ(1, loader.jobs());
+  ASSERT_EQ(10, loader.loaded_pages());
+  loader.stop();
+  ASSERT_FALSE(loader.enabled());
+
+  // 加载之后都在缓冲池中
+  std::string name;
+  std::vector<PageNum> pages;
+  ASSERT_EQ(RC::SUCCESS, pool.missing_pages(file_id, 100, name, pages));
+  ASSERT_TRUE(pages.empty());
+  for (int i = 1; i <= 10; i++) {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.get_this_page(file_id, i, &page_handle));
+    char *data = nullptr;
+    pool.get_data(&page_handle, &data);
+    ASSERT_EQ((char)i, data[0]);
+    pool.unpin_page(&page_handle);
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,67 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for page visibility map.
+//
+
+#include "storage/common/page_visibility.h"
+#include "gtest/gtest.h"
+
+TEST(PageVisibilityTest, add_remove)
+{
+  PageVisibility visibility;
+  ASSERT_TRUE(visibility.all_visible(1));
+  ASSERT_EQ(0, visibility.page_count());
+
+  visibility.add(1);
+  visibility.add(1);
+  visibility.add(3);
+  ASSERT_FALSE(visibility.all_visible(1));
+  ASSERT_TRUE(visibility.all_visible(2));
+  ASSERT_FALSE(visibility.all_visible(3));
+  ASSERT_EQ(2, visibility.page_count());
+
+  // 页面上所有的操作都结束之后才全部可见
+  visibility.remove(1);
+  ASSERT_FALSE(visibility.all_visible(1));
+  visibility.remove(1);
+  ASSERT_TRUE(visibility.all_visible(1));
+  visibility.remove(3);
+  ASSERT_TRUE(visibility.all_visible(3));
+  ASSERT_EQ(0, visibility.page_count());
+
+  // 没有add过的页面不影响计数
+  visibility.remove(5);
+  visibility.add(5);
+  ASSERT_FALSE(visibility.all_visible(5));
+}
+
+TEST(PageVisibilityTest, insert)
+{
+  PageVisibility visibility;
+  {
+    PageVisibilityInsert insert(visibility, true);
+    ASSERT_FALSE(visibility.all_visible(1));
+    visibility.add(1);
+  }
+  ASSERT_FALSE(visibility.all_visible(1));
+  ASSERT_TRUE(visibility.all_visible(2));
+  {
+    PageVisibilityInsert insert(visibility, false);
+    ASSERT_TRUE(visibility.all_visible(2));
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,462 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the sql parser.
+//
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sql/parser/parse.h"
+#include "gtest/gtest.h"
+
+TEST(ParseTest, limit)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("select * from t;", query));
+  ASSERT_EQ(0, query->sstr.selection.has_limit);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("select * from t where id > 1 order by id limit 10;", query));
+  ASSERT_EQ(1, query->sstr.selection.has_limit);
+  ASSERT_EQ(10, query->sstr.selection.limit);
+  ASSERT_EQ(0, query->sstr.selection.offset);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("select * from t LIMIT 5 OFFSET 20;", query));
+  ASSERT_EQ(5, query->sstr.selection.limit);
+  ASSERT_EQ(20, query->sstr.selection.offset);
+
+  // limit m, n跳过m行
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("select * from t limit 20, 5;", query));
+  ASSERT_EQ(5, query->sstr.selection.limit);
+  ASSERT_EQ(20, query->sstr.selection.offset);
+
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("select * from t limit;", query));
+  query_destroy(query);
+}
+
+TEST(ParseTest, sub_query)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS,
+            parse("select * from t1 where v > 1 and id in (select id from t2 where t2.v = t1.v and t2.id < 5) and "
+                  "not exists (select * from t3 where t3.id = t1.id);",
+                query));
+  const Selects &selects = query->sstr.selection;
+  ASSERT_EQ(3, selects.condition_num);
+  ASSERT_EQ(IN_SUBQUERY, selects.conditions[1].comp);
+  ASSERT_STREQ("id", selects.conditions[1].left_attr.attribute_name);
+
+  // 子查询的条件不会留在外层
+  const Selects *sub_select = selects.conditions[1].sub_select;
+  ASSERT_NE(nullptr, sub_select);
+  ASSERT_STREQ("t2", sub_select->relations[0]);
+  ASSERT_EQ(1, sub_select->attr_num);
+  ASSERT_EQ(2, sub_select->condition_num);
+  ASSERT_STREQ("t1", sub_select->conditions[0].right_attr.relation_name);
+
+  ASSERT_EQ(NOT_EXISTS_SUBQUERY, selects.conditions[2].comp);
+  ASSERT_EQ(0, selects.conditions[2].left_is_attr);
+  ASSERT_STREQ("t3", selects.conditions[2].sub_select->relations[0]);
+  ASSERT_EQ(1, selects.conditions[2].sub_select->condition_num);
+  ASSERT_EQ(nullptr, selects.conditions[0].sub_select);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("select * from t1 where id not in (select id from t2 where v in (select v from t3));", query));
+  ASSERT_EQ(NOT_IN_SUBQUERY, query->sstr.selection.conditions[0].comp);
+  ASSERT_EQ(IN_SUBQUERY, query->sstr.selection.conditions[0].sub_select->conditions[0].comp);
+
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("select * from t1 where id in (select id from t2;", query));
+  query_destroy(query);
+}
+
+TEST(ParseTest, prepare)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("prepare ins from insert into t values(?, 'a', ?);", query));
+  ASSERT_EQ(SCF_PREPARE, query->flag);
+  const Prepare &prepare = query->sstr.prepare;
+  ASSERT_STREQ("ins", prepare.stmt_name);
+  ASSERT_EQ(2, prepare.param_num);
+  ASSERT_EQ(SCF_INSERT, prepare.query->flag);
+
+  Query *execute = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("execute ins using 3, 'b';", execute));
+  ASSERT_EQ(SCF_EXECUTE, execute->flag);
+  ASSERT_EQ(2, execute->sstr.execute.value_num);
+
+  // 在拷贝上绑定参数，保存的语句不变，可以反复执行
+  Query *bound = query_create();
+  query_copy(bound, prepare.query);
+  query_bind_params(bound, execute->sstr.execute.values);
+  const Inserts &inserts = bound->sstr.insertion;
+  ASSERT_STREQ("t", inserts.relation_name);
+  ASSERT_EQ(INTS, inserts.values[0][0].type);
+  ASSERT_EQ(3, *(int *)inserts.values[0][0].data);
+  ASSERT_STREQ("a", (char *)inserts.values[0][1].data);
+  ASSERT_EQ(CHARS, inserts.values[0][2].type);
+  ASSERT_STREQ("b", (char *)inserts.values[0][2].data);
+  ASSERT_EQ(UNDEFINED, prepare.query->sstr.insertion.values[0][0].type);
+  query_destroy(bound);
+
+  // 参数按出现的顺序编号，子查询中的也一样
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS,
+            parse("prepare sel from select * from t1 where v = ? and id in (select id from t2 where v > ?);", query));
+  ASSERT_EQ(2, query->sstr.prepare.param_num);
+  query_reset(execute);
+  ASSERT_EQ(RC::SUCCESS, parse("execute sel using 1, 2;", execute));
+  bound = query_create();
+  query_copy(bound, query->sstr.prepare.query);
+  query_bind_params(bound, execute->sstr.execute.values);
+  ASSERT_EQ(1, *(int *)bound->sstr.selection.conditions[0].right_value.data);
+  ASSERT_EQ(2, *(int *)bound->sstr.selection.conditions[1].sub_select->conditions[0].right_value.data);
+  query_destroy(bound);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("deallocate prepare sel;", query));
+  ASSERT_EQ(SCF_DEALLOCATE, query->flag);
+
+  // 参数只能出现在PREPARE的语句中
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("insert into t values(?, 1);", query));
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("prepare p from create table t(id int);", query));
+  query_destroy(execute);
+  query_destroy(query);
+}
+
+TEST(ParseTest, savepoint)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("savepoint sp1;", query));
+  ASSERT_EQ(SCF_SAVEPOINT, query->flag);
+  ASSERT_STREQ("sp1", query->sstr.savepoint.savepoint_name);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("rollback to sp1;", query));
+  ASSERT_EQ(SCF_ROLLBACK_TO_SAVEPOINT, query->flag);
+  ASSERT_STREQ("sp1", query->sstr.savepoint.savepoint_name);
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("ROLLBACK TO SAVEPOINT sp2;", query));
+  ASSERT_EQ(SCF_ROLLBACK_TO_SAVEPOINT, query->flag);
+  ASSERT_STREQ("sp2", query->sstr.savepoint.savepoint_name);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("release savepoint sp2;", query));
+  ASSERT_EQ(SCF_RELEASE_SAVEPOINT, query->flag);
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("rollback;", query));
+  ASSERT_EQ(SCF_ROLLBACK, query->flag);
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("release sp2;", query));
+  query_destroy(query);
+}
+
+TEST(ParseTest, set_variable)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("set synchronous_commit = off;", query));
+  ASSERT_EQ(SCF_SET_VARIABLE, query->flag);
+  ASSERT_STREQ("synchronous_commit", query->sstr.set_variable.variable_name);
+  ASSERT_STREQ("off", query->sstr.set_variable.value);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("SET synchronous_commit = ON;", query));
+  ASSERT_STREQ("on", query->sstr.set_variable.value);
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("set synchronous_commit = 1;", query));
+  ASSERT_STREQ("1", query->sstr.set_variable.value);
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("set synchronous_commit;", query));
+  query_destroy(query);
+}
+
+TEST(ParseTest, create_table_engine)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("create table m(id int, name char(8)) engine=memory;", query));
+  ASSERT_EQ(SCF_CREATE_TABLE, query->flag);
+  ASSERT_STREQ("memory", query->sstr.create_table.engine);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("create table d(id int);", query));
+  ASSERT_EQ(nullptr, query->sstr.create_table.engine);
+  query_destroy(query);
+}
+
+TEST(ParseTest, create_table_bloom_filter)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("create table t(id int, name char(8)) format=pax bloom_filter=name;", query));
+  ASSERT_EQ(SCF_CREATE_TABLE, query->flag);
+  ASSERT_STREQ("name", query->sstr.create_table.bloom_filter);
+  ASSERT_STREQ("pax", query->sstr.create_table.format);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("create table d(id int);", query));
+  ASSERT_EQ(nullptr, query->sstr.create_table.bloom_filter);
+  query_destroy(query);
+}
+
+TEST(ParseTest, partition)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS,
+            parse("create table t(id int, name char(8)) partition by range(id) "
+                  "(partition p0 values less than (10), partition p1 values less than maxvalue);",
+                query));
+  const PartitionDef &range = query->sstr.create_table.partition;
+  ASSERT_EQ(RANGE_PARTITION, range.type);
+  ASSERT_STREQ("id", range.field_name);
+  ASSERT_EQ(2, range.partition_num);
+  ASSERT_STREQ("p0", range.partition_names[0]);
+  ASSERT_EQ(INTS, range.bounds[0].type);
+  ASSERT_EQ(10, *(int *)range.bounds[0].data);
+  ASSERT_EQ(UNDEFINED, range.bounds[1].type);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("create table h(id int) partition by hash(id) partitions 4;", query));
+  ASSERT_EQ(HASH_PARTITION, query->sstr.create_table.partition.type);
+  ASSERT_EQ(4, query->sstr.create_table.partition.partition_num);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("create table d(id int);", query));
+  ASSERT_EQ(NO_PARTITION, query->sstr.create_table.partition.type);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("alter table t drop partition p0;", query));
+  ASSERT_EQ(SCF_DROP_PARTITION, query->flag);
+  ASSERT_STREQ("t", query->sstr.drop_partition.relation_name);
+  ASSERT_STREQ("p0", query->sstr.drop_partition.partition_name);
+
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("create table t(id int) partition by list(id) partitions 4;", query));
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("create table t(id int) partition by range(id) (partition p0 values less than (null));", query));
+  query_destroy(query);
+}
+
+TEST(ParseTest, truncate)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("truncate table t;", query));
+  ASSERT_EQ(SCF_TRUNCATE_TABLE, query->flag);
+  ASSERT_STREQ("t", query->sstr.truncate_table.relation_name);
+
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("truncate t;", query));
+  query_destroy(query);
+}
+
+TEST(ParseTest, analyze)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("analyze table t;", query));
+  ASSERT_EQ(SCF_ANALYZE_TABLE, query->flag);
+  ASSERT_STREQ("t", query->sstr.analyze_table.relation_name);
+
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("analyze t;", query));
+  query_destroy(query);
+}
+
+TEST(ParseTest, materialized_view)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("create materialized view mv as select a, count(*), sum(b) from t group by a;", query));
+  ASSERT_EQ(SCF_CREATE_VIEW, query->flag);
+  ASSERT_STREQ("mv", query->sstr.create_view.view_name);
+  const Selects &selects = query->sstr.create_view.query->sstr.selection;
+  ASSERT_EQ(1, selects.relation_num);
+  ASSERT_EQ(3, selects.attr_num);
+  ASSERT_EQ(1, selects.group_num);
+  ASSERT_STREQ("sum", selects.attributes[0].window_function_name);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("drop materialized view mv;", query));
+  ASSERT_EQ(SCF_DROP_TABLE, query->flag);
+  ASSERT_STREQ("mv", query->sstr.drop_table.relation_name);
+
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("create materialized table mv as select a from t;", query));
+  query_destroy(query);
+}
+
+TEST(ParseTest, outfile)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("select * from t;", query));
+  ASSERT_EQ(nullptr, query->sstr.selection.outfile);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("select id, name from t where id > 1 order by id limit 10 into outfile '/tmp/t.txt';", query));
+  ASSERT_EQ(SCF_SELECT, query->flag);
+  ASSERT_STREQ("/tmp/t.txt", query->sstr.selection.outfile);
+  ASSERT_EQ(10, query->sstr.selection.limit);
+
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("select * from t into dumpfile '/tmp/t.txt';", query));
+  query_destroy(query);
+}
+
+TEST(ParseTest, backup)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("backup to '/tmp/backup-1';", query));
+  ASSERT_EQ(SCF_BACKUP, query->flag);
+  ASSERT_STREQ("/tmp/backup-1", query->sstr.backup.dir);
+
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("restore to '/tmp/backup-1';", query));
+  query_destroy(query);
+}
+
+TEST(ParseTest, cursor)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("declare c1 cursor for select id from t where id > 3;", query));
+  ASSERT_EQ(SCF_SELECT, query->flag);
+  ASSERT_STREQ("c1", query->sstr.selection.cursor);
+  ASSERT_EQ(1, query->sstr.selection.condition_num);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("select id from t;", query));
+  ASSERT_EQ(nullptr, query->sstr.selection.cursor);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("FETCH 100 from c1;", query));
+  ASSERT_EQ(SCF_FETCH, query->flag);
+  ASSERT_STREQ("c1", query->sstr.fetch.cursor_name);
+  ASSERT_EQ(100, query->sstr.fetch.row_num);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("close c1;", query));
+  ASSERT_EQ(SCF_CLOSE_CURSOR, query->flag);
+  ASSERT_STREQ("c1", query->sstr.close_cursor.cursor_name);
+
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("declare c1 cursor as select id from t;", query));
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("fetch c1;", query));
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("open c1;", query));
+  query_destroy(query);
+}
+
+TEST(ParseTest, explain)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("select * from t;", query));
+  ASSERT_EQ(EXPLAIN_NONE, query->sstr.selection.explain);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("explain select * from t, s where t.id = s.id;", query));
+  ASSERT_EQ(SCF_SELECT, query->flag);
+  ASSERT_EQ(EXPLAIN_PLAN, query->sstr.selection.explain);
+  ASSERT_EQ(2, query->sstr.selection.relation_num);
+
+  query_reset(query);
+  ASSERT_EQ(RC::SUCCESS, parse("explain analyze select id from t order by id limit 3;", query));
+  ASSERT_EQ(SCF_SELECT, query->flag);
+  ASSERT_EQ(EXPLAIN_ANALYZE, query->sstr.selection.explain);
+
+  query_reset(query);
+  ASSERT_NE(RC::SUCCESS, parse("explain insert into t values(1);", query));
+  query_destroy(query);
+}
+
+TEST(ParseTest, arena)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("insert into t values(1, 'a'), (2, 'b'), (3, 'c');", query));
+  const Inserts &inserts = query->sstr.insertion;
+  ASSERT_EQ(3, inserts.group_num);
+  ASSERT_EQ(2, inserts.value_num[2]);
+  ASSERT_EQ(3, *(int *)inserts.values[2][0].data);
+  ASSERT_STREQ("c", (char *)inserts.values[2][1].data);
+
+  // 组数不受MAX_NUM限制
+  std::string sql = "insert into t values";
+  for (int i = 0; i < 1000; i++) {
+    sql += (i == 0 ? "(" : ", (") + std::to_string(i) + ", 'v')";
+  }
+  Query *many = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse((sql + ";").c_str(), many));
+  ASSERT_EQ(1000, many->sstr.insertion.group_num);
+  ASSERT_EQ(999, *(int *)many->sstr.insertion.values[999][0].data);
+  ASSERT_STREQ("v", (char *)many->sstr.insertion.values[500][1].data);
+  query_destroy(many);
+
+  // 拷贝的内存在自己的arena中，源语句释放之后仍然可用
+  Query *copy = query_create();
+  query_copy(copy, query);
+  query_destroy(query);
+  ASSERT_STREQ("t", copy->sstr.insertion.relation_name);
+  ASSERT_EQ(3, copy->sstr.insertion.group_num);
+  ASSERT_STREQ("b", (char *)copy->sstr.insertion.values[1][1].data);
+
+  // 较长的字符串单独申请一块内存
+  std::string long_value(8192, 'x');
+  query_reset(copy);
+  ASSERT_EQ(RC::SUCCESS, parse(("select * from t where name = '" + long_value + "' and id > 1;").c_str(), copy));
+  ASSERT_NE(nullptr, copy->arena.blocks);
+  ASSERT_STREQ(long_value.c_str(), (char *)copy->sstr.selection.conditions[0].right_value.data);
+  ASSERT_EQ(1, *(int *)copy->sstr.selection.conditions[1].right_value.data);
+
+  query_reset(copy);
+  ASSERT_EQ(nullptr, copy->arena.blocks);
+  ASSERT_EQ(RC::SUCCESS, parse("select id from t;", copy));
+  ASSERT_STREQ("id", copy->sstr.selection.attributes[0].attribute_name);
+  query_destroy(copy);
+}
+
+TEST(ParseTest, threads)
+{
+  // 每个线程用自己的词法分析器，同一个线程解析出错之后也能继续使用
+  std::atomic<int> failures(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([t, &failures]() {
+      Query *query = query_create();
+      for (int i = 0; i < 500; i++) {
+        const std::string name = "t" + std::to_string(t);
+        RC rc = parse(("select * from " + name + " where id = " + std::to_string(i) + ";").c_str(), query);
+        if (rc != RC::SUCCESS || 0 != strcmp(name.c_str(), query->sstr.selection.relations[0]) ||
+            i != *(int *)query->sstr.selection.conditions[0].right_value.data) {
+          failures++;
+        }
+        query_reset(query);
+        if (RC::SUCCESS == parse("select * from where;", query)) {
+          failures++;
+        }
+        query_reset(query);
+      }
+      query_destroy(query);
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(0, failures.load());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
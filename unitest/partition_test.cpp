@@ -0,0 +1,210 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the partition metas of partitioned tables.
+//
+
+#include <string.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "storage/common/partition_meta.h"
+#include "storage/common/table_meta.h"
+#include "gtest/gtest.h"
+
+static void init_table_meta(TableMeta &table_meta)
+{
+  AttrInfo attributes[] = {
+      {(char *)"id", INTS, 4, 1},
+      {(char *)"name", CHARS, 8, 0},
+      {(char *)"score", FLOATS, 4, 0},
+  };
+  ASSERT_EQ(RC::SUCCESS, table_meta.init("t", 3, attributes));
+}
+
+static PartitionMeta range_partition(const TableMeta &table_meta, const char *name, int *bound)
+{
+  PartitionMeta partition;
+  Value value = {INTS, bound, 0};
+  EXPECT_EQ(RC::SUCCESS, partition.init(name, *table_meta.field("id"), bound == nullptr ? nullptr : &value));
+  return partition;
+}
+
+static void init_range_partitions(TableMeta &table_meta)
+{
+  int bounds[] = {10, 20};
+  std::vector<PartitionMeta> partitions = {
+      range_partition(table_meta, "p0", &bounds[0]),
+      range_partition(table_meta, "p1", &bounds[1]),
+      range_partition(table_meta, "pmax", nullptr),
+  };
+  ASSERT_EQ(RC::SUCCESS, table_meta.set_partitions(RANGE_PARTITION, "id", partitions));
+}
+
+/**
+ * 和Table中的记录格式相同，字段之后是null标志
+ */
+static std::vector<char> make_record(const TableMeta &table_meta, const int *id, const char *name)
+{
+  std::vector<char> record(table_meta.record_data_size(), 0);
+  if (id == nullptr)
+  {
+    table_meta.null_flag(table_meta.find_field_index_by_name("id")).set(record.data(), true);
+  }
+  else
+  {
+    memcpy(record.data() + table_meta.field("id")->offset(), id, sizeof(*id));
+  }
+  strncpy(record.data() + table_meta.field("name")->offset(), name, table_meta.field("name")->len());
+  return record;
+}
+
+TEST(PartitionTest, range_route)
+{
+  TableMeta table_meta;
+  init_table_meta(table_meta);
+  init_range_partitions(table_meta);
+  ASSERT_TRUE(table_meta.partitioned());
+  ASSERT_STREQ("id", table_meta.partition_field()->name());
+
+  int ids[] = {-5, 9, 10, 19, 20, 1000};
+  int expected[] = {0, 0, 1, 1, 2, 2};
+  for (int i = 0; i < 6; i++)
+  {
+    std::vector<char> record = make_record(table_meta, &ids[i], "a");
+    ASSERT_EQ(expected[i], table_meta.find_partition(record.data())) << ids[i];
+  }
+  // null放在第一个分区
+  std::vector<char> null_record = make_record(table_meta, nullptr, "a");
+  ASSERT_EQ(0, table_meta.find_partition(null_record.data()));
+
+  // 去掉maxvalue分区之后大的值没有分区
+  ASSERT_EQ(RC::SUCCESS, table_meta.remove_partition("pmax"));
+  std::vector<char> record = make_record(table_meta, &ids[5], "a");
+  ASSERT_EQ(-1, table_meta.find_partition(record.data()));
+  ASSERT_EQ(RC::NOTFOUND, table_meta.remove_partition("pmax"));
+  ASSERT_EQ(RC::SUCCESS, table_meta.remove_partition("p0"));
+  ASSERT_EQ(RC::INVALID_ARGUMENT, table_meta.remove_partition("p1"));
+  ASSERT_EQ(1, table_meta.partition_num());
+}
+
+TEST(PartitionTest, hash_route)
+{
+  TableMeta table_meta;
+  init_table_meta(table_meta);
+  std::vector<PartitionMeta> partitions(4);
+  for (int i = 0; i < 4; i++)
+  {
+    ASSERT_EQ(RC::SUCCESS, partitions[i].init(("p" + std::to_string(i)).c_str(), *table_meta.field("name"), nullptr));
+  }
+  ASSERT_EQ(RC::SUCCESS, table_meta.set_partitions(HASH_PARTITION, "name", partitions));
+
+  std::vector<int> counts(4, 0);
+  int id = 1;
+  for (int i = 0; i < 100; i++)
+  {
+    std::vector<char> record = make_record(table_meta, &id, ("n" + std::to_string(i)).c_str());
+    const int partition = table_meta.find_partition(record.data());
+    ASSERT_GE(partition, 0);
+    ASSERT_LT(partition, 4);
+    counts[partition]++;
+    // 只和字符串的内容有关，和字段中结尾之后的字节无关
+    ASSERT_EQ(PartitionMeta::hash(*table_meta.field("name"), ("n" + std::to_string(i)).c_str()) % 4,
+              (uint32_t)partition);
+  }
+  for (int count : counts)
+  {
+    ASSERT_GT(count, 0);
+  }
+  // hash分区不能删除
+  ASSERT_EQ(RC::INVALID_ARGUMENT, table_meta.remove_partition("p0"));
+}
+
+TEST(PartitionTest, invalid)
+{
+  TableMeta table_meta;
+  init_table_meta(table_meta);
+  int bounds[] = {20, 10};
+  std::vector<PartitionMeta> decreasing = {
+      range_partition(table_meta, "p0", &bounds[0]),
+      range_partition(table_meta, "p1", &bounds[1]),
+  };
+  ASSERT_NE(RC::SUCCESS, table_meta.set_partitions(RANGE_PARTITION, "id", decreasing));
+
+  std::vector<PartitionMeta> max_first = {
+      range_partition(table_meta, "p0", nullptr),
+      range_partition(table_meta, "p1", &bounds[0]),
+  };
+  ASSERT_NE(RC::SUCCESS, table_meta.set_partitions(RANGE_PARTITION, "id", max_first));
+
+  std::vector<PartitionMeta> duplicate = {
+      range_partition(table_meta, "p0", &bounds[1]),
+      range_partition(table_meta, "p0", &bounds[0]),
+  };
+  ASSERT_NE(RC::SUCCESS, table_meta.set_partitions(RANGE_PARTITION, "id", duplicate));
+
+  std::vector<PartitionMeta> hash_bound = {range_partition(table_meta, "p0", &bounds[0])};
+  ASSERT_NE(RC::SUCCESS, table_meta.set_partitions(HASH_PARTITION, "id", hash_bound));
+
+  std::vector<PartitionMeta> hash(2);
+  ASSERT_EQ(RC::SUCCESS, hash[0].init("p0", *table_meta.field("score"), nullptr));
+  ASSERT_EQ(RC::SUCCESS, hash[1].init("p1", *table_meta.field("score"), nullptr));
+  ASSERT_NE(RC::SUCCESS, table_meta.set_partitions(HASH_PARTITION, "score", hash));
+  ASSERT_NE(RC::SUCCESS, table_meta.set_partitions(HASH_PARTITION, "no_field", hash));
+
+  // 上界的类型和字段不同
+  PartitionMeta partition;
+  Value value = {CHARS, (void *)"abc", 0};
+  ASSERT_NE(RC::SUCCESS, partition.init("p0", *table_meta.field("id"), &value));
+  ASSERT_FALSE(table_meta.partitioned());
+}
+
+TEST(PartitionTest, serialize)
+{
+  TableMeta table_meta;
+  init_table_meta(table_meta);
+  init_range_partitions(table_meta);
+
+  std::stringstream ss;
+  ASSERT_GT(table_meta.serialize(ss), 0);
+  TableMeta from_json;
+  ASSERT_GT(from_json.deserialize(ss), 0);
+
+  std::string data;
+  table_meta.serialize_binary(data);
+  TableMeta from_binary;
+  ASSERT_EQ(RC::SUCCESS, from_binary.deserialize_binary(data.data(), (int)data.size()));
+
+  for (const TableMeta *decoded : {&from_json, &from_binary})
+  {
+    ASSERT_EQ(RANGE_PARTITION, decoded->partition_type());
+    ASSERT_STREQ("id", decoded->partition_field()->name());
+    ASSERT_EQ(3, decoded->partition_num());
+    ASSERT_STREQ("p1", decoded->partition(1)->name());
+    ASSERT_EQ(20, *(const int *)decoded->partition(1)->bound());
+    ASSERT_FALSE(decoded->partition(2)->has_bound());
+  }
+
+  // 分区的元数据是不分区的表，名字带上分区名
+  TableMeta partition_meta;
+  table_meta.partition_table_meta(1, partition_meta);
+  ASSERT_STREQ("t.p1", partition_meta.name());
+  ASSERT_FALSE(partition_meta.partitioned());
+  ASSERT_EQ(table_meta.record_size(), partition_meta.record_size());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,108 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the plan cache.
+//
+
+#include "sql/plan_cache/plan_cache.h"
+#include "gtest/gtest.h"
+
+static std::shared_ptr<const CachedPlan> make_plan(const char *db, const char *table)
+{
+  std::shared_ptr<CachedPlan> plan = std::make_shared<CachedPlan>();
+  plan->db = db;
+  plan->tables.push_back(table);
+  return plan;
+}
+
+TEST(PlanCacheTest, normalize)
+{
+  std::string normalized;
+  std::vector<SqlLiteral> literals;
+  ASSERT_TRUE(normalize_sql("  select *  from t1\n where id = 12 and v > -3.5 and name = 'a b';", normalized, literals));
+  ASSERT_EQ("select * from t1 where id = ? and v > ? and name = ?;", normalized);
+  ASSERT_EQ(3, literals.size());
+  ASSERT_EQ(INTS, literals[0].type);
+  ASSERT_EQ("12", literals[0].text);
+  ASSERT_EQ(FLOATS, literals[1].type);
+  ASSERT_EQ("-3.5", literals[1].text);
+  ASSERT_EQ(CHARS, literals[2].type);
+  ASSERT_EQ("'a b'", literals[2].text);
+
+  // 字段名中的数字不是常量，日期按字符串处理
+  ASSERT_TRUE(normalize_sql("insert into t2 values(1,'2021-10-01',null);", normalized, literals));
+  ASSERT_EQ("insert into t2 values(?,?,null);", normalized);
+  ASSERT_EQ(2, literals.size());
+
+  std::vector<ValueBuffer> buffers;
+  std::vector<Value> values;
+  ASSERT_TRUE(literals_to_values(literals, buffers, values));
+  ASSERT_EQ(INTS, values[0].type);
+  ASSERT_EQ(1, *(int *)values[0].data);
+  ASSERT_EQ(DATES, values[1].type);
+
+  // 超出int范围的常量交给parse stage处理
+  ASSERT_TRUE(normalize_sql("select * from t where id = 99999999999;", normalized, literals));
+  ASSERT_FALSE(literals_to_values(literals, buffers, values));
+
+  // 只缓存增删改查，已经有参数或者有多条语句的不缓存
+  ASSERT_FALSE(normalize_sql("create table t(id int);", normalized, literals));
+  ASSERT_FALSE(normalize_sql("selectx * from t;", normalized, literals));
+  ASSERT_FALSE(normalize_sql("select * from t where id = ?;", normalized, literals));
+  ASSERT_FALSE(normalize_sql("select * from t; select * from t;", normalized, literals));
+}
+
+TEST(PlanCacheTest, lru)
+{
+  PlanCache cache(PLAN_CACHE_SHARDS);
+  const int num = PLAN_CACHE_SHARDS * 8;
+  for (int i = 0; i < num; i++) {
+    cache.put("sql" + std::to_string(i), make_plan("sys", "t"), cache.version());
+  }
+  ASSERT_GE(cache.size(), (size_t)1);
+  ASSERT_LE(cache.size(), (size_t)PLAN_CACHE_SHARDS);
+  // 最后放进去的一定还在
+  ASSERT_NE(nullptr, cache.get("sql" + std::to_string(num - 1)));
+
+  cache.set_capacity(0);
+  ASSERT_EQ(0, cache.size());
+  cache.put("sql", make_plan("sys", "t"), cache.version());
+  ASSERT_EQ(nullptr, cache.get("sql"));
+}
+
+TEST(PlanCacheTest, invalidate)
+{
+  PlanCache cache;
+  cache.put("a", make_plan("sys", "t1"), cache.version());
+  cache.put("b", make_plan("sys", "t2"), cache.version());
+  cache.put("c", make_plan("db2", "t1"), cache.version());
+
+  std::shared_ptr<const CachedPlan> plan = cache.get("a");
+  ASSERT_NE(nullptr, plan);
+  cache.invalidate("sys", "t1");
+  ASSERT_EQ(nullptr, cache.get("a"));
+  ASSERT_NE(nullptr, cache.get("b"));
+  ASSERT_NE(nullptr, cache.get("c"));
+  // 已经取出来的计划仍然可以使用
+  ASSERT_EQ("t1", plan->tables[0]);
+
+  // 生成计划期间表发生了变化，不放进缓存
+  uint64_t version = cache.version();
+  cache.invalidate("sys", "t3");
+  cache.put("d", make_plan("sys", "t4"), version);
+  ASSERT_EQ(nullptr, cache.get("d"));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
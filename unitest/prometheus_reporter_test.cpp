@@ -0,0 +1,135 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the prometheus reporter.
+//
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "common/metrics/latency_histogram.h"
+#include "common/metrics/metrics.h"
+#include "common/metrics/prometheus_reporter.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+class TextMetric : public Metric {
+public:
+  TextMetric(const std::string &text)
+  {
+    std::string value = text;
+    snapshot_value_ = new SnapshotBasic<std::string>();
+    ((SnapshotBasic<std::string> *)snapshot_value_)->setValue(value);
+  }
+  ~TextMetric()
+  {
+    delete snapshot_value_;
+  }
+  void snapshot()
+  {}
+};
+
+static bool contains(const std::string &text, const std::string &line)
+{
+  return text.find(line) != std::string::npos;
+}
+
+static std::string http_get(int port, const char *path)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return "";
+  }
+  std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  EXPECT_EQ((ssize_t)request.size(), write(fd, request.data(), request.size()));
+  std::string response;
+  char buf[4096];
+  ssize_t len = 0;
+  while ((len = read(fd, buf, sizeof(buf))) > 0) {
+    response.append(buf, len);
+  }
+  close(fd);
+  return response;
+}
+
+TEST(PrometheusReporterTest, format)
+{
+  PrometheusReporter reporter;
+  TextMetric pool("threads:3,busy_us:919,idle_us:3002660,busy:0.03%");
+  TextMetric queue("5");
+  TextMetric text("hello");
+  reporter.report("seda.SQLThreads.pool", &pool);
+  reporter.report("seda.SQLThreads.ExecuteStage.queue", &queue);
+  reporter.report("text", &text);
+
+  LatencyHistogram histogram;
+  histogram.update(50);
+  histogram.update(2000);
+  histogram.update(2000000);
+  histogram.snapshot();
+  reporter.report("SessionStage.sql", &histogram);
+  histogram.update(300);
+  histogram.snapshot();
+  reporter.report("SessionStage.sql", &histogram);
+
+  std::string text_format = reporter.to_text();
+  ASSERT_TRUE(contains(text_format, "# TYPE miniob_seda_SQLThreads_pool_threads gauge\n"));
+  ASSERT_TRUE(contains(text_format, "miniob_seda_SQLThreads_pool_busy_us 919\n"));
+  ASSERT_TRUE(contains(text_format, "miniob_seda_SQLThreads_pool_busy 0.03\n"));
+  ASSERT_TRUE(contains(text_format, "miniob_seda_SQLThreads_ExecuteStage_queue 5\n"));
+  ASSERT_FALSE(contains(text_format, "hello"));
+
+  // 两次报告的区间累加起来
+  ASSERT_TRUE(contains(text_format, "# TYPE miniob_SessionStage_sql_seconds histogram\n"));
+  ASSERT_TRUE(contains(text_format, "miniob_SessionStage_sql_seconds_bucket{le=\"0.0001\"} 1\n"));
+  ASSERT_TRUE(contains(text_format, "miniob_SessionStage_sql_seconds_bucket{le=\"0.0005\"} 2\n"));
+  ASSERT_TRUE(contains(text_format, "miniob_SessionStage_sql_seconds_bucket{le=\"0.0025\"} 3\n"));
+  ASSERT_TRUE(contains(text_format, "miniob_SessionStage_sql_seconds_bucket{le=\"1\"} 3\n"));
+  ASSERT_TRUE(contains(text_format, "miniob_SessionStage_sql_seconds_bucket{le=\"2.5\"} 4\n"));
+  ASSERT_TRUE(contains(text_format, "miniob_SessionStage_sql_seconds_bucket{le=\"+Inf\"} 4\n"));
+  ASSERT_TRUE(contains(text_format, "miniob_SessionStage_sql_seconds_sum 2.00235\n"));
+  ASSERT_TRUE(contains(text_format, "miniob_SessionStage_sql_seconds_count 4\n"));
+}
+
+TEST(PrometheusReporterTest, http)
+{
+  PrometheusReporter reporter;
+  ASSERT_EQ(0, reporter.start(0));
+  ASSERT_GT(reporter.port(), 0);
+  TextMetric queue("7");
+  reporter.report("stage.queue", &queue);
+
+  std::string response = http_get(reporter.port(), "/metrics");
+  ASSERT_EQ(0u, response.find("HTTP/1.0 200 OK\r\n"));
+  ASSERT_TRUE(contains(response, "\r\n\r\n# TYPE miniob_stage_queue gauge\nminiob_stage_queue 7\n"));
+
+  response = http_get(reporter.port(), "/other");
+  ASSERT_EQ(0u, response.find("HTTP/1.0 404 Not Found\r\n"));
+  reporter.stop();
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,78 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the query result cache.
+//
+
+#include "sql/query_cache/query_cache.h"
+#include "gtest/gtest.h"
+
+static std::shared_ptr<const CachedResult> make_result(size_t response_len)
+{
+  std::shared_ptr<CachedResult> result = std::make_shared<CachedResult>();
+  result->response.assign(response_len, 'x');
+  result->db = "sys";
+  return result;
+}
+
+TEST(QueryCacheTest, lru)
+{
+  QueryCache query_cache(1024 * 1024);
+  query_cache.put("a", make_result(10 * 1024));
+  query_cache.put("b", make_result(10 * 1024));
+  ASSERT_EQ(2, query_cache.size());
+  ASSERT_NE(nullptr, query_cache.get("a"));
+  ASSERT_EQ(nullptr, query_cache.get("c"));
+
+  // 容量按字节计算，缩小之后淘汰最久没有使用的b
+  size_t bytes = query_cache.bytes();
+  query_cache.set_capacity(bytes - 1);
+  ASSERT_EQ(1, query_cache.size());
+  ASSERT_NE(nullptr, query_cache.get("a"));
+  ASSERT_EQ(nullptr, query_cache.get("b"));
+
+  // 同一个key放入新的结果时替换原来的
+  query_cache.set_capacity(1024 * 1024);
+  query_cache.put("a", make_result(20 * 1024));
+  ASSERT_EQ(1, query_cache.size());
+  ASSERT_EQ(20 * 1024, query_cache.get("a")->response.size());
+
+  query_cache.remove("a");
+  ASSERT_EQ(0, query_cache.size());
+  ASSERT_EQ(0, query_cache.bytes());
+}
+
+TEST(QueryCacheTest, large_result)
+{
+  QueryCache query_cache(1024 * 1024);
+  // 超过容量1/8的结果不缓存
+  query_cache.put("large", make_result(200 * 1024));
+  ASSERT_EQ(0, query_cache.size());
+
+  std::shared_ptr<const CachedResult> result = make_result(100 * 1024);
+  query_cache.put("a", result);
+  ASSERT_EQ(1, query_cache.size());
+
+  // 淘汰之后外面持有的结果仍然可以使用
+  query_cache.clear();
+  ASSERT_EQ(nullptr, query_cache.get("a"));
+  ASSERT_EQ(100 * 1024, result->response.size());
+
+  query_cache.set_capacity(0);
+  query_cache.put("a", result);
+  ASSERT_EQ(0, query_cache.size());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,94 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the cancellation of running statements.
+//
+
+#include "session/query_cancel.h"
+#include "gtest/gtest.h"
+
+TEST(QueryCancelTest, cancel)
+{
+  QueryCancel cancel;
+  // 没有语句在执行时不能取消
+  ASSERT_FALSE(cancel.cancel(QueryCancel::Reason::KILLED));
+  ASSERT_FALSE(cancel.cancelled());
+
+  cancel.begin();
+  ASSERT_TRUE(cancel.cancel(QueryCancel::Reason::KILLED));
+  ASSERT_TRUE(cancel.cancelled());
+  ASSERT_EQ(QueryCancel::Reason::KILLED, cancel.reason());
+  cancel.end();
+
+  // 下一条语句清除之前的标记
+  cancel.begin();
+  ASSERT_FALSE(cancel.cancelled());
+  cancel.end();
+}
+
+TEST(QueryCancelTest, timeout_of_finished_statement)
+{
+  QueryCancel cancel;
+  const uint64_t first = cancel.begin();
+  cancel.end();
+  const uint64_t second = cancel.begin();
+  ASSERT_NE(first, second);
+
+  // 第一条语句的定时器到期时不能取消第二条语句
+  ASSERT_FALSE(cancel.cancel(first, QueryCancel::Reason::TIMEOUT));
+  ASSERT_FALSE(cancel.cancelled());
+  ASSERT_TRUE(cancel.cancel(second, QueryCancel::Reason::TIMEOUT));
+  ASSERT_EQ(QueryCancel::Reason::TIMEOUT, cancel.reason());
+  cancel.end();
+  ASSERT_FALSE(cancel.cancel(second, QueryCancel::Reason::TIMEOUT));
+}
+
+TEST(QueryCancelTest, poll)
+{
+  QueryCancel cancel;
+  cancel.begin();
+  unsigned int counter = 0;
+  ASSERT_FALSE(QueryCancel::poll(counter));
+
+  QueryCancelScope scope(&cancel);
+  cancel.cancel(QueryCancel::Reason::KILLED);
+  ASSERT_TRUE(QueryCancel::current_cancelled());
+  // 每QUERY_CANCEL_CHECK_INTERVAL次才检查一次
+  int polls = 0;
+  counter = 0;
+  while (!QueryCancel::poll(counter)) {
+    polls++;
+  }
+  ASSERT_EQ(QUERY_CANCEL_CHECK_INTERVAL - 1, polls);
+  cancel.end();
+}
+
+TEST(QueryCancelTest, scope)
+{
+  QueryCancel outer;
+  QueryCancel inner;
+  ASSERT_EQ(nullptr, QueryCancel::current());
+  {
+    QueryCancelScope outer_scope(&outer);
+    {
+      QueryCancelScope inner_scope(&inner);
+      ASSERT_EQ(&inner, QueryCancel::current());
+    }
+    ASSERT_EQ(&outer, QueryCancel::current());
+  }
+  ASSERT_EQ(nullptr, QueryCancel::current());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
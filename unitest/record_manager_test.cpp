@@ -0,0 +1,588 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for record manager.
+//
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "storage/common/record_manager.h"
+#include "gtest/gtest.h"
+
+static const int RECORD_SIZE = 100;
+
+static int count_records(DiskBufferPool &pool, int file_id)
+{
+  RecordFileScanner scanner;
+  scanner.open_scan(pool, file_id, nullptr);
+  int count = 0;
+  Record record;
+  RC rc = scanner.get_first_record(&record);
+  while (rc == RC::SUCCESS) {
+    count++;
+    rc = scanner.get_next_record(&record);
+  }
+  scanner.close_scan();
+  return count;
+}
+
+TEST(test_record_manager, test_free_space_map) {
+  const char *file_name = "record_fsm_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(16);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+
+  std::vector<RID> rids;
+  char data[RECORD_SIZE];
+  {
+    RecordFileHandler handler;
+    ASSERT_EQ(RC::SUCCESS, handler.init(pool, file_id));
+    for (int i = 0; i < 400; i++) {
+      memset(data, i % 128, sizeof(data));
+      RID rid;
+      ASSERT_EQ(RC::SUCCESS, handler.insert_record(data, RECORD_SIZE, &rid));
+      // 第1页是空闲空间表页
+      ASSERT_GT(rid.page_num, 1);
+      rids.push_back(rid);
+    }
+    ASSERT_EQ(400, count_records(pool, file_id));
+
+    // 删除之后空出来的slot会被再次使用
+    ASSERT_EQ(RC::SUCCESS, handler.delete_record(&rids[3]));
+    RID rid;
+    ASSERT_EQ(RC::SUCCESS, handler.insert_record(data, RECORD_SIZE, &rid));
+    ASSERT_EQ(rids[3].page_num, rid.page_num);
+    ASSERT_EQ(rids[3].slot_num, rid.slot_num);
+
+    ASSERT_EQ(RC::SUCCESS, handler.delete_record(&rids[10]));
+    handler.close();
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+
+  // 重新打开文件，空闲空间表从文件中读取
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  {
+    RecordFileHandler handler;
+    ASSERT_EQ(RC::SUCCESS, handler.init(pool, file_id));
+    ASSERT_EQ(399, count_records(pool, file_id));
+    RID rid;
+    ASSERT_EQ(RC::SUCCESS, handler.insert_record(data, RECORD_SIZE, &rid));
+    ASSERT_EQ(rids[10].page_num, rid.page_num);
+    ASSERT_EQ(rids[10].slot_num, rid.slot_num);
+    handler.close();
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+TEST(test_record_manager, test_legacy_file_without_free_space_map) {
+  const char *file_name = "record_legacy_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(16);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+
+  // 旧版本的文件第1页就是记录页
+  char data[RECORD_SIZE];
+  memset(data, 'a', sizeof(data));
+  RID first_rid;
+  {
+    BPPageHandle page_handle;
+    ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+    ASSERT_EQ(1, page_handle.frame->page->page_num);
+    RecordPageHandler page_handler;
+    ASSERT_EQ(RC::SUCCESS, page_handler.init_empty_page(pool, file_id, 1, RECORD_SIZE));
+    ASSERT_EQ(RC::SUCCESS, page_handler.insert_record(data, &first_rid));
+    ASSERT_EQ(RC::SUCCESS, page_handler.insert_record(data, nullptr));
+    pool.unpin_page(&page_handle);
+  }
+
+  RecordFileHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.init(pool, file_id));
+  RID rid;
+  ASSERT_EQ(RC::SUCCESS, handler.insert_record(data, RECORD_SIZE, &rid));
+  ASSERT_EQ(1, rid.page_num);
+  ASSERT_EQ(3, count_records(pool, file_id));
+
+  ASSERT_EQ(RC::SUCCESS, handler.delete_record(&first_rid));
+  ASSERT_EQ(RC::SUCCESS, handler.insert_record(data, RECORD_SIZE, &rid));
+  ASSERT_EQ(first_rid.page_num, rid.page_num);
+  ASSERT_EQ(first_rid.slot_num, rid.slot_num);
+  handler.close();
+
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+TEST(test_record_manager, test_insert_records) {
+  const char *file_name = "record_batch_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(16);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+
+  RecordFileHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.init(pool, file_id));
+
+  // 一批记录跨越多个页面，每个页面上的slot数超过64个
+  const int record_size = 20;
+  const int row_num = 1000;
+  static char data[row_num][record_size];
+  const char *rows[row_num];
+  RID rids[row_num];
+  for (int i = 0; i < row_num; i++) {
+    snprintf(data[i], record_size, "row-%d", i);
+    rows[i] = data[i];
+  }
+  ASSERT_EQ(RC::SUCCESS, handler.insert_records(rows, row_num, record_size, rids));
+  ASSERT_EQ(row_num, count_records(pool, file_id));
+
+  for (int i = 0; i < row_num; i++) {
+    ASSERT_GT(rids[i].page_num, 1);
+    if (i > 0) {
+      ASSERT_TRUE(rids[i].page_num != rids[i - 1].page_num || rids[i].slot_num != rids[i - 1].slot_num);
+    }
+    Record record;
+    ASSERT_EQ(RC::SUCCESS, handler.get_record(&rids[i], &record));
+    ASSERT_EQ(0, memcmp(data[i], record.data, record_size));
+  }
+
+  // 删除的slot在下一批插入时被重新使用
+  ASSERT_EQ(RC::SUCCESS, handler.delete_record(&rids[5]));
+  RID rid;
+  ASSERT_EQ(RC::SUCCESS, handler.insert_records(rows, 1, record_size, &rid));
+  ASSERT_EQ(rids[5].page_num, rid.page_num);
+  ASSERT_EQ(rids[5].slot_num, rid.slot_num);
+  handler.close();
+
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+static RC visit_and_delete_even(Record *record, void *context)
+{
+  RecordFileHandler *handler = (RecordFileHandler *)context;
+  int value = 0;
+  memcpy(&value, record->data, sizeof(value));
+  if (value % 2 == 0) {
+    // 访问记录时可以删除当前的记录
+    return handler->delete_record(&record->rid);
+  }
+  return RC::SUCCESS;
+}
+
+static RC visit_and_count(Record *record, void *context)
+{
+  (*(int *)context)++;
+  return RC::SUCCESS;
+}
+
+TEST(test_record_manager, test_visit_records) {
+  const char *file_name = "record_visit_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(16);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+
+  RecordFileHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.init(pool, file_id));
+  char data[RECORD_SIZE];
+  memset(data, 0, sizeof(data));
+  for (int i = 0; i < 500; i++) {
+    memcpy(data, &i, sizeof(i));
+    ASSERT_EQ(RC::SUCCESS, handler.insert_record(data, RECORD_SIZE, nullptr));
+  }
+
+  RecordFileScanner scanner;
+  ASSERT_EQ(RC::SUCCESS, scanner.open_scan(pool, file_id, nullptr));
+  ASSERT_EQ(RC::SUCCESS, scanner.visit_records(visit_and_delete_even, &handler));
+  int count = 0;
+  ASSERT_EQ(RC::SUCCESS, scanner.visit_records(visit_and_count, &count));
+  ASSERT_EQ(250, count);
+
+  // 分页面访问，每次只访问一个有记录的页面，所有页面访问完之后返回RECORD_EOF
+  ASSERT_EQ(RC::SUCCESS, scanner.open_scan(pool, file_id, nullptr));
+  count = 0;
+  int page_visits = 0;
+  RC rc = RC::SUCCESS;
+  while ((rc = scanner.visit_next_page(visit_and_count, &count)) == RC::SUCCESS) {
+    page_visits++;
+  }
+  ASSERT_EQ(RC::RECORD_EOF, rc);
+  ASSERT_EQ(RC::RECORD_EOF, scanner.visit_next_page(visit_and_count, &count));
+  ASSERT_GT(page_visits, 1);
+  scanner.close_scan();
+  ASSERT_EQ(250, count);
+  ASSERT_EQ(250, count_records(pool, file_id));
+
+  handler.close();
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+struct MorselScanTask {
+  DiskBufferPool *pool;
+  int file_id;
+  PageMorsels *morsels;
+  std::vector<int> values;
+};
+
+static RC visit_and_collect(Record *record, void *context)
+{
+  int value = 0;
+  memcpy(&value, record->data, sizeof(value));
+  ((MorselScanTask *)context)->values.push_back(value);
+  return RC::SUCCESS;
+}
+
+static void *morsel_scan_routine(void *arg)
+{
+  MorselScanTask *task = (MorselScanTask *)arg;
+  RecordFileScanner scanner;
+  scanner.open_scan(*task->pool, task->file_id, nullptr);
+  scanner.set_morsels(task->morsels);
+  while (scanner.visit_next_page(visit_and_collect, task) == RC::SUCCESS) {
+  }
+  scanner.close_scan();
+  return nullptr;
+}
+
+TEST(test_record_manager, test_morsel_scan) {
+  const char *file_name = "record_morsel_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(16);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+
+  RecordFileHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.init(pool, file_id));
+  char data[RECORD_SIZE];
+  memset(data, 0, sizeof(data));
+  const int record_num = 3000;
+  for (int i = 0; i < record_num; i++) {
+    memcpy(data, &i, sizeof(i));
+    ASSERT_EQ(RC::SUCCESS, handler.insert_record(data, RECORD_SIZE, nullptr));
+  }
+
+  // 几个线程共享页面分配器，每条记录正好被一个线程访问到
+  const int thread_num = 4;
+  PageMorsels morsels;
+  std::vector<MorselScanTask> tasks(thread_num, MorselScanTask{&pool, file_id, &morsels, {}});
+  std::vector<pthread_t> threads(thread_num);
+  for (int i = 0; i < thread_num; i++) {
+    ASSERT_EQ(0, pthread_create(&threads[i], nullptr, morsel_scan_routine, &tasks[i]));
+  }
+  std::vector<int> values;
+  for (int i = 0; i < thread_num; i++) {
+    pthread_join(threads[i], nullptr);
+    values.insert(values.end(), tasks[i].values.begin(), tasks[i].values.end());
+  }
+  std::sort(values.begin(), values.end());
+  ASSERT_EQ(record_num, (int)values.size());
+  for (int i = 0; i < record_num; i++) {
+    ASSERT_EQ(i, values[i]);
+  }
+
+  handler.close();
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+static void make_var_record(std::vector<char> &data, int i, int len)
+{
+  data.resize(len);
+  for (int j = 0; j < len; j++) {
+    data[j] = (char)('a' + (i + j) % 26);
+  }
+}
+
+static void check_var_record(RecordFileHandler &handler, const RID &rid, int i, int len)
+{
+  std::vector<char> expect;
+  make_var_record(expect, i, len);
+  std::vector<char> data;
+  ASSERT_EQ(RC::SUCCESS, handler.get_record(&rid, data));
+  ASSERT_EQ(expect, data);
+}
+
+TEST(test_record_manager, test_variable_length_records) {
+  const char *file_name = "record_var_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(16);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+
+  // 长度不同的记录，最后两条超过页面的1/4，需要溢出页，其中一条跨越多个溢出页
+  const int row_num = 302;
+  std::vector<int> lengths;
+  for (int i = 0; i < row_num - 2; i++) {
+    lengths.push_back(8 + i % 50);
+  }
+  lengths.push_back(1500);
+  lengths.push_back(20000);
+
+  std::vector<RID> rids(row_num);
+  std::vector<char> data;
+  {
+    RecordFileHandler handler;
+    ASSERT_EQ(RC::SUCCESS, handler.init(pool, file_id, true));
+    ASSERT_TRUE(handler.variable_length());
+    for (int i = 0; i < row_num; i++) {
+      make_var_record(data, i, lengths[i]);
+      ASSERT_EQ(RC::SUCCESS, handler.insert_record(data.data(), lengths[i], &rids[i]));
+      ASSERT_GT(rids[i].page_num, 1);
+    }
+    for (int i = 0; i < row_num; i++) {
+      check_var_record(handler, rids[i], i, lengths[i]);
+    }
+    // 扫描时跳过溢出页，有溢出页的记录拼接成完整的记录
+    ASSERT_EQ(row_num, count_records(pool, file_id));
+
+    // 变长、缩短、变成溢出记录和从溢出记录变回来，rid都不变
+    const int new_lengths[] = {900, 4, 9000, 30};
+    for (int k = 0; k < 4; k++) {
+      const int i = k * 10;
+      lengths[i] = new_lengths[k];
+      make_var_record(data, i, lengths[i]);
+      ASSERT_EQ(RC::SUCCESS, handler.update_record(&rids[i], data.data(), lengths[i]));
+    }
+    lengths[row_num - 1] = 100;
+    make_var_record(data, row_num - 1, lengths[row_num - 1]);
+    ASSERT_EQ(RC::SUCCESS, handler.update_record(&rids[row_num - 1], data.data(), lengths[row_num - 1]));
+    for (int i = 0; i < row_num; i++) {
+      check_var_record(handler, rids[i], i, lengths[i]);
+    }
+
+    // 页面上空出来的空间能放下最长的记录之后被再次使用
+    ASSERT_EQ(RC::SUCCESS, handler.delete_record(&rids[row_num - 2]));
+    int deleted_size = 0;
+    for (int i = 20; deleted_size < 2048 && rids[i].page_num == rids[20].page_num; i++) {
+      ASSERT_EQ(RC::SUCCESS, handler.delete_record(&rids[i]));
+      deleted_size += std::min(lengths[i], 100);
+      lengths[i] = -1;
+    }
+    lengths[20] = 50;
+    make_var_record(data, 20, lengths[20]);
+    RID rid;
+    ASSERT_EQ(RC::SUCCESS, handler.insert_record(data.data(), lengths[20], &rid));
+    ASSERT_EQ(rids[20].page_num, rid.page_num);
+    ASSERT_EQ(rids[20].slot_num, rid.slot_num);
+    handler.close();
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+
+  // 重新打开时从空闲空间表页中读到记录格式
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  {
+    RecordFileHandler handler;
+    ASSERT_EQ(RC::SUCCESS, handler.init(pool, file_id));
+    ASSERT_TRUE(handler.variable_length());
+    int count = 0;
+    for (int i = 0; i < row_num; i++) {
+      if (i != row_num - 2 && lengths[i] >= 0) {
+        check_var_record(handler, rids[i], i, lengths[i]);
+        count++;
+      }
+    }
+    ASSERT_EQ(count, count_records(pool, file_id));
+    handler.close();
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+struct PaxRow {
+  int id;
+  char name[12];
+  double score;
+};
+
+static RC visit_and_sum_score(Record *record, void *context)
+{
+  PaxRow *row = (PaxRow *)record->data;
+  *(double *)context += row->score;
+  return RC::SUCCESS;
+}
+
+TEST(test_record_manager, test_pax_records) {
+  const char *file_name = "record_pax_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(16);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+
+  const std::vector<int> columns = {(int)sizeof(int), 12, (int)sizeof(double)};
+  const int row_num = 1000;
+  RID rids[row_num];
+  double total = 0;
+  {
+    RecordFileHandler handler;
+    ASSERT_EQ(RC::SUCCESS, handler.init(pool, file_id, columns));
+    ASSERT_TRUE(handler.pax());
+    for (int i = 0; i < row_num; i++) {
+      PaxRow row;
+      row.id = i;
+      snprintf(row.name, sizeof(row.name), "name-%d", i);
+      row.score = i * 0.5;
+      total += row.score;
+      ASSERT_EQ(RC::SUCCESS, handler.insert_record((const char *)&row, sizeof(row), &rids[i]));
+    }
+
+    PaxRow row;
+    row.id = 7;
+    snprintf(row.name, sizeof(row.name), "changed");
+    row.score = 100;
+    Record record;
+    record.rid = rids[7];
+    record.data = (char *)&row;
+    ASSERT_EQ(RC::SUCCESS, handler.update_record(&record));
+    total += 100 - 7 * 0.5;
+    handler.close();
+  }
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+
+  // 重新打开文件时从空闲空间表页中读取格式
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  RecordFileHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.init(pool, file_id));
+  ASSERT_TRUE(handler.pax());
+  ASSERT_FALSE(handler.variable_length());
+  for (int i = 0; i < row_num; i++) {
+    Record record;
+    ASSERT_EQ(RC::SUCCESS, handler.get_record(&rids[i], &record));
+    const PaxRow *row = (const PaxRow *)record.data;
+    ASSERT_EQ(i, row->id);
+    if (i == 7) {
+      ASSERT_STREQ("changed", row->name);
+    } else {
+      char name[12];
+      snprintf(name, sizeof(name), "name-%d", i);
+      ASSERT_STREQ(name, row->name);
+    }
+  }
+  ASSERT_EQ(row_num, count_records(pool, file_id));
+
+  // 只读取score列
+  RecordFileScanner scanner;
+  ASSERT_EQ(RC::SUCCESS, scanner.open_scan(pool, file_id, nullptr));
+  scanner.set_columns({2});
+  double sum = 0;
+  ASSERT_EQ(RC::SUCCESS, scanner.visit_records(visit_and_sum_score, &sum));
+  scanner.close_scan();
+  ASSERT_DOUBLE_EQ(total, sum);
+
+  ASSERT_EQ(RC::SUCCESS, handler.delete_record(&rids[0]));
+  ASSERT_EQ(row_num - 1, count_records(pool, file_id));
+  handler.close();
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+TEST(test_record_manager, test_compact_records) {
+  const char *file_name = "record_compact_test.data";
+  unlink(file_name);
+
+  DiskBufferPool pool(16);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+
+  RecordFileHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.init(pool, file_id));
+
+  const int record_size = 20;
+  const int row_num = 1000;
+  static char data[row_num][record_size];
+  const char *rows[row_num];
+  RID rids[row_num];
+  for (int i = 0; i < row_num; i++) {
+    snprintf(data[i], record_size, "row-%d", i);
+    rows[i] = data[i];
+  }
+  ASSERT_EQ(RC::SUCCESS, handler.insert_records(rows, row_num, record_size, rids));
+
+  // 只保留二十分之一的记录，每个页面都变得很稀疏
+  for (int i = 0; i < row_num; i++) {
+    if (i % 20 != 0) {
+      ASSERT_EQ(RC::SUCCESS, handler.delete_record(&rids[i]));
+    }
+  }
+  int old_page_count = 0;
+  ASSERT_EQ(RC::SUCCESS, pool.get_page_count(file_id, &old_page_count));
+  ASSERT_GT(old_page_count, 4);
+
+  // 从后往前把稀疏页面上的记录搬走，直到前面的页面放不下为止
+  PageNum before = BP_INVALID_PAGE_NUM;
+  PageNum page_num = BP_INVALID_PAGE_NUM;
+  RC rc = RC::SUCCESS;
+  while (rc == RC::SUCCESS && handler.find_sparse_page(before, 25, &page_num) == RC::SUCCESS) {
+    before = page_num;
+    std::vector<RID> page_rids;
+    ASSERT_EQ(RC::SUCCESS, handler.get_page_rids(page_num, page_rids));
+    for (const RID &rid : page_rids) {
+      RID new_rid;
+      rc = handler.move_record(&rid, &new_rid);
+      if (rc != RC::SUCCESS) {
+        ASSERT_EQ(RC::RECORD_NOMEM, rc);
+        break;
+      }
+      ASSERT_LT(new_rid.page_num, rid.page_num);
+      for (int i = 0; i < row_num; i += 20) {
+        if (rids[i].page_num == rid.page_num && rids[i].slot_num == rid.slot_num) {
+          rids[i] = new_rid;
+        }
+      }
+    }
+  }
+
+  // 所有记录都集中到了第一个记录页中，后面的页面被释放，文件也变短了
+  for (int i = 0; i < row_num; i += 20) {
+    Record record;
+    ASSERT_EQ(RC::SUCCESS, handler.get_record(&rids[i], &record));
+    ASSERT_EQ(0, memcmp(data[i], record.data, record_size));
+    ASSERT_EQ(rids[0].page_num, rids[i].page_num);
+  }
+  ASSERT_EQ(row_num / 20, count_records(pool, file_id));
+  int new_page_count = 0;
+  ASSERT_EQ(RC::SUCCESS, pool.get_page_count(file_id, &new_page_count));
+  ASSERT_LT(new_page_count, old_page_count);
+  ASSERT_EQ(rids[0].page_num + 1, new_page_count);
+  handler.close();
+
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  unlink(file_name);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
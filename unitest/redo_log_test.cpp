@@ -0,0 +1,238 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the redo log.
+//
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "storage/default/disk_buffer_pool.h"
+#include "storage/default/redo_log.h"
+#include "gtest/gtest.h"
+
+static const char *REDO_DIR = "redo_log_test_dir";
+
+TEST(RedoLogTest, group_commit)
+{
+  system((std::string("rm -rf ") + REDO_DIR).c_str());
+  RedoLog &redo_log = RedoLog::instance();
+  ASSERT_EQ(RC::SUCCESS, redo_log.open(REDO_DIR));
+  ASSERT_TRUE(redo_log.enabled());
+
+  // 每个线程追加之后都等待落盘，同时等待的线程共用一次fdatasync
+  const int thread_num = 8;
+  const int commit_num = 50;
+  long sync_count = redo_log.sync_count();
+  std::vector<std::thread> threads;
+  std::vector<RC> results(thread_num, RC::SUCCESS);
+  for (int t = 0; t < thread_num; t++) {
+    threads.emplace_back([t, &redo_log, &results]() {
+      char page[BP_PAGE_SIZE];
+      memset(page, 'a' + t, sizeof(page));
+      for (int i = 0; i < commit_num; i++) {
+        uint64_t lsn = redo_log.append_page("group_commit.data", i, page, sizeof(page));
+        RC rc = redo_log.flush(lsn);
+        if (rc != RC::SUCCESS || redo_log.durable_lsn() < lsn) {
+          results[t] = RC::GENERIC_ERROR;
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (RC rc : results) {
+    ASSERT_EQ(RC::SUCCESS, rc);
+  }
+  ASSERT_EQ(redo_log.current_lsn(), redo_log.durable_lsn());
+  ASSERT_LE(redo_log.sync_count() - sync_count, thread_num * commit_num);
+  redo_log.close();
+  ASSERT_FALSE(redo_log.enabled());
+}
+
+TEST(RedoLogTest, recover)
+{
+  system((std::string("rm -rf ") + REDO_DIR).c_str());
+  const char *file_name = "redo_log_test.data";
+  unlink(file_name);
+  RedoLog &redo_log = RedoLog::instance();
+  ASSERT_EQ(RC::SUCCESS, redo_log.open(REDO_DIR));
+
+  DiskBufferPool pool(64);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  int file_id = -1;
+  ASSERT_EQ(RC::SUCCESS, pool.open_file(file_name, &file_id));
+  BPPageHandle page_handle;
+  ASSERT_EQ(RC::SUCCESS, pool.allocate_page(file_id, &page_handle));
+  char *data = nullptr;
+  ASSERT_EQ(RC::SUCCESS, pool.get_data(&page_handle, &data));
+  memset(data, 'x', pool.page_data_size());
+  ASSERT_EQ(RC::SUCCESS, pool.mark_dirty(&page_handle));
+  ASSERT_EQ(RC::SUCCESS, pool.unpin_page(&page_handle));
+
+  // 提交时页面写到日志中，数据文件中的页面之后被破坏了，恢复时用日志中的内容覆盖
+  pool.log_pages(false);
+  ASSERT_EQ(RC::SUCCESS, redo_log.flush(redo_log.current_lsn()));
+  ASSERT_EQ(RC::SUCCESS, pool.close_file(file_id));
+  int fd = open(file_name, O_RDWR);
+  ASSERT_GE(fd, 0);
+  std::vector<char> page(BP_PAGE_SIZE, 'z');
+  ASSERT_EQ(BP_PAGE_SIZE, pwrite(fd, page.data(), BP_PAGE_SIZE, BP_PAGE_SIZE));
+
+  ASSERT_EQ(RC::SUCCESS, RedoLog::recover(REDO_DIR));
+  ASSERT_EQ(BP_PAGE_SIZE, pread(fd, page.data(), BP_PAGE_SIZE, BP_PAGE_SIZE));
+  ASSERT_EQ(page_checksum(1, (Page *)page.data(), BP_PAGE_SIZE), *(PageNum *)page.data());
+  ASSERT_EQ('x', page[sizeof(PageNum)]);
+  ASSERT_EQ('x', page[BP_PAGE_SIZE - 1]);
+  close(fd);
+
+  // 文件重新创建之后，以前的页面不会再写到新文件中
+  unlink(file_name);
+  ASSERT_EQ(RC::SUCCESS, pool.create_file(file_name));
+  ASSERT_EQ(RC::SUCCESS, RedoLog::recover(REDO_DIR));
+  struct stat st;
+  ASSERT_EQ(0, stat(file_name, &st));
+  ASSERT_EQ(BP_PAGE_SIZE, st.st_size);
+
+  redo_log.close();
+  unlink(file_name);
+  system((std::string("rm -rf ") + REDO_DIR).c_str());
+}
+
+TEST(RedoLogTest, async_commit)
+{
+  system((std::string("rm -rf ") + REDO_DIR).c_str());
+  RedoLog &redo_log = RedoLog::instance();
+  ASSERT_EQ(RC::SUCCESS, redo_log.open(REDO_DIR));
+  redo_log.set_async_commit_lag(20);
+
+  // 异步提交立即返回，后台线程在延迟之内让日志落盘
+  uint64_t lsn = redo_log.append_commit(5);
+  redo_log.flush_async(lsn);
+  for (int i = 0; i < 1000 && redo_log.durable_lsn() < lsn; i++) {
+    usleep(1000);
+  }
+  ASSERT_LE(lsn, redo_log.durable_lsn());
+  redo_log.end_commit(5);
+
+  // 关闭时还没有落盘的异步提交也会写到磁盘上
+  redo_log.set_async_commit_lag(60000);
+  lsn = redo_log.append_commit(6);
+  redo_log.flush_async(lsn);
+  redo_log.close();
+  std::set<int64_t> committed;
+  ASSERT_EQ(RC::SUCCESS, RedoLog::recover(REDO_DIR, &committed));
+  ASSERT_EQ(1, (int)committed.count(6));
+  redo_log.set_async_commit_lag(REDO_LOG_DEFAULT_ASYNC_COMMIT_LAG);
+}
+
+TEST(RedoLogTest, commit_records)
+{
+  system((std::string("rm -rf ") + REDO_DIR).c_str());
+  RedoLog &redo_log = RedoLog::instance();
+  ASSERT_EQ(RC::SUCCESS, redo_log.open(REDO_DIR));
+  ASSERT_FALSE(redo_log.recovering());
+
+  // 事务号是64位的
+  const int64_t wide_trx_id = (1LL << 40) + 9;
+  ASSERT_EQ(RC::SUCCESS, redo_log.flush(redo_log.append_commit(7)));
+  redo_log.end_commit(7);
+  ASSERT_EQ(RC::SUCCESS, redo_log.flush(redo_log.append_commit(wide_trx_id)));
+  std::set<int64_t> committed;
+  ASSERT_EQ(RC::SUCCESS, RedoLog::recover(REDO_DIR, &committed));
+  ASSERT_EQ(2, (int)committed.size());
+
+  // checkpoint之后只有还没有完成提交的事务留在日志中
+  ASSERT_EQ(RC::SUCCESS, redo_log.checkpoint());
+  committed.clear();
+  ASSERT_EQ(RC::SUCCESS, RedoLog::recover(REDO_DIR, &committed));
+  ASSERT_EQ(1, (int)committed.size());
+  ASSERT_EQ(1, (int)committed.count(wide_trx_id));
+
+  // 重新打开时恢复已经提交的事务，finish_recovery之前一直保留
+  redo_log.close();
+  ASSERT_EQ(RC::SUCCESS, redo_log.open(REDO_DIR));
+  ASSERT_TRUE(redo_log.recovering());
+  ASSERT_TRUE(redo_log.recovered_committed(wide_trx_id));
+  ASSERT_FALSE(redo_log.recovered_committed(7));
+  ASSERT_EQ(RC::SUCCESS, redo_log.checkpoint());
+  committed.clear();
+  ASSERT_EQ(RC::SUCCESS, RedoLog::recover(REDO_DIR, &committed));
+  ASSERT_EQ(1, (int)committed.count(wide_trx_id));
+
+  ASSERT_EQ(RC::SUCCESS, redo_log.finish_recovery());
+  ASSERT_FALSE(redo_log.recovering());
+  committed.clear();
+  ASSERT_EQ(RC::SUCCESS, RedoLog::recover(REDO_DIR, &committed));
+  ASSERT_TRUE(committed.empty());
+  redo_log.close();
+  system((std::string("rm -rf ") + REDO_DIR).c_str());
+}
+
+TEST(RedoLogTest, undo_records)
+{
+  system((std::string("rm -rf ") + REDO_DIR).c_str());
+  RedoLog &redo_log = RedoLog::instance();
+  ASSERT_EQ(RC::SUCCESS, redo_log.open(REDO_DIR));
+
+  const std::string before(16, 'b');
+  redo_log.append_undo(3, "t", 1, 2, before.data(), (int)before.size());
+  redo_log.append_undo(4, "t", 1, 3, before.data(), (int)before.size());
+  redo_log.end_undo(4);
+  ASSERT_EQ(RC::SUCCESS, redo_log.flush(redo_log.append_commit(4)));
+
+  // 已经提交的事务不需要修改之前的内容
+  RedoUndoImages images;
+  ASSERT_EQ(RC::SUCCESS, RedoLog::recover(REDO_DIR, nullptr, &images));
+  ASSERT_EQ(1, (int)images.size());
+  ASSERT_EQ(before, images[std::make_tuple(std::string("t"), (int64_t)3, 1, 2)]);
+
+  // 没有结束的事务修改之前的内容在checkpoint之后仍然留在日志中
+  ASSERT_EQ(RC::SUCCESS, redo_log.checkpoint());
+  images.clear();
+  ASSERT_EQ(RC::SUCCESS, RedoLog::recover(REDO_DIR, nullptr, &images));
+  ASSERT_EQ(1, (int)images.size());
+
+  redo_log.close();
+  ASSERT_EQ(RC::SUCCESS, redo_log.open(REDO_DIR));
+  ASSERT_TRUE(redo_log.recovering());
+  const std::string *undo = redo_log.recovered_undo("t", 3, 1, 2);
+  ASSERT_NE(nullptr, undo);
+  ASSERT_EQ(before, *undo);
+  ASSERT_EQ(nullptr, redo_log.recovered_undo("t", 4, 1, 3));
+  ASSERT_EQ(nullptr, redo_log.recovered_undo("t", 3, 1, 3));
+  // 恢复过程中再次崩溃也能回滚
+  images.clear();
+  ASSERT_EQ(RC::SUCCESS, RedoLog::recover(REDO_DIR, nullptr, &images));
+  ASSERT_EQ(1, (int)images.size());
+
+  ASSERT_EQ(RC::SUCCESS, redo_log.finish_recovery());
+  ASSERT_EQ(nullptr, redo_log.recovered_undo("t", 3, 1, 2));
+  images.clear();
+  ASSERT_EQ(RC::SUCCESS, RedoLog::recover(REDO_DIR, nullptr, &images));
+  ASSERT_TRUE(images.empty());
+  redo_log.close();
+  system((std::string("rm -rf ") + REDO_DIR).c_str());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,145 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for read replicas fed by the redo log.
+//
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "storage/default/redo_log.h"
+#include "storage/default/replication.h"
+#include "gtest/gtest.h"
+
+static const char *REDO_DIR = "replication_test_redo";
+static const char *PRIMARY_DIR = "replication_test_primary/";
+static const char *REPLICA_DIR = "replication_test_replica/";
+
+static std::mutex shipped_mutex;
+static std::string shipped;
+
+static void open_redo_log()
+{
+  system((std::string("rm -rf ") + REDO_DIR).c_str());
+  RedoLog &redo_log = RedoLog::instance();
+  ASSERT_EQ(RC::SUCCESS, redo_log.open(REDO_DIR));
+  redo_log.set_shipper([](const char *data, size_t len, uint64_t) {
+    std::lock_guard<std::mutex> lock(shipped_mutex);
+    shipped.append(data, len);
+  });
+}
+
+static std::string take_shipped()
+{
+  std::lock_guard<std::mutex> lock(shipped_mutex);
+  std::string data;
+  data.swap(shipped);
+  return data;
+}
+
+TEST(ReplicationTest, apply_trx_state)
+{
+  open_redo_log();
+  RedoLog &redo_log = RedoLog::instance();
+  ReplicaClient &replica = ReplicaClient::instance();
+
+  // 落盘的日志原样交给备库
+  const std::string before(16, 'b');
+  redo_log.append_undo(103, "t", 1, 2, before.data(), (int)before.size());
+  ASSERT_EQ(RC::SUCCESS, redo_log.flush(redo_log.append_commit(107)));
+  std::string data = take_shipped();
+  ASSERT_FALSE(data.empty());
+  RedoRecordHeader header;
+  ASSERT_TRUE(RedoLog::decode_record(data.data(), data.size(), header));
+  ASSERT_EQ(REDO_UNDO_IMAGE, header.type);
+  ASSERT_FALSE(RedoLog::decode_record(data.data(), sizeof(header) - 1, header));
+
+  ASSERT_EQ(RC::SUCCESS, replica.apply(data.data(), data.size()));
+  ASSERT_TRUE(replica.committed(107));
+  ASSERT_FALSE(replica.committed(103));
+
+  // 第一次checkpoint之前的状态要到下一次checkpoint记录才能丢掉
+  redo_log.end_commit(107);
+  ASSERT_EQ(RC::SUCCESS, redo_log.checkpoint());
+  data = take_shipped();
+  ASSERT_EQ(RC::SUCCESS, replica.apply(data.data(), data.size()));
+  ASSERT_TRUE(replica.committed(107));
+
+  // 没有结束的提交在checkpoint时重新写过，还保留着
+  ASSERT_EQ(RC::SUCCESS, redo_log.flush(redo_log.append_commit(108)));
+  ASSERT_EQ(RC::SUCCESS, redo_log.checkpoint());
+  data = take_shipped();
+  ASSERT_EQ(RC::SUCCESS, replica.apply(data.data(), data.size()));
+  ASSERT_FALSE(replica.committed(107));
+  ASSERT_TRUE(replica.committed(108));
+
+  // 不完整的记录
+  ASSERT_EQ(RC::SUCCESS, redo_log.flush(redo_log.append_commit(109)));
+  data = take_shipped();
+  ASSERT_NE(RC::SUCCESS, replica.apply(data.data(), data.size() - 1));
+
+  redo_log.set_shipper(nullptr);
+  redo_log.close();
+  system((std::string("rm -rf ") + REDO_DIR).c_str());
+}
+
+TEST(ReplicationTest, snapshot_and_stream)
+{
+  open_redo_log();
+  RedoLog &redo_log = RedoLog::instance();
+  system((std::string("rm -rf ") + PRIMARY_DIR + " " + REPLICA_DIR).c_str());
+  system((std::string("mkdir -p ") + PRIMARY_DIR + "sys " + REPLICA_DIR).c_str());
+  {
+    std::ofstream file(std::string(PRIMARY_DIR) + "sys/t.data");
+    file << "primary data";
+    std::ofstream stale(std::string(REPLICA_DIR) + "stale.data");
+    stale << "stale";
+  }
+
+  ReplicationServer &server = ReplicationServer::instance();
+  ASSERT_EQ(RC::SUCCESS, server.start(0, PRIMARY_DIR));
+  ASSERT_GT(server.port(), 0);
+
+  // 快照替换掉备库原来的文件
+  ReplicaClient &replica = ReplicaClient::instance();
+  ASSERT_EQ(RC::SUCCESS, replica.connect("127.0.0.1:" + std::to_string(server.port()), REPLICA_DIR));
+  std::ifstream copied(std::string(REPLICA_DIR) + "sys/t.data");
+  std::stringstream content;
+  content << copied.rdbuf();
+  ASSERT_EQ("primary data", content.str());
+  ASSERT_NE(0, access((std::string(REPLICA_DIR) + "stale.data").c_str(), F_OK));
+
+  ASSERT_EQ(RC::SUCCESS, replica.start());
+  ASSERT_EQ(RC::SUCCESS, redo_log.flush(redo_log.append_commit(201)));
+  for (int i = 0; i < 500 && !replica.committed(201); i++) {
+    usleep(10000);
+  }
+  ASSERT_TRUE(replica.committed(201));
+  ASSERT_EQ(1, server.replica_count());
+  ASSERT_NE(std::string::npos, replica.metric().to_string().find("connected:1"));
+
+  replica.stop();
+  server.stop();
+  ASSERT_NE(std::string::npos, replica.metric().to_string().find("connected:0"));
+  redo_log.close();
+  system((std::string("rm -rf ") + REDO_DIR + " " + PRIMARY_DIR + " " + REPLICA_DIR).c_str());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,151 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for sampled request tracing and the Chrome trace export.
+//
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "common/seda/request_trace.h"
+#include "json/json.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+/**
+ * 导出的是JSON数组格式，每个span后面有逗号，去掉最后一个逗号补上']'就是完整的JSON
+ */
+static bool parse_events(const std::string &text, Json::Value &events)
+{
+  std::string json = text;
+  if (json.empty() || json[0] != '[') {
+    json = "[" + json;
+  }
+  const size_t comma = json.rfind(',');
+  if (comma != std::string::npos) {
+    json.erase(comma);
+  }
+  json += "]";
+  Json::Reader reader;
+  return reader.parse(json, events) && events.isArray();
+}
+
+TEST(RequestTraceTest, ring)
+{
+  RequestTrace trace(7);
+  for (int i = 0; i < REQUEST_TRACE_SPAN_NUM + 10; i++) {
+    trace.add_span("stage", "parse", i, i + 1);
+  }
+  // 环满了之后覆盖最早的span
+  ASSERT_EQ(REQUEST_TRACE_SPAN_NUM, trace.span_num());
+  ASSERT_EQ(10u, trace.dropped());
+  ASSERT_EQ(10u, trace.span(0).begin_us);
+  ASSERT_EQ((u64_t)REQUEST_TRACE_SPAN_NUM + 9, trace.span(REQUEST_TRACE_SPAN_NUM - 1).begin_us);
+}
+
+TEST(RequestTraceTest, span_scope)
+{
+  {
+    // 没有采样的请求不记录
+    TraceSpanScope span("storage", "page_read");
+  }
+
+  RequestTrace trace(1);
+  RequestTrace::set_current(&trace);
+  {
+    TraceSpanScope outer("storage", "table_scan");
+    TraceSpanScope inner("storage", "page_read");
+  }
+  // 其它线程设置同一个trace之后，span也记录到这个请求中
+  std::thread worker([&trace]() {
+    RequestTrace::set_current(&trace);
+    TraceSpanScope span("executor", "parallel_scan_worker");
+  });
+  worker.join();
+  RequestTrace::set_current(nullptr);
+  {
+    TraceSpanScope span("storage", "page_read");
+  }
+
+  ASSERT_EQ(3, trace.span_num());
+  ASSERT_STREQ("page_read", trace.span(0).name);
+  ASSERT_STREQ("table_scan", trace.span(1).name);
+  ASSERT_LE(trace.span(1).begin_us, trace.span(0).begin_us);
+  ASSERT_GE(trace.span(1).end_us, trace.span(0).end_us);
+  ASSERT_STREQ("parallel_scan_worker", trace.span(2).name);
+  ASSERT_NE(trace.span(0).thread_id, trace.span(2).thread_id);
+}
+
+TEST(RequestTraceTest, chrome_trace)
+{
+  RequestTrace trace(3);
+  trace.add_span("stage", "parse", 100, 150);
+  trace.add_span("storage", "page_read", 160, 200);
+  std::string out;
+  RequestTraceLog::to_chrome_trace(trace, "select * from t where name='a\"b'\n", out);
+
+  Json::Value events;
+  ASSERT_TRUE(parse_events(out, events));
+  ASSERT_EQ(2u, events.size());
+  ASSERT_EQ("parse", events[0]["name"].asString());
+  ASSERT_EQ("stage", events[0]["cat"].asString());
+  ASSERT_EQ("X", events[0]["ph"].asString());
+  ASSERT_EQ(100, events[0]["ts"].asInt());
+  ASSERT_EQ(50, events[0]["dur"].asInt());
+  ASSERT_EQ(40, events[1]["dur"].asInt());
+  ASSERT_EQ(3, events[1]["args"]["request"].asInt());
+  ASSERT_EQ("select * from t where name='a\"b'\n", events[1]["args"]["label"].asString());
+}
+
+TEST(RequestTraceTest, sample_and_write)
+{
+  const char *file = "request_trace_test.json";
+  remove(file);
+  RequestTraceLog &trace_log = RequestTraceLog::instance();
+  ASSERT_EQ(0, trace_log.init(file, 0));
+  ASSERT_FALSE(trace_log.enabled());
+  ASSERT_EQ(nullptr, trace_log.sample());
+
+  // 每4个请求跟踪1个
+  ASSERT_EQ(0, trace_log.init(file, 0.25));
+  int sampled = 0;
+  for (int i = 0; i < 40; i++) {
+    RequestTrace *trace = trace_log.sample();
+    if (trace != nullptr) {
+      sampled++;
+      trace->add_span("stage", "execute", 10, 20);
+      trace_log.write(*trace, "select 1;");
+      delete trace;
+    }
+  }
+  trace_log.close();
+  ASSERT_EQ(10, sampled);
+
+  std::ifstream ifs(file);
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  Json::Value events;
+  ASSERT_TRUE(parse_events(ss.str(), events));
+  ASSERT_EQ(10u, events.size());
+  remove(file);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
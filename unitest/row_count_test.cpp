@@ -0,0 +1,112 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for maintained row count.
+//
+
+#include <stdio.h>
+
+#include "storage/common/row_count.h"
+#include "gtest/gtest.h"
+
+static const char *ROW_COUNT_FILE = "row_count_test.count";
+
+TEST(RowCountTest, save_load)
+{
+  remove(ROW_COUNT_FILE);
+  int64_t count = 0;
+  uint64_t epoch = 0;
+  {
+    RowCount row_count;
+    row_count.init(ROW_COUNT_FILE);
+    ASSERT_NE(RC::SUCCESS, row_count.load());
+    ASSERT_FALSE(row_count.get(&count, &epoch));
+    ASSERT_EQ(RC::SUCCESS, row_count.reset());
+    ASSERT_TRUE(row_count.get(&count, &epoch));
+    ASSERT_EQ(0, count);
+
+    ASSERT_EQ(RC::SUCCESS, row_count.begin_change());
+    row_count.end_change(5);
+    ASSERT_EQ(RC::SUCCESS, row_count.save());
+  }
+  {
+    RowCount row_count;
+    row_count.init(ROW_COUNT_FILE);
+    ASSERT_EQ(RC::SUCCESS, row_count.load());
+    ASSERT_TRUE(row_count.get(&count, &epoch));
+    ASSERT_EQ(5, count);
+
+    // 修改开始之后文件不再完整，没有保存就重新打开时记录数未知
+    ASSERT_EQ(RC::SUCCESS, row_count.begin_change());
+    // 修改没有结束时不保存
+    ASSERT_EQ(RC::SUCCESS, row_count.save());
+  }
+  {
+    RowCount row_count;
+    row_count.init(ROW_COUNT_FILE);
+    ASSERT_NE(RC::SUCCESS, row_count.load());
+    ASSERT_FALSE(row_count.get(&count, &epoch));
+    row_count.clear();
+  }
+  FILE *file = fopen(ROW_COUNT_FILE, "r");
+  ASSERT_EQ(nullptr, file);
+}
+
+TEST(RowCountTest, learn)
+{
+  RowCount row_count;
+  row_count.init(ROW_COUNT_FILE);
+  row_count.clear();
+
+  int64_t count = 0;
+  uint64_t epoch = 0;
+  ASSERT_FALSE(row_count.get(&count, &epoch));
+  row_count.learn(epoch, 10);
+  ASSERT_TRUE(row_count.get(&count, &epoch));
+  ASSERT_EQ(10, count);
+
+  // 扫描期间有修改时不使用扫描的结果
+  row_count.clear();
+  row_count.get(&count, &epoch);
+  row_count.begin_change();
+  row_count.learn(epoch, 20);
+  ASSERT_FALSE(row_count.get(&count, &epoch));
+  row_count.learn(epoch, 20);
+  ASSERT_FALSE(row_count.get(&count, &epoch));
+  row_count.end_change(1);
+  ASSERT_FALSE(row_count.get(&count, &epoch));
+  row_count.learn(epoch, 21);
+  ASSERT_TRUE(row_count.get(&count, &epoch));
+  ASSERT_EQ(21, count);
+
+  // 只在内存中维护
+  RowCount memory;
+  memory.init("");
+  ASSERT_TRUE(memory.get(&count, &epoch));
+  ASSERT_EQ(0, count);
+  {
+    RowCountChange change(memory, true);
+    change.add(3);
+  }
+  {
+    RowCountChange change(memory, false);
+    change.add(3);
+  }
+  ASSERT_TRUE(memory.get(&count, &epoch));
+  ASSERT_EQ(3, count);
+  ASSERT_EQ(RC::SUCCESS, memory.save());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,106 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for page scan kernels.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "storage/common/scan_kernel.h"
+#include "gtest/gtest.h"
+
+// 每条记录：4字节的字段，1字节的null位图，再补3个字节
+#define RECORD_SIZE 8
+
+static const CompOp ops[] = {EQUAL_TO, LESS_EQUAL, NOT_EQUAL, LESS_THAN, GREAT_EQUAL, GREAT_THAN};
+
+static bool expected_match(int cmp, CompOp op)
+{
+  switch (op) {
+    case EQUAL_TO: return cmp == 0;
+    case LESS_EQUAL: return cmp <= 0;
+    case NOT_EQUAL: return cmp != 0;
+    case LESS_THAN: return cmp < 0;
+    case GREAT_EQUAL: return cmp >= 0;
+    default: return cmp > 0;
+  }
+}
+
+static bool get_bit(const std::vector<char> &bits, int i)
+{
+  return (bits[i / 8] & (1 << (i % 8))) != 0;
+}
+
+TEST(ScanKernelTest, compare_int)
+{
+  srand(7);
+  // 数量不是8的倍数，最后几条记录逐条比较
+  for (int count : {1, 8, 9, 100, 203}) {
+    std::vector<char> page(count * RECORD_SIZE);
+    for (int i = 0; i < count; i++) {
+      int v = rand() % 11 - 5;
+      memcpy(&page[i * RECORD_SIZE], &v, sizeof(v));
+      // 字段的null标志是第2位，其它位是别的字段的，不影响比较
+      page[i * RECORD_SIZE + 4] = (char)((rand() % 5 == 0 ? 0x04 : 0) | (rand() % 2 == 0 ? 0x0b : 0));
+    }
+    for (CompOp op : ops) {
+      std::vector<char> bits((count + 7) / 8);
+      scan_compare_int(page.data(), page.data() + 4, 0x04, RECORD_SIZE, count, op, 1, bits.data());
+      for (int i = 0; i < count; i++) {
+        int v;
+        memcpy(&v, &page[i * RECORD_SIZE], sizeof(v));
+        bool expected = (page[i * RECORD_SIZE + 4] & 0x04) == 0 && expected_match(v < 1 ? -1 : (v > 1 ? 1 : 0), op);
+        ASSERT_EQ(expected, get_bit(bits, i)) << "count=" << count << " op=" << op << " i=" << i;
+      }
+    }
+  }
+}
+
+TEST(ScanKernelTest, compare_float)
+{
+  const int count = 64;
+  std::vector<char> page(count * RECORD_SIZE);
+  for (int i = 0; i < count; i++) {
+    // 包括和1.5只差很小的值，应该认为相等
+    float v = (i % 3 == 0) ? 1.5f + (i % 2 == 0 ? 1e-7f : -1e-7f) : (i - 32) * 0.25f;
+    memcpy(&page[i * RECORD_SIZE], &v, sizeof(v));
+    page[i * RECORD_SIZE + 4] = i % 13 == 0 ? 1 : 0;
+  }
+  for (CompOp op : ops) {
+    std::vector<char> bits((count + 7) / 8);
+    scan_compare_float(page.data(), page.data() + 4, 1, RECORD_SIZE, count, op, 1.5f, bits.data());
+    for (int i = 0; i < count; i++) {
+      float v;
+      memcpy(&v, &page[i * RECORD_SIZE], sizeof(v));
+      float result = v - 1.5f;
+      int cmp = (result < 1e-6 && result > -1e-6) ? 0 : (result > 0 ? 1 : -1);
+      bool expected = page[i * RECORD_SIZE + 4] == 0 && expected_match(cmp, op);
+      ASSERT_EQ(expected, get_bit(bits, i)) << "op=" << op << " i=" << i;
+    }
+  }
+}
+
+TEST(ScanKernelTest, reverse_comp_op)
+{
+  ASSERT_EQ(GREAT_THAN, reverse_comp_op(LESS_THAN));
+  ASSERT_EQ(LESS_EQUAL, reverse_comp_op(GREAT_EQUAL));
+  ASSERT_EQ(EQUAL_TO, reverse_comp_op(EQUAL_TO));
+  ASSERT_EQ(NOT_EQUAL, reverse_comp_op(NOT_EQUAL));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,153 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the session pool and idle session reclamation.
+//
+
+#include "session/cursor.h"
+#include "session/session.h"
+#include "session/session_pool.h"
+#include "storage/trx/trx.h"
+#include "gtest/gtest.h"
+
+TEST(SessionPoolTest, reuse)
+{
+  SessionPool &pool = SessionPool::instance();
+  pool.set_max_idle(1);
+  Session *first = pool.acquire();
+  ASSERT_NE(nullptr, first);
+  first->set_current_db("other");
+  first->set_trx_multi_operation_mode(true);
+  ASSERT_EQ(1, pool.active_count());
+
+  // 放回池中的session恢复初始状态之后给下一个连接使用
+  pool.release(first);
+  ASSERT_EQ(0, pool.active_count());
+  ASSERT_EQ(1, pool.idle_count());
+  Session *second = pool.acquire();
+  ASSERT_EQ(first, second);
+  ASSERT_EQ(Session::default_session().get_current_db(), second->get_current_db());
+  ASSERT_FALSE(second->is_trx_multi_operation_mode());
+
+  // 超过max_idle的session直接释放
+  Session *third = pool.acquire();
+  pool.release(second);
+  pool.release(third);
+  ASSERT_EQ(1, pool.idle_count());
+  pool.set_max_idle(0);
+  ASSERT_EQ(0, pool.idle_count());
+}
+
+TEST(SessionPoolTest, reclaim_idle)
+{
+  SessionPool &pool = SessionPool::instance();
+  Session *session = pool.acquire();
+  Trx *trx = session->current_trx();
+  ASSERT_NE(nullptr, trx);
+
+  // 执行中的请求和多语句事务都不回收
+  session->begin_request("select * from t;");
+  ASSERT_EQ(0, pool.reclaim_idle(0));
+  session->end_request();
+  session->set_trx_multi_operation_mode(true);
+  ASSERT_EQ(0, pool.reclaim_idle(0));
+  session->set_trx_multi_operation_mode(false);
+  ASSERT_EQ(0, pool.reclaim_idle(3600LL * 1000 * 1000));
+
+  ASSERT_EQ(1, pool.reclaim_idle(0));
+  ASSERT_EQ(0, pool.reclaim_idle(0));
+  ASSERT_NE(nullptr, session->current_trx());
+  pool.release(session);
+}
+
+class TestCursor : public Cursor {
+public:
+  TestCursor(bool uses_session_trx, int *destroyed) : uses_session_trx_(uses_session_trx), destroyed_(destroyed)
+  {}
+  ~TestCursor() override
+  {
+    (*destroyed_)++;
+  }
+  bool uses_session_trx() const override
+  {
+    return uses_session_trx_;
+  }
+
+private:
+  bool uses_session_trx_;
+  int *destroyed_;
+};
+
+TEST(SessionPoolTest, cursors)
+{
+  SessionPool &pool = SessionPool::instance();
+  Session *session = pool.acquire();
+  int destroyed = 0;
+  TestCursor *hold = new TestCursor(false, &destroyed);
+  ASSERT_TRUE(session->add_cursor("hold", hold));
+  ASSERT_TRUE(session->add_cursor("in_trx", new TestCursor(true, &destroyed)));
+
+  // 同名的游标已经打开时不接管新的游标
+  TestCursor duplicate(false, &destroyed);
+  ASSERT_FALSE(session->add_cursor("hold", &duplicate));
+  ASSERT_EQ(hold, session->find_cursor("hold"));
+
+  // 事务结束只关闭使用session事务的游标
+  session->close_trx_cursors();
+  ASSERT_EQ(1, destroyed);
+  ASSERT_EQ(nullptr, session->find_cursor("in_trx"));
+  ASSERT_EQ(hold, session->find_cursor("hold"));
+
+  ASSERT_TRUE(session->remove_cursor("hold"));
+  ASSERT_FALSE(session->remove_cursor("hold"));
+  ASSERT_EQ(2, destroyed);
+
+  // 放回池中时关闭剩下的游标
+  ASSERT_TRUE(session->add_cursor("left", new TestCursor(false, &destroyed)));
+  pool.release(session);
+  ASSERT_EQ(3, destroyed);
+}
+
+TEST(SessionPoolTest, kill_query)
+{
+  SessionPool &pool = SessionPool::instance();
+  Session *first = pool.acquire();
+  Session *second = pool.acquire();
+  ASSERT_NE(first->id(), second->id());
+
+  // 没有在执行的语句
+  ASSERT_FALSE(pool.kill_query(second->id()));
+  second->begin_request("select * from t;");
+  second->query_cancel()->begin();
+  ASSERT_TRUE(pool.kill_query(second->id()));
+  ASSERT_TRUE(second->query_cancel()->cancelled());
+  ASSERT_FALSE(first->query_cancel()->cancelled());
+
+  std::vector<SessionInfo> sessions;
+  pool.list(sessions);
+  ASSERT_EQ(2, sessions.size());
+  ASSERT_EQ(first->id(), sessions[0].id);
+  ASSERT_FALSE(sessions[0].in_request);
+  ASSERT_TRUE(sessions[1].in_request);
+  ASSERT_EQ("select * from t;", sessions[1].sql);
+
+  second->query_cancel()->end();
+  second->end_request();
+  pool.release(first);
+  pool.release(second);
+  ASSERT_FALSE(pool.kill_query(second->id()));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
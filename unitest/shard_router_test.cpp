@@ -0,0 +1,319 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the hash-sharding query router.
+//
+
+#include <string>
+#include <vector>
+
+#include "obrouter/result_merger.h"
+#include "obrouter/route_planner.h"
+#include "obrouter/shard_map.h"
+#include "obrouter/sql_writer.h"
+#include "sql/parser/parse.h"
+#include "gtest/gtest.h"
+
+static const int KEY_POSITION = 0;
+
+class ShardRouterTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    ASSERT_EQ(RC::SUCCESS, shard_map_.init("127.0.0.1:6781, 127.0.0.1:6782, /tmp/shard2.sock", "t.id, s.name"));
+  }
+
+  /**
+   * 解析并路由一条语句，分片键都是表的第一个字段
+   */
+  RoutePlan plan(const char *sql)
+  {
+    RoutePlanner planner(shard_map_, [](const char *, const char *, int &position) {
+      position = KEY_POSITION;
+      return RC::SUCCESS;
+    });
+    Query *query = query_create();
+    EXPECT_EQ(RC::SUCCESS, parse(sql, query));
+    RoutePlan route_plan;
+    EXPECT_EQ(RC::SUCCESS, planner.plan(sql, query, route_plan));
+    query_destroy(query);
+    return route_plan;
+  }
+
+  int shard_of_int(int v)
+  {
+    Value value;
+    value.type = INTS;
+    value.data = &v;
+    value.is_null = 0;
+    return shard_map_.shard_of(value);
+  }
+
+protected:
+  ShardMap shard_map_;
+};
+
+TEST_F(ShardRouterTest, shard_map)
+{
+  ASSERT_EQ(3, shard_map_.shard_num());
+  ASSERT_EQ("127.0.0.1:6782", shard_map_.shard(1).to_string());
+  ASSERT_EQ("/tmp/shard2.sock", shard_map_.shard(2).unix_path);
+  ASSERT_STREQ("id", shard_map_.shard_key("t"));
+  ASSERT_STREQ("name", shard_map_.shard_key("s"));
+  ASSERT_EQ(nullptr, shard_map_.shard_key("u"));
+
+  // 不同类型的相同值落在同一个分片上
+  int i = 7;
+  float f = 7.0;
+  Value int_value{INTS, &i, 0};
+  Value float_value{FLOATS, &f, 0};
+  Value chars_value{CHARS, (void *)"7", 0};
+  ASSERT_EQ("7", ShardMap::canonical(int_value));
+  ASSERT_EQ("7", ShardMap::canonical(float_value));
+  ASSERT_EQ(shard_map_.shard_of(int_value), shard_map_.shard_of(float_value));
+  ASSERT_EQ(shard_map_.shard_of(int_value), shard_map_.shard_of(chars_value));
+  Value null_value{NULLS, (void *)"NULL", 1};
+  ASSERT_EQ(0, shard_map_.shard_of(null_value));
+
+  // 键分布到所有分片上
+  std::vector<int> counts(3, 0);
+  for (int v = 0; v < 300; v++) {
+    counts[shard_of_int(v)]++;
+  }
+  for (int count : counts) {
+    ASSERT_GT(count, 50);
+  }
+
+  ShardMap invalid;
+  ASSERT_NE(RC::SUCCESS, invalid.init("", ""));
+  ASSERT_NE(RC::SUCCESS, invalid.init("127.0.0.1:abc", ""));
+  ASSERT_NE(RC::SUCCESS, invalid.init("127.0.0.1:6781", "t"));
+}
+
+TEST_F(ShardRouterTest, sql_writer)
+{
+  Query *query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("insert into t values (1, 2.5, 'a b', '2021-3-4', null), (-2, 0.1, \"it's\", 'x', 3);", query));
+  std::string sql;
+  SqlWriter::write_insert(query->sstr.insertion, {1, 0}, sql);
+  ASSERT_EQ("insert into t values (-2, 0.1, \"it's\", 'x', 3), (1, 2.5, 'a b', '2021-03-04', null);", sql);
+  query_destroy(query);
+
+  query = query_create();
+  ASSERT_EQ(RC::SUCCESS, parse("select a, t.b from t where a >= 1 and b is not null and 3 <> c order by a desc, b;", query));
+  const Selects &selects = query->sstr.selection;
+  std::vector<RelAttr> attrs;
+  for (size_t i = selects.attr_num; i > 0; i--) {
+    attrs.push_back(selects.attributes[i - 1]);
+  }
+  sql.clear();
+  ASSERT_EQ(RC::SUCCESS, SqlWriter::write_select(selects, attrs, true, 10, sql));
+  ASSERT_EQ("select a, t.b from t where a >= 1 and b is not null and 3 <> c order by a desc, b asc limit 10;", sql);
+  query_destroy(query);
+}
+
+TEST_F(ShardRouterTest, route_statements)
+{
+  RoutePlan route_plan = plan("select * from t where id = 5;");
+  ASSERT_EQ(RouteType::SINGLE, route_plan.type);
+  ASSERT_EQ(shard_of_int(5), route_plan.requests[0].shard);
+  ASSERT_EQ("select * from t where id = 5;", route_plan.requests[0].sql);
+
+  // 没有分片的表在第0个分片上
+  route_plan = plan("select * from u, t where t.id = 5 and u.a = t.b;");
+  ASSERT_EQ(shard_of_int(5) == 0 ? RouteType::SINGLE : RouteType::FAILURE, route_plan.type);
+  route_plan = plan("select * from u where a in (select b from u);");
+  ASSERT_EQ(RouteType::SINGLE, route_plan.type);
+  ASSERT_EQ(0, route_plan.requests[0].shard);
+
+  route_plan = plan("select * from t, s where t.id = s.id;");
+  ASSERT_EQ(RouteType::FAILURE, route_plan.type);
+  route_plan = plan("select * from t where b in (select name from s);");
+  ASSERT_EQ(RouteType::FAILURE, route_plan.type);
+
+  // 写分片键等值的记录只发给一个分片
+  route_plan = plan("update t set b = 1 where id = 5;");
+  ASSERT_EQ(RouteType::SINGLE, route_plan.type);
+  ASSERT_EQ(shard_of_int(5), route_plan.requests[0].shard);
+  route_plan = plan("delete from t where b = 1;");
+  ASSERT_EQ(RouteType::MULTI, route_plan.type);
+  ASSERT_EQ(3, (int)route_plan.requests.size());
+  route_plan = plan("update t set id = 1 where b = 1;");
+  ASSERT_EQ(RouteType::FAILURE, route_plan.type);
+
+  route_plan = plan("create table t(id int, b int);");
+  ASSERT_EQ(RouteType::MULTI, route_plan.type);
+  ASSERT_EQ("t", route_plan.ddl_table);
+  route_plan = plan("create table s(id int);");
+  ASSERT_EQ(RouteType::FAILURE, route_plan.type);
+  route_plan = plan("create table u(id int);");
+  ASSERT_EQ(RouteType::SINGLE, route_plan.type);
+  route_plan = plan("drop index i;");
+  ASSERT_EQ(RouteType::MULTI, route_plan.type);
+  ASSERT_TRUE(route_plan.any_success);
+  route_plan = plan("show tables;");
+  ASSERT_EQ(RouteType::SINGLE, route_plan.type);
+  ASSERT_EQ(0, route_plan.requests[0].shard);
+  route_plan = plan("load data infile 'a.csv' into table t;");
+  ASSERT_EQ(RouteType::FAILURE, route_plan.type);
+}
+
+TEST_F(ShardRouterTest, route_insert)
+{
+  // 按分片键把各组值分到不同的分片
+  std::string sql = "insert into t values";
+  for (int i = 0; i < 30; i++) {
+    sql += std::string(i == 0 ? " (" : ", (") + std::to_string(i) + ", 'v')";
+  }
+  sql += ";";
+  RoutePlan route_plan = plan(sql.c_str());
+  ASSERT_EQ(RouteType::MULTI, route_plan.type);
+  ASSERT_EQ(3, (int)route_plan.requests.size());
+  size_t total = 0;
+  for (const ShardRequest &request : route_plan.requests) {
+    for (int i = 0; i < 30; i++) {
+      std::string row = "(" + std::to_string(i) + ", 'v')";
+      if (request.sql.find(" " + row) != std::string::npos) {
+        ASSERT_EQ(shard_of_int(i), request.shard);
+        total++;
+      }
+    }
+  }
+  ASSERT_EQ(30u, total);
+
+  route_plan = plan("insert into t values (5, 'v');");
+  ASSERT_EQ(RouteType::SINGLE, route_plan.type);
+  ASSERT_EQ(shard_of_int(5), route_plan.requests[0].shard);
+  ASSERT_EQ("insert into t values (5, 'v');", route_plan.requests[0].sql);
+}
+
+TEST_F(ShardRouterTest, route_scatter)
+{
+  RoutePlan route_plan = plan("select b from t where b > 1 order by c desc limit 2 offset 3;");
+  ASSERT_EQ(RouteType::SCATTER, route_plan.type);
+  ASSERT_EQ(3, (int)route_plan.requests.size());
+  ASSERT_EQ("select b, c from t where b > 1 order by c desc limit 5;", route_plan.requests[0].sql);
+  ASSERT_EQ(1, route_plan.merge.hidden_columns);
+  ASSERT_FALSE(route_plan.merge.aggregate);
+
+  // 聚合拆成部分聚合下推，avg拆成sum和count
+  route_plan = plan("select b, avg(c), count(*), max(d) from t group by b, e;");
+  ASSERT_EQ(RouteType::SCATTER, route_plan.type);
+  ASSERT_EQ("select b, sum(c), count(c), count(*), max(d), e from t group by b, e;", route_plan.requests[0].sql);
+  ASSERT_TRUE(route_plan.merge.aggregate);
+  ASSERT_EQ(4, (int)route_plan.merge.columns.size());
+  ASSERT_EQ(MergeFunc::AVG, route_plan.merge.columns[1].func);
+  ASSERT_EQ(2, route_plan.merge.columns[1].count_source);
+  ASSERT_EQ(std::vector<int>({0, 5}), route_plan.merge.group_sources);
+
+  route_plan = plan("select count(distinct b) from t;");
+  ASSERT_EQ(RouteType::FAILURE, route_plan.type);
+  route_plan = plan("select b, rank() over (order by b) from t;");
+  ASSERT_EQ(RouteType::FAILURE, route_plan.type);
+}
+
+/**
+ * 构造一个分片的结果集
+ */
+static WireResult make_result(const std::vector<std::string> &headers, const std::vector<WireRow> &rows)
+{
+  std::string schema;
+  wire_put_u16(schema, headers.size());
+  for (const std::string &header : headers) {
+    wire_put_u8(schema, WIRE_VALUE_INT);
+    wire_put_u16(schema, header.size());
+    schema.append(header);
+  }
+  std::string data;
+  wire_put_u32(data, rows.size());
+  for (const WireRow &row : rows) {
+    wire_put_u16(data, row.size());
+    for (const WireValue &value : row) {
+      wire_put_u8(data, value.type);
+      if (value.type == WIRE_VALUE_INT) {
+        wire_put_u32(data, (uint32_t)value.int_value);
+      } else if (value.type == WIRE_VALUE_FLOAT) {
+        wire_put_f32(data, (float)value.float_value);
+      } else if (value.type == WIRE_VALUE_STRING) {
+        wire_put_u16(data, value.string_value.size());
+        data.append(value.string_value);
+      }
+    }
+  }
+  WireResult result;
+  EXPECT_EQ(RC::SUCCESS, result.add_frame(WIRE_FRAME_SCHEMA, schema.data(), schema.size()));
+  EXPECT_EQ(RC::SUCCESS, result.add_frame(WIRE_FRAME_ROWS, data.data(), data.size()));
+  return result;
+}
+
+static WireValue int_value(int v)
+{
+  return WireValue::make_int(v);
+}
+
+TEST_F(ShardRouterTest, merge_rows)
+{
+  RoutePlan route_plan = plan("select b from t order by c desc limit 2 offset 1;");
+  std::vector<WireResult> results;
+  results.push_back(make_result({"b", "c"}, {{int_value(1), int_value(10)}, {int_value(2), int_value(5)}}));
+  results.push_back(make_result({"b", "c"}, {{int_value(3), int_value(8)}}));
+  results.push_back(make_result({"b", "c"}, {}));
+  std::string out;
+  ResultMerger::merge_rows(route_plan.merge, results, out);
+  ASSERT_EQ("b\n3\n2\n", out);
+
+  // 有分片失败时返回失败
+  results.clear();
+  results.push_back(make_result({"b", "c"}, {}));
+  results.emplace_back();
+  results.back().add_frame(WIRE_FRAME_MESSAGE, "FAILURE\n", 8);
+  ResultMerger::merge_rows(route_plan.merge, results, out);
+  ASSERT_EQ("FAILURE\n", out);
+
+  std::vector<WireResult> statuses(2);
+  statuses[0].add_frame(WIRE_FRAME_MESSAGE, "SUCCESS\n", 8);
+  statuses[1].add_frame(WIRE_FRAME_MESSAGE, "FAILURE\n", 8);
+  ResultMerger::merge_status(statuses, false, out);
+  ASSERT_EQ("FAILURE\n", out);
+  ResultMerger::merge_status(statuses, true, out);
+  ASSERT_EQ("SUCCESS\n", out);
+}
+
+TEST_F(ShardRouterTest, merge_aggregate)
+{
+  RoutePlan route_plan = plan("select b, avg(c), count(*), min(d) from t group by b order by b desc;");
+  // 分片上的列：b, sum(c), count(c), count(*), min(d)
+  std::vector<std::string> headers = {"b", "sum(c)", "count(c)", "count(*)", "min(d)"};
+  WireValue null_value;
+  std::vector<WireResult> results;
+  results.push_back(make_result(headers,
+      {{int_value(1), int_value(3), int_value(2), int_value(2), int_value(4)},
+       {int_value(2), null_value, int_value(0), int_value(1), null_value}}));
+  results.push_back(make_result(headers, {{int_value(1), int_value(4), int_value(2), int_value(3), int_value(-1)}}));
+  // 没有记录时observer返回的表头不同，不参与合并
+  results.push_back(make_result({"b", "c", "d"}, {}));
+  std::string out;
+  ResultMerger::merge_rows(route_plan.merge, results, out);
+  ASSERT_EQ("b | avg(c) | count(*) | min(d)\n2 | NULL | 1 | NULL\n1 | 1.75 | 5 | -1\n", out);
+
+  // 所有分片都没有记录
+  results.clear();
+  results.push_back(make_result({"b", "c", "d"}, {}));
+  results.push_back(make_result({"b", "c", "d"}, {}));
+  ResultMerger::merge_rows(route_plan.merge, results, out);
+  ASSERT_EQ("b | c | d\n", out);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
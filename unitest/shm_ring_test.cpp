@@ -0,0 +1,194 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the rings of the shared-memory transport.
+//
+
+#include <sys/eventfd.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "net/shm_ring.h"
+#include "gtest/gtest.h"
+
+static std::vector<char> make_region(uint32_t request_ring_size, uint32_t response_ring_size)
+{
+  // 共享内存按页对齐，这里多分配一些自己对齐到cache line
+  return std::vector<char>(shm_region_size(request_ring_size, response_ring_size) + SHM_CACHE_LINE_SIZE);
+}
+
+static void *align_region(std::vector<char> &buf)
+{
+  uintptr_t addr = (uintptr_t)buf.data();
+  return (void *)((addr + SHM_CACHE_LINE_SIZE - 1) & ~(uintptr_t)(SHM_CACHE_LINE_SIZE - 1));
+}
+
+TEST(ShmRingTest, init_and_attach)
+{
+  std::vector<char> buf = make_region(64, 256);
+  void *mem = align_region(buf);
+  ShmRing requests;
+  ShmRing responses;
+  shm_region_init(mem, 64, 256, &requests, &responses);
+  ASSERT_EQ(64u, requests.writable());
+  ASSERT_EQ(256u, responses.writable());
+
+  ShmRing client_requests;
+  ShmRing client_responses;
+  const size_t size = shm_region_size(64, 256);
+  ASSERT_TRUE(shm_region_attach(mem, size, &client_requests, &client_responses));
+  ASSERT_EQ(5u, client_requests.write("hello", 5));
+  char out[8];
+  ASSERT_EQ(5u, requests.read(out, sizeof(out)));
+  ASSERT_EQ(std::string("hello"), std::string(out, 5));
+
+  // 大小不对或者被改坏的区域不能使用
+  ASSERT_FALSE(shm_region_attach(mem, size - 1, &client_requests, &client_responses));
+  ((ShmRegionHeader *)mem)->response_ring_size = 255;
+  ASSERT_FALSE(shm_region_attach(mem, size, &client_requests, &client_responses));
+  ((ShmRegionHeader *)mem)->response_ring_size = 256;
+  ((ShmRegionHeader *)mem)->magic = 0;
+  ASSERT_FALSE(shm_region_attach(mem, size, &client_requests, &client_responses));
+}
+
+TEST(ShmRingTest, full_and_wrap_around)
+{
+  std::vector<char> buf = make_region(16, 16);
+  void *mem = align_region(buf);
+  ShmRing ring;
+  ShmRing unused;
+  shm_region_init(mem, 16, 16, &ring, &unused);
+
+  // 环满时只写入一部分
+  ASSERT_EQ(16u, ring.write("0123456789abcdefXYZ", 19));
+  ASSERT_EQ(0u, ring.write("X", 1));
+  char out[32];
+  ASSERT_EQ(10u, ring.read(out, 10));
+  ASSERT_EQ(std::string("0123456789"), std::string(out, 10));
+
+  // 写入的数据绕过环的末尾
+  ASSERT_EQ(10u, ring.write("ghijklmnop", 10));
+  ASSERT_EQ(16u, ring.readable());
+  ASSERT_EQ(16u, ring.read(out, sizeof(out)));
+  ASSERT_EQ(std::string("abcdefghijklmnop"), std::string(out, 16));
+  ASSERT_EQ(0u, ring.read(out, sizeof(out)));
+}
+
+TEST(ShmRingTest, corrupted)
+{
+  std::vector<char> buf = make_region(16, 16);
+  void *mem = align_region(buf);
+  ShmRing ring;
+  ShmRing unused;
+  shm_region_init(mem, 16, 16, &ring, &unused);
+  ASSERT_EQ(4u, ring.write("abcd", 4));
+
+  // 消费者把head改到tail之后，差值下溢，不能当作很大的空间写入
+  std::vector<char> data(64, 'x');
+  ring.header()->head.store(ring.header()->tail.load() + 1);
+  ASSERT_EQ(SHM_RING_CORRUPTED, ring.readable());
+  ASSERT_EQ(0u, ring.writable());
+  ASSERT_EQ(SHM_RING_CORRUPTED, ring.write(data.data(), data.size()));
+  char out[64];
+  ASSERT_EQ(SHM_RING_CORRUPTED, ring.read(out, sizeof(out)));
+
+  // 生产者把tail改得超出容量，读时不能越过环的末尾
+  ring.header()->head.store(0);
+  ring.header()->tail.store(17);
+  ASSERT_EQ(SHM_RING_CORRUPTED, ring.readable());
+  ASSERT_EQ(SHM_RING_CORRUPTED, ring.read(out, sizeof(out)));
+  ASSERT_EQ(SHM_RING_CORRUPTED, ring.write(data.data(), data.size()));
+
+  // 恢复正常之后可以继续使用
+  ring.header()->tail.store(16);
+  ASSERT_EQ(16u, ring.readable());
+  ASSERT_EQ(0u, ring.writable());
+}
+
+TEST(ShmRingTest, notify)
+{
+  std::vector<char> buf = make_region(16, 16);
+  void *mem = align_region(buf);
+  ShmRing ring;
+  ShmRing unused;
+  shm_region_init(mem, 16, 16, &ring, &unused);
+  int efd = eventfd(0, EFD_NONBLOCK);
+  ASSERT_GE(efd, 0);
+
+  // 对方没有等待时不写eventfd
+  uint64_t value = 0;
+  shm_notify_consumer(ring, efd);
+  ASSERT_LT(::read(efd, &value, sizeof(value)), 0);
+
+  // 只唤醒一次
+  ring.header()->consumer_waiting.store(1);
+  shm_notify_consumer(ring, efd);
+  shm_notify_consumer(ring, efd);
+  ASSERT_EQ((ssize_t)sizeof(value), ::read(efd, &value, sizeof(value)));
+  ASSERT_EQ(1u, value);
+  ASSERT_EQ(0u, ring.header()->consumer_waiting.load());
+
+  ring.header()->producer_waiting.store(1);
+  shm_notify_producer(ring, efd);
+  ASSERT_EQ((ssize_t)sizeof(value), ::read(efd, &value, sizeof(value)));
+  close(efd);
+}
+
+TEST(ShmRingTest, producer_consumer)
+{
+  const uint32_t ring_size = 4096;
+  std::vector<char> buf = make_region(ring_size, ring_size);
+  void *mem = align_region(buf);
+  ShmRing producer;
+  ShmRing unused;
+  shm_region_init(mem, ring_size, ring_size, &producer, &unused);
+  ShmRing consumer;
+  ASSERT_TRUE(shm_region_attach(mem, shm_region_size(ring_size, ring_size), &consumer, &unused));
+
+  // 每次写入的长度不同，和容量互质，覆盖各种绕回的位置
+  std::string data;
+  for (int i = 0; data.size() < 4 * 1024 * 1024; i++) {
+    data += std::to_string(i) + ",";
+  }
+
+  std::thread writer([&producer, &data]() {
+    size_t pos = 0;
+    while (pos < data.size()) {
+      const size_t len = std::min((size_t)1237, data.size() - pos);
+      const size_t written = producer.write(data.data() + pos, len);
+      if (written == 0) {
+        std::this_thread::yield();
+      }
+      pos += written;
+    }
+  });
+
+  std::string received;
+  char out[977];
+  while (received.size() < data.size()) {
+    const size_t len = consumer.read(out, sizeof(out));
+    if (len == 0) {
+      std::this_thread::yield();
+    }
+    received.append(out, len);
+  }
+  writer.join();
+  ASSERT_EQ(data, received);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
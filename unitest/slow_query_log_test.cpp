@@ -0,0 +1,106 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the per-statement trace and the slow query log.
+//
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "session/slow_query_log.h"
+#include "storage/common/table_scanner.h"
+#include "storage/default/disk_buffer_pool.h"
+#include "gtest/gtest.h"
+
+static std::string read_file(const char *file)
+{
+  std::ifstream ifs(file);
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  return ss.str();
+}
+
+TEST(SlowQueryLogTest, trace)
+{
+  QueryTrace trace;
+  trace.begin();
+  usleep(2000);
+  trace.enter_stage("parse");
+  scanned_record_count() += 5;
+  bp_thread_stat().misses += 2;
+  trace.enter_stage("execute");
+  usleep(2000);
+  trace.enter_stage("parse");
+  trace.end();
+
+  // 同一个stage多次进入时累加，按第一次进入的顺序输出
+  const std::string stages = trace.stage_string();
+  ASSERT_EQ(0u, stages.find("session="));
+  ASSERT_NE(std::string::npos, stages.find(",parse="));
+  ASSERT_NE(std::string::npos, stages.find(",execute="));
+  ASSERT_EQ(stages.find("parse="), stages.rfind("parse="));
+  ASSERT_GE(trace.total_us(), 4000u);
+  ASSERT_EQ(5, trace.rows_examined());
+  ASSERT_EQ(0, trace.pages_hit());
+  ASSERT_EQ(2, trace.pages_read());
+
+  // 没有begin的语句不记录
+  QueryTrace idle;
+  idle.enter_stage("parse");
+  idle.end();
+  ASSERT_EQ(0u, idle.total_us());
+}
+
+TEST(SlowQueryLogTest, threshold)
+{
+  const char *file = "slow_query_log_test.log";
+  SlowQueryLog &log = SlowQueryLog::instance();
+  log.init(file, -1);
+  ASSERT_FALSE(log.enabled());
+
+  log.init(file, 1);
+  ASSERT_TRUE(log.enabled());
+  QueryTrace fast;
+  fast.begin();
+  fast.end();
+  log.record("select fast from t;", fast);
+
+  QueryTrace slow;
+  slow.begin();
+  usleep(5000);
+  slow.enter_stage("execute");
+  slow.end();
+  log.record("select slow\nfrom t;", slow);
+  log.close();
+
+  // 日志按天切换，文件名后面加上日期
+  char date[16];
+  time_t now = time(nullptr);
+  strftime(date, sizeof(date), ".%Y%m%d", localtime(&now));
+  const std::string dated_file = std::string(file) + date;
+  const std::string content = read_file(dated_file.c_str());
+  ASSERT_EQ(std::string::npos, content.find("select fast"));
+  ASSERT_NE(std::string::npos, content.find("sql=select slow from t;"));
+  ASSERT_NE(std::string::npos, content.find("stages=session="));
+  ASSERT_NE(std::string::npos, content.find("rows_examined=0"));
+  remove(dated_file.c_str());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
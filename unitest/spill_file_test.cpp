@@ -0,0 +1,118 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the spill file manager.
+//
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "common/os/path.h"
+#include "storage/default/spill_file.h"
+#include "gtest/gtest.h"
+
+TEST(SpillFileTest, write_and_read)
+{
+  SpillFileManager &manager = SpillFileManager::instance();
+  ASSERT_EQ(RC::SUCCESS, manager.init("", 0));
+  SpillQuota quota(0);
+  FILE *file = manager.create(&quota);
+  ASSERT_NE(nullptr, file);
+  ASSERT_EQ(1, manager.open_files());
+
+  // 比缓冲区大，会分多次写到文件中
+  const int count = SPILL_FILE_BUFFER_SIZE / sizeof(int) * 3;
+  for (int i = 0; i < count; i++) {
+    ASSERT_EQ(1u, fwrite(&i, sizeof(i), 1, file));
+  }
+  rewind(file);
+  ASSERT_EQ(count * sizeof(int), quota.used());
+  for (int i = 0; i < count; i++) {
+    int value = -1;
+    ASSERT_EQ(1u, fread(&value, sizeof(value), 1, file));
+    ASSERT_EQ(i, value);
+  }
+  int value = 0;
+  ASSERT_EQ(0u, fread(&value, sizeof(value), 1, file));
+  ASSERT_TRUE(feof(file));
+
+  // 覆盖写不增加quota
+  rewind(file);
+  ASSERT_EQ(1u, fwrite(&value, sizeof(value), 1, file));
+  ASSERT_EQ(0, fflush(file));
+  ASSERT_EQ(count * sizeof(int), quota.used());
+
+  ASSERT_EQ(0, fclose(file));
+  ASSERT_EQ(0u, quota.used());
+  ASSERT_EQ(count * sizeof(int), quota.peak());
+  ASSERT_EQ(0, manager.open_files());
+  ASSERT_EQ(0u, manager.used_bytes());
+}
+
+TEST(SpillFileTest, quota)
+{
+  SpillFileManager &manager = SpillFileManager::instance();
+  ASSERT_EQ(RC::SUCCESS, manager.init("", 0));
+  SpillQuota quota(SPILL_FILE_BUFFER_SIZE * 2);
+  FILE *file1 = manager.create(&quota);
+  FILE *file2 = manager.create(&quota);
+  ASSERT_NE(nullptr, file1);
+  ASSERT_NE(nullptr, file2);
+
+  std::vector<char> data(SPILL_FILE_BUFFER_SIZE, 'a');
+  ASSERT_EQ(data.size(), fwrite(data.data(), 1, data.size(), file1));
+  ASSERT_EQ(0, fflush(file1));
+  ASSERT_EQ(data.size(), fwrite(data.data(), 1, data.size(), file2));
+  ASSERT_EQ(0, fflush(file2));
+
+  // 两个文件一起用完了quota
+  ASSERT_EQ(data.size(), fwrite(data.data(), 1, data.size(), file1));
+  ASSERT_NE(0, fflush(file1));
+  ASSERT_EQ(EDQUOT, errno);
+  fclose(file1);
+
+  // 关闭的文件归还quota
+  clearerr(file2);
+  ASSERT_EQ(data.size(), fwrite(data.data(), 1, data.size(), file2));
+  ASSERT_EQ(0, fflush(file2));
+  ASSERT_EQ(data.size() * 2, quota.used());
+  fclose(file2);
+  ASSERT_EQ(0u, quota.used());
+}
+
+TEST(SpillFileTest, spill_dir)
+{
+  std::string dir = "spill_file_test_dir";
+  SpillFileManager &manager = SpillFileManager::instance();
+  ASSERT_EQ(RC::SUCCESS, manager.init(dir, 0));
+  ASSERT_TRUE(common::is_directory(dir.c_str()));
+
+  FILE *file = manager.create(nullptr);
+  ASSERT_NE(nullptr, file);
+  ASSERT_EQ(5u, fwrite("hello", 1, 5, file));
+  ASSERT_EQ(0, fflush(file));
+  // 临时文件没有名字
+  std::vector<std::string> files;
+  ASSERT_EQ(0, common::list_file(dir.c_str(), ".*", files));
+  fclose(file);
+
+  ASSERT_EQ(RC::SUCCESS, manager.init("", 0));
+  rmdir(dir.c_str());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,138 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for handling the queued events of a stage in batches.
+//
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "common/seda/stage.h"
+#include "common/seda/thread_pool.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+/**
+ * 第一个事件等到open之后才处理完，记录每次handle_events的事件数
+ */
+class BatchStage : public Stage {
+public:
+  BatchStage() : Stage("BatchStage")
+  {}
+
+  void handle_event(StageEvent *event) override
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (handled_ == 0) {
+      started_ = true;
+      cond_.notify_all();
+      cond_.wait(lock, [this]() { return opened_; });
+    }
+    handled_++;
+    cond_.notify_all();
+    lock.unlock();
+    event->done_immediate();
+  }
+  void handle_events(StageEvent **events, int n) override
+  {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      batches_.push_back(n);
+    }
+    Stage::handle_events(events, n);
+  }
+  void callback_event(StageEvent *event, CallbackContext *context) override
+  {}
+
+  void wait_started()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return started_; });
+  }
+  void open()
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    opened_ = true;
+    cond_.notify_all();
+  }
+  void wait_handled(int count)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this, count]() { return handled_ >= count; });
+  }
+  std::vector<int> batches()
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return batches_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  int handled_ = 0;
+  bool started_ = false;
+  bool opened_ = false;
+  std::vector<int> batches_;
+};
+
+TEST(StageBatchTest, batch)
+{
+  Threadpool::create_pool_key();
+  for (bool work_stealing : {false, true}) {
+    Threadpool *pool = new Threadpool(1, "test", work_stealing);
+    BatchStage *stage = new BatchStage();
+    stage->set_max_batch(4);
+    ASSERT_EQ(4, stage->max_batch());
+    stage->set_pool(pool);
+    ASSERT_TRUE(stage->connect());
+
+    // 唯一的线程被第一个事件占住，后面的5个事件排队，放开之后4个一批，剩下一个单独处理
+    stage->add_event(new StageEvent());
+    stage->wait_started();
+    for (int i = 0; i < 5; i++) {
+      stage->add_event(new StageEvent());
+    }
+    // 低优先级的事件不会被拿到批里
+    StageEvent *low_event = new StageEvent();
+    low_event->set_priority(StageEvent::LOW_PRIORITY);
+    stage->add_event(low_event);
+    stage->open();
+    stage->wait_handled(7);
+    ASSERT_EQ(std::vector<int>{4}, stage->batches());
+
+    // 被批处理拿走的事件的调度都跳过了，之后的事件照常处理
+    stage->add_event(new StageEvent());
+    stage->wait_handled(8);
+
+    stage->disconnect();
+    ASSERT_EQ(0u, stage->qlen());
+    delete stage;
+    delete pool;
+  }
+}
+
+TEST(StageBatchTest, max_batch)
+{
+  BatchStage stage;
+  ASSERT_EQ(1, stage.max_batch());
+  stage.set_max_batch(0);
+  ASSERT_EQ(1, stage.max_batch());
+  stage.set_max_batch(Stage::MAX_EVENT_BATCH + 1);
+  ASSERT_EQ(Stage::MAX_EVENT_BATCH, stage.max_batch());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
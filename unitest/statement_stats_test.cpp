@@ -0,0 +1,93 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the statement statistics table.
+//
+
+#include <sstream>
+#include <string>
+
+#include "session/statement_stats.h"
+#include "gtest/gtest.h"
+
+TEST(StatementStatsTest, key)
+{
+  ASSERT_EQ("select * from t where id = ? and s = ?;",
+      StatementStatsTable::statement_key("select *  from t\nwhere id = 12 and s = 'abc';"));
+  // 不能参数化的语句只合并空白
+  ASSERT_EQ("create table t(id int);", StatementStatsTable::statement_key("  create table\tt(id int);"));
+}
+
+TEST(StatementStatsTest, record)
+{
+  StatementStatsTable table;
+  for (int i = 0; i < 100; i++)
+  {
+    const std::string sql = "select * from t where id = " + std::to_string(i) + ";";
+    table.record("sys", sql.c_str(), i < 99 ? 10 : 5000, 1, 100, i < 99 ? 0 : 3);
+  }
+  table.record("sys", "insert into t values(1);", 20000, 0, 0, 0);
+  table.record("other", "select * from t where id = 1;", 1, 0, 0, 0);
+  ASSERT_EQ(3, table.size());
+
+  std::vector<StatementStats> top = table.top(10);
+  ASSERT_EQ(3, top.size());
+  ASSERT_EQ("insert into t values(?);", top[0].sql);
+
+  const StatementStats &select = top[1];
+  ASSERT_EQ("sys", select.db);
+  ASSERT_EQ("select * from t where id = ?;", select.sql);
+  ASSERT_EQ(100, select.calls);
+  ASSERT_EQ(99 * 10 + 5000, select.total_us);
+  ASSERT_EQ(5000, select.max_us);
+  ASSERT_EQ(100, select.rows_sent);
+  ASSERT_EQ(10000, select.rows_examined);
+  ASSERT_EQ(3, select.pages_read);
+  // 10us在[8, 16)中，p99是最慢的那一次
+  ASSERT_EQ(16, select.quantile_us(0.5));
+  ASSERT_EQ(5000, select.quantile_us(0.99));
+
+  ASSERT_EQ("other", top[2].db);
+  ASSERT_EQ(1, table.top(1).size());
+
+  std::stringstream ss;
+  table.dump(ss);
+  ASSERT_NE(std::string::npos, ss.str().find("5990 | 100 | 59 | 5000 | 5000 | 100 | 10000 | 3 | sys | select"));
+
+  table.reset();
+  ASSERT_EQ(0, table.size());
+  ASSERT_TRUE(table.top(10).empty());
+}
+
+TEST(StatementStatsTest, evict)
+{
+  // 每个分片最多两个语句，总耗时少的语句被淘汰
+  StatementStatsTable table(STATEMENT_STATS_SHARDS * 2);
+  table.record("sys", "select * from t;", 1000000, 0, 0, 0);
+  for (int i = 0; i < 1000; i++)
+  {
+    const std::string sql = "select * from t" + std::to_string(i) + ";";
+    table.record("sys", sql.c_str(), 10, 0, 0, 0);
+  }
+  ASSERT_LE(table.size(), STATEMENT_STATS_SHARDS * 2);
+  ASSERT_EQ("select * from t;", table.top(1)[0].sql);
+
+  table.set_capacity(0);
+  ASSERT_FALSE(table.enabled());
+  table.record("sys", "select * from t;", 10, 0, 0, 0);
+  ASSERT_EQ(0, table.size());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,83 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the striped counter and the metrics built on it.
+//
+
+#include <stdint.h>
+
+#include <thread>
+#include <vector>
+
+#include "common/metrics/metrics.h"
+#include "common/metrics/striped_counter.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+TEST(StripedCounterTest, layout)
+{
+  // 每个stripe占一个cache line
+  StripedCounter counter;
+  ASSERT_EQ(STRIPED_COUNTER_STRIPES * CACHE_LINE_SIZE, sizeof(counter));
+  ASSERT_EQ(0u, (uintptr_t)&counter % CACHE_LINE_SIZE);
+
+  StripedCounter *heap_counter = new StripedCounter();
+  ASSERT_EQ(0u, (uintptr_t)heap_counter % CACHE_LINE_SIZE);
+  delete heap_counter;
+}
+
+TEST(StripedCounterTest, concurrent)
+{
+  StripedCounter counter;
+  const int thread_num = 8;
+  const int count = 100000;
+  std::vector<std::thread> threads;
+  std::vector<long> taken(thread_num, 0);
+  for (int t = 0; t < thread_num; t++) {
+    threads.emplace_back([&counter, &taken, t]() {
+      for (int i = 0; i < count; i++) {
+        counter.add(2);
+        // 同时take，加上的数要么这次取走，要么留给下一次
+        if (t == 0 && i % 1000 == 0) {
+          taken[t] += counter.take();
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(2L * thread_num * count, taken[0] + counter.sum());
+  ASSERT_EQ(2L * thread_num * count - taken[0], counter.take());
+  ASSERT_EQ(0, counter.sum());
+}
+
+TEST(StripedCounterTest, counter_metric)
+{
+  Counter counter;
+  counter.inc();
+  counter.inc(10);
+  ASSERT_EQ(11, counter.value());
+  counter.snapshot();
+  ASSERT_EQ("11", counter.get_snapshot()->to_string());
+
+  // 计数一直累加，不随snapshot清零
+  counter.inc();
+  counter.snapshot();
+  ASSERT_EQ("12", counter.get_snapshot()->to_string());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,372 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for keeping the indexes of a table in step with its records.
+//
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "storage/common/condition_filter.h"
+#include "storage/common/index.h"
+#include "storage/common/table.h"
+#include "storage/common/table_scanner.h"
+#include "storage/trx/trx.h"
+#include "gtest/gtest.h"
+
+#define TEST_DIR "table_index_test_dir"
+
+typedef std::vector<std::pair<std::string, RID>> IndexEntries;
+
+/**
+ * 按索引的顺序列出所有的索引项
+ */
+static IndexEntries index_entries(Index *index)
+{
+  IndexEntries entries;
+  IndexScanner *scanner = index->create_range_scanner(nullptr, 0, false, nullptr, 0, false);
+  EXPECT_NE(nullptr, scanner);
+  std::vector<char> key(index->key_length());
+  RID rid;
+  while (scanner->next_entry(&rid, key.data()) == RC::SUCCESS)
+  {
+    entries.emplace_back(std::string(key.data(), key.size()), rid);
+  }
+  scanner->destroy();
+  return entries;
+}
+
+static std::string int_key(int value)
+{
+  return std::string((const char *)&value, sizeof(value));
+}
+
+/**
+ * 索引中rid的所有键
+ */
+static std::vector<std::string> keys_of(const IndexEntries &entries, const RID &rid)
+{
+  std::vector<std::string> keys;
+  for (const auto &entry : entries)
+  {
+    if (entry.second == rid)
+    {
+      keys.push_back(entry.first);
+    }
+  }
+  return keys;
+}
+
+class TableIndexTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    system("rm -rf " TEST_DIR " && mkdir -p " TEST_DIR);
+    // id和v上有索引，name上没有，v可以为null
+    AttrInfo attributes[] = {
+        {(char *)"id", INTS, 4, 0, 0},
+        {(char *)"name", CHARS, 8, 0, 0},
+        {(char *)"v", INTS, 4, 1, 0},
+    };
+    ASSERT_EQ(RC::SUCCESS, table_.create(TEST_DIR "/t.table", "t", TEST_DIR, 3, attributes));
+    const char *id_field[] = {"id"};
+    const char *v_field[] = {"v"};
+    Trx trx;
+    ASSERT_EQ(RC::SUCCESS, table_.create_index(&trx, "i_id", 1, id_field));
+    ASSERT_EQ(RC::SUCCESS, table_.create_index(&trx, "i_v", 1, v_field));
+    ASSERT_EQ(RC::SUCCESS, trx.commit());
+    id_index_ = table_.find_index_for_lookup("id");
+    v_index_ = table_.find_index_for_lookup("v");
+    ASSERT_NE(nullptr, id_index_);
+    ASSERT_NE(nullptr, v_index_);
+
+    // 第i行的id是i，v是i * 10，第3行的v是null
+    for (int i = 1; i <= 5; i++)
+    {
+      insert(i, i == 3 ? nullptr : &(values_[i] = i * 10));
+    }
+  }
+
+  void TearDown() override
+  {
+    table_.sync();
+    system("rm -rf " TEST_DIR);
+  }
+
+  void insert(int id, const int *v)
+  {
+    int zero = 0;
+    Value values[] = {
+        {INTS, &id, 0},
+        {CHARS, (void *)"name", 0},
+        {INTS, v == nullptr ? &zero : (void *)v, v == nullptr},
+    };
+    Trx trx;
+    Record *record = nullptr;
+    ASSERT_EQ(RC::SUCCESS, table_.insert_record(&trx, 3, values, &record));
+    rids_[id] = record->rid;
+    ASSERT_EQ(RC::SUCCESS, trx.commit());
+  }
+
+  /**
+   * id = *id的条件，条件中引用了id
+   */
+  static void id_condition(int *id, Condition *condition)
+  {
+    RelAttr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.attribute_name = (char *)"id";
+    Value id_value = {INTS, id, 0};
+    memset(condition, 0, sizeof(*condition));
+    condition_init(condition, EQUAL_TO, 1, &attr, nullptr, 0, nullptr, &id_value);
+  }
+
+  /**
+   * 把id为id的记录的attribute改成value，value为nullptr时改成null
+   */
+  RC update(Trx &trx, int id, const char *attribute, AttrType type, const void *value)
+  {
+    Condition condition;
+    id_condition(&id, &condition);
+    Value new_value = {type, (void *)value, value == nullptr};
+    int zero = 0;
+    if (value == nullptr)
+    {
+      new_value.data = &zero;
+    }
+    int updated = 0;
+    RC rc = table_.update_record(&trx, attribute, &new_value, 1, &condition, &updated);
+    EXPECT_EQ(rc == RC::SUCCESS ? 1 : 0, updated);
+    return rc;
+  }
+
+  RC remove(Trx &trx, int id)
+  {
+    Condition condition;
+    id_condition(&id, &condition);
+    DefaultConditionFilter filter;
+    RC rc = filter.init(table_, condition);
+    if (rc != RC::SUCCESS)
+    {
+      return rc;
+    }
+    int deleted = 0;
+    rc = table_.delete_record(&trx, &filter, &deleted);
+    EXPECT_EQ(rc == RC::SUCCESS ? 1 : 0, deleted);
+    return rc;
+  }
+
+  /**
+   * 扫描表中所有的记录，生成fields上的索引应该有的索引项，排好序
+   */
+  IndexEntries scan_entries(const std::vector<const char *> &fields)
+  {
+    struct Context
+    {
+      std::vector<const FieldMeta *> fields;
+      TableScanner *scanner;
+      IndexEntries entries;
+    };
+    TableScanner scanner;
+    Context context = {{}, &scanner, {}};
+    for (const char *field : fields)
+    {
+      context.fields.push_back(table_.table_meta().field(field));
+    }
+    EXPECT_EQ(RC::SUCCESS, scanner.open(nullptr, &table_, nullptr, -1));
+    RC rc = RC::SUCCESS;
+    while ((rc = scanner.next_batch(&context, [](const char *data, void *ctx) {
+              Context &context = *(Context *)ctx;
+              std::string key;
+              for (const FieldMeta *field : context.fields)
+              {
+                key.append(data + field->offset(), field->len());
+              }
+              context.entries.emplace_back(key, context.scanner->current_rid());
+            })) == RC::SUCCESS)
+    {
+    }
+    EXPECT_EQ(RC::RECORD_EOF, rc);
+    scanner.close();
+    std::sort(context.entries.begin(), context.entries.end());
+    return context.entries;
+  }
+
+protected:
+  Table table_;
+  Index *id_index_ = nullptr;
+  Index *v_index_ = nullptr;
+  int values_[6] = {0};
+  std::map<int, RID> rids_;
+};
+
+TEST_F(TableIndexTest, update_non_indexed_field)
+{
+  const IndexEntries id_entries = index_entries(id_index_);
+  const IndexEntries v_entries = index_entries(v_index_);
+  ASSERT_EQ(5u, id_entries.size());
+
+  Trx trx;
+  ASSERT_EQ(RC::SUCCESS, update(trx, 2, "name", CHARS, "other"));
+  ASSERT_EQ(RC::SUCCESS, trx.commit());
+  ASSERT_EQ(id_entries, index_entries(id_index_));
+  ASSERT_EQ(v_entries, index_entries(v_index_));
+}
+
+TEST_F(TableIndexTest, update_same_value)
+{
+  const IndexEntries id_entries = index_entries(id_index_);
+  const IndexEntries v_entries = index_entries(v_index_);
+
+  Trx trx;
+  int v = 40;
+  ASSERT_EQ(RC::SUCCESS, update(trx, 4, "v", INTS, &v));
+  ASSERT_EQ(RC::SUCCESS, trx.commit());
+  ASSERT_EQ(id_entries, index_entries(id_index_));
+  ASSERT_EQ(v_entries, index_entries(v_index_));
+}
+
+TEST_F(TableIndexTest, update_null_to_value)
+{
+  // 第3行的v是null，字段中的值和0相同，只有null标志不同
+  Trx trx;
+  int v = 0;
+  ASSERT_EQ(RC::SUCCESS, update(trx, 3, "v", INTS, &v));
+  ASSERT_EQ(RC::SUCCESS, trx.commit());
+  IndexEntries entries = index_entries(v_index_);
+  ASSERT_EQ(5u, entries.size());
+  ASSERT_EQ(std::vector<std::string>{int_key(0)}, keys_of(entries, rids_[3]));
+
+  // 再改回null，然后改成非0的值
+  Trx trx2;
+  ASSERT_EQ(RC::SUCCESS, update(trx2, 3, "v", INTS, nullptr));
+  int v2 = 35;
+  ASSERT_EQ(RC::SUCCESS, update(trx2, 3, "v", INTS, &v2));
+  ASSERT_EQ(RC::SUCCESS, trx2.commit());
+  entries = index_entries(v_index_);
+  ASSERT_EQ(5u, entries.size());
+  ASSERT_EQ(std::vector<std::string>{int_key(35)}, keys_of(entries, rids_[3]));
+  // 其它记录的索引项不变
+  ASSERT_EQ(std::vector<std::string>{int_key(40)}, keys_of(entries, rids_[4]));
+}
+
+TEST_F(TableIndexTest, rollback_indexed_update)
+{
+  const IndexEntries id_entries = index_entries(id_index_);
+  const IndexEntries v_entries = index_entries(v_index_);
+
+  Trx trx;
+  int id = 100;
+  int v = 7;
+  ASSERT_EQ(RC::SUCCESS, update(trx, 2, "v", INTS, &v));
+  ASSERT_EQ(RC::SUCCESS, update(trx, 2, "id", INTS, &id));
+  ASSERT_EQ(std::vector<std::string>{int_key(100)}, keys_of(index_entries(id_index_), rids_[2]));
+  ASSERT_EQ(std::vector<std::string>{int_key(7)}, keys_of(index_entries(v_index_), rids_[2]));
+
+  // 回滚之后索引项指回原来的键
+  ASSERT_EQ(RC::SUCCESS, trx.rollback());
+  ASSERT_EQ(id_entries, index_entries(id_index_));
+  ASSERT_EQ(v_entries, index_entries(v_index_));
+  ASSERT_EQ(std::vector<std::string>{int_key(2)}, keys_of(index_entries(id_index_), rids_[2]));
+}
+
+TEST_F(TableIndexTest, build_index_during_writes)
+{
+  const int row_num = 20000;
+  for (int i = 6; i <= row_num; i++)
+  {
+    insert(i, &i);
+  }
+
+  // 一个线程不停地插入、更新和删除，同时在线创建name和v上的索引
+  std::atomic<bool> stop(false);
+  std::atomic<int> operations(0);
+  std::thread writer([&]() {
+    std::vector<int> ids;
+    for (int i = 1; i <= row_num; i++)
+    {
+      ids.push_back(i);
+    }
+    int next_id = row_num + 1;
+    for (int i = 0; !stop; i++)
+    {
+      Trx trx;
+      char name[8];
+      snprintf(name, sizeof(name), "n%d", i % 100000);
+      int v = i;
+      RC rc = RC::SUCCESS;
+      switch (i % 4)
+      {
+        case 0:
+          ids.push_back(next_id);
+          insert(next_id++, &v);
+          break;
+        case 1:
+          rc = update(trx, ids[(i * 7) % ids.size()], "name", CHARS, name);
+          break;
+        case 2:
+          rc = update(trx, ids[(i * 11) % ids.size()], "v", INTS, i % 5 == 0 ? nullptr : &v);
+          break;
+        default:
+        {
+          size_t victim = (i * 13) % ids.size();
+          rc = remove(trx, ids[victim]);
+          ids[victim] = ids.back();
+          ids.pop_back();
+          break;
+        }
+      }
+      ASSERT_EQ(RC::SUCCESS, rc);
+      ASSERT_EQ(RC::SUCCESS, trx.commit());
+      operations++;
+    }
+  });
+
+  // 等写线程做了一些修改再开始创建，发布之后的修改也要维护新的索引
+  while (operations < 100)
+  {
+    std::this_thread::yield();
+  }
+  const std::vector<const char *> fields = {"name", "v"};
+  Trx trx;
+  ASSERT_EQ(RC::SUCCESS, table_.create_index(&trx, "i_name_v", (int)fields.size(), fields.data()));
+  ASSERT_EQ(RC::SUCCESS, trx.commit());
+  const int built = operations;
+  while (operations < built + 100)
+  {
+    std::this_thread::yield();
+  }
+  stop = true;
+  writer.join();
+
+  Index *index = table_.find_index_for_lookup("name");
+  ASSERT_NE(nullptr, index);
+  IndexEntries entries = index_entries(index);
+  std::sort(entries.begin(), entries.end());
+  ASSERT_EQ(scan_entries(fields), entries);
+  IndexEntries id_entries = index_entries(id_index_);
+  std::sort(id_entries.begin(), id_entries.end());
+  ASSERT_EQ(scan_entries({"id"}), id_entries);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,195 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for resizing thread pools by their backlog.
+//
+
+#include <unistd.h>
+
+#include <condition_variable>
+#include <mutex>
+
+#include "common/seda/stage.h"
+#include "common/seda/thread_pool.h"
+#include "common/seda/thread_pool_autoscaler.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+static ThreadpoolAutoscaler::Sample make_sample(unsigned int threads, int backlog, unsigned int idle_threads)
+{
+  ThreadpoolAutoscaler::Sample sample;
+  sample.threads = threads;
+  sample.min_threads = 2;
+  sample.max_threads = 16;
+  sample.cpus = 4;
+  sample.backlog = backlog;
+  sample.idle_threads = idle_threads;
+  sample.interval_us = 1000000;
+  sample.busy_us = threads * sample.interval_us;
+  sample.cpu_us = sample.busy_us;
+  return sample;
+}
+
+TEST(ThreadpoolAutoscalerTest, grow)
+{
+  int rounds = 0;
+  // 有等待的请求并且没有空闲线程，最多增加一倍
+  ASSERT_EQ(2, ThreadpoolAutoscaler::decide(make_sample(2, 10, 0), rounds));
+  ASSERT_EQ(1, ThreadpoolAutoscaler::decide(make_sample(3, 1, 0), rounds));
+  ASSERT_EQ(0, ThreadpoolAutoscaler::decide(make_sample(2, 10, 1), rounds));
+  ASSERT_EQ(0, ThreadpoolAutoscaler::decide(make_sample(2, 0, 0), rounds));
+
+  // 计算密集时不超过cpu个数
+  ASSERT_EQ(0, ThreadpoolAutoscaler::decide(make_sample(4, 10, 0), rounds));
+  ThreadpoolAutoscaler::Sample sample = make_sample(3, 10, 0);
+  ASSERT_EQ(1, ThreadpoolAutoscaler::decide(sample, rounds));
+
+  // 线程大部分时间在等IO时可以超过cpu个数，但是不超过上限
+  sample = make_sample(4, 10, 0);
+  sample.cpu_us = sample.busy_us / 4;
+  ASSERT_EQ(4, ThreadpoolAutoscaler::decide(sample, rounds));
+  sample = make_sample(14, 10, 0);
+  sample.cpu_us = 0;
+  ASSERT_EQ(2, ThreadpoolAutoscaler::decide(sample, rounds));
+  sample = make_sample(16, 10, 0);
+  sample.cpu_us = 0;
+  ASSERT_EQ(0, ThreadpoolAutoscaler::decide(sample, rounds));
+  // 所有线程都卡在一个事件上，一个事件也没有处理完
+  sample = make_sample(4, 10, 0);
+  sample.busy_us = sample.cpu_us = 0;
+  ASSERT_EQ(4, ThreadpoolAutoscaler::decide(sample, rounds));
+
+  // 回到上下限之内
+  ASSERT_EQ(1, ThreadpoolAutoscaler::decide(make_sample(1, 0, 1), rounds));
+  ASSERT_EQ(-2, ThreadpoolAutoscaler::decide(make_sample(18, 0, 1), rounds));
+}
+
+TEST(ThreadpoolAutoscalerTest, shrink)
+{
+  int rounds = 0;
+  ThreadpoolAutoscaler::Sample idle = make_sample(4, 0, 3);
+  idle.busy_us = idle.cpu_us = idle.interval_us;
+  for (int i = 1; i < AUTOSCALE_SHRINK_ROUNDS; i++) {
+    ASSERT_EQ(0, ThreadpoolAutoscaler::decide(idle, rounds));
+  }
+  // 中间忙了一次就重新计数
+  ASSERT_EQ(0, ThreadpoolAutoscaler::decide(make_sample(4, 0, 0), rounds));
+  ASSERT_EQ(0, rounds);
+  for (int i = 1; i < AUTOSCALE_SHRINK_ROUNDS; i++) {
+    ASSERT_EQ(0, ThreadpoolAutoscaler::decide(idle, rounds));
+  }
+  ASSERT_EQ(-1, ThreadpoolAutoscaler::decide(idle, rounds));
+
+  // 不低于下限
+  rounds = 0;
+  ThreadpoolAutoscaler::Sample min_idle = make_sample(2, 0, 2);
+  min_idle.busy_us = min_idle.cpu_us = 0;
+  for (int i = 0; i < AUTOSCALE_SHRINK_ROUNDS * 2; i++) {
+    ASSERT_EQ(0, ThreadpoolAutoscaler::decide(min_idle, rounds));
+  }
+}
+
+/**
+ * 每个事件等到open之后才处理完
+ */
+class BlockStage : public Stage {
+public:
+  BlockStage() : Stage("BlockStage")
+  {}
+
+  void handle_event(StageEvent *event) override
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    started_++;
+    cond_.notify_all();
+    cond_.wait(lock, [this]() { return opened_; });
+    handled_++;
+    cond_.notify_all();
+    lock.unlock();
+    event->done_immediate();
+  }
+  void callback_event(StageEvent *event, CallbackContext *context) override
+  {}
+
+  void wait_started(int count)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this, count]() { return started_ >= count; });
+  }
+  void open()
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    opened_ = true;
+    cond_.notify_all();
+  }
+  void wait_handled(int count)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this, count]() { return handled_ >= count; });
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  int started_ = 0;
+  int handled_ = 0;
+  bool opened_ = false;
+};
+
+TEST(ThreadpoolAutoscalerTest, resize_pool)
+{
+  Threadpool::create_pool_key();
+  for (bool work_stealing : {false, true}) {
+    Threadpool *pool = new Threadpool(1, "test", work_stealing);
+    pool->set_thread_limits(1, 2);
+    BlockStage *stage = new BlockStage();
+    stage->set_pool(pool);
+    ASSERT_TRUE(stage->connect());
+    ThreadpoolAutoscaler autoscaler;
+    autoscaler.add_pool(pool);
+
+    // 唯一的线程被占住，另一个事件在排队，即使只有一个cpu也要加线程
+    stage->add_event(new StageEvent());
+    stage->add_event(new StageEvent());
+    stage->wait_started(1);
+    ASSERT_EQ(1, pool->backlog());
+    usleep(1000);
+    autoscaler.check();
+    ASSERT_EQ(2u, pool->num_threads());
+    stage->wait_started(2);
+    stage->open();
+    stage->wait_handled(2);
+
+    // 空闲一段时间之后回到下限，第一次检查时可能还算上了处理事件的时间
+    for (int i = 0; i < AUTOSCALE_SHRINK_ROUNDS * 2 && pool->num_threads() > 1; i++) {
+      usleep(1000);
+      autoscaler.check();
+    }
+    ASSERT_EQ(1u, pool->num_threads());
+
+    // 被结束的线程的deque由新的线程接着使用
+    pool->add_threads(1);
+    ASSERT_EQ(2u, pool->num_threads());
+    stage->add_event(new StageEvent());
+    stage->wait_handled(3);
+
+    stage->disconnect();
+    delete stage;
+    delete pool;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
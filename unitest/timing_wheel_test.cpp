@@ -0,0 +1,147 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the timing wheel of the timer stage.
+//
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "common/seda/timing_wheel.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+// 用指针的值当作事件，测试里不会解引用
+static StageEvent *event_of(u64_t id)
+{
+  return (StageEvent *)(id + 1);
+}
+
+static u64_t id_of(StageEvent *event)
+{
+  return (u64_t)event - 1;
+}
+
+TEST(TimingWheelTest, basic)
+{
+  TimingWheel wheel(100);
+  u64_t tick = 0;
+  ASSERT_FALSE(wheel.next_tick(tick));
+
+  ASSERT_TRUE(wheel.add(1, 105, event_of(1)));
+  ASSERT_TRUE(wheel.add(2, 103, event_of(2)));
+  ASSERT_TRUE(wheel.add(3, 50, event_of(3)));  // 已经过期
+  ASSERT_FALSE(wheel.add(3, 200, event_of(3)));
+  ASSERT_EQ(3u, wheel.size());
+  ASSERT_TRUE(wheel.next_tick(tick));
+  ASSERT_EQ(100u, tick);
+
+  std::vector<StageEvent *> expired;
+  wheel.advance(102, expired);
+  ASSERT_EQ(1u, expired.size());
+  ASSERT_EQ(event_of(3), expired[0]);
+
+  ASSERT_EQ(event_of(1), wheel.remove(1));
+  ASSERT_EQ(nullptr, wheel.remove(1));
+
+  expired.clear();
+  wheel.advance(200, expired);
+  ASSERT_EQ(1u, expired.size());
+  ASSERT_EQ(event_of(2), expired[0]);
+  ASSERT_EQ(0u, wheel.size());
+  ASSERT_EQ(201u, wheel.current_tick());
+}
+
+TEST(TimingWheelTest, random)
+{
+  // 和按时间排序的map的结果比较，覆盖各级时间轮之间的迁移
+  srand(11);
+  const u64_t start = 12345;
+  TimingWheel wheel(start);
+  std::multimap<u64_t, u64_t> expected;  // expire -> id
+  std::map<u64_t, u64_t> expires;       // id -> expire
+  u64_t now = start;
+  u64_t next_id = 0;
+  for (int round = 0; round < 2000; round++) {
+    const int op = rand() % 10;
+    if (op < 6) {
+      u64_t delay = 0;
+      switch (rand() % 4) {
+        case 0: delay = rand() % 300; break;
+        case 1: delay = rand() % 70000; break;
+        case 2: delay = rand() % 20000000; break;
+        default: delay = (u64_t)rand() * 8; break;
+      }
+      const u64_t id = next_id++;
+      ASSERT_TRUE(wheel.add(id, now + delay, event_of(id)));
+      expected.insert(std::make_pair(now + delay, id));
+      expires[id] = now + delay;
+    } else if (op < 8 && !expires.empty()) {
+      auto it = expires.begin();
+      std::advance(it, rand() % expires.size());
+      const u64_t id = it->first;
+      ASSERT_EQ(event_of(id), wheel.remove(id));
+      auto range = expected.equal_range(it->second);
+      for (auto e = range.first; e != range.second; ++e) {
+        if (e->second == id) {
+          expected.erase(e);
+          break;
+        }
+      }
+      expires.erase(it);
+    } else {
+      u64_t step = rand() % 4 == 0 ? (u64_t)rand() % 5000000 : rand() % 1000;
+      u64_t tick = 0;
+      if (rand() % 2 == 0 && wheel.next_tick(tick) && tick > now) {
+        // 按照next_tick前进时不能错过任何事件，已经过了的时间在current_tick触发
+        ASSERT_TRUE(expected.empty() || std::max(expected.begin()->first, wheel.current_tick()) >= tick)
+            << "round=" << round << " first=" << expected.begin()->first << " tick=" << tick << " now=" << now;
+        step = tick - now;
+      }
+      now += step;
+      std::vector<StageEvent *> expired;
+      wheel.advance(now, expired);
+      size_t count = 0;
+      for (auto it = expected.begin(); it != expected.end() && it->first <= now; ++it) {
+        count++;
+      }
+      ASSERT_EQ(count, expired.size()) << "round=" << round;
+      for (StageEvent *event : expired) {
+        const u64_t id = id_of(event);
+        ASSERT_LE(expires[id], now);
+        auto range = expected.equal_range(expires[id]);
+        for (auto e = range.first; e != range.second; ++e) {
+          if (e->second == id) {
+            expected.erase(e);
+            break;
+          }
+        }
+        expires.erase(id);
+      }
+    }
+    ASSERT_EQ(expected.size(), wheel.size());
+  }
+
+  std::vector<StageEvent *> events;
+  wheel.clear(events);
+  ASSERT_EQ(expected.size(), events.size());
+  ASSERT_EQ(0u, wheel.size());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
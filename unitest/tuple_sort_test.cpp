@@ -0,0 +1,163 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for normalized sort keys and external sort runs.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "sql/executor/tuple_sort.h"
+#include "gtest/gtest.h"
+
+static std::string int_key(int value, bool is_null, bool desc)
+{
+  Tuple tuple;
+  tuple.add(value, is_null);
+  std::string key;
+  make_sort_key(tuple, {SortField{0, INTS, desc}}, key);
+  return key;
+}
+
+static std::string float_key(float value, bool desc)
+{
+  Tuple tuple;
+  tuple.add(value);
+  std::string key;
+  make_sort_key(tuple, {SortField{0, FLOATS, desc}}, key);
+  return key;
+}
+
+static std::string chars_key(const char *value, bool desc)
+{
+  Tuple tuple;
+  tuple.add(value, strlen(value));
+  std::string key;
+  make_sort_key(tuple, {SortField{0, CHARS, desc}}, key);
+  return key;
+}
+
+TEST(TupleSortTest, key_order)
+{
+  EXPECT_LT(int_key(-5, false, false), int_key(-1, false, false));
+  EXPECT_LT(int_key(-1, false, false), int_key(0, false, false));
+  EXPECT_LT(int_key(0, false, false), int_key(300, false, false));
+  EXPECT_GT(int_key(-1, false, true), int_key(300, false, true));
+
+  EXPECT_LT(float_key(-2.5f, false), float_key(-0.5f, false));
+  EXPECT_LT(float_key(-0.5f, false), float_key(0.0f, false));
+  EXPECT_EQ(float_key(-0.0f, false), float_key(0.0f, false));
+  EXPECT_LT(float_key(0.25f, false), float_key(10.0f, false));
+  EXPECT_GT(float_key(0.25f, true), float_key(10.0f, true));
+
+  EXPECT_LT(chars_key("ab", false), chars_key("abc", false));
+  EXPECT_LT(chars_key("abc", false), chars_key("b", false));
+  EXPECT_LT(chars_key("2021-01-31", false), chars_key("2021-02-01", false));
+  EXPECT_GT(chars_key("ab", true), chars_key("abc", true));
+
+  // NULL最小，降序时排在最后
+  EXPECT_LT(int_key(0, true, false), int_key(-100, false, false));
+  EXPECT_GT(int_key(0, true, true), int_key(-100, false, true));
+}
+
+TEST(TupleSortTest, multiple_fields)
+{
+  std::vector<SortField> fields = {SortField{0, CHARS, false}, SortField{1, INTS, true}};
+  auto make_key = [&fields](const char *name, int value) {
+    Tuple tuple;
+    tuple.add(name, strlen(name));
+    tuple.add(value);
+    std::string key;
+    make_sort_key(tuple, fields, key);
+    return key;
+  };
+  EXPECT_LT(make_key("a", 9), make_key("a", 1));
+  EXPECT_LT(make_key("a", 1), make_key("ab", 9));
+  EXPECT_LT(make_key("ab", 9), make_key("b", 100));
+}
+
+TEST(TupleSortTest, parallel_sort)
+{
+  const int num = SORT_PARALLEL_THRESHOLD * 3 + 17;
+  std::vector<SortEntry> entries(num);
+  srand(7);
+  for (int i = 0; i < num; i++) {
+    Tuple tuple;
+    tuple.add(rand() % 1000, i % 97 == 0);
+    make_sort_key(tuple, {SortField{0, INTS, false}}, entries[i].key);
+    entries[i].index = i;
+  }
+  std::vector<SortEntry> expected = entries;
+  std::stable_sort(expected.begin(), expected.end(),
+      [](const SortEntry &a, const SortEntry &b) { return a.key < b.key; });
+
+  sort_entries(entries);
+  ASSERT_EQ(expected.size(), entries.size());
+  for (int i = 0; i < num; i++) {
+    ASSERT_EQ(expected[i].index, entries[i].index);
+  }
+}
+
+TEST(TupleSortTest, merge_runs)
+{
+  TupleSchema schema;
+  schema.add(INTS, "t", "id");
+  schema.add(FLOATS, "t", "score", true);
+  schema.add(CHARS, "t", "name");
+  std::vector<SortField> fields = {SortField{0, INTS, false}};
+
+  // 第一段是偶数，第二段是奇数，两段都有id为4的行
+  std::vector<FILE *> runs;
+  for (int run = 0; run < 2; run++) {
+    FILE *file = tmpfile();
+    ASSERT_NE(nullptr, file);
+    for (int id = run; id < 10; id += 2) {
+      Tuple tuple;
+      tuple.add(id == 5 ? 4 : id);
+      tuple.add(id * 0.5f, id == 3);
+      std::string name = "n" + std::to_string(id);
+      tuple.add(name.c_str(), name.size());
+      std::string key;
+      make_sort_key(tuple, fields, key);
+      ASSERT_EQ(RC::SUCCESS, write_sort_row(file, key, tuple, schema));
+    }
+    runs.push_back(file);
+  }
+
+  SortRunMerger merger;
+  ASSERT_EQ(RC::SUCCESS, merger.init(schema, runs));
+  std::vector<std::string> names;
+  std::string key;
+  Tuple tuple;
+  RC rc = RC::SUCCESS;
+  while ((rc = merger.next(key, tuple)) == RC::SUCCESS) {
+    std::stringstream ss;
+    TupleSet::print_tuple(ss, tuple);
+    names.push_back(ss.str());
+  }
+  ASSERT_EQ(RC::RECORD_EOF, rc);
+  std::vector<std::string> expected = {"0 | 0 | n0\n", "1 | 0.5 | n1\n", "2 | 1 | n2\n", "3 | NULL | n3\n",
+      "4 | 2 | n4\n", "4 | 2.5 | n5\n", "6 | 3 | n6\n", "7 | 3.5 | n7\n", "8 | 4 | n8\n", "9 | 4.5 | n9\n"};
+  ASSERT_EQ(expected, names);
+  for (FILE *file : runs) {
+    fclose(file);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
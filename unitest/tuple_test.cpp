@@ -0,0 +1,151 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for inline tuple values.
+//
+
+#include <sstream>
+
+#include "sql/executor/tuple.h"
+#include "net/wire_protocol.h"
+#include "gtest/gtest.h"
+
+static std::string to_string(const Tuple &tuple)
+{
+  std::stringstream ss;
+  TupleSet::print_tuple(ss, tuple);
+  return ss.str();
+}
+
+TEST(TupleTest, add_and_print)
+{
+  Tuple tuple;
+  tuple.add(-3);
+  tuple.add(17.101f);
+  tuple.add("apple", 5);
+  tuple.add("NULL", 4, true);
+  tuple.add(2.0f);
+  ASSERT_EQ(5, tuple.size());
+  ASSERT_EQ(-3, tuple.get_int(0));
+  ASSERT_STREQ("apple", tuple.get_string(2));
+  ASSERT_EQ(5, tuple.get_len(2));
+  ASSERT_TRUE(tuple.is_null(3));
+  ASSERT_EQ("-3 | 17.1 | apple | NULL | 2\n", to_string(tuple));
+}
+
+TEST(TupleTest, format)
+{
+  Tuple tuple;
+  tuple.add(2147483647);
+  tuple.add(-2147483647 - 1);
+  tuple.add(0.0f);
+  tuple.add(-0.004f);
+  tuple.add(1.005f);
+  tuple.add(99.995f);
+  tuple.add(-12.5f);
+  tuple.add(3.4e38f);
+  std::string out;
+  TupleSet::append_tuple(out, tuple);
+  // 和printf("%.2f")的舍入相同
+  ASSERT_EQ("2147483647 | -2147483648 | 0 | -0 | 1 | 100 | -12.5 | "
+            "339999995214436424907732413799364296704\n",
+      out);
+  ASSERT_EQ(out, to_string(tuple));
+}
+
+TEST(TupleTest, merge_and_copy)
+{
+  Tuple left;
+  left.add("ab", 2);
+  left.add(1);
+  Tuple right;
+  right.add("cde", 3);
+  right.add(1.5f);
+  right.add("f", 1);
+
+  Tuple joined;
+  joined.merge(left);
+  joined.merge(right);
+  ASSERT_EQ("ab | 1 | cde | 1.5 | f\n", to_string(joined));
+
+  Tuple projected;
+  projected.add(joined, 4);
+  projected.add(joined, 2);
+  projected.add(joined, 1);
+  ASSERT_EQ("f | cde | 1\n", to_string(projected));
+
+  Tuple moved(std::move(projected));
+  ASSERT_EQ("f | cde | 1\n", to_string(moved));
+}
+
+TEST(TupleTest, compare)
+{
+  Tuple tuple;
+  tuple.add(3);
+  tuple.add(5);
+  tuple.add(3.0000001f);
+  tuple.add("abc", 3);
+  tuple.add("abd", 3);
+  tuple.add(0, true);
+
+  ASSERT_LT(tuple.compare(0, tuple, 1), 0);
+  ASSERT_GT(tuple.compare(1, tuple, 0), 0);
+  ASSERT_EQ(0, tuple.compare(0, tuple, 2));
+  ASSERT_LT(tuple.compare(3, tuple, 4), 0);
+  ASSERT_EQ(0, tuple.compare(3, tuple, 3));
+  // null和任何值比较都返回-1
+  ASSERT_EQ(-1, tuple.compare(5, tuple, 0));
+  ASSERT_EQ(-1, tuple.compare(0, tuple, 5));
+}
+
+TEST(TupleTest, encode)
+{
+  TupleSchema schema;
+  schema.add(INTS, "t", "id");
+  schema.add(CHARS, "u", "name", true);
+  std::string out;
+  schema.encode(out);
+  ASSERT_EQ(WIRE_FRAME_SCHEMA, out[0]);
+  ASSERT_EQ(out.size() - WIRE_FRAME_HEADER_SIZE, wire_get_u32(out.data() + 1));
+  const char *p = out.data() + WIRE_FRAME_HEADER_SIZE;
+  ASSERT_EQ(2, wire_get_u16(p));
+  // 有多张表时列名带表名，和print相同
+  ASSERT_EQ(WIRE_VALUE_INT, p[2]);
+  ASSERT_EQ(4, wire_get_u16(p + 3));
+  ASSERT_EQ("t.id", std::string(p + 5, 4));
+  ASSERT_EQ(WIRE_VALUE_STRING, p[9]);
+  ASSERT_EQ("u.name", std::string(p + 12, wire_get_u16(p + 10)));
+
+  Tuple tuple;
+  tuple.add(-3);
+  tuple.add(1.5f);
+  tuple.add("apple", 5);
+  tuple.add("NULL", 4, true);
+  out.clear();
+  TupleSet::encode_tuple(out, tuple);
+  p = out.data();
+  ASSERT_EQ(4, wire_get_u16(p));
+  ASSERT_EQ(WIRE_VALUE_INT, p[2]);
+  ASSERT_EQ(-3, (int)wire_get_u32(p + 3));
+  ASSERT_EQ(WIRE_VALUE_FLOAT, p[7]);
+  ASSERT_FLOAT_EQ(1.5f, wire_get_f32(p + 8));
+  ASSERT_EQ(WIRE_VALUE_STRING, p[12]);
+  ASSERT_EQ(5, wire_get_u16(p + 13));
+  ASSERT_EQ("apple", std::string(p + 15, 5));
+  ASSERT_EQ(WIRE_VALUE_NULL, p[20]);
+  ASSERT_EQ(21u, out.size());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
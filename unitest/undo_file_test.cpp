@@ -0,0 +1,69 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for undo records kept in buffer pool pages.
+//
+
+#include <unistd.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include "storage/common/undo_file.h"
+#include "gtest/gtest.h"
+
+TEST(UndoFileTest, append_and_read)
+{
+  const char *file_name = "undo_file_test.undo";
+  // 缓冲池比undo记录占用的页面少，读取时要从磁盘上重新加载
+  DiskBufferPool pool(8);
+  UndoFile undo_file;
+  ASSERT_EQ(RC::SUCCESS, undo_file.open(&pool, file_name));
+
+  std::vector<UndoPtr> ptrs;
+  for (int i = 0; i < 100; i++)
+  {
+    std::vector<char> data(300 + i * 7, (char)i);
+    UndoPtr ptr;
+    ASSERT_EQ(RC::SUCCESS, undo_file.append(data.data(), (int)data.size(), &ptr));
+    ptrs.push_back(ptr);
+  }
+  ASSERT_GT(undo_file.used_size(), 8 * pool.page_data_size());
+
+  std::vector<char> data;
+  for (int i = 0; i < 100; i++)
+  {
+    ASSERT_EQ(RC::SUCCESS, undo_file.read(ptrs[i], data));
+    ASSERT_EQ(std::vector<char>(300 + i * 7, (char)i), data);
+  }
+
+  // reset之后从头复用页面，超过使用范围的位置不能读
+  undo_file.reset();
+  ASSERT_EQ(0, undo_file.used_size());
+  ASSERT_EQ(RC::INTERNAL, undo_file.read(ptrs[0], data));
+  const char record[] = "after reset";
+  UndoPtr ptr;
+  ASSERT_EQ(RC::SUCCESS, undo_file.append(record, sizeof(record), &ptr));
+  ASSERT_EQ(0, ptr.offset);
+  ASSERT_EQ(RC::SUCCESS, undo_file.read(ptr, data));
+  ASSERT_EQ(0, memcmp(record, data.data(), sizeof(record)));
+
+  // 关闭时删除文件
+  undo_file.close();
+  ASSERT_NE(0, access(file_name, F_OK));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
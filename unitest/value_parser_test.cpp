@@ -0,0 +1,93 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the conversion from text to values.
+//
+
+#include <string>
+#include <string_view>
+
+#include "common/lang/string.h"
+#include "sql/parser/value_parser.h"
+#include "gtest/gtest.h"
+
+TEST(ValueParserTest, str_to_number)
+{
+  int i = 0;
+  ASSERT_TRUE(common::str_to_int("123", i));
+  ASSERT_EQ(123, i);
+  ASSERT_TRUE(common::str_to_int("-2147483648", i));
+  ASSERT_EQ(-2147483648LL, i);
+  ASSERT_TRUE(common::str_to_int("+7", i));
+  ASSERT_EQ(7, i);
+  ASSERT_FALSE(common::str_to_int("", i));
+  ASSERT_FALSE(common::str_to_int("+", i));
+  ASSERT_FALSE(common::str_to_int("+-1", i));
+  ASSERT_FALSE(common::str_to_int("12a", i));
+  ASSERT_FALSE(common::str_to_int(" 12", i));
+  ASSERT_FALSE(common::str_to_int("2147483648", i));
+  // 只解析string_view范围内的字符
+  ASSERT_TRUE(common::str_to_int(std::string_view("4567", 2), i));
+  ASSERT_EQ(45, i);
+
+  float f = 0;
+  ASSERT_TRUE(common::str_to_float("1.5", f));
+  ASSERT_EQ(1.5f, f);
+  ASSERT_TRUE(common::str_to_float("-3", f));
+  ASSERT_EQ(-3.0f, f);
+  ASSERT_TRUE(common::str_to_float("+2.25", f));
+  ASSERT_EQ(2.25f, f);
+  ASSERT_FALSE(common::str_to_float("1.5.", f));
+  ASSERT_FALSE(common::str_to_float("", f));
+  ASSERT_FALSE(common::str_to_float("1e100", f));
+}
+
+TEST(ValueParserTest, parse_value)
+{
+  ValueBuffer buffer;
+  Value value;
+  ASSERT_EQ(RC::SUCCESS, parse_value(INTS, "42", buffer, value));
+  ASSERT_EQ(INTS, value.type);
+  ASSERT_EQ(42, *(int *)value.data);
+  ASSERT_EQ(0, value.is_null);
+  ASSERT_EQ(RC::SCHEMA_FIELD_TYPE_MISMATCH, parse_value(INTS, "4.2", buffer, value));
+
+  ASSERT_EQ(RC::SUCCESS, parse_value(FLOATS, "4.5", buffer, value));
+  ASSERT_EQ(FLOATS, value.type);
+  ASSERT_EQ(4.5f, *(float *)value.data);
+
+  ASSERT_EQ(RC::SUCCESS, parse_value(DATES, "1970-01-02", buffer, value));
+  ASSERT_EQ(DATES, value.type);
+  ASSERT_EQ(1, *(int *)value.data);
+  ASSERT_EQ(RC::SUCCESS, parse_value(DATES, "2038-1-31", buffer, value));
+  ASSERT_EQ(DATE_MAX_DAYS, *(int *)value.data);
+  ASSERT_EQ(RC::SCHEMA_FIELD_TYPE_MISMATCH, parse_value(DATES, "2038-02-01", buffer, value));
+  ASSERT_EQ(RC::SCHEMA_FIELD_TYPE_MISMATCH, parse_value(DATES, "2021-02-29", buffer, value));
+  ASSERT_EQ(RC::SCHEMA_FIELD_TYPE_MISMATCH, parse_value(DATES, "2021-01-011", buffer, value));
+
+  // 字符串复制到buffer中，以'\0'结尾
+  const char *line = "abc|def";
+  ASSERT_EQ(RC::SUCCESS, parse_value(CHARS, std::string_view(line, 3), buffer, value));
+  ASSERT_EQ(CHARS, value.type);
+  ASSERT_STREQ("abc", (const char *)value.data);
+
+  parse_string_value("2021-10-01", buffer, value);
+  ASSERT_EQ(DATES, value.type);
+  parse_string_value("2021-10-32", buffer, value);
+  ASSERT_EQ(CHARS, value.type);
+  ASSERT_STREQ("2021-10-32", (const char *)value.data);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
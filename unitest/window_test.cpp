@@ -0,0 +1,187 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for window functions over sorted input.
+//
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sql/executor/execution_node.h"
+#include "gtest/gtest.h"
+
+/**
+ * 依次输出构造时给出的(part, score)，输入已经按窗口的字段排好序
+ */
+class VectorExeNode : public ExecutionNode {
+public:
+  VectorExeNode(const std::vector<std::pair<int, int>> &rows) : rows_(rows)
+  {
+    schema_.add(INTS, "t", "part");
+    schema_.add(INTS, "t", "score", true);
+  }
+
+  const TupleSchema &schema() const override
+  {
+    return schema_;
+  }
+  std::string explain() const override
+  {
+    return "VECTOR";
+  }
+
+protected:
+  RC do_open() override
+  {
+    pos_ = 0;
+    return RC::SUCCESS;
+  }
+  RC do_next(Tuple &tuple) override
+  {
+    if (pos_ >= rows_.size()) {
+      return RC::RECORD_EOF;
+    }
+    const std::pair<int, int> &row = rows_[pos_++];
+    Tuple result;
+    result.add(row.first);
+    // score为负数时表示null
+    result.add(row.second, row.second < 0);
+    tuple = std::move(result);
+    return RC::SUCCESS;
+  }
+  RC do_close() override
+  {
+    return RC::SUCCESS;
+  }
+
+private:
+  TupleSchema schema_;
+  std::vector<std::pair<int, int>> rows_;
+  size_t pos_ = 0;
+};
+
+static RelAttr make_attr(const char *name, bool desc = false)
+{
+  RelAttr attr{};
+  attr.attribute_name = const_cast<char *>(name);
+  attr.is_desc = desc ? 1 : 0;
+  return attr;
+}
+
+static WindowFunction make_function(WindowFuncType type, const char *arg, const char *name)
+{
+  return WindowFunction{type, nullptr, arg, name};
+}
+
+static RC run_window(const std::vector<std::pair<int, int>> &rows, const WindowSpec &window,
+    std::vector<WindowFunction> &&functions, std::vector<std::string> &output)
+{
+  WindowExeNode node(new VectorExeNode(rows), &window, std::move(functions));
+  RC rc = node.open();
+  if (rc != RC::SUCCESS) {
+    return rc;
+  }
+  Tuple tuple;
+  while ((rc = node.next(tuple)) == RC::SUCCESS) {
+    std::stringstream ss;
+    for (int i = 0; i < tuple.size(); i++) {
+      ss << (i == 0 ? "" : " | ");
+      if (tuple.is_null(i)) {
+        ss << "NULL";
+      } else {
+        tuple.print_value(ss, i);
+      }
+    }
+    output.push_back(ss.str());
+  }
+  node.close();
+  return rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+}
+
+TEST(WindowTest, rank_and_running_sum)
+{
+  // partition by part order by score desc
+  WindowSpec window{};
+  window.partition_num = 1;
+  window.order_num = 1;
+  window.attrs[0] = make_attr("part");
+  window.attrs[1] = make_attr("score", true);
+
+  std::vector<WindowFunction> functions;
+  functions.push_back(make_function(WindowFuncType::ROW_NUMBER, "*", "row_number()"));
+  functions.push_back(make_function(WindowFuncType::RANK, "*", "rank()"));
+  functions.push_back(make_function(WindowFuncType::DENSE_RANK, "*", "dense_rank()"));
+  functions.push_back(make_function(WindowFuncType::SUM, "score", "sum(score)"));
+
+  std::vector<std::pair<int, int>> rows = {{1, 90}, {1, 90}, {1, 80}, {2, 70}, {2, 60}, {2, 60}};
+  std::vector<std::string> output;
+  ASSERT_EQ(RC::SUCCESS, run_window(rows, window, std::move(functions), output));
+  // 相同score的行有相同的排名，sum计算到这组相同的行为止
+  std::vector<std::string> expected = {
+      "1 | 90 | 1 | 1 | 1 | 180",
+      "1 | 90 | 2 | 1 | 1 | 180",
+      "1 | 80 | 3 | 3 | 2 | 260",
+      "2 | 70 | 1 | 1 | 1 | 70",
+      "2 | 60 | 2 | 2 | 2 | 190",
+      "2 | 60 | 3 | 2 | 2 | 190",
+  };
+  ASSERT_EQ(expected, output);
+}
+
+TEST(WindowTest, whole_partition)
+{
+  // partition by part，没有order by时整个分区的值都相同
+  WindowSpec window{};
+  window.partition_num = 1;
+  window.attrs[0] = make_attr("part");
+
+  std::vector<WindowFunction> functions;
+  functions.push_back(make_function(WindowFuncType::COUNT, "*", "count(*)"));
+  functions.push_back(make_function(WindowFuncType::COUNT, "score", "count(score)"));
+  functions.push_back(make_function(WindowFuncType::MAX, "score", "max(score)"));
+
+  std::vector<std::pair<int, int>> rows = {{1, 10}, {1, -1}, {1, 30}, {2, -1}};
+  std::vector<std::string> output;
+  ASSERT_EQ(RC::SUCCESS, run_window(rows, window, std::move(functions), output));
+  std::vector<std::string> expected = {
+      "1 | 10 | 3 | 2 | 30",
+      "1 | NULL | 3 | 2 | 30",
+      "1 | 30 | 3 | 2 | 30",
+      "2 | NULL | 1 | 0 | NULL",
+  };
+  ASSERT_EQ(expected, output);
+}
+
+TEST(WindowTest, empty_input)
+{
+  WindowSpec window{};
+  std::vector<WindowFunction> functions;
+  functions.push_back(make_function(WindowFuncType::ROW_NUMBER, "*", "row_number()"));
+  std::vector<std::string> output;
+  ASSERT_EQ(RC::SUCCESS, run_window({}, window, std::move(functions), output));
+  ASSERT_TRUE(output.empty());
+}
+
+TEST(WindowTest, sum_needs_number)
+{
+  WindowSpec window{};
+  std::vector<WindowFunction> functions;
+  functions.push_back(make_function(WindowFuncType::SUM, "*", "sum()"));
+  std::vector<std::string> output;
+  ASSERT_EQ(RC::SCHEMA_FIELD_TYPE_MISMATCH, run_window({{1, 1}}, window, std::move(functions), output));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
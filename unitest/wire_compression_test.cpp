@@ -0,0 +1,104 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the compressed frames of responses.
+//
+
+#include <algorithm>
+#include <string>
+
+#include "net/wire_compression.h"
+#include "gtest/gtest.h"
+
+static std::string make_rows(int rows)
+{
+  std::string data;
+  for (int i = 0; i < rows; i++) {
+    data += std::to_string(i) + " | name_" + std::to_string(i % 100) + " | 3.5\n";
+  }
+  return data;
+}
+
+TEST(WireCompressionTest, names)
+{
+  WireCompression compression = WIRE_COMPRESSION_NONE;
+  ASSERT_TRUE(wire_compression_from_string("LZ4", &compression));
+  ASSERT_EQ(WIRE_COMPRESSION_LZ4, compression);
+  ASSERT_TRUE(wire_compression_from_string("zstd", &compression));
+  ASSERT_EQ(WIRE_COMPRESSION_ZSTD, compression);
+  ASSERT_FALSE(wire_compression_from_string("snappy", &compression));
+  ASSERT_TRUE(wire_compression_supported(WIRE_COMPRESSION_NONE));
+}
+
+TEST(WireCompressionTest, round_trip)
+{
+  const std::string data = make_rows(100000);
+  ASSERT_GT(data.size(), (size_t)WIRE_COMPRESSION_BLOCK_SIZE);
+  for (WireCompression compression : {WIRE_COMPRESSION_ZLIB, WIRE_COMPRESSION_LZ4, WIRE_COMPRESSION_ZSTD}) {
+    if (!wire_compression_supported(compression)) {
+      continue;
+    }
+    std::string frames;
+    wire_compress(compression, data.data(), data.size(), WIRE_COMPRESSION_THRESHOLD_DEFAULT, frames);
+    ASSERT_LT(frames.size(), data.size() / 2);
+    ASSERT_EQ(WIRE_COMPRESSED_FRAME_COMPRESSED, frames[0]);
+
+    // 数据分成很小的片段收到也能解开
+    WireDecompressor decompressor(compression);
+    std::string out;
+    for (size_t i = 0; i < frames.size(); i += 7) {
+      ASSERT_TRUE(decompressor.feed(frames.data() + i, std::min((size_t)7, frames.size() - i), out));
+    }
+    ASSERT_EQ(data, out);
+  }
+}
+
+TEST(WireCompressionTest, small_data_is_plain)
+{
+  // 不到阈值或者压缩不了的数据原样发送，没有编译压缩库时也能解开
+  const std::string data = "SUCCESS\n";
+  std::string frames;
+  wire_compress(WIRE_COMPRESSION_LZ4, data.data(), data.size() + 1, WIRE_COMPRESSION_THRESHOLD_DEFAULT, frames);
+  ASSERT_EQ(WIRE_COMPRESSED_FRAME_HEADER_SIZE + data.size() + 1, frames.size());
+  ASSERT_EQ(WIRE_COMPRESSED_FRAME_PLAIN, frames[0]);
+
+  WireDecompressor decompressor(WIRE_COMPRESSION_LZ4);
+  std::string out;
+  ASSERT_TRUE(decompressor.feed(frames.data(), frames.size(), out));
+  ASSERT_EQ(std::string(data.c_str(), data.size() + 1), out);
+}
+
+TEST(WireCompressionTest, corrupt)
+{
+  WireDecompressor decompressor(WIRE_COMPRESSION_ZLIB);
+  std::string out;
+  std::string frames;
+  wire_put_u8(frames, 'X');
+  wire_put_u32(frames, 4);
+  wire_put_u32(frames, 4);
+  frames += "abcd";
+  ASSERT_FALSE(decompressor.feed(frames.data(), frames.size(), out));
+
+  // 原始长度超过一帧的上限
+  WireDecompressor big(WIRE_COMPRESSION_ZLIB);
+  frames.clear();
+  wire_put_u8(frames, WIRE_COMPRESSED_FRAME_COMPRESSED);
+  wire_put_u32(frames, WIRE_COMPRESSION_BLOCK_SIZE + 1);
+  wire_put_u32(frames, 4);
+  ASSERT_FALSE(big.feed(frames.data(), frames.size(), out));
+  ASSERT_TRUE(out.empty());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,124 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for the work stealing deque of the thread pool.
+//
+
+#include <pthread.h>
+
+#include <atomic>
+#include <vector>
+
+#include "common/seda/work_stealing_queue.h"
+#include "gtest/gtest.h"
+
+using namespace common;
+
+TEST(WorkStealingQueueTest, single_thread)
+{
+  WorkStealingQueue<int> queue;
+  int items[4] = {0, 1, 2, 3};
+  ASSERT_EQ(nullptr, queue.pop());
+  ASSERT_EQ(nullptr, queue.steal());
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(queue.push(&items[i]));
+  }
+  ASSERT_EQ(4, queue.size());
+
+  // 自己从底部后进先出，别的线程从顶部先进先出
+  ASSERT_EQ(&items[3], queue.pop());
+  ASSERT_EQ(&items[0], queue.steal());
+  ASSERT_EQ(&items[2], queue.pop());
+  ASSERT_EQ(&items[1], queue.steal());
+  ASSERT_EQ(nullptr, queue.pop());
+  ASSERT_EQ(nullptr, queue.steal());
+  ASSERT_EQ(0, queue.size());
+}
+
+TEST(WorkStealingQueueTest, full)
+{
+  WorkStealingQueue<int> queue;
+  int item = 0;
+  for (int64_t i = 0; i < WorkStealingQueue<int>::CAPACITY; i++) {
+    ASSERT_TRUE(queue.push(&item));
+  }
+  ASSERT_FALSE(queue.push(&item));
+  ASSERT_EQ(&item, queue.steal());
+  ASSERT_TRUE(queue.push(&item));
+}
+
+struct StealContext {
+  WorkStealingQueue<int> *queue;
+  std::atomic<bool> *done;
+  std::vector<int> *taken;  // 每个元素被取走的次数
+};
+
+static void *thief(void *arg)
+{
+  StealContext *ctx = (StealContext *)arg;
+  while (true) {
+    bool done = ctx->done->load();
+    int *item = ctx->queue->steal();
+    if (item != nullptr) {
+      __sync_fetch_and_add(&(*ctx->taken)[*item], 1);
+    } else if (done && ctx->queue->size() == 0) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+TEST(WorkStealingQueueTest, steal_exactly_once)
+{
+  const int num = 200000;
+  const int thief_num = 3;
+  WorkStealingQueue<int> queue;
+  std::atomic<bool> done(false);
+  std::vector<int> values(num);
+  std::vector<int> taken(num, 0);
+  StealContext ctx{&queue, &done, &taken};
+
+  pthread_t threads[thief_num];
+  for (int i = 0; i < thief_num; i++) {
+    ASSERT_EQ(0, pthread_create(&threads[i], nullptr, thief, &ctx));
+  }
+
+  // 所有者一边放一边取，和小偷争抢最后一个元素
+  for (int i = 0; i < num; i++) {
+    values[i] = i;
+    while (!queue.push(&values[i])) {
+      int *item = queue.pop();
+      if (item != nullptr) {
+        __sync_fetch_and_add(&taken[*item], 1);
+      }
+    }
+    if (i % 3 == 0) {
+      int *item = queue.pop();
+      if (item != nullptr) {
+        __sync_fetch_and_add(&taken[*item], 1);
+      }
+    }
+  }
+  done.store(true);
+  for (int i = 0; i < thief_num; i++) {
+    pthread_join(threads[i], nullptr);
+  }
+
+  for (int i = 0; i < num; i++) {
+    ASSERT_EQ(1, taken[i]) << "i=" << i;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
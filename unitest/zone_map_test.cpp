@@ -0,0 +1,234 @@
+/* Copyright (c) 2021 Xie Meiyi(xiemeiyi@hust.edu.cn) and OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+//
+// Tests for zone map.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "storage/common/zone_map.h"
+#include "storage/common/table_meta.h"
+#include "storage/common/condition_filter.h"
+#include "gtest/gtest.h"
+
+static const char *ZONE_MAP_FILE = "zone_map_test.zone";
+
+class ZoneMapTest : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    remove(ZONE_MAP_FILE);
+    AttrInfo attributes[] = {
+        {(char *)"id", INTS, 4, 0},
+        {(char *)"score", FLOATS, 4, 1},
+        {(char *)"name", CHARS, 8, 0},
+    };
+    ASSERT_EQ(RC::SUCCESS, table_meta_.init("t", 3, attributes));
+  }
+
+  void TearDown() override
+  {
+    remove(ZONE_MAP_FILE);
+  }
+
+  // score为负数时表示null
+  std::vector<char> make_record(int id, float score)
+  {
+    std::vector<char> data(table_meta_.record_data_size(), 0);
+    memcpy(data.data() + table_meta_.field("id")->offset(), &id, sizeof(id));
+    memcpy(data.data() + table_meta_.field("score")->offset(), &score, sizeof(score));
+    if (score < 0) {
+      table_meta_.null_flag(table_meta_.find_field_index_by_name("score")).set(data.data(), true);
+    }
+    return data;
+  }
+
+  bool match(const ZoneMap &zone_map, PageNum page_num, const char *field, CompOp op, AttrType type, void *value,
+             bool value_on_left = false)
+  {
+    ConDesc attr = {true, NullFlag(), 4, table_meta_.field(field)->offset(), nullptr};
+    ConDesc constant = {false, NullFlag(), 0, 0, value};
+    DefaultConditionFilter filter;
+    if (value_on_left) {
+      filter.init(constant, attr, type, op, type);
+    } else {
+      filter.init(attr, constant, type, op, type);
+    }
+    return zone_map.may_match(page_num, &filter);
+  }
+
+  TableMeta table_meta_;
+};
+
+TEST_F(ZoneMapTest, test_may_match)
+{
+  ZoneMap zone_map;
+  zone_map.init(table_meta_, ZONE_MAP_FILE);
+  ASSERT_TRUE(zone_map.enabled());
+
+  for (int id = 10; id < 20; id++) {
+    zone_map.update(2, make_record(id, id * 1.5f).data());
+  }
+  for (int id = 100; id < 110; id++) {
+    zone_map.update(3, make_record(id, -1).data());
+  }
+
+  int v = 15;
+  ASSERT_TRUE(match(zone_map, 2, "id", EQUAL_TO, INTS, &v));
+  ASSERT_FALSE(match(zone_map, 3, "id", EQUAL_TO, INTS, &v));
+  v = 19;
+  ASSERT_FALSE(match(zone_map, 2, "id", GREAT_THAN, INTS, &v));
+  ASSERT_TRUE(match(zone_map, 2, "id", GREAT_EQUAL, INTS, &v));
+  ASSERT_TRUE(match(zone_map, 3, "id", GREAT_THAN, INTS, &v));
+  // 19 > id
+  ASSERT_TRUE(match(zone_map, 2, "id", GREAT_THAN, INTS, &v, true));
+  ASSERT_FALSE(match(zone_map, 3, "id", GREAT_THAN, INTS, &v, true));
+  v = 10;
+  ASSERT_FALSE(match(zone_map, 2, "id", LESS_THAN, INTS, &v));
+  ASSERT_TRUE(match(zone_map, 2, "id", LESS_EQUAL, INTS, &v));
+
+  // 第3页的score都是null，比较都不成立
+  float f = 15.0f;
+  ASSERT_TRUE(match(zone_map, 2, "score", EQUAL_TO, FLOATS, &f));
+  ASSERT_FALSE(match(zone_map, 3, "score", EQUAL_TO, FLOATS, &f));
+  ASSERT_FALSE(match(zone_map, 3, "score", NOT_EQUAL, FLOATS, &f));
+  ASSERT_TRUE(match(zone_map, 3, "score", IS_NULL, FLOATS, &f));
+  f = 28.5f;
+  ASSERT_TRUE(match(zone_map, 2, "score", GREAT_EQUAL, FLOATS, &f));
+  ASSERT_FALSE(match(zone_map, 2, "score", GREAT_THAN, FLOATS, &f));
+
+  // 没有记录过的页面和没有跟踪的字段不能跳过
+  v = 15;
+  ASSERT_TRUE(match(zone_map, 10, "id", EQUAL_TO, INTS, &v));
+  char name[8] = "abc";
+  ASSERT_TRUE(match(zone_map, 2, "name", EQUAL_TO, CHARS, name));
+
+  // 组合条件中任何一个不满足都可以跳过
+  ConDesc id_attr = {true, NullFlag(), 4, table_meta_.field("id")->offset(), nullptr};
+  int low = 12;
+  int high = 105;
+  ConDesc low_value = {false, NullFlag(), 0, 0, &low};
+  ConDesc high_value = {false, NullFlag(), 0, 0, &high};
+  DefaultConditionFilter greater;
+  DefaultConditionFilter less;
+  greater.init(id_attr, low_value, INTS, GREAT_THAN, INTS);
+  less.init(id_attr, high_value, INTS, LESS_THAN, INTS);
+  const ConditionFilter *filters[] = {&greater, &less};
+  CompositeConditionFilter composite;
+  composite.init(filters, 2);
+  ASSERT_TRUE(zone_map.may_match(2, &composite));
+  ASSERT_TRUE(zone_map.may_match(3, &composite));
+  low = 20;
+  ASSERT_FALSE(zone_map.may_match(2, &composite));
+
+  zone_map.reset_page(2);
+  v = 15;
+  ASSERT_FALSE(match(zone_map, 2, "id", EQUAL_TO, INTS, &v));
+}
+
+TEST_F(ZoneMapTest, test_save_and_load)
+{
+  {
+    ZoneMap zone_map;
+    zone_map.init(table_meta_, ZONE_MAP_FILE);
+    ASSERT_EQ(RC::NOTFOUND, zone_map.load());
+    zone_map.update(1, make_record(1, 1.0f).data());
+    zone_map.update(5, make_record(50, 5.0f).data());
+    ASSERT_EQ(RC::SUCCESS, zone_map.save());
+  }
+
+  {
+    ZoneMap zone_map;
+    zone_map.init(table_meta_, ZONE_MAP_FILE);
+    ASSERT_EQ(RC::SUCCESS, zone_map.load());
+    int v = 50;
+    ASSERT_FALSE(match(zone_map, 1, "id", EQUAL_TO, INTS, &v));
+    ASSERT_TRUE(match(zone_map, 5, "id", EQUAL_TO, INTS, &v));
+    ASSERT_FALSE(match(zone_map, 3, "id", EQUAL_TO, INTS, &v));
+
+    // 修改之前标记为不完整，没有再保存时下次加载失败
+    ASSERT_EQ(RC::SUCCESS, zone_map.mark_dirty());
+    zone_map.update(3, make_record(50, 5.0f).data());
+  }
+
+  ZoneMap zone_map;
+  zone_map.init(table_meta_, ZONE_MAP_FILE);
+  ASSERT_NE(RC::SUCCESS, zone_map.load());
+}
+
+TEST_F(ZoneMapTest, test_bloom_filter)
+{
+  ASSERT_EQ(RC::SUCCESS, table_meta_.set_bloom_filter_field("name"));
+  ASSERT_NE(RC::SUCCESS, table_meta_.set_bloom_filter_field("score"));
+  auto make_named_record = [this](int id, const char *name) {
+    std::vector<char> data = make_record(id, 1.0f);
+    strncpy(data.data() + table_meta_.field("name")->offset(), name, 8);
+    return data;
+  };
+
+  {
+    ZoneMap zone_map;
+    zone_map.init(table_meta_, ZONE_MAP_FILE);
+    ASSERT_TRUE(zone_map.bloom_enabled());
+    // 第0个区段是0到ZONE_MAP_EXTENT_PAGES - 1页
+    for (int id = 0; id < 1000; id++) {
+      std::string name = "a" + std::to_string(id);
+      zone_map.update(id % ZONE_MAP_EXTENT_PAGES, make_named_record(id, name.c_str()).data());
+    }
+    zone_map.update(ZONE_MAP_EXTENT_PAGES, make_named_record(5000, "b").data());
+
+    char name[8] = "a17";
+    ASSERT_TRUE(match(zone_map, 1, "name", EQUAL_TO, CHARS, name));
+    ASSERT_TRUE(match(zone_map, 1, "name", EQUAL_TO, CHARS, name, true));
+    ASSERT_FALSE(match(zone_map, ZONE_MAP_EXTENT_PAGES, "name", EQUAL_TO, CHARS, name));
+    // 其它比较符和没有记录过的区段不能跳过
+    ASSERT_TRUE(match(zone_map, ZONE_MAP_EXTENT_PAGES, "name", NOT_EQUAL, CHARS, name));
+    ASSERT_TRUE(match(zone_map, 10 * ZONE_MAP_EXTENT_PAGES, "name", EQUAL_TO, CHARS, name));
+
+    // 1000个值中没有的值，误判的比例很低
+    int false_positives = 0;
+    for (int i = 0; i < 1000; i++) {
+      std::string missing = "c" + std::to_string(i);
+      snprintf(name, sizeof(name), "%s", missing.c_str());
+      false_positives += match(zone_map, 0, "name", EQUAL_TO, CHARS, name) ? 1 : 0;
+    }
+    ASSERT_LT(false_positives, 10);
+    ASSERT_EQ(RC::SUCCESS, zone_map.save());
+  }
+
+  ZoneMap zone_map;
+  zone_map.init(table_meta_, ZONE_MAP_FILE);
+  ASSERT_EQ(RC::SUCCESS, zone_map.load());
+  char name[8] = "b";
+  ASSERT_FALSE(match(zone_map, 0, "name", EQUAL_TO, CHARS, name));
+  ASSERT_TRUE(match(zone_map, ZONE_MAP_EXTENT_PAGES + 1, "name", EQUAL_TO, CHARS, name));
+
+  // 清空之后区段中没有任何值
+  zone_map.reset_extent_bloom_filter(1);
+  ASSERT_FALSE(match(zone_map, ZONE_MAP_EXTENT_PAGES + 1, "name", EQUAL_TO, CHARS, name));
+
+  // 表的布隆过滤器字段和文件对不上时重建
+  TableMeta other_meta(table_meta_);
+  ASSERT_EQ(RC::SUCCESS, other_meta.set_bloom_filter_field("id"));
+  ZoneMap other;
+  other.init(other_meta, ZONE_MAP_FILE);
+  ASSERT_NE(RC::SUCCESS, other.load());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}